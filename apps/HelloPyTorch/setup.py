@@ -21,6 +21,16 @@ def generate_pybind_wrapper(path, headers, has_cuda):
         name = os.path.splitext(h)[0]
         s += "  m.def(\"{}\", &{}_th_, \"PyTorch wrapper of the Halide pipeline {}\");\n".format(
           name, name, name)
+        # Ops generated with -d 2 also have their gradient, and a
+        # differentiable version that uses both.
+        pytorch_header = os.path.join(os.path.dirname(path), name + ".pytorch.h")
+        with open(pytorch_header) as fid:
+            has_autograd = (name + "_autograd_th_") in fid.read()
+        if has_autograd:
+            s += "  m.def(\"{}_grad\", &{}_grad_th_, \"PyTorch wrapper of the gradient of the Halide pipeline {}\");\n".format(
+              name, name, name)
+            s += "  m.def(\"{}_autograd\", &{}_autograd_th_, \"Differentiable PyTorch wrapper of the Halide pipeline {}\");\n".format(
+              name, name, name)
     s += "}\n"
     with open(path, 'w') as fid:
         fid.write(s)
@@ -43,12 +53,18 @@ if __name__ == "__main__":
     else:
         has_cuda = True
 
+    # Optionally run the parallel loops of the Halide ops on PyTorch's
+    # intra-op thread pool, rather than Halide's own
+    use_aten_thread_pool = os.getenv("USE_ATEN_THREAD_POOL") == "1"
+
     include_dirs = [build_dir, os.path.join(halide_dir, "include")]
     # Note that recent versions of PyTorch (at least 1.7.1) requires C++14
     # in order to compile extensions
     compile_args = ["-std=c++14", "-g"]
     if platform.system() == "Darwin":  # on osx libstdc++ causes trouble
         compile_args += ["-stdlib=libc++"]
+    if use_aten_thread_pool:
+        compile_args += ["-DHL_PYTORCH_USE_ATEN_THREAD_POOL"]
 
     re_cc = re.compile(r".*\.pytorch\.h")
     hl_srcs = [f for f in os.listdir(build_dir) if re_cc.match(f)]
@@ -31,6 +31,25 @@ class TestAdd(unittest.TestCase):
             return
         self._test_add(is_cuda=True, is_double=True)
 
+    def test_cpu_autograd(self):
+        # add_autograd_float32 is generated with -d 2, so it is directly
+        # differentiable, without a hand-written autograd.Function.
+        def add(a, b):
+            return modules.ops.add_autograd_float32(a, b, th.empty_like(a))[0]
+
+        output = add(self.a, self.b)
+        diff = (output-self.gt).sum().item()
+        assert diff == 0.0, "Test failed: sum should be 4, got %f" % diff
+
+        self.a.requires_grad = True
+        self.b.requires_grad = True
+        add(self.a, self.b).sum().backward()
+        assert (self.a.grad == 1).all() and (self.b.grad == 1).all()
+
+        warnings.filterwarnings(
+            "ignore", module=r".*gradcheck*")
+        th.autograd.gradcheck(add, [self.a, self.b], eps=1e-2, atol=1e-2)
+
     def _test_add(self, is_cuda=False, is_double=False):
         if is_double:
             self.a = self.a.double()
@@ -3,6 +3,7 @@
 namespace {
 
 using namespace Halide;
+using namespace Halide::ConciseCasts;
 
 class ConvolutionLayer : public Halide::Generator<ConvolutionLayer> {
 public:
@@ -12,6 +13,8 @@ public:
     Output<Buffer<float, 4>> relu{"relu"};
 
     void generate() {
+        // The batch size is not fixed; N is only used as an estimate for
+        // the autoscheduler.
         const int N = 5, CI = 128, CO = 128, W = 100, H = 80;
 
         /* THE ALGORITHM */
@@ -35,12 +38,12 @@ public:
         relu.dim(0).set_bounds(0, CO).set_stride(1);
         relu.dim(1).set_bounds(0, W).set_stride(CO);
         relu.dim(2).set_bounds(0, H).set_stride(CO * W);
-        relu.dim(3).set_bounds(0, N).set_stride(CO * H * W);
+        relu.dim(3).set_min(0).set_stride(CO * H * W);
 
         input.dim(0).set_bounds(0, CI).set_stride(1);
         input.dim(1).set_bounds(0, W + 2).set_stride(CI);
         input.dim(2).set_bounds(0, H + 2).set_stride(CI * (W + 2));
-        input.dim(3).set_bounds(0, N).set_stride(CI * (W + 2) * (H + 2));
+        input.dim(3).set_bounds(0, relu.dim(3).extent()).set_stride(CI * (W + 2) * (H + 2));
 
         filter.dim(0).set_bounds(0, CO).set_stride(1);
         filter.dim(1).set_bounds(0, 3).set_stride(CO);
@@ -202,6 +205,169 @@ public:
     }
 };
 
+// The same layer, quantized to 8 bits. Activations are uint8 (or int8 on
+// ARM, see configure()), weights are int8, and the int32 accumulator is
+// requantized to uint8 with a fixed point multiplier and shift. The
+// reduction over input channels is written so that it maps to dot product
+// instructions where they exist (vpdpbusd with AVX512_SapphireRapids,
+// sdot with ARMDotProd).
+class QuantizedConvolutionLayer : public Halide::Generator<QuantizedConvolutionLayer> {
+public:
+    Input<Buffer<void, 4>> input{"input"};
+    // The filter is packed so that groups of 4 input channels are adjacent
+    // for each output channel: (CI % 4, CO, 3, 3, CI / 4).
+    Input<Buffer<int8_t, 5>> filter{"filter"};
+    Input<Buffer<int32_t, 1>> bias{"bias"};
+    Input<int32_t> output_multiplier{"output_multiplier"};
+    Input<uint32_t> output_shift{"output_shift"};
+    Output<Buffer<uint8_t, 4>> relu{"relu"};
+
+    void configure() {
+        // ARM only has dot products of operands with the same signedness.
+        if (get_target().arch == Target::ARM) {
+            input.set_type(Int(8));
+        } else {
+            input.set_type(UInt(8));
+        }
+    }
+
+    void generate() {
+        const int N = 5, CI = 128, CO = 128, W = 100, H = 80;
+
+        /* THE ALGORITHM */
+
+        Var x("x"), y("y"), c("c"), n("n");
+
+        Func conv("conv");
+        RDom r(0, CI, 0, 3, 0, 3);
+
+        conv(c, x, y, n) = bias(c);
+        conv(c, x, y, n) += i32(widening_mul(filter(r.x % 4, c, r.y, r.z, r.x / 4),
+                                             input(r.x, x + r.y, y + r.z, n)));
+
+        Expr requantized = rounding_mul_shift_right(conv(c, x, y, n), output_multiplier, 31);
+        requantized = rounding_shift_right(requantized, output_shift);
+        relu(c, x, y, n) = u8_sat(max(0, requantized));
+
+        /* THE SCHEDULE */
+
+        relu.dim(0).set_bounds(0, CO).set_stride(1);
+        relu.dim(1).set_bounds(0, W).set_stride(CO);
+        relu.dim(2).set_bounds(0, H).set_stride(CO * W);
+        relu.dim(3).set_min(0).set_stride(CO * H * W);
+
+        input.dim(0).set_bounds(0, CI).set_stride(1);
+        input.dim(1).set_bounds(0, W + 2).set_stride(CI);
+        input.dim(2).set_bounds(0, H + 2).set_stride(CI * (W + 2));
+        input.dim(3).set_bounds(0, relu.dim(3).extent()).set_stride(CI * (W + 2) * (H + 2));
+
+        filter.dim(0).set_bounds(0, 4).set_stride(1);
+        filter.dim(1).set_bounds(0, CO).set_stride(4);
+        filter.dim(2).set_bounds(0, 3).set_stride(4 * CO);
+        filter.dim(3).set_bounds(0, 3).set_stride(4 * CO * 3);
+        filter.dim(4).set_bounds(0, CI / 4).set_stride(4 * CO * 3 * 3);
+
+        bias.dim(0).set_bounds(0, CO).set_stride(1);
+
+        if (using_autoscheduler()) {
+            input.dim(0).set_estimate(0, CI);
+            input.dim(1).set_estimate(0, W + 2);
+            input.dim(2).set_estimate(0, H + 2);
+            input.dim(3).set_estimate(0, N);
+
+            filter.dim(0).set_estimate(0, 4);
+            filter.dim(1).set_estimate(0, CO);
+            filter.dim(2).set_estimate(0, 3);
+            filter.dim(3).set_estimate(0, 3);
+            filter.dim(4).set_estimate(0, CI / 4);
+
+            bias.dim(0).set_estimate(0, CO);
+
+            output_multiplier.set_estimate(1 << 30);
+            output_shift.set_estimate(8);
+
+            relu.dim(0).set_estimate(0, CO);
+            relu.dim(1).set_estimate(0, W);
+            relu.dim(2).set_estimate(0, H);
+            relu.dim(3).set_estimate(0, N);
+
+        } else if (get_target().has_gpu_feature()) {
+            // A simple GPU schedule, one output per thread.
+            Var xi, xo, ci, co;
+            relu.compute_root()
+                .gpu_tile(c, x, co, xo, ci, xi, 32, 4);
+
+            conv.compute_at(relu, ci)
+                .update()
+                .unroll(r.y)
+                .unroll(r.z);
+
+        } else {
+            // This uses the same register tiling as the float schedule
+            // above, with int32 accumulators. The reduction over input
+            // channels is vectorized in groups that map to a single dot
+            // product instruction, and the rest of each group of 4 is
+            // unrolled.
+            int tile_w = 1;
+            int tile_h = 1;
+            const int vec = natural_vector_size<int32_t>();
+
+            if (get_target().has_feature(Target::AVX512_Skylake) ||
+                (get_target().arch == Target::ARM &&
+                 get_target().bits == 64)) {
+                tile_w = 4;
+                tile_h = 5;
+            } else if (get_target().arch == Target::X86) {
+                tile_w = 3;
+                tile_h = 4;
+            } else {
+                tile_w = 2;
+                tile_h = 4;
+            }
+
+            // Most targets can do 2-way widening multiply-adds, but
+            // these have 4-way 8-bit dot products.
+            int vector_reduction = 2;
+            if (get_target().has_feature(Target::AVX512_SapphireRapids) ||
+                get_target().has_feature(Target::ARMDotProd)) {
+                vector_reduction = 4;
+            }
+
+            Var co, ci, xo, xi;
+            RVar rco, rci;
+            relu.split(c, co, ci, vec * tile_w)
+                .split(x, xo, xi, tile_h)
+                .reorder(ci, xi, xo, y, n, co)
+                .vectorize(ci, vec)
+                .unroll(ci)
+                .unroll(xi)
+                .parallel(y)
+                .parallel(n)
+                .parallel(co);
+            conv.compute_at(relu, xo)
+                .vectorize(c, vec)
+                .unroll(c)
+                .unroll(x)
+                .unroll(y)
+                .update()
+                .split(r.x, rco, rci, 4)
+                .reorder(rci, c, x, y, rco, r.y, r.z, n)
+                .vectorize(c, vec)
+                .unroll(c)
+                .unroll(x)
+                .unroll(y)
+                .atomic()
+                .vectorize(rci, vector_reduction)
+                .unroll(rci);
+            input.in()
+                .compute_at(conv, x)
+                .vectorize(_0, 4)
+                .unroll(_0);
+        }
+    }
+};
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(ConvolutionLayer, conv_layer)
+HALIDE_REGISTER_GENERATOR(QuantizedConvolutionLayer, conv_layer_int8)
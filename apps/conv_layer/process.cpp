@@ -1,8 +1,10 @@
 #include <chrono>
 #include <cstdio>
+#include <cstdlib>
 
 #include "conv_layer.h"
 #include "conv_layer_auto_schedule.h"
+#include "conv_layer_int8.h"
 
 #include "HalideBuffer.h"
 #include "halide_benchmark.h"
@@ -11,22 +13,11 @@ using namespace Halide::Tools;
 using namespace Halide::Runtime;
 
 int main(int argc, char **argv) {
-    const int N = 5, CI = 128, CO = 128, W = 100, H = 80;
+    const int CI = 128, CO = 128, W = 100, H = 80;
 
-    Buffer<float, 4> input(CI, W + 2, H + 2, N);
     Buffer<float, 4> filter(CO, 3, 3, CI);
     Buffer<float, 1> bias(CO);
 
-    for (int c = 0; c < input.dim(3).extent(); c++) {
-        for (int z = 0; z < input.channels(); z++) {
-            for (int y = 0; y < input.height(); y++) {
-                for (int x = 0; x < input.width(); x++) {
-                    input(x, y, z, c) = rand();
-                }
-            }
-        }
-    }
-
     for (int c = 0; c < filter.dim(3).extent(); c++) {
         for (int z = 0; z < filter.channels(); z++) {
             for (int y = 0; y < filter.height(); y++) {
@@ -41,7 +32,17 @@ int main(int argc, char **argv) {
         bias(x) = rand();
     }
 
-    Buffer<float, 4> output(CO, W, H, N);
+    // The quantized layer wants its filter packed in groups of 4 input
+    // channels: (CI % 4, CO, 3, 3, CI / 4).
+    Buffer<int8_t, 5> filter_int8(4, CO, 3, 3, CI / 4);
+    Buffer<int32_t, 1> bias_int8(CO);
+    filter_int8.for_each_value([](int8_t &v) { v = (int8_t)(rand() % 256 - 128); });
+    bias_int8.for_each_value([](int32_t &v) { v = rand() % 1024 - 512; });
+    const int32_t output_multiplier = 1 << 30;
+    const uint32_t output_shift = 12;
+
+    // The int8 layer takes int8 activations on ARM and uint8 elsewhere.
+    const halide_type_t input_int8_type = conv_layer_int8_metadata()->arguments[0].type;
 
 // This is necessary to get the PTX compiler to do a good
 // job. TODO: This should be a scheduling directive or a runtime
@@ -52,23 +53,49 @@ int main(int argc, char **argv) {
     setenv("HL_CUDA_JIT_MAX_REGISTERS", "256", 1);
 #endif
 
-    conv_layer(input, filter, bias, output);
+    for (int N : {1, 8, 32}) {
+        Buffer<float, 4> input(CI, W + 2, H + 2, N);
+        input.for_each_value([](float &v) { v = rand(); });
+
+        Buffer<> input_int8(input_int8_type, CI, W + 2, H + 2, N);
+        if (input_int8_type.code == halide_type_int) {
+            input_int8.as<int8_t>().for_each_value([](int8_t &v) { v = (int8_t)(rand() % 256 - 128); });
+        } else {
+            input_int8.as<uint8_t>().for_each_value([](uint8_t &v) { v = (uint8_t)(rand() % 256); });
+        }
 
-    // Timing code
+        Buffer<float, 4> output(CO, W, H, N);
+        Buffer<uint8_t, 4> output_int8(CO, W, H, N);
 
-    // Manually-tuned version
-    double min_t_manual = benchmark(10, 10, [&]() {
         conv_layer(input, filter, bias, output);
-        output.device_sync();
-    });
-    printf("Manually-tuned time: %gms\n", min_t_manual * 1e3);
-
-    // Auto-scheduled version
-    double min_t_auto = benchmark(10, 10, [&]() {
-        conv_layer_auto_schedule(input, filter, bias, output);
-        output.device_sync();
-    });
-    printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
+
+        // Timing code
+
+        printf("Batch size %d:\n", N);
+
+        // Manually-tuned version
+        double min_t_manual = benchmark(10, 10, [&]() {
+            conv_layer(input, filter, bias, output);
+            output.device_sync();
+        });
+        printf("  Manually-tuned time: %gms\n", min_t_manual * 1e3);
+
+        // Auto-scheduled version
+        double min_t_auto = benchmark(10, 10, [&]() {
+            conv_layer_auto_schedule(input, filter, bias, output);
+            output.device_sync();
+        });
+        printf("  Auto-scheduled time: %gms\n", min_t_auto * 1e3);
+
+        // Quantized version
+        double min_t_int8 = benchmark(10, 10, [&]() {
+            conv_layer_int8(input_int8, filter_int8, bias_int8,
+                            output_multiplier, output_shift, output_int8);
+            output_int8.device_sync();
+        });
+        printf("  Int8 time: %gms (%.2fx the manually-tuned float time)\n",
+               min_t_int8 * 1e3, min_t_manual / min_t_int8);
+    }
 
     printf("Success!\n");
     return 0;
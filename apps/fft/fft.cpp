@@ -476,6 +476,14 @@ std::pair<FuncType, FuncType> tiled_transpose(FuncType f, int max_tile_size,
     return {fT, f_tiledT};
 }
 
+// Parallelize all of the stages of f over the batch dimension outer.
+void parallelize_batch(Func f, const Var &outer) {
+    f.parallel(outer);
+    for (int i = 0; i < f.num_update_definitions(); i++) {
+        f.update(i).parallel(outer);
+    }
+}
+
 }  // namespace
 
 ComplexFunc fft2d_c2c(ComplexFunc x,
@@ -545,6 +553,10 @@ ComplexFunc fft2d_c2c(ComplexFunc x,
 
     dft1T.compute_at(dft, outer);
 
+    if (desc.parallel_batch && x.dimensions() > 2) {
+        parallelize_batch(dft, outer);
+    }
+
     dft.bound(dft.args()[0], 0, N0);
     dft.bound(dft.args()[1], 0, N1);
 
@@ -707,6 +719,9 @@ ComplexFunc fft2d_r2c(Func r,
         result.bound(n1, 0, (N1 + 1) / 2 + 1);
         result.vectorize(n0, std::min(N0, target.natural_vector_size(result.types()[0])));
         dft.compute_at(result, outer);
+        if (desc.parallel_batch && !args.empty()) {
+            result.parallel(outer);
+        }
         return result;
     }
 
@@ -871,9 +886,13 @@ ComplexFunc fft2d_r2c(Func r,
     dft.update(4).allow_race_conditions().vectorize(n0z1, vector_size);
     dft.update(5).allow_race_conditions().vectorize(n0z2, vector_size);
 
-    // Intentionally serial
-    dft.update(0).unscheduled();
-    dft.update(3).unscheduled();
+    if (desc.parallel_batch && !args.empty()) {
+        parallelize_batch(dft, outer);
+    } else {
+        // Intentionally serial
+        dft.update(0).unscheduled();
+        dft.update(3).unscheduled();
+    }
 
     // Our result is undefined outside these bounds.
     dft.bound(n0, 0, N0);
@@ -1053,6 +1072,9 @@ Func fft2d_c2r(ComplexFunc c,
             .unroll(n0, gcd(N0 / zip_width, 4));
     }
     dft.compute_at(unzipped, outer);
+    if (desc.parallel_batch && !args.empty()) {
+        unzipped.parallel(outer);
+    }
 
     unzipped.bound(n0, 0, N0);
     unzipped.bound(n1, 0, N1);
@@ -1088,6 +1110,15 @@ vector<int> radix_factor(int N) {
         }
     }
 
+    // A lone radix 2 stage is much less efficient than the others. If we have
+    // one and a radix 8 stage, replace them with two radix 4 stages instead.
+    auto r2 = std::find(R.begin(), R.end(), 2);
+    auto r8 = std::find(R.begin(), R.end(), 8);
+    if (r2 != R.end() && r8 != R.end()) {
+        *r8 = 4;
+        *r2 = 4;
+    }
+
     // If there are still factors left over, just include them as a radix.
     if (N != 1 || R.empty()) {
         R.push_back(N);
@@ -30,6 +30,12 @@ struct Fft2dDesc {
     // if there is no outer loop around FFTs that can be parallelized.
     bool parallel = false;
 
+    // The following option indicates that the FFT should parallelize over the
+    // innermost dimension outside of the FFT, i.e. across a batch of FFTs. This
+    // is usually a better way to use multiple cores than parallel (above) when
+    // there are many FFTs to compute. It has no effect on 2D inputs.
+    bool parallel_batch = false;
+
     // This option will schedule the input to the FFT at the innermost location
     // that makes sense.
     bool schedule_input = false;
@@ -4,6 +4,7 @@
 // algorithms.
 
 #include "Halide.h"
+#include <algorithm>
 #include <cmath>  // for log2
 #include <cstdio>
 #include <vector>
@@ -230,10 +231,96 @@ int main(int argc, char **argv) {
            2.5 * W * H * (log2(W) + log2(H)) / fftw_t,
            fftw_t / halide_t);
 
+    // Batched FFTs, as used by frequency domain convolution of many images.
+    // Unlike the benchmarks above, each FFT in the batch writes to its own
+    // output, so the batch can be computed in parallel. FFTW is single threaded
+    // here, so the ratio includes the speedup due to the parallelism.
+    const int batch = std::max(1, std::min(256, (1 << 20) / (W * H)));
+    Fft2dDesc fwd_batch_desc = fwd_desc;
+    fwd_batch_desc.parallel_batch = true;
+    Fft2dDesc inv_batch_desc = inv_desc;
+    inv_batch_desc.parallel_batch = true;
+
+    printf("\nBatches of %d:\n", batch);
+
+    Func bench_c2c_batch = fft2d_c2c(c2c_in, W, H, -1, target, fwd_batch_desc);
+    Realization R_c2c_batch = bench_c2c_batch.realize({W, H, batch}, target);
+
+    halide_t = benchmark(samples, 1, [&]() { bench_c2c_batch.realize(R_c2c_batch); }) * 1e6 / batch;
+#ifdef WITH_FFTW
+    // Planning a whole batch exhaustively is very slow, so just measure.
+    const int fftw_n[] = {W, H};
+    std::vector<std::pair<float, float>> fftw_c1_batch(W * H * batch);
+    std::vector<std::pair<float, float>> fftw_c2_batch(W * H * batch);
+    fftwf_plan c2c_batch_plan =
+        fftwf_plan_many_dft(2, fftw_n, batch,
+                            (fftwf_complex *)&fftw_c1_batch[0], nullptr, 1, W * H,
+                            (fftwf_complex *)&fftw_c2_batch[0], nullptr, 1, W * H,
+                            FFTW_FORWARD, FFTW_MEASURE);
+    fftw_t = benchmark(samples, 1, [&]() { fftwf_execute(c2c_batch_plan); }) * 1e6 / batch;
+#else
+    fftw_t = 0;
+#endif
+    printf("%12s %10.3f %10.2f %10.3f %10.2f %10.3g\n",
+           "c2c",
+           halide_t,
+           5 * W * H * (log2(W) + log2(H)) / halide_t,
+           fftw_t,
+           5 * W * H * (log2(W) + log2(H)) / fftw_t,
+           fftw_t / halide_t);
+
+    Func bench_r2c_batch = fft2d_r2c(r2c_in, W, H, target, fwd_batch_desc);
+    Realization R_r2c_batch = bench_r2c_batch.realize({W, H / 2 + 1, batch}, target);
+
+    halide_t = benchmark(samples, 1, [&]() { bench_r2c_batch.realize(R_r2c_batch); }) * 1e6 / batch;
+#ifdef WITH_FFTW
+    std::vector<float> fftw_r_batch(W * H * batch);
+    fftwf_plan r2c_batch_plan =
+        fftwf_plan_many_dft_r2c(2, fftw_n, batch,
+                                &fftw_r_batch[0], nullptr, 1, W * H,
+                                (fftwf_complex *)&fftw_c1_batch[0], nullptr, 1, W * (H / 2 + 1),
+                                FFTW_MEASURE);
+    fftw_t = benchmark(samples, 1, [&]() { fftwf_execute(r2c_batch_plan); }) * 1e6 / batch;
+#else
+    fftw_t = 0;
+#endif
+    printf("%12s %10.3f %10.2f %10.3f %10.2f %10.3g\n",
+           "r2c",
+           halide_t,
+           2.5 * W * H * (log2(W) + log2(H)) / halide_t,
+           fftw_t,
+           2.5 * W * H * (log2(W) + log2(H)) / fftw_t,
+           fftw_t / halide_t);
+
+    Func bench_c2r_batch = fft2d_c2r(c2r_in, W, H, target, inv_batch_desc);
+    Realization R_c2r_batch = bench_c2r_batch.realize({W, H, batch}, target);
+
+    halide_t = benchmark(samples, 1, [&]() { bench_c2r_batch.realize(R_c2r_batch); }) * 1e6 / batch;
+#ifdef WITH_FFTW
+    fftwf_plan c2r_batch_plan =
+        fftwf_plan_many_dft_c2r(2, fftw_n, batch,
+                                (fftwf_complex *)&fftw_c1_batch[0], nullptr, 1, W * (H / 2 + 1),
+                                &fftw_r_batch[0], nullptr, 1, W * H,
+                                FFTW_MEASURE);
+    fftw_t = benchmark(samples, 1, [&]() { fftwf_execute(c2r_batch_plan); }) * 1e6 / batch;
+#else
+    fftw_t = 0;
+#endif
+    printf("%12s %10.3f %10.2f %10.3f %10.2f %10.3g\n",
+           "c2r",
+           halide_t,
+           2.5 * W * H * (log2(W) + log2(H)) / halide_t,
+           fftw_t,
+           2.5 * W * H * (log2(W) + log2(H)) / fftw_t,
+           fftw_t / halide_t);
+
 #ifdef WITH_FFTW
     fftwf_destroy_plan(c2c_plan);
     fftwf_destroy_plan(r2c_plan);
     fftwf_destroy_plan(c2r_plan);
+    fftwf_destroy_plan(c2c_batch_plan);
+    fftwf_destroy_plan(r2c_batch_plan);
+    fftwf_destroy_plan(c2r_batch_plan);
 #endif
 
     return 0;
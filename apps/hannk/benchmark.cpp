@@ -1,4 +1,5 @@
 #include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 
@@ -35,6 +36,9 @@ void run_benchmark(const std::string &filename, const InterpreterOptions &option
     if (!options.trace) {
         auto result = Halide::Tools::benchmark([&]() { interpreter.execute(); });
         std::cout << ": " << result.wall_time * 1e6 << " us" << std::endl;
+        if (options.profile_ops) {
+            interpreter.dump_op_timings(std::cout);
+        }
 
         halide_profiler_report(nullptr);
         halide_profiler_reset();
@@ -61,6 +65,19 @@ __attribute__((visibility("default"))) int main(int argc, char **argv) {
             options.trace = true;
             continue;
         }
+        if (!strcmp(argv[i], "--profile_ops")) {
+            options.profile_ops = true;
+            continue;
+        }
+        if (!strcmp(argv[i], "--no_winograd")) {
+            // To compare against the direct convolutions.
+            options.winograd = false;
+            continue;
+        }
+        if (!strncmp(argv[i], "--hexagon_offload_min_macs=", 27)) {
+            options.hexagon_offload_min_macs = std::atoll(argv[i] + 27);
+            continue;
+        }
         if (argv[i][0] == '-') {
             HLOG(ERROR) << "Unknown flag: " << argv[i] << ".\n";
             exit(1);
@@ -1043,6 +1043,7 @@ class NodeSupport {
         F64 = 1 << kTfLiteFloat64,
         BOOLTYPE = 1 << kTfLiteBool,
         I32_OR_NONE = I32 | NONE,
+        F32_OR_NONE = F32 | NONE,
         ANY_ARITHMETIC = U8 | I8 | I16 | I32 | F32 | F64,
         ANY = (int)0xffffffff
     };
@@ -1193,7 +1194,8 @@ class NodeSupport {
         if (!IsVersionOK(1, 2)) {
             return false;
         }
-        if (!InputsHaveCorrectTypes({U8 | I32, U8 | I32})) {
+        if (!InputsHaveCorrectTypes({U8 | I32, U8 | I32}) &&
+            !InputsHaveCorrectTypes({F32, F32})) {
             return false;
         }
         const TfLiteAddParams *params = (const TfLiteAddParams *)(node_->builtin_data);
@@ -1207,7 +1209,8 @@ class NodeSupport {
         if (!IsVersionOK(1, 2)) {
             return false;
         }
-        if (!InputsHaveCorrectTypes({U8 | I32, U8 | I32})) {
+        if (!InputsHaveCorrectTypes({U8 | I32, U8 | I32}) &&
+            !InputsHaveCorrectTypes({F32, F32})) {
             return false;
         }
         const TfLiteSubParams *params = (const TfLiteSubParams *)(node_->builtin_data);
@@ -1221,7 +1224,8 @@ class NodeSupport {
         if (!IsVersionOK(1, 2)) {
             return false;
         }
-        if (!InputsHaveCorrectTypes({U8 | I32, U8 | I32})) {
+        if (!InputsHaveCorrectTypes({U8 | I32, U8 | I32}) &&
+            !InputsHaveCorrectTypes({F32, F32})) {
             return false;
         }
         const TfLiteMulParams *params = (const TfLiteMulParams *)(node_->builtin_data);
@@ -1383,7 +1387,8 @@ class NodeSupport {
         if (!IsVersionOK(1, 2)) {
             return false;
         }
-        if (!InputsHaveCorrectTypes({U8, U8, I32})) {
+        if (!InputsHaveCorrectTypes({U8, U8, I32}) &&
+            !InputsHaveCorrectTypes({F32, F32, F32})) {
             return false;
         }
         const TfLiteConvParams *params = (const TfLiteConvParams *)(node_->builtin_data);
@@ -1397,7 +1402,8 @@ class NodeSupport {
         if (!IsVersionOK(1, 2)) {
             return false;
         }
-        if (!InputsHaveCorrectTypes({U8, U8, I32})) {
+        if (!InputsHaveCorrectTypes({U8, U8, I32}) &&
+            !InputsHaveCorrectTypes({F32, F32, F32})) {
             return false;
         }
         const TfLiteDepthwiseConvParams *params = (const TfLiteDepthwiseConvParams *)(node_->builtin_data);
@@ -1415,7 +1421,8 @@ class NodeSupport {
         if (!(InputsHaveCorrectTypes({U8, U8, I32_OR_NONE}) && OutputsHaveCorrectTypes({U8})) &&
             // Not sure if this combination is actually expected, but models in the wild
             // require it, so we'll support it
-            !(InputsHaveCorrectTypes({U8, U8, I32_OR_NONE}) && OutputsHaveCorrectTypes({I16}))) {
+            !(InputsHaveCorrectTypes({U8, U8, I32_OR_NONE}) && OutputsHaveCorrectTypes({I16})) &&
+            !(InputsHaveCorrectTypes({F32, F32, F32_OR_NONE}) && OutputsHaveCorrectTypes({F32}))) {
             return false;
         }
         const TfLiteFullyConnectedParams *params = (const TfLiteFullyConnectedParams *)(node_->builtin_data);
@@ -1429,7 +1436,7 @@ class NodeSupport {
         if (!IsVersionOK(1, 2)) {
             return false;
         }
-        if (!InputsHaveCorrectTypes({U8})) {
+        if (!InputsHaveCorrectTypes({U8 | F32})) {
             return false;
         }
         const TfLitePoolParams *params = (const TfLitePoolParams *)(node_->builtin_data);
@@ -1451,7 +1458,7 @@ class NodeSupport {
         if (!IsVersionOK(1, 2)) {
             return false;
         }
-        if (!InputsHaveCorrectTypes({U8, I32})) {
+        if (!InputsHaveCorrectTypes({U8 | F32, I32})) {
             return false;
         }
         return true;
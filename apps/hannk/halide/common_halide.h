@@ -5,6 +5,8 @@
 
 #include "Halide.h"
 
+#include <vector>
+
 namespace hannk {
 
 using Halide::rounding_shift_right;
@@ -69,6 +71,15 @@ Halide::Expr quantize_i16(const Halide::Expr &x, const Halide::Expr &multiplier,
 Halide::Expr quantize_and_relu_u8(const Halide::Expr &x, const Halide::Expr &multiplier, const Halide::Expr &shift, const Halide::Expr &zero,
                                   const Halide::Expr &min, const Halide::Expr &max, const Halide::Target &target);
 
+// Interpret an elementwise program (see interpreter/elementwise_program.h) on
+// the given inputs, which are loaded into scratch slots -1, -2, ... Returns the
+// scratch Func, indexed by args and then the slot. The results of the program
+// are in the last slots. The scratch is stored in registers, which limits
+// programs to max_instructions instructions.
+Halide::Func interpret_elementwise_program(const std::vector<Halide::Expr> &inputs, const std::vector<Halide::Var> &args,
+                                           const Halide::ImageParam &program, const Halide::Type &intermediate_type,
+                                           int max_instructions);
+
 }  // namespace hannk
 
 #endif  // HANNK_COMMON_HALIDE_H
@@ -13,6 +13,16 @@ constexpr int mul_input_shift = 6;
 
 constexpr int softmax_input_shift = 6;
 
+// Elementwise programs fused into the output stage of the convolution
+// kernels are limited to this many instructions, so the scratch for the
+// program fits in registers.
+constexpr int max_epilogue_instructions = 12;
+
+// The largest sum of products in a Winograd convolution is 1020 * 2295 per
+// input channel (the largest transformed input and filter values), which
+// must not overflow 32 bits.
+constexpr int max_winograd_input_channels = 0x7fffffff / (1020 * 2295);
+
 }  // namespace hannk
 
 #endif  // HANNK_CONSTANTS_H
@@ -1,5 +1,6 @@
 #include "Halide.h"
 #include "halide/common_halide.h"
+#include "halide/constants.h"
 
 using namespace Halide;
 using namespace Halide::BoundaryConditions;
@@ -42,6 +43,17 @@ public:
     // to load vectors, so making this value larger helps for big reductions.
     GeneratorParam<int> unroll_reduction_{"unroll_reduction", 4};
 
+    // When true, an elementwise program (see interpreter/elementwise_program.h)
+    // is applied to the quantized output and an extra input before storing it,
+    // to avoid a separate pass over the output for the following op. Only
+    // supported for 8-bit outputs.
+    GeneratorParam<bool> epilogue_{"epilogue", false};
+
+    // When true, the convolution is offloaded to Hexagon HVX (see
+    // Func::hexagon), and scheduled for Hexagon rather than the host. The
+    // target must have the hvx feature.
+    GeneratorParam<bool> hexagon_offload_{"hexagon_offload", false};
+
     // Unsigned 8-bit input tensor, indexed by c, x, y, b.
     Input<Buffer<uint8_t, 4>> input_{"input"};
     Input<uint8_t> input_zero_{"input_zero"};
@@ -72,25 +84,44 @@ public:
 
     Output<Buffer<void, 4>> output_{"output"};
 
+    // The extra input and program of the epilogue, if any.
+    Input<Buffer<uint8_t, 4>> *epilogue_input_ = nullptr;
+    Input<Buffer<int16_t, 2>> *epilogue_program_ = nullptr;
+
+    // The target the convolution is computed on.
+    Target compute_target() const {
+        Target t = get_target();
+        if (hexagon_offload_) {
+            t.os = Target::NoOS;
+            t.arch = Target::Hexagon;
+            t.bits = 32;
+        }
+        return t;
+    }
+
     void configure() {
-        if (use_8bit_multiply(target)) {
+        if (use_8bit_multiply(compute_target())) {
             filter_.set_type(UInt(8));
         } else {
             filter_.set_type(Int(16));
         }
+        if (epilogue_) {
+            epilogue_input_ = add_input<Buffer<uint8_t, 4>>("epilogue_input");
+            epilogue_program_ = add_input<Buffer<int16_t, 2>>("epilogue_program");
+        }
     }
 
     void generate() {
         // The algorithm.
         Func input("input_wrapper");
         Expr input_cxyb = input_(c, x, y, b);
-        if (!use_8bit_multiply(target)) {
+        if (!use_8bit_multiply(compute_target())) {
             input_cxyb = i16(input_cxyb) - i16(input_zero_);
         }
         input(c, x, y, b) = input_cxyb;
 
         // Align the reduction loop of filter.
-        const int vector_reduction = get_vector_reduction_factor(target, UInt(8));
+        const int vector_reduction = get_vector_reduction_factor(compute_target(), UInt(8));
         const int unroll_reduction = std::max<int>(vector_reduction, unroll_reduction_);
         const int accum_vector_size = natural_vector_size<int32_t>();
 
@@ -109,7 +140,7 @@ public:
         Func offset_c("offset_c");
         Func sum_input("sum_input");
         Func convolved("convolved");
-        if (use_8bit_multiply(target)) {
+        if (use_8bit_multiply(compute_target())) {
             // We want to compute the reduction:
             // convolved(c, x, y, b) = bias_(c)
             // convolved(c, x, y, b) +=
@@ -152,9 +183,14 @@ public:
         Expr output;
         if (output_.type() == halide_type_of<uint8_t>()) {
             output = quantize_and_relu_u8(convolved(c, x, y, b), output_multiplier_, output_shift_, output_zero_,
-                                          output_min_, output_max_, target);
+                                          output_min_, output_max_, compute_target());
+            if (epilogue_) {
+                Func epilogue = interpret_elementwise_program({output, (*epilogue_input_)(c, x, y, b)}, {c, x, y, b},
+                                                              *epilogue_program_, Int(32), max_epilogue_instructions);
+                output = u8_sat(epilogue(c, x, y, b, epilogue_program_->dim(1).extent()));
+            }
         } else {
-            output = quantize_i16(convolved(c, x, y, b), output_multiplier_, output_shift_, target);
+            output = quantize_i16(convolved(c, x, y, b), output_multiplier_, output_shift_, compute_target());
         }
         output_(c, x, y, b) = output;
 
@@ -164,6 +200,11 @@ public:
         interpret_as_tensor(output_);
         require_same_min_extent(3, input_, output_);
         require_same_min_extent(0, bias_, output_);
+        if (epilogue_) {
+            for (int d = 0; d < 4; d++) {
+                require_same_min_extent(d, *epilogue_input_, output_);
+            }
+        }
 
         const int filter_alignment = vector_reduction * accum_vector_size;
         filter_.set_host_alignment(filter_alignment * filter_.type().bytes());
@@ -182,11 +223,16 @@ public:
         }
 
         output_.compute_root();
+        if (hexagon_offload_) {
+            // This must precede the specializations below, so they are all
+            // offloaded.
+            output_.hexagon();
+        }
 
         // Figure out how big the tiles we should optimize for should be by getting
         // the total number of accumulators best for this target and figuring out
         // tile sizes.
-        const int accumulators = get_accumulator_count(target);
+        const int accumulators = get_accumulator_count(compute_target());
         std::vector<std::pair<int, int>> tile_sizes;
         const int min_tile_c = 1;
         const int max_tile_c = 4;
@@ -232,7 +278,7 @@ public:
             .unroll(c, max_tile_c, TailStrategy::GuardWithIf)
             .unroll(x);
 
-        if (use_8bit_multiply(target)) {
+        if (use_8bit_multiply(compute_target())) {
             // Specialize this to avoid computing sum_input when it isn't needed.
             convolved.specialize(filter_zero_ == 0);
         }
@@ -254,7 +300,7 @@ public:
             convolved.update().specialize(filter_depth == vector_reduction);
         }
 
-        if (!use_8bit_multiply(target) && get_target().arch == Target::X86) {
+        if (!use_8bit_multiply(compute_target()) && compute_target().arch == Target::X86) {
             // On x86, widening subtracts eat up a lot of the already scarce
             // registers, so precomputing this outside the inner loop helps
             // a lot.
@@ -283,7 +329,7 @@ public:
                 .vectorize(c);
         }
 
-        if (use_8bit_multiply(target)) {
+        if (use_8bit_multiply(compute_target())) {
             // Precompute the channel offset at root.
             // TODO: This gets recomputed often when the op is split up into small
             // pieces.
@@ -363,7 +409,153 @@ public:
     }
 };
 
+// A float version of Conv. There are no offsets to subtract, so this is a
+// single reduction of multiply-adds.
+class ConvFloat : public Generator<ConvFloat> {
+public:
+    // 32-bit float input tensor, indexed by c, x, y, b.
+    Input<Buffer<float, 4>> input_{"input"};
+
+    // A 6D array of filter coefficients indexed by ci % n, co % k, ci / n, co / k, x, y,
+    // as for Conv, where n = 1 and k = accum_vector_size (below).
+    Input<Buffer<float, 6>> filter_{"filter"};
+
+    // A 1D array of biases. The bias should be added to the c dimension of
+    // the output.
+    Input<Buffer<float, 1>> bias_{"bias"};
+
+    // The stride and dilation are as for Conv.
+    Input<int> stride_x_{"stride_x"};
+    Input<int> stride_y_{"stride_y"};
+    Input<int> dilation_x_{"dilation_x"};
+    Input<int> dilation_y_{"dilation_y"};
+
+    Input<float> output_min_{"output_min"};
+    Input<float> output_max_{"output_max"};
+
+    Output<Buffer<float, 4>> output_{"output"};
+
+    void generate() {
+        // The algorithm.
+        const int accum_vector_size = natural_vector_size<float>();
+
+        Expr filter_depth = filter_.dim(2).extent();
+        Expr filter_width = filter_.dim(4).extent();
+        Expr filter_height = filter_.dim(5).extent();
+        RDom r(0, filter_width, 0, filter_height, 0, filter_depth);
+        Expr filter_rdxyc =
+            filter_(0, c % accum_vector_size, r.z, c / accum_vector_size, r.x, r.y);
+        Expr input_rdxyc =
+            input_(r.z, x * stride_x_ + r.x * dilation_x_, y * stride_y_ + r.y * dilation_y_, b);
+
+        Func convolved("convolved");
+        convolved(c, x, y, b) = bias_(c);
+        convolved(c, x, y, b) += input_rdxyc * filter_rdxyc;
+
+        output_(c, x, y, b) = clamp(convolved(c, x, y, b), output_min_, output_max_);
+
+        // Schedule.
+        interpret_as_tensor(input_);
+        interpret_as_tensor(bias_);
+        interpret_as_tensor(output_);
+        require_same_min_extent(3, input_, output_);
+        require_same_min_extent(0, bias_, output_);
+
+        filter_.set_host_alignment(accum_vector_size * sizeof(float));
+        filter_.dim(0).set_min(0).set_extent(1).set_stride(1);
+        filter_.dim(1).set_min(0).set_extent(accum_vector_size).set_stride(1);
+        filter_.dim(2).set_min(0).set_stride(accum_vector_size);
+        for (int d = 3; d < filter_.dimensions(); d++) {
+            filter_.dim(d).set_min(0).set_stride(align(filter_.dim(d).stride(), accum_vector_size));
+        }
+
+        input_.dim(0).set_min(0).set_extent(filter_depth);
+
+        output_.compute_root();
+
+        // Tile the output as for Conv.
+        const int accumulators = get_accumulator_count(target);
+        std::vector<std::pair<int, int>> tile_sizes;
+        const int min_tile_c = 1;
+        const int max_tile_c = 4;
+        for (int tile_c = max_tile_c; tile_c >= min_tile_c; tile_c /= 2) {
+            int tile_x = std::min(8, accumulators / tile_c);
+            tile_sizes.emplace_back(tile_c, tile_x);
+        }
+        tile_sizes.emplace_back(max_tile_c, 1);
+
+        Var xo("xo");
+        Expr output_channels = output_.dim(0).extent();
+        Expr output_width = output_.dim(1).extent();
+        for (auto i : tile_sizes) {
+            const int tile_c = i.first;
+            const int tile_x = i.second;
+            output_
+                .specialize(output_channels % (tile_c * accum_vector_size) == 0 && output_width >= tile_x)
+                .split(c, co, c, tile_c * accum_vector_size, TailStrategy::RoundUp)
+                .split(x, xo, x, tile_x, TailStrategy::ShiftInwards)
+                .reorder(x, c, co, xo, y, b)
+                .vectorize(c)
+                .unroll(x);
+        }
+
+        output_
+            .split(c, co, c, accum_vector_size * min_tile_c, TailStrategy::PredicateStores)
+            .split(x, xo, x, 1)
+            .reorder(c, x, co, xo, y, b)
+            .vectorize(c);
+
+        convolved.compute_at(output_, co)
+            .store_in(MemoryType::Stack)
+            .reorder(x, c)
+            .vectorize(c, accum_vector_size * min_tile_c, TailStrategy::RoundUp)
+            .unroll(c, max_tile_c, TailStrategy::GuardWithIf)
+            .unroll(x);
+
+        convolved.update()
+            .reorder(c, x, r.z, r.x, r.y)
+            .vectorize(c, accum_vector_size, TailStrategy::RoundUp)
+            .unroll(c, max_tile_c, TailStrategy::GuardWithIf)
+            .unroll(x);
+
+        bias_.in().compute_root().store_in(MemoryType::Stack);
+    }
+};
+
+// Tile a float filter for ConvFloat.
+class TileConvFilterFloat : public Generator<TileConvFilterFloat> {
+public:
+    // The filter, indexed by ci, x, y, co.
+    Input<Buffer<float, 4>> input_{"input"};
+
+    // 6D array of filter coefficients indexed by ci % n, co % k, ci / n, co / k, x, y,
+    // where n = 1 and k = vector_tile (below).
+    Output<Buffer<float, 6>> output_{"output"};
+
+    void generate() {
+        Func input_bounded = constant_exterior(input_, 0.0f);
+
+        const int vector_tile = natural_vector_size<float>();
+
+        Var bi("bi"), bo("bo");
+
+        output_(ci, bi, co, bo, x, y) = input_bounded(co, x, y, bo * vector_tile + bi);
+
+        // Schedule.
+        output_.dim(0).set_min(0).set_extent(1);
+        output_.dim(1).set_min(0).set_extent(vector_tile).set_stride(1);
+        output_.dim(2).set_min(0).set_stride(vector_tile);
+
+        output_
+            .compute_root()
+            .reorder(bi, ci, bo, x, y, co)
+            .vectorize(bi);
+    }
+};
+
 }  // namespace hannk
 
 HALIDE_REGISTER_GENERATOR(hannk::Conv, Conv)
+HALIDE_REGISTER_GENERATOR(hannk::ConvFloat, ConvFloat)
 HALIDE_REGISTER_GENERATOR(hannk::TileConvFilter, TileConvFilter)
+HALIDE_REGISTER_GENERATOR(hannk::TileConvFilterFloat, TileConvFilterFloat)
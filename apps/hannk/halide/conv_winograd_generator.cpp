@@ -0,0 +1,206 @@
+#include "Halide.h"
+#include "halide/common_halide.h"
+
+using namespace Halide;
+using namespace Halide::BoundaryConditions;
+using namespace Halide::ConciseCasts;
+
+namespace hannk {
+
+Var x("x"), y("y"), c("c"), b("b");
+Var co("co"), ci("ci"), xo("xo"), yo("yo");
+
+// The coordinates of the 4x4 tiles of the transformed input and filter, and
+// the 2x2 tiles of the output.
+Var tx("tx"), ty("ty"), ex("ex"), ey("ey"), ox("ox"), oy("oy");
+
+// The transforms of Winograd's F(2x2, 3x3) algorithm, applied to one
+// dimension at a time. d(i) is the i'th element of the tile being
+// transformed, and e selects the element of the result. These are
+// the B^T, G and A^T matrices of "Fast Algorithms for Convolutional
+// Neural Networks" (Lavin and Gray), except that G is multiplied by 2
+// to keep the filter transform in integers.
+Expr transform_input(const std::function<Expr(int)> &d, const Expr &e) {
+    return mux(e, {d(0) - d(2), d(1) + d(2), d(2) - d(1), d(1) - d(3)});
+}
+
+Expr transform_filter(const std::function<Expr(int)> &g, const Expr &e) {
+    return mux(e, {g(0) * 2, g(0) + g(1) + g(2), g(0) - g(1) + g(2), g(2) * 2});
+}
+
+Expr transform_output(const std::function<Expr(int)> &m, const Expr &o) {
+    return mux(o, {m(0) + m(1) + m(2), m(1) - m(2) - m(3)});
+}
+
+// A 3x3 convolution with stride 1 and no dilation, computed with Winograd's
+// F(2x2, 3x3) algorithm. This computes each 2x2 tile of the output with 16
+// multiplies per channel, rather than 36. The offsets are subtracted from the
+// input and filter before transforming them, so the sums of products don't
+// need the offset terms of the Conv generator. The magnitude of each product
+// is up to 1020 * 2295 (the largest transformed input and filter values), so
+// the number of input channels must be limited to avoid overflowing the sums
+// (see max_winograd_input_channels).
+class ConvWinograd : public Generator<ConvWinograd> {
+public:
+    // Unsigned 8-bit input tensor, indexed by c, x, y, b.
+    Input<Buffer<uint8_t, 4>> input_{"input"};
+    Input<uint8_t> input_zero_{"input_zero"};
+
+    // The filter, transformed by TileWinogradConvFilter, indexed by co, ci,
+    // and the coordinates ex, ey of the 4x4 transformed tile.
+    Input<Buffer<int16_t, 4>> filter_{"filter"};
+
+    // A 1D array of 32-bit biases. The bias should be added to the c
+    // dimension of the output.
+    Input<Buffer<int32_t, 1>> bias_{"bias"};
+
+    Input<int32_t> output_multiplier_{"output_multiplier"};
+    Input<int32_t> output_shift_{"output_shift"};
+    Input<uint8_t> output_zero_{"output_zero"};
+    Input<uint8_t> output_min_{"output_min"};
+    Input<uint8_t> output_max_{"output_max"};
+
+    Output<Buffer<uint8_t, 4>> output_{"output"};
+
+    void generate() {
+        // The algorithm.
+
+        // The last tile of an odd sized output reads one past the end of the
+        // input, the result of which is discarded.
+        Func input_bounded = repeat_edge(input_, {{Expr(), Expr()},
+                                                  {input_.dim(1).min(), input_.dim(1).extent()},
+                                                  {input_.dim(2).min(), input_.dim(2).extent()},
+                                                  {Expr(), Expr()}});
+        Func input_zeroed("input_zeroed");
+        input_zeroed(c, x, y, b) = i16(input_bounded(c, x, y, b)) - i16(input_zero_);
+
+        // The tiles are aligned to the min of the output.
+        Expr output_x0 = output_.dim(1).min();
+        Expr output_y0 = output_.dim(2).min();
+
+        // Transform 4x4 tiles of the input, overlapping by 2. The transformed
+        // values fit in 16 bits.
+        Func input_tx("input_tx");
+        input_tx(c, ex, tx, y, b) =
+            transform_input([&](int i) { return input_zeroed(c, output_x0 + tx * 2 + i, y, b); }, ex);
+        Func input_t("input_t");
+        input_t(c, ex, ey, tx, ty, b) =
+            transform_input([&](int j) { return input_tx(c, ex, tx, output_y0 + ty * 2 + j, b); }, ey);
+
+        // Multiply the transformed input and filter elementwise, and sum over
+        // the input channels.
+        RDom r(0, input_.dim(0).extent());
+        Func product("product");
+        product(c, ex, ey, tx, ty, b) = 0;
+        product(c, ex, ey, tx, ty, b) += i32(filter_(c, r, ex, ey)) * i32(input_t(r, ex, ey, tx, ty, b));
+
+        // Transform the products back to 2x2 tiles of the output. The
+        // intermediate values of this transform can overflow, but the result,
+        // which is 4 times the convolution (because of the factor of 2 in the
+        // filter transform), does not. Use unsigned values so this is well
+        // defined.
+        Func output_tx("output_tx");
+        output_tx(c, ox, ey, tx, ty, b) =
+            transform_output([&](int i) { return u32(product(c, i, ey, tx, ty, b)); }, ox);
+        Func output_t("output_t");
+        output_t(c, ox, oy, tx, ty, b) =
+            transform_output([&](int j) { return output_tx(c, ox, j, tx, ty, b); }, oy);
+
+        Expr output_x = x - output_x0;
+        Expr output_y = y - output_y0;
+        Expr convolved =
+            bias_(c) + (i32(output_t(c, output_x % 2, output_y % 2, output_x / 2, output_y / 2, b)) >> 2);
+        output_(c, x, y, b) = quantize_and_relu_u8(convolved, output_multiplier_, output_shift_, output_zero_,
+                                                   output_min_, output_max_, target);
+
+        // Schedule.
+        interpret_as_tensor(input_);
+        interpret_as_tensor(bias_);
+        interpret_as_tensor(output_);
+        require_same_min_extent(3, input_, output_);
+        require_same_min_extent(0, bias_, output_);
+        require_same_min_extent(0, filter_, output_);
+
+        input_.dim(0).set_min(0);
+        filter_.dim(0).set_stride(1);
+        filter_.dim(1).set_min(0).set_extent(input_.dim(0).extent());
+        filter_.dim(2).set_min(0).set_extent(4);
+        filter_.dim(3).set_min(0).set_extent(4);
+
+        const int vector_size = natural_vector_size<int32_t>();
+
+        // Compute 2x2 tiles of the output, one vector of channels at a time.
+        output_.compute_root()
+            .split(x, xo, x, 2, TailStrategy::GuardWithIf)
+            .split(y, yo, y, 2, TailStrategy::GuardWithIf)
+            .split(c, co, c, vector_size, TailStrategy::GuardWithIf)
+            .reorder(c, x, y, co, xo, yo, b)
+            .vectorize(c)
+            .unroll(x)
+            .unroll(y);
+
+        // The 16 sums of products of each tile are the accumulators.
+        product.compute_at(output_, co)
+            .store_in(MemoryType::Stack)
+            .vectorize(c, vector_size, TailStrategy::GuardWithIf)
+            .unroll(ex)
+            .unroll(ey);
+        product.update()
+            .reorder(c, ex, ey, r.x, tx, ty, b)
+            .vectorize(c, vector_size, TailStrategy::GuardWithIf)
+            .unroll(ex)
+            .unroll(ey);
+
+        // Transform the input tile once for all the output channels.
+        input_t.compute_at(output_, xo)
+            .reorder(c, ex, ey, tx, ty, b)
+            .vectorize(c, natural_vector_size<int16_t>(), TailStrategy::GuardWithIf)
+            .unroll(ex)
+            .unroll(ey);
+
+        bias_.in().compute_root().store_in(MemoryType::Stack);
+    }
+};
+
+// Subtract the offset from a 3x3 filter, transform it for ConvWinograd, and
+// reorder it so the output channels are innermost.
+class TileWinogradConvFilter : public Generator<TileWinogradConvFilter> {
+public:
+    // The filter, indexed by ci, x, y, co.
+    Input<Buffer<uint8_t, 4>> input_{"input"};
+    Input<uint8_t> input_zero_{"input_zero"};
+
+    // The transformed filter, indexed by co, ci, ex, ey.
+    Output<Buffer<int16_t, 4>> output_{"output"};
+
+    void generate() {
+        Func filter_zeroed("filter_zeroed");
+        filter_zeroed(ci, x, y, co) = i16(input_(ci, x, y, co)) - i16(input_zero_);
+
+        Func filter_tx("filter_tx");
+        filter_tx(ci, ex, y, co) =
+            transform_filter([&](int i) { return filter_zeroed(ci, input_.dim(1).min() + i, y, co); }, ex);
+        output_(co, ci, ex, ey) =
+            transform_filter([&](int j) { return filter_tx(ci, ex, input_.dim(2).min() + j, co); }, ey);
+
+        // Schedule.
+        input_.dim(1).set_extent(3);
+        input_.dim(2).set_extent(3);
+        output_.dim(0).set_stride(1);
+        output_.dim(2).set_min(0).set_extent(4);
+        output_.dim(3).set_min(0).set_extent(4);
+
+        // TODO: We probably don't care about the performance of this, but if we do,
+        // we could optimize this more.
+        output_.compute_root()
+            .reorder(co, ex, ey, ci)
+            .vectorize(co, natural_vector_size<int16_t>(), TailStrategy::GuardWithIf)
+            .unroll(ex)
+            .unroll(ey);
+    }
+};
+
+}  // namespace hannk
+
+HALIDE_REGISTER_GENERATOR(hannk::ConvWinograd, ConvWinograd)
+HALIDE_REGISTER_GENERATOR(hannk::TileWinogradConvFilter, TileWinogradConvFilter)
@@ -1,5 +1,6 @@
 #include "Halide.h"
 #include "halide/common_halide.h"
+#include "halide/constants.h"
 
 using namespace Halide;
 using namespace Halide::ConciseCasts;
@@ -19,6 +20,11 @@ public:
     // x of the input, instead of the x dimension of the buffer.
     GeneratorParam<bool> shallow_{"shallow", false};
 
+    // When true, an elementwise program (see interpreter/elementwise_program.h)
+    // is applied to the quantized output and an extra input before storing it,
+    // to avoid a separate pass over the output for the following op.
+    GeneratorParam<bool> epilogue_{"epilogue", false};
+
     // Unsigned 8-bit input tensor, indexed by ci, x, y, b.
     Input<Buffer<uint8_t, 4>> input_{"input"};
     Input<uint8_t> input_zero_{"input_zero"};
@@ -53,6 +59,17 @@ public:
 
     Output<Buffer<uint8_t, 4>> output_{"output"};
 
+    // The extra input and program of the epilogue, if any.
+    Input<Buffer<uint8_t, 4>> *epilogue_input_ = nullptr;
+    Input<Buffer<int16_t, 2>> *epilogue_program_ = nullptr;
+
+    void configure() {
+        if (epilogue_) {
+            epilogue_input_ = add_input<Buffer<uint8_t, 4>>("epilogue_input");
+            epilogue_program_ = add_input<Buffer<int16_t, 2>>("epilogue_program");
+        }
+    }
+
     void generate() {
         // The algorithm.
 
@@ -130,9 +147,15 @@ public:
         convolved(c, x, y, b) = offset_c(filter_c);
         convolved(c, x, y, b) += i32(filter_zeroed_rdxy) * i32(input_rdxy);
 
-        output_(c, x, y, b) =
+        Expr output =
             quantize_and_relu_u8(convolved(c, x, y, b), output_multiplier_, output_shift_,
                                  output_zero_, output_min_, output_max_, target);
+        if (epilogue_) {
+            Func epilogue = interpret_elementwise_program({output, (*epilogue_input_)(c, x, y, b)}, {c, x, y, b},
+                                                          *epilogue_program_, Int(32), max_epilogue_instructions);
+            output = u8_sat(epilogue(c, x, y, b, epilogue_program_->dim(1).extent()));
+        }
+        output_(c, x, y, b) = output;
 
         // Schedule.
         interpret_as_tensor(input_);
@@ -140,6 +163,11 @@ public:
         interpret_as_tensor(bias_);
         interpret_as_tensor(output_);
         require_same_min_extent(3, input_, output_);
+        if (epilogue_) {
+            for (int d = 0; d < 4; d++) {
+                require_same_min_extent(d, *epilogue_input_, output_);
+            }
+        }
         if (shallow_) {
             // Shallow inputs should have fused c and x, and left x as a dummy dim.
             output_.dim(1).set_min(0).set_extent(1);
@@ -238,6 +266,117 @@ public:
     }
 };
 
+// A float version of DepthwiseConv.
+class DepthwiseConvFloat : public Generator<DepthwiseConvFloat> {
+public:
+    // 32-bit float input tensor, indexed by ci, x, y, b.
+    Input<Buffer<float, 4>> input_{"input"};
+
+    // A 3D array of filter coefficients indexed by co, x, y.
+    Input<Buffer<float, 3>> filter_{"filter"};
+
+    // A 1D array of biases indexed by co.
+    Input<Buffer<float, 1>> bias_{"bias"};
+
+    // The depth multiplier specifies the ratio between co and ci. Unlike
+    // DepthwiseConv, this handles any depth multiplier, so the input
+    // doesn't need to be upsampled first.
+    Input<int> depth_multiplier_{"depth_multiplier"};
+
+    // The stride and dilation are as for DepthwiseConv.
+    Input<int> stride_x_{"stride_x"};
+    Input<int> stride_y_{"stride_y"};
+    Input<int> dilation_x_{"dilation_x"};
+    Input<int> dilation_y_{"dilation_y"};
+
+    Input<float> output_min_{"output_min"};
+    Input<float> output_max_{"output_max"};
+
+    Output<Buffer<float, 4>> output_{"output"};
+
+    void generate() {
+        // The algorithm.
+        const int vector_size = natural_vector_size<float>();
+
+        Var x("x"), y("y"), c("c"), b("b");
+
+        // Apply the c multiplier.
+        Func resampled_input("resampled_input");
+        resampled_input(c, x, y, b) = input_(c / depth_multiplier_, x, y, b);
+
+        filter_.dim(1).set_min(0);
+        filter_.dim(2).set_min(0);
+        Expr filter_width = filter_.dim(1).extent();
+        Expr filter_height = filter_.dim(2).extent();
+        RDom r(0, filter_width, 0, filter_height);
+
+        Expr rx = x * stride_x_ + r.x * dilation_x_;
+        Expr ry = y * stride_y_ + r.y * dilation_y_;
+        Func convolved("convolved");
+        convolved(c, x, y, b) = bias_(c);
+        convolved(c, x, y, b) += filter_(c, r.x, r.y) * resampled_input(c, rx, ry, b);
+
+        output_(c, x, y, b) = clamp(convolved(c, x, y, b), output_min_, output_max_);
+
+        // Schedule.
+        interpret_as_tensor(input_);
+        interpret_as_tensor(filter_);
+        interpret_as_tensor(bias_);
+        interpret_as_tensor(output_);
+        require_same_min_extent(3, input_, output_);
+        require_same_min_extent(0, output_, bias_);
+        require_same_min_extent(0, output_, filter_);
+
+        // Tile the output as for DepthwiseConv.
+        const int kAccumulators = 4;
+        const int kTileW = 2;
+        const int kTileH = kAccumulators / kTileW;
+        const int kMinTiles = 4;
+        Var xo("xo"), yo("yo"), co("co");
+        Expr output_width = output_.dim(1).extent();
+        Expr output_height = output_.dim(2).extent();
+        Expr use_tiles =
+            (output_width >= kTileW * kMinTiles || output_width % kTileW == 0) &&
+            (output_height >= kTileH * kMinTiles || output_height % kTileH == 0);
+        output_.compute_root()
+            .specialize(use_tiles)
+            .tile(x, y, xo, yo, x, y, kTileW, kTileH, TailStrategy::ShiftInwards)
+            .split(c, co, c, vector_size, TailStrategy::PredicateStores)
+            .reorder(x, y, c, xo, yo, b, co)
+            .unroll(x)
+            .unroll(y)
+            .vectorize(c);
+
+        output_
+            .tile(x, y, xo, yo, x, y, 1, 1)
+            .split(c, co, c, vector_size, TailStrategy::PredicateStores)
+            .reorder(x, y, c, xo, yo, b, co)
+            .unroll(x)
+            .unroll(y)
+            .vectorize(c);
+
+        convolved.compute_at(output_, xo)
+            .store_in(MemoryType::Register)
+            .bound_extent(c, vector_size)
+            .unroll(x)
+            .unroll(y)
+            .vectorize(c);
+        convolved.update()
+            .reorder(x, y, r.x, r.y)
+            .unroll(x)
+            .unroll(y)
+            .vectorize(c);
+        // Without a depth multiplier, the input can be loaded with dense
+        // vectors rather than gathers.
+        convolved.update()
+            .specialize(depth_multiplier_ == 1 && filter_width == 3 && filter_height == 3)
+            .unroll(r.x)
+            .unroll(r.y);
+        convolved.update()
+            .specialize(depth_multiplier_ == 1);
+    }
+};
+
 // A generator to resample the channels of a buffer. This is used to
 // implement depth_multiplier != 1 for DepthwiseConv above if the
 // depth_multiplier is too small to use the broadcasting version.
@@ -272,4 +411,5 @@ public:
 }  // namespace hannk
 
 HALIDE_REGISTER_GENERATOR(hannk::DepthwiseConv, DepthwiseConv)
+HALIDE_REGISTER_GENERATOR(hannk::DepthwiseConvFloat, DepthwiseConvFloat)
 HALIDE_REGISTER_GENERATOR(hannk::UpsampleChannels, UpsampleChannels)
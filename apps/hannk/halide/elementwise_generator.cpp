@@ -1,7 +1,6 @@
 #include "Halide.h"
 #include "halide/common_halide.h"
 #include "halide/constants.h"
-#include "interpreter/elementwise_program.h"
 
 using namespace Halide;
 using namespace Halide::ConciseCasts;
@@ -107,6 +106,71 @@ public:
     }
 };
 
+// Float versions of Add and Mul. These support broadcasting in the same way.
+class AddFloat : public Generator<AddFloat> {
+public:
+    Input<Buffer<float, 2>> input1_{"input1"};
+    Input<Buffer<float, 2>> input2_{"input2"};
+    // 1 to add input2, -1 to subtract it.
+    Input<float> input2_sign_{"input2_sign"};
+
+    Input<float> output_min_{"output_min"};
+    Input<float> output_max_{"output_max"};
+
+    Output<Buffer<float, 2>> output_{"output"};
+
+    void generate() {
+        Var x("x"), y("y");
+
+        Expr output = input1_(x, y) + input2_(x, y) * input2_sign_;
+        output_(x, y) = clamp(output, output_min_, output_max_);
+
+        // Schedule.
+        const int vector_size = natural_vector_size<float>();
+
+        output_.compute_root()
+            .vectorize(x, vector_size * 2, TailStrategy::Predicate);
+
+        input1_.dim(0).set_stride(Expr());
+        input2_.dim(0).set_stride(Expr());
+        output_.specialize(input1_.dim(0).stride() == 1 && input2_.dim(0).stride() == 1);
+        output_.specialize(input1_.dim(0).stride() == 1 && input2_.dim(0).stride() == 0);
+        output_.specialize(input1_.dim(0).stride() == 0 && input2_.dim(0).stride() == 1);
+        output_.specialize_fail("input dimension 0 must have a stride of 0 or 1.");
+    }
+};
+
+class MulFloat : public Generator<MulFloat> {
+public:
+    Input<Buffer<float, 2>> input1_{"input1"};
+    Input<Buffer<float, 2>> input2_{"input2"};
+
+    Input<float> output_min_{"output_min"};
+    Input<float> output_max_{"output_max"};
+
+    Output<Buffer<float, 2>> output_{"output"};
+
+    void generate() {
+        Var x("x"), y("y");
+
+        Expr output = input1_(x, y) * input2_(x, y);
+        output_(x, y) = clamp(output, output_min_, output_max_);
+
+        // Schedule.
+        const int vector_size = natural_vector_size<float>();
+
+        output_.compute_root()
+            .vectorize(x, vector_size * 2, TailStrategy::Predicate);
+
+        input1_.dim(0).set_stride(Expr());
+        input2_.dim(0).set_stride(Expr());
+        output_.specialize(input1_.dim(0).stride() == 1 && input2_.dim(0).stride() == 1);
+        output_.specialize(input1_.dim(0).stride() == 1 && input2_.dim(0).stride() == 0);
+        output_.specialize(input1_.dim(0).stride() == 0 && input2_.dim(0).stride() == 1);
+        output_.specialize_fail("input dimension 0 must have a stride of 0 or 1.");
+    }
+};
+
 // This is a generator that interprets programs to implement sequences of
 // elementwise operations dynamically.
 class Elementwise : public Generator<Elementwise> {
@@ -131,52 +195,19 @@ public:
     Output<Buffer<void, 2>> output_{"output"};
 
     void generate() {
-        Var x("x"), y("y"), u("u");
-
-        Type intermediate_type = intermediate_type_;
-        Type unsigned_intermediate = intermediate_type.with_code(halide_type_uint);
-        const int q = intermediate_type.bits() - (intermediate_type.is_int() ? 1 : 0);
+        Var x("x"), y("y");
 
-        Func scratch("scratch");
-        scratch(x, y, u) = undef(intermediate_type_);
+        // Only allow this many instructions per input, so we can store scratch
+        // on the real stack. This is a lame heuristic.
+        const int max_instructions_per_input = 4;
 
-        // Load the inputs into the scratch memory.
         const int input_count = inputs_.size();
+        std::vector<Expr> inputs;
         for (int i = 0; i < input_count; i++) {
-            scratch(x, y, -i - 1) = cast(intermediate_type, inputs_[i](x, y));
+            inputs.push_back(inputs_[i](x, y));
         }
-
-        // scratch slot 0 is a constant 0.
-        scratch(x, y, 0) = cast(intermediate_type, 0);
-
-        RDom r(0, ElementwiseAssembler::OpCodeCount, 0, program_.dim(1).extent());
-        Expr op = program_(0, r.y);
-        Expr arg1 = program_(1, r.y);
-        Expr arg2 = program_(2, r.y);
-        Expr arg3 = cast(intermediate_type, program_(3, r.y));
-        Expr arg4 = cast(intermediate_type, program_(4, r.y));
-
-        Expr slot = r.y + 1;
-
-        const int max_input = input_count - 1;
-        Expr input1 = scratch(x, y, unsafe_promise_clamped(i32(arg1), -max_input - 1, slot));
-        Expr input2 = scratch(x, y, unsafe_promise_clamped(i32(arg2), -max_input - 1, slot));
-
-        std::vector<Expr> instructions = {
-            scratch(x, y, slot),
-            saturating_add(input1, input2 + arg3),
-            saturating_sub(input1, input2 + arg3),
-            saturating_add(multiply_2x_high(input1, input2 + arg3), arg4),
-            rounding_mul_shift_right(input1, input2 + arg3, cast(unsigned_intermediate, arg4)),
-            rounding_shift_right(input1, input2 + arg3),
-            min(input1, input2 + arg3),
-            max(input1, input2 + arg3),
-            clamp(input1, arg3, arg4),
-            rounding_shift_right(approx_logistic(q, input1, input2 + arg3, intermediate_type), q - arg4),
-            rounding_shift_right(approx_tanh(q, input1, input2 + arg3, intermediate_type), q - arg4),
-        };
-        r.where(r.x == op);
-        scratch(x, y, slot) = mux(r.x, instructions);
+        Func scratch = interpret_elementwise_program(inputs, {x, y}, program_, intermediate_type_,
+                                                     input_count * max_instructions_per_input);
 
         std::vector<Type> output_types;
         if (((Type)output1_type_).bits() > 0) {
@@ -203,10 +234,6 @@ public:
         output_.compute_root()
             .vectorize(x, natural_vector_size<uint8_t>(), TailStrategy::Predicate);
 
-        // Only allow this many instructions per input, so we can store scratch
-        // on the real stack. This is a lame heuristic.
-        const int max_instructions_per_input = 4;
-
         // Support broadcasting of dimension 0 of any input.
         for (int i = 0; i < input_count; i++) {
             inputs_[i].dim(0).set_stride(Expr());
@@ -215,21 +242,13 @@ public:
             scratch.update(i).specialize_fail("Input dimension 0 must have stride 0 or 1.");
         }
         scratch.update(input_count).unscheduled();  // constant zero
-
-        const int slots = input_count * max_instructions_per_input;
-        scratch
-            .bound_extent(u, input_count + slots + 1)
-            .store_in(MemoryType::Register)
-            .update(input_count + 1)
-            .unroll(r.x);
-
-        program_.dim(0).set_min(0).set_extent(ElementwiseAssembler::InstructionSize).set_stride(1);
-        program_.dim(1).set_min(0).set_stride(ElementwiseAssembler::InstructionSize);
     }
 };
 
 }  // namespace hannk
 
 HALIDE_REGISTER_GENERATOR(hannk::Add, Add)
+HALIDE_REGISTER_GENERATOR(hannk::AddFloat, AddFloat)
 HALIDE_REGISTER_GENERATOR(hannk::Mul, Mul)
+HALIDE_REGISTER_GENERATOR(hannk::MulFloat, MulFloat)
 HALIDE_REGISTER_GENERATOR(hannk::Elementwise, Elementwise)
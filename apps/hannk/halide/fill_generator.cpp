@@ -9,29 +9,31 @@ namespace hannk {
 class Fill : public Generator<Fill> {
 public:
     // Value to fill the output with.
-    Input<uint8_t> value_{"value"};
-    Output<Buffer<uint8_t, 4>> output_{"output"};
+    Input<int> value_{"value"};
+    Output<Buffer<void, 4>> output_{"output"};
 
     void generate() {
         Var c("c"), x("x"), y("y"), b("b");
 
-        output_(c, x, y, b) = value_;
+        output_(c, x, y, b) = cast(output_.type(), value_);
 
         // Schedule.
-        const int vector_size_u8 = natural_vector_size<uint8_t>();
+        const int vector_size = natural_vector_size(output_.type());
 
-        output_.specialize(is_interleaved(output_, 4))
-            .vectorize(x, vector_size_u8, TailStrategy::GuardWithIf)
-            .vectorize(c);
+        if (output_.type().bytes() == 1) {
+            output_.specialize(is_interleaved(output_, 4))
+                .vectorize(x, vector_size, TailStrategy::GuardWithIf)
+                .vectorize(c);
+        }
 
         Expr output_channels = output_.dim(0).extent();
-        for (int i = vector_size_u8; i >= 4; i /= 2) {
+        for (int i = vector_size; i >= 4; i /= 2) {
             output_
                 .specialize(output_channels >= i)
                 .vectorize(c, i, TailStrategy::ShiftInwards);
         }
 
-        output_.vectorize(c, vector_size_u8, TailStrategy::GuardWithIf);
+        output_.vectorize(c, vector_size, TailStrategy::GuardWithIf);
     }
 };
 
@@ -31,10 +31,25 @@ AllocationPlanner::AllocationPlanner(size_t alignment)
 int AllocationPlanner::add_block(size_t size, int first_use, int last_use) {
     assert(!committed_);
     int block_id = (int)block_requirements_.size();
-    block_requirements_.push_back({kInvalidOffset, size, first_use, last_use});
+    block_requirements_.push_back({kInvalidOffset, size, first_use, last_use, -1, -1});
     return block_id;
 }
 
+void AllocationPlanner::share_block(int block_id, int source_block_id) {
+    assert(!committed_);
+    assert(block_id >= 0 && block_id < (int)block_requirements_.size());
+    assert(source_block_id >= 0 && source_block_id < (int)block_requirements_.size());
+    auto &block = block_requirements_[block_id];
+    auto &source = block_requirements_[source_block_id];
+    assert(block.shares_with < 0 && source.shared_by < 0);
+    // The source must die exactly when the block is born. (Requiring the
+    // source to live longer than that one op also rules out cycles.)
+    assert(source.last_use == block.first_use);
+    assert(source.first_use < source.last_use);
+    block.shares_with = source_block_id;
+    source.shared_by = block_id;
+}
+
 int AllocationPlanner::block_count() const {
     return (int)block_requirements_.size();
 }
@@ -60,46 +75,137 @@ void AllocationPlanner::commit() {
 
 #else
 
-    // Use a basic greedy algorithm to lay out the buffers;
-    // the basic idea here is to start with the largest block,
-    // then progress into smaller blocks, picking out the first large-enough
-    // gap we find that has no overlap in the time domain. If there is
-    // no such gap, add the block to the end. This isn't perfect, of course,
-    // but pretty good in practice. (Algorithm inspired by TFMicro's greedy allocator.)
+    // Blocks written in place over one another are laid out as a single
+    // group, with the largest size of any of them, spanning all of their
+    // lifetimes. Each group starts at a block that doesn't share with anything.
+    std::vector<BlockRequirements> groups;
+    std::vector<int> group_of(block_requirements_.size(), -1);
+    for (size_t i = 0; i < block_requirements_.size(); i++) {
+        if (block_requirements_[i].shares_with >= 0) {
+            continue;
+        }
+        BlockRequirements group = {kInvalidOffset, 0, std::numeric_limits<int>::max(), std::numeric_limits<int>::min(), -1, -1};
+        for (int j = (int)i; j >= 0; j = block_requirements_[j].shared_by) {
+            const auto &r = block_requirements_[j];
+            group_of[j] = (int)groups.size();
+            group.size_needed = std::max(group.size_needed, r.size_needed);
+            group.first_use = std::min(group.first_use, r.first_use);
+            group.last_use = std::max(group.last_use, r.last_use);
+        }
+        groups.push_back(group);
+    }
 
-    // Make a list of all the block requirements, sorted by descending size.
-    // (This list will just point to the entries in the block_requirements_ list.)
-    std::vector<BlockRequirements *> block_requirements_sorted;
-    block_requirements_sorted.reserve(block_requirements_.size());
-    for (auto &r : block_requirements_) {
-        block_requirements_sorted.push_back(&r);
+    std::vector<BlockRequirements *> groups_sorted;
+    groups_sorted.reserve(groups.size());
+    for (auto &g : groups) {
+        groups_sorted.push_back(&g);
     }
 
-    std::sort(block_requirements_sorted.begin(), block_requirements_sorted.end(),
-              [](BlockRequirements *a, BlockRequirements *b) -> bool {
-                  // Sort in decreasing (well, really non-increasing) order by size.
-                  if (a->size_needed != b->size_needed) {
-                      return a->size_needed > b->size_needed;
-                  }
+    // The greedy layout is sensitive to the order in which the blocks are
+    // placed. Largest first is usually best, but models with many long-lived
+    // small tensors can do better placing the blocks that occupy the most
+    // memory over time first, so we try a few orders and keep the best.
+    using Order = bool (*)(const BlockRequirements *a, const BlockRequirements *b);
+    const Order orders[] = {
+        // Decreasing (well, really non-increasing) size.
+        [](const BlockRequirements *a, const BlockRequirements *b) -> bool {
+            if (a->size_needed != b->size_needed) {
+                return a->size_needed > b->size_needed;
+            }
+            // If sizes are equal, sort by increasing time of first use.
+            return a->first_use < b->first_use;
+        },
+        // Decreasing size times lifetime.
+        [](const BlockRequirements *a, const BlockRequirements *b) -> bool {
+            const size_t a_area = a->size_needed * (size_t)(a->last_use - a->first_use + 1);
+            const size_t b_area = b->size_needed * (size_t)(b->last_use - b->first_use + 1);
+            if (a_area != b_area) {
+                return a_area > b_area;
+            }
+            return a->first_use < b->first_use;
+        },
+        // Decreasing lifetime, then decreasing size.
+        [](const BlockRequirements *a, const BlockRequirements *b) -> bool {
+            const int a_life = a->last_use - a->first_use;
+            const int b_life = b->last_use - b->first_use;
+            if (a_life != b_life) {
+                return a_life > b_life;
+            }
+            if (a->size_needed != b->size_needed) {
+                return a->size_needed > b->size_needed;
+            }
+            return a->first_use < b->first_use;
+        },
+    };
 
-                  // If sizes are equal, sort by increasing time of first use.
-                  return a->first_use < b->first_use;
-              });
+    size_t best_memory_needed = std::numeric_limits<size_t>::max();
+    std::vector<size_t> best_offsets(groups.size());
+    for (Order order : orders) {
+        for (auto &g : groups) {
+            g.calculated_offset = kInvalidOffset;
+        }
+        std::stable_sort(groups_sorted.begin(), groups_sorted.end(), order);
+        const size_t needed = greedy_layout(groups_sorted);
+        if (needed < best_memory_needed) {
+            best_memory_needed = needed;
+            for (size_t i = 0; i < groups.size(); i++) {
+                best_offsets[i] = groups[i].calculated_offset;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < block_requirements_.size(); i++) {
+        assert(group_of[i] >= 0);
+        block_requirements_[i].calculated_offset = best_offsets[group_of[i]];
+    }
+
+#endif  // HANNK_USE_TRIVIAL_ALLOCATION_PLANNER
+
+#ifndef NDEBUG
+    check_overlap();
+#endif
+}
+
+bool AllocationPlanner::commit_layout(const std::vector<size_t> &offsets) {
+    assert(!committed_);
+    if (offsets.size() != block_requirements_.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < offsets.size(); i++) {
+        if (offsets[i] % alignment_ != 0) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < offsets.size(); i++) {
+        block_requirements_[i].calculated_offset = offsets[i];
+    }
+    int a, b;
+    if (find_overlap(&a, &b)) {
+        for (auto &br : block_requirements_) {
+            br.calculated_offset = kInvalidOffset;
+        }
+        return false;
+    }
+    committed_ = true;
+    return true;
+}
+
+size_t AllocationPlanner::greedy_layout(const std::vector<BlockRequirements *> &order) const {
+    // Use a basic greedy algorithm to lay out the buffers;
+    // the basic idea here is to take the blocks in order (usually starting
+    // with the largest block, then progressing into smaller blocks), picking out
+    // the first large-enough gap we find that has no overlap in the time domain.
+    // If there is no such gap, add the block to the end. This isn't perfect, of course,
+    // but pretty good in practice. (Algorithm inspired by TFMicro's greedy allocator.)
 
     // This is a list that we keep sorted (by offset) as we go along.
-    // It just points to entries in block_requirements_sorted, so it's crucial
-    // that block_requirements_sorted be kept in the same order after this.
     std::list<BlockRequirements *> offsets;
 
     using OffsetsIterator = std::list<BlockRequirements *>::iterator;
 
-    // Put the first (largest) block at offset 0.
-    block_requirements_sorted[0]->calculated_offset = 0;
-    offsets.push_back(block_requirements_sorted[0]);
-
-    // Process the rest in descending order, trying to find a gap that fits.
-    for (size_t i = 1; i < block_requirements_sorted.size(); ++i) {
-        BlockRequirements *req = block_requirements_sorted[i];
+    // Process the blocks in order, trying to find a gap that fits.
+    size_t memory_needed = 0;
+    for (BlockRequirements *req : order) {
         size_t candidate_offset = 0;
 
         OffsetsIterator prior = offsets.end();
@@ -161,15 +267,12 @@ void AllocationPlanner::commit() {
             }
         }
         if (!inserted) {
-            assert(candidate_offset >= offsets.back()->calculated_offset);
+            assert(offsets.empty() || candidate_offset >= offsets.back()->calculated_offset);
             offsets.push_back(req);
         }
+        memory_needed = std::max(memory_needed, candidate_offset + req->size_needed);
     }
-#endif  // HANNK_USE_TRIVIAL_ALLOCATION_PLANNER
-
-#ifndef NDEBUG
-    check_overlap();
-#endif
+    return memory_needed;
 }
 
 size_t AllocationPlanner::memory_needed() const {
@@ -182,6 +285,14 @@ size_t AllocationPlanner::memory_needed() const {
     return needed;
 }
 
+size_t AllocationPlanner::memory_needed_without_reuse() const {
+    size_t needed = 0;
+    for (const auto &br : block_requirements_) {
+        needed += align_up(br.size_needed, alignment_);
+    }
+    return needed;
+}
+
 size_t AllocationPlanner::get_block_offset(int block_id) const {
     assert(committed_);
     assert(block_id >= 0 && block_id < (int)block_requirements_.size());
@@ -216,9 +327,11 @@ void AllocationPlanner::dump(std::ostream &o) {
           << " Offset: " << it.calculated_offset
           << " Size: " << it.size_needed
           << " FirstUse: " << it.first_use
-          << " LastUse: " << it.last_use
-          << " MapChar: " << char_for(block_id)
-          << "\n";
+          << " LastUse: " << it.last_use;
+        if (it.shares_with >= 0) {
+            o << " SharesWith: " << it.shares_with;
+        }
+        o << " MapChar: " << char_for(block_id) << "\n";
         max_size = std::max(max_size, it.calculated_offset + it.size_needed);
         max_time = std::max(max_time, it.last_use);
         ++block_id;
@@ -254,10 +367,7 @@ void AllocationPlanner::dump(std::ostream &o) {
     }
 }
 
-void AllocationPlanner::check_overlap() {
-#ifndef NDEBUG
-    assert(committed_);
-    bool ok = true;
+bool AllocationPlanner::find_overlap(int *block_a, int *block_b) const {
     for (size_t i = 0; i < block_requirements_.size(); ++i) {
         const auto &a = &block_requirements_[i];
         for (size_t j = 0; j < i; ++j) {
@@ -265,6 +375,11 @@ void AllocationPlanner::check_overlap() {
             if (a->first_use > b->last_use || b->first_use > a->last_use) {
                 continue;
             }
+            // Blocks written in place over one another overlap by design.
+            if ((a->shares_with == (int)j || b->shares_with == (int)i) &&
+                a->calculated_offset == b->calculated_offset) {
+                continue;
+            }
             const size_t a_start = a->calculated_offset;
             const size_t a_end = a_start + a->size_needed;
             const size_t b_start = b->calculated_offset;
@@ -272,13 +387,28 @@ void AllocationPlanner::check_overlap() {
             if (a_start >= b_end || b_start >= a_end) {
                 continue;
             }
-            std::cerr << "Overlap found!\n"
-                      << "  block_id " << i << " time " << a->first_use << ".." << a->last_use << " space " << a_start << ".." << a_end << "\n"
-                      << "  block_id " << j << " time " << b->first_use << ".." << b->last_use << " space " << b_start << ".." << b_end << "\n";
-            ok = false;
+            *block_a = (int)i;
+            *block_b = (int)j;
+            return true;
         }
     }
-    if (!ok) {
+    return false;
+}
+
+void AllocationPlanner::check_overlap() {
+#ifndef NDEBUG
+    assert(committed_);
+    int i, j;
+    if (find_overlap(&i, &j)) {
+        const auto &a = &block_requirements_[i];
+        const auto &b = &block_requirements_[j];
+        const size_t a_start = a->calculated_offset;
+        const size_t a_end = a_start + a->size_needed;
+        const size_t b_start = b->calculated_offset;
+        const size_t b_end = b_start + b->size_needed;
+        std::cerr << "Overlap found!\n"
+                  << "  block_id " << i << " time " << a->first_use << ".." << a->last_use << " space " << a_start << ".." << a_end << "\n"
+                  << "  block_id " << j << " time " << b->first_use << ".." << b->last_use << " space " << b_start << ".." << b_end << "\n";
         abort();
     }
 #endif
@@ -18,6 +18,14 @@ public:
     // the same offset may be returned for multiple blocks.
     int add_block(size_t size, int first_use, int last_use);
 
+    // Allow a block to occupy the same memory as an earlier block that dies
+    // as it is born, i.e. the op at 'block_id's first use writes it in place
+    // over 'source_block_id', whose last use is that same op. Blocks chained
+    // this way (e.g. a series of elementwise ops) are laid out as one.
+    // Each block may share with at most one source, and be the source of
+    // at most one block.
+    void share_block(int block_id, int source_block_id);
+
     // How many blocks have been added to the planner.
     int block_count() const;
 
@@ -25,10 +33,19 @@ public:
     // call add_block() after this.
     void commit();
 
+    // Commit all the blocks added, with a layout computed by commit() for the
+    // same blocks earlier (e.g. in a previous run, see PreparedCache). Returns
+    // false, and commits nothing, if the layout isn't valid for these blocks.
+    [[nodiscard]] bool commit_layout(const std::vector<size_t> &offsets);
+
     // The largest contiguous block of memory that's needed to hold the layout.
     // It is an error to call this before commit().
     size_t memory_needed() const;
 
+    // The memory that would be needed if no blocks overlapped at all,
+    // for comparison with memory_needed().
+    size_t memory_needed_without_reuse() const;
+
     // Calculated layout offset for the nth block added to the planner.
     // It is an error to call this before commit().
     size_t get_block_offset(int block_id) const;
@@ -52,11 +69,23 @@ private:
         size_t size_needed;
         int first_use;
         int last_use;
+        // The block this one is written in place over, or -1.
+        int shares_with;
+        // The block written in place over this one, or -1.
+        int shared_by;
     };
     std::vector<BlockRequirements> block_requirements_;
 
     bool committed_ = false;
 
+    // Lay out the given blocks greedily, in the given order. Returns the memory needed.
+    size_t greedy_layout(const std::vector<BlockRequirements *> &order) const;
+
+    // Find a pair of blocks that are live at the same time and overlap in
+    // memory, other than blocks written in place over one another at the
+    // same offset. Returns false if there are none.
+    bool find_overlap(int *block_a, int *block_b) const;
+
     void check_overlap();
 };
 
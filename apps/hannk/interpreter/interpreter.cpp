@@ -6,8 +6,12 @@
 #include "HalideBuffer.h"  // for HALIDE_RUNTIME_BUFFER_ALLOCATION_ALIGNMENT
 #include "HalideRuntime.h"
 
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
 #include <map>
 #include <set>
+#include <tuple>
 #include <unordered_set>
 
 namespace hannk {
@@ -55,6 +59,18 @@ struct TensorAllocationInfo {
     int last_use = std::numeric_limits<int>::min();
     int block_index = -1;
     std::set<TensorPtr> tensors;
+
+    // The first of the names of the tensors, to order the storage consistently
+    // from run to run.
+    std::string name() const {
+        std::string result;
+        for (const auto &t : tensors) {
+            if (result.empty() || t->name() < result) {
+                result = t->name();
+            }
+        }
+        return result;
+    }
 };
 
 bool needs_arena_allocation(const TensorPtr &t) {
@@ -64,6 +80,23 @@ bool needs_arena_allocation(const TensorPtr &t) {
     return true;
 }
 
+// Whether an elementwise op could write 'output' over 'input' in place: each
+// element of the output must be stored exactly where the same element of the input
+// is, so that it is only written after it has been read.
+bool can_write_in_place(const TensorPtr &input, const TensorPtr &output) {
+    if (!needs_arena_allocation(input) || !needs_arena_allocation(output)) {
+        return false;
+    }
+    if (input->alias_type() == AliasType::Offset || output->alias_type() == AliasType::Offset) {
+        return false;
+    }
+    return input->type().bytes() == output->type().bytes() &&
+           input->is_dense() && output->is_dense() &&
+           is_subset_of(input->bounds(), output->bounds()) &&
+           is_subset_of(output->bounds(), input->bounds()) &&
+           input->storage()->storage_size() == output->storage()->storage_size();
+}
+
 class FindAllocatableTensors : public TensorVisitor {
     void visit_tensor(const TensorPtr &t) override {
         if (!needs_arena_allocation(t)) {
@@ -82,12 +115,44 @@ class FindAllocatableTensors : public TensorVisitor {
         info.tensors.insert(t);
     }
 
+    void visit_elementwise(const ElementwiseOp *op) {
+        for (int j = 0; j < op->output_count(); j++) {
+            for (int i = 0; i < op->input_count(); i++) {
+                if (can_write_in_place(op->input(i), op->output(j))) {
+                    in_place_candidates.push_back({op->input(i)->storage(), op->output(j)->storage(), op_index()});
+                }
+            }
+        }
+    }
+
+    void visit(const BinaryOp *op) override {
+        visit_elementwise(op);
+    }
+
+    void visit(const ElementwiseProgramOp *op) override {
+        visit_elementwise(op);
+    }
+
+    void visit(const UnaryOp *op) override {
+        visit_elementwise(op);
+    }
+
 public:
     // Iteration order matters, so don't use unordered_map without consideration.
     std::map<TensorStoragePtr, TensorAllocationInfo> tensor_info;
+
+    // Pairs of storage that the elementwise op at 'op_index' could write in
+    // place, if the input isn't used after that op.
+    struct InPlaceCandidate {
+        TensorStoragePtr input, output;
+        int op_index;
+    };
+    std::vector<InPlaceCandidate> in_place_candidates;
 };
 
-std::unique_ptr<char[]> allocate_tensors(const Op *root, const InterpreterOptions &options) {
+std::unique_ptr<char[]> allocate_tensors(const Op *root, const InterpreterOptions &options,
+                                         PreparedCache *cache, const char **arena_begin,
+                                         const char **arena_end, size_t *arena_size) {
     // Find the tensors that we want to allocate in an arena,
     // along the needed storage size and lifetime for each.
     FindAllocatableTensors find_tensors;
@@ -111,16 +176,74 @@ std::unique_ptr<char[]> allocate_tensors(const Op *root, const InterpreterOption
     constexpr int kHalideBufferAlignment = HALIDE_RUNTIME_BUFFER_ALLOCATION_ALIGNMENT;
     constexpr size_t alignment = (size_t)std::max(kHalideBufferAlignment, kTfLiteDefaultTensorAlignment);
     AllocationPlanner planner(alignment);
+    // Add the blocks in an order that doesn't depend on the addresses of the
+    // storage, so a layout from a previous run can be used.
+    std::vector<std::pair<std::string, TensorAllocationInfo *>> infos;
     for (auto &it : find_tensors.tensor_info) {
-        auto &info = it.second;
+        infos.emplace_back(it.second.name(), &it.second);
+    }
+    std::stable_sort(infos.begin(), infos.end(), [](const auto &a, const auto &b) {
+        return std::make_tuple(a.second->first_use, a.second->last_use, a.second->size_needed, a.first) <
+               std::make_tuple(b.second->first_use, b.second->last_use, b.second->size_needed, b.first);
+    });
+    for (auto &it : infos) {
+        auto &info = *it.second;
         info.block_index = planner.add_block(info.size_needed, info.first_use, info.last_use);
         assert(info.block_index >= 0);
     }
-    planner.commit();
+
+    // Let elementwise ops overwrite an input that dies at that op, rather
+    // than needing memory for both. (The in_place() transform already aliases
+    // inputs with a single consumer; this catches the rest.) The inputs of
+    // the model must be left intact, as they aren't rewritten between executions.
+    std::set<TensorStoragePtr> root_inputs;
+    for (int i = 0; i < root->input_count(); i++) {
+        if (needs_arena_allocation(root->input(i))) {
+            root_inputs.insert(root->input(i)->storage());
+        }
+    }
+    std::set<int> sharing_blocks, shared_blocks;
+    int in_place_count = 0;
+    for (const auto &c : find_tensors.in_place_candidates) {
+        if (c.input == c.output || root_inputs.count(c.input)) {
+            continue;
+        }
+        const auto &input = find_tensors.tensor_info.at(c.input);
+        const auto &output = find_tensors.tensor_info.at(c.output);
+        if (input.last_use != c.op_index || output.first_use != c.op_index || input.first_use >= c.op_index) {
+            continue;
+        }
+        if (shared_blocks.count(input.block_index) || sharing_blocks.count(output.block_index)) {
+            continue;
+        }
+        planner.share_block(output.block_index, input.block_index);
+        shared_blocks.insert(input.block_index);
+        sharing_blocks.insert(output.block_index);
+        in_place_count++;
+    }
+
+    std::vector<size_t> offsets;
+    if (cache && cache->find_arena_layout(planner.block_count(), &offsets) && planner.commit_layout(offsets)) {
+        if (options.verbosity >= 1) {
+            HLOG(INFO) << "Using arena layout from the prepared cache";
+        }
+    } else {
+        planner.commit();
+        offsets.resize(planner.block_count());
+        for (int i = 0; i < planner.block_count(); i++) {
+            offsets[i] = planner.get_block_offset(i);
+        }
+    }
+    if (cache) {
+        cache->set_arena_layout(std::move(offsets));
+    }
+    *arena_size = planner.memory_needed();
 
     if (options.verbosity >= 1) {
         std::ostringstream oss;
-        oss << "Arena memory needed: " << planner.memory_needed() << '\n';
+        oss << "Arena memory needed: " << planner.memory_needed()
+            << " (" << planner.memory_needed_without_reuse() << " without reuse, "
+            << in_place_count << " tensors written in place)\n";
         oss << "    Offsets:";
         for (int i = 0; i < planner.block_count(); i++) {
             oss << ' ' << planner.get_block_offset(i);
@@ -141,6 +264,8 @@ std::unique_ptr<char[]> allocate_tensors(const Op *root, const InterpreterOption
 
     // Make sure that the 'base' we start from is aligned.
     arena_base = (char *)(((uintptr_t)arena_base + alignment - 1) & ~(alignment - 1));
+    *arena_begin = arena_base;
+    *arena_end = arena_base + planner.memory_needed();
 
     for (const auto &it : find_tensors.tensor_info) {
         const auto &info = it.second;
@@ -153,6 +278,144 @@ std::unique_ptr<char[]> allocate_tensors(const Op *root, const InterpreterOption
     return arena;
 }
 
+// The memory an op reads and writes, for deciding which ops may run
+// concurrently. Tensors in the arena are tracked by their address range,
+// which accounts both for aliases and for the AllocationPlanner reusing
+// the memory of tensors that are no longer live. Everything else that
+// isn't constant (external and dynamic tensors) is lumped together,
+// since its memory may not be known until the model is executed.
+struct MemoryUse {
+    struct Range {
+        const char *begin, *end;
+    };
+    std::vector<Range> reads, writes;
+    bool writes_other = false, reads_other = false;
+
+    static bool overlaps(const std::vector<Range> &a, const std::vector<Range> &b) {
+        for (const Range &i : a) {
+            for (const Range &j : b) {
+                if (i.begin < j.end && j.begin < i.end) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Whether an op using this memory must wait for an earlier op using 'other'.
+    bool conflicts_with(const MemoryUse &other) const {
+        return overlaps(writes, other.reads) || overlaps(writes, other.writes) ||
+               overlaps(reads, other.writes) ||
+               (writes_other && (other.reads_other || other.writes_other)) ||
+               (reads_other && other.writes_other);
+    }
+};
+
+class FindMemoryUse : public OpVisitor {
+    using OpVisitor::visit;
+
+    const char *arena_begin_, *arena_end_;
+
+    void add(const TensorPtr &t, bool write) {
+        if (!t || t->is_constant()) {
+            return;
+        }
+        const halide_buffer_t *buf = t->raw_buffer();
+        const char *begin = (const char *)buf->begin();
+        const char *end = (const char *)buf->end();
+        if (t->is_allocated() && !t->is_external() && !t->is_dynamic() &&
+            begin >= arena_begin_ && end <= arena_end_) {
+            (write ? use.writes : use.reads).push_back({begin, end});
+        } else {
+            (write ? use.writes_other : use.reads_other) = true;
+        }
+    }
+
+    void visit_leaf(const Op *op) override {
+        for (int j = 0; j < op->input_count(); j++) {
+            add(op->input(j), false);
+        }
+        for (int j = 0; j < op->output_count(); j++) {
+            add(op->output(j), true);
+        }
+    }
+
+public:
+    FindMemoryUse(const char *arena_begin, const char *arena_end)
+        : arena_begin_(arena_begin), arena_end_(arena_end) {
+    }
+
+    MemoryUse use;
+};
+
+// Group the ops of the model into waves, each of which depends only on
+// the waves before it. An op is placed in the wave after the last op it
+// conflicts with, so the ops in a wave never touch the same memory.
+std::vector<std::vector<Op *>> schedule_op_waves(Op *root, const char *arena_begin, const char *arena_end) {
+    std::vector<std::vector<Op *>> waves;
+    OpGroup *group = dynamic_cast<OpGroup *>(root);
+    if (!group) {
+        waves.push_back({root});
+        return waves;
+    }
+
+    std::vector<MemoryUse> uses;
+    std::vector<int> wave_of;
+    for (int i = 0; i < group->op_count(); i++) {
+        Op *op = group->op(i);
+        FindMemoryUse find_use(arena_begin, arena_end);
+        op->accept(&find_use);
+
+        int wave = 0;
+        for (int j = 0; j < i; j++) {
+            if (find_use.use.conflicts_with(uses[j])) {
+                wave = std::max(wave, wave_of[j] + 1);
+            }
+        }
+        if (wave == (int)waves.size()) {
+            waves.emplace_back();
+        }
+        waves[wave].push_back(op);
+        uses.push_back(std::move(find_use.use));
+        wave_of.push_back(wave);
+    }
+    return waves;
+}
+
+// Count the multiply-accumulates done by an op.
+class CountMacs : public OpVisitor {
+    using OpVisitor::visit;
+
+    void visit(const ConvOp *op) override {
+        const TensorPtr &filter = op->filter();
+        int filter_width, filter_height;
+        if (op->winograd()) {
+            filter_width = filter_height = 3;
+        } else if (filter->rank() == op->input()->rank()) {
+            filter_width = filter->extent(1);
+            filter_height = filter->extent(2);
+        } else {
+            // The filter is tiled, see TileConvFilterOp.
+            filter_width = filter->extent(4);
+            filter_height = filter->extent(5);
+        }
+        macs += (int64_t)op->output()->number_of_elements() * op->input()->extent(0) * filter_width * filter_height;
+    }
+
+    void visit(const DepthwiseConv2DOp *op) override {
+        macs += (int64_t)op->output()->number_of_elements() * op->filter()->extent(1) * op->filter()->extent(2);
+    }
+
+public:
+    int64_t macs = 0;
+};
+
+int execute_op_task(void *user_context, int task_number, uint8_t *closure) {
+    const auto *ops = (const std::vector<Op *> *)closure;
+    (*ops)[task_number]->execute();
+    return 0;
+}
+
 class VerifyAllAllocated : public TensorVisitor {
     void visit_tensor(const TensorPtr &t) override {
         if (!needs_arena_allocation(t)) {
@@ -246,7 +509,16 @@ bool Interpreter::prepare() {
 
     dump_model("Model after prepare():", 3);
 
-    model_ = pad_for_ops(std::move(model_));
+    if (options_.batch_size > 0) {
+        model_ = set_batch_size(std::move(model_), options_.batch_size);
+        if (!model_) {
+            HLOG(ERROR) << "set_batch_size() failed.";
+            return false;
+        }
+        dump_model("Model after set_batch_size():", 3);
+    }
+
+    model_ = pad_for_ops(std::move(model_), options_.winograd, options_.hexagon_offload_min_macs);
     if (!model_) {
         HLOG(ERROR) << "pad_for_ops() failed.";
         return false;
@@ -256,7 +528,32 @@ bool Interpreter::prepare() {
     model_ = in_place(std::move(model_));
     dump_model("Model after in_place():", 3);
 
-    model_ = fold_constants(std::move(model_));
+    // The results of constant folding depend on the transforms above, so
+    // identify the model by what it looks like now.
+    uint64_t fingerprint = 0;
+    if (!options_.prepared_cache_path.empty() || options_.shared_constants) {
+        fingerprint = fingerprint_model(model_.get());
+    }
+    if (!options_.prepared_cache_path.empty()) {
+        prepared_cache_ = std::make_unique<PreparedCache>(fingerprint);
+        if (!prepared_cache_->load(options_.prepared_cache_path) && options_.verbosity >= 1) {
+            HLOG(INFO) << "No usable prepared cache at " << options_.prepared_cache_path;
+        }
+    }
+
+    if (options_.shared_constants) {
+        SharedConstants *shared = options_.shared_constants.get();
+        std::lock_guard<std::mutex> lock(shared->mutex());
+        if (shared->begin(fingerprint)) {
+            model_ = fold_constants(std::move(model_), prepared_cache_.get(), shared);
+            shared->end();
+        } else {
+            HLOG(WARNING) << "InterpreterOptions::shared_constants is for a different model, ignoring it.";
+            model_ = fold_constants(std::move(model_), prepared_cache_.get());
+        }
+    } else {
+        model_ = fold_constants(std::move(model_), prepared_cache_.get());
+    }
     dump_model("Model after fold_constants():", 3);
 
     model_ = flatten_groups(std::move(model_));
@@ -269,6 +566,13 @@ bool Interpreter::prepare() {
     }
     dump_model("Model after fuse_pad_ops:", 3);
 
+    model_ = fuse_elementwise_epilogues(std::move(model_));
+    if (!model_) {
+        HLOG(ERROR) << "fuse_elementwise_epilogues() failed.";
+        return false;
+    }
+    dump_model("Model after fuse_elementwise_epilogues:", 3);
+
     model_ = remove_dead_ops(std::move(model_));
     dump_model("Model after remove_dead_ops:", 3);
 
@@ -276,7 +580,9 @@ bool Interpreter::prepare() {
     do_check_op_order(model_.get());
 #endif
     assert(tensor_storage_arena_ == nullptr);
-    tensor_storage_arena_ = allocate_tensors(model_.get(), options_);
+    const char *arena_begin = nullptr, *arena_end = nullptr;
+    tensor_storage_arena_ = allocate_tensors(model_.get(), options_, prepared_cache_.get(),
+                                             &arena_begin, &arena_end, &arena_size_);
 
 #ifndef NDEBUG
     VerifyAllAllocated verify_all;
@@ -285,6 +591,48 @@ bool Interpreter::prepare() {
 
     dump_model("Model after all transformations:", 2);
 
+    if (options_.parallel_ops) {
+        op_waves_ = schedule_op_waves(model_.get(), arena_begin, arena_end);
+        if (options_.verbosity >= 1) {
+            std::ostringstream oss;
+            oss << "Op waves:";
+            for (const auto &wave : op_waves_) {
+                oss << ' ' << wave.size();
+            }
+            HLOG(INFO) << oss.str();
+        }
+    }
+
+    if (options_.profile_ops) {
+        OpGroup *group = dynamic_cast<OpGroup *>(model_.get());
+        if (group) {
+            for (int i = 0; i < group->op_count(); i++) {
+                profiled_ops_.push_back(group->op(i));
+            }
+        } else {
+            profiled_ops_.push_back(model_.get());
+        }
+        for (Op *op : profiled_ops_) {
+            OpTiming timing;
+            timing.type = op->name();
+            if (op->output_count() > 0) {
+                timing.output = op->output()->name();
+            }
+            CountMacs count_macs;
+            op->accept(&count_macs);
+            timing.macs = count_macs.macs;
+            op_timings_.push_back(std::move(timing));
+        }
+    }
+
+    if (prepared_cache_ && prepared_cache_->dirty()) {
+        if (!prepared_cache_->write(options_.prepared_cache_path)) {
+            HLOG(WARNING) << "Unable to write prepared cache " << options_.prepared_cache_path;
+        } else if (options_.verbosity >= 1) {
+            HLOG(INFO) << "Wrote prepared cache " << options_.prepared_cache_path;
+        }
+    }
+
     prepared_ = true;
     return true;
 }
@@ -294,7 +642,29 @@ void Interpreter::execute() {
         HLOG(ERROR) << "Must call prepare() before execute()";
         return;
     }
-    model_->execute();
+    if (options_.profile_ops) {
+        for (size_t i = 0; i < profiled_ops_.size(); i++) {
+            const auto begin = std::chrono::steady_clock::now();
+            profiled_ops_[i]->execute();
+            const auto end = std::chrono::steady_clock::now();
+            op_timings_[i].seconds += std::chrono::duration<double>(end - begin).count();
+            op_timings_[i].executions++;
+        }
+        return;
+    }
+    if (!options_.parallel_ops) {
+        model_->execute();
+        return;
+    }
+    for (auto &wave : op_waves_) {
+        if (wave.size() == 1) {
+            wave[0]->execute();
+        } else {
+            // The ops themselves may use the thread pool too; Halide's
+            // thread pool allows nested parallelism.
+            halide_do_par_for(nullptr, execute_op_task, 0, (int)wave.size(), (uint8_t *)&wave);
+        }
+    }
 }
 
 TensorPtr Interpreter::get_tensor(const std::string &name) {
@@ -349,6 +719,93 @@ TensorPtr Interpreter::get_tensor(const std::string &name) {
     return finder.result;
 }
 
+std::vector<OpTiming> Interpreter::op_type_timings() const {
+    std::map<std::string, OpTiming> by_type;
+    for (const OpTiming &i : op_timings_) {
+        auto it = by_type.find(i.type);
+        if (it == by_type.end()) {
+            OpTiming &timing = by_type[i.type];
+            timing = i;
+            timing.output.clear();
+        } else {
+            OpTiming &timing = it->second;
+            timing.op_count++;
+            timing.macs += i.macs;
+            timing.seconds += i.seconds;
+        }
+    }
+
+    std::vector<OpTiming> result;
+    for (auto &i : by_type) {
+        result.push_back(std::move(i.second));
+    }
+    std::stable_sort(result.begin(), result.end(), [](const OpTiming &a, const OpTiming &b) {
+        return a.seconds > b.seconds;
+    });
+    return result;
+}
+
+void Interpreter::reset_op_timings() {
+    for (OpTiming &i : op_timings_) {
+        i.executions = 0;
+        i.seconds = 0;
+    }
+}
+
+void Interpreter::dump_op_timings(std::ostream &os, bool csv) const {
+    double total_seconds = 0;
+    for (const OpTiming &i : op_timings_) {
+        total_seconds += i.seconds;
+    }
+    const auto percent = [=](const OpTiming &i) {
+        return total_seconds > 0 ? 100 * i.seconds / total_seconds : 0;
+    };
+
+    const std::vector<OpTiming> type_timings = op_type_timings();
+    if (csv) {
+        os << "Op,Type,Output,MACs,Time_us,Percent,GOPS\n";
+        for (size_t i = 0; i < op_timings_.size(); i++) {
+            const OpTiming &t = op_timings_[i];
+            os << i << ',' << t.type << ',' << t.output << ',' << t.macs << ','
+               << t.microseconds_per_execution() << ',' << percent(t) << ',' << t.gops() << '\n';
+        }
+        os << "Type,Count,MACs,Time_us,Percent,GOPS\n";
+        for (const OpTiming &t : type_timings) {
+            os << t.type << ',' << t.op_count << ',' << t.macs << ','
+               << t.microseconds_per_execution() << ',' << percent(t) << ',' << t.gops() << '\n';
+        }
+        return;
+    }
+
+    const auto flags = os.flags();
+    const auto precision = os.precision();
+    os << std::fixed << std::setprecision(1);
+    os << "Per-op times:\n";
+    for (size_t i = 0; i < op_timings_.size(); i++) {
+        const OpTiming &t = op_timings_[i];
+        os << std::setw(4) << i << ' ' << std::left << std::setw(24) << t.type << std::right
+           << std::setw(10) << t.microseconds_per_execution() << " us"
+           << std::setw(6) << percent(t) << '%';
+        if (t.macs > 0) {
+            os << std::setw(12) << t.macs << " MACs" << std::setw(8) << t.gops() << " GOPS";
+        }
+        os << "  " << t.output << '\n';
+    }
+    os << "Per-op-type times:\n";
+    for (const OpTiming &t : type_timings) {
+        os << std::left << std::setw(24) << t.type << std::right
+           << std::setw(4) << t.op_count << " ops"
+           << std::setw(10) << t.microseconds_per_execution() << " us"
+           << std::setw(6) << percent(t) << '%';
+        if (t.macs > 0) {
+            os << std::setw(12) << t.macs << " MACs" << std::setw(8) << t.gops() << " GOPS";
+        }
+        os << '\n';
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+
 std::vector<TensorPtr> Interpreter::inputs() {
     HCHECK(prepared_);
     std::vector<TensorPtr> result;
@@ -1,10 +1,13 @@
 #ifndef HANNK_INTERPRETER_H
 #define HANNK_INTERPRETER_H
 
+#include <iostream>
 #include <string>
 #include <vector>
 
 #include "interpreter/model.h"
+#include "interpreter/prepared_cache.h"
+#include "interpreter/shared_constants.h"
 
 namespace hannk {
 
@@ -14,14 +17,95 @@ struct InterpreterOptions {
 
     // Whether to enable tracing.
     bool trace = false;
+
+    // Whether to run ops that don't depend on each other concurrently
+    // on the Halide thread pool (e.g. the towers of an Inception model),
+    // rather than strictly in order.
+    bool parallel_ops = false;
+
+    // If nonzero, run the model on batches of this size, rather than
+    // the batch size it was built for. The inputs and outputs get this
+    // as the extent of their outermost dimension, and ops like conv
+    // and fully connected read their weights once for the whole batch.
+    int batch_size = 0;
+
+    // Whether to compute 3x3 convolutions with Winograd's algorithm where
+    // it applies, which needs fewer multiplies than the direct algorithm.
+    bool winograd = true;
+
+    // If not negative, convolutions that do at least this many
+    // multiply-accumulates are offloaded to Hexagon HVX, if hannk was built
+    // with HANNK_HEXAGON_OFFLOAD. The host waits for each offloaded op to
+    // finish, so with parallel_ops, other ops can run on the host meanwhile.
+    int64_t hexagon_offload_min_macs = -1;
+
+    // If not empty, a file in which to cache the results of the expensive
+    // parts of prepare() (see PreparedCache). If the file exists and is for
+    // the same model, the cached results are used; otherwise, the file is
+    // (re)written by prepare().
+    std::string prepared_cache_path;
+
+    // If not null, the constant tensors computed by prepare() are stored in
+    // (or, if another Interpreter for the same model has already stored
+    // them, taken from) this object, rather than each Interpreter having its
+    // own copy. Each Interpreter still has its own arena.
+    SharedConstantsPtr shared_constants;
+
+    // Whether to time each op of the model as it executes (see
+    // Interpreter::op_timings()). The ops are executed one at a time,
+    // even if parallel_ops is set.
+    bool profile_ops = false;
+};
+
+// The time spent in an op (or in all the ops of one type), summed over
+// the calls to Interpreter::execute().
+struct OpTiming {
+    // The type of op (i.e. Op::name()).
+    std::string type;
+    // The name of the first output of the op, to identify it in the model.
+    // Empty for the timing of a type of op.
+    std::string output;
+    // The number of ops of this type, for the timing of a type of op.
+    int op_count = 1;
+    // The multiply-accumulates done by one execution of the op(s), if
+    // it is that kind of op (e.g. convolutions). Winograd convolutions count
+    // the multiply-accumulates of the direct algorithm.
+    int64_t macs = 0;
+    int64_t executions = 0;
+    double seconds = 0;
+
+    double microseconds_per_execution() const {
+        return executions > 0 ? seconds * 1e6 / executions : 0;
+    }
+
+    // The effective billions of operations (two per multiply-accumulate)
+    // per second.
+    double gops() const {
+        return seconds > 0 ? 2.0 * macs * executions / seconds * 1e-9 : 0;
+    }
 };
 
 class Interpreter {
     OpPtr model_;
     std::unique_ptr<char[]> tensor_storage_arena_;
+    size_t arena_size_ = 0;
     InterpreterOptions options_;
     bool prepared_ = false;
 
+    // Keeps the constant tensors loaded from the prepared cache (if any)
+    // mapped into memory.
+    std::unique_ptr<PreparedCache> prepared_cache_;
+
+    // If options_.parallel_ops is set, the ops of the model in waves:
+    // the ops in each wave depend only on ops in earlier waves, and
+    // so may run concurrently.
+    std::vector<std::vector<Op *>> op_waves_;
+
+    // If options_.profile_ops is set, the ops of the model, and the time
+    // spent in each.
+    std::vector<Op *> profiled_ops_;
+    std::vector<OpTiming> op_timings_;
+
 public:
     explicit Interpreter(OpPtr m, InterpreterOptions options = InterpreterOptions());
     ~Interpreter();
@@ -48,6 +132,29 @@ public:
     // Return the Tensor(s) that are the final output(s) of the Model.
     std::vector<TensorPtr> outputs();
 
+    // The size in bytes of the arena holding the intermediate tensors of
+    // the Model, which is the peak memory they need at any one time.
+    // Only valid after prepare().
+    size_t arena_size() const {
+        return arena_size_;
+    }
+
+    // If profile_ops was set, the time spent in each op of the model,
+    // in the order they execute.
+    const std::vector<OpTiming> &op_timings() const {
+        return op_timings_;
+    }
+
+    // The op_timings() summed for each type of op, in decreasing order of
+    // time spent.
+    std::vector<OpTiming> op_type_timings() const;
+
+    void reset_op_timings();
+
+    // Print op_timings() and op_type_timings(), as tables of text or
+    // comma-separated values.
+    void dump_op_timings(std::ostream &os, bool csv = false) const;
+
     // Movable but not copyable.
     Interpreter() = delete;
     Interpreter(const Interpreter &) = delete;
@@ -2,28 +2,45 @@
 #include <cmath>
 #include <iostream>
 
+#include "halide/add_float32_float32.h"
 #include "halide/add_uint8_uint8.h"
+#include "halide/average_pool_float32.h"
 #include "halide/average_pool_uint8.h"
 #include "halide/constants.h"
+#include "halide/conv_epilogue_u8_u8_u8.h"
+#include "halide/conv_f32_f32_f32.h"
+#ifdef HANNK_HEXAGON_OFFLOAD
+#include "halide/conv_hexagon_u8_u8_u8.h"
+#endif
 #include "halide/conv_u8_u8_i16.h"
 #include "halide/conv_u8_u8_u8.h"
+#include "halide/conv_winograd_u8_u8_u8.h"
 #ifdef CONV_R16
 #include "halide/conv_r16_u8_u8_i16.h"
 #include "halide/conv_r16_u8_u8_u8.h"
 #endif
+#include "halide/copy_float32_float32.h"
 #include "halide/copy_uint8_uint8.h"
 #include "halide/depthwise_conv_broadcast_uint8.h"
+#include "halide/depthwise_conv_epilogue_uint8.h"
+#include "halide/depthwise_conv_float32.h"
+#include "halide/depthwise_conv_shallow_epilogue_uint8.h"
 #include "halide/depthwise_conv_shallow_uint8.h"
 #include "halide/depthwise_conv_uint8.h"
 #include "halide/elementwise_5xint16_1xuint8int16.h"
 #include "halide/elementwise_5xuint8_1xuint8.h"
+#include "halide/fill_float32.h"
 #include "halide/fill_uint8.h"
 #include "halide/l2_normalization_uint8.h"
+#include "halide/max_pool_float32.h"
 #include "halide/max_pool_uint8.h"
 #include "halide/mean_uint8.h"
+#include "halide/mul_float32_float32_float32.h"
 #include "halide/mul_uint8_uint8_uint8.h"
 #include "halide/softmax_uint8.h"
+#include "halide/tile_conv_filter_float32.h"
 #include "halide/tile_conv_filter_uint8.h"
+#include "halide/tile_winograd_conv_filter_uint8.h"
 #include "halide/upsample_channels_uint8.h"
 #include "interpreter/elementwise_program.h"
 #include "interpreter/ops.h"
@@ -413,6 +430,28 @@ Interval get_output_range(ActivationFunction activation, const QuantizationInfo
     return output_range;
 }
 
+struct FloatInterval {
+    float min;
+    float max;
+};
+
+// The range of a float output with the given activation function.
+FloatInterval get_float_output_range(ActivationFunction activation) {
+    const float inf = std::numeric_limits<float>::infinity();
+    if (activation == ActivationFunction::None) {
+        return {-inf, inf};
+    } else if (activation == ActivationFunction::Relu) {
+        return {0.0f, inf};
+    } else if (activation == ActivationFunction::Relu6) {
+        return {0.0f, 6.0f};
+    } else if (activation == ActivationFunction::ReluN1To1) {
+        return {-1.0f, 1.0f};
+    } else {
+        HLOG(FATAL) << "Unsupported float activation function type.";
+        return {-inf, inf};
+    }
+}
+
 struct MultiplyParams {
     int a_zero;
     int b_zero;
@@ -434,6 +473,12 @@ MultiplyParams get_quantized_multiply_params(const QuantizationInfo &a, const Qu
     return result;
 }
 
+int get_add_multiplier(const QuantizationInfo &inq, int sign, const QuantizationInfo &outq) {
+    const float in_scale = inq.uniform_scale() * (1 << add_output_shift);
+    const float out_scale = outq.uniform_scale() * (1 << add_input_shift);
+    return std::lround(in_scale / out_scale) * sign;
+}
+
 void add_uint8(const HalideBuffer<const void> &in1, const QuantizationInfo &in1q, int in1sign,
                const HalideBuffer<const void> &in2, const QuantizationInfo &in2q, int in2sign,
                const HalideBuffer<void> &out, const QuantizationInfo &outq,
@@ -442,12 +487,8 @@ void add_uint8(const HalideBuffer<const void> &in1, const QuantizationInfo &in1q
     const int in2_zero = in2q.uniform_zero();
     const int out_zero = outq.uniform_zero();
 
-    const float in1_scale = in1q.uniform_scale() * (1 << add_output_shift);
-    const float in2_scale = in2q.uniform_scale() * (1 << add_output_shift);
-    const float out_scale = outq.uniform_scale() * (1 << add_input_shift);
-
-    const int in1_multiplier = std::lround(in1_scale / out_scale) * in1sign;
-    const int in2_multiplier = std::lround(in2_scale / out_scale) * in2sign;
+    const int in1_multiplier = get_add_multiplier(in1q, in1sign, outq);
+    const int in2_multiplier = get_add_multiplier(in2q, in2sign, outq);
 
     const auto out_range = get_output_range(activation, outq);
 
@@ -458,6 +499,30 @@ void add_uint8(const HalideBuffer<const void> &in1, const QuantizationInfo &in1q
     elementwise_loop_nest<2>(add_rank2, in1, in2, out);
 }
 
+// Make an elementwise program computing the same thing as add_uint8 of
+// inputs 0 and 1 of the program. The intermediates of the program must be
+// 32-bit. If in2sign is 0, input 1 is not used.
+HalideBuffer<int16_t, 2> make_add_uint8_program(const QuantizationInfo &in1q, int in1sign,
+                                                 const QuantizationInfo &in2q, int in2sign,
+                                                 const QuantizationInfo &outq, ActivationFunction activation) {
+    std::array<int16_t, ElementwiseAssembler::InstructionSize * max_epilogue_instructions> program_buffer;
+    ElementwiseAssembler p(program_buffer);
+    auto scaled_input = [&](int index, const QuantizationInfo &inq, int sign) {
+        auto input_zeroed = p.sub(p.input(index), inq.uniform_zero());
+        auto input_shifted = p.mul_shift(input_zeroed, 1 << add_input_shift, 0);
+        return p.mul_shift(input_shifted, get_add_multiplier(inq, sign, outq), 0);
+    };
+    auto sum = scaled_input(0, in1q, in1sign);
+    if (in2sign != 0) {
+        sum = p.add(sum, scaled_input(1, in2q, in2sign));
+    }
+    const auto out_range = get_output_range(activation, outq);
+    auto result = p.shift(sum, add_output_shift);
+    result = p.add(result, outq.uniform_zero());
+    result = p.clamp(result, out_range.min, out_range.max);
+    return p.assemble({result}).copy();
+}
+
 void mul_uint8(const HalideBuffer<const void> &in1, const QuantizationInfo &in1q,
                const HalideBuffer<const void> &in2, const QuantizationInfo &in2q,
                const HalideBuffer<void> &out, const QuantizationInfo &outq,
@@ -484,6 +549,26 @@ void mul_uint8(const HalideBuffer<const void> &in1, const QuantizationInfo &in1q
     elementwise_loop_nest<2>(mul_rank2, in1, in2, out);
 }
 
+void add_float32(const HalideBuffer<const void> &in1, const HalideBuffer<const void> &in2, int in2sign,
+                 const HalideBuffer<void> &out, ActivationFunction activation = ActivationFunction::None) {
+    const auto out_range = get_float_output_range(activation);
+
+    auto add_rank2 = [&](halide_buffer_t *in1_buf, halide_buffer_t *in2_buf, halide_buffer_t *out_buf) {
+        add_float32_float32(in1_buf, in2_buf, (float)in2sign, out_range.min, out_range.max, out_buf);
+    };
+    elementwise_loop_nest<2>(add_rank2, in1, in2, out);
+}
+
+void mul_float32(const HalideBuffer<const void> &in1, const HalideBuffer<const void> &in2,
+                 const HalideBuffer<void> &out, ActivationFunction activation = ActivationFunction::None) {
+    const auto out_range = get_float_output_range(activation);
+
+    auto mul_rank2 = [&](halide_buffer_t *in1_buf, halide_buffer_t *in2_buf, halide_buffer_t *out_buf) {
+        mul_float32_float32_float32(in1_buf, in2_buf, out_range.min, out_range.max, out_buf);
+    };
+    elementwise_loop_nest<2>(mul_rank2, in1, in2, out);
+}
+
 bool try_requantize(const HalideBuffer<const void> &in, const QuantizationInfo &inq,
                     HalideBuffer<void> out, const QuantizationInfo &outq,
                     ActivationFunction activation = ActivationFunction::None) {
@@ -651,6 +736,25 @@ bool try_scalar_binary_op(BinaryOp::Operator op, const TensorPtr &a, const Tenso
 
 }  // namespace
 
+HalideBuffer<int16_t, 2> BinaryOp::to_epilogue(int fused_input) const {
+    assert(fused_input == 0 || fused_input == 1);
+    for (int i = 0; i < input_count(); i++) {
+        if (input(i)->type() != halide_type_of<uint8_t>()) {
+            return HalideBuffer<int16_t, 2>();
+        }
+    }
+    if (output()->type() != halide_type_of<uint8_t>() || (op_ != Add && op_ != Sub)) {
+        // Mul needs a 32-bit multiplier, which doesn't fit in the immediates
+        // of an elementwise program.
+        return HalideBuffer<int16_t, 2>();
+    }
+    const int signs[] = {1, op_ == Add ? 1 : -1};
+    const int other_input = 1 - fused_input;
+    return make_add_uint8_program(input(fused_input)->quantization(), signs[fused_input],
+                                  input(other_input)->quantization(), signs[other_input],
+                                  output()->quantization(), activation_);
+}
+
 void BinaryOp::execute() {
     const TensorPtr &in1 = input(0);
     const TensorPtr &in2 = input(1);
@@ -674,6 +778,20 @@ void BinaryOp::execute() {
         default:
             break;
         }
+    } else if (in1->type() == halide_type_of<float>() &&
+               in2->type() == halide_type_of<float>() &&
+               out->type() == halide_type_of<float>() &&
+               (op_ == Add || op_ == Sub || op_ == Mul)) {
+        const auto &in1_buf = in1->buffer();
+        const auto &in2_buf = in2->buffer();
+        const auto &out_buf = out->buffer();
+
+        if (op_ == Mul) {
+            mul_float32(in1_buf, in2_buf, out_buf, activation_);
+        } else {
+            add_float32(in1_buf, in2_buf, op_ == Add ? 1 : -1, out_buf, activation_);
+        }
+        return;
     } else {
         // This is really slow, only intended to support scalar operations.
         if (try_scalar_binary_op<int32_t, int32_t>(op_, in1, in2, out)) {
@@ -755,7 +873,14 @@ void ConcatenationOp::execute() {
 }
 
 halide_type_t ConvOp::filter_type() const {
-    if (input()->type() == halide_type_of<uint8_t>() &&
+    if (winograd_) {
+        return halide_type_of<int16_t>();
+#ifdef HANNK_HEXAGON_OFFLOAD
+    } else if (hexagon_) {
+        const halide_filter_metadata_t *metadata = conv_hexagon_u8_u8_u8_metadata();
+        return metadata->arguments[2].type;
+#endif
+    } else if (input()->type() == halide_type_of<uint8_t>() &&
         output()->type() == halide_type_of<uint8_t>()) {
         const halide_filter_metadata_t *metadata = conv_u8_u8_u8_metadata();
         return metadata->arguments[2].type;
@@ -763,21 +888,141 @@ halide_type_t ConvOp::filter_type() const {
                output()->type() == halide_type_of<int16_t>()) {
         const halide_filter_metadata_t *metadata = conv_u8_u8_i16_metadata();
         return metadata->arguments[2].type;
+    } else if (input()->type() == halide_type_of<float>() &&
+               output()->type() == halide_type_of<float>()) {
+        return halide_type_of<float>();
     } else {
         HLOG(FATAL) << "Unsupported type " << output()->type() << "\n";
         return halide_type_t(halide_type_int, 0, 0);
     }
 }
 
+namespace {
+
+std::vector<TensorPtr> with_epilogue_input(std::vector<TensorPtr> inputs, const TensorPtr &epilogue_input) {
+    if (epilogue_input) {
+        inputs.push_back(epilogue_input);
+    }
+    return inputs;
+}
+
+// Get the buffer to pass as the epilogue input of op. When the epilogue
+// doesn't use an input, the output of op is passed as a dummy.
+HalideBuffer<void> epilogue_input_buffer(const Op *op, int epilogue_input_idx) {
+    if (op->input_count() > epilogue_input_idx) {
+        return op->input(epilogue_input_idx)->buffer();
+    } else {
+        return op->output()->buffer();
+    }
+}
+
+}  // namespace
+
+ConvOp::ConvOp(const ConvOp *op, HalideBuffer<int16_t, 2> epilogue, const TensorPtr &epilogue_input,
+               const TensorPtr &output)
+    : Op(with_epilogue_input({op->input(), op->filter(), op->bias()}, epilogue_input), {output}),
+      stride_(op->stride_),
+      dilation_(op->dilation_),
+      padding_(op->padding_),
+      activation_(op->activation_),
+      epilogue_(std::move(epilogue)),
+      result_quantization_(op->output()->quantization()),
+      winograd_(op->winograd_),
+      hexagon_(op->hexagon_) {
+    assert(!op->has_epilogue());
+}
+
+bool ConvOp::can_fuse_epilogue() const {
+    assert(vector_tile_ > 0);
+    // The schedule only avoids reading the epilogue input out of bounds
+    // when the channels are a multiple of the vector size.
+    return !has_epilogue() && !winograd_ && !hexagon_ &&
+           input()->type() == halide_type_of<uint8_t>() &&
+           output()->type() == halide_type_of<uint8_t>() &&
+           output()->extent(0) % vector_tile_ == 0;
+}
+
+namespace {
+
+// The transforms of a Winograd convolution have some overhead per tile of
+// each input channel, so it's only worth using for convolutions with enough
+// input channels.
+constexpr int min_winograd_input_channels = 16;
+
+}  // namespace
+
+bool ConvOp::can_use_winograd() const {
+    assert(vector_tile_ > 0);
+    const TensorPtr &in = input();
+    const TensorPtr &filt = filter();
+    const TensorPtr &out = output();
+    if (winograd_ || hexagon_ || has_epilogue() ||
+        in->type() != halide_type_of<uint8_t>() ||
+        filt->type() != halide_type_of<uint8_t>() ||
+        out->type() != halide_type_of<uint8_t>() ||
+        in->rank() != 4 || filt->rank() != 4) {
+        return false;
+    }
+    if (stride_[0] != 1 || stride_[1] != 1 || dilation_[0] != 1 || dilation_[1] != 1 ||
+        filt->extent(1) != 3 || filt->extent(2) != 3) {
+        return false;
+    }
+    const int input_channels = filt->extent(0);
+    return input_channels >= min_winograd_input_channels &&
+           input_channels <= max_winograd_input_channels &&
+           out->extent(0) >= vector_tile_ &&
+           out->extent(1) >= 2 && out->extent(2) >= 2;
+}
+
+bool ConvOp::can_use_hexagon() const {
+#ifdef HANNK_HEXAGON_OFFLOAD
+    return !winograd_ && !has_epilogue() &&
+           input()->type() == halide_type_of<uint8_t>() &&
+           filter()->type() == halide_type_of<uint8_t>() &&
+           output()->type() == halide_type_of<uint8_t>() &&
+           filter()->rank() == input()->rank();
+#else
+    return false;
+#endif
+}
+
 BoundsMap ConvOp::map_bounds(int input_idx, int output_idx) const {
     assert(vector_reduction_ > 0);
     assert(vector_tile_ > 0);
 
+    if (winograd_ && input_idx == 0) {
+        // The channels don't need to be aligned, and the filter is always 3x3.
+        BoundsMap result(input()->rank(), output()->rank());
+        result
+            .constant(0, input()->extent(0))
+            .elementwise(3, 3);
+        for (int i = 1; i < 3; i++) {
+            result.downsample(i, i, 1, Interval(0, 2));
+        }
+        return result;
+    } else if (winograd_ && input_idx == 1) {
+        // The filter is tiled for Winograd's algorithm, indexed by co, ci,
+        // and the coordinates of the 4x4 transformed tile.
+        BoundsMap result(4, output()->rank());
+        result
+            .elementwise(0, 0)
+            .constant(1, input()->extent(0))
+            .constant(2, 4)
+            .constant(3, 4);
+        return result;
+    }
+
 #ifdef CONV_R16
-    const int unroll_reduction = filter()->extent(0) >= 16 ? 16 : 4;
+    int unroll_reduction = filter()->extent(0) >= 16 ? 16 : 4;
 #else
-    const int unroll_reduction = 4;
+    int unroll_reduction = 4;
 #endif
+    if (input()->type() == halide_type_of<float>()) {
+        // The float convolution doesn't unroll the reduction.
+        unroll_reduction = 1;
+    } else if (hexagon_) {
+        unroll_reduction = 4;
+    }
     if (input_idx == 0) {
         BoundsMap result(input()->rank(), output()->rank());
         result
@@ -799,9 +1044,11 @@ BoundsMap ConvOp::map_bounds(int input_idx, int output_idx) const {
             result.constant(i + 3, filter()->bounds(i));
         }
         return result;
-    } else {
-        assert(input_idx == 2);
+    } else if (input_idx == 2) {
         return BoundsMap(1, output()->rank()).elementwise(0, 0);
+    } else {
+        assert(input_idx == 3);
+        return BoundsMap::elementwise(output()->rank());
     }
 }
 
@@ -810,7 +1057,16 @@ namespace {
 void call_conv2d(halide_buffer_t *input, halide_buffer_t *filter, halide_buffer_t *bias,
                  const MultiplyParams &params, const std::array<int, 2> &stride,
                  const std::array<int, 2> &dilation, const Interval &output_range,
-                 halide_buffer_t *output) {
+                 halide_buffer_t *epilogue_input, halide_buffer_t *epilogue, halide_buffer_t *output) {
+    if (epilogue) {
+        assert(output->type == halide_type_of<uint8_t>());
+        conv_epilogue_u8_u8_u8(input, (uint8_t)params.a_zero, filter, (uint8_t)params.b_zero, bias,
+                               stride[0], stride[1], dilation[0], dilation[1], params.c.mantissa(),
+                               -params.c.exponent(), (uint8_t)params.c_zero, output_range.min, output_range.max,
+                               epilogue_input, epilogue, output);
+        return;
+    }
+
     using Conv2DFn = decltype(&::hannk::conv_u8_u8_u8);
 
     Conv2DFn fn;
@@ -835,10 +1091,40 @@ void call_conv2d(halide_buffer_t *input, halide_buffer_t *filter, halide_buffer_
 
 bool ConvOp::prepare() {
     // Pass minimal sized buffers to learn about the alignment requirements.
+    if (input()->type() == halide_type_of<float>()) {
+        HalideBuffer<float, 4> input_buf(nullptr, 1, 1, 1, 1);
+        HalideBuffer<float, 1> bias_buf(nullptr, 1);
+        HalideBuffer<float, 6> filter_buf(nullptr, 1, 1, 1, 1, 1, 1);
+        HalideBuffer<float, 4> output_buf(nullptr, 1, 1, 1, 1);
+        if (conv_f32_f32_f32(input_buf, filter_buf, bias_buf, 1, 1, 1, 1, 0.0f, 0.0f, output_buf) != 0) {
+            return false;
+        }
+
+        vector_reduction_ = filter_buf.dim(0).extent();
+        vector_tile_ = filter_buf.dim(1).extent();
+        return true;
+    }
+
     // TODO: need to adapt this to the types of in, filt, out once we support multiple variants
     HalideBuffer<uint8_t, 4> input_buf(nullptr, 1, 1, 1, 1);
     HalideBuffer<int32_t, 1> bias_buf(nullptr, 1);
-    HalideBuffer<void, 6> filter_buf(filter_type(), nullptr, 1, 1, 1, 1, 1, 1);
+#ifdef HANNK_HEXAGON_OFFLOAD
+    if (hexagon_) {
+        HalideBuffer<void, 6> filter_buf(filter_type(), nullptr, 1, 1, 1, 1, 1, 1);
+        HalideBuffer<uint8_t, 4> output_buf(nullptr, 1, 1, 1, 1);
+        if (conv_hexagon_u8_u8_u8(input_buf, 0, filter_buf, 0, bias_buf, 1, 1, 1, 1, 0, 0, 0, 0, 0, output_buf) != 0) {
+            return false;
+        }
+
+        vector_reduction_ = filter_buf.dim(0).extent();
+        vector_tile_ = filter_buf.dim(1).extent();
+        return true;
+    }
+#endif
+    // Query the direct convolution even if this op uses Winograd's algorithm,
+    // because its requirements decide whether to use Winograd's algorithm.
+    const halide_type_t direct_filter_type = conv_u8_u8_u8_metadata()->arguments[2].type;
+    HalideBuffer<void, 6> filter_buf(direct_filter_type, nullptr, 1, 1, 1, 1, 1, 1);
     HalideBuffer<uint8_t, 4> output_buf(nullptr, 1, 1, 1, 1);
     if (conv_u8_u8_u8(input_buf, 0, filter_buf, 0, bias_buf, 1, 1, 1, 1, 0, 0, 0, 0, 0, output_buf) != 0) {
         return false;
@@ -860,19 +1146,31 @@ void ConvOp::execute() {
         auto filter_buf = filt->buffer();
         auto bias_buf = bias()->buffer();
         auto output_buf = out->buffer();
+        auto epilogue_input_buf = epilogue_input_buffer(this, 3);
 
+        const QuantizationInfo &result_quantization = has_epilogue() ? result_quantization_ : out->quantization();
         MultiplyParams params =
-            get_quantized_multiply_params(in->quantization(), filt->quantization(), out->quantization());
+            get_quantized_multiply_params(in->quantization(), filt->quantization(), result_quantization);
 
-        const auto output_range = get_output_range(activation_, out->quantization());
+        const auto output_range = get_output_range(activation_, result_quantization);
 
         // Pad with dummy dimensions up to 2D.
         while (input_buf.dimensions() < 4) {
             input_buf.embed(input_buf.dimensions() - 1, 1);
             output_buf.embed(output_buf.dimensions() - 1, 1);
+            epilogue_input_buf.embed(epilogue_input_buf.dimensions() - 1, 1);
             filter_buf.add_dimension();
         }
 
+        if (winograd_) {
+            // The offset of the filter was subtracted when tiling it.
+            assert(!has_epilogue());
+            conv_winograd_u8_u8_u8(input_buf, (uint8_t)params.a_zero, filter_buf, bias_buf,
+                                   params.c.mantissa(), -params.c.exponent(), (uint8_t)params.c_zero,
+                                   output_range.min, output_range.max, output_buf);
+            return;
+        }
+
         assert(filter_buf.dimensions() == 6);
         const int filter_width = filter_buf.dim(4).extent();
         const int filter_height = filter_buf.dim(5).extent();
@@ -883,9 +1181,11 @@ void ConvOp::execute() {
             // them all where possible, which might be a further improvement.
             while (can_fuse_xy(FuseType::Pad, input_buf) &&
                    can_fuse_xy(FuseType::Pad, output_buf) &&
+                   can_fuse_xy(FuseType::Pad, epilogue_input_buf) &&
                    input_buf.dim(1).extent() == output_buf.dim(1).extent()) {
                 fuse_xy(FuseType::Pad, input_buf);
                 fuse_xy(FuseType::Pad, output_buf);
+                fuse_xy(FuseType::Pad, epilogue_input_buf);
             }
 
             if (output_buf.dim(1).extent() < output_buf.dim(2).extent()) {
@@ -894,10 +1194,53 @@ void ConvOp::execute() {
                 // if we tiled y instead. We can do this by just swapping the x and y dimensions.
                 input_buf.transpose(1, 2);
                 output_buf.transpose(1, 2);
+                epilogue_input_buf.transpose(1, 2);
             }
         }
 
-        call_conv2d(input_buf, filter_buf, bias_buf, params, stride_, dilation_, output_range, output_buf);
+#ifdef HANNK_HEXAGON_OFFLOAD
+        if (hexagon_) {
+            assert(!has_epilogue());
+            conv_hexagon_u8_u8_u8(input_buf, (uint8_t)params.a_zero, filter_buf, (uint8_t)params.b_zero, bias_buf,
+                                  stride_[0], stride_[1], dilation_[0], dilation_[1], params.c.mantissa(),
+                                  -params.c.exponent(), (uint8_t)params.c_zero, output_range.min, output_range.max,
+                                  output_buf);
+            // The pipeline leaves the output on the device. The device
+            // allocations belong to these copies of the tensors' buffers, so
+            // free them before they go out of scope.
+            output_buf.copy_to_host();
+            input_buf.device_free();
+            filter_buf.device_free();
+            bias_buf.device_free();
+            output_buf.device_free();
+            return;
+        }
+#endif
+
+        halide_buffer_t *epilogue = has_epilogue() ? epilogue_.raw_buffer() : nullptr;
+        call_conv2d(input_buf, filter_buf, bias_buf, params, stride_, dilation_, output_range,
+                    epilogue_input_buf, epilogue, output_buf);
+    } else if (in->type() == halide_type_of<float>() &&
+               filt->type() == halide_type_of<float>() &&
+               out->type() == halide_type_of<float>()) {
+        assert(!has_epilogue());
+        auto input_buf = in->buffer();
+        auto filter_buf = filt->buffer();
+        auto bias_buf = bias()->buffer();
+        auto output_buf = out->buffer();
+
+        const auto output_range = get_float_output_range(activation_);
+
+        // Pad with dummy dimensions up to 2D.
+        while (input_buf.dimensions() < 4) {
+            input_buf.embed(input_buf.dimensions() - 1, 1);
+            output_buf.embed(output_buf.dimensions() - 1, 1);
+            filter_buf.add_dimension();
+        }
+
+        assert(filter_buf.dimensions() == 6);
+        conv_f32_f32_f32(input_buf, filter_buf, bias_buf, stride_[0], stride_[1], dilation_[0], dilation_[1],
+                         output_range.min, output_range.max, output_buf);
     } else {
         HLOG(FATAL) << "Unsupported type " << out->type() << "\n";
     }
@@ -909,8 +1252,21 @@ namespace {
 void call_depthwise_conv_uint8(
     halide_buffer_t *input, halide_buffer_t *filter, halide_buffer_t *bias,
     const MultiplyParams &params, const std::array<int, 2> &stride, const std::array<int, 2> &dilation,
-    int input_stride_x, const Interval &output_range, halide_buffer_t *output) {
-    if (input_stride_x != 0) {
+    int input_stride_x, const Interval &output_range, halide_buffer_t *epilogue_input,
+    halide_buffer_t *epilogue, halide_buffer_t *output) {
+    if (epilogue && input_stride_x != 0) {
+        depthwise_conv_shallow_epilogue_uint8(
+            input, (uint8_t)params.a_zero, filter, (uint8_t)params.b_zero, bias,
+            stride[0], stride[1], dilation[0], dilation[1], input_stride_x, params.c.mantissa(), -params.c.exponent(),
+            (uint8_t)params.c_zero, (uint8_t)output_range.min, (uint8_t)output_range.max, epilogue_input, epilogue,
+            output);
+    } else if (epilogue) {
+        depthwise_conv_epilogue_uint8(
+            input, (uint8_t)params.a_zero, filter, (uint8_t)params.b_zero, bias,
+            stride[0], stride[1], dilation[0], dilation[1], input_stride_x, params.c.mantissa(), -params.c.exponent(),
+            (uint8_t)params.c_zero, (uint8_t)output_range.min, (uint8_t)output_range.max, epilogue_input, epilogue,
+            output);
+    } else if (input_stride_x != 0) {
         depthwise_conv_shallow_uint8(
             input, (uint8_t)params.a_zero, filter, (uint8_t)params.b_zero, bias,
             stride[0], stride[1], dilation[0], dilation[1], input_stride_x, params.c.mantissa(), -params.c.exponent(),
@@ -940,6 +1296,32 @@ bool can_be_shallow(int alignment, int extent_0, int extent_1) {
 
 }  // namespace
 
+DepthwiseConv2DOp::DepthwiseConv2DOp(const DepthwiseConv2DOp *op, HalideBuffer<int16_t, 2> epilogue,
+                                     const TensorPtr &epilogue_input, const TensorPtr &output)
+    : Op(with_epilogue_input({op->input(), op->filter(), op->bias()}, epilogue_input), {output}),
+      depth_multiplier_(op->depth_multiplier_),
+      stride_(op->stride_),
+      dilation_(op->dilation_),
+      padding_(op->padding_),
+      activation_(op->activation_),
+      epilogue_(std::move(epilogue)),
+      result_quantization_(op->output()->quantization()) {
+    assert(!op->has_epilogue());
+}
+
+bool DepthwiseConv2DOp::can_fuse_epilogue() const {
+    assert(channel_alignment_ > 0);
+    // There are no epilogue variants of the broadcasting depthwise conv,
+    // and the schedule only avoids reading the epilogue input out of
+    // bounds when the channels are a multiple of the vector size.
+    return !has_epilogue() &&
+           input()->type() == halide_type_of<uint8_t>() &&
+           output()->type() == halide_type_of<uint8_t>() &&
+           depth_multiplier_ == 1 &&
+           input()->extent(0) > 1 &&
+           output()->extent(0) % channel_alignment_ == 0;
+}
+
 BoundsMap DepthwiseConv2DOp::map_bounds(int input_idx, int output_idx) const {
     assert(output_idx == 0);
     assert(channel_alignment_ > 0);
@@ -968,11 +1350,18 @@ BoundsMap DepthwiseConv2DOp::map_bounds(int input_idx, int output_idx) const {
     } else if (input_idx == 2) {
         return BoundsMap(1, 4).elementwise(0, 0);
     } else {
-        return BoundsMap(0, 4);
+        assert(input_idx == 3);
+        return BoundsMap::elementwise(4);
     }
 }
 
 bool DepthwiseConv2DOp::prepare() {
+    if (input()->type() == halide_type_of<float>()) {
+        // The float depthwise convolution doesn't require any alignment.
+        channel_alignment_ = 1;
+        return true;
+    }
+
     // Pass minimal sized buffers to learn about the alignment requirements.
     // TODO: need to adapt this to the types of in, filt, out once we support multiple variants
     HalideBuffer<uint8_t, 4> input_buf(nullptr, 1, 1, 1, 1);
@@ -998,11 +1387,13 @@ void DepthwiseConv2DOp::execute() {
         auto filter_buf = filt->buffer().sliced(3, 0);
         auto bias_buf = bias()->buffer();
         auto output_buf = out->buffer();
+        auto epilogue_input_buf = epilogue_input_buffer(this, 3);
 
+        const QuantizationInfo &result_quantization = has_epilogue() ? result_quantization_ : out->quantization();
         MultiplyParams params =
-            get_quantized_multiply_params(in->quantization(), filt->quantization(), out->quantization());
+            get_quantized_multiply_params(in->quantization(), filt->quantization(), result_quantization);
 
-        const auto output_range = get_output_range(activation_, out->quantization());
+        const auto output_range = get_output_range(activation_, result_quantization);
 
         // If the number of channels is small and divides the channel alignment,
         // and the stride of the filter in x is 1, we can use the "shallow"
@@ -1012,15 +1403,31 @@ void DepthwiseConv2DOp::execute() {
         if (stride_[0] == 1 &&
             can_fuse_cx(FuseType::InPlace, input_buf) &&
             can_fuse_cx(FuseType::InPlace, output_buf) &&
+            can_fuse_cx(FuseType::InPlace, epilogue_input_buf) &&
             can_be_shallow(channel_alignment_, input_buf.dim(0).extent(), input_buf.dim(1).extent())) {
             input_stride_x = input_buf.dim(1).stride();
             fuse_cx(FuseType::InPlace, input_buf);
             fuse_cx(FuseType::InPlace, output_buf);
+            fuse_cx(FuseType::InPlace, epilogue_input_buf);
         }
 
         assert(depth_multiplier_ == 1 || depth_multiplier_ >= out->extent(0));
-        call_depthwise_conv_uint8(input_buf, filter_buf, bias_buf, params,
-                                  stride_, dilation_, input_stride_x, output_range, output_buf);
+        halide_buffer_t *epilogue = has_epilogue() ? epilogue_.raw_buffer() : nullptr;
+        call_depthwise_conv_uint8(input_buf, filter_buf, bias_buf, params, stride_, dilation_,
+                                  input_stride_x, output_range, epilogue_input_buf, epilogue, output_buf);
+    } else if (in->type() == halide_type_of<float>() &&
+               filt->type() == halide_type_of<float>() &&
+               out->type() == halide_type_of<float>()) {
+        assert(!has_epilogue());
+        auto input_buf = in->buffer();
+        auto filter_buf = filt->buffer().sliced(3, 0);
+        auto bias_buf = bias()->buffer();
+        auto output_buf = out->buffer();
+
+        const auto output_range = get_float_output_range(activation_);
+
+        depthwise_conv_float32(input_buf, filter_buf, bias_buf, depth_multiplier_, stride_[0], stride_[1],
+                               dilation_[0], dilation_[1], output_range.min, output_range.max, output_buf);
     } else {
         HLOG(FATAL) << "Unsupported type " << out->type() << "\n";
     }
@@ -1249,7 +1656,8 @@ void PadOp::execute() {
         out->resize_dynamic(new_shape);
     }
 
-    if (out->type().bytes() == 1) {
+    const bool is_float = out->type() == halide_type_of<float>();
+    if (out->type().bytes() == 1 || is_float) {
         auto input_buf = in->buffer();
         auto output_buf = out->buffer();
 
@@ -1259,7 +1667,15 @@ void PadOp::execute() {
             input_buf.translate(d, padding_buf(0, idx));
         }
 
-        uint8_t pad_value = in->quantization().uniform_zero();
+        // Float tensors are padded with zero.
+        const int pad_value = is_float ? 0 : in->quantization().uniform_zero();
+        auto fill = [&](halide_buffer_t *buf) {
+            if (is_float) {
+                fill_float32(pad_value, buf);
+            } else {
+                fill_uint8(pad_value, buf);
+            }
+        };
 
         // TODO: should we pad_to_rank(4) the input and output bufs before the loop?
 
@@ -1277,14 +1693,14 @@ void PadOp::execute() {
             if (output_min < input_min) {
                 auto before = output_buf.cropped(d, output_min, input_min - output_min);
                 pad_to_rank(4, before);
-                fill_uint8(pad_value, before);
+                fill(before);
             } else {
                 input_min = output_min;
             }
             if (output_max > input_max) {
                 auto after = output_buf.cropped(d, input_max + 1, output_max - input_max);
                 pad_to_rank(4, after);
-                fill_uint8(pad_value, after);
+                fill(after);
             } else {
                 input_max = output_max;
             }
@@ -1295,7 +1711,11 @@ void PadOp::execute() {
             input_buf.dim(0).max() < output_buf.dim(0).max()) {
             pad_to_rank(4, input_buf);
             pad_to_rank(4, output_buf);
-            copy_uint8_uint8(input_buf, pad_value, output_buf);
+            if (is_float) {
+                copy_float32_float32(input_buf, pad_value, output_buf);
+            } else {
+                copy_uint8_uint8(input_buf, pad_value, output_buf);
+            }
         }
     } else {
         HLOG(FATAL) << "Unsupported type " << out->type() << "\n";
@@ -1361,6 +1781,30 @@ void Pool2DOp::execute() {
                            output_range.min, output_range.max, output_buf);
             break;
         }
+    } else if (in->type() == halide_type_of<float>() &&
+               out->type() == halide_type_of<float>()) {
+        auto input_buf = in->buffer();
+        auto output_buf = out->buffer();
+
+        const auto output_range = get_float_output_range(activation_);
+
+        const int in_width = input_buf.dim(1).extent();
+        const int in_height = input_buf.dim(2).extent();
+        const int out_width = output_buf.dim(1).extent();
+        const int out_height = output_buf.dim(2).extent();
+        input_buf.translate(1, compute_padding(stride_[0], in_width, filter_size_[0], out_width));
+        input_buf.translate(2, compute_padding(stride_[1], in_height, filter_size_[1], out_height));
+
+        switch (op_) {
+        case Average:
+            average_pool_float32(input_buf, stride_[0], stride_[1], filter_size_[0], filter_size_[1],
+                                 output_range.min, output_range.max, output_buf);
+            break;
+        case Max:
+            max_pool_float32(input_buf, stride_[0], stride_[1], filter_size_[0], filter_size_[1],
+                             output_range.min, output_range.max, output_buf);
+            break;
+        }
     } else {
         HLOG(FATAL) << "Unsupported type " << out->type() << "\n";
     }
@@ -1719,12 +2163,29 @@ void TileConvFilterOp::execute() {
         int input_zero = in->quantization().uniform_zero();
         int output_zero = out->quantization().uniform_zero();
 
+        if (winograd_) {
+            // The transform subtracts the offset.
+            assert(output_zero == 0);
+            tile_winograd_conv_filter_uint8(input_buf, input_zero, output_buf);
+            return;
+        }
+
         while (input_buf.dimensions() < 4) {
             input_buf.embed(input_buf.dimensions() - 1, 0);
             output_buf.add_dimension();
         }
 
         tile_conv_filter_uint8(input_buf, input_zero, output_zero, output_buf);
+    } else if (in->type() == halide_type_of<float>()) {
+        auto input_buf = in->buffer();
+        auto output_buf = out->buffer();
+
+        while (input_buf.dimensions() < 4) {
+            input_buf.embed(input_buf.dimensions() - 1, 0);
+            output_buf.add_dimension();
+        }
+
+        tile_conv_filter_float32(input_buf, output_buf);
     } else {
         HLOG(FATAL) << "Unsupported type " << in->type() << "\n";
     }
@@ -1782,6 +2243,23 @@ const char *UnaryOp::to_string(UnaryOp::Operator op) {
     }
 }
 
+HalideBuffer<int16_t, 2> UnaryOp::to_epilogue() const {
+    const TensorPtr &in = input();
+    const TensorPtr &out = output();
+    if (in->type() != halide_type_of<uint8_t>() || out->type() != halide_type_of<uint8_t>()) {
+        return HalideBuffer<int16_t, 2>();
+    }
+    if (op_ == Negate) {
+        return make_add_uint8_program(in->quantization(), -1, in->quantization(), 0,
+                                      out->quantization(), ActivationFunction::None);
+    } else if (op_ == Relu || op_ == Relu6 || op_ == ReluN1To1) {
+        return make_add_uint8_program(in->quantization(), 1, in->quantization(), 0,
+                                      out->quantization(), to_activation(op_));
+    } else {
+        return HalideBuffer<int16_t, 2>();
+    }
+}
+
 void UnaryOp::execute() {
     const TensorPtr &in = input();
     const TensorPtr &out = output();
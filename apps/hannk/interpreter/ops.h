@@ -55,6 +55,19 @@ public:
         : ElementwiseOp({a, b}, {output}), op_(op), activation_(activation) {
     }
 
+    Operator op() const {
+        return op_;
+    }
+    ActivationFunction activation() const {
+        return activation_;
+    }
+
+    // Make an elementwise program that computes this op, to be fused into the
+    // output stage of the producer of input(fused_input). Input 0 of the
+    // program is that input, and input 1 is the other input. Returns an
+    // empty buffer if this op can't be computed this way.
+    HalideBuffer<int16_t, 2> to_epilogue(int fused_input) const;
+
     void execute() override;
 
     std::string name() const override {
@@ -101,6 +114,19 @@ class ConvOp : public Op {
     Padding padding_;
     ActivationFunction activation_;
 
+    // An elementwise program applied to the result of the convolution and
+    // the epilogue input (if any), and the quantization of that result.
+    HalideBuffer<int16_t, 2> epilogue_;
+    QuantizationInfo result_quantization_;
+
+    // Whether to compute the convolution with Winograd's algorithm, in which
+    // case the filter is tiled by TileConvFilterOp for it.
+    bool winograd_;
+
+    // Whether to offload the convolution to Hexagon HVX. Only supported if
+    // hannk was built with HANNK_HEXAGON_OFFLOAD.
+    bool hexagon_;
+
     // calculated in prepare()
     int vector_reduction_ = 0;
     int vector_tile_ = 0;
@@ -108,14 +134,22 @@ class ConvOp : public Op {
 public:
     ConvOp(const TensorPtr &input, const TensorPtr &filter, const TensorPtr &bias, const TensorPtr &output,
            std::array<int, 2> stride, std::array<int, 2> dilation, Padding padding,
-           ActivationFunction activation)
+           ActivationFunction activation, bool winograd = false, bool hexagon = false)
         : Op({input, filter, bias}, {output}),
           stride_(stride),
           dilation_(dilation),
           padding_(padding),
-          activation_(activation) {
+          activation_(activation),
+          winograd_(winograd),
+          hexagon_(hexagon) {
     }
 
+    // Make a copy of op that applies the elementwise program epilogue to
+    // the result of op and epilogue_input (which may be null), and stores
+    // that to output.
+    ConvOp(const ConvOp *op, HalideBuffer<int16_t, 2> epilogue, const TensorPtr &epilogue_input,
+           const TensorPtr &output);
+
     const TensorPtr &filter() const {
         return Op::input(1);
     }
@@ -135,6 +169,28 @@ public:
     ActivationFunction activation() const {
         return activation_;
     }
+    bool has_epilogue() const {
+        return epilogue_.data() != nullptr;
+    }
+    // Whether an epilogue can be fused into this op. Requires the op to be
+    // prepared.
+    bool can_fuse_epilogue() const;
+
+    bool winograd() const {
+        return winograd_;
+    }
+    // Whether this op can be computed with Winograd's algorithm, and is big
+    // enough to benefit from it. Requires the op to be prepared, and the
+    // filter to not be tiled yet.
+    bool can_use_winograd() const;
+
+    bool hexagon() const {
+        return hexagon_;
+    }
+    // Whether this op can be offloaded to Hexagon. Always false if hannk
+    // was built without HANNK_HEXAGON_OFFLOAD. Requires the filter to not
+    // be tiled yet.
+    bool can_use_hexagon() const;
 
     halide_type_t filter_type() const;
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
@@ -158,6 +214,11 @@ class DepthwiseConv2DOp : public Op {
     Padding padding_;
     ActivationFunction activation_;
 
+    // An elementwise program applied to the result of the convolution and
+    // the epilogue input (if any), and the quantization of that result.
+    HalideBuffer<int16_t, 2> epilogue_;
+    QuantizationInfo result_quantization_;
+
     // calculated in prepare()
     int channel_alignment_ = 0;
 
@@ -173,6 +234,12 @@ public:
           activation_(activation) {
     }
 
+    // Make a copy of op that applies the elementwise program epilogue to
+    // the result of op and epilogue_input (which may be null), and stores
+    // that to output.
+    DepthwiseConv2DOp(const DepthwiseConv2DOp *op, HalideBuffer<int16_t, 2> epilogue,
+                      const TensorPtr &epilogue_input, const TensorPtr &output);
+
     int depth_multiplier() const {
         return depth_multiplier_;
     }
@@ -197,6 +264,12 @@ public:
     ActivationFunction activation() const {
         return activation_;
     }
+    bool has_epilogue() const {
+        return epilogue_.data() != nullptr;
+    }
+    // Whether an epilogue can be fused into this op. Requires the op to be
+    // prepared.
+    bool can_fuse_epilogue() const;
 
     bool prepare() override;
     void execute() override;
@@ -497,9 +570,16 @@ private:
 };
 
 class TileConvFilterOp : public Op {
+    // Whether to tile the filter for a ConvOp using Winograd's algorithm.
+    bool winograd_;
+
 public:
-    TileConvFilterOp(const TensorPtr &input, const TensorPtr &output)
-        : Op({input}, {output}) {
+    TileConvFilterOp(const TensorPtr &input, const TensorPtr &output, bool winograd = false)
+        : Op({input}, {output}), winograd_(winograd) {
+    }
+
+    bool winograd() const {
+        return winograd_;
     }
 
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
@@ -556,6 +636,15 @@ public:
         : ElementwiseOp({input}, {output}), op_(op) {
     }
 
+    Operator op() const {
+        return op_;
+    }
+
+    // Make an elementwise program that computes this op, to be fused into the
+    // output stage of the producer of the input, which is input 0 of the
+    // program. Returns an empty buffer if this op can't be computed this way.
+    HalideBuffer<int16_t, 2> to_epilogue() const;
+
     void execute() override;
 
     std::string name() const override {
@@ -0,0 +1,317 @@
+#include "interpreter/prepared_cache.h"
+#include "interpreter/ops.h"
+#include "util/error_util.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_set>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace hannk {
+
+namespace {
+
+constexpr char kMagic[8] = {'H', 'A', 'N', 'N', 'K', 'P', 'C', '\0'};
+constexpr uint32_t kVersion = 1;
+
+// Constants in the file are aligned to this, so they can be used in place.
+constexpr size_t kAlignment = 64;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t constant_count;
+    uint64_t fingerprint;
+    uint64_t block_count;
+};
+
+struct ConstantEntry {
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Not a cryptographic hash, just enough to notice that a model has changed.
+class Hasher {
+    uint64_t h_ = 14695981039346656037ULL;
+
+public:
+    void add(uint64_t x) {
+        h_ = (h_ ^ x) * 1099511628211ULL;
+    }
+
+    void add(const void *data, size_t size) {
+        const char *p = (const char *)data;
+        uint64_t word;
+        for (; size >= sizeof(word); size -= sizeof(word), p += sizeof(word)) {
+            memcpy(&word, p, sizeof(word));
+            add(word);
+        }
+        word = 0;
+        memcpy(&word, p, size);
+        add(word);
+    }
+
+    void add(const std::string &s) {
+        add(s.size());
+        add(s.data(), s.size());
+    }
+
+    uint64_t result() const {
+        return h_;
+    }
+};
+
+class Fingerprinter : public OpVisitor {
+    using OpVisitor::visit;
+
+    std::unordered_set<const Tensor *> hashed_contents_;
+
+    void add(const TensorPtr &t) {
+        if (!t) {
+            hasher.add(0);
+            return;
+        }
+        hasher.add(t->name());
+        hasher.add(t->type().as_u32());
+        hasher.add(t->rank());
+        for (int d = 0; d < t->rank(); d++) {
+            hasher.add(t->bounds(d).min);
+            hasher.add(t->bounds(d).max);
+        }
+        const QuantizationInfo &q = t->quantization();
+        hasher.add(q.dimension);
+        hasher.add(q.scale.data(), q.scale.size() * sizeof(q.scale[0]));
+        hasher.add(q.zero.data(), q.zero.size() * sizeof(q.zero[0]));
+        hasher.add(t->is_constant());
+        if (t->is_constant() && t->is_allocated() && hashed_contents_.insert(t.get()).second) {
+            const auto &buf = t->buffer();
+            hasher.add(buf.begin(), buf.size_in_bytes());
+        }
+    }
+
+    void visit_leaf(const Op *op) override {
+        hasher.add(op->name());
+        hasher.add(op->input_count());
+        for (int i = 0; i < op->input_count(); i++) {
+            add(op->input(i));
+        }
+        hasher.add(op->output_count());
+        for (int i = 0; i < op->output_count(); i++) {
+            add(op->output(i));
+        }
+    }
+
+public:
+    Hasher hasher;
+};
+
+size_t align_offset(size_t x, size_t alignment) {
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+}  // namespace
+
+uint64_t fingerprint_model(const Op *root) {
+    Fingerprinter fingerprinter;
+    fingerprinter.hasher.add(kVersion);
+    root->accept(&fingerprinter);
+    return fingerprinter.hasher.result();
+}
+
+PreparedCache::~PreparedCache() {
+    unmap();
+}
+
+void PreparedCache::unmap() {
+    if (!mapping_) {
+        return;
+    }
+#ifdef _WIN32
+    delete[](char *) mapping_;
+#else
+    munmap(mapping_, mapping_size_);
+#endif
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+}
+
+bool PreparedCache::load(const std::string &path) {
+    assert(!loaded());
+    // Anything we don't find has to be computed, and then written back.
+    dirty_ = true;
+
+#ifdef _WIN32
+    // Without mmap, constants are copied out of the file, aligned as if
+    // they were mapped.
+    std::ifstream f(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!f.is_open()) {
+        return false;
+    }
+    size_t size = f.tellg();
+    char *data = new char[size + kAlignment];
+    char *aligned = (char *)align_offset((uintptr_t)data, kAlignment);
+    f.seekg(0, std::ifstream::beg);
+    if (!f.read(aligned, size)) {
+        delete[] data;
+        return false;
+    }
+    mapping_ = data;
+    mapping_size_ = size;
+    const char *base = aligned;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    // A private mapping, so the constants can be written without changing
+    // the file (e.g. by ops that alias them).
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    mapping_ = data;
+    mapping_size_ = size;
+    const char *base = (const char *)data;
+#endif
+
+    Header header;
+    if (size < sizeof(header)) {
+        unmap();
+        return false;
+    }
+    memcpy(&header, base, sizeof(header));
+    size_t entries_size = header.block_count * sizeof(uint64_t) +
+                          header.constant_count * sizeof(ConstantEntry);
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.version != kVersion ||
+        header.fingerprint != fingerprint_ ||
+        header.block_count > size ||
+        header.constant_count > size ||
+        sizeof(header) + entries_size > size) {
+        unmap();
+        return false;
+    }
+
+    const char *p = base + sizeof(header);
+    cached_arena_offsets_.resize(header.block_count);
+    for (size_t &offset : cached_arena_offsets_) {
+        uint64_t offset64;
+        memcpy(&offset64, p, sizeof(offset64));
+        p += sizeof(offset64);
+        offset = offset64;
+    }
+    for (uint32_t i = 0; i < header.constant_count; i++) {
+        ConstantEntry entry;
+        memcpy(&entry, p, sizeof(entry));
+        p += sizeof(entry);
+        if (entry.offset > size || entry.size > size - entry.offset || entry.offset % kAlignment != 0) {
+            cached_constants_.clear();
+            cached_arena_offsets_.clear();
+            unmap();
+            return false;
+        }
+        cached_constants_.push_back({base + entry.offset, entry.size});
+    }
+
+    dirty_ = false;
+    return true;
+}
+
+void *PreparedCache::find_constant(int index, size_t size) {
+    if (index < (int)cached_constants_.size() && cached_constants_[index].size == size) {
+        return const_cast<void *>(cached_constants_[index].data);
+    }
+    dirty_ = true;
+    return nullptr;
+}
+
+void PreparedCache::add_constant(int index, TensorPtr t) {
+    assert(index == (int)constants_.size());
+    constants_.push_back(std::move(t));
+}
+
+bool PreparedCache::find_arena_layout(int block_count, std::vector<size_t> *offsets) {
+    if (loaded() && (int)cached_arena_offsets_.size() == block_count) {
+        *offsets = cached_arena_offsets_;
+        return true;
+    }
+    return false;
+}
+
+void PreparedCache::set_arena_layout(std::vector<size_t> offsets) {
+    if (!loaded() || offsets != cached_arena_offsets_) {
+        dirty_ = true;
+    }
+    arena_offsets_ = std::move(offsets);
+}
+
+bool PreparedCache::write(const std::string &path) const {
+    Header header;
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.constant_count = constants_.size();
+    header.fingerprint = fingerprint_;
+    header.block_count = arena_offsets_.size();
+
+    // Lay out the constants after the header and the entries.
+    std::vector<ConstantEntry> entries;
+    size_t offset = sizeof(header) + header.block_count * sizeof(uint64_t) +
+                    header.constant_count * sizeof(ConstantEntry);
+    for (const TensorPtr &t : constants_) {
+        offset = align_offset(offset, kAlignment);
+        const size_t size = t->buffer().size_in_bytes();
+        entries.push_back({offset, size});
+        offset += size;
+    }
+
+    // Write to a temporary file, and then move it into place.
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream f(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!f.is_open()) {
+            return false;
+        }
+        f.write((const char *)&header, sizeof(header));
+        for (size_t o : arena_offsets_) {
+            uint64_t offset64 = o;
+            f.write((const char *)&offset64, sizeof(offset64));
+        }
+        f.write((const char *)entries.data(), entries.size() * sizeof(entries[0]));
+        for (size_t i = 0; i < constants_.size(); i++) {
+            const size_t padding = entries[i].offset - (size_t)f.tellp();
+            const char zeros[kAlignment] = {0};
+            f.write(zeros, padding);
+            f.write((const char *)constants_[i]->buffer().begin(), entries[i].size);
+        }
+        if (!f.good()) {
+            f.close();
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+#ifdef _WIN32
+    // rename() doesn't replace existing files on Windows.
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace hannk
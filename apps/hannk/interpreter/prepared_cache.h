@@ -0,0 +1,97 @@
+#ifndef HANNK_PREPARED_CACHE_H
+#define HANNK_PREPARED_CACHE_H
+
+#include <string>
+#include <vector>
+
+#include "interpreter/model.h"
+
+namespace hannk {
+
+// Compute a hash of everything about a model that affects the result of
+// constant folding: the ops, the shapes and quantization of the tensors, and
+// the contents of the constant tensors.
+uint64_t fingerprint_model(const Op *root);
+
+// A file holding the results of the expensive parts of Interpreter::prepare()
+// for a model: the tensors computed by constant folding (e.g. the tiled filters
+// of convolutions), and the layout of the tensor arena. The file is mapped into
+// memory, and the constant tensors are used in place from the mapping.
+//
+// The ops themselves are still parsed and transformed at each startup; the
+// cache only stands in for the work on the data.
+class PreparedCache {
+    const uint64_t fingerprint_;
+
+    // The mapping of the cache file, if one was loaded.
+    void *mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+
+    struct Constant {
+        const void *data;
+        size_t size;
+    };
+    std::vector<Constant> cached_constants_;
+    std::vector<size_t> cached_arena_offsets_;
+
+    // What to write to the cache, if the loaded cache (if any) didn't have
+    // everything we needed.
+    std::vector<TensorPtr> constants_;
+    std::vector<size_t> arena_offsets_;
+    bool dirty_ = false;
+
+    void unmap();
+
+public:
+    explicit PreparedCache(uint64_t fingerprint)
+        : fingerprint_(fingerprint) {
+    }
+    ~PreparedCache();
+
+    // Map the cache file at path into memory. Returns false if there is no
+    // such file, or it isn't a cache for a model with the same fingerprint.
+    bool load(const std::string &path);
+
+    bool loaded() const {
+        return mapping_ != nullptr;
+    }
+
+    // Whether the cache needs to be (re)written, because it didn't have
+    // everything asked of it.
+    bool dirty() const {
+        return dirty_;
+    }
+
+    // Get the cached contents of the index'th tensor computed by constant
+    // folding, if it has the given size. Otherwise, returns null. The memory
+    // is a private mapping, so it may be written without affecting the file.
+    void *find_constant(int index, size_t size);
+
+    // Record the index'th tensor computed by constant folding. The indices
+    // must be consecutive.
+    void add_constant(int index, TensorPtr t);
+
+    // Get the cached offsets of the blocks of the arena, if the cache has
+    // the given number of blocks. The layout still needs to be checked
+    // against the blocks.
+    bool find_arena_layout(int block_count, std::vector<size_t> *offsets);
+
+    // Record the offsets of the blocks of the arena that were used.
+    void set_arena_layout(std::vector<size_t> offsets);
+
+    // Write everything recorded to the cache file at path. The file is
+    // replaced atomically, so a concurrent load sees either the old or the
+    // new cache.
+    bool write(const std::string &path) const;
+
+    // Not movable, not copyable.
+    PreparedCache() = delete;
+    PreparedCache(const PreparedCache &) = delete;
+    PreparedCache &operator=(const PreparedCache &) = delete;
+    PreparedCache(PreparedCache &&) = delete;
+    PreparedCache &operator=(PreparedCache &&) = delete;
+};
+
+}  // namespace hannk
+
+#endif  // HANNK_PREPARED_CACHE_H
@@ -0,0 +1,48 @@
+#include "interpreter/shared_constants.h"
+
+#include "HalideBuffer.h"  // for HALIDE_RUNTIME_BUFFER_ALLOCATION_ALIGNMENT
+
+namespace hannk {
+
+bool SharedConstants::begin(uint64_t fingerprint) {
+    if (!begun_) {
+        fingerprint_ = fingerprint;
+        begun_ = true;
+    }
+    return fingerprint_ == fingerprint;
+}
+
+void *SharedConstants::get_constant(int index, size_t size, bool *computed) {
+    assert(begun_);
+    *computed = false;
+    if (index < (int)constants_.size()) {
+        const Constant &c = constants_[index];
+        if (c.size != size) {
+            return nullptr;
+        }
+        *computed = computed_;
+        return c.data;
+    }
+    if (computed_) {
+        // The Interpreter that computed the constants didn't need this one.
+        return nullptr;
+    }
+    assert(index == (int)constants_.size());
+
+    // Allocate the constant with the same alignment as the heap allocations
+    // it replaces.
+    constexpr size_t alignment = HALIDE_RUNTIME_BUFFER_ALLOCATION_ALIGNMENT;
+    Constant c;
+    c.storage.reset(new char[size + alignment]);
+    c.data = (void *)(((uintptr_t)c.storage.get() + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    c.size = size;
+    constants_.push_back(std::move(c));
+    return constants_.back().data;
+}
+
+void SharedConstants::end() {
+    assert(begun_);
+    computed_ = true;
+}
+
+}  // namespace hannk
@@ -0,0 +1,71 @@
+#ifndef HANNK_SHARED_CONSTANTS_H
+#define HANNK_SHARED_CONSTANTS_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace hannk {
+
+// The tensors computed by constant folding (e.g. the tiled filters of
+// convolutions) for a model, shared by several Interpreters running the
+// same model, so that each one only needs memory for its own arena. The
+// first Interpreter to be prepared computes the constants; the others
+// use them. Once computed, the constants are never modified.
+//
+// The constants of the model itself are not copied by the Interpreter, so
+// they are already shared if the Interpreters are all made from the same
+// model buffer (which must outlive them).
+class SharedConstants {
+    std::mutex mutex_;
+
+    // The fingerprint (see fingerprint_model()) of the model the constants
+    // are for, once an Interpreter has begun computing them.
+    uint64_t fingerprint_ = 0;
+    bool begun_ = false;
+    bool computed_ = false;
+
+    struct Constant {
+        std::unique_ptr<char[]> storage;
+        void *data;
+        size_t size;
+    };
+    std::vector<Constant> constants_;
+
+public:
+    SharedConstants() = default;
+
+    // Interpreter::prepare() holds this while folding constants, so the
+    // constants are computed once, even if several Interpreters are
+    // prepared concurrently.
+    std::mutex &mutex() {
+        return mutex_;
+    }
+
+    // Begin folding constants for a model with the given fingerprint.
+    // Returns false if the constants are for a different model, in which
+    // case they can't be used.
+    bool begin(uint64_t fingerprint);
+
+    // Get the memory for the index'th tensor computed by constant folding.
+    // If *computed is set to true, it already contains the result; otherwise
+    // the result should be computed into it. Returns null if there is no
+    // memory for the tensor.
+    void *get_constant(int index, size_t size, bool *computed);
+
+    // Mark the constants as computed, once constant folding is done.
+    void end();
+
+    // Not movable, not copyable.
+    SharedConstants(const SharedConstants &) = delete;
+    SharedConstants &operator=(const SharedConstants &) = delete;
+    SharedConstants(SharedConstants &&) = delete;
+    SharedConstants &operator=(SharedConstants &&) = delete;
+};
+
+using SharedConstantsPtr = std::shared_ptr<SharedConstants>;
+
+}  // namespace hannk
+
+#endif  // HANNK_SHARED_CONSTANTS_H
@@ -197,6 +197,16 @@ void Tensor::resize_dynamic(const Box &new_shape) {
     storage_ = nullptr;
 }
 
+void Tensor::resize(const Box &new_shape) {
+    assert(!is_allocated());
+    assert(!is_external());
+    assert(!is_dynamic());
+    assert(storage_ == nullptr);
+    assert(alias_info_ == nullptr);
+
+    buffer_ = make_unallocated_buffer(buffer_.type(), new_shape);
+}
+
 bool Tensor::has_external_alias() const {
     if (alias_info_ != nullptr) {
         for (const auto &weak : alias_info_->aliases) {
@@ -250,6 +250,10 @@ public:
 
     void resize_dynamic(const Box &new_shape);
 
+    // Change the shape of a Tensor that isn't allocated, external,
+    // dynamic or aliased yet.
+    void resize(const Box &new_shape);
+
     AliasType alias_type() const {
         return alias_info_ != nullptr ? alias_info_->alias_type : AliasType::None;
     }
@@ -1,6 +1,9 @@
 #include "interpreter/transforms.h"
+#include "halide/constants.h"
 #include "util/small_vector.h"
 
+#include <cstring>
+#include <set>
 #include <unordered_set>
 
 namespace hannk {
@@ -321,6 +324,21 @@ void replace_consumers(const TensorPtr &from, const TensorPtr &to) {
 class PadForOps : public OpMutator {
     using OpMutator::visit;
 
+    const bool winograd_;
+    const int64_t hexagon_min_macs_;
+
+    // Whether op is big enough to be worth offloading to Hexagon.
+    bool should_use_hexagon(const ConvOp *op) const {
+        if (hexagon_min_macs_ < 0 || !op->can_use_hexagon()) {
+            return false;
+        }
+        // The filter is not tiled yet, so it is indexed by ci, x, y, co.
+        const TensorPtr &filter = op->filter();
+        const int64_t macs = (int64_t)op->output()->number_of_elements() *
+                             filter->extent(0) * filter->extent(1) * filter->extent(2);
+        return macs >= hexagon_min_macs_;
+    }
+
     std::unique_ptr<PadOp> get_padding_for_op(const Op *op, int input_idx = 0, int output_idx = 0) {
         TensorPtr input = op->input(input_idx);
         TensorPtr output = op->output(output_idx);
@@ -353,12 +371,25 @@ class PadForOps : public OpMutator {
     }
 
     OpPtr visit(std::unique_ptr<ConvOp> op) override {
+        TensorPtr filter = op->filter();
+        const bool needs_tiling = !op->winograd() && filter->rank() == op->input()->rank();
+        if (needs_tiling && should_use_hexagon(op.get())) {
+            // The offloaded convolution may need different padding and tiling.
+            op = make_prepared_op<ConvOp>(op->input(), op->filter(), op->bias(), op->output(),
+                                          op->stride(), op->dilation(), op->padding(), op->activation(),
+                                          /*winograd*/ false, /*hexagon*/ true);
+        } else if (winograd_ && needs_tiling && op->can_use_winograd()) {
+            // Winograd's algorithm needs different padding and tiling.
+            op = make_prepared_op<ConvOp>(op->input(), op->filter(), op->bias(), op->output(),
+                                          op->stride(), op->dilation(), op->padding(), op->activation(),
+                                          /*winograd*/ true);
+        }
+
         OpPtr padding = get_padding_for_op(op.get());
         OpPtr tile = nullptr;
 
         // We also need to tile the filter.
-        TensorPtr filter = op->filter();
-        if (op->filter()->rank() == op->input()->rank()) {
+        if (needs_tiling) {
             // This op has not yet had its filter tiled, do it now.
             BoundsMap bounds = op->map_bounds(1, 0);
             Box tiled_shape = bounds.evaluate(op->output()->bounds());
@@ -374,7 +405,7 @@ class PadForOps : public OpMutator {
             // Maybe more than one op uses this same filter...?
             replace_consumers(filter, tiled);
 
-            tile = make_prepared_op<TileConvFilterOp>(filter, tiled);
+            tile = make_prepared_op<TileConvFilterOp>(filter, tiled, op->winograd());
         }
 
         if (padding || tile) {
@@ -395,7 +426,8 @@ class PadForOps : public OpMutator {
             auto inputs = op->inputs();
             auto outputs = op->outputs();
             op = make_prepared_op<ConvOp>(conv_input, conv_filter, op->bias(), op->output(),
-                                          op->stride(), op->dilation(), op->padding(), op->activation());
+                                          op->stride(), op->dilation(), op->padding(), op->activation(),
+                                          op->winograd(), op->hexagon());
             new_ops.push_back(std::move(op));
 
             return make_prepared_op<OpGroup>(std::move(inputs), std::move(outputs), std::move(new_ops));
@@ -406,7 +438,9 @@ class PadForOps : public OpMutator {
 
     OpPtr visit(std::unique_ptr<DepthwiseConv2DOp> op) override {
         OpPtr upsample_op = nullptr;
-        if (op->depth_multiplier() != 1 && op->depth_multiplier() < op->output()->extent(0)) {
+        // The float depthwise convolution handles any depth multiplier itself.
+        if (op->input()->type() != halide_type_of<float>() &&
+            op->depth_multiplier() != 1 && op->depth_multiplier() < op->output()->extent(0)) {
             // Make an UpsampleChannels op and a new tensor for the upsampled result.
             TensorPtr input = op->input();
             TensorPtr output = op->output();
@@ -463,13 +497,18 @@ class PadForOps : public OpMutator {
     }
 
 public:
+    PadForOps(bool winograd, int64_t hexagon_min_macs)
+        : winograd_(winograd),
+          hexagon_min_macs_(hexagon_min_macs) {
+    }
+
     bool prepare_failed = false;
 };
 
 }  // namespace
 
-OpPtr pad_for_ops(OpPtr op) {
-    PadForOps padder;
+OpPtr pad_for_ops(OpPtr op, bool winograd, int64_t hexagon_min_macs) {
+    PadForOps padder(winograd, hexagon_min_macs);
     op = padder.mutate(std::move(op));
     if (padder.prepare_failed) {
         return nullptr;
@@ -535,6 +574,103 @@ OpPtr fuse_pad_ops(OpPtr op) {
 
 namespace {
 
+bool same_bounds(const TensorPtr &a, const TensorPtr &b) {
+    return is_subset_of(a->bounds(), b->bounds()) && is_subset_of(b->bounds(), a->bounds());
+}
+
+class FuseElementwiseEpilogues : public OpMutator {
+    using OpMutator::visit;
+
+    // Check if we can compute output by fusing an elementwise op of input and
+    // epilogue_input (which may be null) into the op producing input.
+    static bool can_fuse(const TensorPtr &input, const TensorPtr &epilogue_input, const TensorPtr &output) {
+        // The fused op no longer writes input, so nothing else can use it.
+        if (input->producers().size() != 1 || input->consumers().size() != 1 ||
+            input->is_external() || !same_bounds(input, output)) {
+            return false;
+        }
+        if (epilogue_input) {
+            // Don't allow broadcasting, or overwriting the epilogue input while
+            // reading it.
+            if (epilogue_input == input || !same_bounds(epilogue_input, output) ||
+                (epilogue_input->alias_type() != AliasType::None && output->alias_type() != AliasType::None)) {
+                return false;
+            }
+        }
+        const Op *producer = input->producers().front();
+        if (const ConvOp *conv = cast_op<ConvOp>(producer)) {
+            return conv->can_fuse_epilogue();
+        } else if (const DepthwiseConv2DOp *depthwise = cast_op<DepthwiseConv2DOp>(producer)) {
+            return depthwise->can_fuse_epilogue();
+        }
+        return false;
+    }
+
+    OpPtr fuse(const TensorPtr &input, HalideBuffer<int16_t, 2> epilogue, const TensorPtr &epilogue_input,
+               const TensorPtr &output) {
+        // We'll rely on remove_dead_ops to get rid of the producer later on.
+        const Op *producer = input->producers().front();
+        if (const ConvOp *conv = cast_op<ConvOp>(producer)) {
+            return make_prepared_op<ConvOp>(conv, std::move(epilogue), epilogue_input, output);
+        } else {
+            const DepthwiseConv2DOp *depthwise = cast_op<DepthwiseConv2DOp>(producer);
+            assert(depthwise);
+            return make_prepared_op<DepthwiseConv2DOp>(depthwise, std::move(epilogue), epilogue_input, output);
+        }
+    }
+
+    OpPtr visit(std::unique_ptr<BinaryOp> op) override {
+        for (int i = 0; i < 2; i++) {
+            const TensorPtr &input = op->input(i);
+            const TensorPtr &other = op->input(1 - i);
+            if (!can_fuse(input, other, op->output())) {
+                continue;
+            }
+            HalideBuffer<int16_t, 2> epilogue = op->to_epilogue(i);
+            if (epilogue.data() && epilogue.dim(1).extent() <= max_epilogue_instructions) {
+                return fuse(input, std::move(epilogue), other, op->output());
+            }
+        }
+        return op;
+    }
+
+    OpPtr visit(std::unique_ptr<UnaryOp> op) override {
+        if (can_fuse(op->input(), nullptr, op->output())) {
+            HalideBuffer<int16_t, 2> epilogue = op->to_epilogue();
+            if (epilogue.data() && epilogue.dim(1).extent() <= max_epilogue_instructions) {
+                return fuse(op->input(), std::move(epilogue), nullptr, op->output());
+            }
+        }
+        return op;
+    }
+
+    template<class T, class... Args>
+    std::unique_ptr<T> make_prepared_op(Args &&...args) {
+        auto op = std::make_unique<T>(std::forward<Args>(args)...);
+        if (!op->prepare()) {
+            HLOG(ERROR) << "fuse_elementwise_epilogues: new_op " << op->name() << " failed prepare()";
+            prepare_failed = true;
+        }
+        return op;
+    }
+
+public:
+    bool prepare_failed = false;
+};
+
+}  // namespace
+
+OpPtr fuse_elementwise_epilogues(OpPtr op) {
+    FuseElementwiseEpilogues fuser;
+    op = fuser.mutate(std::move(op));
+    if (fuser.prepare_failed) {
+        return nullptr;
+    }
+    return op;
+}
+
+namespace {
+
 bool can_execute_with_all_constant_inputs(const Op *op) {
     for (int i = 0; i < op->input_count(); i++) {
         if (!op->input(i)->is_constant()) {
@@ -545,24 +681,76 @@ bool can_execute_with_all_constant_inputs(const Op *op) {
     return true;
 }
 
+// Whether the result of constant folding t can be stored in a PreparedCache
+// or SharedConstants.
+bool is_cacheable(const TensorPtr &t) {
+    return !t->is_allocated() && t->alias_type() == AliasType::None && t->is_dense();
+}
+
 class ConstantFolder : public OpMutator {
     using OpMutator::visit;
 
+    PreparedCache *cache_;
+    SharedConstants *shared_;
+    int cached_count_ = 0;
+
+    // Find storage for the output of an op that is the next cacheable
+    // result of constant folding. Sets *computed if the storage already
+    // contains the result.
+    void *find_storage(const TensorPtr &output, bool *computed) {
+        const int index = cached_count_++;
+        const size_t size = output->buffer().size_in_bytes();
+        void *storage = nullptr;
+        *computed = false;
+        if (shared_) {
+            storage = shared_->get_constant(index, size, computed);
+        }
+        if (cache_) {
+            void *cached = cache_->find_constant(index, size);
+            cache_->add_constant(index, output);
+            if (cached && !*computed) {
+                if (storage) {
+                    memcpy(storage, cached, size);
+                } else {
+                    storage = cached;
+                }
+                *computed = true;
+            }
+        }
+        return storage;
+    }
+
     OpPtr visit_leaf(OpPtr op) override {
         if (can_execute_with_all_constant_inputs(op.get())) {
             // Allocate all the outputs.
             // Since we aren't ready for arena allocation,
-            // we'll just do these as one-off heap allocs.
+            // we'll just do these as one-off heap allocs,
+            // unless the cache or the shared constants have
+            // storage for the result.
+            bool all_cached = true;
             for (int j = 0; j < op->output_count(); j++) {
-                // Note that an output could be 'allocated' here if it
-                // is the result of a ReshapeOp that aliases constant data.
-                if (!op->output(j)->is_allocated()) {
-                    op->output(j)->allocate_from_heap();
+                const TensorPtr &output = op->output(j);
+                void *storage = nullptr;
+                bool computed = false;
+                if ((cache_ || shared_) && is_cacheable(output)) {
+                    storage = find_storage(output, &computed);
+                }
+                all_cached = all_cached && computed;
+                if (storage) {
+                    output->allocate_from_arena_pointer(storage);
+                } else {
+                    // Note that an output could be 'allocated' here if it
+                    // is the result of a ReshapeOp that aliases constant data.
+                    if (!output->is_allocated()) {
+                        output->allocate_from_heap();
+                    }
                 }
             }
 
             // Run the whole op.
-            op->execute();
+            if (!all_cached) {
+                op->execute();
+            }
 
             // Mark the outputs constant.
             for (int j = 0; j < op->output_count(); j++) {
@@ -574,17 +762,174 @@ class ConstantFolder : public OpMutator {
             return op;
         }
     }
+
+public:
+    ConstantFolder(PreparedCache *cache, SharedConstants *shared)
+        : cache_(cache), shared_(shared) {
+    }
 };
 
 }  // namespace
 
-OpPtr fold_constants(OpPtr op) {
-    ConstantFolder folder;
+OpPtr fold_constants(OpPtr op, PreparedCache *cache, SharedConstants *shared) {
+    ConstantFolder folder(cache, shared);
     return folder.mutate(std::move(op));
 }
 
 namespace {
 
+class SetBatchSize : public OpMutator {
+    using OpMutator::visit;
+
+    const int old_batch_size_, new_batch_size_;
+
+    bool has_batch(const TensorPtr &t) const {
+        return t && t->rank() > 0 && t->extent(t->rank() - 1) == old_batch_size_;
+    }
+
+    bool is_batched(const TensorPtr &t) const {
+        return t && batched.count(t) > 0;
+    }
+
+    bool any_input_batched(const Op *op) const {
+        for (int i = 0; i < op->input_count(); i++) {
+            if (is_batched(op->input(i))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void fail(const Op *op) {
+        HLOG(ERROR) << "set_batch_size: " << op->name() << " can't be batched";
+        failed = true;
+    }
+
+    OpPtr visit_leaf(OpPtr op) override {
+        if (failed || !any_input_batched(op.get())) {
+            return op;
+        }
+        for (int o = 0; o < op->output_count(); o++) {
+            const TensorPtr &output = op->output(o);
+            if (!output) {
+                continue;
+            }
+            if (!has_batch(output)) {
+                fail(op.get());
+                return op;
+            }
+            const int output_batch_dim = output->rank() - 1;
+            for (int i = 0; i < op->input_count(); i++) {
+                const TensorPtr &input = op->input(i);
+                if (!is_batched(input)) {
+                    continue;
+                }
+                // Each batch of the output must depend only on the same
+                // batch of the input.
+                const int input_batch_dim = input->rank() - 1;
+                BoundsMap bounds = op->map_bounds(i, o);
+                if (!bounds.is_elementwise(input_batch_dim, output_batch_dim) ||
+                    bounds.at(input_batch_dim, output_batch_dim).bounds.min != 0) {
+                    fail(op.get());
+                    return op;
+                }
+            }
+            batched.insert(output);
+        }
+        return op;
+    }
+
+    OpPtr visit(std::unique_ptr<ReshapeOp> op) override {
+        if (failed || !is_batched(op->input())) {
+            return op;
+        }
+        // A reshape can keep the batch dimension if it is also the
+        // outermost dimension of the output, and the shape says so.
+        const TensorPtr &shape = op->input(1);
+        if (!has_batch(op->output()) || (shape && !shape->is_constant())) {
+            fail(op.get());
+            return op;
+        }
+        if (shape) {
+            // The shape is stored outermost dimension first.
+            const auto &shape_buf = shape->buffer<const int32_t>();
+            if (shape_buf.dimensions() != 1 || shape_buf.dim(0).extent() != op->output()->rank()) {
+                fail(op.get());
+                return op;
+            }
+            const int32_t batch = shape_buf(shape_buf.dim(0).min());
+            if (batch != old_batch_size_ && batch != -1) {
+                fail(op.get());
+                return op;
+            }
+            if (batch != -1) {
+                // The shape tensor might be shared with other ops, so replace it.
+                HalideBuffer<void> new_shape_buf = HalideBuffer<const void>(shape->buffer()).copy();
+                new_shape_buf.as<int32_t>()(new_shape_buf.dim(0).min()) = new_batch_size_;
+                TensorPtr new_shape = std::make_shared<Tensor>(shape->name(), std::move(new_shape_buf), shape->quantization());
+                new_shape->set_constant();
+                op->set_input(1, std::move(new_shape));
+            }
+        }
+        batched.insert(op->output());
+        return op;
+    }
+
+public:
+    SetBatchSize(int old_batch_size, int new_batch_size)
+        : old_batch_size_(old_batch_size), new_batch_size_(new_batch_size) {
+    }
+
+    std::set<TensorPtr> batched;
+    bool failed = false;
+};
+
+}  // namespace
+
+OpPtr set_batch_size(OpPtr op, int batch_size) {
+    // The batch size is the outermost extent of the (non-constant) inputs.
+    int old_batch_size = -1;
+    for (int i = 0; i < op->input_count(); i++) {
+        const TensorPtr &input = op->input(i);
+        if (input->is_constant() || input->rank() == 0) {
+            continue;
+        }
+        const int extent = input->extent(input->rank() - 1);
+        if (old_batch_size != -1 && extent != old_batch_size) {
+            HLOG(ERROR) << "set_batch_size: the inputs have different batch sizes";
+            return nullptr;
+        }
+        old_batch_size = extent;
+    }
+    if (old_batch_size == -1 || old_batch_size == batch_size) {
+        return op;
+    }
+
+    SetBatchSize set_batch(old_batch_size, batch_size);
+    for (int i = 0; i < op->input_count(); i++) {
+        if (!op->input(i)->is_constant() && op->input(i)->rank() > 0) {
+            set_batch.batched.insert(op->input(i));
+        }
+    }
+    op = set_batch.mutate(std::move(op));
+    if (set_batch.failed) {
+        return nullptr;
+    }
+
+    for (const TensorPtr &t : set_batch.batched) {
+        if (t->is_allocated() || t->is_external() || t->is_dynamic()) {
+            HLOG(ERROR) << "set_batch_size: can't resize tensor " << t->name();
+            return nullptr;
+        }
+        Box bounds = t->bounds();
+        bounds[bounds.size() - 1].set_extent(batch_size);
+        t->resize(bounds);
+    }
+    return op;
+}
+
+namespace {
+
 class GroupFlattener : public OpMutator {
     using OpMutator::visit;
 
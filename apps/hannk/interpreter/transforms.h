@@ -2,6 +2,8 @@
 #define HANNK_TRANSFORMS_H
 
 #include "interpreter/ops.h"
+#include "interpreter/prepared_cache.h"
+#include "interpreter/shared_constants.h"
 
 namespace hannk {
 
@@ -14,12 +16,29 @@ namespace hannk {
 // Add pad ops before ops that need it, so those ops can
 // assume everything needed of the input is in bounds.
 // New ops will have prepare() called on them; this will return nullptr
-// if any of those calls fail.
-[[nodiscard]] OpPtr pad_for_ops(OpPtr op);
+// if any of those calls fail. ConvOps that can be offloaded to Hexagon,
+// and do at least hexagon_min_macs multiply-accumulates, are changed to
+// be offloaded (none are if hexagon_min_macs is negative). Otherwise,
+// if winograd is true, ConvOps that can use Winograd's algorithm are
+// changed to use it.
+[[nodiscard]] OpPtr pad_for_ops(OpPtr op, bool winograd, int64_t hexagon_min_macs = -1);
 
 // Execute ops that are constant, and mark the results
-// constant as well.
-[[nodiscard]] OpPtr fold_constants(OpPtr op);
+// constant as well. If cache is not null, results found in
+// the cache are used instead of executing the ops, and the
+// results are recorded in the cache. If shared is not null,
+// the results are stored in (or taken from) shared, which
+// must already have begun.
+[[nodiscard]] OpPtr fold_constants(OpPtr op, PreparedCache *cache = nullptr,
+                                   SharedConstants *shared = nullptr);
+
+// Change the batch size of the model: the extent of the outermost
+// dimension of its inputs, and of every tensor computed from them
+// elementwise in that dimension (as determined by the ops' BoundsMaps).
+// Must be called after the ops are prepared, but before any tensors are
+// allocated. Returns nullptr if some op can't be batched, e.g. because
+// it reshapes or transposes the batch dimension.
+[[nodiscard]] OpPtr set_batch_size(OpPtr op, int batch_size);
 
 // Flatten all nested OpGroups into a single OpGroup.
 // TODO: OpGroups that represent subgraphs shouldn't be flattened;
@@ -31,6 +50,12 @@ namespace hannk {
 // a waste; this combines them. (This should be run after flatten_groups().)
 [[nodiscard]] OpPtr fuse_pad_ops(OpPtr op);
 
+// Fuse elementwise ops that consume the output of a convolution into the
+// output stage of the convolution, when the shapes allow it. This avoids a
+// separate pass over memory for such ops. (This should be run after
+// flatten_groups().)
+[[nodiscard]] OpPtr fuse_elementwise_epilogues(OpPtr op);
+
 }  // namespace hannk
 
 #endif  // HANNK_TRANSFORMS_H
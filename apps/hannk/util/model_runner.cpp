@@ -2,6 +2,7 @@
 #include <dlfcn.h>
 #include <iostream>
 #include <random>
+#include <sstream>
 
 #ifndef _WIN32
 #include <unistd.h>
@@ -406,12 +407,18 @@ ModelRunner::RunResult ModelRunner::run_in_hannk(const std::vector<char> &buffer
 
     InterpreterOptions options;
     options.verbosity = verbosity;
+    options.parallel_ops = parallel_ops;
+    options.prepared_cache_path = prepared_cache_path;
+    options.profile_ops = profile_ops;
     Interpreter interpreter(std::move(model), std::move(options));
     if (!interpreter.prepare()) {
         std::cerr << "hannk::Interpreter::prepare() failed\n";
         // TODO: probably better form to return an error here, but for now, this is fine.
         exit(1);
     }
+    if (verbosity) {
+        std::cout << "HALIDE arena size: " << interpreter.arena_size() << " bytes\n";
+    }
 
     // Fill in the inputs with pseudorandom data (save the seeds for later).
     for (TensorPtr t : interpreter.inputs()) {
@@ -445,9 +452,15 @@ ModelRunner::RunResult ModelRunner::run_in_hannk(const std::vector<char> &buffer
 
     // Now benchmark it
     if (do_benchmark) {
+        interpreter.reset_op_timings();
         result.time = bench([&interpreter]() {
             interpreter.execute();
         });
+        if (profile_ops) {
+            std::ostringstream os;
+            interpreter.dump_op_timings(os, csv_output);
+            result.op_timings = os.str();
+        }
     }
 
     return result;
@@ -572,6 +585,18 @@ int ModelRunner::parse_flags(int argc, char **argv, std::vector<std::string> &fi
              this->keep_going = std::stoi(value) != 0;
              return 0;
          }},
+        {"parallel_ops", [this](const std::string &value) {
+             this->parallel_ops = std::stoi(value) != 0;
+             return 0;
+         }},
+        {"prepared_cache", [this](const std::string &value) {
+             this->prepared_cache_path = value;
+             return 0;
+         }},
+        {"profile_ops", [this](const std::string &value) {
+             this->profile_ops = std::stoi(value) != 0;
+             return 0;
+         }},
         {"seed", [&seed](const std::string &value) {
              seed = std::stoi(value);
              return 0;
@@ -726,6 +751,16 @@ void ModelRunner::run(const std::string &filename) {
     if (csv_output) {
         std::cout << '\n';
     }
+
+    // ----- Log the per-op times, after the results for the whole model
+    for (WhichRun i : active_runs) {
+        if (!results[i].op_timings.empty()) {
+            if (!csv_output) {
+                std::cout << RunNames[i] << " op times:\n";
+            }
+            std::cout << results[i].op_timings;
+        }
+    }
 }
 
 }  // namespace hannk
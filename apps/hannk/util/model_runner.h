@@ -106,10 +106,13 @@ struct ModelRunner {
     bool do_benchmark = true;
     bool do_compare_results = true;
     bool keep_going = false;
+    bool parallel_ops = false;
+    bool profile_ops = false;
     double tolerance;
     bool csv_output = false;
     int run_count = 0;
     std::string external_delegate_path;
+    std::string prepared_cache_path;
     std::vector<WhichRun> active_runs;
 
     ModelRunner();
@@ -132,6 +135,8 @@ private:
     struct RunResult {
         std::vector<HalideBuffer<const void>> outputs;
         std::chrono::duration<double> time{0};
+        // The per-op timings of the benchmark, if profile_ops is set.
+        std::string op_timings;
     };
     RunResult run_in_hannk(const std::vector<char> &buffer);
 #if HANNK_BUILD_TFLITE
@@ -82,13 +82,12 @@ public:
             output
                 .tile(x, y, tx, ty, x, y, tile_width, tile_height, TailStrategy::RoundUp);
 
+            // Overlap the DMA transfer of each tile with the processing
+            // of the previous one, in locked L2 cache.
             input_copy
                 .copy_to_host()
-                .async()
-                .compute_at(output, tx)
-                .store_at(output, ty)
-                .reorder_storage(c, x, y)
-                .fold_storage(x, tile_width * 2);
+                .double_buffer(output, tx, ty, x, tile_width, MemoryType::LockedCache)
+                .reorder_storage(c, x, y);
             break;
         case Schedule::Split: {
             Var yo, yi;
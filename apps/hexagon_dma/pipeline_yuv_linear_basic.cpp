@@ -122,20 +122,16 @@ public:
             output_uv
                 .tile(x, y, tx, ty, x, y, tile_width, tile_height, TailStrategy::RoundUp);
 
+            // Overlap the DMA transfer of each tile with the processing
+            // of the previous one, in locked L2 cache.
             input_y_copy
                 .copy_to_host()
-                .async()
-                .compute_at(output_y, tx)
-                .store_at(output_y, ty)
-                .fold_storage(x, tile_width * 2);
+                .double_buffer(output_y, tx, ty, x, tile_width, MemoryType::LockedCache);
 
             input_uv_copy
                 .copy_to_host()
-                .async()
-                .compute_at(output_uv, tx)
-                .store_at(output_uv, ty)
-                .reorder_storage(c, x, y)
-                .fold_storage(x, tile_width * 2);
+                .double_buffer(output_uv, tx, ty, x, tile_width, MemoryType::LockedCache)
+                .reorder_storage(c, x, y);
             break;
         case Schedule::Split: {
             Var yo, yi;
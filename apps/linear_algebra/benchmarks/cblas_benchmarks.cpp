@@ -7,7 +7,7 @@
 // Accepted values for subroutine are:
 //    L1: scal, copy, axpy, dot, nrm2
 //    L2: gemv_notrans, gemv_trans
-//    L3: gemm_notrans, gemm_transA, gemm_transB, gemm_transAB
+//    L3: gemm_notrans, gemm_transA, gemm_transB, gemm_transAB, gemm_batched
 //
 
 #include "cblas.h"
@@ -27,6 +27,7 @@ struct BenchmarksBase {
     typedef T Scalar;
     typedef std::vector<T> Vector;
     typedef std::vector<T> Matrix;
+    typedef std::vector<T> MatrixBatch;
 
     std::random_device rand_dev;
     std::default_random_engine rand_eng{rand_dev()};
@@ -54,6 +55,10 @@ struct BenchmarksBase {
         return buff;
     }
 
+    MatrixBatch random_matrix_batch(int N, int batch) {
+        return random_vector(N * N * batch);
+    }
+
     BenchmarksBase(std::string n)
         : name(n) {
     }
@@ -83,6 +88,8 @@ struct BenchmarksBase {
             this->bench_gemm_transB(size);
         } else if (benchmark == "gemm_transAB") {
             this->bench_gemm_transAB(size);
+        } else if (benchmark == "gemm_batched") {
+            this->bench_gemm_batched(size);
         }
     }
 
@@ -98,6 +105,7 @@ struct BenchmarksBase {
     virtual void bench_gemm_transA(int N) = 0;
     virtual void bench_gemm_transB(int N) = 0;
     virtual void bench_gemm_transAB(int N) = 0;
+    virtual void bench_gemm_batched(int N) = 0;
 };
 
 struct BenchmarksFloat : public BenchmarksBase<float> {
@@ -126,6 +134,8 @@ struct BenchmarksFloat : public BenchmarksBase<float> {
     L3Benchmark(gemm_transB, "s", cblas_sgemm(CblasColMajor, CblasNoTrans, CblasTrans, N, N, N, alpha, &(A[0]), N, &(B[0]), N, beta, &(C[0]), N));
 
     L3Benchmark(gemm_transAB, "s", cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, &(A[0]), N, &(B[0]), N, beta, &(C[0]), N));
+
+    L3BatchedBenchmark(gemm_batched, "s", for (int i = 0; i < batch; i++) cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N, alpha, &(A[i * N * N]), N, &(B[i * N * N]), N, beta, &(C[i * N * N]), N));
 };
 
 struct BenchmarksDouble : public BenchmarksBase<double> {
@@ -154,6 +164,8 @@ struct BenchmarksDouble : public BenchmarksBase<double> {
     L3Benchmark(gemm_transB, "d", cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, N, N, N, alpha, &(A[0]), N, &(B[0]), N, beta, &(C[0]), N));
 
     L3Benchmark(gemm_transAB, "d", cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, &(A[0]), N, &(B[0]), N, beta, &(C[0]), N));
+
+    L3BatchedBenchmark(gemm_batched, "d", for (int i = 0; i < batch; i++) cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N, alpha, &(A[i * N * N]), N, &(B[i * N * N]), N, beta, &(C[i * N * N]), N));
 };
 
 int main(int argc, char *argv[]) {
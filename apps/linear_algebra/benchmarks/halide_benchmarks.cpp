@@ -7,7 +7,7 @@
 // Accepted values for subroutine are:
 //    L1: scal, copy, axpy, dot, nrm2
 //    L2: gemv_notrans, gemv_trans
-//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB
+//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB, gemm_batched
 //
 
 #include "HalideBuffer.h"
@@ -24,6 +24,7 @@ struct BenchmarksBase {
     typedef T Scalar;
     typedef Halide::Runtime::Buffer<T, 1> Vector;
     typedef Halide::Runtime::Buffer<T, 2> Matrix;
+    typedef Halide::Runtime::Buffer<T, 3> MatrixBatch;
 
     std::random_device rand_dev;
     std::default_random_engine rand_eng{rand_dev()};
@@ -53,6 +54,15 @@ struct BenchmarksBase {
         return buff;
     }
 
+    MatrixBatch random_matrix_batch(int N, int batch) {
+        MatrixBatch buff(N, N, batch);
+        Scalar *A = (Scalar *)buff.data();
+        for (int i = 0; i < N * N * batch; ++i) {
+            A[i] = random_scalar();
+        }
+        return buff;
+    }
+
     BenchmarksBase(std::string n)
         : name(n) {
     }
@@ -82,6 +92,8 @@ struct BenchmarksBase {
             bench_gemm_transB(size);
         } else if (benchmark == "gemm_transAB") {
             bench_gemm_transAB(size);
+        } else if (benchmark == "gemm_batched") {
+            bench_gemm_batched(size);
         }
     }
 
@@ -97,6 +109,7 @@ struct BenchmarksBase {
     virtual void bench_gemm_transA(int N) = 0;
     virtual void bench_gemm_transB(int N) = 0;
     virtual void bench_gemm_transAB(int N) = 0;
+    virtual void bench_gemm_batched(int N) = 0;
 };
 
 struct BenchmarksFloat : public BenchmarksBase<float> {
@@ -126,6 +139,8 @@ struct BenchmarksFloat : public BenchmarksBase<float> {
     L3Benchmark(gemm_transB, "s", halide_sgemm(false, true, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
 
     L3Benchmark(gemm_transAB, "s", halide_sgemm(true, true, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
+
+    L3BatchedBenchmark(gemm_batched, "s", halide_sgemm_batched(false, false, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
 };
 
 struct BenchmarksDouble : public BenchmarksBase<double> {
@@ -155,6 +170,8 @@ struct BenchmarksDouble : public BenchmarksBase<double> {
     L3Benchmark(gemm_transB, "d", halide_dgemm(false, true, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
 
     L3Benchmark(gemm_transAB, "d", halide_dgemm(true, true, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
+
+    L3BatchedBenchmark(gemm_batched, "d", halide_dgemm_batched(false, false, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
 };
 
 int main(int argc, char *argv[]) {
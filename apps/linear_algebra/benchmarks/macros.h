@@ -121,3 +121,25 @@ inline void set_math_flags() {
             << std::setw(20) << L3GFLOPS(N)             \
             << "\n";                                    \
     }
+
+// Batched benchmarks compute this many independent products per call.
+#define L3_BATCH_SIZE 256
+#define L3BatchedBenchmark(benchmark, type, code)       \
+    virtual void bench_##benchmark(int N) override {    \
+        const int batch = L3_BATCH_SIZE;                \
+        Scalar alpha = random_scalar();                 \
+        Scalar beta = random_scalar();                  \
+        MatrixBatch A(random_matrix_batch(N, batch));   \
+        MatrixBatch B(random_matrix_batch(N, batch));   \
+        MatrixBatch C(random_matrix_batch(N, batch));   \
+                                                        \
+        time_it(code)                                   \
+                                                        \
+                std::cout                               \
+            << std::setw(8) << name                     \
+            << std::setw(15) << type << #benchmark      \
+            << std::setw(8) << std::to_string(N)        \
+            << std::setw(20) << std::to_string(elapsed) \
+            << std::setw(20) << L3GFLOPS(N) * batch     \
+            << "\n";                                    \
+    }
@@ -172,7 +172,114 @@ public:
     }
 };
 
+// Generator class for batched BLAS gemm operations, computing one
+// independent matrix product per element of dimension 2 of the
+// inputs. This is meant for many small or medium sized products, so
+// it parallelizes across the batch rather than within each product.
+// Strided batches are handled by the stride of dimension 2.
+template<class T>
+class BatchedGEMMGenerator : public Generator<BatchedGEMMGenerator<T>> {
+public:
+    typedef Generator<BatchedGEMMGenerator<T>> Base;
+    using Base::get_target;
+    using Base::natural_vector_size;
+    using Base::target;
+    template<typename T2>
+    using Input = typename Base::template Input<T2>;
+    template<typename T2>
+    using Output = typename Base::template Output<T2>;
+
+    GeneratorParam<bool> transpose_A_{"transpose_A", false};
+    GeneratorParam<bool> transpose_B_{"transpose_B", false};
+
+    // Standard ordering of parameters in GEMM functions.
+    Input<T> a_{"a_", 1};
+    Input<Buffer<T, 3>> A_{"A_"};
+    Input<Buffer<T, 3>> B_{"B_"};
+    Input<T> b_{"b_", 1};
+    Input<Buffer<T, 3>> C_{"C_"};
+
+    Output<Buffer<T, 3>> result_{"result"};
+
+    void generate() {
+        // Matrices are interpreted as column-major by default. The
+        // transpose GeneratorParams are used to handle cases where
+        // one or both is actually row major.
+        const Expr num_rows = transpose_A_ ? A_.height() : A_.width();
+        const Expr num_cols = transpose_B_ ? B_.width() : B_.height();
+        const Expr sum_size = transpose_A_ ? A_.width() : A_.height();
+        const Expr num_batches = A_.dim(2).extent();
+
+        // The micro-kernel computes an s x kn block of the result
+        // in registers.
+        const int vec = std::max(4, natural_vector_size(a_.type()));
+        const int s = vec * 2;
+        const int kn = 4;
+
+        Var i, j, k, b, ii, io, ji, jo;
+
+        // Pack A into panels of s rows and B into panels of kn
+        // columns, so the micro-kernel reads both of them with dense
+        // loads regardless of the layout of the inputs. The padding
+        // at the edges of the panels is zero.
+        Func A = BoundaryConditions::constant_exterior(A_, cast<T>(0), {{0, A_.width()}, {0, A_.height()}});
+        Func B = BoundaryConditions::constant_exterior(B_, cast<T>(0), {{0, B_.width()}, {0, B_.height()}});
+
+        Func Ap("Ap"), Bp("Bp");
+        if (transpose_A_) {
+            Ap(ii, k, io, b) = A(k, io * s + ii, b);
+        } else {
+            Ap(ii, k, io, b) = A(io * s + ii, k, b);
+        }
+        if (transpose_B_) {
+            Bp(ji, k, jo, b) = B(jo * kn + ji, k, b);
+        } else {
+            Bp(ji, k, jo, b) = B(k, jo * kn + ji, b);
+        }
+
+        Func AB("AB");
+        RDom rv(0, sum_size);
+        AB(i, j, b) += Ap(i % s, rv, i / s, b) * Bp(j % kn, rv, j / kn, b);
+
+        // Do the part that makes it a 'general' matrix multiply.
+        result_(i, j, b) = (a_ * AB(i, j, b) + b_ * C_(i, j, b));
+
+        result_
+            .tile(i, j, ii, ji, s, kn, TailStrategy::GuardWithIf)
+            .vectorize(ii)
+            .unroll(ji)
+            .parallel(b);
+
+        result_.bound(i, 0, num_rows).bound(j, 0, num_cols);
+
+        Ap.compute_at(result_, b)
+            .vectorize(ii);
+        Bp.compute_at(result_, b)
+            .vectorize(ji);
+
+        AB.compute_at(result_, i)
+            .bound_extent(j, kn)
+            .unroll(j)
+            .bound_extent(i, s)
+            .vectorize(i)
+            .update()
+            .reorder(i, j, rv)
+            .unroll(j)
+            .unroll(rv, 2)
+            .vectorize(i);
+
+        A_.dim(0).set_min(0).dim(1).set_min(0).dim(2).set_min(0);
+        B_.dim(0).set_min(0).dim(1).set_min(0).dim(2).set_bounds(0, num_batches);
+        C_.dim(0).set_bounds(0, num_rows);
+        C_.dim(1).set_bounds(0, num_cols);
+        C_.dim(2).set_bounds(0, num_batches);
+        result_.dim(0).set_bounds(0, num_rows).dim(1).set_bounds(0, num_cols).dim(2).set_bounds(0, num_batches);
+    }
+};
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<float>, sgemm)
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<double>, dgemm)
+HALIDE_REGISTER_GENERATOR(BatchedGEMMGenerator<float>, sgemm_batched)
+HALIDE_REGISTER_GENERATOR(BatchedGEMMGenerator<double>, dgemm_batched)
@@ -31,6 +31,13 @@ Buffer<T, 2> init_matrix_buffer(const int M, const int N, T *A, const int lda) {
     return Buffer<T, 2>(A, 2, shape);
 }
 
+template<typename T>
+Buffer<T, 3> init_matrix_batch_buffer(const int M, const int N, T *A, const int lda,
+                                      const int stride, const int batch_count) {
+    halide_dimension_t shape[] = {{0, M, 1}, {0, N, lda}, {0, batch_count, stride}};
+    return Buffer<T, 3>(A, 3, shape);
+}
+
 }  // namespace
 
 #ifdef __cplusplus
@@ -291,6 +298,76 @@ void hblas_dgemm(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA
     assert_no_error(halide_dgemm(tA, tB, alpha, buff_A, buff_B, beta, buff_C));
 }
 
+void hblas_sgemm_strided_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                                 const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                                 const int K, const float alpha, const float *A,
+                                 const int lda, const int strideA, const float *B,
+                                 const int ldb, const int strideB, const float beta,
+                                 float *C, const int ldc, const int strideC,
+                                 const int batch_count) {
+    bool tA = false, tB = false;
+    switch (TransA) {
+    case HblasNoTrans:
+        tA = false;
+        break;
+    case HblasConjTrans:
+    case HblasTrans:
+        tA = true;
+        break;
+    };
+
+    switch (TransB) {
+    case HblasNoTrans:
+        tB = false;
+        break;
+    case HblasConjTrans:
+    case HblasTrans:
+        tB = true;
+        break;
+    };
+
+    auto buff_A = init_matrix_batch_buffer(tA ? K : M, tA ? M : K, const_cast<float *>(A), lda, strideA, batch_count);
+    auto buff_B = init_matrix_batch_buffer(tB ? N : K, tB ? K : N, const_cast<float *>(B), ldb, strideB, batch_count);
+    auto buff_C = init_matrix_batch_buffer(M, N, C, ldc, strideC, batch_count);
+
+    assert_no_error(halide_sgemm_batched(tA, tB, alpha, buff_A, buff_B, beta, buff_C));
+}
+
+void hblas_dgemm_strided_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                                 const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                                 const int K, const double alpha, const double *A,
+                                 const int lda, const int strideA, const double *B,
+                                 const int ldb, const int strideB, const double beta,
+                                 double *C, const int ldc, const int strideC,
+                                 const int batch_count) {
+    bool tA = false, tB = false;
+    switch (TransA) {
+    case HblasNoTrans:
+        tA = false;
+        break;
+    case HblasConjTrans:
+    case HblasTrans:
+        tA = true;
+        break;
+    };
+
+    switch (TransB) {
+    case HblasNoTrans:
+        tB = false;
+        break;
+    case HblasConjTrans:
+    case HblasTrans:
+        tB = true;
+        break;
+    };
+
+    auto buff_A = init_matrix_batch_buffer(tA ? K : M, tA ? M : K, const_cast<double *>(A), lda, strideA, batch_count);
+    auto buff_B = init_matrix_batch_buffer(tB ? N : K, tB ? K : N, const_cast<double *>(B), ldb, strideB, batch_count);
+    auto buff_C = init_matrix_batch_buffer(M, N, C, ldc, strideC, batch_count);
+
+    assert_no_error(halide_dgemm_batched(tA, tB, alpha, buff_A, buff_B, beta, buff_C));
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -8,6 +8,10 @@
 #include "halide_daxpy_impl.h"
 #include "halide_dcopy_impl.h"
 #include "halide_ddot.h"
+#include "halide_dgemm_batched_notrans.h"
+#include "halide_dgemm_batched_transA.h"
+#include "halide_dgemm_batched_transAB.h"
+#include "halide_dgemm_batched_transB.h"
 #include "halide_dgemm_notrans.h"
 #include "halide_dgemm_transA.h"
 #include "halide_dgemm_transAB.h"
@@ -20,6 +24,10 @@
 #include "halide_saxpy_impl.h"
 #include "halide_scopy_impl.h"
 #include "halide_sdot.h"
+#include "halide_sgemm_batched_notrans.h"
+#include "halide_sgemm_batched_transA.h"
+#include "halide_sgemm_batched_transAB.h"
+#include "halide_sgemm_batched_transB.h"
 #include "halide_sgemm_notrans.h"
 #include "halide_sgemm_transA.h"
 #include "halide_sgemm_transAB.h"
@@ -103,6 +111,32 @@ inline int halide_dgemm(bool transA, bool transB, double a, halide_buffer_t *A,
     return -1;
 }
 
+inline int halide_sgemm_batched(bool transA, bool transB, float a, halide_buffer_t *A, halide_buffer_t *B, float b, halide_buffer_t *C) {
+    if (transA && transB) {
+        return halide_sgemm_batched_transAB(a, A, B, b, C, C);
+    } else if (transA) {
+        return halide_sgemm_batched_transA(a, A, B, b, C, C);
+    } else if (transB) {
+        return halide_sgemm_batched_transB(a, A, B, b, C, C);
+    } else {
+        return halide_sgemm_batched_notrans(a, A, B, b, C, C);
+    }
+    return -1;
+}
+
+inline int halide_dgemm_batched(bool transA, bool transB, double a, halide_buffer_t *A, halide_buffer_t *B, double b, halide_buffer_t *C) {
+    if (transA && transB) {
+        return halide_dgemm_batched_transAB(a, A, B, b, C, C);
+    } else if (transA) {
+        return halide_dgemm_batched_transA(a, A, B, b, C, C);
+    } else if (transB) {
+        return halide_dgemm_batched_transB(a, A, B, b, C, C);
+    } else {
+        return halide_dgemm_batched_notrans(a, A, B, b, C, C);
+    }
+    return -1;
+}
+
 enum HBLAS_ORDER { HblasRowMajor = 101,
                    HblasColMajor = 102 };
 enum HBLAS_TRANSPOSE { HblasNoTrans = 111,
@@ -246,6 +280,26 @@ void hblas_dgemm(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA
                  const int lda, const double *B, const int ldb,
                  const double beta, double *C, const int ldc);
 
+/*
+ * Computes batch_count independent gemms, where the i-th matrices start at
+ * A + i * strideA, B + i * strideB and C + i * strideC.
+ */
+void hblas_sgemm_strided_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                                 const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                                 const int K, const float alpha, const float *A,
+                                 const int lda, const int strideA, const float *B,
+                                 const int ldb, const int strideB, const float beta,
+                                 float *C, const int ldc, const int strideC,
+                                 const int batch_count);
+
+void hblas_dgemm_strided_batched(const enum HBLAS_ORDER Order, const enum HBLAS_TRANSPOSE TransA,
+                                 const enum HBLAS_TRANSPOSE TransB, const int M, const int N,
+                                 const int K, const double alpha, const double *A,
+                                 const int lda, const int strideA, const double *B,
+                                 const int ldb, const int strideB, const double beta,
+                                 double *C, const int ldc, const int strideC,
+                                 const int batch_count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -113,6 +113,35 @@
         return compareMatrices(N, eC, aC);      \
     }
 
+#define L3_BATCHED_TEST(method, cblas_code, hblas_code) \
+    bool test_##method(int N) {                         \
+        const int batch = 4;                            \
+        Scalar alpha = random_scalar();                 \
+        Scalar beta = random_scalar();                  \
+        Matrix eA(random_vector(N * N * batch));        \
+        Matrix eB(random_vector(N * N * batch));        \
+        Matrix eC(random_vector(N * N * batch));        \
+        Matrix aA(eA), aB(eB), aC(eC);                  \
+                                                        \
+        {                                               \
+            Scalar *A = &(eA[0]);                       \
+            Scalar *B = &(eB[0]);                       \
+            Scalar *C = &(eC[0]);                       \
+            for (int i = 0; i < batch; i++) {           \
+                cblas_code;                             \
+            }                                           \
+        }                                               \
+                                                        \
+        {                                               \
+            Scalar *A = &(aA[0]);                       \
+            Scalar *B = &(aB[0]);                       \
+            Scalar *C = &(aC[0]);                       \
+            hblas_code;                                 \
+        }                                               \
+                                                        \
+        return compareVectors(N * N * batch, eC, aC);   \
+    }
+
 template<class T>
 struct BLASTestBase {
     typedef T Scalar;
@@ -213,6 +242,10 @@ struct BLASFloatTests : public BLASTestBase<float> {
         RUN_TEST(sgemm_transA);
         RUN_TEST(sgemm_transB);
         RUN_TEST(sgemm_transAB);
+        RUN_TEST(sgemm_batched_notrans);
+        RUN_TEST(sgemm_batched_transA);
+        RUN_TEST(sgemm_batched_transB);
+        RUN_TEST(sgemm_batched_transAB);
     }
 
     L1_VECTOR_TEST(scopy, scopy(N, x, 1, y, 1))
@@ -244,6 +277,18 @@ struct BLASFloatTests : public BLASTestBase<float> {
     L3_TEST(sgemm_transAB,
             cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_sgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+    L3_BATCHED_TEST(sgemm_batched_notrans,
+                    cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N, alpha, A + i * N * N, N, B + i * N * N, N, beta, C + i * N * N, N),
+                    hblas_sgemm_strided_batched(HblasColMajor, HblasNoTrans, HblasNoTrans, N, N, N, alpha, A, N, N * N, B, N, N * N, beta, C, N, N * N, batch));
+    L3_BATCHED_TEST(sgemm_batched_transA,
+                    cblas_sgemm(CblasColMajor, CblasTrans, CblasNoTrans, N, N, N, alpha, A + i * N * N, N, B + i * N * N, N, beta, C + i * N * N, N),
+                    hblas_sgemm_strided_batched(HblasColMajor, HblasTrans, HblasNoTrans, N, N, N, alpha, A, N, N * N, B, N, N * N, beta, C, N, N * N, batch));
+    L3_BATCHED_TEST(sgemm_batched_transB,
+                    cblas_sgemm(CblasColMajor, CblasNoTrans, CblasTrans, N, N, N, alpha, A + i * N * N, N, B + i * N * N, N, beta, C + i * N * N, N),
+                    hblas_sgemm_strided_batched(HblasColMajor, HblasNoTrans, HblasTrans, N, N, N, alpha, A, N, N * N, B, N, N * N, beta, C, N, N * N, batch));
+    L3_BATCHED_TEST(sgemm_batched_transAB,
+                    cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A + i * N * N, N, B + i * N * N, N, beta, C + i * N * N, N),
+                    hblas_sgemm_strided_batched(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, N * N, B, N, N * N, beta, C, N, N * N, batch));
 };
 
 struct BLASDoubleTests : public BLASTestBase<double> {
@@ -260,6 +305,10 @@ struct BLASDoubleTests : public BLASTestBase<double> {
         RUN_TEST(dgemm_transA);
         RUN_TEST(dgemm_transB);
         RUN_TEST(dgemm_transAB);
+        RUN_TEST(dgemm_batched_notrans);
+        RUN_TEST(dgemm_batched_transA);
+        RUN_TEST(dgemm_batched_transB);
+        RUN_TEST(dgemm_batched_transAB);
     }
 
     L1_VECTOR_TEST(dcopy, dcopy(N, x, 1, y, 1))
@@ -291,6 +340,18 @@ struct BLASDoubleTests : public BLASTestBase<double> {
     L3_TEST(dgemm_transAB,
             cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N),
             hblas_dgemm(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, B, N, beta, C, N));
+    L3_BATCHED_TEST(dgemm_batched_notrans,
+                    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N, alpha, A + i * N * N, N, B + i * N * N, N, beta, C + i * N * N, N),
+                    hblas_dgemm_strided_batched(HblasColMajor, HblasNoTrans, HblasNoTrans, N, N, N, alpha, A, N, N * N, B, N, N * N, beta, C, N, N * N, batch));
+    L3_BATCHED_TEST(dgemm_batched_transA,
+                    cblas_dgemm(CblasColMajor, CblasTrans, CblasNoTrans, N, N, N, alpha, A + i * N * N, N, B + i * N * N, N, beta, C + i * N * N, N),
+                    hblas_dgemm_strided_batched(HblasColMajor, HblasTrans, HblasNoTrans, N, N, N, alpha, A, N, N * N, B, N, N * N, beta, C, N, N * N, batch));
+    L3_BATCHED_TEST(dgemm_batched_transB,
+                    cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, N, N, N, alpha, A + i * N * N, N, B + i * N * N, N, beta, C + i * N * N, N),
+                    hblas_dgemm_strided_batched(HblasColMajor, HblasNoTrans, HblasTrans, N, N, N, alpha, A, N, N * N, B, N, N * N, beta, C, N, N * N, batch));
+    L3_BATCHED_TEST(dgemm_batched_transAB,
+                    cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, A + i * N * N, N, B + i * N * N, N, beta, C + i * N * N, N),
+                    hblas_dgemm_strided_batched(HblasColMajor, HblasTrans, HblasTrans, N, N, N, alpha, A, N, N * N, B, N, N * N, beta, C, N, N * N, batch));
 };
 
 int main(int argc, char *argv[]) {
@@ -8,6 +8,7 @@ import signal
 import base64
 import hashlib
 import datetime
+import os
 
 
 class HalideBackend(BackendBase):
@@ -34,13 +35,25 @@ class HalideBackend(BackendBase):
         Builds and returns an internal representation of the model (which
         includes the actual Halide pipeline).
 
+        The whole graph is converted into a single Halide pipeline, and
+        nontrivial models are autoscheduled as a unit. If a cache directory is given (or set with
+        the HALIDE_ONNX_CACHE_DIR environment variable), the schedule and the
+        compiled code are stored there and reused by later sessions that
+        prepare the same model.
+
         :param model: The ONNX model to be converted.
         :param device: The device to execute this model on (Ignored for now).
+        :param cache_dir: Optional directory in which to cache compiled models.
         :returns: An internal object that can be used to run the model with
                   Halide.
         """
         onnx.checker.check_model(model)
 
+        cache_dir = kwargs.get('cache_dir',
+                               os.environ.get('HALIDE_ONNX_CACHE_DIR', ''))
+        if cache_dir:
+            halide_model.model_cpp.SetCacheDir(cache_dir)
+
         prepared = halide_model.Model()
         prepared.BuildFromOnnxModel(model)
         # Optimize the schedule of nontrivial models to make sure they
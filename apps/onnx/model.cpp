@@ -62,13 +62,29 @@ HalideModel convert_onnx_model(
     return result;
 }
 
-std::string auto_schedule(const HalideModel &pipeline) {
-    // Generate a schedule for the pipeline.
+std::string auto_schedule(
+    const HalideModel &pipeline,
+    const std::string &autoscheduler) {
+    // Generate a schedule for the whole model at once, so that the
+    // autoscheduler can fuse across the nodes of the graph.
     Halide::Target tgt = Halide::get_host_target();
-    auto schedule = pipeline.rep->auto_schedule(tgt);
+    auto schedule = pipeline.rep->apply_autoscheduler(
+        tgt, Halide::AutoschedulerParams(autoscheduler));
     return schedule.schedule_source;
 }
 
+void set_cache_dir(const std::string &dir) {
+    // Both the JIT cache and the schedule database are keyed by hashes of
+    // their contents, so a model that was already prepared in an earlier
+    // session skips autoscheduling and code generation.
+    Halide::Internal::JITSharedRuntime::set_jit_cache_dir(dir);
+    if (dir.empty()) {
+        unsetenv("HL_SCHEDULE_DATABASE_DIR");
+    } else {
+        setenv("HL_SCHEDULE_DATABASE_DIR", dir.c_str(), 1);
+    }
+}
+
 template<typename T>
 struct Distribution {
     typedef typename std::conditional<
@@ -555,7 +571,17 @@ PYBIND11_MODULE(model_cpp, m) {
     m.def(
         "AutoSchedule",
         &auto_schedule,
+        py::arg("pipeline"),
+        py::arg("autoscheduler") = "Mullapudi2016",
         "A function to automatic schedule HalideModel.");
+    m.def(
+        "LoadPlugin",
+        &Halide::load_plugin,
+        "Load a plugin, such as an autoscheduler.");
+    m.def(
+        "SetCacheDir",
+        &set_cache_dir,
+        "Cache compiled code and schedules in the given directory.");
     m.def("Run", &run, "A function to JIT compile and run HalideModel.");
     m.def("Benchmark", &benchmark, "A function to benchmark the model");
     m.def("Compile", &compile, "Compile the pipeline");
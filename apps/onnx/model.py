@@ -2,6 +2,8 @@ import model_cpp
 
 
 class Model():
+    _loaded_plugins = set()
+
     def __init__(self):
         self.pipeline = None
 
@@ -24,10 +26,14 @@ class Model():
             self.pipeline = model_cpp.ConvertOnnxModel(model_str,
                 expected_dim_sizes, layout)
 
-    def OptimizeSchedule(self):
+    def OptimizeSchedule(self, autoscheduler="Mullapudi2016",
+                         plugin="autoschedule_mullapudi2016"):
         if not self.pipeline:
             raise Exception("model not initialized, call BuildFromOnnxModel first")
-        return model_cpp.AutoSchedule(self.pipeline)
+        if plugin and plugin not in Model._loaded_plugins:
+            model_cpp.LoadPlugin(plugin)
+            Model._loaded_plugins.add(plugin)
+        return model_cpp.AutoSchedule(self.pipeline, autoscheduler)
 
     def run(self, inputs, device=''):
         if not self.pipeline:
@@ -15,8 +15,62 @@ static Halide::Expr div_down(Halide::Expr num, int denom) {
 }
 
 namespace {
+// Read the value stored at the given address in a buffer of type t.
+Halide::Expr load_constant(const Halide::Type &t, const void *addr) {
+    if (t.is_bool()) {
+        return Halide::Internal::make_const(t, *static_cast<const bool *>(addr));
+    }
+    if (t.is_float()) {
+        if (t.bits() == 64) {
+            return Halide::Internal::make_const(t, *static_cast<const double *>(addr));
+        } else if (t.bits() == 32) {
+            return Halide::Internal::make_const(t, *static_cast<const float *>(addr));
+        }
+        return Halide::Expr();
+    }
+    switch (t.bits()) {
+    case 8:
+        return t.is_int() ? Halide::Internal::make_const(t, *static_cast<const int8_t *>(addr)) :
+                            Halide::Internal::make_const(t, *static_cast<const uint8_t *>(addr));
+    case 16:
+        return t.is_int() ? Halide::Internal::make_const(t, *static_cast<const int16_t *>(addr)) :
+                            Halide::Internal::make_const(t, *static_cast<const uint16_t *>(addr));
+    case 32:
+        return t.is_int() ? Halide::Internal::make_const(t, *static_cast<const int32_t *>(addr)) :
+                            Halide::Internal::make_const(t, *static_cast<const uint32_t *>(addr));
+    case 64:
+        return t.is_int() ? Halide::Internal::make_const(t, *static_cast<const int64_t *>(addr)) :
+                            Halide::Internal::make_const(t, *static_cast<const uint64_t *>(addr));
+    default:
+        return Halide::Expr();
+    }
+}
+
 class FuncCallInliner : public Halide::Internal::IRMutator {
     Halide::Expr visit(const Halide::Internal::Call *op) override {
+        if (op->call_type == Halide::Internal::Call::Image && op->image.defined()) {
+            // Constant tensors are stored in buffers. Fold loads from them at
+            // constant coordinates, so that shapes can be computed statically
+            // instead of by realizing the shape tensors.
+            std::vector<int> pos(op->args.size());
+            for (size_t i = 0; i < pos.size(); i++) {
+                Halide::Expr arg = Halide::Internal::simplify(mutate(op->args[i]));
+                const int64_t *coord = Halide::Internal::as_const_int(arg);
+                if (!coord) {
+                    return Halide::Internal::IRMutator::visit(op);
+                }
+                pos[i] = static_cast<int>(*coord);
+            }
+            const Halide::Buffer<> &buf = op->image;
+            if (!buf.data() || pos.size() != (size_t)buf.dimensions() || !buf.contains(pos)) {
+                return Halide::Internal::IRMutator::visit(op);
+            }
+            Halide::Expr value = load_constant(buf.type(), buf.raw_buffer()->address_of(pos.data()));
+            if (!value.defined()) {
+                return Halide::Internal::IRMutator::visit(op);
+            }
+            return value;
+        }
         if (op->call_type != Halide::Internal::Call::Halide) {
             return Halide::Internal::IRMutator::visit(op);
         }
@@ -63,6 +117,25 @@ Halide::Expr inline_func_call(Halide::Expr e) {
     return r;
 }
 
+// Try to compute the values of a 1D tensor (typically a shape) at conversion
+// time, without JIT compiling anything. Returns false if they can't be
+// determined statically.
+static bool evaluate_statically(
+    const Tensor &t,
+    int num_values,
+    std::vector<int64_t> *values) {
+    values->clear();
+    for (int i = 0; i < num_values; ++i) {
+        Halide::Expr e = Halide::Internal::simplify(inline_func_call(t.rep(i)));
+        const int64_t *value = Halide::Internal::as_const_int(e);
+        if (!value) {
+            return false;
+        }
+        values->push_back(*value);
+    }
+    return true;
+}
+
 std::string sanitize_name(const std::string &name) {
     std::string result = name;
     assert(!name.empty());
@@ -1437,15 +1510,13 @@ Node convert_tile_node(
     std::vector<Halide::Expr> &output_shape = result.outputs[0].shape;
 
     // Evaluate repeats if possible to compute output_shape.
-    try {
-        Halide::Func tiles = repeats.rep;
-        Halide::Buffer<int64_t> realized_shape = tiles.realize({rank});
+    std::vector<int64_t> tiling_factors;
+    if (evaluate_statically(repeats, rank, &tiling_factors)) {
         for (int i = 0; i < rank; ++i) {
-            int64_t tiling_factor = realized_shape(i);
             output_shape.push_back(
-                input.shape[i] * static_cast<int32_t>(tiling_factor));
+                input.shape[i] * static_cast<int32_t>(tiling_factors[i]));
         }
-    } catch (...) {
+    } else {
         for (int i = 0; i < rank; ++i) {
             output_shape.push_back(input.shape[i] * inline_func_call(repeats.rep(i)));
         }
@@ -3114,13 +3185,12 @@ Node convert_reshape_node(
     // The new_shape tensor is often a constant, so we can use it to determine
     // the actual shape of the output.
     bool new_shape_known = false;
-    try {
-        Halide::Func mutable_func = new_shape.rep;
-        Halide::Buffer<int64_t> realized_shape = mutable_func.realize({output_rank});
+    std::vector<int64_t> static_shape;
+    if (evaluate_statically(new_shape, output_rank, &static_shape)) {
         int unknown_dim = -1;
         int64_t known_size = 1;
         for (int i = 0; i < output_rank; ++i) {
-            int dim = realized_shape(i);
+            int dim = static_shape[i];
             if (dim == -1) {
                 unknown_dim = i;
                 output_shape.push_back(Halide::Expr());
@@ -3136,7 +3206,7 @@ Node convert_reshape_node(
                 Halide::Internal::simplify(Halide::cast<int32_t>(dim));
         }
         new_shape_known = true;
-    } catch (...) {
+    } else {
         if (output_rank == 1) {
             // Infer the dim from the number of elements in the input.
             output_shape.push_back(
@@ -414,6 +414,57 @@ static void test_constant_fill() {
     }
 }
 
+static void test_reshape() {
+    onnx::NodeProto shape_node;
+    shape_node.set_name("shape_node");
+    shape_node.set_op_type("Constant");
+    shape_node.add_output("shape");
+    onnx::AttributeProto *attr = shape_node.add_attribute();
+    attr->set_name("value");
+    onnx::TensorProto &value = *attr->mutable_t();
+    value.set_data_type(onnx::TensorProto_DataType_INT64);
+    value.add_dims(2);
+    value.add_int64_data(6);
+    value.add_int64_data(-1);
+    Node shape = convert_node(shape_node, {});
+
+    onnx::NodeProto reshape_node;
+    reshape_node.set_name("reshape_node");
+    reshape_node.set_op_type("Reshape");
+    reshape_node.add_input("x");
+    reshape_node.add_input("shape");
+    reshape_node.add_output("y");
+
+    std::vector<Tensor> node_inputs;
+    node_inputs.resize(2);
+    node_inputs[0].shape = {3, 4};
+    node_inputs[0].type = onnx::TensorProto_DataType_FLOAT;
+    Halide::Buffer<float, 2> input(4, 3);
+    input.for_each_element([&](int x, int y) { input(x, y) = x + 4 * y; });
+    Halide::Var x, y;
+    node_inputs[0].rep(x, y) = input(y, x);
+    node_inputs[1] = shape.outputs[0];
+
+    Node converted = convert_node(reshape_node, node_inputs);
+
+    // The output shape is computed when converting the node.
+    GOOGLE_CHECK_EQ(1, converted.outputs.size());
+    const std::vector<Halide::Expr> &output_shape = converted.outputs[0].shape;
+    GOOGLE_CHECK_EQ(2, output_shape.size());
+    const int64_t *dim0 = Halide::Internal::as_const_int(output_shape[0]);
+    const int64_t *dim1 = Halide::Internal::as_const_int(output_shape[1]);
+    GOOGLE_CHECK(dim0 && dim1);
+    EXPECT_EQ(6, *dim0);
+    EXPECT_EQ(2, *dim1);
+
+    Halide::Buffer<float, 2> output = converted.outputs[0].rep.realize({6, 2});
+    for (int i = 0; i < 6; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            EXPECT_EQ(output(i, j), j + 2 * i);
+        }
+    }
+}
+
 static void test_model() {
     onnx::ModelProto model;
     onnx::ValueInfoProto *input_def = model.mutable_graph()->add_input();
@@ -510,6 +561,7 @@ int main() {
     test_where_broadcast();
     test_concat();
     test_constant_fill();
+    test_reshape();
     test_model();
     printf("Success!\n");
     return 0;
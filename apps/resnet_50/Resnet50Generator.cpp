@@ -28,7 +28,8 @@ int find_index(int value, std::vector<int> vec) {
 
 class Resnet50Generator : public Halide::Generator<Resnet50Generator> {
 public:
-    Input<Buffer<float, 3>> input{"input"};
+    // The input is a batch of images, with the batch in dimension 3.
+    Input<Buffer<float, 4>> input{"input"};
     /** parameter values for scaling layers **/
     Input<Buffer<float, 1>> conv1_gamma{"conv1_gamma"};
     Input<Buffer<float, 1>[4]> br1_gamma { "br1_gamma" };
@@ -63,7 +64,7 @@ public:
 
     Input<Buffer<float, 2>> fc1000_weights{"fc1000_weights"};
     Input<Buffer<float, 1>> fc1000_bias{"fc1000_bias"};
-    Output<Buffer<float, 1>> final_output{"final_output"};
+    Output<Buffer<float, 2>> final_output{"final_output"};
 
     /** list out shapes of each layers weights **/
     // weight shapes: out channels, kernel_w, kernel_h, pad, stride. In channels infered by input tensor shape
@@ -112,7 +113,7 @@ public:
                                      res4x_br2c_ws, res4x_br2c_ws, res4x_br2c_ws, res4x_br2c_ws, res4x_br2c_ws, res4x_br2c_ws,
                                      res5x_br2c_ws, res5x_br2c_ws, res5x_br2c_ws};
 
-    Var c, i, j;
+    Var c, i, j, n;
 
     void generate() {
 
@@ -223,9 +224,9 @@ public:
         relu1.f.compute_root();
         pool1.f.compute_root();
         for (int i = 0; i < 16; i++) {
-            br2a_relu[i].f.compute_root().vectorize(c, 8).parallel(j);
-            br2b_relu[i].f.compute_root().vectorize(c, 8).parallel(j);
-            resunit_relu[i].f.compute_root().vectorize(c, 8).parallel(j);
+            br2a_relu[i].f.compute_root().vectorize(c, 8).parallel(j).parallel(n);
+            br2b_relu[i].f.compute_root().vectorize(c, 8).parallel(j).parallel(n);
+            resunit_relu[i].f.compute_root().vectorize(c, 8).parallel(j).parallel(n);
         }
         pool5.f.compute_root();
         fc1000.f.compute_root();
@@ -261,7 +262,7 @@ private:
         }
         RDom r(0, input.shape[0], 0, weight_shape.w, 0, weight_shape.h);
         Func conv;
-        conv(c, i, j) += weights(c, r.y, r.z, r.x) * padded(r.x, weight_shape.stride * i + r.y - p, weight_shape.stride * j + r.z - p);
+        conv(c, i, j, n) += weights(c, r.y, r.z, r.x) * padded(r.x, weight_shape.stride * i + r.y - p, weight_shape.stride * j + r.z - p, n);
 
         Tensor output;
         output.f = conv;
@@ -270,12 +271,12 @@ private:
         return output;
     }
 
-    // assumes input is 3D (c, w, h) where w and h = 1
+    // assumes input is 4D (c, w, h, n) where w and h = 1
     Tensor fc_layer(const Tensor &input, const WeightShape &weight_shape, const Func &weights, const Func &bias, const std::string &name) {
         RDom r(0, input.shape[0]);
         Func fc;
-        fc(c) = bias(c);
-        fc(c) += weights(c, r.x) * input.f(r.x, 0, 0);
+        fc(c, n) = bias(c);
+        fc(c, n) += weights(c, r.x) * input.f(r.x, 0, 0, n);
 
         Tensor output;
         output.f = fc;
@@ -287,7 +288,7 @@ private:
 
     Tensor relu_layer(const Tensor &input, const std::string &name) {
         Func relu;
-        relu(c, i, j) = max(0.0f, input.f(c, i, j));
+        relu(c, i, j, n) = max(0.0f, input.f(c, i, j, n));
         Tensor output;
         output.f = relu;
         output.shape = input.shape;
@@ -305,7 +306,7 @@ private:
         }
         RDom r(0, weight_shape.w, 0, weight_shape.h);
         Func pool;
-        pool(c, i, j) = maximum(padded(c, weight_shape.stride * i + r.x - p, weight_shape.stride * j + r.y - p));
+        pool(c, i, j, n) = maximum(padded(c, weight_shape.stride * i + r.x - p, weight_shape.stride * j + r.y - p, n));
         Tensor output;
         output.f = pool;
         output.name = name;
@@ -323,10 +324,9 @@ private:
             padded = input.f;
         }
         RDom r(0, weight_shape.w, 0, weight_shape.h);
-        float scale = weight_shape.w * weight_shape.h;
+        float scale = 1.0f / (weight_shape.w * weight_shape.h);
         Func pool;
-        float n = 1.0f / scale;
-        pool(c, i, j) += n * padded(c, weight_shape.stride * i + r.x - p, weight_shape.stride * j + r.y - p);
+        pool(c, i, j, n) += scale * padded(c, weight_shape.stride * i + r.x - p, weight_shape.stride * j + r.y - p, n);
 
         Tensor output;
         output.f = pool;
@@ -338,8 +338,7 @@ private:
 
     Tensor norm_layer(const Tensor &input, const Func &mu, const Func &sigma, const std::string &name) {
         Func normed;
-        Expr e = input.f(c, i, j);
-        normed(c, i, j) = (input.f(c, i, j) - mu(c)) / (sqrt(sigma(c) + 1e-5f));
+        normed(c, i, j, n) = (input.f(c, i, j, n) - mu(c)) / (sqrt(sigma(c) + 1e-5f));
         Tensor output;
         output.f = normed;
         output.shape = input.shape;
@@ -349,7 +348,7 @@ private:
 
     Tensor scale_layer(const Tensor &input, const Func &gamma, const Func &beta, const std::string &name) {
         Func scaled;
-        scaled(c, i, j) = input.f(c, i, j) * gamma(c) + beta(c);
+        scaled(c, i, j, n) = input.f(c, i, j, n) * gamma(c) + beta(c);
         Tensor output;
         output.f = scaled;
         output.shape = input.shape;
@@ -360,7 +359,7 @@ private:
     Tensor sum_layer(const Tensor &t1, const Tensor &t2, const std::string &name) {
         assert(t1.shape == t2.shape);
         Func summed;
-        summed(c, i, j) = t1.f(c, i, j) + t2.f(c, i, j);
+        summed(c, i, j, n) = t1.f(c, i, j, n) + t2.f(c, i, j, n);
         Tensor output;
         output.f = summed;
         output.shape = t1.shape;
@@ -372,9 +371,9 @@ private:
         assert(input.shape[0] == classes);
         RDom r(0, classes);
         Func exp_vals;
-        exp_vals(c) = exp(input.f(c));
+        exp_vals(c, n) = exp(input.f(c, n));
         Func output("output");
-        output(c) = exp_vals(c) / sum(exp_vals(r.x));
+        output(c, n) = exp_vals(c, n) / sum(exp_vals(r.x, n));
         return output;
     }
 };
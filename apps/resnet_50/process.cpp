@@ -96,17 +96,18 @@ Buffer<float, 1> load_fc_bias(std::string shapefile, std::string datafile) {
 }
 
 int main(int argc, char **argv) {
-    if (argc < 3) {
-        printf("Usage: iterations weight_dir seed output_file");
+    if (argc < 5) {
+        printf("Usage: iterations weight_dir seed output_file [batch_size]");
         return -1;
     }
     int iterations = atoi(argv[1]);
     std::string weight_dir = argv[2];
     int seed = atoi(argv[3]);
     std::string output_file = argv[4];
+    int batch_size = argc > 5 ? atoi(argv[5]) : 1;
 
-    Buffer<float, 3> input(3, 224, 224);
-    Buffer<float, 1> output(1000);
+    Buffer<float, 4> input(3, 224, 224, batch_size);
+    Buffer<float, 2> output(1000, batch_size);
 
     Buffer<float, 4> conv1_weights;
     Buffer<float, 1> conv1_mu;
@@ -245,7 +246,7 @@ int main(int argc, char **argv) {
     input.for_each_value([&e2](float &v) {
         v = e2() / (float)e2.max();
     });
-    printf("Running Resnet50 for %d iterations....\n", iterations);
+    printf("Running Resnet50 with batch size %d for %d iterations....\n", batch_size, iterations);
     double best = benchmark(iterations, 1, [&]() {
         resnet50(input,
                  conv1_gamma,
@@ -281,19 +282,22 @@ int main(int argc, char **argv) {
            "This code hasn't been scheduled properly yet so this runtime \n"
            "isn't representative of anything and should not be used as a basis\n"
            "for any comparisons.\n");
-    printf("Execution time : %gms \n", best * 1e3);
+    printf("Execution time : %gms (%gms per image)\n", best * 1e3, best * 1e3 / batch_size);
     printf("**********************************************************************\n");
 
+    // The first image of the batch is the same regardless of the batch
+    // size, so only it is reported and written out for validation.
+    Buffer<float, 1> first_output = output.sliced(1, 0);
     float max_class_val = -FLT_MIN;
     int max_class = 0;
     for (int i = 0; i < 1000; ++i) {
-        if (output(i) > max_class_val) {
-            max_class_val = output(i);
+        if (first_output(i) > max_class_val) {
+            max_class_val = first_output(i);
             max_class = i;
         }
     }
     printf("Class for random data of seed %d is %d\n", seed, max_class);
 
     printf("Writing output layer to %s\n", output_file.c_str());
-    write_buffer_to_file(output, output_file);
+    write_buffer_to_file(first_output, output_file);
 }
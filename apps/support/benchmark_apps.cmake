@@ -0,0 +1,118 @@
+##
+# Runs the apps benchmark suite; invoked by the benchmark_apps target in
+# apps/CMakeLists.txt, which passes:
+#
+#   BENCHMARKS - a file with one "app function WxH[xC] rungen_path" line per
+#                configuration to run
+#   THREADS    - comma-separated Halide thread pool sizes (0 = number of cores)
+#   MIN_TIME   - the RunGen --benchmark_min_time, in seconds
+#   OUTPUT     - the JSON file to write
+#   SOURCE_DIR - the apps source directory, used to find the commit
+#
+# The output is a single JSON object with the commit, the date, and a list of
+# results, one per app, variant, size and thread count. Each result has the
+# RunGen --json_output object under "rungen", or an "error" if the run failed.
+# A failed run doesn't stop the suite, but the script fails at the end.
+##
+
+cmake_minimum_required(VERSION 3.22)
+
+foreach (var IN ITEMS BENCHMARKS THREADS MIN_TIME OUTPUT)
+    if (NOT DEFINED ${var})
+        message(FATAL_ERROR "benchmark_apps.cmake: ${var} must be defined")
+    endif ()
+endforeach ()
+
+function(json_string out str)
+    string(REPLACE "\\" "\\\\" str "${str}")
+    string(REPLACE "\"" "\\\"" str "${str}")
+    string(REPLACE "\n" "\\n" str "${str}")
+    string(REPLACE "\t" "\\t" str "${str}")
+    set(${out} "\"${str}\"" PARENT_SCOPE)
+endfunction()
+
+set(commit "unknown")
+find_package(Git QUIET)
+if (Git_FOUND AND DEFINED SOURCE_DIR)
+    execute_process(COMMAND "${GIT_EXECUTABLE}" rev-parse HEAD
+                    WORKING_DIRECTORY "${SOURCE_DIR}"
+                    OUTPUT_VARIABLE git_commit
+                    OUTPUT_STRIP_TRAILING_WHITESPACE
+                    RESULT_VARIABLE git_result
+                    ERROR_QUIET)
+    if (git_result EQUAL 0)
+        set(commit "${git_commit}")
+    endif ()
+endif ()
+string(TIMESTAMP date "%Y-%m-%dT%H:%M:%SZ" UTC)
+
+string(REPLACE "," ";" THREADS "${THREADS}")
+file(STRINGS "${BENCHMARKS}" benchmarks)
+
+# The results are accumulated as a string rather than a list, since the
+# JSON may contain semicolons.
+set(results "")
+set(separator "")
+set(failures 0)
+foreach (benchmark IN LISTS benchmarks)
+    if (NOT benchmark MATCHES "^([^ ]+) ([^ ]+) ([^ ]+) (.+)$")
+        continue()
+    endif ()
+    set(app "${CMAKE_MATCH_1}")
+    set(function "${CMAKE_MATCH_2}")
+    set(size "${CMAKE_MATCH_3}")
+    set(rungen "${CMAKE_MATCH_4}")
+
+    if (function STREQUAL app)
+        set(variant "manual")
+    else ()
+        set(variant "auto_schedule")
+    endif ()
+    string(REPLACE "x" "," extents "${size}")
+
+    foreach (threads IN LISTS THREADS)
+        if (threads EQUAL 0)
+            set(env --unset=HL_NUM_THREADS)
+        else ()
+            set(env HL_NUM_THREADS=${threads})
+        endif ()
+
+        message(STATUS "Benchmarking ${function} at ${size} with ${threads} threads")
+        execute_process(COMMAND "${CMAKE_COMMAND}" -E env ${env}
+                        "${rungen}"
+                        --name=${function}
+                        --benchmarks=all
+                        --benchmark_min_time=${MIN_TIME}
+                        --default_input_buffers=random:0:auto
+                        --default_input_scalars=estimate,default
+                        --output_extents=[${extents}]
+                        --json_output
+                        --quiet
+                        OUTPUT_VARIABLE rungen_output
+                        ERROR_VARIABLE rungen_error
+                        RESULT_VARIABLE rungen_result
+                        OUTPUT_STRIP_TRAILING_WHITESPACE)
+
+        set(result "{\"app\": \"${app}\", \"variant\": \"${variant}\", \"function\": \"${function}\", \"output_extents\": [${extents}], \"threads\": ${threads}, ")
+        if (rungen_result EQUAL 0)
+            string(APPEND result "\"rungen\": ${rungen_output}}")
+        else ()
+            message(WARNING "${function} at ${size} with ${threads} threads failed:\n${rungen_error}")
+            json_string(error_json "${rungen_error}")
+            string(APPEND result "\"error\": ${error_json}}")
+            math(EXPR failures "${failures} + 1")
+        endif ()
+        string(APPEND results "${separator}${result}")
+        set(separator ",\n    ")
+    endforeach ()
+endforeach ()
+
+json_string(commit_json "${commit}")
+file(WRITE "${OUTPUT}"
+     "{\n  \"schema_version\": 1,\n  \"commit\": ${commit_json},\n  \"date\": \"${date}\",\n"
+     "  \"results\": [\n    ${results}\n  ]\n}\n")
+message(STATUS "Wrote benchmark results to ${OUTPUT}")
+
+if (failures GREATER 0)
+    message(FATAL_ERROR "${failures} benchmark configuration(s) failed")
+endif ()
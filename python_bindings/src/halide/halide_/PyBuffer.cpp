@@ -1,7 +1,22 @@
 #include "PyBuffer.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
 #include <utility>
 
+#ifdef _WIN32
+#ifdef _MSC_VER
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
 #include "PyFunc.h"
 #include "PyType.h"
 
@@ -269,11 +284,170 @@ py::object buffer_setitem_operator(Buffer<> &buf, const std::vector<int> &pos, c
     return py::object();
 }
 
+// The subset of dlpack.h (https://github.com/dmlc/dlpack) needed to
+// exchange tensors with other frameworks (e.g. PyTorch, CuPy, JAX) via
+// __dlpack__(). These are a stable C ABI, so we declare them here rather
+// than depending on the header.
+constexpr int32_t kDLCPU = 1;
+constexpr int32_t kDLCUDA = 2;
+constexpr int32_t kDLCUDAHost = 3;
+constexpr int32_t kDLOpenCL = 4;
+constexpr int32_t kDLMetal = 8;
+
+constexpr uint8_t kDLInt = 0;
+constexpr uint8_t kDLUInt = 1;
+constexpr uint8_t kDLFloat = 2;
+constexpr uint8_t kDLBfloat = 4;
+constexpr uint8_t kDLBool = 6;
+
+struct DLDevice {
+    int32_t device_type;
+    int32_t device_id;
+};
+
+struct DLDataType {
+    uint8_t code;
+    uint8_t bits;
+    uint16_t lanes;
+};
+
+struct DLTensor {
+    void *data;
+    DLDevice device;
+    int32_t ndim;
+    DLDataType dtype;
+    int64_t *shape;
+    int64_t *strides;
+    uint64_t byte_offset;
+};
+
+struct DLManagedTensor {
+    DLTensor dl_tensor;
+    void *manager_ctx;
+    void (*deleter)(DLManagedTensor *self);
+};
+
+// The names of DLPack capsules before and after they are consumed.
+constexpr const char *dltensor_name = "dltensor";
+constexpr const char *used_dltensor_name = "used_dltensor";
+
+Type dlpack_to_type(const DLDataType &dtype) {
+    if (dtype.lanes != 1) {
+        throw py::value_error("Unsupported DLPack type: vector types are not supported.");
+    }
+    const int bits = dtype.bits;
+    const bool valid_bits = bits == 8 || bits == 16 || bits == 32 || bits == 64;
+    if (dtype.code == kDLInt && valid_bits) {
+        return Int(bits);
+    } else if (dtype.code == kDLUInt && valid_bits) {
+        return UInt(bits);
+    } else if (dtype.code == kDLFloat && (bits == 16 || bits == 32 || bits == 64)) {
+        return Float(bits);
+    } else if (dtype.code == kDLBfloat && bits == 16) {
+        return BFloat(bits);
+    } else if (dtype.code == kDLBool && bits == 8) {
+        return Bool();
+    }
+    throw py::value_error("Unsupported DLPack type.");
+    return Type();
+}
+
+DLDataType type_to_dlpack(const Type &type) {
+    if (type.is_bool()) {
+        return {kDLBool, 8, 1};
+    } else if (type.is_int()) {
+        return {kDLInt, (uint8_t)type.bits(), 1};
+    } else if (type.is_uint()) {
+        return {kDLUInt, (uint8_t)type.bits(), 1};
+    } else if (type.is_bfloat()) {
+        return {kDLBfloat, (uint8_t)type.bits(), 1};
+    } else if (type.is_float()) {
+        return {kDLFloat, (uint8_t)type.bits(), 1};
+    }
+    throw py::value_error("Unsupported Buffer<> type.");
+    return DLDataType();
+}
+
+// The DeviceAPI that owns memory on a DLPack device, or Host if the
+// memory can be accessed directly by the host.
+DeviceAPI dlpack_device_api(int32_t device_type) {
+    switch (device_type) {
+    case kDLCPU:
+    case kDLCUDAHost:
+        return DeviceAPI::Host;
+    case kDLCUDA:
+        return DeviceAPI::CUDA;
+    case kDLOpenCL:
+        return DeviceAPI::OpenCL;
+    case kDLMetal:
+        return DeviceAPI::Metal;
+    default:
+        throw py::value_error("Unsupported DLPack device type " + std::to_string(device_type) + ".");
+    }
+    return DeviceAPI::None;
+}
+
+// Make a Buffer<> that uses the memory of a DLPack tensor in place. For
+// tensors in device memory, the Buffer<> has no host allocation, and wraps
+// the device memory with the device interface for it.
+Buffer<> dlpack_to_halidebuffer(const DLTensor &tensor, const Target &target, const std::string &name, bool reverse_axes) {
+    const Type type = dlpack_to_type(tensor.dtype);
+    const int d = tensor.ndim;
+    std::vector<halide_dimension_t> dims(d);
+    // DLPack tensors without strides are compact and row-major.
+    int64_t compact_stride = 1;
+    for (int i = d - 1; i >= 0; i--) {
+        const int64_t extent = tensor.shape[i];
+        const int64_t stride = tensor.strides ? tensor.strides[i] : compact_stride;
+        compact_stride *= extent;
+        if (extent < 0 || extent > INT_MAX || stride < INT_MIN || stride > INT_MAX) {
+            throw py::value_error("Out of range dimensions in buffer conversion.");
+        }
+        // As for numpy, reverse the order so that most-varying comes first.
+        const int dst_axis = reverse_axes ? (d - i - 1) : i;
+        dims[dst_axis] = {0, (int32_t)extent, (int32_t)stride};
+    }
+
+    const DeviceAPI device_api = dlpack_device_api(tensor.device.device_type);
+    if (device_api == DeviceAPI::Host) {
+        Buffer<> b(type, (uint8_t *)tensor.data + tensor.byte_offset, d, dims.data(), name);
+        // As for a py::buffer, assume the host has the latest data.
+        b.set_host_dirty();
+        return b;
+    }
+
+    // Only CUDA device pointers can be offset; the others are handles
+    // to whole allocations.
+    uint64_t handle = (uint64_t)(uintptr_t)tensor.data;
+    if (tensor.byte_offset != 0) {
+        if (device_api != DeviceAPI::CUDA) {
+            throw py::value_error("DLPack tensors with a byte_offset are only supported for CPU and CUDA memory.");
+        }
+        handle += tensor.byte_offset;
+    }
+
+    Target t = to_jit_target(target);
+    if (!t.supports_device_api(device_api)) {
+        t = t.with_feature(target_feature_for_device_api(device_api));
+    }
+    Buffer<> b(type, nullptr, d, dims.data(), name);
+    if (b.device_wrap_native(device_api, handle, t) != halide_error_code_success) {
+        throw py::value_error("Unable to wrap the device memory of a DLPack tensor.");
+    }
+    b.set_device_dirty();
+    return b;
+}
+
 // Use an alias class so that if we are created via a py::buffer, we can
 // keep the py::buffer_info class alive for the life of the Buffer<>,
-// ensuring the data isn't collected out from under us.
+// ensuring the data isn't collected out from under us. Similarly, a
+// Buffer<> created from a DLPack tensor keeps the tensor alive, and calls
+// its deleter when it is destroyed, and one created from an object with a
+// __cuda_array_interface__ keeps that object alive.
 class PyBuffer : public Buffer<> {
     py::buffer_info info;
+    std::shared_ptr<DLManagedTensor> dlpack_tensor;
+    py::object owner;
 
     PyBuffer(py::buffer_info &&info, const std::string &name, bool reverse_axes)
         : Buffer<>(pybufferinfo_to_halidebuffer(info, reverse_axes), name),
@@ -307,9 +481,313 @@ public:
         this->set_host_dirty();
     }
 
+    PyBuffer(std::shared_ptr<DLManagedTensor> tensor, const Target &target, const std::string &name, bool reverse_axes)
+        : Buffer<>(dlpack_to_halidebuffer(tensor->dl_tensor, target, name, reverse_axes)),
+          info(),
+          dlpack_tensor(std::move(tensor)) {
+    }
+
+    PyBuffer(const DLTensor &tensor, py::object owner, const Target &target, const std::string &name, bool reverse_axes)
+        : Buffer<>(dlpack_to_halidebuffer(tensor, target, name, reverse_axes)),
+          info(),
+          owner(std::move(owner)) {
+    }
+
     ~PyBuffer() override = default;
 };
 
+// Make a Buffer<> from an object with a __dlpack__() method, or a DLPack
+// capsule, that shares its memory.
+std::unique_ptr<Buffer<>> buffer_from_dlpack(const py::object &obj, const Target &target, const std::string &name, bool reverse_axes) {
+    py::object capsule;
+    if (py::hasattr(obj, "__dlpack__")) {
+        int32_t device_type = kDLCPU;
+        if (py::hasattr(obj, "__dlpack_device__")) {
+            device_type = obj.attr("__dlpack_device__")().cast<py::tuple>()[0].cast<int32_t>();
+        }
+        if (device_type == kDLCUDA) {
+            // Halide's CUDA runtime uses the legacy default stream, which is
+            // 1 in the protocol; the producer makes its data ready on it.
+            capsule = obj.attr("__dlpack__")(py::arg("stream") = 1);
+        } else {
+            capsule = obj.attr("__dlpack__")();
+        }
+    } else {
+        capsule = obj;
+    }
+
+    if (!PyCapsule_CheckExact(capsule.ptr())) {
+        throw py::type_error("Expected an object with a __dlpack__ method, or a DLPack capsule.");
+    }
+    const char *capsule_name = PyCapsule_GetName(capsule.ptr());
+    if (capsule_name == nullptr || strcmp(capsule_name, dltensor_name) != 0) {
+        throw py::value_error("The DLPack capsule is invalid, or has already been consumed.");
+    }
+    auto *managed = (DLManagedTensor *)PyCapsule_GetPointer(capsule.ptr(), dltensor_name);
+    if (managed == nullptr) {
+        throw py::error_already_set();
+    }
+
+    // We own the tensor now; rename the capsule so it doesn't delete it.
+    std::shared_ptr<DLManagedTensor> tensor(managed, [](DLManagedTensor *t) {
+        if (t->deleter) {
+            t->deleter(t);
+        }
+    });
+    PyCapsule_SetName(capsule.ptr(), used_dltensor_name);
+
+    return std::unique_ptr<Buffer<>>(new PyBuffer(std::move(tensor), target, name, reverse_axes));
+}
+
+// Parse the typestr of a __cuda_array_interface__ (e.g. "<f4"), which is
+// the same as that of a numpy array interface.
+DLDataType cuda_array_typestr_to_dlpack(const std::string &typestr) {
+    if (typestr.size() >= 3 && typestr[0] != '>') {
+        const int bytes = atoi(typestr.c_str() + 2);
+        const uint8_t bits = (uint8_t)(bytes * 8);
+        switch (typestr[1]) {
+        case 'b':
+            if (bytes == 1) {
+                return {kDLBool, 8, 1};
+            }
+            break;
+        case 'i':
+            return {kDLInt, bits, 1};
+        case 'u':
+            return {kDLUInt, bits, 1};
+        case 'f':
+            return {kDLFloat, bits, 1};
+        }
+    }
+    throw py::value_error("Unsupported __cuda_array_interface__ typestr '" + typestr + "'.");
+    return DLDataType();
+}
+
+std::string type_to_cuda_array_typestr(const Type &type) {
+    const std::string bytes = std::to_string(type.bytes());
+    if (type.is_bool()) {
+        return "|b1";
+    } else if (type.is_int()) {
+        return "<i" + bytes;
+    } else if (type.is_uint()) {
+        return "<u" + bytes;
+    } else if (type.is_float() && !type.is_bfloat()) {
+        return "<f" + bytes;
+    }
+    throw py::value_error("Unsupported Buffer<> type for __cuda_array_interface__.");
+    return std::string();
+}
+
+// Wait for the work queued on a CUDA stream to finish. The producer of a
+// __cuda_array_interface__ has loaded the driver already, so we just look
+// up cuStreamSynchronize in it.
+void cuda_stream_synchronize(uintptr_t stream) {
+    using cuStreamSynchronize_t = int (*)(void *);
+#ifdef _WIN32
+    HMODULE lib = GetModuleHandleA("nvcuda.dll");
+    auto sync = lib ? (cuStreamSynchronize_t)GetProcAddress(lib, "cuStreamSynchronize") : nullptr;
+#else
+    void *lib = dlopen("libcuda.so.1", RTLD_LAZY | RTLD_NOLOAD);
+    if (lib == nullptr) {
+        lib = dlopen("libcuda.so", RTLD_LAZY | RTLD_NOLOAD);
+    }
+    auto sync = lib ? (cuStreamSynchronize_t)dlsym(lib, "cuStreamSynchronize") : nullptr;
+#endif
+    if (sync == nullptr) {
+        throw py::value_error("Unable to find the CUDA driver to synchronize with the stream of a __cuda_array_interface__.");
+    }
+    const int result = sync((void *)stream);
+#ifndef _WIN32
+    dlclose(lib);
+#endif
+    if (result != 0) {
+        throw py::value_error("Unable to synchronize with the stream of a __cuda_array_interface__ (CUDA error " + std::to_string(result) + ").");
+    }
+}
+
+// Make a Buffer<> that wraps the CUDA memory of an object with a
+// __cuda_array_interface__ (e.g. a Numba device array or a CuPy array) in
+// place. The interface describes the same thing as a DLPack tensor, so we
+// translate it to one.
+std::unique_ptr<Buffer<>> buffer_from_cuda_array_interface(const py::object &obj, const Target &target, const std::string &name, bool reverse_axes) {
+    if (!py::hasattr(obj, "__cuda_array_interface__")) {
+        throw py::type_error("Expected an object with a __cuda_array_interface__.");
+    }
+    const py::dict iface = obj.attr("__cuda_array_interface__").cast<py::dict>();
+    if (iface.contains("mask") && !iface["mask"].is_none()) {
+        throw py::value_error("Masked arrays are not supported by __cuda_array_interface__ conversion.");
+    }
+
+    DLTensor tensor;
+    tensor.data = (void *)iface["data"].cast<py::tuple>()[0].cast<uintptr_t>();
+    tensor.device = {kDLCUDA, 0};
+    tensor.dtype = cuda_array_typestr_to_dlpack(iface["typestr"].cast<std::string>());
+    std::vector<int64_t> shape = iface["shape"].cast<std::vector<int64_t>>();
+    std::vector<int64_t> strides;
+    tensor.ndim = (int32_t)shape.size();
+    tensor.shape = shape.data();
+    tensor.strides = nullptr;
+    tensor.byte_offset = 0;
+    if (iface.contains("strides") && !iface["strides"].is_none()) {
+        // The strides are in bytes, rather than elements as in DLPack.
+        const int64_t bytes = tensor.dtype.bits / 8;
+        for (int64_t s : iface["strides"].cast<std::vector<int64_t>>()) {
+            if (s % bytes != 0) {
+                throw py::value_error("__cuda_array_interface__ strides must be a multiple of the element size.");
+            }
+            strides.push_back(s / bytes);
+        }
+        if (strides.size() != shape.size()) {
+            throw py::value_error("__cuda_array_interface__ shape and strides must have the same length.");
+        }
+        tensor.strides = strides.data();
+    }
+
+    // A stream of None means the data is ready. Halide's CUDA runtime
+    // uses the legacy default stream (1 in the protocol), which waits for
+    // the work queued on all other blocking streams, so we only need to
+    // synchronize with the per-thread default stream (2) or an explicit
+    // stream handle.
+    if (iface.contains("stream") && !iface["stream"].is_none()) {
+        const uintptr_t stream = iface["stream"].cast<uintptr_t>();
+        if (stream == 0) {
+            throw py::value_error("A __cuda_array_interface__ stream of 0 is disallowed by the protocol.");
+        }
+        if (stream != 1) {
+            py::gil_scoped_release release;
+            cuda_stream_synchronize(stream);
+        }
+    }
+
+    return std::unique_ptr<Buffer<>>(new PyBuffer(tensor, obj, target, name, reverse_axes));
+}
+
+// The DLPack device of the data of a Buffer<>, which is the device for
+// buffers with a CUDA allocation, and the host otherwise.
+DLDevice get_dlpack_device(const Buffer<> &b) {
+    const halide_device_interface_t *interface = b.raw_buffer()->device_interface;
+    if (interface != nullptr && b.has_device_allocation()) {
+        const Target t = get_jit_target_from_environment().with_feature(Target::CUDA);
+        if (interface == get_device_interface_for_device_api(DeviceAPI::CUDA, t)) {
+            // Halide's CUDA runtime uses the device set by HL_GPU_DEVICE
+            // (if any), or the first one.
+            const char *device = getenv("HL_GPU_DEVICE");
+            return {kDLCUDA, device ? std::max(atoi(device), 0) : 0};
+        }
+    }
+    return {kDLCPU, 0};
+}
+
+// The manager_ctx of DLPack tensors made from a Buffer<>, which keeps the
+// Buffer<> alive while the tensor is in use.
+struct DLPackBuffer {
+    Buffer<> buffer;
+    std::vector<int64_t> shape, strides;
+    DLManagedTensor tensor;
+};
+
+void delete_dlpack_buffer(DLManagedTensor *self) {
+    delete (DLPackBuffer *)self->manager_ctx;
+}
+
+void delete_dltensor_capsule(PyObject *capsule) {
+    // If the capsule was consumed, the consumer deletes the tensor.
+    if (PyCapsule_IsValid(capsule, dltensor_name)) {
+        auto *tensor = (DLManagedTensor *)PyCapsule_GetPointer(capsule, dltensor_name);
+        tensor->deleter(tensor);
+    }
+}
+
+// Make a DLPack capsule that shares the memory of a Buffer<>: the device
+// memory of a CUDA buffer, or the host memory otherwise.
+py::capsule buffer_to_dlpack(Buffer<> &b, bool reverse_axes) {
+    const DLDevice device = get_dlpack_device(b);
+    void *data;
+    if (device.device_type == kDLCUDA) {
+        const Target t = get_jit_target_from_environment().with_feature(Target::CUDA);
+        if (b.host_dirty() && b.copy_to_device(DeviceAPI::CUDA, t) != halide_error_code_success) {
+            throw py::value_error("Unable to copy Buffer<> to the device.");
+        }
+        // Make sure any pipelines writing the buffer are done before the
+        // consumer uses it.
+        if (b.device_sync(nullptr) != halide_error_code_success) {
+            throw py::value_error("Unable to synchronize the device of a Buffer<>.");
+        }
+        // The device field of CUDA buffers is the device pointer.
+        data = (void *)(uintptr_t)b.raw_buffer()->device;
+    } else {
+        if (b.device_dirty()) {
+            throw py::value_error("Cannot export a device-dirty Buffer<> with DLPack; call copy_to_host() first.");
+        }
+        if (b.data() == nullptr) {
+            throw py::value_error("Cannot convert a Buffer<> with null host ptr to a DLPack tensor.");
+        }
+        data = b.data();
+    }
+
+    auto ctx = std::make_unique<DLPackBuffer>();
+    ctx->buffer = b;
+    const int d = b.dimensions();
+    ctx->shape.resize(d);
+    ctx->strides.resize(d);
+    for (int i = 0; i < d; i++) {
+        const int dst_axis = reverse_axes ? (d - i - 1) : i;
+        ctx->shape[dst_axis] = b.raw_buffer()->dim[i].extent;
+        ctx->strides[dst_axis] = b.raw_buffer()->dim[i].stride;
+    }
+
+    DLTensor &tensor = ctx->tensor.dl_tensor;
+    tensor.data = data;
+    tensor.device = device;
+    tensor.ndim = d;
+    tensor.dtype = type_to_dlpack(b.type());
+    tensor.shape = ctx->shape.data();
+    tensor.strides = ctx->strides.data();
+    tensor.byte_offset = 0;
+    ctx->tensor.manager_ctx = ctx.get();
+    ctx->tensor.deleter = delete_dlpack_buffer;
+
+    py::capsule capsule(&ctx->tensor, dltensor_name, delete_dltensor_capsule);
+    ctx.release();
+    return capsule;
+}
+
+// The __cuda_array_interface__ (version 3) of a Buffer<> with a CUDA
+// allocation, which shares its device memory. Buffer<>s without one don't
+// have the attribute at all, so that consumers check for it with hasattr.
+py::dict buffer_to_cuda_array_interface(Buffer<> &b) {
+    if (get_dlpack_device(b).device_type != kDLCUDA) {
+        PyErr_SetString(PyExc_AttributeError, "Only Buffer<>s with a CUDA device allocation have a __cuda_array_interface__.");
+        throw py::error_already_set();
+    }
+    const Target t = get_jit_target_from_environment().with_feature(Target::CUDA);
+    if (b.host_dirty() && b.copy_to_device(DeviceAPI::CUDA, t) != halide_error_code_success) {
+        throw py::value_error("Unable to copy Buffer<> to the device.");
+    }
+    // As for DLPack, wait for any pipelines writing the buffer, so that
+    // the data is ready on any stream.
+    if (b.device_sync(nullptr) != halide_error_code_success) {
+        throw py::value_error("Unable to synchronize the device of a Buffer<>.");
+    }
+
+    const int d = b.dimensions();
+    const int bytes = b.type().bytes();
+    py::list shape, strides;
+    for (int i = d - 1; i >= 0; i--) {
+        shape.append(b.raw_buffer()->dim[i].extent);
+        strides.append((int64_t)b.raw_buffer()->dim[i].stride * bytes);
+    }
+
+    py::dict iface;
+    iface["shape"] = py::tuple(shape);
+    iface["typestr"] = type_to_cuda_array_typestr(b.type());
+    iface["data"] = py::make_tuple((uintptr_t)b.raw_buffer()->device, false);
+    iface["version"] = 3;
+    iface["strides"] = py::tuple(strides);
+    iface["stream"] = py::none();
+    return iface;
+}
+
 py::buffer_info to_buffer_info(Buffer<> &b, bool reverse_axes = true) {
     if (b.data() == nullptr) {
         throw py::value_error("Cannot convert a Buffer<> with null host ptr to a Python buffer.");
@@ -378,6 +856,30 @@ void define_buffer(py::module &m) {
                 },
                 py::arg("type"), py::arg("sizes"), py::arg("name") = "")
 
+            // Share memory with tensors of other frameworks via DLPack,
+            // including device memory (CUDA, OpenCL or Metal) without copying
+            // it to the host. The axes are reversed by default, as for numpy.
+            .def_static("from_dlpack", &buffer_from_dlpack,
+                        py::arg("obj"), py::arg("target") = Target(), py::arg("name") = "", py::arg("reverse_axes") = true)
+            .def(
+                "__dlpack__", [](Buffer<> &b, const py::object & /*stream*/, const py::object & /*max_version*/) -> py::capsule {
+                    // We synchronize with the device before exporting, so the
+                    // data is ready on any stream.
+                    return buffer_to_dlpack(b, /*reverse_axes*/ true);
+                },
+                py::kw_only(), py::arg("stream") = py::none(), py::arg("max_version") = py::none())
+            .def("__dlpack_device__", [](const Buffer<> &b) -> py::tuple {
+                const DLDevice device = get_dlpack_device(b);
+                return py::make_tuple(device.device_type, device.device_id);
+            })
+
+            // Share CUDA memory with libraries that use the CUDA array
+            // interface rather than DLPack (e.g. Numba). The axes are
+            // reversed, as for numpy.
+            .def_static("from_cuda_array_interface", &buffer_from_cuda_array_interface,
+                        py::arg("obj"), py::arg("target") = Target(), py::arg("name") = "", py::arg("reverse_axes") = true)
+            .def_property_readonly("__cuda_array_interface__", &buffer_to_cuda_array_interface)
+
             .def_static("make_scalar", (Buffer<>(*)(Type, const std::string &))Buffer<>::make_scalar, py::arg("type"), py::arg("name") = "")
             .def_static("make_interleaved", (Buffer<>(*)(Type, int, int, int, const std::string &))Buffer<>::make_interleaved, py::arg("type"), py::arg("width"), py::arg("height"), py::arg("channels"), py::arg("name") = "")
             .def_static(
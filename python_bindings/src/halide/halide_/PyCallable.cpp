@@ -1,6 +1,11 @@
 #include "PyCallable.h"
 
+#include <algorithm>
+#include <exception>
+#include <memory>
+
 #include "PyBuffer.h"
+#include "PyFuture.h"
 
 #define TYPED_ALLOCA(TYPE, COUNT) ((TYPE *)alloca(sizeof(TYPE) * (COUNT)))
 
@@ -50,22 +55,17 @@ T cast_to(const py::handle &h) {
 }  // namespace
 
 class PyCallable {
-public:
-    static void call_impl(Callable &c, const py::args &args, const py::kwargs &kwargs) {
+    // Convert the arguments of a call from Python to the argv for
+    // Callable::call_argv_checked(). argv, scalar_storage, buffers and
+    // cci must have room for all of the arguments of c, including the
+    // JITUserContext, for which jit_user_context is used.
+    static void marshal_args(Callable &c, const py::args &args, const py::kwargs &kwargs,
+                             JITUserContext *jit_user_context, const void **argv,
+                             halide_scalar_value_t *scalar_storage, HalideBuffer *buffers,
+                             Callable::QuickCallCheckInfo *cci) {
         const size_t argc = c.arguments().size();
-        _halide_user_assert(argc > 0);
         const Argument *c_args = c.arguments().data();
 
-        // We want to keep call overhead as low as possible here,
-        // so use alloca (rather than e.g. std::vector) for short-term
-        // small allocations.
-        const void **argv = TYPED_ALLOCA(const void *, argc);
-        halide_scalar_value_t *scalar_storage = TYPED_ALLOCA(halide_scalar_value_t, argc);
-        HBufArray buffers(argc, TYPED_ALLOCA(HalideBuffer, argc));
-        Callable::QuickCallCheckInfo *cci = TYPED_ALLOCA(Callable::QuickCallCheckInfo, argc);
-
-        _halide_user_assert(argv && scalar_storage && buffers.buffers && cci) << "alloca failure";
-
         // Clear argv to all zero so we can use it to validate that all fields are
         // set properly when using kwargs -- a well-formed call will never have any
         // of the fields left null, nor any set twice. (The other alloca stuff can
@@ -76,8 +76,7 @@ public:
             << "Expected at most " << (argc - 1) << " positional arguments, but saw " << args.size() << ".";
 
         // args
-        JITUserContext empty_jit_user_context;
-        scalar_storage[0].u.u64 = (uintptr_t)&empty_jit_user_context;
+        scalar_storage[0].u.u64 = (uintptr_t)jit_user_context;
         argv[0] = &scalar_storage[0];
         cci[0] = Callable::make_ucon_qcci();
 
@@ -89,15 +88,16 @@ public:
                 // and we don't need the intermediate HalideBuffer wrapper anyway.
                 halide_buffer_t *raw_buffer;
                 if (py::isinstance<Halide::Buffer<>>(value)) {
-                    auto b = cast_to<Halide::Buffer<>>(value);
-                    raw_buffer = b.raw_buffer();
+                    // Use the Buffer held by the Python object (which keeps it
+                    // alive for the call), rather than a copy of it.
+                    raw_buffer = cast_to<Halide::Buffer<> &>(value).raw_buffer();
                 } else {
                     const bool writable = c_arg.is_output();
                     const bool reverse_axes = true;
-                    buffers.buffers[slot] =
+                    buffers[slot] =
                         pybuffer_to_halidebuffer<void, AnyDims, MaxFastDimensions>(
                             cast_to<py::buffer>(value), writable, reverse_axes);
-                    raw_buffer = buffers.buffers[slot].raw_buffer();
+                    raw_buffer = buffers[slot].raw_buffer();
                 }
                 // Mark all input buffers as having a dirty host, so that the Halide call will
                 // do a lazy-copy-to-GPU if needed. (See: https://github.com/halide/Halide/issues/6868)
@@ -147,11 +147,16 @@ public:
         }
 
         if (!kwargs.empty()) {
-            std::string trimmed_name;
-
             // Also process kwargs.
             for (auto kw : kwargs) {
-                const std::string name = cast_to<std::string>(kw.first);
+                // Compare the names without making std::strings of them, as
+                // this is done for every call.
+                Py_ssize_t name_size = 0;
+                const char *name = PyUnicode_Check(kw.first.ptr()) ? PyUnicode_AsUTF8AndSize(kw.first.ptr(), &name_size) : nullptr;
+                if (name == nullptr) {
+                    PyErr_Clear();
+                    _halide_user_assert(0) << "Keyword argument names must be strings.";
+                }
 
                 const py::handle value = kw.second;
 
@@ -162,15 +167,11 @@ public:
                 // of arguments a linear search is probably faster.
                 for (size_t slot = 1; slot < argc; slot++) {
                     const auto &c_arg = c_args[slot];
-                    const std::string *c_arg_name = &c_arg.name;
                     // The names in Arguments might be uniquified due to Func reuse.
-                    // Check and trim off any residue and match just the previous part.
-                    const size_t pos = c_arg_name->find_first_of('$');
-                    if (pos != std::string::npos) {
-                        trimmed_name = c_arg_name->substr(0, pos);
-                        c_arg_name = &trimmed_name;
-                    }
-                    if (*c_arg_name == name) {
+                    // Check and ignore any residue and match just the previous part.
+                    const size_t c_arg_name_size = std::min(c_arg.name.find_first_of('$'), c_arg.name.size());
+                    if (c_arg_name_size == (size_t)name_size &&
+                        c_arg.name.compare(0, c_arg_name_size, name, name_size) == 0) {
                         _halide_user_assert(argv[slot] == nullptr) << "Argument " << name << " specified multiple times.";
                         define_one_arg(c_arg, value, slot);
                         goto found_kw_arg;
@@ -191,6 +192,15 @@ public:
             _halide_user_assert(args.size() == argc - 1)
                 << "Expected exactly " << (argc - 1) << " positional arguments, but saw " << args.size() << ".";
         }
+    }
+
+    // Call c with the arguments made by marshal_args(). This doesn't use
+    // Python, so it can be done without the GIL, as long as the Python
+    // objects the arguments came from are kept alive.
+    static void call_marshalled(Callable &c, JITUserContext *jit_user_context, const void **argv,
+                                const Callable::QuickCallCheckInfo *cci) {
+        const size_t argc = c.arguments().size();
+        const Argument *c_args = c.arguments().data();
 
         int result = c.call_argv_checked(argc, argv, cci);
         _halide_user_assert(result == 0) << "Halide Runtime Error: " << result;
@@ -199,19 +209,180 @@ public:
         // flush results back to host, otherwise the output buffer will contain
         // random garbage. (We need a better solution for this,
         // see https://github.com/halide/Halide/issues/6868)
-        for (size_t i = 0; i < args.size(); i++) {
-            const auto &c_arg = c_args[i + 1];  // c_args[0] is the JITUserContext
-            const size_t slot = i + 1;
-            if (c_arg.kind == Argument::OutputBuffer) {
+        for (size_t slot = 1; slot < argc; slot++) {
+            // c_args[0] is the JITUserContext
+            if (c_args[slot].kind == Argument::OutputBuffer) {
                 auto *buf = (halide_buffer_t *)argv[slot];
                 if (buf->device_dirty()) {
-                    int result = buf->device_interface->copy_to_host(&empty_jit_user_context, buf);
+                    int result = buf->device_interface->copy_to_host(jit_user_context, buf);
                     _halide_user_assert(result == 0) << "Halide Runtime Error: " << result;
                 }
             }
         }
     }
 
+    // The arguments of a call, marshalled into storage that outlives the
+    // call that made them (unlike the alloca'd storage of call_impl).
+    struct MarshalledCall {
+        JITUserContext jit_user_context;
+        std::vector<const void *> argv;
+        std::vector<halide_scalar_value_t> scalar_storage;
+        std::vector<HalideBuffer> buffers;
+        std::vector<Callable::QuickCallCheckInfo> cci;
+
+        MarshalledCall(Callable &c, const py::args &args, const py::kwargs &kwargs)
+            : argv(c.arguments().size()),
+              scalar_storage(c.arguments().size()),
+              buffers(c.arguments().size()),
+              cci(c.arguments().size()) {
+            marshal_args(c, args, kwargs, &jit_user_context, argv.data(),
+                         scalar_storage.data(), buffers.data(), cci.data());
+        }
+
+        void call(Callable &c) {
+            call_marshalled(c, &jit_user_context, argv.data(), cci.data());
+        }
+
+        // argv refers to jit_user_context, so this can't be moved.
+        MarshalledCall(const MarshalledCall &) = delete;
+        MarshalledCall &operator=(const MarshalledCall &) = delete;
+        MarshalledCall(MarshalledCall &&) = delete;
+        MarshalledCall &operator=(MarshalledCall &&) = delete;
+    };
+
+    // A batch of calls for map_impl, run as the tasks of a parallel loop.
+    struct MapBatch {
+        Callable &c;
+        std::vector<std::unique_ptr<MarshalledCall>> calls;
+        std::vector<std::exception_ptr> errors;
+
+        static int task(JITUserContext *, int index, uint8_t *closure) {
+            MapBatch *batch = (MapBatch *)closure;
+            // Exceptions can't propagate through the runtime, so save them
+            // to rethrow once all the calls are done.
+            try {
+                batch->calls[index]->call(batch->c);
+            } catch (...) {
+                batch->errors[index] = std::current_exception();
+            }
+            return 0;
+        }
+    };
+
+    // Get the Python objects passed for the outputs of a call: a single
+    // object if there is one output, otherwise a tuple.
+    static py::object get_outputs(Callable &c, const py::args &args, const py::kwargs &kwargs) {
+        const std::vector<Argument> &c_args = c.arguments();
+        std::vector<py::object> outputs;
+        for (size_t slot = 1; slot < c_args.size(); slot++) {
+            if (!c_args[slot].is_output()) {
+                continue;
+            }
+            if (slot - 1 < args.size()) {
+                outputs.push_back(args[slot - 1]);
+            } else {
+                const std::string name = c_args[slot].name.substr(0, c_args[slot].name.find_first_of('$'));
+                outputs.push_back(kwargs[name.c_str()]);
+            }
+        }
+        if (outputs.size() == 1) {
+            return outputs[0];
+        }
+        py::tuple result(outputs.size());
+        for (size_t i = 0; i < outputs.size(); i++) {
+            result[i] = outputs[i];
+        }
+        return std::move(result);
+    }
+
+public:
+    static void call_impl(Callable &c, const py::args &args, const py::kwargs &kwargs) {
+        const size_t argc = c.arguments().size();
+        _halide_user_assert(argc > 0);
+
+        // We want to keep call overhead as low as possible here,
+        // so use alloca (rather than e.g. std::vector) for short-term
+        // small allocations.
+        const void **argv = TYPED_ALLOCA(const void *, argc);
+        halide_scalar_value_t *scalar_storage = TYPED_ALLOCA(halide_scalar_value_t, argc);
+        HBufArray buffers(argc, TYPED_ALLOCA(HalideBuffer, argc));
+        Callable::QuickCallCheckInfo *cci = TYPED_ALLOCA(Callable::QuickCallCheckInfo, argc);
+
+        _halide_user_assert(argv && scalar_storage && buffers.buffers && cci) << "alloca failure";
+
+        JITUserContext empty_jit_user_context;
+        marshal_args(c, args, kwargs, &empty_jit_user_context, argv, scalar_storage, buffers.buffers, cci);
+
+        // The arguments are all marshalled, so other Python threads can
+        // run while the pipeline does. (The Python objects the arguments
+        // came from are kept alive by our caller.)
+        py::gil_scoped_release release;
+        call_marshalled(c, &empty_jit_user_context, argv, cci);
+    }
+
+    static std::unique_ptr<PyFuture> call_async_impl(Callable &c, const py::args &args, const py::kwargs &kwargs) {
+        const size_t argc = c.arguments().size();
+        _halide_user_assert(argc > 0);
+
+        // The arguments must outlive this call, so they can't be on the stack.
+        auto call = std::make_shared<MarshalledCall>(c, args, kwargs);
+
+        // Keep the Python objects the arguments came from alive until the
+        // call is done.
+        return std::make_unique<PyFuture>(
+            [c, call]() mutable {
+                call->call(c);
+            },
+            []() -> py::object { return py::none(); },
+            py::make_tuple(args, kwargs));
+    }
+
+    // Make many calls of c, one for each item of calls: a tuple of the
+    // positional arguments, or a dict of the keyword arguments. The calls
+    // are run in parallel on the Halide runtime's thread pool, with the
+    // GIL released, and the outputs of each call are returned in order.
+    static py::list map_impl(Callable &c, const py::iterable &calls) {
+        _halide_user_assert(c.arguments().size() > 0);
+
+        MapBatch batch{c, {}, {}};
+        py::list all_outputs;
+        for (py::handle item : calls) {
+            py::args args;
+            py::kwargs kwargs;
+            if (py::isinstance<py::dict>(item)) {
+                kwargs = py::reinterpret_borrow<py::kwargs>(item);
+            } else {
+                args = py::reinterpret_borrow<py::args>(py::tuple(cast_to<py::sequence>(item)));
+            }
+            batch.calls.push_back(std::make_unique<MarshalledCall>(c, args, kwargs));
+            all_outputs.append(get_outputs(c, args, kwargs));
+        }
+        batch.errors.resize(batch.calls.size());
+
+        {
+            // The Python objects the arguments came from are kept alive by
+            // calls (and all_outputs).
+            py::gil_scoped_release release;
+            JITUserContext pool_context;
+            Internal::JITSharedRuntime::populate_jit_handlers(&pool_context, JITHandlers());
+            if (pool_context.handlers.custom_do_par_for) {
+                (void)pool_context.handlers.custom_do_par_for(&pool_context, MapBatch::task, 0,
+                                                              (int)batch.calls.size(), (uint8_t *)&batch);
+            } else {
+                for (size_t i = 0; i < batch.calls.size(); i++) {
+                    (void)MapBatch::task(&pool_context, (int)i, (uint8_t *)&batch);
+                }
+            }
+        }
+
+        for (const auto &e : batch.errors) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        }
+        return all_outputs;
+    }
+
 #undef TYPED_ALLOCA
 };
 
@@ -222,7 +393,13 @@ void define_callable(py::module &m) {
 
     auto callable_class =
         py::class_<Callable>(m, "Callable")
-            .def("__call__", PyCallable::call_impl);
+            .def("__call__", PyCallable::call_impl)
+            // Like __call__, but runs the pipeline on another thread, and
+            // returns a Future for its completion.
+            .def("call_async", PyCallable::call_async_impl)
+            // Call the Callable once for each item of a list of calls, in
+            // parallel, returning the outputs of each call.
+            .def("map", PyCallable::map_impl, py::arg("calls"));
 }
 
 }  // namespace PythonBindings
@@ -31,6 +31,13 @@ void define_derivative(py::module &m) {
           (Derivative(*)(const Func &, const Buffer<float> &)) & propagate_adjoints);
     m.def("propagate_adjoints",
           (Derivative(*)(const Func &)) & propagate_adjoints);
+    m.def("propagate_adjoints",
+          (Derivative(*)(const Func &, const Func &, const Region &, const std::vector<Func> &)) & propagate_adjoints,
+          py::arg("output"), py::arg("adjoint"), py::arg("output_bounds"), py::arg("checkpoints"));
+    m.def("propagate_adjoints",
+          (Derivative(*)(const Func &, const std::vector<Func> &)) & propagate_adjoints,
+          py::arg("output"), py::arg("checkpoints"));
+    m.def("choose_checkpoints", &choose_checkpoints, py::arg("output"));
 }
 
 }  // namespace PythonBindings
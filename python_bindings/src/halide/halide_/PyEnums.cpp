@@ -41,6 +41,16 @@ void define_enums(py::module &m) {
         .value("NoAlign", LoopAlignStrategy::NoAlign)
         .value("Auto", LoopAlignStrategy::Auto);
 
+    py::enum_<GatherMode>(m, "GatherMode")
+        .value("Auto", GatherMode::Auto)
+        .value("Always", GatherMode::Always)
+        .value("Never", GatherMode::Never);
+
+    py::enum_<MathAccuracy>(m, "MathAccuracy")
+        .value("Precise", MathAccuracy::Precise)
+        .value("High", MathAccuracy::High)
+        .value("Fast", MathAccuracy::Fast);
+
     py::enum_<MemoryType>(m, "MemoryType")
         .value("Auto", MemoryType::Auto)
         .value("Heap", MemoryType::Heap)
@@ -49,7 +59,8 @@ void define_enums(py::module &m) {
         .value("GPUShared", MemoryType::GPUShared)
         .value("GPUTexture", MemoryType::GPUTexture)
         .value("LockedCache", MemoryType::LockedCache)
-        .value("VTCM", MemoryType::VTCM);
+        .value("VTCM", MemoryType::VTCM)
+        .value("WMMAAccumulator", MemoryType::WMMAAccumulator);
 
     py::enum_<NameMangling>(m, "NameMangling")
         .value("Default", NameMangling::Default)
@@ -189,6 +200,20 @@ void define_enums(py::module &m) {
         .value("VulkanV12", Target::VulkanV12)
         .value("VulkanV13", Target::VulkanV13)
         .value("Semihosting", Target::Feature::Semihosting)
+        .value("AutoPrefetch", Target::Feature::AutoPrefetch)
+        .value("Workspace", Target::Feature::Workspace)
+        .value("PlanMemory", Target::Feature::PlanMemory)
+        .value("VectorMath", Target::Feature::VectorMath)
+        .value("AVX512_FP16", Target::Feature::AVX512_FP16)
+        .value("ProfileGuided", Target::Feature::ProfileGuided)
+        .value("SpecializeDenseStrides", Target::Feature::SpecializeDenseStrides)
+        .value("ARMI8mm", Target::Feature::ARMI8mm)
+        .value("ARMBf16", Target::Feature::ARMBf16)
+        .value("ProfileStages", Target::Feature::ProfileStages)
+        .value("ProfileMemoryTraffic", Target::Feature::ProfileMemoryTraffic)
+        .value("WasmRelaxedSimd", Target::Feature::WasmRelaxedSimd)
+        .value("StaticWorkspace", Target::Feature::StaticWorkspace)
+        .value("CPlusPlusParallelFor", Target::Feature::CPlusPlusParallelFor)
         .value("FeatureEnd", Target::Feature::FeatureEnd);
 
     py::enum_<halide_type_code_t>(m, "TypeCode")
@@ -130,6 +130,17 @@ void define_func(py::module &m) {
     // - set_custom_print()
     // - JITUserContext
 
+    auto trace_sampling_class =
+        py::class_<TraceSampling>(m, "TraceSampling")
+            .def(py::init<>())
+            .def_readwrite("every", &TraceSampling::every)
+            .def_readwrite("fraction", &TraceSampling::fraction)
+            .def_readwrite("seed", &TraceSampling::seed)
+            .def_readwrite("region", &TraceSampling::region)
+            .def_static("every_nth", &TraceSampling::every_nth, py::arg("n"))
+            .def_static("random_fraction", &TraceSampling::random_fraction, py::arg("fraction"), py::arg("seed") = 0)
+            .def_static("region_of_interest", &TraceSampling::region_of_interest, py::arg("region"));
+
     auto func_class =
         py::class_<Func>(m, "Func")
             .def(py::init<>())
@@ -212,13 +223,25 @@ void define_func(py::module &m) {
             .def("store_at", (Func & (Func::*)(const Func &, const RVar &)) & Func::store_at, py::arg("f"), py::arg("var"))
             .def("store_at", (Func & (Func::*)(LoopLevel)) & Func::store_at, py::arg("loop_level"))
 
+            .def("hoist_storage", (Func & (Func::*)(const Func &, const Var &)) & Func::hoist_storage, py::arg("f"), py::arg("var"))
+            .def("hoist_storage", (Func & (Func::*)(const Func &, const RVar &)) & Func::hoist_storage, py::arg("f"), py::arg("var"))
+            .def("hoist_storage", (Func & (Func::*)(LoopLevel)) & Func::hoist_storage, py::arg("loop_level"))
+
             .def("async_", &Func::async)
+            .def("ring_buffer", &Func::ring_buffer, py::arg("buffers"))
+            .def("double_buffer", &Func::double_buffer, py::arg("f"), py::arg("var"), py::arg("store_var"), py::arg("dim"), py::arg("extent"), py::arg("memory_type") = MemoryType::Auto)
             .def("memoize", &Func::memoize)
             .def("compute_inline", &Func::compute_inline)
             .def("compute_root", &Func::compute_root)
             .def("store_root", &Func::store_root)
+            .def("hoist_storage_root", &Func::hoist_storage_root)
 
             .def("store_in", &Func::store_in, py::arg("memory_type"))
+            .def("gather_mode", &Func::gather_mode, py::arg("mode"))
+            .def("interleave_tuple", &Func::interleave_tuple, py::arg("interleave") = true)
+            .def("code_size_budget", &Func::code_size_budget, py::arg("nodes"))
+            .def("store_nontemporal", &Func::store_nontemporal, py::arg("nontemporal") = true)
+            .def("store_interleaved", &Func::store_interleaved, py::arg("channels"), py::arg("vector_size") = 16)
 
             .def(
                 "compile_to", [](Func &f, const std::map<OutputFileType, std::string> &output_files, const std::vector<Argument> &args, const std::string &fn_name, const Target &target) {
@@ -313,6 +336,12 @@ void define_func(py::module &m) {
                 },
                 py::arg("arguments"), py::arg("target") = Target())
 
+            .def(
+                "compile_to_callable", [](Func &f, const std::vector<Argument> &args, const std::vector<Target> &targets) {
+                    return f.compile_to_callable(args, targets);
+                },
+                py::arg("arguments"), py::arg("targets"))
+
             .def("has_update_definition", &Func::has_update_definition)
             .def("num_update_definitions", &Func::num_update_definitions)
 
@@ -327,11 +356,12 @@ void define_func(py::module &m) {
                 py::arg("idx") = 0)
             .def("rvars", &Func::rvars, py::arg("idx") = 0)
 
-            .def("trace_loads", &Func::trace_loads)
-            .def("trace_stores", &Func::trace_stores)
+            .def("trace_loads", &Func::trace_loads, py::arg("sampling") = TraceSampling())
+            .def("trace_stores", &Func::trace_stores, py::arg("sampling") = TraceSampling())
             .def("trace_realizations", &Func::trace_realizations)
             .def("print_loop_nest", &Func::print_loop_nest)
             .def("add_trace_tag", &Func::add_trace_tag, py::arg("trace_tag"))
+            .def("notify_completion", &Func::notify_completion, py::arg("var"))
 
             // TODO: also provide to-array versions to avoid requiring filesystem usage
             .def("debug_to_file", &Func::debug_to_file)
@@ -403,6 +433,8 @@ void define_func(py::module &m) {
             .def("bound_extent", &Func::bound_extent, py::arg("var"), py::arg("extent"))
 
             .def("align_storage", &Func::align_storage, py::arg("dim"), py::arg("alignment"))
+            .def("pad_storage", &Func::pad_storage, py::arg("dim"), py::arg("padding"))
+            .def("pad_storage_against_aliasing", &Func::pad_storage_against_aliasing, py::arg("dim"), py::arg("critical_stride") = Expr(4096))
 
             .def("fold_storage", &Func::fold_storage, py::arg("dim"), py::arg("extent"), py::arg("fold_forward") = true)
 
@@ -0,0 +1,66 @@
+#include "PyFuture.h"
+
+#include <chrono>
+#include <utility>
+
+namespace Halide {
+namespace PythonBindings {
+
+PyFuture::PyFuture(std::function<void()> work, std::function<py::object()> get_result, py::object keep_alive)
+    : future(std::async(std::launch::async, std::move(work)).share()),
+      get_result(std::move(get_result)),
+      keep_alive(std::move(keep_alive)) {
+}
+
+PyFuture::~PyFuture() {
+    // The work may need the GIL (e.g. to print), so don't hold it while
+    // waiting for the work to finish using the objects it refers to.
+    if (!done()) {
+        py::gil_scoped_release release;
+        future.wait();
+    }
+}
+
+bool PyFuture::done() const {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+bool PyFuture::wait(const py::object &timeout) const {
+    if (timeout.is_none()) {
+        py::gil_scoped_release release;
+        future.wait();
+        return true;
+    }
+    const double seconds = timeout.cast<double>();
+    py::gil_scoped_release release;
+    return future.wait_for(std::chrono::duration<double>(seconds)) == std::future_status::ready;
+}
+
+py::object PyFuture::result() const {
+    wait(py::none());
+    // This rethrows the exception thrown by the work, if any.
+    future.get();
+    return get_result();
+}
+
+void define_future(py::module &m) {
+    auto future_class =
+        py::class_<PyFuture>(m, "Future")
+            .def("done", &PyFuture::done)
+            .def("wait", &PyFuture::wait, py::arg("timeout") = py::none())
+            .def("result", &PyFuture::result);
+
+    // Wait for all of the futures, and return a list of their results.
+    m.def(
+        "wait_all", [](const std::vector<PyFuture *> &futures) -> py::list {
+            py::list results;
+            for (PyFuture *f : futures) {
+                results.append(f->result());
+            }
+            return results;
+        },
+        py::arg("futures"));
+}
+
+}  // namespace PythonBindings
+}  // namespace Halide
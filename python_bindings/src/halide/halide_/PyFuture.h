@@ -0,0 +1,52 @@
+#ifndef HALIDE_PYTHON_BINDINGS_PYFUTURE_H
+#define HALIDE_PYTHON_BINDINGS_PYFUTURE_H
+
+#include <functional>
+#include <future>
+
+#include "PyHalide.h"
+
+namespace Halide {
+namespace PythonBindings {
+
+void define_future(py::module &m);
+
+// The pending result of work (e.g. running a pipeline) done on another
+// thread, without holding the GIL. This is what Callable.call_async()
+// and Pipeline.realize_async() return.
+class PyFuture {
+    std::shared_future<void> future;
+
+    // Converts the result of the work to a Python object. Only called
+    // (with the GIL held) once the work is done.
+    std::function<py::object()> get_result;
+
+    // Python objects that must be kept alive until the work is done
+    // (e.g. the arguments of a call).
+    py::object keep_alive;
+
+public:
+    PyFuture(std::function<void()> work, std::function<py::object()> get_result, py::object keep_alive);
+    ~PyFuture();
+
+    bool done() const;
+
+    // Wait until the work is done, or for timeout seconds if timeout is
+    // not None. Returns whether the work is done.
+    bool wait(const py::object &timeout) const;
+
+    // Wait until the work is done, and return its result, or rethrow the
+    // exception it threw.
+    py::object result() const;
+
+    PyFuture() = delete;
+    PyFuture(const PyFuture &) = delete;
+    PyFuture &operator=(const PyFuture &) = delete;
+    PyFuture(PyFuture &&) = delete;
+    PyFuture &operator=(PyFuture &&) = delete;
+};
+
+}  // namespace PythonBindings
+}  // namespace Halide
+
+#endif  // HALIDE_PYTHON_BINDINGS_PYFUTURE_H
@@ -11,6 +11,7 @@
 #include "PyExpr.h"
 #include "PyExternFuncArgument.h"
 #include "PyFunc.h"
+#include "PyFuture.h"
 #include "PyGenerator.h"
 #include "PyIROperator.h"
 #include "PyImageParam.h"
@@ -19,6 +20,7 @@
 #include "PyModule.h"
 #include "PyParam.h"
 #include "PyPipeline.h"
+#include "PyProfiler.h"
 #include "PyRDom.h"
 #include "PyTarget.h"
 #include "PyTuple.h"
@@ -54,6 +56,7 @@ PYBIND11_MODULE(HALIDE_PYBIND_MODULE_NAME, m) {
     define_var(m);
     define_rdom(m);
     define_module(m);
+    define_future(m);
     define_callable(m);
     define_func(m);
     define_pipeline(m);
@@ -65,9 +68,14 @@ PYBIND11_MODULE(HALIDE_PYBIND_MODULE_NAME, m) {
     define_type(m);
     define_derivative(m);
     define_generator(m);
+    define_profiler(m);
 
     // There is no PyUtil yet, so just put this here
     m.def("load_plugin", &Halide::load_plugin, py::arg("lib_name"));
+
+    // Compiled pipelines are stored in (and reloaded from) this directory.
+    m.def("set_jit_cache_dir", &Halide::Internal::JITSharedRuntime::set_jit_cache_dir, py::arg("dir"));
+    m.def("get_jit_cache_dir", &Halide::Internal::JITSharedRuntime::get_jit_cache_dir);
 }
 
 namespace Halide {
@@ -89,14 +89,21 @@ void define_operators(py::module &m) {
     });
     m.def("mux", (Expr(*)(const Expr &, const std::vector<Expr> &)) & mux);
 
-    m.def("sin", &sin);
-    m.def("asin", &asin);
-    m.def("cos", &cos);
-    m.def("acos", &acos);
-    m.def("tan", &tan);
-    m.def("atan", &atan);
-    m.def("atan", &atan2);
-    m.def("atan2", &atan2);
+    m.def("sin", (Expr(*)(Expr)) & sin);
+    m.def("sin", (Expr(*)(Expr, MathAccuracy)) & sin, py::arg("x"), py::arg("accuracy"));
+    m.def("asin", (Expr(*)(Expr)) & asin);
+    m.def("asin", (Expr(*)(Expr, MathAccuracy)) & asin, py::arg("x"), py::arg("accuracy"));
+    m.def("cos", (Expr(*)(Expr)) & cos);
+    m.def("cos", (Expr(*)(Expr, MathAccuracy)) & cos, py::arg("x"), py::arg("accuracy"));
+    m.def("acos", (Expr(*)(Expr)) & acos);
+    m.def("acos", (Expr(*)(Expr, MathAccuracy)) & acos, py::arg("x"), py::arg("accuracy"));
+    m.def("tan", (Expr(*)(Expr)) & tan);
+    m.def("tan", (Expr(*)(Expr, MathAccuracy)) & tan, py::arg("x"), py::arg("accuracy"));
+    m.def("atan", (Expr(*)(Expr)) & atan);
+    m.def("atan", (Expr(*)(Expr, MathAccuracy)) & atan, py::arg("x"), py::arg("accuracy"));
+    m.def("atan", (Expr(*)(Expr, Expr)) & atan2);
+    m.def("atan2", (Expr(*)(Expr, Expr)) & atan2);
+    m.def("atan2", (Expr(*)(Expr, Expr, MathAccuracy)) & atan2, py::arg("y"), py::arg("x"), py::arg("accuracy"));
     m.def("sinh", &sinh);
     m.def("asinh", &asinh);
     m.def("cosh", &cosh);
@@ -105,9 +112,12 @@ void define_operators(py::module &m) {
     m.def("atanh", &atanh);
     m.def("sqrt", &sqrt);
     m.def("hypot", &hypot);
-    m.def("exp", &exp);
-    m.def("log", &log);
-    m.def("pow", &pow);
+    m.def("exp", (Expr(*)(Expr)) & exp);
+    m.def("exp", (Expr(*)(Expr, MathAccuracy)) & exp, py::arg("x"), py::arg("accuracy"));
+    m.def("log", (Expr(*)(Expr)) & log);
+    m.def("log", (Expr(*)(Expr, MathAccuracy)) & log, py::arg("x"), py::arg("accuracy"));
+    m.def("pow", (Expr(*)(Expr, Expr)) & pow);
+    m.def("pow", (Expr(*)(Expr, Expr, MathAccuracy)) & pow, py::arg("x"), py::arg("y"), py::arg("accuracy"));
     m.def("erf", &erf);
     m.def("fast_log", &fast_log);
     m.def("fast_exp", &fast_exp);
@@ -159,6 +169,7 @@ void define_operators(py::module &m) {
         py::arg("result"));
     m.def("likely", &likely);
     m.def("likely_if_innermost", &likely_if_innermost);
+    m.def("gpu_occupancy_block_size", &gpu_occupancy_block_size, py::arg("max_size") = 1024);
     m.def("saturating_cast", (Expr(*)(Type, Expr)) & saturating_cast);
     m.def("strict_float", &strict_float);
     m.def("logical_not", [](const Expr &expr) -> Expr {
@@ -75,7 +75,8 @@ void define_image_param(py::module &m) {
             .def("in_", (Func(ImageParam::*)(const Func &)) & ImageParam::in)
             .def("in_", (Func(ImageParam::*)(const std::vector<Func> &)) & ImageParam::in)
             .def("in_", (Func(ImageParam::*)()) & ImageParam::in)
-            .def("trace_loads", &ImageParam::trace_loads)
+            .def("deinterleaved", &ImageParam::deinterleaved, py::arg("channels"), py::arg("vector_size") = 16)
+            .def("trace_loads", &ImageParam::trace_loads, py::arg("sampling") = TraceSampling())
 
             .def("__repr__", [](const ImageParam &im) -> std::string {
                 std::ostringstream o;
@@ -1,8 +1,11 @@
 #include "PyPipeline.h"
 
+#include <memory>
+#include <optional>
 #include <utility>
 
 #include "PyError.h"
+#include "PyFuture.h"
 #include "PyTuple.h"
 
 namespace Halide {
@@ -71,6 +74,7 @@ void define_pipeline(py::module &m) {
             .def(py::init<const std::vector<Func> &>())
 
             .def("outputs", &Pipeline::outputs)
+            .def_static("combine", &Pipeline::combine, py::arg("pipelines"))
 
             .def("apply_autoscheduler", (AutoSchedulerResults(Pipeline::*)(const Target &, const AutoschedulerParams &) const) & Pipeline::apply_autoscheduler,
                  py::arg("target"), py::arg("autoscheduler_params"))
@@ -171,6 +175,12 @@ void define_pipeline(py::module &m) {
                 },
                 py::arg("arguments"), py::arg("target") = Target())
 
+            .def(
+                "compile_to_callable", [](Pipeline &p, const std::vector<Argument> &args, const std::vector<Target> &targets) {
+                    return p.compile_to_callable(args, targets);
+                },
+                py::arg("arguments"), py::arg("targets"))
+
             .def(
                 "realize", [](Pipeline &p, Buffer<> buffer, const Target &target) -> void {
                     py::gil_scoped_release release;
@@ -209,6 +219,47 @@ void define_pipeline(py::module &m) {
                 },
                 py::arg("dst"), py::arg("target") = Target())
 
+            // Like realize(), but runs the pipeline on another thread, and
+            // returns a Future for its result. The Pipeline must not be
+            // changed or realized elsewhere until the result is ready. As
+            // for realize(), the list-of-sizes overload must go first.
+            .def(
+                "realize_async", [](Pipeline &p, std::vector<int32_t> sizes, const Target &target) -> std::unique_ptr<PyFuture> {
+                    auto r = std::make_shared<std::optional<Realization>>();
+                    return std::make_unique<PyFuture>(
+                        [p, sizes = std::move(sizes), target, r]() mutable {
+                            PyJITUserContext juc;
+                            *r = p.realize(&juc, std::move(sizes), target);
+                        },
+                        [r]() -> py::object { return realization_to_object(**r); },
+                        py::none());
+                },
+                py::arg("sizes") = std::vector<int32_t>{}, py::arg("target") = Target())
+
+            .def(
+                "realize_async", [](Pipeline &p, Buffer<> buffer, const Target &target) -> std::unique_ptr<PyFuture> {
+                    return std::make_unique<PyFuture>(
+                        [p, buffer = std::move(buffer), target]() mutable {
+                            PyJITUserContext juc;
+                            p.realize(&juc, Realization(std::move(buffer)), target);
+                        },
+                        []() -> py::object { return py::none(); },
+                        py::none());
+                },
+                py::arg("dst"), py::arg("target") = Target())
+
+            .def(
+                "realize_async", [](Pipeline &p, std::vector<Buffer<>> buffers, const Target &target) -> std::unique_ptr<PyFuture> {
+                    return std::make_unique<PyFuture>(
+                        [p, buffers = std::move(buffers), target]() mutable {
+                            PyJITUserContext juc;
+                            p.realize(&juc, Realization(std::move(buffers)), target);
+                        },
+                        []() -> py::object { return py::none(); },
+                        py::none());
+                },
+                py::arg("dst"), py::arg("target") = Target())
+
             .def(
                 "infer_input_bounds", [](Pipeline &p, const py::object &dst, const Target &target) -> void {
                     const Target t = to_jit_target(target);
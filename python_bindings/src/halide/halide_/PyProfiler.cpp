@@ -0,0 +1,95 @@
+#include "PyProfiler.h"
+
+#include <string>
+#include <vector>
+
+namespace Halide {
+namespace PythonBindings {
+
+namespace {
+
+// A copy of the stats of one pipeline, taken while the profiler is
+// locked, so that the Python objects can be built after it is unlocked.
+struct PipelineStats {
+    halide_profiler_pipeline_stats pipeline;
+    std::vector<halide_profiler_func_stats> funcs;
+};
+
+int copy_pipeline_stats(void *arg, const halide_profiler_pipeline_stats *p) {
+    PipelineStats stats;
+    stats.pipeline = *p;
+    stats.funcs.assign(p->funcs, p->funcs + p->num_funcs);
+    ((std::vector<PipelineStats> *)arg)->push_back(std::move(stats));
+    return 0;
+}
+
+double ratio(uint64_t numerator, uint64_t denominator) {
+    return denominator ? (double)numerator / (double)denominator : 0.0;
+}
+
+// The fields that pipelines and Funcs have in common.
+template<typename T>
+py::dict common_stats_to_dict(const T &s) {
+    py::dict d;
+    d["name"] = std::string(s.name ? s.name : "");
+    d["time_ns"] = s.time;
+    d["memory_current"] = s.memory_current;
+    d["memory_peak"] = s.memory_peak;
+    d["memory_total"] = s.memory_total;
+    d["num_allocs"] = s.num_allocs;
+    d["active_threads"] = ratio(s.active_threads_numerator, s.active_threads_denominator);
+    d["device_memory_current"] = s.device_memory_current;
+    d["device_memory_peak"] = s.device_memory_peak;
+    d["device_memory_total"] = s.device_memory_total;
+    d["device_num_allocs"] = s.device_num_allocs;
+    d["device_pool_hits"] = s.device_pool_hits;
+    d["copy_to_device_bytes"] = s.copy_to_device_bytes;
+    d["copy_to_host_bytes"] = s.copy_to_host_bytes;
+    d["copy_to_device_time_ns"] = s.copy_to_device_time;
+    d["copy_to_host_time_ns"] = s.copy_to_host_time;
+    d["kernel_time_ns"] = s.kernel_time;
+    d["num_kernels"] = s.num_kernels;
+    d["bytes_loaded"] = s.bytes_loaded;
+    d["bytes_stored"] = s.bytes_stored;
+    d["arithmetic_ops"] = s.arithmetic_ops;
+    return d;
+}
+
+py::list profiler_stats() {
+    std::vector<PipelineStats> stats;
+    {
+        py::gil_scoped_release release;
+        Internal::JITSharedRuntime::profiler_visit(copy_pipeline_stats, &stats);
+    }
+
+    py::list result;
+    for (const auto &s : stats) {
+        py::dict p = common_stats_to_dict(s.pipeline);
+        p["runs"] = s.pipeline.runs;
+        p["sampled_runs"] = s.pipeline.sampled_runs;
+        p["samples"] = s.pipeline.samples;
+        py::list funcs;
+        for (const auto &f : s.funcs) {
+            py::dict d = common_stats_to_dict(f);
+            d["stack_peak"] = f.stack_peak;
+            funcs.append(d);
+        }
+        p["funcs"] = funcs;
+        result.append(p);
+    }
+    return result;
+}
+
+}  // namespace
+
+void define_profiler(py::module &m) {
+    // The stats of each JIT-compiled pipeline run with the profile target
+    // feature since the last reset, as a list of dicts (one per pipeline,
+    // each with a list of dicts for its Funcs under "funcs").
+    m.def("profiler_stats", &profiler_stats);
+    m.def("profiler_reset", &Internal::JITSharedRuntime::profiler_reset);
+    m.def("set_profiler_report_after_run", &Internal::JITSharedRuntime::set_profiler_report_after_run, py::arg("report"));
+}
+
+}  // namespace PythonBindings
+}  // namespace Halide
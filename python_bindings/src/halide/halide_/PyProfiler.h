@@ -0,0 +1,14 @@
+#ifndef HALIDE_PYTHON_BINDINGS_PYPROFILER_H
+#define HALIDE_PYTHON_BINDINGS_PYPROFILER_H
+
+#include "PyHalide.h"
+
+namespace Halide {
+namespace PythonBindings {
+
+void define_profiler(py::module &m);
+
+}  // namespace PythonBindings
+}  // namespace Halide
+
+#endif  // HALIDE_PYTHON_BINDINGS_PYPROFILER_H
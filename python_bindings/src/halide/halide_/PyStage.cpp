@@ -17,7 +17,10 @@ void define_stage(py::module &m) {
             .def("rfactor", (Func(Stage::*)(std::vector<std::pair<RVar, Var>>)) & Stage::rfactor,
                  py::arg("preserved"))
             .def("rfactor", (Func(Stage::*)(const RVar &, const Var &)) & Stage::rfactor,
-                 py::arg("r"), py::arg("v"));
+                 py::arg("r"), py::arg("v"))
+            .def("allow_reassociation", &Stage::allow_reassociation)
+            .def("privatize", &Stage::privatize,
+                 py::arg("r"), py::arg("v"), py::arg("slice_size"));
 
     py::implicitly_convertible<Func, Stage>();
 
@@ -382,6 +382,86 @@ def test_oob():
         assert "index 6 is out of bounds for axis 1 with min=0, extent=6" in str(e)
 
 
+def test_dlpack():
+    if not hasattr(np, "from_dlpack"):
+        # DLPack needs numpy 1.22 or later.
+        return
+
+    a = np.arange(12, dtype=np.int16).reshape(3, 4)
+    b = hl.Buffer.from_dlpack(a)
+    assert b.type() == hl.Int(16)
+    assert b.dim(0).extent() == 4
+    assert b.dim(0).stride() == 1
+    assert b.dim(1).extent() == 3
+    assert b.dim(1).stride() == 4
+    assert b[1, 2] == a[2, 1]
+
+    # The memory is shared in both directions.
+    b[3, 0] = 42
+    assert a[0, 3] == 42
+    c = np.from_dlpack(b)
+    assert c.shape == (3, 4)
+    c[2, 2] = 99
+    assert b[2, 2] == 99
+    assert a[2, 2] == 99
+
+    strided = hl.Buffer.from_dlpack(a[:, ::2])
+    assert strided.dim(0).extent() == 2
+    assert strided.dim(0).stride() == 2
+    assert strided[1, 2] == a[2, 2]
+
+    # A capsule can only be consumed once.
+    capsule = a.__dlpack__()
+    hl.Buffer.from_dlpack(capsule)
+    try:
+        hl.Buffer.from_dlpack(capsule)
+    except ValueError as e:
+        assert "already been consumed" in str(e)
+    else:
+        assert False, "Did not see expected exception!"
+
+
+def test_cuda_array_interface():
+    # Only Buffers with a CUDA allocation expose the interface.
+    b = hl.Buffer(hl.Float(32), [4, 3])
+    assert not hasattr(b, "__cuda_array_interface__")
+
+    class FakeArray:
+        def __init__(self, typestr):
+            self.__cuda_array_interface__ = {
+                "shape": (3, 4),
+                "typestr": typestr,
+                "data": (0, False),
+                "version": 3,
+            }
+
+    for typestr in [">f4", "<c8", "|V2"]:
+        try:
+            hl.Buffer.from_cuda_array_interface(FakeArray(typestr))
+        except ValueError as e:
+            assert "Unsupported" in str(e)
+        else:
+            assert False, "Did not see expected exception!"
+
+    target = hl.get_jit_target_from_environment()
+    if not target.has_feature(hl.TargetFeature.CUDA):
+        return
+
+    b.fill(3.0)
+    b.copy_to_device(hl.DeviceAPI.CUDA, target)
+    iface = b.__cuda_array_interface__
+    assert iface["shape"] == (3, 4)
+    assert iface["typestr"] == "<f4"
+    assert iface["strides"] == (16, 4)
+
+    # The device memory is shared, not copied.
+    c = hl.Buffer.from_cuda_array_interface(b)
+    assert c.has_device_allocation()
+    assert c.dim(0).extent() == 4
+    assert c.dim(1).extent() == 3
+    assert c.__cuda_array_interface__["data"] == iface["data"]
+
+
 if __name__ == "__main__":
     test_make_interleaved()
     test_interleaved_ndarray()
@@ -401,3 +481,5 @@ if __name__ == "__main__":
     test_buffer_to_str()
     test_scalar_buffers()
     test_oob()
+    test_dlpack()
+    test_cuda_array_interface()
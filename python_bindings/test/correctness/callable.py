@@ -1,5 +1,8 @@
 import halide as hl
 import numpy as np
+import os
+import tempfile
+import threading
 
 from simplepy_generator import SimplePy
 import simplecpp_pystub  # Needed for create_callable_from_generator("simplecpp") to work
@@ -171,6 +174,112 @@ def test_simple(callable_factory):
         assert False, "Did not see expected exception!"
 
 
+def test_threads():
+    # Calls to a Callable release the GIL while the pipeline runs, so calls
+    # from several threads can run concurrently.
+    p = hl.Param(hl.Int(32), 0)
+    x = hl.Var("x")
+    f = hl.Func("f")
+    f[x] = x + p
+
+    c = f.compile_to_callable([p])
+
+    failures = []
+
+    def _run(k):
+        out = hl.Buffer(hl.Int(32), [1000])
+        for _ in range(20):
+            c(k, out)
+            if out[999] != 999 + k:
+                failures.append(k)
+
+    threads = [threading.Thread(target=_run, args=(k,)) for k in range(4)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    assert not failures
+
+
+def test_async():
+    p = hl.Param(hl.Int(32), 0)
+    x = hl.Var("x")
+    f = hl.Func("f")
+    f[x] = x + p
+
+    c = f.compile_to_callable([p])
+
+    outs = [hl.Buffer(hl.Int(32), [100]) for _ in range(4)]
+    futures = [c.call_async(k, outs[k]) for k in range(4)]
+    assert hl.wait_all(futures) == [None] * 4
+    for k in range(4):
+        assert futures[k].done()
+        assert outs[k][99] == 99 + k
+
+    # Errors in the call are raised by result().
+    future = c.call_async(1, hl.Buffer(hl.Float(32), [100]))
+    assert future.wait(timeout=60)
+    try:
+        future.result()
+    except hl.HalideError:
+        pass
+    else:
+        assert False, "Did not see expected exception!"
+
+    r = hl.Pipeline(f).realize_async([10]).result()
+    assert r.type() == hl.Int(32)
+    assert r[9] == 9
+
+
+def test_map():
+    p = hl.Param(hl.Int(32), "p", 0)
+    x = hl.Var("x")
+    f = hl.Func("f")
+    f[x] = x + p
+
+    c = f.compile_to_callable([p])
+
+    outs = [hl.Buffer(hl.Int(32), [100]) for _ in range(50)]
+    calls = [(k, outs[k]) for k in range(40)] + [{"p": k, "f": outs[k]} for k in range(40, 50)]
+    results = c.map(calls)
+    assert len(results) == 50
+    for k in range(50):
+        assert results[k] is outs[k]
+        assert outs[k][99] == 99 + k
+
+    # Errors in any of the calls are raised after all of them are done.
+    bad = hl.Buffer(hl.Float(32), [100])
+    try:
+        c.map([(1, outs[0]), (2, bad)])
+    except hl.HalideError:
+        pass
+    else:
+        assert False, "Did not see expected exception!"
+    assert outs[0][99] == 100
+
+
+def test_jit_cache():
+    old_dir = hl.get_jit_cache_dir()
+    with tempfile.TemporaryDirectory() as tmp:
+        cache_dir = os.path.join(tmp, "jit_cache")
+        hl.set_jit_cache_dir(cache_dir)
+        assert hl.get_jit_cache_dir() == cache_dir
+        try:
+            for _ in range(2):
+                p = hl.Param(hl.Int(32), "p", 0)
+                x = hl.Var("x")
+                f = hl.Func("f")
+                f[x] = x * 3 + p
+                c = f.compile_to_callable([p])
+                out = hl.Buffer(hl.Int(32), [10])
+                c(5, out)
+                assert out[9] == 32
+            # The second compilation is loaded from the cache written by the first.
+            assert any(name.endswith(".o") for name in os.listdir(cache_dir))
+        finally:
+            hl.set_jit_cache_dir(old_dir)
+
+
 if __name__ == "__main__":
     # test_callable()
 
@@ -184,3 +293,7 @@ if __name__ == "__main__":
 
     test_simple(via_simplecpp_pystub)
     test_simple(via_simplepy)
+    test_threads()
+    test_async()
+    test_map()
+    test_jit_cache()
@@ -0,0 +1,41 @@
+import halide as hl
+
+
+def test_profiler_stats():
+    x = hl.Var("x")
+    f = hl.Func("f")
+    g = hl.Func("g")
+    f[x] = hl.sin(x) * 2.0
+    g[x] = f[x] + f[x + 1]
+    f.compute_root()
+
+    t = hl.get_jit_target_from_environment().with_feature(hl.TargetFeature.Profile)
+    c = g.compile_to_callable([], t)
+
+    # Accumulate the stats over several runs, instead of printing them
+    # after each one.
+    hl.set_profiler_report_after_run(False)
+    try:
+        hl.profiler_reset()
+        out = hl.Buffer(hl.Float(32), [100000])
+        for _ in range(10):
+            c(out)
+
+        stats = [p for p in hl.profiler_stats() if p["runs"] > 0]
+        assert len(stats) == 1
+        p = stats[0]
+        assert p["runs"] == 10
+        assert p["memory_peak"] > 0
+        funcs = {func["name"]: func for func in p["funcs"]}
+        assert "f" in funcs and "g" in funcs
+        assert funcs["f"]["num_allocs"] == 10
+        assert funcs["f"]["memory_peak"] >= 100001 * 4
+
+        hl.profiler_reset()
+        assert all(p["runs"] == 0 for p in hl.profiler_stats())
+    finally:
+        hl.set_profiler_report_after_run(True)
+
+
+if __name__ == "__main__":
+    test_profiler_stats()
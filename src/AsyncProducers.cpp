@@ -1,9 +1,13 @@
 #include "AsyncProducers.h"
+#include "Bounds.h"
 #include "ExprUsesVar.h"
 #include "Function.h"
 #include "IREquality.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "Scope.h"
+#include "Simplify.h"
+#include "Substitute.h"
 
 namespace Halide {
 namespace Internal {
@@ -306,6 +310,445 @@ public:
     int count = 0;
 };
 
+// Rewrite the accesses to a ring-buffered Func to index into the current
+// slot of its hoisted storage.
+class RingBufferAccesses : public IRMutator {
+    using IRMutator::visit;
+
+    const string &func;
+    const Region &bounds;
+    int slot_dim;
+    Expr slot_offset;
+
+    vector<Expr> rewrite_args(const vector<Expr> &args) {
+        vector<Expr> result;
+        for (size_t i = 0; i < args.size(); i++) {
+            Expr arg = mutate(args[i]) - bounds[i].min;
+            if ((int)i == slot_dim) {
+                arg += slot_offset;
+            }
+            result.push_back(arg);
+        }
+        return result;
+    }
+
+    Stmt visit(const Provide *op) override {
+        if (op->name != func) {
+            return IRMutator::visit(op);
+        }
+        vector<Expr> values;
+        for (const Expr &v : op->values) {
+            values.push_back(mutate(v));
+        }
+        return Provide::make(op->name, values, rewrite_args(op->args), mutate(op->predicate));
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->call_type != Call::Halide || op->name != func) {
+            return IRMutator::visit(op);
+        }
+        return Call::make(op->type, op->name, rewrite_args(op->args), op->call_type,
+                          op->func, op->value_index, op->image, op->param);
+    }
+
+public:
+    RingBufferAccesses(const string &f, const Region &b, int d, Expr o)
+        : func(f), bounds(b), slot_dim(d), slot_offset(std::move(o)) {
+    }
+};
+
+// Move the realization of each ring-buffered Func out to its
+// hoist_storage level, with the outermost storage dimension widened to
+// hold one copy per slot. Each copy is as large as the largest
+// realization made by any iteration of the loops in between, and
+// accesses are made relative to the min of the realization of the
+// current iteration. The current slot is a free variable here; it is
+// defined separately on each side of the fork by ForkAsyncProducers.
+class HoistRingBuffers : public IRMutator {
+public:
+    HoistRingBuffers(const map<string, Function> &e)
+        : env(e) {
+    }
+
+    Stmt hoist(const Stmt &s) {
+        sites.push_back({"", 0, {}});
+        Stmt result = wrap(mutate(s), sites.back());
+        sites.pop_back();
+        return result;
+    }
+
+private:
+    using IRMutator::visit;
+
+    const map<string, Function> &env;
+
+    // A variable defined by a loop or a let.
+    struct Definition {
+        string name;
+        Expr min, extent;  // For a loop
+        Expr value;        // For a let
+    };
+    vector<Definition> defs;
+
+    struct HoistedRealize {
+        vector<Type> types;
+        MemoryType memory_type;
+        // The bounds of a single slot.
+        Region bounds;
+        int slot_dim;
+        Expr buffers;
+    };
+
+    // The enclosing loops, outermost first, with the realizations hoisted
+    // to each. The first site is outside all loops.
+    struct Site {
+        string loop_name;
+        size_t first_def;
+        map<string, HoistedRealize> realizes;
+    };
+    vector<Site> sites;
+
+    Stmt wrap(Stmt body, const Site &site) {
+        for (const auto &it : site.realizes) {
+            const HoistedRealize &r = it.second;
+            string slot_extent = it.first + ".ring_buffer.slot_extent";
+            Region bounds = r.bounds;
+            bounds[r.slot_dim].extent = Variable::make(Int(32), slot_extent) * r.buffers;
+            body = Realize::make(it.first, r.types, r.memory_type, bounds, const_true(), body);
+            body = LetStmt::make(slot_extent, r.bounds[r.slot_dim].extent, body);
+        }
+        return body;
+    }
+
+    // Substitute in the lets defined between the first def and the end,
+    // so that the bounds of an expression don't lose track of the
+    // correlation between the variables they define.
+    Expr substitute_lets(Expr e, size_t first, size_t end) const {
+        for (size_t i = end; i > first; i--) {
+            const Definition &d = defs[i - 1];
+            if (d.value.defined()) {
+                e = substitute(d.name, d.value, e);
+            }
+        }
+        return simplify(e);
+    }
+
+    Stmt visit(const For *op) override {
+        Expr min = mutate(op->min);
+        Expr extent = mutate(op->extent);
+        defs.push_back({op->name, min, extent, Expr()});
+        sites.push_back({op->name, defs.size(), {}});
+        Stmt body = mutate(op->body);
+        body = wrap(body, sites.back());
+        sites.pop_back();
+        defs.pop_back();
+        return For::make(op->name, min, extent, op->for_type, op->device_api, body);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        Expr value = mutate(op->value);
+        defs.push_back({op->name, Expr(), Expr(), value});
+        Stmt body = mutate(op->body);
+        defs.pop_back();
+        return LetStmt::make(op->name, value, body);
+    }
+
+    Stmt visit(const Realize *op) override {
+        auto it = env.find(op->name);
+        internal_assert(it != env.end());
+        const Function &f = it->second;
+        Expr buffers = f.schedule().ring_buffer();
+        if (!buffers.defined()) {
+            return IRMutator::visit(op);
+        }
+        const LoopLevel &level = f.schedule().hoist_storage_level();
+
+        // Find the innermost enclosing loop that matches the level.
+        int site = -1;
+        if (level.is_root()) {
+            site = 0;
+        } else {
+            for (int i = (int)sites.size() - 1; i > 0 && site < 0; i--) {
+                if (level.match(sites[i].loop_name)) {
+                    site = i;
+                }
+            }
+        }
+        internal_assert(site >= 0)
+            << "Could not find the hoist_storage level " << level.to_string()
+            << " of " << op->name << "\n";
+
+        // Bound the loop variables defined between the site and here.
+        size_t first = sites[site].first_def;
+        Scope<Interval> scope;
+        for (size_t i = first; i < defs.size(); i++) {
+            const Definition &d = defs[i];
+            if (!d.value.defined()) {
+                Expr min = substitute_lets(d.min, first, i);
+                Expr max = substitute_lets(d.min + d.extent - 1, first, i);
+                scope.push(d.name, Interval(bounds_of_expr_in_scope(min, scope).min,
+                                            bounds_of_expr_in_scope(max, scope).max));
+            }
+        }
+
+        // The slots are laid out one after the other along the outermost
+        // storage dimension.
+        const string &outermost = f.schedule().storage_dims().back().var;
+        int slot_dim = -1;
+        for (size_t i = 0; i < f.args().size(); i++) {
+            if (f.args()[i] == outermost) {
+                slot_dim = (int)i;
+            }
+        }
+        internal_assert(slot_dim >= 0);
+
+        Region bounds;
+        for (const Range &r : op->bounds) {
+            Expr extent = substitute_lets(r.extent, first, defs.size());
+            Interval interval = bounds_of_expr_in_scope(extent, scope);
+            user_assert(interval.has_upper_bound())
+                << "Can't ring-buffer " << op->name << " at " << level.to_string()
+                << ", as the extent " << r.extent << " of its storage has no upper bound there\n";
+            bounds.emplace_back(0, simplify(interval.max));
+        }
+
+        auto hoisted = sites[site].realizes.find(op->name);
+        if (hoisted == sites[site].realizes.end()) {
+            sites[site].realizes[op->name] = {op->types, op->memory_type, bounds, slot_dim, buffers};
+        } else {
+            // Another realization of the same Func, e.g. in a different
+            // specialization. The slots must be large enough for both.
+            Region &b = hoisted->second.bounds;
+            internal_assert(b.size() == bounds.size());
+            for (size_t i = 0; i < b.size(); i++) {
+                b[i].extent = simplify(max(b[i].extent, bounds[i].extent));
+            }
+        }
+
+        // The size of a slot isn't known until all the realizations
+        // hoisted to the site have been seen.
+        Expr slot = Variable::make(Int(32), op->name + ".ring_buffer.slot");
+        Expr slot_extent = Variable::make(Int(32), op->name + ".ring_buffer.slot_extent");
+        Stmt body = mutate(op->body);
+        return RingBufferAccesses(op->name, op->bounds, slot_dim, slot * slot_extent).mutate(body);
+    }
+};
+
+// Keep only the produce nodes of the given Funcs, and the loops, lets and
+// allocations around them.
+class ExtractProducers : public NoOpCollapsingMutator {
+    const set<string> &funcs;
+
+    using NoOpCollapsingMutator::visit;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer && funcs.count(op->name)) {
+            return op;
+        }
+        Stmt body = mutate(op->body);
+        if (is_no_op(body) || op->is_producer) {
+            return body;
+        } else {
+            return ProducerConsumer::make(op->name, op->is_producer, body);
+        }
+    }
+
+    Stmt visit(const Evaluate *) override {
+        return Evaluate::make(0);
+    }
+
+    Stmt visit(const Provide *) override {
+        return Evaluate::make(0);
+    }
+
+    Stmt visit(const Store *) override {
+        return Evaluate::make(0);
+    }
+
+    Stmt visit(const AssertStmt *) override {
+        return Evaluate::make(0);
+    }
+
+    Stmt visit(const Prefetch *) override {
+        return Evaluate::make(0);
+    }
+
+    Stmt visit(const Atomic *) override {
+        return Evaluate::make(0);
+    }
+
+public:
+    ExtractProducers(const set<string> &f)
+        : funcs(f) {
+    }
+};
+
+// Remove the produce nodes of the given Funcs.
+class RemoveProducers : public NoOpCollapsingMutator {
+    const set<string> &funcs;
+
+    using NoOpCollapsingMutator::visit;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer && funcs.count(op->name)) {
+            return Evaluate::make(0);
+        }
+        return NoOpCollapsingMutator::visit(op);
+    }
+
+public:
+    RemoveProducers(const set<string> &f)
+        : funcs(f) {
+    }
+};
+
+class FindProduceNodes : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->is_producer) {
+            names.insert(op->name);
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    set<string> names;
+};
+
+// Ring-buffered Funcs that aren't async are stored in GPU shared memory,
+// and are software-pipelined instead: in the innermost loop around their
+// produce nodes, each iteration produces the next iteration's slot
+// before consuming its own. The two touch different slots, so they are
+// put in a Fork, which lets the threads of a GPU block run them without
+// a barrier between them. The loads of the next tile are then in flight
+// while the current tile is being computed on.
+class PipelineRingBuffers : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, Function> &env;
+
+    // The ring buffers in scope that are not yet pipelined, with their
+    // number of slots.
+    map<string, Expr> pending;
+
+    Stmt visit(const Realize *op) override {
+        auto it = env.find(op->name);
+        internal_assert(it != env.end());
+        const FuncSchedule &schedule = it->second.schedule();
+        if (!schedule.ring_buffer().defined() || schedule.async()) {
+            return IRMutator::visit(op);
+        }
+        pending[op->name] = schedule.ring_buffer();
+        Stmt body = mutate(op->body);
+        if (pending.count(op->name)) {
+            // There are no loops between the storage and the compute
+            // level, so only one slot is ever used.
+            body = LetStmt::make(op->name + ".ring_buffer.slot", 0, body);
+            pending.erase(op->name);
+        }
+        return Realize::make(op->name, op->types, op->memory_type,
+                             op->bounds, op->condition, body);
+    }
+
+    Stmt visit(const For *op) override {
+        Stmt body = mutate(op->body);
+
+        FindProduceNodes produced;
+        body.accept(&produced);
+        set<string> funcs;
+        for (const auto &it : pending) {
+            if (produced.names.count(it.first)) {
+                funcs.insert(it.first);
+            }
+        }
+        if (funcs.empty()) {
+            return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
+
+        user_assert(op->for_type == ForType::Serial || op->for_type == ForType::Unrolled)
+            << "Can't pipeline the ring-buffered Func " << *funcs.begin()
+            << " over the loop " << op->name << ", as it is not serial.\n";
+
+        // Produce the first iteration before the loop, and each
+        // following one an iteration ahead. The Funcs don't depend on
+        // each other, so they are produced in a Fork too.
+        Expr loop_var = Variable::make(Int(32), op->name);
+        Stmt consumer = RemoveProducers(funcs).mutate(body);
+        Stmt first, next;
+        for (const string &f : funcs) {
+            Expr slot = (loop_var - op->min) % pending[f];
+            const set<string> one_func = {f};
+            Stmt producer = ExtractProducers(one_func).mutate(body);
+            producer = LetStmt::make(f + ".ring_buffer.slot", slot, producer);
+            consumer = LetStmt::make(f + ".ring_buffer.slot", slot, consumer);
+            Stmt p = substitute(op->name, op->min, producer);
+            Stmt n = substitute(op->name, loop_var + 1, producer);
+            first = first.defined() ? Fork::make(first, p) : p;
+            next = next.defined() ? Fork::make(next, n) : n;
+            pending.erase(f);
+        }
+
+        Stmt prologue = IfThenElse::make(op->extent > 0, first);
+        Stmt prefetch = IfThenElse::make(loop_var + 1 < op->min + op->extent, next);
+        Stmt loop = For::make(op->name, op->min, op->extent, op->for_type, op->device_api,
+                              Fork::make(prefetch, consumer));
+        return Block::make(prologue, loop);
+    }
+
+public:
+    PipelineRingBuffers(const map<string, Function> &e)
+        : env(e) {
+    }
+};
+
+// Track which slot of a ring buffer the produce or consume nodes of a Func
+// are using on one side of the fork, with a counter private to that side.
+// The producer waits for a free slot before producing into it, and the
+// consumer frees the slot once it has consumed it.
+class InjectRingBufferSlots : public IRMutator {
+    using IRMutator::visit;
+
+    const string &func;
+    bool is_producer;
+    Expr buffers, sema;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->name != func || op->is_producer != is_producer) {
+            return IRMutator::visit(op);
+        }
+        Expr count = Load::make(Int(32), counter_name(), 0, Buffer<>(), Parameter(), const_true(), ModulusRemainder());
+        Stmt increment = Store::make(counter_name(), count + 1, 0, Parameter(), const_true(), ModulusRemainder());
+        Stmt body;
+        if (is_producer) {
+            body = Block::make(op, increment);
+        } else {
+            Expr release = Call::make(Int(32), "halide_semaphore_release", {sema, 1}, Call::Extern);
+            body = Block::make({op, increment, Evaluate::make(release)});
+        }
+        body = LetStmt::make(func + ".ring_buffer.slot", count % buffers, body);
+        if (is_producer) {
+            body = Acquire::make(sema, 1, body);
+        }
+        return body;
+    }
+
+public:
+    InjectRingBufferSlots(const string &f, bool p, Expr b, Expr s)
+        : func(f), is_producer(p), buffers(std::move(b)), sema(std::move(s)) {
+    }
+
+    string counter_name() const {
+        return func + (is_producer ? ".ring_buffer.produced" : ".ring_buffer.consumed");
+    }
+
+    Stmt inject(const Stmt &s) {
+        Stmt body = mutate(s);
+        body = Block::make(Store::make(counter_name(), 0, 0, Parameter(), const_true(), ModulusRemainder()), body);
+        return Allocate::make(counter_name(), Int(32), MemoryType::Stack, {}, const_true(), body);
+    }
+};
+
 class ForkAsyncProducers : public IRMutator {
     using IRMutator::visit;
 
@@ -339,6 +782,19 @@ class ForkAsyncProducers : public IRMutator {
             Stmt producer = GenerateProducerBody(op->name, sema_vars, cloned_acquires).mutate(body);
             Stmt consumer = GenerateConsumerBody(op->name, sema_vars).mutate(body);
 
+            // A ring-buffered producer may run ahead of the consumer by as
+            // many iterations as there are slots.
+            Expr buffers = f.schedule().ring_buffer();
+            string ring_sema_name = op->name + ".ring_buffer.semaphore";
+            if (buffers.defined()) {
+                user_assert(consumes.count == 1)
+                    << "Ring-buffered Func " << op->name << " must be consumed in a single place "
+                    << "within its hoist_storage level, but it is consumed in " << consumes.count << ".\n";
+                Expr ring_sema = Variable::make(type_of<halide_semaphore_t *>(), ring_sema_name);
+                producer = InjectRingBufferSlots(op->name, true, buffers, ring_sema).inject(producer);
+                consumer = InjectRingBufferSlots(op->name, false, buffers, ring_sema).inject(consumer);
+            }
+
             // Recurse on both sides
             producer = mutate(producer);
             consumer = mutate(consumer);
@@ -363,6 +819,13 @@ class ForkAsyncProducers : public IRMutator {
                 body = LetStmt::make(sema_name, sema_space, body);
             }
 
+            if (buffers.defined()) {
+                // All of the slots start out free
+                Expr sema_space = Call::make(type_of<halide_semaphore_t *>(), "halide_make_semaphore",
+                                             {buffers}, Call::Extern);
+                body = LetStmt::make(ring_sema_name, sema_space, body);
+            }
+
             return Realize::make(op->name, op->types, op->memory_type,
                                  op->bounds, op->condition, body);
         } else {
@@ -706,6 +1169,8 @@ class TightenForkNodes : public IRMutator {
 }  // namespace
 
 Stmt fork_async_producers(Stmt s, const map<string, Function> &env) {
+    s = HoistRingBuffers(env).hoist(s);
+    s = PipelineRingBuffers(env).mutate(s);
     s = TightenProducerConsumerNodes(env).mutate(s);
     s = ForkAsyncProducers(env).mutate(s);
     s = ExpandAcquireNodes().mutate(s);
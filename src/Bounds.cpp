@@ -1,4 +1,5 @@
 #include <iostream>
+#include <unordered_map>
 #include <utility>
 
 #include "Bounds.h"
@@ -126,16 +127,20 @@ public:
     Bounds(const Scope<Interval> *s, const FuncValueBounds &fb, bool const_bound)
         : func_bounds(fb), const_bound(const_bound) {
         scope.set_containing_scope(s);
+    }
 
-        // Find any points that are single_points but fail is_single_point due to
-        // pointer equality checks and replace with single_points.
-        for (auto item = s->cbegin(); item != s->cend(); ++item) {
-            const Interval &item_interval = item.value();
-            if (!item_interval.is_single_point() &&
-                equal(item_interval.min, item_interval.max)) {
-                scope.push(item.name(), Interval::single_point(item_interval.min));
-            }
+    // Look up a variable in the scope. Intervals that are single points
+    // but fail is_single_point due to pointer equality checks are
+    // replaced with single_points. This is done here rather than for
+    // every entry in the scope up front, because the scopes built up
+    // while walking a large Stmt can be much larger than the number of
+    // variables in any one Expr.
+    Interval get_scope_interval(const string &name) const {
+        Interval i = scope.get(name);
+        if (!i.is_single_point() && equal(i.min, i.max)) {
+            i = Interval::single_point(i.min);
         }
+        return i;
     }
 
 #if DO_TRACK_BOUNDS_INTERVALS
@@ -375,7 +380,7 @@ private:
         if (const_bound) {
             bounds_of_type(op->type);
             if (scope.contains(op->name)) {
-                const Interval &scope_interval = scope.get(op->name);
+                Interval scope_interval = get_scope_interval(op->name);
                 if (scope_interval.has_upper_bound() && is_const(scope_interval.max)) {
                     interval.max = Interval::make_min(interval.max, scope_interval.max);
                 }
@@ -398,7 +403,7 @@ private:
             }
         } else {
             if (scope.contains(op->name)) {
-                interval = scope.get(op->name);
+                interval = get_scope_interval(op->name);
             } else if (op->type.is_vector()) {
                 // Uh oh, we need to take the min/max lane of some unknown vector. Treat as unbounded.
                 bounds_of_type(op->type);
@@ -1716,8 +1721,140 @@ Interval bounds_of_expr_in_scope_with_indent(const Expr &expr, const Scope<Inter
 
 }  // namespace
 
+struct BoundsQueryCache::Contents {
+    // The variables and Funcs an Expr refers to, so that the scope
+    // entries that matter can be looked up without walking it again.
+    struct Uses {
+        vector<string> vars;
+        vector<pair<string, int>> funcs;
+    };
+    std::unordered_map<const IRNode *, Uses> uses;
+
+    // Queries are keyed on the pointers of everything they depend on.
+    map<vector<const void *>, Interval> results;
+
+    // Keeps everything whose pointers appear in a key alive, so that
+    // the pointers can't be reused by other nodes.
+    vector<Expr> keep_alive;
+
+    size_t hits = 0;
+};
+
+namespace {
+
+thread_local BoundsQueryCache::Contents *active_bounds_query_cache = nullptr;
+
+class FindUses : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    set<string> seen_vars;
+    set<pair<string, int>> seen_funcs;
+
+    void visit(const Variable *op) override {
+        if (seen_vars.insert(op->name).second) {
+            uses.vars.push_back(op->name);
+        }
+    }
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        if (op->call_type == Call::Halide ||
+            op->call_type == Call::Image) {
+            pair<string, int> key = {op->name, op->value_index};
+            if (seen_funcs.insert(key).second) {
+                uses.funcs.push_back(key);
+            }
+        }
+    }
+
+public:
+    BoundsQueryCache::Contents::Uses uses;
+};
+
+// Stands in for the interval of a name that isn't in scope.
+const char not_in_scope = 0;
+
+}  // namespace
+
+BoundsQueryCache::BoundsQueryCache() {
+    if (!active_bounds_query_cache) {
+        contents = std::make_unique<Contents>();
+        active_bounds_query_cache = contents.get();
+    }
+}
+
+BoundsQueryCache::~BoundsQueryCache() {
+    if (contents) {
+        active_bounds_query_cache = nullptr;
+    }
+}
+
+size_t BoundsQueryCache::hits() const {
+    if (contents) {
+        return contents->hits;
+    } else if (active_bounds_query_cache) {
+        return active_bounds_query_cache->hits;
+    } else {
+        return 0;
+    }
+}
+
 Interval bounds_of_expr_in_scope(const Expr &expr, const Scope<Interval> &scope, const FuncValueBounds &fb, bool const_bound) {
-    return bounds_of_expr_in_scope_with_indent(expr, scope, fb, const_bound, 0);
+    BoundsQueryCache::Contents *cache = active_bounds_query_cache;
+    if (!cache || !expr.defined()) {
+        return bounds_of_expr_in_scope_with_indent(expr, scope, fb, const_bound, 0);
+    }
+
+    auto it = cache->uses.find(expr.get());
+    if (it == cache->uses.end()) {
+        FindUses finder;
+        expr.accept(&finder);
+        it = cache->uses.emplace(expr.get(), std::move(finder.uses)).first;
+        cache->keep_alive.push_back(expr);
+    }
+    const BoundsQueryCache::Contents::Uses &uses = it->second;
+
+    vector<const void *> key;
+    key.reserve(2 + 2 * (uses.vars.size() + uses.funcs.size()));
+    key.push_back(expr.get());
+    key.push_back(const_bound ? &not_in_scope : nullptr);
+    vector<Expr> bindings;
+    auto add_interval = [&](const Interval &i) {
+        key.push_back(i.min.get());
+        key.push_back(i.max.get());
+        bindings.push_back(i.min);
+        bindings.push_back(i.max);
+    };
+    for (const string &v : uses.vars) {
+        if (scope.contains(v)) {
+            add_interval(scope.get(v));
+        } else {
+            key.push_back(&not_in_scope);
+        }
+    }
+    for (const auto &f : uses.funcs) {
+        auto fb_it = fb.find(f);
+        if (fb_it != fb.end()) {
+            add_interval(fb_it->second);
+        } else {
+            key.push_back(&not_in_scope);
+        }
+    }
+
+    auto result = cache->results.find(key);
+    if (result != cache->results.end()) {
+        cache->hits++;
+        return result->second;
+    }
+
+    Interval i = bounds_of_expr_in_scope_with_indent(expr, scope, fb, const_bound, 0);
+    cache->results.emplace(std::move(key), i);
+    for (Expr &e : bindings) {
+        if (e.defined()) {
+            cache->keep_alive.push_back(std::move(e));
+        }
+    }
+    return i;
 }
 
 Region region_union(const Region &a, const Region &b) {
@@ -3761,6 +3898,34 @@ void bounds_test() {
         internal_assert(in.is_single_point());
     }
 
+    // Memoized queries
+    {
+        Var x("x"), y("y");
+        Expr e = x * 2 + y;
+        Scope<Interval> scope;
+        scope.push("x", Interval(0, 10));
+        BoundsQueryCache cache;
+        {
+            // An inner cache reuses the outer one.
+            BoundsQueryCache inner;
+        }
+        check(scope, e, 0, 20);
+        check(scope, e, 0, 20);
+        internal_assert(cache.hits() == 1);
+        // A binding for a variable the Expr refers to makes a new query.
+        scope.push("y", Interval(1, 1));
+        check(scope, e, 1, 21);
+        internal_assert(cache.hits() == 1);
+        // Bindings for other names don't.
+        scope.push("z", Interval(0, 5));
+        check(scope, e, 1, 21);
+        internal_assert(cache.hits() == 2);
+        scope.pop("z");
+        scope.pop("y");
+        check(scope, e, 0, 20);
+        internal_assert(cache.hits() == 3);
+    }
+
     std::cout << "Bounds test passed" << std::endl;
 }
 
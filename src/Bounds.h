@@ -6,6 +6,8 @@
  * and the regions of a function read or written by a statement.
  */
 
+#include <memory>
+
 #include "Interval.h"
 #include "Scope.h"
 
@@ -35,6 +37,35 @@ Interval bounds_of_expr_in_scope(const Expr &expr,
                                  const FuncValueBounds &func_bounds = empty_func_value_bounds(),
                                  bool const_bound = false);
 
+/** While an instance of this class is alive, calls to
+ * bounds_of_expr_in_scope on the same thread are memoized. A query is
+ * answered from the cache if it is for the same Expr (by identity) as
+ * an earlier one with the same const_bound flag, and if every variable
+ * and Func the Expr refers to has the same (again by identity) interval
+ * in the scope and the func value bounds as it did then. Pushing, popping or changing any of those
+ * entries therefore makes a different query rather than needing to
+ * invalidate anything. Passes that ask for the bounds of the same
+ * expressions over and over create one of these for their duration.
+ * Instances may be nested, in which case the outermost one holds the
+ * cache. */
+class BoundsQueryCache {
+public:
+    struct Contents;
+
+private:
+    std::unique_ptr<Contents> contents;
+
+public:
+    BoundsQueryCache();
+    ~BoundsQueryCache();
+
+    BoundsQueryCache(const BoundsQueryCache &) = delete;
+    BoundsQueryCache &operator=(const BoundsQueryCache &) = delete;
+
+    /** The number of queries answered from the cache, for testing. */
+    size_t hits() const;
+};
+
 /** Given a varying expression, try to find a constant that is either:
  * An upper bound (always greater than or equal to the expression), or
  * A lower bound (always less than or equal to the expression)
@@ -1346,6 +1346,9 @@ Stmt bounds_inference(Stmt s,
                       const FuncValueBounds &func_bounds,
                       const Target &target) {
 
+    // Many of the same bounds queries are made once per consumer.
+    BoundsQueryCache bounds_cache;
+
     vector<Function> funcs(order.size());
     for (size_t i = 0; i < order.size(); i++) {
         funcs[i] = env.find(order[i])->second;
@@ -1,4 +1,5 @@
 #include <map>
+#include <unordered_map>
 
 #include "CSE.h"
 #include "IREquality.h"
@@ -75,8 +76,6 @@ public:
     struct Entry {
         Expr expr;
         int use_count = 0;
-        // All consumer Exprs for which this is the last child Expr.
-        map<ExprWithCompareCache, int> uses;
         Entry(const Expr &e)
             : expr(e) {
         }
@@ -84,14 +83,24 @@ public:
     vector<std::unique_ptr<Entry>> entries;
 
     map<Expr, int, ExprCompare> shallow_numbering, output_numbering;
-    map<ExprWithCompareCache, int> leaves;
 
-    int number = -1;
+    // The children of an Expr are rebuilt from the numbering before
+    // it is looked up, so they are already canonical and their hashes
+    // are cached. Hashing or comparing the Expr itself then only has
+    // to look at its own fields.
+    struct HashExpr {
+        IRHasher *hasher;
+        size_t operator()(const Expr &e) const {
+            return (size_t)hasher->hash(e);
+        }
+    };
+    IRHasher hasher;
+    std::unordered_map<Expr, int, HashExpr, IRDeepEqual> numbering;
 
-    IRCompareCache cache;
+    int number = -1;
 
     GVN()
-        : number(0), cache(8) {
+        : numbering(0, HashExpr{&hasher}), number(0) {
     }
 
     Stmt mutate(const Stmt &s) override {
@@ -99,10 +108,6 @@ public:
         return Stmt();
     }
 
-    ExprWithCompareCache with_cache(const Expr &e) {
-        return ExprWithCompareCache(e, &cache);
-    }
-
     Expr mutate(const Expr &e) override {
         // Early out if we've already seen this exact Expr.
         {
@@ -114,26 +119,18 @@ public:
         }
 
         // We haven't seen this exact Expr before. Rebuild it using
-        // things already in the numbering.
-        number = -1;
+        // things already in the numbering, and see if an equal Expr
+        // is already in there too.
         Expr new_e = IRMutator::mutate(e);
-
-        // 'number' is now set to the numbering for the last child of
-        // this Expr (or -1 if there are no children). Next we see if
-        // that child has an identical parent to this one.
-
-        auto &use_map = number == -1 ? leaves : entries[number]->uses;
-        auto p = use_map.emplace(with_cache(new_e), (int)entries.size());
-        auto iter = p.first;
-        bool novel = p.second;
-        if (novel) {
+        auto p = numbering.emplace(new_e, (int)entries.size());
+        number = p.first->second;
+        if (p.second) {
             // This is a never-before-seen Expr
-            number = (int)entries.size();
-            iter->second = number;
             entries.emplace_back(new Entry(new_e));
         } else {
-            // This child already has a syntactically-equal parent
-            number = iter->second;
+            // An equal Expr is already numbered. The hasher caches by
+            // address, and the rebuilt Expr may be about to die.
+            hasher.forget(new_e);
             new_e = entries[number]->expr;
         }
 
@@ -302,6 +302,9 @@ private:
     const std::vector<Argument> &arguments() const;
 
 public:
+    template<typename... Args>
+    class Bound;
+
     /** Construct a default Callable. This is not usable (trying to call it will fail).
      * The defined() method will return false. */
     Callable();
@@ -386,6 +389,19 @@ public:
         }
     }
 
+    /** Bind the Callable to a fixed signature, for calling it many times with
+     * as little overhead as possible. The argument types are checked (in the
+     * same way as make_std_function()) once, here; each call to the resulting
+     * Bound just packs its arguments into an argv array on the stack and
+     * jumps to the argv entry point, with no heap allocation and no further
+     * checking. Unlike make_std_function(), there is no type erasure, so the
+     * packing can be inlined at the call site. The signature must not include
+     * the JITUserContext; the Bound can be called with or without one. */
+    template<typename... Args>
+    Bound<Args...> bind() const {
+        return Bound<Args...>(*this);
+    }
+
     /** Unsafe low-overhead way of invoking the Callable.
      *
      * This function relies on the same calling convention as the argv-based
@@ -405,6 +421,51 @@ public:
     int call_argv_fast(size_t argc, const void *const *argv) const;
 };
 
+/** A Callable with a signature that has been checked by Callable::bind(). */
+template<typename... Args>
+class Callable::Bound {
+    friend class Callable;
+
+    static_assert(!(std::is_same_v<std::remove_cv_t<std::remove_reference_t<Args>>, JITUserContext *> || ...),
+                  "The signature passed to Callable::bind() must not include the JITUserContext.");
+
+    Callable callable;
+
+    // Set if the signature didn't match, in which case every call fails
+    // (rather than packing the arguments wrongly).
+    FailureFn failure_fn;
+
+    explicit Bound(const Callable &c)
+        : callable(c) {
+        constexpr auto actual_arg_types = make_fcci_array<JITUserContext *, Args...>();
+        failure_fn = c.check_fcci(actual_arg_types.size(), actual_arg_types.data());
+    }
+
+public:
+    /** Construct an empty Bound. This is not usable (trying to call it will crash). */
+    Bound() = default;
+
+    bool defined() const {
+        return callable.defined();
+    }
+
+    HALIDE_FUNCTION_ATTRS int
+    operator()(JITUserContext *context, const Args &...args) const {
+        if (failure_fn) {
+            return failure_fn(context);
+        }
+        constexpr size_t count = 1 + sizeof...(Args);
+        ArgvStorage<count> argv(context, args...);
+        return callable.call_argv_fast(count, &argv.argv[0]);
+    }
+
+    HALIDE_FUNCTION_ATTRS int
+    operator()(const Args &...args) const {
+        JITUserContext empty;
+        return (*this)(&empty, args...);
+    }
+};
+
 }  // namespace Halide
 
 #endif
@@ -6,11 +6,13 @@
 #include "CodeGen_Posix.h"
 #include "ConciseCasts.h"
 #include "Debug.h"
+#include "Deinterleave.h"
 #include "IREquality.h"
 #include "IRMatch.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
+#include "IRVisitor.h"
 #include "LLVM_Headers.h"
 #include "Simplify.h"
 #include "Substitute.h"
@@ -96,6 +98,280 @@ class SubstituteInStridedLoads : public IRMutator {
     using IRMutator::visit;
 };
 
+// Rewrite sums of products that compute 2x2 tiles of a matrix
+// multiply to the matrix multiply-accumulate instructions of i8mm
+// (2x8 int8 times 8x2 int8) and bf16 (2x4 bfloat16 times 4x2 bfloat16).
+// These arise from vectorizing a reduction by a multiple of 8 (or 4),
+// and the output over a 2x2 tile, with result lanes i * 2 + j.
+class FindMatrixMultiplies : public IRMutator {
+    using IRMutator::visit;
+
+    const Target &target;
+
+    // The enclosing lets, and the number of stores visited when they
+    // were defined, if they load from memory. A let that loads from
+    // memory can't be substituted past a store.
+    struct LetValue {
+        Expr value;
+        int stores;
+    };
+    Scope<LetValue> lets;
+    int stores = 0;
+
+    // Substitute in the enclosing lets, so the lanes of the operands
+    // can be compared. Returns an undefined Expr if that isn't safe.
+    Expr expand(const Expr &e) {
+        class Expand : public IRMutator {
+            using IRMutator::visit;
+
+            Expr visit(const Variable *op) override {
+                if (!lets.contains(op->name)) {
+                    return op;
+                }
+                auto it = expanded.find(op->name);
+                if (it != expanded.end()) {
+                    return it->second;
+                }
+                const LetValue &l = lets.get(op->name);
+                if (l.stores >= 0 && l.stores != stores) {
+                    ok = false;
+                    return op;
+                }
+                Expr value = mutate(l.value);
+                expanded[op->name] = value;
+                return value;
+            }
+
+            const Scope<LetValue> &lets;
+            int stores;
+            std::map<string, Expr> expanded;
+
+        public:
+            bool ok = true;
+
+            Expand(const Scope<LetValue> &lets, int stores)
+                : lets(lets), stores(stores) {
+            }
+        } expander(lets, stores);
+        Expr result = expander.mutate(e);
+        return expander.ok ? result : Expr();
+    }
+
+    // Check that the lanes of e for each 2x2 element of group g of
+    // result lanes, each reducing factor lanes, only depend on the row
+    // (or the column).
+    bool depends_only_on(const Expr &e, int g, int factor, bool row) {
+        int base = g * 4 * factor;
+        for (int i = 0; i < 2; i++) {
+            // The lanes of the elements (i, 1) and (i, 0) for a row
+            // operand, or (1, i) and (0, i) for a column operand.
+            int a = row ? (i * 2 + 1) : (2 + i);
+            int b = row ? (i * 2) : i;
+            if (!equal(extract_lanes(e, base + a * factor, 1, factor),
+                       extract_lanes(e, base + b * factor, 1, factor))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The lanes of the two rows (or columns) of e in group g of result
+    // lanes, for the given chunk of depth lanes of the reduction.
+    Expr operand(const Expr &e, int g, int factor, int chunk, int depth, bool row) {
+        int base = g * 4 * factor + chunk * depth;
+        int stride = row ? 2 : 1;
+        return Shuffle::make_concat({extract_lanes(e, base, 1, depth),
+                                     extract_lanes(e, base + stride * factor, 1, depth)});
+    }
+
+    Expr visit_matrix_multiply(const VectorReduce *op, const Expr &init) {
+        if (op->op != VectorReduce::Add ||
+            op->type.lanes() % 4 != 0) {
+            return Expr();
+        }
+
+        Expr wild_i8x = Variable::make(Int(8, 0), "*");
+        Expr wild_u8x = Variable::make(UInt(8, 0), "*");
+        Expr wild_f32x = Variable::make(Float(32, 0), "*");
+        struct Pattern {
+            Expr pattern;
+            Target::Feature required_feature;
+            int depth;
+            Type narrow_type;
+        };
+        const Pattern patterns[] = {
+            {i32(widening_mul(wild_i8x, wild_i8x)), Target::ARMI8mm, 8},
+            {i32(widening_mul(wild_u8x, wild_u8x)), Target::ARMI8mm, 8},
+            {u32(widening_mul(wild_u8x, wild_u8x)), Target::ARMI8mm, 8},
+            {i32(widening_mul(wild_u8x, wild_i8x)), Target::ARMI8mm, 8},
+            {i32(widening_mul(wild_i8x, wild_u8x)), Target::ARMI8mm, 8},
+            {wild_f32x * wild_f32x, Target::ARMBf16, 4, BFloat(16)},
+        };
+
+        int factor = op->value.type().lanes() / op->type.lanes();
+        Expr value = expand(op->value);
+        if (!value.defined()) {
+            return Expr();
+        }
+        vector<Expr> matches;
+        for (const Pattern &p : patterns) {
+            if (factor % p.depth != 0 ||
+                !target.has_feature(p.required_feature) ||
+                !expr_match(p.pattern, value, matches)) {
+                continue;
+            }
+            Expr a = matches[0], b = matches[1];
+            if (p.narrow_type.bits() > 0) {
+                a = lossless_cast(p.narrow_type.with_lanes(a.type().lanes()), a);
+                b = lossless_cast(p.narrow_type.with_lanes(b.type().lanes()), b);
+                if (!a.defined() || !b.defined()) {
+                    continue;
+                }
+            }
+
+            vector<Expr> groups;
+            for (int g = 0; g < op->type.lanes() / 4; g++) {
+                if (!depends_only_on(a, g, factor, true) ||
+                    !depends_only_on(b, g, factor, false)) {
+                    if (depends_only_on(b, g, factor, true) &&
+                        depends_only_on(a, g, factor, false)) {
+                        std::swap(a, b);
+                    } else {
+                        return Expr();
+                    }
+                }
+
+                // There is only an unsigned times signed instruction,
+                // so compute the transpose of the tile if the rows
+                // are the signed operand.
+                Expr rows = a, columns = b;
+                bool transpose = a.type().is_int() && b.type().is_uint();
+                if (transpose) {
+                    std::swap(rows, columns);
+                }
+
+                Type t = op->type.with_lanes(4);
+                Expr acc = init.defined() ? extract_lanes(init, g * 4, 1, 4) : make_zero(t);
+                if (transpose) {
+                    acc = Shuffle::make({acc}, {0, 2, 1, 3});
+                }
+                for (int c = 0; c < factor / p.depth; c++) {
+                    acc = Call::make(t, "matrix_multiply",
+                                     {acc,
+                                      operand(rows, g, factor, c, p.depth, !transpose),
+                                      operand(columns, g, factor, c, p.depth, transpose)},
+                                     Call::PureExtern);
+                }
+                if (transpose) {
+                    acc = Shuffle::make({acc}, {0, 2, 1, 3});
+                }
+                groups.push_back(acc);
+            }
+            debug(4) << "Using matrix multiplies for " << Expr(op) << "\n";
+            return Shuffle::make_concat(groups);
+        }
+        return Expr();
+    }
+
+    Expr visit(const VectorReduce *op) override {
+        Expr e = visit_matrix_multiply(op, Expr());
+        return e.defined() ? e : IRMutator::visit(op);
+    }
+
+    Expr visit(const Add *op) override {
+        const VectorReduce *a = op->a.as<VectorReduce>();
+        const VectorReduce *b = op->b.as<VectorReduce>();
+        Expr e;
+        if (b) {
+            e = visit_matrix_multiply(b, mutate(op->a));
+        }
+        if (!e.defined() && a) {
+            e = visit_matrix_multiply(a, mutate(op->b));
+        }
+        return e.defined() ? e : IRMutator::visit(op);
+    }
+
+    template<typename LetOrLetStmt>
+    auto visit_let(const LetOrLetStmt *op) -> decltype(op->body) {
+        class HasLoad : public IRVisitor {
+            using IRVisitor::visit;
+
+            void visit(const Load *op) override {
+                result = true;
+            }
+
+        public:
+            bool result = false;
+        } has_load;
+        op->value.accept(&has_load);
+
+        auto value = mutate(op->value);
+        ScopedBinding<LetValue> bind(lets, op->name, {op->value, has_load.result ? stores : -1});
+        auto body = mutate(op->body);
+        if (value.same_as(op->value) && body.same_as(op->body)) {
+            return op;
+        }
+        return LetOrLetStmt::make(op->name, value, body);
+    }
+
+    Expr visit(const Let *op) override {
+        return visit_let(op);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        return visit_let(op);
+    }
+
+    // Calls with side effects may write to memory too.
+    static bool writes_memory(const Call *op) {
+        return !op->is_pure() && op->call_type != Call::Image && op->call_type != Call::Halide;
+    }
+
+    Stmt visit(const Store *op) override {
+        Stmt s = IRMutator::visit(op);
+        stores++;
+        return s;
+    }
+
+    Expr visit(const Call *op) override {
+        Expr e = IRMutator::visit(op);
+        if (writes_memory(op)) {
+            stores++;
+        }
+        return e;
+    }
+
+    Stmt visit(const For *op) override {
+        // A store in a later iteration of the loop happens after the
+        // lets outside the loop, and before the loads in this one.
+        class HasStore : public IRVisitor {
+            using IRVisitor::visit;
+
+            void visit(const Store *op) override {
+                result = true;
+            }
+
+            void visit(const Call *op) override {
+                result |= writes_memory(op);
+                IRVisitor::visit(op);
+            }
+
+        public:
+            bool result = false;
+        } has_store;
+        op->body.accept(&has_store);
+        if (has_store.result) {
+            stores++;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    FindMatrixMultiplies(const Target &target)
+        : target(target) {
+    }
+};
+
 /** A code generator that emits ARM code from a given Halide stmt. */
 class CodeGen_ARM : public CodeGen_Posix {
 public:
@@ -126,7 +402,20 @@ protected:
     void visit(const LT *) override;
     void visit(const LE *) override;
     void codegen_vector_reduce(const VectorReduce *, const Expr &) override;
+    void codegen_predicated_load(const Load *) override;
+    void codegen_predicated_store(const Store *) override;
+    // @}
+
+    /** SVE gathers and scatters, for loads and stores that aren't dense.
+     * The mask may be null, in which case all lanes are active. */
+    // @{
+    Value *codegen_sve_gather(const Load *op, Value *mask);
+    void codegen_sve_scatter(const Store *op, Value *mask);
     // @}
+
+    /** Emit a ramp(base, 1) < limit comparison as an SVE whilelt. Returns
+     * null if the comparison is not of that form. */
+    Value *codegen_sve_while(const Expr &a, const Expr &b, bool or_equal);
     Type upgrade_type_for_arithmetic(const Type &t) const override;
     Type upgrade_type_for_argument_passing(const Type &t) const override;
     Type upgrade_type_for_storage(const Type &t) const override;
@@ -147,6 +436,13 @@ protected:
     string mattrs() const override;
     bool use_soft_float_abi() const override;
     int native_vector_bits() const override;
+    int target_vscale() const override;
+
+    // SVE is used when the vector length is known, in which case vectors
+    // are scalable vectors with a fixed vscale.
+    bool sve_enabled() const {
+        return target_vscale() != 0;
+    }
 
     // NEON can be disabled for older processors.
     bool neon_intrinsics_disabled() {
@@ -296,6 +592,8 @@ struct ArmIntrinsic {
         SplitArg0 = 1 << 6,          // This intrinsic requires splitting the argument into the low and high halves.
         NoPrefix = 1 << 7,           // Don't prefix the intrinsic with llvm.*
         RequireFp16 = 1 << 8,        // Available only if Target has ARMFp16 feature
+        RequireI8mm = 1 << 9,        // Available only if Target has ARMI8mm feature
+        RequireBf16 = 1 << 10,       // Available only if Target has ARMBf16 feature
     };
 };
 
@@ -649,6 +947,16 @@ const ArmIntrinsic intrinsic_defs[] = {
     {nullptr, "udot.v4i32.v16i8", Int(32, 4), "dot_product", {Int(32, 4), UInt(8, 16), UInt(8, 16)}, ArmIntrinsic::NoMangle},
     {nullptr, "udot.v4i32.v16i8", UInt(32, 4), "dot_product", {UInt(32, 4), UInt(8, 16), UInt(8, 16)}, ArmIntrinsic::NoMangle},
 
+    // SMMLA, UMMLA, USMMLA, BFMMLA - Matrix multiply-accumulate of 2x2 tiles.
+    // The first operand holds the rows of the left matrix, and the second the
+    // columns of the right matrix.
+    {nullptr, "smmla.v4i32.v16i8", Int(32, 4), "matrix_multiply", {Int(32, 4), Int(8, 16), Int(8, 16)}, ArmIntrinsic::NoMangle | ArmIntrinsic::RequireI8mm},
+    {nullptr, "ummla.v4i32.v16i8", Int(32, 4), "matrix_multiply", {Int(32, 4), UInt(8, 16), UInt(8, 16)}, ArmIntrinsic::NoMangle | ArmIntrinsic::RequireI8mm},
+    {nullptr, "ummla.v4i32.v16i8", UInt(32, 4), "matrix_multiply", {UInt(32, 4), UInt(8, 16), UInt(8, 16)}, ArmIntrinsic::NoMangle | ArmIntrinsic::RequireI8mm},
+    {nullptr, "usmmla.v4i32.v16i8", Int(32, 4), "matrix_multiply", {Int(32, 4), UInt(8, 16), Int(8, 16)}, ArmIntrinsic::NoMangle | ArmIntrinsic::RequireI8mm},
+    // LLVM's bfmmla takes bfloat vectors, which Halide represents as uint16.
+    {nullptr, "bfmmla_f32x4", Float(32, 4), "matrix_multiply", {Float(32, 4), BFloat(16, 8), BFloat(16, 8)}, ArmIntrinsic::NoMangle | ArmIntrinsic::NoPrefix | ArmIntrinsic::RequireBf16},
+
     // ABDL - Widening absolute difference
     // The ARM backend folds both signed and unsigned widening casts of absd to a widening_absd, so we need to handle both signed and
     // unsigned input and return types.
@@ -752,6 +1060,12 @@ void CodeGen_ARM::init_module() {
         if (intrin.flags & ArmIntrinsic::RequireFp16 && !target.has_feature(Target::ARMFp16)) {
             continue;
         }
+        if (intrin.flags & ArmIntrinsic::RequireI8mm && !target.has_feature(Target::ARMI8mm)) {
+            continue;
+        }
+        if (intrin.flags & ArmIntrinsic::RequireBf16 && !target.has_feature(Target::ARMBf16)) {
+            continue;
+        }
         // Get the name of the intrinsic with the appropriate prefix.
         const char *intrin_name = nullptr;
         if (target.bits == 32) {
@@ -853,6 +1167,12 @@ void CodeGen_ARM::compile_func(const LoweredFunc &f,
         func.body = SubstituteInStridedLoads().mutate(func.body);
     }
 
+    if (target.bits == 64 &&
+        !neon_intrinsics_disabled() &&
+        target.features_any_of({Target::ARMI8mm, Target::ARMBf16})) {
+        func.body = FindMatrixMultiplies(target).mutate(func.body);
+    }
+
     CodeGen_Posix::compile_func(func, simple_name, extern_name);
 }
 
@@ -989,6 +1309,12 @@ void CodeGen_ARM::visit(const Store *op) {
     // A dense store of an interleaving can be done using a vst2 intrinsic
     const Ramp *ramp = op->index.as<Ramp>();
 
+    if (sve_enabled() && op->value.type().is_vector() && !ramp &&
+        op->value.type() == upgrade_type_for_storage(op->value.type())) {
+        codegen_sve_scatter(op, nullptr);
+        return;
+    }
+
     // We only deal with ramps here
     if (!ramp) {
         CodeGen_Posix::visit(op);
@@ -1171,6 +1497,16 @@ void CodeGen_ARM::visit(const Load *op) {
     }
 
     const Ramp *ramp = op->index.as<Ramp>();
+    const IntImm *stride = ramp ? ramp->stride.as<IntImm>() : nullptr;
+
+    // Without NEON-style strided load builtins, anything but a dense
+    // load is a gather.
+    if (sve_enabled() && op->type.is_vector() &&
+        !(stride && (-1 <= stride->value && stride->value <= 1)) &&
+        op->type == upgrade_type_for_storage(op->type)) {
+        value = codegen_sve_gather(op, nullptr);
+        return;
+    }
 
     // We only deal with ramps here
     if (!ramp) {
@@ -1179,7 +1515,6 @@ void CodeGen_ARM::visit(const Load *op) {
     }
 
     // If the stride is in [-1, 1], we can deal with that using vanilla codegen
-    const IntImm *stride = ramp ? ramp->stride.as<IntImm>() : nullptr;
     if (stride && (-1 <= stride->value && stride->value <= 1)) {
         CodeGen_Posix::visit(op);
         return;
@@ -1347,6 +1682,11 @@ void CodeGen_ARM::visit(const Call *op) {
 }
 
 void CodeGen_ARM::visit(const LT *op) {
+    if (Value *mask = codegen_sve_while(op->a, op->b, false)) {
+        value = mask;
+        return;
+    }
+
     if (op->a.type().is_float() && op->type.is_vector()) {
         // Fast-math flags confuse LLVM's aarch64 backend, so
         // temporarily clear them for this instruction.
@@ -1361,6 +1701,11 @@ void CodeGen_ARM::visit(const LT *op) {
 }
 
 void CodeGen_ARM::visit(const LE *op) {
+    if (Value *mask = codegen_sve_while(op->a, op->b, true)) {
+        value = mask;
+        return;
+    }
+
     if (op->a.type().is_float() && op->type.is_vector()) {
         // Fast-math flags confuse LLVM's aarch64 backend, so
         // temporarily clear them for this instruction.
@@ -1374,6 +1719,67 @@ void CodeGen_ARM::visit(const LE *op) {
     CodeGen_Posix::visit(op);
 }
 
+Value *CodeGen_ARM::codegen_sve_gather(const Load *op, Value *mask) {
+    Value *base = codegen_buffer_pointer(op->name, op->type.element_of(), make_zero(Int(32)));
+    Value *index = codegen(op->index);
+    Value *ptrs = builder->CreateInBoundsGEP(llvm_type_of(op->type.element_of()), base, index);
+    Instruction *gather = builder->CreateMaskedGather(llvm_type_of(op->type), ptrs,
+                                                      llvm::Align(op->type.bytes()), mask);
+    add_tbaa_metadata(gather, op->name, op->index);
+    return gather;
+}
+
+void CodeGen_ARM::codegen_sve_scatter(const Store *op, Value *mask) {
+    Type value_type = op->value.type();
+    Value *val = codegen(op->value);
+    Value *base = codegen_buffer_pointer(op->name, value_type.element_of(), make_zero(Int(32)));
+    Value *index = codegen(op->index);
+    Value *ptrs = builder->CreateInBoundsGEP(llvm_type_of(value_type.element_of()), base, index);
+    Instruction *scatter = builder->CreateMaskedScatter(val, ptrs, llvm::Align(value_type.bytes()), mask);
+    add_tbaa_metadata(scatter, op->name, op->index);
+}
+
+void CodeGen_ARM::codegen_predicated_load(const Load *op) {
+    const Ramp *ramp = op->index.as<Ramp>();
+    if (sve_enabled() && !(ramp && is_const_one(ramp->stride))) {
+        value = codegen_sve_gather(op, codegen(op->predicate));
+    } else {
+        CodeGen_Posix::codegen_predicated_load(op);
+    }
+}
+
+void CodeGen_ARM::codegen_predicated_store(const Store *op) {
+    const Ramp *ramp = op->index.as<Ramp>();
+    if (sve_enabled() && !(ramp && is_const_one(ramp->stride)) && !emit_atomic_stores) {
+        codegen_sve_scatter(op, codegen(op->predicate));
+    } else {
+        CodeGen_Posix::codegen_predicated_store(op);
+    }
+}
+
+Value *CodeGen_ARM::codegen_sve_while(const Expr &a, const Expr &b, bool or_equal) {
+    // The predicates of loops vectorized with TailStrategy::Predicate
+    // compare a dense ramp of the loop variable to the loop end.
+    const Ramp *ramp = a.as<Ramp>();
+    const Broadcast *limit = b.as<Broadcast>();
+    if (!sve_enabled() || !ramp || !limit || !is_const_one(ramp->stride) ||
+        ramp->base.type() != Int(32) || ramp->lanes % target_vscale() != 0) {
+        return nullptr;
+    }
+
+    // Lane i is active if i < limit - base. The count is clamped at zero,
+    // as whilelt compares unsigned values.
+    Expr count = limit->value - ramp->base;
+    if (or_equal) {
+        count += 1;
+    }
+    count = simplify(max(count, 0));
+    llvm::Type *mask_type = llvm_type_of(Bool(ramp->lanes));
+    llvm::Function *fn = llvm::Intrinsic::getDeclaration(module.get(), llvm::Intrinsic::get_active_lane_mask,
+                                                         {mask_type, i32_t});
+    return builder->CreateCall(fn, {ConstantInt::get(i32_t, 0), codegen(count)});
+}
+
 void CodeGen_ARM::codegen_vector_reduce(const VectorReduce *op, const Expr &init) {
     if (neon_intrinsics_disabled() ||
         op->op == VectorReduce::Or ||
@@ -1593,6 +1999,16 @@ string CodeGen_ARM::mattrs() const {
             separator = ",";
         }
 
+        if (target.has_feature(Target::ARMI8mm)) {
+            arch_flags += separator + "+i8mm";
+            separator = ",";
+        }
+
+        if (target.has_feature(Target::ARMBf16)) {
+            arch_flags += separator + "+bf16";
+            separator = ",";
+        }
+
         if (target.os == Target::IOS || target.os == Target::OSX) {
             return arch_flags + separator + "+reserve-x18";
         } else {
@@ -1611,9 +2027,24 @@ bool CodeGen_ARM::use_soft_float_abi() const {
 }
 
 int CodeGen_ARM::native_vector_bits() const {
+    if (target_vscale() != 0) {
+        return target.vector_bits;
+    }
     return 128;
 }
 
+int CodeGen_ARM::target_vscale() const {
+    if (target.bits == 64 &&
+        target.vector_bits != 0 &&
+        target.features_any_of({Target::SVE, Target::SVE2})) {
+        user_assert(target.vector_bits % 128 == 0)
+            << "The vector_bits of an SVE target must be a multiple of 128, not "
+            << target.vector_bits << ".\n";
+        return target.vector_bits / 128;
+    }
+    return 0;
+}
+
 bool CodeGen_ARM::supports_call_as_float16(const Call *op) const {
     bool is_fp16_native = float16_native_funcs.find(op->name) != float16_native_funcs.end();
     bool is_fp16_transcendental = float16_transcendental_remapping.find(op->name) != float16_transcendental_remapping.end();
@@ -90,6 +90,64 @@ const char *const constexpr_argument_info_docs = R"INLINE_CODE(
 
 )INLINE_CODE";
 
+Expr (*vector_reduce_binop(VectorReduce::Operator op))(Expr, Expr) {
+    switch (op) {
+    case VectorReduce::Add:
+        return Add::make;
+    case VectorReduce::Mul:
+        return Mul::make;
+    case VectorReduce::Min:
+        return Min::make;
+    case VectorReduce::Max:
+        return Max::make;
+    case VectorReduce::And:
+        return And::make;
+    case VectorReduce::Or:
+        return Or::make;
+    case VectorReduce::SaturatingAdd:
+        return Halide::saturating_add;
+    }
+    return nullptr;
+}
+
+// Express a vector reduction as vector ops on shuffles of its input,
+// combining pairs of lanes, and so halving the reduction factor, at each
+// step. Any odd factor left is combined one slice at a time.
+Expr vector_reduce_to_shuffles(const VectorReduce *op) {
+    auto binop = vector_reduce_binop(op->op);
+    const int outer_lanes = op->type.lanes();
+    int factor = op->value.type().lanes() / outer_lanes;
+    Expr value = op->value;
+    vector<std::pair<string, Expr>> lets;
+    auto bind = [&](const Expr &e) {
+        string name = unique_name('t');
+        lets.emplace_back(name, e);
+        return Variable::make(e.type(), name);
+    };
+    while (factor % 2 == 0) {
+        Expr v = bind(value);
+        int lanes = v.type().lanes() / 2;
+        if (outer_lanes == 1) {
+            // There's only one result, so the halves can be combined.
+            value = binop(Shuffle::make_slice(v, 0, 1, lanes), Shuffle::make_slice(v, lanes, 1, lanes));
+        } else {
+            value = binop(Shuffle::make_slice(v, 0, 2, lanes), Shuffle::make_slice(v, 1, 2, lanes));
+        }
+        factor /= 2;
+    }
+    if (factor > 1) {
+        Expr v = bind(value);
+        value = Shuffle::make_slice(v, 0, factor, outer_lanes);
+        for (int i = 1; i < factor; i++) {
+            value = binop(value, Shuffle::make_slice(v, i, factor, outer_lanes));
+        }
+    }
+    for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+        value = Let::make(it->first, it->second, value);
+    }
+    return value;
+}
+
 class TypeInfoGatherer : public IRGraphVisitor {
 private:
     using IRGraphVisitor::include;
@@ -162,6 +220,11 @@ protected:
         IRGraphVisitor::visit(op);
     }
 
+    void visit(const VectorReduce *op) override {
+        include_type(op->type);
+        vector_reduce_to_shuffles(op).accept(this);
+    }
+
     void visit(const Call *op) override {
         include_type(op->type);
         if (op->is_intrinsic(Call::lerp)) {
@@ -357,6 +420,41 @@ void CodeGen_C::add_vector_typedefs(const std::set<Type> &vector_types) {
     using_vector_typedefs = true;
 }
 
+void CodeGen_C::add_parallel_for_prologue() {
+    stream << R"INLINE_CODE(
+// Parallel loops call HALIDE_C_PARALLEL_FOR(min, extent, body), where
+// body takes the loop index and returns a nonzero error code on failure,
+// and which returns zero or one of the error codes returned by body. To
+// run them on another thread pool (TBB, GCD, ...), define it before
+// this point. The default uses OpenMP if it is enabled.
+#ifndef HALIDE_C_PARALLEL_FOR
+#define HALIDE_C_PARALLEL_FOR halide_c_parallel_for
+namespace {
+template<typename Body>
+int halide_c_parallel_for(int min, int extent, const Body &body) {
+    int result = 0;
+#ifdef _OPENMP
+#pragma omp parallel for
+    for (int i = min; i < min + extent; i++) {
+        int r = body(i);
+        if (r != 0) {
+#pragma omp atomic write
+            result = r;
+        }
+    }
+#else
+    for (int i = min; i < min + extent && result == 0; i++) {
+        result = body(i);
+    }
+#endif
+    return result;
+}
+}  // namespace
+#endif
+
+)INLINE_CODE";
+}
+
 void CodeGen_C::set_name_mangling_mode(NameMangling mode) {
     if (extern_c_open && mode != NameMangling::C) {
         stream << R"INLINE_CODE(
@@ -923,6 +1021,10 @@ void CodeGen_C::compile(const Module &input) {
     if (!is_header_or_extern_decl()) {
         add_vector_typedefs(type_info.vector_types_used);
 
+        if (type_info.for_types_used.count(ForType::Parallel)) {
+            add_parallel_for_prologue();
+        }
+
         // Emit prototypes for all external and internal-only functions.
         // Gather them up and do them all up front, to reduce duplicates,
         // and to make it simpler to get internal-linkage functions correct.
@@ -1845,6 +1947,32 @@ void CodeGen_C::visit(const Call *op) {
         internal_assert(op->args.size() == 1);
         string arg0 = print_expr(op->args[0]);
         rhs << "(" << arg0 << ")";
+    } else if (using_vector_typedefs && op->type.is_vector() && op->type.is_int_or_uint() &&
+               op->type.bits() <= 32 &&
+               (op->is_intrinsic(Call::saturating_add) ||
+                op->is_intrinsic(Call::saturating_sub) ||
+                op->is_intrinsic(Call::rounding_halving_add))) {
+        // The vector ops for these use the target's SIMD instructions where it has them.
+        internal_assert(op->args.size() == 2);
+        string a0 = print_expr(op->args[0]);
+        string a1 = print_expr(op->args[1]);
+        rhs << print_type(op->type) << "_ops::" << op->name << "(" << a0 << ", " << a1 << ")";
+    } else if (using_vector_typedefs && op->type.is_vector() && op->type.is_int_or_uint() &&
+               op->is_intrinsic(Call::widening_mul)) {
+        internal_assert(op->args.size() == 2);
+        string a0 = print_expr(op->args[0]);
+        string a1 = print_expr(op->args[1]);
+        rhs << print_type(op->type) << "_ops::widening_mul<"
+            << print_type(op->args[0].type().element_of()) << ", "
+            << print_type(op->args[1].type().element_of()) << ">(" << a0 << ", " << a1 << ")";
+    } else if (using_vector_typedefs && op->type.is_vector() && op->type.is_int_or_uint() &&
+               op->is_intrinsic(Call::saturating_cast) &&
+               op->args[0].type().is_int_or_uint() &&
+               op->args[0].type().bits() > op->type.bits()) {
+        internal_assert(op->args.size() == 1);
+        string a0 = print_expr(op->args[0]);
+        rhs << print_type(op->type) << "_ops::saturating_cast<"
+            << print_type(op->args[0].type().element_of()) << ">(" << a0 << ")";
     } else if (op->is_intrinsic()) {
         Expr lowered = lower_intrinsic(op);
         if (lowered.defined()) {
@@ -2054,30 +2182,7 @@ void CodeGen_C::visit(const Select *op) {
 }
 
 Expr CodeGen_C::scalarize_vector_reduce(const VectorReduce *op) {
-    Expr (*binop)(Expr, Expr) = nullptr;
-    switch (op->op) {
-    case VectorReduce::Add:
-        binop = Add::make;
-        break;
-    case VectorReduce::Mul:
-        binop = Mul::make;
-        break;
-    case VectorReduce::Min:
-        binop = Min::make;
-        break;
-    case VectorReduce::Max:
-        binop = Max::make;
-        break;
-    case VectorReduce::And:
-        binop = And::make;
-        break;
-    case VectorReduce::Or:
-        binop = Or::make;
-        break;
-    case VectorReduce::SaturatingAdd:
-        binop = Halide::saturating_add;
-        break;
-    }
+    auto binop = vector_reduce_binop(op->op);
 
     std::vector<Expr> lanes;
     int outer_lanes = op->type.lanes();
@@ -2101,6 +2206,11 @@ Expr CodeGen_C::scalarize_vector_reduce(const VectorReduce *op) {
 void CodeGen_C::visit(const VectorReduce *op) {
     stream << get_indent() << "// Vector reduce: " << op->op << "\n";
 
+    if (using_vector_typedefs) {
+        id = print_expr(vector_reduce_to_shuffles(op));
+        return;
+    }
+
     Expr scalarized = scalarize_vector_reduce(op);
     if (scalarized.type().is_scalar()) {
         print_assignment(op->type, print_expr(scalarized));
@@ -2214,12 +2324,28 @@ void CodeGen_C::visit(const For *op) {
     string id_extent = print_expr(op->extent);
 
     if (op->for_type == ForType::Parallel) {
-        stream << get_indent() << "#pragma omp parallel for\n";
-    } else {
-        internal_assert(op->for_type == ForType::Serial)
-            << "Can only emit serial or parallel for loops to C\n";
+        // Parallel loops are only left for us by the
+        // c_plus_plus_parallel_for target feature. The body becomes a
+        // lambda, which returns from the loop body rather than the function
+        // on failure.
+        string id_result = unique_name('_');
+        stream << get_indent() << "int " << id_result << " = HALIDE_C_PARALLEL_FOR("
+               << id_min << ", " << id_extent << ", [&](int " << print_name(op->name) << ") -> int\n";
+        open_scope();
+        op->body.accept(this);
+        stream << get_indent() << "return 0;\n";
+        close_scope("parallel for " + print_name(op->name));
+        stream << get_indent() << ");\n";
+        stream << get_indent() << "if (" << id_result << " != 0)\n";
+        open_scope();
+        stream << get_indent() << "return " << id_result << ";\n";
+        close_scope("");
+        return;
     }
 
+    internal_assert(op->for_type == ForType::Serial)
+        << "Can only emit serial or parallel for loops to C\n";
+
     stream << get_indent() << "for (int "
            << print_name(op->name)
            << " = " << id_min
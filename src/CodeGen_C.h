@@ -134,6 +134,9 @@ protected:
      * use different syntax for other C-like languages. */
     virtual void add_vector_typedefs(const std::set<Type> &vector_types);
 
+    /** Emit the default HALIDE_C_PARALLEL_FOR used by parallel loops. */
+    void add_parallel_for_prologue();
+
     /** Bottleneck to allow customization of calls to generic Extern/PureExtern calls.  */
     virtual std::string print_extern_call(const Call *op);
 
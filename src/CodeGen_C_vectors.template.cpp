@@ -6,8 +6,25 @@
 #define __has_builtin(x) 0
 #endif
 
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace {
 
+// The range of the narrower integer type Dst, as values of Src.
+template<typename Dst, typename Src>
+struct SaturatingCastBounds {
+    static constexpr Src lo() {
+        return std::is_signed<Src>::value ? static_cast<Src>(std::numeric_limits<Dst>::min()) : 0;
+    }
+    static constexpr Src hi() {
+        return static_cast<Src>(std::numeric_limits<Dst>::max());
+    }
+};
+
 // We can't use std::array because that has its own overload of operator<, etc,
 // which will interfere with ours.
 template<typename ElementType, size_t Lanes>
@@ -142,6 +159,55 @@ public:
         return r;
     }
 
+    // The integer ops below are only used for element types of up to 32 bits,
+    // so the intermediates fit in an int64_t.
+    static Vec saturating_add(const Vec &a, const Vec &b) {
+        Vec r;
+        for (size_t i = 0; i < Lanes; i++) {
+            int64_t s = (int64_t)a[i] + (int64_t)b[i];
+            r[i] = (ElementType)::halide_cpp_min<int64_t>(::halide_cpp_max<int64_t>(s, std::numeric_limits<ElementType>::min()),
+                                                          std::numeric_limits<ElementType>::max());
+        }
+        return r;
+    }
+
+    static Vec saturating_sub(const Vec &a, const Vec &b) {
+        Vec r;
+        for (size_t i = 0; i < Lanes; i++) {
+            int64_t s = (int64_t)a[i] - (int64_t)b[i];
+            r[i] = (ElementType)::halide_cpp_min<int64_t>(::halide_cpp_max<int64_t>(s, std::numeric_limits<ElementType>::min()),
+                                                          std::numeric_limits<ElementType>::max());
+        }
+        return r;
+    }
+
+    static Vec rounding_halving_add(const Vec &a, const Vec &b) {
+        Vec r;
+        for (size_t i = 0; i < Lanes; i++) {
+            r[i] = (ElementType)(((int64_t)a[i] + (int64_t)b[i] + 1) >> 1);
+        }
+        return r;
+    }
+
+    template<typename A, typename B>
+    static Vec widening_mul(const CppVector<A, Lanes> &a, const CppVector<B, Lanes> &b) {
+        Vec r;
+        for (size_t i = 0; i < Lanes; i++) {
+            r[i] = static_cast<ElementType>(a[i]) * static_cast<ElementType>(b[i]);
+        }
+        return r;
+    }
+
+    template<typename OtherElementType>
+    static Vec saturating_cast(const CppVector<OtherElementType, Lanes> &src) {
+        using Bounds = SaturatingCastBounds<ElementType, OtherElementType>;
+        Vec r;
+        for (size_t i = 0; i < Lanes; i++) {
+            r[i] = static_cast<ElementType>(::halide_cpp_min(::halide_cpp_max(src[i], Bounds::lo()), Bounds::hi()));
+        }
+        return r;
+    }
+
     static Vec select(const Mask &cond, const Vec &true_value, const Vec &false_value) {
         Vec r;
         for (size_t i = 0; i < Lanes; i++) {
@@ -552,6 +618,30 @@ struct NativeVectorComparisonType<float> { using type = int32_t; };
 template<>
 struct NativeVectorComparisonType<double> { using type = int64_t; };
 
+// A signed type wide enough to hold the sum or difference of two values of T.
+template<typename T>
+struct NativeVectorWideningType {
+    using type = void;
+};
+
+template<>
+struct NativeVectorWideningType<int8_t> { using type = int16_t; };
+
+template<>
+struct NativeVectorWideningType<int16_t> { using type = int32_t; };
+
+template<>
+struct NativeVectorWideningType<int32_t> { using type = int64_t; };
+
+template<>
+struct NativeVectorWideningType<uint8_t> { using type = int16_t; };
+
+template<>
+struct NativeVectorWideningType<uint16_t> { using type = int32_t; };
+
+template<>
+struct NativeVectorWideningType<uint32_t> { using type = int64_t; };
+
 template<typename ElementType_, size_t Lanes_>
 class NativeVectorOps {
 public:
@@ -698,6 +788,48 @@ public:
 #endif
     }
 
+    // The integer ops below are only used for element types of up to 32 bits.
+    // They are written as the widen-operate-narrow patterns that compilers
+    // match to single instructions (e.g. uqadd, urhadd and umull on NEON);
+    // the common 128-bit cases are also given directly for SSE2 below.
+    static Vec saturating_add(const Vec a, const Vec b) {
+        using W = NativeVectorOps<typename NativeVectorWideningType<ElementType>::type, Lanes>;
+        const typename W::Vec s = W::convert_from(a) + W::convert_from(b);
+        return saturate_from_wider(s);
+    }
+
+    static Vec saturating_sub(const Vec a, const Vec b) {
+        using W = NativeVectorOps<typename NativeVectorWideningType<ElementType>::type, Lanes>;
+        const typename W::Vec s = W::convert_from(a) - W::convert_from(b);
+        return saturate_from_wider(s);
+    }
+
+    static Vec rounding_halving_add(const Vec a, const Vec b) {
+        using W = NativeVectorOps<typename NativeVectorWideningType<ElementType>::type, Lanes>;
+        const typename W::Vec s = W::convert_from(a) + W::convert_from(b) + W::broadcast(1);
+        return convert_from(s >> 1);
+    }
+
+    template<typename A, typename B>
+    static Vec widening_mul(const NativeVector<A, Lanes> a, const NativeVector<B, Lanes> b) {
+        return convert_from(a) * convert_from(b);
+    }
+
+    template<typename OtherElementType>
+    static Vec saturating_cast(const NativeVector<OtherElementType, Lanes> src) {
+        using S = NativeVectorOps<OtherElementType, Lanes>;
+        using Bounds = SaturatingCastBounds<ElementType, OtherElementType>;
+        return convert_from(S::min(S::max(src, S::broadcast(Bounds::lo())), S::broadcast(Bounds::hi())));
+    }
+
+    template<typename WideVec>
+    static Vec saturate_from_wider(const WideVec s) {
+        using W = NativeVectorOps<typename NativeVectorWideningType<ElementType>::type, Lanes>;
+        const typename W::Vec lo = W::broadcast(std::numeric_limits<ElementType>::min());
+        const typename W::Vec hi = W::broadcast(std::numeric_limits<ElementType>::max());
+        return convert_from(W::min(W::max(s, lo), hi));
+    }
+
     static Vec select(const Mask cond, const Vec true_value, const Vec false_value) {
 #if defined(__GNUC__) && !defined(__clang__)
         // This should do the correct lane-wise select.
@@ -764,6 +896,118 @@ public:
     }
 };
 
+#if defined(__SSE2__)
+
+template<>
+inline NativeVector<int8_t, 16> NativeVectorOps<int8_t, 16>::saturating_add(const Vec a, const Vec b) {
+    return (Vec)_mm_adds_epi8((__m128i)a, (__m128i)b);
+}
+
+template<>
+inline NativeVector<uint8_t, 16> NativeVectorOps<uint8_t, 16>::saturating_add(const Vec a, const Vec b) {
+    return (Vec)_mm_adds_epu8((__m128i)a, (__m128i)b);
+}
+
+template<>
+inline NativeVector<int16_t, 8> NativeVectorOps<int16_t, 8>::saturating_add(const Vec a, const Vec b) {
+    return (Vec)_mm_adds_epi16((__m128i)a, (__m128i)b);
+}
+
+template<>
+inline NativeVector<uint16_t, 8> NativeVectorOps<uint16_t, 8>::saturating_add(const Vec a, const Vec b) {
+    return (Vec)_mm_adds_epu16((__m128i)a, (__m128i)b);
+}
+
+template<>
+inline NativeVector<int8_t, 16> NativeVectorOps<int8_t, 16>::saturating_sub(const Vec a, const Vec b) {
+    return (Vec)_mm_subs_epi8((__m128i)a, (__m128i)b);
+}
+
+template<>
+inline NativeVector<uint8_t, 16> NativeVectorOps<uint8_t, 16>::saturating_sub(const Vec a, const Vec b) {
+    return (Vec)_mm_subs_epu8((__m128i)a, (__m128i)b);
+}
+
+template<>
+inline NativeVector<int16_t, 8> NativeVectorOps<int16_t, 8>::saturating_sub(const Vec a, const Vec b) {
+    return (Vec)_mm_subs_epi16((__m128i)a, (__m128i)b);
+}
+
+template<>
+inline NativeVector<uint16_t, 8> NativeVectorOps<uint16_t, 8>::saturating_sub(const Vec a, const Vec b) {
+    return (Vec)_mm_subs_epu16((__m128i)a, (__m128i)b);
+}
+
+template<>
+inline NativeVector<uint8_t, 16> NativeVectorOps<uint8_t, 16>::rounding_halving_add(const Vec a, const Vec b) {
+    return (Vec)_mm_avg_epu8((__m128i)a, (__m128i)b);
+}
+
+template<>
+inline NativeVector<uint16_t, 8> NativeVectorOps<uint16_t, 8>::rounding_halving_add(const Vec a, const Vec b) {
+    return (Vec)_mm_avg_epu16((__m128i)a, (__m128i)b);
+}
+
+// The specializations below take or return 256-bit vectors. Without AVX
+// those are passed in memory, under a different ABI than with it, and
+// defining them would trigger -Wpsabi in every file that includes this
+// header. Without AVX the generic versions are used instead, and only
+// instantiated if the generated code calls them.
+#if defined(__AVX__)
+
+template<>
+template<>
+inline NativeVector<int32_t, 8> NativeVectorOps<int32_t, 8>::widening_mul<int16_t, int16_t>(const NativeVector<int16_t, 8> a,
+                                                                                             const NativeVector<int16_t, 8> b) {
+    const __m128i lo = _mm_mullo_epi16((__m128i)a, (__m128i)b);
+    const __m128i hi = _mm_mulhi_epi16((__m128i)a, (__m128i)b);
+    const __m128i r[2] = {_mm_unpacklo_epi16(lo, hi), _mm_unpackhi_epi16(lo, hi)};
+    Vec result;
+    memcpy(&result, r, sizeof(result));
+    return result;
+}
+
+template<>
+template<>
+inline NativeVector<uint32_t, 8> NativeVectorOps<uint32_t, 8>::widening_mul<uint16_t, uint16_t>(const NativeVector<uint16_t, 8> a,
+                                                                                                const NativeVector<uint16_t, 8> b) {
+    const __m128i lo = _mm_mullo_epi16((__m128i)a, (__m128i)b);
+    const __m128i hi = _mm_mulhi_epu16((__m128i)a, (__m128i)b);
+    const __m128i r[2] = {_mm_unpacklo_epi16(lo, hi), _mm_unpackhi_epi16(lo, hi)};
+    Vec result;
+    memcpy(&result, r, sizeof(result));
+    return result;
+}
+
+// The saturating narrowing casts that SSE2 packs two registers for.
+template<>
+template<>
+inline NativeVector<int8_t, 16> NativeVectorOps<int8_t, 16>::saturating_cast<int16_t>(const NativeVector<int16_t, 16> src) {
+    __m128i halves[2];
+    memcpy(halves, &src, sizeof(halves));
+    return (Vec)_mm_packs_epi16(halves[0], halves[1]);
+}
+
+template<>
+template<>
+inline NativeVector<uint8_t, 16> NativeVectorOps<uint8_t, 16>::saturating_cast<int16_t>(const NativeVector<int16_t, 16> src) {
+    __m128i halves[2];
+    memcpy(halves, &src, sizeof(halves));
+    return (Vec)_mm_packus_epi16(halves[0], halves[1]);
+}
+
+template<>
+template<>
+inline NativeVector<int16_t, 8> NativeVectorOps<int16_t, 8>::saturating_cast<int32_t>(const NativeVector<int32_t, 8> src) {
+    __m128i halves[2];
+    memcpy(halves, &src, sizeof(halves));
+    return (Vec)_mm_packs_epi32(halves[0], halves[1]);
+}
+
+#endif  // __AVX__
+
+#endif  // __SSE2__
+
 #endif  // __has_attribute(ext_vector_type) || __has_attribute(vector_size)
 
 }  // namespace
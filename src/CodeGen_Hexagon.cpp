@@ -13,6 +13,7 @@
 #include "IRPrinter.h"
 #include "LLVM_Headers.h"
 #include "LoopCarry.h"
+#include "PlanMemory.h"
 #include "Simplify.h"
 #include "Substitute.h"
 #include "Target.h"
@@ -525,6 +526,13 @@ void CodeGen_Hexagon::compile_func(const LoweredFunc &f,
     debug(2) << "Hexagon: Lowering after adding calls to qurt_hvx_lock:\n"
              << body << "\n\n";
 
+    if (is_hvx_v65_or_later()) {
+        debug(1) << "Hexagon: Planning VTCM...\n";
+        body = plan_memory(body, target, MemoryType::VTCM);
+        debug(2) << "Hexagon: Lowering after planning VTCM:\n"
+                 << body << "\n\n";
+    }
+
     debug(1) << "Hexagon: function body for " << simple_name << " :\n";
     debug(1) << body << "\n";
 
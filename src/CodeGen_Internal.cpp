@@ -31,6 +31,8 @@ bool function_takes_user_context(const std::string &name) {
         "halide_buffer_copy",
         "halide_copy_to_host",
         "halide_copy_to_device",
+        "halide_copy_region_to_host",
+        "halide_copy_region_to_device",
         "halide_current_time_ns",
         "halide_debug_to_file",
         "halide_device_free",
@@ -51,18 +53,23 @@ bool function_takes_user_context(const std::string &name) {
         "halide_print",
         "halide_profiler_memory_allocate",
         "halide_profiler_memory_free",
+        "halide_profiler_memory_traffic",
         "halide_profiler_pipeline_start",
         "halide_profiler_pipeline_end",
         "halide_profiler_stack_peak_update",
+        "halide_region_complete",
         "halide_spawn_thread",
         "halide_device_release",
         "halide_start_clock",
+        "halide_static_workspace_malloc",
         "halide_trace",
         "halide_trace_helper",
         "halide_memoization_cache_lookup",
         "halide_memoization_cache_store",
         "halide_memoization_cache_release",
+        "halide_memoization_cache_release_device",
         "halide_cuda_run",
+        "halide_cuda_occupancy_block_size",
         "halide_opencl_run",
         "halide_openglcompute_run",
         "halide_metal_run",
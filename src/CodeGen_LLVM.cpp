@@ -212,9 +212,9 @@ CodeGen_LLVM::CodeGen_LLVM(const Target &t)
       inside_atomic_mutex_node(false),
       emit_atomic_stores(false),
       use_llvm_vp_intrinsics(false),
+      strict_float(t.has_feature(Target::StrictFloat)),
 
       destructor_block(nullptr),
-      strict_float(t.has_feature(Target::StrictFloat)),
       llvm_large_code_model(t.has_feature(Target::LLVMLargeCodeModel)),
       effective_vscale(0) {
     initialize_llvm();
@@ -479,6 +479,8 @@ void CodeGen_LLVM::init_codegen(const std::string &name, bool any_strict_float)
 
 std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
     init_codegen(input.name(), input.any_strict_float());
+    profile = PipelineProfile(get_target(), input.name());
+    nontemporal_buffers = input.nontemporal_buffers();
 
     internal_assert(module && context && builder)
         << "The CodeGen_LLVM subclass should have made an initial module before calling CodeGen_LLVM::compile\n";
@@ -637,6 +639,7 @@ void CodeGen_LLVM::begin_func(LinkageType linkage, const std::string &name,
 
     // Null out the destructor block.
     destructor_block = nullptr;
+    error_paths.clear();
 
     // Make the initial basic block
     BasicBlock *block = BasicBlock::Create(*context, "entry", function);
@@ -666,6 +669,10 @@ void CodeGen_LLVM::begin_func(LinkageType linkage, const std::string &name,
 void CodeGen_LLVM::end_func(const std::vector<LoweredArgument> &args) {
     return_with_error_code(ConstantInt::get(i32_t, 0));
 
+    // Keep the long assertion failure paths out of the way of the
+    // argument and bounds checks that run on every call.
+    outline_error_paths();
+
     // Remove the arguments from the symbol table
     for (const auto &arg : args) {
         if (arg.is_buffer()) {
@@ -680,11 +687,52 @@ void CodeGen_LLVM::end_func(const std::vector<LoweredArgument> &args) {
     current_function_args.clear();
 }
 
+namespace {
+
+// The heat of the Func that the closure of a parallel loop runs the
+// body of, going by the name of the first loop in it, or the name of
+// the loop variable it is passed.
+FuncHeat closure_heat(const LoweredFunc &f, const PipelineProfile &profile) {
+    class FirstLoop : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const For *op) override {
+            if (name.empty()) {
+                name = op->name;
+            }
+        }
+
+    public:
+        std::string name;
+    } first_loop;
+    f.body.accept(&first_loop);
+
+    FuncHeat heat = profile.loop_heat(first_loop.name);
+    for (size_t i = 0; heat == FuncHeat::Unknown && i < f.args.size(); i++) {
+        heat = profile.loop_heat(f.args[i].name);
+    }
+    return heat;
+}
+
+}  // namespace
+
 void CodeGen_LLVM::compile_func(const LoweredFunc &f, const std::string &simple_name,
                                 const std::string &extern_name) {
     // Generate the function declaration and argument unpacking code.
     begin_func(f.linkage, simple_name, extern_name, f.args);
 
+    // Let LLVM optimize the closures of cold Funcs for size, and spend
+    // more effort on those of hot ones.
+    if (!profile.empty() && f.linkage == LinkageType::Internal) {
+        FuncHeat heat = closure_heat(f, profile);
+        if (heat == FuncHeat::Cold) {
+            function->addFnAttr(Attribute::Cold);
+            function->addFnAttr(Attribute::OptimizeForSize);
+        } else if (heat == FuncHeat::Hot) {
+            function->addFnAttr(Attribute::Hot);
+        }
+    }
+
     // If building with MSAN, ensure that calls to halide_msan_annotate_buffer_is_initialized()
     // happen for every output buffer if the function succeeds.
     if (f.linkage != LinkageType::Internal &&
@@ -703,8 +751,15 @@ void CodeGen_LLVM::compile_func(const LoweredFunc &f, const std::string &simple_
 
     // Generate the function body.
     debug(1) << "Generating llvm bitcode for function " << f.name << "...\n";
+    emitted_nontemporal_store = false;
     f.body.accept(this);
 
+    // Non-temporal stores are weakly ordered, so make them visible
+    // before the function (or parallel task) returns.
+    if (emitted_nontemporal_store) {
+        builder->CreateFence(AtomicOrdering::SequentiallyConsistent);
+    }
+
     // Show one time warning and clear it.
     for (auto it = onetime_warnings.begin(); it != onetime_warnings.end(); it = onetime_warnings.erase(it)) {
         user_warning << "In function " << f.name << ", " << it->second;
@@ -845,6 +900,7 @@ void CodeGen_LLVM::compile_buffer(const Buffer<> &buf) {
     bool constant = buf.dimensions() != 0;
 
     vector<char> data_blob((const char *)buf.data(), (const char *)buf.data() + buf.size_in_bytes());
+    embedded_buffer_alignments[buf.name()] = binary_blob_alignment(data_blob.size());
 
     Constant *fields[] = {
         ConstantInt::get(i64_t, 0),                                         // device
@@ -1270,7 +1326,7 @@ void CodeGen_LLVM::optimize_module() {
     if (logger) {
         auto time_end = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> diff = time_end - time_start;
-        logger->record_compilation_time(CompilerLogger::Phase::LLVM, diff.count());
+        logger->record_compilation_time(CompilerLogger::Phase::LLVMOptimization, diff.count());
     }
 }
 
@@ -2107,6 +2163,10 @@ void CodeGen_LLVM::visit(const Load *op) {
             }
 
             value = shuffle_vectors(flipped, indices);
+        } else if (ramp && stride && use_llvm_vp_intrinsics) {
+            // A strided load, e.g. one of the channels of interleaved data
+            value = codegen_vector_load(op->type, op->name, ramp->base, op->image, op->param,
+                                        op->alignment, nullptr, true, stride);
         } else if (ramp) {
             // Gather without generating the indices as a vector
             Value *ptr = codegen_buffer_pointer(op->name, op->type.element_of(), ramp->base);
@@ -2379,7 +2439,7 @@ void CodeGen_LLVM::codegen_predicated_store(const Store *op) {
 
 llvm::Value *CodeGen_LLVM::codegen_vector_load(const Type &type, const std::string &name, const Expr &base,
                                                const Buffer<> &image, const Parameter &param, const ModulusRemainder &alignment,
-                                               llvm::Value *vpred, bool slice_to_native, llvm::Value *stride) {
+                                               llvm::Value *vpred, bool slice_to_native, const Expr &stride) {
     debug(4) << "Vectorize predicated dense vector load:\n\t"
              << "(" << type << ")" << name << "[ramp(base, 1, " << type.lanes() << ")]\n";
 
@@ -2411,17 +2471,33 @@ llvm::Value *CodeGen_LLVM::codegen_vector_load(const Type &type, const std::stri
     } else if (get_target().has_feature(Target::JIT) && image.defined()) {
         // If we're JITting, use the actual pointer value to determine alignment for embedded buffers.
         align_bytes = gcd(align_bytes, (int)(((uintptr_t)image.data()) & std::numeric_limits<int>::max()));
+    } else if (image.defined()) {
+        // Otherwise, the data of Buffers embedded in this module is only
+        // as aligned as we placed it, which can be less than the native
+        // vector width for small Buffers.
+        auto it = embedded_buffer_alignments.find(image.name());
+        if (it != embedded_buffer_alignments.end()) {
+            align_bytes = gcd(align_bytes, it->second);
+        }
     }
 
     // For dense vector loads wider than the native vector
     // width, bust them up into native vectors
     int load_lanes = type.lanes();
     int native_lanes = slice_to_native ? std::max(1, maximum_vector_bits() / type.bits()) : load_lanes;
+    // vp.strided.load takes the stride in bytes.
+    Value *byte_stride = nullptr;
+    if (stride.defined()) {
+        byte_stride = codegen(stride * type.bytes());
+        if (get_target().bits == 64 && !byte_stride->getType()->isIntegerTy(64)) {
+            byte_stride = builder->CreateIntCast(byte_stride, i64_t, true);
+        }
+    }
     vector<Value *> slices;
     for (int i = 0; i < load_lanes; i += native_lanes) {
         int slice_lanes = std::min(native_lanes, load_lanes - i);
-        Expr slice_base = simplify(base + i);
-        Expr slice_stride = make_one(slice_base.type());
+        Expr slice_stride = stride.defined() ? stride : make_one(base.type());
+        Expr slice_base = simplify(base + i * slice_stride);
         Expr slice_index = slice_lanes == 1 ? slice_base : Ramp::make(slice_base, slice_stride, slice_lanes);
         llvm::Type *slice_type = get_vector_type(llvm_type_of(type.element_of()), slice_lanes);
         Value *elt_ptr = codegen_buffer_pointer(name, type.element_of(), slice_base);
@@ -2436,13 +2512,10 @@ llvm::Value *CodeGen_LLVM::codegen_vector_load(const Type &type, const std::stri
         // level. Assume that if stride is passed, this is not dense, though
         // LLVM should codegen the same thing for a constant 1 strided load as
         // for a non-strided load.
-        if (stride) {
-            if (get_target().bits == 64 && !stride->getType()->isIntegerTy(64)) {
-                stride = builder->CreateIntCast(stride, i64_t, true);
-            }
+        if (byte_stride) {
             if (try_vector_predication_intrinsic("llvm.experimental.vp.strided.load", VPResultType(slice_type, 0),
                                                  slice_lanes, vp_slice_mask,
-                                                 {VPArg(vec_ptr, 1, align_bytes), VPArg(stride, 1)})) {
+                                                 {VPArg(vec_ptr, 1, type.bytes()), VPArg(byte_stride, 1)})) {
                 load_inst = dyn_cast<Instruction>(value);
             } else {
                 internal_error << "Vector predicated strided load should not be requested if not supported.\n";
@@ -2471,7 +2544,7 @@ Value *CodeGen_LLVM::codegen_dense_vector_load(const Load *load, Value *vpred, b
     internal_assert(ramp && is_const_one(ramp->stride)) << "Should be dense vector load\n";
 
     return codegen_vector_load(load->type, load->name, ramp->base, load->image, load->param,
-                               load->alignment, vpred, slice_to_native, nullptr);
+                               load->alignment, vpred, slice_to_native);
 }
 
 void CodeGen_LLVM::codegen_predicated_load(const Load *op) {
@@ -2483,9 +2556,9 @@ void CodeGen_LLVM::codegen_predicated_load(const Load *op) {
         value = codegen_dense_vector_load(op, vpred);
     } else if (use_llvm_vp_intrinsics && stride) {  // Case only handled by vector predication, otherwise must scalarize.
         Value *vpred = codegen(op->predicate);
-        Value *llvm_stride = codegen(stride);  // Not 1 (dense) as that was caught above.
+        // Not 1 (dense) as that was caught above.
         value = codegen_vector_load(op->type, op->name, ramp->base, op->image, op->param,
-                                    op->alignment, vpred, true, llvm_stride);
+                                    op->alignment, vpred, true, stride);
     } else if (ramp && stride && stride->value == -1) {
         debug(4) << "Predicated dense vector load with stride -1\n\t" << Expr(op) << "\n";
         vector<int> indices(ramp->lanes);
@@ -2643,6 +2716,38 @@ void CodeGen_LLVM::codegen_atomic_rmw(const Store *op) {
     }
 }
 
+namespace {
+
+// The vector_math target feature replaces vectorized calls to these
+// math library functions, which would otherwise be made one lane at a
+// time, with Halide's vectorizable versions.
+Expr lower_vector_math_call(const Call *op) {
+    if (op->call_type != Call::PureExtern ||
+        !op->type.is_vector() ||
+        op->type.element_of() != Float(32)) {
+        return Expr();
+    }
+    const vector<Expr> &args = op->args;
+    if (op->name == "sin_f32") {
+        return halide_sin(args[0]);
+    } else if (op->name == "cos_f32") {
+        return halide_cos(args[0]);
+    } else if (op->name == "tan_f32") {
+        return halide_tan(args[0]);
+    } else if (op->name == "asin_f32") {
+        return halide_asin(args[0]);
+    } else if (op->name == "acos_f32") {
+        return halide_acos(args[0]);
+    } else if (op->name == "atan_f32") {
+        return halide_atan(args[0]);
+    } else if (op->name == "atan2_f32") {
+        return halide_atan2(args[0], args[1]);
+    }
+    return Expr();
+}
+
+}  // namespace
+
 void CodeGen_LLVM::visit(const Call *op) {
     internal_assert(op->is_extern() || op->is_intrinsic())
         << "Can only codegen extern calls and intrinsics\n";
@@ -3317,6 +3422,7 @@ void CodeGen_LLVM::visit(const Call *op) {
         safe_flags.clear();
         builder->setFastMathFlags(safe_flags);
         builder->setDefaultFPMathTag(strict_fp_math_md);
+        ScopedValue<bool> old_strict_float(strict_float, true);
         value = codegen(op->args[0]);
     } else if (is_float16_transcendental(op) && !supports_call_as_float16(op)) {
         value = codegen(lower_float16_transcendental_to_float32_equivalent(op));
@@ -3332,6 +3438,10 @@ void CodeGen_LLVM::visit(const Call *op) {
             internal_error << "Unknown intrinsic " << op->name;
         }
         value = codegen(lowered);
+    } else if (target.has_feature(Target::VectorMath) &&
+               !strict_float &&
+               lower_vector_math_call(op).defined()) {
+        value = codegen(lower_vector_math_call(op));
     } else if (op->call_type == Call::PureExtern && op->name == "pow_f32") {
         internal_assert(op->args.size() == 2);
         Expr x = op->args[0];
@@ -3585,6 +3695,15 @@ Constant *CodeGen_LLVM::create_string_constant(const string &s) {
     }
 }
 
+int CodeGen_LLVM::binary_blob_alignment(size_t size) const {
+    int alignment = 32;
+    int native_vector_bytes = native_vector_bits() / 8;
+    if (size > (size_t)alignment && native_vector_bytes > alignment) {
+        alignment = native_vector_bytes;
+    }
+    return alignment;
+}
+
 Constant *CodeGen_LLVM::create_binary_blob(const vector<char> &data, const string &name, bool constant) {
     internal_assert(!data.empty());
     llvm::Type *type = ArrayType::get(i8_t, data.size());
@@ -3593,12 +3712,7 @@ Constant *CodeGen_LLVM::create_binary_blob(const vector<char> &data, const strin
                                                 nullptr, name);
     ArrayRef<unsigned char> data_array((const unsigned char *)&data[0], data.size());
     global->setInitializer(ConstantDataArray::get(*context, data_array));
-    size_t alignment = 32;
-    size_t native_vector_bytes = (size_t)(native_vector_bits() / 8);
-    if (data.size() > alignment && native_vector_bytes > alignment) {
-        alignment = native_vector_bytes;
-    }
-    global->setAlignment(llvm::Align(alignment));
+    global->setAlignment(llvm::Align(binary_blob_alignment(data.size())));
 
     Constant *zero = ConstantInt::get(i32_t, 0);
     Constant *zeros[] = {zero, zero};
@@ -3606,6 +3720,34 @@ Constant *CodeGen_LLVM::create_binary_blob(const vector<char> &data, const strin
     return ptr;
 }
 
+namespace {
+
+// The blocks of an assertion failure path that starts at the block
+// first. Computing the error code may have split the path across more
+// blocks, which are all appended to the function after first.
+vector<BasicBlock *> error_path_blocks(BasicBlock *first) {
+    vector<BasicBlock *> blocks;
+    llvm::Function *f = first->getParent();
+    for (auto bb = first->getIterator(); bb != f->end(); ++bb) {
+        blocks.push_back(&*bb);
+    }
+    return blocks;
+}
+
+// Mark the calls on an assertion failure path as cold, so that LLVM lays
+// the path out of line.
+void mark_error_path_cold(const vector<BasicBlock *> &blocks) {
+    for (BasicBlock *bb : blocks) {
+        for (auto &inst : *bb) {
+            if (CallInst *call = dyn_cast<CallInst>(&inst)) {
+                call->addFnAttr(Attribute::Cold);
+            }
+        }
+    }
+}
+
+}  // namespace
+
 void CodeGen_LLVM::create_assertion(Value *cond, const Expr &message, llvm::Value *error_code) {
 
     internal_assert(!message.defined() || message.type() == Int(32))
@@ -3626,9 +3768,10 @@ void CodeGen_LLVM::create_assertion(Value *cond, const Expr &message, llvm::Valu
         cond = scalar_cond;
     }
 
-    // Make a new basic block for the assert
-    BasicBlock *assert_fails_bb = BasicBlock::Create(*context, "assert failed", function);
+    // Make a new basic block for the assert. The failure case is
+    // created last, so that every block after it belongs to it.
     BasicBlock *assert_succeeds_bb = BasicBlock::Create(*context, "assert succeeded", function);
+    BasicBlock *assert_fails_bb = BasicBlock::Create(*context, "assert failed", function);
 
     // If the condition fails, enter the assert body, otherwise, enter the block after
     builder->CreateCondBr(cond, assert_succeeds_bb, assert_fails_bb, very_likely_branch);
@@ -3640,13 +3783,69 @@ void CodeGen_LLVM::create_assertion(Value *cond, const Expr &message, llvm::Valu
     if (!error_code) {
         error_code = codegen(message);
     }
+    vector<BasicBlock *> error_path = error_path_blocks(assert_fails_bb);
+    mark_error_path_cold(error_path);
 
     return_with_error_code(error_code);
+    error_paths.push_back(std::move(error_path));
 
     // Continue on using the success case
     builder->SetInsertPoint(assert_succeeds_bb);
 }
 
+void CodeGen_LLVM::outline_error_paths() {
+    // A path that only calls the error function is left in place, as
+    // calling an outlined function instead wouldn't make it smaller.
+    // Longer ones build an error message first.
+    vector<vector<BasicBlock *>> to_outline;
+    for (auto &blocks : error_paths) {
+        if (blocks.front()->getParent() != function) {
+            continue;
+        }
+        int calls = 0;
+        for (BasicBlock *bb : blocks) {
+            for (auto &inst : *bb) {
+                calls += isa<CallInst>(inst);
+            }
+        }
+        if (calls < 2) {
+            continue;
+        }
+        // The outlined function can't return from this one, so leave
+        // the return of the error code (see codegen_asserts) behind.
+        BasicBlock *last = blocks.back();
+        if (isa<ReturnInst>(last->getTerminator())) {
+            last->splitBasicBlock(last->getTerminator(), "assert_failed_return");
+        }
+        to_outline.push_back(std::move(blocks));
+    }
+    error_paths.clear();
+
+    if (to_outline.empty()) {
+        return;
+    }
+    CodeExtractorAnalysisCache cache(*function);
+    for (const auto &blocks : to_outline) {
+        CodeExtractor extractor(blocks);
+        if (!extractor.isEligible()) {
+            continue;
+        }
+        llvm::Function *outlined = extractor.extractCodeRegion(cache);
+        if (!outlined) {
+            continue;
+        }
+        outlined->setName(function->getName() + ".cold");
+        outlined->addFnAttr(Attribute::Cold);
+        outlined->addFnAttr(Attribute::NoInline);
+        outlined->addFnAttr(Attribute::OptimizeForSize);
+        for (User *u : outlined->users()) {
+            if (CallInst *call = dyn_cast<CallInst>(u)) {
+                call->addFnAttr(Attribute::Cold);
+            }
+        }
+    }
+}
+
 void CodeGen_LLVM::return_with_error_code(llvm::Value *error_code) {
     // Branch to the destructor block, which cleans up and then bails out.
     BasicBlock *dtors = get_destructor_block();
@@ -3679,6 +3878,10 @@ void CodeGen_LLVM::visit(const For *op) {
     Value *extent = codegen(op->extent);
     const Acquire *acquire = op->body.as<Acquire>();
 
+    user_assert(!(op->for_type == ForType::Parallel && target.has_feature(Target::CPlusPlusParallelFor)))
+        << "Loop " << op->name << " is parallel, and the target has the c_plus_plus_parallel_for "
+        << "feature, so it can only be compiled by the C++ backend.\n";
+
     // TODO(zvookin): remove this after validating it doesn't happen
     internal_assert(!(op->for_type == ForType::Parallel ||
                       (op->for_type == ForType::Serial &&
@@ -3722,7 +3925,20 @@ void CodeGen_LLVM::visit(const For *op) {
 
         // Maybe exit the loop
         Value *end_condition = builder->CreateICmpNE(next_var, max);
-        builder->CreateCondBr(end_condition, loop_bb, after_bb);
+        llvm::BranchInst *back_edge = builder->CreateCondBr(end_condition, loop_bb, after_bb);
+
+        if (!profile.empty() && profile.loop_heat(op->name) == FuncHeat::Cold) {
+            // Keep LLVM's own loop optimizations, if enabled, from
+            // growing the loops of cold Funcs.
+            llvm::Metadata *disable_unroll = MDNode::get(*context, {MDString::get(*context, "llvm.loop.unroll.disable")});
+            llvm::Metadata *disable_vectorize =
+                MDNode::get(*context, {MDString::get(*context, "llvm.loop.vectorize.enable"),
+                                       ConstantAsMetadata::get(ConstantInt::getFalse(*context))});
+            // The first operand of a loop ID is the loop ID itself.
+            MDNode *loop_id = MDNode::getDistinct(*context, {nullptr, disable_unroll, disable_vectorize});
+            loop_id->replaceOperandWith(0, loop_id);
+            back_edge->setMetadata(LLVMContext::MD_loop, loop_id);
+        }
 
         builder->SetInsertPoint(after_bb);
 
@@ -3845,6 +4061,15 @@ void CodeGen_LLVM::visit(const Store *op) {
                     } else {
                         StoreInst *store = builder->CreateAlignedStore(slice_val, vec_ptr, llvm::Align(alignment));
                         annotate_store(store, slice_index);
+                        // Only aligned vector stores have non-temporal
+                        // instructions on most targets.
+                        if (is_dense && slice_lanes > 1 && !emit_atomic_stores &&
+                            alignment >= slice_lanes * value_type.bytes() &&
+                            nontemporal_buffers.count(op->name)) {
+                            MDNode *one = MDNode::get(*context, {ConstantAsMetadata::get(ConstantInt::get(i32_t, 1))});
+                            store->setMetadata(LLVMContext::MD_nontemporal, one);
+                            emitted_nontemporal_store = true;
+                        }
                     }
                 } else if (ramp != nullptr) {
                     if (get_target().bits == 64 && !stride_val->getType()->isIntegerTy(64)) {
@@ -3942,7 +4167,10 @@ void CodeGen_LLVM::codegen_asserts(const vector<const AssertStmt *> &asserts) {
         switch_inst->addCase(ConstantInt::get(IntegerType::get(*context, 32), i), fail_bb);
         builder->SetInsertPoint(fail_bb);
         Value *v = codegen(asserts[i]->message);
+        vector<BasicBlock *> error_path = error_path_blocks(fail_bb);
+        mark_error_path_cold(error_path);
         builder->CreateRet(v);
+        error_paths.push_back(std::move(error_path));
     }
     builder->SetInsertPoint(no_errors_bb);
 }
@@ -35,12 +35,14 @@ class GlobalVariable;
 #include <map>
 #include <memory>
 #include <optional>
+#include <set>
 #include <string>
 #include <variant>
 #include <vector>
 
 #include "IRVisitor.h"
 #include "Module.h"
+#include "ProfileGuided.h"
 #include "Scope.h"
 #include "Target.h"
 
@@ -283,6 +285,10 @@ protected:
      * the destructor block. */
     void return_with_error_code(llvm::Value *error_code);
 
+    /** Move the assertion failure paths of the current function that
+     * build an error message out into separate cold functions. */
+    void outline_error_paths();
+
     /** Put a string constant in the module as a global variable and return a pointer to it. */
     llvm::Constant *create_string_constant(const std::string &str);
 
@@ -640,6 +646,17 @@ protected:
     };
     std::map<WarningKind, std::string> onetime_warnings;
 
+    /** Generate code for a Load or Store with a predicate that isn't
+     * const true. Targets with masked gathers and scatters may override
+     * these. */
+    // @{
+    virtual void codegen_predicated_load(const Load *op);
+    virtual void codegen_predicated_store(const Store *op);
+    // @}
+
+    /** Turn off all unsafe math flags in scopes while this is set. */
+    bool strict_float;
+
 private:
     /** All the values in scope at the current code location during
      * codegen. Use sym_push and sym_pop to access. */
@@ -654,8 +671,25 @@ private:
      * to this block. */
     llvm::BasicBlock *destructor_block;
 
-    /** Turn off all unsafe math flags in scopes while this is set. */
-    bool strict_float;
+    /** The blocks of each assertion failure path in the current
+     * function, which outline_error_paths may move out of it. */
+    std::vector<std::vector<llvm::BasicBlock *>> error_paths;
+
+    /** The profile of the pipeline being compiled, if the target has
+     * the profile_guided feature. */
+    PipelineProfile profile;
+
+    /** The buffers to write with non-temporal stores, and whether the
+     * function being generated has emitted any. */
+    std::set<std::string> nontemporal_buffers;
+    bool emitted_nontemporal_store = false;
+
+    /** The alignment in bytes of the host data of each Buffer
+     * embedded in the module, by name. */
+    std::map<std::string, int> embedded_buffer_alignments;
+
+    /** The alignment to give a binary blob of the given size. */
+    int binary_blob_alignment(size_t size) const;
 
     /** Use the LLVM large code model when this is set. */
     bool llvm_large_code_model;
@@ -690,10 +724,7 @@ private:
 
     llvm::Value *codegen_vector_load(const Type &type, const std::string &name, const Expr &base,
                                      const Buffer<> &image, const Parameter &param, const ModulusRemainder &alignment,
-                                     llvm::Value *vpred = nullptr, bool slice_to_native = true, llvm::Value *stride = nullptr);
-
-    virtual void codegen_predicated_load(const Load *op);
-    virtual void codegen_predicated_store(const Store *op);
+                                     llvm::Value *vpred = nullptr, bool slice_to_native = true, const Expr &stride = Expr());
 
     void codegen_atomic_rmw(const Store *op);
 
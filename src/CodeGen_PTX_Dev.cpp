@@ -90,6 +90,10 @@ protected:
     void codegen_vector_reduce(const VectorReduce *op, const Expr &init) override;
     // @}
 
+    /** Generate code for the "wmma_" intrinsics injected by
+     * extract_tensor_core_operations. */
+    void codegen_wmma(const Call *op);
+
     std::string march() const;
     std::string mcpu_target() const override;
     std::string mcpu_tune() const override;
@@ -110,6 +114,12 @@ protected:
     std::string simt_intrinsic(const std::string &name);
 
     bool supports_atomic_add(const Type &t) const override;
+
+    /** Emit a scalar atomic add as one atomic per group of lanes in a
+     * warp that update the same address, rather than one per
+     * lane. Returns false if the store isn't a suitable atomic add, or
+     * the target lacks the warp intrinsics needed. */
+    bool codegen_warp_aggregated_atomic_add(const Store *op);
 };
 
 CodeGen_PTX_Dev::CodeGen_PTX_Dev(const Target &host)
@@ -274,6 +284,11 @@ void CodeGen_PTX_Dev::visit(const Call *op) {
         return;
     }
 
+    if (op->is_intrinsic() && starts_with(op->name, "wmma_")) {
+        codegen_wmma(op);
+        return;
+    }
+
     // TODO: It would be better if CodeGen_LLVM could handle overloaded intrin calls by default.
     value = call_overloaded_intrin(op->type, op->name, op->args);
     if (!value) {
@@ -281,6 +296,85 @@ void CodeGen_PTX_Dev::visit(const Call *op) {
     }
 }
 
+void CodeGen_PTX_Dev::codegen_wmma(const Call *op) {
+    // The first argument of all of these is a load of the first
+    // element of the tile in memory, which gives us the address.
+    auto string_arg = [&](int i) {
+        const StringImm *str = op->args[i].as<StringImm>();
+        internal_assert(str) << "Expected string argument to " << op->name << "\n";
+        return str->value;
+    };
+
+    string intrin = "llvm.nvvm.wmma.m16n16k16.";
+    vector<Value *> vector_args;
+    Value *ptr = nullptr, *leading_dim = nullptr;
+    if (op->name == "wmma_load_a" || op->name == "wmma_load_b") {
+        internal_assert(op->args.size() == 4);
+        intrin += "load." + string(op->name == "wmma_load_a" ? "a" : "b") + "." +
+                  string_arg(2) + ".stride." + string_arg(3);
+    } else if (op->name == "wmma_mma") {
+        internal_assert(op->args.size() == 6);
+        string ptx_type = string_arg(5);
+        intrin += "mma." + string_arg(3) + "." + string_arg(4) + "." +
+                  (ptx_type == "f16" ? string("f32.f32") : ptx_type);
+        vector_args = {codegen(op->args[1]), codegen(op->args[2]), codegen(op->args[0])};
+    } else if (op->name == "wmma_store") {
+        internal_assert(op->args.size() == 4);
+        intrin += "store.d." + string_arg(2) + ".stride." +
+                  string(op->args[3].type().is_float() ? "f32" : "s32");
+        vector_args = {codegen(op->args[3])};
+    } else {
+        internal_error << "Unknown tensor core intrinsic " << op->name << "\n";
+    }
+
+    if (op->name != "wmma_mma") {
+        const Load *start = op->args[0].as<Load>();
+        internal_assert(start) << "Expected load of start of tile in " << op->name << "\n";
+        ptr = codegen_buffer_pointer(start->name, start->type, start->index);
+        leading_dim = codegen(op->args[1]);
+    }
+
+    llvm::Intrinsic::ID id = llvm::Function::lookupIntrinsicID(intrin);
+    internal_assert(id != llvm::Intrinsic::not_intrinsic) << "Unknown intrinsic " << intrin << "\n";
+    llvm::Function *fn = ptr ?
+                             llvm::Intrinsic::getDeclaration(module.get(), id, {ptr->getType()}) :
+                             llvm::Intrinsic::getDeclaration(module.get(), id);
+    llvm::FunctionType *fn_type = fn->getFunctionType();
+
+    // The fragments are vectors in Halide, but are passed to the
+    // intrinsics as one argument per register.
+    vector<Value *> args;
+    if (ptr) {
+        args.push_back(ptr);
+    }
+    for (Value *v : vector_args) {
+        int lanes = get_vector_num_elements(v->getType());
+        for (int i = 0; i < lanes; i++) {
+            Value *e = builder->CreateExtractElement(v, ConstantInt::get(i32_t, i));
+            args.push_back(builder->CreateBitCast(e, fn_type->getParamType(args.size())));
+        }
+    }
+    if (leading_dim) {
+        args.push_back(leading_dim);
+    }
+
+    Value *result = builder->CreateCall(fn, args);
+    if (op->name == "wmma_store") {
+        value = ConstantInt::get(i32_t, 0);
+        return;
+    }
+
+    // And the results are returned as a struct of registers.
+    llvm::Type *result_type = llvm_type_of(op->type);
+    llvm::Type *element_type = result_type->getScalarType();
+    value = UndefValue::get(result_type);
+    for (int i = 0; i < op->type.lanes(); i++) {
+        Value *e = builder->CreateExtractValue(result, {(unsigned)i});
+        e = builder->CreateBitCast(e, element_type);
+        value = builder->CreateInsertElement(value, e, ConstantInt::get(i32_t, i));
+    }
+}
+
 string CodeGen_PTX_Dev::simt_intrinsic(const string &name) {
     if (ends_with(name, ".__thread_id_x")) {
         return "llvm.nvvm.read.ptx.sreg.tid.x";
@@ -383,6 +477,9 @@ void CodeGen_PTX_Dev::visit(const Store *op) {
     if (emit_atomic_stores) {
         user_assert(is_const_one(op->predicate)) << "Atomic update does not support predicated store.\n";
         user_assert(op->value.type().bits() >= 32) << "CUDA: 8-bit or 16-bit atomics are not supported.\n";
+        if (codegen_warp_aggregated_atomic_add(op)) {
+            return;
+        }
     }
 
     // Do aligned 4-wide 32-bit stores as a single i128 store.
@@ -816,6 +913,80 @@ bool CodeGen_PTX_Dev::supports_atomic_add(const Type &t) const {
     return false;
 }
 
+bool CodeGen_PTX_Dev::codegen_warp_aggregated_atomic_add(const Store *op) {
+    // We need activemask (PTX 6.2) and match.any.sync (sm_70), and
+    // redux.sync (sm_80) for non-constant deltas. The ptx isa we
+    // ask LLVM for only has the first of these from sm_80 onwards.
+    Type t = op->value.type();
+    if (target.get_cuda_capability_lower_bound() < 80 ||
+        !t.is_scalar() ||
+        t.bits() != 32 ||
+        !is_const_one(op->predicate) ||
+        !supports_atomic_add(t) ||
+        !expr_uses_var(op->value, op->name)) {
+        return false;
+    }
+
+    Expr equiv_load = Load::make(t, op->name, op->index, Buffer<>(), op->param, op->predicate, op->alignment);
+    Expr delta = simplify(common_subexpression_elimination(op->value - equiv_load));
+    if (expr_uses_var(delta, op->name) ||
+        expr_uses_var(op->index, op->name)) {
+        return false;
+    }
+    // A histogram-like update by a constant can be combined by
+    // counting the lanes in each group. Otherwise we need to sum the
+    // deltas across the group, which redux.sync only does for
+    // integers.
+    bool constant_delta = is_const(delta);
+    if (!constant_delta && !t.is_int_or_uint()) {
+        return false;
+    }
+
+    auto intrinsic = [&](const char *name, llvm::ArrayRef<llvm::Type *> types = {}) {
+        llvm::Intrinsic::ID id = llvm::Function::lookupIntrinsicID(name);
+        internal_assert(id != llvm::Intrinsic::not_intrinsic) << "Unknown intrinsic " << name << "\n";
+        return llvm::Intrinsic::getDeclaration(module.get(), id, types);
+    };
+
+    Value *ptr = codegen_buffer_pointer(op->name, t, op->index);
+    Value *val = codegen(delta);
+
+    // Find the active lanes that update the same address as this one.
+    llvm::FunctionType *mask_type = llvm::FunctionType::get(i32_t, false);
+    Value *mask = builder->CreateCall(llvm::InlineAsm::get(mask_type, "activemask.b32 $0;", "=r", true));
+    Value *addr = builder->CreatePtrToInt(ptr, i64_t);
+    Value *peers = builder->CreateCall(intrinsic("llvm.nvvm.match.any.sync.i64"), {mask, addr});
+
+    // Sum the group's updates.
+    Value *sum;
+    if (constant_delta) {
+        Value *count = builder->CreateCall(intrinsic("llvm.ctpop", {i32_t}), {peers});
+        if (t.is_float()) {
+            sum = builder->CreateFMul(val, builder->CreateUIToFP(count, val->getType()));
+        } else {
+            sum = builder->CreateMul(val, count);
+        }
+    } else {
+        sum = builder->CreateCall(intrinsic("llvm.nvvm.redux.sync.add"), {val, peers});
+    }
+
+    // The lowest lane in each group does the atomic on its behalf.
+    Value *lane = builder->CreateCall(intrinsic("llvm.nvvm.read.ptx.sreg.laneid"));
+    Value *leader = builder->CreateCall(intrinsic("llvm.cttz", {i32_t}), {peers, builder->getFalse()});
+    Value *is_leader = builder->CreateICmpEQ(lane, leader);
+
+    llvm::Function *f = builder->GetInsertBlock()->getParent();
+    BasicBlock *leader_bb = BasicBlock::Create(*context, "atomic_leader", f);
+    BasicBlock *after_bb = BasicBlock::Create(*context, "atomic_after", f);
+    builder->CreateCondBr(is_leader, leader_bb, after_bb);
+    builder->SetInsertPoint(leader_bb);
+    builder->CreateAtomicRMW(t.is_float() ? AtomicRMWInst::FAdd : AtomicRMWInst::Add,
+                             ptr, sum, llvm::MaybeAlign(), AtomicOrdering::Monotonic);
+    builder->CreateBr(after_bb);
+    builder->SetInsertPoint(after_bb);
+    return true;
+}
+
 }  // namespace
 
 std::unique_ptr<CodeGen_GPU_Dev> new_CodeGen_PTX_Dev(const Target &target) {
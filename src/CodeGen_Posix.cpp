@@ -260,8 +260,71 @@ CodeGen_Posix::Allocation CodeGen_Posix::create_allocation(const std::string &na
         allocation.ptr = phi;
         allocation.pseudostack_slot = slot;
     } else {
+        // With the workspace feature, heap allocations come from a slot
+        // per allocation site that keeps its block between calls. JIT
+        // modules can be freed while the runtime that holds the slots
+        // lives on, so they keep using halide_malloc.
+        bool use_workspace = target.has_feature(Target::Workspace) &&
+                             !target.has_feature(Target::JIT) &&
+                             free_function.empty();
+
         if (new_expr.defined()) {
             allocation.ptr = codegen(new_expr);
+
+            // If the new_expr points into another allocation (as the
+            // allocations placed in an arena by plan_memory do), use
+            // the same name for alias analysis, as the memory may be
+            // shared.
+            Expr base = new_expr;
+            while (true) {
+                if (const Reinterpret *r = base.as<Reinterpret>()) {
+                    base = r->value;
+                } else if (const Add *a = base.as<Add>()) {
+                    base = a->a;
+                } else {
+                    break;
+                }
+            }
+            const Variable *v = base.as<Variable>();
+            if (v && allocations.contains(v->name)) {
+                allocation.name = get_allocation_name(v->name);
+            }
+        } else if (use_workspace) {
+            llvm::Function *malloc_fn = module->getFunction("halide_workspace_malloc");
+            if (!malloc_fn) {
+                llvm::Type *size_t_type = target.bits == 64 ? i64_t : i32_t;
+                llvm::FunctionType *malloc_ty =
+                    llvm::FunctionType::get(i8_t->getPointerTo(),
+                                            {i8_t->getPointerTo(), i8_t->getPointerTo(), size_t_type}, false);
+                malloc_fn = llvm::Function::Create(malloc_ty, llvm::GlobalValue::ExternalLinkage,
+                                                   "halide_workspace_malloc", module.get());
+            }
+            malloc_fn->setReturnDoesNotAlias();
+
+            // A zero-initialized halide_workspace_slot_t
+            llvm::Type *slot_type = llvm::ArrayType::get(i64_t, 5);
+            llvm::GlobalVariable *slot =
+                new llvm::GlobalVariable(*module, slot_type, false, llvm::GlobalValue::PrivateLinkage,
+                                         llvm::ConstantAggregateZero::get(slot_type), name + ".workspace_slot");
+            slot->setAlignment(llvm::Align(8));
+
+            llvm::Function::arg_iterator arg_iter = malloc_fn->arg_begin();
+            ++arg_iter;  // skip the user context *
+            Value *slot_ptr = builder->CreatePointerCast(slot, arg_iter->getType());
+            ++arg_iter;  // skip the pointer to the slot
+            llvm_size = builder->CreateIntCast(llvm_size, arg_iter->getType(), false);
+
+            debug(4) << "Creating call to halide_workspace_malloc for allocation " << name << "\n";
+            Value *args[3] = {get_user_context(), slot_ptr, llvm_size};
+            Value *call = builder->CreateCall(malloc_fn, args);
+            allocation.ptr = builder->CreatePointerCast(call, llvm_type_of(type)->getPointerTo());
+
+            free_function = "halide_workspace_free";
+            if (!module->getFunction(free_function)) {
+                llvm::FunctionType *free_ty =
+                    llvm::FunctionType::get(void_t, {i8_t->getPointerTo(), i8_t->getPointerTo()}, false);
+                llvm::Function::Create(free_ty, llvm::GlobalValue::ExternalLinkage, free_function, module.get());
+            }
         } else {
             // call malloc
             llvm::Function *malloc_fn = module->getFunction("halide_malloc");
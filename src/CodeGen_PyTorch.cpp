@@ -55,6 +55,19 @@ void CodeGen_PyTorch::compile(const Module &module) {
             compile(f, false);
         }
     }
+
+    // Emit an autograd Function for each function whose gradient is also
+    // in the module.
+    for (const auto &f : module.functions()) {
+        if (f.linkage == LinkageType::Internal) {
+            continue;
+        }
+        for (const auto &g : module.functions()) {
+            if (g.linkage != LinkageType::Internal && g.name == f.name + "_grad") {
+                compile_autograd(f, g);
+            }
+        }
+    }
 }
 
 void CodeGen_PyTorch::compile(const LoweredFunc &f, bool is_cuda) {
@@ -155,6 +168,8 @@ void CodeGen_PyTorch::compile(const LoweredFunc &f, bool is_cuda) {
 
     stream << get_indent() << "// Run Halide pipeline\n";
 
+    stream << get_indent() << "Halide::PyTorch::maybe_use_aten_thread_pool();\n";
+
     stream << get_indent() << "int err = " << simple_name << "(";
     for (size_t i = 0; i < args.size(); i++) {
         if (args[i].is_buffer()) {
@@ -219,5 +234,197 @@ void CodeGen_PyTorch::compile(const LoweredFunc &f, bool is_cuda) {
     }
 }
 
+void CodeGen_PyTorch::compile_autograd(const LoweredFunc &forward, const LoweredFunc &gradient) {
+    std::vector<LoweredArgument> inputs, outputs;
+    size_t buffer_input_count = 0;
+    for (const auto &arg : forward.args) {
+        if (arg.name == "__user_context") {
+            continue;
+        } else if (arg.is_output()) {
+            outputs.push_back(arg);
+        } else {
+            if (arg.is_scalar() && arg.type.is_handle()) {
+                user_warning << "Not emitting a PyTorch autograd function for " << forward.name
+                             << ", because it has a handle argument.\n";
+                return;
+            }
+            inputs.push_back(arg);
+            buffer_input_count += arg.is_buffer() ? 1 : 0;
+        }
+    }
+
+    // The gradient takes the same inputs, then the gradient of the loss for
+    // each output, and produces the gradient of each output with respect to
+    // each buffer input.
+    std::vector<LoweredArgument> grad_args;
+    for (const auto &arg : gradient.args) {
+        if (arg.name != "__user_context") {
+            grad_args.push_back(arg);
+        }
+    }
+    const size_t grad_input_begin = inputs.size();
+    const size_t grad_output_begin = grad_input_begin + outputs.size();
+    bool matches = grad_args.size() == grad_output_begin + outputs.size() * buffer_input_count;
+    for (size_t i = 0; matches && i < grad_args.size(); i++) {
+        if (i < grad_input_begin) {
+            matches = grad_args[i].name == inputs[i].name && grad_args[i].kind == inputs[i].kind;
+        } else if (i < grad_output_begin) {
+            matches = grad_args[i].is_input() && grad_args[i].is_buffer();
+        } else {
+            matches = grad_args[i].is_output();
+        }
+    }
+    if (!matches) {
+        user_warning << "Not emitting a PyTorch autograd function for " << forward.name
+                     << ", because the arguments of " << gradient.name
+                     << " don't match those of its gradient.\n";
+        return;
+    }
+
+    std::vector<std::string> namespaces;
+    std::string simple_name = extract_namespaces(forward.name, namespaces);
+    const std::string simple_grad_name = strip_namespaces(gradient.name);
+    const std::string function_name = simple_name + "_autograd_";
+
+    if (!namespaces.empty()) {
+        for (const auto &ns : namespaces) {
+            stream << "namespace " << ns << " {\n";
+        }
+        stream << "\n";
+    }
+
+    const auto print_args = [&](const std::vector<LoweredArgument> &args) {
+        for (size_t i = 0; i < args.size(); i++) {
+            stream << (i > 0 ? ", " : "") << c_print_name(args[i].name);
+        }
+    };
+
+    stream << "// A differentiable version of " << simple_name << "_th_, using "
+           << simple_grad_name << "_th_ for the backward pass.\n";
+    stream << "// As for " << simple_name << "_th_, the caller allocates the outputs.\n";
+    stream << "struct " << function_name << " : public torch::autograd::Function<" << function_name << "> {\n";
+    indent += 4;
+
+    // The forward pass runs the op, and saves the inputs for the backward pass.
+    stream << get_indent() << "static torch::autograd::variable_list forward(torch::autograd::AutogradContext *ctx";
+    std::vector<LoweredArgument> forward_args = inputs;
+    forward_args.insert(forward_args.end(), outputs.begin(), outputs.end());
+    for (const auto &arg : forward_args) {
+        stream << ", ";
+        if (arg.is_buffer()) {
+            stream << "at::Tensor " << c_print_name(arg.name);
+        } else {
+            stream << type_to_c_type(arg.type, true) << c_print_name(arg.name);
+        }
+    }
+    stream << ") {\n";
+    indent += 4;
+    stream << get_indent() << "ctx->save_for_backward({";
+    bool first = true;
+    for (const auto &arg : inputs) {
+        if (arg.is_buffer()) {
+            stream << (first ? "" : ", ") << c_print_name(arg.name);
+            first = false;
+        }
+    }
+    stream << "});\n";
+    for (const auto &arg : inputs) {
+        if (arg.is_scalar()) {
+            stream << get_indent() << "ctx->saved_data[\"" << c_print_name(arg.name) << "\"] = ("
+                   << (arg.type.is_float() ? "double" : "int64_t") << ")" << c_print_name(arg.name) << ";\n";
+        }
+    }
+    stream << get_indent() << simple_name << "_th_(";
+    print_args(forward_args);
+    stream << ");\n";
+    stream << get_indent() << "ctx->mark_dirty({";
+    print_args(outputs);
+    stream << "});\n";
+    stream << get_indent() << "return {";
+    print_args(outputs);
+    stream << "};\n";
+    indent -= 4;
+    stream << get_indent() << "}\n\n";
+
+    // The backward pass runs the gradient, and sums the gradients with
+    // respect to each input over the outputs.
+    stream << get_indent() << "static torch::autograd::variable_list backward(torch::autograd::AutogradContext *ctx, "
+           << "torch::autograd::variable_list grad_outputs) {\n";
+    indent += 4;
+    stream << get_indent() << "torch::autograd::variable_list saved = ctx->get_saved_variables();\n";
+    int saved_index = 0;
+    for (const auto &arg : inputs) {
+        if (arg.is_buffer()) {
+            stream << get_indent() << "at::Tensor " << c_print_name(arg.name) << " = saved[" << saved_index++ << "];\n";
+        } else {
+            stream << get_indent() << type_to_c_type(arg.type, true) << c_print_name(arg.name) << " = ("
+                   << type_to_c_type(arg.type, false) << ")ctx->saved_data[\"" << c_print_name(arg.name) << "\"]."
+                   << (arg.type.is_float() ? "toDouble()" : "toInt()") << ";\n";
+        }
+    }
+    for (size_t i = 0; i < outputs.size(); i++) {
+        stream << get_indent() << "at::Tensor " << c_print_name(grad_args[grad_input_begin + i].name)
+               << " = grad_outputs[" << i << "].contiguous();\n";
+    }
+    std::vector<std::vector<std::string>> input_grads(inputs.size());
+    size_t grad_index = grad_output_begin;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        for (size_t j = 0; j < inputs.size(); j++) {
+            if (inputs[j].is_buffer()) {
+                const std::string name = c_print_name(grad_args[grad_index++].name);
+                stream << get_indent() << "at::Tensor " << name << " = at::empty_like(" << c_print_name(inputs[j].name) << ");\n";
+                input_grads[j].push_back(name);
+            }
+        }
+    }
+    stream << get_indent() << simple_grad_name << "_th_(";
+    print_args(grad_args);
+    stream << ");\n";
+    stream << get_indent() << "return {";
+    for (size_t j = 0; j < forward_args.size(); j++) {
+        stream << (j > 0 ? ", " : "");
+        if (j < inputs.size() && inputs[j].is_buffer()) {
+            for (size_t i = 0; i < input_grads[j].size(); i++) {
+                stream << (i > 0 ? " + " : "") << input_grads[j][i];
+            }
+        } else {
+            // Scalars and outputs have no gradient.
+            stream << "at::Tensor()";
+        }
+    }
+    stream << "};\n";
+    indent -= 4;
+    stream << get_indent() << "}\n";
+
+    indent -= 4;
+    stream << "};\n\n";
+
+    // The entry point, to register with pybind11 alongside the other ops.
+    stream << "inline torch::autograd::variable_list " << simple_name << "_autograd_th_(";
+    for (size_t i = 0; i < forward_args.size(); i++) {
+        stream << (i > 0 ? ", " : "");
+        if (forward_args[i].is_buffer()) {
+            stream << "at::Tensor &" << c_print_name(forward_args[i].name);
+        } else {
+            stream << type_to_c_type(forward_args[i].type, true) << c_print_name(forward_args[i].name);
+        }
+    }
+    stream << ") {\n";
+    indent += 4;
+    stream << get_indent() << "return " << function_name << "::apply(";
+    print_args(forward_args);
+    stream << ");\n";
+    indent -= 4;
+    stream << "}\n";
+
+    if (!namespaces.empty()) {
+        stream << "\n";
+        for (size_t i = namespaces.size(); i > 0; i--) {
+            stream << "}  // namespace " << namespaces[i - 1] << "\n";
+        }
+        stream << "\n";
+    }
+}
+
 }  // namespace Internal
 }  // namespace Halide
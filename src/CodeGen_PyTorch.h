@@ -11,6 +11,11 @@
  * The generated code checks for runtime errors and raises PyTorch exception
  * accordingly. It also makes sure the GPU device and stream are consistent when
  * the PyTorch input, when applicable.
+ *
+ * If the module also contains the gradient of a function (as produced by
+ * the "-d 2" Generator flag, see AbstractGenerator::build_gradient_module()),
+ * this also emits a torch::autograd::Function that uses both, so the
+ * Halide op can be used directly in training.
  */
 
 #include "IRPrinter.h"
@@ -36,6 +41,7 @@ public:
 
 private:
     void compile(const LoweredFunc &func, bool is_cuda);
+    void compile_autograd(const LoweredFunc &forward, const LoweredFunc &gradient);
 };
 
 }  // namespace Internal
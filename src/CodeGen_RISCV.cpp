@@ -64,8 +64,26 @@ struct RISCVIntrinsic {
         RoundDown = 1 << 1,         // Set vxrm rounding mode to down (rdn) before intrinsic.
         RoundUp = 1 << 2,           // Set vxrm rounding mode to up (rdu) before intrinsic.
         MangleReturnType = 1 << 3,  // Put return type mangling at start of type list.
-        ReverseBinOp = 1 << 4,      // Switch first two arguments to handle asymmetric ops.
+        ReverseBinOp = 1 << 4,      // Switch the last two arguments to handle asymmetric ops.
+        TiedAccumulator = 1 << 5,   // First argument is an accumulator in place of the tail argument.
     };
+
+    // The widest element type, in bits, and the largest relative scale,
+    // of the return and argument types at a type width scale of one.
+    int max_bits() const {
+        int bits = ret_type.type.bits() * ret_type.relative_scale;
+        for (const auto &arg_type : arg_types) {
+            bits = std::max(bits, arg_type.type.bits() * arg_type.relative_scale);
+        }
+        return bits;
+    }
+    int max_relative_scale() const {
+        int scale = ret_type.relative_scale;
+        for (const auto &arg_type : arg_types) {
+            scale = std::max(scale, arg_type.relative_scale);
+        }
+        return scale;
+    }
 };
 
 Type concretize_fixed_or_scalable(const IntrinsicArgPattern &f_or_v, int type_width_scale, int vector_bits) {
@@ -104,13 +122,19 @@ public:
      * enabled using the appropriate flags in the target struct. */
     CodeGen_RISCV(const Target &);
     llvm::Function *define_riscv_intrinsic_wrapper(const RISCVIntrinsic &intrin,
-                                                   int type_width_scale);
+                                                   int type_width_scale, int lmul);
 
 protected:
     using CodeGen_Posix::visit;
 
     void init_module() override;
 
+    /** Nodes for which we want to emit specific RISC-V vector intrinsics */
+    // @{
+    void visit(const Add *) override;
+    void visit(const Call *) override;
+    // @}
+
     string mcpu_target() const override;
     string mcpu_tune() const override;
     string mattrs() const override;
@@ -207,6 +231,26 @@ const RISCVIntrinsic intrinsic_defs[] = {
     {"vwmulu", {Type::UInt, 2}, "widening_mul", {Type::UInt, Type::UInt}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::MangleReturnType},
     {"vwmulsu", {Type::Int, 2}, "widening_mul", {Type::Int, Type::UInt}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::MangleReturnType},
     {"vwmulsu", {Type::Int, 2}, "widening_mul", {Type::UInt, Type::Int}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::MangleReturnType | RISCVIntrinsic::ReverseBinOp},
+    {"vasub", Type::Int, "halving_sub", {Type::Int, Type::Int}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::RoundDown},
+    {"vasubu", Type::UInt, "halving_sub", {Type::UInt, Type::UInt}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::RoundDown},
+    {"vsadd", Type::Int, "saturating_add", {Type::Int, Type::Int}, RISCVIntrinsic::AddVLArg},
+    {"vsaddu", Type::UInt, "saturating_add", {Type::UInt, Type::UInt}, RISCVIntrinsic::AddVLArg},
+    {"vssub", Type::Int, "saturating_sub", {Type::Int, Type::Int}, RISCVIntrinsic::AddVLArg},
+    {"vssubu", Type::UInt, "saturating_sub", {Type::UInt, Type::UInt}, RISCVIntrinsic::AddVLArg},
+    {"vwadd.w", {Type::Int, 2}, "widen_right_add", {{Type::Int, 2}, Type::Int}, RISCVIntrinsic::AddVLArg},
+    {"vwaddu.w", {Type::UInt, 2}, "widen_right_add", {{Type::UInt, 2}, Type::UInt}, RISCVIntrinsic::AddVLArg},
+    {"vwsub.w", {Type::Int, 2}, "widen_right_sub", {{Type::Int, 2}, Type::Int}, RISCVIntrinsic::AddVLArg},
+    {"vwsubu.w", {Type::UInt, 2}, "widen_right_sub", {{Type::UInt, 2}, Type::UInt}, RISCVIntrinsic::AddVLArg},
+    {"vwmacc", {Type::Int, 2}, "widening_mul_add", {{Type::Int, 2}, Type::Int, Type::Int}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::MangleReturnType | RISCVIntrinsic::TiedAccumulator},
+    {"vwmaccu", {Type::UInt, 2}, "widening_mul_add", {{Type::UInt, 2}, Type::UInt, Type::UInt}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::MangleReturnType | RISCVIntrinsic::TiedAccumulator},
+    {"vwmaccsu", {Type::Int, 2}, "widening_mul_add", {{Type::Int, 2}, Type::Int, Type::UInt}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::MangleReturnType | RISCVIntrinsic::TiedAccumulator},
+    {"vwmaccsu", {Type::Int, 2}, "widening_mul_add", {{Type::Int, 2}, Type::UInt, Type::Int}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::MangleReturnType | RISCVIntrinsic::TiedAccumulator | RISCVIntrinsic::ReverseBinOp},
+    {"vssra", Type::Int, "rounding_shift_right", {Type::Int, Type::UInt}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::RoundUp},
+    {"vssrl", Type::UInt, "rounding_shift_right", {Type::UInt, Type::UInt}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::RoundUp},
+    {"vnclip", Type::Int, "saturating_shift_right_narrow", {{Type::Int, 2}, Type::UInt}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::MangleReturnType | RISCVIntrinsic::RoundDown},
+    {"vnclipu", Type::UInt, "saturating_shift_right_narrow", {{Type::UInt, 2}, Type::UInt}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::MangleReturnType | RISCVIntrinsic::RoundDown},
+    {"vnclip", Type::Int, "saturating_rounding_shift_right_narrow", {{Type::Int, 2}, Type::UInt}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::MangleReturnType | RISCVIntrinsic::RoundUp},
+    {"vnclipu", Type::UInt, "saturating_rounding_shift_right_narrow", {{Type::UInt, 2}, Type::UInt}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::MangleReturnType | RISCVIntrinsic::RoundUp},
 };
 
 void CodeGen_RISCV::init_module() {
@@ -215,59 +259,50 @@ void CodeGen_RISCV::init_module() {
     int effective_vscale = target_vscale();
     if (effective_vscale != 0) {
         for (const RISCVIntrinsic &intrin : intrinsic_defs) {
-            std::vector<Type> arg_types;
-            arg_types.reserve(max_intrinsic_args);
-            if (intrin.ret_type.type_pattern == IntrinsicArgPattern::AllTypeWidths) {
-                // Iterate over 8/16/32/64 bit integer type widths via log2 shift amount.
-                // TODO: Will need to add floating point bit widths when an intrinsic is added.
-                //     Not doing this now as it is there would be no coverage, it requires
-                //     deciding whether to get floatness from an argument or return type,
-                //     and it probably has to check target flags to figure out Float(16)
-                //     and BFloat(16) availability.
-                for (int log2_of_scale = 0; log2_of_scale < 4; log2_of_scale++) {
-                    int bit_width_scale = 1 << log2_of_scale;
-
-                    Type ret_type = concretize_fixed_or_scalable(intrin.ret_type, bit_width_scale,
-                                                                 target.vector_bits);
-
-                    if ((intrin.ret_type.relative_scale * bit_width_scale * intrin.ret_type.type.bits()) > 64) {
+            // Iterate over 8/16/32/64 bit integer type widths via log2 shift amount.
+            // TODO: Will need to add floating point bit widths when an intrinsic is added.
+            //     Not doing this now as it is there would be no coverage, it requires
+            //     deciding whether to get floatness from an argument or return type,
+            //     and it probably has to check target flags to figure out Float(16)
+            //     and BFloat(16) availability.
+            bool all_type_widths = (intrin.ret_type.type_pattern == IntrinsicArgPattern::AllTypeWidths);
+            bool scalable = (intrin.ret_type.type_pattern != IntrinsicArgPattern::Fixed);
+            for (int log2_of_scale = 0; log2_of_scale < (all_type_widths ? 4 : 1); log2_of_scale++) {
+                int bit_width_scale = 1 << log2_of_scale;
+                if (intrin.max_bits() * bit_width_scale > 64) {
+                    break;
+                }
+
+                // Declare an overload for each register group size (LMUL) up
+                // to 8, so that vectors spanning several registers are handled
+                // by a single instruction instead of being sliced up.
+                for (int lmul = 1; lmul * intrin.max_relative_scale() <= 8; lmul *= 2) {
+                    if (lmul > 1 && !scalable) {
                         break;
                     }
-
+                    int vector_bits = target.vector_bits * lmul;
+                    Type ret_type = concretize_fixed_or_scalable(intrin.ret_type, bit_width_scale, vector_bits);
+                    std::vector<Type> arg_types;
+                    arg_types.reserve(max_intrinsic_args);
                     for (const auto &arg_type : intrin.arg_types) {
                         if (arg_type.type_pattern == IntrinsicArgPattern::Undefined) {
                             break;
                         }
-                        if ((arg_type.relative_scale * bit_width_scale * arg_type.type.bits()) > 64) {
-                            break;
-                        }
-                        arg_types.push_back(concretize_fixed_or_scalable(arg_type, bit_width_scale,
-                                                                         target.vector_bits));
+                        arg_types.push_back(concretize_fixed_or_scalable(arg_type, bit_width_scale, vector_bits));
                     }
-                    llvm::Function *intrin_impl = define_riscv_intrinsic_wrapper(intrin, bit_width_scale);
+                    llvm::Function *intrin_impl = define_riscv_intrinsic_wrapper(intrin, bit_width_scale, lmul);
                     declare_intrin_overload(intrin.name, ret_type, intrin_impl, arg_types);
-                    arg_types.clear();
                 }
-            } else {
-                llvm::Function *intrin_impl = define_riscv_intrinsic_wrapper(intrin, 1);
-                Type ret_type = concretize_fixed_or_scalable(intrin.ret_type, 1,
-                                                             target.vector_bits);
-                for (const auto &arg_type : intrin.arg_types) {
-                    if (arg_type.type_pattern == IntrinsicArgPattern::Undefined) {
-                        break;
-                    }
-                    arg_types.push_back(concretize_fixed_or_scalable(arg_type, 1, target.vector_bits));
-                }
-                declare_intrin_overload(intrin.name, ret_type, intrin_impl, arg_types);
-                arg_types.clear();
             }
         }
     }
 }
 
 llvm::Function *CodeGen_RISCV::define_riscv_intrinsic_wrapper(const RISCVIntrinsic &intrin,
-                                                              int bit_width_scale) {
+                                                              int bit_width_scale, int lmul) {
     int effective_vscale = target_vscale();
+    int vector_bits = target.vector_bits * lmul;
+    bool tied_accumulator = intrin.flags & RISCVIntrinsic::TiedAccumulator;
 
     llvm::Type *xlen_type = target.bits == 32 ? i32_t : i64_t;
 
@@ -276,7 +311,7 @@ llvm::Function *CodeGen_RISCV::define_riscv_intrinsic_wrapper(const RISCVIntrins
     std::string mangled_name = "llvm.riscv.";
     mangled_name += intrin.riscv_name;
     Type ret_type = concretize_fixed_or_scalable(intrin.ret_type, bit_width_scale,
-                                                 target.vector_bits);
+                                                 vector_bits);
     if (intrin.flags & RISCVIntrinsic::MangleReturnType) {
         bool scalable = (intrin.ret_type.type_pattern != IntrinsicArgPattern::Fixed);
         mangled_name += "." + mangle_vector_argument_type(ret_type, scalable, effective_vscale);
@@ -294,15 +329,21 @@ llvm::Function *CodeGen_RISCV::define_riscv_intrinsic_wrapper(const RISCVIntrins
         llvm_ret_type = llvm_type_of(ret_type);
     }
 
-    llvm_arg_types.push_back(llvm_ret_type);
+    // The tail argument, unless the accumulator takes its place.
+    if (!tied_accumulator) {
+        llvm_arg_types.push_back(llvm_ret_type);
+    }
     for (const auto &arg_type_pattern : intrin.arg_types) {
         if (arg_type_pattern.type_pattern == IntrinsicArgPattern::Undefined) {
             break;
         }
-        Type arg_type = concretize_fixed_or_scalable(arg_type_pattern, bit_width_scale, target.vector_bits);
+        Type arg_type = concretize_fixed_or_scalable(arg_type_pattern, bit_width_scale, vector_bits);
 
         bool scalable = (arg_type_pattern.type_pattern != IntrinsicArgPattern::Fixed);
-        mangled_name += "." + mangle_vector_argument_type(arg_type, scalable, effective_vscale);
+        // The accumulator has the return type, which is not mangled again.
+        if (!tied_accumulator || &arg_type_pattern != &intrin.arg_types[0]) {
+            mangled_name += "." + mangle_vector_argument_type(arg_type, scalable, effective_vscale);
+        }
         llvm::Type *llvm_type;
         if (arg_type.is_vector()) {
             int lanes = arg_type.lanes();
@@ -316,26 +357,31 @@ llvm::Function *CodeGen_RISCV::define_riscv_intrinsic_wrapper(const RISCVIntrins
         }
         llvm_arg_types.push_back(llvm_type);
     }
+    const size_t num_wrapper_args = llvm_arg_types.size() - (tied_accumulator ? 0 : 1);
     if (intrin.flags & RISCVIntrinsic::ReverseBinOp) {
         internal_assert(llvm_arg_types.size() > 2);
-        std::swap(llvm_arg_types[1], llvm_arg_types[2]);
+        std::swap(llvm_arg_types[llvm_arg_types.size() - 2], llvm_arg_types[llvm_arg_types.size() - 1]);
     }
     if (intrin.flags & RISCVIntrinsic::AddVLArg) {
         mangled_name += (target.bits == 64) ? ".i64" : ".i32";
         llvm_arg_types.push_back(xlen_type);
     }
+    if (tied_accumulator) {
+        // Tail policy argument
+        llvm_arg_types.push_back(xlen_type);
+    }
 
     llvm::Function *inner =
         get_llvm_intrin(llvm_ret_type, mangled_name, llvm_arg_types);
     llvm::FunctionType *inner_ty = inner->getFunctionType();
 
-    // Remove vector tail preservation argument.
-    llvm_arg_types.erase(llvm_arg_types.begin());
-    // Remove vector length argument passed to inrinsic for wrapper.
-    // Wrapper will supply a constant for the fixed vector length.
-    if (intrin.flags & RISCVIntrinsic::AddVLArg) {
-        llvm_arg_types.resize(llvm_arg_types.size() - 1);
+    // Remove vector tail preservation argument, and the vector length and
+    // policy arguments passed to intrinsic for wrapper. Wrapper will
+    // supply a constant for the fixed vector length.
+    if (!tied_accumulator) {
+        llvm_arg_types.erase(llvm_arg_types.begin());
     }
+    llvm_arg_types.resize(num_wrapper_args);
 
     string wrapper_name = unique_name(std::string(intrin.name) + "_wrapper");
     llvm::FunctionType *wrapper_ty = llvm::FunctionType::get(
@@ -365,17 +411,26 @@ llvm::Function *CodeGen_RISCV::define_riscv_intrinsic_wrapper(const RISCVIntrins
     }
 
     // Call the LLVM intrinsic.
-    int actual_lanes = ret_type.lanes();
-    llvm::Constant *vtype = llvm::ConstantInt::get(xlen_type, actual_lanes);
+    std::vector<llvm::Value *> call_args;
     // Add an initial argument to handle tail propagation. Only done if result is vector type.
-    int left_arg = 0;
-    int right_arg = 1;
+    if (!tied_accumulator) {
+        call_args.push_back(llvm::UndefValue::get(llvm_ret_type));
+    }
+    for (size_t i = 0; i < num_wrapper_args; i++) {
+        call_args.push_back(wrapper->getArg(i));
+    }
     if (intrin.flags & RISCVIntrinsic::ReverseBinOp) {
-        std::swap(left_arg, right_arg);
+        std::swap(call_args[call_args.size() - 2], call_args[call_args.size() - 1]);
+    }
+    if (intrin.flags & RISCVIntrinsic::AddVLArg) {
+        int actual_lanes = ret_type.lanes();
+        call_args.push_back(llvm::ConstantInt::get(xlen_type, actual_lanes));
     }
-    llvm::Value *ret = builder->CreateCall(inner, {llvm::UndefValue::get(llvm_ret_type),
-                                                   wrapper->getArg(left_arg), wrapper->getArg(right_arg),
-                                                   vtype});
+    if (tied_accumulator) {
+        // The tail is agnostic, as the full vector length is always used.
+        call_args.push_back(llvm::ConstantInt::get(xlen_type, 1));
+    }
+    llvm::Value *ret = builder->CreateCall(inner, call_args);
     builder->CreateRet(ret);
 
     // Always inline these wrappers.
@@ -390,6 +445,64 @@ llvm::Function *CodeGen_RISCV::define_riscv_intrinsic_wrapper(const RISCVIntrins
     return wrapper;
 }
 
+void CodeGen_RISCV::visit(const Add *op) {
+    if (target_vscale() != 0 && op->type.is_vector()) {
+        // A widening multiply-accumulate, e.g. vwmacc.
+        for (const auto &[acc, prod] : {std::make_pair(op->a, op->b), std::make_pair(op->b, op->a)}) {
+            const Call *mul = Call::as_intrinsic(prod, {Call::widening_mul});
+            if (mul) {
+                value = call_overloaded_intrin(op->type, "widening_mul_add", {acc, mul->args[0], mul->args[1]});
+                if (value) {
+                    return;
+                }
+            }
+        }
+    }
+    CodeGen_Posix::visit(op);
+}
+
+void CodeGen_RISCV::visit(const Call *op) {
+    if (target_vscale() != 0 && op->type.is_vector()) {
+        if (op->is_intrinsic(Call::saturating_cast) &&
+            (op->type.is_int() || op->type.is_uint()) &&
+            op->args[0].type() == op->type.widen()) {
+            // Saturating narrows, optionally of a shift right by a
+            // constant, are vnclip(u), with the rounding mode picking
+            // between a truncating or a rounding shift.
+            Expr x = op->args[0];
+            Expr shift = make_zero(UInt(op->type.bits()));
+            const char *intrin = "saturating_shift_right_narrow";
+            const Call *c = Call::as_intrinsic(x, {Call::shift_right, Call::rounding_shift_right});
+            const int64_t *const_shift = c ? as_const_int(c->args[1]) : nullptr;
+            const uint64_t *const_ushift = c ? as_const_uint(c->args[1]) : nullptr;
+            int64_t s = const_shift ? *const_shift : const_ushift ? (int64_t)*const_ushift : -1;
+            if (s >= 0 && s < x.type().bits()) {
+                shift = make_const(UInt(op->type.bits()), s);
+                if (c->is_intrinsic(Call::rounding_shift_right)) {
+                    intrin = "saturating_rounding_shift_right_narrow";
+                }
+                x = c->args[0];
+            }
+            value = call_overloaded_intrin(op->type, intrin, {x, shift});
+            if (value) {
+                return;
+            }
+        } else if (op->is_intrinsic(Call::rounding_shift_right) &&
+                   op->args[1].type().is_int()) {
+            // vssra and vssrl take an unsigned shift.
+            const int64_t *shift = as_const_int(op->args[1]);
+            if (shift && *shift >= 0 && *shift < op->type.bits()) {
+                value = call_overloaded_intrin(op->type, "rounding_shift_right",
+                                               {op->args[0], make_const(UInt(op->type.bits()), *shift)});
+                if (value) {
+                    return;
+                }
+            }
+        }
+    }
+    CodeGen_Posix::visit(op);
+}
+
 }  // anonymous namespace
 
 std::unique_ptr<CodeGen_Posix> new_CodeGen_RISCV(const Target &target) {
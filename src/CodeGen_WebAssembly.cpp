@@ -1,11 +1,13 @@
 #include <functional>
 #include <sstream>
 
+#include "Bounds.h"
 #include "CodeGen_Posix.h"
 #include "ConciseCasts.h"
 #include "IRMatch.h"
 #include "IROperator.h"
 #include "LLVM_Headers.h"
+#include "Simplify.h"
 #include "Substitute.h"
 
 namespace Halide {
@@ -38,6 +40,8 @@ protected:
     int native_vector_bits() const override;
     bool use_pic() const override;
 
+    void visit(const Add *) override;
+    void visit(const Sub *) override;
     void visit(const Cast *) override;
     void visit(const Call *) override;
     void codegen_vector_reduce(const VectorReduce *, const Expr &) override;
@@ -115,6 +119,25 @@ const WasmIntrinsic intrinsic_defs[] = {
     {"llvm.nearbyint.v2f64", Float(64, 2), "nearbyint", {Float(64, 2)}, Target::WasmSimd128},
     {"llvm.nearbyint.f32", Float(32), "nearbyint", {Float(32)}},
     {"llvm.nearbyint.f64", Float(64), "nearbyint", {Float(64)}},
+
+    // The relaxed SIMD intrinsics were renamed (and some had their
+    // operands reordered) while the proposal was in flux, so only use
+    // them with LLVM versions that have the final names.
+#if LLVM_VERSION >= 160
+    {"llvm.wasm.relaxed.madd.v4f32", Float(32, 4), "relaxed_madd", {Float(32, 4), Float(32, 4), Float(32, 4)}, Target::WasmRelaxedSimd},
+    {"llvm.wasm.relaxed.madd.v2f64", Float(64, 2), "relaxed_madd", {Float(64, 2), Float(64, 2), Float(64, 2)}, Target::WasmRelaxedSimd},
+    {"llvm.wasm.relaxed.nmadd.v4f32", Float(32, 4), "relaxed_nmadd", {Float(32, 4), Float(32, 4), Float(32, 4)}, Target::WasmRelaxedSimd},
+    {"llvm.wasm.relaxed.nmadd.v2f64", Float(64, 2), "relaxed_nmadd", {Float(64, 2), Float(64, 2), Float(64, 2)}, Target::WasmRelaxedSimd},
+
+    // Out-of-range float to int conversions are undefined in Halide, so
+    // we don't need the saturating behavior of the non-relaxed versions.
+    {"llvm.wasm.relaxed.trunc.signed", Int(32, 4), "relaxed_trunc", {Float(32, 4)}, Target::WasmRelaxedSimd},
+    {"llvm.wasm.relaxed.trunc.unsigned", UInt(32, 4), "relaxed_trunc", {Float(32, 4)}, Target::WasmRelaxedSimd},
+
+    // The second operand of these must be in [0, 127] (see is_int7 below).
+    {"llvm.wasm.relaxed.dot.i8x16.i7x16.signed", Int(16, 8), "relaxed_dot_product", {Int(8, 16), Int(8, 16)}, Target::WasmRelaxedSimd},
+    {"llvm.wasm.relaxed.dot.i8x16.i7x16.add.signed", Int(32, 4), "relaxed_dot_product", {Int(8, 16), Int(8, 16), Int(32, 4)}, Target::WasmRelaxedSimd},
+#endif
 };
 // clang-format on
 
@@ -142,6 +165,42 @@ void CodeGen_WebAssembly::init_module() {
     }
 }
 
+void CodeGen_WebAssembly::visit(const Add *op) {
+    // Relaxed madd may or may not round the product before adding, which
+    // is only allowed outside of strict_float.
+    if (target.has_feature(Target::WasmRelaxedSimd) &&
+        op->type.is_float() && op->type.is_vector() && !strict_float) {
+        const Mul *mul = op->a.as<Mul>();
+        Expr addend = op->b;
+        if (!mul) {
+            mul = op->b.as<Mul>();
+            addend = op->a;
+        }
+        if (mul) {
+            value = call_overloaded_intrin(op->type, "relaxed_madd", {mul->a, mul->b, addend});
+            if (value) {
+                return;
+            }
+        }
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
+void CodeGen_WebAssembly::visit(const Sub *op) {
+    if (target.has_feature(Target::WasmRelaxedSimd) &&
+        op->type.is_float() && op->type.is_vector() && !strict_float) {
+        if (const Mul *mul = op->b.as<Mul>()) {
+            value = call_overloaded_intrin(op->type, "relaxed_nmadd", {mul->a, mul->b, op->a});
+            if (value) {
+                return;
+            }
+        }
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
 void CodeGen_WebAssembly::visit(const Cast *op) {
     struct Pattern {
         std::string intrin;  ///< Name of the intrinsic
@@ -159,6 +218,8 @@ void CodeGen_WebAssembly::visit(const Cast *op) {
         {"widen_integer", u32(wild_u16x_), Target::WasmSimd128},
         {"widen_integer", i64(wild_i32x_), Target::WasmSimd128},
         {"widen_integer", u64(wild_u32x_), Target::WasmSimd128},
+        {"relaxed_trunc", i32(wild_f32x_), Target::WasmRelaxedSimd},
+        {"relaxed_trunc", u32(wild_f32x_), Target::WasmRelaxedSimd},
     };
     // clang-format on
 
@@ -237,16 +298,36 @@ void CodeGen_WebAssembly::visit(const Call *op) {
     CodeGen_Posix::visit(op);
 }
 
+// The relaxed dot products may treat the top bit of their second operand
+// as either a sign bit or a magnitude bit, so their result is only
+// deterministic if that operand is known to be in [0, 127].
+bool is_int7(const Expr &e) {
+    Interval i = bounds_of_expr_in_scope(e, Scope<Interval>::empty_scope());
+    return i.is_bounded() && can_prove(i.min >= 0 && i.max <= 127);
+}
+
 void CodeGen_WebAssembly::codegen_vector_reduce(const VectorReduce *op, const Expr &init) {
     struct Pattern {
+        enum Flags {
+            CombineInit = 1 << 0,  // Pass the initial value (or zero) as the last argument.
+            Int7Operand = 1 << 1,  // One operand must be in [0, 127]; it is passed second.
+        };
         VectorReduce::Operator reduce_op;
         int factor;
         Expr pattern;
         const char *intrin;
         Target::Feature required_feature;
+        int flags = 0;
     };
     // clang-format off
     static const Pattern patterns[] = {
+        {VectorReduce::Add, 4, i32(widening_mul(wild_i8x_, wild_i8x_)), "relaxed_dot_product", Target::WasmRelaxedSimd, Pattern::CombineInit | Pattern::Int7Operand},
+        {VectorReduce::Add, 4, i32(widening_mul(wild_i8x_, wild_u8x_)), "relaxed_dot_product", Target::WasmRelaxedSimd, Pattern::CombineInit | Pattern::Int7Operand},
+        {VectorReduce::Add, 4, i32(widening_mul(wild_u8x_, wild_i8x_)), "relaxed_dot_product", Target::WasmRelaxedSimd, Pattern::CombineInit | Pattern::Int7Operand},
+        {VectorReduce::Add, 2, widening_mul(wild_i8x_, wild_i8x_), "relaxed_dot_product", Target::WasmRelaxedSimd, Pattern::Int7Operand},
+        {VectorReduce::Add, 2, widening_mul(wild_i8x_, wild_u8x_), "relaxed_dot_product", Target::WasmRelaxedSimd, Pattern::Int7Operand},
+        {VectorReduce::Add, 2, widening_mul(wild_u8x_, wild_i8x_), "relaxed_dot_product", Target::WasmRelaxedSimd, Pattern::Int7Operand},
+
         {VectorReduce::Add, 2, i16(wild_i8x_), "pairwise_widening_add", Target::WasmSimd128},
         {VectorReduce::Add, 2, u16(wild_u8x_), "pairwise_widening_add", Target::WasmSimd128},
         {VectorReduce::Add, 2, i16(wild_u8x_), "pairwise_widening_add", Target::WasmSimd128},
@@ -280,6 +361,23 @@ void CodeGen_WebAssembly::codegen_vector_reduce(const VectorReduce *op, const Ex
             continue;
         }
         if (expr_match(p.pattern, op->value, matches)) {
+            if (p.flags & Pattern::Int7Operand) {
+                if (!is_int7(matches[1])) {
+                    std::swap(matches[0], matches[1]);
+                }
+                // The other operand is passed as signed, so it can only
+                // be a uint8 if it is also in [0, 127].
+                if (!is_int7(matches[1]) ||
+                    (matches[0].type().is_uint() && !is_int7(matches[0]))) {
+                    continue;
+                }
+                for (Expr &m : matches) {
+                    if (m.type().is_uint()) {
+                        m = reinterpret(m.type().with_code(Type::Int), m);
+                    }
+                }
+            }
+
             if (factor != p.factor) {
                 Expr equiv = VectorReduce::make(op->op, op->value, op->value.type().lanes() / p.factor);
                 equiv = VectorReduce::make(op->op, equiv, op->type.lanes());
@@ -287,6 +385,15 @@ void CodeGen_WebAssembly::codegen_vector_reduce(const VectorReduce *op, const Ex
                 return;
             }
 
+            if (p.flags & Pattern::CombineInit) {
+                matches.push_back(init.defined() ? init : make_zero(op->type));
+                value = call_overloaded_intrin(op->type, p.intrin, matches);
+                if (value) {
+                    return;
+                }
+                continue;
+            }
+
             if (const Shuffle *s = matches[0].as<Shuffle>()) {
                 if (s->is_broadcast() && matches.size() == 2) {
                     // LLVM wants the broadcast as the second operand for the broadcasting
@@ -337,6 +444,13 @@ string CodeGen_WebAssembly::mattrs() const {
         sep = ",";
     }
 
+    if (target.has_feature(Target::WasmRelaxedSimd)) {
+        user_assert(target.has_feature(Target::WasmSimd128))
+            << "wasm_relaxed_simd requires wasm_simd128.";
+        s << sep << "+relaxed-simd";
+        sep = ",";
+    }
+
     if (target.has_feature(Target::WasmThreads)) {
         // "WasmThreads" doesn't directly affect LLVM codegen,
         // but it does end up requiring atomics, so be sure to enable them.
@@ -2,6 +2,7 @@
 #include "CodeGen_Posix.h"
 #include "ConciseCasts.h"
 #include "Debug.h"
+#include "GatherScatter.h"
 #include "IRMatch.h"
 #include "IRMutator.h"
 #include "IROperator.h"
@@ -28,6 +29,9 @@ namespace {
 // existing flags, so that instruction patterns can just check for the
 // oldest feature flag that supports an instruction.
 Target complete_x86_target(Target t) {
+    if (t.has_feature(Target::AVX512_FP16)) {
+        t.set_feature(Target::AVX512_SapphireRapids);
+    }
     if (t.has_feature(Target::AVX512_SapphireRapids)) {
         t.set_feature(Target::AVX512_Cannonlake);
     }
@@ -69,6 +73,16 @@ protected:
 
     llvm::Type *llvm_type_of(const Type &t) const override;
 
+    /** With AVX512-FP16, float16 is a native arithmetic type rather
+     * than being widened to float32. */
+    // @{
+    bool is_float16_and_has_feature(const Type &t) const;
+    Type upgrade_type_for_arithmetic(const Type &t) const override;
+    Type upgrade_type_for_argument_passing(const Type &t) const override;
+    Type upgrade_type_for_storage(const Type &t) const override;
+    bool supports_call_as_float16(const Call *op) const override;
+    // @}
+
     using CodeGen_Posix::visit;
 
     void init_module() override;
@@ -92,6 +106,13 @@ protected:
     void codegen_vector_reduce(const VectorReduce *, const Expr &init) override;
     // @}
 
+    /** Is this an unpredicated vector load or store at data-dependent
+     * addresses? */
+    bool is_data_dependent_access(const Type &type, const Expr &index, const Expr &predicate) const;
+
+    /** A vector of the addresses of the lanes of a load or store. */
+    llvm::Value *codegen_lane_pointers(const std::string &name, const Type &type, const Expr &index);
+
 private:
     Scope<MemoryType> mem_type;
 };
@@ -140,6 +161,19 @@ const x86Intrinsic intrinsic_defs[] = {
     {"llvm.sadd.sat.v32i8", Int(8, 32), "saturating_add", {Int(8, 32), Int(8, 32)}, Target::AVX2},
     {"llvm.sadd.sat.v16i8", Int(8, 16), "saturating_add", {Int(8, 16), Int(8, 16)}},
     {"llvm.sadd.sat.v8i8", Int(8, 8), "saturating_add", {Int(8, 8), Int(8, 8)}},
+
+    {"llvm.sqrt.v32f16", Float(16, 32), "sqrt_f16", {Float(16, 32)}, Target::AVX512_FP16},
+    {"llvm.sqrt.v16f16", Float(16, 16), "sqrt_f16", {Float(16, 16)}, Target::AVX512_FP16},
+    {"llvm.sqrt.v8f16", Float(16, 8), "sqrt_f16", {Float(16, 8)}, Target::AVX512_FP16},
+    {"llvm.floor.v32f16", Float(16, 32), "floor_f16", {Float(16, 32)}, Target::AVX512_FP16},
+    {"llvm.floor.v16f16", Float(16, 16), "floor_f16", {Float(16, 16)}, Target::AVX512_FP16},
+    {"llvm.floor.v8f16", Float(16, 8), "floor_f16", {Float(16, 8)}, Target::AVX512_FP16},
+    {"llvm.ceil.v32f16", Float(16, 32), "ceil_f16", {Float(16, 32)}, Target::AVX512_FP16},
+    {"llvm.ceil.v16f16", Float(16, 16), "ceil_f16", {Float(16, 16)}, Target::AVX512_FP16},
+    {"llvm.ceil.v8f16", Float(16, 8), "ceil_f16", {Float(16, 8)}, Target::AVX512_FP16},
+    {"llvm.trunc.v32f16", Float(16, 32), "trunc_f16", {Float(16, 32)}, Target::AVX512_FP16},
+    {"llvm.trunc.v16f16", Float(16, 16), "trunc_f16", {Float(16, 16)}, Target::AVX512_FP16},
+    {"llvm.trunc.v8f16", Float(16, 8), "trunc_f16", {Float(16, 8)}, Target::AVX512_FP16},
     {"llvm.ssub.sat.v64i8", Int(8, 64), "saturating_sub", {Int(8, 64), Int(8, 64)}, Target::AVX512_Skylake},
     {"llvm.ssub.sat.v32i8", Int(8, 32), "saturating_sub", {Int(8, 32), Int(8, 32)}, Target::AVX2},
     {"llvm.ssub.sat.v16i8", Int(8, 16), "saturating_sub", {Int(8, 16), Int(8, 16)}},
@@ -548,6 +582,15 @@ void CodeGen_X86::visit(const Call *op) {
         return;
     }
 
+    if (op->call_type == Call::PureExtern &&
+        is_float16_and_has_feature(op->type) &&
+        supports_call_as_float16(op)) {
+        value = call_overloaded_intrin(op->type, op->name, op->args);
+        if (value) {
+            return;
+        }
+    }
+
     // A 16-bit mul-shift-right of less than 16 can sometimes be rounded up to a
     // full 16 to use pmulh(u)w by left-shifting one of the operands. This is
     // handled here instead of in the lowering of mul_shift_right because it's
@@ -848,6 +891,17 @@ void CodeGen_X86::visit(const Load *op) {
         value = load;
         return;
     }
+    if (is_data_dependent_access(op->type, op->index, op->predicate) &&
+        target_has_gather(target, op->type)) {
+        // choose_gathers_and_scatters has already scalarized the
+        // gathers that shouldn't use vpgather.
+        Value *ptrs = codegen_lane_pointers(op->name, op->type, op->index);
+        Instruction *gather = builder->CreateMaskedGather(llvm_type_of(op->type), ptrs,
+                                                          llvm::Align(op->type.bytes()));
+        add_tbaa_metadata(gather, op->name, op->index);
+        value = gather;
+        return;
+    }
     CodeGen_Posix::visit(op);
 }
 
@@ -862,9 +916,33 @@ void CodeGen_X86::visit(const Store *op) {
         add_tbaa_metadata(store, op->name, op->index);
         return;
     }
+    if (is_data_dependent_access(op->value.type(), op->index, op->predicate) &&
+        target_has_scatter(target, op->value.type())) {
+        // Overlapping lanes of a scatter are written in lane order,
+        // as they would be by separate stores.
+        Value *val = codegen(op->value);
+        Value *ptrs = codegen_lane_pointers(op->name, op->value.type(), op->index);
+        Instruction *scatter = builder->CreateMaskedScatter(val, ptrs,
+                                                            llvm::Align(op->value.type().bytes()));
+        add_tbaa_metadata(scatter, op->name, op->index);
+        return;
+    }
     CodeGen_Posix::visit(op);
 }
 
+bool CodeGen_X86::is_data_dependent_access(const Type &type, const Expr &index, const Expr &predicate) const {
+    return type.is_vector() &&
+           upgrade_type_for_storage(type) == type &&
+           is_const_one(predicate) &&
+           !index.as<Ramp>() &&
+           !index.as<Broadcast>();
+}
+
+Value *CodeGen_X86::codegen_lane_pointers(const string &name, const Type &type, const Expr &index) {
+    Value *base = codegen_buffer_pointer(name, type.element_of(), make_zero(index.type().element_of()));
+    return builder->CreateInBoundsGEP(llvm_type_of(type.element_of()), base, codegen(index));
+}
+
 string CodeGen_X86::mcpu_target() const {
     // Perform an ad-hoc guess for the -mcpu given features.
     // WARNING: this is used to drive -mcpu, *NOT* -mtune!
@@ -961,10 +1039,65 @@ string CodeGen_X86::mattrs() const {
         if (target.has_feature(Target::AVX512_SapphireRapids)) {
             features += ",+avx512bf16,+avx512vnni,+amx-int8,+amx-bf16";
         }
+        if (target.has_feature(Target::AVX512_FP16)) {
+            features += ",+avx512fp16";
+        }
+    }
+#if LLVM_VERSION >= 170
+    if (target.has_feature(Target::AVX2)) {
+        // choose_gathers_and_scatters has already decided which
+        // gathers and scatters are worth it, so LLVM shouldn't
+        // scalarize them.
+        features += separator + "-prefer-no-gather,-prefer-no-scatter";
+        separator = ",";
     }
+#endif
     return features;
 }
 
+bool CodeGen_X86::is_float16_and_has_feature(const Type &t) const {
+    // There is no native bfloat16 arithmetic, only conversions and
+    // dot products, so bfloat16 is still widened.
+    return t.code() == Type::Float && t.bits() == 16 && target.has_feature(Target::AVX512_FP16);
+}
+
+Type CodeGen_X86::upgrade_type_for_arithmetic(const Type &t) const {
+    if (is_float16_and_has_feature(t)) {
+        return t;
+    }
+    return CodeGen_Posix::upgrade_type_for_arithmetic(t);
+}
+
+Type CodeGen_X86::upgrade_type_for_argument_passing(const Type &t) const {
+    if (is_float16_and_has_feature(t)) {
+        return t;
+    }
+    return CodeGen_Posix::upgrade_type_for_argument_passing(t);
+}
+
+Type CodeGen_X86::upgrade_type_for_storage(const Type &t) const {
+    if (is_float16_and_has_feature(t)) {
+        return t;
+    }
+    return CodeGen_Posix::upgrade_type_for_storage(t);
+}
+
+bool CodeGen_X86::supports_call_as_float16(const Call *op) const {
+    // These have native float16 instructions. The transcendentals
+    // are still computed in float32, but the conversions to and from
+    // it are native.
+    static const std::set<string> native_funcs = {
+        "ceil_f16",
+        "floor_f16",
+        "is_finite_f16",
+        "is_inf_f16",
+        "is_nan_f16",
+        "sqrt_f16",
+        "trunc_f16",
+    };
+    return target.has_feature(Target::AVX512_FP16) && native_funcs.count(op->name);
+}
+
 bool CodeGen_X86::use_soft_float_abi() const {
     return false;
 }
@@ -0,0 +1,128 @@
+#include <algorithm>
+
+#include "CodeSizeBudget.h"
+#include "CompilerLogger.h"
+#include "Debug.h"
+#include "Function.h"
+#include "IRVisitor.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Count the nodes of the IR as a tree: a shared subexpression is
+// generated once for each place it is used.
+class CountNodes : public IRGraphVisitor {
+    using IRGraphVisitor::include;
+
+    void include(const Expr &e) override {
+        count++;
+        e.accept(this);
+    }
+
+    void include(const Stmt &s) override {
+        count++;
+        s.accept(this);
+    }
+
+public:
+    uint64_t count = 0;
+
+    void count_stmt(const Stmt &s) {
+        include(s);
+    }
+};
+
+class MeasureProducers : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->is_producer && budgets.count(op->name)) {
+            sizes[op->name] += code_size(op->body);
+        }
+        IRVisitor::visit(op);
+    }
+
+    const map<string, int> &budgets;
+
+public:
+    map<string, uint64_t> sizes;
+
+    MeasureProducers(const map<string, int> &budgets)
+        : budgets(budgets) {
+    }
+};
+
+}  // namespace
+
+uint64_t code_size(const Stmt &s) {
+    if (!s.defined()) {
+        return 0;
+    }
+    CountNodes counter;
+    counter.count_stmt(s);
+    return counter.count;
+}
+
+CodeSizeBudget::CodeSizeBudget(const Stmt &s, const map<string, Function> &env) {
+    map<string, int> budgets;
+    for (const auto &p : env) {
+        int budget = p.second.schedule().code_size_budget();
+        if (budget > 0) {
+            budgets[p.first] = budget;
+        }
+    }
+    if (budgets.empty()) {
+        return;
+    }
+
+    MeasureProducers measure(budgets);
+    s.accept(&measure);
+    for (const auto &p : budgets) {
+        FuncBudget &f = funcs[p.first];
+        f.budget = p.second;
+        f.size = measure.sizes[p.first];
+    }
+}
+
+set<string> CodeSizeBudget::choose(const string &transform, vector<CodeSizeCandidate> candidates) {
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const CodeSizeCandidate &a, const CodeSizeCandidate &b) {
+                         if (a.depth != b.depth) {
+                             return a.depth > b.depth;
+                         }
+                         return a.cost < b.cost;
+                     });
+
+    set<string> rejected;
+    for (const CodeSizeCandidate &c : candidates) {
+        auto it = funcs.find(c.func);
+        if (it == funcs.end()) {
+            continue;
+        }
+        FuncBudget &f = it->second;
+        bool applied = f.size + c.cost <= f.budget;
+        if (applied) {
+            f.size += c.cost;
+        } else {
+            rejected.insert(c.loop);
+        }
+        debug(1) << "Code size budget of " << c.func << ": "
+                 << (applied ? "applying " : "not applying ") << transform
+                 << " to loop " << c.loop << " (+" << c.cost << " nodes, "
+                 << f.size << " of " << f.budget << " used)\n";
+        if (auto *logger = get_compiler_logger()) {
+            logger->record_code_size_decision(c.func, c.loop, transform, c.cost, applied);
+        }
+    }
+    return rejected;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,81 @@
+#ifndef HALIDE_CODE_SIZE_BUDGET_H
+#define HALIDE_CODE_SIZE_BUDGET_H
+
+/** \file
+ * Defines the bookkeeping that keeps the loop nests of Funcs within the
+ * code size budgets set with Func::code_size_budget.
+ */
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** A loop that a lowering pass would like to transform by duplicating
+ * its body. */
+struct CodeSizeCandidate {
+    /** The Func whose loop nest the loop belongs to. */
+    std::string func;
+
+    /** The name of the loop. */
+    std::string loop;
+
+    /** The number of IR nodes the transformation is expected to add. */
+    uint64_t cost;
+
+    /** The number of loops (including this one) of the Func enclosing
+     * the body. Deeper loops run more often, so they are expected to
+     * benefit more. */
+    int depth;
+};
+
+/** The size of the code generated for a statement, estimated as the
+ * number of IR nodes in it, counting shared subexpressions once per
+ * use. */
+uint64_t code_size(const Stmt &s);
+
+/** The sizes and code size budgets of the Funcs in a lowered
+ * statement that have one. */
+class CodeSizeBudget {
+    struct FuncBudget {
+        uint64_t size = 0, budget = 0;
+    };
+    std::map<std::string, FuncBudget> funcs;
+
+public:
+    /** Measure the producers of the Funcs in the environment with a
+     * code size budget. */
+    CodeSizeBudget(const Stmt &s, const std::map<std::string, Function> &env);
+
+    /** Whether any Func has a code size budget. */
+    bool empty() const {
+        return funcs.empty();
+    }
+
+    /** Whether the given Func has a code size budget. */
+    bool has_budget(const std::string &func) const {
+        return funcs.count(func) != 0;
+    }
+
+    /** Decide which candidates to transform, in order of expected
+     * benefit: deepest first, then cheapest first. Candidates are
+     * accepted while they fit within the budget of their Func, and
+     * their cost is then charged to it. Each decision is reported at
+     * debug level 1 and to the CompilerLogger, if any, under the given
+     * name of the transformation. Returns the names of the loops that
+     * must be left alone. */
+    std::set<std::string> choose(const std::string &transform,
+                                 std::vector<CodeSizeCandidate> candidates);
+};
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
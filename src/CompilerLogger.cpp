@@ -17,7 +17,7 @@ namespace {
 // TODO: for now we are just going to ignore potential issues with
 // static-initialization-order-fiasco, as CompilerLogger isn't currently used
 // from any static-initialization execution scope.
-std::unique_ptr<CompilerLogger> active_compiler_logger;
+thread_local std::unique_ptr<CompilerLogger> active_compiler_logger;
 
 class ObfuscateNames : public IRMutator {
     using IRMutator::visit;
@@ -116,6 +116,34 @@ void JSONCompilerLogger::record_compilation_time(Phase phase, double duration) {
     compilation_time[phase] += duration;
 }
 
+void JSONCompilerLogger::record_lowering_pass(const std::string &pass_name, double duration,
+                                              uint64_t peak_rss_bytes, uint64_t ir_node_count,
+                                              uint64_t simplifier_rewrites) {
+    lowering_passes.push_back({pass_name, duration, peak_rss_bytes, ir_node_count, simplifier_rewrites});
+}
+
+void JSONCompilerLogger::record_lowered_func(const std::string &name, uint64_t ir_node_count) {
+    lowered_funcs[name].ir_node_count = ir_node_count;
+}
+
+void JSONCompilerLogger::record_lowered_func_object_code_size(const std::string &name, uint64_t bytes) {
+    lowered_funcs[name].object_code_size += bytes;
+}
+
+void JSONCompilerLogger::record_peak_rss(uint64_t bytes) {
+    peak_rss_bytes = std::max(peak_rss_bytes, bytes);
+}
+
+void JSONCompilerLogger::record_code_size_decision(const std::string &func, const std::string &loop,
+                                                   const std::string &transform, uint64_t cost,
+                                                   bool applied) {
+    code_size_decisions.push_back({func, loop, transform, cost, applied});
+}
+
+void JSONCompilerLogger::record_static_workspace_size(const std::string &name, uint64_t bytes) {
+    static_workspace_sizes[name] = bytes;
+}
+
 void JSONCompilerLogger::obfuscate() {
     {
         std::map<std::string, std::vector<Expr>> n;
@@ -269,13 +297,104 @@ std::ostream &JSONCompilerLogger::emit_to_stream(std::ostream &o) {
     if (object_code_size) {
         emit_key_value(o, indent, "object_code_size", object_code_size);
     }
+    if (peak_rss_bytes) {
+        emit_key_value(o, indent, "peak_rss", peak_rss_bytes);
+    }
 
     // If these are present, emit them, even if value is zero
     if (compilation_time.count(Phase::HalideLowering)) {
         emit_key_value(o, indent, "compilation_time_halide_lowering", compilation_time[Phase::HalideLowering]);
     }
-    if (compilation_time.count(Phase::LLVM)) {
-        emit_key_value(o, indent, "compilation_time_llvm", compilation_time[Phase::LLVM]);
+    // LLVM time is recorded by sub-phase where possible; report the total
+    // under the original key as well, so existing consumers keep working.
+    if (compilation_time.count(Phase::LLVM) ||
+        compilation_time.count(Phase::LLVMOptimization) ||
+        compilation_time.count(Phase::LLVMCodeGen)) {
+        double llvm_time = 0;
+        for (Phase p : {Phase::LLVM, Phase::LLVMOptimization, Phase::LLVMCodeGen}) {
+            auto it = compilation_time.find(p);
+            if (it != compilation_time.end()) {
+                llvm_time += it->second;
+            }
+        }
+        emit_key_value(o, indent, "compilation_time_llvm", llvm_time);
+    }
+    if (compilation_time.count(Phase::LLVMOptimization)) {
+        emit_key_value(o, indent, "compilation_time_llvm_optimization", compilation_time[Phase::LLVMOptimization]);
+    }
+    if (compilation_time.count(Phase::LLVMCodeGen)) {
+        emit_key_value(o, indent, "compilation_time_llvm_codegen", compilation_time[Phase::LLVMCodeGen]);
+    }
+
+    if (!lowering_passes.empty()) {
+        std::string spaces(indent, ' ');
+        emit_key(o, indent, "lowering_passes");
+        o << "[\n";
+        int commas_to_emit = (int)lowering_passes.size() - 1;
+        for (const auto &pass : lowering_passes) {
+            o << spaces << " {\n";
+            emit_key_value(o, indent + 2, "name", pass.name);
+            emit_key_value(o, indent + 2, "time", pass.duration);
+            emit_key_value(o, indent + 2, "peak_rss", pass.peak_rss_bytes);
+            emit_key_value(o, indent + 2, "ir_nodes", pass.ir_node_count);
+            emit_key_value(o, indent + 2, "simplifier_rewrites", pass.simplifier_rewrites, false);
+            o << spaces << " }";
+            emit_eol(o, commas_to_emit-- > 0);
+        }
+        o << spaces << "]";
+        emit_eol(o);
+    }
+
+    if (!lowered_funcs.empty()) {
+        std::string spaces(indent, ' ');
+        emit_key(o, indent, "lowered_funcs");
+        o << "[\n";
+        int commas_to_emit = (int)lowered_funcs.size() - 1;
+        for (const auto &it : lowered_funcs) {
+            o << spaces << " {\n";
+            emit_key_value(o, indent + 2, "name", it.first);
+            emit_key_value(o, indent + 2, "ir_nodes", it.second.ir_node_count);
+            emit_key_value(o, indent + 2, "object_code_size", it.second.object_code_size, false);
+            o << spaces << " }";
+            emit_eol(o, commas_to_emit-- > 0);
+        }
+        o << spaces << "]";
+        emit_eol(o);
+    }
+
+    if (!code_size_decisions.empty()) {
+        std::string spaces(indent, ' ');
+        emit_key(o, indent, "code_size_decisions");
+        o << "[\n";
+        int commas_to_emit = (int)code_size_decisions.size() - 1;
+        for (const auto &d : code_size_decisions) {
+            o << spaces << " {\n";
+            emit_key_value(o, indent + 2, "func", d.func);
+            emit_key_value(o, indent + 2, "loop", d.loop);
+            emit_key_value(o, indent + 2, "transform", d.transform);
+            emit_key_value(o, indent + 2, "cost", d.cost);
+            emit_key_value(o, indent + 2, "applied", d.applied ? "true" : "false", false);
+            o << spaces << " }";
+            emit_eol(o, commas_to_emit-- > 0);
+        }
+        o << spaces << "]";
+        emit_eol(o);
+    }
+
+    if (!static_workspace_sizes.empty()) {
+        std::string spaces(indent, ' ');
+        emit_key(o, indent, "static_workspaces");
+        o << "[\n";
+        int commas_to_emit = (int)static_workspace_sizes.size() - 1;
+        for (const auto &it : static_workspace_sizes) {
+            o << spaces << " {\n";
+            emit_key_value(o, indent + 2, "name", it.first);
+            emit_key_value(o, indent + 2, "bytes", it.second, false);
+            o << spaces << " }";
+            emit_eol(o, commas_to_emit-- > 0);
+        }
+        o << spaces << "]";
+        emit_eol(o);
     }
 
     if (!matched_simplifier_rules.empty()) {
@@ -15,6 +15,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "Expr.h"
 #include "Target.h"
@@ -28,6 +29,8 @@ public:
     enum class Phase {
         HalideLowering,
         LLVM,
+        LLVMOptimization,
+        LLVMCodeGen,
     };
 
     CompilerLogger() = default;
@@ -53,19 +56,73 @@ public:
      */
     virtual void record_compilation_time(Phase phase, double duration) = 0;
 
+    /** Record the cost of a single lowering pass: the time taken (in seconds),
+     * the peak resident set size of the process (in bytes) at the end of the
+     * pass, the number of distinct IR nodes in the resulting Stmt, and the
+     * number of simplifier rewrite rules that matched during the pass.
+     * The default implementation ignores the data.
+     */
+    virtual void record_lowering_pass(const std::string &pass_name, double duration,
+                                      uint64_t peak_rss_bytes, uint64_t ir_node_count,
+                                      uint64_t simplifier_rewrites) {
+    }
+
+    /** Record the size of a single LoweredFunc of the Module, as the number
+     * of distinct IR nodes in its body once lowering is complete. Closures
+     * split out of the pipeline (e.g. the bodies of parallel loops) are
+     * LoweredFuncs of their own. The default implementation ignores the data.
+     */
+    virtual void record_lowered_func(const std::string &name, uint64_t ir_node_count) {
+    }
+
+    /** Record the size (in bytes) of the machine code generated for a
+     * LoweredFunc, as found in the object file(s) produced. The default
+     * implementation ignores the data.
+     */
+    virtual void record_lowered_func_object_code_size(const std::string &name, uint64_t bytes) {
+    }
+
+    /** Record the peak resident set size of the process (in bytes) once
+     * compilation of the Module is complete. The default implementation
+     * ignores the data.
+     */
+    virtual void record_peak_rss(uint64_t bytes) {
+    }
+
+    /** Record whether a lowering pass applied a code-duplicating
+     * transformation (e.g. "unroll" or "partition") to a loop of a Func
+     * with a code size budget, along with the number of IR nodes it
+     * was estimated to add. See \ref Func::code_size_budget. The
+     * default implementation ignores the data.
+     */
+    virtual void record_code_size_decision(const std::string &func, const std::string &loop,
+                                           const std::string &transform, uint64_t cost,
+                                           bool applied) {
+    }
+
+    /** Record the size (in bytes) of the static workspace a pipeline
+     * compiled with the static_workspace target feature needs. The
+     * default implementation ignores the data.
+     */
+    virtual void record_static_workspace_size(const std::string &name, uint64_t bytes) {
+    }
+
     /**
      * Emit all the gathered data to the given stream. This may be called multiple times.
      */
     virtual std::ostream &emit_to_stream(std::ostream &o) = 0;
 };
 
-/** Set the active CompilerLogger object, replacing any existing one.
+/** Set the active CompilerLogger object for the calling thread, replacing
+ * any existing one. Each thread has its own, so that pipelines compiled
+ * concurrently (e.g. by compile_multitarget) log separately.
  * It is legal to pass in a nullptr (which means "don't do any compiler logging").
  * Returns the previous CompilerLogger (if any). */
 std::unique_ptr<CompilerLogger> set_compiler_logger(std::unique_ptr<CompilerLogger> compiler_logger);
 
-/** Return the currently active CompilerLogger object. If set_compiler_logger()
- * has never been called, a nullptr implementation will be returned.
+/** Return the currently active CompilerLogger object for the calling thread.
+ * If set_compiler_logger() has never been called on this thread, a nullptr
+ * implementation will be returned.
  * Do not save the pointer returned! It is intended to be used for immediate
  * calls only. */
 CompilerLogger *get_compiler_logger();
@@ -90,6 +147,16 @@ public:
     void record_failed_to_prove(Expr failed_to_prove, Expr original_expr) override;
     void record_object_code_size(uint64_t bytes) override;
     void record_compilation_time(Phase phase, double duration) override;
+    void record_lowering_pass(const std::string &pass_name, double duration,
+                              uint64_t peak_rss_bytes, uint64_t ir_node_count,
+                              uint64_t simplifier_rewrites) override;
+    void record_lowered_func(const std::string &name, uint64_t ir_node_count) override;
+    void record_lowered_func_object_code_size(const std::string &name, uint64_t bytes) override;
+    void record_peak_rss(uint64_t bytes) override;
+    void record_code_size_decision(const std::string &func, const std::string &loop,
+                                   const std::string &transform, uint64_t cost,
+                                   bool applied) override;
+    void record_static_workspace_size(const std::string &name, uint64_t bytes) override;
 
     std::ostream &emit_to_stream(std::ostream &o) override;
 
@@ -116,6 +183,40 @@ protected:
     // Map of the time take for each phase of compilation.
     std::map<Phase, double> compilation_time;
 
+    struct LoweringPass {
+        std::string name;
+        double duration;
+        uint64_t peak_rss_bytes;
+        uint64_t ir_node_count;
+        uint64_t simplifier_rewrites;
+    };
+
+    // The cost of each lowering pass, in the order in which they ran.
+    std::vector<LoweringPass> lowering_passes;
+
+    struct LoweredFuncSize {
+        uint64_t ir_node_count{0};
+        uint64_t object_code_size{0};
+    };
+
+    // The size of each LoweredFunc, by name.
+    std::map<std::string, LoweredFuncSize> lowered_funcs;
+
+    // The largest peak resident set size recorded, in bytes.
+    uint64_t peak_rss_bytes{0};
+
+    struct CodeSizeDecision {
+        std::string func, loop, transform;
+        uint64_t cost;
+        bool applied;
+    };
+
+    // The choices made to keep Funcs within their code size budgets.
+    std::vector<CodeSizeDecision> code_size_decisions;
+
+    // The size of the static workspace of each pipeline, by name.
+    std::map<std::string, uint64_t> static_workspace_sizes;
+
     void obfuscate();
     void emit();
 };
@@ -198,9 +198,9 @@ private:
     Expr visit(const VectorReduce *op) override {
         std::vector<int> input_lanes;
         int factor = op->value.type().lanes() / op->type.lanes();
-        for (int i = starting_lane; i < op->type.lanes(); i += lane_stride) {
+        for (int i = 0; i < new_lanes; i++) {
             for (int j = 0; j < factor; j++) {
-                input_lanes.push_back(i * factor + j);
+                input_lanes.push_back((starting_lane + i * lane_stride) * factor + j);
             }
         }
         Expr in = Shuffle::make({op->value}, input_lanes);
@@ -356,7 +356,9 @@ private:
     }
 
     Expr visit(const Shuffle *op) override {
-        if (op->is_interleave()) {
+        if (op->is_interleave() &&
+            starting_lane < lane_stride &&
+            new_lanes * lane_stride == op->type.lanes()) {
             // Special case where we can discard some of the vector arguments entirely.
             internal_assert(starting_lane >= 0 && starting_lane < lane_stride);
             if ((int)op->vectors.size() == lane_stride) {
@@ -438,6 +440,12 @@ Expr extract_lane(const Expr &e, int lane) {
     return deinterleave(e, lane, e.type().lanes(), 1, lets);
 }
 
+Expr extract_lanes(const Expr &e, int starting_lane, int lane_stride, int new_lanes) {
+    internal_assert(starting_lane + (new_lanes - 1) * lane_stride < e.type().lanes());
+    Scope<> lets;
+    return deinterleave(e, starting_lane, lane_stride, new_lanes, lets);
+}
+
 namespace {
 
 class Interleaver : public IRMutator {
@@ -836,6 +844,13 @@ void deinterleave_vector_test() {
           Shuffle::make({vec_x, vec_y}, {0, 2, 4, 3, 1, 3}),
           Shuffle::make({vec_x, vec_y}, {4, 6, 2, 7, 2, 4}));
 
+    // Ranges of lanes that aren't a half or a third of the vector.
+    Expr range = extract_lanes(ramp, 2, 1, 4);
+    internal_assert(equal(range, Ramp::make(x + 10, 3, 4))) << range << "\n";
+    range = extract_lanes(Load::make(ramp.type(), "buf", ramp, Buffer<>(), Parameter(), const_true(ramp.type().lanes()), ModulusRemainder()), 4, 1, 2);
+    internal_assert(equal(range, Load::make(Int(32, 2), "buf", Ramp::make(x + 16, 3, 2), Buffer<>(), Parameter(), const_true(2), ModulusRemainder())))
+        << range << "\n";
+
     std::cout << "deinterleave_vector test passed" << std::endl;
 }
 
@@ -22,6 +22,10 @@ Expr extract_even_lanes(const Expr &a);
 /** Extract the nth lane of a vector */
 Expr extract_lane(const Expr &vec, int lane);
 
+/** Extract new_lanes lanes of a vector, starting at the given lane and
+ * stepping by lane_stride. */
+Expr extract_lanes(const Expr &vec, int starting_lane, int lane_stride, int new_lanes);
+
 /** Look through a statement for expressions of the form select(ramp %
  * 2 == 0, a, b) and replace them with calls to an interleave
  * intrinsic */
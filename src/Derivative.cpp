@@ -14,6 +14,7 @@
 #include "IREquality.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "Qualify.h"
 #include "RealizationOrder.h"
 #include "Simplify.h"
 #include "Solve.h"
@@ -1916,6 +1917,84 @@ void ReverseAccumulationVisitor::propagate_halide_function_call(
     }
 }
 
+/** Replace calls to the given forward Funcs with their definitions, so
+ * that the adjoints recompute those values instead of keeping them from
+ * the forward pass. */
+class RecomputeForwardFuncs : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, Function> &recomputed;
+
+    Expr visit(const Call *op) override {
+        if (op->call_type != Call::Halide) {
+            return IRMutator::visit(op);
+        }
+        auto it = recomputed.find(op->name);
+        if (it == recomputed.end()) {
+            return IRMutator::visit(op);
+        }
+        const Function &f = it->second;
+        vector<Expr> args = mutate(op->args);
+
+        // The definition may itself call Funcs that are recomputed.
+        Expr body = mutate(qualify(f.name() + ".", f.values()[op->value_index]));
+        const vector<string> &func_args = f.args();
+        internal_assert(args.size() == func_args.size());
+        for (size_t i = 0; i < args.size(); i++) {
+            body = Let::make(f.name() + "." + func_args[i], args[i], body);
+        }
+        return body;
+    }
+
+public:
+    RecomputeForwardFuncs(const map<string, Function> &recomputed)
+        : recomputed(recomputed) {
+    }
+};
+
+// Only pure Funcs can be recomputed where they are used. The others
+// are always kept.
+bool can_be_recomputed(const Function &f) {
+    return f.can_be_inlined();
+}
+
+/** Make the adjoints recompute every forward Func the output depends on,
+ * except for the output itself, the checkpoints, and the Funcs that
+ * can't be recomputed. */
+void recompute_forward_funcs(const Func &output,
+                             const vector<Func> &checkpoints,
+                             map<FuncKey, Func> &adjoints) {
+    map<string, Function> forward = find_transitive_calls(output.function());
+    set<string> kept = {output.name()};
+    for (const auto &f : checkpoints) {
+        kept.insert(f.name());
+    }
+    map<string, Function> recomputed;
+    for (const auto &it : forward) {
+        if (!kept.count(it.first) && can_be_recomputed(it.second)) {
+            recomputed.insert(it);
+        }
+    }
+    if (recomputed.empty()) {
+        return;
+    }
+
+    // Rewrite the adjoints, and any helper Funcs they call that are not
+    // part of the forward pipeline.
+    map<string, Function> backward;
+    for (const auto &it : adjoints) {
+        for (const auto &f : find_transitive_calls(it.second.function())) {
+            if (!forward.count(f.first)) {
+                backward.insert(f);
+            }
+        }
+    }
+    RecomputeForwardFuncs recompute(recomputed);
+    for (auto &it : backward) {
+        it.second.mutate(&recompute);
+    }
+}
+
 }  // namespace
 }  // namespace Internal
 
@@ -1970,6 +2049,22 @@ Derivative propagate_adjoints(const Func &output,
     return Derivative{visitor.get_adjoint_funcs()};
 }
 
+Derivative propagate_adjoints(const Func &output,
+                              const Func &adjoint,
+                              const Region &output_bounds,
+                              const std::vector<Func> &checkpoints) {
+    user_assert(output.dimensions() == adjoint.dimensions())
+        << "output dimensions and adjoint dimensions must match\n";
+    user_assert((int)output_bounds.size() == adjoint.dimensions())
+        << "output_bounds and adjoint dimensions must match\n";
+
+    Internal::ReverseAccumulationVisitor visitor;
+    visitor.propagate_adjoints(output, adjoint, output_bounds);
+    map<FuncKey, Func> adjoints = visitor.get_adjoint_funcs();
+    Internal::recompute_forward_funcs(output, checkpoints, adjoints);
+    return Derivative{std::move(adjoints)};
+}
+
 Derivative propagate_adjoints(const Func &output,
                               const Buffer<float> &adjoint) {
     user_assert(output.dimensions() == adjoint.dimensions());
@@ -1992,4 +2087,37 @@ Derivative propagate_adjoints(const Func &output) {
     return propagate_adjoints(output, adjoint, output_bounds);
 }
 
+Derivative propagate_adjoints(const Func &output,
+                              const std::vector<Func> &checkpoints) {
+    Func adjoint("adjoint");
+    adjoint(output.args()) = Internal::make_one(output.value().type());
+    Region output_bounds;
+    output_bounds.reserve(output.dimensions());
+    for (int i = 0; i < output.dimensions(); i++) {
+        output_bounds.emplace_back(0, 0);
+    }
+    return propagate_adjoints(output, adjoint, output_bounds, checkpoints);
+}
+
+std::vector<Func> choose_checkpoints(const Func &output) {
+    map<string, Internal::Function> env = Internal::find_transitive_calls(output.function());
+    vector<string> order = Internal::realization_order({output.function()}, env).first;
+    vector<Func> candidates;
+    for (const auto &func_name : order) {
+        const Internal::Function &f = env[func_name];
+        if (func_name != output.name() && Internal::can_be_recomputed(f)) {
+            candidates.emplace_back(f);
+        }
+    }
+    // Keeping every k-th Func in realization order, with k close to
+    // sqrt(n), keeps about sqrt(n) of them, and recomputes each of the
+    // others from at most about sqrt(n) Funcs back.
+    size_t k = std::max<size_t>(1, (size_t)std::lround(std::sqrt((double)candidates.size())));
+    vector<Func> checkpoints;
+    for (size_t i = k - 1; i < candidates.size(); i += k) {
+        checkpoints.push_back(candidates[i]);
+    }
+    return checkpoints;
+}
+
 }  // namespace Halide
@@ -70,6 +70,36 @@ Derivative propagate_adjoints(const Func &output,
  */
 Derivative propagate_adjoints(const Func &output);
 
+/**
+ *  Like the propagate_adjoints above, but with checkpointing. By default
+ *  the adjoints call the forward Funcs they need, so every forward
+ *  intermediate has to be kept for the backward pass. With these
+ *  versions, only the output, the given checkpoints and the Funcs which
+ *  can't be inlined (those with update or extern definitions) are kept.
+ *  The adjoints recompute the values of every other forward Func from
+ *  the nearest kept ones instead. This trades compute for memory: a
+ *  recomputed stencil is evaluated once per use, so long chains of
+ *  stencils between checkpoints get expensive. Pass an empty list of
+ *  checkpoints to recompute everything possible, or use
+ *  choose_checkpoints to pick them.
+ */
+// @{
+Derivative propagate_adjoints(const Func &output,
+                              const Func &adjoint,
+                              const Region &output_bounds,
+                              const std::vector<Func> &checkpoints);
+Derivative propagate_adjoints(const Func &output,
+                              const std::vector<Func> &checkpoints);
+// @}
+
+/**
+ *  Choose checkpoints for propagate_adjoints automatically. Of the
+ *  forward Funcs the output depends on that could be recomputed, this
+ *  keeps every k-th one in realization order, with k close to the
+ *  square root of their number.
+ */
+std::vector<Func> choose_checkpoints(const Func &output);
+
 }  // namespace Halide
 
 #endif
@@ -92,6 +92,15 @@ struct IRNode {
     }
     virtual ~IRNode() = default;
 
+    /** IR nodes are allocated from per-thread pools of pages, one size
+     * class per page, rather than individually from the heap. A page is
+     * returned to the system as soon as the last node in it is freed.
+     * See IRNodeAllocator.h. */
+    // @{
+    static void *operator new(size_t size);
+    static void operator delete(void *ptr, size_t size);
+    // @}
+
     /** These classes are all managed with intrusive reference
      * counting, so we also track a reference count. It's mutable
      * so that we can do reference counting even through const
@@ -384,6 +393,11 @@ enum class MemoryType {
     /** AMX Tile register for X86. Any data that would be used in an AMX matrix
      * multiplication must first be loaded into an AMX tile register. */
     AMXTile,
+
+    /** A WMMA accumulator fragment for CUDA tensor cores. The 16x16 tile
+     * is distributed across the registers of the lanes of a warp, and
+     * can only be the target of a matrix multiply-accumulate. */
+    WMMAAccumulator,
 };
 
 namespace Internal {
@@ -0,0 +1,524 @@
+#include "ExtractTensorCoreOperations.h"
+
+#include "CodeGen_GPU_Dev.h"
+#include "Deinterleave.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "Target.h"
+#include "Util.h"
+
+/** \file Support extraction of CUDA WMMA instructions.
+ *
+ * A Func stored in MemoryType::WMMAAccumulator must be a 16x16 tile,
+ * vectorized across both dimensions, whose update definition is a
+ * matrix multiply with a reduction over 16 elements that is also
+ * vectorized:
+ *
+ *   C(x, y) += f32(A(r, y)) * f32(B(x, r))
+ *
+ * After vectorization, the update is a single 256-wide VectorReduce
+ * of 4096 products. We recognize the loads of A and B within that as
+ * 16x16 tiles, and the stores to and from C as 16x16 tiles, and then
+ * replace the whole thing with WMMA fragment operations. The
+ * fragments are distributed across the lanes of a warp, so the GPU
+ * block computing the tile becomes a single warp executing the same
+ * code in every lane.
+ */
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// m16n16k16 is supported for all of the input types we handle.
+constexpr int wmma_tile = 16;
+constexpr int wmma_tile_elements = wmma_tile * wmma_tile;
+constexpr int warp_size = 32;
+// Each lane of the warp holds 8 elements of the accumulator.
+constexpr int wmma_accumulator_lanes = wmma_tile_elements / warp_size;
+
+struct FragmentType {
+    // The name of the type in the PTX instructions.
+    string ptx_type;
+    // The number of 32-bit registers per lane holding an A or B fragment.
+    int registers;
+    // The type of the accumulator.
+    Type accumulator;
+    // The minimum CUDA capability with tensor cores for this type.
+    int min_cuda_capability;
+};
+
+bool get_fragment_type(const Type &t, FragmentType *result) {
+    if (t == Float(16)) {
+        *result = {"f16", 8, Float(32), 70};
+    } else if (t == BFloat(16)) {
+        *result = {"bf16", 4, Float(32), 80};
+    } else if (t == Int(8)) {
+        *result = {"s8", 2, Int(32), 75};
+    } else if (t == UInt(8)) {
+        *result = {"u8", 2, Int(32), 75};
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// An index that is affine in each of a set of nested loops that have
+// been vectorized, with the given extents, innermost first.
+struct AffineTile {
+    bool result = false;
+    Expr base;
+    vector<Expr> strides;
+};
+
+AffineTile get_affine_tile(const Expr &index, const vector<int> &extents) {
+    int lanes = 1;
+    for (int e : extents) {
+        lanes *= e;
+    }
+    if (index.type().lanes() != lanes) {
+        return {};
+    }
+
+    AffineTile tile;
+    tile.base = simplify(extract_lane(index, 0));
+    Expr equiv = tile.base;
+    int inner = 1;
+    for (int e : extents) {
+        Expr stride = simplify(extract_lane(index, inner) - tile.base);
+        tile.strides.push_back(stride);
+        equiv = Ramp::make(equiv, inner == 1 ? stride : Broadcast::make(stride, inner), e);
+        inner *= e;
+    }
+    if (!is_const_zero(simplify(index - equiv))) {
+        return {};
+    }
+    tile.result = true;
+    return tile;
+}
+
+// Get the layout and leading dimension of a 2D tile of a matrix,
+// given the strides in the row and column directions.
+bool get_layout(const Expr &row_stride, const Expr &column_stride, string *layout, Expr *leading_dim) {
+    if (is_const_one(column_stride)) {
+        *layout = "row";
+        *leading_dim = row_stride;
+    } else if (is_const_one(row_stride)) {
+        *layout = "col";
+        *leading_dim = column_stride;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// WMMA loads and stores require 256-bit aligned addresses and a
+// leading dimension that is a multiple of 16 bytes. We assume the
+// base address of the buffer is aligned, which is true of any device
+// allocation made by Halide.
+bool is_wmma_aligned(const Expr &base, const Expr &leading_dim, int bytes) {
+    return can_prove(base % (32 / bytes) == 0 &&
+                     leading_dim % (16 / bytes) == 0);
+}
+
+// Check the only stores in the kernel are to fragments.
+class StoresOnlyTo : public IRVisitor {
+    using IRVisitor::visit;
+
+    const std::set<string> &names;
+
+    void visit(const Store *op) override {
+        result = result && names.count(op->name);
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool result = true;
+
+    StoresOnlyTo(const std::set<string> &names)
+        : names(names) {
+    }
+};
+
+class HasThreadLoops : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        result = result || CodeGen_GPU_Dev::is_gpu_thread_var(op->name);
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool result = false;
+};
+
+class HasBlockLoops : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        result = result || CodeGen_GPU_Dev::is_gpu_block_var(op->name);
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool result = false;
+};
+
+class ExtractTensorCoreOperations : public IRMutator {
+    using IRMutator::visit;
+
+    const Target &target;
+
+    // Whether we're in the innermost loop over GPU blocks.
+    bool in_block = false;
+
+    // Why the tensor core operations can't be used in the current
+    // block, if anything.
+    string block_failure;
+
+    // The names of the fragments made in the current block.
+    std::set<string> fragments;
+
+    string tile_name;
+    string fragment_name;
+    Type accumulator_type;
+    bool found_matmul = false;
+
+    // The first reason found for why the current accumulator
+    // allocation can't use tensor cores. If this is set, the
+    // allocation falls back to ordinary vector code.
+    string failure;
+
+    void fail(const string &reason) {
+        if (failure.empty()) {
+            failure = reason;
+        }
+    }
+
+    Stmt fall_back(const Allocate *op, const string &reason) {
+        user_warning << "Cannot use tensor cores for " << op->name
+                     << ", which is stored in MemoryType::WMMAAccumulator: " << reason
+                     << "\nFalling back to ordinary vector code.\n";
+        ScopedValue<string> old_tile_name(tile_name, "");
+        return Allocate::make(op->name, op->type, MemoryType::Auto, op->extents, op->condition,
+                              mutate(op->body), op->new_expr, op->free_function, op->padding);
+    }
+
+    Expr load_fragment() const {
+        Type t = accumulator_type.with_lanes(wmma_accumulator_lanes);
+        return Load::make(t, fragment_name, Ramp::make(0, 1, wmma_accumulator_lanes),
+                          Buffer<>(), Parameter(), const_true(wmma_accumulator_lanes), ModulusRemainder());
+    }
+
+    Stmt store_fragment(const Expr &value) const {
+        return Store::make(fragment_name, value, Ramp::make(0, 1, wmma_accumulator_lanes),
+                           Parameter(), const_true(wmma_accumulator_lanes), ModulusRemainder());
+    }
+
+    // Is this an access to the entire accumulator tile, in order?
+    bool is_whole_tile(const Expr &index) const {
+        AffineTile tile = get_affine_tile(index, {wmma_tile, wmma_tile});
+        return (tile.result &&
+                is_const_zero(tile.base) &&
+                is_const_one(tile.strides[0]) &&
+                is_const(tile.strides[1], wmma_tile));
+    }
+
+    Stmt convert_to_matmul(const Store *op) {
+        const Add *add = op->value.as<Add>();
+        if (!add) {
+            return Stmt();
+        }
+        const VectorReduce *reduce = add->a.as<VectorReduce>();
+        const Load *self = add->b.as<Load>();
+        if (!reduce) {
+            reduce = add->b.as<VectorReduce>();
+            self = add->a.as<Load>();
+        }
+        if (!reduce || !self ||
+            reduce->op != VectorReduce::Add ||
+            self->name != tile_name ||
+            !equal(self->index, op->index)) {
+            return Stmt();
+        }
+        if (reduce->value.type().lanes() != wmma_tile_elements * wmma_tile) {
+            fail("The reduction in the matrix multiply must be vectorized by a factor of 16.");
+            return Stmt();
+        }
+        const Mul *mul = reduce->value.as<Mul>();
+        if (!mul) {
+            return Stmt();
+        }
+
+        // Both operands should be lossless casts of loads to the
+        // accumulator type.
+        auto get_operand = [&](const Expr &e) -> const Load * {
+            const Cast *cast = e.as<Cast>();
+            if (!cast || cast->type.element_of() != accumulator_type) {
+                return nullptr;
+            }
+            return cast->value.as<Load>();
+        };
+        const Load *a = get_operand(mul->a);
+        const Load *b = get_operand(mul->b);
+        if (!a || !b) {
+            return Stmt();
+        }
+
+        FragmentType frag;
+        if (a->type.element_of() != b->type.element_of() ||
+            !get_fragment_type(a->type.element_of(), &frag) ||
+            frag.accumulator != accumulator_type) {
+            std::ostringstream error;
+            error << "Tensor cores can only multiply two float16, bfloat16, or 8-bit integer matrices "
+                  << "into a float32 (for floats) or int32 (for integers) accumulator, not "
+                  << a->type.element_of() << " and " << b->type.element_of()
+                  << " into " << accumulator_type << ".";
+            fail(error.str());
+            return Stmt();
+        }
+        if (target.get_cuda_capability_lower_bound() < frag.min_cuda_capability) {
+            std::ostringstream error;
+            error << "Tensor core multiplies of " << a->type.element_of()
+                  << " require a CUDA capability of at least " << frag.min_cuda_capability / 10
+                  << "." << frag.min_cuda_capability % 10 << ".";
+            fail(error.str());
+            return Stmt();
+        }
+
+        // The lanes of the products are the reduction dimension k,
+        // then the columns n, then the rows m. A varies with k and m,
+        // and B varies with k and n.
+        vector<int> extents = {wmma_tile, wmma_tile, wmma_tile};
+        AffineTile a_tile = get_affine_tile(a->index, extents);
+        AffineTile b_tile = get_affine_tile(b->index, extents);
+        if (a_tile.result && b_tile.result && !is_const_zero(a_tile.strides[1])) {
+            std::swap(a, b);
+            std::swap(a_tile, b_tile);
+        }
+        if (!a_tile.result || !b_tile.result ||
+            !is_const_zero(a_tile.strides[1]) ||
+            !is_const_zero(b_tile.strides[2])) {
+            fail("The operands of the matrix multiply are not 16x16 tiles of A(k, m) and B(n, k).");
+            return Stmt();
+        }
+
+        string a_layout, b_layout;
+        Expr a_leading_dim, b_leading_dim;
+        if (!get_layout(a_tile.strides[2], a_tile.strides[0], &a_layout, &a_leading_dim) ||
+            !get_layout(b_tile.strides[0], b_tile.strides[1], &b_layout, &b_leading_dim)) {
+            fail("The operands of the matrix multiply must be dense in either the row or column direction.");
+            return Stmt();
+        }
+        int bytes = a->type.bytes();
+        if (!is_wmma_aligned(a_tile.base, a_leading_dim, bytes) ||
+            !is_wmma_aligned(b_tile.base, b_leading_dim, bytes)) {
+            fail("Could not prove the tiles of the operands are 32-byte aligned with a "
+                 "row stride that is a multiple of 16 bytes. Try constraining the mins "
+                 "and strides of the inputs.");
+            return Stmt();
+        }
+
+        found_matmul = true;
+
+        auto load_operand = [&](const char *name, const Load *load, const AffineTile &tile,
+                                const Expr &leading_dim, const string &layout) {
+            Expr start = Load::make(load->type.element_of(), load->name, tile.base,
+                                    load->image, load->param, const_true(), ModulusRemainder());
+            return Call::make(UInt(32, frag.registers), name,
+                              {start, leading_dim, layout, frag.ptx_type}, Call::Intrinsic);
+        };
+        Expr a_frag = load_operand("wmma_load_a", a, a_tile, a_leading_dim, a_layout);
+        Expr b_frag = load_operand("wmma_load_b", b, b_tile, b_leading_dim, b_layout);
+        Expr mma = Call::make(accumulator_type.with_lanes(wmma_accumulator_lanes), "wmma_mma",
+                              {load_fragment(), a_frag, b_frag, a_layout, b_layout, frag.ptx_type},
+                              Call::Intrinsic);
+        return store_fragment(mma);
+    }
+
+    Stmt convert_to_tile_store(const Store *op) {
+        AffineTile tile = get_affine_tile(op->index, {wmma_tile, wmma_tile});
+        string layout;
+        Expr leading_dim;
+        if (!tile.result ||
+            !get_layout(tile.strides[1], tile.strides[0], &layout, &leading_dim)) {
+            fail("A store from the accumulator does not store a 16x16 tile that is dense in "
+                 "either the row or column direction.");
+            return Stmt();
+        }
+        if (!is_wmma_aligned(tile.base, leading_dim, accumulator_type.bytes())) {
+            fail("Could not prove the stored tile is 32-byte aligned with a row stride "
+                 "that is a multiple of 16 bytes. Try constraining the mins and strides "
+                 "of the output.");
+            return Stmt();
+        }
+        Expr start = Load::make(accumulator_type, op->name, tile.base,
+                                Buffer<>(), op->param, const_true(), ModulusRemainder());
+        Expr store = Call::make(Int(32), "wmma_store",
+                                {start, leading_dim, layout, load_fragment()}, Call::Intrinsic);
+        return Evaluate::make(store);
+    }
+
+    Stmt visit(const For *op) override {
+        HasBlockLoops inner_blocks;
+        op->body.accept(&inner_blocks);
+        if (in_block ||
+            !CodeGen_GPU_Dev::is_gpu_block_var(op->name) ||
+            inner_blocks.result) {
+            return IRMutator::visit(op);
+        }
+
+        ScopedValue<bool> old_in_block(in_block, true);
+        ScopedValue<string> old_block_failure(block_failure, "");
+        fragments.clear();
+
+        HasThreadLoops threads;
+        op->body.accept(&threads);
+        if (op->device_api != DeviceAPI::CUDA) {
+            block_failure = "Tensor cores are only supported in CUDA kernels.";
+        } else if (threads.result) {
+            block_failure = ("The GPU kernel has loops over threads. Each GPU block using tensor "
+                             "cores must compute the tile as a single warp, with no gpu_threads "
+                             "or gpu_lanes loops.");
+        }
+
+        Stmt body = mutate(op->body);
+        if (!fragments.empty()) {
+            // Every lane of the warp is going to execute the body, so
+            // it can't do anything other than the tensor core
+            // operations.
+            StoresOnlyTo check(fragments);
+            body.accept(&check);
+            if (check.result) {
+                body = For::make(unique_name("wmma") + ".__thread_id_x", 0, warp_size,
+                                 ForType::GPULane, DeviceAPI::CUDA, body);
+            } else {
+                block_failure = ("The GPU block contains stores other than the tensor core "
+                                 "operations, and every lane of the warp would run them.");
+                body = mutate(op->body);
+            }
+        }
+        fragments.clear();
+
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (op->memory_type != MemoryType::WMMAAccumulator) {
+            return IRMutator::visit(op);
+        }
+        if (!in_block) {
+            return fall_back(op, "It is not computed inside a GPU block.");
+        }
+        if (!block_failure.empty()) {
+            return fall_back(op, block_failure);
+        }
+        if (op->type != Float(32) && op->type != Int(32)) {
+            return fall_back(op, "Tensor core accumulators must be 32-bit integers or 32-bit floats.");
+        }
+        if (op->constant_allocation_size() != wmma_tile_elements) {
+            return fall_back(op, "Tensor core accumulators must be a single 16x16 tile.");
+        }
+
+        user_assert(tile_name.empty()) << "Already in tensor core allocation: " << tile_name;
+        ScopedValue<string> old_tile_name(tile_name, op->name);
+        ScopedValue<string> old_fragment_name(fragment_name, op->name + ".wmma");
+        ScopedValue<Type> old_accumulator_type(accumulator_type, op->type);
+        ScopedValue<bool> old_found_matmul(found_matmul, false);
+        ScopedValue<string> old_failure(failure, "");
+
+        Stmt body = mutate(op->body);
+        if (failure.empty() && !found_matmul) {
+            fail("No matrix multiply of a supported type, shape, and schedule was found.");
+        }
+        if (!failure.empty()) {
+            return fall_back(op, failure);
+        }
+
+        fragments.insert(fragment_name);
+        return Allocate::make(fragment_name, op->type, MemoryType::Register,
+                              {wmma_accumulator_lanes}, const_true(), body);
+    }
+
+    Stmt visit(const Free *op) override {
+        if (tile_name.empty() || op->name != tile_name) {
+            return op;
+        }
+        return Free::make(fragment_name);
+    }
+
+    Expr visit(const Load *op) override {
+        // Any load of the whole tile will be matched elsewhere, so a
+        // load here means the accumulator is used outside of a tensor
+        // core operation.
+        if (!tile_name.empty() && op->name == tile_name) {
+            fail("The accumulator is used outside a tensor core operation.");
+        }
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Store *op) override {
+        if (tile_name.empty()) {
+            return IRMutator::visit(op);
+        }
+
+        if (op->name != tile_name) {
+            const Load *load = op->value.as<Load>();
+            if (!load || load->name != tile_name) {
+                return IRMutator::visit(op);
+            }
+            if (!is_const_one(op->predicate) || !is_whole_tile(load->index)) {
+                fail("A store from the accumulator does not store the whole tile.");
+                return op;
+            }
+            if (op->value.type().element_of() != accumulator_type) {
+                fail("A store from the accumulator changes its type.");
+                return op;
+            }
+            Stmt store = convert_to_tile_store(op);
+            return store.defined() ? store : Stmt(op);
+        }
+
+        if (!is_const_one(op->predicate) || !is_whole_tile(op->index)) {
+            fail("A store to the accumulator does not store the whole tile.");
+            return op;
+        }
+
+        // Initialization of the whole tile to a single value,
+        // typically zero.
+        if (const Broadcast *b = op->value.as<Broadcast>()) {
+            if (b->value.type().is_scalar()) {
+                return store_fragment(Broadcast::make(b->value, wmma_accumulator_lanes));
+            }
+        }
+
+        Stmt matmul = convert_to_matmul(op);
+        if (matmul.defined()) {
+            return matmul;
+        }
+
+        // Otherwise there is some other operation using the
+        // allocation, so we cannot use tensor cores.
+        fail("Found non-tensor-core operations on the accumulator.");
+        return op;
+    }
+
+public:
+    ExtractTensorCoreOperations(const Target &target)
+        : target(target) {
+    }
+};
+
+}  // namespace
+
+Stmt extract_tensor_core_operations(const Stmt &s, const Target &t) {
+    return ExtractTensorCoreOperations(t).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,30 @@
+#ifndef HALIDE_EXTRACT_TENSOR_CORE_OPERATIONS_H
+#define HALIDE_EXTRACT_TENSOR_CORE_OPERATIONS_H
+
+/** \file
+ * Defines the lowering pass that injects calls to the CUDA warp matrix
+ * multiply-accumulate (WMMA) intrinsics that use tensor cores.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+/** Rewrite the matrix multiplies accumulated into Funcs stored in the
+ * WMMAAccumulator memory type as WMMA intrinsic calls, to be used in
+ * the PTX backend. Each GPU block containing such a Func becomes a
+ * single warp. Allocations in the WMMAAccumulator memory type that
+ * can't use tensor cores (because the target doesn't support them
+ * for the types involved, or because they aren't a supported matrix
+ * multiply) fall back to ordinary vector code, with a warning saying
+ * why. */
+Stmt extract_tensor_core_operations(const Stmt &s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -3,8 +3,11 @@
 #include "IRMatch.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "Target.h"
 #include "Util.h"
 
+#include <sstream>
+
 /** \file Support extraction of AMX instructions. */
 
 /**
@@ -377,8 +380,14 @@ struct Matmul {
     int tile_x;
     int tile_y;
     int tile_r;
+    // Why an operation that looks like a tile matmul can't be one.
+    string error;
 };
 
+// The limits of an AMX tile register.
+constexpr int amx_max_rows = 16;
+constexpr int amx_max_colbytes = 64;
+
 Matmul convert_to_matmul(const Store *op, const string &new_name, AMXOpType op_type) {
     // m[ramp(0, 1, S)] = VectorAdd(lhs[{XYR tile}] * xX(rhs[{YR tile}])) + m[ramp(0, 1, S)]
     const auto wild_i8x = Variable::make(Int(8, 0), "*");
@@ -458,8 +467,12 @@ Matmul convert_to_matmul(const Store *op, const string &new_name, AMXOpType op_t
         bool is_bf16 = rhs_cast->value.type().element_of() == BFloat(16);
 
         if ((op_type == AMXOpType::Int8 && !is_i8_u8) || (op_type == AMXOpType::Bfloat16 && !is_bf16)) {
-            user_error << "Expected rhs type of " << (op_type == AMXOpType::Int8 ? "i8/u8" : "bf16")
-                       << ", got " << rhs_cast->value.type() << " instead.\nIn Expression: " << Expr(rhs_cast);
+            std::ostringstream error;
+            error << "Expected rhs type of " << (op_type == AMXOpType::Int8 ? "i8/u8" : "bf16")
+                  << ", got " << rhs_cast->value.type() << " instead.\nIn Expression: " << Expr(rhs_cast);
+            Matmul failed;
+            failed.error = error.str();
+            return failed;
         }
     } else {
         return {};
@@ -498,10 +511,24 @@ Matmul convert_to_matmul(const Store *op, const string &new_name, AMXOpType op_t
         return {};
     }
 
-    // {rows, colbytes, var, index}
-    auto lhs_var = Variable::make(Handle(), lhs_load->name);
     const auto &lhs_load_type = lhs_load->type;
     int element_width = lhs_load_type.bytes();
+
+    // Larger matrices must be tiled by the schedule into multiples of
+    // tiles that each fit in a tile register.
+    if (tile_x > amx_max_rows || tile_y * 4 > amx_max_colbytes || tile_r * element_width > amx_max_colbytes) {
+        std::ostringstream error;
+        error << "Tile of " << tile_x << "x" << tile_y << "x" << tile_r
+              << " does not fit in AMX tile registers, which have at most "
+              << amx_max_rows << " rows of " << amx_max_colbytes << " bytes. "
+              << "Split the matmul into smaller tiles.";
+        Matmul failed;
+        failed.error = error.str();
+        return failed;
+    }
+
+    // {rows, colbytes, var, index}
+    auto lhs_var = Variable::make(Handle(), lhs_load->name);
     auto lhs_type = lhs_load_type.with_lanes(1024 / element_width);
     auto lhs = Call::make(lhs_type, "tile_load", {tile_x, tile_r * element_width, lhs_var, lhs_tile.base * element_width, lhs_tile.stride[0] * element_width}, Call::Intrinsic);
 
@@ -561,6 +588,7 @@ Stmt convert_to_tile_store(const Store *op, const string &amx_name, int tile_x,
 class ExtractTileOperations : public IRMutator {
     using IRMutator::visit;
 
+    const Target &target;
     string tile_name;
     string amx_name;
     vector<Stmt> pending_stores;
@@ -570,12 +598,34 @@ class ExtractTileOperations : public IRMutator {
     int found_tile_r = -1;
     AMXOpType op_type;
 
+    // The first reason found for why the current AMX tile allocation can't
+    // use the tile instructions. If this is set, the allocation falls back
+    // to ordinary vector code.
+    string failure;
+
+    void fail(const string &reason) {
+        if (failure.empty()) {
+            failure = reason;
+        }
+    }
+
+    Stmt fall_back(const Allocate *op, const string &reason) {
+        user_warning << "Cannot use AMX tile instructions for " << op->name
+                     << ", which is stored in MemoryType::AMXTile: " << reason
+                     << "\nFalling back to ordinary vector code.\n";
+        return Allocate::make(op->name, op->type, MemoryType::Auto, op->extents, op->condition,
+                              mutate(op->body), op->new_expr, op->free_function, op->padding);
+    }
+
     Stmt visit(const Allocate *op) override {
         if (op->memory_type == MemoryType::AMXTile) {
-            user_assert(
-                (op->type.is_int() && op->type.bits() == 32) ||
-                (op->type.is_float() && op->type.bits() == 32))
-                << "scheduled tile operations must yield 32-bit integers or 32-bit floats";
+            if (!target.has_feature(Target::AVX512_SapphireRapids)) {
+                return fall_back(op, "The target does not have AMX (avx512_sapphirerapids).");
+            }
+            if (!((op->type.is_int() && op->type.bits() == 32) ||
+                  (op->type.is_float() && op->type.bits() == 32))) {
+                return fall_back(op, "Scheduled tile operations must yield 32-bit integers or 32-bit floats.");
+            }
 
             if (op->type.is_int() && op->type.bits() == 32) {
                 op_type = AMXOpType::Int8;
@@ -587,17 +637,26 @@ class ExtractTileOperations : public IRMutator {
             ScopedValue<string> old_amx_name(amx_name, op->name + ".amx");
             ScopedValue<string> old_tile_name(tile_name, op->name);
             ScopedValue<bool> old_in_alloc(in_allocate, true);
+            ScopedValue<int> old_tile_x(found_tile_x, -1);
+            ScopedValue<int> old_tile_y(found_tile_y, -1);
+            ScopedValue<int> old_tile_r(found_tile_r, -1);
+            ScopedValue<string> old_failure(failure, "");
             Stmt body = op->body;
 
             pending_stores.clear();
             body = mutate(body);
-            if (found_tile_x < 0 || found_tile_y < 0 || found_tile_r < 0) {
-                return op;
+            if (failure.empty() && (found_tile_x < 0 || found_tile_y < 0 || found_tile_r < 0)) {
+                fail("No matrix multiply of a supported type, shape, and schedule was found.");
             }
-            if (!pending_stores.empty()) {
+            if (failure.empty() && !pending_stores.empty()) {
                 // Really only need to go over the pending stores
                 body = mutate(body);
             }
+            if (!failure.empty()) {
+                string reason = failure;
+                ScopedValue<bool> not_in_alloc(in_allocate, false);
+                return fall_back(op, reason);
+            }
 
             auto alloc_type = amx_op_type_result_type(op_type);
             return Allocate::make(amx_name, alloc_type, MemoryType::AMXTile, {1}, const_true(), body);
@@ -606,14 +665,14 @@ class ExtractTileOperations : public IRMutator {
     }
 
     Stmt visit(const Free *op) override {
-        if (op->name != tile_name) {
+        if (!in_allocate || op->name != tile_name) {
             return op;
         }
         return Free::make(amx_name);
     }
 
     Stmt visit(const ProducerConsumer *op) override {
-        if (op->name != tile_name) {
+        if (!in_allocate || op->name != tile_name) {
             return IRMutator::visit(op);
         }
 
@@ -624,34 +683,52 @@ class ExtractTileOperations : public IRMutator {
     Expr visit(const Load *op) override {
         // Any tile load will be matched elsewhere, so a load here means that
         // the AMX tile is used outside of a tile instruction.
-        user_assert(op->name != tile_name) << "AMX tile allocation used outside a tile instruction";
+        if (in_allocate && op->name == tile_name) {
+            fail("The tile allocation is used outside a tile instruction.");
+        }
         return IRMutator::visit(op);
     }
 
     Stmt visit(const Store *op) override {
+        if (!in_allocate) {
+            return IRMutator::visit(op);
+        }
+
         if (op->name != tile_name) {
             const auto *load = op->value.as<Load>();
             if (!load || load->name != tile_name) {
+                return IRMutator::visit(op);
+            }
+            if (found_tile_x < 0 || found_tile_y < 0) {
+                pending_stores.emplace_back(op);
                 return op;
             }
             auto store = convert_to_tile_store(op, amx_name, found_tile_x, found_tile_y);
-            user_assert(store.defined()) << "Store to AMX tile allocation of a non-tile value";
+            if (!store.defined()) {
+                fail("A store from the tile allocation does not store a whole tile.");
+                return op;
+            }
             return store;
         }
 
         auto matmul = convert_to_matmul(op, amx_name, op_type);
         if (matmul.result) {
-            user_assert(
-                (found_tile_x < 0 || matmul.tile_x == found_tile_x) &&
-                (found_tile_y < 0 || matmul.tile_y == found_tile_y) &&
-                (found_tile_r < 0 || matmul.tile_r == found_tile_r))
-                << "Found different tile sizes for AMX tile allocation";
+            if (!((found_tile_x < 0 || matmul.tile_x == found_tile_x) &&
+                  (found_tile_y < 0 || matmul.tile_y == found_tile_y) &&
+                  (found_tile_r < 0 || matmul.tile_r == found_tile_r))) {
+                fail("Found different tile sizes for the tile allocation.");
+                return op;
+            }
             found_tile_x = matmul.tile_x;
             found_tile_y = matmul.tile_y;
             found_tile_r = matmul.tile_r;
 
             return matmul.stmt;
         }
+        if (!matmul.error.empty()) {
+            fail(matmul.error);
+            return op;
+        }
 
         if (found_tile_x < 0 || found_tile_y < 0) {
             pending_stores.emplace_back(op);
@@ -664,15 +741,20 @@ class ExtractTileOperations : public IRMutator {
         }
 
         // Otherwise there is some other operation using the allocation, so we cannot use the AMX instructions
-        user_error << "Found non-tile operations for AMX tile allocation";
+        fail("Found non-tile operations on the tile allocation.");
         return op;
     }
+
+public:
+    ExtractTileOperations(const Target &target)
+        : target(target) {
+    }
 };
 
 }  // namespace
 
-Stmt extract_tile_operations(const Stmt &s) {
-    return ExtractTileOperations().mutate(s);
+Stmt extract_tile_operations(const Stmt &s, const Target &t) {
+    return ExtractTileOperations(t).mutate(s);
 }
 }  // namespace Internal
 }  // namespace Halide
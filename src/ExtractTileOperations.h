@@ -9,11 +9,17 @@
 #include "Expr.h"
 
 namespace Halide {
+
+struct Target;
+
 namespace Internal {
 
 /** Rewrite any AMX tile operations that have been stored in the AMXTile memory
- * type as intrinsic calls, to be used in the X86 backend. */
-Stmt extract_tile_operations(const Stmt &s);
+ * type as intrinsic calls, to be used in the X86 backend. Allocations in the
+ * AMXTile memory type that can't use the tile instructions (because the
+ * target doesn't have AMX, or because they aren't a supported matrix
+ * multiply) fall back to ordinary vector code, with a warning saying why. */
+Stmt extract_tile_operations(const Stmt &s, const Target &t);
 
 }  // namespace Internal
 }  // namespace Halide
@@ -702,6 +702,24 @@ Func Stage::rfactor(const RVar &r, const Var &v) {
     return rfactor({{r, v}});
 }
 
+Func Stage::privatize(const RVar &r, const Var &v, int slice_size) {
+    user_assert(slice_size > 0)
+        << "In schedule for " << name()
+        << ": privatize() requires a positive slice size, not " << slice_size << "\n";
+    // The outer RVar keeps the name of r, so that the merge in this
+    // stage can be scheduled using r.
+    RVar ri(r.name() + "_in_slice");
+    split(r, r, ri, slice_size);
+    Func intm = rfactor(r, v);
+
+    // Compute each slice into its own allocation, so that the threads
+    // never touch the same bins.
+    Func wrapper = intm.in();
+    wrapper.compute_root().parallel(v);
+    intm.compute_at(wrapper, v);
+    return intm;
+}
+
 Func Stage::rfactor(vector<pair<RVar, Var>> preserved) {
     user_assert(!definition.is_init()) << "rfactor() must be called on an update definition\n";
 
@@ -1534,6 +1552,12 @@ Stage &Stage::atomic(bool override_associativity_test) {
     return *this;
 }
 
+Stage &Stage::allow_reassociation() {
+    atomic();
+    definition.schedule().allow_reassociation() = true;
+    return *this;
+}
+
 Stage &Stage::serial(const VarOrRVar &var) {
     set_dim_type(var, ForType::Serial);
     return *this;
@@ -2220,12 +2244,83 @@ Func &Func::store_in(MemoryType t) {
     return *this;
 }
 
+Func &Func::gather_mode(GatherMode mode) {
+    invalidate_cache();
+    func.schedule().gather_mode() = mode;
+    return *this;
+}
+
+Func &Func::interleave_tuple(bool interleave) {
+    invalidate_cache();
+    func.schedule().interleave_tuple() = interleave;
+    return *this;
+}
+
+Func &Func::code_size_budget(int nodes) {
+    user_assert(nodes >= 0)
+        << "The code size budget of Func " << name() << " must not be negative.\n";
+    invalidate_cache();
+    func.schedule().code_size_budget() = nodes;
+    return *this;
+}
+
+Func &Func::store_nontemporal(bool nontemporal) {
+    invalidate_cache();
+    func.schedule().store_nontemporal() = nontemporal;
+    return *this;
+}
+
+Func &Func::store_interleaved(int channels, int vector_size) {
+    const int d = dimensions();
+    user_assert(d >= 2)
+        << "Can't store Func " << name() << " interleaved, because it has fewer than two dimensions.\n";
+    user_assert(channels > 1)
+        << "Can't store Func " << name() << " interleaved with " << channels << " channels.\n";
+
+    for (OutputImageParam buf : output_buffers()) {
+        buf.dim(0).set_stride(channels);
+        buf.dim(d - 1).set_stride(1).set_bounds(0, channels);
+    }
+
+    vector<Var> pure_args = args();
+    vector<VarOrRVar> order = {pure_args[d - 1]};
+    order.insert(order.end(), pure_args.begin(), pure_args.end() - 1);
+    return bound(pure_args[d - 1], 0, channels)
+        .reorder(order)
+        .unroll(pure_args[d - 1])
+        .vectorize(pure_args[0], vector_size);
+}
+
 Func &Func::async() {
     invalidate_cache();
     func.schedule().async() = true;
     return *this;
 }
 
+Func &Func::ring_buffer(Expr buffers) {
+    user_assert(buffers.type().is_int() || buffers.type().is_uint())
+        << "The number of buffers passed to ring_buffer on Func \"" << name()
+        << "\" must be an integer, not " << buffers << "\n";
+    invalidate_cache();
+    func.schedule().ring_buffer() = cast<int>(std::move(buffers));
+    return *this;
+}
+
+Func &Func::double_buffer(const Func &f, const Var &var, const Var &store_var,
+                          const Var &dim, const Expr &extent, MemoryType memory_type) {
+    user_assert(func.has_extern_definition() && func.extern_function_name() == "halide_buffer_copy")
+        << "Func \"" << name() << "\" can't be double-buffered, as it is not a copy made by "
+        << "copy_to_host or copy_to_device. Use ring_buffer instead.\n";
+    user_assert(extent.type().is_int() || extent.type().is_uint())
+        << "The tile extent passed to double_buffer on Func \"" << name()
+        << "\" must be an integer, not " << extent << "\n";
+    return compute_at(f, var)
+        .store_at(f, store_var)
+        .async()
+        .fold_storage(dim, 2 * cast<int>(extent))
+        .store_in(memory_type);
+}
+
 Stage Func::specialize(const Expr &c) {
     invalidate_cache();
     return Stage(func, func.definition(), 0).specialize(c);
@@ -2663,6 +2758,40 @@ Func &Func::align_storage(const Var &dim, const Expr &alignment) {
     return *this;
 }
 
+Func &Func::pad_storage(const Var &dim, const Expr &padding) {
+    invalidate_cache();
+
+    vector<StorageDim> &dims = func.schedule().storage_dims();
+    for (auto &d : dims) {
+        if (var_name_match(d.var, dim.name())) {
+            d.padding = padding;
+            return *this;
+        }
+    }
+    user_error << "In schedule for " << name()
+               << ", could not find var " << dim.name()
+               << " to pad the storage of.\n"
+               << dump_dim_list(func.schedule().storage_dims());
+    return *this;
+}
+
+Func &Func::pad_storage_against_aliasing(const Var &dim, const Expr &critical_stride) {
+    invalidate_cache();
+
+    vector<StorageDim> &dims = func.schedule().storage_dims();
+    for (auto &d : dims) {
+        if (var_name_match(d.var, dim.name())) {
+            d.critical_stride = critical_stride;
+            return *this;
+        }
+    }
+    user_error << "In schedule for " << name()
+               << ", could not find var " << dim.name()
+               << " to pad the storage of.\n"
+               << dump_dim_list(func.schedule().storage_dims());
+    return *this;
+}
+
 Func &Func::bound_storage(const Var &dim, const Expr &bound) {
     invalidate_cache();
 
@@ -2763,19 +2892,37 @@ Func &Func::store_root() {
     return store_at(LoopLevel::root());
 }
 
+Func &Func::hoist_storage(LoopLevel loop_level) {
+    invalidate_cache();
+    func.schedule().hoist_storage_level() = std::move(loop_level);
+    return *this;
+}
+
+Func &Func::hoist_storage(const Func &f, const RVar &var) {
+    return hoist_storage(LoopLevel(f, var));
+}
+
+Func &Func::hoist_storage(const Func &f, const Var &var) {
+    return hoist_storage(LoopLevel(f, var));
+}
+
+Func &Func::hoist_storage_root() {
+    return hoist_storage(LoopLevel::root());
+}
+
 Func &Func::compute_inline() {
     return compute_at(LoopLevel::inlined());
 }
 
-Func &Func::trace_loads() {
+Func &Func::trace_loads(const TraceSampling &sampling) {
     invalidate_cache();
-    func.trace_loads();
+    func.trace_loads(sampling);
     return *this;
 }
 
-Func &Func::trace_stores() {
+Func &Func::trace_stores(const TraceSampling &sampling) {
     invalidate_cache();
-    func.trace_stores();
+    func.trace_stores(sampling);
     return *this;
 }
 
@@ -2791,6 +2938,12 @@ Func &Func::add_trace_tag(const std::string &trace_tag) {
     return *this;
 }
 
+Func &Func::notify_completion(const VarOrRVar &var) {
+    invalidate_cache();
+    func.schedule().completion_level() = LoopLevel(func, var);
+    return *this;
+}
+
 void Func::debug_to_file(const string &filename) {
     invalidate_cache();
     func.debug_file() = filename;
@@ -3402,8 +3555,16 @@ void Func::compile_jit(const Target &target) {
     pipeline().compile_jit(target);
 }
 
+void Func::specialize_jit_on(const std::vector<Expr> &params, int max_variants, bool compile_in_background) {
+    pipeline().specialize_jit_on(params, max_variants, compile_in_background);
+}
+
 Callable Func::compile_to_callable(const std::vector<Argument> &args, const Target &target) {
     return pipeline().compile_to_callable(args, target);
 }
 
+Callable Func::compile_to_callable(const std::vector<Argument> &args, const std::vector<Target> &targets) {
+    return pipeline().compile_to_callable(args, targets);
+}
+
 }  // namespace Halide
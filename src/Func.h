@@ -189,6 +189,28 @@ public:
     Func rfactor(const RVar &r, const Var &v);
     // @}
 
+    /** Parallelize a scatter-reduction, such as a histogram, by giving
+     * each thread its own private copy of the output. The RVar r is
+     * split into slices of the given size, and rfactor() moves the
+     * reduction over each slice into an intermediate Func with a new
+     * pure Var v that indexes the slices. The slices are computed in
+     * parallel, each into its own allocation (which goes on the stack
+     * if the output is small and has a constant size). This stage then
+     * only merges the private copies. Returns the intermediate Func,
+     * which can be scheduled further. For example, to compute a 256-bin
+     * histogram in parallel with a vectorized merge:
+     \code
+     hist(x) = 0;
+     hist(clamp(input(r.x, r.y), 0, 255)) += 1;
+     Func intm = hist.update().privatize(r.y, u, 16);
+     hist.bound(x, 0, 256).update().reorder(x, r.y).vectorize(x, 8);
+     \endcode
+     * The merge iterates over the slices using r. On GPUs, schedule
+     * the wrapper returned by intm.in() over gpu blocks instead, and
+     * store intm in MemoryType::GPUShared with an atomic() update.
+     */
+    Func privatize(const RVar &r, const Var &v, int slice_size);
+
     /** Schedule the iteration over this stage to be fused with another
      * stage 's' from outermost loop to a given LoopLevel. 'this' stage will
      * be computed AFTER 's' in the innermost fused dimension. There should not
@@ -439,6 +461,26 @@ public:
     Stage &allow_race_conditions();
     Stage &atomic(bool override_associativity_test = false);
 
+    /** Allow the reduction in this stage to be reassociated, so that an
+     * inner RVar of a sum (or product, min, or max) can be vectorized
+     * without rfactor(). This implies atomic(), and so still requires
+     * the update to be provably associative. When a vectorized RVar is
+     * the only thing inside a serial loop over another RVar, and the
+     * update writes to the same site throughout both, each lane keeps
+     * a partial result across the serial loop, and the lanes are
+     * combined with a reduction tree at the end of it. For example:
+     \code
+     sum() = 0.0f;
+     sum() += input(r);
+     sum.update().split(r, ro, ri, 8).allow_reassociation().vectorize(ri);
+     \endcode
+     * keeps eight partial sums in a vector. If the extent of r is not a
+     * multiple of the split factor, the guard on ri gets in the way, and
+     * the vector is instead reduced on every iteration over ro. Float values of this stage are also exempt from the
+     * StrictFloat target feature, so the result may differ from the
+     * serial order of evaluation in the last few bits. */
+    Stage &allow_reassociation();
+
     Stage &hexagon(const VarOrRVar &x = Var::outermost());
 
     Stage &prefetch(const Func &f, const VarOrRVar &at, const VarOrRVar &from, Expr offset = 1,
@@ -1052,6 +1094,12 @@ public:
      */
     void compile_jit(const Target &target = get_jit_target_from_environment());
 
+    /** Make the JIT specialize on the values some scalar Params take
+     * when realizing this Func. See Pipeline::specialize_jit_on. */
+    void specialize_jit_on(const std::vector<Expr> &params,
+                           int max_variants = 4,
+                           bool compile_in_background = true);
+
     /** Get a struct containing the currently set custom functions
      * used by JIT. This can be mutated. Changes will take effect the
      * next time this Func is realized. */
@@ -1060,10 +1108,15 @@ public:
     /** Eagerly jit compile the function to machine code and return a callable
      * struct that behaves like a function pointer. The calling convention
      * will exactly match that of an AOT-compiled version of this Func
-     * with the same Argument list.
+     * with the same Argument list. The second version picks one of
+     * several targets at runtime; see Pipeline::compile_to_callable.
      */
+    // @{
     Callable compile_to_callable(const std::vector<Argument> &args,
                                  const Target &target = get_jit_target_from_environment());
+    Callable compile_to_callable(const std::vector<Argument> &args,
+                                 const std::vector<Target> &targets);
+    // @}
 
     /** Add a custom pass to be used during lowering. It is run after
      * all other lowering passes. Can be used to verify properties of
@@ -1637,7 +1690,14 @@ public:
      * deadlock.
      * Vectorization of predicated RVars (through rdom.where()) on CPU
      * is also unsupported yet (see https://github.com/halide/Halide/issues/4298).
-     * 8-bit and 16-bit atomics on GPU are also not supported. */
+     * 8-bit and 16-bit atomics on GPU are also not supported.
+     *
+     * On CUDA targets with compute capability 8.0 or higher, atomic
+     * adds of 32-bit values are aggregated across each warp: the lanes
+     * that update the same address combine their updates, and one of
+     * them does a single atomic on their behalf. This makes
+     * histogram-like updates with many lanes hitting the same bin much
+     * cheaper. */
     Func &atomic(bool override_associativity_test = false);
 
     /** Specialize a Func. This creates a special-case version of the
@@ -2068,6 +2128,39 @@ public:
      * aligned to multiples of 16, use foo.align_storage(x, 16). */
     Func &align_storage(const Var &dim, const Expr &alignment);
 
+    /** Pad the storage extent of a particular dimension of
+     * realizations of this function by the given number of elements,
+     * after applying any alignment from align_storage. The strides of
+     * the dimensions stored outside of dim grow accordingly.
+     *
+     * This is mostly useful for allocations in GPU shared memory,
+     * which is divided into banks such that consecutive 32-bit words
+     * live in consecutive banks. If a warp accesses a column of a
+     * buffer with a row stride that is a multiple of the number of
+     * banks, every access hits the same bank and is serialized. For
+     * example, a 32x32 tile of floats transposed through shared
+     * memory should use tile.store_in(MemoryType::GPUShared).pad_storage(x, 1)
+     * to make the row stride 33 instead. */
+    Func &pad_storage(const Var &dim, const Expr &padding);
+
+    /** Pad the storage extent of a particular dimension of
+     * realizations of this function by one 64-byte cache line
+     * (rounded up to any alignment from align_storage, so scanlines
+     * stay aligned) whenever the stride of the dimension stored
+     * outside of it would otherwise be a multiple of critical_stride
+     * bytes. The check is done at runtime, so only allocations that
+     * need it grow.
+     *
+     * Rows that are a multiple of the size of one way of a cache
+     * apart map to the same cache set. A column-wise pass over an
+     * image with a large power of two width, or a tiled transpose,
+     * then only uses as many lines of the cache as it is associative.
+     * The default of 4096 bytes is the size of one way of a typical 32KB
+     * 8-way L1 data cache. For example, for an internal image
+     * foo(x, y) that may be 1024 floats wide, use
+     * foo.pad_storage_against_aliasing(x). */
+    Func &pad_storage_against_aliasing(const Var &dim, const Expr &critical_stride = 4096);
+
     /** Store realizations of this function in a circular buffer of a
      * given extent. This is more efficient when the extent of the
      * circular buffer is a power of 2. If the fold factor is too
@@ -2258,6 +2351,64 @@ public:
      */
     Func &async();
 
+    /** Rotate the storage of an async Func between a number of copies,
+     * so that its producer can run up to that many iterations of the
+     * loops between its hoist_storage level and its compute level ahead
+     * of the consumer, instead of waiting for each iteration to be
+     * consumed before starting on the next. Two copies give double
+     * buffering:
+     *
+     \code
+     g.compute_at(f, y).hoist_storage_root().ring_buffer(2).async();
+     \endcode
+     *
+     * The Func must be async and have a hoist_storage level, which is
+     * where the copies are allocated. Each copy is as large as the
+     * largest allocation made by any iteration of the loops in
+     * between.
+     *
+     * A Func stored in GPU shared memory can be ring-buffered without
+     * being async. Each iteration of the innermost loop around its
+     * compute level then produces the tile for the next iteration
+     * before computing on its own tile, without a barrier in between,
+     * so that the loads of the next tile overlap with the computation
+     * on the current one. For example, to double-buffer the tiles of
+     * a matrix multiply staged in shared memory:
+     *
+     \code
+     A_tile.compute_at(prod, ko).hoist_storage(out, bx).store_in(MemoryType::GPUShared).ring_buffer(2);
+     \endcode
+     *
+     * Anything the producer depends on must be computed within it. */
+    Func &ring_buffer(Expr buffers);
+
+    /** Double-buffer the tiles copied by a Func made with
+     * copy_to_host() or copy_to_device(), so that the copy of the next
+     * tile overlaps with the computation of f on the current one. The
+     * copy is computed asynchronously in f's loop over tiles var, and
+     * stored at f's enclosing loop store_var, with its storage along
+     * dim folded to two tiles of the given extent, in memory of the
+     * given type. For example, with an input wrapped for Hexagon DMA,
+     *
+     \code
+     input_copy.copy_to_host().double_buffer(output, tx, ty, x, tile_width, MemoryType::LockedCache);
+     \endcode
+     *
+     * double-buffers the DMA transfer of each tile into locked L2
+     * cache. Each transfer takes its own engine from the DMA pool, so
+     * one can be in flight while the other tile is being computed on.
+     * This is equivalent to:
+     *
+     \code
+     input_copy.compute_at(output, tx).store_at(output, ty).async().fold_storage(x, 2 * tile_width).store_in(MemoryType::LockedCache);
+     \endcode
+     *
+     * Copies write their storage through a buffer, so they can't be
+     * ring-buffered; use ring_buffer() for other Funcs instead. */
+    Func &double_buffer(const Func &f, const Var &var, const Var &store_var,
+                        const Var &dim, const Expr &extent,
+                        MemoryType memory_type = MemoryType::Auto);
+
     /** Bound the extent of a Func's storage, but not extent of its
      * compute. This can be useful for forcing a function's allocation
      * to be a fixed size, which often means it can go on the stack.
@@ -2374,6 +2525,36 @@ public:
      * outside the outermost loop. */
     Func &store_root();
 
+    /** Hoist the allocation of this function out to f's loop over var,
+     * without changing where it is stored or computed. Unlike store_at,
+     * this doesn't change which values persist between iterations of
+     * the loops in between, so it has no effect on sliding window and
+     * storage folding optimizations. Instead, a single allocation is made
+     * in the loop over var, large enough for the largest allocation made
+     * by any iteration of the loops inside it, and each of those
+     * iterations reuses it. This saves repeatedly allocating and freeing
+     * a Func computed inside tiles:
+     *
+     \code
+     g.compute_at(f, xo).hoist_storage(f, yo);
+     \endcode
+     *
+     * The loops between var and the store_at level must be serial. */
+    Func &hoist_storage(const Func &f, const Var &var);
+
+    /** Equivalent to the version of hoist_storage that takes a Var, but
+     * hoists the allocation to the loop over a dimension of a reduction
+     * domain */
+    Func &hoist_storage(const Func &f, const RVar &var);
+
+    /** Equivalent to the version of hoist_storage that takes a Var, but
+     * hoists the allocation to a given LoopLevel. */
+    Func &hoist_storage(LoopLevel loop_level);
+
+    /** Equivalent to \ref Func::hoist_storage, but hoists the allocation
+     * outside the outermost loop. */
+    Func &hoist_storage_root();
+
     /** Aggressively inline all uses of this function. This is the
      * default schedule, so you're unlikely to need to call this. For
      * a Func with an update definition, that means it gets computed
@@ -2411,15 +2592,77 @@ public:
      * on MemoryType for more detail. */
     Func &store_in(MemoryType memory_type);
 
+    /** Control whether vectorized loads and stores at data-dependent
+     * addresses in the definitions of this Func (e.g. lookups into a
+     * table) use the target's gather and scatter instructions. By
+     * default a cost heuristic decides. See the documentation on
+     * GatherMode for more detail. */
+    Func &gather_mode(GatherMode mode);
+
+    /** Store the elements of this Tuple-valued Func interleaved in a
+     * single allocation, instead of in one allocation per element. This
+     * is a win when consumers read all of the elements at each point
+     * (e.g. the real and imaginary parts of a complex number), as they
+     * then touch one stream of memory instead of several. Vectorized
+     * loads and stores of the elements become strided, and are done as
+     * dense loads and stores with interleaving shuffles. The elements
+     * must all have the same type. This has no effect on output Funcs,
+     * or on Funcs whose buffers are used directly (e.g. by an extern
+     * stage). */
+    Func &interleave_tuple(bool interleave = true);
+
+    /** Limit the size of the code generated for the loop nests of this
+     * Func, in IR nodes, to the given number. Unrolling and loop
+     * partitioning both duplicate loop bodies; when doing all of the
+     * unrolling and partitioning the schedule implies would exceed the
+     * budget, the loops expected to benefit most (the innermost ones,
+     * then the cheapest) are transformed first, and the rest are left
+     * as serial loops, or unpartitioned. Loops of other Funcs computed
+     * within this one count towards its size, but use their own
+     * budget. A budget of zero (the default) means no limit. The
+     * decisions taken are reported at HL_DEBUG_CODEGEN=1 and to the
+     * CompilerLogger. */
+    Func &code_size_budget(int nodes);
+
+    /** Write the values of this Func with non-temporal stores, which
+     * bypass the cache. This is a win for large buffers (e.g. the
+     * outputs of a pipeline) that are written once and not read again
+     * soon after, as it avoids evicting useful data from the cache and
+     * reading each cache line before overwriting it. It is a loss for
+     * anything that is reloaded while it is still in cache, so it is
+     * best used on outputs and compute_root Funcs only. It applies to
+     * dense vector stores that are known to be aligned to the vector
+     * width; for outputs, that means setting the host alignment of the
+     * output buffer and aligning the vectorized loop, e.g. with
+     * align_bounds. Other stores are unaffected. Requires an LLVM-based
+     * CPU target; on other targets this has no effect. */
+    Func &store_nontemporal(bool nontemporal = true);
+
+    /** Declare that the output buffers of this Func hold interleaved
+     * data, with the given number of channels along the last dimension
+     * stored adjacent to each other in memory (e.g. RGBRGBRGB...), and
+     * schedule the pure definition to write it in one pass: vectorized
+     * by vector_size along the first dimension, with the channels
+     * innermost and unrolled, so that each vector of each channel is
+     * interleaved with the others in registers and stored densely. The
+     * stages feeding this Func can then be computed planar, e.g. at
+     * root or per tile of this Func. The output must be at least
+     * vector_size wide. Only meaningful for outputs, and must be called
+     * before splitting or reordering the pure definition. To read
+     * interleaved inputs, see \ref ImageParam::deinterleaved. */
+    Func &store_interleaved(int channels, int vector_size = 16);
+
     /** Trace all loads from this Func by emitting calls to
      * halide_trace. If the Func is inlined, this has no
-     * effect. */
-    Func &trace_loads();
+     * effect. Pass a TraceSampling to trace only some of the loads,
+     * e.g. to keep traced runs on full-size inputs tractable. */
+    Func &trace_loads(const TraceSampling &sampling = TraceSampling());
 
     /** Trace all stores to the buffer backing this Func by emitting
      * calls to halide_trace. If the Func is inlined, this call
-     * has no effect. */
-    Func &trace_stores();
+     * has no effect. Pass a TraceSampling to trace only some of the
+     * stores. */
+    Func &trace_stores(const TraceSampling &sampling = TraceSampling());
 
     /** Trace all realizations of this Func by emitting calls to
      * halide_trace. */
@@ -2432,6 +2675,24 @@ public:
      */
     Func &add_trace_tag(const std::string &trace_tag);
 
+    /** Call halide_region_complete with the region of this Func
+     * computed by each iteration of the given loop of its last stage,
+     * once that iteration is done. This lets the caller start
+     * consuming the tiles or row strips of an output (e.g. encoding or
+     * transmitting them) while the rest of the output is still being
+     * computed. For example, to hear about each strip of 16 rows of an
+     * output:
+     \code
+     f.split(y, yo, yi, 16).parallel(yo).notify_completion(yo);
+     \endcode
+     * In JIT mode, set JITHandlers::custom_region_complete to receive
+     * the calls. In AOT mode, use halide_set_custom_region_complete.
+     * If the loop is parallel, the calls may be concurrent and in any
+     * order. If the loop was split with TailStrategy::ShiftInwards,
+     * the last region may overlap the one before it. The loop must be
+     * serial or parallel, and run on the host. */
+    Func &notify_completion(const VarOrRVar &var);
+
     /** Get a handle on the internal halide function that this Func
      * represents. Useful if you want to do introspection on Halide
      * functions */
@@ -108,6 +108,7 @@ struct FunctionContents {
     Expr extern_proxy_expr;
 
     bool trace_loads = false, trace_stores = false, trace_realizations = false;
+    TraceSampling trace_loads_sampling, trace_stores_sampling;
     std::vector<string> trace_tags;
 
     bool frozen = false;
@@ -150,6 +151,13 @@ struct FunctionContents {
                 }
             }
         }
+
+        for (const TraceSampling *s : {&trace_loads_sampling, &trace_stores_sampling}) {
+            for (const Range &r : s->region) {
+                r.min.accept(visitor);
+                r.extent.accept(visitor);
+            }
+        }
     }
 
     // Pass an IRMutator through to all Exprs referenced in the FunctionContents
@@ -171,6 +179,13 @@ struct FunctionContents {
             }
             extern_proxy_expr = mutator->mutate(extern_proxy_expr);
         }
+
+        for (TraceSampling *s : {&trace_loads_sampling, &trace_stores_sampling}) {
+            for (Range &r : s->region) {
+                r.min = mutator->mutate(r.min);
+                r.extent = mutator->mutate(r.extent);
+            }
+        }
     }
 };
 
@@ -463,6 +478,8 @@ void Function::deep_copy(const FunctionPtr &copy, DeepCopyMap &copied_map) const
     copy->trace_loads = contents->trace_loads;
     copy->trace_stores = contents->trace_stores;
     copy->trace_realizations = contents->trace_realizations;
+    copy->trace_loads_sampling = contents->trace_loads_sampling;
+    copy->trace_stores_sampling = contents->trace_stores_sampling;
     copy->trace_tags = contents->trace_tags;
     copy->frozen = contents->frozen;
     copy->output_buffers = contents->output_buffers;
@@ -1067,11 +1084,15 @@ Function::operator ExternFuncArgument() const {
     return ExternFuncArgument(contents);
 }
 
-void Function::trace_loads() {
+void Function::trace_loads(const TraceSampling &sampling) {
+    user_assert(sampling.every >= 1) << "TraceSampling::every must be at least one.\n";
     contents->trace_loads = true;
+    contents->trace_loads_sampling = sampling;
 }
-void Function::trace_stores() {
+void Function::trace_stores(const TraceSampling &sampling) {
+    user_assert(sampling.every >= 1) << "TraceSampling::every must be at least one.\n";
     contents->trace_stores = true;
+    contents->trace_stores_sampling = sampling;
 }
 void Function::trace_realizations() {
     contents->trace_realizations = true;
@@ -1089,6 +1110,12 @@ bool Function::is_tracing_stores() const {
 bool Function::is_tracing_realizations() const {
     return contents->trace_realizations;
 }
+const TraceSampling &Function::trace_loads_sampling() const {
+    return contents->trace_loads_sampling;
+}
+const TraceSampling &Function::trace_stores_sampling() const {
+    return contents->trace_stores_sampling;
+}
 const std::vector<std::string> &Function::get_trace_tags() const {
     return contents->trace_tags;
 }
@@ -1101,6 +1128,8 @@ void Function::lock_loop_levels() {
     auto &schedule = contents->func_schedule;
     schedule.compute_level().lock();
     schedule.store_level().lock();
+    schedule.hoist_storage_level().lock();
+    schedule.completion_level().lock();
     // If store_level is inlined, use the compute_level instead.
     // (Note that we deliberately do *not* do the same if store_level
     // is undefined.)
@@ -28,6 +28,56 @@ enum class NameMangling {
     CPlusPlus,  ///< C++ name mangling
 };
 
+/** Which accesses Func::trace_loads and Func::trace_stores report to
+ * halide_trace. Accesses that aren't sampled aren't instrumented at
+ * all beyond the test that skips them. The tests combine, so an access
+ * is traced only if it passes all of them. The choice of which
+ * accesses to trace depends only on their coordinates, so the same
+ * accesses are traced from run to run, and loads and stores of the same
+ * sites line up. A vectorized access is traced as a whole if any of
+ * its lanes is sampled. */
+struct TraceSampling {
+    /** Trace only the accesses whose innermost coordinate is a multiple
+     * of this. */
+    int every = 1;
+
+    /** Trace this fraction of the accesses, chosen pseudo-randomly from
+     * a hash of their coordinates and the seed. */
+    float fraction = 1.0f;
+    uint32_t seed = 0;
+
+    /** Trace only the accesses inside this region of the Func. Empty
+     * means everywhere. If it has fewer dimensions than the Func, the
+     * remaining ones are unconstrained. */
+    Region region;
+
+    TraceSampling() = default;
+
+    static TraceSampling every_nth(int n) {
+        TraceSampling s;
+        s.every = n;
+        return s;
+    }
+
+    static TraceSampling random_fraction(float f, uint32_t seed = 0) {
+        TraceSampling s;
+        s.fraction = f;
+        s.seed = seed;
+        return s;
+    }
+
+    static TraceSampling region_of_interest(const Region &r) {
+        TraceSampling s;
+        s.region = r;
+        return s;
+    }
+
+    /** Whether every access is traced. */
+    bool samples_everything() const {
+        return every <= 1 && fraction >= 1.0f && region.empty();
+    }
+};
+
 namespace Internal {
 
 struct Call;
@@ -249,13 +299,15 @@ public:
     /** Tracing calls and accessors, passed down from the Func
      * equivalents. */
     // @{
-    void trace_loads();
-    void trace_stores();
+    void trace_loads(const TraceSampling &sampling = TraceSampling());
+    void trace_stores(const TraceSampling &sampling = TraceSampling());
     void trace_realizations();
     void add_trace_tag(const std::string &trace_tag);
     bool is_tracing_loads() const;
     bool is_tracing_stores() const;
     bool is_tracing_realizations() const;
+    const TraceSampling &trace_loads_sampling() const;
+    const TraceSampling &trace_stores_sampling() const;
     const std::vector<std::string> &get_trace_tags() const;
     // @}
 
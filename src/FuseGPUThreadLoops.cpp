@@ -1204,6 +1204,7 @@ public:
 
 class InjectThreadBarriers : public IRMutator {
     bool in_threads, injected_barrier;
+    int fork_fence_mask = 0;
 
     using IRMutator::visit;
 
@@ -1244,6 +1245,7 @@ class InjectThreadBarriers : public IRMutator {
                                           op->for_type == ForType::GPULane));
 
         ScopedValue<bool> old_injected_barrier(injected_barrier, false);
+        ScopedValue<int> old_fork_fence_mask(fork_fence_mask, 0);
 
         if (!is_parallel(op->for_type)) {
             Stmt body = mutate(op->body);
@@ -1252,8 +1254,9 @@ class InjectThreadBarriers : public IRMutator {
             // loop iteration.
             if (!in_threads && injected_barrier) {
                 // Any memory access fences should be handled by the
-                // synchronizations within the block
-                body = Block::make(body, make_barrier(0));
+                // synchronizations within the block, except for the
+                // stores made by the sides of a fork.
+                body = Block::make(body, make_barrier(fork_fence_mask));
             }
             return For::make(op->name, op->min, op->extent,
                              op->for_type, op->device_api, body);
@@ -1281,6 +1284,7 @@ class InjectThreadBarriers : public IRMutator {
         case MemoryType::LockedCache:
         case MemoryType::VTCM:
         case MemoryType::AMXTile:
+        case MemoryType::WMMAAccumulator:
             break;
         }
 
@@ -1306,6 +1310,7 @@ class InjectThreadBarriers : public IRMutator {
         case MemoryType::LockedCache:
         case MemoryType::VTCM:
         case MemoryType::AMXTile:
+        case MemoryType::WMMAAccumulator:
             break;
         }
 
@@ -1349,6 +1354,30 @@ class InjectThreadBarriers : public IRMutator {
         }
     }
 
+    Stmt visit(const Fork *op) override {
+        // The sides of a fork don't depend on each other (see
+        // PipelineRingBuffers), so the threads can run one after the
+        // other without a barrier in between. The next iteration of
+        // the enclosing loop might depend on either of them though.
+        std::set<std::string> old_shared_stores, old_device_stores;
+        old_shared_stores.swap(shared_stores);
+        old_device_stores.swap(device_stores);
+        Stmt rest = mutate(op->rest);
+        Stmt first = mutate(op->first);
+        if (!in_threads) {
+            if (!shared_stores.empty()) {
+                fork_fence_mask |= CodeGen_GPU_Dev::MemoryFenceType::Shared;
+            }
+            if (!device_stores.empty()) {
+                fork_fence_mask |= CodeGen_GPU_Dev::MemoryFenceType::Device;
+            }
+            injected_barrier = true;
+        }
+        shared_stores.insert(old_shared_stores.begin(), old_shared_stores.end());
+        device_stores.insert(old_device_stores.begin(), old_device_stores.end());
+        return Block::make(first, rest);
+    }
+
 public:
     InjectThreadBarriers(ExtractSharedAndHeapAllocations &sha, ExtractRegisterAllocations &ra)
         : in_threads(false),
@@ -1357,6 +1386,16 @@ public:
     }
 };
 
+// Without a loop over threads, the sides of a fork just run one after
+// the other.
+class SerializeForks : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const Fork *op) override {
+        return Block::make(mutate(op->first), mutate(op->rest));
+    }
+};
+
 class FuseGPUThreadLoopsSingleKernel : public IRMutator {
     using IRMutator::visit;
     const ExtractBlockSize &block_size;
@@ -1393,6 +1432,8 @@ class FuseGPUThreadLoopsSingleKernel : public IRMutator {
                 // If there's no loop over threads, everything is already synchronous.
                 InjectThreadBarriers i{block_allocations, register_allocs};
                 body = i.mutate(body);
+            } else {
+                body = SerializeForks().mutate(body);
             }
 
             debug(3) << "Injected synchronization:\n"
@@ -0,0 +1,163 @@
+#include "GatherScatter.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+bool is_avx512(const Target &t) {
+    return t.arch == Target::X86 &&
+           t.features_any_of({Target::AVX512,
+                              Target::AVX512_KNL,
+                              Target::AVX512_Skylake,
+                              Target::AVX512_Cannonlake,
+                              Target::AVX512_SapphireRapids});
+}
+
+bool is_element_type_ok(const Type &type) {
+    return (type.is_int() || type.is_uint() || type.is_float()) &&
+           (type.bits() == 32 || type.bits() == 64);
+}
+
+// Loads and stores with a ramp index are dense or strided, which
+// codegen handles without gathering. Broadcast indices should have
+// been simplified away.
+bool is_data_dependent(const Expr &index) {
+    return index.type().is_vector() &&
+           !index.as<Ramp>() &&
+           !index.as<Broadcast>();
+}
+
+class ChooseGathersAndScatters : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, Function> &env;
+    const Target &target;
+    GatherMode mode = GatherMode::Auto;
+
+    bool use_hardware(const Type &type, bool available) const {
+        if (!available || mode == GatherMode::Never) {
+            return false;
+        } else if (mode == GatherMode::Always) {
+            return true;
+        }
+        // Gathers on AVX2 parts are only a win over separate loads
+        // when they fill a whole register. AVX-512 parts have much
+        // faster gathers and scatters.
+        if (is_avx512(target)) {
+            return type.lanes() >= 4;
+        } else {
+            return type.bits() * type.lanes() >= 256;
+        }
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        auto it = env.find(op->name);
+        if (op->is_producer && it != env.end()) {
+            ScopedValue<GatherMode> old_mode(mode, it->second.schedule().gather_mode());
+            return IRMutator::visit(op);
+        }
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Leave code for other devices alone.
+            return op;
+        }
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Load *op) override {
+        Expr e = IRMutator::visit(op);
+        op = e.as<Load>();
+        if (!op ||
+            !is_data_dependent(op->index) ||
+            !is_const_one(op->predicate) ||
+            use_hardware(op->type, target_has_gather(target, op->type))) {
+            return e;
+        }
+
+        string index_name = unique_name('t');
+        Expr index = Variable::make(op->index.type(), index_name);
+        vector<Expr> lanes;
+        for (int i = 0; i < op->type.lanes(); i++) {
+            lanes.push_back(Load::make(op->type.element_of(), op->name,
+                                       Shuffle::make_extract_element(index, i),
+                                       op->image, op->param, const_true(),
+                                       ModulusRemainder()));
+        }
+        return Let::make(index_name, op->index, Shuffle::make_concat(lanes));
+    }
+
+    Stmt visit(const Store *op) override {
+        Stmt s = IRMutator::visit(op);
+        op = s.as<Store>();
+        if (!op) {
+            return s;
+        }
+        Type type = op->value.type();
+        if (!is_data_dependent(op->index) ||
+            !is_const_one(op->predicate) ||
+            use_hardware(type, target_has_scatter(target, type))) {
+            return s;
+        }
+
+        // Later lanes must win when two lanes store to the same
+        // address, so store them in order.
+        string index_name = unique_name('t');
+        string value_name = unique_name('t');
+        Expr index = Variable::make(op->index.type(), index_name);
+        Expr value = Variable::make(type, value_name);
+        vector<Stmt> lanes;
+        for (int i = 0; i < type.lanes(); i++) {
+            lanes.push_back(Store::make(op->name,
+                                        Shuffle::make_extract_element(value, i),
+                                        Shuffle::make_extract_element(index, i),
+                                        op->param, const_true(), ModulusRemainder()));
+        }
+        Stmt result = Block::make(lanes);
+        result = LetStmt::make(value_name, op->value, result);
+        result = LetStmt::make(index_name, op->index, result);
+        return result;
+    }
+
+public:
+    ChooseGathersAndScatters(const map<string, Function> &env, const Target &t)
+        : env(env), target(t) {
+    }
+};
+
+}  // namespace
+
+bool target_has_gather(const Target &t, const Type &type) {
+    return t.arch == Target::X86 &&
+           (t.has_feature(Target::AVX2) || is_avx512(t)) &&
+           is_element_type_ok(type.element_of());
+}
+
+bool target_has_scatter(const Target &t, const Type &type) {
+    return is_avx512(t) && is_element_type_ok(type.element_of());
+}
+
+Stmt choose_gathers_and_scatters(const Stmt &s,
+                                 const map<string, Function> &env,
+                                 const Target &t) {
+    if (!target_has_gather(t, Int(32))) {
+        // Codegen does one load or store per lane anyway.
+        return s;
+    }
+    return ChooseGathersAndScatters(env, t).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
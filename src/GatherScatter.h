@@ -0,0 +1,42 @@
+#ifndef HALIDE_GATHER_SCATTER_H
+#define HALIDE_GATHER_SCATTER_H
+
+/** \file
+ * Defines the lowering pass that decides which vector loads and stores
+ * at data-dependent addresses use gather and scatter instructions.
+ */
+
+#include <map>
+#include <string>
+
+#include "Expr.h"
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+class Function;
+
+/** Does the target have an instruction that gathers a vector of
+ * the given type from arbitrary addresses? */
+bool target_has_gather(const Target &t, const Type &type);
+
+/** Does the target have an instruction that scatters a vector of the
+ * given type to arbitrary addresses? */
+bool target_has_scatter(const Target &t, const Type &type);
+
+/** Code generators that support them emit every unpredicated vector
+ * load and store at a data-dependent address as a gather or scatter.
+ * This pass rewrites those that shouldn't be, according to the
+ * GatherMode of the Function being computed and a cost heuristic,
+ * into a load or store of each lane. */
+Stmt choose_gathers_and_scatters(const Stmt &s,
+                                 const std::map<std::string, Function> &env,
+                                 const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
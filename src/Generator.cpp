@@ -3,12 +3,17 @@
 #include <condition_variable>
 #include <fstream>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 
 #include "CompilerLogger.h"
 #include "Generator.h"
+#include "GeneratorCache.h"
 #include "IRPrinter.h"
+#include "LLVM_Output.h"
 #include "Module.h"
 #include "Simplify.h"
 
@@ -633,10 +638,19 @@ std::string halide_type_to_c_type(const Type &t) {
 
 namespace {
 
-int generate_filter_main_inner(int argc,
-                               char **argv,
-                               const GeneratorFactoryProvider &generator_factory_provider) {
-    static const char kUsage[] = R"INLINE_CODE(
+// The plugins loaded with -p. They are part of what identifies a
+// Generator in the generator cache.
+std::vector<std::string> &loaded_plugins() {
+    static std::vector<std::string> plugins;
+    return plugins;
+}
+
+void load_generator_plugin(const std::string &lib_path) {
+    load_plugin(lib_path);
+    loaded_plugins().push_back(lib_path);
+}
+
+const char kUsage[] = R"INLINE_CODE(
 gengen
   [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME]
   [-d 1|0] [-e EMIT_OPTIONS] [-n FILE_BASE_NAME] [-p PLUGIN_NAME]
@@ -644,9 +658,18 @@ gengen
   target=target-string[,target-string...]
   [generator_param=value [...]]
 
- -d  Build a module that is suitable for using for gradient descent calculation
-     in TensorFlow or PyTorch. See Generator::build_gradient_module()
-     documentation.
+gengen -b MANIFEST [-j JOBS] [-p PLUGIN_NAME]
+
+ -b  Run every invocation listed in MANIFEST in this process. Each line of
+     MANIFEST holds the arguments of one invocation of the first form above,
+     separated by whitespace. Blank lines and lines starting with '#' are
+     ignored. Any plugins are loaded before the invocations are run.
+
+ -d  If 1, build a module that is suitable for using for gradient descent
+     calculation in TensorFlow or PyTorch. See Generator::build_gradient_module()
+     documentation. If 2, build a module with both the pipeline as written and
+     its gradient (as <function_name>_grad); the pytorch_wrapper of such a
+     module includes a differentiable op that uses both.
 
  -e  A comma separated list of files to emit. Accepted values are:
      [assembly, bitcode, c_header, c_source, cpp_stub, featurization,
@@ -671,9 +694,15 @@ gengen
      bugs and/or degenerate cases don't stall build systems. Defaults to 900
      (=15 minutes). Specify 0 to allow ~infinite time.
 
+ -j  The number of invocations from the manifest given with -b to run
+     concurrently. Defaults to the number of cores.
+
  -v  If nonzero, log the path to all generated files to stdout.
 )INLINE_CODE";
 
+// Parse the arguments of a single invocation (excluding the program name).
+ExecuteGeneratorArgs parse_generator_args(const std::vector<std::string> &argv,
+                                          const GeneratorFactoryProvider &generator_factory_provider) {
     std::map<std::string, std::string> flags_info = {
         {"-d", "0"},
         {"-e", ""},
@@ -689,18 +718,18 @@ gengen
 
     ExecuteGeneratorArgs args;
 
-    for (int i = 1; i < argc; ++i) {
+    for (size_t i = 0; i < argv.size(); ++i) {
         if (argv[i][0] != '-') {
             std::vector<std::string> v = split_string(argv[i], "=");
             user_assert(v.size() == 2 && !v[0].empty() && !v[1].empty()) << kUsage;
             args.generator_params[v[0]] = v[1];
         } else if (auto it = flags_info.find(argv[i]); it != flags_info.end()) {
-            user_assert(i + 1 < argc) << kUsage;
+            user_assert(i + 1 < argv.size()) << kUsage;
             it->second = argv[i + 1];
             ++i;
             continue;
         } else {
-            if (!strcmp(argv[i], "-s")) {
+            if (argv[i] == "-s") {
                 user_error << "-s is no longer supported for setting autoscheduler; specify autoschduler.name=NAME instead.\n"
                            << kUsage;
             }
@@ -713,7 +742,7 @@ gengen
     // how arguments are parsed, so we handle those first.
     for (const auto &lib_path : split_string(flags_info["-p"], ",")) {
         if (!lib_path.empty()) {
-            load_plugin(lib_path);
+            load_generator_plugin(lib_path);
         }
     }
 
@@ -727,8 +756,8 @@ gengen
     }
 
     const auto &d_val = flags_info["-d"];
-    user_assert(d_val == "1" || d_val == "0") << "-d must be 0 or 1\n"
-                                              << kUsage;
+    user_assert(d_val == "0" || d_val == "1" || d_val == "2") << "-d must be 0, 1 or 2\n"
+                                                              << kUsage;
 
     const auto &v_val = flags_info["-v"];
     user_assert(v_val == "1" || v_val == "0") << "-v must be 0 or 1\n"
@@ -736,8 +765,11 @@ gengen
 
     const std::vector<std::string> generator_names = generator_factory_provider.enumerate();
 
-    const auto create_generator = [&](const std::string &generator_name, const Halide::GeneratorContext &context) -> AbstractGeneratorPtr {
-        internal_assert(generator_name == args.generator_name);
+    // Note that these callbacks outlive this function, so mustn't refer
+    // to its locals (including args).
+    const auto create_generator = [expected_generator_name = flags_info["-g"], generator_names,
+                                   &generator_factory_provider](const std::string &generator_name, const Halide::GeneratorContext &context) -> AbstractGeneratorPtr {
+        internal_assert(generator_name == expected_generator_name);
         auto g = generator_factory_provider.create(generator_name, context);
         if (!g) {
             std::ostringstream o;
@@ -840,8 +872,13 @@ gengen
     args.function_name = flags_info["-f"];
     args.file_base_name = flags_info["-n"];
     args.runtime_name = flags_info["-r"];
-    args.build_mode = (d_val == "1") ? ExecuteGeneratorArgs::Gradient : ExecuteGeneratorArgs::Default;
+    args.build_mode = (d_val == "2") ? ExecuteGeneratorArgs::ForwardAndGradient :
+                      (d_val == "1") ? ExecuteGeneratorArgs::Gradient :
+                                       ExecuteGeneratorArgs::Default;
     args.create_generator = create_generator;
+    // The generator cache only hashes native code, so it can't tell
+    // when Generators from elsewhere (e.g. Python source) change.
+    args.use_generator_cache = &generator_factory_provider == &get_registered_generators();
     // args.generator_params is already set
     // If true, log the path of all output files to stdout.
     args.log_outputs = (v_val == "1");
@@ -852,11 +889,14 @@ gengen
     if (do_compiler_logging) {
         const bool obfuscate_compiler_logging = get_env_variable("HL_OBFUSCATE_COMPILER_LOGGER") == "1";
         args.compiler_logger_factory =
-            [obfuscate_compiler_logging, &args](const std::string &function_name, const Target &target) -> std::unique_ptr<CompilerLogger> {
+            [obfuscate_compiler_logging,
+             generator_name = args.generator_name,
+             generator_function_name = args.function_name,
+             generator_params = args.generator_params](const std::string &function_name, const Target &target) -> std::unique_ptr<CompilerLogger> {
             // rebuild generator_args from the map so that they are always canonical
             std::string generator_args_string, autoscheduler_name;
             std::string sep;
-            for (const auto &it : args.generator_params) {
+            for (const auto &it : generator_params) {
                 std::string quote = it.second.find(' ') != std::string::npos ? "\\\"" : "";
                 generator_args_string += sep + it.first + "=" + quote + it.second + quote;
                 sep = " ";
@@ -865,8 +905,8 @@ gengen
                 }
             }
             std::unique_ptr<JSONCompilerLogger> t(new JSONCompilerLogger(
-                obfuscate_compiler_logging ? "" : args.generator_name,
-                obfuscate_compiler_logging ? "" : args.function_name,
+                obfuscate_compiler_logging ? "" : generator_name,
+                obfuscate_compiler_logging ? "" : generator_function_name,
                 obfuscate_compiler_logging ? "" : autoscheduler_name,
                 obfuscate_compiler_logging ? Target() : target,
                 obfuscate_compiler_logging ? "" : generator_args_string,
@@ -895,8 +935,109 @@ gengen
         user_error << o.str();
     }
 
-    execute_generator(args);
-    return 0;
+    return args;
+}
+
+// Run the invocations listed in a manifest, on up to num_jobs threads.
+int execute_generator_batch(const std::string &manifest_path, int num_jobs,
+                            const GeneratorFactoryProvider &generator_factory_provider) {
+    std::ifstream manifest(manifest_path);
+    user_assert(manifest.is_open()) << "Could not open manifest: " << manifest_path << "\n";
+
+    // Parse everything up front, on this thread, so that errors in the
+    // manifest are reported before anything is built, and any plugins
+    // named in it are loaded before the workers start.
+    std::vector<ExecuteGeneratorArgs> jobs;
+    std::vector<int> job_lines;
+    std::string line;
+    for (int line_number = 1; std::getline(manifest, line); line_number++) {
+        std::istringstream words(line);
+        std::vector<std::string> argv;
+        std::string word;
+        while (words >> word) {
+            argv.push_back(word);
+        }
+        if (argv.empty() || argv[0][0] == '#') {
+            continue;
+        }
+        user_assert(argv[0] != "-b" && argv[0] != "-j")
+            << manifest_path << ":" << line_number << ": -b and -j may not be used in a manifest\n";
+        jobs.push_back(parse_generator_args(argv, generator_factory_provider));
+        job_lines.push_back(line_number);
+    }
+
+    if (num_jobs <= 0) {
+        num_jobs = (int)std::thread::hardware_concurrency();
+    }
+    const size_t num_threads = std::max<size_t>(1, std::min(jobs.size(), (size_t)num_jobs));
+    debug(1) << "Running " << jobs.size() << " generator invocations on " << num_threads << " threads\n";
+
+    std::atomic<size_t> next{0};
+    std::atomic<int> failures{0};
+    std::mutex print_mutex;
+    const auto worker = [&]() {
+        size_t i;
+        while ((i = next++) < jobs.size()) {
+#ifdef HALIDE_WITH_EXCEPTIONS
+            try {
+                execute_generator(jobs[i]);
+            } catch (::Halide::Error &err) {
+                std::lock_guard<std::mutex> lock(print_mutex);
+                std::cerr << manifest_path << ":" << job_lines[i] << ": " << err.what() << "\n";
+                failures++;
+            } catch (std::exception &err) {
+                std::lock_guard<std::mutex> lock(print_mutex);
+                std::cerr << manifest_path << ":" << job_lines[i] << ": " << err.what() << "\n";
+                failures++;
+            }
+#else
+            execute_generator(jobs[i]);
+#endif
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : threads) {
+        t.join();
+    }
+    return failures == 0 ? 0 : -1;
+}
+
+int generate_filter_main_inner(int argc,
+                               char **argv,
+                               const GeneratorFactoryProvider &generator_factory_provider) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    std::string manifest_path, jobs = "0";
+    std::vector<std::string> plugins;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "-b" || args[i] == "-j") {
+            user_assert(i + 1 < args.size()) << kUsage;
+            (args[i] == "-b" ? manifest_path : jobs) = args[i + 1];
+            args.erase(args.begin() + i, args.begin() + i + 2);
+            i--;
+        }
+    }
+
+    if (manifest_path.empty()) {
+        execute_generator(parse_generator_args(args, generator_factory_provider));
+        return 0;
+    }
+
+    for (size_t i = 0; i < args.size(); i += 2) {
+        user_assert(args[i] == "-p" && i + 1 < args.size())
+            << "Only -j and -p may be combined with -b\n"
+            << kUsage;
+        for (const auto &lib_path : split_string(args[i + 1], ",")) {
+            if (!lib_path.empty()) {
+                load_generator_plugin(lib_path);
+            }
+        }
+    }
+    return execute_generator_batch(manifest_path, std::atoi(jobs.c_str()), generator_factory_provider);
 }
 
 class GeneratorsFromRegistry : public GeneratorFactoryProvider {
@@ -966,9 +1107,53 @@ int generate_filter_main(int argc, char **argv, const GeneratorFactoryProvider &
 #endif
 
 int generate_filter_main(int argc, char **argv) {
-    return generate_filter_main(argc, argv, GeneratorsFromRegistry());
+    return generate_filter_main(argc, argv, get_registered_generators());
 }
 
+namespace {
+
+// Describe everything that determines the files a Generator emits, for
+// use as a generator cache key. Returns an empty string if the
+// Generator can't be cached.
+std::string generator_cache_key(const ExecuteGeneratorArgs &args,
+                                const std::map<OutputFileType, std::string> &output_files) {
+    if (args.targets.size() > 1 && !output_files.count(OutputFileType::static_library)) {
+        // Multitarget object files are emitted under names that aren't
+        // in output_files.
+        return "";
+    }
+    const std::string identity = generator_identity(loaded_plugins());
+    if (identity.empty()) {
+        return "";
+    }
+    std::ostringstream key;
+#ifdef HALIDE_VERSION_MAJOR
+    key << "halide " << HALIDE_VERSION_MAJOR << "." << HALIDE_VERSION_MINOR << "." << HALIDE_VERSION_PATCH << "\n";
+#endif
+    key << "llvm " << LLVM_VERSION << "\n"
+        << "llvm_args " << get_env_variable("HL_LLVM_ARGS") << "\n"
+        << "llvm_codegen_threads " << get_llvm_codegen_threads() << "\n"
+        << identity
+        << "generator " << args.generator_name << "\n"
+        << "function " << args.function_name << "\n"
+        << "build_mode " << (int)args.build_mode << "\n";
+    for (const auto &kv : args.generator_params) {
+        key << "param " << kv.first << "=" << kv.second << "\n";
+    }
+    for (const Target &t : args.targets) {
+        key << "target " << t.to_string() << "\n";
+    }
+    for (const auto &s : args.suffixes) {
+        key << "suffix " << s << "\n";
+    }
+    for (const auto &kv : output_files) {
+        key << "output " << (int)kv.first << " " << kv.second << "\n";
+    }
+    return key.str();
+}
+
+}  // namespace
+
 void execute_generator(const ExecuteGeneratorArgs &args_in) {
     const auto fix_defaults = [](const ExecuteGeneratorArgs &args_in) -> ExecuteGeneratorArgs {
         ExecuteGeneratorArgs args = args_in;
@@ -1061,18 +1246,58 @@ void execute_generator(const ExecuteGeneratorArgs &args_in) {
             auto output_files = compute_output_files(args.targets[0], base_path, args.output_types);
             auto module_factory = [&](const std::string &function_name, const Target &target) -> Module {
                 // Must re-create each time since each instance will have a different Target.
-                auto gen = args.create_generator(args.generator_name, GeneratorContext(target));
-                for (const auto &kv : args.generator_params) {
-                    if (kv.first == "target") {
-                        continue;
+                const auto make_generator = [&]() {
+                    auto gen = args.create_generator(args.generator_name, GeneratorContext(target));
+                    for (const auto &kv : args.generator_params) {
+                        if (kv.first == "target") {
+                            continue;
+                        }
+                        gen->set_generatorparam_value(kv.first, kv.second);
+                    }
+                    return gen;
+                };
+                switch (args.build_mode) {
+                case ExecuteGeneratorArgs::Gradient:
+                    return make_generator()->build_gradient_module(function_name);
+                case ExecuteGeneratorArgs::ForwardAndGradient: {
+                    // A Generator can only be built once, so we need a second
+                    // one for the gradient.
+                    Module result = make_generator()->build_module(function_name);
+                    Module gradient = make_generator()->build_gradient_module(function_name + "_grad");
+                    for (const auto &b : gradient.buffers()) {
+                        result.append(b);
                     }
-                    gen->set_generatorparam_value(kv.first, kv.second);
+                    for (const auto &f : gradient.functions()) {
+                        result.append(f);
+                    }
+                    for (const auto &m : gradient.submodules()) {
+                        result.append(m);
+                    }
+                    for (const auto &kv : gradient.get_metadata_name_map()) {
+                        result.remap_metadata_name(kv.first, kv.second);
+                    }
+                    result.set_any_strict_float(result.any_strict_float() || gradient.any_strict_float());
+                    std::set<std::string> nontemporal_buffers = result.nontemporal_buffers();
+                    nontemporal_buffers.insert(gradient.nontemporal_buffers().begin(),
+                                               gradient.nontemporal_buffers().end());
+                    result.set_nontemporal_buffers(nontemporal_buffers);
+                    return result;
+                }
+                default:
+                    return make_generator()->build_module(function_name);
                 }
-                return args.build_mode == ExecuteGeneratorArgs::Gradient ?
-                           gen->build_gradient_module(function_name) :
-                           gen->build_module(function_name);
             };
-            compile_multitarget(args.function_name, output_files, args.targets, args.suffixes, module_factory, args.compiler_logger_factory);
+            std::string cache_key;
+            if (args.use_generator_cache && !get_env_variable("HL_GENERATOR_CACHE_DIR").empty()) {
+                cache_key = generator_cache_key(args, output_files);
+            }
+            const GeneratorCache cache(cache_key);
+            if (cache.load(output_files)) {
+                debug(1) << "Loaded outputs of Generator " << args.generator_name << " from generator cache\n";
+            } else {
+                compile_multitarget(args.function_name, output_files, args.targets, args.suffixes, module_factory, args.compiler_logger_factory);
+                cache.save(output_files);
+            }
             if (args.log_outputs) {
                 for (const auto &o : output_files) {
                     std::cout << "Generated file: " << o.second << "\n";
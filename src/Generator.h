@@ -1801,6 +1801,7 @@ public:
 
     /** Forward methods to the ImageParam. */
     // @{
+    HALIDE_FORWARD_METHOD(ImageParam, deinterleaved)
     HALIDE_FORWARD_METHOD(ImageParam, dim)
     HALIDE_FORWARD_METHOD_CONST(ImageParam, dim)
     HALIDE_FORWARD_METHOD_CONST(ImageParam, host_alignment)
@@ -2313,6 +2314,7 @@ public:
     HALIDE_FORWARD_METHOD(Func, specialize_fail)
     HALIDE_FORWARD_METHOD(Func, split)
     HALIDE_FORWARD_METHOD(Func, store_at)
+    HALIDE_FORWARD_METHOD(Func, store_interleaved)
     HALIDE_FORWARD_METHOD(Func, store_root)
     HALIDE_FORWARD_METHOD(Func, tile)
     HALIDE_FORWARD_METHOD(Func, trace_stores)
@@ -3920,7 +3922,11 @@ struct ExecuteGeneratorArgs {
         Default,
 
         // Build a version suitable for using for gradient descent calculation.
-        Gradient
+        Gradient,
+
+        // Build both of the above in one module, with the gradient version
+        // named <function_name>_grad.
+        ForwardAndGradient
     } build_mode = Default;
 
     // The fn that will produce Generator(s) from the name specified.
@@ -3943,6 +3949,13 @@ struct ExecuteGeneratorArgs {
 
     // If true, log the path of all output files to stdout.
     bool log_outputs = false;
+
+    // If true, and HL_GENERATOR_CACHE_DIR is set, the output files may be
+    // loaded from and stored in the generator cache (see GeneratorCache.h).
+    // The cache only knows about code in the running executable, libHalide
+    // and any loaded plugins, so it must not be used with Generators defined
+    // elsewhere (e.g. in Python).
+    bool use_generator_cache = false;
 };
 
 /**
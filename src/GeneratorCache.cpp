@@ -0,0 +1,188 @@
+#include "GeneratorCache.h"
+
+#include <sstream>
+
+#include "Debug.h"
+#include "LLVM_Headers.h"
+#include "Util.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+constexpr int generator_cache_version = 1;
+
+std::string hash_to_hex(llvm::StringRef str) {
+    auto hash = llvm::SHA1::hash(llvm::ArrayRef<uint8_t>((const uint8_t *)str.data(), str.size()));
+    return llvm::toHex(hash, /*LowerCase*/ true);
+}
+
+// Entries are the version and the size of the key, each on a line,
+// then the key, then for each output file its type and size on a line
+// followed by its contents.
+bool read_line(llvm::StringRef &in, std::string *line) {
+    size_t end = in.find('\n');
+    if (end == llvm::StringRef::npos) {
+        return false;
+    }
+    *line = in.substr(0, end).str();
+    in = in.drop_front(end + 1);
+    return true;
+}
+
+// The path of the file this code was loaded from: the Halide shared
+// library, or the executable if Halide is linked in statically.
+std::string halide_library_path() {
+#ifdef _WIN32
+    HMODULE module = nullptr;
+    char path[MAX_PATH];
+    if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                                GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                            (LPCSTR)&halide_library_path, &module)) {
+        return "";
+    }
+    DWORD size = GetModuleFileNameA(module, path, MAX_PATH);
+    if (size == 0 || size == MAX_PATH) {
+        return "";
+    }
+    return std::string(path, size);
+#else
+    Dl_info info;
+    if (!dladdr((void *)&halide_library_path, &info) || !info.dli_fname) {
+        return "";
+    }
+    return info.dli_fname;
+#endif
+}
+
+}  // namespace
+
+GeneratorCache::GeneratorCache(const std::string &key)
+    : key(key) {
+    const std::string dir = get_env_variable("HL_GENERATOR_CACHE_DIR");
+    if (dir.empty() || key.empty()) {
+        return;
+    }
+    path = dir + "/" + hash_to_hex(key) + ".generated";
+}
+
+bool GeneratorCache::load(const std::map<OutputFileType, std::string> &output_files) const {
+    if (!enabled()) {
+        return false;
+    }
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) {
+        return false;
+    }
+    llvm::StringRef in = (*buffer)->getBuffer();
+
+    // Check the whole key rather than trusting the hash.
+    std::string version, key_size;
+    if (!read_line(in, &version) ||
+        !read_line(in, &key_size) ||
+        version != std::to_string(generator_cache_version) ||
+        key_size != std::to_string(key.size()) ||
+        !in.startswith(key)) {
+        debug(1) << "Ignoring mismatched generator cache entry " << path << "\n";
+        return false;
+    }
+    in = in.drop_front(key.size());
+
+    std::map<OutputFileType, llvm::StringRef> contents;
+    std::string header;
+    while (read_line(in, &header)) {
+        std::istringstream h(header);
+        int type = -1;
+        size_t size = 0;
+        h >> type >> size;
+        if (h.fail() || size > in.size()) {
+            debug(1) << "Ignoring malformed generator cache entry " << path << "\n";
+            return false;
+        }
+        contents[(OutputFileType)type] = in.substr(0, size);
+        in = in.drop_front(size);
+    }
+
+    for (const auto &it : output_files) {
+        if (!contents.count(it.first)) {
+            return false;
+        }
+    }
+    for (const auto &it : output_files) {
+        llvm::StringRef data = contents.at(it.first);
+        write_entire_file(it.second, data.data(), data.size());
+    }
+    debug(1) << "Loaded generator outputs from generator cache " << path << "\n";
+    return true;
+}
+
+void GeneratorCache::save(const std::map<OutputFileType, std::string> &output_files) const {
+    if (!enabled()) {
+        return;
+    }
+
+    std::string out = std::to_string(generator_cache_version) + "\n" +
+                      std::to_string(key.size()) + "\n" + key;
+    for (const auto &it : output_files) {
+        std::vector<char> data = read_entire_file(it.second);
+        out += std::to_string((int)it.first) + " " + std::to_string(data.size()) + "\n";
+        out.append(data.begin(), data.end());
+    }
+
+    // Write to a temporary file and rename it into place, so that
+    // concurrent builds never see a partially-written entry.
+    int fd = -1;
+    llvm::SmallString<256> tmp_path;
+    if (llvm::sys::fs::createUniqueFile(path + ".%%%%%%%%.tmp", fd, tmp_path)) {
+        debug(1) << "Unable to write to generator cache " << path << "\n";
+        return;
+    }
+    {
+        llvm::raw_fd_ostream file(fd, /*shouldClose*/ true);
+        file << out;
+    }
+    if (llvm::sys::fs::rename(tmp_path, path)) {
+        llvm::sys::fs::remove(tmp_path);
+        debug(1) << "Unable to write to generator cache " << path << "\n";
+        return;
+    }
+    debug(1) << "Stored generator outputs in generator cache " << path << "\n";
+}
+
+std::string generator_identity(const std::vector<std::string> &libraries) {
+    static int main_addr = 0;
+    const std::string main_executable = llvm::sys::fs::getMainExecutable(nullptr, &main_addr);
+    const std::string halide_library = halide_library_path();
+    std::vector<std::string> files = {main_executable};
+    if (halide_library.empty() || !llvm::sys::fs::equivalent(halide_library, main_executable)) {
+        // Rebuilding libHalide changes what the Generator emits without
+        // changing the executable, so libHalide is hashed too. An empty
+        // path fails below.
+        files.push_back(halide_library);
+    }
+    files.insert(files.end(), libraries.begin(), libraries.end());
+
+    std::string identity;
+    for (const std::string &f : files) {
+        auto buffer = llvm::MemoryBuffer::getFile(f);
+        if (f.empty() || !buffer) {
+            debug(1) << "Unable to hash " << f << " for the generator cache\n";
+            return "";
+        }
+        identity += hash_to_hex((*buffer)->getBuffer()) + " " + f + "\n";
+    }
+    return identity;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,61 @@
+#ifndef HALIDE_GENERATOR_CACHE_H
+#define HALIDE_GENERATOR_CACHE_H
+
+/** \file
+ * Defines an on-disk cache of the files produced by running Generators.
+ *
+ * Build systems rerun a Generator whenever any of its dependencies
+ * change, even when nothing that affects its outputs did, and running a
+ * large Generator can take minutes. If the environment variable
+ * HL_GENERATOR_CACHE_DIR names a directory, execute_generator stores the
+ * files it emits in that directory, under a hash of the Generator
+ * executable, the Halide library and any plugins it loaded, the
+ * Generator name and GeneratorParams, the targets, the requested
+ * outputs, the Halide and LLVM versions and the LLVM options. The next time the same Generator is run in the same
+ * way, the files are copied from the cache instead. A Generator that
+ * reads other files while it runs (e.g. weights loaded from disk) must
+ * not be used with the cache. Nor can Generators that aren't native
+ * code, such as Python Generators, so the cache is only used with
+ * Generators from the registry.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Module.h"
+
+namespace Halide {
+namespace Internal {
+
+class GeneratorCache {
+    std::string key, path;
+
+public:
+    /** Find the entry for a key, which is a description of everything
+     * that determines the outputs. The cache is disabled if
+     * HL_GENERATOR_CACHE_DIR is not set or the key is empty. */
+    explicit GeneratorCache(const std::string &key);
+
+    bool enabled() const {
+        return !path.empty();
+    }
+
+    /** If the cache holds an entry with all of the given outputs,
+     * write them to their files and return true. */
+    bool load(const std::map<OutputFileType, std::string> &output_files) const;
+
+    /** Store the given output files, which must all exist. */
+    void save(const std::map<OutputFileType, std::string> &output_files) const;
+};
+
+/** A hash of the contents of the running executable, of the Halide
+ * shared library (if Halide isn't linked in statically), and of the
+ * given libraries, for use in generator cache keys. Returns an empty
+ * string if any of them can't be read. */
+std::string generator_identity(const std::vector<std::string> &libraries);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
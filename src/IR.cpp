@@ -646,6 +646,7 @@ const char *const intrinsic_op_names[] = {
     "mux",
     "popcount",
     "prefetch",
+    "profiler_stage_marker",
     "promise_clamped",
     "random",
     "register_destructor",
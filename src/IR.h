@@ -561,6 +561,11 @@ struct Call : public ExprNode<Call> {
         mux,
         popcount,
         prefetch,
+
+        // Marks the start of an update definition or specialization of
+        // a Func, which inject_profiling bills separately when the
+        // profile_stages feature is on. arg[0] names it.
+        profiler_stage_marker,
         promise_clamped,
         random,
         register_destructor,
@@ -1,3 +1,6 @@
+#include <cmath>
+#include <cstring>
+
 #include "IREquality.h"
 #include "IROperator.h"
 #include "IRVisitor.h"
@@ -686,6 +689,343 @@ bool ExprWithCompareCache::operator<(const ExprWithCompareCache &other) const {
     return cmp.result == IRComparer::LessThan;
 }
 
+namespace {
+
+uint64_t hash_combine(uint64_t h, uint64_t v) {
+    // Combine as boost::hash_combine does, then apply the 64-bit
+    // finalizer from MurmurHash3 to spread the bits.
+    h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t hash_string(const string &str) {
+    // FNV-1a, rather than std::hash, so that hashes are stable across
+    // standard libraries.
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c : str) {
+        h ^= (uint8_t)c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/** Hashes the fields of a single node that IRComparer compares,
+ * combined with the hashes of its children. */
+class HashNode : public IRVisitor {
+    IRHasher &hasher;
+
+    void mix(uint64_t v) {
+        h = hash_combine(h, v);
+    }
+
+    void mix_name(const string &name) {
+        mix(hash_string(name));
+    }
+
+    void mix_expr(const Expr &e) {
+        mix(hasher.hash(e));
+    }
+
+    void mix_stmt(const Stmt &s) {
+        mix(hasher.hash(s));
+    }
+
+    void mix_exprs(const vector<Expr> &v) {
+        mix(v.size());
+        for (const Expr &e : v) {
+            mix_expr(e);
+        }
+    }
+
+    template<typename T>
+    void mix_binary(const T *op) {
+        mix_expr(op->a);
+        mix_expr(op->b);
+    }
+
+public:
+    uint64_t h;
+
+    HashNode(IRHasher &hasher, const IRNode *n)
+        : hasher(hasher), h(hash_combine(0, (uint64_t)n->node_type)) {
+    }
+
+    void mix_type(Type t) {
+        mix(t.code());
+        mix(t.bits());
+        mix(t.lanes());
+        // Handle types that compare equal have the same inner name.
+        if (t.handle_type) {
+            mix_name(t.handle_type->inner_name.name);
+        }
+    }
+
+protected:
+    void visit(const IntImm *op) override {
+        mix((uint64_t)op->value);
+    }
+    void visit(const UIntImm *op) override {
+        mix(op->value);
+    }
+    void visit(const FloatImm *op) override {
+        // All NaNs are equal to each other, and so are the zeros.
+        double v = op->value;
+        if (std::isnan(v)) {
+            mix(1);
+        } else {
+            if (v == 0) {
+                v = 0;
+            }
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            mix(bits);
+        }
+    }
+    void visit(const StringImm *op) override {
+        mix_name(op->value);
+    }
+    void visit(const Cast *op) override {
+        mix_expr(op->value);
+    }
+    void visit(const Reinterpret *op) override {
+        mix_expr(op->value);
+    }
+    void visit(const Variable *op) override {
+        mix_name(op->name);
+    }
+    void visit(const Add *op) override {
+        mix_binary(op);
+    }
+    void visit(const Sub *op) override {
+        mix_binary(op);
+    }
+    void visit(const Mul *op) override {
+        mix_binary(op);
+    }
+    void visit(const Div *op) override {
+        mix_binary(op);
+    }
+    void visit(const Mod *op) override {
+        mix_binary(op);
+    }
+    void visit(const Min *op) override {
+        mix_binary(op);
+    }
+    void visit(const Max *op) override {
+        mix_binary(op);
+    }
+    void visit(const EQ *op) override {
+        mix_binary(op);
+    }
+    void visit(const NE *op) override {
+        mix_binary(op);
+    }
+    void visit(const LT *op) override {
+        mix_binary(op);
+    }
+    void visit(const LE *op) override {
+        mix_binary(op);
+    }
+    void visit(const GT *op) override {
+        mix_binary(op);
+    }
+    void visit(const GE *op) override {
+        mix_binary(op);
+    }
+    void visit(const And *op) override {
+        mix_binary(op);
+    }
+    void visit(const Or *op) override {
+        mix_binary(op);
+    }
+    void visit(const Not *op) override {
+        mix_expr(op->a);
+    }
+    void visit(const Select *op) override {
+        mix_expr(op->condition);
+        mix_expr(op->true_value);
+        mix_expr(op->false_value);
+    }
+    void visit(const Load *op) override {
+        mix_name(op->name);
+        mix_expr(op->predicate);
+        mix_expr(op->index);
+        mix(op->alignment.modulus);
+        mix(op->alignment.remainder);
+    }
+    void visit(const Ramp *op) override {
+        mix_expr(op->base);
+        mix_expr(op->stride);
+    }
+    void visit(const Broadcast *op) override {
+        mix_expr(op->value);
+    }
+    void visit(const Call *op) override {
+        mix_name(op->name);
+        mix(op->call_type);
+        mix(op->value_index);
+        mix_exprs(op->args);
+    }
+    void visit(const Let *op) override {
+        mix_name(op->name);
+        mix_expr(op->value);
+        mix_expr(op->body);
+    }
+    void visit(const LetStmt *op) override {
+        mix_name(op->name);
+        mix_expr(op->value);
+        mix_stmt(op->body);
+    }
+    void visit(const AssertStmt *op) override {
+        mix_expr(op->condition);
+        mix_expr(op->message);
+    }
+    void visit(const ProducerConsumer *op) override {
+        mix_name(op->name);
+        mix(op->is_producer);
+        mix_stmt(op->body);
+    }
+    void visit(const For *op) override {
+        mix_name(op->name);
+        mix((uint64_t)op->for_type);
+        mix_expr(op->min);
+        mix_expr(op->extent);
+        mix_stmt(op->body);
+    }
+    void visit(const Acquire *op) override {
+        mix_expr(op->semaphore);
+        mix_expr(op->count);
+        mix_stmt(op->body);
+    }
+    void visit(const Store *op) override {
+        mix_name(op->name);
+        mix_expr(op->predicate);
+        mix_expr(op->value);
+        mix_expr(op->index);
+        mix(op->alignment.modulus);
+        mix(op->alignment.remainder);
+    }
+    void visit(const Provide *op) override {
+        mix_name(op->name);
+        mix_exprs(op->args);
+        mix_exprs(op->values);
+    }
+    void visit(const Allocate *op) override {
+        mix_name(op->name);
+        mix_type(op->type);
+        mix_exprs(op->extents);
+        mix_stmt(op->body);
+        mix_expr(op->condition);
+        mix_expr(op->new_expr);
+        mix_name(op->free_function);
+    }
+    void visit(const Free *op) override {
+        mix_name(op->name);
+    }
+    void visit(const Realize *op) override {
+        mix_name(op->name);
+        mix(op->types.size());
+        for (const Type &t : op->types) {
+            mix_type(t);
+        }
+        mix(op->bounds.size());
+        for (const Range &r : op->bounds) {
+            mix_expr(r.min);
+            mix_expr(r.extent);
+        }
+        mix_stmt(op->body);
+        mix_expr(op->condition);
+    }
+    void visit(const Block *op) override {
+        mix_stmt(op->first);
+        mix_stmt(op->rest);
+    }
+    void visit(const Fork *op) override {
+        mix_stmt(op->first);
+        mix_stmt(op->rest);
+    }
+    void visit(const IfThenElse *op) override {
+        mix_expr(op->condition);
+        mix_stmt(op->then_case);
+        mix_stmt(op->else_case);
+    }
+    void visit(const Evaluate *op) override {
+        mix_expr(op->value);
+    }
+    void visit(const Shuffle *op) override {
+        mix_exprs(op->vectors);
+        mix(op->indices.size());
+        for (int i : op->indices) {
+            mix((uint64_t)i);
+        }
+    }
+    void visit(const Prefetch *op) override {
+        mix_name(op->name);
+        mix(op->types.size());
+        for (const Type &t : op->types) {
+            mix_type(t);
+        }
+        mix(op->bounds.size());
+        for (const Range &r : op->bounds) {
+            mix_expr(r.min);
+            mix_expr(r.extent);
+        }
+        mix_expr(op->condition);
+        mix_stmt(op->body);
+    }
+    void visit(const Atomic *op) override {
+        mix_name(op->producer_name);
+        mix_name(op->mutex_name);
+        mix_stmt(op->body);
+    }
+    void visit(const VectorReduce *op) override {
+        mix((uint64_t)op->op);
+        mix_expr(op->value);
+    }
+};
+
+}  // namespace
+
+uint64_t IRHasher::hash(const Expr &e) {
+    if (!e.defined()) {
+        return 0;
+    }
+    auto it = cache.find(e.get());
+    if (it != cache.end()) {
+        return it->second;
+    }
+    HashNode hasher(*this, e.get());
+    hasher.mix_type(e.type());
+    e.accept(&hasher);
+    cache.emplace(e.get(), hasher.h);
+    return hasher.h;
+}
+
+uint64_t IRHasher::hash(const Stmt &s) {
+    if (!s.defined()) {
+        return 0;
+    }
+    auto it = cache.find(s.get());
+    if (it != cache.end()) {
+        return it->second;
+    }
+    HashNode hasher(*this, s.get());
+    s.accept(&hasher);
+    cache.emplace(s.get(), hasher.h);
+    return hasher.h;
+}
+
+uint64_t structural_hash(const Expr &e) {
+    return IRHasher().hash(e);
+}
+
+uint64_t structural_hash(const Stmt &s) {
+    return IRHasher().hash(s);
+}
+
 // Testing code
 namespace {
 
@@ -713,6 +1053,11 @@ void check_equal(const Expr &a, const Expr &b) {
         << a
         << "\nand\n"
         << b << "\n";
+    internal_assert(structural_hash(a) == structural_hash(b))
+        << "Error in ir_equality_test: equal Exprs have different hashes:\n"
+        << a
+        << "\nand\n"
+        << b << "\n";
 }
 
 void check_not_equal(const Expr &a, const Expr &b) {
@@ -751,6 +1096,18 @@ void ir_equality_test() {
     // These are only discovered to be not equal way down the tree:
     e2 = e2 * e2 + e2;
     check_not_equal(e1, e2);
+    internal_assert(structural_hash(e1) != structural_hash(e2));
+
+    // Hashes are consistent with equal() on floats.
+    check_equal(FloatImm::make(Float(32), 0.0), FloatImm::make(Float(32), -0.0));
+    check_equal(FloatImm::make(Float(32), NAN), FloatImm::make(Float(32), -NAN));
+    internal_assert(structural_hash(x + 1) != structural_hash(x + 2));
+    internal_assert(structural_hash(cast<float>(x)) != structural_hash(cast<double>(x)));
+
+    // Shared subexpressions are hashed once across calls to an IRHasher.
+    IRHasher hasher;
+    internal_assert(hasher.hash(e1 + 1) == structural_hash(e1 + 1));
+    internal_assert(hasher.hash(Evaluate::make(e1)) != hasher.hash(Evaluate::make(e2)));
 
     debug(0) << "ir_equality_test passed\n";
 }
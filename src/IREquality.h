@@ -5,6 +5,8 @@
  * Methods to test Exprs and Stmts for equality of value
  */
 
+#include <unordered_map>
+
 #include "Expr.h"
 
 namespace Halide {
@@ -122,6 +124,61 @@ bool graph_less_than(const Expr &a, const Expr &b);
 bool graph_less_than(const Stmt &a, const Stmt &b);
 // @}
 
+/** Computes structural hashes of IR that are consistent with equal():
+ * IR that compares equal hashes to the same value. The hash depends
+ * only on the structure of the IR, so it is the same across runs and
+ * platforms, but it may change between versions of Halide. The hash
+ * of each node is cached by address, so a shared subexpression is
+ * only hashed once, both within one piece of IR and across calls. The
+ * cache does not keep nodes alive. The caller must keep everything
+ * hashed alive while using the hasher, or forget() a node before
+ * releasing it. */
+class IRHasher {
+    std::unordered_map<const IRNode *, uint64_t> cache;
+
+public:
+    uint64_t hash(const Expr &e);
+    uint64_t hash(const Stmt &s);
+
+    /** Drop the cached hash of a single node. */
+    void forget(const IRHandle &n) {
+        cache.erase(n.get());
+    }
+
+    void clear() {
+        cache.clear();
+    }
+};
+
+/** The structural hash of some IR. See IRHasher. */
+// @{
+uint64_t structural_hash(const Expr &e);
+uint64_t structural_hash(const Stmt &s);
+// @}
+
+/** Hash and equality structs for using IR as the key of an
+ * std::unordered_map or std::unordered_set, by value rather than by
+ * identity. */
+// @{
+struct IRDeepHash {
+    size_t operator()(const Expr &e) const {
+        return (size_t)structural_hash(e);
+    }
+    size_t operator()(const Stmt &s) const {
+        return (size_t)structural_hash(s);
+    }
+};
+
+struct IRDeepEqual {
+    bool operator()(const Expr &a, const Expr &b) const {
+        return graph_equal(a, b);
+    }
+    bool operator()(const Stmt &a, const Stmt &b) const {
+        return graph_equal(a, b);
+    }
+};
+// @}
+
 void ir_equality_test();
 
 }  // namespace Internal
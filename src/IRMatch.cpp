@@ -1,3 +1,4 @@
+#include <atomic>
 #include <iostream>
 #include <map>
 #include <utility>
@@ -548,6 +549,20 @@ bool equal_helper(const BaseExprNode &a, const BaseExprNode &b) noexcept {
     return false;
 }
 
+namespace {
+// Counted per thread, so that concurrent compilations don't see each
+// other's rewrites.
+thread_local uint64_t matched_rewrites = 0;
+}  // namespace
+
+void count_matched_rewrite() {
+    matched_rewrites++;
+}
+
+uint64_t matched_rewrite_count() {
+    return matched_rewrites;
+}
+
 }  // namespace IRMatcher
 }  // namespace Internal
 }  // namespace Halide
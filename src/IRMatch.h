@@ -2813,6 +2813,13 @@ HALIDE_ALWAYS_INLINE bool evaluate_predicate(Pattern p, MatcherState &state) {
 // correctness_simplify with this on.
 #define HALIDE_FUZZ_TEST_RULES 0
 
+/** Called each time a rewrite rule matches. The total is reported per
+ * lowering pass to the CompilerLogger. */
+void count_matched_rewrite();
+
+/** The number of rewrite rules that have matched so far on this thread. */
+uint64_t matched_rewrite_count();
+
 template<typename Instance>
 struct Rewriter {
     Instance instance;
@@ -2844,6 +2851,7 @@ struct Rewriter {
 #endif
         if (before.template match<0>(unwrap(instance), state)) {
             build_replacement(after);
+            count_matched_rewrite();
 #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << "\n";
 #endif
@@ -2862,6 +2870,7 @@ struct Rewriter {
         static_assert(Before::canonical, "LHS of rewrite rule should be in canonical form");
         if (before.template match<0>(unwrap(instance), state)) {
             result = after;
+            count_matched_rewrite();
 #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << "\n";
 #endif
@@ -2883,6 +2892,7 @@ struct Rewriter {
 #endif
         if (before.template match<0>(unwrap(instance), state)) {
             result = make_const(output_type, after);
+            count_matched_rewrite();
 #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << "\n";
 #endif
@@ -2914,6 +2924,7 @@ struct Rewriter {
         if (before.template match<0>(unwrap(instance), state) &&
             evaluate_predicate(pred, state)) {
             build_replacement(after);
+            count_matched_rewrite();
 #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << " when " << pred << "\n";
 #endif
@@ -2937,6 +2948,7 @@ struct Rewriter {
         if (before.template match<0>(unwrap(instance), state) &&
             evaluate_predicate(pred, state)) {
             result = after;
+            count_matched_rewrite();
 #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << " when " << pred << "\n";
 #endif
@@ -2962,6 +2974,7 @@ struct Rewriter {
         if (before.template match<0>(unwrap(instance), state) &&
             evaluate_predicate(pred, state)) {
             result = make_const(output_type, after);
+            count_matched_rewrite();
 #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << " when " << pred << "\n";
 #endif
@@ -0,0 +1,389 @@
+#include "IRNodeAllocator.h"
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "Error.h"
+#include "Expr.h"
+#include "IR.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+// The sanitizers can only check accesses to nodes if they come straight
+// from the system allocator.
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+constexpr bool use_pages = false;
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(memory_sanitizer) || __has_feature(thread_sanitizer)
+constexpr bool use_pages = false;
+#else
+constexpr bool use_pages = true;
+#endif
+#else
+constexpr bool use_pages = true;
+#endif
+
+constexpr size_t page_size = 64 * 1024;
+constexpr size_t granule = 16;
+// Larger nodes (there are none at the time of writing) come from the heap.
+constexpr size_t max_slot_size = 512;
+constexpr int num_size_classes = max_slot_size / granule;
+
+int size_class(size_t size) {
+    return (int)((size + granule - 1) / granule) - 1;
+}
+
+struct FreeSlot {
+    FreeSlot *next;
+};
+
+struct Pool;
+
+// The header at the start of each page. Pages are aligned to their size,
+// so the page containing a node can be found by masking its address.
+struct Page {
+    // Only touched by the owning thread (or, for orphaned pages, while
+    // holding orphans_mutex).
+    enum class List { None,
+                      Available,
+                      Full };
+    Page *prev = nullptr, *next = nullptr;
+    List list = List::None;
+    int size_class = 0;
+    size_t slot_size = 0;
+    FreeSlot *free = nullptr;
+    char *bump = nullptr, *end = nullptr;
+    // Slots handed out and not yet known to be free. Slots freed by other
+    // threads are still counted until the owner collects them.
+    int64_t used = 0;
+
+    // Touched by any thread. The owner is the Pool of the thread that
+    // allocates from this page, or nullptr while it is orphaned.
+    std::atomic<Pool *> owner{nullptr};
+    // Slots freed by threads other than the owner.
+    std::atomic<FreeSlot *> remote_free{nullptr};
+};
+
+constexpr size_t page_header_size = (sizeof(Page) + granule - 1) / granule * granule;
+
+std::atomic<size_t> page_count{0};
+
+Page *new_page(Pool *owner, int cls) {
+    void *mem = ::operator new(page_size, std::align_val_t(page_size));
+    Page *p = new (mem) Page;
+    p->size_class = cls;
+    p->slot_size = (cls + 1) * granule;
+    p->bump = (char *)mem + page_header_size;
+    p->end = (char *)mem + page_size;
+    p->owner.store(owner, std::memory_order_relaxed);
+    page_count++;
+    return p;
+}
+
+void delete_page(Page *p) {
+    p->~Page();
+    ::operator delete((void *)p, std::align_val_t(page_size));
+    page_count--;
+}
+
+Page *page_of(void *ptr) {
+    return (Page *)((uintptr_t)ptr & ~(uintptr_t)(page_size - 1));
+}
+
+// Move the slots other threads have freed onto the owner's free list.
+void collect_remote_frees(Page *p) {
+    FreeSlot *s = p->remote_free.exchange(nullptr, std::memory_order_acquire);
+    while (s) {
+        FreeSlot *next = s->next;
+        s->next = p->free;
+        p->free = s;
+        p->used--;
+        s = next;
+    }
+}
+
+// An intrusive doubly-linked list of pages.
+struct PageList {
+    Page *head = nullptr;
+
+    void push(Page *p, Page::List which) {
+        p->prev = nullptr;
+        p->next = head;
+        if (head) {
+            head->prev = p;
+        }
+        head = p;
+        p->list = which;
+    }
+
+    void remove(Page *p) {
+        if (p->prev) {
+            p->prev->next = p->next;
+        } else {
+            head = p->next;
+        }
+        if (p->next) {
+            p->next->prev = p->prev;
+        }
+        p->prev = p->next = nullptr;
+        p->list = Page::List::None;
+    }
+};
+
+// Pages whose owning thread exited while they still held live nodes.
+// They are adopted by the next thread that needs a page of that size.
+std::mutex orphans_mutex;
+PageList orphans[num_size_classes];
+std::atomic<int> orphan_count{0};
+
+// The pages owned by one thread. Each size class has a page currently
+// being allocated from, a list of other pages known to have free slots,
+// and a list of pages that were full the last time we looked.
+struct Pool {
+    Page *current[num_size_classes] = {};
+    PageList available[num_size_classes];
+    PageList full[num_size_classes];
+
+    FreeSlot *take_slot(Page *p) {
+        if (!p->free) {
+            if (p->bump + p->slot_size <= p->end) {
+                FreeSlot *s = (FreeSlot *)p->bump;
+                p->bump += p->slot_size;
+                return s;
+            }
+            collect_remote_frees(p);
+        }
+        FreeSlot *s = p->free;
+        if (s) {
+            p->free = s->next;
+        }
+        return s;
+    }
+
+    Page *adopt_orphan(int cls) {
+        if (orphan_count.load(std::memory_order_relaxed) == 0) {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(orphans_mutex);
+        Page *p = orphans[cls].head;
+        if (p) {
+            orphans[cls].remove(p);
+            orphan_count--;
+            p->owner.store(this, std::memory_order_relaxed);
+        }
+        return p;
+    }
+
+    void *allocate(int cls) {
+        Page *p = current[cls];
+        FreeSlot *s = p ? take_slot(p) : nullptr;
+        if (!s) {
+            if (p) {
+                full[cls].push(p, Page::List::Full);
+                p = nullptr;
+            }
+            while (!s && available[cls].head) {
+                p = available[cls].head;
+                available[cls].remove(p);
+                s = take_slot(p);
+                if (!s) {
+                    full[cls].push(p, Page::List::Full);
+                }
+            }
+            if (!s) {
+                // Pick up any full page that other threads have freed
+                // slots in before making a new one.
+                for (Page *q = full[cls].head; q; q = q->next) {
+                    if (q->remote_free.load(std::memory_order_relaxed)) {
+                        full[cls].remove(q);
+                        p = q;
+                        s = take_slot(p);
+                        break;
+                    }
+                }
+            }
+            while (!s && (p = adopt_orphan(cls))) {
+                s = take_slot(p);
+                if (!s) {
+                    full[cls].push(p, Page::List::Full);
+                }
+            }
+            if (!s) {
+                p = new_page(this, cls);
+                s = take_slot(p);
+            }
+            current[cls] = p;
+        }
+        p->used++;
+        return s;
+    }
+
+    void free(Page *p, FreeSlot *s) {
+        s->next = p->free;
+        p->free = s;
+        p->used--;
+        if (p == current[p->size_class]) {
+            return;
+        }
+        PageList &l = p->list == Page::List::Available ? available[p->size_class] : full[p->size_class];
+        if (p->used == 0) {
+            // Every slot is free, so nothing can still be pushing onto
+            // remote_free either.
+            l.remove(p);
+            delete_page(p);
+        } else if (p->list == Page::List::Full) {
+            l.remove(p);
+            available[p->size_class].push(p, Page::List::Available);
+        }
+    }
+
+    static void abandon(Page *p) {
+        collect_remote_frees(p);
+        if (p->used == 0) {
+            delete_page(p);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(orphans_mutex);
+        p->owner.store(nullptr, std::memory_order_relaxed);
+        orphans[p->size_class].push(p, Page::List::None);
+        orphan_count++;
+    }
+
+    ~Pool() {
+        for (int cls = 0; cls < num_size_classes; cls++) {
+            for (PageList *l : {&available[cls], &full[cls]}) {
+                while (Page *p = l->head) {
+                    l->remove(p);
+                    abandon(p);
+                }
+            }
+            if (current[cls]) {
+                abandon(current[cls]);
+            }
+        }
+    }
+};
+
+void free_remote(Page *p, FreeSlot *s) {
+    FreeSlot *head = p->remote_free.load(std::memory_order_relaxed);
+    do {
+        s->next = head;
+    } while (!p->remote_free.compare_exchange_weak(head, s, std::memory_order_release, std::memory_order_relaxed));
+}
+
+thread_local Pool *this_thread_pool = nullptr;
+
+struct PoolReleaser {
+    ~PoolReleaser() {
+        delete this_thread_pool;
+        this_thread_pool = nullptr;
+    }
+};
+
+Pool *get_this_thread_pool() {
+    if (!this_thread_pool) {
+        this_thread_pool = new Pool;
+        // Constructed at most once per thread. Should a thread allocate
+        // nodes after this has run on exit, its new pool is leaked.
+        thread_local PoolReleaser releaser;
+        (void)releaser;
+    }
+    return this_thread_pool;
+}
+
+}  // namespace
+
+void *allocate_ir_node(size_t size) {
+    if (!use_pages || size > max_slot_size) {
+        return ::operator new(size);
+    }
+    return get_this_thread_pool()->allocate(size_class(size));
+}
+
+void free_ir_node(void *ptr, size_t size) {
+    if (!use_pages || size > max_slot_size) {
+        ::operator delete(ptr);
+        return;
+    }
+    Page *p = page_of(ptr);
+    Pool *pool = this_thread_pool;
+    if (pool && p->owner.load(std::memory_order_relaxed) == pool) {
+        pool->free(p, (FreeSlot *)ptr);
+    } else {
+        free_remote(p, (FreeSlot *)ptr);
+    }
+}
+
+size_t ir_node_allocator_page_count() {
+    return page_count;
+}
+
+void *IRNode::operator new(size_t size) {
+    return allocate_ir_node(size);
+}
+
+void IRNode::operator delete(void *ptr, size_t size) {
+    free_ir_node(ptr, size);
+}
+
+void ir_node_allocator_test() {
+    if (!use_pages) {
+        return;
+    }
+
+    Expr x = Variable::make(Int(32), "x");
+    const int n = 100000;
+
+    std::vector<Expr> exprs;
+    for (int i = 0; i < n; i++) {
+        exprs.push_back(x + i);
+    }
+    size_t peak = ir_node_allocator_page_count();
+
+    // Free half the nodes on another thread, and the rest on this one.
+    std::thread t([&]() {
+        for (int i = 0; i < n; i += 2) {
+            exprs[i] = Expr();
+        }
+    });
+    t.join();
+    for (int i = 1; i < n; i += 2) {
+        exprs[i] = Expr();
+    }
+
+    // The same number of nodes again should fit in the pages we already
+    // have, whichever thread freed their previous occupants.
+    for (int i = 0; i < n; i++) {
+        exprs[i] = x + i;
+    }
+    internal_assert(ir_node_allocator_page_count() <= peak)
+        << ir_node_allocator_page_count() << " pages vs " << peak << "\n";
+    for (int i = 0; i < n; i++) {
+        internal_assert(is_const(exprs[i].as<Add>()->b, i));
+    }
+    exprs.clear();
+
+    // Nodes made on a thread that has since exited can still be freed,
+    // and their pages are adopted by this thread.
+    std::thread u([&]() {
+        for (int i = 0; i < n; i++) {
+            exprs.push_back(x * i);
+        }
+    });
+    u.join();
+    exprs.clear();
+
+    std::cout << "IRNodeAllocator test passed" << std::endl;
+}
+
+}  // namespace Internal
+}  // namespace Halide
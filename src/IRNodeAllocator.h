@@ -0,0 +1,37 @@
+#ifndef HALIDE_IR_NODE_ALLOCATOR_H
+#define HALIDE_IR_NODE_ALLOCATOR_H
+
+/** \file
+ * Defines the allocator behind IRNode::operator new and delete.
+ *
+ * Lowering creates and destroys many millions of small IR nodes. Rather
+ * than calling the system allocator for each one, each thread carves
+ * nodes out of 64KB pages, where every page holds nodes of a single size
+ * class. Freed nodes go back on their page's free list, and a page is
+ * released in one go as soon as the last node in it dies, so memory held
+ * by the garbage of a lowering pass is returned without needing to know
+ * which nodes outlive the pass. Nodes may be freed on any thread.
+ */
+
+#include <cstddef>
+
+namespace Halide {
+namespace Internal {
+
+/** Allocate storage for an IR node of the given size in bytes. */
+void *allocate_ir_node(size_t size);
+
+/** Free storage returned by allocate_ir_node. The size must be the
+ * same one that was passed to allocate_ir_node. */
+void free_ir_node(void *ptr, size_t size);
+
+/** The number of pages currently allocated by all threads, for
+ * testing. */
+size_t ir_node_allocator_page_count();
+
+void ir_node_allocator_test();
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <atomic>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <sstream>
 #include <utility>
@@ -498,10 +499,12 @@ Expr lossless_cast(Type t, Expr e) {
         }
 
         if (const Sub *sub = e.as<Sub>()) {
+            // The difference may be negative, so it only fits in a
+            // signed type.
             Expr a = lossless_cast(t.narrow(), sub->a);
             Expr b = lossless_cast(t.narrow(), sub->b);
-            if (a.defined() && b.defined()) {
-                return cast(t, a) + cast(t, b);
+            if (t.is_int() && a.defined() && b.defined()) {
+                return cast(t, a) - cast(t, b);
             } else {
                 return Expr();
             }
@@ -851,6 +854,179 @@ Expr halide_exp(const Expr &x_full) {
     return result;
 }
 
+namespace {
+
+// Reduce x by the nearest multiple of pi/2, returning the reduced
+// argument in [-pi/4, pi/4] and setting *quadrant to the multiple. pi/2
+// is split into four parts, the first three with few enough bits that
+// their products with the quadrant are exact, so the reduced argument
+// stays accurate for |x| up to about 8192. The subtractions are strict,
+// because reassociating them would fold the parts back together.
+Expr reduce_by_half_pi(const Expr &x, Expr *quadrant) {
+    Type type = x.type();
+    const float two_over_pi = 0.636619772367581343f;
+    const float half_pi_part1 = 1.5703125f;
+    const float half_pi_part2 = 4.837512969970703125e-4f;
+    const float half_pi_part3 = 7.54953362047672271729e-8f;
+    const float half_pi_part4 = 2.56334406825708960298e-12f;
+
+    Expr k_real = floor(x * two_over_pi + 0.5f);
+    *quadrant = cast(Int(32, type.lanes()), k_real);
+    Expr reduced = x - k_real * half_pi_part1;
+    reduced -= k_real * half_pi_part2;
+    reduced -= k_real * half_pi_part3;
+    reduced -= k_real * half_pi_part4;
+    return strict_float(reduced);
+}
+
+// Minimax polynomials for sin, cos and tan on [-pi/4, pi/4], from Cephes.
+Expr sin_polynomial(const Expr &x) {
+    Expr z = x * x;
+    return ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * x + x;
+}
+
+Expr cos_polynomial(const Expr &x) {
+    Expr z = x * x;
+    return ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z - 0.5f * z + 1.0f;
+}
+
+Expr tan_polynomial(const Expr &x) {
+    Expr z = x * x;
+    float coeff[] = {
+        9.38540185543e-3f,
+        3.11992232697e-3f,
+        2.44301354525e-2f,
+        5.34112807005e-2f,
+        1.33387994085e-1f,
+        3.33331568548e-1f};
+    return evaluate_polynomial(z, coeff, sizeof(coeff) / sizeof(coeff[0])) * z * x + x;
+}
+
+// cos(x) is sin(x + pi/2), which is one quadrant further on.
+Expr halide_sin_cos(const Expr &x_full, bool is_sin) {
+    Type type = x_full.type();
+    internal_assert(type.element_of() == Float(32));
+
+    Expr quadrant;
+    Expr x = reduce_by_half_pi(x_full, &quadrant);
+    if (!is_sin) {
+        quadrant += 1;
+    }
+    Expr result = select((quadrant & 1) == 0, sin_polynomial(x), cos_polynomial(x));
+    result = select((quadrant & 2) == 0, result, -result);
+    return common_subexpression_elimination(result);
+}
+
+}  // namespace
+
+Expr halide_sin(const Expr &x) {
+    return halide_sin_cos(x, true);
+}
+
+Expr halide_cos(const Expr &x) {
+    return halide_sin_cos(x, false);
+}
+
+Expr halide_tan(const Expr &x_full) {
+    Type type = x_full.type();
+    internal_assert(type.element_of() == Float(32));
+
+    Expr quadrant;
+    Expr x = reduce_by_half_pi(x_full, &quadrant);
+    Expr t = tan_polynomial(x);
+    Expr result = select((quadrant & 1) == 0, t, -1.0f / t);
+    return common_subexpression_elimination(result);
+}
+
+Expr halide_atan(const Expr &x_full) {
+    Type type = x_full.type();
+    internal_assert(type.element_of() == Float(32));
+
+    // Reduce to [-tan(pi/8), tan(pi/8)] using atan(x) = pi/2 -
+    // atan(1/x) and atan(x) = pi/4 + atan((x - 1) / (x + 1)).
+    const float half_pi = 1.57079632679489661923f;
+    const float quarter_pi = 0.785398163397448309616f;
+    Expr ax = abs(x_full);
+    Expr big = ax > 2.414213562373095f;
+    Expr mid = ax > 0.4142135623730950f;
+    Expr offset = select(big, make_const(type, half_pi),
+                         mid, make_const(type, quarter_pi),
+                         make_zero(type));
+    Expr x = select(big, -1.0f / ax, mid, (ax - 1.0f) / (ax + 1.0f), ax);
+
+    Expr z = x * x;
+    Expr result = offset + (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z - 3.33329491539e-1f) * z * x + x;
+    result = select(x_full < 0.0f, -result, result);
+    return common_subexpression_elimination(result);
+}
+
+Expr halide_atan2(const Expr &y, const Expr &x) {
+    Type type = y.type();
+    internal_assert(type.element_of() == Float(32) && x.type() == type);
+
+    const float pi = 3.14159265358979323846f;
+    const float half_pi = 1.57079632679489661923f;
+    Expr result = halide_atan(y / x);
+    result = select(x < 0.0f, select(y < 0.0f, result - pi, result + pi), result);
+    Expr on_y_axis = select(y > 0.0f, make_const(type, half_pi),
+                            y < 0.0f, make_const(type, -half_pi),
+                            make_zero(type));
+    result = select(x == 0.0f, on_y_axis, result);
+    return common_subexpression_elimination(result);
+}
+
+namespace {
+
+// A minimax polynomial for asin on [-0.5, 0.5], from Cephes, where z
+// is x * x. Larger arguments are reduced using asin(x) = pi/2 - 2 *
+// asin(sqrt((1 - x) / 2)).
+Expr asin_polynomial(const Expr &x, const Expr &z) {
+    float coeff[] = {
+        4.2163199048e-2f,
+        2.4181311049e-2f,
+        4.5470025998e-2f,
+        7.4953002686e-2f,
+        1.6666752422e-1f};
+    return evaluate_polynomial(z, coeff, sizeof(coeff) / sizeof(coeff[0])) * z * x + x;
+}
+
+}  // namespace
+
+Expr halide_asin(const Expr &x_full) {
+    Type type = x_full.type();
+    internal_assert(type.element_of() == Float(32));
+
+    const float half_pi = 1.57079632679489661923f;
+    Expr ax = abs(x_full);
+    Expr big = ax > 0.5f;
+    Expr z = select(big, 0.5f * (1.0f - ax), ax * ax);
+    Expr x = select(big, sqrt(z), ax);
+    Expr p = asin_polynomial(x, z);
+    Expr result = select(big, half_pi - 2.0f * p, p);
+    result = select(x_full < 0.0f, -result, result);
+    return common_subexpression_elimination(result);
+}
+
+Expr halide_acos(const Expr &x_full) {
+    Type type = x_full.type();
+    internal_assert(type.element_of() == Float(32));
+
+    // acos(x) is pi/2 - asin(x), but near +/-1 that loses the low bits
+    // of the result, so use acos(x) = 2 * asin(sqrt((1 - x) / 2))
+    // there instead.
+    const float pi = 3.14159265358979323846f;
+    const float half_pi = 1.57079632679489661923f;
+    Expr ax = abs(x_full);
+    Expr big = ax > 0.5f;
+    Expr z = select(big, 0.5f * (1.0f - ax), x_full * x_full);
+    Expr x = select(big, sqrt(z), x_full);
+    Expr p = asin_polynomial(x, z);
+    Expr result = select(!big, half_pi - p,
+                         x_full < 0.0f, pi - 2.0f * p,
+                         2.0f * p);
+    return common_subexpression_elimination(result);
+}
+
 Expr halide_erf(const Expr &x_full) {
     user_assert(x_full.type() == Float(32)) << "halide_erf only works for Float(32)";
 
@@ -1547,6 +1723,29 @@ Expr mux(const Expr &id, const std::initializer_list<Expr> &values) {
     return mux(id, std::vector<Expr>(values));
 }
 
+namespace {
+const char *const gpu_occupancy_block_size_prefix = "gpu_occupancy_block_size.";
+}  // namespace
+
+Expr gpu_occupancy_block_size(int max_size) {
+    user_assert(max_size > 0) << "gpu_occupancy_block_size requires a positive maximum size.\n";
+    // The name records the maximum, so that the GPU offloading pass
+    // knows what bound to pass to the runtime, and what to use when
+    // it can't ask.
+    std::string name = gpu_occupancy_block_size_prefix + std::to_string(max_size) + "." + Internal::unique_name('b');
+    return clamp(Internal::Variable::make(Int(32), name), 1, max_size);
+}
+
+namespace Internal {
+bool is_gpu_occupancy_block_size(const std::string &name, int *max_size) {
+    if (!starts_with(name, gpu_occupancy_block_size_prefix)) {
+        return false;
+    }
+    *max_size = std::atoi(name.c_str() + strlen(gpu_occupancy_block_size_prefix));
+    return true;
+}
+}  // namespace Internal
+
 Expr unsafe_promise_clamped(const Expr &value, const Expr &min, const Expr &max) {
     user_assert(value.defined()) << "unsafe_promise_clamped with undefined value.\n";
     Expr n_min_val = min.defined() ? lossless_cast(value.type(), min) : value.type().min();
@@ -2215,6 +2414,117 @@ Expr fast_pow(Expr x, Expr y) {
     return select(x == 0.0f, 0.0f, fast_exp(fast_log(x) * std::move(y)));
 }
 
+namespace {
+
+// Give a call to a Float(32) transcendental function the requested
+// accuracy. The high and fast implementations take the arguments of
+// the call; fast may be null if there isn't a faster one.
+Expr with_accuracy(const Expr &precise, MathAccuracy accuracy,
+                   const std::function<Expr(const std::vector<Expr> &)> &high,
+                   const std::function<Expr(const std::vector<Expr> &)> &fast) {
+    const Call *c = precise.as<Call>();
+    if (!c || c->type != Float(32)) {
+        return precise;
+    }
+    switch (accuracy) {
+    case MathAccuracy::Precise: {
+        // strict_float stops the vector_math target feature from
+        // replacing the call. Bind the arguments outside of it, so
+        // that only the call itself is strict.
+        std::vector<std::pair<std::string, Expr>> lets;
+        std::vector<Expr> args;
+        for (const Expr &arg : c->args) {
+            lets.emplace_back(Internal::unique_name('t'), arg);
+            args.push_back(Variable::make(arg.type(), lets.back().first));
+        }
+        Expr result = strict_float(Call::make(c->type, c->name, args, c->call_type));
+        for (auto it = lets.rbegin(); it != lets.rend(); ++it) {
+            result = Let::make(it->first, it->second, result);
+        }
+        return result;
+    }
+    case MathAccuracy::High:
+        return high(c->args);
+    case MathAccuracy::Fast:
+        return fast ? fast(c->args) : high(c->args);
+    }
+    return precise;
+}
+
+}  // namespace
+
+Expr sin(Expr x, MathAccuracy accuracy) {
+    return with_accuracy(
+        sin(std::move(x)), accuracy,
+        [](const std::vector<Expr> &args) { return Internal::halide_sin(args[0]); },
+        [](const std::vector<Expr> &args) { return fast_sin(args[0]); });
+}
+
+Expr cos(Expr x, MathAccuracy accuracy) {
+    return with_accuracy(
+        cos(std::move(x)), accuracy,
+        [](const std::vector<Expr> &args) { return Internal::halide_cos(args[0]); },
+        [](const std::vector<Expr> &args) { return fast_cos(args[0]); });
+}
+
+Expr tan(Expr x, MathAccuracy accuracy) {
+    return with_accuracy(
+        tan(std::move(x)), accuracy,
+        [](const std::vector<Expr> &args) { return Internal::halide_tan(args[0]); },
+        nullptr);
+}
+
+Expr asin(Expr x, MathAccuracy accuracy) {
+    return with_accuracy(
+        asin(std::move(x)), accuracy,
+        [](const std::vector<Expr> &args) { return Internal::halide_asin(args[0]); },
+        nullptr);
+}
+
+Expr acos(Expr x, MathAccuracy accuracy) {
+    return with_accuracy(
+        acos(std::move(x)), accuracy,
+        [](const std::vector<Expr> &args) { return Internal::halide_acos(args[0]); },
+        nullptr);
+}
+
+Expr atan(Expr x, MathAccuracy accuracy) {
+    return with_accuracy(
+        atan(std::move(x)), accuracy,
+        [](const std::vector<Expr> &args) { return Internal::halide_atan(args[0]); },
+        nullptr);
+}
+
+Expr atan2(Expr y, Expr x, MathAccuracy accuracy) {
+    return with_accuracy(
+        atan2(std::move(y), std::move(x)), accuracy,
+        [](const std::vector<Expr> &args) { return Internal::halide_atan2(args[0], args[1]); },
+        nullptr);
+}
+
+// Codegen already uses vectorizable polynomials for Float(32) exp,
+// log, and pow.
+Expr exp(Expr x, MathAccuracy accuracy) {
+    return with_accuracy(
+        exp(std::move(x)), accuracy,
+        [](const std::vector<Expr> &args) { return exp(args[0]); },
+        [](const std::vector<Expr> &args) { return fast_exp(args[0]); });
+}
+
+Expr log(Expr x, MathAccuracy accuracy) {
+    return with_accuracy(
+        log(std::move(x)), accuracy,
+        [](const std::vector<Expr> &args) { return log(args[0]); },
+        [](const std::vector<Expr> &args) { return fast_log(args[0]); });
+}
+
+Expr pow(Expr x, Expr y, MathAccuracy accuracy) {
+    return with_accuracy(
+        pow(std::move(x), std::move(y)), accuracy,
+        [](const std::vector<Expr> &args) { return pow(args[0], args[1]); },
+        [](const std::vector<Expr> &args) { return fast_pow(args[0], args[1]); });
+}
+
 Expr fast_inverse(Expr x) {
     user_assert(x.defined()) << "fast_inverse of undefined Expr\n";
     Type t = x.type();
@@ -187,6 +187,13 @@ void match_types_bitwise(Expr &a, Expr &b, const char *op_name);
 Expr halide_log(const Expr &a);
 Expr halide_exp(const Expr &a);
 Expr halide_erf(const Expr &a);
+Expr halide_sin(const Expr &a);
+Expr halide_cos(const Expr &a);
+Expr halide_tan(const Expr &a);
+Expr halide_asin(const Expr &a);
+Expr halide_acos(const Expr &a);
+Expr halide_atan(const Expr &a);
+Expr halide_atan2(const Expr &y, const Expr &x);
 // @}
 
 /** Raise an expression to an integer power by repeatedly multiplying
@@ -351,6 +358,10 @@ Expr requirement_failed_error(Expr condition, const std::vector<Expr> &args);
 
 Expr memoize_tag_helper(Expr result, const std::vector<Expr> &cache_key_values);
 
+/** Check if a variable name is one made by gpu_occupancy_block_size,
+ * and if so, get the maximum size it was given. */
+bool is_gpu_occupancy_block_size(const std::string &name, int *max_size);
+
 }  // namespace Internal
 
 /** Cast an expression to the halide type corresponding to the C++ type T. */
@@ -937,6 +948,44 @@ Expr pow(Expr x, Expr y);
  * mantissa. Vectorizes cleanly. */
 Expr erf(const Expr &x);
 
+/** Accuracy tiers for the transcendental functions that take one. The
+ * vectorizable tiers are only implemented for Float(32); other types
+ * always get the system math library. */
+enum class MathAccuracy {
+    /** As accurate as the system math library (within about 1
+     * ULP). The trigonometric functions call the library one lane at
+     * a time when vectorized, even with the vector_math target
+     * feature. */
+    Precise,
+
+    /** A vectorizable polynomial approximation within a few ULP. The
+     * trigonometric functions reduce their argument accurately for
+     * |x| up to about 8192. This is what the vector_math target
+     * feature uses for vectorized calls to the functions without an
+     * accuracy. */
+    High,
+
+    /** The fastest vectorizable approximation, with an absolute error
+     * of about 1e-5 (see fast_sin, fast_exp, etc.). Functions without
+     * a faster approximation use the High one. */
+    Fast
+};
+
+/** Transcendental functions with an explicit accuracy tier. See
+ * MathAccuracy. */
+// @{
+Expr sin(Expr x, MathAccuracy accuracy);
+Expr cos(Expr x, MathAccuracy accuracy);
+Expr tan(Expr x, MathAccuracy accuracy);
+Expr asin(Expr x, MathAccuracy accuracy);
+Expr acos(Expr x, MathAccuracy accuracy);
+Expr atan(Expr x, MathAccuracy accuracy);
+Expr atan2(Expr y, Expr x, MathAccuracy accuracy);
+Expr exp(Expr x, MathAccuracy accuracy);
+Expr log(Expr x, MathAccuracy accuracy);
+Expr pow(Expr x, Expr y, MathAccuracy accuracy);
+// @}
+
 /** Fast vectorizable approximation to some trigonometric functions for Float(32).
  * Absolute approximation error is less than 1e-5. */
 // @{
@@ -1423,6 +1472,20 @@ Expr strict_float(Expr e);
  */
 Expr unsafe_promise_clamped(const Expr &value, const Expr &min, const Expr &max);
 
+/** Return a GPU block size that is picked when the pipeline runs, rather
+ * than fixed in the schedule. Use it as the thread tile size of a
+ * one-dimensional gpu_tile:
+ \code
+ f.gpu_tile(x, xo, xi, gpu_occupancy_block_size(512), TailStrategy::GuardWithIf);
+ \endcode
+ * On CUDA, the size is the one that cuOccupancyMaxPotentialBlockSize
+ * reports maximizes the occupancy of the kernel launched with it,
+ * chosen on first use on each device and cached. It is never more than
+ * max_size. With other GPU APIs, or if the CUDA driver can't tell, it
+ * is max_size. Each call returns a distinct value, which should only be
+ * used as the block size of a single kernel. */
+Expr gpu_occupancy_block_size(int max_size = 1024);
+
 namespace Internal {
 /**
  * FOR INTERNAL USE ONLY.
@@ -84,9 +84,32 @@ Func ImageParam::in() {
     return func.in();
 }
 
-void ImageParam::trace_loads() {
+Func ImageParam::deinterleaved(int channels, int vector_size) {
     internal_assert(func.defined());
-    func.trace_loads();
+    const int d = dimensions();
+    user_assert(d >= 2)
+        << "Can't deinterleave ImageParam " << name() << ", because it has fewer than two dimensions.\n";
+    user_assert(channels > 1)
+        << "Can't deinterleave ImageParam " << name() << " into " << channels << " channels.\n";
+
+    dim(0).set_stride(channels);
+    dim(d - 1).set_stride(1).set_bounds(0, channels);
+
+    Func planar = in();
+    std::vector<Var> args = planar.args();
+    std::vector<VarOrRVar> order = {args[d - 1]};
+    order.insert(order.end(), args.begin(), args.end() - 1);
+    planar.compute_root()
+        .bound(args[d - 1], 0, channels)
+        .reorder(order)
+        .unroll(args[d - 1])
+        .vectorize(args[0], vector_size);
+    return planar;
+}
+
+void ImageParam::trace_loads(const TraceSampling &sampling) {
+    internal_assert(func.defined());
+    func.trace_loads(sampling);
 }
 
 ImageParam &ImageParam::add_trace_tag(const std::string &trace_tag) {
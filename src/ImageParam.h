@@ -128,8 +128,30 @@ public:
     Func in();
     // @}
 
-    /** Trace all loads from this ImageParam by emitting calls to halide_trace. */
-    void trace_loads();
+    /** Declare that this ImageParam holds interleaved data, with the
+     * given number of channels along its last dimension stored
+     * adjacent to each other in memory (e.g. RGBRGBRGB...), and
+     * return a wrapper Func (see \ref ImageParam::in) that makes a
+     * planar copy of it on entry to the pipeline. All stages read the
+     * copy, so they are free of stride-channels loads. The copy is
+     * made in one pass, vectorized by vector_size along the first
+     * dimension with the channels unrolled, which becomes a single
+     * vector deinterleave (e.g. ld3 on ARM) per vector. The image
+     * must be at least vector_size wide. The returned Func can be
+     * rescheduled, e.g. to compute it per tile of the consumer
+     * instead of at root:
+     \code
+     ImageParam rgb(UInt(8), 3);
+     Func planar = rgb.deinterleaved(3);
+     output(x, y, c) = ... rgb(x, y, c) ...
+     planar.compute_at(output, yo);
+     \endcode
+     * To write interleaved outputs, see \ref Func::store_interleaved. */
+    Func deinterleaved(int channels, int vector_size = 16);
+
+    /** Trace all loads from this ImageParam by emitting calls to
+     * halide_trace, or only those picked by the sampling. */
+    void trace_loads(const TraceSampling &sampling = TraceSampling());
 
     /** Add a trace tag to this ImageParam's Func. */
     ImageParam &add_trace_tag(const std::string &trace_tag);
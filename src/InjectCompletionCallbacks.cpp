@@ -0,0 +1,95 @@
+#include "InjectCompletionCallbacks.h"
+#include "Bounds.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRPrinter.h"
+#include "InjectHostDevBufferCopies.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+class InjectCompletionCallbacks : public IRMutator {
+    using IRMutator::visit;
+
+    const Function &func;
+    // The prefix of the loops of the last stage of the Func. The
+    // region is only complete once all of the stages have run over it.
+    const string last_stage_prefix;
+
+    Stmt visit(const For *op) override {
+        Stmt body = mutate(op->body);
+
+        const LoopLevel &level = func.schedule().completion_level();
+        if (!starts_with(op->name, last_stage_prefix) || !level.match(op->name)) {
+            if (body.same_as(op->body)) {
+                return op;
+            }
+            return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
+
+        user_assert(op->for_type == ForType::Serial || op->for_type == ForType::Parallel)
+            << "Func " << func.name() << " is scheduled to notify completion at loop " << op->name
+            << ", which is " << op->for_type << ". The loop must be serial or parallel.\n";
+        user_assert(op->device_api == DeviceAPI::None || op->device_api == DeviceAPI::Host)
+            << "Func " << func.name() << " is scheduled to notify completion at loop " << op->name
+            << ", which runs on a device. The loop must run on the host.\n";
+
+        Box box = box_provided(body, func.name());
+        user_assert(box.size() == (size_t)func.dimensions())
+            << "Could not find the region of Func " << func.name()
+            << " provided by an iteration of loop " << op->name << "\n";
+        vector<Expr> mins, extents;
+        for (const Interval &i : box.bounds) {
+            user_assert(i.is_bounded())
+                << "The region of Func " << func.name()
+                << " provided by an iteration of loop " << op->name << " is unbounded\n";
+            mins.push_back(i.min);
+            extents.push_back(i.max - i.min + 1);
+        }
+        vector<Expr> args = {func.name(),
+                             func.dimensions(),
+                             Call::make(type_of<int32_t *>(), Call::make_struct, mins, Call::Intrinsic),
+                             Call::make(type_of<int32_t *>(), Call::make_struct, extents, Call::Intrinsic)};
+        body = Block::make(body, call_extern_and_assert("halide_region_complete", args));
+        found = true;
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+    }
+
+public:
+    bool found = false;
+
+    InjectCompletionCallbacks(const Function &func)
+        : func(func),
+          last_stage_prefix(func.name() + ".s" + std::to_string(func.updates().size()) + ".") {
+    }
+};
+
+}  // namespace
+
+Stmt inject_completion_callbacks(const Stmt &s, const map<string, Function> &env) {
+    Stmt result = s;
+    for (const auto &it : env) {
+        const Function &f = it.second;
+        const LoopLevel &level = f.schedule().completion_level();
+        if (level.is_inlined()) {
+            continue;
+        }
+        InjectCompletionCallbacks injector(f);
+        result = injector.mutate(result);
+        user_assert(injector.found)
+            << "Func " << f.name() << " is scheduled to notify completion at loop "
+            << level.to_string() << ", but there is no such loop in the final stage of "
+            << f.name() << ". Is " << f.name() << " inlined?\n";
+    }
+    return result;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,29 @@
+#ifndef HALIDE_INJECT_COMPLETION_CALLBACKS_H
+#define HALIDE_INJECT_COMPLETION_CALLBACKS_H
+
+/** \file
+ * Defines the lowering pass that injects calls to halide_region_complete
+ * for Funcs scheduled with Func::notify_completion.
+ */
+
+#include <map>
+#include <string>
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** At the end of each iteration of the loop each Func with a
+ * completion level is scheduled to notify completion at, call
+ * halide_region_complete with the region of the Func the iteration
+ * provided. Must be done before storage flattening, while the
+ * Provide nodes still exist. */
+Stmt inject_completion_callbacks(const Stmt &s, const std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -6,6 +6,7 @@
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
+#include "Scope.h"
 #include "Substitute.h"
 
 #include <map>
@@ -149,8 +150,16 @@ class InjectBufferCopiesForSingleBuffer : public IRMutator {
 
     const bool is_external;
 
+    // Whether the buffer holds the result of a memoized Func, in which
+    // case the memoization cache may own its device allocation.
+    const bool is_memoized;
+
     MemoryType memory_type;
 
+    // If defined, the region of the buffer that is ever read, in which
+    // case only that region is copied between host and device.
+    Region region;
+
     enum FlagState {
         Unknown,
         False,
@@ -191,13 +200,34 @@ class InjectBufferCopiesForSingleBuffer : public IRMutator {
         return device_malloc;
     }
 
-    Stmt make_copy_to_host() {
-        return call_extern_and_assert("halide_copy_to_host", {buffer_var()});
+    // The mins and extents of the region to copy, as pointers to
+    // arrays of int32.
+    std::pair<Expr, Expr> region_arrays() {
+        vector<Expr> mins, extents;
+        for (const Range &r : region) {
+            mins.push_back(r.min);
+            extents.push_back(r.extent);
+        }
+        return {Call::make(type_of<int *>(), Call::make_struct, mins, Call::Intrinsic),
+                Call::make(type_of<int *>(), Call::make_struct, extents, Call::Intrinsic)};
+    }
+
+    Stmt make_copy_to_host(bool whole_buffer) {
+        if (region.empty() || whole_buffer) {
+            return call_extern_and_assert("halide_copy_to_host", {buffer_var()});
+        }
+        auto [mins, extents] = region_arrays();
+        return call_extern_and_assert("halide_copy_region_to_host", {buffer_var(), mins, extents});
     }
 
     Stmt make_copy_to_device(DeviceAPI target_device_api) {
         Expr device_interface = make_device_interface_call(target_device_api, memory_type);
-        return call_extern_and_assert("halide_copy_to_device", {buffer_var(), device_interface});
+        if (region.empty()) {
+            return call_extern_and_assert("halide_copy_to_device", {buffer_var(), device_interface});
+        }
+        auto [mins, extents] = region_arrays();
+        return call_extern_and_assert("halide_copy_region_to_device",
+                                      {buffer_var(), device_interface, mins, extents});
     }
 
     Stmt make_host_dirty() {
@@ -211,7 +241,8 @@ class InjectBufferCopiesForSingleBuffer : public IRMutator {
     }
 
     Stmt make_device_free() {
-        return call_extern_and_assert("halide_device_free", {buffer_var()});
+        return call_extern_and_assert(is_memoized ? "halide_memoization_cache_release_device" : "halide_device_free",
+                                      {buffer_var()});
     }
 
     Stmt do_copies(Stmt s) {
@@ -275,7 +306,9 @@ class InjectBufferCopiesForSingleBuffer : public IRMutator {
 
         // Then do it, updating what we know about the buffer
         if (needs_copy_to_host) {
-            stmts.push_back(make_copy_to_host());
+            // A device flip frees the device allocation afterwards, so
+            // it must move the whole buffer.
+            stmts.push_back(make_copy_to_host(needs_device_flip));
             state.device_dirty = False;
         }
 
@@ -288,6 +321,10 @@ class InjectBufferCopiesForSingleBuffer : public IRMutator {
             state.device_dirty = False;
         }
 
+        // Copies go just before the first leaf that needs them, rather
+        // than being hoisted, so that a runtime that queues uploads on
+        // their own stream (see halide_cuda_use_copy_stream) can run
+        // them while the kernels of earlier leaves are still running.
         if (needs_copy_to_device) {
             stmts.push_back(make_copy_to_device(touching_device));
             state.host_dirty = False;
@@ -422,8 +459,8 @@ class InjectBufferCopiesForSingleBuffer : public IRMutator {
     }
 
 public:
-    InjectBufferCopiesForSingleBuffer(const std::string &b, bool e, MemoryType m)
-        : buffer(b), is_external(e), memory_type(m) {
+    InjectBufferCopiesForSingleBuffer(const std::string &b, bool e, MemoryType m, Region r = Region(), bool memoized = false)
+        : buffer(b), is_external(e), is_memoized(memoized), memory_type(m), region(std::move(r)) {
         if (is_external) {
             // The state of the buffer is totally unknown, which is
             // the default constructor for this->state
@@ -519,7 +556,7 @@ class InjectBufferCopies : public IRMutator {
                 Expr buf = Variable::make(type_of<struct halide_buffer_t *>(), buffer);
                 Stmt destructor =
                     Evaluate::make(Call::make(Handle(), Call::register_destructor,
-                                              {Expr("halide_device_free_as_destructor"), buf}, Call::Intrinsic));
+                                              {Expr(destructor_name), buf}, Call::Intrinsic));
                 Stmt body = Block::make(destructor, op->body);
                 return LetStmt::make(op->name, op->value, body);
             } else {
@@ -527,11 +564,11 @@ class InjectBufferCopies : public IRMutator {
             }
         }
 
-        string buffer;
+        string buffer, destructor_name;
 
     public:
-        InjectDeviceDestructor(string b)
-            : buffer(std::move(b)) {
+        InjectDeviceDestructor(string b, string d)
+            : buffer(std::move(b)), destructor_name(std::move(d)) {
         }
     };
 
@@ -625,9 +662,14 @@ class InjectBufferCopies : public IRMutator {
             return IRMutator::visit(op);
         }
 
+        // The memoization cache provides the host memory of the
+        // result of a memoized Func, and keeps any device allocation
+        // made for it, so that later cache hits can use it in place.
+        const bool memoized = op->free_function == "halide_memoization_cache_release";
+
         Stmt body = mutate(op->body);
 
-        InjectBufferCopiesForSingleBuffer injector(op->name, false, op->memory_type);
+        InjectBufferCopiesForSingleBuffer injector(op->name, false, op->memory_type, Region(), memoized);
         body = injector.mutate(body);
 
         string buffer_name = op->name + ".buffer";
@@ -635,7 +677,7 @@ class InjectBufferCopies : public IRMutator {
 
         // Device what type of allocation to make.
 
-        if (touched_on_host && finder.devices_touched.size() == 2) {
+        if (touched_on_host && finder.devices_touched.size() == 2 && !memoized) {
             // Touched on a single device and the host. Use a combined allocation.
             DeviceAPI touching_device = DeviceAPI::None;
             for (DeviceAPI d : finder.devices_touched) {
@@ -666,21 +708,24 @@ class InjectBufferCopies : public IRMutator {
             // devices. Do separate device and host allocations.
 
             // Add a device destructor
-            body = InjectDeviceDestructor(buffer_name).mutate(body);
+            body = InjectDeviceDestructor(buffer_name,
+                                          memoized ? "halide_memoization_cache_release_device_as_destructor" : "halide_device_free_as_destructor")
+                       .mutate(body);
 
             // Make a device_free stmt
 
             FindLastUse last_use(op->name);
             body.accept(&last_use);
             if (last_use.last_use.defined()) {
-                Stmt device_free = call_extern_and_assert("halide_device_free", {buffer});
+                Stmt device_free = call_extern_and_assert(memoized ? "halide_memoization_cache_release_device" : "halide_device_free",
+                                                          {buffer});
                 FreeAfterLastUse free_injecter(last_use.last_use, device_free);
                 body = free_injecter.mutate(body);
                 internal_assert(free_injecter.success);
             }
 
             Expr condition = op->condition;
-            bool touched_on_one_device = !touched_on_host && finder.devices_touched.size() == 1 &&
+            bool touched_on_one_device = !memoized && !touched_on_host && finder.devices_touched.size() == 1 &&
                                          (finder.devices_touched_by_extern.empty() ||
                                           (finder.devices_touched_by_extern.size() == 1 &&
                                            *(finder.devices_touched.begin()) == *(finder.devices_touched_by_extern.begin())));
@@ -736,8 +781,17 @@ public:
 // Inject the buffer handling code for the inputs and outputs at the
 // appropriate site.
 class InjectBufferCopiesForInputsAndOutputs : public IRMutator {
+    using IRMutator::visit;
+
     Stmt site;
 
+    // Whether all the device APIs in use can crop device buffers, and
+    // so copy parts of them.
+    bool can_copy_regions;
+
+    // The lets enclosing the site.
+    Scope<> lets;
+
     // Find all references to external buffers.
     class FindInputsAndOutputs : public IRVisitor {
         using IRVisitor::visit;
@@ -746,6 +800,7 @@ class InjectBufferCopiesForInputsAndOutputs : public IRMutator {
             if (p.defined()) {
                 result.insert(p.name());
                 result_storage[p.name()] = p.memory_type();
+                result_dimensions[p.name()] = p.dimensions();
             }
         }
 
@@ -753,6 +808,7 @@ class InjectBufferCopiesForInputsAndOutputs : public IRMutator {
             if (b.defined()) {
                 result.insert(b.name());
                 result_storage[b.name()] = MemoryType::Auto;
+                result_dimensions[b.name()] = b.dimensions();
             }
         }
 
@@ -785,8 +841,42 @@ class InjectBufferCopiesForInputsAndOutputs : public IRMutator {
     public:
         set<string> result;
         std::map<string, MemoryType> result_storage;
+        std::map<string, int> result_dimensions;
     };
 
+    // The region of an input that is read by the pipeline, as computed
+    // by bounds inference, if only that region needs to be copied
+    // between host and device. Inputs that are written, or passed to
+    // extern stages, which may read all of them and change their dirty
+    // bits, are copied whole.
+    Region region_to_copy(const Stmt &s, const string &buf, int dimensions) {
+        if (!can_copy_regions || dimensions == 0) {
+            return Region();
+        }
+        FindBufferUsage usage(buf, DeviceAPI::Host);
+        s.accept(&usage);
+        if (!usage.devices_writing.empty() || !usage.devices_touched_by_extern.empty()) {
+            return Region();
+        }
+        Region region;
+        for (int i = 0; i < dimensions; i++) {
+            string min_name = buf + ".min." + std::to_string(i) + ".required";
+            string extent_name = buf + ".extent." + std::to_string(i) + ".required";
+            if (!lets.contains(min_name) || !lets.contains(extent_name)) {
+                // Simplified away, or never used by bounds inference.
+                return Region();
+            }
+            region.emplace_back(Variable::make(Int(32), min_name),
+                                Variable::make(Int(32), extent_name));
+        }
+        return region;
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        ScopedBinding<> bind(lets, op->name);
+        return IRMutator::visit(op);
+    }
+
 public:
     using IRMutator::mutate;
 
@@ -796,7 +886,10 @@ public:
             s.accept(&finder);
             Stmt new_stmt = s;
             for (const string &buf : finder.result) {
-                new_stmt = InjectBufferCopiesForSingleBuffer(buf, true, finder.result_storage.at(buf)).mutate(new_stmt);
+                Region region = region_to_copy(s, buf, finder.result_dimensions.at(buf));
+                new_stmt = InjectBufferCopiesForSingleBuffer(buf, true, finder.result_storage.at(buf),
+                                                             std::move(region))
+                               .mutate(new_stmt);
             }
             return new_stmt;
         } else {
@@ -804,8 +897,8 @@ public:
         }
     }
 
-    InjectBufferCopiesForInputsAndOutputs(Stmt s)
-        : site(std::move(s)) {
+    InjectBufferCopiesForInputsAndOutputs(Stmt s, bool can_copy_regions)
+        : site(std::move(s)), can_copy_regions(can_copy_regions) {
     }
 };
 
@@ -831,7 +924,9 @@ Stmt inject_host_dev_buffer_copies(Stmt s, const Target &t) {
     if (outermost.result.defined()) {
         // If the entire pipeline simplified away, or just dispatches
         // to another pipeline, there may be no outermost produce.
-        s = InjectBufferCopiesForInputsAndOutputs(outermost.result).mutate(s);
+        bool can_copy_regions = !t.has_feature(Target::OpenGLCompute) &&
+                                !t.has_feature(Target::HexagonDma);
+        s = InjectBufferCopiesForInputsAndOutputs(outermost.result, can_copy_regions).mutate(s);
     }
 
     return s;
@@ -0,0 +1,209 @@
+#include <set>
+
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "InterleaveTuples.h"
+#include "Scope.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The allocation of one element of a Tuple-valued Function that is
+// being interleaved.
+struct Element {
+    string func;
+    int index, count;
+
+    string first() const {
+        return func + ".0";
+    }
+};
+
+// Strip the suffix from the name of a halide_buffer_t that storage
+// flattening made for an allocation.
+string buffer_host(const string &name) {
+    if (ends_with(name, ".buffer")) {
+        return name.substr(0, name.size() - 7);
+    }
+    return name;
+}
+
+// Find the Functions that are used in some way other than loads and
+// stores of their elements, which would see the wrong layout.
+class FindUnsafeUses : public IRVisitor {
+    using IRVisitor::visit;
+
+    const map<string, Element> &elements;
+    Scope<> allocated;
+
+    void mark(const string &name) {
+        auto it = elements.find(name);
+        if (it != elements.end()) {
+            unsafe.insert(it->second.func);
+        }
+    }
+
+    void visit(const LetStmt *op) override {
+        if (op->name != buffer_host(op->name) &&
+            elements.count(buffer_host(op->name))) {
+            // The halide_buffer_t that storage flattening wraps
+            // around each allocation is fine as long as it's unused.
+            op->body.accept(this);
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Variable *op) override {
+        mark(buffer_host(op->name));
+    }
+
+    void visit(const Prefetch *op) override {
+        mark(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Allocate *op) override {
+        auto it = elements.find(op->name);
+        if (it == elements.end()) {
+            IRVisitor::visit(op);
+            return;
+        }
+        const Element &e = it->second;
+        if ((e.index > 0 && !allocated.contains(e.first())) ||
+            op->memory_type == MemoryType::GPUTexture ||
+            op->memory_type == MemoryType::AMXTile ||
+            op->memory_type == MemoryType::WMMAAccumulator) {
+            // The elements must be allocated together, in memory
+            // that's accessed with loads and stores.
+            unsafe.insert(e.func);
+        }
+        for (const Expr &extent : op->extents) {
+            extent.accept(this);
+        }
+        op->condition.accept(this);
+        ScopedBinding<> bind(allocated, op->name);
+        op->body.accept(this);
+    }
+
+public:
+    set<string> unsafe;
+
+    FindUnsafeUses(const map<string, Element> &elements)
+        : elements(elements) {
+    }
+};
+
+class InterleaveTuples : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, Element> &elements;
+
+    Stmt visit(const Allocate *op) override {
+        auto it = elements.find(op->name);
+        if (it == elements.end()) {
+            return IRMutator::visit(op);
+        }
+        const Element &e = it->second;
+        Stmt body = mutate(op->body);
+        if (e.index > 0) {
+            // This element lives in the allocation of the first one.
+            return body;
+        }
+        vector<Expr> extents = {e.count};
+        for (const Expr &extent : op->extents) {
+            extents.push_back(mutate(extent));
+        }
+        return Allocate::make(op->name, op->type, op->memory_type, extents,
+                              mutate(op->condition), body, op->new_expr,
+                              op->free_function, op->padding);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        if (op->name != buffer_host(op->name) &&
+            elements.count(buffer_host(op->name))) {
+            // It would describe the wrong layout, and it's unused.
+            return mutate(op->body);
+        }
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Load *op) override {
+        auto it = elements.find(op->name);
+        if (it == elements.end()) {
+            return IRMutator::visit(op);
+        }
+        const Element &e = it->second;
+        Expr index = mutate(op->index) * e.count + e.index;
+        return Load::make(op->type, e.first(), index, op->image, op->param,
+                          mutate(op->predicate), op->alignment * e.count + e.index);
+    }
+
+    Stmt visit(const Store *op) override {
+        auto it = elements.find(op->name);
+        if (it == elements.end()) {
+            return IRMutator::visit(op);
+        }
+        const Element &e = it->second;
+        Expr index = mutate(op->index) * e.count + e.index;
+        return Store::make(e.first(), mutate(op->value), index, op->param,
+                           mutate(op->predicate), op->alignment * e.count + e.index);
+    }
+
+public:
+    InterleaveTuples(const map<string, Element> &elements)
+        : elements(elements) {
+    }
+};
+
+}  // namespace
+
+Stmt interleave_tuple_storage(const Stmt &s, const map<string, Function> &env) {
+    map<string, Element> elements;
+    for (const auto &p : env) {
+        const Function &f = p.second;
+        if (!f.schedule().interleave_tuple() || f.outputs() < 2) {
+            continue;
+        }
+        for (const Type &t : f.output_types()) {
+            user_assert(t == f.output_types()[0])
+                << "Can't interleave the storage of " << f.name()
+                << ", because the elements of its Tuple don't all have the same type.\n";
+        }
+        for (int i = 0; i < f.outputs(); i++) {
+            elements[f.name() + "." + std::to_string(i)] = {f.name(), i, f.outputs()};
+        }
+    }
+    if (elements.empty()) {
+        return s;
+    }
+
+    FindUnsafeUses finder(elements);
+    s.accept(&finder);
+    for (const string &func : finder.unsafe) {
+        user_warning << "Not interleaving the storage of " << func
+                     << ", because its buffers are used directly (for example by an extern "
+                     << "stage, a copy to or from a device, or a prefetch).\n";
+        for (auto it = elements.begin(); it != elements.end();) {
+            if (it->second.func == func) {
+                it = elements.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    return InterleaveTuples(elements).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,32 @@
+#ifndef HALIDE_INTERLEAVE_TUPLES_H
+#define HALIDE_INTERLEAVE_TUPLES_H
+
+/** \file
+ * Defines the lowering pass that stores the elements of Tuple-valued
+ * Funcs interleaved in a single allocation.
+ */
+
+#include <map>
+#include <string>
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** After storage flattening, the elements of a Tuple-valued Function
+ * live in separate allocations named foo.0, foo.1, etc. For the
+ * Functions scheduled with Func::interleave_tuple, merge these into
+ * the allocation of foo.0, with element k of the value at flattened
+ * index i stored at i * n + k, where n is the number of
+ * elements. Vectorized accesses to the elements then become strided,
+ * and later passes turn them into dense loads and stores with
+ * interleaving shuffles. */
+Stmt interleave_tuple_storage(const Stmt &s, const std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,119 @@
+#include <iostream>
+
+#include "InternExprs.h"
+#include "IREquality.h"
+#include "IROperator.h"
+#include "IRMutator.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+// Replaces every Expr reached with its canonical node.
+class InternChildren : public IRMutator {
+    ExprInterner &interner;
+
+public:
+    using IRMutator::mutate;
+
+    InternChildren(ExprInterner &interner)
+        : interner(interner) {
+    }
+
+    Expr mutate(const Expr &e) override {
+        return interner.intern(e);
+    }
+};
+
+}  // namespace
+
+Expr ExprInterner::intern(const Expr &e) {
+    if (!e.defined()) {
+        return e;
+    }
+    auto it = memo.find(e.get());
+    if (it != memo.end()) {
+        return it->second;
+    }
+    // Intern the children and rebuild the node (if necessary) on top of
+    // them, then find the canonical version of the result.
+    InternChildren children(*this);
+    Expr result = canonicalize(children.IRMutator::mutate(e));
+    memo.emplace(e.get(), result);
+    seen.push_back(e);
+    return result;
+}
+
+Expr ExprInterner::canonicalize(const Expr &e) {
+    if (hashes.count(e.get())) {
+        return e;
+    }
+
+    // The children are canonical, so their hashes are already cached
+    // and this only hashes one level deep.
+    uint64_t h = hasher.hash(e);
+
+    std::vector<Expr> &bucket = table[h];
+    for (const Expr &c : bucket) {
+        // Likewise this only compares one level deep before hitting
+        // same_as.
+        if (equal(c, e)) {
+            hasher.forget(e);
+            return c;
+        }
+    }
+    bucket.push_back(e);
+    hashes.emplace(e.get(), h);
+    return e;
+}
+
+uint64_t ExprInterner::hash(const Expr &e) const {
+    auto it = hashes.find(e.get());
+    internal_assert(it != hashes.end()) << "Expr has not been interned: " << e << "\n";
+    return it->second;
+}
+
+Stmt intern_exprs(const Stmt &s) {
+    ExprInterner interner;
+    return InternChildren(interner).mutate(s);
+}
+
+void intern_exprs_test() {
+    Expr x = Variable::make(Int(32), "x");
+    Expr y = Variable::make(Int(32), "y");
+
+    ExprInterner interner;
+
+    // Structurally-equal trees built separately map to one node.
+    Expr a = interner.intern((x + y) * (x + y));
+    Expr b = interner.intern((x + y) * (x + y));
+    internal_assert(a.same_as(b));
+    internal_assert(interner.hash(a) == interner.hash(b));
+    internal_assert(interner.hash(a) == structural_hash((x + y) * (x + y)));
+
+    // The shared subexpression is shared in the result.
+    const Mul *mul = a.as<Mul>();
+    internal_assert(mul && mul->a.same_as(mul->b));
+
+    // x, y, x + y and the product.
+    internal_assert(interner.size() == 4) << interner.size() << "\n";
+
+    // Different trees stay different, even down to types and constants.
+    internal_assert(!interner.intern(x + 1).same_as(interner.intern(x + 2)));
+    internal_assert(!interner.intern(cast<float>(x)).same_as(interner.intern(cast<double>(x))));
+    internal_assert(!interner.intern(Variable::make(Int(16), "x")).same_as(interner.intern(x)));
+
+    // Interning a Stmt preserves its meaning.
+    Stmt s = Block::make(Evaluate::make((x + y) * 2), Evaluate::make((x + y) * 2));
+    Stmt t = intern_exprs(s);
+    internal_assert(equal(s, t));
+    const Block *block = t.as<Block>();
+    internal_assert(block &&
+                    block->first.as<Evaluate>()->value.same_as(block->rest.as<Evaluate>()->value));
+
+    std::cout << "intern_exprs test passed" << std::endl;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,68 @@
+#ifndef HALIDE_INTERN_EXPRS_H
+#define HALIDE_INTERN_EXPRS_H
+
+/** \file
+ * Defines a pass that hash-conses the expressions in some IR, so that
+ * structurally-equal subexpressions share a single node.
+ */
+
+#include <unordered_map>
+#include <vector>
+
+#include "Expr.h"
+#include "IREquality.h"
+
+namespace Halide {
+namespace Internal {
+
+/** A table of canonical Expr nodes. Every Expr returned by intern() is
+ * the unique representative of its structural equivalence class among
+ * the Exprs interned so far, so two interned Exprs are equal iff they
+ * are the same node, and equal() and graph_equal() on them return
+ * immediately. A structural hash is cached for each canonical node. */
+class ExprInterner {
+    // Canonical nodes, bucketed by structural hash.
+    std::unordered_map<uint64_t, std::vector<Expr>> table;
+
+    // The structural hash of each canonical node.
+    std::unordered_map<const IRNode *, uint64_t> hashes;
+
+    // Hashes new nodes, reusing the cached hashes of their children.
+    IRHasher hasher;
+
+    // The result of interning each node we have already seen, so that
+    // shared subgraphs of the input are only walked once.
+    std::unordered_map<const IRNode *, Expr> memo;
+
+    // Keeps the keys of memo alive.
+    std::vector<Expr> seen;
+
+    Expr canonicalize(const Expr &e);
+
+public:
+    /** Return the canonical node structurally equal to e. */
+    Expr intern(const Expr &e);
+
+    /** The cached structural hash of an Expr returned by intern(). This
+     * is the same as structural_hash(). */
+    uint64_t hash(const Expr &e) const;
+
+    /** The number of distinct canonical nodes. */
+    size_t size() const {
+        return hashes.size();
+    }
+};
+
+/** Hash-cons all the Exprs in a Stmt, so that structurally-equal
+ * subexpressions share nodes. This reduces the memory used by IR with
+ * much redundancy (e.g. after bounds inference), and makes subsequent
+ * equality tests between those subexpressions O(1). Lowering runs this
+ * after bounds inference if the environment variable HL_INTERN_IR is 1. */
+Stmt intern_exprs(const Stmt &s);
+
+void intern_exprs_test();
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
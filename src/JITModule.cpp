@@ -1,6 +1,10 @@
+#include <atomic>
 #include <cstdint>
+#include <iomanip>
+#include <limits>
 #include <mutex>
 #include <set>
+#include <sstream>
 #include <string>
 
 #ifdef _WIN32
@@ -16,6 +20,7 @@
 #include "CodeGen_Internal.h"
 #include "CodeGen_LLVM.h"
 #include "Debug.h"
+#include "IRPrinter.h"
 #include "JITModule.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Output.h"
@@ -295,44 +300,113 @@ public:
 
 }  // namespace
 
-JITModule::JITModule() {
-    jit_module = new JITModuleContents();
+// Compute the name under which a Module is stored in the on-disk JIT
+// cache. The key covers everything that influences the generated object:
+// the lowered IR (which already reflects the algorithm, the schedule and
+// any extern calls), the argument types, the target, any embedded
+// buffers, and the Halide and LLVM versions.
+std::string jit_cache_key(const Module &m) {
+    std::ostringstream key;
+    // Print floating-point constants exactly, so that pipelines differing
+    // only in a constant don't collide.
+    key << std::setprecision(std::numeric_limits<double>::max_digits10);
+#ifdef HALIDE_VERSION_MAJOR
+    key << "halide " << HALIDE_VERSION_MAJOR << "." << HALIDE_VERSION_MINOR << "." << HALIDE_VERSION_PATCH << "\n";
+#endif
+    key << "llvm " << LLVM_VERSION << "\n"
+        << "llvm_args " << get_env_variable("HL_LLVM_ARGS") << "\n"
+        << m << "\n";
+    for (const auto &f : m.functions()) {
+        for (const auto &arg : f.args) {
+            key << f.name << " arg " << arg.name << " " << (int)arg.kind << " " << arg.type << " " << (int)arg.dimensions << "\n";
+        }
+    }
+    std::string str = key.str();
+    for (const auto &b : m.buffers()) {
+        const char *data = (const char *)b.data();
+        str.append(data, data + b.size_in_bytes());
+    }
+    auto hash = llvm::SHA1::hash(llvm::ArrayRef<uint8_t>((const uint8_t *)str.data(), str.size()));
+    return llvm::toHex(hash, /*LowerCase*/ true);
 }
 
-JITModule::JITModule(const Module &m, const LoweredFunc &fn,
-                     const std::vector<JITModule> &dependencies) {
-    jit_module = new JITModuleContents();
-    std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, *jit_module->context));
-    std::vector<JITModule> deps_with_runtime = dependencies;
-    std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), m.target());
-    deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
-    compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime);
-    // If -time-passes is in HL_LLVM_ARGS, this will print llvm passes time statstics otherwise its no-op.
-    llvm::reportAndResetTimings();
-}
+namespace {
 
-void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
-                               const std::vector<JITModule> &dependencies,
-                               const std::vector<std::string> &requested_exports) {
+// Writes each object compiled by the JIT to the on-disk JIT cache. Lookups
+// are done before the llvm module is even generated, so this never
+// provides objects itself.
+class JITObjectCache : public llvm::ObjectCache {
+    const std::string path;
+
+public:
+    JITObjectCache(const std::string &path)
+        : path(path) {
+    }
+
+    void notifyObjectCompiled(const llvm::Module *m, llvm::MemoryBufferRef obj) override {
+        // Write to a temporary file and rename it into place, so that
+        // concurrent processes never see a partially-written object.
+        int fd = -1;
+        llvm::SmallString<256> tmp_path;
+        if (llvm::sys::fs::createUniqueFile(path + ".%%%%%%%%.tmp", fd, tmp_path)) {
+            debug(1) << "Unable to write to JIT cache " << path << "\n";
+            return;
+        }
+        {
+            llvm::raw_fd_ostream out(fd, /*shouldClose*/ true);
+            out << obj.getBuffer();
+        }
+        if (llvm::sys::fs::rename(tmp_path, path)) {
+            llvm::sys::fs::remove(tmp_path);
+            debug(1) << "Unable to write to JIT cache " << path << "\n";
+            return;
+        }
+        debug(1) << "Stored " << m->getModuleIdentifier() << " in JIT cache " << path << "\n";
+    }
+
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *) override {
+        return nullptr;
+    }
+};
+
+// Link either an llvm module or a previously-compiled object (from the
+// on-disk JIT cache) into a fresh LLJIT, resolving symbols against the
+// dependencies, and stash the results in contents. If object_cache is
+// non-null, the object compiled from the llvm module is passed to it. If
+// both are given, the object provides the code, and the llvm module just
+// the target options and static constructors and destructors.
+void link_jit_module(JITModuleContents &contents,
+                     std::unique_ptr<llvm::Module> m,
+                     std::unique_ptr<llvm::MemoryBuffer> object,
+                     llvm::ObjectCache *object_cache,
+                     const string &function_name, const Target &target,
+                     const std::vector<JITModule> &dependencies,
+                     const std::vector<std::string> &requested_exports) {
+    internal_assert(m || object);
 
     // Ensure that LLVM is initialized
     CodeGen_LLVM::initialize_llvm();
 
     // Make the execution engine
     debug(2) << "Creating new execution engine\n";
-    debug(2) << "Target triple: " << m->getTargetTriple() << "\n";
-    string error_string;
-
-    llvm::for_each(*m, set_function_attributes_from_halide_target_options);
 
+    llvm::Triple triple;
     llvm::TargetOptions options;
-    get_target_options(*m, options);
-
-    DataLayout initial_module_data_layout = m->getDataLayout();
-    string module_name = m->getModuleIdentifier();
+    string module_name;
+    if (m) {
+        debug(2) << "Target triple: " << m->getTargetTriple() << "\n";
+        llvm::for_each(*m, set_function_attributes_from_halide_target_options);
+        get_target_options(*m, options);
+        triple = llvm::Triple(m->getTargetTriple());
+        module_name = m->getModuleIdentifier();
+    } else {
+        // The code has already been generated, so only the triple matters.
+        triple = get_triple_for_target(target);
+        module_name = function_name;
+    }
 
     // Build TargetMachine
-    llvm::orc::JITTargetMachineBuilder tm_builder(llvm::Triple(m->getTargetTriple()));
+    llvm::orc::JITTargetMachineBuilder tm_builder(triple);
     tm_builder.setOptions(options);
     tm_builder.setCodeGenOptLevel(CodeGenOpt::Aggressive);
     if (target.arch == Target::Arch::RISCV) {
@@ -343,9 +417,9 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     internal_assert(tm) << llvm::toString(tm.takeError()) << "\n";
 
     DataLayout target_data_layout(tm.get()->createDataLayout());
-    if (initial_module_data_layout != target_data_layout) {
+    if (m && m->getDataLayout() != target_data_layout) {
         internal_error << "Warning: data layout mismatch between module ("
-                       << initial_module_data_layout.getStringRepresentation()
+                       << m->getDataLayout().getStringRepresentation()
                        << ") and what the execution engine expects ("
                        << target_data_layout.getStringRepresentation() << ")\n";
     }
@@ -353,7 +427,7 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     // Create LLJIT
     const auto compilerBuilder = [&](const llvm::orc::JITTargetMachineBuilder & /*jtmb*/)
         -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
-        return std::make_unique<llvm::orc::TMOwningSimpleCompiler>(std::move(*tm));
+        return std::make_unique<llvm::orc::TMOwningSimpleCompiler>(std::move(*tm), object_cache);
     };
 
     llvm::orc::LLJITBuilderState::ObjectLinkingLayerCreator linkerBuilder;
@@ -379,21 +453,27 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
                                   .setObjectLinkingLayerCreator(linkerBuilder)
                                   .create());
 
-    auto ctors = llvm::orc::getConstructors(*m);
+    // Halide pipelines don't have static constructors or destructors, so
+    // there are none to run for an object loaded from the JIT cache.
     llvm::orc::CtorDtorRunner ctorRunner(JIT->getMainJITDylib());
-    ctorRunner.add(ctors);
-
-    auto dtors = llvm::orc::getDestructors(*m);
     auto dtorRunner = std::make_unique<llvm::orc::CtorDtorRunner>(JIT->getMainJITDylib());
-    dtorRunner->add(dtors);
+    if (m) {
+        ctorRunner.add(llvm::orc::getConstructors(*m));
+        dtorRunner->add(llvm::orc::getDestructors(*m));
+    }
 
     // Resolve system symbols (like pthread, dl and others)
     auto gen = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(target_data_layout.getGlobalPrefix());
     internal_assert(gen) << llvm::toString(gen.takeError()) << "\n";
     JIT->getMainJITDylib().addGenerator(std::move(gen.get()));
 
-    llvm::orc::ThreadSafeModule tsm(std::move(m), std::move(jit_module->context));
-    auto err = JIT->addIRModule(std::move(tsm));
+    llvm::Error err = llvm::Error::success();
+    if (object) {
+        err = JIT->addObjectFile(std::move(object));
+    } else {
+        llvm::orc::ThreadSafeModule tsm(std::move(m), std::move(contents.context));
+        err = JIT->addIRModule(std::move(tsm));
+    }
     internal_assert(!err) << llvm::toString(std::move(err)) << "\n";
 
     // Resolve symbol dependencies
@@ -430,10 +510,10 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     debug(1) << "JIT compiling " << module_name
              << " for " << target.to_string() << "\n";
 
-    std::map<std::string, Symbol> exports;
+    std::map<std::string, JITModule::Symbol> exports;
 
-    Symbol entrypoint;
-    Symbol argv_entrypoint;
+    JITModule::Symbol entrypoint;
+    JITModule::Symbol argv_entrypoint;
     if (!function_name.empty()) {
         entrypoint = compile_and_get_function(*JIT, function_name);
         exports[function_name] = entrypoint;
@@ -449,13 +529,60 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     internal_assert(!err) << llvm::toString(std::move(err)) << "\n";
 
     // Stash the various objects that need to stay alive behind a reference-counted pointer.
-    jit_module->exports = exports;
-    jit_module->JIT = std::move(JIT);
-    jit_module->dtorRunner = std::move(dtorRunner);
-    jit_module->dependencies = dependencies;
-    jit_module->entrypoint = entrypoint;
-    jit_module->argv_entrypoint = argv_entrypoint;
-    jit_module->name = function_name;
+    contents.exports = exports;
+    contents.JIT = std::move(JIT);
+    contents.dtorRunner = std::move(dtorRunner);
+    contents.dependencies = dependencies;
+    contents.entrypoint = entrypoint;
+    contents.argv_entrypoint = argv_entrypoint;
+    contents.name = function_name;
+}
+}  // namespace
+
+JITModule::JITModule() {
+    jit_module = new JITModuleContents();
+}
+
+JITModule::JITModule(const Module &m, const LoweredFunc &fn,
+                     const std::vector<JITModule> &dependencies) {
+    jit_module = new JITModuleContents();
+
+    std::string cache_path;
+    const std::string cache_dir = JITSharedRuntime::get_jit_cache_dir();
+    if (!cache_dir.empty()) {
+        cache_path = cache_dir + "/" + jit_cache_key(m) + ".o";
+        auto object = llvm::MemoryBuffer::getFile(cache_path);
+        if (object) {
+            debug(1) << "Loading " << fn.name << " from JIT cache " << cache_path << "\n";
+            std::vector<JITModule> deps_with_runtime = dependencies;
+            std::vector<JITModule> shared_runtime = JITSharedRuntime::get(nullptr, m.target());
+            deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
+            link_jit_module(*jit_module, nullptr, std::move(*object), nullptr,
+                            fn.name, m.target(), deps_with_runtime, {});
+            return;
+        }
+    }
+
+    std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, *jit_module->context));
+    std::vector<JITModule> deps_with_runtime = dependencies;
+    std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), m.target());
+    deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
+    if (cache_path.empty()) {
+        compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime);
+    } else {
+        JITObjectCache object_cache(cache_path);
+        link_jit_module(*jit_module, std::move(llvm_module), nullptr, &object_cache,
+                        fn.name, m.target(), deps_with_runtime, {});
+    }
+    // If -time-passes is in HL_LLVM_ARGS, this will print llvm passes time statstics otherwise its no-op.
+    llvm::reportAndResetTimings();
+}
+
+void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
+                               const std::vector<JITModule> &dependencies,
+                               const std::vector<std::string> &requested_exports) {
+    link_jit_module(*jit_module, std::move(m), nullptr, nullptr,
+                    function_name, target, dependencies, requested_exports);
 }
 
 /*static*/
@@ -561,6 +688,14 @@ void JITModule::memoization_cache_set_size(int64_t size) const {
     }
 }
 
+void JITModule::memoization_cache_set_device_size(int64_t size) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_set_device_size");
+    if (f != exports().end()) {
+        (reinterpret_bits<void (*)(int64_t)>(f->second.address))(size);
+    }
+}
+
 void JITModule::memoization_cache_evict(uint64_t eviction_key) const {
     std::map<std::string, Symbol>::const_iterator f =
         exports().find("halide_memoization_cache_evict");
@@ -569,6 +704,32 @@ void JITModule::memoization_cache_evict(uint64_t eviction_key) const {
     }
 }
 
+void JITModule::memoization_cache_set_eviction_key_size(uint64_t eviction_key, int64_t size) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_set_eviction_key_size");
+    if (f != exports().end()) {
+        (reinterpret_bits<int (*)(uint64_t, int64_t)>(f->second.address))(eviction_key, size);
+    }
+}
+
+int64_t JITModule::memoization_cache_get_eviction_key_usage(uint64_t eviction_key) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_get_eviction_key_usage");
+    if (f != exports().end()) {
+        return (reinterpret_bits<int64_t (*)(uint64_t)>(f->second.address))(eviction_key);
+    }
+    return 0;
+}
+
+void JITModule::memoization_cache_get_stats(halide_memoization_cache_stats_t *stats) const {
+    *stats = halide_memoization_cache_stats_t{};
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_get_stats");
+    if (f != exports().end()) {
+        (reinterpret_bits<int (*)(halide_memoization_cache_stats_t *)>(f->second.address))(stats);
+    }
+}
+
 void JITModule::reuse_device_allocations(bool b) const {
     std::map<std::string, Symbol>::const_iterator f =
         exports().find("halide_reuse_device_allocations");
@@ -577,6 +738,23 @@ void JITModule::reuse_device_allocations(bool b) const {
     }
 }
 
+int JITModule::profiler_visit(halide_profiler_visitor_t visitor, void *arg) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_profiler_visit");
+    if (f != exports().end()) {
+        return (reinterpret_bits<int (*)(halide_profiler_visitor_t, void *)>(f->second.address))(visitor, arg);
+    }
+    return 0;
+}
+
+void JITModule::profiler_reset() const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_profiler_reset");
+    if (f != exports().end()) {
+        (reinterpret_bits<void (*)()>(f->second.address))();
+    }
+}
+
 bool JITModule::compiled() const {
     return jit_module->JIT != nullptr;
 }
@@ -610,6 +788,9 @@ void merge_handlers(JITHandlers &base, const JITHandlers &addins) {
     if (addins.custom_trace) {
         base.custom_trace = addins.custom_trace;
     }
+    if (addins.custom_region_complete) {
+        base.custom_region_complete = addins.custom_region_complete;
+    }
     if (addins.custom_get_symbol) {
         base.custom_get_symbol = addins.custom_get_symbol;
     }
@@ -628,6 +809,9 @@ void merge_handlers(JITHandlers &base, const JITHandlers &addins) {
     if (addins.custom_cuda_get_stream) {
         base.custom_cuda_get_stream = addins.custom_cuda_get_stream;
     }
+    if (addins.custom_jit_compile_report) {
+        base.custom_jit_compile_report = addins.custom_jit_compile_report;
+    }
 }
 
 void print_handler(JITUserContext *context, const char *msg) {
@@ -688,6 +872,15 @@ int32_t trace_handler(JITUserContext *context, const halide_trace_event_t *e) {
     }
 }
 
+int32_t region_complete_handler(JITUserContext *context, const char *func, int dimensions,
+                                const int32_t *min, const int32_t *extent) {
+    if (context && context->handlers.custom_region_complete) {
+        return context->handlers.custom_region_complete(context, func, dimensions, min, extent);
+    } else {
+        return active_handlers.custom_region_complete(context, func, dimensions, min, extent);
+    }
+}
+
 void *get_symbol_handler(const char *name) {
     return (*active_handlers.custom_get_symbol)(name);
 }
@@ -747,6 +940,34 @@ void adjust_module_ref_count(void *arg, int32_t count) {
 
 std::mutex shared_runtimes_mutex;
 
+std::atomic<bool> profiler_report_after_run{true};
+
+std::mutex jit_cache_dir_mutex;
+
+std::string &jit_cache_dir() {
+    // Guarded by jit_cache_dir_mutex
+    static std::string dir = get_env_variable("HL_JIT_CACHE_DIR");
+    return dir;
+}
+
+// Compute the name under which a shared runtime module is stored in the
+// on-disk JIT cache. Unlike pipelines, the runtime is only ever available
+// as an llvm module, so the key is a hash of its bitcode.
+std::string jit_runtime_cache_key(const llvm::Module &m, const Target &target) {
+    std::string str;
+    llvm::raw_string_ostream key(str);
+#ifdef HALIDE_VERSION_MAJOR
+    key << "halide " << HALIDE_VERSION_MAJOR << "." << HALIDE_VERSION_MINOR << "." << HALIDE_VERSION_PATCH << "\n";
+#endif
+    key << "llvm " << LLVM_VERSION << "\n"
+        << "llvm_args " << get_env_variable("HL_LLVM_ARGS") << "\n"
+        << "target " << target.to_string() << "\n";
+    llvm::WriteBitcodeToFile(m, key);
+    key.flush();
+    auto hash = llvm::SHA1::hash(llvm::ArrayRef<uint8_t>((const uint8_t *)str.data(), str.size()));
+    return "runtime_" + llvm::toHex(hash, /*LowerCase*/ true);
+}
+
 // The Halide runtime is broken up into pieces so that state can be
 // shared across JIT compilations that do not use the same target
 // options. At present, the split is into a MainShared module that
@@ -925,7 +1146,22 @@ JITModule &make_module(llvm::Module *for_module, Target target,
 
         std::vector<std::string> halide_exports(halide_exports_unique.begin(), halide_exports_unique.end());
 
-        runtime.compile_module(std::move(module), "", target, deps, halide_exports);
+        const std::string cache_dir = JITSharedRuntime::get_jit_cache_dir();
+        if (cache_dir.empty()) {
+            runtime.compile_module(std::move(module), "", target, deps, halide_exports);
+        } else {
+            const std::string cache_path = cache_dir + "/" + jit_runtime_cache_key(*module, target) + ".o";
+            auto object = llvm::MemoryBuffer::getFile(cache_path);
+            if (object) {
+                debug(1) << "Loading " << module_name << " from JIT cache " << cache_path << "\n";
+                link_jit_module(*runtime.jit_module, std::move(module), std::move(*object), nullptr,
+                                "", target, deps, halide_exports);
+            } else {
+                JITObjectCache object_cache(cache_path);
+                link_jit_module(*runtime.jit_module, std::move(module), nullptr, &object_cache,
+                                "", target, deps, halide_exports);
+            }
+        }
 
         if (runtime_kind == MainShared) {
             runtime_internal_handlers.custom_print =
@@ -949,6 +1185,9 @@ JITModule &make_module(llvm::Module *for_module, Target target,
             runtime_internal_handlers.custom_trace =
                 hook_function(runtime.exports(), "halide_set_custom_trace", trace_handler);
 
+            runtime_internal_handlers.custom_region_complete =
+                hook_function(runtime.exports(), "halide_set_custom_region_complete", region_complete_handler);
+
             runtime_internal_handlers.custom_get_symbol =
                 hook_function(runtime.exports(), "halide_set_custom_get_symbol", get_symbol_handler);
 
@@ -1117,6 +1356,34 @@ void JITSharedRuntime::populate_jit_handlers(JITUserContext *jit_user_context, c
     jit_user_context->handlers = merged;
 }
 
+void JITSharedRuntime::set_jit_cache_dir(const std::string &dir) {
+    if (!dir.empty()) {
+        std::error_code err = llvm::sys::fs::create_directories(dir);
+        user_assert(!err) << "Unable to create JIT cache directory " << dir << ": " << err.message() << "\n";
+    }
+    std::lock_guard<std::mutex> lock(jit_cache_dir_mutex);
+    jit_cache_dir() = dir;
+}
+
+std::string JITSharedRuntime::get_jit_cache_dir() {
+    std::lock_guard<std::mutex> lock(jit_cache_dir_mutex);
+    return jit_cache_dir();
+}
+
+int JITSharedRuntime::profiler_visit(halide_profiler_visitor_t visitor, void *arg) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).profiler_visit(visitor, arg);
+}
+
+void JITSharedRuntime::profiler_reset() {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).profiler_reset();
+}
+
+void JITSharedRuntime::set_profiler_report_after_run(bool b) {
+    profiler_report_after_run = b;
+}
+
 void JITSharedRuntime::release_all() {
     std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
 
@@ -1133,6 +1400,37 @@ JITHandlers JITSharedRuntime::set_default_handlers(const JITHandlers &handlers)
     return result;
 }
 
+Target JITSharedRuntime::select_target(const std::vector<Target> &targets) {
+    internal_assert(!targets.empty());
+    const Target &base_target = targets.back();
+    if (targets.size() == 1) {
+        return base_target;
+    }
+
+    std::vector<JITModule> runtime = get(nullptr, base_target);
+    internal_assert(!runtime.empty());
+    auto f = runtime.front().exports().find("halide_can_use_target_features");
+    internal_assert(f != runtime.front().exports().end());
+    auto can_use_target_features = reinterpret_bits<int (*)(int, const uint64_t *)>(f->second.address);
+
+    constexpr int kFeaturesWordCount = (Target::FeatureEnd + 63) / (sizeof(uint64_t) * 8);
+    for (const Target &target : targets) {
+        if (target == base_target) {
+            break;
+        }
+        uint64_t features[kFeaturesWordCount] = {0};
+        for (int i = 0; i < Target::FeatureEnd; ++i) {
+            if (target.has_feature((Target::Feature)i)) {
+                features[i >> 6] |= ((uint64_t)1) << (i & 63);
+            }
+        }
+        if (can_use_target_features(kFeaturesWordCount, features)) {
+            return target;
+        }
+    }
+    return base_target;
+}
+
 void JITSharedRuntime::memoization_cache_set_size(int64_t size) {
     std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
 
@@ -1142,11 +1440,31 @@ void JITSharedRuntime::memoization_cache_set_size(int64_t size) {
     }
 }
 
+void JITSharedRuntime::memoization_cache_set_device_size(int64_t size) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).memoization_cache_set_device_size(size);
+}
+
 void JITSharedRuntime::memoization_cache_evict(uint64_t eviction_key) {
     std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
     shared_runtimes(MainShared).memoization_cache_evict(eviction_key);
 }
 
+void JITSharedRuntime::memoization_cache_set_eviction_key_size(uint64_t eviction_key, int64_t size) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).memoization_cache_set_eviction_key_size(eviction_key, size);
+}
+
+int64_t JITSharedRuntime::memoization_cache_get_eviction_key_usage(uint64_t eviction_key) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    return shared_runtimes(MainShared).memoization_cache_get_eviction_key_usage(eviction_key);
+}
+
+void JITSharedRuntime::memoization_cache_get_stats(halide_memoization_cache_stats_t *stats) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).memoization_cache_get_stats(stats);
+}
+
 void JITSharedRuntime::reuse_device_allocations(bool b) {
     std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
     shared_runtimes(MainShared).reuse_device_allocations(b);
@@ -1201,7 +1519,8 @@ int JITCache::call_jit_code(const Target &target, const void *const *args) {
 
 void JITCache::finish_profiling(JITUserContext *context) {
     // If we're profiling, report runtimes and reset profiler stats.
-    if (jit_target.has_feature(Target::Profile) || jit_target.has_feature(Target::ProfileByTimer)) {
+    if ((jit_target.has_feature(Target::Profile) || jit_target.has_feature(Target::ProfileByTimer)) &&
+        profiler_report_after_run) {
         JITModule::Symbol report_sym = jit_module.find_symbol_by_name("halide_profiler_report");
         JITModule::Symbol reset_sym = jit_module.find_symbol_by_name("halide_profiler_reset");
         if (report_sym.address && reset_sym.address) {
@@ -1270,7 +1589,8 @@ JITFuncCallContext::JITFuncCallContext(JITUserContext *context, const JITHandler
              << "custom_do_task: " << (void *)context->handlers.custom_do_task << "\n"
              << "custom_do_par_for: " << (void *)context->handlers.custom_do_par_for << "\n"
              << "custom_error: " << (void *)context->handlers.custom_error << "\n"
-             << "custom_trace: " << (void *)context->handlers.custom_trace << "\n";
+             << "custom_trace: " << (void *)context->handlers.custom_trace << "\n"
+             << "custom_region_complete: " << (void *)context->handlers.custom_region_complete << "\n";
 }
 
 void JITFuncCallContext::finalize(int exit_status) {
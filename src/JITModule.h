@@ -28,6 +28,41 @@ class Module;
 
 struct JITUserContext;
 
+/** Counters describing how often Pipeline::compile_jit (and so
+ * realize) recompiled a Pipeline rather than reusing its cached code,
+ * and how long compiling took. See Pipeline::jit_compile_stats. */
+struct JITCompileStats {
+    /** Why previously compiled code was thrown away. */
+    enum InvalidationCause {
+        CacheInvalidated,             ///< invalidate_cache() was called, e.g. by scheduling or redefining a Func
+        TargetChanged,                ///< compile_jit was called for a different Target
+        JITExternsChanged,            ///< set_jit_externs was called
+        CustomLoweringPassesChanged,  ///< A custom lowering pass was added or removed
+        ScheduleLoaded,               ///< apply_autoscheduler loaded a schedule from the database
+        NumInvalidationCauses,
+    };
+
+    /** The number of times compile_jit compiled, and the number of
+     * times it found code already compiled for the target. */
+    uint64_t compiles = 0, cache_hits = 0;
+
+    /** Compile time in seconds, in total and split into lowering to a
+     * Module and generating and linking the machine code, and the
+     * time taken by the most recent compile. */
+    double compile_seconds = 0, lowering_seconds = 0, codegen_seconds = 0, last_compile_seconds = 0;
+
+    /** A histogram of compile times. Bucket zero counts compiles of
+     * under a millisecond, bucket i counts compiles of [2^(i-1),
+     * 2^i) milliseconds, and the last bucket counts all the longer
+     * ones. */
+    static constexpr int num_histogram_buckets = 20;
+    uint64_t compile_time_histogram[num_histogram_buckets] = {};
+
+    /** The number of times compiled code was discarded, indexed by
+     * InvalidationCause. */
+    uint64_t invalidations[NumInvalidationCauses] = {};
+};
+
 /** A set of custom overrides of runtime functions. These only apply
  * when JIT-compiling code. If you are doing AOT compilation, see
  * HalideRuntime.h for instructions on how to replace runtime
@@ -94,6 +129,11 @@ struct JITHandlers {
      * Func. */
     int32_t (*custom_trace)(JITUserContext *, const halide_trace_event_t *){nullptr};
 
+    /** A custom routine to call each time a region of a Func
+     * scheduled with Func::notify_completion is complete. See
+     * halide_region_complete in HalideRuntime.h. */
+    int32_t (*custom_region_complete)(JITUserContext *, const char *, int, const int32_t *, const int32_t *){nullptr};
+
     /** A method to use for Halide to resolve symbol names dynamically
      * in the calling process or library from within the Halide
      * runtime. Equivalent to dlsym with a null first argument. */
@@ -124,6 +164,13 @@ struct JITHandlers {
      * stream to use. The cuda context and stream are both modelled
      * as a void *, to avoid a dependence on the cuda headers. */
     int32_t (*custom_cuda_get_stream)(JITUserContext *user_context, void *cuda_context, void **stream_ptr){nullptr};
+
+    /** Called each time a Pipeline is JIT-compiled (but not when its
+     * cached code is reused), with the name of the pipeline and its
+     * updated JITCompileStats. Unlike the other handlers, this is
+     * called by the compiler rather than the runtime, so it is only
+     * taken from the Pipeline's handlers and the default handlers. */
+    void (*custom_jit_compile_report)(const char *pipeline_name, const JITCompileStats &stats){nullptr};
 };
 
 namespace Internal {
@@ -241,12 +288,30 @@ struct JITModule {
     /** See JITSharedRuntime::memoization_cache_set_size */
     void memoization_cache_set_size(int64_t size) const;
 
+    /** See JITSharedRuntime::memoization_cache_set_device_size */
+    void memoization_cache_set_device_size(int64_t size) const;
+
     /** See JITSharedRuntime::memoization_cache_evict */
     void memoization_cache_evict(uint64_t eviction_key) const;
 
+    /** See JITSharedRuntime::memoization_cache_set_eviction_key_size */
+    void memoization_cache_set_eviction_key_size(uint64_t eviction_key, int64_t size) const;
+
+    /** See JITSharedRuntime::memoization_cache_get_eviction_key_usage */
+    int64_t memoization_cache_get_eviction_key_usage(uint64_t eviction_key) const;
+
+    /** See JITSharedRuntime::memoization_cache_get_stats */
+    void memoization_cache_get_stats(halide_memoization_cache_stats_t *stats) const;
+
     /** See JITSharedRuntime::reuse_device_allocations */
     void reuse_device_allocations(bool) const;
 
+    /** See JITSharedRuntime::profiler_visit */
+    int profiler_visit(halide_profiler_visitor_t visitor, void *arg) const;
+
+    /** See JITSharedRuntime::profiler_reset */
+    void profiler_reset() const;
+
     /** Return true if compile_module has been called on this module. */
     bool compiled() const;
 };
@@ -258,12 +323,41 @@ public:
     static void populate_jit_handlers(JITUserContext *jit_user_context, const JITHandlers &handlers);
     static JITHandlers set_default_handlers(const JITHandlers &handlers);
 
+    /** Pick the first of the targets that can run on this machine, the
+     * same way the wrapper made by compile_multitarget does: each target
+     * but the last is checked with halide_can_use_target_features, and
+     * the last one is used if none of the others can be. The shared
+     * runtime is created for the last target if it doesn't exist yet, so
+     * the last target should be the most conservative one. */
+    static Target select_target(const std::vector<Target> &targets);
+
+    /** Set the directory in which the object code for JIT-compiled
+     * pipelines (or the linked wasm, for WebAssembly targets) and for
+     * the shared runtime is stored, so that later
+     * compilations (including those in other processes) that lower to
+     * the same code for the same target can skip LLVM code generation.
+     * The directory is created if it doesn't exist. An empty string
+     * disables the cache. Defaults to the value of HL_JIT_CACHE_DIR. */
+    static void set_jit_cache_dir(const std::string &dir);
+
+    /** Get the directory set by set_jit_cache_dir, or an empty string
+     * if the JIT cache is disabled. */
+    static std::string get_jit_cache_dir();
+
     /** Set the maximum number of bytes used by memoization caching.
      * If you are compiling statically, you should include HalideRuntime.h
      * and call halide_memoization_cache_set_size() instead.
      */
     static void memoization_cache_set_size(int64_t size);
 
+    /** Set the maximum number of bytes of device memory kept by the
+     * memoization cache for the results of memoized Funcs computed on
+     * a device. Zero restores the default. If you are compiling
+     * statically, you should include HalideRuntime.h and call
+     * halide_memoization_cache_set_device_size() instead.
+     */
+    static void memoization_cache_set_device_size(int64_t size);
+
     /** Evict all cache entries that were tagged with the given
      * eviction_key in the memoize scheduling directive. If you are
      * compiling statically, you should include HalideRuntime.h and
@@ -271,6 +365,28 @@ public:
      */
     static void memoization_cache_evict(uint64_t eviction_key);
 
+    /** Set a budget, in bytes, for the memoization cache entries
+     * tagged with the given eviction_key. Zero removes the budget. If
+     * you are compiling statically, you should include
+     * HalideRuntime.h and call
+     * halide_memoization_cache_set_eviction_key_size() instead.
+     */
+    static void memoization_cache_set_eviction_key_size(uint64_t eviction_key, int64_t size);
+
+    /** Get the bytes stored in the memoization cache by entries tagged
+     * with the given eviction_key. If you are compiling statically,
+     * you should include HalideRuntime.h and call
+     * halide_memoization_cache_get_eviction_key_usage() instead.
+     */
+    static int64_t memoization_cache_get_eviction_key_usage(uint64_t eviction_key);
+
+    /** Get hit, miss and eviction statistics for the memoization
+     * cache. If you are compiling statically, you should include
+     * HalideRuntime.h and call halide_memoization_cache_get_stats()
+     * instead.
+     */
+    static void memoization_cache_get_stats(halide_memoization_cache_stats_t *stats);
+
     /** Set whether or not Halide may hold onto and reuse device
      * allocations to avoid calling expensive device API allocation
      * functions. If you are compiling statically, you should include
@@ -278,11 +394,32 @@ public:
      * instead. */
     static void reuse_device_allocations(bool);
 
+    /** Call the visitor on the profiler stats of each JIT-compiled
+     * pipeline run with the profile target feature since the last
+     * reset. Returns zero if no profiled pipeline has been compiled.
+     * If you are compiling statically, you should include
+     * HalideRuntime.h and call halide_profiler_visit() instead. */
+    static int profiler_visit(halide_profiler_visitor_t visitor, void *arg);
+
+    /** Reset the profiler stats of all JIT-compiled pipelines. Must
+     * not be called while any of them is running. */
+    static void profiler_reset();
+
+    /** Set whether each run of a profiled JIT-compiled pipeline prints
+     * the profiler report and resets the profiler stats afterwards, as
+     * it does by default. Turn this off to accumulate stats over many
+     * runs and read them with profiler_visit. */
+    static void set_profiler_report_after_run(bool);
+
     static void release_all();
 };
 
 void *get_symbol_address(const char *s);
 
+/** Compute a content hash of a Module, naming it in the JIT cache
+ * directory set with JITSharedRuntime::set_jit_cache_dir. */
+std::string jit_cache_key(const Module &m);
+
 struct JITCache {
     Target jit_target;
     // Arguments for all inputs and outputs
@@ -5,9 +5,13 @@
 #include "CompilerLogger.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Runtime_Linker.h"
+#include "Util.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <thread>
 
 #ifdef _WIN32
 #ifndef NOMINMAX
@@ -338,15 +342,13 @@ std::unique_ptr<llvm::Module> clone_module(const llvm::Module &module_in) {
 
 }  // namespace
 
-void emit_file(const llvm::Module &module_in, Internal::LLVMOStream &out,
-               llvm::CodeGenFileType file_type) {
-    Internal::debug(1) << "emit_file.Compiling to native code...\n";
-    Internal::debug(2) << "Target triple: " << module_in.getTargetTriple() << "\n";
-
-    auto time_start = std::chrono::high_resolution_clock::now();
+namespace {
 
-    // Work on a copy of the module to avoid modifying the original.
-    std::unique_ptr<llvm::Module> module = clone_module(module_in);
+// Run the backend passes on module, writing the result to out. The
+// module is consumed. Safe to call concurrently on modules that belong
+// to different LLVMContexts.
+void run_codegen_passes(std::unique_ptr<llvm::Module> module, Internal::LLVMOStream &out,
+                        llvm::CodeGenFileType file_type) {
 
     // Get the target specific parser.
     auto target_machine = Internal::make_target_machine(*module);
@@ -404,18 +406,36 @@ void emit_file(const llvm::Module &module_in, Internal::LLVMOStream &out,
     target_machine->addPassesToEmitFile(pass_manager, out, nullptr, file_type);
 
     pass_manager.run(*module);
+}
+
+}  // namespace
+
+void emit_file(std::unique_ptr<llvm::Module> module, Internal::LLVMOStream &out,
+               llvm::CodeGenFileType file_type) {
+    Internal::debug(1) << "emit_file.Compiling to native code...\n";
+    Internal::debug(2) << "Target triple: " << module->getTargetTriple() << "\n";
+
+    auto time_start = std::chrono::high_resolution_clock::now();
+
+    run_codegen_passes(std::move(module), out, file_type);
 
     auto *logger = Internal::get_compiler_logger();
     if (logger) {
         auto time_end = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> diff = time_end - time_start;
-        logger->record_compilation_time(Internal::CompilerLogger::Phase::LLVM, diff.count());
+        logger->record_compilation_time(Internal::CompilerLogger::Phase::LLVMCodeGen, diff.count());
     }
 
     // If -time-passes is in HL_LLVM_ARGS, this will print llvm passes time statstics otherwise its no-op.
     llvm::reportAndResetTimings();
 }
 
+void emit_file(const llvm::Module &module_in, Internal::LLVMOStream &out,
+               llvm::CodeGenFileType file_type) {
+    // Work on a copy of the module to avoid modifying the original.
+    emit_file(clone_module(module_in), out, file_type);
+}
+
 std::unique_ptr<llvm::Module> compile_module_to_llvm_module(const Module &module, llvm::LLVMContext &context) {
     return codegen_llvm(module, context);
 }
@@ -424,6 +444,113 @@ void compile_llvm_module_to_object(llvm::Module &module, Internal::LLVMOStream &
     emit_file(module, out, llvm::CGFT_ObjectFile);
 }
 
+void compile_llvm_module_to_object(std::unique_ptr<llvm::Module> module, Internal::LLVMOStream &out) {
+    emit_file(std::move(module), out, llvm::CGFT_ObjectFile);
+}
+
+int get_llvm_codegen_threads() {
+    std::string threads = Internal::get_env_variable("HL_LLVM_CODEGEN_THREADS");
+    if (threads.empty()) {
+        return 1;
+    }
+    int n = std::atoi(threads.c_str());
+    if (n <= 0) {
+        n = (int)std::thread::hardware_concurrency();
+    }
+    return std::max(n, 1);
+}
+
+int compile_llvm_module_to_objects(llvm::Module &module, int num_parts,
+                                   const std::function<std::unique_ptr<llvm::raw_fd_ostream>(int)> &make_output) {
+    if (num_parts <= 1) {
+        auto out = make_output(0);
+        compile_llvm_module_to_object(module, *out);
+        return 1;
+    }
+
+    Internal::debug(1) << "compile_llvm_module_to_objects: splitting into " << num_parts << " parts\n";
+    auto time_start = std::chrono::high_resolution_clock::now();
+
+    // LLVMContexts are not thread-safe, so each part is serialized here
+    // and parsed back into a context of its own on its worker thread.
+    // SplitModule promotes any local symbol that is used across parts to
+    // a hidden global with a unique name.
+    std::vector<llvm::SmallVector<char, 0>> parts;
+    {
+        std::unique_ptr<llvm::Module> to_split = clone_module(module);
+        llvm::SplitModule(
+            *to_split, num_parts,
+            [&](std::unique_ptr<llvm::Module> part) {
+                parts.emplace_back();
+                llvm::raw_svector_ostream os(parts.back());
+                WriteBitcodeToFile(*part, os);
+            },
+            /* PreserveLocals */ false);
+    }
+
+    std::vector<std::unique_ptr<llvm::raw_fd_ostream>> outs;
+    for (size_t i = 0; i < parts.size(); i++) {
+        outs.push_back(make_output((int)i));
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < parts.size(); i++) {
+        threads.emplace_back([&, i]() {
+            llvm::LLVMContext context;
+            llvm::MemoryBufferRef buffer_ref(llvm::StringRef(parts[i].data(), parts[i].size()), "split_module");
+            auto part = llvm::parseBitcodeFile(buffer_ref, context);
+            internal_assert(part) << "Could not parse split module " << i << "\n";
+            run_codegen_passes(std::move(part.get()), *outs[i], llvm::CGFT_ObjectFile);
+            outs[i]->flush();
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    auto *logger = Internal::get_compiler_logger();
+    if (logger) {
+        auto time_end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> diff = time_end - time_start;
+        logger->record_compilation_time(Internal::CompilerLogger::Phase::LLVMCodeGen, diff.count());
+    }
+    llvm::reportAndResetTimings();
+
+    return (int)parts.size();
+}
+
+std::map<std::string, uint64_t> get_object_function_sizes(const std::vector<std::string> &object_files) {
+    std::map<std::string, uint64_t> sizes;
+    for (const auto &f : object_files) {
+        auto buffer = llvm::MemoryBuffer::getFile(f);
+        if (!buffer) {
+            continue;
+        }
+        auto obj = llvm::object::ObjectFile::createObjectFile((*buffer)->getMemBufferRef());
+        if (!obj) {
+            llvm::consumeError(obj.takeError());
+            continue;
+        }
+        for (const auto &it : llvm::object::computeSymbolSizes(**obj)) {
+            const llvm::object::SymbolRef &sym = it.first;
+            auto type = sym.getType();
+            auto flags = sym.getFlags();
+            auto name = sym.getName();
+            if (!type || !flags || !name) {
+                llvm::consumeError(type.takeError());
+                llvm::consumeError(flags.takeError());
+                llvm::consumeError(name.takeError());
+                continue;
+            }
+            if (*type == llvm::object::SymbolRef::ST_Function &&
+                !(*flags & llvm::object::SymbolRef::SF_Undefined)) {
+                sizes[name->str()] += it.second;
+            }
+        }
+    }
+    return sizes;
+}
+
 void compile_llvm_module_to_assembly(llvm::Module &module, Internal::LLVMOStream &out) {
     emit_file(module, out, llvm::CGFT_AssemblyFile);
 }
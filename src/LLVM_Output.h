@@ -5,6 +5,8 @@
  *
  */
 
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -39,6 +41,31 @@ void compile_llvm_module_to_object(llvm::Module &module, Internal::LLVMOStream &
 void compile_llvm_module_to_assembly(llvm::Module &module, Internal::LLVMOStream &out);
 // @}
 
+/** Compile an LLVM module to a native object, consuming it. This saves
+ * the copy of the module that the version above makes, which can be a
+ * large part of peak memory use for big pipelines. */
+void compile_llvm_module_to_object(std::unique_ptr<llvm::Module> module, Internal::LLVMOStream &out);
+
+/** Compile an LLVM module to native object code split into up to
+ * num_parts objects, which are code-generated in parallel on a thread
+ * each. make_output is called (on the calling thread) with the index of
+ * each part to get the stream to write it to. Returns the number of
+ * parts produced. The parts reference each other's symbols, so they
+ * must all be linked together, e.g. by placing them in the same static
+ * library. */
+int compile_llvm_module_to_objects(llvm::Module &module, int num_parts,
+                                   const std::function<std::unique_ptr<llvm::raw_fd_ostream>(int)> &make_output);
+
+/** The number of threads to use for LLVM code generation of static
+ * libraries, from the environment variable HL_LLVM_CODEGEN_THREADS (0
+ * means one per core). Defaults to 1. */
+int get_llvm_codegen_threads();
+
+/** Get the size in bytes of each function defined in the given
+ * object files, keyed by symbol name. Objects that can't be parsed
+ * are skipped. */
+std::map<std::string, uint64_t> get_object_function_sizes(const std::vector<std::string> &object_files);
+
 /** Compile an LLVM module to LLVM targets (bitcode, LLVM assembly). */
 // @{
 void compile_llvm_module_to_llvm_bitcode(llvm::Module &module, Internal::LLVMOStream &out);
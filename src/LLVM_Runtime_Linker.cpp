@@ -2,6 +2,11 @@
 #include "Error.h"
 #include "LLVM_Headers.h"
 #include "Target.h"
+#include "Util.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
 
 namespace Halide {
 
@@ -27,13 +32,33 @@ std::unique_ptr<llvm::Module> parse_bitcode_file(llvm::StringRef buf, llvm::LLVM
     return result;
 }
 
-#define DECLARE_INITMOD(mod)                                                              \
-    extern "C" unsigned char halide_internal_initmod_##mod[];                             \
-    extern "C" int halide_internal_initmod_##mod##_length;                                \
-    std::unique_ptr<llvm::Module> get_initmod_##mod(llvm::LLVMContext *context) {         \
-        llvm::StringRef sb = llvm::StringRef((const char *)halide_internal_initmod_##mod, \
-                                             halide_internal_initmod_##mod##_length);     \
-        return parse_bitcode_file(sb, context, #mod);                                     \
+// Every embedded runtime module, so that the on-disk cache of initial
+// modules can tell whether it was written by a build of Halide with the
+// same runtime.
+struct InitmodBlob {
+    const unsigned char *data;
+    const int *length;
+};
+
+std::vector<InitmodBlob> &all_initmod_blobs() {
+    static std::vector<InitmodBlob> blobs;
+    return blobs;
+}
+
+bool register_initmod_blob(const unsigned char *data, const int *length) {
+    all_initmod_blobs().push_back({data, length});
+    return true;
+}
+
+#define DECLARE_INITMOD(mod)                                                                       \
+    extern "C" unsigned char halide_internal_initmod_##mod[];                                      \
+    extern "C" int halide_internal_initmod_##mod##_length;                                         \
+    [[maybe_unused]] const bool initmod_##mod##_registered =                                       \
+        register_initmod_blob(halide_internal_initmod_##mod, &halide_internal_initmod_##mod##_length); \
+    std::unique_ptr<llvm::Module> get_initmod_##mod(llvm::LLVMContext *context) {                  \
+        llvm::StringRef sb = llvm::StringRef((const char *)halide_internal_initmod_##mod,          \
+                                             halide_internal_initmod_##mod##_length);              \
+        return parse_bitcode_file(sb, context, #mod);                                              \
     }
 
 #define DECLARE_NO_INITMOD(mod)                                                                                         \
@@ -88,6 +113,9 @@ DECLARE_CPP_INITMOD(destructors)
 DECLARE_CPP_INITMOD(device_interface)
 DECLARE_CPP_INITMOD(errors)
 DECLARE_CPP_INITMOD(fake_get_symbol)
+DECLARE_CPP_INITMOD(fake_futex)
+DECLARE_CPP_INITMOD(fake_host_memory)
+DECLARE_CPP_INITMOD(fake_thread_affinity)
 DECLARE_CPP_INITMOD(fake_thread_pool)
 DECLARE_CPP_INITMOD(float16_t)
 DECLARE_CPP_INITMOD(fopen)
@@ -104,7 +132,10 @@ DECLARE_CPP_INITMOD(hexagon_dma_pool)
 DECLARE_CPP_INITMOD(hexagon_host)
 DECLARE_CPP_INITMOD(ios_io)
 DECLARE_CPP_INITMOD(linux_clock)
+DECLARE_CPP_INITMOD(linux_futex)
 DECLARE_CPP_INITMOD(linux_host_cpu_count)
+DECLARE_CPP_INITMOD(linux_host_memory)
+DECLARE_CPP_INITMOD(linux_thread_affinity)
 DECLARE_CPP_INITMOD(linux_yield)
 DECLARE_CPP_INITMOD(module_aot_ref_count)
 DECLARE_CPP_INITMOD(module_jit_ref_count)
@@ -140,6 +171,7 @@ DECLARE_CPP_INITMOD(qurt_threads)
 DECLARE_CPP_INITMOD(qurt_threads_tsan)
 DECLARE_CPP_INITMOD(qurt_yield)
 DECLARE_CPP_INITMOD(runtime_api)
+DECLARE_CPP_INITMOD(timeline)
 DECLARE_CPP_INITMOD(timer_profiler)
 DECLARE_CPP_INITMOD(to_string)
 DECLARE_CPP_INITMOD(trace_helper)
@@ -157,6 +189,7 @@ DECLARE_CPP_INITMOD(windows_profiler)
 DECLARE_CPP_INITMOD(windows_threads)
 DECLARE_CPP_INITMOD(windows_threads_tsan)
 DECLARE_CPP_INITMOD(windows_yield)
+DECLARE_CPP_INITMOD(workspace)
 DECLARE_CPP_INITMOD(write_debug_image)
 
 // Universal LL Initmods. Please keep sorted alphabetically.
@@ -657,6 +690,71 @@ void link_modules(std::vector<std::unique_ptr<llvm::Module>> &modules, Target t,
     }
 }
 
+// Assembling the initial module for a target links together dozens of
+// runtime modules, and is the same work every time. Each process keeps
+// the bitcode of the initial module for each kind of module and target
+// it has seen, which is much cheaper to parse than to re-link. If
+// HL_RUNTIME_CACHE_DIR is set, they are also kept there for other
+// processes.
+struct InitialModuleCache {
+    struct Entry {
+        std::string id;
+        llvm::SmallVector<char, 0> bitcode;
+    };
+    std::mutex mutex;
+    // Entries are immutable once added, so that they can be parsed
+    // without holding the mutex.
+    std::map<std::string, std::shared_ptr<const Entry>> entries;
+};
+
+InitialModuleCache &initial_module_cache() {
+    static InitialModuleCache cache;
+    return cache;
+}
+
+// A hash of everything that goes into an initial module other than the
+// target: the versions of Halide and LLVM, and the embedded runtime.
+const std::string &runtime_fingerprint() {
+    static const std::string fingerprint = []() {
+        llvm::SHA1 hasher;
+#ifdef HALIDE_VERSION_MAJOR
+        hasher.update(std::to_string(HALIDE_VERSION_MAJOR) + "." +
+                      std::to_string(HALIDE_VERSION_MINOR) + "." +
+                      std::to_string(HALIDE_VERSION_PATCH));
+#endif
+        hasher.update("llvm " + std::to_string(LLVM_VERSION));
+        for (const InitmodBlob &blob : all_initmod_blobs()) {
+            hasher.update(llvm::ArrayRef<uint8_t>(blob.data, *blob.length));
+        }
+        return llvm::toHex(hasher.final(), /*LowerCase*/ true);
+    }();
+    return fingerprint;
+}
+
+std::string initial_module_cache_path(const std::string &dir, const std::string &key) {
+    std::string str = runtime_fingerprint() + "\n" + key;
+    auto hash = llvm::SHA1::hash(llvm::ArrayRef<uint8_t>((const uint8_t *)str.data(), str.size()));
+    return dir + "/runtime_" + llvm::toHex(hash, /*LowerCase*/ true) + ".bc";
+}
+
+void write_initial_module_cache_file(const std::string &path, const llvm::SmallVector<char, 0> &bitcode) {
+    // Write to a temporary file and rename it into place, so that
+    // concurrent processes never see a partially-written module.
+    int fd = -1;
+    llvm::SmallString<256> tmp_path;
+    if (llvm::sys::fs::createUniqueFile(path + ".%%%%%%%%.tmp", fd, tmp_path)) {
+        Internal::debug(1) << "Unable to write to runtime cache " << path << "\n";
+        return;
+    }
+    {
+        llvm::raw_fd_ostream out(fd, /* shouldClose */ true);
+        out.write(bitcode.data(), bitcode.size());
+    }
+    if (llvm::sys::fs::rename(tmp_path, path)) {
+        llvm::sys::fs::remove(tmp_path);
+    }
+}
+
 }  // namespace
 
 namespace Internal {
@@ -754,6 +852,7 @@ std::unique_ptr<llvm::Module> link_with_wasm_jit_runtime(llvm::LLVMContext *c, c
     modules.push_back(get_initmod_fake_thread_pool(c, bits_64, debug));
     modules.push_back(get_initmod_posix_aligned_alloc(c, bits_64, debug));
     modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
+    modules.push_back(get_initmod_fake_host_memory(c, bits_64, debug));
     modules.push_back(get_initmod_halide_buffer_t(c, bits_64, debug));
     modules.push_back(get_initmod_destructors(c, bits_64, debug));
     // These two aren't necessary, since they are 100% alwaysinline
@@ -779,7 +878,9 @@ std::unique_ptr<llvm::Module> link_with_wasm_jit_runtime(llvm::LLVMContext *c, c
 }
 
 /** Create an llvm module containing the support code for a given target. */
-std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+namespace {
+
+std::unique_ptr<llvm::Module> link_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
     enum InitialModuleType {
         ModuleAOT,
         ModuleAOTNoRuntime,
@@ -815,6 +916,11 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
     const auto add_allocator = [&]() {
         modules.push_back(get_initmod_posix_aligned_alloc(c, bits_64, debug));
         modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
+        if (t.os == Target::Linux && t.arch == Target::X86) {
+            modules.push_back(get_initmod_linux_host_memory(c, bits_64, debug));
+        } else {
+            modules.push_back(get_initmod_fake_host_memory(c, bits_64, debug));
+        }
     };
 
     if (module_type != ModuleGPU) {
@@ -832,6 +938,12 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 }
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_linux_thread_affinity(c, bits_64, debug));
+                if (t.arch == Target::X86) {
+                    modules.push_back(get_initmod_linux_futex(c, bits_64, debug));
+                } else {
+                    modules.push_back(get_initmod_fake_futex(c, bits_64, debug));
+                }
                 modules.push_back(get_initmod_linux_yield(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -849,6 +961,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_linux_yield(c, bits_64, debug));
                 if (t.has_feature(Target::WasmThreads)) {
                     // Assume that the wasm libc will be providing pthreads
+                    modules.push_back(get_initmod_fake_thread_affinity(c, bits_64, debug));
+                    modules.push_back(get_initmod_fake_futex(c, bits_64, debug));
                     modules.push_back(get_initmod_posix_threads(c, bits_64, debug));
                 } else {
                     modules.push_back(get_initmod_fake_thread_pool(c, bits_64, debug));
@@ -861,6 +975,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_osx_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_thread_affinity(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_futex(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_yield(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -880,6 +996,12 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 }
                 modules.push_back(get_initmod_android_io(c, bits_64, debug));
                 modules.push_back(get_initmod_android_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_linux_thread_affinity(c, bits_64, debug));
+                if (t.arch == Target::X86) {
+                    modules.push_back(get_initmod_linux_futex(c, bits_64, debug));
+                } else {
+                    modules.push_back(get_initmod_fake_futex(c, bits_64, debug));
+                }
                 modules.push_back(get_initmod_linux_yield(c, bits_64, debug));  // TODO: verify
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -890,11 +1012,13 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             } else if (t.os == Target::Windows) {
                 modules.push_back(get_initmod_posix_aligned_alloc(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_host_memory(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_print(c, bits_64, debug));
                 modules.push_back(get_initmod_windows_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_windows_io(c, bits_64, debug));
                 modules.push_back(get_initmod_windows_yield(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_thread_affinity(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_windows_threads_tsan(c, bits_64, debug));
                 } else {
@@ -908,6 +1032,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_posix_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_ios_io(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_thread_affinity(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_futex(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_yield(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -918,6 +1044,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_posix_aligned_alloc(c, bits_64, debug));
                 modules.push_back(get_initmod_qurt_allocator(c, bits_64, debug));
                 modules.push_back(get_initmod_qurt_yield(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_thread_affinity(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_qurt_threads_tsan(c, bits_64, debug));
                 } else {
@@ -947,6 +1074,8 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_fuchsia_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_fuchsia_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_thread_affinity(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_futex(c, bits_64, debug));
                 modules.push_back(get_initmod_fuchsia_yield(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -984,6 +1113,11 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 // though...).
                 modules.push_back(get_initmod_tracing(c, bits_64, debug));
                 modules.push_back(get_initmod_trace_helper(c, bits_64, debug));
+                // The timeline needs a clock and thread ids, which
+                // bare-metal hosts don't have to provide.
+                if (t.os != Target::NoOS) {
+                    modules.push_back(get_initmod_timeline(c, bits_64, debug));
+                }
                 modules.push_back(get_initmod_write_debug_image(c, bits_64, debug));
 
                 // TODO: Support this module in the Hexagon backend,
@@ -1017,6 +1151,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             }
 
             modules.push_back(get_initmod_allocation_cache(c, bits_64, debug));
+            modules.push_back(get_initmod_workspace(c, bits_64, debug));
             modules.push_back(get_initmod_device_interface(c, bits_64, debug));
             modules.push_back(get_initmod_float16_t(c, bits_64, debug));
             modules.push_back(get_initmod_errors(c, bits_64, debug));
@@ -1263,6 +1398,58 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
     return std::move(modules[0]);
 }
 
+}  // namespace
+
+std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+    InitialModuleCache &cache = initial_module_cache();
+    const std::string key = t.to_string() +
+                            (for_shared_jit_runtime ? "/shared_jit_runtime" : "") +
+                            (just_gpu ? "/just_gpu" : "");
+    std::shared_ptr<const InitialModuleCache::Entry> cached;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto it = cache.entries.find(key);
+        if (it != cache.entries.end()) {
+            cached = it->second;
+        }
+    }
+    if (cached) {
+        // Parse outside the lock, so that pipelines being compiled on
+        // several threads at once don't take turns at it.
+        llvm::StringRef buf(cached->bitcode.data(), cached->bitcode.size());
+        return parse_bitcode_file(buf, c, cached->id.c_str());
+    }
+
+    InitialModuleCache::Entry entry;
+    std::unique_ptr<llvm::Module> module;
+
+    const std::string cache_dir = get_env_variable("HL_RUNTIME_CACHE_DIR");
+    std::string cache_path;
+    if (!cache_dir.empty()) {
+        cache_path = initial_module_cache_path(cache_dir, key);
+        if (auto file = llvm::MemoryBuffer::getFile(cache_path)) {
+            debug(1) << "Loading initial module for " << key << " from runtime cache " << cache_path << "\n";
+            entry.id = "halide_initial_module";
+            entry.bitcode.append((*file)->getBufferStart(), (*file)->getBufferEnd());
+            module = parse_bitcode_file((*file)->getBuffer(), c, entry.id.c_str());
+        }
+    }
+
+    if (!module) {
+        module = link_initial_module_for_target(t, c, for_shared_jit_runtime, just_gpu);
+        entry.id = module->getModuleIdentifier();
+        llvm::raw_svector_ostream os(entry.bitcode);
+        llvm::WriteBitcodeToFile(*module, os);
+        if (!cache_path.empty()) {
+            write_initial_module_cache_file(cache_path, entry.bitcode);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.entries.emplace(key, std::make_shared<const InitialModuleCache::Entry>(std::move(entry)));
+    return module;
+}
+
 #ifdef WITH_NVPTX
 std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target target, llvm::LLVMContext *c) {
     std::vector<std::unique_ptr<llvm::Module>> modules;
@@ -8,6 +8,7 @@
 #include "Substitute.h"
 
 #include <algorithm>
+#include <map>
 
 namespace Halide {
 namespace Internal {
@@ -130,6 +131,72 @@ Expr scratch_index(int i, Type t) {
     }
 }
 
+/** Find the buffers that a loop body stores to exactly once, and that
+ * are not allocated or otherwise referenced by name within the body. A
+ * value stored to one of these on one iteration can be carried into
+ * the next iteration instead of being reloaded. */
+class FindForwardableStores : public IRVisitor {
+    std::map<string, int> stores;
+    set<string> excluded;
+
+    using IRVisitor::visit;
+
+    void visit(const Store *op) override {
+        stores[op->name]++;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Allocate *op) override {
+        excluded.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Variable *op) override {
+        // The buffer may be passed to something that writes to it.
+        excluded.insert(op->name);
+        if (ends_with(op->name, ".buffer")) {
+            excluded.insert(op->name.substr(0, op->name.size() - 7));
+        }
+    }
+
+public:
+    set<string> result() const {
+        set<string> r;
+        for (const auto &it : stores) {
+            if (it.second == 1 && !excluded.count(it.first)) {
+                r.insert(it.first);
+            }
+        }
+        return r;
+    }
+};
+
+/** Replace the store to a buffer with a store of the same value to
+ * both the buffer and a scratch slot. */
+class ForwardStoredValue : public IRMutator {
+    const string &buffer, &scratch;
+
+    using IRMutator::visit;
+
+    Stmt visit(const Store *op) override {
+        if (op->name != buffer) {
+            return IRMutator::visit(op);
+        }
+        Type t = op->value.type();
+        string name = unique_name('t');
+        Expr value = Variable::make(t, name);
+        Stmt s = Block::make(Store::make(op->name, value, op->index, op->param, op->predicate, op->alignment),
+                             Store::make(scratch, value, scratch_index(1, t),
+                                         Parameter(), const_true(t.lanes()), ModulusRemainder()));
+        return LetStmt::make(name, op->value, s);
+    }
+
+public:
+    ForwardStoredValue(const string &buffer, const string &scratch)
+        : buffer(buffer), scratch(scratch) {
+    }
+};
+
 /** Given a scope of things that move linearly over time, come up with
  * the next time step's version of some arbitrary Expr (which may be a
  * nasty graph). Variables that move non-linearly through time are
@@ -191,6 +258,10 @@ class LoopCarryOverLoop : public IRMutator {
     // to lift out.
     const Scope<> &in_consume;
 
+    // Buffers whose stores may be forwarded to loads on the next
+    // iteration.
+    const set<string> &forwardable_stores;
+
     int max_carried_values;
 
     using IRMutator::visit;
@@ -312,7 +383,50 @@ class LoopCarryOverLoop : public IRMutator {
             }
         }
 
-        if (chains.empty()) {
+        // Find values stored on this loop iteration that get reloaded
+        // on the next one, as in a scan or a running sum. These
+        // partial results can be carried across the iteration instead
+        // of making a round trip through memory.
+        vector<pair<string, vector<const Load *>>> forwards;
+        for (const Stmt &s : block_to_vector(graph_stmt)) {
+            const Store *store = s.as<Store>();
+            if (!store ||
+                !forwardable_stores.count(store->name) ||
+                !is_const_one(store->predicate)) {
+                continue;
+            }
+            Expr store_index = substitute_in_all_lets(simplify(common_subexpression_elimination(store->index)));
+            // If the store goes to the same place on every iteration, a
+            // load from there after it would see this iteration's
+            // value, not the last one.
+            Expr next_store_index = step_forwards(store->index, linear);
+            if (!next_store_index.defined() ||
+                graph_equal(next_store_index, store->index) ||
+                graph_equal(next_store_index, store_index)) {
+                continue;
+            }
+            vector<const Load *> reloads;
+            for (const Load *load : find_loads.result) {
+                if (load->name != store->name ||
+                    load->type != store->value.type() ||
+                    !is_const_one(load->predicate)) {
+                    continue;
+                }
+                Expr next_index = step_forwards(load->index, linear);
+                if (next_index.defined() &&
+                    (graph_equal(next_index, store->index) ||
+                     graph_equal(next_index, store_index))) {
+                    debug(3) << "Found value carried through memory:\n"
+                             << Expr(load) << "\n";
+                    reloads.push_back(load);
+                }
+            }
+            if (!reloads.empty()) {
+                forwards.emplace_back(store->name, reloads);
+            }
+        }
+
+        if (chains.empty() && forwards.empty()) {
             return orig_stmt;
         }
 
@@ -377,6 +491,9 @@ class LoopCarryOverLoop : public IRMutator {
             sz += c.size();
         }
         chains.swap(trimmed);
+        if (sz + forwards.size() > (size_t)max_carried_values) {
+            forwards.resize(max_carried_values - std::min(sz, (size_t)max_carried_values));
+        }
 
         // We now have chains of the form:
         // f[x] <- f[x+1] <- ... <- f[x+N-1]
@@ -473,6 +590,39 @@ class LoopCarryOverLoop : public IRMutator {
                               initial_stores});
         }
 
+        // For stored values reloaded on the next iteration, keep the
+        // value stored on the previous iteration in slot zero of a
+        // scratch buffer, and the one stored on this iteration in slot
+        // one. Before the loop, slot zero gets loaded from memory as
+        // usual.
+        for (const auto &f : forwards) {
+            string scratch = unique_name('c');
+            const Load *orig_load = f.second[0];
+            Type t = orig_load->type;
+            Expr prev = Load::make(t, scratch, scratch_index(0, t),
+                                   Buffer<>(), Parameter(), const_true(t.lanes()), ModulusRemainder());
+            for (const Load *l : f.second) {
+                core = graph_substitute(l, prev, core);
+            }
+            core = ForwardStoredValue(f.first, scratch).mutate(core);
+
+            Expr next = Load::make(t, scratch, scratch_index(1, t),
+                                   Buffer<>(), Parameter(), const_true(t.lanes()), ModulusRemainder());
+            scratch_shuffles.push_back(Store::make(scratch, next, scratch_index(0, t),
+                                                   Parameter(), const_true(t.lanes()), ModulusRemainder()));
+
+            Stmt initial_store = Store::make(scratch, orig_load, scratch_index(0, t),
+                                             Parameter(), const_true(t.lanes()), ModulusRemainder());
+            for (size_t i = containing_lets.size(); i > 0; i--) {
+                auto l = containing_lets[i - 1];
+                if (stmt_uses_var(initial_store, l.first)) {
+                    initial_store = LetStmt::make(l.first, l.second, initial_store);
+                }
+            }
+
+            allocs.push_back({scratch, t.element_of(), 2 * t.lanes(), initial_store});
+        }
+
         Stmt s = Block::make(not_first_iteration_scratch_stores);
         s = Block::make(s, core);
         s = Block::make(s, Block::make(scratch_shuffles));
@@ -493,8 +643,8 @@ class LoopCarryOverLoop : public IRMutator {
     }
 
 public:
-    LoopCarryOverLoop(const string &var, const Scope<> &s, int max_carried_values)
-        : in_consume(s), max_carried_values(max_carried_values) {
+    LoopCarryOverLoop(const string &var, const Scope<> &s, const set<string> &forwardable_stores, int max_carried_values)
+        : in_consume(s), forwardable_stores(forwardable_stores), max_carried_values(max_carried_values) {
         linear.push(var, 1);
     }
 
@@ -528,7 +678,10 @@ class LoopCarry : public IRMutator {
         if (op->for_type == ForType::Serial && !is_const_one(op->extent)) {
             Stmt stmt;
             Stmt body = mutate(op->body);
-            LoopCarryOverLoop carry(op->name, in_consume, max_carried_values);
+            FindForwardableStores find_forwardable_stores;
+            body.accept(&find_forwardable_stores);
+            set<string> forwardable_stores = find_forwardable_stores.result();
+            LoopCarryOverLoop carry(op->name, in_consume, forwardable_stores, max_carried_values);
             body = carry.mutate(body);
             if (body.same_as(op->body)) {
                 stmt = op;
@@ -8,7 +8,9 @@ namespace Internal {
 
 /** Reuse loads done on previous loop iterations by stashing them in
  * induction variables instead of redoing the load. If the loads are
- * predicated, the predicates need to match. Can be an optimization or
+ * predicated, the predicates need to match. Values stored on one
+ * iteration and reloaded on the next, such as the partial results of a
+ * scan, are carried in the same way. Can be an optimization or
  * pessimization depending on how good the L1 cache is on the architecture
  * and how many memory issue slots there are. Currently only intended
  * for Hexagon. */
@@ -23,6 +23,7 @@
 #include "DebugToFile.h"
 #include "Deinterleave.h"
 #include "EarlyFree.h"
+#include "ExtractTensorCoreOperations.h"
 #include "ExtractTileOperations.h"
 #include "FindCalls.h"
 #include "FindIntrinsics.h"
@@ -31,21 +32,30 @@
 #include "Function.h"
 #include "FuseGPUThreadLoops.h"
 #include "FuzzFloatStores.h"
+#include "GatherScatter.h"
 #include "HexagonOffload.h"
+#include "IRMatch.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
+#include "IRVisitor.h"
 #include "InferArguments.h"
+#include "InjectCompletionCallbacks.h"
 #include "InjectHostDevBufferCopies.h"
 #include "Inline.h"
+#include "InterleaveTuples.h"
+#include "InternExprs.h"
 #include "LICM.h"
 #include "LoopCarry.h"
 #include "LowerParallelTasks.h"
 #include "LowerWarpShuffles.h"
 #include "Memoization.h"
+#include "NarrowArithmetic.h"
 #include "OffloadGPULoops.h"
 #include "PartitionLoops.h"
+#include "PlanMemory.h"
 #include "Prefetch.h"
+#include "ProfileGuided.h"
 #include "Profiling.h"
 #include "PurifyIndexMath.h"
 #include "Qualify.h"
@@ -61,6 +71,7 @@
 #include "SimplifySpecializations.h"
 #include "SkipStages.h"
 #include "SlidingWindow.h"
+#include "SpecializeDenseStrides.h"
 #include "SplitTuples.h"
 #include "StageStridedLoads.h"
 #include "StorageFlattening.h"
@@ -86,11 +97,70 @@ using std::vector;
 
 namespace {
 
+// Counts the distinct IR nodes reachable from a Stmt.
+class CountIRNodes : public IRGraphVisitor {
+    std::set<IRHandle> seen;
+
+public:
+    using IRGraphVisitor::include;
+
+    void include(const Expr &e) override {
+        if (seen.insert(e.get()).second) {
+            e.accept(this);
+        }
+    }
+
+    void include(const Stmt &s) override {
+        if (seen.insert(s.get()).second) {
+            s.accept(this);
+        }
+    }
+
+    uint64_t count() const {
+        return seen.size();
+    }
+};
+
+uint64_t count_ir_nodes(const Stmt &s) {
+    CountIRNodes counter;
+    counter.include(s);
+    return counter.count();
+}
+
 class LoweringLogger {
     Stmt last_written;
 
+    // Per-pass statistics reported to the CompilerLogger, if there is
+    // one, as of the end of the previous pass.
+    std::chrono::high_resolution_clock::time_point last_time = std::chrono::high_resolution_clock::now();
+    uint64_t last_rewrite_count = IRMatcher::matched_rewrite_count();
+
+    void record_pass(CompilerLogger *logger, const string &message, const Stmt &s) {
+        // "Lowering after foo:" -> "foo"
+        const string prefix = "Lowering after ";
+        string name = message;
+        if (starts_with(name, prefix)) {
+            name = name.substr(prefix.size());
+        }
+        while (!name.empty() && (name.back() == ':' || name.back() == '\n')) {
+            name.pop_back();
+        }
+
+        auto now = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> diff = now - last_time;
+        uint64_t rewrites = IRMatcher::matched_rewrite_count();
+        logger->record_lowering_pass(name, diff.count(), get_peak_rss_bytes(),
+                                     count_ir_nodes(s), rewrites - last_rewrite_count);
+        last_rewrite_count = rewrites;
+        // Don't charge the node counting above to the next pass.
+        last_time = std::chrono::high_resolution_clock::now();
+    }
+
 public:
     void operator()(const string &message, const Stmt &s) {
+        if (auto *logger = get_compiler_logger()) {
+            record_pass(logger, message, s);
+        }
         if (!s.same_as(last_written)) {
             debug(2) << message << "\n"
                      << s << "\n";
@@ -118,8 +188,28 @@ void lower_impl(const vector<Function> &output_funcs,
     auto [outputs, env] = deep_copy(output_funcs, build_environment(output_funcs));
 
     bool any_strict_float = strictify_float(env, t);
+    // Codegen for the vector_math feature introduces strict float ops.
+    any_strict_float |= t.has_feature(Target::VectorMath);
     result_module.set_any_strict_float(any_strict_float);
 
+    // Codegen writes the buffers of Funcs scheduled with
+    // store_nontemporal using non-temporal stores.
+    std::set<string> nontemporal_buffers;
+    for (const auto &it : env) {
+        const Function &f = it.second;
+        if (!f.schedule().store_nontemporal()) {
+            continue;
+        }
+        if (f.outputs() == 1) {
+            nontemporal_buffers.insert(f.name());
+        } else {
+            for (int i = 0; i < f.outputs(); i++) {
+                nontemporal_buffers.insert(f.name() + "." + std::to_string(i));
+            }
+        }
+    }
+    result_module.set_nontemporal_buffers(nontemporal_buffers);
+
     // Output functions should all be computed and stored at root.
     for (const Function &f : outputs) {
         Func(f).compute_root().store_root();
@@ -133,10 +223,19 @@ void lower_impl(const vector<Function> &output_funcs,
     // Substitute in wrapper Funcs
     env = wrap_func_calls(env);
 
+    // Split parallel loops that would otherwise stop Funcs stored
+    // outside of them from sliding.
+    split_parallel_sliding_loops(env);
+
     // Compute a realization order and determine group of functions which loops
     // are to be fused together
     auto [order, fused_groups] = realization_order(outputs, env);
 
+    // Only compile the general case of the Funcs a profile says are
+    // cold.
+    const PipelineProfile profile(t, pipeline_name);
+    drop_cold_specializations(env, profile);
+
     // Try to simplify the RHS/LHS of a function definition by propagating its
     // specializations' conditions
     simplify_specializations(env);
@@ -159,6 +258,10 @@ void lower_impl(const vector<Function> &output_funcs,
     s = inject_tracing(s, pipeline_name, trace_pipeline, env, outputs, t);
     log("Lowering after injecting tracing:", s);
 
+    debug(1) << "Injecting completion callbacks...\n";
+    s = inject_completion_callbacks(s, env);
+    log("Lowering after injecting completion callbacks:", s);
+
     debug(1) << "Adding checks for parameters\n";
     s = add_parameter_checks(requirements, s, t);
     log("Lowering after injecting parameter checks:", s);
@@ -181,6 +284,15 @@ void lower_impl(const vector<Function> &output_funcs,
     s = bounds_inference(s, outputs, order, fused_groups, env, func_bounds, t);
     log("Lowering after computation bounds inference:", s);
 
+    // Bounds inference produces a lot of redundant IR. Optionally
+    // hash-cons it to save memory and make later equality tests cheap.
+    const bool intern_ir = get_env_variable("HL_INTERN_IR") == "1";
+    if (intern_ir) {
+        debug(1) << "Interning expressions...\n";
+        s = intern_exprs(s);
+        log("Lowering after interning expressions:", s);
+    }
+
     debug(1) << "Removing extern loops...\n";
     s = remove_extern_loops(s);
     log("Lowering after removing extern loops:", s);
@@ -208,6 +320,12 @@ void lower_impl(const vector<Function> &output_funcs,
     s = allocation_bounds_inference(s, env, func_bounds);
     log("Lowering after allocation bounds inference:", s);
 
+    if (intern_ir) {
+        debug(1) << "Interning expressions...\n";
+        s = intern_exprs(s);
+        log("Lowering after interning expressions again:", s);
+    }
+
     bool will_inject_host_copies =
         (t.has_gpu_feature() ||
          t.has_feature(Target::OpenGLCompute) ||
@@ -269,6 +387,10 @@ void lower_impl(const vector<Function> &output_funcs,
     s = storage_flattening(s, outputs, env, t);
     log("Lowering after storage flattening:", s);
 
+    debug(1) << "Interleaving tuple storage...\n";
+    s = interleave_tuple_storage(s, env);
+    log("Lowering after interleaving tuple storage:", s);
+
     debug(1) << "Adding atomic mutex allocation...\n";
     s = add_atomic_mutex(s, env);
     log("Lowering after adding atomic mutex allocation:", s);
@@ -304,6 +426,12 @@ void lower_impl(const vector<Function> &output_funcs,
     s = unify_duplicate_lets(s);
     log("Lowering after second simplifcation:", s);
 
+    if (t.has_feature(Target::AutoPrefetch)) {
+        debug(1) << "Injecting automatic prefetches...\n";
+        s = inject_auto_prefetches(s, t);
+        log("Lowering after injecting automatic prefetches:", s);
+    }
+
     debug(1) << "Reduce prefetch dimension...\n";
     s = reduce_prefetch_dimension(s, t);
     log("Lowering after reduce prefetch dimension:", s);
@@ -312,18 +440,38 @@ void lower_impl(const vector<Function> &output_funcs,
     s = simplify_correlated_differences(s);
     log("Lowering after simplifying correlated differences:", s);
 
+    if (!profile.empty()) {
+        debug(1) << "Shrinking the loops of cold Funcs...\n";
+        s = shrink_cold_loops(s, profile);
+        log("Lowering after shrinking the loops of cold Funcs:", s);
+    }
+
     debug(1) << "Unrolling...\n";
-    s = unroll_loops(s);
+    s = unroll_loops(s, env);
     log("Lowering after unrolling:", s);
 
+    if (t.has_feature(Target::SpecializeDenseStrides)) {
+        debug(1) << "Specializing loop nests on dense input strides...\n";
+        s = specialize_dense_strides(s);
+        log("Lowering after specializing loop nests on dense input strides:", s);
+    }
+
     debug(1) << "Vectorizing...\n";
     s = vectorize_loops(s, env);
     s = simplify(s);
+    s = share_vector_loads(s);
     log("Lowering after vectorizing:", s);
 
+    debug(1) << "Extracting tensor core operations...\n";
+    s = extract_tensor_core_operations(s, t);
+    log("Lowering after extracting tensor core operations:", s);
+
     if (t.has_gpu_feature() ||
         t.has_feature(Target::Vulkan) ||
         t.has_feature(Target::OpenGLCompute)) {
+        if (t.has_feature(Target::ProfileStages)) {
+            s = strip_gpu_profiler_stage_markers(s);
+        }
         debug(1) << "Injecting per-block gpu synchronization...\n";
         s = fuse_gpu_thread_loops(s);
         log("Lowering after injecting per-block gpu synchronization:", s);
@@ -335,7 +483,7 @@ void lower_impl(const vector<Function> &output_funcs,
     log("Lowering after rewriting vector interleavings:", s);
 
     debug(1) << "Partitioning loops to simplify boundary conditions...\n";
-    s = partition_loops(s);
+    s = partition_loops(s, env);
     s = simplify(s);
     log("Lowering after partitioning loops:", s);
 
@@ -376,10 +524,20 @@ void lower_impl(const vector<Function> &output_funcs,
 
     if (t.has_feature(Target::Profile) || t.has_feature(Target::ProfileByTimer)) {
         debug(1) << "Injecting profiling...\n";
-        s = inject_profiling(s, pipeline_name);
+        s = inject_profiling(s, pipeline_name, t);
         log("Lowering after injecting profiling:", s);
     }
 
+    if (t.has_feature(Target::StaticWorkspace)) {
+        debug(1) << "Planning static workspace...\n";
+        s = plan_static_workspace(s, t, pipeline_name);
+        log("Lowering after planning static workspace:", s);
+    } else if (t.has_feature(Target::PlanMemory)) {
+        debug(1) << "Planning memory...\n";
+        s = plan_memory(s, t);
+        log("Lowering after planning memory:", s);
+    }
+
     if (t.has_feature(Target::CUDA)) {
         debug(1) << "Injecting warp shuffles...\n";
         s = lower_warp_shuffles(s, t);
@@ -393,11 +551,9 @@ void lower_impl(const vector<Function> &output_funcs,
     s = lower_unsafe_promises(s, t);
     log("Lowering after lowering unsafe promises:", s);
 
-    if (t.has_feature(Target::AVX512_SapphireRapids)) {
-        debug(1) << "Extracting tile operations...\n";
-        s = extract_tile_operations(s);
-        log("Lowering after extracting tile operations:", s);
-    }
+    debug(1) << "Extracting tile operations...\n";
+    s = extract_tile_operations(s, t);
+    log("Lowering after extracting tile operations:", s);
 
     debug(1) << "Flattening nested ramps...\n";
     s = flatten_nested_ramps(s);
@@ -410,6 +566,10 @@ void lower_impl(const vector<Function> &output_funcs,
     s = hoist_loop_invariant_if_statements(s);
     log("Lowering after removing dead allocations and hoisting loop invariants:", s);
 
+    debug(1) << "Narrowing vector arithmetic...\n";
+    s = narrow_arithmetic(s);
+    log("Lowering after narrowing vector arithmetic:", s);
+
     debug(1) << "Finding intrinsics...\n";
     // Must be run after the last simplification, because it turns
     // divisions into shifts, which the simplifier reverses.
@@ -420,6 +580,10 @@ void lower_impl(const vector<Function> &output_funcs,
     s = hoist_prefetches(s);
     log("Lowering after hoisting prefetches:", s);
 
+    debug(1) << "Choosing gathers and scatters...\n";
+    s = choose_gathers_and_scatters(s, env, t);
+    log("Lowering after choosing gathers and scatters:", s);
+
     debug(1) << "Lowering after final simplification:\n"
              << s << "\n\n";
 
@@ -448,6 +612,7 @@ void lower_impl(const vector<Function> &output_funcs,
                  << s << "\n\n";
     } else {
         debug(1) << "Skipping GPU offload...\n";
+        s = bind_max_gpu_occupancy_block_sizes(s);
     }
 
     // TODO: This needs to happen before lowering parallel tasks, because global
@@ -565,6 +730,9 @@ void lower_impl(const vector<Function> &output_funcs,
         auto time_end = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> diff = time_end - time_start;
         logger->record_compilation_time(CompilerLogger::Phase::HalideLowering, diff.count());
+        for (const auto &f : result_module.functions()) {
+            logger->record_lowered_func(f.name, count_ir_nodes(f.body));
+        }
     }
 }
 
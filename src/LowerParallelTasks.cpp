@@ -1,5 +1,6 @@
 #include "LowerParallelTasks.h"
 
+#include <set>
 #include <string>
 
 #include "Argument.h"
@@ -155,6 +156,49 @@ int calculate_min_threads(const Stmt &body) {
     return min_threads.result;
 }
 
+class UsesTaskSync : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Fork *op) override {
+        result = true;
+    }
+
+    void visit(const Acquire *op) override {
+        result = true;
+    }
+
+public:
+    bool result = false;
+};
+
+bool uses_task_sync(const Stmt &s) {
+    UsesTaskSync uses;
+    s.accept(&uses);
+    return uses.result;
+}
+
+class SemaphoreReleases : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->name == "halide_semaphore_release" && !op->args.empty()) {
+            if (const Variable *v = op->args[0].as<Variable>()) {
+                result.insert(v->name);
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    std::set<std::string> result;
+};
+
+std::set<std::string> semaphore_releases(const Stmt &s) {
+    SemaphoreReleases releases;
+    s.accept(&releases);
+    return releases.result;
+}
+
 struct LowerParallelTasks : public IRMutator {
 
     /** Codegen a call to do_parallel_tasks */
@@ -169,6 +213,8 @@ struct LowerParallelTasks : public IRMutator {
         Expr min, extent;
         Expr serial;
         std::string name;
+        int priority = 0;
+        int locality_group = 0;
     };
 
     using IRMutator::visit;
@@ -176,6 +222,15 @@ struct LowerParallelTasks : public IRMutator {
     Stmt visit(const For *op) override {
         const Acquire *acquire = op->body.as<Acquire>();
 
+        // With c_plus_plus_parallel_for, CodeGen_C emits plain parallel
+        // loops itself. Loops that synchronize with other tasks still
+        // need the task system.
+        if (op->for_type == ForType::Parallel &&
+            target.has_feature(Target::CPlusPlusParallelFor) &&
+            !uses_task_sync(op->body)) {
+            return IRMutator::visit(op);
+        }
+
         if (op->for_type == ForType::Parallel ||
             (op->for_type == ForType::Serial &&
              acquire &&
@@ -193,9 +248,52 @@ struct LowerParallelTasks : public IRMutator {
         return do_as_parallel_task(op);
     }
 
-    Stmt rewrite_parallel_tasks(const std::vector<ParallelTask> &tasks) {
+    // Set the scheduling hints of a list of tasks. A task that
+    // releases a semaphore a later task acquires feeds it. Tasks get a
+    // priority of the length of the longest chain of tasks they feed,
+    // so that the thread pool starts the critical path first, and
+    // tasks joined by feeding share a locality group. Acquires of
+    // semaphores released by later tasks are back-pressure on a
+    // folded buffer, and ignored.
+    void set_task_hints(std::vector<ParallelTask> &tasks) {
+        const int num_tasks = (int)tasks.size();
+        std::vector<std::set<std::string>> releases(num_tasks);
+        std::vector<int> group(num_tasks);
+        for (int i = 0; i < num_tasks; i++) {
+            releases[i] = semaphore_releases(tasks[i].body);
+            group[i] = i;
+        }
+        std::vector<bool> fed(num_tasks, false);
+        for (int i = num_tasks - 1; i >= 0; i--) {
+            for (int j = i + 1; j < num_tasks; j++) {
+                bool feeds = false;
+                for (const auto &sem : tasks[j].semaphores) {
+                    const Variable *v = sem.semaphore.as<Variable>();
+                    feeds = feeds || (v && releases[i].count(v->name));
+                }
+                if (!feeds) {
+                    continue;
+                }
+                tasks[i].priority = std::max(tasks[i].priority, tasks[j].priority + 1);
+                fed[i] = fed[j] = true;
+                const int old_group = group[j];
+                for (int &g : group) {
+                    if (g == old_group) {
+                        g = group[i];
+                    }
+                }
+            }
+        }
+        for (int i = 0; i < num_tasks; i++) {
+            tasks[i].locality_group = fed[i] ? group[i] + 1 : 0;
+        }
+    }
+
+    Stmt rewrite_parallel_tasks(std::vector<ParallelTask> tasks) {
         Stmt body;
 
+        set_task_hints(tasks);
+
         Closure closure;
         for (const auto &t : tasks) {
             Stmt s = t.body;
@@ -212,7 +310,7 @@ struct LowerParallelTasks : public IRMutator {
 
         int num_tasks = (int)(tasks.size());
         std::vector<Expr> tasks_array_args;
-        tasks_array_args.reserve(num_tasks * 9);
+        tasks_array_args.reserve(num_tasks * 11);
 
         std::string closure_name = unique_name("parallel_closure");
         Expr closure_struct_allocation = closure.pack_into_struct();
@@ -339,6 +437,8 @@ struct LowerParallelTasks : public IRMutator {
                 tasks_array_args.emplace_back(t.extent);
                 tasks_array_args.emplace_back(min_threads);
                 tasks_array_args.emplace_back(Cast::make(Bool(), t.serial));
+                tasks_array_args.emplace_back(t.priority);
+                tasks_array_args.emplace_back(t.locality_group);
             }
         }
 
@@ -406,7 +506,7 @@ struct LowerParallelTasks : public IRMutator {
     Stmt do_as_parallel_task(const Stmt &s) {
         std::vector<ParallelTask> tasks;
         get_parallel_tasks(s, tasks, {function_name, 0});
-        return rewrite_parallel_tasks(tasks);
+        return rewrite_parallel_tasks(std::move(tasks));
     }
 
     LowerParallelTasks(const std::string &name, const Target &t)
@@ -5,6 +5,7 @@
 #include "IRMatch.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "IRVisitor.h"
 #include "LICM.h"
 #include "Simplify.h"
 #include "Solve.h"
@@ -36,6 +37,10 @@
 // intrinsics. Finally, warp shuffles must be hoisted outside of
 // conditionals, because they return undefined values if either the
 // source or destination lanes are inactive.
+//
+// Separately, atomic reductions into a single location from every
+// lane are rewritten to first reduce across the warp with shuffles,
+// so that only one lane needs to perform the atomic update.
 
 namespace Halide {
 namespace Internal {
@@ -815,12 +820,284 @@ bool has_lane_loop(const Stmt &s) {
     return l.result;
 }
 
+// Checks if an Expr loads from a given buffer.
+class LoadsFrom : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &buf;
+
+    void visit(const Load *op) override {
+        result = result || op->name == buf;
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool result = false;
+
+    LoadsFrom(const string &buf)
+        : buf(buf) {
+    }
+};
+
+// Atomic reductions into a location shared by all lanes of a warp
+// (e.g. f() += g(r), with r split and scheduled across GPU lanes),
+// would otherwise have every lane contend on the same atomic
+// update. Instead, combine the values from each lane first using a
+// butterfly of warp shuffles (or a single redux.sync on sm_80 and
+// later), and then have just one lane perform the update. The lanes
+// must all be active to do this, so we only rewrite atomics not
+// inside any control flow that varies across the warp.
+class LowerWarpReductions : public IRMutator {
+    using IRMutator::visit;
+
+    string lane_var;
+    Expr lane_min;
+    int warp_size = 0;
+    int cuda_cap;
+
+    // Vars that may take on different values in different lanes
+    // of the warp.
+    Scope<> varying;
+
+    // Are all lanes of the warp known to be executing the current
+    // statement?
+    bool converged = false;
+
+    static Expr combine(VectorReduce::Operator op, const Expr &a, const Expr &b) {
+        switch (op) {
+        case VectorReduce::Add:
+            return a + b;
+        case VectorReduce::Min:
+            return min(a, b);
+        case VectorReduce::Max:
+            return max(a, b);
+        default:
+            internal_error << "Unhandled warp reduction operator\n";
+            return Expr();
+        }
+    }
+
+    Expr reduce_across_warp(VectorReduce::Operator op, const Expr &value) {
+        Type t = value.type();
+        Expr membermask = (int)0xffffffff;
+
+        if (cuda_cap >= 80 && warp_size == 32 && t.is_int_or_uint()) {
+            // redux.sync reduces 32-bit integers across the whole warp in
+            // one instruction. Narrower types are extended according to
+            // their signedness, which gives the correct answer once
+            // truncated back again.
+            Type wide = t.is_int() ? Int(32) : UInt(32);
+            string intrin = "llvm.nvvm.redux.sync.";
+            if (op == VectorReduce::Add) {
+                intrin += "add";
+            } else {
+                intrin += t.is_uint() ? "u" : "";
+                intrin += op == VectorReduce::Min ? "min" : "max";
+            }
+            return cast(t, Call::make(wide, intrin, {cast(wide, value), membermask}, Call::PureExtern));
+        }
+
+        // Make 32-bit with a combination of reinterprets and zero
+        // extension, as for other warp shuffles.
+        Type shuffle_type = t.bits() < 32 ? UInt(32) : t;
+        string intrin = "llvm.nvvm.shfl";
+        if (cuda_cap >= 70) {
+            intrin += ".sync";
+        }
+        intrin += shuffle_type.is_float() ? ".bfly.f32" : ".bfly.i32";
+
+        Expr result = value;
+        for (int offset = warp_size / 2; offset > 0; offset /= 2) {
+            Expr val = result;
+            if (shuffle_type != t) {
+                val = cast(shuffle_type, reinterpret(t.with_code(Type::UInt), val));
+            }
+            vector<Expr> args = {val, offset, 31};
+            if (cuda_cap >= 70) {
+                args.insert(args.begin(), membermask);
+            }
+            Expr shuffled = Call::make(shuffle_type, intrin, args, Call::PureExtern);
+            if (shuffle_type != t) {
+                shuffled = reinterpret(t, cast(t.with_code(Type::UInt), shuffled));
+            }
+            string name = unique_name('t');
+            lets.emplace_back(name, combine(op, result, shuffled));
+            result = Variable::make(t, name);
+        }
+        return result;
+    }
+
+    // The lets computing the butterfly reduction.
+    vector<pair<string, Expr>> lets;
+
+    // Try to rewrite an atomic update, optionally guarded by a
+    // condition that varies across the warp. Returns an undefined
+    // Stmt if it's not of a form we can handle.
+    Stmt rewrite_atomic(Stmt s, const Expr &guard) {
+        // Peel off any lets around and inside the atomic node. They'll
+        // become part of the value contributed by each lane.
+        vector<pair<string, Expr>> value_lets;
+        auto peel_lets = [&](Stmt s) {
+            while (const LetStmt *let = s.as<LetStmt>()) {
+                value_lets.emplace_back(let->name, let->value);
+                s = let->body;
+            }
+            return s;
+        };
+        const Atomic *atomic = peel_lets(s).as<Atomic>();
+        if (!atomic || !atomic->mutex_name.empty()) {
+            return Stmt();
+        }
+        const Store *store = peel_lets(atomic->body).as<Store>();
+        if (!store ||
+            !store->value.type().is_scalar() ||
+            store->value.type().bits() > 32 ||
+            store->value.type().is_bool() ||
+            !is_const_one(store->predicate) ||
+            expr_uses_vars(store->index, varying)) {
+            return Stmt();
+        }
+        for (const auto &p : value_lets) {
+            if (expr_uses_var(store->index, p.first)) {
+                return Stmt();
+            }
+        }
+
+        // Match a commutative and associative update of the stored
+        // location with some per-lane value.
+        auto is_self = [&](const Expr &e) {
+            const Load *load = e.as<Load>();
+            return load && load->name == store->name && equal(load->index, store->index);
+        };
+        VectorReduce::Operator op = VectorReduce::Add;
+        Expr self, value;
+        auto match = [&](VectorReduce::Operator o, const Expr &a, const Expr &b) {
+            op = o;
+            if (is_self(a)) {
+                self = a;
+                value = b;
+            } else if (is_self(b)) {
+                self = b;
+                value = a;
+            }
+        };
+        if (const Add *add = store->value.as<Add>()) {
+            match(VectorReduce::Add, add->a, add->b);
+        } else if (const Min *mn = store->value.as<Min>()) {
+            match(VectorReduce::Min, mn->a, mn->b);
+        } else if (const Max *mx = store->value.as<Max>()) {
+            match(VectorReduce::Max, mx->a, mx->b);
+        }
+        if (!value.defined()) {
+            return Stmt();
+        }
+        LoadsFrom loads_self(store->name);
+        value.accept(&loads_self);
+        if (loads_self.result) {
+            return Stmt();
+        }
+
+        for (auto it = value_lets.rbegin(); it != value_lets.rend(); it++) {
+            value = Let::make(it->first, it->second, value);
+        }
+        if (guard.defined()) {
+            // Lanes that don't participate contribute the identity.
+            // Use if_then_else so that they don't evaluate the value.
+            Type t = value.type();
+            Expr identity = (op == VectorReduce::Add ? make_zero(t) :
+                             op == VectorReduce::Min ? t.max() :
+                                                       t.min());
+            value = Call::make(t, Call::if_then_else, {guard, value, identity}, Call::PureIntrinsic);
+        }
+
+        string name = unique_name('t');
+        lets.clear();
+        lets.emplace_back(name, value);
+        Expr reduced = reduce_across_warp(op, Variable::make(value.type(), name));
+
+        Stmt update = Store::make(store->name, combine(op, self, reduced), store->index,
+                                  store->param, store->predicate, store->alignment);
+        update = Atomic::make(atomic->producer_name, atomic->mutex_name, update);
+        update = IfThenElse::make(Variable::make(Int(32), lane_var) == lane_min, update);
+        for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+            update = LetStmt::make(it->first, it->second, update);
+        }
+        lets.clear();
+        return update;
+    }
+
+    Stmt visit(const For *op) override {
+        int bits = 0;
+        if (lane_var.empty() &&
+            op->for_type == ForType::GPULane &&
+            is_const_power_of_two_integer(op->extent, &bits) &&
+            bits <= 5) {
+            ScopedValue<string> old_lane_var(lane_var, op->name);
+            ScopedValue<Expr> old_lane_min(lane_min, op->min);
+            ScopedValue<int> old_warp_size(warp_size, 1 << bits);
+            ScopedValue<bool> old_converged(converged, true);
+            ScopedBinding<> bind(varying, op->name);
+            return IRMutator::visit(op);
+        } else if (op->for_type == ForType::GPUThread || op->for_type == ForType::GPULane) {
+            // Other thread loops may share the warp if it's narrower
+            // than 32 lanes.
+            ScopedBinding<> bind(varying, op->name);
+            return IRMutator::visit(op);
+        } else {
+            // A loop with bounds that vary across the warp causes the
+            // lanes to diverge.
+            bool uniform = !expr_uses_vars(op->min, varying) && !expr_uses_vars(op->extent, varying);
+            ScopedValue<bool> old_converged(converged, converged && uniform);
+            ScopedBinding<> bind_if(!uniform, varying, op->name);
+            return IRMutator::visit(op);
+        }
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        ScopedBinding<> bind_if(expr_uses_vars(op->value, varying), varying, op->name);
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        if (!expr_uses_vars(op->condition, varying)) {
+            return IRMutator::visit(op);
+        }
+        if (converged && !op->else_case.defined()) {
+            // A guard on just the atomic update, e.g. from
+            // TailStrategy::GuardWithIf, can be folded into the value
+            // each lane contributes.
+            Stmt s = rewrite_atomic(op->then_case, op->condition);
+            if (s.defined()) {
+                return s;
+            }
+        }
+        ScopedValue<bool> old_converged(converged, false);
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Atomic *op) override {
+        if (converged) {
+            Stmt s = rewrite_atomic(op, Expr());
+            if (s.defined()) {
+                return s;
+            }
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    LowerWarpReductions(int cuda_cap)
+        : cuda_cap(cuda_cap) {
+    }
+};
+
 class LowerWarpShufflesInEachKernel : public IRMutator {
     using IRMutator::visit;
 
     Stmt visit(const For *op) override {
         if (op->device_api == DeviceAPI::CUDA && has_lane_loop(op)) {
             Stmt s = op;
+            s = LowerWarpReductions(cuda_cap).mutate(s);
             s = LowerWarpShuffles(cuda_cap).mutate(s);
             s = HoistWarpShuffles().mutate(s);
             return simplify(s);
@@ -12,7 +12,9 @@ namespace Halide {
 namespace Internal {
 
 /** Rewrite access to things stored outside the loop over GPU lanes to
- * use nvidia's warp shuffle instructions. */
+ * use nvidia's warp shuffle instructions. Atomic reductions from all
+ * lanes into the same location are also rewritten to reduce across the
+ * warp first, so that only a single lane performs the update. */
 Stmt lower_warp_shuffles(Stmt s, const Target &t);
 
 }  // namespace Internal
@@ -1,9 +1,12 @@
 #include "Module.h"
 
 #include <array>
+#include <atomic>
+#include <exception>
 #include <fstream>
 #include <future>
 #include <memory>
+#include <thread>
 #include <utility>
 
 #include "CodeGen_C.h"
@@ -264,6 +267,7 @@ inline void apply_schedule_$SHORTNAME$(
 ) {
     using ::Halide::Func;
     using ::Halide::MemoryType;
+    using ::Halide::PrefetchBoundStrategy;
     using ::Halide::RVar;
     using ::Halide::TailStrategy;
     using ::Halide::Var;
@@ -312,6 +316,25 @@ $NAMESPACECLOSE$
     stream << s;
 }
 
+// Report the object code size of each LoweredFunc of the module, found
+// by looking up its symbol in the given object files.
+void record_lowered_func_object_code_sizes(CompilerLogger *logger, const Module &module,
+                                           const std::vector<std::string> &object_files) {
+    std::map<std::string, uint64_t> sizes = get_object_function_sizes(object_files);
+    for (const auto &f : module.functions()) {
+        // Symbols may have a leading underscore (e.g. on OSX). Names
+        // mangled as C++ are not found, and so aren't recorded.
+        const std::string name = strip_namespaces(f.name);
+        for (const std::string &symbol : {name, "_" + name}) {
+            auto it = sizes.find(symbol);
+            if (it != sizes.end()) {
+                logger->record_lowered_func_object_code_size(f.name, it->second);
+                break;
+            }
+        }
+    }
+}
+
 }  // namespace
 
 struct ModuleContents {
@@ -323,6 +346,7 @@ struct ModuleContents {
     std::vector<Module> submodules;
     MetadataNameMap metadata_name_map;
     bool any_strict_float{false};
+    std::set<std::string> nontemporal_buffers;
     std::unique_ptr<AutoSchedulerResults> auto_scheduler_results;
 };
 
@@ -375,6 +399,10 @@ void Module::set_any_strict_float(bool any_strict_float) {
     contents->any_strict_float = any_strict_float;
 }
 
+void Module::set_nontemporal_buffers(const std::set<std::string> &buffers) {
+    contents->nontemporal_buffers = buffers;
+}
+
 const Target &Module::target() const {
     return contents->target;
 }
@@ -391,6 +419,10 @@ bool Module::any_strict_float() const {
     return contents->any_strict_float;
 }
 
+const std::set<std::string> &Module::nontemporal_buffers() const {
+    return contents->nontemporal_buffers;
+}
+
 const std::vector<Buffer<>> &Module::buffers() const {
     return contents->buffers;
 }
@@ -431,6 +463,7 @@ void Module::append(const Module &module) {
 
 Module link_modules(const std::string &name, const std::vector<Module> &modules) {
     Module output(name, modules.front().target());
+    std::set<std::string> nontemporal_buffers;
 
     for (const auto &input : modules) {
         if (output.target() != input.target()) {
@@ -448,7 +481,10 @@ Module link_modules(const std::string &name, const std::vector<Module> &modules)
         for (const auto &f : input.functions()) {
             output.append(f);
         }
+        nontemporal_buffers.insert(input.nontemporal_buffers().begin(),
+                                   input.nontemporal_buffers().end());
     }
+    output.set_nontemporal_buffers(nontemporal_buffers);
 
     return output;
 }
@@ -495,6 +531,7 @@ Module Module::resolve_submodules() const {
     for (const auto &buf : buffers()) {
         lowered_module.append(buf);
     }
+    lowered_module.set_nontemporal_buffers(nontemporal_buffers());
     for (const auto &m : submodules()) {
         Module copy(m.resolve_submodules());
 
@@ -519,6 +556,31 @@ MetadataNameMap Module::get_metadata_name_map() const {
 }
 
 void Module::compile(const std::map<OutputFileType, std::string> &output_files) const {
+    compile_impl(output_files, false);
+}
+
+void Module::compile_and_release(const std::map<OutputFileType, std::string> &output_files) {
+    // Detach from any other handles to the same contents (e.g. the
+    // Module a Pipeline keeps from its last compilation), so releasing
+    // the IR doesn't affect them. If there are none, the old contents
+    // are freed here and the copy holds the only references to the IR.
+    IntrusivePtr<ModuleContents> copy(new ModuleContents);
+    copy->name = contents->name;
+    copy->target = contents->target;
+    copy->buffers = contents->buffers;
+    copy->functions = contents->functions;
+    copy->submodules = contents->submodules;
+    copy->metadata_name_map = contents->metadata_name_map;
+    copy->any_strict_float = contents->any_strict_float;
+    copy->nontemporal_buffers = contents->nontemporal_buffers;
+    if (contents->auto_scheduler_results) {
+        copy->auto_scheduler_results = std::make_unique<AutoSchedulerResults>(*contents->auto_scheduler_results);
+    }
+    contents = copy;
+    compile_impl(output_files, true);
+}
+
+void Module::compile_impl(const std::map<OutputFileType, std::string> &output_files, bool release_ir) const {
     validate_outputs(output_files);
 
     // Minor but worthwhile optimization: if all of the output files are of types that won't
@@ -536,7 +598,9 @@ void Module::compile(const std::map<OutputFileType, std::string> &output_files)
     // the copied module.
     if (!submodules().empty() && !should_ignore_submodules(output_files)) {
         debug(1) << "Module.compile(): begin submodules\n";
-        resolve_submodules().compile(output_files);
+        // The resolved copy is only used here, so its IR can always be
+        // released.
+        resolve_submodules().compile_and_release(output_files);
         debug(1) << "Module.compile(): end submodules\n";
         return;
     }
@@ -564,14 +628,43 @@ void Module::compile(const std::map<OutputFileType, std::string> &output_files)
         llvm::LLVMContext context;
         std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(*this, context));
 
+        // The Halide IR is no longer needed if none of the outputs below
+        // print it, so drop it before the (much larger) native codegen.
+        if (release_ir &&
+            assembly_path.empty() &&
+            !contains(output_files, OutputFileType::stmt) &&
+            !contains(output_files, OutputFileType::function_info_header) &&
+            !contains(output_files, OutputFileType::c_header) &&
+            !contains(output_files, OutputFileType::c_source) &&
+            !contains(output_files, OutputFileType::python_extension) &&
+            !contains(output_files, OutputFileType::pytorch_wrapper)) {
+            debug(1) << "Module.compile(): releasing IR\n";
+            for (auto &f : contents->functions) {
+                f.body = Stmt();
+            }
+            contents->buffers.clear();
+        }
+
+        // If nothing else needs the LLVM module after the object, the
+        // object can consume it rather than working on a copy.
+        const bool object_is_last = !contains(output_files, OutputFileType::static_library) &&
+                                    assembly_path.empty() &&
+                                    !contains(output_files, OutputFileType::bitcode) &&
+                                    !contains(output_files, OutputFileType::llvm_assembly);
+
         if (contains(output_files, OutputFileType::object)) {
             const auto &f = output_files.at(OutputFileType::object);
             debug(1) << "Module.compile(): object " << f << "\n";
             auto out = make_raw_fd_ostream(f);
-            compile_llvm_module_to_object(*llvm_module, *out);
+            if (object_is_last) {
+                compile_llvm_module_to_object(std::move(llvm_module), *out);
+            } else {
+                compile_llvm_module_to_object(*llvm_module, *out);
+            }
             if (logger) {
                 out->flush();
                 logger->record_object_code_size(file_stat(f).file_size);
+                record_lowered_func_object_code_sizes(logger, *this, {f});
             }
         }
         if (contains(output_files, OutputFileType::static_library)) {
@@ -585,14 +678,22 @@ void Module::compile(const std::map<OutputFileType, std::string> &output_files)
             // `temp_assembly_dir` into a static library...)
             TemporaryFileDir temp_object_dir;
             {
-                std::string object = temp_object_dir.add_temp_object_file(output_files.at(OutputFileType::static_library), "", target());
-                debug(1) << "Module.compile(): temporary object " << object << "\n";
-                auto out = make_raw_fd_ostream(object);
-                compile_llvm_module_to_object(*llvm_module, *out);
-                out->flush();  // create_static_library() is happier if we do this
+                // A static library can hold the module as several objects,
+                // so LLVM codegen can be split across threads.
+                const std::string &lib = output_files.at(OutputFileType::static_library);
+                compile_llvm_module_to_objects(*llvm_module, get_llvm_codegen_threads(), [&](int i) {
+                    std::string object = temp_object_dir.add_temp_object_file(lib, i == 0 ? "" : "_" + std::to_string(i), target());
+                    debug(1) << "Module.compile(): temporary object " << object << "\n";
+                    return make_raw_fd_ostream(object);
+                });
                 if (logger && !contains(output_files, OutputFileType::object)) {
                     // Don't double-record object-code size if we already recorded it for object
-                    logger->record_object_code_size(file_stat(object).file_size);
+                    uint64_t size = 0;
+                    for (const auto &object : temp_object_dir.files()) {
+                        size += file_stat(object).file_size;
+                    }
+                    logger->record_object_code_size(size);
+                    record_lowered_func_object_code_sizes(logger, *this, temp_object_dir.files());
                 }
             }
             debug(1) << "Module.compile(): static_library " << output_files.at(OutputFileType::static_library) << "\n";
@@ -694,6 +795,9 @@ void Module::compile(const std::map<OutputFileType, std::string> &output_files)
         file.close();
         internal_assert(!file.fail());
     }
+    if (logger) {
+        logger->record_peak_rss(get_peak_rss_bytes());
+    }
     if (contains(output_files, OutputFileType::compiler_log)) {
         debug(1) << "Module.compile(): compiler_log " << output_files.at(OutputFileType::compiler_log) << "\n";
         std::ofstream file(output_files.at(OutputFileType::compiler_log));
@@ -745,11 +849,31 @@ public:
         }
     }
 
+    explicit ScopedCompilerLogger(std::unique_ptr<CompilerLogger> compiler_logger) {
+        internal_assert(!get_compiler_logger());
+        set_compiler_logger(std::move(compiler_logger));
+    }
+
+    // Deactivate the logger and hand it back, so that it can be
+    // activated again later (possibly on another thread).
+    std::unique_ptr<CompilerLogger> release() {
+        return set_compiler_logger(nullptr);
+    }
+
     ~ScopedCompilerLogger() {
         set_compiler_logger(nullptr);
     }
 };
 
+int get_compile_multitarget_threads() {
+    std::string threads = get_env_variable("HL_COMPILE_MULTITARGET_THREADS");
+    int n = threads.empty() ? 0 : std::atoi(threads.c_str());
+    if (n <= 0) {
+        n = (int)std::thread::hardware_concurrency();
+    }
+    return std::max(n, 1);
+}
+
 }  // namespace
 
 void compile_multitarget(const std::string &fn_name,
@@ -809,7 +933,7 @@ void compile_multitarget(const std::string &fn_name,
         // This would make the filename outputs more symmetrical (ie the same for n=1 as for n>1)
         // but at the expense of breaking existing users. So for now, we're going to continue
         // with the legacy treatment below:
-        module_factory(fn_name, base_target).compile(output_files);
+        module_factory(fn_name, base_target).compile_and_release(output_files);
         return;
     }
 
@@ -838,6 +962,16 @@ void compile_multitarget(const std::string &fn_name,
     std::vector<AutoSchedulerResults> auto_scheduler_results;
     MetadataNameMap metadata_name_map;
 
+    // The sub_target outputs, and their lowered Modules, args,
+    // auto_scheduler_results and metadata, in target order.
+    std::vector<std::string> sub_fn_names(targets.size());
+    std::vector<Module> sub_modules;
+    std::vector<std::unique_ptr<CompilerLogger>> sub_compiler_loggers(targets.size());
+    std::vector<std::map<OutputFileType, std::string>> sub_outs(targets.size());
+    std::vector<std::vector<LoweredArgument>> sub_target_args(targets.size());
+    std::vector<MetadataNameMap> sub_metadata_name_maps(targets.size());
+    auto_scheduler_results.resize(targets.size());
+
     for (size_t i = 0; i < targets.size(); ++i) {
         const Target &target = targets[i];
 
@@ -868,38 +1002,104 @@ void compile_multitarget(const std::string &fn_name,
 
         // Each sub-target has a function name that is the 'real' name plus a suffix
         std::string suffix = suffix_for_entry(i);
-        std::string sub_fn_name = needs_wrapper ? (fn_name + suffix) : fn_name;
+        sub_fn_names[i] = needs_wrapper ? (fn_name + suffix) : fn_name;
 
+        auto sub_out = add_suffixes(output_files, suffix);
+        if (contains(output_files, OutputFileType::static_library)) {
+            sub_out[OutputFileType::object] = temp_obj_dir.add_temp_object_file(output_files.at(OutputFileType::static_library), suffix, target);
+            sub_out.erase(OutputFileType::static_library);
+        }
+        sub_out.erase(OutputFileType::registration);
+        sub_out.erase(OutputFileType::schedule);
+        sub_out.erase(OutputFileType::c_header);
+        sub_out.erase(OutputFileType::function_info_header);
+        if (contains(sub_out, OutputFileType::compiler_log)) {
+            sub_out[OutputFileType::compiler_log] = temp_compiler_log_dir.add_temp_file(output_files.at(OutputFileType::compiler_log), suffix, target);
+        }
+        sub_outs[i] = std::move(sub_out);
+    }
+
+    // Lower the sub-targets one after another on this thread, in
+    // target order. Module factories may share state between calls
+    // (e.g. the ones used by Pipeline), or run code that must stay on
+    // the calling thread (e.g. Python Generators, which need the GIL),
+    // and lowering in a fixed order keeps the names it makes the same
+    // from run to run.
+    for (size_t i = 0; i < targets.size(); ++i) {
         // We always produce the runtime separately, so add NoRuntime explicitly.
-        Target sub_fn_target = target.with_feature(Target::NoRuntime);
-
-        {
-            ScopedCompilerLogger activate(compiler_logger_factory, sub_fn_name, sub_fn_target);
-            Module sub_module = module_factory(sub_fn_name, sub_fn_target);
-            // Re-assign every time -- should be the same across all targets anyway,
-            // but base_target is always the last one we encounter.
-            base_target_args = sub_module.get_function_by_name(sub_fn_name).args;
-
-            auto sub_out = add_suffixes(output_files, suffix);
-            if (contains(output_files, OutputFileType::static_library)) {
-                sub_out[OutputFileType::object] = temp_obj_dir.add_temp_object_file(output_files.at(OutputFileType::static_library), suffix, target);
-                sub_out.erase(OutputFileType::static_library);
-            }
-            sub_out.erase(OutputFileType::registration);
-            sub_out.erase(OutputFileType::schedule);
-            sub_out.erase(OutputFileType::c_header);
-            sub_out.erase(OutputFileType::function_info_header);
-            if (contains(sub_out, OutputFileType::compiler_log)) {
-                sub_out[OutputFileType::compiler_log] = temp_compiler_log_dir.add_temp_file(output_files.at(OutputFileType::compiler_log), suffix, target);
-            }
-            debug(1) << "compile_multitarget: compile_sub_target " << sub_out[OutputFileType::object] << "\n";
-            sub_module.compile(sub_out);
-            const auto *r = sub_module.get_auto_scheduler_results();
-            auto_scheduler_results.push_back(r ? *r : AutoSchedulerResults());
-            if (target == base_target) {
-                metadata_name_map = sub_module.get_metadata_name_map();
+        Target sub_fn_target = targets[i].with_feature(Target::NoRuntime);
+        const std::string &sub_fn_name = sub_fn_names[i];
+
+        ScopedCompilerLogger activate(compiler_logger_factory, sub_fn_name, sub_fn_target);
+        sub_modules.push_back(module_factory(sub_fn_name, sub_fn_target));
+        sub_target_args[i] = sub_modules.back().get_function_by_name(sub_fn_name).args;
+        sub_compiler_loggers[i] = activate.release();
+    }
+
+    // Then compile the lowered Modules concurrently. Each one makes
+    // names from its own copy of the unique_name counters, as they
+    // were after lowering, so the output doesn't depend on the number
+    // of threads or on how they interleave.
+    const UniqueNameCounters names_after_lowering;
+    auto compile_sub_target = [&](size_t i) {
+        ScopedUniqueNameCounters names(names_after_lowering);
+        ScopedCompilerLogger activate(std::move(sub_compiler_loggers[i]));
+        Module &sub_module = sub_modules[i];
+
+        debug(1) << "compile_multitarget: compile_sub_target " << sub_outs[i][OutputFileType::object] << "\n";
+        sub_module.compile_and_release(sub_outs[i]);
+        const auto *r = sub_module.get_auto_scheduler_results();
+        auto_scheduler_results[i] = r ? *r : AutoSchedulerResults();
+        sub_metadata_name_maps[i] = sub_module.get_metadata_name_map();
+    };
+
+    const size_t num_threads = std::min(targets.size(), (size_t)get_compile_multitarget_threads());
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < targets.size(); i++) {
+            compile_sub_target(i);
+        }
+    } else {
+        debug(1) << "compile_multitarget: compiling on " << num_threads << " threads\n";
+        std::atomic<size_t> next{0};
+        std::vector<std::exception_ptr> errors(targets.size());
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < num_threads; t++) {
+            threads.emplace_back([&]() {
+                size_t i;
+                while ((i = next++) < targets.size()) {
+#ifdef HALIDE_WITH_EXCEPTIONS
+                    try {
+                        compile_sub_target(i);
+                    } catch (...) {
+                        errors[i] = std::current_exception();
+                    }
+#else
+                    compile_sub_target(i);
+#endif
+                }
+            });
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+#ifdef HALIDE_WITH_EXCEPTIONS
+        // Report the error for the first target that failed, as the
+        // serial loop would have.
+        for (const auto &e : errors) {
+            if (e) {
+                std::rethrow_exception(e);
             }
         }
+#endif
+    }
+
+    // base_target is always the last one.
+    base_target_args = sub_target_args.back();
+    metadata_name_map = sub_metadata_name_maps.back();
+
+    for (size_t i = 0; i < targets.size(); ++i) {
+        const Target &target = targets[i];
+        const std::string &sub_fn_name = sub_fn_names[i];
 
         uint64_t cur_target_features[kFeaturesWordCount] = {0};
         for (int i = 0; i < Target::FeatureEnd; ++i) {
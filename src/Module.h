@@ -9,6 +9,7 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 
 #include "Argument.h"
@@ -138,6 +139,8 @@ using MetadataNameMap = std::map<std::string, std::string>;
 class Module {
     Internal::IntrusivePtr<Internal::ModuleContents> contents;
 
+    void compile_impl(const std::map<OutputFileType, std::string> &output_files, bool release_ir) const;
+
 public:
     Module(const std::string &name, const Target &target, const MetadataNameMap &metadata_name_map = {});
 
@@ -155,6 +158,10 @@ public:
     /** Return whether this module uses strict floating-point anywhere. */
     bool any_strict_float() const;
 
+    /** The names of the buffers that dense, aligned vector stores should
+     * write to with non-temporal stores. See \ref Func::store_nontemporal */
+    const std::set<std::string> &nontemporal_buffers() const;
+
     /** The declarations contained in this module. */
     // @{
     const std::vector<Buffer<void>> &buffers() const;
@@ -178,6 +185,13 @@ public:
      * the fields set in output_files. */
     void compile(const std::map<OutputFileType, std::string> &output_files) const;
 
+    /** Compile a halide Module that won't be used again. This is the
+     * same as compile, except that the IR of the functions in this
+     * Module (and any copies of it) is released as soon as none of the
+     * remaining outputs need it, which lowers peak memory use when
+     * compiling large pipelines. */
+    void compile_and_release(const std::map<OutputFileType, std::string> &output_files);
+
     /** Compile a halide Module to in-memory object code. Currently
      * only supports LLVM based compilation, but should be extended to
      * handle source code backends. */
@@ -200,6 +214,9 @@ public:
 
     /** Set whether this module uses strict floating-point directives anywhere. */
     void set_any_strict_float(bool any_strict_float);
+
+    /** Set the names of the buffers to write with non-temporal stores. */
+    void set_nontemporal_buffers(const std::set<std::string> &buffers);
 };
 
 /** Link a set of modules together into one module. */
@@ -221,6 +238,12 @@ std::map<OutputFileType, std::string> compile_standalone_runtime(const std::map<
 using ModuleFactory = std::function<Module(const std::string &fn_name, const Target &target)>;
 using CompilerLoggerFactory = std::function<std::unique_ptr<Internal::CompilerLogger>(const std::string &fn_name, const Target &target)>;
 
+/** Compile a pipeline for several targets, along with a wrapper that
+ * picks the first target the host supports at runtime. The module
+ * factory is called for each target in turn on the calling thread;
+ * the resulting Modules are then compiled to their outputs
+ * concurrently, on up to HL_COMPILE_MULTITARGET_THREADS threads
+ * (default: one per core). */
 void compile_multitarget(const std::string &fn_name,
                          const std::map<OutputFileType, std::string> &output_files,
                          const std::vector<Target> &targets,
@@ -0,0 +1,261 @@
+#include "NarrowArithmetic.h"
+#include "Bounds.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+#include "Simplify.h"
+
+#include <string>
+#include <vector>
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+bool can_represent(const Type &t, const Expr &e) {
+    if (const int64_t *i = as_const_int(e)) {
+        return t.can_represent(*i);
+    } else if (const uint64_t *u = as_const_uint(e)) {
+        return t.can_represent(*u);
+    }
+    return false;
+}
+
+class NarrowArithmetic : public IRMutator {
+    using IRMutator::visit;
+
+    // The bounds of the enclosing lets.
+    Scope<Interval> bounds;
+
+    // The enclosing vector lets, so that a let of a widened narrow
+    // value can be narrowed again. Each narrowed version of the value
+    // that is used gets a let of its own, next to the original.
+    struct NarrowedLet {
+        Type type;
+        std::string name;
+        Expr value;
+    };
+    struct VectorLet {
+        Expr value;
+        std::vector<NarrowedLet> narrowed;
+    };
+    Scope<VectorLet> vector_lets;
+
+    // The bounds of the subexpressions considered so far. The keys are
+    // nodes of the Stmt being mutated, which outlives this map.
+    std::map<const BaseExprNode *, Interval> bounds_cache;
+
+    bool fits(const Expr &e, const Type &t) {
+        auto it = bounds_cache.find(e.get());
+        if (it == bounds_cache.end()) {
+            Interval i = bounds_of_expr_in_scope(e, bounds);
+            if (i.has_lower_bound()) {
+                i.min = simplify(i.min);
+            }
+            if (i.has_upper_bound()) {
+                i.max = simplify(i.max);
+            }
+            it = bounds_cache.emplace(e.get(), i).first;
+        }
+        const Interval &i = it->second;
+        return i.is_bounded() && can_represent(t, i.min) && can_represent(t, i.max);
+    }
+
+    template<typename T>
+    Expr narrow_binary(const T *op, const Type &t) {
+        Expr a = narrow(op->a, t);
+        if (!a.defined()) {
+            return Expr();
+        }
+        Expr b = narrow(op->b, t);
+        if (!b.defined()) {
+            return Expr();
+        }
+        return T::make(a, b);
+    }
+
+    // Compute e in type t, which must hold e and all its intermediate
+    // values. Returns an undefined Expr if that can't be proven.
+    Expr narrow(const Expr &e, const Type &t) {
+        if (e.type() == t) {
+            return e;
+        }
+
+        if (const Variable *var = e.as<Variable>()) {
+            if (vector_lets.contains(var->name)) {
+                VectorLet &let = vector_lets.ref(var->name);
+                for (const NarrowedLet &n : let.narrowed) {
+                    if (n.type == t) {
+                        return Variable::make(t, n.name);
+                    }
+                }
+                Expr value = lossless_cast(t, let.value);
+                if (!value.defined()) {
+                    return Expr();
+                }
+                let.narrowed.push_back({t, unique_name(var->name + ".narrow"), value});
+                return Variable::make(t, let.narrowed.back().name);
+            }
+        } else if (const Broadcast *op = e.as<Broadcast>()) {
+            Expr value = narrow(op->value, t.element_of());
+            if (value.defined()) {
+                return Broadcast::make(value, op->lanes);
+            }
+            return Expr();
+        } else if (const Cast *op = e.as<Cast>()) {
+            if (op->type.can_represent(op->value.type())) {
+                // Look through widening casts, which may be of narrower
+                // arithmetic.
+                return narrow(op->value, t);
+            }
+            return Expr();
+        }
+
+        Expr leaf = lossless_cast(t, e);
+        if (leaf.defined()) {
+            return leaf;
+        }
+
+        if (!fits(e, t)) {
+            return Expr();
+        }
+
+        // As every intermediate value fits in t, computing in t gives
+        // the same results, including for Halide's division and modulus.
+        if (const Add *op = e.as<Add>()) {
+            return narrow_binary(op, t);
+        } else if (const Sub *op = e.as<Sub>()) {
+            return narrow_binary(op, t);
+        } else if (const Mul *op = e.as<Mul>()) {
+            return narrow_binary(op, t);
+        } else if (const Div *op = e.as<Div>()) {
+            return narrow_binary(op, t);
+        } else if (const Mod *op = e.as<Mod>()) {
+            return narrow_binary(op, t);
+        } else if (const Min *op = e.as<Min>()) {
+            return narrow_binary(op, t);
+        } else if (const Max *op = e.as<Max>()) {
+            return narrow_binary(op, t);
+        } else if (const Select *op = e.as<Select>()) {
+            Expr true_value = narrow(op->true_value, t);
+            if (!true_value.defined()) {
+                return Expr();
+            }
+            Expr false_value = narrow(op->false_value, t);
+            if (!false_value.defined()) {
+                return Expr();
+            }
+            return Select::make(mutate(op->condition), true_value, false_value);
+        } else if (e.type().is_scalar()) {
+            // A scalar leaf is cheap to cast once outside the vector
+            // arithmetic.
+            return Cast::make(t, e);
+        }
+        return Expr();
+    }
+
+    template<typename T>
+    Expr visit_arithmetic(const T *op) {
+        const Type &t = op->type;
+        if (t.is_vector() && t.is_int_or_uint() && t.bits() >= 32) {
+            for (const Type &n : {UInt(8), Int(8), UInt(16), Int(16), UInt(32), Int(32)}) {
+                if (n.bits() >= t.bits()) {
+                    break;
+                }
+                Type narrow_t = n.with_lanes(t.lanes());
+                if (!fits(op, narrow_t)) {
+                    continue;
+                }
+                Expr e = narrow(op, narrow_t);
+                if (e.defined()) {
+                    return Cast::make(t, e);
+                }
+            }
+        }
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Add *op) override {
+        return visit_arithmetic(op);
+    }
+
+    Expr visit(const Sub *op) override {
+        return visit_arithmetic(op);
+    }
+
+    Expr visit(const Mul *op) override {
+        return visit_arithmetic(op);
+    }
+
+    Expr visit(const Div *op) override {
+        return visit_arithmetic(op);
+    }
+
+    Expr visit(const Mod *op) override {
+        return visit_arithmetic(op);
+    }
+
+    Expr visit(const Min *op) override {
+        return visit_arithmetic(op);
+    }
+
+    Expr visit(const Max *op) override {
+        return visit_arithmetic(op);
+    }
+
+    Expr visit(const Select *op) override {
+        return visit_arithmetic(op);
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Leave code for other devices alone. Not all of them
+            // support narrow vector types.
+            return op;
+        }
+        return IRMutator::visit(op);
+    }
+
+    template<typename LetOrLetStmt, typename Body>
+    Body visit_let(const LetOrLetStmt *op) {
+        Expr value = mutate(op->value);
+        Interval value_bounds;
+        if (op->value.type().is_int_or_uint()) {
+            value_bounds = bounds_of_expr_in_scope(op->value, bounds);
+        }
+        ScopedBinding<Interval> bind_bounds(bounds, op->name, value_bounds);
+        ScopedBinding<VectorLet> bind_value(op->value.type().is_vector(), vector_lets, op->name, VectorLet{op->value, {}});
+        Body body = mutate(op->body);
+        if (bind_value.bound()) {
+            // Compute each narrowed version of the value once, where the
+            // original is computed, rather than at every use, which may
+            // come after a store to something the value loads from.
+            for (const NarrowedLet &n : vector_lets.get(op->name).narrowed) {
+                body = LetOrLetStmt::make(n.name, n.value, body);
+            }
+        }
+        if (value.same_as(op->value) && body.same_as(op->body)) {
+            return op;
+        }
+        return LetOrLetStmt::make(op->name, value, body);
+    }
+
+    Expr visit(const Let *op) override {
+        return visit_let<Let, Expr>(op);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        return visit_let<LetStmt, Stmt>(op);
+    }
+};
+
+}  // namespace
+
+Stmt narrow_arithmetic(const Stmt &s) {
+    return NarrowArithmetic().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,27 @@
+#ifndef HALIDE_NARROW_ARITHMETIC_H
+#define HALIDE_NARROW_ARITHMETIC_H
+
+/** \file
+ * Defines the lowering pass that computes wide integer vector
+ * arithmetic in narrower types where the values allow it.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Rewrite integer vector arithmetic of 32 or more bits to compute in
+ * the narrowest integer type that provably holds the result and every
+ * intermediate value, e.g. i32(a_u8) + i32(b_u8) * 3 becomes
+ * i32(u16(a_u8) + u16(b_u8) * 3). The leaves must be values that can
+ * be losslessly cast to the narrow type, such as widened narrow loads
+ * and small constants. This multiplies the number of lanes per vector
+ * register for pipelines that compute on narrow data in int32 without
+ * hand-written casts. */
+Stmt narrow_arithmetic(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -15,12 +15,14 @@
 #include "IRPrinter.h"
 #include "InjectHostDevBufferCopies.h"
 #include "OffloadGPULoops.h"
+#include "Simplify.h"
 #include "Util.h"
 
 namespace Halide {
 namespace Internal {
 
 using std::map;
+using std::pair;
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -94,12 +96,31 @@ private:
     }
 };
 
+// Find the variables made by gpu_occupancy_block_size.
+class FindOccupancyBlockSizes : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        int max_size;
+        if (is_gpu_occupancy_block_size(op->name, &max_size)) {
+            result[op->name] = max_size;
+        }
+    }
+
+public:
+    map<string, int> result;
+};
+
 class InjectGpuOffload : public IRMutator {
     /** Child code generator for device kernels. */
     map<DeviceAPI, unique_ptr<CodeGen_GPU_Dev>> cgdev;
 
     map<string, bool> state_needed;
 
+    // The CUDA kernels whose launches use each occupancy-based block
+    // size, and their static shared memory usage.
+    map<string, pair<string, Expr>> occupancy_kernels;
+
     const Target &target;
 
     Expr get_state_var(const string &name) {
@@ -235,6 +256,21 @@ class InjectGpuOffload : public IRMutator {
         debug(3) << "bounds.num_threads[2] = " << bounds.num_threads[2] << "\n";
 
         string api_unique_name = gpu_codegen->api_unique_name();
+
+        if (loop->device_api == DeviceAPI::CUDA) {
+            FindOccupancyBlockSizes find;
+            for (int i = 0; i < 3; i++) {
+                bounds.num_threads[i].accept(&find);
+            }
+            Expr shared_mem = simplify(bounds.shared_mem_size);
+            if (!is_const(shared_mem)) {
+                shared_mem = 0;
+            }
+            for (const auto &it : find.result) {
+                occupancy_kernels.emplace(it.first, std::make_pair(kernel_name, shared_mem));
+            }
+        }
+
         vector<Expr> run_args = {
             get_state_var(api_unique_name),
             kernel_name,
@@ -294,6 +330,24 @@ public:
 
         Stmt result = mutate(s);
 
+        // Block sizes from gpu_occupancy_block_size are asked of the
+        // runtime once the kernels are loaded, if a CUDA kernel
+        // launch uses them. Everything else gets the maximum size.
+        FindOccupancyBlockSizes find_block_sizes;
+        result.accept(&find_block_sizes);
+        vector<pair<string, Expr>> occupancy_lets;
+        for (const auto &it : find_block_sizes.result) {
+            auto k = occupancy_kernels.find(it.first);
+            if (k == occupancy_kernels.end()) {
+                result = LetStmt::make(it.first, it.second, result);
+            } else {
+                Expr query = Call::make(Int(32), "halide_cuda_occupancy_block_size",
+                                        {get_state_var("cuda"), k->second.first, k->second.second, it.second},
+                                        Call::Extern);
+                occupancy_lets.emplace_back(it.first, query);
+            }
+        }
+
         for (auto &i : cgdev) {
             string api_unique_name = i.second->api_unique_name();
 
@@ -318,6 +372,12 @@ public:
             Stmt register_destructor = Evaluate::make(
                 Call::make(Handle(), Call::register_destructor, finalize_args, Call::Intrinsic));
 
+            if (i.first == DeviceAPI::CUDA) {
+                for (const auto &l : occupancy_lets) {
+                    result = LetStmt::make(l.first, l.second, result);
+                }
+            }
+
             result = LetStmt::make(api_unique_name, state_ptr, Block::make({init_kernels, register_destructor, result}));
         }
         return result;
@@ -330,5 +390,15 @@ Stmt inject_gpu_offload(const Stmt &s, const Target &host_target) {
     return InjectGpuOffload(host_target).inject(s);
 }
 
+Stmt bind_max_gpu_occupancy_block_sizes(const Stmt &s) {
+    FindOccupancyBlockSizes find;
+    s.accept(&find);
+    Stmt result = s;
+    for (const auto &it : find.result) {
+        result = LetStmt::make(it.first, it.second, result);
+    }
+    return result;
+}
+
 }  // namespace Internal
 }  // namespace Halide
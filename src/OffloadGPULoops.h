@@ -19,6 +19,10 @@ namespace Internal {
  * module, and call them through the appropriate host runtime module. */
 Stmt inject_gpu_offload(const Stmt &s, const Target &host_target);
 
+/** Bind the block sizes made by gpu_occupancy_block_size to their
+ * maximum sizes. Used when there is no GPU runtime to ask. */
+Stmt bind_max_gpu_occupancy_block_sizes(const Stmt &s);
+
 }  // namespace Internal
 }  // namespace Halide
 
@@ -0,0 +1,115 @@
+#include "ParallelScan.h"
+
+#include "Func.h"
+#include "IROperator.h"
+#include "Util.h"
+
+namespace Halide {
+
+using std::string;
+using std::vector;
+
+Func linear_recurrence(const Func &input, int dim, const Expr &min, const Expr &extent,
+                       const Expr &coefficient, int block_size, const string &func_name) {
+    user_assert(input.defined())
+        << "Can't compute a linear recurrence of an undefined Func.\n";
+    user_assert(input.outputs() == 1)
+        << "Can't compute a linear recurrence of Func " << input.name()
+        << ", because it has multiple outputs.\n";
+    const int dims = input.dimensions();
+    user_assert(dim >= 0 && dim < dims)
+        << "Can't compute a linear recurrence of Func " << input.name()
+        << " along dimension " << dim << ", because it has " << dims << " dimensions.\n";
+    user_assert(block_size > 1)
+        << "The block size of a linear recurrence must be greater than one.\n";
+
+    const Type t = input.type();
+    const Expr a = cast(t, coefficient);
+    const bool unit = is_const_one(a);
+    user_assert(unit || t.is_float())
+        << "A linear recurrence of Func " << input.name()
+        << " with a coefficient other than one requires a floating-point type, not "
+        << t << ".\n";
+
+    // The Funcs below must have distinct names even if this is used more
+    // than once in a pipeline, as in an integral image.
+    const string name = Internal::unique_name(func_name);
+
+    vector<Var> vars;
+    for (int i = 0; i < dims; i++) {
+        vars.emplace_back(name + "_v" + std::to_string(i));
+    }
+    Var ii(name + "_ii"), bo(name + "_bo");
+
+    // The intermediate Funcs have the scan dimension replaced by an
+    // index within a block and a block index.
+    auto block_args = [&](const Expr &inner, const Expr &block) {
+        vector<Expr> args(vars.begin(), vars.end());
+        args[dim] = block;
+        args.insert(args.begin() + dim, inner);
+        return args;
+    };
+    auto carry_args = [&](const Expr &block) {
+        vector<Expr> args(vars.begin(), vars.end());
+        args[dim] = block;
+        return args;
+    };
+
+    // The powers of the coefficient within a block.
+    Func decay(name + "_decay");
+    if (!unit) {
+        decay(ii) = pow(a, cast(t, ii + 1));
+    }
+
+    // The recurrence within each block, starting from zero. The last
+    // block may be partial, so clamp the accesses to the input.
+    Func local(name + "_local");
+    vector<Expr> input_args(vars.begin(), vars.end());
+    input_args[dim] = clamp(min + bo * block_size + ii, min, min + extent - 1);
+    local(block_args(ii, bo)) = input(input_args);
+    RDom r(1, block_size - 1, name + "_r");
+    Expr prev = local(block_args(r - 1, bo));
+    local(block_args(r, bo)) += unit ? prev : a * prev;
+
+    // The value of the full recurrence at the end of each block, found
+    // with a serial scan over the blocks.
+    Func carry(name + "_carry");
+    carry(carry_args(bo)) = local(block_args(block_size - 1, bo));
+    Expr num_blocks = (extent + block_size - 1) / block_size;
+    RDom rb(1, num_blocks - 1, name + "_rb");
+    prev = carry(carry_args(rb - 1));
+    carry(carry_args(rb)) += unit ? prev : decay(block_size - 1) * prev;
+
+    // Add the contribution of the preceding blocks to each element.
+    Func result(name);
+    Expr e = vars[dim] - min;
+    Expr block = e / block_size;
+    Expr inner = e % block_size;
+    Expr entry = carry(carry_args(max(block - 1, 0)));
+    if (!unit) {
+        entry = decay(inner) * entry;
+    }
+    result(vars) = local(block_args(inner, block)) + select(block > 0, entry, Internal::make_zero(t));
+
+    // Schedule. Keep the dimensions inside the scan dimension innermost
+    // within the scan over each block.
+    if (!unit) {
+        decay.compute_root();
+    }
+    local.compute_root().parallel(bo);
+    vector<VarOrRVar> order(vars.begin(), vars.begin() + dim);
+    order.emplace_back(r);
+    local.update().reorder(order).parallel(bo);
+    carry.compute_root();
+
+    return result;
+}
+
+Func prefix_sum(const Func &input, int dim, const Expr &min, const Expr &extent,
+                int block_size, const string &name) {
+    user_assert(input.defined())
+        << "Can't compute a prefix sum of an undefined Func.\n";
+    return linear_recurrence(input, dim, min, extent, Internal::make_one(input.type()), block_size, name);
+}
+
+}  // namespace Halide
@@ -0,0 +1,68 @@
+#ifndef HALIDE_PARALLEL_SCAN_H
+#define HALIDE_PARALLEL_SCAN_H
+
+/** \file
+ * Defines blocked parallel implementations of first-order linear
+ * recurrences, such as prefix sums and IIR filters.
+ */
+
+#include <string>
+
+#include "Expr.h"
+
+namespace Halide {
+
+class Func;
+
+/** Compute the first-order linear recurrence
+ *
+ \code
+ result(..., i, ...) = input(..., i, ...) + coefficient * result(..., i - 1, ...)
+ \endcode
+ *
+ * along dimension dim of input, for i in [min, min + extent), taking
+ * result(..., min - 1, ...) to be zero. Writing this directly as an
+ * update over an RDom serializes the loop along dim. This version
+ * instead splits the scan dimension into blocks of block_size
+ * elements and runs the recurrence within each block in parallel,
+ * assuming a zero entry value. A short serial scan over the last
+ * value of each block then finds the true entry value of every
+ * block. Each output is the block-local value plus the entry value of
+ * its block times the matching power of the coefficient. This adds
+ * about one multiply-add per element and gives up to extent /
+ * block_size way parallelism along the scan dimension. That is useful
+ * when the other dimensions are too small to keep all cores busy, as
+ * with narrow tall images.
+ *
+ * The intermediate Funcs are computed at root, and the blocks are run
+ * in parallel. The returned Func is pure, and can be scheduled like
+ * any other. It is only meaningful within [min, min + extent) along
+ * dim, and the input is only accessed within that range along dim.
+ *
+ * A coefficient other than one requires a floating-point input. For
+ * example, a first-order low pass IIR filter down the columns of an
+ * image is:
+ \code
+ Func weighted;
+ weighted(x, y) = alpha * input(x, y);
+ Func blur = linear_recurrence(weighted, 1, 0, height, 1 - alpha);
+ \endcode
+ */
+Func linear_recurrence(const Func &input, int dim, const Expr &min, const Expr &extent,
+                       const Expr &coefficient, int block_size = 256,
+                       const std::string &name = "linear_recurrence");
+
+/** Compute the inclusive prefix sum of input along dimension dim over
+ * [min, min + extent), using the blocked parallel scan described in
+ * \ref linear_recurrence. An integral image is a prefix sum along each
+ * dimension in turn:
+ \code
+ Func integral = prefix_sum(prefix_sum(input, 0, 0, width), 1, 0, height);
+ \endcode
+ */
+Func prefix_sum(const Func &input, int dim, const Expr &min, const Expr &extent,
+                int block_size = 256, const std::string &name = "prefix_sum");
+
+}  // namespace Halide
+
+#endif
@@ -4,6 +4,7 @@
 
 #include "CSE.h"
 #include "CodeGen_GPU_Dev.h"
+#include "CodeSizeBudget.h"
 #include "ExprUsesVar.h"
 #include "IREquality.h"
 #include "IRMutator.h"
@@ -17,7 +18,9 @@
 namespace Halide {
 namespace Internal {
 
+using std::map;
 using std::pair;
+using std::set;
 using std::string;
 using std::vector;
 
@@ -511,11 +514,57 @@ bool contains_warp_synchronous_logic(const Stmt &s) {
     return c.result;
 }
 
+// Find the loops of the Funcs with a code size budget that loop
+// partitioning would split, and estimate how much code splitting each
+// of them would add.
+class FindPartitionCandidates : public IRVisitor {
+    using IRVisitor::visit;
+
+    const CodeSizeBudget &budget;
+    string func;
+    int depth = 0;
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->is_producer) {
+            ScopedValue<string> old_func(func, op->name);
+            ScopedValue<int> old_depth(depth, 0);
+            IRVisitor::visit(op);
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const For *op) override {
+        ScopedValue<int> old_depth(depth, depth + 1);
+        if (budget.has_budget(func)) {
+            FindSimplifications finder(op->name);
+            op->body.accept(&finder);
+            if (!finder.simplifications.empty()) {
+                // The prologue and the epilogue are each a copy of
+                // the body.
+                candidates.push_back({func, op->name, 2 * code_size(op->body), depth});
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    vector<CodeSizeCandidate> candidates;
+
+    FindPartitionCandidates(const CodeSizeBudget &budget, const string &func)
+        : budget(budget), func(func) {
+    }
+};
+
 class PartitionLoops : public IRMutator {
     using IRMutator::visit;
 
     bool in_gpu_loop = false;
 
+    // Loops that would take their Func over its code size budget if
+    // partitioned.
+    const set<string> &too_big;
+
     Stmt visit(const For *op) override {
         Stmt body = op->body;
 
@@ -528,6 +577,10 @@ class PartitionLoops : public IRMutator {
             return IRMutator::visit(op);
         }
 
+        if (too_big.count(op->name)) {
+            return IRMutator::visit(op);
+        }
+
         // Find simplifications in this loop body
         FindSimplifications finder(op->name);
         body.accept(&finder);
@@ -771,6 +824,11 @@ class PartitionLoops : public IRMutator {
 
         return stmt;
     }
+
+public:
+    PartitionLoops(const set<string> &too_big)
+        : too_big(too_big) {
+    }
 };
 
 class ExprContainsLoad : public IRVisitor {
@@ -1081,22 +1139,45 @@ bool has_likely_tag(const Expr &e) {
     return h.result;
 }
 
-Stmt partition_loops(Stmt s) {
+Stmt partition_loops(Stmt s, const map<string, Function> &env) {
     s = LowerLikelyIfInnermost().mutate(s);
 
     // Walk inwards to the first loop before doing any more work.
     class Mutator : public IRMutator {
         using IRMutator::visit;
+
+        CodeSizeBudget budget;
+        string func;
+
+        Stmt visit(const ProducerConsumer *op) override {
+            if (op->is_producer) {
+                ScopedValue<string> old_func(func, op->name);
+                return IRMutator::visit(op);
+            }
+            return IRMutator::visit(op);
+        }
+
         Stmt visit(const For *op) override {
             Stmt s = op;
             s = MarkClampedRampsAsLikely().mutate(s);
             s = ExpandSelects().mutate(s);
-            s = PartitionLoops().mutate(s);
+            set<string> too_big;
+            if (!budget.empty()) {
+                FindPartitionCandidates finder(budget, func);
+                s.accept(&finder);
+                too_big = budget.choose("partition", finder.candidates);
+            }
+            s = PartitionLoops(too_big).mutate(s);
             s = RenormalizeGPULoops().mutate(s);
             s = CollapseSelects().mutate(s);
             return s;
         }
-    } mutator;
+
+    public:
+        Mutator(const Stmt &s, const map<string, Function> &env)
+            : budget(s, env) {
+        }
+    } mutator(s, env);
     s = mutator.mutate(s);
 
     s = remove_likelies(s);
@@ -1,5 +1,12 @@
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <set>
 #include <utility>
 
 #include "Argument.h"
@@ -7,6 +14,7 @@
 #include "CodeGen_Internal.h"
 #include "FindCalls.h"
 #include "Func.h"
+#include "IRMutator.h"
 #include "IRVisitor.h"
 #include "InferArguments.h"
 #include "LLVM_Output.h"
@@ -16,6 +24,7 @@
 #include "Pipeline.h"
 #include "PrintLoopNest.h"
 #include "RealizationOrder.h"
+#include "ScheduleDatabase.h"
 #include "WasmExecutor.h"
 
 using namespace Halide::Internal;
@@ -116,10 +125,53 @@ struct PipelineContents {
     // Cached jit-compiled code
     JITCache jit_cache;
 
+    /** The scalar Params the JIT specializes on, if any, and how many
+     * variants to keep. */
+    vector<Parameter> jit_specialize_params;
+    size_t max_jit_specializations = 0;
+    bool jit_specialize_in_background = false;
+
+    /** Jit-compiled variants specialized on values of the Params
+     * above, most recently used first. The key is the bits of the
+     * value of each Param. */
+    struct JITSpecialization {
+        vector<uint64_t> key;
+        JITCache cache;
+    };
+    std::list<JITSpecialization> jit_specializations;
+
+    /** A variant being compiled in the background, if any. */
+    std::future<JITCache> pending_jit_specialization;
+    vector<uint64_t> pending_jit_specialization_key;
+
+    void invalidate_jit_specializations() {
+        // Waits for any variant still being compiled, which may be
+        // using the custom lowering passes.
+        pending_jit_specialization = std::future<JITCache>();
+        jit_specializations.clear();
+    }
+
+    JITCompileStats jit_compile_stats;
+
+    /** The outputs kept by realize_reusing_outputs, for the sizes and
+     * target below: buffers with no storage for the next bounds query,
+     * the allocated outputs, and the same cropped to the sizes. */
+    struct ReusedOutputs {
+        vector<int32_t> sizes;
+        Target target;
+        std::optional<Realization> query, full, result;
+    };
+    ReusedOutputs reused_outputs;
+
     /** Clear all cached state */
-    void invalidate_cache() {
+    void invalidate_cache(JITCompileStats::InvalidationCause cause = JITCompileStats::CacheInvalidated) {
+        if (!jit_cache.jit_target.has_unknowns()) {
+            jit_compile_stats.invalidations[cause]++;
+        }
         module = Module("", Target());
         jit_cache = JITCache();
+        reused_outputs = ReusedOutputs();
+        invalidate_jit_specializations();
     }
 
     // The outputs
@@ -162,7 +214,7 @@ struct PipelineContents {
     }
 
     void clear_custom_lowering_passes() {
-        invalidate_cache();
+        invalidate_cache(JITCompileStats::CustomLoweringPassesChanged);
         for (auto &custom_lowering_pass : custom_lowering_passes) {
             if (custom_lowering_pass.deleter) {
                 custom_lowering_pass.deleter();
@@ -214,6 +266,39 @@ vector<Func> Pipeline::outputs() const {
     return funcs;
 }
 
+/* static */
+Pipeline Pipeline::combine(const vector<Pipeline> &pipelines) {
+    user_assert(!pipelines.empty()) << "Can't combine an empty list of Pipelines\n";
+    Pipeline result;
+    result.contents = new PipelineContents;
+    std::set<string> output_names;
+    for (const Pipeline &p : pipelines) {
+        user_assert(p.defined()) << "Can't combine an undefined Pipeline\n";
+        user_assert(p.contents->custom_lowering_passes.empty())
+            << "Can't combine Pipelines that have custom lowering passes\n";
+        for (const Function &f : p.contents->outputs) {
+            user_assert(output_names.insert(f.name()).second)
+                << "Func " << f.name() << " is an output of more than one of the Pipelines being combined\n";
+            result.contents->outputs.push_back(f);
+        }
+        result.contents->requirements.insert(result.contents->requirements.end(),
+                                             p.contents->requirements.begin(),
+                                             p.contents->requirements.end());
+        result.contents->jit_externs.insert(p.contents->jit_externs.begin(),
+                                            p.contents->jit_externs.end());
+        result.contents->trace_pipeline |= p.contents->trace_pipeline;
+    }
+    return result;
+}
+
+namespace {
+
+// Guards the autoscheduler map, as plugins may be loaded while other
+// threads compile pipelines.
+std::mutex autoscheduler_map_mutex;
+
+}  // namespace
+
 /* static */
 std::map<std::string, AutoSchedulerFn> &Pipeline::get_autoscheduler_map() {
     static std::map<std::string, AutoSchedulerFn> autoschedulers = {};
@@ -222,6 +307,7 @@ std::map<std::string, AutoSchedulerFn> &Pipeline::get_autoscheduler_map() {
 
 /* static */
 AutoSchedulerFn Pipeline::find_autoscheduler(const std::string &autoscheduler_name) {
+    std::lock_guard<std::mutex> lock(autoscheduler_map_mutex);
     const auto &m = get_autoscheduler_map();
     auto it = m.find(autoscheduler_name);
     if (it == m.end()) {
@@ -247,12 +333,19 @@ AutoSchedulerResults Pipeline::apply_autoscheduler(const Target &target, const A
     results.target = target;
     results.autoscheduler_params = autoscheduler_params;
 
+    ScheduleDatabase database(contents->outputs, target, autoscheduler_params);
+    if (database.load(&results)) {
+        contents->invalidate_cache(JITCompileStats::ScheduleLoaded);
+        return results;
+    }
     autoscheduler_fn(*this, target, autoscheduler_params, &results);
+    database.save(results);
     return results;
 }
 
 /* static */
 void Pipeline::add_autoscheduler(const std::string &autoscheduler_name, const AutoSchedulerFn &autoscheduler) {
+    std::lock_guard<std::mutex> lock(autoscheduler_map_mutex);
     auto &m = get_autoscheduler_map();
     user_assert(m.find(autoscheduler_name) == m.end()) << "'" << autoscheduler_name << "' is already registered as an autoscheduler.\n";
     m[autoscheduler_name] = autoscheduler;
@@ -560,14 +653,18 @@ void Pipeline::compile_jit(const Target &target_arg) {
     Target target = target_arg.with_feature(Target::JIT).with_feature(Target::UserContext);
 
     // If we're re-jitting for the same target, we can just keep the old jit module.
-    if (get_compiled_jit_target() == target) {
+    Target compiled_target = get_compiled_jit_target();
+    if (compiled_target == target) {
         debug(2) << "Reusing old jit module compiled for :\n"
                  << target << "\n";
+        contents->jit_compile_stats.cache_hits++;
         return;
     }
 
     // Clear all cached info in case there is an error.
-    contents->invalidate_cache();
+    contents->invalidate_cache(JITCompileStats::TargetChanged);
+
+    auto start = std::chrono::steady_clock::now();
 
     // Infer an arguments vector
     infer_arguments();
@@ -582,8 +679,30 @@ void Pipeline::compile_jit(const Target &target_arg) {
     }
 
     Module module = compile_to_module(args, generate_function_name(), target).resolve_submodules();
+    auto lowered = std::chrono::steady_clock::now();
     std::map<std::string, JITExtern> lowered_externs = contents->jit_externs;
     contents->jit_cache = compile_jit_cache(module, std::move(args), contents->outputs, contents->jit_externs, target);
+    auto finished = std::chrono::steady_clock::now();
+
+    JITCompileStats &stats = contents->jit_compile_stats;
+    double lowering_seconds = std::chrono::duration<double>(lowered - start).count();
+    double codegen_seconds = std::chrono::duration<double>(finished - lowered).count();
+    stats.compiles++;
+    stats.last_compile_seconds = lowering_seconds + codegen_seconds;
+    stats.compile_seconds += stats.last_compile_seconds;
+    stats.lowering_seconds += lowering_seconds;
+    stats.codegen_seconds += codegen_seconds;
+    int bucket = 0;
+    for (double ms = stats.last_compile_seconds * 1000; ms >= 1 && bucket < JITCompileStats::num_histogram_buckets - 1; ms /= 2) {
+        bucket++;
+    }
+    stats.compile_time_histogram[bucket]++;
+
+    JITUserContext context;
+    JITSharedRuntime::populate_jit_handlers(&context, contents->jit_handlers);
+    if (context.handlers.custom_jit_compile_report) {
+        context.handlers.custom_jit_compile_report(module.name().c_str(), stats);
+    }
 }
 
 Callable Pipeline::compile_to_callable(const std::vector<Argument> &args_in, const Target &target_arg) {
@@ -613,6 +732,156 @@ Callable Pipeline::compile_to_callable(const std::vector<Argument> &args_in, con
     return Callable(module.name(), jit_handlers(), get_jit_externs(), std::move(jit_cache));
 }
 
+Callable Pipeline::compile_to_callable(const std::vector<Argument> &args, const std::vector<Target> &targets) {
+    user_assert(!targets.empty()) << "Must specify at least one target.\n";
+    vector<Target> jit_targets;
+    jit_targets.reserve(targets.size());
+    for (const Target &t : targets) {
+        user_assert(t.os == targets.back().os &&
+                    t.arch == targets.back().arch &&
+                    t.bits == targets.back().bits)
+            << "All Targets must have matching arch-bits-os for compile_to_callable.\n";
+        user_assert(t.arch != Target::WebAssembly || targets.size() == 1)
+            << "compile_to_callable can't choose between several WebAssembly targets.\n";
+        jit_targets.push_back(t.with_feature(Target::JIT).with_feature(Target::UserContext));
+    }
+    return compile_to_callable(args, JITSharedRuntime::select_target(jit_targets));
+}
+
+void Pipeline::specialize_jit_on(const std::vector<Expr> &params, int max_variants, bool compile_in_background) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    user_assert(params.empty() || max_variants > 0)
+        << "specialize_jit_on requires max_variants to be at least one.\n";
+
+    vector<Parameter> parameters;
+    for (const Expr &e : params) {
+        const Variable *v = e.as<Variable>();
+        user_assert(v && v->param.defined() && !v->param.is_buffer())
+            << "specialize_jit_on can only specialize on scalar Params, but was passed: " << e << "\n";
+        parameters.push_back(v->param);
+    }
+
+    contents->invalidate_jit_specializations();
+    contents->jit_specialize_params = std::move(parameters);
+    contents->max_jit_specializations = max_variants;
+    contents->jit_specialize_in_background = compile_in_background;
+}
+
+namespace {
+
+// Replace uses of some scalar Params with constants.
+class SubstituteParams : public IRMutator {
+    using IRMutator::visit;
+
+    const vector<std::pair<Parameter, Expr>> &values;
+
+    Expr visit(const Variable *op) override {
+        if (op->param.defined()) {
+            for (const auto &p : values) {
+                if (op->param.same_as(p.first)) {
+                    return p.second;
+                }
+            }
+        }
+        return op;
+    }
+
+public:
+    SubstituteParams(const vector<std::pair<Parameter, Expr>> &values)
+        : values(values) {
+    }
+};
+
+}  // namespace
+
+JITCache &Pipeline::get_jit_cache_for_call(const ParamMap &param_map) {
+    // A ParamMap may replace the values of the Params, so don't
+    // bother specializing calls that use one.
+    if (contents->jit_specialize_params.empty() ||
+        &param_map != &ParamMap::empty_map()) {
+        return contents->jit_cache;
+    }
+
+    auto &variants = contents->jit_specializations;
+    auto &pending = contents->pending_jit_specialization;
+
+    auto add_variant = [&](vector<uint64_t> key, JITCache cache) {
+        variants.push_front({std::move(key), std::move(cache)});
+        while (variants.size() > contents->max_jit_specializations) {
+            variants.pop_back();
+        }
+    };
+
+    if (pending.valid() &&
+        pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        add_variant(std::move(contents->pending_jit_specialization_key), pending.get());
+    }
+
+    vector<uint64_t> key;
+    vector<std::pair<Parameter, Expr>> values;
+    for (const Parameter &p : contents->jit_specialize_params) {
+        uint64_t bits = 0;
+        memcpy(&bits, p.scalar_address(), p.type().bytes());
+        key.push_back(bits);
+        values.emplace_back(p, p.scalar_expr());
+    }
+
+    for (auto it = variants.begin(); it != variants.end(); it++) {
+        if (it->key == key) {
+            variants.splice(variants.begin(), variants, it);
+            return variants.front().cache;
+        }
+    }
+
+    if (pending.valid()) {
+        // Still compiling some other variant. Only one is compiled at a time.
+        return contents->jit_cache;
+    }
+
+    debug(2) << "Compiling jit variant specialized on current Param values\n";
+
+    // Substitute the values into a copy of the pipeline. Everything
+    // the compilation needs is copied, so that it can proceed on
+    // another thread.
+    auto [outputs, env] = deep_copy(contents->outputs, build_environment(contents->outputs));
+    SubstituteParams substitute_params(values);
+    for (auto &it : env) {
+        it.second.mutate(&substitute_params);
+    }
+    vector<Stmt> requirements;
+    for (const Stmt &s : contents->requirements) {
+        requirements.push_back(substitute_params.mutate(s));
+    }
+    vector<Argument> args;
+    for (const InferredArgument &arg : contents->inferred_args) {
+        args.push_back(arg.arg);
+    }
+    vector<IRMutator *> custom_passes;
+    for (const CustomLoweringPass &p : contents->custom_lowering_passes) {
+        custom_passes.push_back(p.pass);
+    }
+    std::string fn_name = generate_function_name();
+    Target target = contents->jit_cache.jit_target;
+    std::map<std::string, JITExtern> jit_externs = contents->jit_externs;
+    bool trace_pipeline = contents->trace_pipeline;
+
+    auto compile = [=, outputs = std::move(outputs)]() {
+        Module module = lower(outputs, fn_name, target, args, LinkageType::ExternalPlusMetadata,
+                              requirements, trace_pipeline, custom_passes)
+                            .resolve_submodules();
+        return compile_jit_cache(module, args, outputs, jit_externs, target);
+    };
+
+    if (contents->jit_specialize_in_background) {
+        pending = std::async(std::launch::async, compile);
+        contents->pending_jit_specialization_key = std::move(key);
+        return contents->jit_cache;
+    } else {
+        add_variant(std::move(key), compile());
+        return variants.front().cache;
+    }
+}
+
 /*static*/ JITCache Pipeline::compile_jit_cache(const Module &module,
                                                 std::vector<Argument> args,
                                                 const std::vector<Internal::Function> &outputs,
@@ -667,7 +936,7 @@ Callable Pipeline::compile_to_callable(const std::vector<Argument> &args_in, con
 void Pipeline::set_jit_externs(const std::map<std::string, JITExtern> &externs) {
     user_assert(defined()) << "Pipeline is undefined\n";
     contents->jit_externs = externs;
-    invalidate_cache();
+    contents->invalidate_cache(JITCompileStats::JITExternsChanged);
 }
 
 const std::map<std::string, JITExtern> &Pipeline::get_jit_externs() {
@@ -677,7 +946,7 @@ const std::map<std::string, JITExtern> &Pipeline::get_jit_externs() {
 
 void Pipeline::add_custom_lowering_pass(IRMutator *pass, std::function<void()> deleter) {
     user_assert(defined()) << "Pipeline is undefined\n";
-    contents->invalidate_cache();
+    contents->invalidate_cache(JITCompileStats::CustomLoweringPassesChanged);
     CustomLoweringPass p = {pass, std::move(deleter)};
     contents->custom_lowering_passes.push_back(p);
 }
@@ -699,18 +968,29 @@ JITHandlers &Pipeline::jit_handlers() {
     return contents->jit_handlers;
 }
 
+const JITCompileStats &Pipeline::jit_compile_stats() const {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    return contents->jit_compile_stats;
+}
+
+void Pipeline::reset_jit_compile_stats() {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    contents->jit_compile_stats = JITCompileStats();
+}
+
 Realization Pipeline::realize(vector<int32_t> sizes, const Target &target,
                               const ParamMap &param_map) {
     return realize(nullptr, std::move(sizes), target, param_map);
 }
 
-Realization Pipeline::realize(JITUserContext *context,
-                              vector<int32_t> sizes,
-                              const Target &target,
-                              const ParamMap &param_map) {
-    user_assert(defined()) << "Pipeline is undefined\n";
+namespace {
+
+// Make buffers of the given sizes with no storage, one per output
+// value of the given Funcs.
+vector<Buffer<>> make_output_buffers(const vector<Function> &outputs,
+                                     const vector<int32_t> &sizes) {
     vector<Buffer<>> bufs;
-    for (auto &out : contents->outputs) {
+    for (const auto &out : outputs) {
         user_assert((int)sizes.size() == out.dimensions())
             << "Func " << out.name() << " is defined with " << out.dimensions() << " dimensions, but realize() is requesting a realization with " << sizes.size() << " dimensions.\n";
         user_assert(out.has_pure_definition() || out.has_extern_definition()) << "Can't realize Pipeline with undefined output Func: " << out.name() << ".\n";
@@ -718,7 +998,17 @@ Realization Pipeline::realize(JITUserContext *context,
             bufs.emplace_back(t, nullptr, sizes);
         }
     }
-    Realization r(std::move(bufs));
+    return bufs;
+}
+
+}  // namespace
+
+Realization Pipeline::realize(JITUserContext *context,
+                              vector<int32_t> sizes,
+                              const Target &target,
+                              const ParamMap &param_map) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    Realization r(make_output_buffers(contents->outputs, sizes));
     // Do an output bounds query if we can. Otherwise just assume the
     // output size is good.
     if (!target.has_feature(Target::NoBoundsQuery)) {
@@ -752,6 +1042,83 @@ Realization Pipeline::realize(JITUserContext *context,
     return r;
 }
 
+const Realization &Pipeline::realize_reusing_outputs(const vector<int32_t> &sizes,
+                                                     const Target &target,
+                                                     const ParamMap &param_map) {
+    return realize_reusing_outputs(nullptr, sizes, target, param_map);
+}
+
+const Realization &Pipeline::realize_reusing_outputs(JITUserContext *context,
+                                                     const vector<int32_t> &sizes,
+                                                     const Target &target,
+                                                     const ParamMap &param_map) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    PipelineContents::ReusedOutputs &reused = contents->reused_outputs;
+    const bool bounds_query = !target.has_feature(Target::NoBoundsQuery);
+
+    if (!reused.query || reused.sizes != sizes || reused.target != target) {
+        reused = PipelineContents::ReusedOutputs();
+        reused.query.emplace(make_output_buffers(contents->outputs, sizes));
+        reused.sizes = sizes;
+        reused.target = target;
+    }
+
+    Realization &query = *reused.query;
+    if (bounds_query) {
+        // The last bounds query may have changed the shape of the
+        // query buffers, so reset them to the requested sizes first.
+        for (size_t i = 0; i < query.size(); i++) {
+            halide_buffer_t *buf = query[i].raw_buffer();
+            int32_t stride = 1;
+            for (size_t d = 0; d < sizes.size(); d++) {
+                buf->dim[d] = halide_dimension_t(0, sizes[d], stride);
+                stride *= sizes[d];
+            }
+        }
+        realize(context, query, target, param_map);
+    }
+
+    bool same_shape = reused.full.has_value();
+    for (size_t i = 0; same_shape && i < query.size(); i++) {
+        for (int d = 0; d < query[i].dimensions(); d++) {
+            same_shape &= ((*reused.full)[i].dim(d).min() == query[i].dim(d).min() &&
+                           (*reused.full)[i].dim(d).extent() == query[i].dim(d).extent());
+        }
+    }
+
+    if (!same_shape) {
+        // Allocate outputs of the shape the bounds query asked for, and
+        // make new buffers for the next query.
+        reused.full.emplace(std::move(query));
+        reused.query.emplace(make_output_buffers(contents->outputs, sizes));
+        vector<Buffer<>> cropped;
+        for (size_t i = 0; i < reused.full->size(); i++) {
+            Buffer<> &buf = (*reused.full)[i];
+            buf.allocate();
+            bool needs_crop = false;
+            vector<std::pair<int32_t, int32_t>> crop(sizes.size());
+            for (size_t d = 0; d < sizes.size(); d++) {
+                needs_crop |= (buf.dim(d).extent() != sizes[d] ||
+                               buf.dim(d).min() != 0);
+                crop[d] = {0, sizes[d]};
+            }
+            cropped.push_back(needs_crop ? Buffer<>(buf.get()->cropped(crop), buf.name()) : buf);
+        }
+        reused.result.emplace(std::move(cropped));
+    }
+
+    // Do the actual computation
+    realize(context, *reused.full, target, param_map);
+
+    // Copy the uncropped buffers, as those are the ones the pipeline
+    // marked as dirty on the device.
+    for (size_t i = 0; i < reused.full->size(); i++) {
+        auto result = (*reused.full)[i].copy_to_host(context);
+        user_assert(result == halide_error_code_success) << "copy_to_host() failed with error: " << result;
+    }
+    return *reused.result;
+}
+
 void Pipeline::add_requirement(const Expr &condition, const std::vector<Expr> &error_args) {
     user_assert(defined()) << "Pipeline is undefined\n";
 
@@ -976,6 +1343,8 @@ void Pipeline::realize(JITUserContext *context,
     prepare_jit_call_arguments(outputs, target, param_map,
                                &context, false, args);
 
+    JITCache &jit_cache = get_jit_cache_for_call(param_map);
+
     // The handlers in the jit_context default to the default handlers
     // in the runtime of the shared module (e.g. halide_print_impl,
     // default_trace). As an example, here's what happens with a
@@ -1014,11 +1383,11 @@ void Pipeline::realize(JITUserContext *context,
     // exception.
 
     debug(2) << "Calling jitted function\n";
-    int exit_status = call_jit_code(target, args);
+    int exit_status = jit_cache.call_jit_code(target, args.store);
     debug(2) << "Back from jitted function. Exit status was " << exit_status << "\n";
 
     // If we're profiling, report runtimes and reset profiler stats.
-    contents->jit_cache.finish_profiling(context);
+    jit_cache.finish_profiling(context);
 
     jit_call_context.finalize(exit_status);
 }
@@ -1157,6 +1526,172 @@ void Pipeline::infer_input_bounds(JITUserContext *context,
     infer_input_bounds(context, r, target, param_map);
 }
 
+void Pipeline::realize_tiled(const std::vector<int32_t> &sizes,
+                             const std::vector<int32_t> &tile_sizes,
+                             const TiledInputProvider &provide_input,
+                             const TiledOutputConsumer &consume_output,
+                             bool prefetch,
+                             const Target &target,
+                             const ParamMap &param_map) {
+    realize_tiled(nullptr, sizes, tile_sizes, provide_input, consume_output, prefetch, target, param_map);
+}
+
+void Pipeline::realize_tiled(JITUserContext *context,
+                             const std::vector<int32_t> &sizes,
+                             const std::vector<int32_t> &tile_sizes,
+                             const TiledInputProvider &provide_input,
+                             const TiledOutputConsumer &consume_output,
+                             bool prefetch,
+                             const Target &t,
+                             const ParamMap &param_map) {
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+    user_assert(sizes.size() == tile_sizes.size())
+        << "realize_tiled() was given " << sizes.size() << " sizes but "
+        << tile_sizes.size() << " tile sizes.\n";
+    for (auto &out : contents->outputs) {
+        user_assert((int)sizes.size() == out.dimensions())
+            << "Func " << out.name() << " is defined with " << out.dimensions()
+            << " dimensions, but realize_tiled() is requesting a realization with "
+            << sizes.size() << " dimensions.\n";
+    }
+    for (size_t d = 0; d < sizes.size(); d++) {
+        user_assert(sizes[d] > 0 && tile_sizes[d] > 0)
+            << "realize_tiled() requires positive sizes and tile sizes.\n";
+    }
+
+    Target target = t;
+    if (target.has_unknowns()) {
+        target = get_compiled_jit_target();
+        if (target.has_unknowns()) {
+            target = get_jit_target_from_environment();
+        }
+    }
+    user_assert(!target.has_feature(Target::NoBoundsQuery))
+        << "You may not call realize_tiled() with Target::NoBoundsQuery set.\n";
+    compile_jit(target);
+
+    // The inputs to provide per tile are those not already bound.
+    vector<Parameter> streamed;
+    for (const InferredArgument &ia : contents->inferred_args) {
+        if (ia.param.defined() && ia.param.is_buffer() && !ia.param.buffer().defined()) {
+            streamed.push_back(ia.param);
+        }
+    }
+
+    struct Tile {
+        // The region of the output, as (min, extent) pairs.
+        vector<std::pair<int, int>> region;
+        vector<Buffer<>> outputs;
+        vector<Buffer<>> inputs;
+    };
+
+    // Do bounds inference for a tile, and allocate its buffers.
+    auto prepare_tile = [&](const vector<std::pair<int, int>> &region) {
+        Tile tile;
+        tile.region = region;
+        vector<int> extents;
+        for (const auto &r : region) {
+            extents.push_back(r.second);
+        }
+        for (auto &out : contents->outputs) {
+            for (Type type : out.output_types()) {
+                Buffer<> b(type, nullptr, extents);
+                for (size_t d = 0; d < region.size(); d++) {
+                    b.translate((int)d, region[d].first);
+                }
+                tile.outputs.push_back(b);
+            }
+        }
+        Realization r(tile.outputs);
+        infer_input_bounds(context, r, target, param_map);
+        for (Parameter &p : streamed) {
+            tile.inputs.push_back(p.buffer());
+            p.set_buffer(Buffer<>());
+        }
+        for (Buffer<> &b : tile.outputs) {
+            // The bounds query may have grown the output if it is
+            // constrained, so allocate it here rather than at the
+            // tile size.
+            b.allocate();
+        }
+        return tile;
+    };
+
+    auto provide_inputs = [&](Tile *tile) {
+        for (size_t i = 0; i < streamed.size(); i++) {
+            if (tile->inputs[i].defined()) {
+                provide_input(streamed[i].name(), tile->inputs[i]);
+                tile->inputs[i].set_host_dirty();
+            }
+        }
+    };
+
+    auto run_tile = [&](Tile *tile) {
+        for (size_t i = 0; i < streamed.size(); i++) {
+            streamed[i].set_buffer(tile->inputs[i]);
+        }
+        Realization r(tile->outputs);
+        realize(context, r, target, param_map);
+        for (Parameter &p : streamed) {
+            p.set_buffer(Buffer<>());
+        }
+        for (size_t i = 0; i < r.size(); i++) {
+            r[i].crop(tile->region);
+            auto result = r[i].copy_to_host(context);
+            user_assert(result == halide_error_code_success) << "copy_to_host() failed with error: " << result;
+        }
+        consume_output(r);
+    };
+
+    // Walk the tiles with the first dimension innermost.
+    vector<vector<std::pair<int, int>>> regions;
+    vector<int> pos(sizes.size(), 0);
+    while (true) {
+        vector<std::pair<int, int>> region;
+        for (size_t d = 0; d < sizes.size(); d++) {
+            region.emplace_back(pos[d], std::min(tile_sizes[d], sizes[d] - pos[d]));
+        }
+        regions.push_back(region);
+        size_t d = 0;
+        while (d < sizes.size()) {
+            pos[d] += tile_sizes[d];
+            if (pos[d] < sizes[d]) {
+                break;
+            }
+            pos[d] = 0;
+            d++;
+        }
+        if (d == sizes.size()) {
+            break;
+        }
+    }
+
+    Tile current = prepare_tile(regions[0]);
+    provide_inputs(&current);
+    for (size_t i = 0; i < regions.size(); i++) {
+        // Bounds inference calls into the pipeline, so it happens on
+        // this thread, but filling in the next tile's inputs can
+        // overlap with computing this one.
+        Tile next;
+        std::future<void> pending;
+        if (i + 1 < regions.size()) {
+            next = prepare_tile(regions[i + 1]);
+            if (prefetch) {
+                pending = std::async(std::launch::async, provide_inputs, &next);
+            }
+        }
+        run_tile(&current);
+        if (i + 1 < regions.size()) {
+            if (pending.valid()) {
+                pending.get();
+            } else {
+                provide_inputs(&next);
+            }
+            current = std::move(next);
+        }
+    }
+}
+
 void Pipeline::invalidate_cache() {
     if (defined()) {
         contents->invalidate_cache();
@@ -103,6 +103,16 @@ class Pipeline;
 
 using AutoSchedulerFn = std::function<void(const Pipeline &, const Target &, const AutoschedulerParams &, AutoSchedulerResults *outputs)>;
 
+/** A callback used by Pipeline::realize_tiled to fill in a region of an
+ * input. The buffer has already been allocated with the shape of the
+ * region required of the named ImageParam. */
+using TiledInputProvider = std::function<void(const std::string &name, Buffer<> &region)>;
+
+/** A callback used by Pipeline::realize_tiled to receive a tile of the
+ * output. The Realization contains one Buffer per tuple component per
+ * output Func, cropped to the tile. */
+using TiledOutputConsumer = std::function<void(const Realization &tile)>;
+
 /** A class representing a Halide pipeline. Constructed from the Func
  * or Funcs that it outputs. */
 class Pipeline {
@@ -173,6 +183,11 @@ private:
                                                 const std::map<std::string, JITExtern> &jit_externs,
                                                 const Target &target_arg);
 
+    // Get the jit-compiled code to use for a call with the current
+    // values of the Params passed to specialize_jit_on, compiling a
+    // new variant if need be.
+    Internal::JITCache &get_jit_cache_for_call(const ParamMap &param_map);
+
 public:
     /** Make an undefined Pipeline object. */
     Pipeline();
@@ -190,6 +205,22 @@ public:
     /** Get the Funcs this pipeline outputs. */
     std::vector<Func> outputs() const;
 
+    /** Make a pipeline that computes the outputs of all of the given
+     * pipelines in a single call, in order. The requirements and JIT
+     * externs of the pipelines are carried over. This lets
+     * independent pipelines over the same large input be scheduled
+     * together, e.g. so that their outputs are computed with each
+     * other over a common tiling and each tile of the input is only
+     * loaded once:
+     \code
+     Pipeline thumbnail = ..., histogram = ...;
+     Pipeline both = Pipeline::combine({thumbnail, histogram});
+     \endcode
+     * The pipelines may share inputs and intermediate Funcs, but not
+     * outputs. Custom lowering passes are not carried over, and it is
+     * an error for any of the pipelines to have them. */
+    static Pipeline combine(const std::vector<Pipeline> &pipelines);
+
     /** Generate a schedule for the pipeline using the specified autoscheduler. */
     AutoSchedulerResults apply_autoscheduler(const Target &target,
                                              const AutoschedulerParams &autoscheduler_params) const;
@@ -349,6 +380,32 @@ public:
     Callable compile_to_callable(const std::vector<Argument> &args,
                                  const Target &target = get_jit_target_from_environment());
 
+    /** Like compile_to_callable above, but picks one of several targets
+     * at runtime, as compile_to_multitarget_static_library does for AOT
+     * compilation. The targets are considered in order, and the first
+     * one that halide_can_use_target_features says the host can use is
+     * compiled; the others are never compiled. The last target is used
+     * if none of the others can be, so it should be the most
+     * conservative one. All targets must have identical arch-os-bits. */
+    Callable compile_to_callable(const std::vector<Argument> &args,
+                                 const std::vector<Target> &targets);
+
+    /** Make the JIT specialize on the values some scalar Params take
+     * when realizing this Pipeline. The first time the Pipeline is
+     * realized with a combination of values for these Params that
+     * it hasn't seen before, a variant of the pipeline is compiled
+     * with those values substituted as constants. The max_variants
+     * most recently used variants are kept. This gets the effect of
+     * Func::specialize for each value that is used in practice,
+     * without having to list them. If compile_in_background is true,
+     * variants are compiled on another thread, and realizations
+     * use the generic version of the pipeline until the variant is
+     * ready. Realizations that pass a ParamMap always use the
+     * generic version. Pass an empty vector to turn this off. */
+    void specialize_jit_on(const std::vector<Expr> &params,
+                           int max_variants = 4,
+                           bool compile_in_background = true);
+
     /** Install a set of external C functions or Funcs to satisfy
      * dependencies introduced by HalideExtern and define_extern
      * mechanisms. These will be used by calls to realize,
@@ -364,6 +421,16 @@ public:
      * next time this Pipeline is realized. */
     JITHandlers &jit_handlers();
 
+    /** Get the counts of JIT compiles and cache hits of this Pipeline,
+     * how long the compiles took, and why cached code was
+     * discarded. These accumulate across invalidations of the cache
+     * until reset. Variants compiled by specialize_jit_on and
+     * Callables are not counted. */
+    const JITCompileStats &jit_compile_stats() const;
+
+    /** Reset the counters returned by jit_compile_stats to zero. */
+    void reset_jit_compile_stats();
+
     /** Add a custom pass to be used during lowering. It is run after
      * all other lowering passes. Can be used to verify properties of
      * the lowered Stmt, instrument it with extra code, or otherwise
@@ -403,6 +470,24 @@ public:
                         const Target &target = Target(),
                         const ParamMap &param_map = ParamMap::empty_map());
 
+    /** Like realize(sizes), but for calling in a loop. The Pipeline
+     * keeps the output buffers, and the next call for the same sizes
+     * and target runs into them instead of allocating new ones. They
+     * are only reallocated if the bounds query asks for a different
+     * shape. The returned Realization belongs to the Pipeline, so its
+     * contents are overwritten by the next call, and it is invalidated
+     * by a call with other sizes or target. Copy the buffers to keep
+     * them. */
+    // @{
+    const Realization &realize_reusing_outputs(const std::vector<int32_t> &sizes = {},
+                                               const Target &target = Target(),
+                                               const ParamMap &param_map = ParamMap::empty_map());
+    const Realization &realize_reusing_outputs(JITUserContext *context,
+                                               const std::vector<int32_t> &sizes = {},
+                                               const Target &target = Target(),
+                                               const ParamMap &param_map = ParamMap::empty_map());
+    // @}
+
     /** Evaluate this Pipeline into an existing allocated buffer or
      * buffers. If the buffer is also one of the arguments to the
      * function, strange things may happen, as the pipeline isn't
@@ -451,6 +536,36 @@ public:
                             const ParamMap &param_map = ParamMap::empty_map());
     // @}
 
+    /** Realize the Pipeline over an output of the given size one tile at
+     * a time, for inputs and outputs too large to hold in memory at
+     * once. For each tile, the region required of each ImageParam that
+     * is not bound to a buffer is inferred (as in infer_input_bounds),
+     * and provide_input is called to fill in a buffer of that region.
+     * The tile is then realized, and passed to consume_output. The last
+     * row and column (etc.) of tiles may be smaller than tile_sizes. If
+     * prefetch is true, the inputs of the next tile are provided on
+     * another thread while the current tile is being computed and
+     * consumed, so provide_input must not depend on consume_output
+     * having been called for the previous tile. The ImageParams are left
+     * unbound afterwards. */
+    // @{
+    void realize_tiled(const std::vector<int32_t> &sizes,
+                       const std::vector<int32_t> &tile_sizes,
+                       const TiledInputProvider &provide_input,
+                       const TiledOutputConsumer &consume_output,
+                       bool prefetch = true,
+                       const Target &target = Target(),
+                       const ParamMap &param_map = ParamMap::empty_map());
+    void realize_tiled(JITUserContext *context,
+                       const std::vector<int32_t> &sizes,
+                       const std::vector<int32_t> &tile_sizes,
+                       const TiledInputProvider &provide_input,
+                       const TiledOutputConsumer &consume_output,
+                       bool prefetch = true,
+                       const Target &target = Target(),
+                       const ParamMap &param_map = ParamMap::empty_map());
+    // @}
+
     /** Infer the arguments to the Pipeline, sorted into a canonical order:
      * all buffers (sorted alphabetically by name), followed by all non-buffers
      * (sorted alphabetically by name).
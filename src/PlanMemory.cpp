@@ -0,0 +1,441 @@
+#include <algorithm>
+#include <limits>
+#include <map>
+
+#include "Bounds.h"
+#include "CodeGen_Internal.h"
+#include "CompilerLogger.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "PlanMemory.h"
+#include "Simplify.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Offsets into the arena are aligned to this many bytes, which is at
+// least the alignment of a block returned by halide_malloc.
+constexpr int64_t arena_alignment = 128;
+
+int64_t align_up(int64_t x) {
+    return (x + arena_alignment - 1) / arena_alignment * arena_alignment;
+}
+
+struct Lifetime {
+    string name;
+    int64_t bytes = 0;
+    // The first and last times at which the allocation is used. An
+    // allocation that is never used has first > last.
+    int first = std::numeric_limits<int>::max(), last = -1;
+    int64_t offset = 0;
+
+    bool overlaps(const Lifetime &other) const {
+        return first <= other.last && other.first <= last;
+    }
+};
+
+// Walk the statements outside of any loop in order, giving each one a
+// time, and record when each candidate allocation is used. A loop (or
+// anything else that isn't part of the block structure of the
+// pipeline) is a single step, however many times it runs. When planning
+// VTCM, serial loops are walked into as well, as VTCM is small and each
+// allocation of it is a system call. So are they when planning a static
+// workspace, which must hold every allocation.
+class FindLifetimes : public IRVisitor {
+    using IRVisitor::visit;
+
+    MemoryType memory_type;
+    bool walk_serial_loops;
+    int time = 0;
+    bool in_step = false;
+    Scope<int> candidates;
+    Scope<Interval> bounds;
+
+    // Returns the size in bytes of an allocation that could go in the
+    // arena, or zero if it can't.
+    int64_t arena_bytes(const Allocate *op) {
+        const bool right_type =
+            memory_type == MemoryType::Heap ?
+                (op->memory_type == MemoryType::Heap || op->memory_type == MemoryType::Auto) :
+                op->memory_type == memory_type;
+        if (op->new_expr.defined() ||
+            !op->free_function.empty() ||
+            op->extents.empty() ||
+            !right_type) {
+            return 0;
+        }
+
+        int64_t elems = Allocate::constant_allocation_size(op->extents, op->name);
+        bool constant_size = elems > 0;
+        if (!constant_size) {
+            Expr size = make_one(Int(64));
+            for (const Expr &e : op->extents) {
+                size *= cast<int64_t>(e);
+            }
+            Expr bound = find_constant_bound(simplify(size), Direction::Upper, bounds);
+            const int64_t *b = as_const_int(bound);
+            if (!b || *b <= 0 || *b > std::numeric_limits<int32_t>::max()) {
+                return 0;
+            }
+            elems = *b;
+        }
+
+        int64_t bytes = (elems + op->padding) * op->type.bytes();
+        if (op->memory_type == MemoryType::Auto &&
+            constant_size &&
+            can_allocation_fit_on_stack(bytes)) {
+            // This would go on the stack anyway.
+            return 0;
+        }
+        return bytes;
+    }
+
+    void use(const string &name) {
+        string n = name;
+        if (!candidates.contains(n) && ends_with(n, ".buffer")) {
+            n = n.substr(0, n.size() - 7);
+        }
+        if (candidates.contains(n)) {
+            Lifetime &l = lifetimes[candidates.get(n)];
+            l.first = std::min(l.first, time);
+            l.last = std::max(l.last, time);
+        }
+    }
+
+    void step(const Stmt &s) {
+        time++;
+        ScopedValue<bool> old_in_step(in_step, true);
+        s.accept(this);
+    }
+
+    void step(const Expr &e) {
+        if (e.defined()) {
+            time++;
+            ScopedValue<bool> old_in_step(in_step, true);
+            e.accept(this);
+        }
+    }
+
+    void visit_stmt(const Stmt &s) {
+        const For *loop = s.as<For>();
+        if (s.as<Block>() ||
+            s.as<Allocate>() ||
+            s.as<LetStmt>() ||
+            s.as<ProducerConsumer>() ||
+            s.as<IfThenElse>() ||
+            (loop && loop->for_type == ForType::Serial && walk_serial_loops)) {
+            s.accept(this);
+        } else {
+            step(s);
+        }
+    }
+
+    void visit(const Block *op) override {
+        if (in_step) {
+            IRVisitor::visit(op);
+            return;
+        }
+        visit_stmt(op->first);
+        visit_stmt(op->rest);
+    }
+
+    void visit(const LetStmt *op) override {
+        if (in_step) {
+            IRVisitor::visit(op);
+            return;
+        }
+        step(op->value);
+        ScopedBinding<Interval> bind(bounds, op->name, find_constant_bounds(op->value, bounds));
+        visit_stmt(op->body);
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        if (in_step) {
+            IRVisitor::visit(op);
+            return;
+        }
+        visit_stmt(op->body);
+    }
+
+    void visit(const IfThenElse *op) override {
+        if (in_step) {
+            IRVisitor::visit(op);
+            return;
+        }
+        step(op->condition);
+        visit_stmt(op->then_case);
+        if (op->else_case.defined()) {
+            visit_stmt(op->else_case);
+        }
+    }
+
+    void visit(const For *op) override {
+        if (in_step) {
+            IRVisitor::visit(op);
+            return;
+        }
+        step(op->min);
+        step(op->extent);
+        Interval min_bounds = find_constant_bounds(op->min, bounds);
+        Interval max_bounds = find_constant_bounds(op->min + op->extent - 1, bounds);
+        ScopedBinding<Interval> bind(bounds, op->name, Interval(min_bounds.min, max_bounds.max));
+        const size_t outside = lifetimes.size();
+        const int start = time + 1;
+        visit_stmt(op->body);
+        // The body runs many times, so an allocation made outside the
+        // loop and used inside it is live for the whole loop.
+        for (size_t i = 0; i < outside; i++) {
+            Lifetime &l = lifetimes[i];
+            if (l.last >= start) {
+                l.first = std::min(l.first, start);
+                l.last = std::max(l.last, time);
+            }
+        }
+    }
+
+    void visit(const Allocate *op) override {
+        if (in_step) {
+            IRVisitor::visit(op);
+            return;
+        }
+        for (const Expr &e : op->extents) {
+            step(e);
+        }
+        step(op->condition);
+        step(op->new_expr);
+
+        int64_t bytes = arena_bytes(op);
+        if (bytes > 0) {
+            Lifetime l;
+            l.name = op->name;
+            l.bytes = bytes;
+            lifetimes.push_back(l);
+            ScopedBinding<int> bind(candidates, op->name, (int)lifetimes.size() - 1);
+            visit_stmt(op->body);
+        } else {
+            visit_stmt(op->body);
+        }
+    }
+
+    void visit(const Variable *op) override {
+        use(op->name);
+    }
+
+    void visit(const Load *op) override {
+        use(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Store *op) override {
+        use(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        use(op->name);
+        IRVisitor::visit(op);
+    }
+
+public:
+    vector<Lifetime> lifetimes;
+
+    FindLifetimes(MemoryType memory_type, bool walk_serial_loops)
+        : memory_type(memory_type), walk_serial_loops(walk_serial_loops) {
+    }
+
+    void find(const Stmt &s) {
+        visit_stmt(s);
+    }
+};
+
+// Give each allocation the lowest offset at which it doesn't overlap
+// anything live at the same time, placing the largest ones first.
+// Returns the size of the arena.
+int64_t assign_offsets(vector<Lifetime> &lifetimes) {
+    vector<int> order(lifetimes.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = (int)i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return lifetimes[a].bytes > lifetimes[b].bytes;
+    });
+
+    int64_t total = 0;
+    vector<const Lifetime *> placed;
+    for (int i : order) {
+        Lifetime &l = lifetimes[i];
+        vector<const Lifetime *> live;
+        for (const Lifetime *p : placed) {
+            if (p->overlaps(l)) {
+                live.push_back(p);
+            }
+        }
+        std::sort(live.begin(), live.end(), [](const Lifetime *a, const Lifetime *b) {
+            return a->offset < b->offset;
+        });
+        int64_t offset = 0;
+        for (const Lifetime *p : live) {
+            if (offset + l.bytes <= p->offset) {
+                break;
+            }
+            offset = std::max(offset, align_up(p->offset + p->bytes));
+        }
+        l.offset = offset;
+        total = std::max(total, offset + l.bytes);
+        placed.push_back(&l);
+    }
+    return total;
+}
+
+// Point each planned allocation at its offset in the arena.
+class PlaceInArena : public IRMutator {
+    using IRMutator::visit;
+
+    const string &arena;
+    const map<string, int64_t> &offsets;
+    MemoryType memory_type;
+
+    Stmt visit(const Allocate *op) override {
+        auto it = offsets.find(op->name);
+        if (it == offsets.end()) {
+            return IRMutator::visit(op);
+        }
+        Expr base = reinterpret(UInt(64), Variable::make(Handle(), arena));
+        Expr new_expr = reinterpret(Handle(), base + make_const(UInt(64), it->second));
+        return Allocate::make(op->name, op->type, memory_type, op->extents,
+                              op->condition, mutate(op->body), new_expr,
+                              "halide_device_host_nop_free", op->padding);
+    }
+
+public:
+    PlaceInArena(const string &arena, const map<string, int64_t> &offsets, MemoryType memory_type)
+        : arena(arena), offsets(offsets), memory_type(memory_type) {
+    }
+};
+
+// Reject any heap allocation left after planning a static workspace.
+class CheckNoHeapAllocations : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &pipeline_name;
+    bool in_parallel_loop = false;
+
+    void visit(const For *op) override {
+        ScopedValue<bool> old(in_parallel_loop, in_parallel_loop || op->is_parallel());
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Allocate *op) override {
+        const bool heap = op->memory_type == MemoryType::Heap || op->memory_type == MemoryType::Auto;
+        if (heap && !op->new_expr.defined() && !op->extents.empty()) {
+            int64_t elems = Allocate::constant_allocation_size(op->extents, op->name);
+            bool on_stack = op->memory_type == MemoryType::Auto &&
+                            elems > 0 &&
+                            can_allocation_fit_on_stack((elems + op->padding) * op->type.bytes());
+            user_assert(on_stack)
+                << "Can't place the allocation of " << op->name
+                << " in the static workspace of pipeline " << pipeline_name << ", "
+                << (in_parallel_loop ?
+                        "because it is inside a parallel loop." :
+                        "because its size is not bounded at compile time.")
+                << " Allocations in pipelines compiled with the static_workspace target feature "
+                << "must have a constant bound, and must not be made once per iteration of a parallel loop. "
+                << "Try bounding the Func with Func::bound_storage, or scheduling it outside of the parallel loop.\n";
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    CheckNoHeapAllocations(const string &pipeline_name)
+        : pipeline_name(pipeline_name) {
+    }
+};
+
+}  // namespace
+
+Stmt plan_memory(const Stmt &s, const Target &t, MemoryType memory_type) {
+    internal_assert(memory_type == MemoryType::Heap || memory_type == MemoryType::VTCM);
+    FindLifetimes finder(memory_type, memory_type == MemoryType::VTCM);
+    finder.find(s);
+    vector<Lifetime> &lifetimes = finder.lifetimes;
+    if (lifetimes.empty() ||
+        (lifetimes.size() < 2 && memory_type == MemoryType::Heap)) {
+        // Nothing to share, and no allocator calls to save. (A single
+        // VTCM allocation may have been hoisted out of a loop.)
+        return s;
+    }
+
+    int64_t total = assign_offsets(lifetimes);
+    int64_t max_size = std::min<int64_t>(t.maximum_buffer_size(),
+                                         std::numeric_limits<int32_t>::max());
+    if (total > max_size) {
+        return s;
+    }
+
+    map<string, int64_t> offsets;
+    int64_t sum = 0;
+    for (const Lifetime &l : lifetimes) {
+        debug(3) << "Placing " << l.name << " (" << l.bytes << " bytes, live "
+                 << l.first << " to " << l.last << ") at offset " << l.offset << "\n";
+        offsets[l.name] = l.offset;
+        sum += l.bytes;
+    }
+    debug(2) << "Packed " << lifetimes.size() << " allocations totalling "
+             << sum << " bytes into an arena of " << total << " bytes\n";
+
+    string arena = unique_name(memory_type == MemoryType::VTCM ? "vtcm_plan_arena" : "memory_plan_arena");
+    Stmt body = PlaceInArena(arena, offsets, memory_type).mutate(s);
+    return Allocate::make(arena, UInt(8), memory_type, {(int32_t)total},
+                          const_true(), body);
+}
+
+Stmt plan_static_workspace(const Stmt &s, const Target &t, const string &pipeline_name) {
+    FindLifetimes finder(MemoryType::Heap, true);
+    finder.find(s);
+    vector<Lifetime> &lifetimes = finder.lifetimes;
+
+    int64_t total = assign_offsets(lifetimes);
+    int64_t max_size = std::min<int64_t>(t.maximum_buffer_size(),
+                                         std::numeric_limits<int32_t>::max());
+    user_assert(total <= max_size)
+        << "The static workspace of pipeline " << pipeline_name << " would need "
+        << total << " bytes, which is more than the maximum buffer size for target " << t << "\n";
+
+    debug(1) << "Pipeline " << pipeline_name << " needs a static workspace of " << total << " bytes\n";
+    if (CompilerLogger *logger = get_compiler_logger()) {
+        logger->record_static_workspace_size(pipeline_name, total);
+    }
+
+    Stmt result = s;
+    if (!lifetimes.empty()) {
+        map<string, int64_t> offsets;
+        for (const Lifetime &l : lifetimes) {
+            debug(3) << "Placing " << l.name << " (" << l.bytes << " bytes, live "
+                     << l.first << " to " << l.last << ") at offset " << l.offset << "\n";
+            offsets[l.name] = l.offset;
+        }
+
+        string arena = unique_name("static_workspace");
+        Stmt body = PlaceInArena(arena, offsets, MemoryType::Heap).mutate(s);
+        Type size_type = UInt(t.bits == 64 ? 64 : 32);
+        Expr workspace = Call::make(Handle(), "halide_static_workspace_malloc",
+                                    {make_const(size_type, total)}, Call::Extern);
+        result = Allocate::make(arena, UInt(8), MemoryType::Heap, {(int32_t)total},
+                                const_true(), body, workspace, "halide_device_host_nop_free");
+    }
+
+    CheckNoHeapAllocations checker(pipeline_name);
+    result.accept(&checker);
+    return result;
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,43 @@
+#ifndef HALIDE_PLAN_MEMORY_H
+#define HALIDE_PLAN_MEMORY_H
+
+/** \file
+ * Defines the lowering pass that packs the heap allocations of a
+ * pipeline's intermediates into a single block of memory.
+ */
+
+#include <string>
+
+#include "Expr.h"
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+/** Find the heap allocations outside of any loop that have a constant
+ * (or constant-bounded) size, work out when each is first and last
+ * used, and give each an offset into a single arena so that
+ * allocations that are never live at the same time share memory. The
+ * arena is allocated once around the whole statement, which lowers
+ * both the peak memory use and the number of calls to the allocator.
+ *
+ * With a memory_type of MemoryType::VTCM, the VTCM allocations are
+ * planned instead, including those inside serial loops, which are
+ * then reserved once rather than once per iteration. */
+Stmt plan_memory(const Stmt &s, const Target &t, MemoryType memory_type = MemoryType::Heap);
+
+/** Place every heap allocation of a pipeline, including those inside
+ * serial loops, in a single workspace of a size fixed at compile time,
+ * which the pipeline gets from halide_static_workspace_malloc instead
+ * of halide_malloc. Used for the static_workspace target feature. It
+ * is a user error for any heap allocation to remain, e.g. one without a
+ * constant bound or one inside a parallel loop. The size of the
+ * workspace is reported to the CompilerLogger. */
+Stmt plan_static_workspace(const Stmt &s, const Target &t, const std::string &pipeline_name);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
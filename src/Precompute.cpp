@@ -0,0 +1,69 @@
+#include "Precompute.h"
+
+#include "Func.h"
+#include "IROperator.h"
+#include "Pipeline.h"
+#include "Util.h"
+
+namespace Halide {
+
+using std::string;
+using std::vector;
+
+Func precompute(const Func &f, const Region &region, const string &func_name) {
+    user_assert(f.defined())
+        << "Can't precompute an undefined Func.\n";
+    const int dims = f.dimensions();
+    user_assert((int)region.size() == dims)
+        << "Can't precompute Func " << f.name() << " over a region with " << region.size()
+        << " dimensions, because it has " << dims << " dimensions.\n";
+
+    vector<int> mins, extents;
+    for (const Range &r : region) {
+        const int64_t *min = as_const_int(r.min);
+        const int64_t *extent = as_const_int(r.extent);
+        user_assert(min && extent)
+            << "Can't precompute Func " << f.name() << " over a region that isn't constant: "
+            << r.min << ", " << r.extent << "\n";
+        user_assert(*extent > 0)
+            << "Can't precompute Func " << f.name() << " over an empty region.\n";
+        mins.push_back((int)*min);
+        extents.push_back((int)*extent);
+    }
+
+    Pipeline p(f);
+    vector<Argument> args = p.infer_arguments();
+    user_assert(args.empty())
+        << "Can't precompute Func " << f.name() << ", because it depends on "
+        << args[0].name << ", which isn't known until the pipeline runs.\n";
+
+    // The Buffers are embedded by name, so they must have distinct names
+    // even if this is used more than once in a pipeline.
+    const string name = Internal::unique_name(func_name);
+
+    vector<Buffer<>> buffers;
+    for (size_t i = 0; i < f.types().size(); i++) {
+        Buffer<> b(f.types()[i], extents, name + "_data" + (f.outputs() > 1 ? "_" + std::to_string(i) : ""));
+        for (int d = 0; d < dims; d++) {
+            b.translate(d, mins[d]);
+        }
+        buffers.push_back(std::move(b));
+    }
+    p.realize(Realization(buffers), get_host_target());
+
+    vector<Var> vars;
+    for (int i = 0; i < dims; i++) {
+        vars.emplace_back(name + "_v" + std::to_string(i));
+    }
+    vector<Expr> call_args(vars.begin(), vars.end());
+    vector<Expr> values;
+    for (const Buffer<> &b : buffers) {
+        values.push_back(b(call_args));
+    }
+
+    Func result(name);
+    result(vars) = Tuple(values);
+    return result;
+}
+
+}  // namespace Halide
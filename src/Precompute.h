@@ -0,0 +1,38 @@
+#ifndef HALIDE_PRECOMPUTE_H
+#define HALIDE_PRECOMPUTE_H
+
+/** \file
+ * Defines a helper that evaluates constant Funcs at compile time, so that
+ * they are embedded in the compiled pipeline as constant Buffers.
+ */
+
+#include <string>
+
+#include "Expr.h"
+
+namespace Halide {
+
+class Func;
+
+/** Evaluate f over the given region now, using the JIT on the host,
+ * and return a Func that reads the result from a Buffer. Pipelines
+ * that use the returned Func embed that Buffer in the compiled code
+ * as read-only, aligned data, instead of computing f when they
+ * run. This is useful for repacking constant weights, lookup tables
+ * or filter taps into the layout the pipeline wants, e.g.:
+ \code
+ Buffer<float> weights = ...;
+ Func packed;
+ packed(k, x, y) = weights(x * 8 + k, y);
+ Func prepacked = precompute(packed, {{0, 8}, {0, weights.dim(0).extent() / 8}, {0, weights.dim(1).extent()}});
+ \endcode
+ *
+ * f must only depend on constants and Buffers, not on Params or
+ * ImageParams, and the region must be constant. The returned Func
+ * is only meaningful within the region. f can be scheduled as usual
+ * before calling this, but it can't be changed afterwards. */
+Func precompute(const Func &f, const Region &region, const std::string &name = "precomputed");
+
+}  // namespace Halide
+
+#endif
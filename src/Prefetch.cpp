@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cstdlib>
 #include <map>
 #include <string>
 #include <utility>
@@ -6,11 +7,13 @@
 #include "Bounds.h"
 #include "ExprUsesVar.h"
 #include "Function.h"
+#include "IREquality.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "Prefetch.h"
 #include "Scope.h"
 #include "Simplify.h"
+#include "Substitute.h"
 #include "Target.h"
 #include "Util.h"
 
@@ -18,6 +21,7 @@ namespace Halide {
 namespace Internal {
 
 using std::map;
+using std::pair;
 using std::set;
 using std::string;
 using std::vector;
@@ -391,6 +395,333 @@ public:
     }
 };
 
+// A conservative lower bound on the size of a cache line.
+int cache_line_bytes(const Target &t) {
+    // ARM's cache line size can be 32 or 64 bytes and it can switch the
+    // size at runtime. To be safe, we just use 32 bytes.
+    return t.arch == Target::ARM ? 32 : 64;
+}
+
+// Roughly how many cycles a load that misses in every level of cache
+// takes. Automatic prefetches are issued far enough ahead to hide this.
+constexpr int memory_latency_cycles = 300;
+
+// Never prefetch further ahead than this many iterations, as the data
+// may be evicted again before it is used.
+constexpr int max_prefetch_distance = 64;
+
+// Estimate the number of cycles an iteration of a loop body takes,
+// assuming one cycle per operation, and counting vectorized operations
+// once.
+class EstimateIterationCost : public IRVisitor {
+    using IRVisitor::visit;
+
+    int multiplier = 1;
+
+    void visit(const For *op) override {
+        const int64_t *extent = as_const_int(op->extent);
+        int old_multiplier = multiplier;
+        if (op->for_type == ForType::Unrolled && extent) {
+            multiplier *= (int)*extent;
+        }
+        IRVisitor::visit(op);
+        multiplier = old_multiplier;
+    }
+
+    template<typename T>
+    void count(const T *op) {
+        cost += multiplier;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Add *op) override {
+        count(op);
+    }
+    void visit(const Sub *op) override {
+        count(op);
+    }
+    void visit(const Mul *op) override {
+        count(op);
+    }
+    void visit(const Div *op) override {
+        count(op);
+    }
+    void visit(const Mod *op) override {
+        count(op);
+    }
+    void visit(const Min *op) override {
+        count(op);
+    }
+    void visit(const Max *op) override {
+        count(op);
+    }
+    void visit(const Select *op) override {
+        count(op);
+    }
+    void visit(const Cast *op) override {
+        count(op);
+    }
+    void visit(const Load *op) override {
+        count(op);
+    }
+    void visit(const Store *op) override {
+        count(op);
+    }
+    void visit(const Call *op) override {
+        count(op);
+    }
+
+public:
+    int cost = 0;
+};
+
+class ContainsLoad : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Load *op) override {
+        result = true;
+    }
+
+public:
+    bool result = false;
+};
+
+// A load in a loop body worth prefetching ahead of.
+struct StridedLoad {
+    string name;
+    Type type;
+    // The index of the first element loaded by an iteration of the loop
+    Expr index;
+    // The change in the index from one iteration to the next
+    Expr stride;
+    // The extents and strides of any vectorized or unrolled loops inside
+    // the loop, innermost first, in the format of a prefetch call.
+    vector<Expr> dims;
+};
+
+// Find the loads in the body of a loop that stride through memory by at
+// least a cache line per iteration, such as those of a column pass or a
+// transpose. The hardware prefetchers track these poorly. Loads with
+// data-dependent indices are skipped, as computing their future address
+// could read out of bounds.
+class FindStridedLoads : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &loop_var;
+    const int line_bytes;
+
+    // The lets inside the loop body, outermost first
+    vector<pair<string, Expr>> lets;
+    // The vectorized and unrolled loops inside the loop body, outermost first
+    struct InnerLoop {
+        string name;
+        Expr min, extent;
+    };
+    vector<InnerLoop> inner_loops;
+    // The buffers allocated inside the loop body
+    set<string> allocated;
+
+    Expr substitute_lets(Expr e) const {
+        for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+            e = substitute(it->first, it->second, e);
+        }
+        return simplify(e);
+    }
+
+    bool uses_inner_vars(const Expr &e) const {
+        if (expr_uses_var(e, loop_var)) {
+            return true;
+        }
+        for (const InnerLoop &l : inner_loops) {
+            if (expr_uses_var(e, l.name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Expr difference(const Expr &e, const string &var) const {
+        Expr v = Variable::make(Int(32), var);
+        return simplify(substitute(var, v + 1, e) - e);
+    }
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        lets.emplace_back(op->name, op->value);
+        op->body.accept(this);
+        lets.pop_back();
+    }
+
+    void visit(const Let *op) override {
+        op->value.accept(this);
+        lets.emplace_back(op->name, op->value);
+        op->body.accept(this);
+        lets.pop_back();
+    }
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        inner_loops.push_back({op->name, substitute_lets(op->min), substitute_lets(op->extent)});
+        op->body.accept(this);
+        inner_loops.pop_back();
+    }
+
+    void visit(const Allocate *op) override {
+        allocated.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Load *op) override {
+        IRVisitor::visit(op);
+        if (allocated.count(op->name) || !is_const_one(op->predicate) || op->type.is_vector()) {
+            return;
+        }
+
+        Expr index = substitute_lets(op->index);
+        ContainsLoad contains_load;
+        index.accept(&contains_load);
+        if (contains_load.result || !expr_uses_var(index, loop_var)) {
+            return;
+        }
+
+        Expr stride = difference(index, loop_var);
+        if (uses_inner_vars(stride) || is_const_zero(stride)) {
+            return;
+        }
+        const int64_t *const_stride = as_const_int(stride);
+        if (const_stride && std::abs(*const_stride) * op->type.bytes() < line_bytes) {
+            // Consecutive iterations mostly touch the same cache lines.
+            return;
+        }
+
+        vector<Expr> dims;
+        for (auto it = inner_loops.rbegin(); it != inner_loops.rend(); it++) {
+            Expr inner_stride = difference(index, it->name);
+            if (is_const_zero(inner_stride)) {
+                continue;
+            }
+            if (uses_inner_vars(inner_stride) || !is_const(it->extent)) {
+                return;
+            }
+            dims.push_back(it->extent);
+            dims.push_back(inner_stride);
+        }
+        if (dims.empty()) {
+            dims = {1, 1};
+        }
+
+        // Start from the first iteration of the inner loops.
+        for (auto it = inner_loops.rbegin(); it != inner_loops.rend(); it++) {
+            index = substitute(it->name, it->min, index);
+        }
+        index = simplify(index);
+
+        // Skip loads that run along the same stream as one already found.
+        for (const StridedLoad &l : result) {
+            if (l.name == op->name && equal(l.stride, stride)) {
+                Expr diff = simplify(index - l.index);
+                const int64_t *const_diff = as_const_int(diff);
+                if ((const_diff && std::abs(*const_diff) * op->type.bytes() < line_bytes) ||
+                    can_prove(diff % stride == 0)) {
+                    return;
+                }
+            }
+        }
+
+        result.push_back({op->name, op->type, index, stride, dims});
+    }
+
+public:
+    FindStridedLoads(const string &v, int line)
+        : loop_var(v), line_bytes(line) {
+    }
+
+    vector<StridedLoad> result;
+};
+
+class HasSerialLoopOrPrefetch : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        if (op->for_type != ForType::Vectorized && op->for_type != ForType::Unrolled) {
+            result = true;
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        if (op->is_intrinsic(Call::prefetch)) {
+            result = true;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool result = false;
+};
+
+class InjectAutoPrefetches : public IRMutator {
+    using IRMutator::visit;
+
+    const Target &target;
+
+    // Whether we're inside a loop offloaded to a device. The loops inside
+    // it are marked as DeviceAPI::None.
+    bool in_device_loop = false;
+
+    Stmt visit(const For *op) override {
+        bool on_device = op->device_api != DeviceAPI::None && op->device_api != DeviceAPI::Host;
+        ScopedValue<bool> old_in_device_loop(in_device_loop, in_device_loop || on_device);
+        Stmt stmt = IRMutator::visit(op);
+        op = stmt.as<For>();
+        internal_assert(op);
+
+        // Only innermost serial loops on the host, where the user hasn't
+        // already asked for prefetches, are considered.
+        if (op->for_type != ForType::Serial || in_device_loop) {
+            return stmt;
+        }
+        HasSerialLoopOrPrefetch inner;
+        op->body.accept(&inner);
+        if (inner.result) {
+            return stmt;
+        }
+
+        FindStridedLoads finder(op->name, cache_line_bytes(target));
+        op->body.accept(&finder);
+        if (finder.result.empty()) {
+            return stmt;
+        }
+
+        // Run far enough ahead to cover the memory latency.
+        EstimateIterationCost cost;
+        op->body.accept(&cost);
+        int distance = (memory_latency_cycles + cost.cost - 1) / std::max(cost.cost, 1);
+        distance = std::min(std::max(distance, 1), max_prefetch_distance);
+
+        Expr ahead = Variable::make(Int(32), op->name) + distance;
+        Stmt prefetches;
+        for (const StridedLoad &l : finder.result) {
+            debug(1) << "Prefetching " << l.name << " " << distance
+                     << " iterations ahead in the loop over " << op->name
+                     << ", which strides by " << l.stride << " elements\n";
+            vector<Expr> args = {Variable::make(Handle(), l.name),
+                                 simplify(substitute(op->name, ahead, l.index))};
+            args.insert(args.end(), l.dims.begin(), l.dims.end());
+            Stmt prefetch = Evaluate::make(Call::make(l.type, Call::prefetch, args, Call::Intrinsic));
+            prefetches = prefetches.defined() ? Block::make(prefetches, prefetch) : prefetch;
+        }
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api,
+                         Block::make(prefetches, op->body));
+    }
+
+public:
+    InjectAutoPrefetches(const Target &t)
+        : target(t) {
+    }
+};
+
 template<typename Fn>
 void traverse_block(const Stmt &s, Fn &&f) {
     const Block *b = s.as<Block>();
@@ -453,14 +784,9 @@ Stmt reduce_prefetch_dimension(Stmt stmt, const Target &t) {
     // two dimension. Other architectures generate one prefetch per cache line.
     if (t.has_feature(Target::HVX)) {
         max_dim = 2;
-    } else if (t.arch == Target::ARM) {
-        // ARM's cache line size can be 32 or 64 bytes and it can switch the
-        // size at runtime. To be safe, we just use 32 bytes.
-        max_dim = 1;
-        max_byte_size = 32;
     } else {
         max_dim = 1;
-        max_byte_size = 64;
+        max_byte_size = cache_line_bytes(t);
     }
     internal_assert(max_dim > 0);
 
@@ -473,6 +799,10 @@ Stmt reduce_prefetch_dimension(Stmt stmt, const Target &t) {
     return stmt;
 }
 
+Stmt inject_auto_prefetches(const Stmt &s, const Target &t) {
+    return InjectAutoPrefetches(t).mutate(s);
+}
+
 Stmt hoist_prefetches(const Stmt &s) {
     return HoistPrefetches().mutate(s);
 }
@@ -38,6 +38,14 @@ Stmt inject_prefetch(const Stmt &s, const std::map<std::string, Function> &env);
  * on the architecture), this also adds an outer loops that tile the prefetches. */
 Stmt reduce_prefetch_dimension(Stmt stmt, const Target &t);
 
+/** Prefetch the loads in innermost serial loops that stride through
+ * memory by at least a cache line per iteration, far enough ahead to
+ * hide the latency of a cache miss. Loops that already contain prefetches
+ * are left alone. Enabled by Target::AutoPrefetch. Run this before \ref
+ * reduce_prefetch_dimension, which splits the prefetches into cache
+ * lines. */
+Stmt inject_auto_prefetches(const Stmt &s, const Target &t);
+
 /** Hoist all the prefetches in a Block to the beginning of the Block.
  * This generally only happens when a loop with prefetches is unrolled;
  * in some cases, LLVM's code generation can be suboptimal (unnecessary register spills)
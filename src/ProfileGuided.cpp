@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+#include "Definition.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "ProfileGuided.h"
+#include "Target.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+
+PipelineProfile::PipelineProfile(const Target &t, const string &pipeline) {
+    if (!t.has_feature(Target::ProfileGuided)) {
+        return;
+    }
+    const string file_name = get_env_variable("HL_PROFILE_FILE");
+    user_assert(!file_name.empty())
+        << "The profile_guided target feature requires HL_PROFILE_FILE to name "
+        << "a profile written by halide_profiler_report.\n";
+    *this = PipelineProfile(file_name, pipeline);
+}
+
+PipelineProfile::PipelineProfile(const string &file_name, const string &pipeline) {
+    std::ifstream file(file_name);
+    if (!file) {
+        user_warning << "Could not read the profile " << file_name
+                     << ". Compiling " << pipeline << " without it.\n";
+        return;
+    }
+
+    // Profiles written by pipelines compiled with namespaced names are
+    // still found.
+    const string name = strip_namespaces(pipeline);
+    string line;
+    double total = 0;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        string p, func;
+        double time;
+        if (!(fields >> p >> func >> time)) {
+            user_warning << "Ignoring malformed line in profile " << file_name << ": " << line << "\n";
+            continue;
+        }
+        double threads = 0;
+        uint64_t memory_peak = 0, memory_per_run = 0;
+        fields >> threads >> memory_peak >> memory_per_run;
+        if (strip_namespaces(p) == name) {
+            FuncProfile &f = funcs[func];
+            f.time += time;
+            f.threads = std::max(f.threads, threads);
+            f.memory_peak = std::max(f.memory_peak, memory_peak);
+            f.memory_per_run += memory_per_run;
+            total += time;
+        }
+    }
+    if (total <= 0) {
+        funcs.clear();
+        return;
+    }
+    for (auto &it : funcs) {
+        it.second.fraction = it.second.time / total;
+    }
+}
+
+const FuncProfile *PipelineProfile::func(const string &name) const {
+    auto it = funcs.find(name);
+    return it == funcs.end() ? nullptr : &it->second;
+}
+
+const FuncProfile *PipelineProfile::loop_func(const string &loop) const {
+    // Loops are named <func>.s<stage>.<var>, and Func names may have
+    // dots in them, so try each place the stage could start.
+    for (size_t i = loop.find(".s"); i != string::npos; i = loop.find(".s", i + 1)) {
+        size_t j = i + 2;
+        while (j < loop.size() && std::isdigit(loop[j])) {
+            j++;
+        }
+        if (j > i + 2 && (j == loop.size() || loop[j] == '.')) {
+            if (const FuncProfile *f = func(loop.substr(0, i))) {
+                return f;
+            }
+        }
+    }
+    return nullptr;
+}
+
+namespace {
+
+FuncHeat heat_of(const FuncProfile *f) {
+    if (!f) {
+        return FuncHeat::Unknown;
+    } else if (f->fraction < 0.01) {
+        return FuncHeat::Cold;
+    } else if (f->fraction < 0.1) {
+        return FuncHeat::Warm;
+    } else {
+        return FuncHeat::Hot;
+    }
+}
+
+}  // namespace
+
+FuncHeat PipelineProfile::heat(const string &func) const {
+    return heat_of(this->func(func));
+}
+
+FuncHeat PipelineProfile::loop_heat(const string &loop) const {
+    return heat_of(loop_func(loop));
+}
+
+namespace {
+
+bool can_drop_specializations(const Definition &def) {
+    for (const Specialization &s : def.specializations()) {
+        if (!s.failure_message.empty() ||
+            is_const_one(s.condition) ||
+            !can_drop_specializations(s.definition)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+class ShrinkColdLoops : public IRMutator {
+    using IRMutator::visit;
+
+    const PipelineProfile &profile;
+    bool cold = false;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        FuncHeat h = profile.heat(op->name);
+        if (op->is_producer && h != FuncHeat::Unknown) {
+            // Funcs the profile doesn't mention (e.g. ones computed
+            // inline into this one) inherit the heat of the Func they
+            // are computed within.
+            ScopedValue<bool> old_cold(cold, h == FuncHeat::Cold);
+            return IRMutator::visit(op);
+        }
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const For *op) override {
+        if (cold && op->for_type == ForType::Unrolled) {
+            Stmt body = mutate(op->body);
+            return For::make(op->name, op->min, op->extent, ForType::Serial,
+                             op->device_api, std::move(body));
+        }
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Call *op) override {
+        if (cold &&
+            (op->is_intrinsic(Call::likely) ||
+             op->is_intrinsic(Call::likely_if_innermost))) {
+            return mutate(op->args[0]);
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    ShrinkColdLoops(const PipelineProfile &profile)
+        : profile(profile) {
+    }
+};
+
+}  // namespace
+
+void drop_cold_specializations(const map<string, Function> &env,
+                               const PipelineProfile &profile) {
+    for (const auto &it : env) {
+        Function f = it.second;
+        if (profile.heat(f.name()) != FuncHeat::Cold) {
+            continue;
+        }
+        std::vector<Definition> defs = {f.definition()};
+        for (const Definition &u : f.updates()) {
+            defs.push_back(u);
+        }
+        for (Definition &def : defs) {
+            if (def.defined() &&
+                !def.specializations().empty() &&
+                can_drop_specializations(def)) {
+                debug(1) << "Dropping the specializations of cold Func " << f.name() << "\n";
+                def.specializations().clear();
+            }
+        }
+    }
+}
+
+Stmt shrink_cold_loops(const Stmt &s, const PipelineProfile &profile) {
+    if (profile.empty()) {
+        return s;
+    }
+    return ShrinkColdLoops(profile).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
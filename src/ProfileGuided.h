@@ -0,0 +1,107 @@
+#ifndef HALIDE_PROFILE_GUIDED_H
+#define HALIDE_PROFILE_GUIDED_H
+
+/** \file
+ * Defines the passes that use a profile written by the runtime
+ * profiler to shrink the code of the Funcs a pipeline spends little
+ * time in.
+ */
+
+#include <map>
+#include <string>
+
+#include "Expr.h"
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+class Function;
+
+/** How much of the time of a pipeline went to one of its Funcs. */
+enum class FuncHeat {
+    /** The profile has nothing to say about the Func. */
+    Unknown,
+
+    /** Less than 1% of the time of the pipeline. */
+    Cold,
+
+    /** Between 1% and 10% of the time of the pipeline. */
+    Warm,
+
+    /** At least 10% of the time of the pipeline. */
+    Hot,
+};
+
+/** What the profile of a pipeline says about one of its Funcs. */
+struct FuncProfile {
+    /** The time spent in the Func per run, in nanoseconds. */
+    double time = 0;
+
+    /** The fraction of the time of the pipeline spent in the Func. */
+    double fraction = 0;
+
+    /** The average number of threads active while computing the Func. */
+    double threads = 0;
+
+    /** The peak memory allocated by the Func, and the memory it
+     * allocated per run, in bytes. */
+    uint64_t memory_peak = 0, memory_per_run = 0;
+};
+
+/** The time spent in each Func of a pipeline, as written by
+ * halide_profiler_report to the file named by the environment variable
+ * HL_PROFILE_FILE. Each line of the file is "<pipeline> <func>
+ * <nanoseconds> <threads> <peak bytes> <bytes per run>". Profiles
+ * written before the last three columns existed are still read. */
+class PipelineProfile {
+    std::map<std::string, FuncProfile> funcs;
+
+public:
+    PipelineProfile() = default;
+
+    /** Read the profile of the named pipeline from the file named by
+     * HL_PROFILE_FILE, if the target has the profile_guided feature.
+     * The profile is empty if the target doesn't, or the file has
+     * nothing to say about the pipeline. */
+    PipelineProfile(const Target &t, const std::string &pipeline);
+
+    /** Read the profile of the named pipeline from the given file. */
+    PipelineProfile(const std::string &file_name, const std::string &pipeline);
+
+    bool empty() const {
+        return funcs.empty();
+    }
+
+    /** The profile of the Func with the given name, or null if the
+     * profile has nothing to say about it. */
+    const FuncProfile *func(const std::string &name) const;
+
+    /** The profile of the Func that a loop with the given name (e.g.
+     * "f.s0.x.xi") belongs to, or null. */
+    const FuncProfile *loop_func(const std::string &loop) const;
+
+    /** The heat of the Func with the given name. */
+    FuncHeat heat(const std::string &func) const;
+
+    /** The heat of the Func that a loop with the given name belongs to. */
+    FuncHeat loop_heat(const std::string &loop) const;
+};
+
+/** Drop the specializations of the cold Funcs of a pipeline, so that
+ * only their general case is compiled. Specializations that can fail,
+ * or that replace the general case entirely, are kept. */
+void drop_cold_specializations(const std::map<std::string, Function> &env,
+                               const PipelineProfile &profile);
+
+/** Make the unrolled loops of cold Funcs serial, and remove the likely
+ * tags from their bodies so that loop partitioning leaves them
+ * alone. Must run before unrolling. */
+Stmt shrink_cold_loops(const Stmt &s, const PipelineProfile &profile);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
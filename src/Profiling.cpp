@@ -11,6 +11,7 @@
 #include "Scope.h"
 #include "Simplify.h"
 #include "Substitute.h"
+#include "Target.h"
 #include "UniquifyVariableNames.h"
 #include "Util.h"
 
@@ -23,13 +24,18 @@ using std::vector;
 
 namespace {
 
-Stmt incr_active_threads(const Expr &profiler_state) {
-    return Evaluate::make(Call::make(Int(32), "halide_profiler_incr_active_threads",
+// Host code reports to the pipeline's own halide_profiler_instance_state.
+// Code offloaded to Hexagon updates the remote runtime's global
+// halide_profiler_state instead, as that has no notion of instances.
+Stmt incr_active_threads(const Expr &profiler_state, bool remote) {
+    return Evaluate::make(Call::make(Int(32),
+                                     remote ? "halide_profiler_incr_active_threads" : "halide_profiler_instance_incr_active_threads",
                                      {profiler_state}, Call::Extern));
 }
 
-Stmt decr_active_threads(const Expr &profiler_state) {
-    return Evaluate::make(Call::make(Int(32), "halide_profiler_decr_active_threads",
+Stmt decr_active_threads(const Expr &profiler_state, bool remote) {
+    return Evaluate::make(Call::make(Int(32),
+                                     remote ? "halide_profiler_decr_active_threads" : "halide_profiler_instance_decr_active_threads",
                                      {profiler_state}, Call::Extern));
 }
 
@@ -43,16 +49,16 @@ Stmt release_sampling_token(const Expr &shared_token, const Expr &local_token) {
                                      {shared_token, local_token}, Call::Extern));
 }
 
-Stmt activate_thread(const Stmt &s, const Expr &profiler_state) {
-    return Block::make({incr_active_threads(profiler_state),
+Stmt activate_thread(const Stmt &s, const Expr &profiler_state, bool remote) {
+    return Block::make({incr_active_threads(profiler_state, remote),
                         s,
-                        decr_active_threads(profiler_state)});
+                        decr_active_threads(profiler_state, remote)});
 }
 
-Stmt suspend_thread(const Stmt &s, const Expr &profiler_state) {
-    return Block::make({decr_active_threads(profiler_state),
+Stmt suspend_thread(const Stmt &s, const Expr &profiler_state, bool remote) {
+    return Block::make({decr_active_threads(profiler_state, remote),
                         s,
-                        incr_active_threads(profiler_state)});
+                        incr_active_threads(profiler_state, remote)});
 }
 
 Stmt claim_sampling_token(const Stmt &s, const Expr &shared_token, const Expr &local_token) {
@@ -63,6 +69,119 @@ Stmt claim_sampling_token(const Stmt &s, const Expr &shared_token, const Expr &l
                                       release_sampling_token(shared_token, local_token)}));
 }
 
+// Give each thread running a parallel leaf task a slot of its own in
+// the pipeline instance to report its current Func in.
+Stmt claim_instance_slot(const Stmt &s, const Expr &profiler_instance, const Expr &local_slot) {
+    auto slot_call = [&](const char *name) {
+        return Evaluate::make(Call::make(Int(32), name, {profiler_instance, local_slot}, Call::Extern));
+    };
+    return LetStmt::make(local_slot.as<Variable>()->name,
+                         Call::make(Handle(), Call::alloca, {Int(32).bytes()}, Call::Intrinsic),
+                         Block::make({slot_call("halide_profiler_instance_acquire_slot"),
+                                      s,
+                                      slot_call("halide_profiler_instance_release_slot")}));
+}
+
+// Drop the stage markers from code the profiler doesn't instrument,
+// such as GPU kernels.
+class StripProfilerStageMarkers : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const Evaluate *op) override {
+        if (Call::as_intrinsic(op->value, {Call::profiler_stage_marker})) {
+            return Evaluate::make(0);
+        }
+        return op;
+    }
+};
+
+// Count the bytes loaded and stored, and the arithmetic operations
+// done, by one iteration of a loop body, leaving out nested loops,
+// which count themselves. Both sides of conditionals are counted.
+class CountTraffic : public IRVisitor {
+    using IRVisitor::visit;
+
+    bool in_index = false;
+
+    bool is_counter(const string &name) const {
+        return starts_with(name, "profiler_traffic");
+    }
+
+    void visit(const For *op) override {
+    }
+
+    void visit(const Load *op) override {
+        if (!is_counter(op->name)) {
+            bytes_loaded += op->type.bytes() * op->type.lanes();
+        }
+        // Address arithmetic isn't counted as work.
+        ScopedValue<bool> bind(in_index, true);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Store *op) override {
+        if (!is_counter(op->name)) {
+            bytes_stored += op->value.type().bytes() * op->value.type().lanes();
+        }
+        op->value.accept(this);
+        ScopedValue<bool> bind(in_index, true);
+        op->predicate.accept(this);
+        op->index.accept(this);
+    }
+
+    void count_op(const Type &t) {
+        if (!in_index) {
+            arithmetic_ops += t.lanes();
+        }
+    }
+
+    void visit(const Add *op) override {
+        count_op(op->type);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Sub *op) override {
+        count_op(op->type);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Mul *op) override {
+        count_op(op->type);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Div *op) override {
+        count_op(op->type);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Mod *op) override {
+        count_op(op->type);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Min *op) override {
+        count_op(op->type);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Max *op) override {
+        count_op(op->type);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        // Math library calls and arithmetic intrinsics.
+        if (op->call_type == Call::PureExtern || op->call_type == Call::PureIntrinsic) {
+            count_op(op->type);
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    int64_t bytes_loaded = 0, bytes_stored = 0, arithmetic_ops = 0;
+};
+
 class InjectProfiling : public IRMutator {
 
 public:
@@ -76,8 +195,8 @@ public:
     bool in_parallel = false;
     bool in_leaf_task = false;
 
-    InjectProfiling(const string &pipeline_name)
-        : pipeline_name(pipeline_name) {
+    InjectProfiling(const string &pipeline_name, bool count_traffic)
+        : pipeline_name(pipeline_name), count_traffic(count_traffic) {
         stack.push_back(get_func_id("overhead"));
         // ID 0 is treated specially in the runtime as overhead
         internal_assert(stack.back() == 0);
@@ -86,6 +205,7 @@ public:
         free_id = get_func_id("halide_free");
         profiler_pipeline_state = Variable::make(Handle(), "profiler_pipeline_state");
         profiler_state = Variable::make(Handle(), "profiler_state");
+        profiler_instance = Variable::make(Handle(), "profiler_instance");
         profiler_token = Variable::make(Int(32), "profiler_token");
         profiler_local_sampling_token = Variable::make(Handle(), "profiler_local_sampling_token");
         profiler_shared_sampling_token = Variable::make(Handle(), "profiler_shared_sampling_token");
@@ -100,6 +220,7 @@ private:
     int malloc_id, free_id;
     Expr profiler_pipeline_state;
     Expr profiler_state;
+    Expr profiler_instance;
     Expr profiler_token;
     Expr profiler_local_sampling_token;
     Expr profiler_shared_sampling_token;
@@ -118,6 +239,93 @@ private:
 
     bool profiling_memory = true;
 
+    // Whether we're inside a Hexagon offload, where the remote
+    // runtime's global profiler state is used.
+    bool in_hexagon = false;
+
+    // With the profile_memory_traffic feature, each loop adds the
+    // traffic and arithmetic of its body, times its extent, to
+    // counters on the stack before it runs, so nothing is counted
+    // inside the loop itself. Each parallel task has counters of its
+    // own, which it hands to the runtime when it finishes.
+    bool count_traffic;
+
+    struct TrafficCounters {
+        string name;
+        // Maps from func id -> the index of its three counters.
+        map<int, int> slots;
+    };
+    vector<TrafficCounters> traffic_counters;
+    int next_traffic_counters = 0;
+
+public:
+    void begin_traffic_counters() {
+        traffic_counters.push_back({"profiler_traffic" + std::to_string(next_traffic_counters++), {}});
+    }
+
+    Stmt end_traffic_counters(const Stmt &s) {
+        TrafficCounters counters = std::move(traffic_counters.back());
+        traffic_counters.pop_back();
+        if (counters.slots.empty()) {
+            return s;
+        }
+        auto counter = [&](int slot, int i) {
+            return Load::make(UInt(64), counters.name, slot * 3 + i, Buffer<>(), Parameter(),
+                              const_true(), ModulusRemainder());
+        };
+        vector<Stmt> stmts;
+        for (size_t i = 0; i < counters.slots.size() * 3; i++) {
+            stmts.push_back(Store::make(counters.name, make_zero(UInt(64)), (int)i, Parameter(),
+                                        const_true(), ModulusRemainder()));
+        }
+        stmts.push_back(s);
+        for (const auto &it : counters.slots) {
+            Expr flush = Call::make(Int(32), "halide_profiler_memory_traffic",
+                                    {profiler_pipeline_state, it.first, counter(it.second, 0),
+                                     counter(it.second, 1), counter(it.second, 2)},
+                                    Call::Extern);
+            stmts.push_back(Evaluate::make(flush));
+        }
+        return Allocate::make(counters.name, UInt(64), MemoryType::Stack,
+                              {(int)counters.slots.size() * 3}, const_true(), Block::make(stmts));
+    }
+
+private:
+    // Add the traffic of all iterations of a loop to the counters of
+    // the current Func.
+    Stmt count_loop_traffic(const For *op) {
+        CountTraffic counter;
+        op->body.accept(&counter);
+        if (!counter.bytes_loaded && !counter.bytes_stored && !counter.arithmetic_ops) {
+            return Stmt();
+        }
+        TrafficCounters &counters = traffic_counters.back();
+        int func = stack.back();
+        auto it = counters.slots.find(func);
+        int slot = (it == counters.slots.end()) ? (counters.slots[func] = (int)counters.slots.size()) : it->second;
+
+        Expr iterations = cast<uint64_t>(max(op->extent, 0));
+        vector<Stmt> stmts;
+        int64_t counts[] = {counter.bytes_loaded, counter.bytes_stored, counter.arithmetic_ops};
+        for (int i = 0; i < 3; i++) {
+            if (!counts[i]) {
+                continue;
+            }
+            Expr index = slot * 3 + i;
+            Expr old = Load::make(UInt(64), counters.name, index, Buffer<>(), Parameter(),
+                                  const_true(), ModulusRemainder());
+            Expr value = simplify(old + iterations * make_const(UInt(64), counts[i]));
+            stmts.push_back(Store::make(counters.name, value, index, Parameter(),
+                                        const_true(), ModulusRemainder()));
+        }
+        return Block::make(stmts);
+    }
+
+    // The state that tracks active threads, for the current context.
+    Expr thread_state() const {
+        return in_hexagon ? profiler_state : profiler_instance;
+    }
+
     // Strip down the tuple name, e.g. f.0 into f
     string normalize_name(const string &name) {
         vector<string> v = split_string(name, ".");
@@ -138,6 +346,19 @@ private:
         return idx;
     }
 
+    // Stages and specializations are billed under their full name,
+    // e.g. f.update(0).specialization(1), which the runtime reports as
+    // children of the Func the name starts with.
+    int get_stage_id(const string &name) {
+        auto iter = indices.find(name);
+        if (iter == indices.end()) {
+            int idx = (int)indices.size();
+            indices[name] = idx;
+            return idx;
+        }
+        return iter->second;
+    }
+
     Stmt set_current_func(int id) {
         if (most_recently_set_func == id) {
             return Evaluate::make(0);
@@ -145,8 +366,9 @@ private:
         most_recently_set_func = id;
         Expr last_arg = in_leaf_task ? profiler_local_sampling_token : reinterpret(Handle(), cast<uint64_t>(0));
         // This call gets inlined and becomes a single store instruction.
-        Stmt s = Evaluate::make(Call::make(Int(32), "halide_profiler_set_current_func",
-                                           {profiler_state, profiler_token, id, last_arg}, Call::Extern));
+        Stmt s = Evaluate::make(Call::make(Int(32),
+                                           in_hexagon ? "halide_profiler_set_current_func" : "halide_profiler_instance_set_current_func",
+                                           {thread_state(), profiler_token, id, last_arg}, Call::Extern));
 
         return s;
     }
@@ -298,6 +520,19 @@ private:
         return ProducerConsumer::make(op->name, op->is_producer, body);
     }
 
+    Stmt visit(const Evaluate *op) override {
+        if (const Call *c = Call::as_intrinsic(op->value, {Call::profiler_stage_marker})) {
+            const StringImm *name = c->args[0].as<StringImm>();
+            internal_assert(name);
+            // The rest of the enclosing produce node (or
+            // specialization) belongs to this stage.
+            int idx = get_stage_id(name->value);
+            stack.back() = idx;
+            return set_current_func(idx);
+        }
+        return IRMutator::visit(op);
+    }
+
     Stmt visit_parallel_task(Stmt s) {
         int old = most_recently_set_func;
         if (const Fork *f = s.as<Fork>()) {
@@ -305,7 +540,15 @@ private:
         } else if (const Acquire *a = s.as<Acquire>()) {
             s = Acquire::make(a->semaphore, a->count, visit_parallel_task(a->body));
         } else {
-            s = activate_thread(mutate(s), profiler_state);
+            bool own_counters = count_traffic && !in_hexagon;
+            if (own_counters) {
+                begin_traffic_counters();
+            }
+            s = mutate(s);
+            if (own_counters) {
+                s = end_traffic_counters(s);
+            }
+            s = activate_thread(s, thread_state(), in_hexagon);
         }
         if (most_recently_set_func != old) {
             most_recently_set_func = -1;
@@ -315,13 +558,13 @@ private:
 
     Stmt visit(const Acquire *op) override {
         Stmt s = visit_parallel_task(op);
-        return suspend_thread(s, profiler_state);
+        return suspend_thread(s, thread_state(), in_hexagon);
     }
 
     Stmt visit(const Fork *op) override {
         ScopedValue<bool> bind(in_fork, true);
         Stmt s = visit_parallel_task(op);
-        return suspend_thread(s, profiler_state);
+        return suspend_thread(s, thread_state(), in_hexagon);
     }
 
     Stmt visit(const For *op) override {
@@ -337,8 +580,9 @@ private:
         ScopedValue<bool> bind_in_parallel(in_parallel, in_parallel || op->is_unordered_parallel());
 
         bool leaf_task = false;
+        bool remote_body = in_hexagon || op->device_api == DeviceAPI::Hexagon;
         if (update_active_threads) {
-            body = activate_thread(body, profiler_state);
+            body = activate_thread(body, remote_body ? profiler_state : profiler_instance, remote_body);
 
             class ContainsParallelOrBlockingNode : public IRVisitor {
                 using IRVisitor::visit;
@@ -362,7 +606,11 @@ private:
             leaf_task = !contains_parallel_or_blocking_node.result;
 
             if (leaf_task) {
-                body = claim_sampling_token(body, profiler_shared_sampling_token, profiler_local_sampling_token);
+                if (remote_body) {
+                    body = claim_sampling_token(body, profiler_shared_sampling_token, profiler_local_sampling_token);
+                } else {
+                    body = claim_instance_slot(body, profiler_instance, profiler_local_sampling_token);
+                }
             }
         }
         ScopedValue<bool> bind_leaf_task(in_leaf_task, in_leaf_task || leaf_task);
@@ -377,7 +625,10 @@ private:
             // which means we can't do memory accounting.
             bool old_profiling_memory = profiling_memory;
             profiling_memory = false;
-            body = mutate(body);
+            {
+                ScopedValue<bool> bind_in_hexagon(in_hexagon, true);
+                body = mutate(body);
+            }
             profiling_memory = old_profiling_memory;
 
             // Get the profiler state pointer from scratch inside the
@@ -388,9 +639,16 @@ private:
             body = LetStmt::make("hvx_profiler_state", get_state, body);
         } else if (op->device_api == DeviceAPI::None ||
                    op->device_api == DeviceAPI::Host) {
+            bool own_counters = count_traffic && !in_hexagon && op->is_unordered_parallel();
+            if (own_counters) {
+                begin_traffic_counters();
+            }
             body = mutate(body);
+            if (own_counters) {
+                body = end_traffic_counters(body);
+            }
         } else {
-            body = op->body;
+            body = StripProfilerStageMarkers().mutate(op->body);
         }
 
         if (old != most_recently_set_func) {
@@ -400,7 +658,15 @@ private:
         Stmt stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
 
         if (update_active_threads) {
-            stmt = suspend_thread(stmt, profiler_state);
+            stmt = suspend_thread(stmt, thread_state(), in_hexagon);
+        }
+
+        if (count_traffic && !in_hexagon &&
+            (op->device_api == DeviceAPI::None || op->device_api == DeviceAPI::Host)) {
+            Stmt count = count_loop_traffic(op);
+            if (count.defined()) {
+                stmt = Block::make(count, stmt);
+            }
         }
 
         return stmt;
@@ -408,11 +674,16 @@ private:
 
     Stmt visit(const IfThenElse *op) override {
         int old = most_recently_set_func;
+        // A specialization marked in one branch doesn't apply to the
+        // other, or to what follows.
+        int old_stage = stack.back();
         Expr condition = mutate(op->condition);
         Stmt then_case = mutate(op->then_case);
         int func_computed_in_then = most_recently_set_func;
         most_recently_set_func = old;
+        stack.back() = old_stage;
         Stmt else_case = mutate(op->else_case);
+        stack.back() = old_stage;
         if (most_recently_set_func != func_computed_in_then) {
             most_recently_set_func = -1;
         }
@@ -427,25 +698,32 @@ private:
 
 }  // namespace
 
-Stmt inject_profiling(Stmt s, const string &pipeline_name) {
-    InjectProfiling profiling(pipeline_name);
+Stmt inject_profiling(Stmt s, const string &pipeline_name, const Target &target) {
+    bool count_traffic = target.has_feature(Target::ProfileMemoryTraffic);
+    InjectProfiling profiling(pipeline_name, count_traffic);
+    if (count_traffic) {
+        profiling.begin_traffic_counters();
+    }
     s = profiling.mutate(s);
+    if (count_traffic) {
+        s = profiling.end_traffic_counters(s);
+    }
 
     int num_funcs = (int)(profiling.indices.size());
 
     Expr func_names_buf = Variable::make(Handle(), "profiling_func_names");
 
-    Expr start_profiler = Call::make(Int(32), "halide_profiler_pipeline_start",
-                                     {pipeline_name, num_funcs, func_names_buf}, Call::Extern);
+    Expr profiler_instance = Variable::make(Handle(), "profiler_instance");
 
-    Expr get_state = Call::make(Handle(), "halide_profiler_get_state", {}, Call::Extern);
+    Expr start_profiler = Call::make(Int(32), "halide_profiler_pipeline_start",
+                                     {pipeline_name, num_funcs, func_names_buf, profiler_instance}, Call::Extern);
 
     Expr get_pipeline_state = Call::make(Handle(), "halide_profiler_get_pipeline_state", {pipeline_name}, Call::Extern);
 
     Expr profiler_token = Variable::make(Int(32), "profiler_token");
 
     Expr stop_profiler = Call::make(Handle(), Call::register_destructor,
-                                    {Expr("halide_profiler_pipeline_end"), get_state}, Call::Intrinsic);
+                                    {Expr("halide_profiler_pipeline_end"), profiler_instance}, Call::Intrinsic);
 
     bool no_stack_alloc = profiling.func_stack_peak.empty();
     if (!no_stack_alloc) {
@@ -457,9 +735,7 @@ Stmt inject_profiling(Stmt s, const string &pipeline_name) {
         s = Block::make(update_stack, s);
     }
 
-    Expr profiler_state = Variable::make(Handle(), "profiler_state");
-
-    s = activate_thread(s, profiler_state);
+    s = activate_thread(s, profiler_instance, false);
 
     // Initialize the shared sampling token
     Expr shared_sampling_token_var = Variable::make(Handle(), "profiler_shared_sampling_token");
@@ -470,7 +746,6 @@ Stmt inject_profiling(Stmt s, const string &pipeline_name) {
                       Call::make(Handle(), Call::alloca, {Int(32).bytes()}, Call::Intrinsic), s);
 
     s = LetStmt::make("profiler_pipeline_state", get_pipeline_state, s);
-    s = LetStmt::make("profiler_state", get_state, s);
     // If there was a problem starting the profiler, it will call an
     // appropriate halide error function and then return the
     // (negative) error code as the token.
@@ -498,11 +773,34 @@ Stmt inject_profiling(Stmt s, const string &pipeline_name) {
                        MemoryType::Auto, {num_funcs}, const_true(), s);
     s = Block::make(Evaluate::make(stop_profiler), s);
 
+    // The instance state lives on the pipeline's stack. Size it for
+    // 64-bit pointers, whatever the host, allowing for the padding
+    // around each of its three pointers to change with their size.
+    const int instance_bytes = (int)(sizeof(halide_profiler_instance_state) + 3 * 8);
+    s = LetStmt::make("profiler_instance",
+                      Call::make(Handle(), Call::alloca, {instance_bytes}, Call::Intrinsic), s);
+
     // We have nested definitions of the sampling token
     s = uniquify_variable_names(s);
 
     return s;
 }
 
+Stmt strip_gpu_profiler_stage_markers(const Stmt &s) {
+    class StripGPUMarkers : public IRMutator {
+        using IRMutator::visit;
+
+        Stmt visit(const For *op) override {
+            if (op->device_api != DeviceAPI::None &&
+                op->device_api != DeviceAPI::Host &&
+                op->device_api != DeviceAPI::Hexagon) {
+                return StripProfilerStageMarkers().mutate(op);
+            }
+            return IRMutator::visit(op);
+        }
+    };
+    return StripGPUMarkers().mutate(s);
+}
+
 }  // namespace Internal
 }  // namespace Halide
@@ -22,22 +22,38 @@
  *   f0:          0.025673ms (42%)
  *   mandelbrot:  0.006444ms (10%)   peak: 505344   num: 104000   avg: 5376
  *   argmin:      0.027715ms (46%)   stack: 20
+ *
+ * With the profile_stages feature, the update definitions and
+ * specializations of a Func are billed separately, and reported
+ * indented below the Func, whose own line includes their time:
+ *   f:           0.031000ms (50%)
+ *     update(0):  0.020000ms (32%)
+ *     update(0).specialization(0):  0.004000ms (6%)
  */
 #include <string>
 
 #include "Expr.h"
 
 namespace Halide {
+
+struct Target;
+
 namespace Internal {
 
 /** Take a statement representing a halide pipeline insert
  * high-resolution timing into the generated code (via spawning a
  * thread that acts as a sampling profiler); summaries of execution
  * times and counts will be logged at the end. Should be done before
- * storage flattening, but after all bounds inference.
- *
+ * storage flattening, but after all bounds inference. With the
+ * profile_memory_traffic feature, it also counts the bytes each Func
+ * loads and stores, and the arithmetic it does.
  */
-Stmt inject_profiling(Stmt, const std::string &);
+Stmt inject_profiling(Stmt, const std::string &, const Target &);
+
+/** Remove the markers left for inject_profiling by the profile_stages
+ * feature from GPU loops, which the profiler doesn't instrument. Must
+ * be done before the GPU loops are transformed. */
+Stmt strip_gpu_profiler_stage_markers(const Stmt &);
 
 }  // namespace Internal
 }  // namespace Halide
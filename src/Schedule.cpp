@@ -204,6 +204,18 @@ bool LoopLevel::operator==(const LoopLevel &other) const {
            (contents->var_name == other.contents->var_name);
 }
 
+void LoopLevel::get_parts(std::string &func_name, std::string &var_name, bool &is_rvar, int &stage_index) const {
+    func_name = contents->func_name;
+    var_name = contents->var_name;
+    is_rvar = contents->is_rvar;
+    stage_index = contents->stage_index;
+}
+
+/* static */
+LoopLevel LoopLevel::from_parts(const std::string &func_name, const std::string &var_name, bool is_rvar, int stage_index) {
+    return LoopLevel(func_name, var_name, is_rvar, stage_index, false);
+}
+
 namespace Internal {
 
 typedef std::map<FunctionPtr, FunctionPtr> DeepCopyMap;
@@ -213,18 +225,24 @@ typedef std::map<FunctionPtr, FunctionPtr> DeepCopyMap;
 struct FuncScheduleContents {
     mutable RefCount ref_count;
 
-    LoopLevel store_level, compute_level;
+    LoopLevel store_level, compute_level, hoist_storage_level, completion_level;
     std::vector<StorageDim> storage_dims;
     std::vector<Bound> bounds;
     std::vector<Bound> estimates;
     std::map<std::string, Internal::FunctionPtr> wrappers;
     MemoryType memory_type = MemoryType::Auto;
+    GatherMode gather_mode = GatherMode::Auto;
+    bool interleave_tuple = false;
+    int code_size_budget = 0;
+    bool store_nontemporal = false;
     bool memoized = false;
     bool async = false;
     Expr memoize_eviction_key;
+    Expr ring_buffer;
 
     FuncScheduleContents()
-        : store_level(LoopLevel::inlined()), compute_level(LoopLevel::inlined()) {
+        : store_level(LoopLevel::inlined()), compute_level(LoopLevel::inlined()),
+          hoist_storage_level(LoopLevel::inlined()), completion_level(LoopLevel::inlined()) {
     }
 
     // Pass an IRMutator through to all Exprs referenced in the FuncScheduleContents
@@ -257,6 +275,9 @@ struct FuncScheduleContents {
                 b.remainder = mutator->mutate(b.remainder);
             }
         }
+        if (ring_buffer.defined()) {
+            ring_buffer = mutator->mutate(ring_buffer);
+        }
     }
 };
 
@@ -285,6 +306,7 @@ struct StageScheduleContents {
     bool allow_race_conditions = false;
     bool atomic = false;
     bool override_atomic_associativity_test = false;
+    bool allow_reassociation = false;
 
     StageScheduleContents()
         : fuse_level(FuseLoopLevel()) {
@@ -334,13 +356,20 @@ FuncSchedule FuncSchedule::deep_copy(
     FuncSchedule copy;
     copy.contents->store_level = contents->store_level;
     copy.contents->compute_level = contents->compute_level;
+    copy.contents->hoist_storage_level = contents->hoist_storage_level;
+    copy.contents->completion_level = contents->completion_level;
     copy.contents->storage_dims = contents->storage_dims;
     copy.contents->bounds = contents->bounds;
     copy.contents->estimates = contents->estimates;
     copy.contents->memory_type = contents->memory_type;
+    copy.contents->gather_mode = contents->gather_mode;
+    copy.contents->interleave_tuple = contents->interleave_tuple;
+    copy.contents->code_size_budget = contents->code_size_budget;
+    copy.contents->store_nontemporal = contents->store_nontemporal;
     copy.contents->memoized = contents->memoized;
     copy.contents->memoize_eviction_key = contents->memoize_eviction_key;
     copy.contents->async = contents->async;
+    copy.contents->ring_buffer = contents->ring_buffer;
 
     // Deep-copy wrapper functions.
     for (const auto &iter : contents->wrappers) {
@@ -360,6 +389,38 @@ MemoryType &FuncSchedule::memory_type() {
     return contents->memory_type;
 }
 
+GatherMode FuncSchedule::gather_mode() const {
+    return contents->gather_mode;
+}
+
+GatherMode &FuncSchedule::gather_mode() {
+    return contents->gather_mode;
+}
+
+bool FuncSchedule::interleave_tuple() const {
+    return contents->interleave_tuple;
+}
+
+bool &FuncSchedule::interleave_tuple() {
+    return contents->interleave_tuple;
+}
+
+int FuncSchedule::code_size_budget() const {
+    return contents->code_size_budget;
+}
+
+int &FuncSchedule::code_size_budget() {
+    return contents->code_size_budget;
+}
+
+bool FuncSchedule::store_nontemporal() const {
+    return contents->store_nontemporal;
+}
+
+bool &FuncSchedule::store_nontemporal() {
+    return contents->store_nontemporal;
+}
+
 bool &FuncSchedule::memoized() {
     return contents->memoized;
 }
@@ -384,6 +445,14 @@ bool FuncSchedule::async() const {
     return contents->async;
 }
 
+Expr &FuncSchedule::ring_buffer() {
+    return contents->ring_buffer;
+}
+
+Expr FuncSchedule::ring_buffer() const {
+    return contents->ring_buffer;
+}
+
 std::vector<StorageDim> &FuncSchedule::storage_dims() {
     return contents->storage_dims;
 }
@@ -445,6 +514,22 @@ const LoopLevel &FuncSchedule::compute_level() const {
     return contents->compute_level;
 }
 
+LoopLevel &FuncSchedule::hoist_storage_level() {
+    return contents->hoist_storage_level;
+}
+
+const LoopLevel &FuncSchedule::hoist_storage_level() const {
+    return contents->hoist_storage_level;
+}
+
+LoopLevel &FuncSchedule::completion_level() {
+    return contents->completion_level;
+}
+
+const LoopLevel &FuncSchedule::completion_level() const {
+    return contents->completion_level;
+}
+
 void FuncSchedule::accept(IRVisitor *visitor) const {
     for (const Bound &b : bounds()) {
         if (b.min.defined()) {
@@ -477,6 +562,9 @@ void FuncSchedule::accept(IRVisitor *visitor) const {
     if (memoize_eviction_key().defined()) {
         memoize_eviction_key().accept(visitor);
     }
+    if (ring_buffer().defined()) {
+        ring_buffer().accept(visitor);
+    }
 }
 
 void FuncSchedule::mutate(IRMutator *mutator) {
@@ -502,6 +590,7 @@ StageSchedule StageSchedule::get_copy() const {
     copy.contents->allow_race_conditions = contents->allow_race_conditions;
     copy.contents->atomic = contents->atomic;
     copy.contents->override_atomic_associativity_test = contents->override_atomic_associativity_test;
+    copy.contents->allow_reassociation = contents->allow_reassociation;
     return copy;
 }
 
@@ -585,6 +674,14 @@ bool StageSchedule::override_atomic_associativity_test() const {
     return contents->override_atomic_associativity_test;
 }
 
+bool &StageSchedule::allow_reassociation() {
+    return contents->allow_reassociation;
+}
+
+bool StageSchedule::allow_reassociation() const {
+    return contents->allow_reassociation;
+}
+
 void StageSchedule::accept(IRVisitor *visitor) const {
     for (const ReductionVariable &r : rvars()) {
         if (r.min.defined()) {
@@ -122,6 +122,26 @@ enum class LoopAlignStrategy {
     Auto
 };
 
+/** Different ways to vectorize loads and stores at data-dependent
+ * addresses (e.g. lookups into a table). Only x86 targets with AVX2
+ * (for gathers) or AVX-512 (for scatters) currently have instructions
+ * for these; other targets always load and store each lane
+ * separately. */
+enum class GatherMode {
+    /** Use gather and scatter instructions where they are expected to
+     * be faster than separate loads and stores: for vectors of 32- or
+     * 64-bit elements that fill a whole register on AVX2, and for any
+     * vector of four or more such elements on AVX-512. */
+    Auto,
+
+    /** Use gather and scatter instructions wherever the target has
+     * them for the element type. */
+    Always,
+
+    /** Never use gather and scatter instructions. */
+    Never
+};
+
 /** A reference to a site in a Halide statement at the top of the
  * body of a particular for loop. Evaluating a region of a halide
  * function is done by generating a loop nest that spans its
@@ -251,6 +271,12 @@ public:
         return !(*this == other);
     }
 
+    // Get the fields of this LoopLevel, whether or not it is locked or
+    // defined, and make an unlocked LoopLevel from them. Used to store
+    // and reload schedules.
+    void get_parts(std::string &func_name, std::string &var_name, bool &is_rvar, int &stage_index) const;
+    static LoopLevel from_parts(const std::string &func_name, const std::string &var_name, bool is_rvar, int stage_index);
+
 private:
     void check_defined() const;
     void check_locked() const;
@@ -482,6 +508,16 @@ struct StorageDim {
     /** The bounds allocated (not computed). Set by Func::bound_storage. */
     Expr bound;
 
+    /** Extra elements added to the bounds allocated, after applying
+     * any alignment. Set by Func::pad_storage. */
+    Expr padding;
+
+    /** If defined, the bounds allocated are padded further by one
+     * cache line whenever that would otherwise make the stride of the
+     * next dimension out, in bytes, a multiple of this. Set by
+     * Func::pad_storage_against_aliasing. */
+    Expr critical_stride;
+
     /** If the Func is explicitly folded along this axis (with
      * Func::fold_storage) this gives the extent of the circular
      * buffer used, and whether it is used in increasing order
@@ -577,6 +613,14 @@ public:
     bool &async();
     bool async() const;
 
+    /** The number of copies of the storage to rotate between for an
+     * async producer, or an undefined Expr if the storage is not
+     * ring-buffered. See \ref Func::ring_buffer */
+    // @{
+    Expr &ring_buffer();
+    Expr ring_buffer() const;
+    // @}
+
     /** The list and order of dimensions used to store this
      * function. The first dimension in the vector corresponds to the
      * innermost dimension for storage (i.e. which dimension is
@@ -592,6 +636,36 @@ public:
     MemoryType &memory_type();
     // @}
 
+    /** Whether the loads and stores at data-dependent addresses in
+     * the definitions of this Function use gather and scatter
+     * instructions. See \ref Func::gather_mode */
+    // @{
+    GatherMode gather_mode() const;
+    GatherMode &gather_mode();
+    // @}
+
+    /** Whether the elements of a Tuple-valued Function are stored
+     * interleaved in a single allocation. See \ref Func::interleave_tuple */
+    // @{
+    bool interleave_tuple() const;
+    bool &interleave_tuple();
+    // @}
+
+    /** The number of IR nodes that the loop nests of this Function may
+     * grow to through unrolling and loop partitioning, or zero for no
+     * limit. See \ref Func::code_size_budget */
+    // @{
+    int code_size_budget() const;
+    int &code_size_budget();
+    // @}
+
+    /** Whether aligned vector stores to this Function's buffers bypass
+     * the cache. See \ref Func::store_nontemporal */
+    // @{
+    bool store_nontemporal() const;
+    bool &store_nontemporal();
+    // @}
+
     /** You may explicitly bound some of the dimensions of a function,
      * or constrain them to lie on multiples of a given factor. See
      * \ref Func::bound and \ref Func::align_bounds and \ref Func::align_extent. */
@@ -631,6 +705,24 @@ public:
     LoopLevel &compute_level();
     // @}
 
+    /** At what site should the allocation of this function be made? By
+     * default (LoopLevel::inlined()) it is made at the store_level. If
+     * set, it must be outside of or equal to the store_level, with only
+     * serial loops in between. See \ref Func::hoist_storage */
+    // @{
+    const LoopLevel &hoist_storage_level() const;
+    LoopLevel &hoist_storage_level();
+    // @}
+
+    /** At the end of each iteration of which loop of the last stage
+     * of this function should halide_region_complete be called? By
+     * default (LoopLevel::inlined()) it is never called. See \ref
+     * Func::notify_completion */
+    // @{
+    const LoopLevel &completion_level() const;
+    LoopLevel &completion_level();
+    // @}
+
     /** Pass an IRVisitor through to all Exprs referenced in the
      * Schedule. */
     void accept(IRVisitor *) const;
@@ -737,6 +829,13 @@ public:
     bool &override_atomic_associativity_test();
     // @}
 
+    /** May the reduction in this stage be reassociated? See
+     * \ref Stage::allow_reassociation */
+    // @{
+    bool allow_reassociation() const;
+    bool &allow_reassociation();
+    // @}
+
     /** Pass an IRVisitor through to all Exprs referenced in the
      * Schedule. */
     void accept(IRVisitor *) const;
@@ -0,0 +1,655 @@
+#include "ScheduleDatabase.h"
+
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <sstream>
+
+#include "Debug.h"
+#include "FindCalls.h"
+#include "IR.h"
+#include "IRPrinter.h"
+#include "IRVisitor.h"
+#include "LLVM_Headers.h"
+#include "Pipeline.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+// Bump this whenever the format of the entries changes.
+constexpr int schedule_database_version = 11;
+
+std::map<std::string, Function> pipeline_env(const std::vector<Function> &outputs) {
+    std::map<std::string, Function> env;
+    for (const Function &f : outputs) {
+        std::map<std::string, Function> more_funcs = find_transitive_calls(f);
+        env.insert(more_funcs.begin(), more_funcs.end());
+    }
+    return env;
+}
+
+// Find the Params and Buffers a pipeline refers to.
+class FindParameters : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        if (op->param.defined()) {
+            params.emplace(op->param.name(), op->param);
+        }
+        if (op->image.defined()) {
+            buffers.emplace(op->image.name(), op->image);
+        }
+    }
+
+    void visit(const Variable *op) override {
+        if (op->param.defined()) {
+            params.emplace(op->param.name(), op->param);
+        }
+        if (op->image.defined()) {
+            buffers.emplace(op->image.name(), op->image);
+        }
+    }
+
+public:
+    std::map<std::string, Parameter> params;
+    std::map<std::string, Buffer<>> buffers;
+};
+
+void describe_definition(std::ostream &out, const Definition &def) {
+    out << " args";
+    for (const Expr &e : def.args()) {
+        out << " " << e;
+    }
+    out << "\n  values";
+    for (const Expr &e : def.values()) {
+        out << " " << e;
+    }
+    out << "\n  predicate " << def.predicate() << "\n";
+    for (const ReductionVariable &rv : def.schedule().rvars()) {
+        out << "  rvar " << rv.var << " " << rv.min << " " << rv.extent << "\n";
+    }
+    for (const Specialization &s : def.specializations()) {
+        out << "  specialization " << s.condition << " " << s.failure_message << "\n";
+        describe_definition(out, s.definition);
+    }
+}
+
+void describe_parameter(std::ostream &out, const Parameter &p) {
+    out << "param " << p.name() << " " << p.type() << " " << p.dimensions() << "\n";
+    if (p.is_buffer()) {
+        for (int i = 0; i < p.dimensions(); i++) {
+            out << " dim " << i
+                << " " << p.min_constraint(i)
+                << " " << p.extent_constraint(i)
+                << " " << p.stride_constraint(i)
+                << " " << p.min_constraint_estimate(i)
+                << " " << p.extent_constraint_estimate(i) << "\n";
+        }
+    } else {
+        out << " " << p.estimate() << " " << p.min_value() << " " << p.max_value() << "\n";
+    }
+}
+
+// Describe everything about a pipeline that the autoscheduler may look
+// at but shouldn't modify: the algorithm, the estimates, the target and
+// the autoscheduler parameters.
+std::string describe_algorithm(const std::vector<Function> &outputs,
+                               const Target &target,
+                               const AutoschedulerParams &autoscheduler_params) {
+    std::ostringstream out;
+    // Print floating-point constants exactly, so that pipelines differing
+    // only in a constant don't collide.
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+#ifdef HALIDE_VERSION_MAJOR
+    out << "halide " << HALIDE_VERSION_MAJOR << "." << HALIDE_VERSION_MINOR << "." << HALIDE_VERSION_PATCH << "\n";
+#endif
+    out << "target " << target.to_string() << "\n"
+        << "autoscheduler " << autoscheduler_params.name << "\n";
+    for (const auto &p : autoscheduler_params.extra) {
+        out << " " << p.first << " " << p.second << "\n";
+    }
+
+    FindParameters find_parameters;
+    for (const auto &it : pipeline_env(outputs)) {
+        const Function &f = it.second;
+        f.accept(&find_parameters);
+        out << "func " << f.name() << "\n args";
+        for (const std::string &arg : f.args()) {
+            out << " " << arg;
+        }
+        out << "\n types";
+        for (const Type &t : f.output_types()) {
+            out << " " << t;
+        }
+        out << "\n";
+        if (f.has_extern_definition()) {
+            out << " extern " << f.extern_function_name()
+                << " " << (int)f.extern_definition_name_mangling()
+                << " " << (int)f.extern_function_device_api() << "\n";
+            for (const ExternFuncArgument &arg : f.extern_arguments()) {
+                out << "  arg " << (int)arg.arg_type << " ";
+                if (arg.is_func()) {
+                    out << Function(arg.func).name();
+                } else if (arg.is_expr()) {
+                    out << arg.expr;
+                } else if (arg.is_buffer()) {
+                    out << arg.buffer.name();
+                } else if (arg.is_image_param()) {
+                    out << arg.image_param.name();
+                }
+                out << "\n";
+            }
+        }
+        if (f.has_pure_definition()) {
+            out << " init";
+            describe_definition(out, f.definition());
+        }
+        for (const Definition &def : f.updates()) {
+            out << " update";
+            describe_definition(out, def);
+        }
+        for (const auto &w : f.schedule().wrappers()) {
+            out << " wrapper " << w.first << " " << Function(w.second).name() << "\n";
+        }
+        for (const Bound &b : f.schedule().estimates()) {
+            out << " estimate " << b.var << " " << b.min << " " << b.extent << "\n";
+        }
+    }
+
+    for (const Function &f : outputs) {
+        out << "output " << f.name() << "\n";
+        for (const Parameter &p : f.output_buffers()) {
+            describe_parameter(out, p);
+        }
+    }
+    for (const auto &it : find_parameters.params) {
+        describe_parameter(out, it.second);
+    }
+    for (const auto &it : find_parameters.buffers) {
+        const Buffer<> &b = it.second;
+        out << "buffer " << b.name() << " " << b.type();
+        for (int i = 0; i < b.dimensions(); i++) {
+            out << " " << b.dim(i).min() << " " << b.dim(i).extent() << " " << b.dim(i).stride();
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+// Schedules are stored as a sequence of length-prefixed strings and
+// integers. Exprs in schedules must be undefined or Int(32) constants to
+// be stored; any other Expr is still written out for the sake of the
+// database key, but marks the schedule as unrepresentable.
+class ScheduleWriter {
+    std::ostream &out;
+
+public:
+    bool representable = true;
+
+    ScheduleWriter(std::ostream &out)
+        : out(out) {
+    }
+
+    void write_int(int64_t i) {
+        out << i << "\n";
+    }
+
+    void write_bool(bool b) {
+        write_int(b ? 1 : 0);
+    }
+
+    void write_string(const std::string &s) {
+        out << s.size() << ":" << s << "\n";
+    }
+
+    void write_expr(const Expr &e) {
+        const IntImm *imm = e.as<IntImm>();
+        if (!e.defined()) {
+            out << "u\n";
+        } else if (imm && imm->type == Int(32)) {
+            out << "i " << imm->value << "\n";
+        } else {
+            representable = false;
+            out << "e " << e << "\n";
+        }
+    }
+
+    void write_level(const LoopLevel &level) {
+        std::string func_name, var_name;
+        bool is_rvar;
+        int stage_index;
+        level.get_parts(func_name, var_name, is_rvar, stage_index);
+        write_string(func_name);
+        write_string(var_name);
+        write_bool(is_rvar);
+        write_int(stage_index);
+    }
+};
+
+class ScheduleReader {
+    std::istream &in;
+
+public:
+    bool ok = true;
+
+    ScheduleReader(std::istream &in)
+        : in(in) {
+    }
+
+    int64_t read_int() {
+        int64_t i = 0;
+        if (!(in >> i)) {
+            ok = false;
+        }
+        return i;
+    }
+
+    bool read_bool() {
+        return read_int() != 0;
+    }
+
+    size_t read_count() {
+        int64_t n = read_int();
+        if (n < 0 || n > (1 << 20)) {
+            ok = false;
+            return 0;
+        }
+        return (size_t)n;
+    }
+
+    std::string read_string() {
+        size_t size = 0;
+        char c = 0;
+        if (!(in >> size) || !in.get(c) || c != ':' ||
+            (std::streamsize)size > in.rdbuf()->in_avail()) {
+            ok = false;
+            return "";
+        }
+        std::string s(size, ' ');
+        if (!in.read(&s[0], size)) {
+            ok = false;
+        }
+        return s;
+    }
+
+    Expr read_expr() {
+        std::string tag;
+        in >> tag;
+        if (tag == "u") {
+            return Expr();
+        } else if (tag == "i") {
+            return IntImm::make(Int(32), read_int());
+        }
+        ok = false;
+        return Expr();
+    }
+
+    LoopLevel read_level() {
+        std::string func_name = read_string();
+        std::string var_name = read_string();
+        bool is_rvar = read_bool();
+        int stage_index = (int)read_int();
+        return LoopLevel::from_parts(func_name, var_name, is_rvar, stage_index);
+    }
+};
+
+void write_stage_schedule(ScheduleWriter &w, const StageSchedule &s) {
+    w.write_int(s.splits().size());
+    for (const Split &split : s.splits()) {
+        w.write_string(split.old_var);
+        w.write_string(split.outer);
+        w.write_string(split.inner);
+        w.write_expr(split.factor);
+        w.write_bool(split.exact);
+        w.write_int((int)split.tail);
+        w.write_int((int)split.split_type);
+    }
+    w.write_int(s.dims().size());
+    for (const Dim &d : s.dims()) {
+        w.write_string(d.var);
+        w.write_int((int)d.for_type);
+        w.write_int((int)d.device_api);
+        w.write_int((int)d.dim_type);
+    }
+    if (!s.prefetches().empty()) {
+        w.representable = false;
+    }
+    w.write_level(s.fuse_level().level);
+    w.write_int(s.fuse_level().align.size());
+    for (const auto &it : s.fuse_level().align) {
+        w.write_string(it.first);
+        w.write_int((int)it.second);
+    }
+    w.write_int(s.fused_pairs().size());
+    for (const FusedPair &p : s.fused_pairs()) {
+        w.write_string(p.func_1);
+        w.write_string(p.func_2);
+        w.write_int(p.stage_1);
+        w.write_int(p.stage_2);
+        w.write_string(p.var_name);
+    }
+    w.write_bool(s.allow_race_conditions());
+    w.write_bool(s.atomic());
+    w.write_bool(s.override_atomic_associativity_test());
+    w.write_bool(s.allow_reassociation());
+    w.write_bool(s.touched());
+}
+
+// The init definition (if any) and then the updates of a Function.
+std::vector<Definition> stages_of(const Function &f) {
+    std::vector<Definition> stages;
+    if (f.has_pure_definition()) {
+        stages.push_back(f.definition());
+    }
+    stages.insert(stages.end(), f.updates().begin(), f.updates().end());
+    return stages;
+}
+
+void write_schedules(ScheduleWriter &w, const std::map<std::string, Function> &env) {
+    w.write_int(env.size());
+    for (const auto &it : env) {
+        const Function &f = it.second;
+        const FuncSchedule &s = f.schedule();
+        w.write_string(f.name());
+        w.write_level(s.store_level());
+        w.write_level(s.compute_level());
+        w.write_level(s.hoist_storage_level());
+        w.write_level(s.completion_level());
+        w.write_int((int)s.memory_type());
+        w.write_int((int)s.gather_mode());
+        w.write_bool(s.interleave_tuple());
+        w.write_int(s.code_size_budget());
+        w.write_bool(s.store_nontemporal());
+        w.write_bool(s.memoized());
+        w.write_expr(s.memoize_eviction_key());
+        w.write_bool(s.async());
+        w.write_expr(s.ring_buffer());
+        w.write_int(s.storage_dims().size());
+        for (const StorageDim &d : s.storage_dims()) {
+            w.write_string(d.var);
+            w.write_expr(d.alignment);
+            w.write_expr(d.bound);
+            w.write_expr(d.padding);
+            w.write_expr(d.critical_stride);
+            w.write_expr(d.fold_factor);
+            w.write_bool(d.fold_forward);
+        }
+        w.write_int(s.bounds().size());
+        for (const Bound &b : s.bounds()) {
+            w.write_string(b.var);
+            w.write_expr(b.min);
+            w.write_expr(b.extent);
+            w.write_expr(b.modulus);
+            w.write_expr(b.remainder);
+        }
+        std::vector<Definition> stages = stages_of(f);
+        w.write_int(stages.size());
+        for (const Definition &def : stages) {
+            if (!def.specializations().empty()) {
+                w.representable = false;
+            }
+            write_stage_schedule(w, def.schedule());
+        }
+    }
+}
+
+// A stored schedule, read in full before any of it is applied, so that a
+// malformed entry leaves the pipeline untouched.
+struct StoredStageSchedule {
+    std::vector<Split> splits;
+    std::vector<Dim> dims;
+    FuseLoopLevel fuse_level;
+    std::vector<FusedPair> fused_pairs;
+    bool allow_race_conditions, atomic, override_atomic_associativity_test, allow_reassociation, touched;
+};
+
+struct StoredFuncSchedule {
+    std::string name;
+    LoopLevel store_level, compute_level, hoist_storage_level, completion_level;
+    MemoryType memory_type;
+    GatherMode gather_mode;
+    bool interleave_tuple;
+    int code_size_budget;
+    bool store_nontemporal;
+    bool memoized, async;
+    Expr memoize_eviction_key, ring_buffer;
+    std::vector<StorageDim> storage_dims;
+    std::vector<Bound> bounds;
+    std::vector<StoredStageSchedule> stages;
+};
+
+StoredStageSchedule read_stage_schedule(ScheduleReader &r) {
+    StoredStageSchedule s;
+    s.splits.resize(r.read_count());
+    for (Split &split : s.splits) {
+        split.old_var = r.read_string();
+        split.outer = r.read_string();
+        split.inner = r.read_string();
+        split.factor = r.read_expr();
+        split.exact = r.read_bool();
+        split.tail = (TailStrategy)r.read_int();
+        split.split_type = (Split::SplitType)r.read_int();
+    }
+    s.dims.resize(r.read_count());
+    for (Dim &d : s.dims) {
+        d.var = r.read_string();
+        d.for_type = (ForType)r.read_int();
+        d.device_api = (DeviceAPI)r.read_int();
+        d.dim_type = (DimType)r.read_int();
+    }
+    s.fuse_level.level = r.read_level();
+    size_t aligns = r.read_count();
+    for (size_t i = 0; i < aligns && r.ok; i++) {
+        std::string var = r.read_string();
+        s.fuse_level.align[var] = (LoopAlignStrategy)r.read_int();
+    }
+    s.fused_pairs.resize(r.read_count());
+    for (FusedPair &p : s.fused_pairs) {
+        p.func_1 = r.read_string();
+        p.func_2 = r.read_string();
+        p.stage_1 = r.read_count();
+        p.stage_2 = r.read_count();
+        p.var_name = r.read_string();
+    }
+    s.allow_race_conditions = r.read_bool();
+    s.atomic = r.read_bool();
+    s.override_atomic_associativity_test = r.read_bool();
+    s.allow_reassociation = r.read_bool();
+    s.touched = r.read_bool();
+    return s;
+}
+
+StoredFuncSchedule read_func_schedule(ScheduleReader &r) {
+    StoredFuncSchedule s;
+    s.name = r.read_string();
+    s.store_level = r.read_level();
+    s.compute_level = r.read_level();
+    s.hoist_storage_level = r.read_level();
+    s.completion_level = r.read_level();
+    s.memory_type = (MemoryType)r.read_int();
+    s.gather_mode = (GatherMode)r.read_int();
+    s.interleave_tuple = r.read_bool();
+    s.code_size_budget = (int)r.read_int();
+    s.store_nontemporal = r.read_bool();
+    s.memoized = r.read_bool();
+    s.memoize_eviction_key = r.read_expr();
+    s.async = r.read_bool();
+    s.ring_buffer = r.read_expr();
+    s.storage_dims.resize(r.read_count());
+    for (StorageDim &d : s.storage_dims) {
+        d.var = r.read_string();
+        d.alignment = r.read_expr();
+        d.bound = r.read_expr();
+        d.padding = r.read_expr();
+        d.critical_stride = r.read_expr();
+        d.fold_factor = r.read_expr();
+        d.fold_forward = r.read_bool();
+    }
+    s.bounds.resize(r.read_count());
+    for (Bound &b : s.bounds) {
+        b.var = r.read_string();
+        b.min = r.read_expr();
+        b.extent = r.read_expr();
+        b.modulus = r.read_expr();
+        b.remainder = r.read_expr();
+    }
+    size_t stages = r.read_count();
+    for (size_t i = 0; i < stages && r.ok; i++) {
+        s.stages.push_back(read_stage_schedule(r));
+    }
+    return s;
+}
+
+void apply_schedule(Function f, const StoredFuncSchedule &stored) {
+    FuncSchedule &s = f.schedule();
+    s.store_level() = stored.store_level;
+    s.compute_level() = stored.compute_level;
+    s.hoist_storage_level() = stored.hoist_storage_level;
+    s.completion_level() = stored.completion_level;
+    s.memory_type() = stored.memory_type;
+    s.gather_mode() = stored.gather_mode;
+    s.interleave_tuple() = stored.interleave_tuple;
+    s.code_size_budget() = stored.code_size_budget;
+    s.store_nontemporal() = stored.store_nontemporal;
+    s.memoized() = stored.memoized;
+    s.memoize_eviction_key() = stored.memoize_eviction_key;
+    s.async() = stored.async;
+    s.ring_buffer() = stored.ring_buffer;
+    s.storage_dims() = stored.storage_dims;
+    s.bounds() = stored.bounds;
+    std::vector<Definition> stages = stages_of(f);
+    for (size_t i = 0; i < stored.stages.size(); i++) {
+        const StoredStageSchedule &stage = stored.stages[i];
+        StageSchedule &ss = stages[i].schedule();
+        ss.splits() = stage.splits;
+        ss.dims() = stage.dims;
+        ss.fuse_level() = stage.fuse_level;
+        ss.fused_pairs() = stage.fused_pairs;
+        ss.allow_race_conditions() = stage.allow_race_conditions;
+        ss.atomic() = stage.atomic;
+        ss.override_atomic_associativity_test() = stage.override_atomic_associativity_test;
+        ss.allow_reassociation() = stage.allow_reassociation;
+        ss.touched() = stage.touched;
+    }
+}
+
+std::string hash_to_hex(const std::string &str) {
+    auto hash = llvm::SHA1::hash(llvm::ArrayRef<uint8_t>((const uint8_t *)str.data(), str.size()));
+    return llvm::toHex(hash, /*LowerCase*/ true);
+}
+
+}  // namespace
+
+ScheduleDatabase::ScheduleDatabase(const std::vector<Function> &outputs,
+                                   const Target &target,
+                                   const AutoschedulerParams &autoscheduler_params)
+    : outputs(outputs) {
+    const std::string dir = get_env_variable("HL_SCHEDULE_DATABASE_DIR");
+    if (dir.empty()) {
+        return;
+    }
+    algorithm = describe_algorithm(outputs, target, autoscheduler_params);
+
+    // The key also covers any schedule already applied to the pipeline,
+    // as autoschedulers may respect parts of it.
+    std::ostringstream key;
+    key << std::setprecision(std::numeric_limits<double>::max_digits10)
+        << algorithm;
+    ScheduleWriter w(key);
+    write_schedules(w, pipeline_env(outputs));
+    path = dir + "/" + hash_to_hex(key.str()) + ".schedule";
+}
+
+bool ScheduleDatabase::load(AutoSchedulerResults *results) const {
+    if (!enabled()) {
+        return false;
+    }
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) {
+        return false;
+    }
+    std::istringstream in((*buffer)->getBuffer().str());
+    ScheduleReader r(in);
+    // Check the whole algorithm rather than trusting the hash.
+    if (r.read_int() != schedule_database_version ||
+        r.read_string() != algorithm ||
+        !r.ok) {
+        debug(1) << "Ignoring mismatched schedule database entry " << path << "\n";
+        return false;
+    }
+    std::string schedule_source = r.read_string();
+    std::string featurization = r.read_string();
+
+    std::map<std::string, Function> env = pipeline_env(outputs);
+    std::vector<StoredFuncSchedule> schedules;
+    if (r.read_count() != env.size()) {
+        r.ok = false;
+    }
+    for (auto it = env.begin(); it != env.end() && r.ok; it++) {
+        schedules.push_back(read_func_schedule(r));
+        if (schedules.back().name != it->first ||
+            schedules.back().stages.size() != stages_of(it->second).size()) {
+            r.ok = false;
+        }
+    }
+    if (!r.ok) {
+        debug(1) << "Ignoring malformed schedule database entry " << path << "\n";
+        return false;
+    }
+
+    for (const StoredFuncSchedule &s : schedules) {
+        apply_schedule(env.at(s.name), s);
+    }
+    results->schedule_source = schedule_source;
+    results->featurization.assign(featurization.begin(), featurization.end());
+    debug(1) << "Loaded schedule from schedule database " << path << "\n";
+    return true;
+}
+
+void ScheduleDatabase::save(const AutoSchedulerResults &results) const {
+    if (!enabled()) {
+        return;
+    }
+    if (describe_algorithm(outputs, results.target, results.autoscheduler_params) != algorithm) {
+        debug(1) << "Not storing schedule in schedule database: the autoscheduler changed the algorithm\n";
+        return;
+    }
+
+    std::ostringstream out;
+    ScheduleWriter w(out);
+    w.write_int(schedule_database_version);
+    w.write_string(algorithm);
+    w.write_string(results.schedule_source);
+    w.write_string(std::string(results.featurization.begin(), results.featurization.end()));
+    write_schedules(w, pipeline_env(outputs));
+    if (!w.representable) {
+        debug(1) << "Not storing schedule in schedule database: it can't be represented\n";
+        return;
+    }
+
+    // Write to a temporary file and rename it into place, so that
+    // concurrent processes never see a partially-written entry.
+    int fd = -1;
+    llvm::SmallString<256> tmp_path;
+    if (llvm::sys::fs::createUniqueFile(path + ".%%%%%%%%.tmp", fd, tmp_path)) {
+        debug(1) << "Unable to write to schedule database " << path << "\n";
+        return;
+    }
+    {
+        llvm::raw_fd_ostream file(fd, /*shouldClose*/ true);
+        file << out.str();
+    }
+    if (llvm::sys::fs::rename(tmp_path, path)) {
+        llvm::sys::fs::remove(tmp_path);
+        debug(1) << "Unable to write to schedule database " << path << "\n";
+        return;
+    }
+    debug(1) << "Stored schedule in schedule database " << path << "\n";
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,62 @@
+#ifndef HALIDE_SCHEDULE_DATABASE_H
+#define HALIDE_SCHEDULE_DATABASE_H
+
+/** \file
+ * Defines an on-disk database of the schedules chosen by autoschedulers.
+ *
+ * Autoscheduling a large pipeline can take far longer than compiling it,
+ * and is usually repeated unchanged on every build. If the environment
+ * variable HL_SCHEDULE_DATABASE_DIR names a directory, then
+ * Pipeline::apply_autoscheduler stores the schedule it gets back in that
+ * directory, under a hash of the algorithm, the estimates, any existing
+ * schedule, the target and the autoscheduler parameters. The next time
+ * the same pipeline is autoscheduled in the same way, the schedule is
+ * applied directly from the database instead. Any change to the pipeline
+ * changes the hash, so stale entries are never used.
+ */
+
+#include <string>
+#include <vector>
+
+#include "Function.h"
+
+namespace Halide {
+
+struct AutoSchedulerResults;
+struct AutoschedulerParams;
+struct Target;
+
+namespace Internal {
+
+class ScheduleDatabase {
+    std::vector<Function> outputs;
+    std::string algorithm, path;
+
+public:
+    /** Describe a pipeline as it is before autoscheduling. The database is
+     * disabled if HL_SCHEDULE_DATABASE_DIR is not set. */
+    ScheduleDatabase(const std::vector<Function> &outputs,
+                     const Target &target,
+                     const AutoschedulerParams &autoscheduler_params);
+
+    bool enabled() const {
+        return !path.empty();
+    }
+
+    /** If the database holds a schedule for the pipeline, apply it to the
+     * pipeline's Functions, fill in the schedule_source and featurization
+     * of the results, and return true. */
+    bool load(AutoSchedulerResults *results) const;
+
+    /** Store the schedule the autoscheduler applied to the pipeline. Does
+     * nothing if the autoscheduler did more than set the schedules of
+     * the existing Functions (e.g. by adding wrappers or using rfactor),
+     * or if the schedule uses directives that can't be stored, such as
+     * prefetches or split factors that aren't constants. */
+    void save(const AutoSchedulerResults &results) const;
+};
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -448,13 +448,21 @@ Stmt build_loop_nest(
     return stmt;
 }
 
-// Build a loop nest about a provide node using a schedule
+Stmt profiler_stage_marker(const string &name) {
+    return Evaluate::make(Call::make(Int(32), Call::profiler_stage_marker,
+                                     {StringImm::make(name)}, Call::Intrinsic));
+}
+
+// Build a loop nest about a provide node using a schedule. If
+// profiler_stage is not empty, each specialization is marked for the
+// profiler as a child of it.
 Stmt build_provide_loop_nest(const map<string, Function> &env,
                              const string &prefix,
                              const Function &func,
                              const Definition &def,
                              int start_fuse,
-                             bool is_update) {
+                             bool is_update,
+                             const string &profiler_stage) {
 
     internal_assert(!is_update == def.is_init());
 
@@ -506,7 +514,15 @@ Stmt build_provide_loop_nest(const map<string, Function> &env,
     for (size_t i = specializations.size(); i > 0; i--) {
         const Specialization &s = specializations[i - 1];
         if (s.failure_message.empty()) {
-            Stmt then_case = build_provide_loop_nest(env, prefix, func, s.definition, start_fuse, is_update);
+            string specialization_stage;
+            if (!profiler_stage.empty()) {
+                specialization_stage = profiler_stage + ".specialization(" + std::to_string(i - 1) + ")";
+            }
+            Stmt then_case = build_provide_loop_nest(env, prefix, func, s.definition, start_fuse, is_update,
+                                                     specialization_stage);
+            if (!specialization_stage.empty()) {
+                then_case = Block::make(profiler_stage_marker(specialization_stage), then_case);
+            }
             stmt = IfThenElse::make(s.condition, then_case, stmt);
         } else {
             internal_assert(equal(s.condition, const_true()));
@@ -1440,7 +1456,30 @@ private:
         }
     }
 
+    // The name the profiler bills a stage of a Func under when the
+    // profile_stages feature is on, or an empty string if the stage
+    // shouldn't be billed separately.
+    string profiler_stage_name(const Function &f, int stage) const {
+        if (!target.has_feature(Target::ProfileStages) ||
+            !(target.has_feature(Target::Profile) || target.has_feature(Target::ProfileByTimer)) ||
+            funcs.size() != 1) {
+            return string();
+        }
+        // Stages fused with compute_with are interleaved in one loop
+        // nest, so they stay billed to the Func as a whole.
+        for (size_t i = 0; i <= f.updates().size(); i++) {
+            const Definition &def = (i == 0) ? f.definition() : f.update((int)(i - 1));
+            const LoopLevel &fuse_level = def.schedule().fuse_level().level;
+            if (!def.schedule().fused_pairs().empty() ||
+                !(fuse_level.is_inlined() || fuse_level.is_root())) {
+                return string();
+            }
+        }
+        return stage == 0 ? f.name() : f.name() + ".update(" + std::to_string(stage - 1) + ")";
+    }
+
     Stmt build_produce_definition(const Function &f, const string &prefix, const Definition &def, bool is_update,
+                                  const string &profiler_stage,
                                   map<string, Expr> &replacements, vector<pair<string, Expr>> &add_lets) {
         const vector<Dim> &dims = def.schedule().dims();  // From inner to outer
         const LoopLevel &fuse_level = def.schedule().fuse_level().level;
@@ -1483,7 +1522,7 @@ private:
             }
         }
 
-        Stmt produce = build_provide_loop_nest(env, prefix, f, def, (int)(start_fuse), is_update);
+        Stmt produce = build_provide_loop_nest(env, prefix, f, def, (int)(start_fuse), is_update, profiler_stage);
 
         // Strip off the containing lets. The bounds of the parent fused loop
         // (i.e. the union bounds) might refer to them, so we need to move them
@@ -1492,6 +1531,9 @@ private:
             add_lets.emplace_back(let->name, let->value);
             produce = let->body;
         }
+        if (is_update && !profiler_stage.empty()) {
+            produce = Block::make(profiler_stage_marker(profiler_stage), produce);
+        }
         return produce;
     }
 
@@ -1743,6 +1785,7 @@ private:
             const auto &def = (func_stage.second == 0) ? f.definition() : f.updates()[func_stage.second - 1];
 
             const Stmt &produceDef = build_produce_definition(f, def_prefix, def, func_stage.second > 0,
+                                                              profiler_stage_name(f, func_stage.second),
                                                               replacements, add_lets);
             producer = inject_stmt(producer, produceDef, def.schedule().fuse_level().level);
         }
@@ -2281,6 +2324,41 @@ bool validate_schedule(Function f, const Stmt &s, const Target &target, bool is_
         }
     }
 
+    // The allocation may only be hoisted out through serial loops, to a
+    // site outside the store_at level.
+    const LoopLevel &hoist_at = f.schedule().hoist_storage_level();
+    if (both_ok() && !hoist_at.is_inlined()) {
+        user_assert(!f.schedule().memoized())
+            << "Func \"" << f.name() << "\" is memoized, so its storage can't be hoisted.\n";
+        int hoist_idx = -1;
+        for (int i = 0; i <= store_idx; i++) {
+            if (sites[i].loop_level.match(hoist_at)) {
+                hoist_idx = i;
+            }
+        }
+        user_assert(hoist_idx >= 0)
+            << "Func \"" << f.name() << "\" is scheduled to hoist_storage at "
+            << hoist_at.to_string() << ", which is not outside its store_at level "
+            << store_at.to_string() << ".\n";
+        for (int i = hoist_idx + 1; i <= store_idx; i++) {
+            user_assert(!sites[i].is_parallel)
+                << "Func \"" << f.name() << "\" can't have its storage hoisted out of the "
+                << "parallel loop over " << sites[i].loop_level.to_string() << ".\n";
+        }
+    }
+
+    // Ring buffers are allocated at the hoist_storage level, and only pay
+    // off if the producer can run ahead of its consumer, either in
+    // another thread, or in the same GPU thread block.
+    if (f.schedule().ring_buffer().defined()) {
+        user_assert(f.schedule().async() || f.schedule().memory_type() == MemoryType::GPUShared)
+            << "Func \"" << f.name() << "\" is ring-buffered, so it must also be async, "
+            << "or stored in GPU shared memory.\n";
+        user_assert(!hoist_at.is_inlined())
+            << "Func \"" << f.name() << "\" is ring-buffered, so it must also have a "
+            << "hoist_storage level at which to allocate the buffers.\n";
+    }
+
     if (!both_ok()) {
         err << "Func \"" << f.name() << "\" is computed at the following invalid location:\n"
             << "  " << schedule_to_source(f, store_at, compute_at) << "\n"
@@ -233,34 +233,39 @@ Expr Simplify::visit(const LT *op, ExprInfo *bounds) {
               // Cases where we can remove a min on one side because
               // one term dominates another. These rules were
               // synthesized then extended by hand.
-              rewrite(min(z, y) < min(x, y), z < min(x, y)) ||
-              rewrite(min(z, y) < min(y, x), z < min(y, x)) ||
-              rewrite(min(z, y) < min(x, y + c0), min(z, y) < x, c0 > 0) ||
-              rewrite(min(z, y) < min(y + c0, x), min(z, y) < x, c0 > 0) ||
-              rewrite(min(z, y + c0) < min(x, y), min(z, y + c0) < x, c0 < 0) ||
-              rewrite(min(z, y + c0) < min(y, x), min(z, y + c0) < x, c0 < 0) ||
-
-              rewrite(min(y, z) < min(x, y), z < min(x, y)) ||
-              rewrite(min(y, z) < min(y, x), z < min(y, x)) ||
-              rewrite(min(y, z) < min(x, y + c0), min(z, y) < x, c0 > 0) ||
-              rewrite(min(y, z) < min(y + c0, x), min(z, y) < x, c0 > 0) ||
-              rewrite(min(y + c0, z) < min(x, y), min(z, y + c0) < x, c0 < 0) ||
-              rewrite(min(y + c0, z) < min(y, x), min(z, y + c0) < x, c0 < 0) ||
-
-              // Equivalents with max
-              rewrite(max(z, y) < max(x, y), max(z, y) < x) ||
-              rewrite(max(z, y) < max(y, x), max(z, y) < x) ||
-              rewrite(max(z, y) < max(x, y + c0), max(z, y) < x, c0 < 0) ||
-              rewrite(max(z, y) < max(y + c0, x), max(z, y) < x, c0 < 0) ||
-              rewrite(max(z, y + c0) < max(x, y), max(z, y + c0) < x, c0 > 0) ||
-              rewrite(max(z, y + c0) < max(y, x), max(z, y + c0) < x, c0 > 0) ||
-
-              rewrite(max(y, z) < max(x, y), max(z, y) < x) ||
-              rewrite(max(y, z) < max(y, x), max(z, y) < x) ||
-              rewrite(max(y, z) < max(x, y + c0), max(z, y) < x, c0 < 0) ||
-              rewrite(max(y, z) < max(y + c0, x), max(z, y) < x, c0 < 0) ||
-              rewrite(max(y + c0, z) < max(x, y), max(z, y + c0) < x, c0 > 0) ||
-              rewrite(max(y + c0, z) < max(y, x), max(z, y + c0) < x, c0 > 0) ||
+              // These groups of rules can only match if their shared root
+              // pattern does, so test that once up front instead of failing
+              // each rule separately.
+              (a.node_type() == b.node_type() && (a.node_type() == IRNodeType::Min || a.node_type() == IRNodeType::Max) &&
+               (rewrite(min(z, y) < min(x, y), z < min(x, y)) ||
+                rewrite(min(z, y) < min(y, x), z < min(y, x)) ||
+                rewrite(min(z, y) < min(x, y + c0), min(z, y) < x, c0 > 0) ||
+                rewrite(min(z, y) < min(y + c0, x), min(z, y) < x, c0 > 0) ||
+                rewrite(min(z, y + c0) < min(x, y), min(z, y + c0) < x, c0 < 0) ||
+                rewrite(min(z, y + c0) < min(y, x), min(z, y + c0) < x, c0 < 0) ||
+
+                rewrite(min(y, z) < min(x, y), z < min(x, y)) ||
+                rewrite(min(y, z) < min(y, x), z < min(y, x)) ||
+                rewrite(min(y, z) < min(x, y + c0), min(z, y) < x, c0 > 0) ||
+                rewrite(min(y, z) < min(y + c0, x), min(z, y) < x, c0 > 0) ||
+                rewrite(min(y + c0, z) < min(x, y), min(z, y + c0) < x, c0 < 0) ||
+                rewrite(min(y + c0, z) < min(y, x), min(z, y + c0) < x, c0 < 0) ||
+
+                // Equivalents with max
+                rewrite(max(z, y) < max(x, y), max(z, y) < x) ||
+                rewrite(max(z, y) < max(y, x), max(z, y) < x) ||
+                rewrite(max(z, y) < max(x, y + c0), max(z, y) < x, c0 < 0) ||
+                rewrite(max(z, y) < max(y + c0, x), max(z, y) < x, c0 < 0) ||
+                rewrite(max(z, y + c0) < max(x, y), max(z, y + c0) < x, c0 > 0) ||
+                rewrite(max(z, y + c0) < max(y, x), max(z, y + c0) < x, c0 > 0) ||
+
+                rewrite(max(y, z) < max(x, y), max(z, y) < x) ||
+                rewrite(max(y, z) < max(y, x), max(z, y) < x) ||
+                rewrite(max(y, z) < max(x, y + c0), max(z, y) < x, c0 < 0) ||
+                rewrite(max(y, z) < max(y + c0, x), max(z, y) < x, c0 < 0) ||
+                rewrite(max(y + c0, z) < max(x, y), max(z, y + c0) < x, c0 > 0) ||
+                rewrite(max(y + c0, z) < max(y, x), max(z, y + c0) < x, c0 > 0) ||
+                false)) ||
 
               // Comparisons with selects:
               // x < select(c, t, f) == c && (x < t) || !c && (x < f)
@@ -289,45 +294,47 @@ Expr Simplify::visit(const LT *op, ExprInfo *bounds) {
               rewrite(select(x, c1, c2) < c0, select(x, fold(c1 < c0), fold(c2 < c0))) ||
 
               // Normalize comparison of ramps to a comparison of a ramp and a broadacst
-              rewrite(ramp(x, y, lanes) < ramp(z, w, lanes), ramp(x - z, y - w, lanes) < 0) ||
-
-              // Rules of the form:
-              // rewrite(ramp(x, y, lanes) < broadcast(z, lanes), ramp(x - z, y, lanes) < 0) ||
-              // where x and z cancel usefully
-              rewrite(ramp(x + z, y, lanes) < broadcast(x + w, lanes), ramp(z, y, lanes) < broadcast(w, lanes)) ||
-              rewrite(ramp(z + x, y, lanes) < broadcast(x + w, lanes), ramp(z, y, lanes) < broadcast(w, lanes)) ||
-              rewrite(ramp(x + z, y, lanes) < broadcast(w + x, lanes), ramp(z, y, lanes) < broadcast(w, lanes)) ||
-              rewrite(ramp(z + x, y, lanes) < broadcast(w + x, lanes), ramp(z, y, lanes) < broadcast(w, lanes)) ||
-              rewrite(ramp(x - z, y, lanes) < broadcast(x - w, lanes), ramp(0 - z, y, lanes) < broadcast(0 - w, lanes), !is_const(x, 0)) ||
-              rewrite(ramp(z - x, y, lanes) < broadcast(w - x, lanes), ramp(z, y, lanes) < broadcast(w, lanes)) ||
-
-              // z = 0
-              rewrite(ramp(x, y, lanes) < broadcast(x + w, lanes), ramp(0, y, lanes) < broadcast(w, lanes)) ||
-              rewrite(ramp(x, y, lanes) < broadcast(w + x, lanes), ramp(0, y, lanes) < broadcast(w, lanes)) ||
-              rewrite(ramp(x, y, lanes) < broadcast(x - w, lanes), ramp(0, y, lanes) < broadcast(0 - w, lanes), !is_const(x, 0)) ||
-
-              // w = 0
-              rewrite(ramp(x + z, y, lanes) < broadcast(x, lanes), ramp(z, y, lanes) < 0) ||
-              rewrite(ramp(z + x, y, lanes) < broadcast(x, lanes), ramp(z, y, lanes) < 0) ||
-              rewrite(ramp(x - z, y, lanes) < broadcast(x, lanes), ramp(0 - z, y, lanes) < 0, !is_const(x, 0)) ||
-
-              // With the args flipped
-              rewrite(broadcast(x + w, lanes) < ramp(x + z, y, lanes), broadcast(w, lanes) < ramp(z, y, lanes)) ||
-              rewrite(broadcast(x + w, lanes) < ramp(z + x, y, lanes), broadcast(w, lanes) < ramp(z, y, lanes)) ||
-              rewrite(broadcast(w + x, lanes) < ramp(x + z, y, lanes), broadcast(w, lanes) < ramp(z, y, lanes)) ||
-              rewrite(broadcast(w + x, lanes) < ramp(z + x, y, lanes), broadcast(w, lanes) < ramp(z, y, lanes)) ||
-              rewrite(broadcast(x - w, lanes) < ramp(x - z, y, lanes), broadcast(0 - w, lanes) < ramp(0 - z, y, lanes), !is_const(x, 0)) ||
-              rewrite(broadcast(w - x, lanes) < ramp(z - x, y, lanes), broadcast(w, lanes) < ramp(z, y, lanes)) ||
-
-              // z = 0
-              rewrite(broadcast(x + w, lanes) < ramp(x, y, lanes), broadcast(w, lanes) < ramp(0, y, lanes)) ||
-              rewrite(broadcast(w + x, lanes) < ramp(x, y, lanes), broadcast(w, lanes) < ramp(0, y, lanes)) ||
-              rewrite(broadcast(x - w, lanes) < ramp(x, y, lanes), broadcast(0 - w, lanes) < ramp(0, y, lanes), !is_const(x, 0)) ||
-
-              // w = 0
-              rewrite(broadcast(x, lanes) < ramp(x + z, y, lanes), 0 < ramp(z, y, lanes)) ||
-              rewrite(broadcast(x, lanes) < ramp(z + x, y, lanes), 0 < ramp(z, y, lanes)) ||
-              rewrite(broadcast(x, lanes) < ramp(x - z, y, lanes), 0 < ramp(0 - z, y, lanes), !is_const(x, 0)) ||
+              (op->type.is_vector() &&
+               (rewrite(ramp(x, y, lanes) < ramp(z, w, lanes), ramp(x - z, y - w, lanes) < 0) ||
+
+                // Rules of the form:
+                // rewrite(ramp(x, y, lanes) < broadcast(z, lanes), ramp(x - z, y, lanes) < 0) ||
+                // where x and z cancel usefully
+                rewrite(ramp(x + z, y, lanes) < broadcast(x + w, lanes), ramp(z, y, lanes) < broadcast(w, lanes)) ||
+                rewrite(ramp(z + x, y, lanes) < broadcast(x + w, lanes), ramp(z, y, lanes) < broadcast(w, lanes)) ||
+                rewrite(ramp(x + z, y, lanes) < broadcast(w + x, lanes), ramp(z, y, lanes) < broadcast(w, lanes)) ||
+                rewrite(ramp(z + x, y, lanes) < broadcast(w + x, lanes), ramp(z, y, lanes) < broadcast(w, lanes)) ||
+                rewrite(ramp(x - z, y, lanes) < broadcast(x - w, lanes), ramp(0 - z, y, lanes) < broadcast(0 - w, lanes), !is_const(x, 0)) ||
+                rewrite(ramp(z - x, y, lanes) < broadcast(w - x, lanes), ramp(z, y, lanes) < broadcast(w, lanes)) ||
+
+                // z = 0
+                rewrite(ramp(x, y, lanes) < broadcast(x + w, lanes), ramp(0, y, lanes) < broadcast(w, lanes)) ||
+                rewrite(ramp(x, y, lanes) < broadcast(w + x, lanes), ramp(0, y, lanes) < broadcast(w, lanes)) ||
+                rewrite(ramp(x, y, lanes) < broadcast(x - w, lanes), ramp(0, y, lanes) < broadcast(0 - w, lanes), !is_const(x, 0)) ||
+
+                // w = 0
+                rewrite(ramp(x + z, y, lanes) < broadcast(x, lanes), ramp(z, y, lanes) < 0) ||
+                rewrite(ramp(z + x, y, lanes) < broadcast(x, lanes), ramp(z, y, lanes) < 0) ||
+                rewrite(ramp(x - z, y, lanes) < broadcast(x, lanes), ramp(0 - z, y, lanes) < 0, !is_const(x, 0)) ||
+
+                // With the args flipped
+                rewrite(broadcast(x + w, lanes) < ramp(x + z, y, lanes), broadcast(w, lanes) < ramp(z, y, lanes)) ||
+                rewrite(broadcast(x + w, lanes) < ramp(z + x, y, lanes), broadcast(w, lanes) < ramp(z, y, lanes)) ||
+                rewrite(broadcast(w + x, lanes) < ramp(x + z, y, lanes), broadcast(w, lanes) < ramp(z, y, lanes)) ||
+                rewrite(broadcast(w + x, lanes) < ramp(z + x, y, lanes), broadcast(w, lanes) < ramp(z, y, lanes)) ||
+                rewrite(broadcast(x - w, lanes) < ramp(x - z, y, lanes), broadcast(0 - w, lanes) < ramp(0 - z, y, lanes), !is_const(x, 0)) ||
+                rewrite(broadcast(w - x, lanes) < ramp(z - x, y, lanes), broadcast(w, lanes) < ramp(z, y, lanes)) ||
+
+                // z = 0
+                rewrite(broadcast(x + w, lanes) < ramp(x, y, lanes), broadcast(w, lanes) < ramp(0, y, lanes)) ||
+                rewrite(broadcast(w + x, lanes) < ramp(x, y, lanes), broadcast(w, lanes) < ramp(0, y, lanes)) ||
+                rewrite(broadcast(x - w, lanes) < ramp(x, y, lanes), broadcast(0 - w, lanes) < ramp(0, y, lanes), !is_const(x, 0)) ||
+
+                // w = 0
+                rewrite(broadcast(x, lanes) < ramp(x + z, y, lanes), 0 < ramp(z, y, lanes)) ||
+                rewrite(broadcast(x, lanes) < ramp(z + x, y, lanes), 0 < ramp(z, y, lanes)) ||
+                rewrite(broadcast(x, lanes) < ramp(x - z, y, lanes), 0 < ramp(0 - z, y, lanes), !is_const(x, 0)) ||
+                false)) ||
 
               false)) ||
             (no_overflow_int(ty) && EVAL_IN_LAMBDA
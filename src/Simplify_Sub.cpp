@@ -37,39 +37,46 @@ Expr Simplify::visit(const Sub *op, ExprInfo *bounds) {
             (rewrite(c0 - c1, fold(c0 - c1)) ||
              (!op->type.is_uint() && rewrite(x - c0, x + fold(-c0), !overflows(-c0))) ||
              rewrite(x - x, 0) || // We want to remutate this just to get better bounds
-             rewrite(ramp(x, y, c0) - ramp(z, w, c0), ramp(x - z, y - w, c0)) ||
-             rewrite(ramp(x, y, c0) - broadcast(z, c0), ramp(x - z, y, c0)) ||
-             rewrite(broadcast(x, c0) - ramp(z, w, c0), ramp(x - z, -w, c0)) ||
-             rewrite(broadcast(x, c0) - broadcast(y, c0), broadcast(x - y, c0)) ||
-             rewrite(broadcast(x, c0) - broadcast(y, c1), broadcast(x - broadcast(y, fold(c1/c0)), c0), c1 % c0 == 0) ||
-             rewrite(broadcast(y, c1) - broadcast(x, c0), broadcast(broadcast(y, fold(c1/c0)) - x, c0), c1 % c0 == 0) ||
-             rewrite((x - broadcast(y, c0)) - broadcast(z, c0), x - broadcast(y + z, c0)) ||
-             rewrite((x + broadcast(y, c0)) - broadcast(z, c0), x + broadcast(y - z, c0)) ||
-
-             rewrite(ramp(broadcast(x, c0), y, c1) - broadcast(z, c2), ramp(broadcast(x - z, c0), y, c1), c2 == c0 * c1) ||
-             rewrite(ramp(ramp(x, y, c0), z, c1) - broadcast(w, c2), ramp(ramp(x - w, y, c0), z, c1), c2 == c0 * c1) ||
-             rewrite(select(x, y, z) - select(x, w, u), select(x, y - w, z - u)) ||
-             rewrite(select(x, y, z) - y, select(x, 0, z - y)) ||
-             rewrite(select(x, y, z) - z, select(x, y - z, 0)) ||
-             rewrite(y - select(x, y, z), select(x, 0, y - z)) ||
-             rewrite(z - select(x, y, z), select(x, z - y, 0)) ||
-
-             rewrite(select(x, y + w, z) - y, select(x, w, z - y)) ||
-             rewrite(select(x, w + y, z) - y, select(x, w, z - y)) ||
-             rewrite(select(x, y, z + w) - z, select(x, y - z, w)) ||
-             rewrite(select(x, y, w + z) - z, select(x, y - z, w)) ||
-             rewrite(select(x, y + (z + w), u) - w, select(x, y + z, u - w)) ||
-             rewrite(select(x, y + (z + w), u) - z, select(x, y + w, u - z)) ||
-             rewrite(select(x, (y + z) + w, u) - y, select(x, w + z, u - y)) ||
-             rewrite(select(x, (y + z) + w, u) - z, select(x, w + y, u - z)) ||
-             rewrite(select(x, y + z, w) - (u + y), select(x, z, w - y) - u) ||
-             rewrite(select(x, y + z, w) - (u + z), select(x, y, w - z) - u) ||
-             rewrite(select(x, y + z, w) - (y + u), select(x, z, w - y) - u) ||
-             rewrite(select(x, y + z, w) - (z + u), select(x, y, w - z) - u) ||
-             rewrite(y - select(x, y + w, z), 0 - select(x, w, z - y)) ||
-             rewrite(y - select(x, w + y, z), 0 - select(x, w, z - y)) ||
-             rewrite(z - select(x, y, z + w), 0 - select(x, y - z, w)) ||
-             rewrite(z - select(x, y, w + z), 0 - select(x, y - z, w)) ||
+             // These groups of rules can only match if their shared root
+             // pattern does, so test that once up front instead of failing
+             // each rule separately.
+             (op->type.is_vector() &&
+              (rewrite(ramp(x, y, c0) - ramp(z, w, c0), ramp(x - z, y - w, c0)) ||
+               rewrite(ramp(x, y, c0) - broadcast(z, c0), ramp(x - z, y, c0)) ||
+               rewrite(broadcast(x, c0) - ramp(z, w, c0), ramp(x - z, -w, c0)) ||
+               rewrite(broadcast(x, c0) - broadcast(y, c0), broadcast(x - y, c0)) ||
+               rewrite(broadcast(x, c0) - broadcast(y, c1), broadcast(x - broadcast(y, fold(c1/c0)), c0), c1 % c0 == 0) ||
+               rewrite(broadcast(y, c1) - broadcast(x, c0), broadcast(broadcast(y, fold(c1/c0)) - x, c0), c1 % c0 == 0) ||
+               rewrite((x - broadcast(y, c0)) - broadcast(z, c0), x - broadcast(y + z, c0)) ||
+               rewrite((x + broadcast(y, c0)) - broadcast(z, c0), x + broadcast(y - z, c0)) ||
+
+               rewrite(ramp(broadcast(x, c0), y, c1) - broadcast(z, c2), ramp(broadcast(x - z, c0), y, c1), c2 == c0 * c1) ||
+               rewrite(ramp(ramp(x, y, c0), z, c1) - broadcast(w, c2), ramp(ramp(x - w, y, c0), z, c1), c2 == c0 * c1) ||
+               false)) ||
+             ((a.node_type() == IRNodeType::Select || b.node_type() == IRNodeType::Select) &&
+              (rewrite(select(x, y, z) - select(x, w, u), select(x, y - w, z - u)) ||
+               rewrite(select(x, y, z) - y, select(x, 0, z - y)) ||
+               rewrite(select(x, y, z) - z, select(x, y - z, 0)) ||
+               rewrite(y - select(x, y, z), select(x, 0, y - z)) ||
+               rewrite(z - select(x, y, z), select(x, z - y, 0)) ||
+
+               rewrite(select(x, y + w, z) - y, select(x, w, z - y)) ||
+               rewrite(select(x, w + y, z) - y, select(x, w, z - y)) ||
+               rewrite(select(x, y, z + w) - z, select(x, y - z, w)) ||
+               rewrite(select(x, y, w + z) - z, select(x, y - z, w)) ||
+               rewrite(select(x, y + (z + w), u) - w, select(x, y + z, u - w)) ||
+               rewrite(select(x, y + (z + w), u) - z, select(x, y + w, u - z)) ||
+               rewrite(select(x, (y + z) + w, u) - y, select(x, w + z, u - y)) ||
+               rewrite(select(x, (y + z) + w, u) - z, select(x, w + y, u - z)) ||
+               rewrite(select(x, y + z, w) - (u + y), select(x, z, w - y) - u) ||
+               rewrite(select(x, y + z, w) - (u + z), select(x, y, w - z) - u) ||
+               rewrite(select(x, y + z, w) - (y + u), select(x, z, w - y) - u) ||
+               rewrite(select(x, y + z, w) - (z + u), select(x, y, w - z) - u) ||
+               rewrite(y - select(x, y + w, z), 0 - select(x, w, z - y)) ||
+               rewrite(y - select(x, w + y, z), 0 - select(x, w, z - y)) ||
+               rewrite(z - select(x, y, z + w), 0 - select(x, y - z, w)) ||
+               rewrite(z - select(x, y, w + z), 0 - select(x, y - z, w)) ||
+               false)) ||
 
              rewrite((x + y) - x, y) ||
              rewrite((x + y) - y, x) ||
@@ -1,4 +1,5 @@
 #include "SkipStages.h"
+#include "Bounds.h"
 #include "CSE.h"
 #include "Debug.h"
 #include "ExprUsesVar.h"
@@ -8,7 +9,9 @@
 #include "IRPrinter.h"
 #include "Scope.h"
 #include "Simplify.h"
+#include "Solve.h"
 #include "Substitute.h"
+#include "Util.h"
 
 #include <iterator>
 #include <utility>
@@ -16,6 +19,7 @@
 namespace Halide {
 namespace Internal {
 
+using std::map;
 using std::set;
 using std::string;
 using std::vector;
@@ -39,6 +43,47 @@ bool extern_call_uses_buffer(const Call *op, const std::string &func) {
     return false;
 }
 
+// Replace calls to Funcs computed outside of the realization being
+// analyzed, whose arguments are the same everywhere in the given
+// bounds, with variables standing in for the call at that point. A
+// coarse mask Func indexed by tile is then a single value over each
+// tile, to bounds inference.
+class ReplaceInvariantCalls : public IRMutator {
+    using IRMutator::visit;
+
+    const Scope<Interval> &bounds;
+    const Scope<> &in_pipeline;
+
+    Expr visit(const Call *op) override {
+        if (op->call_type != Call::Halide || in_pipeline.contains(op->name)) {
+            return IRMutator::visit(op);
+        }
+        vector<Expr> args;
+        for (const Expr &arg : op->args) {
+            Interval i = bounds_of_expr_in_scope(arg, bounds);
+            if (!i.is_bounded()) {
+                return IRMutator::visit(op);
+            }
+            Expr min = simplify(i.min);
+            if (!equal(min, simplify(i.max))) {
+                return IRMutator::visit(op);
+            }
+            args.push_back(min);
+        }
+        string name = unique_name('t');
+        replacements[name] = Call::make(op->type, op->name, args, op->call_type,
+                                        op->func, op->value_index, op->image, op->param);
+        return Variable::make(op->type, name);
+    }
+
+public:
+    map<string, Expr> replacements;
+
+    ReplaceInvariantCalls(const Scope<Interval> &b, const Scope<> &p)
+        : bounds(b), in_pipeline(p) {
+    }
+};
+
 class PredicateFinder : public IRVisitor {
 public:
     Expr predicate;
@@ -57,6 +102,8 @@ private:
     bool treat_selects_as_guards;
     bool in_produce;
     Scope<> varying;
+    // The bounds of the varying loop variables and lets, where known.
+    Scope<Interval> bounds;
     Scope<> in_pipeline;
     Scope<> local_buffers;
 
@@ -74,10 +121,14 @@ private:
         if (!is_const_one(op->extent) || min_varies) {
             should_pop = true;
             varying.push(op->name);
+            Interval min = bounds_of_expr_in_scope(op->min, bounds);
+            Interval max = bounds_of_expr_in_scope(op->min + op->extent - 1, bounds);
+            bounds.push(op->name, Interval(min.min, max.max));
         }
         op->body.accept(this);
         if (should_pop) {
             varying.pop(op->name);
+            bounds.pop(op->name);
         } else if (expr_uses_var(predicate, op->name)) {
             predicate = Let::make(op->name, op->min, predicate);
         }
@@ -88,6 +139,7 @@ private:
         struct Frame {
             const T *op;
             ScopedBinding<> binding;
+            ScopedBinding<Interval> bounds_binding;
         };
         vector<Frame> frames;
 
@@ -97,7 +149,9 @@ private:
             varies = false;
             op->value.accept(this);
 
-            frames.push_back(Frame{op, ScopedBinding<>(varies, varying, op->name)});
+            Interval value_bounds = varies ? bounds_of_expr_in_scope(op->value, bounds) : Interval();
+            frames.push_back(Frame{op, ScopedBinding<>(varies, varying, op->name),
+                                   ScopedBinding<Interval>(varies, bounds, op->name, value_bounds)});
 
             varies |= old_varies;
             body = op->body;
@@ -184,6 +238,21 @@ private:
         }
     }
 
+    // A condition that doesn't depend on anything varying, and is true
+    // whenever c might be true somewhere in the bounds of the varying
+    // loops and lets. For a Func computed at a tile of its consumer,
+    // this is whether any of the tile might take the branch.
+    Expr might_be_true(const Expr &c) {
+        ReplaceInvariantCalls replacer(bounds, in_pipeline);
+        Expr never = replacer.mutate(simplify(make_not(c)));
+        never = and_condition_over_domain(never, bounds);
+        Expr result = substitute(replacer.replacements, make_not(never));
+        if (expr_uses_vars(result, varying)) {
+            return const_true();
+        }
+        return result;
+    }
+
     template<typename T>
     void visit_conditional(const Expr &condition, T true_case, T false_case) {
         Expr old_predicate = predicate;
@@ -205,6 +274,15 @@ private:
 
         predicate = make_or(predicate, old_predicate);
         if (varies) {
+            // The condition can't be evaluated where the Func is
+            // realized, but it may still rule out the branches over
+            // the whole of the loops it varies over.
+            if (!is_const_zero(true_predicate)) {
+                true_predicate = make_and(might_be_true(condition), true_predicate);
+            }
+            if (!is_const_zero(false_predicate)) {
+                false_predicate = make_and(might_be_true(make_not(condition)), false_predicate);
+            }
             predicate = make_or(predicate, make_or(true_predicate, false_predicate));
         } else {
             predicate = make_or(predicate, make_select(condition, true_predicate, false_predicate));
@@ -17,7 +17,12 @@ namespace Internal {
  * to check that tells us they won't be used. Does this by analyzing
  * all reads of each buffer allocated, and inferring some condition
  * that tells us if the reads occur. If the condition is non-trivial,
- * inject ifs that guard the production. */
+ * inject ifs that guard the production. Conditions that vary within the
+ * realization are relaxed over the loops they vary in, so a Func
+ * computed at a tile of a consumer that only uses it under a select is
+ * skipped for the tiles where the select condition is false
+ * throughout, e.g. because a coarse mask Func indexed by tile says
+ * so. */
 Stmt skip_stages(Stmt s, const std::vector<std::string> &order);
 
 }  // namespace Internal
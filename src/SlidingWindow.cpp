@@ -4,6 +4,7 @@
 #include "CompilerLogger.h"
 #include "Debug.h"
 #include "ExprUsesVar.h"
+#include "Func.h"
 #include "IREquality.h"
 #include "IRMatch.h"
 #include "IRMutator.h"
@@ -14,6 +15,8 @@
 #include "Simplify.h"
 #include "Solve.h"
 #include "Substitute.h"
+#include <algorithm>
+#include <climits>
 #include <list>
 #include <set>
 #include <utility>
@@ -30,6 +33,10 @@ using std::vector;
 
 namespace {
 
+bool var_name_match(const string &candidate, const string &var) {
+    return (candidate == var) || ends_with(candidate, "." + var);
+}
+
 // Does an expression depend on a particular variable?
 class ExprDependsOnVar : public IRVisitor {
     using IRVisitor::visit;
@@ -910,8 +917,144 @@ class AddLoopMinOrig : public IRMutator {
 }  // namespace
 
 Stmt sliding_window(const Stmt &s, const map<string, Function> &env) {
+    BoundsQueryCache bounds_cache;
     return SlidingWindow(env).mutate(AddLoopMinOrig().mutate(s));
 }
 
+namespace {
+
+// The extent of a loop of a Func, if it has been bounded (or estimated)
+// to a constant, or -1.
+int known_loop_extent(const Function &f, const string &var) {
+    for (const auto *bounds : {&f.schedule().bounds(), &f.schedule().estimates()}) {
+        for (const Bound &b : *bounds) {
+            const int64_t *extent = as_const_int(b.extent);
+            if (b.var == var && extent && *extent > 0 && *extent <= INT_MAX) {
+                return (int)*extent;
+            }
+        }
+    }
+    return -1;
+}
+
+}  // namespace
+
+void split_parallel_sliding_loops(const map<string, Function> &env) {
+    // The number of iterations of the original loop in each strip. The
+    // warm up at the start of each strip is redundant work, so strips
+    // should be long compared to the footprint of the stencils, but
+    // there should also be enough of them to keep all the threads busy.
+    // The number of threads isn't known until the pipeline runs, so when
+    // the extent of the loop is known, aim for a fixed number of strips,
+    // within limits on their length.
+    const int max_strip_size = 32, min_strip_size = 4;
+    const int target_strips = 16, min_strips = 4;
+
+    // The strip loop made for each consumer stage and dimension, so that
+    // all the Funcs that slide over the same loop share one.
+    map<string, string> strips;
+
+    for (const auto &it : env) {
+        Function producer = it.second;
+        FuncSchedule &sched = producer.schedule();
+        const LoopLevel &compute_at = sched.compute_level();
+        const LoopLevel &store_at = sched.store_level();
+        if (compute_at.is_inlined() || compute_at.is_root() ||
+            store_at == compute_at ||
+            !sched.hoist_storage_level().is_inlined()) {
+            continue;
+        }
+
+        string func_name, var_name;
+        bool is_rvar;
+        int stage_index;
+        compute_at.get_parts(func_name, var_name, is_rvar, stage_index);
+        auto consumer_it = env.find(func_name);
+        if (consumer_it == env.end()) {
+            continue;
+        }
+        Function consumer = consumer_it->second;
+        int stage = stage_index;
+        if (stage < 0) {
+            if (consumer.has_update_definition()) {
+                continue;
+            }
+            stage = 0;
+        }
+        if (stage > (int)consumer.updates().size()) {
+            continue;
+        }
+        Definition def = stage == 0 ? consumer.definition() : consumer.update(stage - 1);
+
+        // Only handle Funcs stored at the root or further out in the
+        // same stage, so that all the loops in between are in this stage.
+        string store_func, store_var;
+        int store_stage = -1;
+        if (!store_at.is_root()) {
+            bool store_is_rvar;
+            store_at.get_parts(store_func, store_var, store_is_rvar, store_stage);
+            if (store_func != func_name || store_stage != stage_index) {
+                continue;
+            }
+        }
+
+        vector<Dim> &dims = def.schedule().dims();
+        int compute_idx = -1;
+        for (int i = 0; i < (int)dims.size(); i++) {
+            if (var_name_match(dims[i].var, var_name)) {
+                compute_idx = i;
+                break;
+            }
+        }
+        if (compute_idx < 0) {
+            continue;
+        }
+        int parallel_idx = -1;
+        for (int i = compute_idx; i < (int)dims.size(); i++) {
+            if (!store_at.is_root() && var_name_match(dims[i].var, store_var)) {
+                break;
+            }
+            if (dims[i].for_type == ForType::Parallel) {
+                parallel_idx = i;
+                break;
+            }
+        }
+        if (parallel_idx < 0 || dims[parallel_idx].is_rvar()) {
+            continue;
+        }
+
+        const string old = dims[parallel_idx].var;
+        const string key = func_name + ".s" + std::to_string(stage) + "." + old;
+        string &strip = strips[key];
+        if (strip.empty()) {
+            string inner = old.substr(old.rfind('.') + 1);
+            strip = unique_name("strip");
+            int extent = known_loop_extent(consumer, old);
+            int strip_size = max_strip_size;
+            if (extent > 0) {
+                strip_size = std::max(min_strip_size, std::min(max_strip_size, extent / target_strips));
+                int num_strips = (extent + strip_size - 1) / strip_size;
+                if (num_strips < min_strips) {
+                    user_warning << "The parallel loop " << key << " of extent " << extent
+                                 << " is split into only " << num_strips << " strip(s), so that "
+                                 << producer.name() << ", which is stored outside it, can slide. "
+                                 << "Consider storing " << producer.name() << " inside the parallel loop.\n";
+                }
+            }
+            debug(2) << "Splitting parallel loop " << key << " into strips of "
+                     << strip_size << " so that " << producer.name() << " can slide\n";
+            // Guard the last strip rather than shifting it inwards, which
+            // would fail for loops shorter than one strip.
+            Stage(consumer, def, stage).split(Var(inner), Var(strip), Var(inner), strip_size, TailStrategy::GuardWithIf);
+            for (Dim &d : dims) {
+                if (d.var == old + "." + inner) {
+                    d.for_type = ForType::Serial;
+                }
+            }
+        }
+        sched.store_level() = LoopLevel(consumer, Var(strip), stage_index).lock();
+    }
+}
+
 }  // namespace Internal
 }  // namespace Halide
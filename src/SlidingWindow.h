@@ -23,6 +23,15 @@ class Function;
  */
 Stmt sliding_window(const Stmt &s, const std::map<std::string, Function> &env);
 
+/** A Func stored outside a parallel loop but computed within it would
+ * race, so that schedule is normally an error. Instead, split each such
+ * parallel loop into parallel strips, and make the Func stored at the
+ * strip loop. Each strip loops serially within it, so the Func can
+ * still slide, at the cost of warming up the sliding window again at
+ * the start of each strip. Must be called after the loop levels are
+ * locked and before the loop nests are created. */
+void split_parallel_sliding_loops(const std::map<std::string, Function> &env);
+
 }  // namespace Internal
 }  // namespace Halide
 
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <set>
+
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Scope.h"
+#include "SpecializeDenseStrides.h"
+#include "Substitute.h"
+#include "UniquifyVariableNames.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Each versioned nest checks the strides of at most this many
+// inputs, and at most this many nests are versioned, to bound the
+// growth in code size.
+const int max_inputs_per_nest = 4;
+const int max_versioned_nests = 8;
+
+bool is_innermost_stride(const string &name) {
+    return ends_with(name, ".stride.0");
+}
+
+// Count the loads in vectorized loops from each input buffer with an
+// index that depends on its innermost stride.
+class FindStridedLoads : public IRVisitor {
+    using IRVisitor::visit;
+
+    bool in_vector_loop = false;
+
+    // The innermost strides that the value of each enclosing let
+    // depends on.
+    Scope<set<string>> let_strides;
+
+    set<string> strides_in(const Expr &e) {
+        class Vars : public IRGraphVisitor {
+            using IRGraphVisitor::visit;
+
+            void visit(const Variable *op) override {
+                if (is_innermost_stride(op->name)) {
+                    result.insert(op->name);
+                } else if (let_strides.contains(op->name)) {
+                    const set<string> &s = let_strides.get(op->name);
+                    result.insert(s.begin(), s.end());
+                }
+            }
+
+            const Scope<set<string>> &let_strides;
+
+        public:
+            set<string> result;
+
+            Vars(const Scope<set<string>> &let_strides)
+                : let_strides(let_strides) {
+            }
+        } vars(let_strides);
+        e.accept(&vars);
+        return vars.result;
+    }
+
+    template<typename LetOrLetStmt>
+    void visit_let(const LetOrLetStmt *op) {
+        op->value.accept(this);
+        ScopedBinding<set<string>> bind(let_strides, op->name, strides_in(op->value));
+        op->body.accept(this);
+    }
+
+    void visit(const Let *op) override {
+        visit_let(op);
+    }
+
+    void visit(const LetStmt *op) override {
+        visit_let(op);
+    }
+
+    void visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            on_device = true;
+            return;
+        }
+        if (op->for_type == ForType::Vectorized) {
+            // Code outside the loop doesn't benefit.
+            op->min.accept(this);
+            op->extent.accept(this);
+            ScopedValue<bool> old_in_vector_loop(in_vector_loop, true);
+            op->body.accept(this);
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Load *op) override {
+        IRVisitor::visit(op);
+        if (in_vector_loop && (op->param.defined() || op->image.defined())) {
+            const string stride = op->name + ".stride.0";
+            if (strides_in(op->index).count(stride)) {
+                loads[stride]++;
+            }
+        }
+    }
+
+public:
+    // The number of loads that depend on each stride.
+    map<string, int> loads;
+
+    // Whether the nest has loops that run on a device.
+    bool on_device = false;
+};
+
+class SpecializeDenseStrides : public IRMutator {
+    using IRMutator::visit;
+
+    int versioned = 0;
+
+    // Only whole loop nests are versioned, so this doesn't recurse.
+    Stmt visit(const For *op) override {
+        if (versioned >= max_versioned_nests) {
+            return op;
+        }
+        FindStridedLoads finder;
+        op->accept(&finder);
+        if (finder.on_device || finder.loads.empty()) {
+            return op;
+        }
+
+        // Check the strides of the most used inputs.
+        vector<pair<int, string>> strides;
+        for (const auto &it : finder.loads) {
+            strides.emplace_back(it.second, it.first);
+        }
+        std::sort(strides.begin(), strides.end(),
+                  [](const pair<int, string> &a, const pair<int, string> &b) {
+                      return a.first > b.first;
+                  });
+        if ((int)strides.size() > max_inputs_per_nest) {
+            strides.resize(max_inputs_per_nest);
+        }
+
+        Expr condition;
+        map<string, Expr> dense;
+        for (const auto &it : strides) {
+            Expr check = Variable::make(Int(32), it.second) == 1;
+            condition = condition.defined() ? condition && check : check;
+            dense[it.second] = 1;
+            debug(3) << "Specializing the loop nest over " << op->name
+                     << " on " << it.second << " == 1\n";
+        }
+        versioned++;
+        return IfThenElse::make(condition, substitute(dense, Stmt(op)), op);
+    }
+};
+
+}  // namespace
+
+Stmt specialize_dense_strides(const Stmt &s) {
+    Stmt stmt = SpecializeDenseStrides().mutate(s);
+    if (stmt.same_as(s)) {
+        return s;
+    }
+    // The two versions of each nest use the same names.
+    return uniquify_variable_names(stmt);
+}
+
+}  // namespace Internal
+}  // namespace Halide
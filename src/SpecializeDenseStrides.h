@@ -0,0 +1,27 @@
+#ifndef HALIDE_SPECIALIZE_DENSE_STRIDES_H
+#define HALIDE_SPECIALIZE_DENSE_STRIDES_H
+
+/** \file
+ * Defines the lowering pass that multiversions loop nests on the
+ * innermost strides of input buffers being one.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** For each top-level loop nest with vectorized loops that load from
+ * input buffers whose innermost stride is unknown, add a second copy
+ * of the nest that assumes the strides are one, selected at runtime
+ * by checking them. The vectorized loads in that copy become dense.
+ * At most a few inputs (those loaded from most often) are checked
+ * per nest, and at most a few nests are versioned. Enabled by
+ * Target::SpecializeDenseStrides. Run this after unrolling, and
+ * before vectorization. */
+Stmt specialize_dense_strides(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -5,12 +5,14 @@
 #include "IRPrinter.h"
 #include "IRVisitor.h"
 #include "Module.h"
+#include "ProfileGuided.h"
 #include "Scope.h"
 #include "Substitute.h"
 #include "Util.h"
 
 #include <cstdio>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <regex>
@@ -634,6 +636,10 @@ public:
         cost_model = std::move(cm);
     }
 
+    void init_profile(PipelineProfile p) {
+        profile = std::move(p);
+    }
+
     void print(const Module &m) {
         // Generate a unique ID for this module
         int id = gen_unique_id();
@@ -712,6 +718,9 @@ private:
     // Holds cost information for visualized program
     IRCostModel cost_model;
 
+    // Holds the measured costs of the Funcs, if a profile was given
+    PipelineProfile profile;
+
     /* Private print functions to handle various IR types */
     void print(const Buffer<> &buf) {
         // Generate a unique ID for this module
@@ -1268,6 +1277,41 @@ private:
                << "</span>";
     }
 
+    // Prints what the profile measured for a Func: its share of the time
+    // of the pipeline, and optionally the time per run, the thread
+    // utilization and the memory allocated.
+    void print_profile_info(const FuncProfile *f, bool details) {
+        if (!f) {
+            return;
+        }
+        const char *heat = "ProfileHot";
+        if (f->fraction < 0.01) {
+            heat = "ProfileCold";
+        } else if (f->fraction < 0.1) {
+            heat = "ProfileWarm";
+        }
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(1) << " " << 100 * f->fraction << "%";
+        if (details) {
+            text << std::setprecision(3) << " " << f->time / 1e6 << "ms"
+                 << std::setprecision(1) << " threads: " << f->threads;
+            if (f->memory_peak) {
+                text << " peak: " << f->memory_peak << " bytes"
+                     << " allocated/run: " << f->memory_per_run << " bytes";
+            }
+        }
+        print_html_element("span", std::string("profile-info ") + heat, text.str());
+    }
+
+    // Prints the memory that the profile measured a Func allocating.
+    void print_profile_memory(const FuncProfile *f) {
+        if (!f || !f->memory_peak) {
+            return;
+        }
+        print_html_element("span", "profile-info",
+                           " peak: " + std::to_string(f->memory_peak) + " bytes");
+    }
+
     /* Misc utility methods */
     int gen_unique_id() {
         return id++;
@@ -1512,6 +1556,11 @@ private:
 
         print_toggle_anchor_closing_tag();
 
+        // Annotate producers with what the profile measured
+        if (op->is_producer) {
+            print_profile_info(profile.func(op->name), true);
+        }
+
         // Add a button to jump to this producer/consumer in the viz
         print_visualization_button("prodcons-viz-" + std::to_string(id));
 
@@ -1572,6 +1621,9 @@ private:
 
         print_toggle_anchor_closing_tag();
 
+        // Color the loop by the share of the time its Func took
+        print_profile_info(profile.loop_func(op->name), false);
+
         // Add a button to jump to this loop in the viz
         print_visualization_button("loop-viz-" + std::to_string(id));
 
@@ -1751,6 +1803,9 @@ private:
             print_html_element("span", "matched", "}");
         }
 
+        // Annotate the allocation with the measured peak of its Func
+        print_profile_memory(profile.func(op->name));
+
         // Add a button to jump to this allocation in the viz
         print_visualization_button("allocate-viz-" + std::to_string(id));
 
@@ -2783,6 +2838,13 @@ public:
         html_code_printer.init_cost_info(cost_model);
         html_viz_printer.init_cost_info(cost_model);
 
+        // If a saved profile was given, annotate the code with what
+        // it measured.
+        const std::string profile_file = get_env_variable("HL_STMT_HTML_PROFILE");
+        if (!profile_file.empty()) {
+            html_code_printer.init_profile(PipelineProfile(profile_file, m.name()));
+        }
+
         // Generate html page
         stream << "<html>\n";
         generate_head(m);
@@ -127,7 +127,7 @@ private:
         realizations.pop(op->name);
 
         // The allocation extents of the function taken into account of
-        // the align_storage directives. It is only used to determine the
+        // the align_storage and pad_storage directives. It is only used to determine the
         // host allocation size and the strides in halide_buffer_t objects (which
         // also affects the device allocation in some backends).
         vector<Expr> allocation_extents(extents.size());
@@ -139,6 +139,8 @@ private:
             Function f = iter->second.first;
             const vector<StorageDim> &storage_dims = f.schedule().storage_dims();
             const vector<string> &args = f.args();
+            // The stride of the current storage dimension, in elements.
+            Expr stride = 1;
             for (size_t i = 0; i < storage_dims.size(); i++) {
                 for (size_t j = 0; j < args.size(); j++) {
                     if (args[j] == storage_dims[i].var) {
@@ -163,6 +165,24 @@ private:
                         } else {
                             allocation_extents[j] = extents[j];
                         }
+                        Expr padding = storage_dims[i].padding;
+                        if (padding.defined()) {
+                            allocation_extents[j] += padding;
+                        }
+                        Expr critical_stride = storage_dims[i].critical_stride;
+                        if (critical_stride.defined()) {
+                            // Pad by a cache line, keeping the extent a
+                            // multiple of the alignment.
+                            const int bytes = op->types[0].bytes();
+                            Expr line = (64 + bytes - 1) / bytes;
+                            if (alignment.defined()) {
+                                line = ((line + alignment - 1) / alignment) * alignment;
+                            }
+                            Expr next_stride_bytes = cast<int64_t>(stride) * allocation_extents[j] * bytes;
+                            Expr aliased = (next_stride_bytes % critical_stride) == 0;
+                            allocation_extents[j] += select(aliased, line, 0);
+                        }
+                        stride *= allocation_extents[j];
                     }
                 }
                 internal_assert(storage_permutation.size() == i + 1);
@@ -453,6 +473,158 @@ class PromoteToMemoryType : public IRMutator {
     }
 };
 
+// Move the allocations of Funcs scheduled with hoist_storage out to the
+// loop they name. The hoisted allocation is as large as the largest one
+// made by any iteration of the loops in between, all of which reuse it.
+class HoistStorage : public IRMutator {
+public:
+    HoistStorage(const map<string, pair<Function, int>> &env) {
+        for (const auto &p : env) {
+            // Ring buffers have already been hoisted by fork_async_producers.
+            const FuncSchedule &schedule = p.second.first.schedule();
+            const LoopLevel &level = schedule.hoist_storage_level();
+            if (!level.is_inlined() && !schedule.ring_buffer().defined()) {
+                levels.emplace(p.first, level);
+            }
+        }
+    }
+
+    bool any_hoisted() const {
+        return !levels.empty();
+    }
+
+    Stmt hoist(const Stmt &s) {
+        sites.push_back({"", ForType::Serial, 0, {}});
+        Stmt result = wrap(mutate(s), sites.back());
+        sites.pop_back();
+        return result;
+    }
+
+private:
+    using IRMutator::visit;
+
+    // The hoist_storage level of each allocation to be hoisted.
+    map<string, LoopLevel> levels;
+
+    // A variable defined inside a potential hoisting site, by a loop or
+    // a let.
+    struct Definition {
+        string name;
+        Expr min, extent;  // For a loop
+        Expr value;        // For a let
+    };
+    vector<Definition> defs;
+
+    struct HoistedAllocation {
+        Type type;
+        MemoryType memory_type;
+        vector<Expr> extents;
+    };
+
+    // The enclosing loops, outermost first, with the allocations hoisted
+    // to each. The first site is outside all loops.
+    struct Site {
+        string loop_name;
+        ForType for_type;
+        size_t first_def;
+        map<string, HoistedAllocation> allocations;
+    };
+    vector<Site> sites;
+
+    Stmt wrap(Stmt body, const Site &site) {
+        for (const auto &it : site.allocations) {
+            body = Allocate::make(it.first, it.second.type, it.second.memory_type,
+                                  it.second.extents, const_true(), body);
+        }
+        return body;
+    }
+
+    Stmt visit(const For *op) override {
+        Expr min = mutate(op->min);
+        Expr extent = mutate(op->extent);
+        defs.push_back({op->name, min, extent, Expr()});
+        sites.push_back({op->name, op->for_type, defs.size(), {}});
+        Stmt body = mutate(op->body);
+        body = wrap(body, sites.back());
+        sites.pop_back();
+        defs.pop_back();
+        return For::make(op->name, min, extent, op->for_type, op->device_api, body);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        Expr value = mutate(op->value);
+        defs.push_back({op->name, Expr(), Expr(), value});
+        Stmt body = mutate(op->body);
+        defs.pop_back();
+        return LetStmt::make(op->name, value, body);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        auto level = levels.find(op->name);
+        if (level == levels.end()) {
+            return IRMutator::visit(op);
+        }
+        internal_assert(!op->new_expr.defined() && op->free_function.empty());
+
+        // Find the innermost enclosing loop that matches the level.
+        int site = -1;
+        if (level->second.is_root()) {
+            site = 0;
+        } else {
+            for (int i = (int)sites.size() - 1; i > 0 && site < 0; i--) {
+                if (level->second.match(sites[i].loop_name)) {
+                    site = i;
+                }
+            }
+        }
+        internal_assert(site >= 0)
+            << "Could not find the hoist_storage level " << level->second.to_string()
+            << " of " << op->name << "\n";
+        for (size_t i = site + 1; i < sites.size(); i++) {
+            user_assert(!is_parallel(sites[i].for_type))
+                << "Can't hoist the storage of " << op->name
+                << " out of the parallel loop " << sites[i].loop_name << "\n";
+        }
+
+        // Bound every variable defined between the site and here.
+        Scope<Interval> scope;
+        for (size_t i = sites[site].first_def; i < defs.size(); i++) {
+            const Definition &d = defs[i];
+            Interval interval;
+            if (d.value.defined()) {
+                interval = bounds_of_expr_in_scope(d.value, scope);
+            } else {
+                Interval min = bounds_of_expr_in_scope(d.min, scope);
+                Interval max = bounds_of_expr_in_scope(d.min + d.extent - 1, scope);
+                interval = Interval(min.min, max.max);
+            }
+            scope.push(d.name, interval);
+        }
+
+        vector<Expr> extents;
+        for (const Expr &e : op->extents) {
+            Interval interval = bounds_of_expr_in_scope(e, scope);
+            user_assert(interval.has_upper_bound())
+                << "Can't hoist the storage of " << op->name << " to "
+                << level->second.to_string() << ", as its size " << e
+                << " has no upper bound there\n";
+            extents.push_back(simplify(interval.max));
+        }
+
+        auto it = sites[site].allocations.find(op->name);
+        if (it == sites[site].allocations.end()) {
+            sites[site].allocations[op->name] = {op->type, op->memory_type, extents};
+        } else {
+            internal_assert(it->second.extents.size() == extents.size());
+            for (size_t i = 0; i < extents.size(); i++) {
+                it->second.extents[i] = simplify(max(it->second.extents[i], extents[i]));
+            }
+        }
+
+        return mutate(op->body);
+    }
+};
+
 }  // namespace
 
 Stmt storage_flattening(Stmt s,
@@ -477,6 +649,10 @@ Stmt storage_flattening(Stmt s,
     }
 
     s = FlattenDimensions(tuple_env, outputs, target).mutate(s);
+    HoistStorage hoister(tuple_env);
+    if (hoister.any_hoisted()) {
+        s = hoister.hoist(s);
+    }
     s = PromoteToMemoryType().mutate(s);
     return s;
 }
@@ -21,6 +21,25 @@ int64_t next_power_of_two(int64_t x) {
     return static_cast<int64_t>(1) << static_cast<int64_t>(std::ceil(std::log2(x)));
 }
 
+// Pick an automatic fold factor for a dimension with the given
+// maximum extent. slice_bytes is the size of one coordinate of that
+// dimension in the allocation, or negative if it isn't known at
+// compile time (e.g. an image scanline). Rounding up to a power of
+// two turns the modulus into a mask, but when that would waste more
+// than a quarter of a large allocation (e.g. 8 scanlines for a 5-row
+// stencil) we fold by the exact extent instead. The modulus by a
+// constant is then a multiply and a shift rather than a division.
+int64_t choose_fold_factor(int64_t max_extent, int64_t slice_bytes) {
+    int64_t p = next_power_of_two(max_extent);
+    int64_t wasted = p - max_extent;
+    const int64_t min_bytes_saved = 4096;
+    bool large = slice_bytes < 0 || wasted * slice_bytes >= min_bytes_saved;
+    if (large && wasted * 4 > p) {
+        return max_extent;
+    }
+    return p;
+}
+
 using std::map;
 using std::string;
 using std::vector;
@@ -484,6 +503,7 @@ public:
 class AttemptStorageFoldingOfFunction : public IRMutator {
     Function func;
     bool explicit_only;
+    const vector<int64_t> &slice_bytes;
 
     using IRMutator::visit;
 
@@ -723,7 +743,7 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                 const int max_fold = 1024;
                 const int64_t *const_max_extent = as_const_int(max_extent);
                 if (const_max_extent && *const_max_extent <= max_fold) {
-                    factor = static_cast<int>(next_power_of_two(*const_max_extent));
+                    factor = static_cast<int>(choose_fold_factor(*const_max_extent, slice_bytes[dim]));
                 } else {
                     // Try a little harder to find a bounding power of two
                     int e = max_fold * 2;
@@ -923,8 +943,8 @@ public:
     };
     vector<Fold> dims_folded;
 
-    AttemptStorageFoldingOfFunction(Function f, bool explicit_only)
-        : func(std::move(f)), explicit_only(explicit_only) {
+    AttemptStorageFoldingOfFunction(Function f, bool explicit_only, const vector<int64_t> &slice_bytes)
+        : func(std::move(f)), explicit_only(explicit_only), slice_bytes(slice_bytes) {
     }
 };
 
@@ -945,7 +965,31 @@ class StorageFolding : public IRMutator {
         // Don't attempt automatic storage folding if there is
         // more than one produce node for this func.
         bool explicit_only = count_producers(body, op->name) != 1;
-        AttemptStorageFoldingOfFunction folder(func, explicit_only);
+
+        // The size of one coordinate of each dimension of the
+        // allocation, or -1 where that depends on runtime
+        // extents. Used to weigh memory saved against index cost
+        // when picking fold factors.
+        int64_t elem_bytes = 0;
+        for (const Type &t : op->types) {
+            elem_bytes += t.bytes();
+        }
+        vector<int64_t> slice_bytes(op->bounds.size(), elem_bytes);
+        for (size_t d = 0; d < op->bounds.size(); d++) {
+            for (size_t j = 0; j < op->bounds.size(); j++) {
+                if (j == d || slice_bytes[d] < 0) {
+                    continue;
+                }
+                const int64_t *extent = as_const_int(simplify(op->bounds[j].extent));
+                if (extent && *extent >= 0) {
+                    slice_bytes[d] *= *extent;
+                } else {
+                    slice_bytes[d] = -1;
+                }
+            }
+        }
+
+        AttemptStorageFoldingOfFunction folder(func, explicit_only, slice_bytes);
         if (explicit_only) {
             debug(3) << "Attempting to fold " << op->name << " explicitly\n";
         } else {
@@ -1013,6 +1057,7 @@ public:
 }  // namespace
 
 Stmt storage_folding(const Stmt &s, const std::map<std::string, Function> &env) {
+    BoundsQueryCache bounds_cache;
     return StorageFolding(env).mutate(s);
 }
 
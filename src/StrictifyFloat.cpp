@@ -74,6 +74,29 @@ bool strictify_float(std::map<std::string, Function> &env, const Target &t) {
         }
         // TODO(zalman): Some targets don't allow strict float and we can provide errors for these.
 
+        bool any_reassociable = false;
+        if (func.has_pure_definition()) {
+            any_reassociable = func.definition().schedule().allow_reassociation();
+            for (const Definition &def : func.updates()) {
+                any_reassociable |= def.schedule().allow_reassociation();
+            }
+        }
+
+        if (mode == StrictifyFloat::Forced && any_reassociable) {
+            // Stages that allow reassociation keep fast math, even
+            // when strict float is otherwise forced.
+            auto strictify_definition = [&](Definition &def) {
+                StrictifyFloat strictify(def.schedule().allow_reassociation() ? StrictifyFloat::Allowed : mode);
+                def.mutate(&strictify);
+                any_strict_float |= strictify.any_strict_float;
+            };
+            strictify_definition(func.definition());
+            for (size_t i = 0; i < func.updates().size(); i++) {
+                strictify_definition(func.update(i));
+            }
+            continue;
+        }
+
         StrictifyFloat strictify(mode);
         func.mutate(&strictify);
         any_strict_float |= strictify.any_strict_float;
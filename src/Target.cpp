@@ -285,6 +285,11 @@ Target calculate_host_target() {
                 if ((info2[2] & avx512vnni) == avx512vnni &&
                     (info3[0] & avx512bf16) == avx512bf16) {
                     initial_features.push_back(Target::AVX512_SapphireRapids);
+
+                    const uint32_t avx512fp16 = 1U << 23;  // fp16 result in edx
+                    if ((info2[3] & avx512fp16) == avx512fp16) {
+                        initial_features.push_back(Target::AVX512_FP16);
+                    }
                 }
             }
         }
@@ -552,6 +557,20 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"vk_v12", Target::VulkanV12},
     {"vk_v13", Target::VulkanV13},
     {"semihosting", Target::Semihosting},
+    {"auto_prefetch", Target::AutoPrefetch},
+    {"workspace", Target::Workspace},
+    {"plan_memory", Target::PlanMemory},
+    {"vector_math", Target::VectorMath},
+    {"avx512_fp16", Target::AVX512_FP16},
+    {"profile_guided", Target::ProfileGuided},
+    {"specialize_dense_strides", Target::SpecializeDenseStrides},
+    {"arm_i8mm", Target::ARMI8mm},
+    {"arm_bf16", Target::ARMBf16},
+    {"profile_stages", Target::ProfileStages},
+    {"profile_memory_traffic", Target::ProfileMemoryTraffic},
+    {"wasm_relaxed_simd", Target::WasmRelaxedSimd},
+    {"static_workspace", Target::StaticWorkspace},
+    {"c_plus_plus_parallel_for", Target::CPlusPlusParallelFor},
     // NOTE: When adding features to this map, be sure to update PyEnums.cpp as well.
 };
 
@@ -1270,13 +1289,14 @@ bool Target::get_runtime_compatible_target(const Target &other, Target &result)
     // clang-format on
 
     // clang-format off
-    const std::array<Feature, 14> intersection_features = {{
+    const std::array<Feature, 15> intersection_features = {{
         ARMv7s,
         ARMv81a,
         AVX,
         AVX2,
         AVX512,
         AVX512_Cannonlake,
+        AVX512_FP16,
         AVX512_KNL,
         AVX512_SapphireRapids,
         AVX512_Skylake,
@@ -167,6 +167,20 @@ struct Target {
         VulkanV12 = halide_target_feature_vulkan_version12,
         VulkanV13 = halide_target_feature_vulkan_version13,
         Semihosting = halide_target_feature_semihosting,
+        AutoPrefetch = halide_target_feature_auto_prefetch,
+        Workspace = halide_target_feature_workspace,
+        PlanMemory = halide_target_feature_plan_memory,
+        VectorMath = halide_target_feature_vector_math,
+        AVX512_FP16 = halide_target_feature_avx512_fp16,
+        ProfileGuided = halide_target_feature_profile_guided,
+        SpecializeDenseStrides = halide_target_feature_specialize_dense_strides,
+        ARMI8mm = halide_target_feature_arm_i8mm,
+        ARMBf16 = halide_target_feature_arm_bf16,
+        ProfileStages = halide_target_feature_profile_stages,
+        ProfileMemoryTraffic = halide_target_feature_profile_memory_traffic,
+        WasmRelaxedSimd = halide_target_feature_wasm_relaxed_simd,
+        StaticWorkspace = halide_target_feature_static_workspace,
+        CPlusPlusParallelFor = halide_target_feature_c_plus_plus_parallel_for,
         FeatureEnd = halide_target_feature_end
     };
     Target() = default;
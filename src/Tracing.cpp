@@ -6,6 +6,7 @@
 #include "RealizationOrder.h"
 #include "runtime/HalideRuntime.h"
 
+#include <algorithm>
 #include <set>
 
 namespace Halide {
@@ -51,6 +52,43 @@ struct TraceEventBuilder {
     }
 };
 
+// The condition under which an access at the given coordinates is
+// traced, or an undefined Expr if all of them are.
+Expr sampling_condition(const TraceSampling &sampling, const vector<Expr> &coordinates) {
+    Expr cond;
+    auto add = [&](const Expr &e) {
+        cond = cond.defined() ? (cond && e) : e;
+    };
+
+    if (sampling.every > 1 && !coordinates.empty()) {
+        add(coordinates[0] % sampling.every == 0);
+    }
+
+    if (sampling.fraction < 1.0f) {
+        // Mix the coordinates into a hash, and take the accesses whose
+        // low 24 bits fall below the threshold.
+        Expr h = make_const(UInt(32), sampling.seed * 2654435761u + 0x9e3779b9u);
+        for (const Expr &c : coordinates) {
+            h = (h ^ cast(UInt(32), c)) * make_const(UInt(32), 0x85ebca6bu);
+            h = h ^ (h >> 13);
+        }
+        uint32_t threshold = (uint32_t)(std::max(sampling.fraction, 0.0f) * (1 << 24));
+        add((h & make_const(UInt(32), 0xffffff)) < make_const(UInt(32), threshold));
+    }
+
+    for (size_t i = 0; i < sampling.region.size() && i < coordinates.size(); i++) {
+        const Range &r = sampling.region[i];
+        if (r.min.defined()) {
+            add(coordinates[i] >= r.min);
+            if (r.extent.defined()) {
+                add(coordinates[i] < r.min + r.extent);
+            }
+        }
+    }
+
+    return cond;
+}
+
 class InjectTracing : public IRMutator {
 public:
     const map<string, Function> &env;
@@ -108,6 +146,7 @@ private:
         internal_assert(op);
         bool trace_it = false;
         Expr trace_parent;
+        const TraceSampling *sampling = nullptr;
         if (op->call_type == Call::Halide) {
             auto it = env.find(op->name);
             internal_assert(it != env.end()) << op->name << " not in environment\n";
@@ -118,6 +157,7 @@ private:
             trace_parent = Variable::make(Int(32), op->name + ".trace_id");
             if (trace_it) {
                 add_trace_tags(op->name, f.get_trace_tags());
+                sampling = &f.trace_loads_sampling();
             }
         } else if (op->call_type == Call::Image) {
             trace_it = trace_all_loads;
@@ -135,6 +175,7 @@ private:
                     f.schedule().compute_level().is_inlined()) {
                     trace_it = true;
                     add_trace_tags(op->name, f.get_trace_tags());
+                    sampling = &f.trace_loads_sampling();
                 }
             }
 
@@ -156,6 +197,13 @@ private:
             builder.parent_id = trace_parent;
             builder.value_index = op->value_index;
             Expr trace = builder.build();
+            if (sampling) {
+                Expr cond = sampling_condition(*sampling, op->args);
+                if (cond.defined()) {
+                    trace = Call::make(trace.type(), Call::if_then_else,
+                                       {cond, trace}, Call::PureIntrinsic);
+                }
+            }
 
             expr = Let::make(value_var_name, op,
                              Call::make(op->type, Call::return_second,
@@ -187,6 +235,7 @@ private:
             builder.coordinates = op->args;
             builder.event = halide_trace_store;
             builder.parent_id = Variable::make(Int(32), op->name + ".trace_id");
+            Expr sampled = sampling_condition(f.trace_stores_sampling(), op->args);
             for (size_t i = 0; i < values.size(); i++) {
                 Type t = values[i].type();
                 add_func_touched(f.name(), (int)i, t);
@@ -197,6 +246,10 @@ private:
                 builder.value_index = (int)i;
                 builder.value = {value_var};
                 Expr trace = builder.build();
+                if (sampled.defined()) {
+                    trace = Call::make(trace.type(), Call::if_then_else,
+                                       {sampled, trace}, Call::PureIntrinsic);
+                }
                 if (!is_const_one(op->predicate)) {
                     trace = Call::make(trace.type(), Call::if_then_else,
                                        {op->predicate, trace}, Call::PureIntrinsic);
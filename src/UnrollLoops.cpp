@@ -1,14 +1,19 @@
 #include "UnrollLoops.h"
 #include "Bounds.h"
 #include "CSE.h"
+#include "CodeSizeBudget.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "IRVisitor.h"
 #include "Simplify.h"
 #include "SimplifyCorrelatedDifferences.h"
 #include "Substitute.h"
 #include "UniquifyVariableNames.h"
 
+using std::map;
 using std::pair;
+using std::set;
+using std::string;
 using std::vector;
 
 namespace Halide {
@@ -16,11 +21,72 @@ namespace Internal {
 
 namespace {
 
+// Find the unrolled loops of the Funcs with a code size budget, and
+// estimate how much code unrolling each of them would add.
+class FindUnrollCandidates : public IRVisitor {
+    using IRVisitor::visit;
+
+    const CodeSizeBudget &budget;
+    string func;
+    int depth = 0;
+
+    // The code added by unrolling the loops found so far in the
+    // current loop body.
+    uint64_t added = 0;
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->is_producer) {
+            // Unrolling the loops of another Func is charged to its
+            // own budget.
+            ScopedValue<string> old_func(func, op->name);
+            ScopedValue<int> old_depth(depth, 0);
+            ScopedValue<uint64_t> old_added(added, 0);
+            IRVisitor::visit(op);
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const For *op) override {
+        uint64_t outer_added = added;
+        added = 0;
+        {
+            ScopedValue<int> old_depth(depth, depth + 1);
+            op->body.accept(this);
+        }
+        if (op->for_type == ForType::Unrolled && budget.has_budget(func)) {
+            Expr extent = simplify(op->extent);
+            if (!is_const(extent)) {
+                extent = find_constant_bound(extent, Direction::Upper, Scope<Interval>());
+            }
+            const int64_t *e = as_const_int(extent);
+            if (e && *e > 1) {
+                // Unrolling makes extent - 1 more copies of the body.
+                uint64_t cost = (*e - 1) * (code_size(op->body) + added);
+                candidates.push_back({func, op->name, cost, depth + 1});
+                added += cost;
+            }
+        }
+        added += outer_added;
+    }
+
+public:
+    vector<CodeSizeCandidate> candidates;
+
+    FindUnrollCandidates(const CodeSizeBudget &budget)
+        : budget(budget) {
+    }
+};
+
 class UnrollLoops : public IRMutator {
     using IRMutator::visit;
 
     vector<pair<std::string, Expr>> lets;
 
+    // Unrolled loops that would take their Func over its code size
+    // budget, and so stay serial.
+    const set<string> &too_big;
+
     Stmt visit(const LetStmt *op) override {
         if (is_pure(op->value)) {
             lets.emplace_back(op->name, op->value);
@@ -33,7 +99,12 @@ class UnrollLoops : public IRMutator {
     }
 
     Stmt visit(const For *for_loop) override {
-        if (for_loop->for_type == ForType::Unrolled) {
+        if (for_loop->for_type == ForType::Unrolled &&
+            too_big.count(for_loop->name)) {
+            Stmt body = mutate(for_loop->body);
+            return For::make(for_loop->name, for_loop->min, for_loop->extent,
+                             ForType::Serial, for_loop->device_api, std::move(body));
+        } else if (for_loop->for_type == ForType::Unrolled) {
             // Give it one last chance to simplify to an int
             Expr extent = simplify(for_loop->extent);
             Stmt body = for_loop->body;
@@ -108,7 +179,8 @@ class UnrollLoops : public IRMutator {
     bool permit_failed_unroll = false;
 
 public:
-    UnrollLoops() {
+    UnrollLoops(const set<string> &too_big)
+        : too_big(too_big) {
         // Experimental autoschedulers may want to unroll without
         // being totally confident the loop will indeed turn out
         // to be constant-sized. If this feature continues to be
@@ -124,8 +196,16 @@ public:
 
 }  // namespace
 
-Stmt unroll_loops(const Stmt &s) {
-    Stmt stmt = UnrollLoops().mutate(s);
+Stmt unroll_loops(const Stmt &s, const map<string, Function> &env) {
+    set<string> too_big;
+    CodeSizeBudget budget(s, env);
+    if (!budget.empty()) {
+        FindUnrollCandidates finder(budget);
+        s.accept(&finder);
+        too_big = budget.choose("unroll", finder.candidates);
+    }
+
+    Stmt stmt = UnrollLoops(too_big).mutate(s);
     // Unrolling duplicates variable names. Other passes assume variable names are unique.
     return uniquify_variable_names(stmt);
 }
@@ -5,15 +5,21 @@
  * Defines the lowering pass that unrolls loops marked as such
  */
 
+#include <map>
+#include <string>
+
 #include "Expr.h"
 
 namespace Halide {
 namespace Internal {
 
+class Function;
+
 /** Take a statement with for loops marked for unrolling, and convert
  * each into several copies of the innermost statement. I.e. unroll
- * the loop. */
-Stmt unroll_loops(const Stmt &);
+ * the loop. Unrolled loops that would take the loop nest of a Func
+ * over its code size budget are made serial instead. */
+Stmt unroll_loops(const Stmt &, const std::map<std::string, Function> &env);
 
 }  // namespace Internal
 }  // namespace Halide
@@ -8,6 +8,7 @@
 #include "Debug.h"
 #include "Error.h"
 #include "Introspection.h"
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <fstream>
@@ -39,8 +40,11 @@
 #include <Objbase.h>  // needed for CoCreateGuid
 #include <Shlobj.h>   // needed for SHGetFolderPath
 #include <windows.h>
+// windows.h must come first
+#include <psapi.h>  // needed for GetProcessMemoryInfo
 #else
 #include <dlfcn.h>
+#include <sys/resource.h>  // For getrusage
 #endif
 #ifdef __APPLE__
 #define CAN_GET_RUNNING_PROGRAM_NAME
@@ -172,12 +176,49 @@ const int num_unique_name_counters = (1 << 14);
 // this is a global, which is always zero-initialized.
 std::atomic<int> unique_name_counters[num_unique_name_counters] = {};
 
+// The private counters installed on this thread by a
+// ScopedUniqueNameCounters, if any.
+thread_local std::vector<int> *thread_unique_name_counters = nullptr;
+
 int unique_count(size_t h) {
     h = h & (num_unique_name_counters - 1);
+    if (thread_unique_name_counters) {
+        return (*thread_unique_name_counters)[h]++;
+    }
     return unique_name_counters[h]++;
 }
 }  // namespace
 
+UniqueNameCounters::UniqueNameCounters() {
+    if (thread_unique_name_counters) {
+        counts = *thread_unique_name_counters;
+        return;
+    }
+    counts.resize(num_unique_name_counters);
+    for (int i = 0; i < num_unique_name_counters; i++) {
+        counts[i] = unique_name_counters[i].load();
+    }
+}
+
+ScopedUniqueNameCounters::ScopedUniqueNameCounters(const UniqueNameCounters &start)
+    : counts(start.counts), previous(thread_unique_name_counters) {
+    thread_unique_name_counters = &counts;
+}
+
+ScopedUniqueNameCounters::~ScopedUniqueNameCounters() {
+    thread_unique_name_counters = previous;
+    for (int i = 0; i < num_unique_name_counters; i++) {
+        if (previous) {
+            (*previous)[i] = std::max((*previous)[i], counts[i]);
+            continue;
+        }
+        int current = unique_name_counters[i].load();
+        while (current < counts[i] &&
+               !unique_name_counters[i].compare_exchange_weak(current, counts[i])) {
+        }
+    }
+}
+
 // There are three possible families of names returned by the methods below:
 // 1) char pattern: (char that isn't '$') + number (e.g. v234)
 // 2) string pattern: (string without '$') + '$' + number (e.g. fr#nk82$42)
@@ -617,7 +658,9 @@ struct TickStackEntry {
     int line;
 };
 
-static vector<TickStackEntry> tick_stack;
+// Per thread, so that timing compilations on several threads at once
+// doesn't interleave their entries.
+thread_local vector<TickStackEntry> tick_stack;
 
 void halide_tic_impl(const char *file, int line) {
     string f = file;
@@ -926,6 +969,28 @@ int ctz64(uint64_t x) {
 #endif
 }
 
+uint64_t get_peak_rss_bytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    // macOS reports bytes...
+    return (uint64_t)usage.ru_maxrss;
+#else
+    // ...everyone else reports kilobytes.
+    return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
 }  // namespace Internal
 
 void load_plugin(const std::string &lib_name) {
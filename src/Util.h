@@ -173,6 +173,38 @@ std::string unique_name(char prefix);
 std::string unique_name(const std::string &prefix);
 // @}
 
+/** A copy of the counters unique_name uses on the calling thread, as
+ * they were when this object was made. */
+class UniqueNameCounters {
+public:
+    UniqueNameCounters();
+
+private:
+    friend class ScopedUniqueNameCounters;
+    std::vector<int> counts;
+};
+
+/** While one of these is alive, unique_name on the calling thread
+ * counts from a private copy of the given counters instead of the
+ * process-wide ones. Threads that compile concurrently can each start
+ * from the same UniqueNameCounters, so that the names each one makes
+ * don't depend on how the threads interleave. On destruction, the
+ * process-wide counters are moved past every name made from the copy,
+ * so later names stay unique. If another one was already active on
+ * this thread, it is the counters of that one that are moved on. */
+class ScopedUniqueNameCounters {
+public:
+    explicit ScopedUniqueNameCounters(const UniqueNameCounters &start);
+    ~ScopedUniqueNameCounters();
+
+    ScopedUniqueNameCounters(const ScopedUniqueNameCounters &) = delete;
+    ScopedUniqueNameCounters &operator=(const ScopedUniqueNameCounters &) = delete;
+
+private:
+    std::vector<int> counts;
+    std::vector<int> *previous;
+};
+
 /** Test if the first string starts with the second string */
 bool starts_with(const std::string &str, const std::string &prefix);
 
@@ -508,6 +540,10 @@ int clz64(uint64_t x);
 int ctz64(uint64_t x);
 // @}
 
+/** Return the peak resident memory of this process so far, in bytes,
+ * or zero if it can't be determined on this platform. */
+uint64_t get_peak_rss_bytes();
+
 }  // namespace Internal
 }  // namespace Halide
 
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <set>
 #include <utility>
 
 #include "CSE.h"
@@ -695,6 +696,15 @@ class VectorSubs : public IRMutator {
             }
             return Call::make(op->type, Call::trace, new_args, op->call_type);
         } else if (op->is_intrinsic(Call::if_then_else) && op->args.size() == 2) {
+            const Call *trace = new_args[1].as<Call>();
+            if (trace && trace->name == Call::trace && new_args[0].type().is_vector()) {
+                // A vectorized trace call reports the whole vector at
+                // once, so make it if any of the lanes wants it
+                // (e.g. a predicated store, or sampled tracing).
+                Expr cond = VectorReduce::make(VectorReduce::Or, new_args[0], 1);
+                return Call::make(op->type, Call::if_then_else, {cond, new_args[1]}, Call::PureIntrinsic);
+            }
+
             Expr cond = widen(new_args[0], max_lanes);
             Expr true_value = widen(new_args[1], max_lanes);
 
@@ -1540,6 +1550,197 @@ public:
     }
 };
 
+/** For stages that allow reassociation, keep a partial result per lane
+ * of a vectorized loop over a reduction into a single site, across the
+ * serial loop around it. That is:
+ \code
+ for ro:
+   for ri vectorized:
+     atomic f[i] = f[i] + g(ro, ri)
+ \endcode
+ * becomes:
+ \code
+ allocate f_partial[lanes]
+ for ri vectorized:
+   f_partial[ri] = 0
+ for ro:
+   for ri vectorized:
+     f_partial[ri] = f_partial[ri] + g(ro, ri)
+ for ri vectorized:
+   atomic f[i] = f[i] + f_partial[ri]
+ \endcode
+ * and the last loop then becomes a reduction tree, instead of there
+ * being one on every iteration over ro. */
+class KeepPartialReductions : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, Function> &env;
+
+    // Does the stage of the Func that the loop belongs to allow
+    // reassociation?
+    bool allows_reassociation(const string &func, const string &loop) const {
+        auto it = env.find(func);
+        const string prefix = func + ".s";
+        if (it == env.end() || !starts_with(loop, prefix)) {
+            return false;
+        }
+        size_t end = loop.find('.', prefix.size());
+        if (end == string::npos) {
+            return false;
+        }
+        int stage = std::atoi(loop.substr(prefix.size(), end - prefix.size()).c_str());
+        const Function &f = it->second;
+        if (stage == 0) {
+            return f.has_pure_definition() && f.definition().schedule().allow_reassociation();
+        } else if (stage <= (int)f.updates().size()) {
+            return f.update(stage - 1).schedule().allow_reassociation();
+        }
+        return false;
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->for_type != ForType::Serial) {
+            return IRMutator::visit(op);
+        }
+
+        vector<const LetStmt *> outer_lets, inner_lets;
+        Stmt body = op->body;
+        while (const LetStmt *let = body.as<LetStmt>()) {
+            outer_lets.push_back(let);
+            body = let->body;
+        }
+        const For *inner = body.as<For>();
+        const IntImm *lanes = inner ? inner->extent.as<IntImm>() : nullptr;
+        if (!inner || inner->for_type != ForType::Vectorized || !lanes || lanes->value < 2) {
+            return IRMutator::visit(op);
+        }
+        body = inner->body;
+        while (const LetStmt *let = body.as<LetStmt>()) {
+            inner_lets.push_back(let);
+            body = let->body;
+        }
+        const Atomic *atomic = body.as<Atomic>();
+        const Store *store = atomic ? atomic->body.as<Store>() : nullptr;
+        if (!store ||
+            !atomic->mutex_name.empty() ||
+            store->name != atomic->producer_name ||
+            !is_const_one(store->predicate) ||
+            !store->value.type().is_scalar() ||
+            store->value.type().is_bool() ||
+            !allows_reassociation(atomic->producer_name, op->name)) {
+            return IRMutator::visit(op);
+        }
+
+        // f[i] = f[i] <op> b, for an op with an identity that is safe
+        // under fast math.
+        Type t = store->value.type();
+        Expr a, b, identity;
+        if (const Add *add = store->value.as<Add>()) {
+            a = add->a;
+            b = add->b;
+            identity = make_zero(t);
+        } else if (const Mul *mul = store->value.as<Mul>()) {
+            a = mul->a;
+            b = mul->b;
+            identity = make_one(t);
+        } else if (const Min *min = store->value.as<Min>()) {
+            a = min->a;
+            b = min->b;
+            identity = t.is_float() ? Expr() : t.max();
+        } else if (const Max *max = store->value.as<Max>()) {
+            a = max->a;
+            b = max->b;
+            identity = t.is_float() ? Expr() : t.min();
+        }
+        if (!identity.defined()) {
+            return IRMutator::visit(op);
+        }
+        const Load *load = a.as<Load>();
+        if (!load || load->name != store->name) {
+            std::swap(a, b);
+            load = a.as<Load>();
+        }
+        if (!load ||
+            load->name != store->name ||
+            !is_const_one(load->predicate) ||
+            !equal(load->index, store->index) ||
+            expr_uses_var(b, store->name)) {
+            return IRMutator::visit(op);
+        }
+
+        // The site must be the same throughout both loops, and nothing
+        // else in them may read it.
+        Scope<> inside;
+        inside.push(op->name);
+        inside.push(inner->name);
+        for (const LetStmt *let : outer_lets) {
+            inside.push(let->name);
+            if (expr_uses_var(let->value, store->name)) {
+                return IRMutator::visit(op);
+            }
+        }
+        for (const LetStmt *let : inner_lets) {
+            inside.push(let->name);
+            if (expr_uses_var(let->value, store->name)) {
+                return IRMutator::visit(op);
+            }
+        }
+        if (expr_uses_vars(store->index, inside)) {
+            return IRMutator::visit(op);
+        }
+
+        auto reduce = [&](const Expr &x, const Expr &y) -> Expr {
+            switch (store->value.node_type()) {
+            case IRNodeType::Add:
+                return Add::make(x, y);
+            case IRNodeType::Mul:
+                return Mul::make(x, y);
+            case IRNodeType::Min:
+                return Min::make(x, y);
+            default:
+                return Max::make(x, y);
+            }
+        };
+
+        debug(3) << "Keeping partial results across " << op->name << " for " << store->name << "\n";
+
+        const string partial = unique_name(store->name + "_partial");
+        auto partial_load = [&](const Expr &index) {
+            return Load::make(t, partial, index, Buffer<>(), Parameter(), const_true(), ModulusRemainder());
+        };
+        auto partial_store = [&](const Expr &value, const Expr &index) {
+            return Store::make(partial, value, index, Parameter(), const_true(), ModulusRemainder());
+        };
+
+        Expr lane = Variable::make(Int(32), inner->name) - inner->min;
+        Stmt loop = partial_store(reduce(partial_load(lane), b), lane);
+        for (auto it = inner_lets.rbegin(); it != inner_lets.rend(); it++) {
+            loop = LetStmt::make((*it)->name, (*it)->value, loop);
+        }
+        loop = For::make(inner->name, inner->min, inner->extent, inner->for_type, inner->device_api, loop);
+        for (auto it = outer_lets.rbegin(); it != outer_lets.rend(); it++) {
+            loop = LetStmt::make((*it)->name, (*it)->value, loop);
+        }
+        loop = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, loop);
+
+        Expr v = Variable::make(Int(32), inner->name);
+        Stmt init = For::make(inner->name, 0, inner->extent, ForType::Vectorized, inner->device_api,
+                              partial_store(identity, v));
+        Stmt combine = Store::make(store->name, reduce(a, partial_load(v)), store->index,
+                                   store->param, const_true(), store->alignment);
+        combine = Atomic::make(atomic->producer_name, atomic->mutex_name, combine);
+        combine = For::make(inner->name, 0, inner->extent, ForType::Vectorized, inner->device_api, combine);
+
+        return Allocate::make(partial, t, MemoryType::Stack, {inner->extent}, const_true(),
+                              Block::make({init, loop, combine}));
+    }
+
+public:
+    KeepPartialReductions(const map<string, Function> &env)
+        : env(env) {
+    }
+};
+
 // Vectorize all loops marked as such in a Stmt
 class VectorizeLoops : public IRMutator {
     using IRMutator::visit;
@@ -1626,12 +1827,165 @@ Stmt vectorize_statement(const Stmt &stmt) {
     return VectorizeLoops().mutate(stmt);
 }
 
+/** Find the vector loads that a statement always does, the buffers it
+ * writes, and whether it does anything else that makes it unsafe to
+ * load earlier. Loads that use a variable bound
+ * within the statement, or that are only evaluated conditionally, are
+ * not candidates for sharing. */
+class FindSharableLoads : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    Scope<> bound;
+    int conditional = 0;
+
+    void visit(const Load *op) override {
+        IRGraphVisitor::visit(op);
+        if (op->type.is_vector() && !conditional &&
+            !expr_uses_vars(op->index, bound) &&
+            !expr_uses_vars(op->predicate, bound)) {
+            loads.emplace_back(op);
+        }
+    }
+
+    void visit(const Let *op) override {
+        op->value.accept(this);
+        ScopedBinding<> bind(bound, op->name);
+        op->body.accept(this);
+    }
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        ScopedBinding<> bind(bound, op->name);
+        op->body.accept(this);
+    }
+
+    void visit(const Store *op) override {
+        written.insert(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        if (op->is_intrinsic(Call::if_then_else)) {
+            op->args[0].accept(this);
+            conditional++;
+            for (size_t i = 1; i < op->args.size(); i++) {
+                op->args[i].accept(this);
+            }
+            conditional--;
+        } else {
+            // Anything with side effects might write to memory, or
+            // stop the pipeline.
+            side_effects = side_effects || !op->is_pure();
+            IRGraphVisitor::visit(op);
+        }
+    }
+
+    // Loads inside any other kind of statement run conditionally, or
+    // in a loop, or touch an allocation made within the statement.
+    void visit(const IfThenElse *op) override {
+        conditional++;
+        IRGraphVisitor::visit(op);
+        conditional--;
+    }
+
+    void visit(const For *op) override {
+        conditional++;
+        IRGraphVisitor::visit(op);
+        conditional--;
+    }
+
+    void visit(const Allocate *op) override {
+        conditional++;
+        IRGraphVisitor::visit(op);
+        conditional--;
+    }
+
+    void visit(const Acquire *op) override {
+        conditional++;
+        IRGraphVisitor::visit(op);
+        conditional--;
+    }
+
+    void visit(const AssertStmt *op) override {
+        // A failed assertion may be what keeps a later load in bounds.
+        side_effects = true;
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Atomic *op) override {
+        side_effects = true;
+        IRGraphVisitor::visit(op);
+    }
+
+public:
+    vector<Expr> loads;
+    std::set<string> written;
+    bool side_effects = false;
+};
+
+class ShareVectorLoads : public IRMutator {
+    using IRMutator::visit;
+
+    void flatten(const Stmt &s, vector<Stmt> &stmts) {
+        if (const Block *b = s.as<Block>()) {
+            flatten(b->first, stmts);
+            flatten(b->rest, stmts);
+        } else {
+            stmts.push_back(mutate(s));
+        }
+    }
+
+    Stmt visit(const Block *op) override {
+        vector<Stmt> stmts;
+        flatten(op, stmts);
+
+        map<Expr, int, IRDeepCompare> uses;
+        std::set<string> written;
+        bool side_effects = false;
+        for (const Stmt &s : stmts) {
+            FindSharableLoads finder;
+            s.accept(&finder);
+            std::set<Expr, IRDeepCompare> unique(finder.loads.begin(), finder.loads.end());
+            for (const Expr &e : unique) {
+                uses[e]++;
+            }
+            written.insert(finder.written.begin(), finder.written.end());
+            side_effects = side_effects || finder.side_effects;
+        }
+
+        Stmt result = Block::make(stmts);
+        if (side_effects) {
+            return result;
+        }
+
+        vector<pair<string, Expr>> lets;
+        for (const auto &it : uses) {
+            const Load *load = it.first.as<Load>();
+            if (it.second > 1 && !written.count(load->name)) {
+                string name = unique_name('t');
+                result = substitute(it.first, Variable::make(load->type, name), result);
+                lets.emplace_back(name, it.first);
+            }
+        }
+        for (const auto &l : lets) {
+            result = LetStmt::make(l.first, l.second, result);
+        }
+        return result;
+    }
+};
+
 }  // namespace
+
+Stmt share_vector_loads(const Stmt &s) {
+    return ShareVectorLoads().mutate(s);
+}
+
 Stmt vectorize_loops(const Stmt &stmt, const map<string, Function> &env) {
     // Limit the scope of atomic nodes to just the necessary stuff.
     // TODO: Should this be an earlier pass? It's probably a good idea
     // for non-vectorizing stuff too.
-    Stmt s = LiftVectorizableExprsOutOfAllAtomicNodes(env).mutate(stmt);
+    Stmt s = KeepPartialReductions(env).mutate(stmt);
+    s = LiftVectorizableExprsOutOfAllAtomicNodes(env).mutate(s);
     s = vectorize_statement(s);
     s = RemoveUnnecessaryAtomics().mutate(s);
     return s;
@@ -22,6 +22,14 @@ namespace Internal {
  */
 Stmt vectorize_loops(const Stmt &s, const std::map<std::string, Function> &env);
 
+/** Find vector loads made by more than one store of a block, such as
+ * the stages of a compute_with group fused at a vectorized loop, and
+ * load them once ahead of the block. Only loads of buffers that the
+ * block does not write are shared. Best run after simplification, so
+ * that equal loads are also syntactically equal.
+ */
+Stmt share_vector_loads(const Stmt &s);
+
 }  // namespace Internal
 }  // namespace Halide
 
@@ -3,6 +3,8 @@
 #include <cmath>
 #include <csignal>
 #include <cstdlib>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <unordered_map>
@@ -21,6 +23,7 @@
 #include "LLVM_Output.h"
 #include "LLVM_Runtime_Linker.h"
 #include "Target.h"
+#include "Util.h"
 
 #if WITH_WABT
 #include "wabt/binary-reader.h"
@@ -375,6 +378,78 @@ std::vector<char> compile_to_wasm(const Module &module, const std::string &fn_na
     return read_entire_file(wasm_output.pathname());
 }
 
+// The compiled form of a Module, shared by every WasmModule compiled
+// from identical Modules.
+struct CachedWasm {
+    std::vector<char> wasm;
+#ifdef WITH_V8
+    // V8's compiled code for the wasm, shared across isolates, so that
+    // later compilations reuse code that V8 has already tiered up.
+    std::mutex v8_mutex;
+    std::unique_ptr<CompiledWasmModule> v8_compiled;
+#endif
+};
+
+// Generating and linking the wasm is by far the most expensive part of
+// JIT-compiling a wasm pipeline, so the results are cached by content
+// hash: in memory for the most recently used Modules, and across
+// processes in the JIT cache directory, if one is set.
+std::shared_ptr<CachedWasm> compile_to_wasm_cached(const Module &module, const std::string &fn_name) {
+    constexpr size_t kMaxCachedWasmModules = 32;
+    static std::mutex cache_lock;
+    static std::map<std::string, std::shared_ptr<CachedWasm>> cache;
+    static std::deque<std::string> cache_order;
+
+    const std::string key = jit_cache_key(module) + "_" + fn_name;
+    {
+        std::lock_guard<std::mutex> lock(cache_lock);
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            wdebug(1) << "Reusing compiled wasm for " << fn_name << "\n";
+            return it->second;
+        }
+    }
+
+    auto cached = std::make_shared<CachedWasm>();
+    const std::string cache_dir = JITSharedRuntime::get_jit_cache_dir();
+    const std::string cache_path = cache_dir.empty() ? "" : cache_dir + "/" + key + ".wasm";
+    if (!cache_path.empty() && file_exists(cache_path)) {
+        wdebug(1) << "Loading " << fn_name << " from JIT cache " << cache_path << "\n";
+        cached->wasm = read_entire_file(cache_path);
+    } else {
+        cached->wasm = compile_to_wasm(module, fn_name);
+        if (!cache_path.empty()) {
+            // Write to a temporary file and rename it into place, so that
+            // concurrent processes never see a partially-written module.
+            int fd = -1;
+            llvm::SmallString<256> tmp_path;
+            if (llvm::sys::fs::createUniqueFile(cache_path + ".%%%%%%%%.tmp", fd, tmp_path)) {
+                wdebug(1) << "Unable to write to JIT cache " << cache_path << "\n";
+            } else {
+                {
+                    llvm::raw_fd_ostream out(fd, /*shouldClose*/ true);
+                    out.write(cached->wasm.data(), cached->wasm.size());
+                }
+                if (llvm::sys::fs::rename(tmp_path, cache_path)) {
+                    llvm::sys::fs::remove(tmp_path);
+                    wdebug(1) << "Unable to write to JIT cache " << cache_path << "\n";
+                }
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(cache_lock);
+    auto inserted = cache.emplace(key, cached);
+    if (inserted.second) {
+        cache_order.push_back(key);
+        while (cache_order.size() > kMaxCachedWasmModules) {
+            cache.erase(cache_order.front());
+            cache_order.pop_front();
+        }
+    }
+    return inserted.first->second;
+}
+
 // dynamic_type_dispatch is a utility for functors that want to be able
 // to dynamically dispatch a halide_type_t to type-specialized code.
 // To use it, a functor must be a *templated* class, e.g.
@@ -1280,6 +1355,9 @@ wabt::Features calc_features(const Target &target) {
     if (target.has_feature(Target::WasmSatFloatToInt)) {
         f.enable_sat_float_to_int();
     }
+    if (target.has_feature(Target::WasmRelaxedSimd)) {
+        f.enable_relaxed_simd();
+    }
     return f;
 }
 #endif  // WITH_WABT
@@ -2294,7 +2372,8 @@ WasmModuleContents::WasmModuleContents(
     user_assert(!target.has_feature(Target::WebGPU)) << "wasm_webgpu requires Emscripten (or a similar compiler); it will never be supported under JIT.";
 
     // Compile halide into wasm bytecode.
-    std::vector<char> final_wasm = compile_to_wasm(halide_module, fn_name);
+    std::shared_ptr<CachedWasm> cached_wasm = compile_to_wasm_cached(halide_module, fn_name);
+    const std::vector<char> &final_wasm = cached_wasm->wasm;
 
     // Create a wabt Module for it.
     wabt::MemoryStream log_stream;
@@ -2394,6 +2473,7 @@ WasmModuleContents::WasmModuleContents(
             // Note that we currently enable all features that *might* be used
             // (eg we enable simd even though we might not use it) as we may well end
             // using different Halide Targets across our lifespan.
+            "--experimental-wasm-relaxed-simd",
 
             // Sometimes useful for debugging purposes:
             // "--print_all_exceptions=true",
@@ -2435,11 +2515,25 @@ WasmModuleContents::WasmModuleContents(
 
     Local<v8::String> fn_name_str = NewLocalString(isolate, fn_name.c_str());
 
-    std::vector<char> final_wasm = compile_to_wasm(halide_module, fn_name);
+    std::shared_ptr<CachedWasm> cached_wasm = compile_to_wasm_cached(halide_module, fn_name);
 
-    MaybeLocal<WasmModuleObject> maybe_compiled = WasmModuleObject::Compile(
-        isolate,
-        /* wire_bytes */ {(const uint8_t *)final_wasm.data(), final_wasm.size()});
+    MaybeLocal<WasmModuleObject> maybe_compiled;
+    {
+        std::lock_guard<std::mutex> lock(cached_wasm->v8_mutex);
+        if (cached_wasm->v8_compiled) {
+            wdebug(1) << "Reusing V8 compiled module for " << fn_name << "\n";
+            maybe_compiled = WasmModuleObject::FromCompiledModule(isolate, *cached_wasm->v8_compiled);
+        } else {
+            const std::vector<char> &final_wasm = cached_wasm->wasm;
+            maybe_compiled = WasmModuleObject::Compile(
+                isolate,
+                /* wire_bytes */ {(const uint8_t *)final_wasm.data(), final_wasm.size()});
+            Local<WasmModuleObject> module_object;
+            if (maybe_compiled.ToLocal(&module_object)) {
+                cached_wasm->v8_compiled = std::make_unique<CompiledWasmModule>(module_object->GetCompiledModule());
+            }
+        }
+    }
 
     Local<WasmModuleObject> compiled;
     if (!maybe_compiled.ToLocal(&compiled)) {
@@ -43,13 +43,17 @@
 #include "HalidePlugin.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <queue>
 #include <random>
 #include <set>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -222,6 +226,143 @@ void configure_pipeline_features(const FunctionDAG &dag,
     cost_model->set_pipeline_features(dag, params);
 }
 
+// A CostModel that just records what gets enqueued, so that the
+// children generated on other threads can be handed to the real cost
+// model in a deterministic order.
+class RecordingCostModel : public CostModel {
+    std::vector<std::pair<StageMapOfScheduleFeatures, double *>> queue;
+
+public:
+    void set_pipeline_features(const FunctionDAG &dag,
+                               const Adams2019Params &params) override {
+        internal_error << "RecordingCostModel can't be configured\n";
+    }
+
+    void enqueue(const FunctionDAG &dag,
+                 const StageMapOfScheduleFeatures &schedule_feats,
+                 double *cost_ptr) override {
+        queue.emplace_back(schedule_feats, cost_ptr);
+    }
+
+    void evaluate_costs() override {
+        internal_error << "RecordingCostModel can't evaluate costs\n";
+    }
+
+    void reset() override {
+        queue.clear();
+    }
+
+    // Enqueue everything recorded so far in the given cost model.
+    void replay(const FunctionDAG &dag, CostModel *cost_model) {
+        for (const auto &q : queue) {
+            cost_model->enqueue(dag, q.first, q.second);
+        }
+        queue.clear();
+    }
+};
+
+// Generate the children of each of the given states, spreading the
+// states across params.search_threads threads. The children, and their
+// costs enqueued in the cost model, are passed on in the order of the
+// states, and the caches only get the entries made by each state once
+// they are all done, so the result doesn't depend on the number of
+// threads or on how they were scheduled.
+void generate_children_in_parallel(const FunctionDAG &dag,
+                                   const Adams2019Params &params,
+                                   CostModel *cost_model,
+                                   const std::vector<IntrusivePtr<State>> &states,
+                                   const std::function<void(int, IntrusivePtr<State> &&)> &accept_child,
+                                   Cache *cache) {
+    struct Expansion {
+        std::vector<IntrusivePtr<State>> children;
+        RecordingCostModel costs;
+        FeatureCacheUpdates feature_cache_updates;
+        bool done = false;
+    };
+    std::vector<Expansion> expansions(states.size());
+
+    // Guards 'done', 'next_to_pass_on', and the calls into cost_model
+    // and accept_child.
+    std::mutex mutex;
+    size_t next_to_pass_on = 0;
+    std::atomic<size_t> next_to_expand{0};
+#ifdef HALIDE_WITH_EXCEPTIONS
+    std::exception_ptr error;
+#endif
+
+    auto expand = [&](size_t i) {
+        Expansion &e = expansions[i];
+        std::function<void(IntrusivePtr<State> &&)> collect_child =
+            [&](IntrusivePtr<State> &&s) {
+                e.children.emplace_back(std::move(s));
+            };
+        {
+            FeatureCacheUpdates::Scope scope(&e.feature_cache_updates);
+            states[i]->generate_children(dag, params, cost_model ? &e.costs : nullptr, collect_child, cache);
+        }
+
+        // Pass on the results of this and any following states that
+        // are already done, so they don't all pile up until the end.
+        std::lock_guard<std::mutex> lock(mutex);
+        e.done = true;
+        while (next_to_pass_on < states.size() && expansions[next_to_pass_on].done) {
+            Expansion &n = expansions[next_to_pass_on];
+            if (cost_model) {
+                n.costs.replay(dag, cost_model);
+            }
+            for (auto &c : n.children) {
+                accept_child((int)next_to_pass_on, std::move(c));
+            }
+            n.children.clear();
+            next_to_pass_on++;
+        }
+    };
+
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next_to_expand++) < states.size()) {
+#ifdef HALIDE_WITH_EXCEPTIONS
+            try {
+                expand(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next_to_expand = states.size();
+            }
+#else
+            expand(i);
+#endif
+        }
+    };
+
+    size_t num_threads = params.search_threads > 0 ?
+                             (size_t)params.search_threads :
+                             (size_t)std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::min(num_threads, states.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : threads) {
+        t.join();
+    }
+
+#ifdef HALIDE_WITH_EXCEPTIONS
+    if (error) {
+        std::rethrow_exception(error);
+    }
+#endif
+    internal_assert(next_to_pass_on == states.size());
+
+    for (auto &e : expansions) {
+        e.feature_cache_updates.commit();
+    }
+    cache->commit_memoized_blocks(states);
+}
+
 // A single pass of coarse-to-fine beam search.
 IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                           const vector<Function> &outputs,
@@ -232,7 +373,9 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                           int num_passes,
                                           ProgressBar &tick,
                                           std::unordered_set<uint64_t> &permitted_hashes,
-                                          Cache *cache) {
+                                          Cache *cache,
+                                          const Deadline &deadline,
+                                          bool have_best) {
 
     if (cost_model) {
         configure_pipeline_features(dag, params, cost_model);
@@ -269,11 +412,25 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
     string cyos_str = get_env_variable("HL_CYOS");
 #endif
 
+    bool out_of_time = false;
+
     // This loop is beam search over the sequence of decisions to make.
     for (int i = 0;; i++) {
         std::unordered_map<uint64_t, int> hashes;
         q.swap(pending);
 
+        // Once out of time, abandon this pass if an earlier one found a
+        // complete schedule. Otherwise finish it as a greedy search.
+        if (!out_of_time && deadline.passed()) {
+            if (have_best) {
+                return nullptr;
+            }
+            aslog(1) << "Time limit reached after " << i << " of " << 2 * dag.nodes.size()
+                     << " decisions, completing pass " << pass_idx << " greedily\n";
+            out_of_time = true;
+        }
+        const int beam_size = out_of_time ? 1 : params.beam_size;
+
         if (pending.empty()) {
             if ((false) && params.beam_size < 1000) {  // Intentional dead code. Extra parens to pacify clang-tidy.
                 // Total mortality. Double the beam size and
@@ -290,7 +447,9 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                              num_passes,
                                              tick,
                                              permitted_hashes,
-                                             cache);
+                                             cache,
+                                             deadline,
+                                             have_best);
             } else {
                 internal_error << "Ran out of legal states with beam size " << params.beam_size << "\n";
             }
@@ -301,7 +460,8 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
         }
 
         expanded = 0;
-        while (expanded < params.beam_size && !pending.empty()) {
+        std::vector<IntrusivePtr<State>> to_expand;
+        while (expanded < beam_size && !pending.empty()) {
 
             IntrusivePtr<State> state{pending.pop()};
 
@@ -343,7 +503,7 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
             }
 
             // Random dropout
-            if (pending.size() > 1 && random_dropout(params, rng, dag.nodes.size() * 2)) {
+            if (!out_of_time && pending.size() > 1 && random_dropout(params, rng, dag.nodes.size() * 2)) {
                 continue;
             }
 
@@ -378,10 +538,21 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                 return best;
             }
 
-            state->generate_children(dag, params, cost_model, enqueue_new_children, cache);
+            to_expand.emplace_back(std::move(state));
             expanded++;
         }
 
+        generate_children_in_parallel(
+            dag, params, cost_model, to_expand,
+            [&](int state_idx, IntrusivePtr<State> &&s) {
+                // Keep the progress bar where it would be had the states
+                // been expanded one at a time.
+                expanded = state_idx;
+                enqueue_new_children(std::move(s));
+            },
+            cache);
+        expanded = (int)to_expand.size();
+
         // Drop the other states unconsidered.
         pending.clear();
 
@@ -456,25 +627,43 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
         num_passes = std::atoi(num_passes_str.c_str());
     }
 
+    Deadline deadline(params.time_limit);
+
     for (int i = 0; i < num_passes; i++) {
+        if (best.defined() && deadline.passed()) {
+            aslog(1) << "Time limit of " << params.time_limit << "s reached after "
+                     << i << " of " << num_passes << " passes\n";
+            break;
+        }
+
         ProgressBar tick;
 
         Timer timer;
 
         auto pass = optimal_schedule_pass(dag, outputs, params, cost_model,
-                                          rng, i, num_passes, tick, permitted_hashes, &cache);
+                                          rng, i, num_passes, tick, permitted_hashes, &cache,
+                                          deadline, best.defined());
 
         std::chrono::duration<double> total_time = timer.elapsed();
         auto milli = std::chrono::duration_cast<std::chrono::milliseconds>(total_time).count();
 
         tick.clear();
 
+        if (!pass.defined()) {
+            aslog(1) << "Time limit of " << params.time_limit << "s reached during pass "
+                     << i << " of " << num_passes << ", abandoning it\n";
+            break;
+        }
+
         switch (aslog::aslog_level()) {
         case 0:
             // Silence
             break;
         case 1:
             aslog(1) << "Pass " << i << " of " << num_passes << ", cost: " << pass->cost << ", time (ms): " << milli << "\n";
+            if (params.time_limit > 0) {
+                aslog(1) << "Time remaining (s): " << std::max(0.0, params.time_limit - deadline.timer.elapsed().count()) << "\n";
+            }
             break;
         default:
             aslog(2) << "Pass " << i << " result: ";
@@ -495,11 +684,13 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
         aslog(1) << "Cache (block) misses: " << cache.cache_misses << "\n";
     }
 
+    cache.save_tilings();
+
     return best;
 }
 
 // Keep track of how many times we evaluated a state.
-int State::cost_calculations = 0;
+std::atomic<int> State::cost_calculations{0};
 
 // The main entrypoint to generate a schedule for a pipeline.
 void generate_schedule(const std::vector<Function> &outputs,
@@ -516,6 +707,11 @@ void generate_schedule(const std::vector<Function> &outputs,
     aslog(1) << "Adams2019.disable_memoized_features:" << params.disable_memoized_features << "\n";
     aslog(1) << "Adams2019.disable_memoized_blocks:" << params.disable_memoized_blocks << "\n";
     aslog(1) << "Adams2019.memory_limit:" << params.memory_limit << "\n";
+    aslog(1) << "Adams2019.search_threads:" << params.search_threads << "\n";
+    aslog(1) << "Adams2019.block_cache_path:" << params.block_cache_path << "\n";
+    aslog(1) << "Adams2019.time_limit:" << params.time_limit << "\n";
+    aslog(1) << "Adams2019.cost_model_batch_size:" << params.cost_model_batch_size << "\n";
+    aslog(1) << "Adams2019.prefetch_distance:" << params.prefetch_distance << "\n";
 
     // Start a timer
     HALIDE_TIC;
@@ -599,6 +795,11 @@ struct Adams2019 {
             parser.parse("disable_memoized_features", &params.disable_memoized_features);
             parser.parse("disable_memoized_blocks", &params.disable_memoized_blocks);
             parser.parse("memory_limit", &params.memory_limit);
+            parser.parse("search_threads", &params.search_threads);
+            parser.parse("block_cache_path", &params.block_cache_path);
+            parser.parse("time_limit", &params.time_limit);
+            parser.parse("cost_model_batch_size", &params.cost_model_batch_size);
+            parser.parse("prefetch_distance", &params.prefetch_distance);
             parser.finish();
         }
         Autoscheduler::generate_schedule(outputs, target, params, results);
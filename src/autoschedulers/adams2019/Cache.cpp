@@ -2,6 +2,10 @@
 #include "LoopNest.h"
 #include "State.h"
 
+#include <cstdio>
+#include <fstream>
+#include <random>
+
 namespace Halide {
 namespace Internal {
 namespace Autoscheduler {
@@ -71,7 +75,7 @@ bool Cache::add_memoized_blocks(const State *state,
     return true;
 }
 
-void Cache::memoize_blocks(const FunctionDAG::Node *node, LoopNest *new_root) {
+void Cache::memoize_blocks(const State *state, const FunctionDAG::Node *node, LoopNest *new_root) {
     if (!options.cache_blocks) {
         return;
     }
@@ -89,7 +93,7 @@ void Cache::memoize_blocks(const FunctionDAG::Node *node, LoopNest *new_root) {
 
     internal_assert(loop_nest_found) << "memoize_blocks did not find loop nest!\n";
 
-    auto &blocks = memoized_compute_root_blocks.get_or_create(node)[vector_dim];
+    PendingBlocks pending{node, vector_dim, {}};
 
     for (auto &child : new_root->children) {
         if (child->node == node) {
@@ -97,10 +101,169 @@ void Cache::memoize_blocks(const FunctionDAG::Node *node, LoopNest *new_root) {
             const LoopNest *child_ptr = child.get();
             LoopNest *new_block = new LoopNest;
             new_block->copy_from_including_features(*child_ptr);
-            blocks.emplace_back(new_block);
-            cache_misses++;
+            pending.blocks.emplace_back(new_block);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(pending_blocks_mutex);
+    pending_blocks[state].emplace_back(std::move(pending));
+}
+
+void Cache::commit_memoized_blocks(const std::vector<IntrusivePtr<State>> &states) {
+    for (const auto &state : states) {
+        auto t = pending_tilings.find(state.get());
+        if (t != pending_tilings.end()) {
+            // The first state to find tilings for a key wins.
+            for (auto &p : t->second) {
+                new_tilings.emplace(p.first, std::move(p.second));
+            }
+        }
+
+        auto it = pending_blocks.find(state.get());
+        if (it == pending_blocks.end()) {
+            continue;
+        }
+
+        // Decide for each vector dimension before adding any, as a
+        // state may memoize several tilings of the same one.
+        std::map<std::pair<const FunctionDAG::Node *, int>, bool> first;
+        for (const auto &p : it->second) {
+            first.emplace(std::make_pair(p.node, p.vector_dim),
+                          !memoized_compute_root_blocks.contains(p.node) ||
+                              memoized_compute_root_blocks.get(p.node).count(p.vector_dim) == 0);
+        }
+
+        for (auto &p : it->second) {
+            if (!first.at({p.node, p.vector_dim})) {
+                continue;
+            }
+            auto &blocks = memoized_compute_root_blocks.get_or_create(p.node)[p.vector_dim];
+            for (auto &b : p.blocks) {
+                blocks.emplace_back(std::move(b));
+                cache_misses++;
+            }
+        }
+    }
+    pending_blocks.clear();
+    pending_tilings.clear();
+}
+
+uint64_t Cache::tilings_key(const State *state, const FunctionDAG::Node *node, const Adams2019Params &params) const {
+    uint64_t h = 0;
+    LoopNest::hash_combine(h, params.parallelism);
+    LoopNest::hash_combine(h, node->dimensions);
+    LoopNest::hash_combine(h, node->vector_size);
+
+    const auto &bounds = state->root->get_bounds(node);
+    for (const auto &c : state->root->children) {
+        if (c->node != node) {
+            continue;
+        }
+        LoopNest::hash_combine(h, c->stage->index);
+        LoopNest::hash_combine(h, c->vector_dim);
+        LoopNest::hash_combine(h, c->vectorized_loop_index);
+        for (size_t i = 0; i < c->stage->loop.size(); i++) {
+            const auto &l = c->stage->loop[i];
+            const auto &p = bounds->loops(c->stage->index, i);
+            LoopNest::hash_combine(h, l.pure);
+            LoopNest::hash_combine(h, l.rvar);
+            LoopNest::hash_combine(h, l.pure_dim);
+            LoopNest::hash_combine(h, c->size[i]);
+            LoopNest::hash_combine(h, p.extent());
+            LoopNest::hash_combine(h, p.constant_extent());
+        }
+    }
+    return h;
+}
+
+const Cache::Tilings *Cache::find_stored_tilings(uint64_t key, size_t dimensions) const {
+    auto it = stored_tilings.find(key);
+    if (it == stored_tilings.end()) {
+        return nullptr;
+    }
+    for (const auto &t : it->second) {
+        if (t.size() != dimensions) {
+            return nullptr;
         }
+        for (int64_t s : t) {
+            if (s < 1) {
+                return nullptr;
+            }
+        }
+    }
+    cache_hits++;
+    return &(it->second);
+}
+
+void Cache::store_tilings(const State *state, uint64_t key, Tilings tilings) {
+    std::lock_guard<std::mutex> lock(pending_blocks_mutex);
+    pending_tilings[state].emplace_back(key, std::move(tilings));
+}
+
+// The file holds a header line, and then one line per key of the form:
+//   key num_tilings num_dimensions tiling0[0] tiling0[1] ... tiling1[0] ...
+void Cache::load_tilings() {
+    std::ifstream in(options.block_cache_path);
+    std::string magic;
+    int version = 0;
+    if (!(in >> magic >> version) || magic != "adams2019_tilings" || version != 1) {
+        aslog(1) << "No tilings loaded from " << options.block_cache_path << "\n";
+        return;
+    }
+    uint64_t key;
+    size_t num_tilings, dimensions;
+    while (in >> key >> num_tilings >> dimensions) {
+        Tilings tilings(num_tilings, std::vector<int64_t>(dimensions));
+        for (auto &t : tilings) {
+            for (int64_t &s : t) {
+                in >> s;
+            }
+        }
+        if (!in) {
+            break;
+        }
+        stored_tilings[key] = std::move(tilings);
+    }
+    aslog(1) << "Loaded tilings for " << stored_tilings.size() << " loop shapes from " << options.block_cache_path << "\n";
+}
+
+void Cache::save_tilings() const {
+    if (options.block_cache_path.empty() || new_tilings.empty()) {
+        return;
+    }
+
+    std::map<uint64_t, Tilings> all = stored_tilings;
+    all.insert(new_tilings.begin(), new_tilings.end());
+
+    // Write to a temporary file and rename it into place, so that
+    // concurrent searches never see a partially-written file.
+    std::string tmp_path = options.block_cache_path + ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream out(tmp_path);
+        out << "adams2019_tilings 1\n";
+        for (const auto &it : all) {
+            size_t dimensions = it.second.empty() ? 0 : it.second[0].size();
+            out << it.first << " " << it.second.size() << " " << dimensions;
+            for (const auto &t : it.second) {
+                for (int64_t s : t) {
+                    out << " " << s;
+                }
+            }
+            out << "\n";
+        }
+        if (!out) {
+            out.close();
+            std::remove(tmp_path.c_str());
+            aslog(1) << "Unable to write tilings to " << tmp_path << "\n";
+            return;
+        }
+    }
+    if (std::rename(tmp_path.c_str(), options.block_cache_path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        aslog(1) << "Unable to write tilings to " << options.block_cache_path << "\n";
+        return;
     }
+    aslog(1) << "Saved tilings for " << all.size() << " loop shapes to " << options.block_cache_path << "\n";
 }
 
 }  // namespace Autoscheduler
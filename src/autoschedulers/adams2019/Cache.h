@@ -9,6 +9,13 @@
 #include "LoopNest.h"
 #include "PerfectHashMap.h"
 
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace Halide {
 namespace Internal {
 namespace Autoscheduler {
@@ -64,6 +71,17 @@ namespace Autoscheduler {
     Cache::add_memoized_blocks below (and in Cache.cpp).
     Additionally, if a tiling has not been cached, and it is not pruned, then the tiling will be
     cached using Cache::memoize_blocks (see below and in Cache.cpp).
+
+  If a block_cache_path is given, the tilings generated for parallelizing a Func are also saved
+  in that file, keyed by the shape of the Func's loops rather than by the Func itself, so that later
+  runs, and other pipelines containing Funcs of the same shape, can skip enumerating them (see
+  Cache::find_stored_tilings). Only the tilings are shared, not the resulting LoopNests or their
+  features, as those refer to the Funcs of one particular pipeline.
+
+  The states of the beam are expanded in parallel, so both caches hold back the entries made while
+  the beam is being expanded, and add them in a fixed order once the whole beam is done (see
+  Cache::commit_memoized_blocks and FeatureCacheUpdates in LoopNest.h). Each state only sees the
+  entries made by earlier rounds and by itself, which keeps the search deterministic.
 */
 
 struct State;
@@ -72,15 +90,18 @@ struct State;
 Object stores caching options for autoscheduling.
 cache_blocks: decides if tilings are cached for decisions related to parallelizing the loops of a Func.
 cache_features: decides if LoopNest::compute_features will cache / will use cached featurizations.
+block_cache_path: if non-empty, the file tilings are shared through across runs and pipelines.
 */
 struct CachingOptions {
     bool cache_blocks = false;
     bool cache_features = false;
+    std::string block_cache_path;
 
     static CachingOptions MakeOptionsFromParams(const Adams2019Params &params) {
         CachingOptions options;
         options.cache_blocks = params.disable_memoized_blocks == 0;
         options.cache_features = params.disable_memoized_features == 0;
+        options.block_cache_path = params.block_cache_path;
         return options;
     }
 };
@@ -95,8 +116,25 @@ struct Cache {
     CachingOptions options;
     BlockCache memoized_compute_root_blocks;
 
-    mutable size_t cache_hits = 0;
-    mutable size_t cache_misses = 0;
+    mutable std::atomic<size_t> cache_hits{0};
+    size_t cache_misses = 0;
+
+    // Blocks memoized while expanding the beam, by the state that
+    // found them, waiting for commit_memoized_blocks.
+    struct PendingBlocks {
+        const FunctionDAG::Node *node;
+        int vector_dim;
+        std::vector<IntrusivePtr<const LoopNest>> blocks;
+    };
+    std::mutex pending_blocks_mutex;
+    std::map<const State *, std::vector<PendingBlocks>> pending_blocks;
+
+    // Tilings read from options.block_cache_path, and tilings found
+    // during this search, by tilings_key. Tilings found while expanding
+    // the beam wait in pending_tilings for commit_memoized_blocks.
+    using Tilings = std::vector<std::vector<int64_t>>;
+    std::map<uint64_t, Tilings> stored_tilings, new_tilings;
+    std::map<const State *, std::vector<std::pair<uint64_t, Tilings>>> pending_tilings;
 
     Cache() = delete;
     Cache(const CachingOptions &_options, size_t nodes_size)
@@ -104,6 +142,9 @@ struct Cache {
         if (options.cache_blocks) {
             memoized_compute_root_blocks.make_large(nodes_size);
         }
+        if (!options.block_cache_path.empty()) {
+            load_tilings();
+        }
     }
 
     ~Cache() = default;
@@ -120,7 +161,32 @@ struct Cache {
                              CostModel *cost_model) const;
 
     // Generate tilings for a specific vector dimension and memoize them.
-    void memoize_blocks(const FunctionDAG::Node *node, LoopNest *new_root);
+    // They are not used until commit_memoized_blocks is called.
+    void memoize_blocks(const State *state, const FunctionDAG::Node *node, LoopNest *new_root);
+
+    // Add the blocks memoized since the last call, taking the states
+    // that found them in the given order. As when expanding states
+    // one at a time, only the first state to tile a given Func and
+    // vector dimension gets its tilings memoized.
+    void commit_memoized_blocks(const std::vector<IntrusivePtr<State>> &states);
+
+    // Key the tilings for parallelizing a Func just computed at root by
+    // the shape of its loops (and the parallelism), and not by which Func
+    // it is, so that Funcs of the same shape can share them.
+    uint64_t tilings_key(const State *state, const FunctionDAG::Node *node, const Adams2019Params &params) const;
+
+    // Return the tilings stored for the given key by an earlier run, or
+    // nullptr if there are none (or they don't have the given number of
+    // dimensions).
+    const Tilings *find_stored_tilings(uint64_t key, size_t dimensions) const;
+
+    // Remember the tilings accepted by a state, to be added to
+    // new_tilings by commit_memoized_blocks.
+    void store_tilings(const State *state, uint64_t key, Tilings tilings);
+
+    // Read and write the tilings in options.block_cache_path.
+    void load_tilings();
+    void save_tilings() const;
 };
 
 }  // namespace Autoscheduler
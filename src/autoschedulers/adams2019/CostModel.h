@@ -53,6 +53,33 @@ struct Adams2019Params {
     /** If >= 0, only consider schedules that allocate at most this much memory (measured in bytes).
      * Formerly HL_AUTOSCHEDULE_MEMORY_LIMIT */
     int64_t memory_limit = -1;
+
+    /** Number of threads to expand the states of the beam on. If 0, use
+     * one per core. The schedule found doesn't depend on it. */
+    int search_threads = 0;
+
+    /** If set, the tilings chosen when parallelizing each Func are read
+     * from this file before the search, and added to it afterwards. Funcs
+     * with the same loop shape, in later runs or in other pipelines, then
+     * reuse those tilings instead of enumerating them again. */
+    std::string block_cache_path;
+
+    /** If > 0, the number of seconds the search may take. When it runs
+     * out, the best complete schedule found so far is returned. If no
+     * pass has finished yet, the current one is completed greedily. */
+    double time_limit = 0;
+
+    /** The most states the cost model evaluates in one batch. Larger
+     * batches spread the per-batch work on the pipeline features over
+     * more states, and give inference more parallelism. */
+    int cost_model_batch_size = 1024;
+
+    /** If > 0, a fixed post-pass over the best schedule found makes each
+     * stage prefetch the compute_root Funcs it reads this many iterations
+     * ahead of its innermost serial loop. This is not a search decision:
+     * the distance is used as given, the cost model has no feature for
+     * it, and it does not affect which schedule is chosen. */
+    int prefetch_distance = 0;
 };
 
 }  // namespace Autoscheduler
@@ -79,6 +79,8 @@ void DefaultCostModel::set_pipeline_features(const Internal::Autoscheduler::Func
     pipeline_feat_queue = pipeline_features;
     internal_assert(params.parallelism > 0);
     num_cores = params.parallelism;
+    internal_assert(params.cost_model_batch_size > 0);
+    max_batch_size = params.cost_model_batch_size;
 }
 
 void DefaultCostModel::set_pipeline_features(const Runtime::Buffer<float> &pipeline_feats, int n) {
@@ -142,13 +144,13 @@ void DefaultCostModel::enqueue(int ns, Runtime::Buffer<float> *schedule_feats, d
         << "schedule features has more stages (" << num_stages
         << ") than pipeline features (" << max_num_stages << ")\n";
 
-    const int batch_size = 1024;
+    const int batch_size = max_batch_size;
     if (!schedule_feat_queue.data() ||
+        schedule_feat_queue.dim(0).extent() != batch_size ||
         schedule_feat_queue.dim(2).extent() < max_num_stages) {
         internal_assert(cursor == 0);
         schedule_feat_queue = Runtime::Buffer<float>(batch_size, head2_w, max_num_stages);
-        if (!costs.data()) {
-            internal_assert(!cost_ptrs.data());
+        if (!costs.data() || costs.dim(0).extent() != batch_size) {
             costs = Runtime::Buffer<float>(batch_size);
             cost_ptrs = Runtime::Buffer<double *>(batch_size);
         }
@@ -19,6 +19,7 @@ private:
     Runtime::Buffer<float> schedule_feat_queue, pipeline_feat_queue, costs;
     Runtime::Buffer<double *> cost_ptrs;
     int cursor, num_stages, num_cores;
+    int max_batch_size = 1024;
 
     const std::string weights_in_path, weights_out_path;
     const bool randomize_weights;
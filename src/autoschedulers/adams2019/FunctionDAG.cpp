@@ -379,6 +379,7 @@ void BoundContents::Layout::allocate_some_more() const {
 }
 
 BoundContents *BoundContents::Layout::make() const {
+    std::lock_guard<std::mutex> lock(mutex);
     if (pool.empty()) {
         allocate_some_more();
     }
@@ -391,6 +392,7 @@ BoundContents *BoundContents::Layout::make() const {
 void BoundContents::Layout::release(const BoundContents *b) const {
     internal_assert(b->layout == this) << "Releasing BoundContents onto the wrong pool!";
     b->~BoundContents();
+    std::lock_guard<std::mutex> lock(mutex);
     pool.push_back(const_cast<BoundContents *>(b));
     num_live--;
 }
@@ -575,6 +577,9 @@ bool depends_on_estimate(const Expr &expr) {
 FunctionDAG::FunctionDAG(const vector<Function> &outputs, const Target &target) {
     map<string, Function> env = build_environment(outputs);
 
+    // The same bounds queries are made for many stages and edges.
+    BoundsQueryCache bounds_cache;
+
     // A mutator to apply parameter estimates to the expressions
     // we encounter while constructing the graph.
     class ApplyParamEstimates : public IRMutator {
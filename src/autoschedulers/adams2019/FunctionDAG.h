@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <map>
+#include <mutex>
 #include <string>
 #include <utility>
 
@@ -319,9 +320,12 @@ struct BoundContents {
     // We're frequently going to need to make these concrete bounds
     // arrays.  It makes things more efficient if we figure out the
     // memory layout of those data structures once ahead of time, and
-    // make each individual instance just use that. Note that this is
-    // not thread-safe.
+    // make each individual instance just use that. Objects may be made
+    // and released from several threads at once.
     class Layout {
+        // Guards the pool, the blocks, and num_live
+        mutable std::mutex mutex;
+
         // A memory pool of free BoundContent objects with this layout
         mutable std::vector<BoundContents *> pool;
 
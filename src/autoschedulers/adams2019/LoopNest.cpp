@@ -13,6 +13,14 @@ namespace Autoscheduler {
 // registers.
 const int kUnrollLimit = 12;
 
+namespace {
+
+// The FeatureCacheUpdates collecting the feature cache updates made on
+// this thread, if any.
+thread_local FeatureCacheUpdates *active_feature_cache_updates = nullptr;
+
+}  // namespace
+
 // Given a multi-dimensional box of dimensionality d, generate a list
 // of candidate tile sizes for it, logarithmically spacing the sizes
 // using the given factor. If 'allow_splits' is false, every dimension
@@ -113,7 +121,10 @@ void LoopNest::copy_from(const LoopNest &n) {
     children = n.children;
     inlined = n.inlined;
     store_at = n.store_at;
-    bounds = n.bounds;
+    {
+        std::lock_guard<std::mutex> lock(n.bounds_mutex);
+        bounds = n.bounds;
+    }
     node = n.node;
     stage = n.stage;
     innermost = n.innermost;
@@ -316,8 +327,8 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 
             if (use_cached_features) {
                 // Checks if the features cache has seen this state before, and use the cached features if so.
-                if (c->features_cache.count(hash_of_producers) > 0) {
-                    const auto &entry = c->features_cache.at(hash_of_producers);
+                if (const auto *cached = c->find_cached_features(hash_of_producers)) {
+                    const auto &entry = *cached;
 
                     for (auto it = entry.begin(); it != entry.end(); it++) {
                         const auto *stage_ptr = it.key();
@@ -341,8 +352,7 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 
             if (use_cached_features) {
                 // Cache these features for future reference.
-                c->features_cache[hash_of_producers].make_large(dag.nodes[0].stages[0].max_id);
-                c->memoize_features(c->features_cache[hash_of_producers], features);
+                c->cache_features(hash_of_producers, dag.nodes[0].stages[0].max_id, features);
             }
         }
 
@@ -425,9 +435,7 @@ void LoopNest::compute_features(const FunctionDAG &dag,
                 // may not have been computed when it is accessed as a memoized
                 // feature. We memoize 'points_computed_minimum' here to ensure
                 // its value is always available
-                if (c->features_cache.count(hash_of_producers) > 0) {
-                    c->memoize_points_computed_minimum(c->features_cache[hash_of_producers], features);
-                }
+                c->cache_points_computed_minimum(hash_of_producers, features);
             }
             recompute_inlined_features(sites, features);
         }
@@ -1000,7 +1008,7 @@ void LoopNest::compute_features(const FunctionDAG &dag,
         if (use_cached_features) {
             const auto &block = sites.get(stage).task;
             uint64_t hash_of_producers = sites.get(block->stage).hash_of_producers_stored_at_root;
-            auto &intermediate_map = block->feature_intermediates_cache[hash_of_producers].get_or_create(&(f->stages[0]));
+            auto &intermediate_map = block->cached_feature_intermediates_for_update(hash_of_producers).get_or_create(&(f->stages[0]));
             auto &intermediate = intermediate_map.get_or_create(stage);
 
             intermediate.inlined_calls = it.value() * subinstances;
@@ -1014,13 +1022,18 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 // Get the region required of a Func at this site, from which we
 // know what region would be computed if it were scheduled here,
 // and what its loop nest would be.
-const Bound &LoopNest::get_bounds(const FunctionDAG::Node *f) const {
-    if (bounds.contains(f)) {
-        const Bound &b = bounds.get(f);
-        // Expensive validation for debugging
-        // b->validate();
-        return b;
-    }
+Bound LoopNest::get_bounds(const FunctionDAG::Node *f) const {
+    {
+        std::lock_guard<std::mutex> lock(bounds_mutex);
+        if (bounds.contains(f)) {
+            const Bound &b = bounds.get(f);
+            // Expensive validation for debugging
+            // b->validate();
+            return b;
+        }
+    }
+    // If another thread gets here first for the same Func, it computes
+    // the same bounds, so it doesn't matter whose we end up keeping.
     auto *bound = f->make_bound();
 
     // Compute the region required
@@ -1070,7 +1083,7 @@ const Bound &LoopNest::get_bounds(const FunctionDAG::Node *f) const {
         f->loop_nest_for_region(i, &(bound->region_computed(0)), &(bound->loops(i, 0)));
     }
 
-    const Bound &b = set_bounds(f, bound);
+    Bound b = set_bounds(f, bound);
     // Validation is expensive, turn if off by default.
     // b->validate();
     return b;
@@ -1770,6 +1783,7 @@ void LoopNest::apply(LoopLevel here,
                     state.schedule_source
                         << "\n    .vectorize(" << v.var.name() << ")";
                     s.vectorize(v.var);
+                    v.vectorized = true;
                 }
             } else {
                 // Grab the innermost loop for this node
@@ -1878,6 +1892,7 @@ void LoopNest::apply(LoopLevel here,
                         for (size_t i = 0; i < symbolic_loop.size(); i++) {
                             if (state.vars[i].pure && state.vars[i].exists && state.vars[i].extent > 1) {
                                 s.unroll(state.vars[i].var);
+                                state.vars[i].unrolled = true;
                                 state.schedule_source << "\n    .unroll(" << state.vars[i].var.name() << ")";
                             }
                         }
@@ -1946,35 +1961,131 @@ void LoopNest::apply(LoopLevel here,
 }
 
 void LoopNest::copy_from_including_features(const LoopNest &n) {
-    size = n.size;
-    children = n.children;
-    inlined = n.inlined;
-    store_at = n.store_at;
-    bounds = n.bounds;
-    node = n.node;
-    stage = n.stage;
-    innermost = n.innermost;
-    tileable = n.tileable;
-    parallel = n.parallel;
-    vector_dim = n.vector_dim;
-    vectorized_loop_index = n.vectorized_loop_index;
+    copy_from(n);
     features_cache = n.features_cache;
     feature_intermediates_cache = n.feature_intermediates_cache;
+
+    // This LoopNest is new, so it's fine to write the pending updates
+    // to n straight into its caches.
+    FeatureCacheUpdates *updates = active_feature_cache_updates;
+    if (updates) {
+        const FeatureCacheUpdates::Key first{&n, 0};
+        for (auto it = updates->features.lower_bound(first);
+             it != updates->features.end() && it->first.first == &n; it++) {
+            features_cache[it->first.second] = it->second.value;
+        }
+        for (auto it = updates->intermediates.lower_bound(first);
+             it != updates->intermediates.end() && it->first.first == &n; it++) {
+            feature_intermediates_cache[it->first.second] = it->second.value;
+        }
+        for (auto it = updates->points_computed_minimum.lower_bound(first);
+             it != updates->points_computed_minimum.end() && it->first.first == &n; it++) {
+            auto &entry = features_cache[it->first.second];
+            for (const auto &p : it->second.value) {
+                entry.get(p.first).points_computed_minimum = p.second;
+            }
+        }
+    }
 }
 
-void LoopNest::memoize_points_computed_minimum(StageMap<ScheduleFeatures> &memoized_features, const StageMap<ScheduleFeatures> *features) const {
+const StageMap<ScheduleFeatures> *LoopNest::find_cached_features(uint64_t hash_of_producers) const {
+    if (FeatureCacheUpdates *updates = active_feature_cache_updates) {
+        auto it = updates->features.find({this, hash_of_producers});
+        if (it != updates->features.end()) {
+            return &(it->second.value);
+        }
+    }
+    auto it = features_cache.find(hash_of_producers);
+    return it == features_cache.end() ? nullptr : &(it->second);
+}
+
+void LoopNest::cache_features(uint64_t hash_of_producers, int num_stages,
+                              const StageMap<ScheduleFeatures> *features) const {
+    StageMap<ScheduleFeatures> *entry;
+    if (FeatureCacheUpdates *updates = active_feature_cache_updates) {
+        auto &update = updates->features[{this, hash_of_producers}];
+        update.loop_nest = this;
+        entry = &(update.value);
+    } else {
+        entry = &(features_cache[hash_of_producers]);
+    }
+    entry->make_large(num_stages);
+    memoize_features(*entry, features);
+}
+
+void LoopNest::cache_points_computed_minimum(uint64_t hash_of_producers,
+                                             const StageMap<ScheduleFeatures> *features) const {
+    FeatureCacheUpdates *updates = active_feature_cache_updates;
+    if (updates) {
+        auto it = updates->features.find({this, hash_of_producers});
+        if (it != updates->features.end()) {
+            memoize_points_computed_minimum(it->second.value, features);
+            return;
+        }
+    }
+    auto it = features_cache.find(hash_of_producers);
+    if (it == features_cache.end()) {
+        return;
+    }
+    if (updates) {
+        // Record just the pcm rather than copying the whole entry.
+        auto &update = updates->points_computed_minimum[{this, hash_of_producers}];
+        update.loop_nest = this;
+        update.value.clear();
+        collect_points_computed_minimum(update.value, features);
+    } else {
+        memoize_points_computed_minimum(it->second, features);
+    }
+}
+
+const StageMap<StageMap<FeatureIntermediates>> *LoopNest::find_cached_feature_intermediates(uint64_t hash_of_producers) const {
+    if (FeatureCacheUpdates *updates = active_feature_cache_updates) {
+        auto it = updates->intermediates.find({this, hash_of_producers});
+        if (it != updates->intermediates.end()) {
+            return &(it->second.value);
+        }
+    }
+    auto it = feature_intermediates_cache.find(hash_of_producers);
+    return it == feature_intermediates_cache.end() ? nullptr : &(it->second);
+}
+
+StageMap<StageMap<FeatureIntermediates>> &LoopNest::cached_feature_intermediates_for_update(uint64_t hash_of_producers) const {
+    FeatureCacheUpdates *updates = active_feature_cache_updates;
+    if (!updates) {
+        return feature_intermediates_cache[hash_of_producers];
+    }
+    auto [it, inserted] = updates->intermediates.try_emplace({this, hash_of_producers});
+    if (inserted) {
+        it->second.loop_nest = this;
+        auto existing = feature_intermediates_cache.find(hash_of_producers);
+        if (existing != feature_intermediates_cache.end()) {
+            it->second.value = existing->second;
+        }
+    }
+    return it->second.value;
+}
+
+void LoopNest::collect_points_computed_minimum(std::vector<std::pair<const FunctionDAG::Node::Stage *, double>> &pcm,
+                                               const StageMap<ScheduleFeatures> *features) const {
     for (auto it = inlined.begin(); it != inlined.end(); it++) {
         const auto *node = it.key();
         const auto *stage_ptr = &(node->stages[0]);
-        const auto &inlined_feat = features->get(stage_ptr);
-        // Save pcm into memoized_features.
-        memoized_features.get(stage_ptr).points_computed_minimum = inlined_feat.points_computed_minimum;
+        pcm.emplace_back(stage_ptr, features->get(stage_ptr).points_computed_minimum);
     }
 
-    memoized_features.get(stage).points_computed_minimum = features->get(stage).points_computed_minimum;
+    pcm.emplace_back(stage, features->get(stage).points_computed_minimum);
 
     for (const auto &c : children) {
-        c->memoize_points_computed_minimum(memoized_features, features);
+        c->collect_points_computed_minimum(pcm, features);
+    }
+}
+
+void LoopNest::memoize_points_computed_minimum(StageMap<ScheduleFeatures> &memoized_features, const StageMap<ScheduleFeatures> *features) const {
+    std::vector<std::pair<const FunctionDAG::Node::Stage *, double>> pcm;
+    collect_points_computed_minimum(pcm, features);
+    // Save pcm into memoized_features.
+    for (const auto &p : pcm) {
+        memoized_features.get(p.first).points_computed_minimum = p.second;
     }
 }
 
@@ -2033,9 +2144,10 @@ void LoopNest::recompute_inlined_features(const StageMap<Sites> &sites, StageMap
         internal_assert(sites.contains(block->stage));
         uint64_t hash_of_producers = sites.get(block->stage).hash_of_producers_stored_at_root;
 
-        internal_assert(block->feature_intermediates_cache.count(hash_of_producers) > 0);
-        auto &intermediate_map = block->feature_intermediates_cache[hash_of_producers].get(&(f->stages[0]));
-        auto &intermediate = intermediate_map.get(stage);
+        const auto *cached = block->find_cached_feature_intermediates(hash_of_producers);
+        internal_assert(cached);
+        const auto &intermediate_map = cached->get(&(f->stages[0]));
+        const auto &intermediate = intermediate_map.get(stage);
 
         auto &inlined_feat = features->get(&(f->stages[0]));
         inlined_feat.inlined_calls += intermediate.inlined_calls;
@@ -2168,6 +2280,34 @@ void compute_loop_nest_parents(map<const LoopNest *, pair<const LoopNest *, int>
     }
 }
 
+FeatureCacheUpdates::Scope::Scope(FeatureCacheUpdates *updates)
+    : old(active_feature_cache_updates) {
+    active_feature_cache_updates = updates;
+}
+
+FeatureCacheUpdates::Scope::~Scope() {
+    active_feature_cache_updates = old;
+}
+
+void FeatureCacheUpdates::commit() {
+    internal_assert(active_feature_cache_updates != this);
+    for (auto &it : features) {
+        it.second.loop_nest->features_cache[it.first.second] = std::move(it.second.value);
+    }
+    for (auto &it : intermediates) {
+        it.second.loop_nest->feature_intermediates_cache[it.first.second] = std::move(it.second.value);
+    }
+    for (const auto &it : points_computed_minimum) {
+        auto &entry = it.second.loop_nest->features_cache[it.first.second];
+        for (const auto &p : it.second.value) {
+            entry.get(p.first).points_computed_minimum = p.second;
+        }
+    }
+    features.clear();
+    intermediates.clear();
+    points_computed_minimum.clear();
+}
+
 }  // namespace Autoscheduler
 }  // namespace Internal
 }  // namespace Halide
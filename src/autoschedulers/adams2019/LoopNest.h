@@ -9,6 +9,7 @@
 #include "FunctionDAG.h"
 #include "PerfectHashMap.h"
 #include <map>
+#include <mutex>
 #include <set>
 #include <utility>
 #include <vector>
@@ -53,6 +54,10 @@ struct LoopNest {
     // little boxes to the left of the loop nest tree figures.
     mutable NodeMap<Bound> bounds;
 
+    // Guards 'bounds'. LoopNests are shared between states, and the
+    // states of a beam are expanded in parallel.
+    mutable std::mutex bounds_mutex;
+
     // The Func this loop nest belongs to
     const FunctionDAG::Node *node = nullptr;
 
@@ -145,14 +150,15 @@ struct LoopNest {
     }
 
     // Set the region required of a Func at this site.
-    const Bound &set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
+    Bound set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
+        std::lock_guard<std::mutex> lock(bounds_mutex);
         return bounds.emplace(f, b);
     }
 
     // Get the region required of a Func at this site, from which we
     // know what region would be computed if it were scheduled here,
     // and what its loop nest would be.
-    const Bound &get_bounds(const FunctionDAG::Node *f) const;
+    Bound get_bounds(const FunctionDAG::Node *f) const;
 
     // Recursively print a loop nest representation to stderr
     void dump(std::ostream &os, string prefix, const LoopNest *parent) const;
@@ -240,7 +246,9 @@ struct LoopNest {
                  parallel = false,
                  exists = false,
                  pure = false,
-                 constant_extent = false;
+                 constant_extent = false,
+                 vectorized = false,
+                 unrolled = false;
             FuncVar()
                 : orig(Var()), var(Var()) {
             }
@@ -260,15 +268,40 @@ struct LoopNest {
                const LoopNest *parent,
                const LoopNest *compute_site) const;
 
-    // The below are two feature caches.
+    // The below are two feature caches. Use the accessors below
+    // rather than touching them directly, so that updates go to the
+    // FeatureCacheUpdates active on this thread, if any.
     // hash of producers -> StageMap
     mutable std::map<uint64_t, StageMap<StageMap<FeatureIntermediates>>> feature_intermediates_cache;
     // hash of producers -> StageMap
     mutable std::map<uint64_t, StageMap<ScheduleFeatures>> features_cache;
 
+    // Look up the cached features for the given hash of producers, or nullptr.
+    const StageMap<ScheduleFeatures> *find_cached_features(uint64_t hash_of_producers) const;
+
+    // Cache the features of this LoopNest for the given hash of producers.
+    void cache_features(uint64_t hash_of_producers, int num_stages,
+                        const StageMap<ScheduleFeatures> *features) const;
+
+    // Update the pcm of the inlined funcs in the cached features for
+    // the given hash of producers, if there are any.
+    void cache_points_computed_minimum(uint64_t hash_of_producers,
+                                       const StageMap<ScheduleFeatures> *features) const;
+
+    // Look up the cached intermediates for the given hash of producers, or nullptr.
+    const StageMap<StageMap<FeatureIntermediates>> *find_cached_feature_intermediates(uint64_t hash_of_producers) const;
+
+    // Get the cached intermediates for the given hash of producers
+    // to fill in, creating them if need be.
+    StageMap<StageMap<FeatureIntermediates>> &cached_feature_intermediates_for_update(uint64_t hash_of_producers) const;
+
     // Same as copy_from (above) but also copies the two caches.
     void copy_from_including_features(const LoopNest &n);
 
+    // Loops through inlined funcs and collects the pcm found in features.
+    void collect_points_computed_minimum(std::vector<std::pair<const FunctionDAG::Node::Stage *, double>> &pcm,
+                                         const StageMap<ScheduleFeatures> *features) const;
+
     // Loops through inlined funcs and caches the pcm found in features, into memoized_features.
     void memoize_points_computed_minimum(StageMap<ScheduleFeatures> &memoized_features,
                                          const StageMap<ScheduleFeatures> *features) const;
@@ -295,6 +328,48 @@ struct LoopNest {
     void collect_stages(std::set<const FunctionDAG::Node::Stage *> &stages) const;
 };
 
+// While the states of a beam are being expanded in parallel, the
+// feature caches of the LoopNests they share are left alone. The
+// entries a thread would have added or updated are collected in the
+// FeatureCacheUpdates active on that thread instead, and only become
+// visible to other threads once committed. Committing the updates in
+// a fixed order keeps the search from depending on how the states
+// were spread across threads.
+class FeatureCacheUpdates {
+    using Key = std::pair<const LoopNest *, uint64_t>;
+
+    template<typename T>
+    struct Update {
+        // Keeps the LoopNest alive until the update is committed.
+        IntrusivePtr<const LoopNest> loop_nest;
+        T value;
+    };
+
+    std::map<Key, Update<StageMap<ScheduleFeatures>>> features;
+    std::map<Key, Update<StageMap<StageMap<FeatureIntermediates>>>> intermediates;
+    std::map<Key, Update<std::vector<std::pair<const FunctionDAG::Node::Stage *, double>>>> points_computed_minimum;
+
+    friend struct LoopNest;
+
+public:
+    // Collect the feature cache updates made on this thread in the
+    // given object for the lifetime of the Scope.
+    class Scope {
+        FeatureCacheUpdates *old;
+
+    public:
+        explicit Scope(FeatureCacheUpdates *updates);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        void operator=(const Scope &) = delete;
+    };
+
+    // Apply the updates to the caches. Must not run concurrently with
+    // any featurization.
+    void commit();
+};
+
 // Find the deepest common ancestor of `a` and `b`.
 // `parents` is a map from loop nest to (parent, depth) tuples.
 // Assumes that `a` and `b` are found in `parents`, otherwise errors.
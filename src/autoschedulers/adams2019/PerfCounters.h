@@ -0,0 +1,126 @@
+#ifndef ADAMS2019_PERF_COUNTERS_H
+#define ADAMS2019_PERF_COUNTERS_H
+
+// Hardware performance counters for benchmarked samples, read with
+// perf_event_open on Linux. The Halide runtime runs a pipeline on a pool
+// of long-lived threads, so per-thread counters would miss most of the
+// work; instead the events are counted on every CPU while the benchmark
+// runs. This needs /proc/sys/kernel/perf_event_paranoid to be at most 0
+// (or CAP_PERFMON), and is only meaningful on an otherwise idle machine
+// running one benchmark at a time. On other platforms the counters are
+// never available.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Halide {
+namespace Internal {
+namespace Autoscheduler {
+
+class PerfCounters {
+public:
+    // The names of the events, in the order returned by read().
+    static const std::vector<std::string> &names() {
+        static const std::vector<std::string> n = {
+            "instructions", "cycles", "llc_references", "llc_misses"};
+        return n;
+    }
+
+    PerfCounters() {
+#ifdef __linux__
+        const uint64_t events[] = {PERF_COUNT_HW_INSTRUCTIONS,
+                                   PERF_COUNT_HW_CPU_CYCLES,
+                                   PERF_COUNT_HW_CACHE_REFERENCES,
+                                   PERF_COUNT_HW_CACHE_MISSES};
+        const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        for (uint64_t event : events) {
+            for (long cpu = 0; cpu < num_cpus; cpu++) {
+                perf_event_attr attr;
+                memset(&attr, 0, sizeof(attr));
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = event;
+                attr.disabled = 1;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                int fd = (int)syscall(__NR_perf_event_open, &attr, -1, (int)cpu, -1, 0);
+                if (fd < 0) {
+                    close_all();
+                    return;
+                }
+                fds.push_back(fd);
+            }
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+        close_all();
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool available() const {
+        return !fds.empty();
+    }
+
+    void start() {
+#ifdef __linux__
+        for (int fd : fds) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    void stop() {
+#ifdef __linux__
+        for (int fd : fds) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+#endif
+    }
+
+    // The totals of each event over all CPUs since the last start().
+    std::vector<uint64_t> read() const {
+        std::vector<uint64_t> totals(names().size(), 0);
+#ifdef __linux__
+        for (size_t i = 0; i < fds.size(); i++) {
+            uint64_t count = 0;
+            if (::read(fds[i], &count, sizeof(count)) == sizeof(count)) {
+                totals[i * totals.size() / fds.size()] += count;
+            }
+        }
+#endif
+        return totals;
+    }
+
+private:
+    // One file descriptor per event per CPU, grouped by event.
+    std::vector<int> fds;
+
+    void close_all() {
+#ifdef __linux__
+        for (int fd : fds) {
+            close(fd);
+        }
+#endif
+        fds.clear();
+    }
+};
+
+}  // namespace Autoscheduler
+}  // namespace Internal
+}  // namespace Halide
+
+#endif  // ADAMS2019_PERF_COUNTERS_H
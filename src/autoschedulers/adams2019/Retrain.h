@@ -0,0 +1,89 @@
+#ifndef ADAMS2019_RETRAIN_H
+#define ADAMS2019_RETRAIN_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DefaultCostModel.h"
+#include "HalideBuffer.h"
+
+namespace Halide {
+namespace Internal {
+namespace Autoscheduler {
+
+constexpr int kModels = 1;
+
+struct Sample {
+    std::vector<float> runtimes;  // in msec
+    double prediction[kModels];
+    std::string filename;
+    int32_t schedule_id;
+    Runtime::Buffer<float> schedule_features;
+    // Hardware event counts per run, from the .counters file next to the
+    // sample, if there is one.
+    std::map<std::string, double> counters;
+};
+
+struct PipelineSample {
+    int32_t pipeline_id;
+    int32_t num_stages;
+    Runtime::Buffer<float> pipeline_features;
+    std::map<uint64_t, Sample> schedules;
+    uint64_t fastest_schedule_hash;
+    float fastest_runtime;  // in msec
+    uint64_t pipeline_hash;
+};
+
+// The benchmarked samples seen so far, grouped by pipeline. Samples can
+// be added incrementally, so that a long-running autotuner can retrain
+// on everything it has measured without rereading old sample files.
+class SampleSet {
+    std::vector<float> scratch;
+
+    int best_schedule_id = -1;
+    float best_runtime = 1e20f;
+    std::string best_path;
+
+    size_t num_read = 0, num_unique = 0;
+
+public:
+    std::map<int, PipelineSample> pipelines;
+
+    // Add the sample in a .sample file (a featurization followed by a
+    // runtime, a pipeline id, and a schedule id). Truncated or
+    // implausible samples are skipped with a warning. Any hardware
+    // performance counters in a .counters file of the same name are
+    // kept along with the sample.
+    void add(const std::string &path);
+
+    // Print the noise level of each pipeline and the best sample seen. If
+    // the paths are non-empty, also write the best benchmark to
+    // best_benchmark_path, and copy the .schedule.h file next to the best
+    // sample to best_schedule_path.
+    void report(const std::string &best_benchmark_path,
+                const std::string &best_schedule_path) const;
+};
+
+struct RetrainOptions {
+    int epochs = 0;
+    std::vector<float> rates = {0.0001f};
+    int num_cores = 32;
+};
+
+// Train the models on the samples, saving the weights of the best one
+// after every epoch. If the samples have performance counters, the
+// prediction error on memory-bound samples (those with the most last-level
+// cache misses per instruction) is reported separately at the end. The samples are taken by value, as training moves
+// some pipelines into a validation set and may discard outliers.
+void retrain(const std::vector<std::unique_ptr<DefaultCostModel>> &models,
+             std::map<int, PipelineSample> samples,
+             const RetrainOptions &options);
+
+}  // namespace Autoscheduler
+}  // namespace Internal
+}  // namespace Halide
+
+#endif  // ADAMS2019_RETRAIN_H
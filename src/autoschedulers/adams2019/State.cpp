@@ -389,6 +389,70 @@ void State::generate_children(const FunctionDAG &dag,
                 return;  // successfully added cached states.
             }
 
+            // Make a child that parallelizes the Func using the given
+            // tiling. Returns whether the child was accepted.
+            auto parallelize_child = [&](const vector<int64_t> &tiling) {
+                auto child = make_child();
+                LoopNest *new_root = new LoopNest;
+                new_root->copy_from(*root);
+                for (auto &c : new_root->children) {
+                    if (c->node == node) {
+                        if (!params.disable_subtiling) {
+                            c = c->parallelize_in_tiles(params, tiling, new_root);
+                        } else {
+                            // We're emulating the old
+                            // autoscheduler for an ablation, so
+                            // emulate its parallelism strategy:
+                            // just keep parallelizing outer loops
+                            // until enough are parallel.
+                            vector<int64_t> emulated_tiling = c->size;
+                            int64_t total = 1;
+                            for (size_t i = c->size.size(); i > 0; i--) {
+                                if (!c->stage->loop[i - 1].pure || total >= params.parallelism) {
+                                    emulated_tiling[i - 1] = 1;
+                                }
+                                while (emulated_tiling[i - 1] > 1 &&
+                                       total * emulated_tiling[i - 1] > params.parallelism * 8) {
+                                    emulated_tiling[i - 1] /= 2;
+                                }
+                                total *= emulated_tiling[i - 1];
+                            }
+                            c = c->parallelize_in_tiles(params, emulated_tiling, new_root);
+                        }
+                    }
+                }
+                child->root = new_root;
+                child->num_decisions_made++;
+                if (child->calculate_cost(dag, params, cost_model, cache->options)) {
+                    num_children++;
+                    accept_child(std::move(child));
+                    // Will early return if block caching is not enabled.
+                    cache->memoize_blocks(this, node, new_root);
+                    return true;
+                }
+                return false;
+            };
+
+            // Reuse the tilings found for a Func of the same shape by an
+            // earlier run, possibly of another pipeline.
+            const bool share_tilings = !cache->options.block_cache_path.empty() && !params.disable_subtiling;
+            const uint64_t tilings_key = share_tilings ? cache->tilings_key(this, node, params) : 0;
+            const Cache::Tilings *stored_tilings =
+                share_tilings ? cache->find_stored_tilings(tilings_key, pure_size->size()) : nullptr;
+            if (stored_tilings) {
+                if (stored_tilings->empty()) {
+                    num_children++;
+                    auto child = make_child();
+                    child->num_decisions_made++;
+                    accept_child(std::move(child));
+                    return;
+                }
+                for (const auto &t : *stored_tilings) {
+                    parallelize_child(t);
+                }
+                return;
+            }
+
             // Generate some candidate parallel task shapes.
             auto tilings = generate_tilings(*pure_size, node->dimensions - 1, 2, true);
 
@@ -465,6 +529,9 @@ void State::generate_children(const FunctionDAG &dag,
             // parallelize. This tends to happen for things like
             // compute_root color matrices.
             if (options.empty()) {
+                if (share_tilings) {
+                    cache->store_tilings(this, tilings_key, {});
+                }
                 num_children++;
                 auto child = make_child();
                 child->num_decisions_made++;
@@ -472,6 +539,7 @@ void State::generate_children(const FunctionDAG &dag,
                 return;
             }
 
+            Cache::Tilings accepted;
             for (const auto &o : options) {
                 if (num_children >= 1 && (o.idle_core_wastage > 1.2 || params.disable_subtiling)) {
                     // We have considered several options, and the
@@ -479,44 +547,13 @@ void State::generate_children(const FunctionDAG &dag,
                     break;
                 }
 
-                auto child = make_child();
-                LoopNest *new_root = new LoopNest;
-                new_root->copy_from(*root);
-                for (auto &c : new_root->children) {
-                    if (c->node == node) {
-                        if (!params.disable_subtiling) {
-                            c = c->parallelize_in_tiles(params, o.tiling, new_root);
-                        } else {
-                            // We're emulating the old
-                            // autoscheduler for an ablation, so
-                            // emulate its parallelism strategy:
-                            // just keep parallelizing outer loops
-                            // until enough are parallel.
-                            vector<int64_t> tiling = c->size;
-                            int64_t total = 1;
-                            for (size_t i = c->size.size(); i > 0; i--) {
-                                if (!c->stage->loop[i - 1].pure || total >= params.parallelism) {
-                                    tiling[i - 1] = 1;
-                                }
-                                while (tiling[i - 1] > 1 &&
-                                       total * tiling[i - 1] > params.parallelism * 8) {
-                                    tiling[i - 1] /= 2;
-                                }
-                                total *= tiling[i - 1];
-                            }
-                            c = c->parallelize_in_tiles(params, tiling, new_root);
-                        }
-                    }
-                }
-                child->root = new_root;
-                child->num_decisions_made++;
-                if (child->calculate_cost(dag, params, cost_model, cache->options)) {
-                    num_children++;
-                    accept_child(std::move(child));
-                    // Will early return if block caching is not enabled.
-                    cache->memoize_blocks(node, new_root);
+                if (parallelize_child(o.tiling)) {
+                    accepted.push_back(o.tiling);
                 }
             }
+            if (share_tilings && !accepted.empty()) {
+                cache->store_tilings(this, tilings_key, std::move(accepted));
+            }
         }
     }
 
@@ -670,6 +707,39 @@ void State::apply_schedule(const FunctionDAG &dag, const Adams2019Params &params
             Func(p.first->node->func).reorder_storage(storage_vars);
         }
 
+        if (params.prefetch_distance > 0) {
+            // Prefetch at the innermost serial loop that isn't
+            // vectorized or unrolled. Only compute_root producers are
+            // prefetched, as they are allocated outside all loops. This
+            // runs on the final schedule only; the search never sees
+            // the prefetches.
+            const LoopNest::StageScheduleState::FuncVar *at = nullptr;
+            for (const auto &v : p.second->vars) {
+                if (v.exists && v.extent > 1 && !v.parallel && !v.vectorized && !v.unrolled) {
+                    at = &v;
+                    break;
+                }
+            }
+            for (const auto *e : p.first->incoming_edges) {
+                if (!at || e->producer->is_input) {
+                    continue;
+                }
+                bool compute_root = false;
+                for (const auto &c : root->children) {
+                    compute_root |= (c->node == e->producer);
+                }
+                if (!compute_root) {
+                    continue;
+                }
+                p.second->schedule_source
+                    << "\n    .prefetch(" << e->producer->func.name() << ", "
+                    << at->var.name() << ", " << at->var.name() << ", "
+                    << params.prefetch_distance << ", PrefetchBoundStrategy::NonFaulting)";
+                stage.prefetch(Func(e->producer->func), at->var, at->var,
+                               params.prefetch_distance, PrefetchBoundStrategy::NonFaulting);
+            }
+        }
+
         // Dump the schedule source string
         src << p.first->name
             << p.second->schedule_source.str()
@@ -9,6 +9,7 @@
 #include "Halide.h"
 #include "LoopNest.h"
 #include "PerfectHashMap.h"
+#include <atomic>
 #include <map>
 #include <utility>
 
@@ -37,7 +38,7 @@ struct State {
 
     // The number of times a cost is enqueued into the cost model,
     // for all states.
-    static int cost_calculations;
+    static std::atomic<int> cost_calculations;
 
     State() = default;
     State(const State &) = delete;
@@ -44,6 +44,20 @@ struct Timer {
     }
 };
 
+// A time limit on a search. It never passes if the limit is not positive.
+struct Deadline {
+    Timer timer;
+    double limit;  // in seconds
+
+    explicit Deadline(double limit)
+        : limit(limit) {
+    }
+
+    bool passed() const {
+        return limit > 0 && timer.elapsed().count() >= limit;
+    }
+};
+
 }  // namespace Autoscheduler
 }  // namespace Internal
 }  // namespace Halide
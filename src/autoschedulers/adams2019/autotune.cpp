@@ -0,0 +1,626 @@
+// An in-process version of adams2019_autotune_loop.sh. Link this with the
+// source of the Generator to autotune, in the same way as GenGen.cpp. Each
+// batch of samples is autoscheduled with randomized searches and
+// JIT-compiled in parallel, benchmarked in-process, and then used to
+// retrain the cost model before the next batch, without forking a
+// compiler or RunGen process per sample.
+//
+// With --perf_counters, each sample is also run again with hardware
+// performance counters enabled (see PerfCounters.h), and the counts per
+// run are written to a .counters file next to the .sample file.
+//
+// Usage:
+//   my_pipeline_autotune -g generator_name -p libautoschedule_adams2019.so
+//       -o samples_dir [--target=host] [--batch_size=32] [--num_batches=1]
+//       [--compile_threads=N] [--benchmark_slots=1] [--initial_weights=file]
+//       [--perf_counters]
+//       [generator_param=value ...] [autoscheduler.param=value ...]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Halide.h"
+#include "cmdline.h"
+#include "halide_benchmark.h"
+#include "halide_thread_pool.h"
+
+#include "DefaultCostModel.h"
+#include "PerfCounters.h"
+#include "Retrain.h"
+
+namespace {
+
+using namespace Halide;
+using namespace Halide::Internal::Autoscheduler;
+
+using Halide::Internal::AbstractGeneratorPtr;
+using Halide::Internal::ArgInfoDirection;
+using Halide::Internal::GeneratorRegistry;
+using std::map;
+using std::string;
+using std::vector;
+
+namespace fs = std::filesystem;
+
+struct Flags {
+    string generator_name;
+    string plugin_path;
+    string samples_dir;
+    string target;
+    string initial_weights_path;
+    int batch_size = 32;
+    int num_batches = 1;
+    int compile_threads = 0;
+    int benchmark_slots = 1;
+    double benchmark_min_time = 0.1;
+    bool perf_counters = false;
+    int epochs = 0;
+    vector<float> rates;
+    int num_cores = 32;
+    GeneratorParamsMap generator_params;
+    map<string, string> autoscheduler_params;
+
+    Flags(int argc, char **argv) {
+        cmdline::parser a;
+
+        const char *kNoDesc = "";
+
+        constexpr bool kOptional = false;
+        a.add<string>("generator", 'g');
+        a.add<string>("plugin", 'p');
+        a.add<string>("samples", 'o');
+        a.add<string>("target", '\0', kNoDesc, kOptional, "host");
+        a.add<string>("initial_weights", '\0', kNoDesc, kOptional, "");
+        a.add<int>("batch_size", '\0', kNoDesc, kOptional, 32);
+        a.add<int>("num_batches", '\0', kNoDesc, kOptional, 1);
+        a.add<int>("compile_threads", '\0', "Defaults to the number of cores.", kOptional, 0);
+        a.add<int>("benchmark_slots", '\0', "How many samples to benchmark at once.", kOptional, 1);
+        a.add<double>("benchmark_min_time", '\0', kNoDesc, kOptional, 0.1);
+        a.add("perf_counters", '\0', "Record hardware performance counters for each sample.");
+        a.add<int>("epochs", '\0', "Defaults to the batch size.", kOptional, 0);
+        a.add<string>("rates", '\0', kNoDesc, kOptional, "0.0001");
+        a.add<int>("num_cores", '\0', kNoDesc, kOptional, 32);
+
+        a.parse_check(argc, argv);  // exits if parsing fails
+
+        generator_name = a.get<string>("generator");
+        plugin_path = a.get<string>("plugin");
+        samples_dir = a.get<string>("samples");
+        target = a.get<string>("target");
+        initial_weights_path = a.get<string>("initial_weights");
+        batch_size = a.get<int>("batch_size");
+        num_batches = a.get<int>("num_batches");
+        compile_threads = a.get<int>("compile_threads");
+        benchmark_slots = a.get<int>("benchmark_slots");
+        benchmark_min_time = a.get<double>("benchmark_min_time");
+        perf_counters = a.exist("perf_counters");
+        epochs = a.get<int>("epochs");
+        rates = parse_floats(a.get<string>("rates"));
+        num_cores = a.get<int>("num_cores");
+
+        if (compile_threads <= 0) {
+            compile_threads = (int)std::max(1u, std::thread::hardware_concurrency());
+        }
+        if (epochs <= 0) {
+            epochs = batch_size;
+        }
+        if (perf_counters && benchmark_slots != 1) {
+            std::cerr << "--perf_counters counts every CPU, so requires --benchmark_slots=1.\n";
+            exit(1);
+        }
+        if (batch_size <= 0 || num_batches <= 0 || benchmark_slots <= 0 || rates.empty()) {
+            std::cerr << "--batch_size, --num_batches, --benchmark_slots and --rates must be positive.\n";
+            std::cerr << a.usage();
+            exit(1);
+        }
+
+        // The remaining arguments set GeneratorParams, or the parameters
+        // of the autoscheduler if prefixed with "autoscheduler."
+        const string prefix = "autoscheduler.";
+        for (const string &arg : a.rest()) {
+            size_t eq = arg.find('=');
+            if (eq == string::npos) {
+                std::cerr << "Expected an argument of the form key=value, not " << arg << "\n";
+                std::cerr << a.usage();
+                exit(1);
+            }
+            string key = arg.substr(0, eq), value = arg.substr(eq + 1);
+            if (key.compare(0, prefix.size(), prefix) == 0) {
+                autoscheduler_params[key.substr(prefix.size())] = value;
+            } else {
+                generator_params[key] = value;
+            }
+        }
+    }
+
+    std::vector<float> parse_floats(const std::string &s) {
+        std::vector<float> v;
+        std::istringstream i(s);
+        float f;
+        while (i >> f) {
+            v.push_back(f);
+        }
+        return v;
+    }
+};
+
+// One schedule for the pipeline, ready to benchmark.
+struct Candidate {
+    string path_prefix;
+    int32_t schedule_id = 0;
+
+    bool compiled = false;
+    string schedule_source;
+    vector<uint8_t> featurization;
+
+    Callable callable;
+    JITUserContext user_context;
+    JITUserContext *user_context_ptr = nullptr;
+    vector<Runtime::Buffer<>> buffers;
+    vector<halide_scalar_value_t> scalars;
+    vector<const void *> argv;
+
+    double runtime = 0;  // in seconds
+
+    // Hardware event counts per run, in the order of PerfCounters::names().
+    vector<uint64_t> counters;
+};
+
+Argument to_argument(const Internal::Parameter &param) {
+    return Argument(param.name(),
+                    param.is_buffer() ? Argument::InputBuffer : Argument::InputScalar,
+                    param.type(),
+                    param.dimensions(),
+                    param.get_argument_estimates());
+}
+
+bool get_estimate(const Expr &e, int *result) {
+    const int64_t *i = Internal::as_const_int(e);
+    if (!i) {
+        return false;
+    }
+    *result = (int)*i;
+    return true;
+}
+
+bool set_scalar(const Type &t, const Expr &e, halide_scalar_value_t *v) {
+    if (const int64_t *i = Internal::as_const_int(e)) {
+        switch (t.bits()) {
+        case 8:
+            v->u.i8 = (int8_t)*i;
+            return true;
+        case 16:
+            v->u.i16 = (int16_t)*i;
+            return true;
+        case 32:
+            v->u.i32 = (int32_t)*i;
+            return true;
+        case 64:
+            v->u.i64 = *i;
+            return true;
+        }
+    } else if (const uint64_t *u = Internal::as_const_uint(e)) {
+        switch (t.bits()) {
+        case 1:
+            v->u.b = *u != 0;
+            return true;
+        case 8:
+            v->u.u8 = (uint8_t)*u;
+            return true;
+        case 16:
+            v->u.u16 = (uint16_t)*u;
+            return true;
+        case 32:
+            v->u.u32 = (uint32_t)*u;
+            return true;
+        case 64:
+            v->u.u64 = *u;
+            return true;
+        }
+    } else if (const double *f = Internal::as_const_float(e)) {
+        switch (t.bits()) {
+        case 32:
+            v->u.f32 = (float)*f;
+            return true;
+        case 64:
+            v->u.f64 = *f;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Fill an input with random values, as RunGen's --estimate_all does.
+template<typename T>
+void fill_random(Runtime::Buffer<> &buf, std::mt19937 &rng) {
+    buf.as<T>().for_each_value([&](T &v) {
+        if constexpr (std::is_floating_point<T>::value) {
+            v = std::uniform_real_distribution<T>(0, 1)(rng);
+        } else {
+            v = (T)rng();
+        }
+    });
+}
+
+void fill_random(Runtime::Buffer<> &buf, std::mt19937 &rng) {
+    const halide_type_t t = buf.type();
+    if (t == halide_type_of<float>()) {
+        fill_random<float>(buf, rng);
+    } else if (t == halide_type_of<double>()) {
+        fill_random<double>(buf, rng);
+    } else if (t == halide_type_of<bool>() || t == halide_type_of<uint8_t>()) {
+        fill_random<uint8_t>(buf, rng);
+    } else if (t == halide_type_of<int8_t>()) {
+        fill_random<int8_t>(buf, rng);
+    } else if (t == halide_type_of<uint16_t>()) {
+        fill_random<uint16_t>(buf, rng);
+    } else if (t == halide_type_of<int16_t>()) {
+        fill_random<int16_t>(buf, rng);
+    } else if (t == halide_type_of<uint32_t>()) {
+        fill_random<uint32_t>(buf, rng);
+    } else if (t == halide_type_of<int32_t>()) {
+        fill_random<int32_t>(buf, rng);
+    } else if (t == halide_type_of<uint64_t>()) {
+        fill_random<uint64_t>(buf, rng);
+    } else if (t == halide_type_of<int64_t>()) {
+        fill_random<int64_t>(buf, rng);
+    } else {
+        memset(buf.data(), 0, buf.size_in_bytes());
+    }
+}
+
+Runtime::Buffer<> make_buffer(const Type &type, const vector<int> &mins, const vector<int> &extents) {
+    Runtime::Buffer<> buf(type, extents);
+    buf.set_min(mins);
+    return buf;
+}
+
+// Sample 0 in each batch is a best effort beam search, with no
+// randomness. The others are random probes biased by the cost model.
+AutoschedulerParams sample_autoscheduler_params(const Flags &flags, const string &weights,
+                                                int32_t seed, bool best_effort) {
+    AutoschedulerParams p("Adams2019");
+    p.extra["parallelism"] = "32";
+    p.extra["beam_size"] = best_effort ? "32" : "1";
+    p.extra["random_dropout"] = best_effort ? "100" : "1";
+    p.extra["random_dropout_seed"] = std::to_string(seed);
+    p.extra["weights_path"] = weights;
+    // The samples are already searched in parallel.
+    p.extra["search_threads"] = "1";
+    for (const auto &it : flags.autoscheduler_params) {
+        p.extra[it.first] = it.second;
+    }
+    return p;
+}
+
+// Autoschedule the pipeline with a randomized search, JIT-compile it, and
+// allocate its inputs and outputs using their estimates.
+void compile_candidate(const Flags &flags, const Target &target,
+                       const AutoschedulerParams &autoscheduler_params,
+                       Candidate *c) {
+    AbstractGeneratorPtr gen = GeneratorRegistry::create(flags.generator_name, GeneratorContext(target));
+    if (!gen) {
+        std::cerr << "Unknown generator: " << flags.generator_name << "\n";
+        return;
+    }
+    gen->set_generatorparam_values(flags.generator_params);
+    Pipeline p = gen->build_pipeline();
+
+    AutoSchedulerResults results = p.apply_autoscheduler(target, autoscheduler_params);
+    c->schedule_source = results.schedule_source;
+    c->featurization = results.featurization;
+
+    vector<Argument> args;
+    for (const auto &a : gen->arginfos()) {
+        if (a.dir != ArgInfoDirection::Input) {
+            continue;
+        }
+        for (const auto &param : gen->input_parameter(a.name)) {
+            args.push_back(to_argument(param));
+        }
+    }
+    c->callable = p.compile_to_callable(args, target);
+
+    std::mt19937 rng(0);
+    c->scalars.resize(args.size());
+    for (size_t i = 0; i < args.size(); i++) {
+        const Argument &a = args[i];
+        if (a.is_scalar()) {
+            Expr e = a.argument_estimates.scalar_estimate;
+            if (!e.defined()) {
+                e = a.argument_estimates.scalar_def;
+            }
+            if (!e.defined()) {
+                e = Internal::make_zero(a.type);
+            }
+            if (!set_scalar(a.type, Internal::simplify(cast(a.type, e)), &c->scalars[i])) {
+                std::cerr << "Scalar input " << a.name << " has no constant estimate\n";
+                return;
+            }
+        } else {
+            vector<int> mins, extents;
+            const Region &estimates = a.argument_estimates.buffer_estimates;
+            for (const Range &r : estimates) {
+                int min, extent;
+                if (!get_estimate(r.min, &min) || !get_estimate(r.extent, &extent)) {
+                    std::cerr << "Input buffer " << a.name << " has no estimates\n";
+                    return;
+                }
+                mins.push_back(min);
+                extents.push_back(extent);
+            }
+            if ((int)mins.size() != a.dimensions) {
+                std::cerr << "Input buffer " << a.name << " has no estimates\n";
+                return;
+            }
+            c->buffers.push_back(make_buffer(a.type, mins, extents));
+            fill_random(c->buffers.back(), rng);
+        }
+    }
+
+    for (const Func &f : p.outputs()) {
+        vector<int> mins, extents;
+        for (const Var &v : f.args()) {
+            for (const auto &b : f.function().schedule().estimates()) {
+                int min, extent;
+                if (b.var == v.name() && get_estimate(b.min, &min) && get_estimate(b.extent, &extent)) {
+                    mins.push_back(min);
+                    extents.push_back(extent);
+                }
+            }
+        }
+        if ((int)mins.size() != f.dimensions()) {
+            std::cerr << "Output " << f.name() << " has no estimates\n";
+            return;
+        }
+        for (const Type &t : f.types()) {
+            c->buffers.push_back(make_buffer(t, mins, extents));
+        }
+    }
+
+    // Buffer arguments are passed as halide_buffer_t pointers, in the
+    // same order as the Arguments, followed by the outputs.
+    size_t next_buffer = 0;
+    c->user_context_ptr = &c->user_context;
+    c->argv.push_back(&c->user_context_ptr);
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i].is_scalar()) {
+            c->argv.push_back(&c->scalars[i]);
+        } else {
+            c->argv.push_back(c->buffers[next_buffer++].raw_buffer());
+        }
+    }
+    while (next_buffer < c->buffers.size()) {
+        c->argv.push_back(c->buffers[next_buffer++].raw_buffer());
+    }
+
+    c->compiled = true;
+}
+
+void benchmark_candidate(const Flags &flags, Candidate *c) {
+    Tools::BenchmarkConfig config;
+    config.min_time = flags.benchmark_min_time;
+    config.max_time = flags.benchmark_min_time * 4;
+    int result = 0;
+    auto op = [&]() {
+        result |= c->callable.call_argv_fast(c->argv.size(), c->argv.data());
+        for (auto &buf : c->buffers) {
+            buf.device_sync();
+        }
+    };
+    Tools::BenchmarkResult r = Tools::benchmark(op, config);
+    if (result != 0) {
+        std::cerr << "Benchmarking failed for " << c->path_prefix << "\n";
+        c->compiled = false;
+        return;
+    }
+    c->runtime = r.wall_time;
+}
+
+// Run the candidate again with the performance counters enabled, for
+// about as long as it was benchmarked for.
+void count_candidate(const Flags &flags, PerfCounters &counters, Candidate *c) {
+    const int iterations = (int)std::max(1.0, std::min(1000.0, flags.benchmark_min_time / c->runtime));
+    counters.start();
+    for (int i = 0; i < iterations; i++) {
+        c->callable.call_argv_fast(c->argv.size(), c->argv.data());
+    }
+    for (auto &buf : c->buffers) {
+        buf.device_sync();
+    }
+    counters.stop();
+    c->counters = counters.read();
+    for (uint64_t &count : c->counters) {
+        count /= iterations;
+    }
+}
+
+// Write the sample in the format produced by featurization_to_sample,
+// along with the schedule that produced it.
+string write_sample(const Candidate &c, int32_t pipeline_id) {
+    {
+        std::ofstream f(c.path_prefix + ".schedule.h");
+        f << c.schedule_source;
+    }
+    string path = c.path_prefix + ".sample";
+    std::ofstream f(path, std::ios::binary);
+    f.write((const char *)c.featurization.data(), c.featurization.size());
+    float r = (float)(c.runtime * 1000);
+    f.write((const char *)&r, 4);
+    f.write((const char *)&pipeline_id, 4);
+    f.write((const char *)&c.schedule_id, 4);
+    f.close();
+    if (f.fail()) {
+        std::cerr << "Unable to write sample: " << path << "\n";
+        return "";
+    }
+    if (!c.counters.empty()) {
+        std::ofstream cf(c.path_prefix + ".counters");
+        for (size_t i = 0; i < c.counters.size(); i++) {
+            cf << PerfCounters::names()[i] << " " << c.counters[i] << "\n";
+        }
+    }
+    return path;
+}
+
+// Don't clobber existing samples: start after the highest numbered batch.
+int first_batch_id(const string &samples_dir) {
+    int last = 0;
+    const string prefix = "batch_";
+    for (const auto &entry : fs::directory_iterator(samples_dir)) {
+        string name = entry.path().filename().string();
+        if (name.compare(0, prefix.size(), prefix) == 0) {
+            last = std::max(last, std::atoi(name.c_str() + prefix.size()));
+        }
+    }
+    return last + 1;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Flags flags(argc, argv);
+
+    load_plugin(flags.plugin_path);
+    Target target(flags.target);
+    fs::create_directories(flags.samples_dir);
+
+    // Retraining continues from the samples and the weights of any
+    // previous runs in the same directory.
+    SampleSet samples;
+    for (const auto &entry : fs::recursive_directory_iterator(flags.samples_dir)) {
+        if (entry.path().extension() == ".sample") {
+            samples.add(entry.path().string());
+        }
+    }
+
+    const string weights = flags.samples_dir + "/updated.weights";
+    vector<std::unique_ptr<DefaultCostModel>> models;
+    if (fs::exists(weights)) {
+        std::cout << "Using existing weights " << weights << "\n";
+        models.emplace_back(make_default_cost_model(weights, weights));
+    } else {
+        models.emplace_back(make_default_cost_model(flags.initial_weights_path, weights));
+        models.back()->save_weights();
+    }
+
+    RetrainOptions options;
+    options.epochs = flags.epochs;
+    options.rates = flags.rates;
+    options.num_cores = flags.num_cores;
+
+    std::unique_ptr<PerfCounters> counters;
+    if (flags.perf_counters) {
+        counters = std::make_unique<PerfCounters>();
+        if (!counters->available()) {
+            std::cerr << "Hardware performance counters are unavailable; "
+                      << "check /proc/sys/kernel/perf_event_paranoid\n";
+            counters.reset();
+        }
+    }
+
+    const int32_t pipeline_id = 0;
+    const int first = first_batch_id(flags.samples_dir);
+    for (int batch_id = first; batch_id < first + flags.num_batches; batch_id++) {
+        const auto start = std::chrono::steady_clock::now();
+
+        // Copy the weights being used into the batch folder so that we can repro failures
+        const string dir = flags.samples_dir + "/batch_" + std::to_string(batch_id) + "_0";
+        fs::create_directories(dir);
+        fs::copy_file(weights, dir + "/used.weights", fs::copy_options::overwrite_existing);
+
+        std::cout << "Compiling " << flags.batch_size << " samples\n";
+        vector<Candidate> candidates(flags.batch_size);
+        {
+            Tools::ThreadPool<void> pool(flags.compile_threads);
+            vector<std::future<void>> futures;
+            for (int i = 0; i < flags.batch_size; i++) {
+                Candidate *c = &candidates[i];
+                c->schedule_id = batch_id * 10000 + i;
+                std::ostringstream prefix;
+                prefix << dir << "/" << flags.generator_name
+                       << "_batch_" << std::setw(4) << std::setfill('0') << batch_id
+                       << "_sample_" << std::setw(4) << std::setfill('0') << i;
+                c->path_prefix = prefix.str();
+                AutoschedulerParams asp = sample_autoscheduler_params(flags, weights, c->schedule_id, i == 0);
+                futures.push_back(pool.async([&flags, &target, asp, c]() {
+#ifdef HALIDE_WITH_EXCEPTIONS
+                    try {
+                        compile_candidate(flags, target, asp, c);
+                    } catch (const Halide::Error &e) {
+                        std::cerr << "Compilation failed for " << c->path_prefix << ": " << e.what() << "\n";
+                        c->compiled = false;
+                    }
+#else
+                    compile_candidate(flags, target, asp, c);
+#endif
+                }));
+            }
+            for (auto &f : futures) {
+                f.get();
+            }
+        }
+
+        // Benchmarking in more than one slot at a time trades accuracy
+        // for throughput; the slots share the Halide runtime's thread pool.
+        std::cout << "Benchmarking with " << flags.benchmark_slots << " slot(s)\n";
+        {
+            Tools::ThreadPool<void> pool(flags.benchmark_slots);
+            vector<std::future<void>> futures;
+            for (Candidate &c : candidates) {
+                if (c.compiled) {
+                    futures.push_back(pool.async([&flags, &c]() { benchmark_candidate(flags, &c); }));
+                }
+            }
+            for (auto &f : futures) {
+                f.get();
+            }
+        }
+
+        if (counters) {
+            for (Candidate &c : candidates) {
+                if (c.compiled) {
+                    count_candidate(flags, *counters, &c);
+                }
+            }
+        }
+
+        for (Candidate &c : candidates) {
+            if (!c.compiled) {
+                continue;
+            }
+            std::cout << "Sample " << c.schedule_id << ": " << c.runtime * 1000 << " ms\n";
+            string path = write_sample(c, pipeline_id);
+            if (!path.empty()) {
+                samples.add(path);
+            }
+            // Free the compiled code and buffers before retraining.
+            c = Candidate();
+        }
+
+        // Retrain the model weights on all samples seen so far
+        std::cout << "Retraining model...\n";
+        samples.report(flags.samples_dir + "/best." + flags.generator_name + ".benchmark.txt",
+                       flags.samples_dir + "/best." + flags.generator_name + ".schedule.h");
+        retrain(models, samples.pipelines, options);
+
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Batch " << batch_id << " took " << elapsed.count()
+                  << " seconds to compile, benchmark, and retrain\n";
+    }
+
+    return 0;
+}
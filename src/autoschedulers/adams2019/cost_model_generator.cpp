@@ -489,8 +489,10 @@ public:
         } else {
             // We just write down a good schedule for
             // inference. Scheduling a couple of convs is easy.
+            // Small batches, as come from narrow beams, still get a
+            // task per schedule.
             Var no;
-            prediction_output.specialize(batch_size < 8).split(n, no, n, 1);
+            prediction_output.specialize(batch_size < 8).split(n, no, n, 1).parallel(no);
             prediction_output.compute_root().split(n, no, n, 8).parallel(no);
             prediction_output.bound(n, 0, batch_size);
 
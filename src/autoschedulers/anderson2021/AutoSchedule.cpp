@@ -156,7 +156,9 @@ struct AutoSchedule {
                                               int pass_idx,
                                               int num_passes,
                                               ProgressBar &tick,
-                                              std::unordered_set<uint64_t> &permitted_hashes);
+                                              std::unordered_set<uint64_t> &permitted_hashes,
+                                              const Deadline &deadline,
+                                              bool have_best);
 
     // Performance coarse-to-fine beam search and return the best state found.
     IntrusivePtr<State> optimal_schedule(int beam_size);
@@ -208,7 +210,9 @@ IntrusivePtr<State> AutoSchedule::optimal_schedule_pass(int beam_size,
                                                         int pass_idx,
                                                         int num_passes,
                                                         ProgressBar &tick,
-                                                        std::unordered_set<uint64_t> &permitted_hashes) {
+                                                        std::unordered_set<uint64_t> &permitted_hashes,
+                                                        const Deadline &deadline,
+                                                        bool have_best) {
     StateQueue q, pending;
 
     // The initial state, with no decisions made
@@ -254,11 +258,25 @@ IntrusivePtr<State> AutoSchedule::optimal_schedule_pass(int beam_size,
     }
 #endif
 
+    bool out_of_time = false;
+
     // This loop is beam search over the sequence of decisions to make.
     for (int i = 0;; i++) {
         std::unordered_map<uint64_t, int> hashes;
         q.swap(pending);
 
+        // Once out of time, abandon this pass if an earlier one found a
+        // complete schedule. Otherwise finish it as a greedy search.
+        if (!out_of_time && deadline.passed()) {
+            if (have_best) {
+                return nullptr;
+            }
+            aslog(1) << "Time limit reached after " << i << " of " << 2 * dag.nodes.size()
+                     << " decisions, completing pass " << pass_idx + 1 << " greedily\n";
+            out_of_time = true;
+        }
+        const int beam_width = out_of_time ? 1 : beam_size;
+
         if (pending.empty()) {
             if ((false) && beam_size < 1000) {  // Intentional dead code. Extra parens to pacify clang-tidy.
                 // Total mortality. Double the beam size and
@@ -268,7 +286,9 @@ IntrusivePtr<State> AutoSchedule::optimal_schedule_pass(int beam_size,
                                              pass_idx,
                                              num_passes,
                                              tick,
-                                             permitted_hashes);
+                                             permitted_hashes,
+                                             deadline,
+                                             have_best);
             } else {
                 internal_error << "Ran out of legal states with beam size " << beam_size << "\n";
             }
@@ -279,7 +299,7 @@ IntrusivePtr<State> AutoSchedule::optimal_schedule_pass(int beam_size,
         }
 
         expanded = 0;
-        while (expanded < beam_size && !pending.empty()) {
+        while (expanded < beam_width && !pending.empty()) {
 
             IntrusivePtr<State> state{pending.pop()};
 
@@ -324,7 +344,7 @@ IntrusivePtr<State> AutoSchedule::optimal_schedule_pass(int beam_size,
             }
 
             // Random dropout
-            if (pending.size() > 1 && random_dropout(params, rng, dag.nodes.size() * 2)) {
+            if (!out_of_time && pending.size() > 1 && random_dropout(params, rng, dag.nodes.size() * 2)) {
                 continue;
             }
 
@@ -507,13 +527,32 @@ IntrusivePtr<State> AutoSchedule::optimal_schedule(int beam_size) {
         --num_passes;
     }
 
+    Deadline deadline(params.time_limit);
+
     for (; pass_idx < num_passes; pass_idx++) {
+        if (best.defined() && deadline.passed()) {
+            aslog(1) << "Time limit of " << params.time_limit << "s reached after "
+                     << pass_idx << " of " << num_passes << " passes\n";
+            break;
+        }
+
         ProgressBar tick;
 
-        auto pass = optimal_schedule_pass(beam_size, pass_idx, num_passes, tick, permitted_hashes);
+        auto pass = optimal_schedule_pass(beam_size, pass_idx, num_passes, tick, permitted_hashes,
+                                          deadline, best.defined());
 
         tick.clear();
 
+        if (!pass.defined()) {
+            aslog(1) << "Time limit of " << params.time_limit << "s reached during pass "
+                     << pass_idx + 1 << " of " << num_passes << ", abandoning it\n";
+            break;
+        }
+
+        if (params.time_limit > 0) {
+            aslog(1) << "Time remaining (s): " << std::max(0.0, params.time_limit - deadline.timer.elapsed().count()) << "\n";
+        }
+
         if (aslog::aslog_level() == 0) {
             aslog(1) << "Pass " << pass_idx + 1 << " of " << num_passes << ", cost: " << pass->cost << "\n";
         } else {
@@ -537,6 +576,36 @@ IntrusivePtr<State> AutoSchedule::optimal_schedule(int beam_size) {
     return best;
 }
 
+void Anderson2021Params::set_gpu_defaults_for_target(const Target &target) {
+    // The defaults in the struct describe a CUDA device (a V100, which
+    // the shipped weights were trained on). The other APIs only
+    // guarantee smaller limits, so use values that the common devices
+    // for each of them support. Any of these can be overridden.
+    if (target.has_feature(Target::CUDA)) {
+        return;
+    }
+    if (target.has_feature(Target::Vulkan)) {
+        // 16KB of shared memory is the minimum maxComputeSharedMemorySize
+        // required by the Vulkan spec, and is what many mobile GPUs offer.
+        shared_memory_limit_kb = 16;
+        shared_memory_sm_limit_kb = 32;
+        max_threads_per_block = 256;
+    } else if (target.has_feature(Target::OpenCL)) {
+        // 32KB is the minimum CL_DEVICE_LOCAL_MEM_SIZE for a full
+        // profile device.
+        shared_memory_limit_kb = 32;
+        shared_memory_sm_limit_kb = 64;
+        max_threads_per_block = 256;
+    } else if (target.has_feature(Target::Metal) ||
+               target.has_feature(Target::D3D12Compute)) {
+        // Threadgroup (groupshared) memory is limited to 32KB, and blocks
+        // may have up to 1024 threads.
+        shared_memory_limit_kb = 32;
+        shared_memory_sm_limit_kb = 64;
+        max_threads_per_block = 1024;
+    }
+}
+
 // The main entrypoint to generate a schedule for a pipeline.
 void generate_schedule(const std::vector<Function> &outputs,
                        const Target &target,
@@ -562,6 +631,9 @@ void generate_schedule(const std::vector<Function> &outputs,
     aslog(1) << "Anderson2021Params.shared_memory_sm_limit_kb:" << params.shared_memory_sm_limit_kb << "\n";
     aslog(1) << "Anderson2021Params.active_block_limit:" << params.active_block_limit << "\n";
     aslog(1) << "Anderson2021Params.active_warp_limit:" << params.active_warp_limit << "\n";
+    aslog(1) << "Anderson2021Params.warp_size:" << params.warp_size << "\n";
+    aslog(1) << "Anderson2021Params.max_threads_per_block:" << params.max_threads_per_block << "\n";
+    aslog(1) << "Anderson2021Params.time_limit:" << params.time_limit << "\n";
 
     // Start a timer
     HALIDE_TIC;
@@ -572,6 +644,12 @@ void generate_schedule(const std::vector<Function> &outputs,
     string weights_in_path = params.weights_path;
     string weights_out_path;  // deliberately empty
 
+    if (weights_in_path.empty() && !target.has_feature(Target::CUDA)) {
+        aslog(1) << "Using the default weights, which were trained on a CUDA device. "
+                 << "For better schedules on " << target.to_string()
+                 << ", retrain the cost model on that target (see anderson2021_autotune_loop.sh).\n";
+    }
+
     // Analyse the Halide algorithm and construct our abstract representation of it
     FunctionDAG dag(outputs, target);
     if (aslog::aslog_level() > 0) {
@@ -668,6 +746,7 @@ struct Anderson2021 {
             outputs.push_back(f.function());
         }
         Anderson2021Params params;
+        params.set_gpu_defaults_for_target(target);
         {
             ParamParser parser(params_in.extra);
             parser.parse("parallelism", &params.parallelism);
@@ -686,6 +765,9 @@ struct Anderson2021 {
             parser.parse("shared_memory_sm_limit_kb", &params.shared_memory_sm_limit_kb);
             parser.parse("active_block_limit", &params.active_block_limit);
             parser.parse("active_warp_limit", &params.active_warp_limit);
+            parser.parse("warp_size", &params.warp_size);
+            parser.parse("max_threads_per_block", &params.max_threads_per_block);
+            parser.parse("time_limit", &params.time_limit);
             parser.finish();
         }
         Autoscheduler::generate_schedule(outputs, target, params, results);
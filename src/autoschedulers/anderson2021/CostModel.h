@@ -6,6 +6,7 @@
 #include "FunctionDAG.h"
 #include "HalideBuffer.h"
 #include "PerfectHashMap.h"
+#include "ThreadInfo.h"
 
 // An abstract base class for a cost model.
 namespace Halide {
@@ -67,21 +68,40 @@ struct Anderson2021Params {
      * Formerly HL_STACK_FACTOR */
     double stack_factor = 0.95f;
 
-    /** TODO: document me
+    /** Maximum shared memory (in KB) a single block may allocate.
      * Formerly HL_SHARED_MEMORY_LIMIT */
     int shared_memory_limit_kb = 48;
 
-    /** TODO: document me
+    /** Shared memory (in KB) available to all the resident blocks of one
+     * SM (compute unit). Used to estimate occupancy.
      * Formerly HL_SHARED_MEMORY_SM_LIMIT */
     int shared_memory_sm_limit_kb = 96;
 
-    /** TODO: document me
+    /** Maximum number of blocks resident on one SM at a time.
      * Formerly HL_ACTIVE_BLOCK_LIMIT */
     int active_block_limit = 32;
 
-    /** TODO: document me
+    /** Maximum number of warps resident on one SM at a time.
      * Formerly HL_ACTIVE_WARP_LIMIT */
     int active_warp_limit = 64;
+
+    /** Number of threads in a warp (a SIMD group on Metal, a subgroup on
+     * Vulkan and OpenCL, a wave on D3D12). */
+    int warp_size = 32;
+
+    /** Maximum number of threads in one block. Thread tilings with more
+     * threads than this are rejected. */
+    int max_threads_per_block = MAX_THREADS_PER_BLOCK;
+
+    /** Set the defaults of the limits above to suit the GPU API of the
+     * given target. The defaults otherwise describe a CUDA device. Call
+     * this before applying any user-specified values. */
+    void set_gpu_defaults_for_target(const Target &target);
+
+    /** If > 0, the number of seconds the search may take. When it runs
+     * out, the best complete schedule found so far is returned. If no
+     * pass has finished yet, the current one is completed greedily. */
+    double time_limit = 0;
 };
 
 }  // namespace Autoscheduler
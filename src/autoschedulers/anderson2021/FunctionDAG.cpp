@@ -564,6 +564,9 @@ void FunctionDAG::Edge::expand_footprint(const Span *consumer_loop, Span *produc
 FunctionDAG::FunctionDAG(const vector<Function> &outputs, const Target &target) {
     map<string, Function> env = build_environment(outputs);
 
+    // The same bounds queries are made for many stages and edges.
+    BoundsQueryCache bounds_cache;
+
     // A mutator to apply parameter estimates to the expressions
     // we encounter while constructing the graph.
     class ApplyParamEstimates : public IRMutator {
@@ -97,7 +97,8 @@ std::unique_ptr<ThreadInfo> GPULoopInfo::create_thread_info() {
         current_thread_loop->vectorized_loop_index,
         current_thread_loop->size,
         current_thread_loop->stage->loop,
-        max_thread_counts);
+        max_thread_counts,
+        warp_size);
     thread_info = new_thread_info.get();
     return new_thread_info;
 }
@@ -19,11 +19,12 @@ namespace Autoscheduler {
 struct LoopNest;
 
 struct GPULoopInfo {
-    GPULoopInfo(const LoopNest *root)
-        : root{root} {
+    GPULoopInfo(const LoopNest *root, int warp_size = 32)
+        : root{root}, warp_size{warp_size} {
     }
 
     const LoopNest *root = nullptr;
+    int warp_size = 32;
     const LoopNest *current_block_loop = nullptr;
     const LoopNest *current_thread_loop = nullptr;
     std::vector<const LoopNest *> inner_loop_stack;
@@ -65,7 +65,7 @@ bool in_range_zero_one(double x) {
     return x > 0 && x <= 1;
 }
 
-bool are_valid_thread_extents(const vector<int64_t> &counts) {
+bool are_valid_thread_extents(const vector<int64_t> &counts, int max_threads_per_block) {
     int num_thread_loops = 0;
     int num_threads = 1;
 
@@ -74,7 +74,7 @@ bool are_valid_thread_extents(const vector<int64_t> &counts) {
             continue;
         }
 
-        if (num_thread_loops >= 3 || num_threads * c > MAX_THREADS_PER_BLOCK) {
+        if (num_thread_loops >= 3 || num_threads * c > max_threads_per_block) {
             return false;
         }
 
@@ -147,11 +147,10 @@ void LoopNest::get_stage_sizes(const FunctionDAG::Node *f,
 }
 
 // given the loop nest of a stage to parallelize at root, figure out if using odd tile sizes
-// for the vectorized dimension will allow the resulting thread tiles to be multiples of 32
-// if so, we will include these in the serial loop sizes
-void LoopNest::generate_vec_dim_serial_tilings(vector<int> &serial_sizes) const {
+// for the vectorized dimension will allow the resulting thread tiles to be multiples of
+// the warp size. If so, we will include these in the serial loop sizes
+void LoopNest::generate_vec_dim_serial_tilings(vector<int> &serial_sizes, int warp_width) const {
     // generate suggested tilings for vectorized dimension
-    int warp_width = 32;
     if (size[vectorized_loop_index] % warp_width == 0) {
         int remaining_ext = size[vectorized_loop_index] / warp_width;
         for (int s = 3; s < 8; s += 2) {
@@ -4006,9 +4005,9 @@ double LoopNest::max_idle_lane_wastage(const Target &target, GPULoopInfo gpu_loo
     return max_wastage;
 }
 
-bool LoopNest::has_valid_thread_extents() const {
+bool LoopNest::has_valid_thread_extents(int max_threads_per_block) const {
     for (const auto &c : children) {
-        if (!are_valid_thread_extents(c->get_union_thread_counts(nullptr))) {
+        if (!are_valid_thread_extents(c->get_union_thread_counts(nullptr), max_threads_per_block)) {
             return false;
         }
     }
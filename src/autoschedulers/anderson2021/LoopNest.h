@@ -61,7 +61,7 @@ int get_unroll_limit(const Target &target);
 
 bool in_range_zero_one(double x);
 
-bool are_valid_thread_extents(const vector<int64_t> &counts);
+bool are_valid_thread_extents(const vector<int64_t> &counts, int max_threads_per_block = MAX_THREADS_PER_BLOCK);
 
 double get_idle_lane_wastage_limit_env_var();
 double get_idle_lane_wastage_limit();
@@ -169,7 +169,7 @@ struct LoopNest {
     // given the loop nest of a stage to parallelize at root, figure out if using odd tile sizes
     // for the vectorized dimension will allow the resulting thread tiles to be multiples of 32
     // if so, we will include these in the serial loop sizes
-    void generate_vec_dim_serial_tilings(vector<int> &serial_sizes) const;
+    void generate_vec_dim_serial_tilings(vector<int> &serial_sizes, int warp_width = 32) const;
 
     // get the loop nests of a newly inserted node, f, that is marked GPU threads. Tiles
     // the newly inserted loop nests of f into a threads loop outside a serial loop.
@@ -560,7 +560,7 @@ struct LoopNest {
 
     double max_idle_lane_wastage(const Target &target, GPULoopInfo gpu_loop_info) const;
 
-    bool has_valid_thread_extents() const;
+    bool has_valid_thread_extents(int max_threads_per_block = MAX_THREADS_PER_BLOCK) const;
 
     void collect_nodes_that_should_be_inlined(const NodeMap<bool> &nodes_to_freeze, NodeMap<bool> &inlined_nodes) const;
 
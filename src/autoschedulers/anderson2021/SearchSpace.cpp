@@ -182,14 +182,14 @@ vector<SearchSpace::ParallelTileOption> SearchSpace::filter_parallel_tile_option
 vector<ThreadTileOption> SearchSpace::filter_thread_tile_options(vector<IntrusivePtr<const LoopNest>> &loop_nests) const {
     vector<ThreadTileOption> options;
     for (const auto &loop_nest : loop_nests) {
-        if (!loop_nest->has_valid_thread_extents()) {
+        if (!loop_nest->has_valid_thread_extents(params.max_threads_per_block)) {
             Filter(loop_nest.get()) << "Invalid thread extents\n";
             continue;
         }
 
         ThreadTileOption o;
         o.loop_nest = loop_nest;
-        o.max_idle_lane_wastage = loop_nest->max_idle_lane_wastage(target, {loop_nest.get()});
+        o.max_idle_lane_wastage = loop_nest->max_idle_lane_wastage(target, {loop_nest.get(), params.warp_size});
         options.emplace_back(std::move(o));
     }
 
@@ -633,7 +633,7 @@ void SearchSpace::freeze_lowest_cost_stages(const IntrusivePtr<State> &best) {
 
 vector<vector<int64_t>> SearchSpace::generate_compute_root_serial_tilings(const IntrusivePtr<const LoopNest> &pure_stage, const FunctionDAG::Node *node) const {
     std::vector<int> vec_dim_serial_sizes;
-    pure_stage->generate_vec_dim_serial_tilings(vec_dim_serial_sizes);
+    pure_stage->generate_vec_dim_serial_tilings(vec_dim_serial_sizes, params.warp_size);
 
     return generate_serial_tilings(pure_stage->size,
                                    node->dimensions - 1,
@@ -224,9 +224,9 @@ void State::FeatureLoopNestMutator::split_compute_root_loops(LoopNest *loop_nest
             c = c->parallelize_in_tiles(tiling, loop_nest, params, target, true, false);
 
             if (vectorized_loop_index >= 0) {
-                // Make the vectorized dimension of the inner loop 32 (or as
-                // close as possible)
-                int64_t inner_extent = std::min(c->size[vectorized_loop_index], (int64_t)32);
+                // Make the vectorized dimension of the inner loop one warp
+                // (or as close as possible)
+                int64_t inner_extent = std::min(c->size[vectorized_loop_index], (int64_t)params.warp_size);
 
                 tiling[vectorized_loop_index] = inner_extent;
             }
@@ -257,9 +257,9 @@ void State::FeatureLoopNestMutator::split_compute_root_loops(LoopNest *loop_nest
             // outer_vec_extent and instead only have a single thread
             vector<int64_t> thread_tiling(c->node->dimensions, 1);
             if (vectorized_loop_index >= 0) {
-                // Make the vectorized dimension of the inner loop 32 (or as
-                // close as possible)
-                int64_t inner_extent = std::min(c->size[vectorized_loop_index], (int64_t)32);
+                // Make the vectorized dimension of the inner loop one warp
+                // (or as close as possible)
+                int64_t inner_extent = std::min(c->size[vectorized_loop_index], (int64_t)params.warp_size);
 
                 thread_tiling[c->stage->loop[vectorized_loop_index].pure_dim] = inner_extent;
             }
@@ -500,7 +500,7 @@ bool State::compute_featurization(const FunctionDAG &dag, const Anderson2021Para
     }
 
     Timer timer;
-    feature_root->compute_features(dag, params, target, sites, 1, 1, nullptr, nullptr, *feature_root, {feature_root.get()}, true, total_shared_mem_alloc_sizes, nullptr, nullptr, nullptr, features, stats, verbose);
+    feature_root->compute_features(dag, params, target, sites, 1, 1, nullptr, nullptr, *feature_root, {feature_root.get(), params.warp_size}, true, total_shared_mem_alloc_sizes, nullptr, nullptr, nullptr, features, stats, verbose);
 
     stats.featurization_time += timer.elapsed();
     ++stats.num_featurizations;
@@ -663,7 +663,7 @@ bool State::exceeds_local_memory_limit(const Anderson2021Params &params, const T
 
 bool State::calculate_cost(const FunctionDAG &dag, const Anderson2021Params &params, const Target &target, CostModel *cost_model, Statistics &stats, bool verbose) {
     Timer timer;
-    if (!root->has_valid_thread_extents()) {
+    if (!root->has_valid_thread_extents(params.max_threads_per_block)) {
         Filter(root.get()) << "Invalid thread extents\n";
         return false;
     }
@@ -60,6 +60,20 @@ struct Timer {
     }
 };
 
+// A time limit on a search. It never passes if the limit is not positive.
+struct Deadline {
+    Timer timer;
+    double limit;  // in seconds
+
+    explicit Deadline(double limit)
+        : limit(limit) {
+    }
+
+    bool passed() const {
+        return limit > 0 && timer.elapsed().count() >= limit;
+    }
+};
+
 struct Statistics {
     int num_featurizations{0};
     int num_states_added{0};
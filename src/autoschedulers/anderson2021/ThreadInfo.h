@@ -38,7 +38,8 @@ struct ThreadTileOption {
 };
 
 struct ThreadInfo {
-    ThreadInfo(int vectorized_loop_index, const std::vector<int64_t> &size, const std::vector<FunctionDAG::Node::Loop> &loop, const std::vector<int64_t> &max_thread_counts) {
+    ThreadInfo(int vectorized_loop_index, const std::vector<int64_t> &size, const std::vector<FunctionDAG::Node::Loop> &loop, const std::vector<int64_t> &max_thread_counts, int warp_size = 32)
+        : warp_size(warp_size) {
         init_threads_in_this_block(max_thread_counts);
 
         std::size_t num_thread_loops = 0;
@@ -120,7 +121,7 @@ struct ThreadInfo {
                     // For the 2nd loop, skip threads with x id >= 5
                     bool active = x < threads[0] && y < threads[1] && z < threads[2];
 
-                    bool last_thread = thread_id == 31;
+                    bool last_thread = thread_id == warp_size - 1;
                     fn(thread_id, x, y, z, active, last_thread);
                     ++thread_id;
 
@@ -164,17 +165,20 @@ struct ThreadInfo {
     }
 
     double warp_lane_utilization() const {
-        return (double)num_active_threads / (double)(num_active_warps_per_block * 32);
+        return (double)num_active_threads / (double)(num_active_warps_per_block * warp_size);
     }
 
     double idle_lane_wastage() const {
-        return ((double)(num_active_warps_per_block * 32) - (double)num_active_threads) / MAX_THREADS_PER_BLOCK;
+        return ((double)(num_active_warps_per_block * warp_size) - (double)num_active_threads) / MAX_THREADS_PER_BLOCK;
     }
 
     double block_occupancy() const {
         return (double)num_threads / MAX_THREADS_PER_BLOCK;
     }
 
+    // The number of threads in a warp (or subgroup, or SIMD group)
+    int warp_size = 32;
+
     int num_warps_per_block = 0;
     int num_active_warps_per_block = 0;
     int num_regular_active_warps_per_block = 0;
@@ -209,8 +213,8 @@ private:
             ++num_thread_loops;
         }
 
-        num_warps_per_block = num_threads_in_this_block / 32;
-        if (num_threads_in_this_block % 32 != 0) {
+        num_warps_per_block = num_threads_in_this_block / warp_size;
+        if (num_threads_in_this_block % warp_size != 0) {
             num_warps_per_block++;
         }
     }
@@ -231,7 +235,7 @@ private:
             }
             ++num_threads_in_cur_warp;
 
-            if ((thread_id + 1) % 32 == 0 || is_last_thread) {
+            if ((thread_id + 1) % warp_size == 0 || is_last_thread) {
                 if (current_warp_is_active) {
                     ++num_active_warps_per_block;
 
@@ -245,7 +249,7 @@ private:
                         has_tail_warp = num_active_threads_in_first_warp != num_active_threads_in_cur_warp;
                         final_warp_initial_thread_id = thread_id - num_threads_in_cur_warp + 1;
 
-                        internal_assert(num_threads_in_final_warp <= 32);
+                        internal_assert(num_threads_in_final_warp <= warp_size);
                     }
                 }
 
@@ -185,11 +185,10 @@ make_featurization() {
         beam=1
     fi
 
-    # TODO: make these arguments to this file
-    local -r shared_memory_limit=48
-    local -r shared_memory_sm_limit=96
-    local -r active_block_limit=32
-    local -r active_warp_limit=64
+    # The GPU limits (shared memory, warp size, threads per block, ...)
+    # default to values suited to the GPU API of HL_TARGET. Override them
+    # with e.g. autoscheduler.shared_memory_limit_kb=... in
+    # EXTRA_GENERATOR_ARGS.
 
     GPU=$((RANDOM % NUM_GPUS))
     CMD="HL_DEBUG_AUTOSCHEDULE=1 \
@@ -211,10 +210,6 @@ make_featurization() {
         autoscheduler.randomize_tilings=${RANDOMIZE_TILINGS} \
         autoscheduler.search_space_options=${SEARCH_SPACE_OPTIONS} \
         autoscheduler.freeze_inline_compute_root=${USE_FREEZE} \
-        autoscheduler.shared_memory_limit_kb=${shared_memory_limit} \
-        autoscheduler.shared_memory_sm_limit_kb=${shared_memory_sm_limit} \
-        autoscheduler.active_block_limit=${active_block_limit} \
-        autoscheduler.active_warp_limit=${active_warp_limit} \
         2> ${D}/compile_err.txt > ${D}/compile_log.txt"
 
     FAILED=0
@@ -138,7 +138,7 @@ void parallelize_vars_and_rvars_gpu(
     if (gpu_threads.empty()) {
         // If we can't find any GPU threads, parallelize RVars to find more parallelism
         for (int i = 0; i < (int)rvars.size(); i++) {
-            if (!r_gpu_threads.empty() && rvar_bounds[i] > split_size) {
+            if (r_gpu_threads.empty() && rvar_bounds[i] > split_size) {
                 RVar outer, inner;
                 func_or_stage.split(rvars[i],
                                     outer,
@@ -319,7 +319,7 @@ void parallelize_vars_and_rvars_gpu(
         }
         if (!r_gpu_threads.empty()) {
             func_or_stage.gpu_threads(RVar(r_gpu_threads));
-            schedule_source << "    .r_gpu_threads(" << r_gpu_threads << ")\n";
+            schedule_source << "    .gpu_threads(" << r_gpu_threads << ")\n";
         }
     } else {
         // Not enough parallelism, use a single GPU thread
@@ -1,11 +1,17 @@
 #include "HalidePlugin.h"
 
 #include <algorithm>
+#include <fstream>
 #include <map>
 #include <regex>
 #include <set>
+#include <thread>
 #include <utility>
 
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+
 #include "Halide.h"
 #include "ParamParser.h"
 
@@ -29,11 +35,114 @@ struct ArchParams {
     /** Size of the last-level cache (in bytes). */
     uint64_t last_level_cache_size = 16 * 1024 * 1024;
 
+    /** Sizes of the L1 data and L2 caches (in bytes), or zero if unknown.
+     * If both are known, the cost of a load steps up at each level of the
+     * cache hierarchy, rather than rising linearly all the way to the size
+     * of the last-level cache. */
+    uint64_t l1_cache_size = 0;
+    uint64_t l2_cache_size = 0;
+
     /** Indicates how much more expensive is the cost of a load compared to
      * the cost of an arithmetic operation at last level cache. */
     float balance = 40;
 };
 
+// The size in bytes of the data or unified cache at the given level on
+// the host, or zero if it can't be found.
+uint64_t host_cache_size(int level) {
+#if defined(__linux__)
+    for (int i = 0;; i++) {
+        const string dir = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(i) + "/";
+        std::ifstream level_file(dir + "level");
+        if (!level_file) {
+            break;
+        }
+        int l = 0;
+        string type, size;
+        level_file >> l;
+        std::ifstream(dir + "type") >> type;
+        if (l != level || type == "Instruction") {
+            continue;
+        }
+        // Sizes are written like "32K" or "8M".
+        std::ifstream(dir + "size") >> size;
+        uint64_t bytes = std::strtoull(size.c_str(), nullptr, 10);
+        switch (size.empty() ? ' ' : size.back()) {
+        case 'K':
+            return bytes * 1024;
+        case 'M':
+            return bytes * 1024 * 1024;
+        case 'G':
+            return bytes * 1024 * 1024 * 1024;
+        default:
+            return bytes;
+        }
+    }
+#elif defined(__APPLE__)
+    const char *names[] = {"hw.l1dcachesize", "hw.l2cachesize", "hw.l3cachesize"};
+    if (level >= 1 && level <= 3) {
+        uint64_t bytes = 0;
+        size_t len = sizeof(bytes);
+        if (sysctlbyname(names[level - 1], &bytes, &len, nullptr, 0) == 0) {
+            return bytes;
+        }
+    }
+#endif
+    return 0;
+}
+
+// Fill in the parallelism and cache sizes of the host, where they can be
+// found. Anything that can't be found keeps its default.
+void detect_host_arch_params(ArchParams *arch_params) {
+    unsigned threads = std::thread::hardware_concurrency();
+    if (threads > 0) {
+        arch_params->parallelism = (int)threads;
+    }
+    uint64_t sizes[4] = {0, 0, 0, 0};
+    int last_level = 0;
+    for (int level = 1; level <= 3; level++) {
+        sizes[level] = host_cache_size(level);
+        if (sizes[level] > 0) {
+            last_level = level;
+        }
+    }
+    if (last_level > 0) {
+        arch_params->last_level_cache_size = sizes[last_level];
+    }
+    if (last_level == 3) {
+        arch_params->l1_cache_size = sizes[1];
+        arch_params->l2_cache_size = sizes[2];
+    }
+    debug(1) << "Detected host parallelism: " << arch_params->parallelism
+             << ", L1: " << arch_params->l1_cache_size
+             << ", L2: " << arch_params->l2_cache_size
+             << ", last-level cache: " << arch_params->last_level_cache_size << "\n";
+}
+
+// The cost of loading from a memory footprint of the given size (in bytes),
+// relative to the cost of an arithmetic operation. Without the sizes of
+// the inner caches, this rises linearly to 'balance' at the size of the
+// last-level cache. With them, it is 1 while the footprint fits in L1, a
+// quarter of the way to 'balance' at the size of L2, and 'balance' at the
+// size of the last-level cache.
+Expr load_cost_factor(const Expr &footprint, const ArchParams &arch_params) {
+    const float l1 = (float)arch_params.l1_cache_size;
+    const float l2 = (float)arch_params.l2_cache_size;
+    const float llc = (float)arch_params.last_level_cache_size;
+    const float balance = arch_params.balance;
+    if (!(0 < l1 && l1 < l2 && l2 < llc)) {
+        float load_slope = balance / llc;
+        return cast<int64_t>(min(1 + footprint * load_slope, balance));
+    }
+    const float l2_cost = 1 + (balance - 1) / 4;
+    Expr f = cast<float>(footprint);
+    Expr in_l2 = 1 + (f - l1) * ((l2_cost - 1) / (l2 - l1));
+    Expr in_llc = l2_cost + (f - l2) * ((balance - l2_cost) / (llc - l2));
+    return cast<int64_t>(select(f <= l1, 1.0f,
+                                f <= l2, in_l2,
+                                min(in_llc, balance)));
+}
+
 // Substitute parameter estimates into the exprs describing the box bounds.
 void substitute_estimates_box(Box &box) {
     box.used = substitute_var_estimates(box.used);
@@ -1956,21 +2065,17 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
                                      tile_cost.second);
     }*/
 
-    // TODO: Use smooth step curve from Jon to better model cache behavior,
-    // where each step corresponds to different cache level.
-    //
-    // The current cost model drops off linearly. Larger memory footprint is
-    // penalized more than smaller memory footprint (since smaller one can fit
-    // more in the cache). The cost is clamped at 'balance', which is roughly at
-    // memory footprint equal to or larger than the last level cache size.
+    // Larger memory footprint is penalized more than smaller memory footprint
+    // (since smaller one can fit more in the cache). The cost is clamped at
+    // 'balance', which is roughly at memory footprint equal to or larger than
+    // the last level cache size. If the sizes of the inner caches are known,
+    // the cost steps up at each level (see load_cost_factor).
 
     // If 'model_reuse' is set, the cost model should take into account memory
     // reuse within the tile, e.g. matrix multiply reuses inputs multiple times.
     // TODO: Implement a better reuse model.
     bool model_reuse = false;
 
-    // Linear dropoff
-    float load_slope = arch_params.balance / arch_params.last_level_cache_size;
     for (const auto &f_load : group_load_costs) {
         internal_assert(g.inlined.find(f_load.first) == g.inlined.end())
             << "Intermediates of inlined pure function \"" << f_load.first
@@ -2012,8 +2117,7 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
             }
 
             if (model_reuse) {
-                Expr initial_factor =
-                    cast<int64_t>(min(1 + initial_footprint * load_slope, arch_params.balance));
+                Expr initial_factor = load_cost_factor(initial_footprint, arch_params);
                 per_tile_cost.memory += initial_factor * footprint;
             } else {
                 footprint = initial_footprint;
@@ -2024,7 +2128,7 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
             }
         }
 
-        Expr cost_factor = cast<int64_t>(min(1 + footprint * load_slope, arch_params.balance));
+        Expr cost_factor = load_cost_factor(footprint, arch_params);
         per_tile_cost.memory += cost_factor * f_load.second;
     }
 
@@ -3401,8 +3505,24 @@ struct Mullapudi2016 {
         ArchParams arch_params;
         {
             ParamParser parser(params_in.extra);
+            // Detected values are only defaults: any of them can still be
+            // set explicitly. Detection is off by default so that the
+            // schedule doesn't depend on the machine it was generated on.
+            bool detect_host = false;
+            parser.parse("detect_host", &detect_host);
+            if (detect_host) {
+                const Target host = get_host_target();
+                if (target.arch == host.arch && target.bits == host.bits && target.os == host.os) {
+                    detect_host_arch_params(&arch_params);
+                } else {
+                    user_warning << "Mullapudi2016.detect_host ignored, as the target "
+                                 << target.to_string() << " is not the host\n";
+                }
+            }
             parser.parse("parallelism", &arch_params.parallelism);
             parser.parse("last_level_cache_size", &arch_params.last_level_cache_size);
+            parser.parse("l1_cache_size", &arch_params.l1_cache_size);
+            parser.parse("l2_cache_size", &arch_params.l2_cache_size);
             parser.parse("balance", &arch_params.balance);
             parser.finish();
         }
@@ -937,6 +937,31 @@ public:
         decref();
     }
 
+    /** Take ownership of the host memory this Buffer points to, which
+     * was allocated by something other than this class (e.g. a file
+     * mapped into memory). When the last Buffer sharing the memory
+     * drops its reference, deallocate_fn is called with the given
+     * context. The Buffer must not already own its host memory. */
+    void take_ownership_of_host(void (*deallocate_fn)(void *), void *context) {
+        assert(!owns_host_memory() && "Buffer already owns its host memory");
+        struct ExternalAllocation : AllocationHeader {
+            void (*deallocate_fn)(void *);
+            void *context;
+
+            ExternalAllocation(void (*deallocate_fn)(void *), void *context)
+                : AllocationHeader(release), deallocate_fn(deallocate_fn), context(context) {
+            }
+
+            static void release(void *header) {
+                ExternalAllocation *self = (ExternalAllocation *)header;
+                self->deallocate_fn(self->context);
+                free(header);
+            }
+        };
+        void *storage = malloc(sizeof(ExternalAllocation));
+        alloc = new (storage) ExternalAllocation(deallocate_fn, context);
+    }
+
     /** Drop reference to any owned device memory, possibly freeing it
      * if this buffer held the last reference to it. Asserts that
      * device_dirty is false. */
@@ -1352,6 +1377,23 @@ public:
      */
     template<typename T2, int D2, int S2>
     void copy_from(Buffer<T2, D2, S2> src) {
+        copy_from_impl<false>(std::move(src));
+    }
+
+    /** Like copy_from, but split the copy into tasks run on the Halide
+     * runtime thread pool using halide_do_par_for. This makes the
+     * Buffer depend on the Halide runtime, so it is opt-in. Small
+     * copies are done on the calling thread. */
+    template<typename T2, int D2, int S2>
+    void copy_from_parallel(Buffer<T2, D2, S2> src) {
+        copy_from_impl<true>(std::move(src));
+    }
+
+private:
+    // The parallel flag is a template parameter so that serial copies
+    // don't depend on the Halide runtime.
+    template<bool parallel, typename T2, int D2, int S2>
+    void copy_from_impl(Buffer<T2, D2, S2> src) {
         static_assert(!std::is_const<T>::value, "Cannot call copy_from() on a Buffer<const T>");
         assert(!device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty destination.");
         assert(!src.device_dirty() && "Cannot call Halide::Runtime::Buffer::copy_from on a device dirty source.");
@@ -1375,35 +1417,27 @@ public:
         }
 
         // If T is void, we need to do runtime dispatch to an
-        // appropriately-typed lambda. We're copying, so we only care
+        // appropriately-sized copy. We're copying, so we only care
         // about the element size. (If not, this should optimize away
         // into a static dispatch to the right-sized copy.)
-        if (T_is_void ? (type().bytes() == 1) : (sizeof(not_void_T) == 1)) {
-            using MemType = uint8_t;
-            auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)dst;
-            auto &typed_src = (Buffer<const MemType, D2, S2> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
-        } else if (T_is_void ? (type().bytes() == 2) : (sizeof(not_void_T) == 2)) {
-            using MemType = uint16_t;
-            auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)dst;
-            auto &typed_src = (Buffer<const MemType, D2, S2> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
-        } else if (T_is_void ? (type().bytes() == 4) : (sizeof(not_void_T) == 4)) {
-            using MemType = uint32_t;
-            auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)dst;
-            auto &typed_src = (Buffer<const MemType, D2, S2> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
-        } else if (T_is_void ? (type().bytes() == 8) : (sizeof(not_void_T) == 8)) {
-            using MemType = uint64_t;
-            auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)dst;
-            auto &typed_src = (Buffer<const MemType, D2, S2> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
+        const halide_buffer_t *buffers[] = {&dst.buf, &src.buf};
+        const int bytes = T_is_void ? type().bytes() : sizeof(not_void_T);
+        if (bytes == 1) {
+            Buffer<>::copy_values<uint8_t, parallel>(buffers);
+        } else if (bytes == 2) {
+            Buffer<>::copy_values<uint16_t, parallel>(buffers);
+        } else if (bytes == 4) {
+            Buffer<>::copy_values<uint32_t, parallel>(buffers);
+        } else if (bytes == 8) {
+            Buffer<>::copy_values<uint64_t, parallel>(buffers);
         } else {
             assert(false && "type().bytes() must be 1, 2, 4, or 8");
         }
         set_host_dirty();
     }
 
+public:
+
     /** Make an image that refers to a sub-range of this image along
      * the given dimension. Asserts that the crop region is within
      * the existing bounds: you cannot "crop outwards", even if you know there
@@ -1729,11 +1763,15 @@ public:
     /** Methods for managing any GPU allocation. */
     // @{
     // Set the host dirty flag. Called by every operator()
-    // access. Must be inlined so it can be hoisted out of loops.
+    // access. Must be inlined so it can be hoisted out of loops. Only
+    // writes the flag if it changes, so that accesses from several
+    // threads at once to a buffer that is already host dirty don't race.
     HALIDE_ALWAYS_INLINE
     void set_host_dirty(bool v = true) {
         assert((!v || !device_dirty()) && "Cannot set host dirty when device is already dirty. Call copy_to_host() before accessing the buffer from host.");
-        buf.set_host_dirty(v);
+        if (buf.host_dirty() != v) {
+            buf.set_host_dirty(v);
+        }
     }
 
     // Check if the device allocation is dirty. Called by
@@ -2263,6 +2301,177 @@ private:
         // zero-dimensional case
         f(*data(), (*other_buffers.data())...);
     }
+
+    // Run body(begin, end) over [0, extent) split into ranges, in parallel
+    // on the Halide runtime thread pool. Each index stands for
+    // inner_elements elements; ranges are sized so that each task does
+    // enough work to be worth the overhead of distributing it.
+    template<typename Body>
+    static void parallel_for_ranges(std::ptrdiff_t extent, std::ptrdiff_t inner_elements, Body &&body) {
+        constexpr std::ptrdiff_t min_task_elements = 16 * 1024;
+        const std::ptrdiff_t grain = std::max<std::ptrdiff_t>(1, min_task_elements / std::max<std::ptrdiff_t>(1, inner_elements));
+        const std::ptrdiff_t num_tasks = (extent + grain - 1) / grain;
+        if (num_tasks <= 1) {
+            body((std::ptrdiff_t)0, extent);
+            return;
+        }
+        struct Closure {
+            typename std::remove_reference<Body>::type *body;
+            std::ptrdiff_t extent, grain;
+        } closure{&body, extent, grain};
+        halide_task_t task = [](void *user_context, int idx, uint8_t *c) -> int {
+            const Closure *closure = (const Closure *)c;
+            const std::ptrdiff_t begin = idx * closure->grain;
+            (*closure->body)(begin, std::min(begin + closure->grain, closure->extent));
+            return 0;
+        };
+        (void)halide_do_par_for(nullptr, task, 0, (int)num_tasks, (uint8_t *)&closure);
+    }
+
+    // Run body(slice_t, offsets) in parallel over slices of the outermost
+    // of the d + 1 dimensions in t, where slice_t describes the slice and
+    // offsets are the offsets of its first element in each buffer.
+    template<int N, typename Body>
+    static void parallel_for_slices(int d, const for_each_value_task_dim<N> *t, Body &&body) {
+        std::ptrdiff_t inner_elements = 1;
+        for (int i = 0; i < d; i++) {
+            inner_elements *= t[i].extent;
+        }
+        parallel_for_ranges(t[d].extent, inner_elements, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+            const size_t alloc_size = (d + 1) * sizeof(for_each_value_task_dim<N>);
+            for_each_value_task_dim<N> *slice_t = (for_each_value_task_dim<N> *)HALIDE_ALLOCA(alloc_size);
+            memcpy((void *)slice_t, (const void *)t, alloc_size);
+            slice_t[d].extent = end - begin;
+            std::ptrdiff_t offsets[N];
+            for (int j = 0; j < N; j++) {
+                offsets[j] = begin * t[d].stride[j];
+            }
+            body((const for_each_value_task_dim<N> *)slice_t, (const std::ptrdiff_t *)offsets);
+        });
+    }
+
+    template<typename Fn, typename Ptr, typename... Ptrs>
+    HALIDE_ALWAYS_INLINE static void for_each_value_helper_at(Fn &&f, int d, bool innermost_strides_are_one,
+                                                              const for_each_value_task_dim<sizeof...(Ptrs) + 1> *t,
+                                                              const std::ptrdiff_t *offsets, Ptr ptr, Ptrs... ptrs) {
+        advance_ptrs(offsets, ptr, ptrs...);
+        for_each_value_helper(f, d, innermost_strides_are_one, t, ptr, ptrs...);
+    }
+
+    template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
+    void for_each_value_parallel_impl(Fn &&f, Args &&...other_buffers) const {
+        if (dimensions() > 0) {
+            const size_t alloc_size = dimensions() * sizeof(for_each_value_task_dim<N>);
+            Buffer<>::for_each_value_task_dim<N> *t =
+                (Buffer<>::for_each_value_task_dim<N> *)HALIDE_ALLOCA(alloc_size);
+            const halide_buffer_t *buffers[] = {&buf, (&other_buffers.buf)...};
+            auto [new_dims, innermost_strides_are_one] = Buffer<>::for_each_value_prep(t, buffers);
+            if (new_dims > 0) {
+                const int d = new_dims - 1;
+                const bool inner_one = innermost_strides_are_one;
+                Buffer<>::parallel_for_slices(d, t, [&](const Buffer<>::for_each_value_task_dim<N> *slice_t, const std::ptrdiff_t *offsets) {
+                    Buffer<>::for_each_value_helper_at(f, d, inner_one, slice_t, offsets,
+                                                       data(), (other_buffers.data())...);
+                });
+                return;
+            }
+        }
+
+        // zero-dimensional case
+        f(*data(), (*other_buffers.data())...);
+    }
+
+    // Copy between the host allocations of buffers[1] and buffers[0],
+    // which must have the same shape.
+    template<typename MemType, bool parallel>
+    HALIDE_NEVER_INLINE static void copy_values(const halide_buffer_t **buffers) {
+        MemType *dst = (MemType *)buffers[0]->host;
+        const MemType *src = (const MemType *)buffers[1]->host;
+        if (buffers[0]->dimensions == 0) {
+            *dst = *src;
+            return;
+        }
+        const size_t alloc_size = buffers[0]->dimensions * sizeof(for_each_value_task_dim<2>);
+        for_each_value_task_dim<2> *t = (for_each_value_task_dim<2> *)HALIDE_ALLOCA(alloc_size);
+        // This sorts the dimensions by source stride, and flattens dimensions
+        // that are dense in both buffers.
+        const int d = for_each_value_prep(t, buffers).first - 1;
+        // If the destination is densest along some other dimension (e.g.
+        // when copying planar to interleaved), make that the second
+        // innermost dimension, so that copy_values_helper copies tiles of
+        // it and the innermost dimension instead of making several
+        // passes over the destination.
+        int dst_inner = 0;
+        for (int i = 1; i <= d; i++) {
+            if (std::abs(t[i].stride[0]) < std::abs(t[dst_inner].stride[0])) {
+                dst_inner = i;
+            }
+        }
+        if (dst_inner > 1) {
+            std::rotate(t + 1, t + dst_inner, t + dst_inner + 1);
+        }
+        if (d < 0) {
+            *dst = *src;
+        } else if constexpr (!parallel) {
+            copy_values_helper(d, t, dst, src);
+        } else {
+            parallel_for_slices(d, t, [&](const for_each_value_task_dim<2> *slice_t, const std::ptrdiff_t *offsets) {
+                copy_values_helper(d, slice_t, dst + offsets[0], src + offsets[1]);
+            });
+        }
+    }
+
+    template<typename MemType>
+    static void copy_values_helper(int d, const for_each_value_task_dim<2> *t, MemType *dst, const MemType *src) {
+        if (d == 0) {
+            if (t[0].stride[0] == 1 && t[0].stride[1] == 1) {
+                memcpy(dst, src, t[0].extent * sizeof(MemType));
+            } else {
+                const std::ptrdiff_t dst_stride = t[0].stride[0], src_stride = t[0].stride[1];
+                for (std::ptrdiff_t i = t[0].extent; i != 0; i--) {
+                    *dst = *src;
+                    dst += dst_stride;
+                    src += src_stride;
+                }
+            }
+        } else if (d == 1 && std::abs(t[1].stride[0]) < std::abs(t[0].stride[0])) {
+            // The innermost two dimensions are transposed relative to each
+            // other. Reading whole rows would write one element per cache
+            // line, so copy in square tiles that span a cache line in
+            // both buffers.
+            constexpr std::ptrdiff_t tile = std::max<std::ptrdiff_t>(8, 64 / sizeof(MemType));
+            const std::ptrdiff_t dst_x = t[0].stride[0], src_x = t[0].stride[1];
+            const std::ptrdiff_t dst_y = t[1].stride[0], src_y = t[1].stride[1];
+            for (std::ptrdiff_t y0 = 0; y0 < t[1].extent; y0 += tile) {
+                const std::ptrdiff_t y1 = std::min(y0 + tile, t[1].extent);
+                for (std::ptrdiff_t x0 = 0; x0 < t[0].extent; x0 += tile) {
+                    const std::ptrdiff_t x1 = std::min(x0 + tile, t[0].extent);
+                    if (y1 - y0 == tile) {
+                        // Write whole cache lines of the destination in order.
+                        for (std::ptrdiff_t x = x0; x < x1; x++) {
+                            for (std::ptrdiff_t y = y0; y < y1; y++) {
+                                dst[x * dst_x + y * dst_y] = src[x * src_x + y * src_y];
+                            }
+                        }
+                    } else {
+                        // The tile is narrow (e.g. a few color channels), so
+                        // read the source in order instead.
+                        for (std::ptrdiff_t y = y0; y < y1; y++) {
+                            for (std::ptrdiff_t x = x0; x < x1; x++) {
+                                dst[x * dst_x + y * dst_y] = src[x * src_x + y * src_y];
+                            }
+                        }
+                    }
+                }
+            }
+        } else {
+            for (std::ptrdiff_t i = t[d].extent; i != 0; i--) {
+                copy_values_helper(d - 1, t, dst, src);
+                dst += t[d].stride[0];
+                src += t[d].stride[1];
+            }
+        }
+    }
     // @}
 
 public:
@@ -2296,6 +2505,28 @@ public:
     }
     // @}
 
+    /** Like for_each_value, but split the buffers along their outermost
+     * dimension into tasks run on the Halide runtime thread pool using
+     * halide_do_par_for, so the function may be called concurrently
+     * from several threads. This makes the Buffer depend on the Halide
+     * runtime, so it is opt-in. Small buffers are processed on the
+     * calling thread. */
+    // @{
+    template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
+    HALIDE_ALWAYS_INLINE const Buffer<T, Dims, InClassDimStorage> &for_each_value_parallel(Fn &&f, Args &&...other_buffers) const {
+        for_each_value_parallel_impl(f, std::forward<Args>(other_buffers)...);
+        return *this;
+    }
+
+    template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
+    HALIDE_ALWAYS_INLINE
+        Buffer<T, Dims, InClassDimStorage> &
+        for_each_value_parallel(Fn &&f, Args &&...other_buffers) {
+        for_each_value_parallel_impl(f, std::forward<Args>(other_buffers)...);
+        return *this;
+    }
+    // @}
+
 private:
     // Helper functions for for_each_element
     struct for_each_element_task_dim {
@@ -2426,6 +2657,46 @@ private:
         for_each_element(0, dimensions(), t, std::forward<Fn>(f));
     }
 
+    // The number of dimensions for_each_element iterates over for a callable.
+    template<typename Fn,
+             typename = decltype(std::declval<Fn>()((const int *)nullptr))>
+    static int for_each_element_dims(int, int dims, Fn &&f) {
+        return dims;
+    }
+
+    template<typename Fn>
+    static int for_each_element_dims(double, int dims, Fn &&f) {
+        return std::min(dims, num_args(0, std::forward<Fn>(f)));
+    }
+
+    template<typename Fn>
+    void for_each_element_parallel_impl(Fn &&f) const {
+        const int dims = dimensions();
+        const int outer = for_each_element_dims(0, dims, f) - 1;
+        if (outer < 0) {
+            for_each_element_impl(f);
+            return;
+        }
+        for_each_element_task_dim *t =
+            (for_each_element_task_dim *)HALIDE_ALLOCA(dims * sizeof(for_each_element_task_dim));
+        std::ptrdiff_t inner_elements = 1;
+        for (int i = 0; i < dims; i++) {
+            t[i].min = dim(i).min();
+            t[i].max = dim(i).max();
+            if (i < outer) {
+                inner_elements *= dim(i).extent();
+            }
+        }
+        parallel_for_ranges(dim(outer).extent(), inner_elements, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+            for_each_element_task_dim *slice_t =
+                (for_each_element_task_dim *)HALIDE_ALLOCA(dims * sizeof(for_each_element_task_dim));
+            memcpy((void *)slice_t, (const void *)t, dims * sizeof(for_each_element_task_dim));
+            slice_t[outer].min = t[outer].min + (int)begin;
+            slice_t[outer].max = t[outer].min + (int)end - 1;
+            for_each_element(0, dims, slice_t, f);
+        });
+    }
+
 public:
     /** Call a function at each site in a buffer. This is likely to be
      * much slower than using Halide code to populate a buffer, but is
@@ -2499,6 +2770,42 @@ public:
     }
     // @}
 
+    /** Like for_each_element, but split the outermost dimension iterated
+     * over into tasks run on the Halide runtime thread pool using
+     * halide_do_par_for, so the function may be called concurrently
+     * from several threads. This makes the Buffer depend on the Halide
+     * runtime, so it is opt-in. Small buffers are processed on the
+     * calling thread.
+     *
+     * Note that the non-const operator() of a Buffer marks it
+     * host-dirty, so for it to be safe to call concurrently, mark any
+     * Buffers written to (or read through a non-const reference) as
+     * host-dirty before the loop, e.g.:
+
+     \code
+     const Buffer<float, 2> &in = ...;
+     out.set_host_dirty();
+     out.for_each_element_parallel([&](int x, int y) {
+         out(x, y) = in(x, y) * 2;
+     });
+     \endcode
+     */
+    // @{
+    template<typename Fn>
+    HALIDE_ALWAYS_INLINE const Buffer<T, Dims, InClassDimStorage> &for_each_element_parallel(Fn &&f) const {
+        for_each_element_parallel_impl(f);
+        return *this;
+    }
+
+    template<typename Fn>
+    HALIDE_ALWAYS_INLINE
+        Buffer<T, Dims, InClassDimStorage> &
+        for_each_element_parallel(Fn &&f) {
+        for_each_element_parallel_impl(f);
+        return *this;
+    }
+    // @}
+
 private:
     template<typename Fn>
     struct FillHelper {
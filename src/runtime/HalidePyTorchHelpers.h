@@ -7,6 +7,7 @@
  * is included in each generated op by the PyTorch CodeGen.
  */
 
+#include <atomic>
 #include <exception>
 #include <iostream>
 #include <sstream>
@@ -15,6 +16,10 @@
 
 #include "HalideBuffer.h"
 
+#ifdef HL_PYTORCH_USE_ATEN_THREAD_POOL
+#include "ATen/Parallel.h"
+#endif
+
 // Forward declare the cuda_device_interface, for tensor wrapper.
 extern "C" const halide_device_interface_t *halide_cuda_device_interface();
 
@@ -114,6 +119,43 @@ inline Buffer<scalar_t> wrap_cuda(at::Tensor &tensor) {
     return buffer;
 }
 
+#ifdef HL_PYTORCH_USE_ATEN_THREAD_POOL
+
+/** A halide_do_par_for that runs the tasks of a parallel loop on ATen's
+ * intra-op thread pool (the one at::parallel_for uses), so that the Halide
+ * ops and the rest of the model share threads rather than oversubscribing
+ * the CPU. Inside another at::parallel_for, ATen runs the loop serially on
+ * the calling thread. */
+inline int aten_do_par_for(void *user_context, halide_task_t task, int min, int size, uint8_t *closure) {
+    std::atomic<int> result(0);
+    at::parallel_for(min, (int64_t)min + size, 1, [&](int64_t begin, int64_t end) {
+        for (int64_t x = begin; x < end && result.load(std::memory_order_relaxed) == 0; x++) {
+            int r = task(user_context, (int)x, closure);
+            if (r != 0) {
+                int expected = 0;
+                result.compare_exchange_strong(expected, r);
+            }
+        }
+    });
+    return result;
+}
+
+#endif  // HL_PYTORCH_USE_ATEN_THREAD_POOL
+
+/** Called by each generated op before it runs its pipeline. If
+ * HL_PYTORCH_USE_ATEN_THREAD_POOL is defined, this routes
+ * halide_do_par_for into ATen's thread pool (for the whole process, the
+ * first time it is called); otherwise, it does nothing, and the ops use
+ * Halide's own thread pool. Note that loops lowered to
+ * halide_do_parallel_tasks (e.g. those with async producers) still run on
+ * Halide's thread pool. */
+inline void maybe_use_aten_thread_pool() {
+#ifdef HL_PYTORCH_USE_ATEN_THREAD_POOL
+    static const bool installed = (halide_set_custom_do_par_for(aten_do_par_for), true);
+    (void)installed;
+#endif
+}
+
 }  // namespace PyTorch
 }  // namespace Halide
 
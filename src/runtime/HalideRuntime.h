@@ -287,6 +287,16 @@ struct halide_parallel_task_t {
     // one executing at a time. If false, any order is fine, and
     // concurrency is fine.
     bool serial;
+
+    // Hints for scheduling the tasks in the same list, which a
+    // parallel runtime is free to ignore. Tasks with a higher priority
+    // should be started first; Halide gives a task one more than the
+    // highest priority of the tasks that wait on it. Tasks with the
+    // same nonzero locality group are producers and consumers of each
+    // other, so running one on the thread (or a core near the one)
+    // that last ran another improves cache reuse.
+    int priority;
+    int locality_group;
 };
 
 /** Enqueue some number of the tasks described above and wait for them
@@ -355,6 +365,50 @@ extern int halide_default_semaphore_release(struct halide_semaphore_t *, int n);
 extern bool halide_default_semaphore_try_acquire(struct halide_semaphore_t *, int n);
 // @}
 
+/** Policies the default thread pool can use to decide how many
+ * iterations of a parallel loop a thread claims each time it visits
+ * the job. Claiming several at once amortizes the cost of taking the
+ * thread pool lock over loops with small bodies. Jobs that may block
+ * (those with semaphores to acquire or a nonzero min_threads) are
+ * always claimed one iteration at a time. */
+typedef enum halide_parallel_chunking_policy_t {
+    /** Claim a fraction of the remaining iterations, proportional to
+     * one over the number of threads, so that chunks shrink as the loop
+     * drains and the tail still balances well. This is the default. */
+    halide_parallel_chunking_guided = 0,
+
+    /** Claim a single iteration at a time. */
+    halide_parallel_chunking_single = 1,
+} halide_parallel_chunking_policy_t;
+
+/** Set the chunking policy used by the default thread pool. Returns
+ * the old policy. The policy can also be set with the environment
+ * variable HL_PARALLEL_CHUNKING, which may be "guided" or "single". */
+extern halide_parallel_chunking_policy_t halide_set_parallel_chunking_policy(halide_parallel_chunking_policy_t policy);
+
+/** An alternative implementation of halide_do_par_for backed by a
+ * separate pool of threads that split the loop into one contiguous
+ * range per thread, and steal iterations from each other once their
+ * own range is exhausted. This avoids taking the thread pool lock for
+ * every iteration, which helps loops with many small iterations on
+ * machines with many cores. Install it with:
+ *
+ * halide_set_custom_parallel_runtime(halide_work_stealing_do_par_for,
+ *                                    halide_default_do_task,
+ *                                    halide_default_do_loop_task,
+ *                                    halide_default_do_parallel_tasks,
+ *                                    halide_default_semaphore_init,
+ *                                    halide_default_semaphore_try_acquire,
+ *                                    halide_default_semaphore_release);
+ *
+ * Parallel tasks (async producers, and anything else that needs
+ * semaphores or serial execution) continue to run on the default
+ * thread pool. halide_set_num_threads and halide_shutdown_thread_pool
+ * apply to both pools. */
+extern int halide_work_stealing_do_par_for(void *user_context,
+                                           halide_task_t task,
+                                           int min, int size, uint8_t *closure);
+
 struct halide_thread;
 
 /** Spawn a thread. Returns a handle to the thread for the purposes of
@@ -365,6 +419,33 @@ extern struct halide_thread *halide_spawn_thread(void (*f)(void *), void *closur
 /** Join a thread. */
 extern void halide_join_thread(struct halide_thread *);
 
+/** A call to a pipeline that is running in the background, started
+ * by halide_call_async. */
+struct halide_async_call_t;
+
+/** Start a call to an AOT-compiled pipeline and return without waiting
+ * for it to finish, so that one thread can keep several pipelines in
+ * flight. fn is the pipeline's generated _argv entry point, and args
+ * the argument array to pass to it. The pipeline runs on a thread of
+ * its own, and its parallel loops and async producers still use the
+ * thread pool. args, and the buffers and scalars it points to, must
+ * stay valid until the call completes. As with a direct call, device
+ * work may still be queued when the pipeline returns; use
+ * halide_device_sync on the outputs to wait for it. On success, *call
+ * is set to a handle that must be passed to halide_async_call_wait
+ * exactly once. Returns halide_error_code_success, or
+ * halide_error_code_out_of_memory if the call could not be started.
+ * On targets without threads, the pipeline runs before this returns. */
+extern int halide_call_async(void *user_context, int (*fn)(void **), void **args,
+                             struct halide_async_call_t **call);
+
+/** Returns whether the call has completed, without blocking. */
+extern bool halide_async_call_done(struct halide_async_call_t *call);
+
+/** Wait for the call to complete and release the handle. Returns the
+ * result of the call to the pipeline. */
+extern int halide_async_call_wait(struct halide_async_call_t *call);
+
 /** Set the number of threads used by Halide's thread pool. Returns
  * the old number.
  *
@@ -379,6 +460,143 @@ extern void halide_join_thread(struct halide_thread *);
  */
 extern int halide_set_num_threads(int n);
 
+/** Policies for placing the threads of Halide's thread pools on the
+ * host's cpus. */
+typedef enum halide_thread_affinity_t {
+    /** Let the OS schedule and migrate threads freely. This is the default. */
+    halide_thread_affinity_none = 0,
+
+    /** Pin each worker thread to its own cpu. */
+    halide_thread_affinity_cpu = 1,
+
+    /** Spread the worker threads over the NUMA nodes of the host in
+     * contiguous blocks, and pin each one to the cpus of its node, so
+     * that it keeps accessing memory local to that node. */
+    halide_thread_affinity_numa_node = 2,
+} halide_thread_affinity_t;
+
+/** Set the thread placement policy. Returns the old policy. The
+ * policy applies to threads as they are created, so call this before
+ * the thread pool starts up, or call halide_shutdown_thread_pool()
+ * afterwards to recreate the threads. The policy can also be set with
+ * the environment variable HL_THREAD_AFFINITY, which may be "none",
+ * "cpu" or "numa".
+ *
+ * When the policy is not halide_thread_affinity_none,
+ * halide_work_stealing_do_par_for also hands each worker the same
+ * contiguous slice of every parallel loop, and workers steal from
+ * their neighbours (which share their node) first. Pinning is
+ * currently only implemented on Linux and Android; elsewhere the
+ * policy has no effect.
+ */
+extern halide_thread_affinity_t halide_set_thread_affinity(halide_thread_affinity_t affinity);
+
+/** An isolated thread pool, with its own worker threads and job
+ * queue, for processes that serve several independent clients or
+ * latency classes and don't want them competing in one queue. */
+struct halide_thread_pool_t;
+
+/** Scheduling priority classes for the worker threads of a
+ * halide_thread_pool_t. */
+typedef enum halide_thread_pool_priority_t {
+    /** Workers run at the default OS priority. */
+    halide_thread_pool_priority_normal = 0,
+
+    /** Workers run below the default OS priority, so that batch work
+     * yields the cpus to latency-sensitive pools and other threads.
+     * Currently only implemented on Linux and Android; elsewhere it
+     * behaves like halide_thread_pool_priority_normal. */
+    halide_thread_pool_priority_low = 1,
+} halide_thread_pool_priority_t;
+
+/** Create a thread pool with the given number of threads (0 means
+ * the same default as halide_set_num_threads(0)). The threads are
+ * started lazily the first time the pool is used. Returns nullptr if
+ * the pool could not be allocated. */
+extern struct halide_thread_pool_t *halide_thread_pool_create(int num_threads,
+                                                              halide_thread_pool_priority_t priority);
+
+/** Destroy a thread pool made by halide_thread_pool_create, joining
+ * its threads and removing any bindings to it. No pipeline may be
+ * running on the pool when it is destroyed. */
+extern void halide_thread_pool_destroy(struct halide_thread_pool_t *pool);
+
+/** Make the default implementations of halide_do_par_for and
+ * halide_do_parallel_tasks run any parallel work called with the given
+ * user_context on the given pool, instead of the default thread
+ * pool. For JIT-compiled code the user_context is the JITUserContext
+ * passed to realize. Passing a nullptr pool removes the binding. The
+ * binding must not change while a pipeline using the user_context is
+ * running. Returns halide_error_code_success, or
+ * halide_error_code_out_of_memory if the binding could not be
+ * recorded. */
+extern int halide_thread_pool_bind(void *user_context, struct halide_thread_pool_t *pool);
+
+/** How a thread of a thread pool spent its time while stats collection
+ * was enabled. Times are in nanoseconds, and are left at zero on
+ * platforms without a clock (e.g. Hexagon). */
+struct halide_thread_pool_thread_stats_t {
+    /** Time spent running tasks. */
+    uint64_t busy_ns;
+
+    /** Time spent yielding while waiting for work, before sleeping. */
+    uint64_t spin_ns;
+
+    /** Time spent asleep with no work in the queue. */
+    uint64_t idle_ns;
+
+    /** Time spent asleep because the only work in the queue was
+     * waiting on semaphores (e.g. consumers of async producers). */
+    uint64_t blocked_ns;
+
+    /** Time spent waiting to reacquire the thread pool lock after
+     * running a task. A large value relative to busy_ns means the
+     * tasks are too small for the pool. */
+    uint64_t lock_wait_ns;
+
+    /** The number of times this thread claimed iterations of a job. */
+    uint64_t tasks;
+};
+
+/** A snapshot of the stats of a thread pool. */
+struct halide_thread_pool_stats_t {
+    /** Whether stats collection is enabled. */
+    bool enabled;
+
+    /** The number of worker threads the pool has created. */
+    int num_workers;
+
+    /** The sum over all worker threads. */
+    struct halide_thread_pool_thread_stats_t workers_total;
+
+    /** The calling threads, which work on their own jobs (and
+     * others') while waiting for them to finish. */
+    struct halide_thread_pool_thread_stats_t callers;
+
+    /** The number of jobs enqueued, and the largest number of jobs
+     * that were in the queue at once. */
+    uint64_t jobs_enqueued;
+    int max_queue_depth;
+};
+
+/** Enable or disable collecting stats for a thread pool (the default
+ * pool if pool is nullptr). Enabling stats when they were disabled
+ * resets them to zero. Stats can also be enabled for all pools by
+ * setting the environment variable HL_THREAD_POOL_STATS=1. They
+ * cost a few clock reads per task while enabled. When enabled for the
+ * default pool, halide_profiler_report includes them. Returns
+ * halide_error_code_success. */
+extern int halide_thread_pool_enable_stats(struct halide_thread_pool_t *pool, bool enable);
+
+/** Get the stats of a thread pool (the default pool if pool is
+ * nullptr). If workers is not nullptr, the stats of up to
+ * max_workers individual worker threads are also copied to it, in
+ * the order they were created. Returns halide_error_code_success. */
+extern int halide_thread_pool_get_stats(struct halide_thread_pool_t *pool,
+                                        struct halide_thread_pool_stats_t *stats,
+                                        struct halide_thread_pool_thread_stats_t *workers,
+                                        int max_workers);
+
 /** Halide calls these functions to allocate and free memory. To
  * replace in AOT code, use the halide_set_custom_malloc and
  * halide_set_custom_free, or (on platforms that support weak
@@ -407,6 +625,87 @@ extern halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc);
 extern halide_free_t halide_set_custom_free(halide_free_t user_free);
 //@}
 
+/** Set whether halide_default_malloc pools host allocations. When
+ * enabled, sizes are rounded up to one of a set of size classes, and
+ * freed blocks are kept on per-thread free lists for reuse instead
+ * of being returned to the system, up to the retained size set by
+ * halide_host_allocation_pool_set_size (64MB by default). Disabling
+ * it releases all retained blocks. Off by default. Blocks may be
+ * freed after the flag changes in either direction. Returns
+ * halide_error_code_success. */
+extern int halide_reuse_host_allocations(void *user_context, bool flag);
+
+/** Set the maximum number of bytes of freed host allocations that
+ * halide_reuse_host_allocations retains. Zero restores the default. */
+extern void halide_host_allocation_pool_set_size(int64_t size);
+
+/** Statistics for the host allocation pool. */
+struct halide_host_allocation_pool_stats_t {
+    /** The number of pooled allocations, and how many of those reused
+     * a retained block. */
+    uint64_t mallocs, reused;
+
+    /** The number of pooled blocks freed, and how many of those (or of
+     * the retained blocks) were returned to the system. */
+    uint64_t frees, released;
+
+    /** The bytes currently retained, and the maximum retained. */
+    int64_t retained_bytes, max_retained_bytes;
+};
+
+/** Get statistics for the host allocation pool. Returns
+ * halide_error_code_success. */
+extern int halide_host_allocation_pool_get_stats(struct halide_host_allocation_pool_stats_t *stats);
+
+/** Flags for halide_set_host_memory_policy, which may be or'd
+ * together. */
+typedef enum halide_host_memory_policy_t {
+    /** Allocate from the heap. */
+    halide_host_memory_policy_default = 0,
+    /** Back allocations with 2MB transparent huge pages, to reduce
+     * TLB misses. */
+    halide_host_memory_policy_huge_pages = 1,
+    /** Back allocations with 1GB pages from the hugetlbfs reserve,
+     * falling back to 2MB pages if it is empty, as it is unless the
+     * administrator set one up. */
+    halide_host_memory_policy_gigantic_pages = 2,
+    /** Interleave the pages of each allocation across all NUMA nodes,
+     * so that a parallel loop reading the whole of it is served by
+     * all of their memory controllers. Without this, each page is
+     * placed on the node of the thread that first touches it. */
+    halide_host_memory_policy_numa_interleave = 4,
+} halide_host_memory_policy_t;
+
+/** Set how halide_default_malloc places allocations of at least
+ * min_size bytes (zero means the default of 16MB). Such allocations
+ * are mapped directly from the OS, with fresh pages, and skip the
+ * pool enabled by halide_reuse_host_allocations. Only supported on
+ * x86 Linux; elsewhere, and if the pages can't be mapped, allocations
+ * come from the heap as usual. Blocks may be freed after the policy
+ * changes. Returns halide_error_code_success. */
+extern int halide_set_host_memory_policy(int policy, size_t min_size);
+
+/** Free the blocks kept across calls by heap allocations in pipelines
+ * compiled with the workspace target feature. Blocks in use by running
+ * pipelines are kept. The next call of each pipeline allocates again. */
+extern void halide_release_workspaces(void *user_context);
+
+/** Pipelines compiled with the static_workspace target feature make no
+ * heap allocations. Instead, every intermediate is placed at an offset,
+ * fixed at compile time, in one workspace, of a size also fixed at
+ * compile time (it is reported to the CompilerLogger, and in the debug
+ * output at HL_DEBUG_CODEGEN=1). The pipeline gets the workspace by
+ * calling halide_static_workspace_malloc at the start of each call. The
+ * default implementation returns the block passed to
+ * halide_set_static_workspace, or calls halide_error and returns null
+ * if there is none or it is too small. A workspace may only be used by
+ * one pipeline call at a time. To give each pipeline or thread its own,
+ * define halide_static_workspace_malloc yourself. */
+//@{
+extern void halide_set_static_workspace(void *ptr, size_t size);
+extern void *halide_static_workspace_malloc(void *user_context, size_t size);
+//@}
+
 /** Halide calls these functions to interact with the underlying
  * system runtime functions. To replace in AOT code on platforms that
  * support weak linking, define these functions yourself, or use
@@ -611,7 +910,10 @@ struct halide_trace_event_t {
  * HL_TRACE_FILE is defined, dumps the trace to that file in a
  * sequence of trace packets. The header for a trace packet is defined
  * below. If the trace is going to be large, you may want to make the
- * file a named pipe, and then read from that pipe into gzip.
+ * file a named pipe, and then read from that pipe into gzip, or set
+ * HL_TRACE_COMPRESS=1 to write a compact encoding that the tools in
+ * util/ understand. Setting HL_TRACE_SAMPLE=N records only one out of
+ * every N load and store events.
  *
  * halide_trace returns a unique ID which will be passed to future
  * events that "belong" to the earlier event as the parent id. The
@@ -744,6 +1046,46 @@ extern int halide_get_trace_file(void *user_context);
  * (flushing the trace). Returns zero on success. */
 extern int halide_shutdown_trace();
 
+/** Called by pipelines that use Func::notify_completion each time an
+ * iteration of the chosen loop of the Func has finished, with the
+ * region of the Func it computed, so that consumers of the output can
+ * start on it before the pipeline returns. The region has the given
+ * number of dimensions, with the mins and extents in the arrays
+ * given. The arrays are only valid for the duration of the call. If
+ * the loop is parallel, calls may be concurrent and in any order, and
+ * the regions of neighboring iterations may overlap if the loop was
+ * split with TailStrategy::ShiftInwards. Return zero to continue, or
+ * an error code to abort the pipeline with it. The default
+ * implementation does nothing. */
+// @{
+extern int halide_region_complete(void *user_context, const char *func, int dimensions,
+                                  const int32_t *min, const int32_t *extent);
+extern int halide_default_region_complete(void *user_context, const char *func, int dimensions,
+                                          const int32_t *min, const int32_t *extent);
+typedef int (*halide_region_complete_t)(void *user_context, const char *func, int dimensions,
+                                        const int32_t *min, const int32_t *extent);
+extern halide_region_complete_t halide_set_custom_region_complete(halide_region_complete_t handler);
+// @}
+
+/** Start recording a timeline of per-thread spans, to be written to
+ * the named file as Chrome trace event JSON, which chrome://tracing
+ * and the Perfetto UI can open. The spans cover each chunk of a
+ * parallel loop run by the thread pool, waits on the semaphores of
+ * async producers, device copies, and device kernel launches. Pipelines
+ * compiled with trace_pipeline or trace_realizations also report their
+ * start and end, or their produce and consume nodes, and while a
+ * timeline is being recorded those trace events are not printed to
+ * stdout. If never called, Halide checks for an environment variable
+ * called HL_TIMELINE_FILE when it loads, and records a timeline to that
+ * file if it is set. Calling this while a timeline is being recorded
+ * changes the file it will be written to. Returns zero on success. */
+extern int halide_set_timeline_file(const char *filename);
+
+/** Stop recording the timeline and write it out. This is called
+ * automatically at exit. Returns zero on success, including when no
+ * timeline was being recorded. */
+extern int halide_shutdown_timeline();
+
 /** All Halide GPU or device backend implementations provide an
  * interface to be used with halide_device_malloc, etc. This is
  * accessed via the functions below.
@@ -816,6 +1158,21 @@ extern int halide_copy_to_host(void *user_context, struct halide_buffer_t *buf);
 extern int halide_copy_to_device(void *user_context, struct halide_buffer_t *buf,
                                  const struct halide_device_interface_t *device_interface);
 
+/** Versions of halide_copy_to_host and halide_copy_to_device that only
+ * move the part of buf within [min, min + extent), given per
+ * dimension, e.g. the region of an input a pipeline actually reads. If
+ * the region is all of buf, these are equivalent to the full copies.
+ * Otherwise buf keeps its dirty bits, as the rest of the destination
+ * is still stale, so a later full copy moves everything again. Not
+ * supported by device interfaces that can't crop buffers. */
+// @{
+extern int halide_copy_region_to_host(void *user_context, struct halide_buffer_t *buf,
+                                      const int *min, const int *extent);
+extern int halide_copy_region_to_device(void *user_context, struct halide_buffer_t *buf,
+                                        const struct halide_device_interface_t *device_interface,
+                                        const int *min, const int *extent);
+// @}
+
 /** Copy data from one buffer to another. The buffers may have
  * different shapes and sizes, but the destination buffer's shape must
  * be contained within the source buffer's shape. That is, for each
@@ -918,6 +1275,14 @@ extern int halide_get_gpu_device(void *user_context);
  */
 extern void halide_memoization_cache_set_size(int64_t size);
 
+/** Set the soft maximum amount of device memory, in bytes, that the
+ * memoization cache will use. A memoized Func computed on a device
+ * keeps its device allocation in the cache, in addition to its host
+ * memory, so that later hits can use it in place without copying it
+ * to and from the host. Such entries are also evicted to stay within
+ * this budget. A size of zero resets it to the default. */
+extern void halide_memoization_cache_set_device_size(int64_t size);
+
 /** Given a cache key for a memoized result, currently constructed
  *  from the Func name and top-level Func name plus the arguments of
  *  the computation, determine if the result is in the cache and
@@ -984,11 +1349,91 @@ extern void halide_memoization_cache_evict(void *user_context, uint64_t eviction
  */
 extern void halide_memoization_cache_release(void *user_context, void *host);
 
+/** Called by a pipeline when it is done with the device allocation of
+ * a buffer returned by halide_memoization_cache_lookup. If the
+ * allocation is held by the cache, it is detached from the buffer,
+ * and otherwise it is freed with halide_device_free. */
+extern int halide_memoization_cache_release_device(void *user_context, struct halide_buffer_t *buf);
+
 /** Free all memory and resources associated with the memoization cache.
  * Must be called at a time when no other threads are accessing the cache.
  */
 extern void halide_memoization_cache_cleanup();
 
+/** Set a budget, in bytes, for the entries of the memoization cache
+ * tagged with the given eviction_key, so that one memoized Func can't
+ * evict everything else. Entries with that key are evicted to stay
+ * within it, in addition to the budget for the whole cache set by
+ * halide_memoization_cache_set_size. A size of zero removes the
+ * budget. Returns halide_error_code_out_of_memory if the budget
+ * can't be recorded. */
+extern int halide_memoization_cache_set_eviction_key_size(uint64_t eviction_key, int64_t size);
+
+/** Return the bytes currently stored in the memoization cache by
+ * entries tagged with the given eviction_key. */
+extern int64_t halide_memoization_cache_get_eviction_key_usage(uint64_t eviction_key);
+
+/** Statistics for the memoization cache. */
+struct halide_memoization_cache_stats_t {
+    /** The number of lookups that found, or didn't find, a stored result. */
+    uint64_t hits, misses;
+
+    /** The number of results stored, and the number evicted, either
+     * to stay within a budget or by halide_memoization_cache_evict. */
+    uint64_t stores, evictions;
+
+    /** The bytes of results evicted. */
+    uint64_t bytes_evicted;
+
+    /** The number of entries currently in the cache. */
+    uint64_t entries;
+
+    /** The bytes currently stored, and the budget for them. */
+    int64_t bytes_stored, max_size;
+
+    /** The bytes of device allocations currently held, and the budget
+     * for them. See halide_memoization_cache_set_device_size. */
+    int64_t device_bytes_stored, max_device_size;
+};
+
+/** Get statistics for the memoization cache. The counts are since
+ * the process started or halide_memoization_cache_reset_stats was
+ * last called. Returns halide_error_code_success. */
+extern int halide_memoization_cache_get_stats(struct halide_memoization_cache_stats_t *stats);
+
+/** Reset the counts returned by halide_memoization_cache_get_stats. */
+extern void halide_memoization_cache_reset_stats();
+
+/** A second level for the memoization cache, such as one shared by
+ * several processes. On a miss in the in-process cache, lookup is
+ * called with the host memory of tuple_buffers already allocated; it
+ * should fill that in and return 0 if it has the result, or return 1
+ * if not. store is given each newly computed result, and must copy
+ * whatever it keeps. Both may be called from many threads at once. */
+struct halide_memoization_cache_backend_t {
+    int (*lookup)(void *user_context, const uint8_t *cache_key, int32_t size,
+                  struct halide_buffer_t *computed_bounds,
+                  int32_t tuple_count, struct halide_buffer_t **tuple_buffers);
+    void (*store)(void *user_context, const uint8_t *cache_key, int32_t size,
+                  struct halide_buffer_t *computed_bounds,
+                  int32_t tuple_count, struct halide_buffer_t **tuple_buffers);
+};
+
+/** Set the backend for the memoization cache, or remove it if
+ * backend is nullptr. The backend must stay valid until it is
+ * replaced and no pipelines are running. */
+extern void halide_memoization_cache_set_backend(const struct halide_memoization_cache_backend_t *backend);
+
+/** Share memoized results with other processes through a region of
+ * memory mapped into each of them at the same size, e.g. with
+ * shm_open, ftruncate and mmap(MAP_SHARED). The region must start
+ * out zeroed and be 16-byte aligned; the first process to call this
+ * formats it. Results are copied in once and never modified, so each
+ * process only ever reads others' results. When the region is full,
+ * new results are no longer shared. This sets the memoization cache
+ * backend; passing nullptr removes it. */
+extern int halide_memoization_cache_use_shared_memory(void *memory, size_t size);
+
 /** Verify that a given range of memory has been initialized; only used when Target::MSAN is enabled.
  *
  * The default implementation simply calls the LLVM-provided __msan_check_mem_is_initialized() function.
@@ -1403,6 +1848,20 @@ typedef enum halide_target_feature_t {
     halide_target_feature_vulkan_version12,       ///< Enable Vulkan v1.2 runtime target support.
     halide_target_feature_vulkan_version13,       ///< Enable Vulkan v1.3 runtime target support.
     halide_target_feature_semihosting,            ///< Used together with Target::NoOS for the baremetal target built with semihosting library and run with semihosting mode where minimum I/O communication with a host PC is available.
+    halide_target_feature_auto_prefetch,          ///< Automatically prefetch strided streaming loads in innermost loops.
+    halide_target_feature_workspace,              ///< Keep heap allocations of intermediates between calls of an AOT pipeline. See halide_release_workspaces.
+    halide_target_feature_plan_memory,            ///< Pack the heap allocations of intermediates outside of loops into one block, sharing memory between allocations that are not live at the same time.
+    halide_target_feature_vector_math,            ///< Use Halide's vectorizable approximations for vectorized calls to trigonometric functions, instead of calling the math library once per lane.
+    halide_target_feature_avx512_fp16,            ///< Native float16 arithmetic using AVX512-FP16 (Sapphire Rapids).
+    halide_target_feature_profile_guided,         ///< Use the profile in the file named by HL_PROFILE_FILE to shrink cold code.
+    halide_target_feature_specialize_dense_strides,  ///< Add versions of loop nests for input buffers with an innermost stride of one, selected at runtime.
+    halide_target_feature_arm_i8mm,               ///< Enable ARMv8.6-a int8 matrix multiply instructions.
+    halide_target_feature_arm_bf16,               ///< Enable ARMv8.6-a bfloat16 dot product and matrix multiply instructions.
+    halide_target_feature_profile_stages,         ///< Have the profiler bill each update definition and specialization of a Func separately.
+    halide_target_feature_profile_memory_traffic,  ///< Have the profiler count the bytes loaded and stored and the arithmetic done by each Func.
+    halide_target_feature_wasm_relaxed_simd,      ///< Enable relaxed SIMD instructions for WebAssembly codegen. Requires wasm_simd128.
+    halide_target_feature_static_workspace,       ///< Place all heap allocations in one block of a size fixed at compile time, provided by halide_static_workspace_malloc(). For targets without malloc.
+    halide_target_feature_c_plus_plus_parallel_for,  ///< In C++ output, emit parallel loops as calls to HALIDE_C_PARALLEL_FOR (OpenMP by default) rather than to halide_do_par_for.
     halide_target_feature_end                     ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
@@ -1480,7 +1939,13 @@ typedef struct halide_dimension_t {
 #endif
 
 typedef enum { halide_buffer_flag_host_dirty = 1,
-               halide_buffer_flag_device_dirty = 2 } halide_buffer_flags;
+               halide_buffer_flag_device_dirty = 2,
+               /** Set before calling halide_device_and_host_malloc to
+                * request page-locked host memory from device APIs that
+                * support it. Cleared by the runtime if the host
+                * allocation it made is not page-locked, so it must not
+                * be changed while the allocation is live. */
+               halide_buffer_flag_pinned_host = 4 } halide_buffer_flags;
 
 /**
  * The raw representation of an image passed around by generated
@@ -1545,6 +2010,14 @@ typedef struct halide_buffer_t {
     HALIDE_ALWAYS_INLINE void set_device_dirty(bool v = true) {
         set_flag(halide_buffer_flag_device_dirty, v);
     }
+
+    HALIDE_ALWAYS_INLINE bool pinned_host() const {
+        return get_flag(halide_buffer_flag_pinned_host);
+    }
+
+    HALIDE_ALWAYS_INLINE void set_pinned_host(bool v = true) {
+        set_flag(halide_buffer_flag_pinned_host, v);
+    }
     // @}
 
     /** The total number of elements this buffer represents. Equal to
@@ -1775,6 +2248,12 @@ void halide_register_argv_and_metadata(
  * the -profile target flag, which runs a sampling profiler thread
  * alongside the pipeline. */
 
+/** The number of buckets in the profiler's time histograms. Bucket i
+ * counts the runs that took between 2^i and 2^(i+1) nanoseconds. The
+ * first bucket also counts runs that took no time at all, and the last
+ * one counts everything longer. */
+#define HALIDE_PROFILER_HISTOGRAM_BUCKETS 40
+
 /** Per-Func state tracked by the sampling profiler. */
 struct HALIDE_ATTRIBUTE_ALIGN(8) halide_profiler_func_stats {
     /** Total time taken evaluating this Func (in nanoseconds). */
@@ -1795,11 +2274,51 @@ struct HALIDE_ATTRIBUTE_ALIGN(8) halide_profiler_func_stats {
     /** The average number of thread pool worker threads active while computing this Func. */
     uint64_t active_threads_numerator, active_threads_denominator;
 
+    /** The current, peak, and total device memory allocated through
+     * halide_device_malloc while this Func was running. */
+    uint64_t device_memory_current, device_memory_peak, device_memory_total;
+
+    /** The number of bytes copied to and from the device while this
+     * Func was running, and the time spent in those copies (in
+     * nanoseconds). */
+    uint64_t copy_to_device_bytes, copy_to_host_bytes;
+    uint64_t copy_to_device_time, copy_to_host_time;
+
+    /** The time spent running this Func's device kernels, as measured
+     * on the device (in nanoseconds). Only recorded if the environment
+     * variable HL_PROFILER_TIME_KERNELS is set. */
+    uint64_t kernel_time;
+
     /** The name of this Func. A global constant string. */
     const char *name;
 
     /** The total number of memory allocation of this Func. */
     int num_allocs;
+
+    /** The number of device allocations made while this Func was
+     * running, and how many of them were served by a device allocation
+     * cache or suballocator rather than the device API. */
+    int device_num_allocs, device_pool_hits;
+
+    /** The number of device kernels of this Func that were timed. */
+    int num_kernels;
+
+    /** A histogram of the time billed to this Func in each sampled
+     * run of its pipeline. Runs in which the Func was never sampled
+     * count in the first bucket. The counts decay like those of the
+     * pipeline's histogram. */
+    double time_histogram[HALIDE_PROFILER_HISTOGRAM_BUCKETS];
+
+    /** The decayed total of the time billed to this Func in sampled
+     * runs (in nanoseconds). Divide by the pipeline's decayed_runs for
+     * the recent average time per run. */
+    double decayed_time;
+
+    /** The bytes loaded and stored by the loops computing this Func,
+     * and the arithmetic operations (counting each vector lane) in
+     * them. Only counted with the profile_memory_traffic target
+     * feature. Conditional code is counted as if it always runs. */
+    uint64_t bytes_loaded, bytes_stored, arithmetic_ops;
 };
 
 /** Per-pipeline state tracked by the sampling profiler. These exist
@@ -1821,6 +2340,19 @@ struct HALIDE_ATTRIBUTE_ALIGN(8) halide_profiler_pipeline_stats {
      * work while computing this pipeline. */
     uint64_t active_threads_numerator, active_threads_denominator;
 
+    /** The current, peak, and total device memory allocated by funcs in
+     * this pipeline. */
+    uint64_t device_memory_current, device_memory_peak, device_memory_total;
+
+    /** Bytes copied to and from the device during this pipeline, and
+     * the time spent in those copies (in nanoseconds). */
+    uint64_t copy_to_device_bytes, copy_to_host_bytes;
+    uint64_t copy_to_device_time, copy_to_host_time;
+
+    /** The time spent running device kernels during this pipeline, as
+     * measured on the device (in nanoseconds). */
+    uint64_t kernel_time;
+
     /** The name of this pipeline. A global constant string. */
     const char *name;
 
@@ -1840,11 +2372,42 @@ struct HALIDE_ATTRIBUTE_ALIGN(8) halide_profiler_pipeline_stats {
     /** The number of times this pipeline has been run. */
     int runs;
 
-    /** The total number of samples taken inside of this pipeline. */
+    /** The total number of samples taken inside of this pipeline,
+     * counting each thread billed by a sample separately. */
     int samples;
 
     /** The total number of memory allocation of funcs in this pipeline. */
     int num_allocs;
+
+    /** The number of device allocations made during this pipeline, and
+     * how many of them were served by a device allocation cache or
+     * suballocator. */
+    int device_num_allocs, device_pool_hits;
+
+    /** The number of device kernels that were timed during this pipeline. */
+    int num_kernels;
+
+    /** The number of runs that were sampled. Only these are billed
+     * time, so time / sampled_runs is the average time per run. Memory
+     * statistics cover every run. */
+    int sampled_runs;
+
+    /** A histogram of the wall-clock time of the sampled runs. Counts
+     * are halved once per half_life_ms of the profiler state, so that
+     * they describe recent runs. */
+    double time_histogram[HALIDE_PROFILER_HISTOGRAM_BUCKETS];
+
+    /** The decayed number of sampled runs, and their decayed total
+     * wall-clock time (in nanoseconds). */
+    double decayed_runs, decayed_time;
+
+    /** When the counts were last decayed (in nanoseconds, on the
+     * clock of halide_current_time_ns). */
+    uint64_t decay_time;
+
+    /** The totals of the memory traffic counters of the funcs in this
+     * pipeline. */
+    uint64_t bytes_loaded, bytes_stored, arithmetic_ops;
 };
 
 /** The global state of the profiler. */
@@ -1862,11 +2425,13 @@ struct halide_profiler_state {
     /** An internal id used for bookkeeping. */
     int first_free_id;
 
-    /** The id of the current running Func. Set by the pipeline, read
-     * periodically by the profiler thread. */
+    /** The id of the current running Func. Only set directly by code
+     * running on remote devices, and to halide_profiler_please_stop
+     * at shutdown; pipelines running on the host report through
+     * their halide_profiler_instance_state instead. */
     int current_func;
 
-    /** The number of threads currently doing work. */
+    /** The number of threads currently doing work remotely. */
     int active_threads;
 
     /** A linked list of stats gathered for each pipeline. */
@@ -1879,6 +2444,60 @@ struct halide_profiler_state {
 
     /** Sampling thread reference to be joined at shutdown. */
     struct halide_thread *sampling_thread;
+
+    /** A linked list of the pipeline instances currently running. */
+    struct halide_profiler_instance_state *instances;
+
+    /** Only one in this many runs of each pipeline is sampled, which
+     * makes the profiler cheap enough to leave on in production. The
+     * other runs still track memory, but are never billed time.
+     * Defaults to 1, or the value of HL_PROFILER_SAMPLE_RUNS. */
+    int runs_per_sample;
+
+    /** The half-life of the counts in the time histograms, in
+     * milliseconds, or zero for them to never decay. Defaults to
+     * 60000, or the value of HL_PROFILER_HALF_LIFE_MS. */
+    int half_life_ms;
+};
+
+/** The number of threads per running pipeline instance whose current
+ * Func is tracked separately. */
+#define HALIDE_PROFILER_MAX_SLOTS 64
+
+/** The per-invocation state of a running pipeline, which lives on its
+ * stack for as long as it runs. Each thread working on the pipeline
+ * reports the Func it is running in a slot of its own, so that the
+ * sampler can bill concurrent pipelines, and parallel tasks running
+ * different Funcs, separately. */
+struct halide_profiler_instance_state {
+    /** The id of the Func running in each slot. Slot 0 belongs to
+     * the code outside of parallel leaf tasks; the other slots are
+     * claimed by threads running a parallel leaf task. */
+    int current_func[HALIDE_PROFILER_MAX_SLOTS];
+
+    /** Bit i is set while slot i is claimed. Slot 0 is never
+     * claimed; it is billed when no other slot is. */
+    uint64_t claimed_slots;
+
+    /** The number of threads currently doing work on this instance. */
+    int active_threads;
+
+    /** The next running instance. */
+    struct halide_profiler_instance_state *next;
+
+    /** The stats of the pipeline this is an instance of. */
+    struct halide_profiler_pipeline_stats *pipeline;
+
+    /** The time billed to each Func of the pipeline during this run,
+     * if this run is sampled, from which its histograms are updated
+     * when it ends. Null otherwise. */
+    uint64_t *func_time;
+
+    /** When this run started (on the clock of halide_current_time_ns). */
+    uint64_t start_time;
+
+    /** Whether this run is sampled. */
+    int sampled;
 };
 
 /** Profiler func ids with special meanings. */
@@ -1925,6 +2544,18 @@ void halide_profiler_shutdown();
  * reset. Also happens at process exit. */
 extern void halide_profiler_report(void *user_context);
 
+/** A callback for halide_profiler_visit. Return a non-zero value to
+ * stop the visit. */
+typedef int (*halide_profiler_visitor_t)(void *arg, const struct halide_profiler_pipeline_stats *p);
+
+/** Call the visitor on the stats of each pipeline seen since the last
+ * reset, for exporting them as metrics. The histograms are decayed up
+ * to the present first. The profiler is locked (and so not sampling)
+ * for the duration, so the visitor should copy out what it needs and
+ * return quickly. Returns the first non-zero value returned by the
+ * visitor, or zero. */
+extern int halide_profiler_visit(halide_profiler_visitor_t visitor, void *arg);
+
 /** For timer based profiling, this routine starts the timer chain running.
  * halide_get_profiler_state can be called to get the current timer interval.
  */
@@ -1993,6 +2624,68 @@ extern int halide_reuse_device_allocations(void *user_context, bool);
  * recently set by the method above. */
 extern bool halide_can_reuse_device_allocations(void *user_context);
 
+/** Set whether halide_device_and_host_malloc should allocate the host
+ * side of buffers as page-locked (pinned) memory on device APIs that
+ * support it (currently CUDA and OpenCL), as if every buffer had
+ * halide_buffer_flag_pinned_host set. Copies between the device and
+ * page-locked memory don't need to be staged by the driver, so they
+ * are considerably faster, but page-locked memory is a scarce system
+ * resource. Page-locked allocations are cached for reuse according to
+ * halide_reuse_device_allocations. Defaults to false. */
+extern int halide_use_pinned_host_allocations(void *user_context, bool);
+
+/** Determines whether halide_device_and_host_malloc makes page-locked
+ * host allocations for buffers without
+ * halide_buffer_flag_pinned_host set. Override and switch based on
+ * the user_context for finer-grained control. By default just returns
+ * the value most recently set by the method above. */
+extern bool halide_can_use_pinned_host_allocations(void *user_context);
+
+/** Set whether halide_device_malloc should suballocate buffers out of
+ * large device memory blocks on device APIs that don't already do so
+ * (currently CUDA and OpenCL), rather than making one device API
+ * allocation per buffer. Requests are rounded up to a size class, so
+ * freed space can be reused by buffers of similar but not identical
+ * size. Whether freed space is kept for reuse or returned to the
+ * device API as soon as a block is empty follows
+ * halide_reuse_device_allocations. Defaults to false. */
+extern int halide_use_device_suballocation(void *user_context, bool);
+
+/** Determines whether halide_device_malloc suballocates. Override and
+ * switch based on the user_context for finer-grained control. By
+ * default just returns the value most recently set by the method
+ * above. */
+extern bool halide_can_use_device_suballocation(void *user_context);
+
+/** Device memory held by a device API runtime on behalf of
+ * suballocated buffers. bytes_allocated - bytes_reserved is free space
+ * in blocks, and bytes_reserved - bytes_requested is space lost to
+ * size-class rounding and alignment. */
+struct halide_device_memory_stats_t {
+    /** The number of device API allocations (blocks) currently held,
+     * and their total size. */
+    uint64_t blocks, bytes_allocated;
+
+    /** The largest value bytes_allocated has had. */
+    uint64_t peak_bytes_allocated;
+
+    /** The number of device API allocations made so far. */
+    uint64_t block_allocations;
+
+    /** The number of live suballocations, the space reserved for them
+     * in blocks, and the space their buffers asked for. */
+    uint64_t regions, bytes_reserved, bytes_requested;
+};
+
+/** Return the directory in which the CUDA, OpenCL and Vulkan runtimes
+ * keep a persistent cache of compiled kernels, or NULL to disable it.
+ * Entries are keyed on the kernel source, the device, the driver
+ * version and the build options, so a directory can be shared between
+ * processes and machines. Stale entries are never removed. By default
+ * returns the value of the environment variable
+ * HL_GPU_KERNEL_CACHE_DIR. Override for finer-grained control. */
+extern const char *halide_gpu_kernel_cache_dir(void *user_context);
+
 struct halide_device_allocation_pool {
     int (*release_unused)(void *user_context);
     struct halide_device_allocation_pool *next;
@@ -35,6 +35,11 @@ extern int halide_cuda_run(void *user_context,
                            void *args[],
                            int8_t arg_is_buffer[]);
 extern void halide_cuda_finalize_kernels(void *user_context, void *state_ptr);
+extern int halide_cuda_occupancy_block_size(void *user_context,
+                                            void *state_ptr,
+                                            const char *entry_name,
+                                            int shared_mem_bytes,
+                                            int max_block_size);
 // @}
 
 /** Set the underlying cuda device poiner for a buffer. The device
@@ -65,6 +70,10 @@ extern uintptr_t halide_cuda_get_device_ptr(void *user_context, struct halide_bu
  * driver. See halide_reuse_device_allocations. */
 extern int halide_cuda_release_unused_device_allocations(void *user_context);
 
+/** Report the device memory held by the cuda runtime for buffers
+ * suballocated under halide_use_device_suballocation. */
+extern int halide_cuda_get_device_memory_stats(void *user_context, struct halide_device_memory_stats_t *stats);
+
 // These typedefs treat both a CUcontext and a CUstream as a void *,
 // to avoid dependencies on cuda headers.
 typedef int (*halide_cuda_acquire_context_t)(void *,   // user_context
@@ -82,6 +91,98 @@ extern halide_cuda_release_context_t halide_set_cuda_release_context(halide_cuda
 extern halide_cuda_get_stream_t halide_set_cuda_get_stream(halide_cuda_get_stream_t handler);
 // @}
 
+/** Control whether the default get_stream implementation hands out
+ * non-blocking streams from a pool instead of the context's null
+ * stream. Each user_context is mapped to one stream of the pool, so
+ * kernel launches, copies and halide_cuda_device_sync calls made with
+ * it are ordered with respect to each other, but calls made with
+ * different user_contexts may run concurrently. Buffers passed between
+ * pipelines running with different user_contexts must be synchronized
+ * with halide_device_sync by the producer. The pool can also be
+ * enabled by setting the environment variable HL_CUDA_STREAM_POOL=1.
+ * This should be set before any CUDA work is done, as the pooled
+ * streams do not synchronize with the null stream. Has no effect if a
+ * custom get_stream handler is installed. */
+extern int halide_cuda_use_stream_pool(void *user_context, bool enable);
+
+/** Control whether uploads of host data are queued on a separate copy
+ * stream, so that they can run while kernels queued earlier are still
+ * running, e.g. uploading the next input of a pipeline while the
+ * kernels of the current stage run. Each kernel launch is made to wait
+ * (with an event) for the uploads to the buffers it is passed, and
+ * copies back to the host, halide_device_free and
+ * halide_cuda_device_sync wait for all of them, so nothing else needs
+ * to change. Buffers uploaded with one user_context and then used with
+ * another one that maps to a different stream must be synchronized
+ * with halide_device_sync first. Uploads from pageable host memory
+ * are staged by the driver, so page-locked host memory (see
+ * halide_cuda_device_and_host_malloc) overlaps best. Copy streams can
+ * also be enabled by setting the environment variable
+ * HL_CUDA_COPY_STREAM=1. Has no effect with drivers that lack stream
+ * or event support. */
+extern int halide_cuda_use_copy_stream(void *user_context, bool enable);
+
+/** Control whether halide_cuda_device_and_host_malloc allocates managed
+ * memory (cuMemAllocManaged) that serves as both the host and the
+ * device data of the buffer, in place of a separate host allocation.
+ * Copies to and from the device of such a buffer then move nothing:
+ * copying to the host just waits for the kernels queued so far. This
+ * is only used on devices that can access managed memory concurrently
+ * with the host; elsewhere the usual allocations are made. The memory
+ * must be released with halide_device_and_host_free. Managed memory
+ * can also be enabled by setting the environment variable
+ * HL_CUDA_MANAGED_MEMORY=1. */
+extern int halide_cuda_use_managed_memory(void *user_context, bool enable);
+
+/** Make the default acquire_context implementation use a context on
+ * the given device for all work done with this user_context, instead
+ * of the device chosen by halide_set_gpu_device or HL_GPU_DEVICE. One
+ * large realization can then be spread across the GPUs of a machine
+ * by splitting its output (e.g. along the batch dimension) into crops
+ * and realizing each crop from its own thread with a user_context
+ * bound to a different device. There is one context per device, and
+ * the contexts of devices with a peer link are given access to each
+ * other's memory, so device-to-device copies between them (e.g. of
+ * halos) go directly over the link. Device buffers should otherwise
+ * only be used with user_contexts bound to the device they were
+ * allocated on. Pass -1 to remove a binding. Has no effect if a custom
+ * acquire_context handler is installed. */
+extern int halide_cuda_set_user_context_device(void *user_context, int device);
+
+/** Get the number of CUDA devices available. */
+extern int halide_cuda_get_device_count(void *user_context, int *count);
+
+/** An opaque handle to the CUDA graph recorded for a sequence of
+ * pipeline calls. */
+struct halide_cuda_graph_t;
+
+/** Record the kernels launched between these two calls into a CUDA
+ * graph, and replay it instead of launching them one at a time on
+ * later calls. This cuts the launch overhead of pipelines made of many
+ * small kernels. Pass a pointer to a null handle the first time; it is
+ * allocated and should eventually be freed with
+ * halide_cuda_graph_release, before the CUDA context is released.
+ *
+ * The first call with a handle runs as usual and records its kernel
+ * launches. Later calls defer their launches, updating the graph's
+ * kernel arguments and grid sizes, and launch the whole graph from
+ * halide_cuda_graph_end. If a call launches a different sequence of
+ * kernels than was recorded, the deferred kernels are launched
+ * directly, and the next call records afresh. Copies, device syncs
+ * and frees that return memory to the driver also launch anything
+ * deferred before them, so they see the results of earlier kernels,
+ * and a call that does any of these between kernels is never recorded.
+ * Use one handle per pipeline and set of buffer shapes for the best
+ * reuse. Only one call per user_context may be in progress at a time.
+ * Kernels are launched on the stream halide_cuda_get_stream returns for
+ * the user_context. If the driver does not support graphs, kernels are
+ * just launched as usual. */
+// @{
+extern int halide_cuda_graph_begin(void *user_context, struct halide_cuda_graph_t **graph);
+extern int halide_cuda_graph_end(void *user_context, struct halide_cuda_graph_t *graph);
+extern int halide_cuda_graph_release(void *user_context, struct halide_cuda_graph_t *graph);
+// @}
+
 #ifdef __cplusplus
 }  // End extern "C"
 #endif
@@ -132,6 +132,13 @@ extern int halide_hexagon_set_performance(void *user_context, halide_hexagon_pow
 extern int halide_hexagon_set_thread_priority(void *user_context, int priority);
 // @}
 
+/** Free any ION allocations that were kept for reuse after being
+ * freed. Allocations are only kept when
+ * halide_can_reuse_device_allocations() returns true; calling
+ * halide_reuse_device_allocations(user_context, false) also releases
+ * them. */
+extern int halide_hexagon_release_unused_device_allocations(void *user_context);
+
 /** These are forward declared here to allow clients to override the
  *  Halide Hexagon runtime. Do not call them. */
 // @{
@@ -112,6 +112,31 @@ extern uintptr_t halide_opencl_get_cl_mem(void *user_context, struct halide_buff
 /** Returns the offset associated with the OpenCL memory allocation via device_crop or device_slice. */
 extern uint64_t halide_opencl_get_crop_offset(void *user_context, halide_buffer_t *buf);
 
+/** Release any currently-unused page-locked host allocations made by
+ * halide_device_and_host_malloc, and any empty device memory blocks
+ * held for suballocation, back to the OpenCL driver. See
+ * halide_use_pinned_host_allocations, halide_use_device_suballocation
+ * and halide_reuse_device_allocations. */
+extern int halide_opencl_release_unused_device_allocations(void *user_context);
+
+/** Allocate and free a buffer's host and device memory together. On
+ * devices that report CL_DEVICE_HOST_UNIFIED_MEMORY (integrated GPUs),
+ * the host allocation is wrapped in a CL_MEM_USE_HOST_PTR buffer, so
+ * copies between host and device become a map and unmap rather than a
+ * memcpy. Such buffers must be released with
+ * halide_opencl_device_and_host_free (or halide_device_and_host_free).
+ * Set the environment variable HL_OPENCL_ZERO_COPY to 0 to disable
+ * this. It is also not done when pinned host allocations are in
+ * use. */
+// @{
+extern int halide_opencl_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf);
+extern int halide_opencl_device_and_host_free(void *user_context, struct halide_buffer_t *buf);
+// @}
+
+/** Report the device memory held by the OpenCL runtime for buffers
+ * suballocated under halide_use_device_suballocation. */
+extern int halide_opencl_get_device_memory_stats(void *user_context, struct halide_device_memory_stats_t *stats);
+
 #ifdef __cplusplus
 }  // End extern "C"
 #endif
@@ -25,6 +25,18 @@ extern int halide_qurt_hvx_unlock(void *user_context);
 extern void halide_qurt_hvx_unlock_as_destructor(void *user_context, void * /*obj*/);
 // @}
 
+/** Allocate and free VTCM. The most recent reservation made by
+ * halide_vtcm_malloc is kept when it is freed, and reused by later
+ * allocations that fit in it, so that running a pipeline repeatedly
+ * doesn't request VTCM from QuRT each time. Call
+ * halide_vtcm_release_reserved to give it back to the system, e.g.
+ * so that other processes can use it. */
+// @{
+extern void *halide_vtcm_malloc(void *user_context, int size);
+extern void halide_vtcm_free(void *user_context, void *addr);
+extern void halide_vtcm_release_reserved(void *user_context);
+// @}
+
 #ifdef __cplusplus
 }  // End extern "C"
 #endif
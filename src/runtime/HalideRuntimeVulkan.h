@@ -101,6 +101,21 @@ extern const char *halide_vulkan_get_device_type(void *user_context);
 extern void halide_vulkan_set_build_options(const char *n);
 extern const char *halide_vulkan_get_build_options(void *user_context);
 
+/** Seed the pipeline cache used to create compute pipelines with data
+ * previously returned by halide_vulkan_export_pipeline_cache, so that
+ * kernels compiled by an earlier run don't have to be compiled again
+ * by the driver. This should be called before the first kernel is run.
+ * Data the driver doesn't recognize (eg from another device or driver
+ * version) is ignored. See also halide_gpu_kernel_cache_dir, which
+ * persists the pipeline cache to disk automatically. */
+extern int halide_vulkan_import_pipeline_cache(void *user_context, const void *data, size_t size);
+
+/** Retrieve the contents of the pipeline cache, for storing and passing
+ * to halide_vulkan_import_pipeline_cache in a later run. If data is
+ * NULL, the required size is returned in *size. Otherwise up to *size
+ * bytes are written to data, which fails if that isn't enough. */
+extern int halide_vulkan_export_pipeline_cache(void *user_context, void *data, size_t *size);
+
 #ifdef __cplusplus
 }  // End extern "C"
 #endif
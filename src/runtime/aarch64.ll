@@ -149,4 +149,14 @@ define weak_odr <8 x half> @fast_inverse_sqrt_f16x8(<8 x half> %x) nounwind alwa
        %correction = tail call <8 x half> @llvm.aarch64.neon.frsqrts.v8f16(<8 x half> %approx2, <8 x half> %x)
        %result = fmul <8 x half> %approx, %correction
        ret <8 x half> %result
-}
\ No newline at end of file
+}
+; The bfloat16 matrix multiply takes bfloat vectors, but Halide
+; represents bfloat16 values as i16.
+declare <4 x float> @llvm.aarch64.neon.bfmmla(<4 x float>, <8 x bfloat>, <8 x bfloat>) nounwind readnone;
+
+define weak_odr <4 x float> @bfmmla_f32x4(<4 x float> %init, <8 x i16> %a, <8 x i16> %b) nounwind alwaysinline {
+       %1 = bitcast <8 x i16> %a to <8 x bfloat>
+       %2 = bitcast <8 x i16> %b to <8 x bfloat>
+       %3 = tail call <4 x float> @llvm.aarch64.neon.bfmmla(<4 x float> %init, <8 x bfloat> %1, <8 x bfloat> %2)
+       ret <4 x float> %3
+}
@@ -7,6 +7,8 @@ namespace Runtime {
 namespace Internal {
 
 WEAK bool halide_reuse_device_allocations_flag = true;
+WEAK bool halide_use_pinned_host_allocations_flag = false;
+WEAK bool halide_use_device_suballocation_flag = false;
 
 WEAK halide_mutex allocation_pools_lock;
 WEAK halide_device_allocation_pool *device_allocation_pools = nullptr;
@@ -42,6 +44,24 @@ WEAK bool halide_can_reuse_device_allocations(void *user_context) {
     return halide_reuse_device_allocations_flag;
 }
 
+WEAK int halide_use_pinned_host_allocations(void *user_context, bool flag) {
+    halide_use_pinned_host_allocations_flag = flag;
+    return halide_error_code_success;
+}
+
+WEAK bool halide_can_use_pinned_host_allocations(void *user_context) {
+    return halide_use_pinned_host_allocations_flag;
+}
+
+WEAK int halide_use_device_suballocation(void *user_context, bool flag) {
+    halide_use_device_suballocation_flag = flag;
+    return halide_error_code_success;
+}
+
+WEAK bool halide_can_use_device_suballocation(void *user_context) {
+    return halide_use_device_suballocation_flag;
+}
+
 WEAK void halide_register_device_allocation_pool(struct halide_device_allocation_pool *pool) {
     ScopedMutexLock lock(&allocation_pools_lock);
     pool->next = device_allocation_pools;
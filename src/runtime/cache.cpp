@@ -1,6 +1,7 @@
 #include "HalideRuntime.h"
 #include "device_buffer_utils.h"
 #include "printer.h"
+#include "runtime_atomics.h"
 #include "scoped_mutex_lock.h"
 
 namespace Halide {
@@ -67,16 +68,57 @@ WEAK bool buffer_has_shape(const halide_buffer_t *buf, const halide_dimension_t
     return true;
 }
 
+// The bytes stored by the entries with one eviction key, and an
+// optional budget for them set by
+// halide_memoization_cache_set_eviction_key_size. These are made on
+// first use and live until halide_memoization_cache_cleanup, so that
+// entries can point at them without holding eviction_key_lock.
+struct EvictionKeyUsage {
+    EvictionKeyUsage *next;
+    uint64_t eviction_key;
+    int64_t max_size;  // 0 if there is no budget
+    int64_t current_size;
+};
+
+WEAK halide_mutex eviction_key_lock = {{0}};
+WEAK EvictionKeyUsage *eviction_key_usages = nullptr;
+
+// Must be called with eviction_key_lock held. Returns nullptr if the
+// record doesn't exist and create is false, or allocation fails.
+WEAK EvictionKeyUsage *find_eviction_key_usage(uint64_t eviction_key, bool create) {
+    for (EvictionKeyUsage *usage = eviction_key_usages; usage; usage = usage->next) {
+        if (usage->eviction_key == eviction_key) {
+            return usage;
+        }
+    }
+    if (!create) {
+        return nullptr;
+    }
+    EvictionKeyUsage *usage = (EvictionKeyUsage *)halide_malloc(nullptr, sizeof(EvictionKeyUsage));
+    if (usage) {
+        usage->eviction_key = eviction_key;
+        usage->max_size = 0;
+        usage->current_size = 0;
+        usage->next = eviction_key_usages;
+        eviction_key_usages = usage;
+    }
+    return usage;
+}
+
 struct CacheEntry {
     CacheEntry *next;
-    CacheEntry *more_recent;
-    CacheEntry *less_recent;
+    // Neighbors in the CLOCK ring of the entry's shard.
+    CacheEntry *clock_next;
+    CacheEntry *clock_prev;
     uint8_t *metadata_storage;
     size_t key_size;
     uint8_t *key;
-    uint32_t hash;
+    uint64_t hash;
     uint32_t in_use_count;  // 0 if none returned from halide_cache_lookup
     uint32_t tuple_count;
+    // Set on every hit, and cleared as the CLOCK hand passes, so that
+    // only entries not used for a full revolution are evicted.
+    bool referenced;
     // The shape of the computed data. There may be more data allocated than this.
     int32_t dimensions;
     halide_dimension_t *computed_bounds;
@@ -84,19 +126,23 @@ struct CacheEntry {
     halide_buffer_t *buf;
     uint64_t eviction_key;
     bool has_eviction_key;
+    // Where this entry's bytes are counted by eviction key, if it has one.
+    EvictionKeyUsage *usage;
 
     bool init(const uint8_t *cache_key, size_t cache_key_size,
-              uint32_t key_hash,
+              uint64_t key_hash,
               const halide_buffer_t *computed_bounds_buf,
               int32_t tuples, halide_buffer_t **tuple_buffers,
               bool has_eviction_key, uint64_t eviction_key);
     void destroy();
     halide_buffer_t &buffer(int32_t i);
+    uint64_t size_in_bytes() const;
+    uint64_t device_size_in_bytes() const;
 };
 
 struct CacheBlockHeader {
     CacheEntry *entry;
-    uint32_t hash;
+    uint64_t hash;
 };
 
 // Each host block has extra space to store a header just before the
@@ -115,16 +161,17 @@ WEAK CacheBlockHeader *get_pointer_to_header(uint8_t *host) {
 }
 
 WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
-                           uint32_t key_hash, const halide_buffer_t *computed_bounds_buf,
+                           uint64_t key_hash, const halide_buffer_t *computed_bounds_buf,
                            int32_t tuples, halide_buffer_t **tuple_buffers,
                            bool has_eviction_key_arg, uint64_t eviction_key_arg) {
     next = nullptr;
-    more_recent = nullptr;
-    less_recent = nullptr;
+    clock_next = nullptr;
+    clock_prev = nullptr;
     key_size = cache_key_size;
     hash = key_hash;
     in_use_count = 0;
     tuple_count = tuples;
+    referenced = true;
     dimensions = computed_bounds_buf->dimensions;
 
     // Allocate all the necessary space (or die)
@@ -174,6 +221,7 @@ WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
 
     has_eviction_key = has_eviction_key_arg;
     eviction_key = eviction_key_arg;
+    usage = nullptr;
     return true;
 }
 
@@ -188,134 +236,641 @@ WEAK void CacheEntry::destroy() {
     halide_free(nullptr, metadata_storage);
 }
 
-WEAK uint32_t djb_hash(const uint8_t *key, size_t key_size) {
-    uint32_t h = 5381;
-    for (size_t i = 0; i < key_size; i++) {
-        h = (h << 5) + h + key[i];
+WEAK uint64_t CacheEntry::size_in_bytes() const {
+    uint64_t result = 0;
+    for (uint32_t i = 0; i < tuple_count; i++) {
+        result += buf[i].size_in_bytes();
+    }
+    return result;
+}
+
+// The bytes of the device allocations the entry owns, which were made
+// by the pipeline that computed it, in addition to its host memory.
+WEAK uint64_t CacheEntry::device_size_in_bytes() const {
+    uint64_t result = 0;
+    for (uint32_t i = 0; i < tuple_count; i++) {
+        if (buf[i].device) {
+            result += buf[i].size_in_bytes();
+        }
+    }
+    return result;
+}
+
+// Cache keys are mostly scalar params and buffer shapes, so hash them
+// a word at a time, and finish with the murmur3 finalizer so that
+// both the high bits (which pick a shard) and the low bits (which
+// pick a bucket) are well mixed.
+WEAK uint64_t cache_key_hash(const uint8_t *key, size_t key_size) {
+    const uint64_t m = 0x9e3779b97f4a7c15ULL;
+    uint64_t h = key_size * m;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= key_size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, key + i, sizeof(word));
+        h = (h ^ word) * m;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    for (size_t j = 0; i + j < key_size; j++) {
+        tail |= (uint64_t)key[i + j] << (8 * j);
     }
+    h = (h ^ tail) * m;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
     return h;
 }
 
-WEAK halide_mutex memoization_lock = {{0}};
+// The cache is split into shards by key hash, each with its own lock,
+// hash table and CLOCK ring, so that threads looking up different
+// keys rarely contend. The byte budget is shared by all the shards.
+const size_t kCacheShards = 16;
+const size_t kInitialBucketsPerShard = 16;
+
+struct CacheShard {
+    halide_mutex lock;
+    // A power of two number of hash buckets, allocated on first
+    // store and doubled whenever there are more entries than buckets.
+    CacheEntry **buckets;
+    size_t num_buckets;
+    size_t num_entries;
+    // The next entry to consider for eviction. New entries go just
+    // behind it.
+    CacheEntry *clock_hand;
+    // Stats for halide_memoization_cache_get_stats.
+    uint64_t hits, misses, stores, evictions, bytes_evicted;
+};
 
-const size_t kHashTableSize = 256;
+WEAK CacheShard cache_shards[kCacheShards];
 
-WEAK CacheEntry *cache_entries[kHashTableSize];
+ALWAYS_INLINE size_t shard_index(uint64_t hash) {
+    return (hash >> 56) % kCacheShards;
+}
 
-WEAK CacheEntry *most_recently_used = nullptr;
-WEAK CacheEntry *least_recently_used = nullptr;
+ALWAYS_INLINE size_t bucket_index(const CacheShard &shard, uint64_t hash) {
+    return hash & (shard.num_buckets - 1);
+}
 
 const uint64_t kDefaultCacheSize = 1 << 20;
 WEAK int64_t max_cache_size = kDefaultCacheSize;
 WEAK int64_t current_cache_size = 0;
 
+// Device memory is usually scarcer than host memory, so the device
+// allocations held by entries have a budget of their own. See
+// halide_memoization_cache_set_device_size.
+WEAK int64_t max_device_cache_size = kDefaultCacheSize;
+WEAK int64_t current_device_cache_size = 0;
+
+// Whether the whole cache is over budget, or, if usage is non-null,
+// whether the entries with that eviction key are.
+ALWAYS_INLINE bool cache_over_budget(EvictionKeyUsage *usage = nullptr) {
+    int64_t current, max;
+    if (usage) {
+        Synchronization::atomic_load_relaxed(&usage->current_size, &current);
+        Synchronization::atomic_load_relaxed(&usage->max_size, &max);
+        return max > 0 && current > max;
+    }
+    Synchronization::atomic_load_relaxed(&current_cache_size, &current);
+    Synchronization::atomic_load_relaxed(&max_cache_size, &max);
+    return current > max;
+}
+
+ALWAYS_INLINE bool device_cache_over_budget() {
+    int64_t current, max;
+    Synchronization::atomic_load_relaxed(&current_device_cache_size, &current);
+    Synchronization::atomic_load_relaxed(&max_device_cache_size, &max);
+    return current > max;
+}
+
+// Whether entries must be evicted, either to get within the budget for
+// the eviction key of usage, if it is non-null, or within the host or
+// device budget of the whole cache.
+ALWAYS_INLINE bool needs_pruning(EvictionKeyUsage *usage) {
+    return cache_over_budget(usage) || (!usage && device_cache_over_budget());
+}
+
+// Add the sizes of an entry to the sizes of the cache, or subtract them
+// if sign is -1.
+ALWAYS_INLINE void add_to_cache_size(const CacheEntry *entry, int64_t sign) {
+    int64_t bytes = sign * (int64_t)entry->size_in_bytes();
+    int64_t device_bytes = sign * (int64_t)entry->device_size_in_bytes();
+    Synchronization::atomic_fetch_add_sequentially_consistent(&current_cache_size, bytes);
+    if (device_bytes) {
+        Synchronization::atomic_fetch_add_sequentially_consistent(&current_device_cache_size, device_bytes);
+    }
+    if (entry->usage) {
+        Synchronization::atomic_fetch_add_sequentially_consistent(&entry->usage->current_size, bytes);
+    }
+}
+
 #if CACHE_DEBUGGING
-WEAK void validate_cache() {
-    print(nullptr) << "validating cache, "
-                   << "current size " << current_cache_size
-                   << " of maximum " << max_cache_size << "\n";
-    int entries_in_hash_table = 0;
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
+WEAK void validate_shard(const CacheShard &shard, int64_t *total_size) {
+    size_t entries_in_hash_table = 0;
+    for (size_t i = 0; i < shard.num_buckets; i++) {
+        CacheEntry *entry = shard.buckets[i];
         while (entry != nullptr) {
             entries_in_hash_table++;
-            if (entry->more_recent == nullptr && entry != most_recently_used) {
+            if (bucket_index(shard, entry->hash) != i) {
                 halide_print(nullptr, "cache invalid case 1\n");
                 __builtin_trap();
             }
-            if (entry->less_recent == nullptr && entry != least_recently_used) {
-                halide_print(nullptr, "cache invalid case 2\n");
-                __builtin_trap();
-            }
+            *total_size += entry->size_in_bytes();
             entry = entry->next;
         }
     }
-    int entries_from_mru = 0;
-    CacheEntry *mru_chain = most_recently_used;
-    while (mru_chain != nullptr) {
-        entries_from_mru++;
-        mru_chain = mru_chain->less_recent;
-    }
-    int entries_from_lru = 0;
-    CacheEntry *lru_chain = least_recently_used;
-    while (lru_chain != nullptr) {
-        entries_from_lru++;
-        lru_chain = lru_chain->more_recent;
+    size_t entries_in_clock = 0;
+    if (shard.clock_hand != nullptr) {
+        CacheEntry *entry = shard.clock_hand;
+        do {
+            entries_in_clock++;
+            if (entry->clock_next->clock_prev != entry) {
+                halide_print(nullptr, "cache invalid case 2\n");
+                __builtin_trap();
+            }
+            entry = entry->clock_next;
+        } while (entry != shard.clock_hand);
     }
-    print(nullptr) << "hash entries " << entries_in_hash_table
-                   << ", mru entries " << entries_from_mru
-                   << ", lru entries " << entries_from_lru << "\n";
-    if (entries_in_hash_table != entries_from_mru) {
+    if (entries_in_hash_table != shard.num_entries) {
         halide_print(nullptr, "cache invalid case 3\n");
         __builtin_trap();
     }
-    if (entries_in_hash_table != entries_from_lru) {
+    if (entries_in_clock != shard.num_entries) {
         halide_print(nullptr, "cache invalid case 4\n");
         __builtin_trap();
     }
+}
+
+// Must be called with every shard locked, or none of them in use.
+WEAK void validate_cache() {
+    print(nullptr) << "validating cache, "
+                   << "current size " << current_cache_size
+                   << " of maximum " << max_cache_size << "\n";
+    int64_t total_size = 0;
+    for (const CacheShard &shard : cache_shards) {
+        validate_shard(shard, &total_size);
+    }
     if (current_cache_size < 0) {
         halide_print(nullptr, "cache size is negative\n");
         __builtin_trap();
     }
+    if (total_size != current_cache_size) {
+        halide_print(nullptr, "cache size is wrong\n");
+        __builtin_trap();
+    }
 }
 #endif
 
-WEAK void prune_cache() {
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
-    CacheEntry *prune_candidate = least_recently_used;
-    while (current_cache_size > max_cache_size &&
-           prune_candidate != nullptr) {
-        CacheEntry *more_recent = prune_candidate->more_recent;
-
-        if (prune_candidate->in_use_count == 0) {
-            uint32_t h = prune_candidate->hash;
-            uint32_t index = h % kHashTableSize;
-
-            // Remove from hash table
-            CacheEntry *prev_hash_entry = cache_entries[index];
-            if (prev_hash_entry == prune_candidate) {
-                cache_entries[index] = prune_candidate->next;
-            } else {
-                while (prev_hash_entry != nullptr && prev_hash_entry->next != prune_candidate) {
-                    prev_hash_entry = prev_hash_entry->next;
+// Remove an entry from its shard's hash table and CLOCK ring, and
+// from the cache size. Must be called with the shard locked.
+WEAK void unlink_entry(CacheShard &shard, CacheEntry *entry) {
+    CacheEntry **prev = &shard.buckets[bucket_index(shard, entry->hash)];
+    while (*prev != entry) {
+        halide_abort_if_false(nullptr, *prev != nullptr);
+        prev = &(*prev)->next;
+    }
+    *prev = entry->next;
+
+    if (entry->clock_next == entry) {
+        shard.clock_hand = nullptr;
+    } else {
+        entry->clock_prev->clock_next = entry->clock_next;
+        entry->clock_next->clock_prev = entry->clock_prev;
+        if (shard.clock_hand == entry) {
+            shard.clock_hand = entry->clock_next;
+        }
+    }
+
+    shard.num_entries--;
+    add_to_cache_size(entry, -1);
+}
+
+// Count an entry that is about to be unlinked and destroyed as an
+// eviction. Must be called with the shard locked.
+ALWAYS_INLINE void count_eviction(CacheShard &shard, const CacheEntry *entry) {
+    shard.evictions++;
+    shard.bytes_evicted += entry->size_in_bytes();
+}
+
+// Advance the CLOCK hand of a shard, evicting entries that are not in
+// use and have not been hit since the hand last passed, until the
+// cache is within budget or every entry has been visited twice. If
+// usage is non-null, only entries with that eviction key are evicted,
+// until they are within their budget. If only the device budget is
+// exceeded, only entries with device allocations are evicted. Must be
+// called with the shard locked.
+WEAK void prune_shard(CacheShard &shard, EvictionKeyUsage *usage = nullptr) {
+    size_t steps = shard.num_entries * 2;
+    while (steps-- > 0 && shard.clock_hand != nullptr && needs_pruning(usage)) {
+        CacheEntry *entry = shard.clock_hand;
+        shard.clock_hand = entry->clock_next;
+        if (entry->in_use_count != 0 || (usage && entry->usage != usage)) {
+            continue;
+        }
+        if (!usage && !cache_over_budget() && entry->device_size_in_bytes() == 0) {
+            continue;
+        }
+        if (entry->referenced) {
+            entry->referenced = false;
+            continue;
+        }
+        count_eviction(shard, entry);
+        unlink_entry(shard, entry);
+        entry->destroy();
+        halide_free(nullptr, entry);
+    }
+}
+
+// Prune shards one at a time, starting with the given one, until the
+// cache (or the entries with the eviction key of usage) is within
+// budget. Must be called with no shard locked.
+WEAK void prune_cache(size_t first_shard, EvictionKeyUsage *usage = nullptr) {
+    for (size_t i = 0; i < kCacheShards && needs_pruning(usage); i++) {
+        CacheShard &shard = cache_shards[(first_shard + i) % kCacheShards];
+        ScopedMutexLock lock(&shard.lock);
+        prune_shard(shard, usage);
+    }
+}
+
+// Double the number of buckets of a shard. If that allocation fails,
+// the shard just keeps its longer chains. Must be called with the
+// shard locked.
+WEAK void grow_shard(CacheShard &shard) {
+    size_t new_num_buckets = shard.num_buckets ? shard.num_buckets * 2 : kInitialBucketsPerShard;
+    CacheEntry **new_buckets = (CacheEntry **)halide_malloc(nullptr, new_num_buckets * sizeof(CacheEntry *));
+    if (new_buckets == nullptr) {
+        return;
+    }
+    memset(new_buckets, 0, new_num_buckets * sizeof(CacheEntry *));
+    for (size_t i = 0; i < shard.num_buckets; i++) {
+        CacheEntry *entry = shard.buckets[i];
+        while (entry != nullptr) {
+            CacheEntry *next = entry->next;
+            size_t index = entry->hash & (new_num_buckets - 1);
+            entry->next = new_buckets[index];
+            new_buckets[index] = entry;
+            entry = next;
+        }
+    }
+    if (shard.buckets != nullptr) {
+        halide_free(nullptr, shard.buckets);
+    }
+    shard.buckets = new_buckets;
+    shard.num_buckets = new_num_buckets;
+}
+
+// Remove every entry of a shard with the given eviction key, or every
+// entry at all if all is true. Must be called with the shard locked,
+// or with no other thread using the cache.
+WEAK void evict_from_shard(void *user_context, CacheShard &shard, bool all, uint64_t eviction_key) {
+    for (size_t i = 0; i < shard.num_buckets; i++) {
+        CacheEntry *entry = shard.buckets[i];
+        while (entry != nullptr) {
+            CacheEntry *next = entry->next;
+            if (all || (entry->has_eviction_key && entry->eviction_key == eviction_key)) {
+                if (!all) {
+                    count_eviction(shard, entry);
                 }
-                halide_abort_if_false(nullptr, prev_hash_entry != nullptr);
-                prev_hash_entry->next = prune_candidate->next;
+                unlink_entry(shard, entry);
+                entry->destroy();
+                halide_free(user_context, entry);
             }
+            entry = next;
+        }
+    }
+}
 
-            // Remove from less recent chain.
-            if (least_recently_used == prune_candidate) {
-                least_recently_used = more_recent;
-            }
-            if (more_recent != nullptr) {
-                more_recent->less_recent = prune_candidate->less_recent;
+// An optional second level for the cache, consulted on a miss and
+// given every newly stored result. See
+// halide_memoization_cache_set_backend.
+WEAK const halide_memoization_cache_backend_t *cache_backend = nullptr;
+
+ALWAYS_INLINE const halide_memoization_cache_backend_t *get_cache_backend() {
+    const halide_memoization_cache_backend_t *backend;
+    Synchronization::atomic_load_acquire(&cache_backend, &backend);
+    return backend;
+}
+
+// The built-in backend keeps results in a region of memory shared by
+// several processes, set up by halide_memoization_cache_use_shared_memory.
+// It takes no locks: a result is written once into space claimed
+// from a bump allocator, then published in an open-addressed slot
+// table, and never modified or freed afterwards. Once the region is
+// full, new results are just not shared.
+const uint32_t kSharedCacheMagic = 0x48534d43;  // "HSMC"
+const uint32_t kSharedCacheMaxProbes = 64;
+
+struct SharedCacheHeader {
+    // 0 before initialization, 1 while a process initializes the
+    // region, and kSharedCacheMagic once it is ready.
+    uint32_t state;
+    uint32_t num_slots;
+    uint64_t size;
+    uint64_t data_begin;
+    uint64_t data_next;
+};
+
+struct SharedCacheSlot {
+    uint64_t hash;
+    // 0 while empty, 1 while being written, 2 once published.
+    uint32_t state;
+    uint32_t key_size;
+    uint64_t record;
+};
+
+// A published record is the key, then the computed bounds, then for
+// each tuple element its allocated bounds and byte size, then the
+// data of each tuple element, each part padded to 16 bytes.
+ALWAYS_INLINE size_t shared_cache_pad(size_t n) {
+    return (n + 15) & ~(size_t)15;
+}
+
+WEAK SharedCacheHeader *shared_cache = nullptr;
+
+ALWAYS_INLINE SharedCacheSlot *shared_cache_slots(SharedCacheHeader *header) {
+    return (SharedCacheSlot *)(header + 1);
+}
+
+// Returns the size of the record describing the given result, or 0
+// if it can't be shared because it is only on a device.
+WEAK size_t shared_cache_record_size(int32_t key_size, const halide_buffer_t *computed_bounds,
+                                     int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    size_t dims = computed_bounds->dimensions;
+    size_t result = shared_cache_pad(key_size) +
+                    shared_cache_pad(sizeof(halide_dimension_t) * dims);
+    for (int32_t i = 0; i < tuple_count; i++) {
+        if (tuple_buffers[i]->device_dirty()) {
+            return 0;
+        }
+        result += shared_cache_pad(sizeof(halide_dimension_t) * dims + sizeof(uint64_t));
+        result += shared_cache_pad(tuple_buffers[i]->size_in_bytes());
+    }
+    return result;
+}
+
+// Whether a published record matches the given key and shapes.
+// Returns a pointer to the data of the first tuple element if so.
+WEAK const uint8_t *shared_cache_match(const uint8_t *record, const SharedCacheSlot &slot,
+                                       const uint8_t *cache_key, int32_t key_size,
+                                       const halide_buffer_t *computed_bounds,
+                                       int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    if (slot.key_size != (uint32_t)key_size || !keys_equal(record, cache_key, key_size)) {
+        return nullptr;
+    }
+    size_t dims = computed_bounds->dimensions;
+    record += shared_cache_pad(key_size);
+    if (!buffer_has_shape(computed_bounds, (const halide_dimension_t *)record)) {
+        return nullptr;
+    }
+    record += shared_cache_pad(sizeof(halide_dimension_t) * dims);
+    for (int32_t i = 0; i < tuple_count; i++) {
+        uint64_t bytes;
+        memcpy(&bytes, record + sizeof(halide_dimension_t) * dims, sizeof(bytes));
+        if (!buffer_has_shape(tuple_buffers[i], (const halide_dimension_t *)record) ||
+            bytes != tuple_buffers[i]->size_in_bytes()) {
+            return nullptr;
+        }
+        record += shared_cache_pad(sizeof(halide_dimension_t) * dims + sizeof(uint64_t));
+    }
+    return record;
+}
+
+WEAK int shared_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
+                             halide_buffer_t *computed_bounds,
+                             int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    SharedCacheHeader *header = shared_cache;
+    if (!header) {
+        return 1;
+    }
+    uint8_t *base = (uint8_t *)header;
+    SharedCacheSlot *slots = shared_cache_slots(header);
+    uint64_t h = cache_key_hash(cache_key, size);
+    for (uint32_t probe = 0; probe < kSharedCacheMaxProbes; probe++) {
+        SharedCacheSlot &slot = slots[(h + probe) % header->num_slots];
+        uint32_t state;
+        Synchronization::atomic_load_acquire(&slot.state, &state);
+        if (state == 0) {
+            break;
+        }
+        if (state != 2 || slot.hash != h) {
+            continue;
+        }
+        const uint8_t *data = shared_cache_match(base + slot.record, slot, cache_key, size,
+                                                 computed_bounds, tuple_count, tuple_buffers);
+        if (data) {
+            for (int32_t i = 0; i < tuple_count; i++) {
+                size_t bytes = tuple_buffers[i]->size_in_bytes();
+                memcpy(tuple_buffers[i]->host, data, bytes);
+                tuple_buffers[i]->set_host_dirty(true);
+                data += shared_cache_pad(bytes);
             }
+            return 0;
+        }
+    }
+    return 1;
+}
+
+WEAK void shared_cache_store(void *user_context, const uint8_t *cache_key, int32_t size,
+                             halide_buffer_t *computed_bounds,
+                             int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    SharedCacheHeader *header = shared_cache;
+    if (!header) {
+        return;
+    }
+    size_t record_size = shared_cache_record_size(size, computed_bounds, tuple_count, tuple_buffers);
+    if (record_size == 0) {
+        return;
+    }
+    uint8_t *base = (uint8_t *)header;
+    SharedCacheSlot *slots = shared_cache_slots(header);
+    uint64_t h = cache_key_hash(cache_key, size);
+
+    // Claim a slot, unless another process already shared this result.
+    SharedCacheSlot *claimed = nullptr;
+    for (uint32_t probe = 0; probe < kSharedCacheMaxProbes && !claimed; probe++) {
+        SharedCacheSlot &slot = slots[(h + probe) % header->num_slots];
+        uint32_t expected = 0, desired = 1;
+        if (Synchronization::atomic_cas_strong_sequentially_consistent(&slot.state, &expected, &desired)) {
+            claimed = &slot;
+        } else if (expected == 2 && slot.hash == h &&
+                   shared_cache_match(base + slot.record, slot, cache_key, size,
+                                      computed_bounds, tuple_count, tuple_buffers)) {
+            return;
+        }
+    }
+    if (!claimed) {
+        return;
+    }
+
+    uint64_t offset = Synchronization::atomic_fetch_add_sequentially_consistent(&header->data_next, (uint64_t)record_size);
+    if (offset + record_size > header->size) {
+        // The region is full. The claimed slot stays unpublished,
+        // which lookups skip over.
+        return;
+    }
+
+    uint8_t *record = base + offset;
+    size_t dims = computed_bounds->dimensions;
+    memcpy(record, cache_key, size);
+    record += shared_cache_pad(size);
+    memcpy(record, computed_bounds->dim, sizeof(halide_dimension_t) * dims);
+    record += shared_cache_pad(sizeof(halide_dimension_t) * dims);
+    for (int32_t i = 0; i < tuple_count; i++) {
+        uint64_t bytes = tuple_buffers[i]->size_in_bytes();
+        memcpy(record, tuple_buffers[i]->dim, sizeof(halide_dimension_t) * dims);
+        memcpy(record + sizeof(halide_dimension_t) * dims, &bytes, sizeof(bytes));
+        record += shared_cache_pad(sizeof(halide_dimension_t) * dims + sizeof(uint64_t));
+    }
+    for (int32_t i = 0; i < tuple_count; i++) {
+        size_t bytes = tuple_buffers[i]->size_in_bytes();
+        memcpy(record, tuple_buffers[i]->host, bytes);
+        record += shared_cache_pad(bytes);
+    }
+
+    claimed->hash = h;
+    claimed->key_size = size;
+    claimed->record = offset;
+    uint32_t published = 2;
+    Synchronization::atomic_store_release(&claimed->state, &published);
+}
+
+WEAK halide_memoization_cache_backend_t shared_cache_backend = {
+    shared_cache_lookup,
+    shared_cache_store,
+};
+
+// The in-process part of halide_memoization_cache_store.
+WEAK int store_in_local_cache(void *user_context, const uint8_t *cache_key, int32_t size,
+                              halide_buffer_t *computed_bounds,
+                              int32_t tuple_count, halide_buffer_t **tuple_buffers,
+                              bool has_eviction_key, uint64_t eviction_key) {
+    debug(user_context) << "halide_memoization_cache_store has_eviction_key: " << has_eviction_key << " eviction_key " << eviction_key << " .\n";
+
+    uint64_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
+
+    size_t index = shard_index(h);
+    CacheShard &shard = cache_shards[index];
+
+    EvictionKeyUsage *usage = nullptr;
+    if (has_eviction_key) {
+        ScopedMutexLock lock(&eviction_key_lock);
+        usage = find_eviction_key_usage(eviction_key, true);
+    }
+
+#if CACHE_DEBUGGING
+    debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
+
+    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
+
+    {
+        for (int32_t i = 0; i < tuple_count; i++) {
+            halide_buffer_t *buf = tuple_buffers[i];
+            debug_print_buffer(user_context, "Allocation bounds", *buf);
+        }
+    }
+#endif
+
+    {
+        ScopedMutexLock lock(&shard.lock);
 
-            // Remove from more recent chain.
-            if (most_recently_used == prune_candidate) {
-                most_recently_used = prune_candidate->less_recent;
+        CacheEntry *entry = shard.buckets ? shard.buckets[bucket_index(shard, h)] : nullptr;
+        while (entry != nullptr) {
+            if (entry->hash == h && entry->key_size == (size_t)size &&
+                keys_equal(entry->key, cache_key, size) &&
+                buffer_has_shape(computed_bounds, entry->computed_bounds) &&
+                entry->tuple_count == (uint32_t)tuple_count) {
+
+                bool all_bounds_equal = true;
+                bool no_host_pointers_equal = true;
+                {
+                    for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
+                        halide_buffer_t *buf = tuple_buffers[i];
+                        all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
+                        if (entry->buf[i].host == buf->host) {
+                            no_host_pointers_equal = false;
+                        }
+                    }
+                }
+                if (all_bounds_equal) {
+                    halide_abort_if_false(user_context, no_host_pointers_equal);
+                    // This entry is still in use by the caller. Mark it as having no cache entry
+                    // so halide_memoization_cache_release can free the buffer.
+                    for (int32_t i = 0; i < tuple_count; i++) {
+                        get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
+                    }
+                    return halide_error_code_success;
+                }
             }
-            if (prune_candidate->less_recent != nullptr) {
-                prune_candidate->less_recent = more_recent;
+            entry = entry->next;
+        }
+
+        if (shard.num_entries >= shard.num_buckets) {
+            grow_shard(shard);
+        }
+
+        CacheEntry *new_entry = nullptr;
+        if (shard.buckets != nullptr) {
+            new_entry = (CacheEntry *)halide_malloc(nullptr, sizeof(CacheEntry));
+        }
+        bool inited = false;
+        if (new_entry) {
+            inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers,
+                                     has_eviction_key, eviction_key);
+        }
+        if (!inited) {
+            // This entry is still in use by the caller. Mark it as having no cache entry
+            // so halide_memoization_cache_release can free the buffer.
+            for (int32_t i = 0; i < tuple_count; i++) {
+                get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
             }
 
-            // Decrease cache used amount.
-            for (uint32_t i = 0; i < prune_candidate->tuple_count; i++) {
-                current_cache_size -= prune_candidate->buf[i].size_in_bytes();
+            if (new_entry) {
+                halide_free(user_context, new_entry);
             }
+            return halide_error_code_success;
+        }
+
+        size_t bucket = bucket_index(shard, h);
+        new_entry->next = shard.buckets[bucket];
+        shard.buckets[bucket] = new_entry;
+        if (shard.clock_hand == nullptr) {
+            new_entry->clock_next = new_entry;
+            new_entry->clock_prev = new_entry;
+            shard.clock_hand = new_entry;
+        } else {
+            new_entry->clock_next = shard.clock_hand;
+            new_entry->clock_prev = shard.clock_hand->clock_prev;
+            new_entry->clock_prev->clock_next = new_entry;
+            shard.clock_hand->clock_prev = new_entry;
+        }
+        shard.num_entries++;
+        shard.stores++;
+        new_entry->usage = usage;
+        add_to_cache_size(new_entry, 1);
+
+        new_entry->in_use_count = tuple_count;
 
-            // Deallocate the entry.
-            prune_candidate->destroy();
-            halide_free(nullptr, prune_candidate);
+        for (int32_t i = 0; i < tuple_count; i++) {
+            get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
         }
 
-        prune_candidate = more_recent;
+        // Prefer evicting from this shard, as it is already locked.
+        prune_shard(shard);
+        if (usage) {
+            prune_shard(shard, usage);
+        }
     }
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
+
+    // If that wasn't enough, evict from the other shards too.
+    prune_cache(index + 1);
+    if (usage) {
+        prune_cache(index + 1, usage);
+    }
+
+    debug(user_context) << "Exiting halide_memoization_cache_store\n";
+
+    return halide_error_code_success;
 }
 
 }  // namespace Internal
@@ -329,18 +884,23 @@ WEAK void halide_memoization_cache_set_size(int64_t size) {
         size = kDefaultCacheSize;
     }
 
-    ScopedMutexLock lock(&memoization_lock);
+    Synchronization::atomic_store_sequentially_consistent(&max_cache_size, &size);
+    prune_cache(0);
+}
+
+WEAK void halide_memoization_cache_set_device_size(int64_t size) {
+    if (size == 0) {
+        size = kDefaultCacheSize;
+    }
 
-    max_cache_size = size;
-    prune_cache();
+    Synchronization::atomic_store_sequentially_consistent(&max_device_cache_size, &size);
+    prune_cache(0);
 }
 
 WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
                                          halide_buffer_t *computed_bounds, int32_t tuple_count, halide_buffer_t **tuple_buffers) {
-    uint32_t h = djb_hash(cache_key, size);
-    uint32_t index = h % kHashTableSize;
-
-    ScopedMutexLock lock(&memoization_lock);
+    uint64_t h = cache_key_hash(cache_key, size);
+    CacheShard &shard = cache_shards[shard_index(h)];
 
 #if CACHE_DEBUGGING
     debug_print_key(user_context, "halide_memoization_cache_lookup", cache_key, size);
@@ -355,52 +915,43 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
     }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
-    while (entry != nullptr) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
-
-            // Check all the tuple buffers have the same bounds (they should).
-            bool all_bounds_equal = true;
-            for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-            }
+    {
+        ScopedMutexLock lock(&shard.lock);
 
-            if (all_bounds_equal) {
-                if (entry != most_recently_used) {
-                    halide_abort_if_false(user_context, entry->more_recent != nullptr);
-                    if (entry->less_recent != nullptr) {
-                        entry->less_recent->more_recent = entry->more_recent;
-                    } else {
-                        halide_abort_if_false(user_context, least_recently_used == entry);
-                        least_recently_used = entry->more_recent;
-                    }
-                    halide_abort_if_false(user_context, entry->more_recent != nullptr);
-                    entry->more_recent->less_recent = entry->less_recent;
+        CacheEntry *entry = shard.buckets ? shard.buckets[bucket_index(shard, h)] : nullptr;
+        while (entry != nullptr) {
+            if (entry->hash == h && entry->key_size == (size_t)size &&
+                keys_equal(entry->key, cache_key, size) &&
+                buffer_has_shape(computed_bounds, entry->computed_bounds) &&
+                entry->tuple_count == (uint32_t)tuple_count) {
 
-                    entry->more_recent = nullptr;
-                    entry->less_recent = most_recently_used;
-                    if (most_recently_used != nullptr) {
-                        most_recently_used->more_recent = entry;
-                    }
-                    most_recently_used = entry;
+                // Check all the tuple buffers have the same bounds (they should).
+                bool all_bounds_equal = true;
+                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
+                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
                 }
 
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    *buf = entry->buf[i];
-                }
+                if (all_bounds_equal) {
+                    entry->referenced = true;
 
-                entry->in_use_count += tuple_count;
+                    for (int32_t i = 0; i < tuple_count; i++) {
+                        halide_buffer_t *buf = tuple_buffers[i];
+                        *buf = entry->buf[i];
+                    }
 
-                return 0;
+                    entry->in_use_count += tuple_count;
+                    shard.hits++;
+
+                    return 0;
+                }
             }
+            entry = entry->next;
         }
-        entry = entry->next;
+
+        shard.misses++;
     }
 
+    // A miss. The buffers are allocated without holding the shard lock.
     for (int32_t i = 0; i < tuple_count; i++) {
         halide_buffer_t *buf = tuple_buffers[i];
 
@@ -418,9 +969,15 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
         header->entry = nullptr;
     }
 
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
+    // Try the backend, and keep anything it has in the local cache too.
+    // Lookups don't carry the eviction key, so such entries have none.
+    const halide_memoization_cache_backend_t *backend = get_cache_backend();
+    if (backend &&
+        backend->lookup(user_context, cache_key, size, computed_bounds, tuple_count, tuple_buffers) == 0) {
+        store_in_local_cache(user_context, cache_key, size, computed_bounds, tuple_count, tuple_buffers,
+                             false, 0);
+        return 0;
+    }
 
     return 1;
 }
@@ -429,184 +986,194 @@ WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache
                                         halide_buffer_t *computed_bounds,
                                         int32_t tuple_count, halide_buffer_t **tuple_buffers,
                                         bool has_eviction_key, uint64_t eviction_key) {
-    debug(user_context) << "halide_memoization_cache_store has_eviction_key: " << has_eviction_key << " eviction_key " << eviction_key << " .\n";
-
-    uint32_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
-
-    uint32_t index = h % kHashTableSize;
-
-    ScopedMutexLock lock(&memoization_lock);
+    int result = store_in_local_cache(user_context, cache_key, size, computed_bounds,
+                                      tuple_count, tuple_buffers, has_eviction_key, eviction_key);
+    const halide_memoization_cache_backend_t *backend = get_cache_backend();
+    // Backends share host memory, so results that are only valid on a
+    // device stay in this process.
+    bool on_host = true;
+    for (int32_t i = 0; i < tuple_count; i++) {
+        on_host = on_host && !tuple_buffers[i]->device_dirty();
+    }
+    if (backend && on_host && result == halide_error_code_success) {
+        backend->store(user_context, cache_key, size, computed_bounds, tuple_count, tuple_buffers);
+    }
+    return result;
+}
 
-#if CACHE_DEBUGGING
-    debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
+WEAK void halide_memoization_cache_release(void *user_context, void *host) {
+    CacheBlockHeader *header = get_pointer_to_header((uint8_t *)host);
+    debug(user_context) << "halide_memoization_cache_release\n";
+    CacheEntry *entry = header->entry;
 
-    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
+    if (entry == nullptr) {
+        halide_free(user_context, header);
+    } else {
+        ScopedMutexLock lock(&cache_shards[shard_index(header->hash)].lock);
 
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            debug_print_buffer(user_context, "Allocation bounds", *buf);
-        }
+        halide_abort_if_false(user_context, entry->in_use_count > 0);
+        entry->in_use_count--;
     }
-#endif
 
-    CacheEntry *entry = cache_entries[index];
-    while (entry != nullptr) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
+    debug(user_context) << "Exited halide_memoization_cache_release.\n";
+}
 
-            bool all_bounds_equal = true;
-            bool no_host_pointers_equal = true;
-            {
-                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-                    if (entry->buf[i].host == buf->host) {
-                        no_host_pointers_equal = false;
-                    }
-                }
-            }
-            if (all_bounds_equal) {
-                halide_abort_if_false(user_context, no_host_pointers_equal);
-                // This entry is still in use by the caller. Mark it as having no cache entry
-                // so halide_memoization_cache_release can free the buffer.
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
-                }
+WEAK int halide_memoization_cache_release_device(void *user_context, halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return halide_error_code_success;
+    }
+    CacheEntry *entry = buf->host ? get_pointer_to_header(buf->host)->entry : nullptr;
+    if (entry != nullptr) {
+        CacheBlockHeader *header = get_pointer_to_header(buf->host);
+        ScopedMutexLock lock(&cache_shards[shard_index(header->hash)].lock);
+        for (uint32_t i = 0; i < entry->tuple_count; i++) {
+            if (entry->buf[i].device == buf->device) {
+                // The device allocation now belongs to the cache entry.
+                // Detach it, so that later calls leave it alone.
+                buf->device = 0;
+                buf->device_interface = nullptr;
+                buf->set_device_dirty(false);
                 return halide_error_code_success;
             }
         }
-        entry = entry->next;
     }
+    return halide_device_free(user_context, buf);
+}
 
-    uint64_t added_size = 0;
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            added_size += buf->size_in_bytes();
+WEAK void halide_memoization_cache_release_device_as_destructor(void *user_context, void *obj) {
+    (void)halide_memoization_cache_release_device(user_context, (halide_buffer_t *)obj);  // ignore errors
+}
+
+WEAK void halide_memoization_cache_cleanup() {
+    debug(nullptr) << "halide_memoization_cache_cleanup\n";
+    for (CacheShard &shard : cache_shards) {
+        evict_from_shard(nullptr, shard, true, 0);
+        if (shard.buckets != nullptr) {
+            halide_free(nullptr, shard.buckets);
         }
+        shard.buckets = nullptr;
+        shard.num_buckets = 0;
     }
-    current_cache_size += added_size;
-    prune_cache();
-
-    CacheEntry *new_entry = (CacheEntry *)halide_malloc(nullptr, sizeof(CacheEntry));
-    bool inited = false;
-    if (new_entry) {
-        inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers,
-                                 has_eviction_key, eviction_key);
+#if CACHE_DEBUGGING
+    validate_cache();
+#endif
+    current_cache_size = 0;
+    current_device_cache_size = 0;
+    while (eviction_key_usages) {
+        EvictionKeyUsage *next = eviction_key_usages->next;
+        halide_free(nullptr, eviction_key_usages);
+        eviction_key_usages = next;
     }
-    if (!inited) {
-        current_cache_size -= added_size;
-
-        // This entry is still in use by the caller. Mark it as having no cache entry
-        // so halide_memoization_cache_release can free the buffer.
-        for (int32_t i = 0; i < tuple_count; i++) {
-            get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
-        }
+}
 
-        if (new_entry) {
-            halide_free(user_context, new_entry);
-        }
-        return halide_error_code_success;
+WEAK void halide_memoization_cache_evict(void *user_context, uint64_t eviction_key) {
+    for (CacheShard &shard : cache_shards) {
+        ScopedMutexLock lock(&shard.lock);
+        evict_from_shard(user_context, shard, false, eviction_key);
     }
+}
 
-    new_entry->next = cache_entries[index];
-    new_entry->less_recent = most_recently_used;
-    if (most_recently_used != nullptr) {
-        most_recently_used->more_recent = new_entry;
+WEAK int halide_memoization_cache_set_eviction_key_size(uint64_t eviction_key, int64_t size) {
+    EvictionKeyUsage *usage;
+    {
+        ScopedMutexLock lock(&eviction_key_lock);
+        usage = find_eviction_key_usage(eviction_key, size != 0);
     }
-    most_recently_used = new_entry;
-    if (least_recently_used == nullptr) {
-        least_recently_used = new_entry;
+    if (!usage) {
+        return size != 0 ? halide_error_code_out_of_memory : halide_error_code_success;
     }
-    cache_entries[index] = new_entry;
-
-    new_entry->in_use_count = tuple_count;
+    Synchronization::atomic_store_sequentially_consistent(&usage->max_size, &size);
+    prune_cache(0, usage);
+    return halide_error_code_success;
+}
 
-    for (int32_t i = 0; i < tuple_count; i++) {
-        get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
+WEAK int64_t halide_memoization_cache_get_eviction_key_usage(uint64_t eviction_key) {
+    ScopedMutexLock lock(&eviction_key_lock);
+    EvictionKeyUsage *usage = find_eviction_key_usage(eviction_key, false);
+    int64_t result = 0;
+    if (usage) {
+        Synchronization::atomic_load_relaxed(&usage->current_size, &result);
     }
+    return result;
+}
 
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
-    debug(user_context) << "Exiting halide_memoization_cache_store\n";
-
+WEAK int halide_memoization_cache_get_stats(halide_memoization_cache_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (CacheShard &shard : cache_shards) {
+        ScopedMutexLock lock(&shard.lock);
+        stats->hits += shard.hits;
+        stats->misses += shard.misses;
+        stats->stores += shard.stores;
+        stats->evictions += shard.evictions;
+        stats->bytes_evicted += shard.bytes_evicted;
+        stats->entries += shard.num_entries;
+    }
+    Synchronization::atomic_load_relaxed(&current_cache_size, &stats->bytes_stored);
+    Synchronization::atomic_load_relaxed(&max_cache_size, &stats->max_size);
+    Synchronization::atomic_load_relaxed(&current_device_cache_size, &stats->device_bytes_stored);
+    Synchronization::atomic_load_relaxed(&max_device_cache_size, &stats->max_device_size);
     return halide_error_code_success;
 }
 
-WEAK void halide_memoization_cache_release(void *user_context, void *host) {
-    CacheBlockHeader *header = get_pointer_to_header((uint8_t *)host);
-    debug(user_context) << "halide_memoization_cache_release\n";
-    CacheEntry *entry = header->entry;
-
-    if (entry == nullptr) {
-        halide_free(user_context, header);
-    } else {
-        ScopedMutexLock lock(&memoization_lock);
-
-        halide_abort_if_false(user_context, entry->in_use_count > 0);
-        entry->in_use_count--;
-#if CACHE_DEBUGGING
-        validate_cache();
-#endif
+WEAK void halide_memoization_cache_reset_stats() {
+    for (CacheShard &shard : cache_shards) {
+        ScopedMutexLock lock(&shard.lock);
+        shard.hits = 0;
+        shard.misses = 0;
+        shard.stores = 0;
+        shard.evictions = 0;
+        shard.bytes_evicted = 0;
     }
+}
 
-    debug(user_context) << "Exited halide_memoization_cache_release.\n";
+WEAK void halide_memoization_cache_set_backend(const halide_memoization_cache_backend_t *backend) {
+    Synchronization::atomic_store_release(&cache_backend, &backend);
 }
 
-WEAK void halide_memoization_cache_cleanup() {
-    debug(nullptr) << "halide_memoization_cache_cleanup\n";
-    for (auto &entry_ref : cache_entries) {
-        CacheEntry *entry = entry_ref;
-        entry_ref = nullptr;
-        while (entry != nullptr) {
-            CacheEntry *next = entry->next;
-            entry->destroy();
-            halide_free(nullptr, entry);
-            entry = next;
-        }
+WEAK int halide_memoization_cache_use_shared_memory(void *memory, size_t size) {
+    if (memory == nullptr) {
+        halide_memoization_cache_set_backend(nullptr);
+        shared_cache = nullptr;
+        return halide_error_code_success;
     }
-    current_cache_size = 0;
-    most_recently_used = nullptr;
-    least_recently_used = nullptr;
-}
 
-WEAK void halide_memoization_cache_evict(void *user_context, uint64_t eviction_key) {
-    ScopedMutexLock lock(&memoization_lock);
-
-    for (auto &entry_ref : cache_entries) {
-        CacheEntry *entry = entry_ref;
-        if (entry != nullptr) {
-            CacheEntry **prev = &entry_ref;
-            while (entry != nullptr) {
-                CacheEntry *next = entry->next;
-                if (entry->has_eviction_key && entry->eviction_key == eviction_key) {
-                    *prev = next;
-                    if (entry->more_recent != nullptr) {
-                        entry->more_recent->less_recent = entry->less_recent;
-                    } else {
-                        most_recently_used = entry->less_recent;
-                    }
-                    if (entry->less_recent != nullptr) {
-                        entry->less_recent->more_recent = entry->more_recent;
-                    } else {
-                        least_recently_used = entry->more_recent;
-                    }
-                    entry->destroy();
-                    halide_free(user_context, entry);
-                } else {
-                    prev = &entry->next;
-                }
-                entry = next;
-            }
+    SharedCacheHeader *header = (SharedCacheHeader *)memory;
+    // Give an eighth of the region to slots, which is one slot per 256
+    // bytes of results.
+    size_t num_slots = size / 8 / sizeof(SharedCacheSlot);
+    size_t data_begin = shared_cache_pad(sizeof(SharedCacheHeader) + num_slots * sizeof(SharedCacheSlot));
+    if (((uintptr_t)memory & 15) != 0 || num_slots < kSharedCacheMaxProbes || num_slots > 0xffffffff) {
+        error(nullptr) << "halide_memoization_cache_use_shared_memory: unusable region of " << (uint64_t)size << " bytes\n";
+        return halide_error_code_generic_error;
+    }
+
+    // The first process to get here formats the region. The memory
+    // must start out zeroed, as a fresh shared mapping does.
+    uint32_t expected = 0, desired = 1;
+    if (Synchronization::atomic_cas_strong_sequentially_consistent(&header->state, &expected, &desired)) {
+        header->num_slots = num_slots;
+        header->size = size;
+        header->data_begin = data_begin;
+        header->data_next = data_begin;
+        uint32_t ready = kSharedCacheMagic;
+        Synchronization::atomic_store_release(&header->state, &ready);
+    } else {
+        // Wait for the process formatting it, if that is still going on.
+        uint32_t state = expected;
+        for (int i = 0; state == 1 && i < 100000; i++) {
+            halide_thread_yield();
+            Synchronization::atomic_load_acquire(&header->state, &state);
+        }
+        if (state != kSharedCacheMagic || header->size != size) {
+            error(nullptr) << "halide_memoization_cache_use_shared_memory: region is not a memoization cache of "
+                           << (uint64_t)size << " bytes\n";
+            return halide_error_code_generic_error;
         }
     }
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
+
+    shared_cache = header;
+    halide_memoization_cache_set_backend(&shared_cache_backend);
+    return halide_error_code_success;
 }
 
 namespace {
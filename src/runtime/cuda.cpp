@@ -1,11 +1,15 @@
 #include "HalideRuntimeCuda.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "gpu_binary_cache.h"
 #include "gpu_context_common.h"
+#include "gpu_memory_allocator.h"
 #include "mini_cuda.h"
 #include "printer.h"
+#include "runtime_atomics.h"
 #include "scoped_mutex_lock.h"
 #include "scoped_spin_lock.h"
+#include "timeline.h"
 
 namespace Halide {
 namespace Runtime {
@@ -104,7 +108,7 @@ WEAK int ensure_libcuda_init(void *user_context) {
 extern WEAK halide_device_interface_t cuda_device_interface;
 
 WEAK const char *get_cuda_error_name(CUresult error);
-WEAK int create_cuda_context(void *user_context, CUcontext *ctx);
+WEAK int create_cuda_context(void *user_context, CUcontext *ctx, int requested_device = -1);
 
 template<typename... Args>
 int error_cuda(void *user_context, CUresult cuda_error, const Args &...args) {
@@ -120,6 +124,47 @@ CUcontext WEAK context = nullptr;
 // This lock protexts the above context variable.
 WEAK halide_mutex context_lock;
 
+// The contexts created by this module, indexed by device ordinal, so
+// that the default context and the contexts of user_contexts bound to
+// a device (see halide_cuda_set_user_context_device) share one context
+// per device. Protected by context_lock.
+constexpr int max_cuda_devices = 16;
+WEAK CUcontext device_contexts[max_cuda_devices] = {};
+
+// The user_contexts bound to a particular device.
+WEAK struct DeviceBindingItem {
+    void *user_context;
+    int device;
+    DeviceBindingItem *next;
+} *device_bindings = nullptr;
+WEAK halide_mutex device_bindings_lock;
+
+// The block sizes chosen by halide_cuda_occupancy_block_size. Kernel
+// functions belong to a context, so this caches a choice per kernel
+// per device. Protected by occupancy_lock.
+WEAK struct OccupancyItem {
+    CUfunction f;
+    int shared_mem_bytes;
+    int max_block_size;
+    int block_size;
+    OccupancyItem *next;
+} *occupancy_cache = nullptr;
+WEAK halide_mutex occupancy_lock;
+
+// Returns the device the user_context is bound to, or -1.
+WEAK int bound_device(void *user_context) {
+    if (device_bindings == nullptr) {
+        return -1;
+    }
+    ScopedMutexLock lock(&device_bindings_lock);
+    for (DeviceBindingItem *item = device_bindings; item; item = item->next) {
+        if (item->user_context == user_context) {
+            return item->device;
+        }
+    }
+    return -1;
+}
+
 // A free list, used when allocations are being cached.
 WEAK struct FreeListItem {
     CUdeviceptr ptr;
@@ -130,6 +175,387 @@ WEAK struct FreeListItem {
 } *free_list = nullptr;
 WEAK halide_mutex free_list_lock;
 
+// A free list of page-locked host allocations made by
+// halide_cuda_device_and_host_malloc, used when allocations are being
+// cached.
+WEAK struct PinnedHostFreeListItem {
+    void *ptr;
+    CUcontext ctx;
+    size_t size;
+    PinnedHostFreeListItem *next;
+} *pinned_host_free_list = nullptr;
+WEAK halide_mutex pinned_host_free_list_lock;
+
+// Blocks for the device memory suballocator, used when
+// halide_can_use_device_suballocation is true.
+WEAK int cuda_allocate_block(void *user_context, void *ctx, size_t size, void **handle) {
+    debug(user_context) << "    cuMemAlloc " << (uint64_t)size << " -> ";
+    CUdeviceptr p = 0;
+    CUresult err = cuMemAlloc(&p, size);
+    if (err != CUDA_SUCCESS) {
+        debug(user_context) << get_cuda_error_name(err) << "\n";
+        return halide_error_code_device_malloc_failed;
+    }
+    debug(user_context) << (void *)p << "\n";
+    *handle = (void *)p;
+    return halide_error_code_success;
+}
+
+WEAK int cuda_deallocate_block(void *user_context, void *ctx, void *handle) {
+    debug(user_context) << "    cuMemFree " << handle << "\n";
+    CUresult err = cuMemFree((CUdeviceptr)handle);
+    return (err == CUDA_SUCCESS) ? halide_error_code_success : halide_error_code_device_free_failed;
+}
+
+WEAK GPUMemoryPool cuda_memory_pool = {{cuda_allocate_block, cuda_deallocate_block}, nullptr, {}, {}};
+
+// Suballocations are aligned as strictly as cuMemAlloc aligns
+// allocations.
+constexpr size_t suballocation_alignment = 256;
+
+// The number of non-blocking streams created per context when the
+// default get_stream implementation is pooling streams.
+constexpr int stream_pool_size = 8;
+
+// The streams handed out by the default get_stream implementation for
+// one context. A user_context always maps to the same stream, so the
+// work done on its behalf stays ordered, while work done for other
+// user_contexts may overlap with it.
+WEAK struct StreamPoolItem {
+    CUcontext ctx;
+    CUstream streams[stream_pool_size];
+    StreamPoolItem *next;
+} *stream_pools = nullptr;
+WEAK halide_mutex stream_pool_lock;
+
+// Whether the default get_stream implementation uses the stream
+// pool. -1 means HL_CUDA_STREAM_POOL has not been consulted yet.
+WEAK int stream_pool_enabled = -1;
+
+WEAK bool use_stream_pool() {
+    int enabled;
+    Synchronization::atomic_load_relaxed(&stream_pool_enabled, &enabled);
+    if (enabled < 0) {
+        const char *env = getenv("HL_CUDA_STREAM_POOL");
+        int from_env = (env && atoi(env) != 0) ? 1 : 0;
+        enabled = -1;
+        if (Synchronization::atomic_cas_strong_sequentially_consistent(&stream_pool_enabled, &enabled, &from_env)) {
+            enabled = from_env;
+        }
+    }
+    // Streams are only used if the driver has stream support at all.
+    return enabled != 0 && cuStreamCreate != nullptr && cuStreamSynchronize != nullptr;
+}
+
+// Must be called with ctx current.
+WEAK int get_pooled_stream(void *user_context, CUcontext ctx, CUstream *stream) {
+    uint64_t h = (uint64_t)(uintptr_t)user_context;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    const int slot = (int)(h % stream_pool_size);
+
+    ScopedMutexLock lock(&stream_pool_lock);
+    StreamPoolItem *pool = stream_pools;
+    while (pool && pool->ctx != ctx) {
+        pool = pool->next;
+    }
+    if (!pool) {
+        pool = (StreamPoolItem *)malloc(sizeof(StreamPoolItem));
+        if (!pool) {
+            return halide_error_code_out_of_memory;
+        }
+        memset(pool, 0, sizeof(StreamPoolItem));
+        pool->ctx = ctx;
+        pool->next = stream_pools;
+        stream_pools = pool;
+    }
+    if (!pool->streams[slot]) {
+        debug(user_context) << "    cuStreamCreate for slot " << slot << " of context " << ctx << "\n";
+        CUresult err = cuStreamCreate(&pool->streams[slot], CU_STREAM_NON_BLOCKING);
+        if (err != CUDA_SUCCESS) {
+            pool->streams[slot] = nullptr;
+            return error_cuda(user_context, err, "cuStreamCreate failed");
+        }
+    }
+    *stream = pool->streams[slot];
+    return halide_error_code_success;
+}
+
+// Destroy the pooled streams of a context. Must be called with ctx
+// current, and after all work on the streams is done.
+WEAK void release_stream_pool(void *user_context, CUcontext ctx) {
+    StreamPoolItem *pool = nullptr;
+    {
+        ScopedMutexLock lock(&stream_pool_lock);
+        StreamPoolItem **prev = &stream_pools;
+        while (*prev && (*prev)->ctx != ctx) {
+            prev = &(*prev)->next;
+        }
+        pool = *prev;
+        if (pool) {
+            *prev = pool->next;
+        }
+    }
+    if (!pool) {
+        return;
+    }
+    for (auto &s : pool->streams) {
+        if (s) {
+            debug(user_context) << "    cuStreamDestroy " << s << "\n";
+            (void)cuStreamDestroy_v2(s);
+        }
+    }
+    free(pool);
+}
+
+// The streams uploads are queued on when they are overlapped with
+// kernels (see halide_cuda_use_copy_stream). There is one per context,
+// shared by all user_contexts using it.
+WEAK struct CopyStreamItem {
+    CUcontext ctx;
+    CUstream stream;
+    CopyStreamItem *next;
+} *copy_streams = nullptr;
+
+// An upload queued on a copy stream that no kernel has been made to
+// wait for yet. done fires once the device memory in [begin, end) is
+// valid.
+WEAK struct PendingCopyItem {
+    CUcontext ctx;
+    uint64_t begin, end;
+    CUevent done;
+    PendingCopyItem *next;
+} *pending_copies = nullptr;
+
+// The last kernel launched on stream that was passed the device memory
+// in [begin, end), while uploads were being queued on copy streams. An
+// upload into that memory must not start before done fires. Forgotten
+// when the stream is synchronized.
+WEAK struct KernelUseItem {
+    CUcontext ctx;
+    CUstream stream;
+    uint64_t begin, end;
+    CUevent done;
+    KernelUseItem *next;
+} *kernel_uses = nullptr;
+WEAK halide_mutex copy_stream_lock;
+
+// Whether uploads are queued on a copy stream. -1 means
+// HL_CUDA_COPY_STREAM has not been consulted yet.
+WEAK int copy_stream_enabled = -1;
+
+WEAK bool use_copy_stream() {
+    int enabled;
+    Synchronization::atomic_load_relaxed(&copy_stream_enabled, &enabled);
+    if (enabled < 0) {
+        const char *env = getenv("HL_CUDA_COPY_STREAM");
+        int from_env = (env && atoi(env) != 0) ? 1 : 0;
+        enabled = -1;
+        if (Synchronization::atomic_cas_strong_sequentially_consistent(&copy_stream_enabled, &enabled, &from_env)) {
+            enabled = from_env;
+        }
+    }
+    // Ordering the copy stream with the compute streams needs events.
+    return enabled != 0 &&
+           cuStreamCreate != nullptr && cuStreamSynchronize != nullptr &&
+           cuEventCreate != nullptr && cuEventRecord != nullptr &&
+           cuEventSynchronize != nullptr && cuEventDestroy_v2 != nullptr &&
+           cuStreamWaitEvent != nullptr;
+}
+
+// Whether halide_cuda_device_and_host_malloc uses managed memory. -1
+// means HL_CUDA_MANAGED_MEMORY has not been consulted yet.
+WEAK int managed_memory_enabled = -1;
+
+WEAK bool use_managed_memory() {
+    int enabled;
+    Synchronization::atomic_load_relaxed(&managed_memory_enabled, &enabled);
+    if (enabled < 0) {
+        const char *env = getenv("HL_CUDA_MANAGED_MEMORY");
+        int from_env = (env && atoi(env) != 0) ? 1 : 0;
+        enabled = -1;
+        if (Synchronization::atomic_cas_strong_sequentially_consistent(&managed_memory_enabled, &enabled, &from_env)) {
+            enabled = from_env;
+        }
+    }
+    return enabled != 0 && cuMemAllocManaged != nullptr;
+}
+
+// A buffer whose host pointer is its managed device allocation, as
+// made by halide_cuda_device_and_host_malloc with managed memory.
+WEAK bool is_managed(const halide_buffer_t *buf) {
+    return buf->device != 0 && buf->host == (uint8_t *)buf->device;
+}
+
+// Must be called with ctx current.
+WEAK int get_copy_stream(void *user_context, CUcontext ctx, CUstream *stream) {
+    ScopedMutexLock lock(&copy_stream_lock);
+    CopyStreamItem *item = copy_streams;
+    while (item && item->ctx != ctx) {
+        item = item->next;
+    }
+    if (!item) {
+        item = (CopyStreamItem *)malloc(sizeof(CopyStreamItem));
+        if (!item) {
+            return halide_error_code_out_of_memory;
+        }
+        debug(user_context) << "    cuStreamCreate for copies in context " << ctx << "\n";
+        CUresult err = cuStreamCreate(&item->stream, CU_STREAM_NON_BLOCKING);
+        if (err != CUDA_SUCCESS) {
+            free(item);
+            return error_cuda(user_context, err, "cuStreamCreate failed");
+        }
+        item->ctx = ctx;
+        item->next = copy_streams;
+        copy_streams = item;
+    }
+    *stream = item->stream;
+    return halide_error_code_success;
+}
+
+// The range of device addresses a buffer covers.
+WEAK void device_range(const halide_buffer_t *buf, uint64_t *begin, uint64_t *end) {
+    *begin = buf->device + buf->begin_offset() * buf->type.bytes();
+    *end = buf->device + buf->end_offset() * buf->type.bytes();
+}
+
+// Make work queued on stream after this call wait for the pending
+// uploads in ctx that overlap [begin, end). Once a stream waits for an
+// upload, it is forgotten, so other streams must be synchronized with
+// that one to use the data. Must be called with ctx current.
+WEAK int wait_for_pending_copies(void *user_context, CUcontext ctx, CUstream stream,
+                                 uint64_t begin = 0, uint64_t end = ~(uint64_t)0) {
+    ScopedMutexLock lock(&copy_stream_lock);
+    PendingCopyItem **prev = &pending_copies;
+    while (*prev) {
+        PendingCopyItem *item = *prev;
+        if (item->ctx != ctx || item->end <= begin || end <= item->begin) {
+            prev = &item->next;
+            continue;
+        }
+        debug(user_context) << "    cuStreamWaitEvent " << stream << " on upload to "
+                            << (void *)item->begin << "\n";
+        CUresult err = cuStreamWaitEvent(stream, item->done, 0);
+        if (err != CUDA_SUCCESS) {
+            return error_cuda(user_context, err, "cuStreamWaitEvent failed");
+        }
+        // The wait above holds on to the event, so it is safe to
+        // destroy it before it fires.
+        (void)cuEventDestroy_v2(item->done);
+        *prev = item->next;
+        free(item);
+    }
+    return halide_error_code_success;
+}
+
+// Note that the kernel just launched on stream was passed the device
+// memory in [begin, end). Must be called with ctx current.
+WEAK int note_kernel_use(void *user_context, CUcontext ctx, CUstream stream,
+                         uint64_t begin, uint64_t end) {
+    ScopedMutexLock lock(&copy_stream_lock);
+    KernelUseItem *item = kernel_uses;
+    while (item && !(item->ctx == ctx && item->begin == begin && item->end == end)) {
+        item = item->next;
+    }
+    if (!item) {
+        item = (KernelUseItem *)malloc(sizeof(KernelUseItem));
+        if (!item) {
+            return halide_error_code_out_of_memory;
+        }
+        CUresult err = cuEventCreate(&item->done, CU_EVENT_DISABLE_TIMING);
+        if (err != CUDA_SUCCESS) {
+            free(item);
+            return error_cuda(user_context, err, "cuEventCreate failed");
+        }
+        item->ctx = ctx;
+        item->begin = begin;
+        item->end = end;
+        item->next = kernel_uses;
+        kernel_uses = item;
+    }
+    // Re-recording the event doesn't affect waits already queued on it.
+    item->stream = stream;
+    CUresult err = cuEventRecord(item->done, stream);
+    if (err != CUDA_SUCCESS) {
+        return error_cuda(user_context, err, "cuEventRecord failed");
+    }
+    return halide_error_code_success;
+}
+
+// Make work queued on copy_stream after this call wait for the kernels
+// that were passed device memory overlapping [begin, end). Must be
+// called with ctx current.
+WEAK int wait_for_kernel_uses(void *user_context, CUcontext ctx, CUstream copy_stream,
+                              uint64_t begin, uint64_t end) {
+    ScopedMutexLock lock(&copy_stream_lock);
+    for (KernelUseItem *item = kernel_uses; item; item = item->next) {
+        if (item->ctx != ctx || item->end <= begin || end <= item->begin) {
+            continue;
+        }
+        CUresult err = cuStreamWaitEvent(copy_stream, item->done, 0);
+        if (err != CUDA_SUCCESS) {
+            return error_cuda(user_context, err, "cuStreamWaitEvent failed");
+        }
+    }
+    return halide_error_code_success;
+}
+
+// Forget the kernel uses on a stream that has just been synchronized.
+WEAK void forget_kernel_uses(CUcontext ctx, CUstream stream) {
+    ScopedMutexLock lock(&copy_stream_lock);
+    KernelUseItem **prev = &kernel_uses;
+    while (*prev) {
+        KernelUseItem *item = *prev;
+        if (item->ctx == ctx && item->stream == stream) {
+            (void)cuEventDestroy_v2(item->done);
+            *prev = item->next;
+            free(item);
+        } else {
+            prev = &item->next;
+        }
+    }
+}
+
+// Destroy the copy stream of a context, and forget its pending uploads
+// and kernel uses. Must be called with ctx current, and after all work
+// on the streams of the context is done.
+WEAK void release_copy_stream(void *user_context, CUcontext ctx) {
+    ScopedMutexLock lock(&copy_stream_lock);
+    KernelUseItem **use = &kernel_uses;
+    while (*use) {
+        KernelUseItem *item = *use;
+        if (item->ctx == ctx) {
+            (void)cuEventDestroy_v2(item->done);
+            *use = item->next;
+            free(item);
+        } else {
+            use = &item->next;
+        }
+    }
+    PendingCopyItem **pending = &pending_copies;
+    while (*pending) {
+        PendingCopyItem *item = *pending;
+        if (item->ctx == ctx) {
+            (void)cuEventDestroy_v2(item->done);
+            *pending = item->next;
+            free(item);
+        } else {
+            pending = &item->next;
+        }
+    }
+    CopyStreamItem **prev = &copy_streams;
+    while (*prev && (*prev)->ctx != ctx) {
+        prev = &(*prev)->next;
+    }
+    if (CopyStreamItem *item = *prev) {
+        debug(user_context) << "    cuStreamDestroy " << item->stream << "\n";
+        (void)cuStreamDestroy_v2(item->stream);
+        *prev = item->next;
+        free(item);
+    }
+}
+
 }  // namespace Cuda
 }  // namespace Internal
 }  // namespace Runtime
@@ -157,6 +583,29 @@ WEAK int halide_default_cuda_acquire_context(void *user_context, CUcontext *ctx,
     // If the context has not been initialized, initialize it now.
     halide_abort_if_false(user_context, &context != nullptr);
 
+    // A user_context bound to a device gets that device's context
+    // instead of the default one.
+    int device = bound_device(user_context);
+    if (device >= 0) {
+        CUcontext local_val = device_contexts[device];
+        if (local_val == nullptr) {
+            if (!create) {
+                *ctx = nullptr;
+                return halide_error_code_success;
+            }
+            ScopedMutexLock spinlock(&context_lock);
+            local_val = device_contexts[device];
+            if (local_val == nullptr) {
+                if (auto result = create_cuda_context(user_context, &local_val, device);
+                    result != halide_error_code_success) {
+                    return result;
+                }
+            }
+        }
+        *ctx = local_val;
+        return halide_error_code_success;
+    }
+
     // Note that this null-check of the context is *not* locked with
     // respect to device_release, so we may get a non-null context
     // that's in the process of being destroyed. Things will go badly
@@ -198,10 +647,15 @@ WEAK int halide_default_cuda_release_context(void *user_context) {
 
 // Return the stream to use for executing kernels and synchronization. Only called
 // for versions of cuda which support streams. Default is to use the main stream
-// for the context (nullptr stream). The context is passed in for convenience, but
-// any sort of scoping must be handled by that of the
+// for the context (nullptr stream), unless the stream pool is enabled (see
+// halide_cuda_use_stream_pool), in which case each user_context is mapped to one
+// of a small set of non-blocking streams. The context is passed in for
+// convenience, but any sort of scoping must be handled by that of the
 // halide_cuda_acquire_context/halide_cuda_release_context pair, not this call.
 WEAK int halide_default_cuda_get_stream(void *user_context, CUcontext ctx, CUstream *stream) {
+    if (use_stream_pool()) {
+        return get_pooled_stream(user_context, ctx, stream);
+    }
     // There are two default streams we could use. stream 0 is fully
     // synchronous. stream 2 gives a separate non-blocking stream per
     // thread.
@@ -209,6 +663,76 @@ WEAK int halide_default_cuda_get_stream(void *user_context, CUcontext ctx, CUstr
     return halide_error_code_success;
 }
 
+WEAK int halide_cuda_use_stream_pool(void *user_context, bool enable) {
+    int value = enable ? 1 : 0;
+    Synchronization::atomic_store_sequentially_consistent(&stream_pool_enabled, &value);
+    return halide_error_code_success;
+}
+
+WEAK int halide_cuda_use_managed_memory(void *user_context, bool enable) {
+    int value = enable ? 1 : 0;
+    Synchronization::atomic_store_sequentially_consistent(&managed_memory_enabled, &value);
+    return halide_error_code_success;
+}
+
+WEAK int halide_cuda_use_copy_stream(void *user_context, bool enable) {
+    int value = enable ? 1 : 0;
+    Synchronization::atomic_store_sequentially_consistent(&copy_stream_enabled, &value);
+    return halide_error_code_success;
+}
+
+WEAK int halide_cuda_set_user_context_device(void *user_context, int device) {
+    if (device < -1 || device >= max_cuda_devices) {
+        error(user_context) << "CUDA: device " << device << " is out of range for halide_cuda_set_user_context_device";
+        return halide_error_code_generic_error;
+    }
+
+    ScopedMutexLock lock(&device_bindings_lock);
+    DeviceBindingItem **prev = &device_bindings;
+    while (*prev && (*prev)->user_context != user_context) {
+        prev = &(*prev)->next;
+    }
+    DeviceBindingItem *item = *prev;
+    if (device == -1) {
+        if (item) {
+            *prev = item->next;
+            free(item);
+        }
+        return halide_error_code_success;
+    }
+    if (!item) {
+        item = (DeviceBindingItem *)malloc(sizeof(DeviceBindingItem));
+        if (!item) {
+            return halide_error_code_out_of_memory;
+        }
+        item->user_context = user_context;
+        item->next = device_bindings;
+        device_bindings = item;
+    }
+    item->device = device;
+    return halide_error_code_success;
+}
+
+WEAK int halide_cuda_get_device_count(void *user_context, int *count) {
+    *count = 0;
+    auto result = ensure_libcuda_init(user_context);
+    if (result) {
+        return result;
+    }
+    if (!cuInit) {
+        return error_cuda(user_context, CUDA_ERROR_FILE_NOT_FOUND, "Could not find cuda system libraries");
+    }
+    CUresult err = cuInit(0);
+    if (err != CUDA_SUCCESS) {
+        return error_cuda(user_context, err, "cuInit failed");
+    }
+    err = cuDeviceGetCount(count);
+    if (err != CUDA_SUCCESS) {
+        return error_cuda(user_context, err, "cuGetDeviceCount failed");
+    }
+    return halide_error_code_success;
+}
+
 }  // extern "C"
 
 namespace Halide {
@@ -319,7 +843,46 @@ public:
 
 WEAK Halide::Internal::GPUCompilationCache<CUcontext, CUmodule> compilation_cache;
 
-WEAK int create_cuda_context(void *user_context, CUcontext *ctx) {
+// Let the context of a device access the memory of each of the other
+// devices we have contexts for, and vice versa, where the hardware
+// allows it, so that copies and kernels that touch buffers on another
+// device go directly over the peer link. Called with context_lock held.
+WEAK void enable_peer_access(void *user_context, int device) {
+    if (!cuDeviceCanAccessPeer || !cuCtxEnablePeerAccess) {
+        return;
+    }
+    CUdevice dev;
+    if (cuDeviceGet(&dev, device) != CUDA_SUCCESS) {
+        return;
+    }
+    for (int i = 0; i < max_cuda_devices; i++) {
+        CUdevice peer;
+        if (i == device || !device_contexts[i] || cuDeviceGet(&peer, i) != CUDA_SUCCESS) {
+            continue;
+        }
+        struct {
+            CUdevice dev, peer;
+            CUcontext ctx, peer_ctx;
+        } directions[] = {{dev, peer, device_contexts[device], device_contexts[i]},
+                          {peer, dev, device_contexts[i], device_contexts[device]}};
+        for (const auto &d : directions) {
+            int can_access = 0;
+            if (cuDeviceCanAccessPeer(&can_access, d.dev, d.peer) != CUDA_SUCCESS || !can_access) {
+                continue;
+            }
+            if (cuCtxPushCurrent(d.ctx) != CUDA_SUCCESS) {
+                continue;
+            }
+            CUresult err = cuCtxEnablePeerAccess(d.peer_ctx, 0);
+            debug(user_context) << "    cuCtxEnablePeerAccess " << d.peer_ctx << " from " << d.ctx
+                                << ": " << get_cuda_error_name(err) << "\n";
+            CUcontext old;
+            cuCtxPopCurrent(&old);
+        }
+    }
+}
+
+WEAK int create_cuda_context(void *user_context, CUcontext *ctx, int requested_device) {
     // Initialize CUDA
     auto result = ensure_libcuda_init(user_context);
     if (result) {
@@ -345,7 +908,10 @@ WEAK int create_cuda_context(void *user_context, CUcontext *ctx) {
         return error_cuda(user_context, CUDA_ERROR_NO_DEVICE, "No devices available");
     }
 
-    int device = halide_get_gpu_device(user_context);
+    int device = requested_device >= 0 ? requested_device : halide_get_gpu_device(user_context);
+    if (device >= deviceCount) {
+        return error_cuda(user_context, CUDA_ERROR_INVALID_DEVICE, "Device ", device, " requested, but only ", deviceCount, " available");
+    }
     if (device == -1 && deviceCount == 1) {
         device = 0;
     } else if (device == -1) {
@@ -380,6 +946,12 @@ WEAK int create_cuda_context(void *user_context, CUcontext *ctx) {
 
     debug(user_context) << "    Got device " << dev << "\n";
 
+    // Share the context we already have for this device, if any.
+    if (device < max_cuda_devices && device_contexts[device]) {
+        *ctx = device_contexts[device];
+        return halide_error_code_success;
+    }
+
 // Dump device attributes
 #ifdef DEBUG_RUNTIME
     {
@@ -499,6 +1071,11 @@ WEAK int create_cuda_context(void *user_context, CUcontext *ctx) {
         return error_cuda(user_context, err, "cuCtxPopCurrent failed");
     }
 
+    if (device < max_cuda_devices) {
+        device_contexts[device] = *ctx;
+        enable_peer_access(user_context, device);
+    }
+
     return halide_error_code_success;
 }
 
@@ -525,6 +1102,62 @@ WEAK int validate_device_pointer(void *user_context, halide_buffer_t *buf, size_
 #endif
 }
 
+// Identify the binary the driver would produce for some PTX on the
+// current context's device.
+WEAK void cuda_binary_cache_key(const char *ptx_src, int size, unsigned int max_regs_per_thread,
+                                Halide::Internal::GPUBinaryCacheKey *key) {
+    key->add(ptx_src, size);
+    key->add_value(max_regs_per_thread);
+
+    CUdevice dev = 0;
+    char name[256] = {0};
+    int major = 0, minor = 0, driver_version = 0;
+    if (cuCtxGetDevice(&dev) == CUDA_SUCCESS) {
+        cuDeviceGetName(name, sizeof(name) - 1, dev);
+        cuDeviceGetAttribute(&major, CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MAJOR, dev);
+        cuDeviceGetAttribute(&minor, CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR, dev);
+    }
+    if (cuDriverGetVersion) {
+        cuDriverGetVersion(&driver_version);
+    }
+    key->add(name);
+    key->add_value(major);
+    key->add_value(minor);
+    key->add_value(driver_version);
+}
+
+// Compile PTX with the driver's JIT linker, which, unlike
+// cuModuleLoadData, hands back the resulting binary so that it can be
+// stored in the persistent kernel cache.
+WEAK CUmodule link_and_cache_kernel(void *user_context, const char *ptx_src, int size,
+                                    CUjit_option *options, void **option_values, int num_options,
+                                    const Halide::Internal::GPUBinaryCacheKey &key) {
+    CUlinkState state;
+    CUresult err = cuLinkCreate_v2(num_options, options, option_values, &state);
+    if (err != CUDA_SUCCESS) {
+        return nullptr;
+    }
+    CUmodule loaded_module = nullptr;
+    void *cubin = nullptr;
+    size_t cubin_size = 0;
+    err = cuLinkAddData_v2(state, CU_JIT_INPUT_PTX, (void *)ptx_src, size, "halide", 0, nullptr, nullptr);
+    if (err == CUDA_SUCCESS) {
+        err = cuLinkComplete(state, &cubin, &cubin_size);
+    }
+    if (err == CUDA_SUCCESS) {
+        err = cuModuleLoadData(&loaded_module, cubin);
+    }
+    if (err == CUDA_SUCCESS) {
+        // The binary is owned by the link state, so store it first.
+        Halide::Internal::gpu_binary_cache_store(user_context, "cuda", key, cubin, cubin_size);
+    } else {
+        debug(user_context) << "    cuLink failed: " << get_cuda_error_name(err) << "\n";
+        loaded_module = nullptr;
+    }
+    cuLinkDestroy(state);
+    return loaded_module;
+}
+
 WEAK CUmodule compile_kernel(void *user_context, const char *ptx_src, int size) {
     debug(user_context) << "CUDA: compile_kernel cuModuleLoadData " << (void *)ptx_src << ", " << size << " -> ";
 
@@ -540,6 +1173,30 @@ WEAK CUmodule compile_kernel(void *user_context, const char *ptx_src, int size)
     }
     void *optionValues[] = {(void *)(uintptr_t)max_regs_per_thread};
     CUmodule loaded_module;
+
+    const char *cache_dir = halide_gpu_kernel_cache_dir(user_context);
+    if (cache_dir && *cache_dir &&
+        cuLinkCreate_v2 && cuLinkAddData_v2 && cuLinkComplete && cuLinkDestroy) {
+        Halide::Internal::GPUBinaryCacheKey key;
+        cuda_binary_cache_key(ptx_src, size, max_regs_per_thread, &key);
+        size_t binary_size = 0;
+        void *binary = Halide::Internal::gpu_binary_cache_load(user_context, "cuda", key, &binary_size);
+        if (binary) {
+            CUresult err = cuModuleLoadData(&loaded_module, binary);
+            free(binary);
+            if (err == CUDA_SUCCESS) {
+                debug(user_context) << (void *)(loaded_module) << "\n";
+                return loaded_module;
+            }
+        }
+        loaded_module = link_and_cache_kernel(user_context, ptx_src, size, options, optionValues, 1, key);
+        if (loaded_module) {
+            debug(user_context) << (void *)(loaded_module) << "\n";
+            return loaded_module;
+        }
+        // Fall back to the plain path, which reports any error.
+    }
+
     CUresult err = cuModuleLoadDataEx(&loaded_module, ptx_src, 1, options, optionValues);
 
     if (err != CUDA_SUCCESS) {
@@ -552,46 +1209,368 @@ WEAK CUmodule compile_kernel(void *user_context, const char *ptx_src, int size)
     return loaded_module;
 }
 
+// Times a kernel on the device with a pair of events, if the profiler
+// asked for kernel times. Reporting the time means waiting for the
+// kernel to finish.
+class KernelTimer {
+    CUevent start = nullptr, end = nullptr;
+
+public:
+    ALWAYS_INLINE KernelTimer(CUstream stream) {
+        if (!should_time_device_kernels() || cuEventElapsedTime == nullptr) {
+            return;
+        }
+        if (cuEventCreate(&start, 0) != CUDA_SUCCESS ||
+            cuEventCreate(&end, 0) != CUDA_SUCCESS ||
+            cuEventRecord(start, stream) != CUDA_SUCCESS) {
+            release();
+        }
+    }
+
+    ALWAYS_INLINE void finish(void *user_context, CUstream stream) {
+        if (!start) {
+            return;
+        }
+        float ms = 0;
+        if (cuEventRecord(end, stream) == CUDA_SUCCESS &&
+            cuEventSynchronize(end) == CUDA_SUCCESS &&
+            cuEventElapsedTime(&ms, start, end) == CUDA_SUCCESS) {
+            device_profiler_event(user_context, DeviceProfilerKernel, 0, 0, (uint64_t)(ms * 1000000.0f));
+        }
+    }
+
+    ALWAYS_INLINE void release() {
+        if (start) {
+            cuEventDestroy_v2(start);
+        }
+        if (end) {
+            cuEventDestroy_v2(end);
+        }
+        start = end = nullptr;
+    }
+
+    ALWAYS_INLINE ~KernelTimer() {
+        release();
+    }
+
+    KernelTimer(const KernelTimer &) = delete;
+    KernelTimer &operator=(const KernelTimer &) = delete;
+};
+
 }  // namespace Cuda
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
 
-extern "C" {
-WEAK int halide_cuda_initialize_kernels(void *user_context, void **state_ptr, const char *ptx_src, int size) {
-    debug(user_context) << "CUDA: halide_cuda_initialize_kernels (user_context: " << user_context
-                        << ", state_ptr: " << state_ptr
-                        << ", ptx_src: " << (void *)ptx_src
-                        << ", size: " << size << "\n";
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace Cuda {
 
-    Context ctx(user_context);
-    if (ctx.error()) {
-        return ctx.error();
-    }
+// A kernel launch recorded into a graph. The launch parameters point
+// at a private copy of the kernel arguments, which is refreshed on
+// every replay.
+struct GraphKernel {
+    CUDA_KERNEL_NODE_PARAMS params;
+    size_t num_args;
+    size_t *arg_sizes;
+    CUgraphNode node;
+    bool dirty;
+};
 
-#ifdef DEBUG_RUNTIME
-    uint64_t t_before = halide_current_time_ns(user_context);
-#endif
+enum GraphMode {
+    // Kernels are launched as usual, and recorded to build a graph
+    // from at the end of the call.
+    GraphRecording,
+    // Kernels are not launched, but matched against the recording and
+    // their arguments stashed for the graph launch at the end of the
+    // call.
+    GraphReplaying,
+    // Kernels are launched as usual, and nothing is recorded.
+    GraphDirect,
+};
 
-    CUmodule loaded_module;
-    if (!compilation_cache.kernel_state_setup(user_context, state_ptr, ctx.context, loaded_module,
-                                              compile_kernel, user_context, ptx_src, size)) {
-        return halide_error_code_generic_error;
-    }
-    halide_abort_if_false(user_context, loaded_module != nullptr);
+}  // namespace Cuda
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
 
-#ifdef DEBUG_RUNTIME
-    uint64_t t_after = halide_current_time_ns(user_context);
-    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
-#endif
+struct halide_cuda_graph_t {
+    void *user_context;  // The user_context of the call in progress, if any
+    CUcontext context;
+    CUstream stream;
+    CUgraph graph;
+    CUgraphExec exec;
+    GraphKernel *kernels;
+    int num_kernels, capacity;
+    int cursor;  // The next kernel to match while replaying
+    GraphMode mode;
+    halide_cuda_graph_t *next;  // Next graph in active_graphs
+};
 
-    return halide_error_code_success;
-}
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace Cuda {
 
-WEAK void halide_cuda_finalize_kernels(void *user_context, void *state_ptr) {
-    Context ctx(user_context);
-    if (ctx.error() == halide_error_code_success) {
-        compilation_cache.release_hold(user_context, ctx.context, state_ptr);
+// The graphs with a call in progress.
+WEAK halide_cuda_graph_t *active_graphs = nullptr;
+WEAK halide_mutex active_graphs_lock;
+
+WEAK halide_cuda_graph_t *find_active_graph(void *user_context) {
+    halide_cuda_graph_t *g;
+    Synchronization::atomic_load_relaxed(&active_graphs, &g);
+    if (g == nullptr) {
+        return nullptr;
+    }
+    ScopedMutexLock lock(&active_graphs_lock);
+    for (g = active_graphs; g != nullptr; g = g->next) {
+        if (g->user_context == user_context) {
+            return g;
+        }
+    }
+    return nullptr;
+}
+
+WEAK void remove_active_graph(halide_cuda_graph_t *graph) {
+    ScopedMutexLock lock(&active_graphs_lock);
+    for (halide_cuda_graph_t **g = &active_graphs; *g != nullptr; g = &(*g)->next) {
+        if (*g == graph) {
+            *g = graph->next;
+            break;
+        }
+    }
+    graph->next = nullptr;
+    graph->user_context = nullptr;
+}
+
+WEAK void clear_graph_kernels(halide_cuda_graph_t *graph) {
+    for (int i = 0; i < graph->num_kernels; i++) {
+        // The parameter array heads the kernel's storage.
+        free(graph->kernels[i].params.kernelParams);
+    }
+    graph->num_kernels = 0;
+}
+
+// Must be called with the graph's context current.
+WEAK void destroy_graph_exec(void *user_context, halide_cuda_graph_t *graph) {
+    if (graph->exec) {
+        debug(user_context) << "    cuGraphExecDestroy " << graph->exec << "\n";
+        cuGraphExecDestroy(graph->exec);
+        graph->exec = nullptr;
+    }
+    if (graph->graph) {
+        cuGraphDestroy(graph->graph);
+        graph->graph = nullptr;
+    }
+}
+
+// Appends a copy of a kernel launch to the recording. Returns false
+// if out of memory.
+WEAK bool record_graph_kernel(halide_cuda_graph_t *graph, const CUDA_KERNEL_NODE_PARAMS &params,
+                              const size_t *arg_sizes, size_t num_args) {
+    if (graph->num_kernels == graph->capacity) {
+        int capacity = graph->capacity ? graph->capacity * 2 : 16;
+        GraphKernel *kernels = (GraphKernel *)malloc(capacity * sizeof(GraphKernel));
+        if (kernels == nullptr) {
+            return false;
+        }
+        if (graph->kernels) {
+            memcpy(kernels, graph->kernels, graph->num_kernels * sizeof(GraphKernel));
+            free(graph->kernels);
+        }
+        graph->kernels = kernels;
+        graph->capacity = capacity;
+    }
+
+    // One allocation holds the parameter array, the argument sizes, and
+    // the arguments themselves, each padded to 8 bytes.
+    size_t header_size = (num_args + 1) * sizeof(void *) + num_args * sizeof(size_t);
+    size_t total_size = header_size;
+    for (size_t i = 0; i < num_args; i++) {
+        total_size += (arg_sizes[i] + 7) & ~(size_t)7;
+    }
+    void **kernel_params = (void **)malloc(total_size);
+    if (kernel_params == nullptr) {
+        return false;
+    }
+    size_t *sizes = (size_t *)(kernel_params + num_args + 1);
+    uint8_t *storage = (uint8_t *)kernel_params + header_size;
+    for (size_t i = 0; i < num_args; i++) {
+        sizes[i] = arg_sizes[i];
+        memcpy(storage, params.kernelParams[i], arg_sizes[i]);
+        kernel_params[i] = storage;
+        storage += (arg_sizes[i] + 7) & ~(size_t)7;
+    }
+    kernel_params[num_args] = nullptr;
+
+    GraphKernel &k = graph->kernels[graph->num_kernels++];
+    k.params = params;
+    k.params.kernelParams = kernel_params;
+    k.params.extra = nullptr;
+    k.num_args = num_args;
+    k.arg_sizes = sizes;
+    k.node = nullptr;
+    k.dirty = false;
+    return true;
+}
+
+// Matches a kernel launch against the next recorded one, and if it
+// matches takes its arguments. Grid and block sizes may change from
+// call to call, but the kernel and the layout of its arguments may not.
+WEAK bool replay_graph_kernel(halide_cuda_graph_t *graph, CUcontext ctx, CUstream stream,
+                              const CUDA_KERNEL_NODE_PARAMS &params,
+                              const size_t *arg_sizes, size_t num_args) {
+    if (graph->cursor >= graph->num_kernels ||
+        graph->context != ctx ||
+        graph->stream != stream) {
+        return false;
+    }
+    GraphKernel &k = graph->kernels[graph->cursor];
+    if (k.params.func != params.func ||
+        k.params.sharedMemBytes != params.sharedMemBytes ||
+        k.num_args != num_args) {
+        return false;
+    }
+    for (size_t i = 0; i < num_args; i++) {
+        if (k.arg_sizes[i] != arg_sizes[i]) {
+            return false;
+        }
+    }
+
+    if (k.params.gridDimX != params.gridDimX ||
+        k.params.gridDimY != params.gridDimY ||
+        k.params.gridDimZ != params.gridDimZ ||
+        k.params.blockDimX != params.blockDimX ||
+        k.params.blockDimY != params.blockDimY ||
+        k.params.blockDimZ != params.blockDimZ) {
+        k.params.gridDimX = params.gridDimX;
+        k.params.gridDimY = params.gridDimY;
+        k.params.gridDimZ = params.gridDimZ;
+        k.params.blockDimX = params.blockDimX;
+        k.params.blockDimY = params.blockDimY;
+        k.params.blockDimZ = params.blockDimZ;
+        k.dirty = true;
+    }
+    for (size_t i = 0; i < num_args; i++) {
+        if (memcmp(k.params.kernelParams[i], params.kernelParams[i], arg_sizes[i]) != 0) {
+            memcpy(k.params.kernelParams[i], params.kernelParams[i], arg_sizes[i]);
+            k.dirty = true;
+        }
+    }
+    graph->cursor++;
+    return true;
+}
+
+// Stops recording or replaying for the rest of the call in progress,
+// launching any kernels that have been deferred so far. Called when
+// the call diverges from the recording, and before anything that
+// must be ordered after the kernels already issued. Must be called
+// with the graph's context current.
+WEAK int flush_graph(void *user_context, halide_cuda_graph_t *graph) {
+    int result = halide_error_code_success;
+    if (graph->mode == GraphReplaying) {
+        debug(user_context) << "    CUDA graph diverged after " << graph->cursor
+                            << " of " << graph->num_kernels << " kernels, launching them directly\n";
+        for (int i = 0; i < graph->cursor && result == halide_error_code_success; i++) {
+            const CUDA_KERNEL_NODE_PARAMS &p = graph->kernels[i].params;
+            CUresult err = cuLaunchKernel(p.func,
+                                          p.gridDimX, p.gridDimY, p.gridDimZ,
+                                          p.blockDimX, p.blockDimY, p.blockDimZ,
+                                          p.sharedMemBytes,
+                                          graph->stream,
+                                          p.kernelParams,
+                                          nullptr);
+            if (err != CUDA_SUCCESS) {
+                result = error_cuda(user_context, err, "cuLaunchKernel failed");
+            }
+        }
+        // Record again on the next call.
+        destroy_graph_exec(user_context, graph);
+    }
+    clear_graph_kernels(graph);
+    graph->mode = GraphDirect;
+    return result;
+}
+
+// Flushes the graph of the call in progress with user_context, if it
+// has deferred or recorded any kernels. Must be called with a context
+// current.
+WEAK int flush_active_graph(void *user_context) {
+    halide_cuda_graph_t *graph = find_active_graph(user_context);
+    if (graph == nullptr ||
+        (graph->mode == GraphReplaying && graph->cursor == 0) ||
+        (graph->mode == GraphRecording && graph->num_kernels == 0)) {
+        return halide_error_code_success;
+    }
+    return flush_graph(user_context, graph);
+}
+
+// Builds and instantiates a graph that launches the recorded kernels
+// one after another. Must be called with the graph's context current.
+WEAK void instantiate_graph(void *user_context, halide_cuda_graph_t *graph) {
+    CUresult err = cuGraphCreate(&graph->graph, 0);
+    for (int i = 0; i < graph->num_kernels && err == CUDA_SUCCESS; i++) {
+        CUgraphNode *dep = i > 0 ? &graph->kernels[i - 1].node : nullptr;
+        err = cuGraphAddKernelNode(&graph->kernels[i].node, graph->graph, dep, i > 0 ? 1 : 0,
+                                   &graph->kernels[i].params);
+    }
+    if (err == CUDA_SUCCESS) {
+        err = cuGraphInstantiateWithFlags(&graph->exec, graph->graph, 0);
+    }
+    if (err != CUDA_SUCCESS) {
+        // Not an error; the kernels have already run, and later calls
+        // will just launch them directly too.
+        debug(user_context) << "    Could not build CUDA graph: " << get_cuda_error_name(err) << "\n";
+        graph->exec = nullptr;
+        destroy_graph_exec(user_context, graph);
+        clear_graph_kernels(graph);
+        return;
+    }
+    debug(user_context) << "    Instantiated CUDA graph " << graph->exec
+                        << " of " << graph->num_kernels << " kernels\n";
+}
+
+}  // namespace Cuda
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+extern "C" {
+WEAK int halide_cuda_initialize_kernels(void *user_context, void **state_ptr, const char *ptx_src, int size) {
+    debug(user_context) << "CUDA: halide_cuda_initialize_kernels (user_context: " << user_context
+                        << ", state_ptr: " << state_ptr
+                        << ", ptx_src: " << (void *)ptx_src
+                        << ", size: " << size << "\n";
+
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return ctx.error();
+    }
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+#endif
+
+    CUmodule loaded_module;
+    if (!compilation_cache.kernel_state_setup(user_context, state_ptr, ctx.context, loaded_module,
+                                              compile_kernel, user_context, ptx_src, size)) {
+        return halide_error_code_generic_error;
+    }
+    halide_abort_if_false(user_context, loaded_module != nullptr);
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+#endif
+
+    return halide_error_code_success;
+}
+
+WEAK void halide_cuda_finalize_kernels(void *user_context, void *state_ptr) {
+    Context ctx(user_context);
+    if (ctx.error() == halide_error_code_success) {
+        compilation_cache.release_hold(user_context, ctx.context, state_ptr);
     }
 }
 
@@ -609,6 +1588,26 @@ WEAK int halide_cuda_release_unused_device_allocations(void *user_context) {
         free(to_free);
         to_free = next;
     }
+
+    PinnedHostFreeListItem *pinned_to_free;
+    {
+        ScopedMutexLock lock(&pinned_host_free_list_lock);
+        pinned_to_free = pinned_host_free_list;
+        pinned_host_free_list = nullptr;
+    }
+    while (pinned_to_free) {
+        debug(user_context) << "    releasing page-locked host allocation " << pinned_to_free->ptr << "\n";
+        cuMemFreeHost(pinned_to_free->ptr);
+        PinnedHostFreeListItem *next = pinned_to_free->next;
+        free(pinned_to_free);
+        pinned_to_free = next;
+    }
+
+    return gpu_memory_release_unused(user_context, &cuda_memory_pool);
+}
+
+WEAK int halide_cuda_get_device_memory_stats(void *user_context, struct halide_device_memory_stats_t *stats) {
+    gpu_memory_get_stats(&cuda_memory_pool, stats);
     return halide_error_code_success;
 }
 
@@ -634,6 +1633,40 @@ ALWAYS_INLINE uint64_t quantize_allocation_size(uint64_t sz) {
     return sz;
 }
 
+// Tries to carve size bytes out of a block owned by the suballocator,
+// leaving *p null if that isn't possible.
+WEAK int cuda_suballocate(void *user_context, CUcontext ctx, size_t size, CUdeviceptr *p) {
+    CUstream stream = nullptr;
+    if (cuStreamSynchronize != nullptr) {
+        auto result = halide_cuda_get_stream(user_context, ctx, &stream);
+        if (result) {
+            return result;
+        }
+    }
+
+    GPUMemoryAllocation *allocation =
+        gpu_memory_reserve(user_context, &cuda_memory_pool, ctx, stream, suballocation_alignment, size);
+    if (allocation == nullptr) {
+        // As for plain allocations, release everything unused and try
+        // again before giving up.
+        auto result = halide_cuda_release_unused_device_allocations(user_context);
+        if (result) {
+            return result;
+        }
+        allocation = gpu_memory_reserve(user_context, &cuda_memory_pool, ctx, stream, suballocation_alignment, size);
+    }
+    if (allocation != nullptr) {
+        *p = (CUdeviceptr)allocation->block_handle + allocation->offset;
+        if (allocation->reused_block) {
+            device_profiler_event(user_context, DeviceProfilerPoolHit, 0, size);
+        }
+        debug(user_context) << "    suballocated " << (void *)(*p)
+                            << " at offset " << (uint64_t)allocation->offset
+                            << " of block " << allocation->block_handle << "\n";
+    }
+    return halide_error_code_success;
+}
+
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
@@ -652,6 +1685,13 @@ WEAK int halide_cuda_device_free(void *user_context, halide_buffer_t *buf) {
         << "CUDA: halide_cuda_device_free (user_context: " << user_context
         << ", buf: " << buf << ")\n";
 
+    if (is_managed(buf)) {
+        // The host data would go with it.
+        error(user_context) << "CUDA: halide_cuda_device_free called on a buffer with managed memory. "
+                            << "Use halide_device_and_host_free instead.\n";
+        return halide_error_code_device_free_failed;
+    }
+
     Context ctx(user_context);
     if (ctx.error()) {
         return ctx.error();
@@ -666,8 +1706,44 @@ WEAK int halide_cuda_device_free(void *user_context, halide_buffer_t *buf) {
         return result;
     }
 
+    if (cuStreamSynchronize != nullptr) {
+        // Make anything that reuses the memory wait for uploads to it
+        // still queued on a copy stream.
+        CUstream stream = nullptr;
+        result = halide_cuda_get_stream(user_context, ctx.context, &stream);
+        if (result) {
+            return result;
+        }
+        uint64_t begin, end;
+        device_range(buf, &begin, &end);
+        result = wait_for_pending_copies(user_context, ctx.context, stream, begin, end);
+        if (result) {
+            return result;
+        }
+    }
+
+    if (!halide_can_reuse_device_allocations(user_context)) {
+        // Kernels deferred to a graph may still use the memory we are
+        // about to hand back to the driver. Memory that is kept for
+        // reuse is only handed out again on the same stream, so is
+        // safe either way.
+        result = flush_active_graph(user_context);
+        if (result) {
+            return result;
+        }
+    }
+
+    GPUMemoryAllocation *allocation = gpu_memory_find(&cuda_memory_pool, (uintptr_t)dev_ptr);
+
     CUresult err = CUDA_SUCCESS;
-    if (halide_can_reuse_device_allocations(user_context)) {
+    if (allocation != nullptr) {
+        debug(user_context) << "    releasing suballocation " << (void *)(dev_ptr) << "\n";
+        result = gpu_memory_release(user_context, &cuda_memory_pool, allocation,
+                                    halide_can_reuse_device_allocations(user_context));
+        if (result) {
+            return result;
+        }
+    } else if (halide_can_reuse_device_allocations(user_context)) {
         debug(user_context) << "    caching allocation for later use: " << (void *)(dev_ptr) << "\n";
 
         FreeListItem *item = (FreeListItem *)malloc(sizeof(FreeListItem));
@@ -741,9 +1817,19 @@ WEAK int halide_cuda_device_release(void *user_context) {
             return error_cuda(user_context, err);
         }
 
+        // Launch anything deferred to a graph, ignoring errors.
+        (void)flush_active_graph(user_context);
+
         // Dump the contents of the free list, ignoring errors.
         (void)halide_cuda_release_unused_device_allocations(user_context);
 
+        // Anything still suballocated in this context is about to
+        // become invalid anyway.
+        (void)gpu_memory_release_context(user_context, &cuda_memory_pool, ctx);
+
+        release_stream_pool(user_context, ctx);
+        release_copy_stream(user_context, ctx);
+
         compilation_cache.delete_context(user_context, ctx, cuModuleUnload);
 
         CUcontext old_ctx;
@@ -754,14 +1840,23 @@ WEAK int halide_cuda_device_release(void *user_context) {
         {
             ScopedMutexLock spinlock(&context_lock);
 
-            if (ctx == context) {
-                debug(user_context) << "    cuCtxDestroy " << context << "\n";
+            bool owned = (ctx == context);
+            for (auto &c : device_contexts) {
+                if (c == ctx) {
+                    owned = true;
+                    c = nullptr;
+                }
+            }
+            if (owned) {
+                debug(user_context) << "    cuCtxDestroy " << ctx << "\n";
                 err = cuProfilerStop();
-                err = cuCtxDestroy(context);
+                err = cuCtxDestroy(ctx);
                 if (err != CUDA_SUCCESS && err != CUDA_ERROR_DEINITIALIZED) {
                     return error_cuda(user_context, err);
                 }
-                context = nullptr;
+                if (ctx == context) {
+                    context = nullptr;
+                }
             }
         }  // spinlock
     }
@@ -801,8 +1896,15 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
 #endif
 
     CUdeviceptr p = 0;
+    if (halide_can_use_device_suballocation(user_context)) {
+        auto result = cuda_suballocate(user_context, ctx.context, buf->size_in_bytes(), &p);
+        if (result) {
+            return result;
+        }
+    }
+
     FreeListItem *to_free = nullptr;
-    if (halide_can_reuse_device_allocations(user_context)) {
+    if (!p && halide_can_reuse_device_allocations(user_context)) {
         CUstream stream = nullptr;
         if (cuStreamSynchronize != nullptr) {
             auto result = halide_cuda_get_stream(user_context, ctx.context, &stream);
@@ -850,6 +1952,7 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
             p = best->ptr;
             *best_prev = best->next;
             free(best);
+            device_profiler_event(user_context, DeviceProfilerPoolHit, 0, size);
         }
     }
 
@@ -893,12 +1996,58 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
 }
 
 namespace {
+// The largest pitch cuMemcpy3D accepts for linear memory
+// (CU_DEVICE_ATTRIBUTE_MAX_PITCH is 2^31 - 1 on all current devices).
+constexpr uint64_t max_memcpy_pitch = 0x7fffffff;
+
 WEAK int cuda_do_multidimensional_copy(void *user_context, const device_copy &c,
                                        uint64_t src, uint64_t dst, int d, bool from_host, bool to_host,
                                        CUstream stream) {
+    device_copy_rect rect;
     if (d > MAX_COPY_DIMS) {
         error(user_context) << "Buffer has too many dimensions to copy to/from GPU\n";
         return halide_error_code_bad_dimensions;
+    } else if (!(from_host && to_host) &&
+               make_device_copy_rect(c, d, &rect) &&
+               rect.src_pitch <= max_memcpy_pitch &&
+               rect.dst_pitch <= max_memcpy_pitch) {
+        // Do the innermost one or two dimensions with a single strided
+        // copy, rather than one copy per contiguous chunk.
+        CUDA_MEMCPY3D copy;
+        memset(&copy, 0, sizeof(copy));
+        if (from_host) {
+            copy.srcMemoryType = CU_MEMORYTYPE_HOST;
+            copy.srcHost = (const void *)src;
+        } else {
+            copy.srcMemoryType = CU_MEMORYTYPE_DEVICE;
+            copy.srcDevice = (CUdeviceptr)src;
+        }
+        if (to_host) {
+            copy.dstMemoryType = CU_MEMORYTYPE_HOST;
+            copy.dstHost = (void *)dst;
+        } else {
+            copy.dstMemoryType = CU_MEMORYTYPE_DEVICE;
+            copy.dstDevice = (CUdeviceptr)dst;
+        }
+        copy.srcPitch = rect.src_pitch;
+        copy.srcHeight = rect.src_rows;
+        copy.dstPitch = rect.dst_pitch;
+        copy.dstHeight = rect.dst_rows;
+        copy.WidthInBytes = rect.width;
+        copy.Height = rect.height;
+        copy.Depth = rect.depth;
+        debug(user_context) << "cuMemcpy3D(" << (void *)dst << ", " << (void *)src << ", "
+                            << rect.width << "x" << rect.height << "x" << rect.depth << " bytes, pitches "
+                            << rect.src_pitch << ", " << rect.dst_pitch << ")\n";
+        CUresult err;
+        if (stream) {
+            err = cuMemcpy3DAsync(&copy, stream);
+        } else {
+            err = cuMemcpy3D(&copy);
+        }
+        if (err != CUDA_SUCCESS) {
+            return error_cuda(user_context, err, "cuMemcpy3D", " failed");
+        }
     } else if (d == 0) {
         CUresult err = CUDA_SUCCESS;
         const char *copy_name;
@@ -952,6 +2101,78 @@ WEAK int cuda_do_multidimensional_copy(void *user_context, const device_copy &c,
     }
     return halide_error_code_success;
 }
+
+// Queue the upload c of dst on the copy stream of ctx, so that it can
+// run while kernels already queued on stream are still running. It
+// only waits for the kernels that were passed the memory it overwrites,
+// unless after_stream is set, and kernels queued later wait for it in
+// halide_cuda_run. Must be called with ctx current.
+WEAK int cuda_queue_upload(void *user_context, CUcontext ctx, CUstream stream,
+                           const device_copy &c, const halide_buffer_t *dst,
+                           bool src_pinned, bool after_stream) {
+    CUstream copy_stream = nullptr;
+    if (auto result = get_copy_stream(user_context, ctx, &copy_stream); result != halide_error_code_success) {
+        return result;
+    }
+
+    uint64_t begin, end;
+    device_range(dst, &begin, &end);
+    if (after_stream) {
+        CUevent tail = nullptr;
+        CUresult err = cuEventCreate(&tail, CU_EVENT_DISABLE_TIMING);
+        if (err == CUDA_SUCCESS) {
+            err = cuEventRecord(tail, stream);
+        }
+        if (err == CUDA_SUCCESS) {
+            err = cuStreamWaitEvent(copy_stream, tail, 0);
+        }
+        if (tail) {
+            (void)cuEventDestroy_v2(tail);
+        }
+        if (err != CUDA_SUCCESS) {
+            return error_cuda(user_context, err, "Ordering the copy stream after stream failed");
+        }
+    } else if (auto result = wait_for_kernel_uses(user_context, ctx, copy_stream, begin, end);
+               result != halide_error_code_success) {
+        return result;
+    }
+
+    auto result = cuda_do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions,
+                                                true, false, copy_stream);
+    if (result) {
+        return result;
+    }
+
+    PendingCopyItem *item = (PendingCopyItem *)malloc(sizeof(PendingCopyItem));
+    if (!item) {
+        return halide_error_code_out_of_memory;
+    }
+    CUresult err = cuEventCreate(&item->done, CU_EVENT_DISABLE_TIMING);
+    if (err != CUDA_SUCCESS) {
+        free(item);
+        return error_cuda(user_context, err, "cuEventCreate failed");
+    }
+    err = cuEventRecord(item->done, copy_stream);
+    if (err == CUDA_SUCCESS && src_pinned) {
+        // As for copies on stream, the caller may write to page-locked
+        // host data as soon as we return.
+        err = cuEventSynchronize(item->done);
+    }
+    if (err != CUDA_SUCCESS) {
+        (void)cuEventDestroy_v2(item->done);
+        free(item);
+        return error_cuda(user_context, err, "Queueing an upload failed");
+    }
+    debug(user_context) << "    queued upload to " << (void *)begin << " on copy stream " << copy_stream << "\n";
+
+    item->ctx = ctx;
+    item->begin = begin;
+    item->end = end;
+    ScopedMutexLock lock(&copy_stream_lock);
+    item->next = pending_copies;
+    pending_copies = item;
+    return halide_error_code_success;
+}
 }  // namespace
 
 WEAK int halide_cuda_buffer_copy(void *user_context, struct halide_buffer_t *src,
@@ -1004,6 +2225,10 @@ WEAK int halide_cuda_buffer_copy(void *user_context, struct halide_buffer_t *src
         }
 #endif
 
+        if (auto result = flush_active_graph(user_context); result != halide_error_code_success) {
+            return result;
+        }
+
         CUstream stream = nullptr;
         if (cuStreamSynchronize != nullptr) {
             auto result = halide_cuda_get_stream(user_context, ctx.context, &stream);
@@ -1012,9 +2237,55 @@ WEAK int halide_cuda_buffer_copy(void *user_context, struct halide_buffer_t *src
             }
         }
 
-        auto result = cuda_do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions, from_host, to_host, stream);
-        if (result) {
-            return result;
+        if (src == dst && from_host != to_host && is_managed(src)) {
+            // The host and device data are the same managed memory, so
+            // all there is to do is wait for the kernels using it
+            // before the host does.
+            debug(user_context) << "    no copy needed for managed memory\n";
+            if (to_host) {
+                CUresult err = cuStreamSynchronize ? cuStreamSynchronize(stream) : cuCtxSynchronize();
+                if (err != CUDA_SUCCESS) {
+                    return error_cuda(user_context, err, "cuStreamSynchronize failed");
+                }
+                forget_kernel_uses(ctx.context, stream);
+            }
+        } else if (from_host && !to_host && use_copy_stream()) {
+            // Kernels deferred to a graph were launched by the flush
+            // above without noting what they use.
+            halide_cuda_graph_t *graph = find_active_graph(user_context);
+            auto result = cuda_queue_upload(user_context, ctx.context, stream, c, dst, src->pinned_host(),
+                                            graph != nullptr && graph->mode == GraphReplaying);
+            if (result) {
+                return result;
+            }
+        } else {
+            if (cuStreamSynchronize != nullptr) {
+                // Anything we read or overwrite may still be being
+                // uploaded on a copy stream.
+                auto result = wait_for_pending_copies(user_context, ctx.context, stream);
+                if (result) {
+                    return result;
+                }
+            }
+
+            auto result = cuda_do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions, from_host, to_host, stream);
+            if (result) {
+                return result;
+            }
+
+            if (stream && (to_host || (from_host && src->pinned_host()))) {
+                // The copies above were queued asynchronously, but the
+                // host data must be valid by the time we return, and the
+                // caller is free to write to the host data as soon as we
+                // do. Copies from pageable memory are staged by the
+                // driver, so only copies from page-locked memory can
+                // still be reading the source.
+                CUresult err = cuStreamSynchronize(stream);
+                if (err != CUDA_SUCCESS) {
+                    return error_cuda(user_context, err, "cuStreamSynchronize failed");
+                }
+                forget_kernel_uses(ctx.context, stream);
+            }
         }
 
 #ifdef DEBUG_RUNTIME
@@ -1092,6 +2363,10 @@ WEAK int halide_cuda_device_sync(void *user_context, struct halide_buffer_t *) {
     uint64_t t_before = halide_current_time_ns(user_context);
 #endif
 
+    if (auto result = flush_active_graph(user_context); result != halide_error_code_success) {
+        return result;
+    }
+
     CUresult err;
     if (cuStreamSynchronize != nullptr) {
         CUstream stream;
@@ -1099,7 +2374,14 @@ WEAK int halide_cuda_device_sync(void *user_context, struct halide_buffer_t *) {
         if (result) {
             return result;
         }
+        result = wait_for_pending_copies(user_context, ctx.context, stream);
+        if (result) {
+            return result;
+        }
         err = cuStreamSynchronize(stream);
+        if (err == CUDA_SUCCESS) {
+            forget_kernel_uses(ctx.context, stream);
+        }
     } else {
         err = cuCtxSynchronize();
     }
@@ -1124,6 +2406,7 @@ WEAK int halide_cuda_run(void *user_context,
                          size_t arg_sizes[],
                          void *args[],
                          int8_t arg_is_buffer[]) {
+    ScopedTimelineSpan span(TimelineKernel, entry_name);
 
     debug(user_context) << "CUDA: halide_cuda_run ("
                         << "user_context: " << user_context << ", "
@@ -1192,8 +2475,47 @@ WEAK int halide_cuda_run(void *user_context,
             free(translated_args);
             return result;
         }
+
+        // Uploads to the buffers we are passed may still be queued on
+        // a copy stream.
+        for (size_t i = 0; i < num_args; i++) {
+            if (!arg_is_buffer[i]) {
+                continue;
+            }
+            uint64_t begin, end;
+            device_range((halide_buffer_t *)args[i], &begin, &end);
+            if (auto result = wait_for_pending_copies(user_context, ctx.context, stream, begin, end);
+                result != halide_error_code_success) {
+                free(dev_handles);
+                free(translated_args);
+                return result;
+            }
+        }
+    }
+
+    CUDA_KERNEL_NODE_PARAMS params = {f,
+                                      (unsigned int)blocksX, (unsigned int)blocksY, (unsigned int)blocksZ,
+                                      (unsigned int)threadsX, (unsigned int)threadsY, (unsigned int)threadsZ,
+                                      (unsigned int)shared_mem_bytes,
+                                      translated_args,
+                                      nullptr};
+
+    halide_cuda_graph_t *graph = find_active_graph(user_context);
+    if (graph != nullptr && graph->mode == GraphReplaying) {
+        if (replay_graph_kernel(graph, ctx.context, stream, params, arg_sizes, num_args)) {
+            debug(user_context) << "    deferred to CUDA graph " << graph->exec << "\n";
+            free(dev_handles);
+            free(translated_args);
+            return halide_error_code_success;
+        }
+        if (auto result = flush_graph(user_context, graph); result != halide_error_code_success) {
+            free(dev_handles);
+            free(translated_args);
+            return result;
+        }
     }
 
+    KernelTimer timer(stream);
     err = cuLaunchKernel(f,
                          blocksX, blocksY, blocksZ,
                          threadsX, threadsY, threadsZ,
@@ -1201,14 +2523,42 @@ WEAK int halide_cuda_run(void *user_context,
                          stream,
                          translated_args,
                          nullptr);
+    if (err == CUDA_SUCCESS && graph != nullptr && graph->mode == GraphRecording) {
+        if (graph->num_kernels == 0) {
+            graph->context = ctx.context;
+            graph->stream = stream;
+        }
+        if (graph->context != ctx.context ||
+            graph->stream != stream ||
+            !record_graph_kernel(graph, params, arg_sizes, num_args)) {
+            clear_graph_kernels(graph);
+            graph->mode = GraphDirect;
+        }
+    }
     free(dev_handles);
     free(translated_args);
     if (err != CUDA_SUCCESS) {
         return error_cuda(user_context, err, "cuLaunchKernel failed");
     }
+    timer.finish(user_context, stream);
+
+    if (use_copy_stream()) {
+        // Later uploads into what this kernel uses must wait for it.
+        for (size_t i = 0; i < num_args; i++) {
+            if (!arg_is_buffer[i]) {
+                continue;
+            }
+            uint64_t begin, end;
+            device_range((halide_buffer_t *)args[i], &begin, &end);
+            if (auto result = note_kernel_use(user_context, ctx.context, stream, begin, end);
+                result != halide_error_code_success) {
+                return result;
+            }
+        }
+    }
 
 #ifdef DEBUG_RUNTIME
-    err = cuCtxSynchronize();
+    err = stream ? cuStreamSynchronize(stream) : cuCtxSynchronize();
     if (err != CUDA_SUCCESS) {
         return error_cuda(user_context, err, "cuCtxSynchronize failed");
     }
@@ -1218,12 +2568,378 @@ WEAK int halide_cuda_run(void *user_context,
     return halide_error_code_success;
 }
 
+WEAK int halide_cuda_occupancy_block_size(void *user_context,
+                                          void *state_ptr,
+                                          const char *entry_name,
+                                          int shared_mem_bytes,
+                                          int max_block_size) {
+    debug(user_context) << "CUDA: halide_cuda_occupancy_block_size ("
+                        << "user_context: " << user_context << ", "
+                        << "entry: " << entry_name << ", "
+                        << "shmem: " << shared_mem_bytes << ", "
+                        << "max: " << max_block_size << ")\n";
+
+    // Any failure just falls back to the largest block size allowed.
+    if (cuOccupancyMaxPotentialBlockSize == nullptr) {
+        return max_block_size;
+    }
+
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return max_block_size;
+    }
+
+    CUmodule mod{};
+    if (!compilation_cache.lookup(ctx.context, state_ptr, mod) || mod == nullptr) {
+        return max_block_size;
+    }
+    CUfunction f;
+    if (cuModuleGetFunction(&f, mod, entry_name) != CUDA_SUCCESS) {
+        return max_block_size;
+    }
+
+    ScopedMutexLock lock(&occupancy_lock);
+    for (OccupancyItem *item = occupancy_cache; item; item = item->next) {
+        if (item->f == f &&
+            item->shared_mem_bytes == shared_mem_bytes &&
+            item->max_block_size == max_block_size) {
+            return item->block_size;
+        }
+    }
+
+    int min_grid_size = 0, block_size = 0;
+    CUresult err = cuOccupancyMaxPotentialBlockSize(&min_grid_size, &block_size, f, nullptr,
+                                                    shared_mem_bytes, max_block_size);
+    if (err != CUDA_SUCCESS || block_size <= 0 || block_size > max_block_size) {
+        block_size = max_block_size;
+    }
+    debug(user_context) << "    chose block size " << block_size << "\n";
+
+    OccupancyItem *item = (OccupancyItem *)malloc(sizeof(OccupancyItem));
+    if (item) {
+        *item = {f, shared_mem_bytes, max_block_size, block_size, occupancy_cache};
+        occupancy_cache = item;
+    }
+    return block_size;
+}
+
+WEAK int halide_cuda_graph_begin(void *user_context, halide_cuda_graph_t **graph) {
+    debug(user_context)
+        << "CUDA: halide_cuda_graph_begin (user_context: " << user_context << ")\n";
+
+    halide_abort_if_false(user_context, graph != nullptr);
+    if (*graph == nullptr) {
+        halide_cuda_graph_t *g = (halide_cuda_graph_t *)malloc(sizeof(halide_cuda_graph_t));
+        if (g == nullptr) {
+            return halide_error_code_out_of_memory;
+        }
+        memset(g, 0, sizeof(halide_cuda_graph_t));
+        *graph = g;
+    }
+    halide_cuda_graph_t *g = *graph;
+
+    if (g->user_context != nullptr || find_active_graph(user_context) != nullptr) {
+        error(user_context) << "CUDA: halide_cuda_graph_begin called while a graph call is already in progress";
+        return halide_error_code_generic_error;
+    }
+
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return ctx.error();
+    }
+
+    g->cursor = 0;
+    if (g->exec != nullptr) {
+        g->mode = GraphReplaying;
+    } else if (cuGraphLaunch != nullptr &&
+               cuGraphInstantiateWithFlags != nullptr &&
+               cuGraphExecKernelNodeSetParams != nullptr) {
+        clear_graph_kernels(g);
+        g->mode = GraphRecording;
+    } else {
+        debug(user_context) << "    CUDA graphs are not supported by this driver\n";
+        g->mode = GraphDirect;
+    }
+
+    ScopedMutexLock lock(&active_graphs_lock);
+    g->user_context = user_context;
+    g->next = active_graphs;
+    active_graphs = g;
+    return halide_error_code_success;
+}
+
+WEAK int halide_cuda_graph_end(void *user_context, halide_cuda_graph_t *graph) {
+    debug(user_context)
+        << "CUDA: halide_cuda_graph_end (user_context: " << user_context
+        << ", graph: " << graph << ")\n";
+
+    if (graph == nullptr || graph->user_context != user_context) {
+        error(user_context) << "CUDA: halide_cuda_graph_end called without a matching halide_cuda_graph_begin";
+        return halide_error_code_generic_error;
+    }
+    remove_active_graph(graph);
+
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return ctx.error();
+    }
+
+    if (graph->mode == GraphRecording && graph->num_kernels > 0) {
+        instantiate_graph(user_context, graph);
+    } else if (graph->mode == GraphReplaying) {
+        if (graph->cursor != graph->num_kernels) {
+            // Fewer kernels than were recorded.
+            return flush_graph(user_context, graph);
+        }
+        for (int i = 0; i < graph->num_kernels; i++) {
+            GraphKernel &k = graph->kernels[i];
+            if (k.dirty) {
+                CUresult err = cuGraphExecKernelNodeSetParams(graph->exec, k.node, &k.params);
+                if (err != CUDA_SUCCESS) {
+                    return error_cuda(user_context, err, "cuGraphExecKernelNodeSetParams failed");
+                }
+                k.dirty = false;
+            }
+        }
+        debug(user_context) << "    cuGraphLaunch " << graph->exec << "\n";
+        CUresult err = cuGraphLaunch(graph->exec, graph->stream);
+        if (err != CUDA_SUCCESS) {
+            return error_cuda(user_context, err, "cuGraphLaunch failed");
+        }
+    }
+    graph->mode = GraphDirect;
+    return halide_error_code_success;
+}
+
+WEAK int halide_cuda_graph_release(void *user_context, halide_cuda_graph_t *graph) {
+    debug(user_context)
+        << "CUDA: halide_cuda_graph_release (user_context: " << user_context
+        << ", graph: " << graph << ")\n";
+
+    if (graph == nullptr) {
+        return halide_error_code_success;
+    }
+    if (graph->user_context != nullptr) {
+        remove_active_graph(graph);
+    }
+    if (graph->exec != nullptr || graph->graph != nullptr) {
+        Context ctx(user_context);
+        if (ctx.error()) {
+            return ctx.error();
+        }
+        destroy_graph_exec(user_context, graph);
+    }
+    clear_graph_kernels(graph);
+    free(graph->kernels);
+    free(graph);
+    return halide_error_code_success;
+}
+
+namespace {
+
+WEAK int cuda_free_pinned_host(void *user_context, void *host, size_t size) {
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return ctx.error();
+    }
+
+    if (halide_can_reuse_device_allocations(user_context)) {
+        debug(user_context) << "    caching page-locked allocation for later use: " << host << "\n";
+        PinnedHostFreeListItem *item = (PinnedHostFreeListItem *)malloc(sizeof(PinnedHostFreeListItem));
+        if (item) {
+            item->ptr = host;
+            item->ctx = ctx.context;
+            item->size = size;
+            ScopedMutexLock lock(&pinned_host_free_list_lock);
+            item->next = pinned_host_free_list;
+            pinned_host_free_list = item;
+            return halide_error_code_success;
+        }
+    }
+
+    debug(user_context) << "    releasing page-locked host allocation " << host << "\n";
+    CUresult err = cuMemFreeHost(host);
+    if (err != CUDA_SUCCESS) {
+        // We may be called as a destructor, so don't raise an error
+        // here. The allocation can't be reclaimed any other way, so
+        // just log the failure and drop it.
+        debug(user_context) << "    cuMemFreeHost failed: " << get_cuda_error_name(err) << "\n";
+    }
+    return halide_error_code_success;
+}
+
+}  // namespace
+
+namespace {
+
+// Allocate buf as managed memory that serves as both its host and
+// device data, leaving buf->host null if the device can't access
+// managed memory concurrently with the host.
+WEAK int cuda_managed_malloc(void *user_context, struct halide_buffer_t *buf) {
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return ctx.error();
+    }
+
+    CUdevice dev;
+    int concurrent = 0;
+    CUresult err = cuCtxGetDevice(&dev);
+    if (err == CUDA_SUCCESS) {
+        err = cuDeviceGetAttribute(&concurrent, CU_DEVICE_ATTRIBUTE_CONCURRENT_MANAGED_ACCESS, dev);
+    }
+    if (err != CUDA_SUCCESS || !concurrent) {
+        // Without concurrent access, the host may not touch managed
+        // memory while any kernel is running, which the rest of the
+        // runtime doesn't guarantee.
+        debug(user_context) << "    device lacks concurrent managed access, not using managed memory\n";
+        return halide_error_code_success;
+    }
+
+    const size_t size = buf->size_in_bytes();
+    halide_abort_if_false(user_context, size != 0);
+    CUdeviceptr p = 0;
+    debug(user_context) << "    cuMemAllocManaged " << (uint64_t)size << " -> ";
+    err = cuMemAllocManaged(&p, size, CU_MEM_ATTACH_GLOBAL);
+    if (err != CUDA_SUCCESS) {
+        return error_cuda(user_context, err, "cuMemAllocManaged failed");
+    }
+    debug(user_context) << (void *)p << "\n";
+
+    buf->device = p;
+    buf->host = (uint8_t *)p;
+    buf->device_interface = &cuda_device_interface;
+    buf->device_interface->impl->use_module();
+    return halide_error_code_success;
+}
+
+// The counterpart of cuda_managed_malloc.
+WEAK int cuda_managed_free(void *user_context, struct halide_buffer_t *buf) {
+    Context ctx(user_context);
+    if (ctx.error()) {
+        return ctx.error();
+    }
+
+    // cuMemFree does not wait for kernels still using the memory.
+    CUresult err = cuCtxSynchronize();
+    if (err == CUDA_SUCCESS) {
+        debug(user_context) << "    cuMemFree managed " << (void *)buf->device << "\n";
+        err = cuMemFree((CUdeviceptr)buf->device);
+    }
+    buf->device_interface->impl->release_module();
+    buf->device_interface = nullptr;
+    buf->device = 0;
+    buf->host = nullptr;
+    buf->set_host_dirty(false);
+    buf->set_device_dirty(false);
+    if (err != CUDA_SUCCESS) {
+        // We may be called as a destructor, so don't raise an error here.
+        return error_cuda(user_context, err);
+    }
+    return halide_error_code_success;
+}
+
+}  // namespace
+
 WEAK int halide_cuda_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_malloc(user_context, buf, &cuda_device_interface);
+    if (use_managed_memory()) {
+        debug(user_context)
+            << "CUDA: halide_cuda_device_and_host_malloc (user_context: " << user_context
+            << ", buf: " << buf << ") using managed memory\n";
+        auto result = cuda_managed_malloc(user_context, buf);
+        if (result || buf->host) {
+            return result;
+        }
+    }
+
+    if (!buf->pinned_host() && !halide_can_use_pinned_host_allocations(user_context)) {
+        return halide_default_device_and_host_malloc(user_context, buf, &cuda_device_interface);
+    }
+
+    debug(user_context)
+        << "CUDA: halide_cuda_device_and_host_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    const size_t size = quantize_allocation_size(buf->size_in_bytes());
+    void *host = nullptr;
+    {
+        Context ctx(user_context);
+        if (ctx.error()) {
+            return ctx.error();
+        }
+
+        if (cuMemHostAlloc != nullptr && cuMemFreeHost != nullptr) {
+            if (halide_can_reuse_device_allocations(user_context)) {
+                ScopedMutexLock lock(&pinned_host_free_list_lock);
+                PinnedHostFreeListItem **prev_ptr = &pinned_host_free_list;
+                for (PinnedHostFreeListItem *item = pinned_host_free_list; item; item = item->next) {
+                    if (item->ctx == ctx.context && item->size == size) {
+                        *prev_ptr = item->next;
+                        host = item->ptr;
+                        free(item);
+                        break;
+                    }
+                    prev_ptr = &item->next;
+                }
+            }
+
+            if (!host) {
+                debug(user_context) << "    cuMemHostAlloc: allocating page-locked host memory " << (uint64_t)size << "\n";
+                CUresult err = cuMemHostAlloc(&host, size, CU_MEMHOSTALLOC_PORTABLE);
+                if (err == CUDA_ERROR_OUT_OF_MEMORY) {
+                    // Cached allocations may be what is holding the
+                    // page-locked memory. Release them and try again.
+                    (void)halide_cuda_release_unused_device_allocations(user_context);
+                    err = cuMemHostAlloc(&host, size, CU_MEMHOSTALLOC_PORTABLE);
+                }
+                if (err != CUDA_SUCCESS) {
+                    debug(user_context) << "    cuMemHostAlloc failed (" << get_cuda_error_name(err)
+                                        << "), using pageable memory instead\n";
+                    host = nullptr;
+                }
+            }
+        }
+    }
+
+    if (!host) {
+        return halide_default_device_and_host_malloc(user_context, buf, &cuda_device_interface);
+    }
+
+    buf->host = (uint8_t *)host;
+    buf->set_pinned_host(true);
+    auto result = halide_device_malloc(user_context, buf, &cuda_device_interface);
+    if (result) {
+        (void)cuda_free_pinned_host(user_context, host, size);
+        buf->host = nullptr;
+        buf->set_pinned_host(false);
+    }
+    return result;
 }
 
 WEAK int halide_cuda_device_and_host_free(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_free(user_context, buf, &cuda_device_interface);
+    if (is_managed(buf)) {
+        return cuda_managed_free(user_context, buf);
+    }
+
+    if (!buf->pinned_host()) {
+        return halide_default_device_and_host_free(user_context, buf, &cuda_device_interface);
+    }
+
+    debug(user_context)
+        << "CUDA: halide_cuda_device_and_host_free (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    auto result = halide_device_free(user_context, buf);
+    if (buf->host) {
+        auto free_result = cuda_free_pinned_host(user_context, buf->host, quantize_allocation_size(buf->size_in_bytes()));
+        if (!result) {
+            result = free_result;
+        }
+        buf->host = nullptr;
+    }
+    buf->set_pinned_host(false);
+    buf->set_host_dirty(false);
+    buf->set_device_dirty(false);
+    return result;
 }
 
 WEAK int halide_cuda_wrap_device_ptr(void *user_context, struct halide_buffer_t *buf, uint64_t device_ptr) {
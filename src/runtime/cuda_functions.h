@@ -42,6 +42,7 @@ CUDA_FN_3020(CUresult, cuMemcpyDtoHAsync, cuMemcpyDtoHAsync_v2, (void *dstHost,
 CUDA_FN_3020(CUresult, cuMemcpyDtoDAsync, cuMemcpyDtoDAsync_v2, (CUdeviceptr dstHost, CUdeviceptr srcDevice, size_t ByteCount, CUstream stream));
 
 CUDA_FN_3020(CUresult, cuMemcpy3D, cuMemcpy3D_v2, (const CUDA_MEMCPY3D *pCopy));
+CUDA_FN_3020(CUresult, cuMemcpy3DAsync, cuMemcpy3DAsync_v2, (const CUDA_MEMCPY3D *pCopy, CUstream hStream));
 CUDA_FN(CUresult, cuLaunchKernel, (CUfunction f, unsigned int gridDimX, unsigned int gridDimY, unsigned int gridDimZ, unsigned int blockDimX, unsigned int blockDimY, unsigned int blockDimZ, unsigned int sharedMemBytes, CUstream hStream, void **kernelParams, void **extra));
 CUDA_FN(CUresult, cuCtxSynchronize, ());
 
@@ -50,7 +51,38 @@ CUDA_FN_4000(CUresult, cuCtxPopCurrent, cuCtxPopCurrent_v2, (CUcontext * pctx));
 
 CUDA_FN(CUresult, cuPointerGetAttribute, (void *result, int query, CUdeviceptr ptr));
 
+CUDA_FN_OPTIONAL(CUresult, cuDeviceCanAccessPeer, (int *canAccessPeer, CUdevice dev, CUdevice peerDev));
+CUDA_FN_OPTIONAL(CUresult, cuCtxEnablePeerAccess, (CUcontext peerContext, unsigned int Flags));
+
 CUDA_FN_OPTIONAL(CUresult, cuStreamSynchronize, (CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuStreamCreate, (CUstream * phStream, unsigned int Flags));
+CUDA_FN_OPTIONAL(CUresult, cuStreamDestroy_v2, (CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuStreamWaitEvent, (CUstream hStream, CUevent hEvent, unsigned int Flags));
+
+CUDA_FN_OPTIONAL(CUresult, cuEventCreate, (CUevent * phEvent, unsigned int Flags));
+CUDA_FN_OPTIONAL(CUresult, cuEventRecord, (CUevent hEvent, CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuEventSynchronize, (CUevent hEvent));
+CUDA_FN_OPTIONAL(CUresult, cuEventElapsedTime, (float *pMilliseconds, CUevent hStart, CUevent hEnd));
+CUDA_FN_OPTIONAL(CUresult, cuEventDestroy_v2, (CUevent hEvent));
+
+CUDA_FN_OPTIONAL(CUresult, cuMemHostAlloc, (void **pp, size_t bytesize, unsigned int Flags));
+CUDA_FN_OPTIONAL(CUresult, cuMemAllocManaged, (CUdeviceptr * dptr, size_t bytesize, unsigned int flags));
+CUDA_FN_OPTIONAL(CUresult, cuMemFreeHost, (void *p));
+
+CUDA_FN_OPTIONAL(CUresult, cuDriverGetVersion, (int *driverVersion));
+CUDA_FN_OPTIONAL(CUresult, cuOccupancyMaxPotentialBlockSize, (int *minGridSize, int *blockSize, CUfunction func, CUoccupancyB2DSize blockSizeToDynamicSMemSize, size_t dynamicSMemSize, int blockSizeLimit));
+CUDA_FN_OPTIONAL(CUresult, cuLinkCreate_v2, (unsigned int numOptions, CUjit_option *options, void **optionValues, CUlinkState *stateOut));
+CUDA_FN_OPTIONAL(CUresult, cuLinkAddData_v2, (CUlinkState state, CUjitInputType type, void *data, size_t size, const char *name, unsigned int numOptions, CUjit_option *options, void **optionValues));
+CUDA_FN_OPTIONAL(CUresult, cuLinkComplete, (CUlinkState state, void **cubinOut, size_t *sizeOut));
+CUDA_FN_OPTIONAL(CUresult, cuLinkDestroy, (CUlinkState state));
+
+CUDA_FN_OPTIONAL(CUresult, cuGraphCreate, (CUgraph * phGraph, unsigned int flags));
+CUDA_FN_OPTIONAL(CUresult, cuGraphDestroy, (CUgraph hGraph));
+CUDA_FN_OPTIONAL(CUresult, cuGraphAddKernelNode, (CUgraphNode * phGraphNode, CUgraph hGraph, const CUgraphNode *dependencies, size_t numDependencies, const CUDA_KERNEL_NODE_PARAMS *nodeParams));
+CUDA_FN_OPTIONAL(CUresult, cuGraphInstantiateWithFlags, (CUgraphExec * phGraphExec, CUgraph hGraph, unsigned long long flags));
+CUDA_FN_OPTIONAL(CUresult, cuGraphExecKernelNodeSetParams, (CUgraphExec hGraphExec, CUgraphNode hNode, const CUDA_KERNEL_NODE_PARAMS *nodeParams));
+CUDA_FN_OPTIONAL(CUresult, cuGraphLaunch, (CUgraphExec hGraphExec, CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuGraphExecDestroy, (CUgraphExec hGraphExec));
 
 #undef CUDA_FN
 #undef CUDA_FN_OPTIONAL
@@ -48,6 +48,7 @@
 #include "gpu_context_common.h"
 #include "printer.h"
 #include "scoped_mutex_lock.h"
+#include "timeline.h"
 
 #if !defined(INITGUID)
 #define INITGUID
@@ -274,6 +275,7 @@ D3D12TYPENAME(ID3D12CommandQueue)
 D3D12TYPENAME(ID3D12CommandAllocator)
 D3D12TYPENAME(ID3D12CommandList)
 D3D12TYPENAME(ID3D12GraphicsCommandList)
+D3D12TYPENAME(ID3D12Heap)
 D3D12TYPENAME(ID3D12Resource)
 D3D12TYPENAME(ID3D12PipelineState)
 D3D12TYPENAME(ID3D12RootSignature)
@@ -471,6 +473,7 @@ UUIDOF(ID3D12CommandQueue)
 UUIDOF(ID3D12CommandAllocator)
 UUIDOF(ID3D12CommandList)
 UUIDOF(ID3D12GraphicsCommandList)
+UUIDOF(ID3D12Heap)
 UUIDOF(ID3D12Resource)
 UUIDOF(ID3D12PipelineState)
 UUIDOF(ID3D12RootSignature)
@@ -518,8 +521,18 @@ namespace D3D12Compute {
 typedef halide_d3d12compute_device d3d12_device;
 typedef halide_d3d12compute_command_queue d3d12_command_queue;
 
+// Device buffers are placed in a few large heaps rather than each getting its
+// own committed resource (and implicit heap); a heap block is a simple bump
+// allocator that is rewound once every buffer placed in it has been released.
+struct d3d12_heap_block {
+    ID3D12Heap *heap;
+    uint64_t used;  // bytes
+    uint64_t live;  // number of placed buffers still alive
+};
+
 struct d3d12_buffer {
     ID3D12Resource *resource;
+    d3d12_heap_block *heap_block;  // nullptr for committed resources
     UINT capacityInBytes;
     UINT sizeInBytes;
     UINT offset;    // FirstElement
@@ -691,6 +704,19 @@ static constexpr int MaxFrames = 8;
 WEAK d3d12_frame frame_pool[MaxFrames] = {};
 WEAK uint64_t frame_selector = 0;
 
+// Recorded frames are not submitted to the queue right away; instead, they are
+// batched up and submitted together (with a single fence signal) whenever the
+// host has to wait on the device, amortizing the cost of ExecuteCommandLists()
+// across all the dispatches and copies issued in between.
+WEAK d3d12_compute_command_list *pending_cmd_lists[MaxFrames] = {};
+WEAK int pending_cmd_list_count = 0;
+
+static constexpr int MaxHeapBlocks = 16;
+static constexpr uint64_t PlacedHeapSize = 64 * 1024 * 1024;
+static constexpr uint64_t MaxPlacedBufferSize = 16 * 1024 * 1024;
+static constexpr uint64_t PlacedResourceAlignment = 64 * 1024;  // mandatory for buffers
+WEAK d3d12_heap_block heap_blocks[MaxHeapBlocks] = {};
+
 WEAK void wait_until_completed(d3d12_compute_command_list *cmdList);
 WEAK d3d12_command_list *new_compute_command_list(d3d12_device *device, d3d12_command_allocator *allocator);
 WEAK d3d12_binder *new_descriptor_binder(d3d12_device *device);
@@ -816,6 +842,15 @@ template<>
 WEAK void release_d3d12_object<d3d12_buffer>(d3d12_buffer *buffer) {
     TRACELOG;
     Release_ID3D12Object(buffer->resource);
+    if (buffer->heap_block != nullptr) {
+        d3d12_heap_block *block = buffer->heap_block;
+        halide_abort_if_false(user_context, (block->live > 0));
+        if (--block->live == 0) {
+            TRACEPRINT("rewinding heap block @ " << block << "\n");
+            block->used = 0;
+        }
+        buffer->heap_block = nullptr;
+    }
     if (buffer->host_mirror != nullptr) {
         d3d12_free(buffer->host_mirror);
     }
@@ -1265,6 +1300,65 @@ WEAK void dispatch_threadgroups(d3d12_compute_command_list *cmdList,
     (*cmdList)->Dispatch(blocks_x, blocks_y, blocks_z);
 }
 
+WEAK ID3D12Resource *new_placed_resource(d3d12_device *device, const D3D12_RESOURCE_DESC *pDesc,
+                                        D3D12_RESOURCE_STATES InitialResourceState, d3d12_heap_block **pBlock) {
+    TRACELOG;
+
+    uint64_t size = (pDesc->Width + PlacedResourceAlignment - 1) & ~(PlacedResourceAlignment - 1);
+    if (size > MaxPlacedBufferSize) {
+        return nullptr;
+    }
+
+    d3d12_heap_block *block = nullptr;
+    for (auto &candidate : heap_blocks) {
+        if (candidate.heap == nullptr) {
+            D3D12_HEAP_DESC heapDesc = {};
+            {
+                heapDesc.SizeInBytes = PlacedHeapSize;
+                heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+                heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+                heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+                heapDesc.Properties.CreationNodeMask = 0;
+                heapDesc.Properties.VisibleNodeMask = 0;
+                heapDesc.Alignment = PlacedResourceAlignment;
+                heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;  // required by resource heap tier 1
+            }
+            ID3D12Heap *heap = nullptr;
+            HRESULT result = (*device)->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap));
+            if (FAILED(result) || (heap == nullptr)) {
+                TRACEWARN("Unable to create Direct3D 12 buffer heap; falling back to committed resources\n");
+                return nullptr;
+            }
+            TRACEPRINT("new heap block @ " << &candidate << " (" << heap << ")\n");
+            candidate.heap = heap;
+            candidate.used = 0;
+            candidate.live = 0;
+        }
+        if (candidate.used + size <= PlacedHeapSize) {
+            block = &candidate;
+            break;
+        }
+    }
+    if (block == nullptr) {
+        TRACEPRINT("WARNING: [PERFORMANCE] all heap blocks are full: using a committed resource...\n");
+        return nullptr;
+    }
+
+    ID3D12Resource *resource = nullptr;
+    D3D12_CLEAR_VALUE *pOptimizedClearValue = nullptr;  // for buffers, this must be nullptr
+    HRESULT result = (*device)->CreatePlacedResource(block->heap, block->used, pDesc, InitialResourceState, pOptimizedClearValue, IID_PPV_ARGS(&resource));
+    if (FAILED(result) || (resource == nullptr)) {
+        TRACEWARN("Unable to create placed Direct3D 12 buffer; falling back to a committed resource\n");
+        return nullptr;
+    }
+
+    TRACEPRINT("placed buffer @ offset " << block->used << " (" << size << " bytes) of heap block " << block << "\n");
+    block->used += size;
+    block->live += 1;
+    *pBlock = block;
+    return resource;
+}
+
 WEAK d3d12_buffer new_buffer_resource(d3d12_device *device, size_t length, D3D12_HEAP_TYPE heaptype) {
     TRACELOG;
 
@@ -1319,10 +1413,16 @@ WEAK d3d12_buffer new_buffer_resource(d3d12_device *device, size_t length, D3D12
 
     d3d12_buffer buffer = {};
     ID3D12Resource *resource = nullptr;
-    // A commited resource manages its own private heap:
-    HRESULT result = (*device)->CreateCommittedResource(pHeapProperties, HeapFlags, pDesc, InitialResourceState, pOptimizedClearValue, IID_PPV_ARGS(&resource));
-    if (D3DErrorCheck(result, resource, nullptr, "Unable to create the Direct3D 12 buffer")) {
-        return buffer;
+    if (heaptype == D3D12_HEAP_TYPE_DEFAULT) {
+        // suballocating from a shared heap is much cheaper than a fresh heap per buffer
+        resource = new_placed_resource(device, pDesc, InitialResourceState, &buffer.heap_block);
+    }
+    if (resource == nullptr) {
+        // A commited resource manages its own private heap:
+        HRESULT result = (*device)->CreateCommittedResource(pHeapProperties, HeapFlags, pDesc, InitialResourceState, pOptimizedClearValue, IID_PPV_ARGS(&resource));
+        if (D3DErrorCheck(result, resource, nullptr, "Unable to create the Direct3D 12 buffer")) {
+            return buffer;
+        }
     }
 
     buffer.resource = resource;
@@ -2055,12 +2155,34 @@ WEAK uint64_t queue_insert_checkpoint() {
     return signal;
 }
 
+WEAK void flush_pending_command_lists() {
+    TRACELOG;
+    if (pending_cmd_list_count == 0) {
+        return;
+    }
+    TRACEPRINT("submitting " << pending_cmd_list_count << " pending command lists...\n");
+    ID3D12CommandList *lists[MaxFrames] = {};
+    for (int i = 0; i < pending_cmd_list_count; ++i) {
+        lists[i] = (*pending_cmd_lists[i]);
+    }
+    (*queue)->ExecuteCommandLists(pending_cmd_list_count, lists);
+    uint64_t signal = queue_insert_checkpoint();
+    for (int i = 0; i < pending_cmd_list_count; ++i) {
+        halide_abort_if_false(user_context, (pending_cmd_lists[i]->signal == signal));
+        pending_cmd_lists[i] = nullptr;
+    }
+    pending_cmd_list_count = 0;
+}
+
 WEAK void commit_command_list(d3d12_compute_command_list *cmdList) {
     TRACELOG;
     end_recording(cmdList);
-    ID3D12CommandList *lists[] = {(*cmdList)};
-    (*queue)->ExecuteCommandLists(1, lists);
-    cmdList->signal = queue_insert_checkpoint();
+    if (pending_cmd_list_count == MaxFrames) {
+        flush_pending_command_lists();
+    }
+    pending_cmd_lists[pending_cmd_list_count++] = cmdList;
+    // the whole batch completes at the checkpoint inserted by the next flush:
+    cmdList->signal = __atomic_load_n(&queue_last_signal, __ATOMIC_SEQ_CST) + 1;
 }
 
 // WARN(marcos): busywait interface for internal debugging purposes only
@@ -2095,6 +2217,11 @@ WEAK bool block_until_signaled(uint64_t signal) {
 WEAK void wait_until_signaled(uint64_t signal) {
     TRACELOG;
 
+    if (signal > __atomic_load_n(&queue_last_signal, __ATOMIC_SEQ_CST)) {
+        // the signal belongs to command lists that have not been submitted yet
+        flush_pending_command_lists();
+    }
+
     uint64_t current_signal = queue_fence->GetCompletedValue();
     if (current_signal >= signal) {
         TRACEPRINT("Already synced up!\n");
@@ -2126,6 +2253,7 @@ WEAK void wait_until_completed(d3d12_frame *frame) {
 
 WEAK void wait_until_idle() {
     TRACELOG;
+    flush_pending_command_lists();
     uint64_t signal = __atomic_load_n(&queue_last_signal, __ATOMIC_SEQ_CST);
     wait_until_signaled(signal);
 }
@@ -2815,6 +2943,11 @@ WEAK int halide_d3d12compute_device_release(void *user_context) {
             release_object(buffer);
         }
 
+        for (auto &block : heap_blocks) {
+            Release_ID3D12Object(block.heap);
+            block = zero_struct<d3d12_heap_block>();
+        }
+
         compilation_cache.delete_context(user_context, device, release_object<d3d12_library>);
 
         // Release the device itself, if we created it.
@@ -2964,6 +3097,8 @@ WEAK int halide_d3d12compute_run(void *user_context,
                                  halide_type_t arg_types[], void *args[], int8_t arg_is_buffer[]) {
     TRACELOG;
 
+    ScopedTimelineSpan span(TimelineKernel, entry_name);
+
     D3D12ContextHolder d3d12_context(user_context, true);
     if (d3d12_context.error()) {
         return d3d12_context.error();
@@ -3176,6 +3311,8 @@ WEAK int halide_d3d12compute_run(void *user_context,
 #endif
 
 #if HALIDE_D3D12_PROFILING
+    // timestamps are only available once the (deferred) dispatch has completed
+    wait_until_completed(frame);
     uint64_t eps = (uint64_t)get_elapsed_time(profiler, ini, end);
     StackBasicPrinter<64>() << "kernel execution time: " << eps << "us.\n";
     // TODO: keep some live performance stats in the d3d12_function object
@@ -161,6 +161,70 @@ WEAK device_copy make_buffer_copy(const halide_buffer_t *src, bool src_host,
     return c;
 }
 
+// The innermost dimensions of a device_copy, in the form taken by the
+// strided (2D/3D) copy APIs of the device backends, e.g. cuMemcpy3D or
+// clEnqueueReadBufferRect: depth slices of height rows of width
+// contiguous bytes. Rows are pitch bytes apart, and slices are
+// pitch * rows bytes apart.
+struct device_copy_rect {
+    uint64_t width, height, depth;
+    uint64_t src_pitch, src_rows;
+    uint64_t dst_pitch, dst_rows;
+};
+
+// Try to describe the innermost d dimensions (at most two) of a
+// device_copy as a single strided copy. Returns false if their
+// strides can't be expressed as row and slice pitches.
+WEAK bool make_device_copy_rect(const device_copy &c, int d, device_copy_rect *rect) {
+    if (d < 1 || d > 2) {
+        return false;
+    }
+    // Size-1 dimensions don't need a pitch.
+    uint64_t extent[2] = {1, 1}, src_stride[2] = {0, 0}, dst_stride[2] = {0, 0};
+    int n = 0;
+    for (int i = 0; i < d; i++) {
+        if (c.extent[i] != 1) {
+            extent[n] = c.extent[i];
+            src_stride[n] = c.src_stride_bytes[i];
+            dst_stride[n] = c.dst_stride_bytes[i];
+            n++;
+        }
+    }
+    // Only worth it if it replaces more than one copy.
+    if (n == 0) {
+        return false;
+    }
+
+    rect->width = c.chunk_size;
+    rect->height = extent[0];
+    rect->depth = extent[1];
+    // The strides are unsigned, so check for negative ones
+    // explicitly. Rows must not overlap.
+    if ((int64_t)src_stride[0] < (int64_t)rect->width ||
+        (int64_t)dst_stride[0] < (int64_t)rect->width) {
+        return false;
+    }
+    rect->src_pitch = src_stride[0];
+    rect->dst_pitch = dst_stride[0];
+    rect->src_rows = rect->dst_rows = rect->height;
+    if (n == 2) {
+        // The slice pitch must be a whole number of rows, and the
+        // slices must not overlap.
+        if ((int64_t)src_stride[1] <= 0 ||
+            (int64_t)dst_stride[1] <= 0 ||
+            src_stride[1] % rect->src_pitch != 0 ||
+            dst_stride[1] % rect->dst_pitch != 0) {
+            return false;
+        }
+        rect->src_rows = src_stride[1] / rect->src_pitch;
+        rect->dst_rows = dst_stride[1] / rect->dst_pitch;
+        if (rect->src_rows < rect->height || rect->dst_rows < rect->height) {
+            return false;
+        }
+    }
+    return true;
+}
+
 WEAK device_copy make_host_to_device_copy(const halide_buffer_t *buf) {
     return make_buffer_copy(buf, true, buf, false);
 }
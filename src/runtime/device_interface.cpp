@@ -3,6 +3,7 @@
 #include "device_buffer_utils.h"
 #include "printer.h"
 #include "scoped_mutex_lock.h"
+#include "timeline.h"
 
 extern "C" {
 
@@ -27,6 +28,11 @@ struct device_handle_wrapper {
 // need to be able to do a copy internaly as well.
 WEAK halide_mutex device_copy_mutex;
 
+WEAK device_profiler_hook_t device_profiler_hook = nullptr;
+WEAK bool device_profiler_time_kernels = false;
+
+WEAK timeline_hook_t timeline_hook = nullptr;
+
 WEAK int copy_to_host_already_locked(void *user_context, struct halide_buffer_t *buf) {
     if (!buf->device_dirty()) {
         return halide_error_code_success;  // my, that was easy
@@ -42,7 +48,16 @@ WEAK int copy_to_host_already_locked(void *user_context, struct halide_buffer_t
         debug(user_context) << "copy_to_host_already_locked " << buf << " interface is nullptr\n";
         return halide_error_code_no_device_interface;
     }
-    auto result = interface->impl->copy_to_host(user_context, buf);
+    uint64_t t_before = device_profiler_hook ? halide_current_time_ns(user_context) : 0;
+    int result;
+    {
+        ScopedTimelineSpan span(TimelineCopyToHost, nullptr, buf->size_in_bytes());
+        result = interface->impl->copy_to_host(user_context, buf);
+    }
+    if (device_profiler_hook && result == halide_error_code_success) {
+        device_profiler_event(user_context, DeviceProfilerCopyToHost, buf->device, buf->size_in_bytes(),
+                              halide_current_time_ns(user_context) - t_before);
+    }
     if (result) {
         debug(user_context) << "copy_to_host_already_locked " << buf << " device copy_to_host returned an error\n";
         return halide_error_code_copy_to_host_failed;
@@ -122,6 +137,66 @@ ALWAYS_INLINE int debug_log_and_validate_buf(void *user_context, const halide_bu
     return halide_error_code_success;
 }
 
+// Copy the part of buf within [min, min + extent) between host and
+// device through a crop of buf that shares its allocations, leaving
+// the dirty bits of buf alone. Sets *copied to false, without doing
+// anything, if the region covers all of buf.
+WEAK int copy_region(void *user_context, struct halide_buffer_t *buf,
+                     const halide_device_interface_t *device_interface,
+                     const int *min, const int *extent, bool to_host, bool *copied) {
+    *copied = false;
+    bool covers_all = true;
+    for (int i = 0; i < buf->dimensions; i++) {
+        covers_all = covers_all &&
+                     min[i] <= buf->dim[i].min &&
+                     min[i] + extent[i] >= buf->dim[i].min + buf->dim[i].extent;
+    }
+    if (covers_all) {
+        return halide_error_code_success;
+    }
+
+    halide_dimension_t *shape = (halide_dimension_t *)malloc(buf->dimensions * sizeof(halide_dimension_t));
+    if (!shape) {
+        return halide_error_code_out_of_memory;
+    }
+    halide_buffer_t crop = *buf;
+    crop.dim = shape;
+    crop.device = 0;
+    crop.device_interface = nullptr;
+    int64_t offset = 0;
+    bool empty = false;
+    for (int i = 0; i < buf->dimensions; i++) {
+        const halide_dimension_t &d = buf->dim[i];
+        int lo = min[i] > d.min ? min[i] : d.min;
+        int hi = min[i] + extent[i] < d.min + d.extent ? min[i] + extent[i] : d.min + d.extent;
+        empty = empty || hi <= lo;
+        shape[i] = d;
+        shape[i].min = lo;
+        shape[i].extent = hi - lo;
+        offset += (int64_t)(lo - d.min) * d.stride;
+    }
+    crop.host = buf->host + offset * buf->type.bytes();
+
+    *copied = true;
+    int result = halide_error_code_success;
+    if (!empty) {
+        result = halide_device_crop(user_context, buf, &crop);
+        if (result == halide_error_code_success) {
+            if (to_host) {
+                result = halide_copy_to_host(user_context, &crop);
+            } else {
+                result = halide_copy_to_device(user_context, &crop, device_interface);
+            }
+            int release_result = halide_device_release_crop(user_context, &crop);
+            if (result == halide_error_code_success) {
+                result = release_result;
+            }
+        }
+    }
+    free(shape);
+    return result;
+}
+
 }  // namespace
 
 extern "C" {
@@ -185,8 +260,16 @@ WEAK int copy_to_device_already_locked(void *user_context,
             return halide_error_code_copy_to_device_failed;
         } else {
             debug(user_context) << "halide_copy_to_device " << buf << " calling copy_to_device()\n";
-            result = device_interface->impl->copy_to_device(user_context, buf);
+            uint64_t t_before = device_profiler_hook ? halide_current_time_ns(user_context) : 0;
+            {
+                ScopedTimelineSpan span(TimelineCopyToDevice, nullptr, buf->size_in_bytes());
+                result = device_interface->impl->copy_to_device(user_context, buf);
+            }
             if (result == 0) {
+                if (device_profiler_hook) {
+                    device_profiler_event(user_context, DeviceProfilerCopyToDevice, buf->device, buf->size_in_bytes(),
+                                          halide_current_time_ns(user_context) - t_before);
+                }
                 buf->set_host_dirty(false);
             } else {
                 debug(user_context) << "halide_copy_to_device "
@@ -208,6 +291,49 @@ WEAK int halide_copy_to_device(void *user_context,
     return copy_to_device_already_locked(user_context, buf, device_interface);
 }
 
+WEAK int halide_copy_region_to_host(void *user_context, struct halide_buffer_t *buf,
+                                    const int *min, const int *extent) {
+    auto result = debug_log_and_validate_buf(user_context, buf, "halide_copy_region_to_host");
+    if (result) {
+        return result;
+    }
+
+    if (buf->device_dirty() && buf->host != nullptr && buf->device_interface != nullptr) {
+        bool copied = false;
+        result = copy_region(user_context, buf, nullptr, min, extent, true, &copied);
+        if (result || copied) {
+            return result;
+        }
+    }
+    return halide_copy_to_host(user_context, buf);
+}
+
+WEAK int halide_copy_region_to_device(void *user_context, struct halide_buffer_t *buf,
+                                      const halide_device_interface_t *device_interface,
+                                      const int *min, const int *extent) {
+    auto result = debug_log_and_validate_buf(user_context, buf, "halide_copy_region_to_device");
+    if (result) {
+        return result;
+    }
+
+    if (buf->host_dirty() && !buf->device_dirty() && buf->host != nullptr &&
+        device_interface != nullptr &&
+        (buf->device == 0 || buf->device_interface == device_interface)) {
+        if (buf->device == 0) {
+            result = halide_device_malloc(user_context, buf, device_interface);
+            if (result) {
+                return result;
+            }
+        }
+        bool copied = false;
+        result = copy_region(user_context, buf, device_interface, min, extent, false, &copied);
+        if (result || copied) {
+            return result;
+        }
+    }
+    return halide_copy_to_device(user_context, buf, device_interface);
+}
+
 /** Wait for current GPU operations to complete. Calling this explicitly
  * should rarely be necessary, except maybe for profiling. */
 WEAK int halide_device_sync(void *user_context, struct halide_buffer_t *buf) {
@@ -245,9 +371,13 @@ WEAK int halide_device_malloc(void *user_context, struct halide_buffer_t *buf,
         return halide_error_code_incompatible_device_interface;
     }
 
+    bool had_device = buf->device != 0;
     if (auto result = call_device_interface(device_interface, device_interface->impl->device_malloc, user_context, buf); result != halide_error_code_success) {
         return halide_error_code_device_malloc_failed;
     }
+    if (!had_device) {
+        device_profiler_event(user_context, DeviceProfilerMalloc, buf->device, buf->size_in_bytes());
+    }
     return halide_error_code_success;
 }
 
@@ -260,10 +390,12 @@ WEAK int halide_device_free(void *user_context, struct halide_buffer_t *buf) {
 
     const halide_device_interface_t *device_interface = buf->device_interface;
     if (device_interface != nullptr) {
+        uint64_t device = buf->device;
         if (auto result = call_device_interface(device_interface, device_interface->impl->device_free, user_context, buf); result != halide_error_code_success) {
             return halide_error_code_device_free_failed;
         }
         halide_debug_assert(user_context, buf->device == 0);
+        device_profiler_event(user_context, DeviceProfilerFree, device, 0);
     }
     buf->set_device_dirty(false);
     return halide_error_code_success;
@@ -337,6 +469,9 @@ WEAK int halide_default_device_and_host_malloc(void *user_context, struct halide
     if (buf->host == nullptr) {
         return halide_error_code_host_is_null;
     }
+    // Device APIs that can make page-locked host allocations don't
+    // come through here when they do.
+    buf->set_pinned_host(false);
     result = halide_device_malloc(user_context, buf, device_interface);
     if (result) {
         halide_free(user_context, buf->host);
@@ -604,6 +739,7 @@ WEAK int halide_buffer_copy(void *user_context, struct halide_buffer_t *src,
     UseModule use_src(src->device_interface);
     UseModule use_dst(dst_device_interface);
 
+    ScopedTimelineSpan span(TimelineBufferCopy, nullptr, dst->size_in_bytes());
     return halide_buffer_copy_already_locked(user_context, src, dst_device_interface, dst);
 }
 
@@ -52,4 +52,44 @@ extern WEAK int halide_default_device_wrap_native(void *user_context, struct hal
 extern WEAK int halide_default_device_detach_native(void *user_context, struct halide_buffer_t *buf);
 }
 
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// Device memory events reported to the profiler. The hook is installed
+// by halide_profiler_pipeline_start, and is null unless a pipeline
+// compiled with the profiler has run.
+enum DeviceProfilerEvent {
+    DeviceProfilerMalloc,
+    DeviceProfilerFree,
+    DeviceProfilerPoolHit,
+    DeviceProfilerCopyToDevice,
+    DeviceProfilerCopyToHost,
+    DeviceProfilerKernel,
+};
+
+typedef void (*device_profiler_hook_t)(void *user_context, DeviceProfilerEvent event,
+                                       uint64_t device, uint64_t bytes, uint64_t ns);
+extern WEAK device_profiler_hook_t device_profiler_hook;
+
+// Whether device kernels should be timed on the device and reported as
+// DeviceProfilerKernel events. Timing a kernel means waiting for it to
+// finish, so it's off unless HL_PROFILER_TIME_KERNELS is set.
+extern WEAK bool device_profiler_time_kernels;
+
+ALWAYS_INLINE bool should_time_device_kernels() {
+    return device_profiler_hook && device_profiler_time_kernels;
+}
+
+ALWAYS_INLINE void device_profiler_event(void *user_context, DeviceProfilerEvent event,
+                                         uint64_t device, uint64_t bytes, uint64_t ns = 0) {
+    if (device_profiler_hook) {
+        device_profiler_hook(user_context, event, device, bytes, ns);
+    }
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
 #endif  // HALIDE_RUNTIME_DEVICE_INTERFACE_H
@@ -0,0 +1,19 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+// Waiting on an address is not available on this platform, so threads
+// park on a mutex and condition variable instead.
+
+extern "C" {
+
+WEAK bool halide_futex_supported() {
+    return false;
+}
+
+WEAK void halide_futex_wait(int *addr, int val) {
+}
+
+WEAK void halide_futex_wake(int *addr, int count) {
+}
+
+}  // extern "C"
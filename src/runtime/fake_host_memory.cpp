@@ -0,0 +1,16 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+// Mapping pages with a placement policy is not supported on this
+// platform, so halide_default_malloc always uses the heap.
+
+extern "C" {
+
+WEAK void *halide_internal_map_host_pages(size_t *size, int policy) {
+    return nullptr;
+}
+
+WEAK void halide_internal_unmap_host_pages(void *region, size_t size) {
+}
+
+}  // extern "C"
@@ -0,0 +1,25 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+// Thread placement and priorities are not supported on this platform,
+// so threads stay wherever the OS schedules them.
+
+extern "C" {
+
+WEAK int halide_host_numa_node_count() {
+    return 1;
+}
+
+WEAK bool halide_pin_thread_to_cpu(int cpu) {
+    return false;
+}
+
+WEAK bool halide_pin_thread_to_numa_node(int node) {
+    return false;
+}
+
+WEAK bool halide_set_thread_low_priority() {
+    return false;
+}
+
+}  // extern "C"
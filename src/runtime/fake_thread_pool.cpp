@@ -31,6 +31,11 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     return halide_error_code_success;
 }
 
+WEAK int halide_work_stealing_do_par_for(void *user_context, halide_task_t f,
+                                         int min, int size, uint8_t *closure) {
+    return halide_default_do_par_for(user_context, f, min, size, closure);
+}
+
 WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
                                           struct halide_parallel_task_t *tasks,
                                           void *task_parent) {
@@ -84,6 +89,11 @@ WEAK void halide_join_thread(halide_thread *thread_arg) {
     halide_error(nullptr, "halide_join_thread not implemented on this platform.");
 }
 
+WEAK uint64_t halide_current_thread_id() {
+    // There is only one thread.
+    return 0;
+}
+
 // Don't need to do anything with mutexes since we are in a fake thread pool.
 WEAK void halide_mutex_lock(halide_mutex *mutex) {
 }
@@ -122,6 +132,46 @@ WEAK int halide_set_num_threads(int n) {
     return 1;
 }
 
+WEAK halide_parallel_chunking_policy_t halide_set_parallel_chunking_policy(halide_parallel_chunking_policy_t policy) {
+    // Everything runs serially on this platform, so there is nothing to chunk.
+    return halide_parallel_chunking_guided;
+}
+
+WEAK halide_thread_affinity_t halide_set_thread_affinity(halide_thread_affinity_t affinity) {
+    // There are no worker threads to place on this platform.
+    return halide_thread_affinity_none;
+}
+
+struct halide_thread_pool_t {
+    int unused;
+};
+
+WEAK halide_thread_pool_t halide_fake_thread_pool;
+
+WEAK halide_thread_pool_t *halide_thread_pool_create(int num_threads, halide_thread_pool_priority_t priority) {
+    // There is only ever the calling thread, so all pools are the same.
+    return &halide_fake_thread_pool;
+}
+
+WEAK void halide_thread_pool_destroy(halide_thread_pool_t *pool) {
+}
+
+WEAK int halide_thread_pool_bind(void *user_context, halide_thread_pool_t *pool) {
+    return halide_error_code_success;
+}
+
+WEAK int halide_thread_pool_enable_stats(halide_thread_pool_t *pool, bool enable) {
+    return halide_error_code_success;
+}
+
+WEAK int halide_thread_pool_get_stats(halide_thread_pool_t *pool,
+                                      halide_thread_pool_stats_t *stats,
+                                      halide_thread_pool_thread_stats_t *workers,
+                                      int max_workers) {
+    memset(stats, 0, sizeof(*stats));
+    return halide_error_code_success;
+}
+
 WEAK halide_do_task_t halide_set_custom_do_task(halide_do_task_t f) {
     halide_do_task_t result = custom_do_task;
     custom_do_task = f;
@@ -167,4 +217,31 @@ WEAK bool halide_semaphore_try_acquire(struct halide_semaphore_t *sema, int coun
     return custom_semaphore_try_acquire(sema, count);
 }
 
+struct halide_async_call_t {
+    int result;
+};
+
+WEAK int halide_call_async(void *user_context, int (*fn)(void **), void **args,
+                           halide_async_call_t **call) {
+    // There are no other threads to run the call on, so run it now.
+    halide_async_call_t *c = (halide_async_call_t *)malloc(sizeof(halide_async_call_t));
+    if (!c) {
+        *call = nullptr;
+        return halide_error_code_out_of_memory;
+    }
+    c->result = fn(args);
+    *call = c;
+    return halide_error_code_success;
+}
+
+WEAK bool halide_async_call_done(halide_async_call_t *call) {
+    return true;
+}
+
+WEAK int halide_async_call_wait(halide_async_call_t *call) {
+    int result = call->result;
+    free(call);
+    return result;
+}
+
 }  // extern "C"
@@ -0,0 +1,186 @@
+#ifndef HALIDE_RUNTIME_GPU_BINARY_CACHE_H_
+#define HALIDE_RUNTIME_GPU_BINARY_CACHE_H_
+
+#include "HalideRuntime.h"
+#include "printer.h"
+
+// A persistent, disk-backed cache of compiled GPU kernels, shared by
+// the GPU backends that can export and reimport driver binaries. Each
+// entry is a single file named after a 128-bit key, which the backend
+// computes from the kernel source and everything that could change
+// the driver's output for it (device, driver version, build options).
+// Files are written to a temporary name and renamed into place, so
+// concurrent processes sharing a directory never see partial entries.
+// The cache is disabled unless halide_gpu_kernel_cache_dir returns a
+// directory.
+
+extern "C" {
+
+extern size_t fread(void *ptr, size_t size, size_t n, void *file);
+extern int rename(const char *oldpath, const char *newpath);
+
+WEAK const char *halide_gpu_kernel_cache_dir(void *user_context) {
+    return getenv("HL_GPU_KERNEL_CACHE_DIR");
+}
+
+}  // extern "C"
+
+namespace Halide {
+namespace Internal {
+
+class GPUBinaryCacheKey {
+    uint64_t h0{0xcbf29ce484222325ULL};
+    uint64_t h1{0x84222325cbf29ce4ULL};
+
+    static ALWAYS_INLINE uint64_t mix(uint64_t h, uint64_t w, uint64_t m) {
+        h ^= w;
+        h *= m;
+        return h ^ (h >> 29);
+    }
+
+public:
+    void add(const void *data, size_t size) {
+        const uint8_t *p = (const uint8_t *)data;
+        while (size >= 8) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            h0 = mix(h0, w, 0x100000001b3ULL);
+            h1 = mix(h1, w, 0xff51afd7ed558ccdULL);
+            p += 8;
+            size -= 8;
+        }
+        uint64_t w = size;
+        for (size_t i = 0; i < size; i++) {
+            w = (w << 8) | p[i];
+        }
+        h0 = mix(h0, w, 0x100000001b3ULL);
+        h1 = mix(h1, w, 0xff51afd7ed558ccdULL);
+    }
+
+    void add(const char *str) {
+        add(str, str ? strlen(str) : 0);
+    }
+
+    template<typename T>
+    void add_value(const T &value) {
+        add(&value, sizeof(value));
+    }
+
+    uint64_t low() const {
+        return h0;
+    }
+
+    uint64_t high() const {
+        return h1;
+    }
+};
+
+struct GPUBinaryCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key[2];
+    uint64_t size;
+    uint64_t checksum;
+};
+
+constexpr uint32_t kGPUBinaryCacheMagic = 0x4347484c;  // "LHGC"
+constexpr uint32_t kGPUBinaryCacheVersion = 1;
+
+ALWAYS_INLINE uint64_t gpu_binary_cache_checksum(const void *data, size_t size) {
+    GPUBinaryCacheKey k;
+    k.add(data, size);
+    return k.low();
+}
+
+template<typename PrinterT>
+ALWAYS_INLINE void gpu_binary_cache_path(PrinterT &path, const char *dir,
+                                         const char *backend, const GPUBinaryCacheKey &key) {
+    path << dir << "/halide_" << backend << "_" << key.high() << "_" << key.low() << ".bin";
+}
+
+// Returns the binary stored under key, in a buffer allocated with
+// malloc that the caller must free, or nullptr if there is no valid
+// entry for it.
+WEAK void *gpu_binary_cache_load(void *user_context, const char *backend,
+                                 const GPUBinaryCacheKey &key, size_t *size) {
+    const char *dir = halide_gpu_kernel_cache_dir(user_context);
+    if (!dir || !*dir) {
+        return nullptr;
+    }
+    StringStreamPrinter<1024> path(user_context);
+    gpu_binary_cache_path(path, dir, backend, key);
+
+    void *f = halide_fopen(path.str(), "rb");
+    if (!f) {
+        debug(user_context) << "    GPU kernel cache miss: " << path.str() << "\n";
+        return nullptr;
+    }
+    void *data = nullptr;
+    GPUBinaryCacheHeader header;
+    if (fread(&header, sizeof(header), 1, f) == 1 &&
+        header.magic == kGPUBinaryCacheMagic &&
+        header.version == kGPUBinaryCacheVersion &&
+        header.key[0] == key.low() &&
+        header.key[1] == key.high() &&
+        header.size > 0) {
+        data = malloc(header.size);
+        if (data &&
+            (fread(data, header.size, 1, f) != 1 ||
+             gpu_binary_cache_checksum(data, header.size) != header.checksum)) {
+            free(data);
+            data = nullptr;
+        }
+    }
+    fclose(f);
+    if (data) {
+        debug(user_context) << "    GPU kernel cache hit: " << path.str() << "\n";
+        *size = header.size;
+    } else {
+        debug(user_context) << "    GPU kernel cache entry is invalid: " << path.str() << "\n";
+    }
+    return data;
+}
+
+// Stores a binary under key. Failures are not errors; the kernel will
+// just be compiled again next time.
+WEAK void gpu_binary_cache_store(void *user_context, const char *backend,
+                                 const GPUBinaryCacheKey &key, const void *data, size_t size) {
+    const char *dir = halide_gpu_kernel_cache_dir(user_context);
+    if (!dir || !*dir || !data || size == 0) {
+        return;
+    }
+    StringStreamPrinter<1024> path(user_context), tmp_path(user_context);
+    gpu_binary_cache_path(path, dir, backend, key);
+    // Make the temporary name unique to this process and call.
+    int local = 0;
+    tmp_path << path.str() << ".tmp"
+             << (uint64_t)halide_current_time_ns(user_context) << "_" << (uint64_t)(uintptr_t)&local;
+
+    void *f = halide_fopen(tmp_path.str(), "wb");
+    if (!f) {
+        debug(user_context) << "    GPU kernel cache: could not write " << tmp_path.str() << "\n";
+        return;
+    }
+    GPUBinaryCacheHeader header;
+    header.magic = kGPUBinaryCacheMagic;
+    header.version = kGPUBinaryCacheVersion;
+    header.key[0] = key.low();
+    header.key[1] = key.high();
+    header.size = size;
+    header.checksum = gpu_binary_cache_checksum(data, size);
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(data, size, 1, f) == 1;
+    ok = (fclose(f) == 0) && ok;
+    if (ok && rename(tmp_path.str(), path.str()) == 0) {
+        debug(user_context) << "    GPU kernel cache: stored " << path.str() << "\n";
+    } else {
+        // Possibly another process won the race to store the same
+        // entry, which is fine.
+        remove(tmp_path.str());
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif  // HALIDE_RUNTIME_GPU_BINARY_CACHE_H_
@@ -0,0 +1,359 @@
+#ifndef HALIDE_RUNTIME_GPU_MEMORY_ALLOCATOR_H_
+#define HALIDE_RUNTIME_GPU_MEMORY_ALLOCATOR_H_
+
+#include "HalideRuntime.h"
+#include "internal/block_allocator.h"
+#include "printer.h"
+#include "scoped_mutex_lock.h"
+
+// A device memory suballocator for the GPU backends whose driver APIs
+// only offer one allocation per buffer. Buffers are carved out of
+// large blocks by a BlockAllocator, so pipelines whose buffer sizes
+// vary from run to run reuse the same device memory instead of
+// accumulating exact-size allocations. Requests are first rounded up
+// to a size class, which keeps freed regions interchangeable between
+// buffers of similar size.
+//
+// Each backend owns a GPUMemoryPool, which knows how to make and free
+// blocks, and holds one BlockAllocator per device context and
+// stream. Memory freed on one stream is only handed out again on the
+// same stream, as there are no ordering guarantees between streams.
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+struct GPUMemoryBlockFns {
+    // Makes a device allocation of size bytes in device_context. The
+    // handle can be anything the backend can later offset into, eg a
+    // device pointer or a cl_mem.
+    int (*allocate)(void *user_context, void *device_context, size_t size, void **handle);
+    int (*deallocate)(void *user_context, void *device_context, void *handle);
+};
+
+// Runtime configuration parameters to adjust the behaviour of the suballocator
+struct GPUMemoryConfig {
+    size_t minimum_block_size = 32 * 1024 * 1024;  //< Default block size is 32MB
+    size_t maximum_pool_size = 0;                  //< Maximum number of bytes to allocate in blocks per device context and stream. Zero means no constraint
+};
+WEAK GPUMemoryConfig gpu_memory_config;
+
+struct GPUMemoryAllocator {
+    void *device_context;
+    void *stream;
+    size_t alignment;
+    BlockAllocator *blocks;
+    GPUMemoryAllocator *next;
+};
+
+// A live suballocation: size bytes at offset into the block named by
+// block_handle.
+struct GPUMemoryAllocation {
+    void *block_handle;
+    size_t offset;
+    // block_handle + offset, which identifies the allocation within
+    // its pool.
+    uintptr_t address;
+    size_t size;
+    size_t reserved;
+    MemoryRegion *region;
+    GPUMemoryAllocator *allocator;
+    GPUMemoryAllocation *next;
+    // True if the region came from an existing block, rather than one
+    // newly allocated for it.
+    bool reused_block;
+};
+
+// Live suballocations are kept in a hash table keyed by their
+// address, so that a buffer can be found again cheaply when it is
+// freed.
+constexpr int gpu_memory_allocation_bucket_bits = 8;
+constexpr int gpu_memory_allocation_buckets = 1 << gpu_memory_allocation_bucket_bits;
+
+struct GPUMemoryPool {
+    GPUMemoryBlockFns fns;
+    GPUMemoryAllocator *allocators;
+    GPUMemoryAllocation *allocations[gpu_memory_allocation_buckets];
+    halide_device_memory_stats_t stats;
+};
+
+// Guards every pool. BlockAllocator callbacks only get a
+// user_context, so the pool and device context they should use are
+// stashed here for the duration of each call into a BlockAllocator.
+WEAK halide_mutex gpu_memory_lock;
+WEAK GPUMemoryPool *gpu_memory_active_pool = nullptr;
+WEAK void *gpu_memory_active_context = nullptr;
+
+ALWAYS_INLINE GPUMemoryAllocation **gpu_memory_bucket(GPUMemoryPool *pool, uintptr_t address) {
+    // Suballocations are aligned, so the low bits of the address carry
+    // no information. Take the top bits of a multiplicative hash
+    // instead.
+    uint64_t h = (uint64_t)address * 0x9E3779B97F4A7C15ULL;
+    return &pool->allocations[h >> (64 - gpu_memory_allocation_bucket_bits)];
+}
+
+// Rounds a request up to its size class: the alignment, or the
+// request rounded up to its top 4 significant bits, whichever is
+// larger. At most 1/8th of a request is lost to rounding.
+ALWAYS_INLINE size_t gpu_memory_size_class(size_t size, size_t alignment) {
+    uint64_t sz = size;
+    int z = __builtin_clzll(sz);
+    if (z < 60) {
+        sz--;
+        sz = sz >> (60 - z);
+        sz++;
+        sz = sz << (60 - z);
+    }
+    return aligned_offset((size_t)sz, alignment);
+}
+
+WEAK int gpu_memory_allocate_block(void *user_context, MemoryBlock *block) {
+    GPUMemoryPool *pool = gpu_memory_active_pool;
+    halide_abort_if_false(user_context, pool != nullptr);
+    int result = pool->fns.allocate(user_context, gpu_memory_active_context, block->size, &block->handle);
+    if (result != halide_error_code_success) {
+        block->handle = nullptr;
+        return result;
+    }
+    pool->stats.blocks++;
+    pool->stats.bytes_allocated += block->size;
+    pool->stats.block_allocations++;
+    if (pool->stats.bytes_allocated > pool->stats.peak_bytes_allocated) {
+        pool->stats.peak_bytes_allocated = pool->stats.bytes_allocated;
+    }
+    return halide_error_code_success;
+}
+
+WEAK int gpu_memory_deallocate_block(void *user_context, MemoryBlock *block) {
+    GPUMemoryPool *pool = gpu_memory_active_pool;
+    halide_abort_if_false(user_context, pool != nullptr);
+    pool->stats.blocks--;
+    pool->stats.bytes_allocated -= block->size;
+    return pool->fns.deallocate(user_context, gpu_memory_active_context, block->handle);
+}
+
+// Regions are addressed by their offset into the block, so they just
+// share its handle.
+WEAK int gpu_memory_allocate_region(void *user_context, MemoryRegion *region) {
+    region->handle = reinterpret_cast<BlockRegion *>(region)->block_ptr->memory.handle;
+    return halide_error_code_success;
+}
+
+WEAK int gpu_memory_deallocate_region(void *user_context, MemoryRegion *region) {
+    return halide_error_code_success;
+}
+
+// Must be called with gpu_memory_lock held.
+WEAK GPUMemoryAllocator *gpu_memory_find_allocator(void *user_context, GPUMemoryPool *pool,
+                                                   void *device_context, void *stream, size_t alignment) {
+    for (GPUMemoryAllocator *a = pool->allocators; a != nullptr; a = a->next) {
+        if (a->device_context == device_context && a->stream == stream) {
+            return a;
+        }
+    }
+
+    GPUMemoryAllocator *a = (GPUMemoryAllocator *)malloc(sizeof(GPUMemoryAllocator));
+    if (a == nullptr) {
+        return nullptr;
+    }
+    BlockAllocator::Config config = {0};
+    config.minimum_block_size = gpu_memory_config.minimum_block_size;
+    config.maximum_pool_size = gpu_memory_config.maximum_pool_size;
+    BlockAllocator::MemoryAllocators allocators;
+    allocators.system = {halide_malloc, halide_free};
+    allocators.block = {gpu_memory_allocate_block, gpu_memory_deallocate_block};
+    allocators.region = {gpu_memory_allocate_region, gpu_memory_deallocate_region};
+    a->blocks = BlockAllocator::create(user_context, config, allocators);
+    if (a->blocks == nullptr) {
+        free(a);
+        return nullptr;
+    }
+    a->device_context = device_context;
+    a->stream = stream;
+    a->alignment = alignment;
+    a->next = pool->allocators;
+    pool->allocators = a;
+    return a;
+}
+
+// Must be called with gpu_memory_lock held. Frees all blocks in the
+// pool that have nothing reserved in them, and returns true if any
+// were freed.
+WEAK bool gpu_memory_collect_locked(void *user_context, GPUMemoryPool *pool) {
+    bool collected = false;
+    gpu_memory_active_pool = pool;
+    for (GPUMemoryAllocator *a = pool->allocators; a != nullptr; a = a->next) {
+        gpu_memory_active_context = a->device_context;
+        collected = a->blocks->collect(user_context) || collected;
+    }
+    gpu_memory_active_pool = nullptr;
+    gpu_memory_active_context = nullptr;
+    return collected;
+}
+
+// Suballocates size bytes for use in device_context on stream. The
+// offset of the result within its block is a multiple of alignment,
+// which must be a power of two. Returns nullptr on failure.
+WEAK GPUMemoryAllocation *gpu_memory_reserve(void *user_context, GPUMemoryPool *pool,
+                                             void *device_context, void *stream,
+                                             size_t alignment, size_t size) {
+    GPUMemoryAllocation *allocation = (GPUMemoryAllocation *)malloc(sizeof(GPUMemoryAllocation));
+    if (allocation == nullptr) {
+        return nullptr;
+    }
+
+    ScopedMutexLock lock(&gpu_memory_lock);
+    GPUMemoryAllocator *allocator = gpu_memory_find_allocator(user_context, pool, device_context, stream, alignment);
+    if (allocator == nullptr) {
+        free(allocation);
+        return nullptr;
+    }
+
+    MemoryRequest request = {0};
+    request.size = gpu_memory_size_class(size, allocator->alignment);
+    request.alignment = allocator->alignment;
+    request.properties.visibility = MemoryVisibility::DefaultVisibility;
+    request.properties.caching = MemoryCaching::DefaultCaching;
+    request.properties.usage = MemoryUsage::DefaultUsage;
+    request.properties.alignment = allocator->alignment;
+
+    uint64_t block_allocations = pool->stats.block_allocations;
+    gpu_memory_active_pool = pool;
+    gpu_memory_active_context = device_context;
+    MemoryRegion *region = allocator->blocks->reserve(user_context, request);
+    if (region == nullptr) {
+        // Blocks left empty by earlier frees may be what's holding the
+        // memory we need.
+        if (gpu_memory_collect_locked(user_context, pool)) {
+            gpu_memory_active_pool = pool;
+            gpu_memory_active_context = device_context;
+            region = allocator->blocks->reserve(user_context, request);
+        }
+    }
+    gpu_memory_active_pool = nullptr;
+    gpu_memory_active_context = nullptr;
+
+    if (region == nullptr || region->handle == nullptr) {
+        free(allocation);
+        return nullptr;
+    }
+
+    allocation->block_handle = region->handle;
+    allocation->offset = region->offset;
+    allocation->address = (uintptr_t)region->handle + region->offset;
+    allocation->size = size;
+    allocation->reserved = region->size;
+    allocation->region = region;
+    allocation->allocator = allocator;
+    allocation->reused_block = pool->stats.block_allocations == block_allocations;
+    GPUMemoryAllocation **bucket = gpu_memory_bucket(pool, allocation->address);
+    allocation->next = *bucket;
+    *bucket = allocation;
+
+    pool->stats.regions++;
+    pool->stats.bytes_reserved += allocation->reserved;
+    pool->stats.bytes_requested += allocation->size;
+    return allocation;
+}
+
+// Returns the live suballocation at address (its block handle plus
+// its offset), or nullptr if there is none.
+WEAK GPUMemoryAllocation *gpu_memory_find(GPUMemoryPool *pool, uintptr_t address) {
+    ScopedMutexLock lock(&gpu_memory_lock);
+    for (GPUMemoryAllocation *a = *gpu_memory_bucket(pool, address); a != nullptr; a = a->next) {
+        if (a->address == address) {
+            return a;
+        }
+    }
+    return nullptr;
+}
+
+// Gives a suballocation back to its block. If reuse is true the
+// region is kept as it is for a later request of the same size class,
+// otherwise it is merged with its free neighbours and any block left
+// empty is freed.
+WEAK int gpu_memory_release(void *user_context, GPUMemoryPool *pool,
+                            GPUMemoryAllocation *allocation, bool reuse) {
+    ScopedMutexLock lock(&gpu_memory_lock);
+    GPUMemoryAllocation **prev_ptr = gpu_memory_bucket(pool, allocation->address);
+    while (*prev_ptr != nullptr && *prev_ptr != allocation) {
+        prev_ptr = &(*prev_ptr)->next;
+    }
+    if (*prev_ptr == nullptr) {
+        error(user_context) << "GPU memory pool: releasing an unknown allocation\n";
+        return halide_error_code_internal_error;
+    }
+    *prev_ptr = allocation->next;
+
+    pool->stats.regions--;
+    pool->stats.bytes_reserved -= allocation->reserved;
+    pool->stats.bytes_requested -= allocation->size;
+
+    GPUMemoryAllocator *allocator = allocation->allocator;
+    gpu_memory_active_pool = pool;
+    gpu_memory_active_context = allocator->device_context;
+    int result = allocator->blocks->release(user_context, allocation->region);
+    if (result == 0 && !reuse) {
+        allocator->blocks->collect(user_context);
+    }
+    gpu_memory_active_pool = nullptr;
+    gpu_memory_active_context = nullptr;
+    free(allocation);
+    return result;
+}
+
+// Frees all blocks with nothing reserved in them.
+WEAK int gpu_memory_release_unused(void *user_context, GPUMemoryPool *pool) {
+    ScopedMutexLock lock(&gpu_memory_lock);
+    gpu_memory_collect_locked(user_context, pool);
+    return halide_error_code_success;
+}
+
+// Frees every block made for device_context, whether or not anything
+// is still using it. Used when the context itself is going away.
+WEAK int gpu_memory_release_context(void *user_context, GPUMemoryPool *pool, void *device_context) {
+    ScopedMutexLock lock(&gpu_memory_lock);
+    for (int i = 0; i < gpu_memory_allocation_buckets; i++) {
+        GPUMemoryAllocation **allocation_ptr = &pool->allocations[i];
+        while (*allocation_ptr != nullptr) {
+            GPUMemoryAllocation *a = *allocation_ptr;
+            if (a->allocator->device_context == device_context) {
+                *allocation_ptr = a->next;
+                pool->stats.regions--;
+                pool->stats.bytes_reserved -= a->reserved;
+                pool->stats.bytes_requested -= a->size;
+                free(a);
+            } else {
+                allocation_ptr = &a->next;
+            }
+        }
+    }
+
+    gpu_memory_active_pool = pool;
+    gpu_memory_active_context = device_context;
+    GPUMemoryAllocator **allocator_ptr = &pool->allocators;
+    while (*allocator_ptr != nullptr) {
+        GPUMemoryAllocator *a = *allocator_ptr;
+        if (a->device_context == device_context) {
+            *allocator_ptr = a->next;
+            BlockAllocator::destroy(user_context, a->blocks);
+            free(a);
+        } else {
+            allocator_ptr = &a->next;
+        }
+    }
+    gpu_memory_active_pool = nullptr;
+    gpu_memory_active_context = nullptr;
+    return halide_error_code_success;
+}
+
+WEAK void gpu_memory_get_stats(GPUMemoryPool *pool, halide_device_memory_stats_t *stats) {
+    ScopedMutexLock lock(&gpu_memory_lock);
+    *stats = pool->stats;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+#endif  // HALIDE_RUNTIME_GPU_MEMORY_ALLOCATOR_H_
@@ -4,6 +4,7 @@
 #include "printer.h"
 #include "runtime_internal.h"
 #include "scoped_mutex_lock.h"
+#include "timeline.h"
 
 namespace Halide {
 namespace Runtime {
@@ -219,6 +220,20 @@ struct module_state {
 WEAK module_state *state_list = nullptr;
 WEAK halide_hexagon_handle_t shared_runtime = 0;
 
+// ION allocations are mapped and registered with FastRPC when they
+// are allocated, which is far more expensive than running a small
+// pipeline. When halide_can_reuse_device_allocations is true, freed
+// ION allocations are kept (still mapped and registered) on this list
+// and handed back out to allocations of the same size, so buffers
+// that are recreated every frame don't pay for this on every call.
+struct ion_free_list_item {
+    void *ion;
+    size_t size;
+    ion_free_list_item *next;
+};
+WEAK ion_free_list_item *ion_free_list = nullptr;
+WEAK halide_mutex ion_free_list_lock = {{0}};
+
 #ifdef DEBUG_RUNTIME
 
 // In debug builds, we write shared objects to the current directory (without
@@ -402,6 +417,8 @@ WEAK int halide_hexagon_run(void *user_context,
                             uint64_t arg_sizes[],
                             void *args[],
                             int arg_flags[]) {
+    ScopedTimelineSpan span(TimelineKernel, name);
+
     halide_abort_if_false(user_context, state_ptr != nullptr);
     halide_abort_if_false(user_context, function != nullptr);
     auto result = init_hexagon_runtime(user_context);
@@ -525,6 +542,8 @@ WEAK int halide_hexagon_device_release(void *user_context) {
     }
     state_list = nullptr;
 
+    (void)halide_hexagon_release_unused_device_allocations(user_context);
+
     if (shared_runtime) {
         debug(user_context) << "    releasing shared runtime\n";
         debug(user_context) << "    halide_remote_release_library " << shared_runtime << " -> ";
@@ -546,6 +565,79 @@ WEAK int halide_hexagon_device_release(void *user_context) {
 // arguments than simply mapping the pages.
 static const int min_ion_allocation_size = 4096;
 
+WEAK int halide_hexagon_release_unused_device_allocations(void *user_context) {
+    ion_free_list_item *to_free;
+    {
+        ScopedMutexLock lock(&ion_free_list_lock);
+        to_free = ion_free_list;
+        ion_free_list = nullptr;
+    }
+    while (to_free) {
+        debug(user_context) << "    host_free ion=" << to_free->ion << "\n";
+        host_free(to_free->ion);
+        ion_free_list_item *next = to_free->next;
+        free(to_free);
+        to_free = next;
+    }
+    return halide_error_code_success;
+}
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace Hexagon {
+
+WEAK halide_device_allocation_pool hexagon_allocation_pool;
+
+WEAK __attribute__((constructor)) void register_hexagon_allocation_pool() {
+    hexagon_allocation_pool.release_unused = &halide_hexagon_release_unused_device_allocations;
+    halide_register_device_allocation_pool(&hexagon_allocation_pool);
+}
+
+// Round ION allocations up to a whole number of pages, so buffers
+// that differ slightly in size can still share cached allocations.
+ALWAYS_INLINE size_t quantize_ion_allocation_size(size_t size) {
+    return (size + min_ion_allocation_size - 1) & ~(size_t)(min_ion_allocation_size - 1);
+}
+
+WEAK void *ion_free_list_get(void *user_context, size_t size) {
+    if (!halide_can_reuse_device_allocations(user_context)) {
+        return nullptr;
+    }
+    ScopedMutexLock lock(&ion_free_list_lock);
+    for (ion_free_list_item **prev_ptr = &ion_free_list; *prev_ptr; prev_ptr = &(*prev_ptr)->next) {
+        ion_free_list_item *item = *prev_ptr;
+        if (item->size == size) {
+            *prev_ptr = item->next;
+            void *ion = item->ion;
+            free(item);
+            return ion;
+        }
+    }
+    return nullptr;
+}
+
+WEAK bool ion_free_list_put(void *user_context, void *ion, size_t size) {
+    if (!halide_can_reuse_device_allocations(user_context)) {
+        return false;
+    }
+    ion_free_list_item *item = (ion_free_list_item *)malloc(sizeof(ion_free_list_item));
+    if (!item) {
+        return false;
+    }
+    item->ion = ion;
+    item->size = size;
+    ScopedMutexLock lock(&ion_free_list_lock);
+    item->next = ion_free_list;
+    ion_free_list = item;
+    return true;
+}
+
+}  // namespace Hexagon
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
 WEAK int halide_hexagon_device_malloc(void *user_context, halide_buffer_t *buf) {
     auto result = init_hexagon_runtime(user_context);
     if (result) {
@@ -568,6 +660,9 @@ WEAK int halide_hexagon_device_malloc(void *user_context, halide_buffer_t *buf)
     // that requires up to an extra vector beyond the end of the
     // buffer to be legal to access.
     size += 128;
+    if (size >= min_ion_allocation_size) {
+        size = quantize_ion_allocation_size(size);
+    }
 
     for (int i = 0; i < buf->dimensions; i++) {
         halide_abort_if_false(user_context, buf->dim[i].stride >= 0);
@@ -581,9 +676,19 @@ WEAK int halide_hexagon_device_malloc(void *user_context, halide_buffer_t *buf)
 
     void *ion;
     if (size >= min_ion_allocation_size) {
-        debug(user_context) << "    host_malloc len=" << (uint64_t)size << " -> ";
-        ion = host_malloc(size);
-        debug(user_context) << "        " << ion << "\n";
+        ion = ion_free_list_get(user_context, size);
+        if (ion) {
+            debug(user_context) << "    reusing cached ion=" << ion << "\n";
+        } else {
+            debug(user_context) << "    host_malloc len=" << (uint64_t)size << " -> ";
+            ion = host_malloc(size);
+            debug(user_context) << "        " << ion << "\n";
+        }
+        if (!ion) {
+            // Release the cached allocations and try again.
+            (void)halide_hexagon_release_unused_device_allocations(user_context);
+            ion = host_malloc(size);
+        }
         if (!ion) {
             error(user_context) << "host_malloc failed";
             return halide_error_code_out_of_memory;
@@ -636,8 +741,12 @@ WEAK int halide_hexagon_device_free(void *user_context, halide_buffer_t *buf) {
     void *ion = halide_hexagon_get_device_handle(user_context, buf);
     (void)halide_hexagon_detach_device_handle(user_context, buf);  // ignore errors
     if (size >= min_ion_allocation_size) {
-        debug(user_context) << "    host_free ion=" << ion << "\n";
-        host_free(ion);
+        if (ion_free_list_put(user_context, ion, size)) {
+            debug(user_context) << "    caching ion=" << ion << " for later use\n";
+        } else {
+            debug(user_context) << "    host_free ion=" << ion << "\n";
+            host_free(ion);
+        }
     } else {
         debug(user_context) << "    halide_free ion=" << ion << "\n";
         halide_free(user_context, ion);
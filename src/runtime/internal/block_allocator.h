@@ -120,7 +120,7 @@ private:
     MemoryAllocators allocators;
 };
 
-BlockAllocator *BlockAllocator::create(void *user_context, const Config &cfg, const MemoryAllocators &allocators) {
+WEAK BlockAllocator *BlockAllocator::create(void *user_context, const Config &cfg, const MemoryAllocators &allocators) {
     halide_abort_if_false(user_context, allocators.system.allocate != nullptr);
     BlockAllocator *result = reinterpret_cast<BlockAllocator *>(
         allocators.system.allocate(user_context, sizeof(BlockAllocator)));
@@ -134,7 +134,7 @@ BlockAllocator *BlockAllocator::create(void *user_context, const Config &cfg, co
     return result;
 }
 
-void BlockAllocator::destroy(void *user_context, BlockAllocator *instance) {
+WEAK void BlockAllocator::destroy(void *user_context, BlockAllocator *instance) {
     halide_abort_if_false(user_context, instance != nullptr);
     const MemoryAllocators &allocators = instance->allocators;
     instance->destroy(user_context);
@@ -142,7 +142,7 @@ void BlockAllocator::destroy(void *user_context, BlockAllocator *instance) {
     allocators.system.deallocate(user_context, instance);
 }
 
-void BlockAllocator::initialize(void *user_context, const Config &cfg, const MemoryAllocators &ma) {
+WEAK void BlockAllocator::initialize(void *user_context, const Config &cfg, const MemoryAllocators &ma) {
     config = cfg;
     allocators = ma;
     block_list.initialize(user_context,
@@ -151,7 +151,7 @@ void BlockAllocator::initialize(void *user_context, const Config &cfg, const Mem
                           allocators.system);
 }
 
-MemoryRegion *BlockAllocator::reserve(void *user_context, const MemoryRequest &request) {
+WEAK MemoryRegion *BlockAllocator::reserve(void *user_context, const MemoryRequest &request) {
 #ifdef DEBUG_RUNTIME_INTERNAL
     debug(user_context) << "BlockAllocator: Reserve ("
                         << "user_context=" << (void *)(user_context) << " "
@@ -164,7 +164,8 @@ MemoryRegion *BlockAllocator::reserve(void *user_context, const MemoryRequest &r
 #endif
     BlockEntry *block_entry = reserve_block_entry(user_context, request.properties, request.size, request.dedicated);
     if (block_entry == nullptr) {
-        error(user_context) << "BlockAllocator: Failed to allocate new empty block of requested size ("
+        // Not necessarily fatal: the caller may be able to release memory and try again
+        debug(user_context) << "BlockAllocator: Failed to allocate new empty block of requested size ("
                             << (int32_t)(request.size) << " bytes)!\n";
         return nullptr;
     }
@@ -179,7 +180,7 @@ MemoryRegion *BlockAllocator::reserve(void *user_context, const MemoryRequest &r
         // Unable to reserve region in an existing block ... create a new block and try again.
         block_entry = create_block_entry(user_context, request.properties, request.size, request.dedicated);
         if (block_entry == nullptr) {
-            error(user_context) << "BlockAllocator: Out of memory! Failed to allocate empty block of size ("
+            debug(user_context) << "BlockAllocator: Out of memory! Failed to allocate empty block of size ("
                                 << (int32_t)(request.size) << " bytes)!\n";
             return nullptr;
         }
@@ -194,7 +195,7 @@ MemoryRegion *BlockAllocator::reserve(void *user_context, const MemoryRequest &r
     return result;
 }
 
-int BlockAllocator::release(void *user_context, MemoryRegion *memory_region) {
+WEAK int BlockAllocator::release(void *user_context, MemoryRegion *memory_region) {
     if (memory_region == nullptr) {
         return halide_error_code_internal_error;
     }
@@ -205,7 +206,7 @@ int BlockAllocator::release(void *user_context, MemoryRegion *memory_region) {
     return allocator->release(user_context, memory_region);
 }
 
-int BlockAllocator::reclaim(void *user_context, MemoryRegion *memory_region) {
+WEAK int BlockAllocator::reclaim(void *user_context, MemoryRegion *memory_region) {
     if (memory_region == nullptr) {
         return halide_error_code_internal_error;
     }
@@ -216,7 +217,7 @@ int BlockAllocator::reclaim(void *user_context, MemoryRegion *memory_region) {
     return allocator->reclaim(user_context, memory_region);
 }
 
-int BlockAllocator::retain(void *user_context, MemoryRegion *memory_region) {
+WEAK int BlockAllocator::retain(void *user_context, MemoryRegion *memory_region) {
     if (memory_region == nullptr) {
         return halide_error_code_internal_error;
     }
@@ -227,7 +228,7 @@ int BlockAllocator::retain(void *user_context, MemoryRegion *memory_region) {
     return allocator->retain(user_context, memory_region);
 }
 
-bool BlockAllocator::collect(void *user_context) {
+WEAK bool BlockAllocator::collect(void *user_context) {
     bool result = false;
     BlockEntry *block_entry = block_list.back();
     while (block_entry != nullptr) {
@@ -262,7 +263,7 @@ bool BlockAllocator::collect(void *user_context) {
     return result;
 }
 
-int BlockAllocator::release(void *user_context) {
+WEAK int BlockAllocator::release(void *user_context) {
     BlockEntry *block_entry = block_list.back();
     while (block_entry != nullptr) {
         BlockEntry *prev_entry = block_entry->prev_ptr;
@@ -272,7 +273,7 @@ int BlockAllocator::release(void *user_context) {
     return 0;
 }
 
-int BlockAllocator::destroy(void *user_context) {
+WEAK int BlockAllocator::destroy(void *user_context) {
     BlockEntry *block_entry = block_list.back();
     while (block_entry != nullptr) {
         BlockEntry *prev_entry = block_entry->prev_ptr;
@@ -283,7 +284,7 @@ int BlockAllocator::destroy(void *user_context) {
     return 0;
 }
 
-MemoryRegion *BlockAllocator::reserve_memory_region(void *user_context, RegionAllocator *allocator, const MemoryRequest &request) {
+WEAK MemoryRegion *BlockAllocator::reserve_memory_region(void *user_context, RegionAllocator *allocator, const MemoryRequest &request) {
     MemoryRegion *result = allocator->reserve(user_context, request);
     if (result == nullptr) {
 #ifdef DEBUG_RUNTIME_INTERNAL
@@ -299,7 +300,7 @@ MemoryRegion *BlockAllocator::reserve_memory_region(void *user_context, RegionAl
     return result;
 }
 
-bool BlockAllocator::is_block_suitable_for_request(void *user_context, const BlockResource *block, const MemoryProperties &properties, size_t size, bool dedicated) const {
+WEAK bool BlockAllocator::is_block_suitable_for_request(void *user_context, const BlockResource *block, const MemoryProperties &properties, size_t size, bool dedicated) const {
     if (!is_compatible_block(block, properties)) {
 #ifdef DEBUG_RUNTIME_INTERNAL
         debug(user_context) << "BlockAllocator: skipping block ... incompatible properties!\n"
@@ -347,7 +348,7 @@ bool BlockAllocator::is_block_suitable_for_request(void *user_context, const Blo
     return false;
 }
 
-BlockAllocator::BlockEntry *
+WEAK BlockAllocator::BlockEntry *
 BlockAllocator::find_block_entry(void *user_context, const MemoryProperties &properties, size_t size, bool dedicated) {
     BlockEntry *block_entry = block_list.back();
     while (block_entry != nullptr) {
@@ -385,7 +386,7 @@ BlockAllocator::find_block_entry(void *user_context, const MemoryProperties &pro
     return block_entry;
 }
 
-BlockAllocator::BlockEntry *
+WEAK BlockAllocator::BlockEntry *
 BlockAllocator::reserve_block_entry(void *user_context, const MemoryProperties &properties, size_t size, bool dedicated) {
 #ifdef DEBUG_RUNTIME_INTERNAL
     debug(user_context) << "BlockAllocator: reserving block ... !\n"
@@ -417,7 +418,7 @@ BlockAllocator::reserve_block_entry(void *user_context, const MemoryProperties &
     return block_entry;
 }
 
-RegionAllocator *
+WEAK RegionAllocator *
 BlockAllocator::create_region_allocator(void *user_context, BlockResource *block) {
 #ifdef DEBUG_RUNTIME_INTERNAL
     debug(user_context) << "BlockAllocator: Creating region allocator ("
@@ -436,7 +437,7 @@ BlockAllocator::create_region_allocator(void *user_context, BlockResource *block
     return region_allocator;
 }
 
-int BlockAllocator::destroy_region_allocator(void *user_context, RegionAllocator *region_allocator) {
+WEAK int BlockAllocator::destroy_region_allocator(void *user_context, RegionAllocator *region_allocator) {
 #ifdef DEBUG_RUNTIME_INTERNAL
     debug(user_context) << "BlockAllocator: Destroying region allocator ("
                         << "user_context=" << (void *)(user_context) << " "
@@ -448,7 +449,7 @@ int BlockAllocator::destroy_region_allocator(void *user_context, RegionAllocator
     return RegionAllocator::destroy(user_context, region_allocator);
 }
 
-BlockAllocator::BlockEntry *
+WEAK BlockAllocator::BlockEntry *
 BlockAllocator::create_block_entry(void *user_context, const MemoryProperties &properties, size_t size, bool dedicated) {
     if (config.maximum_pool_size && (pool_size() >= config.maximum_pool_size)) {
         error(user_context) << "BlockAllocator: No free blocks found! Maximum pool size reached ("
@@ -484,11 +485,17 @@ BlockAllocator::create_block_entry(void *user_context, const MemoryProperties &p
     block->memory.dedicated = dedicated;
     block->reserved = 0;
     block->allocator = create_region_allocator(user_context, block);
-    alloc_memory_block(user_context, block);
+    int error_code = alloc_memory_block(user_context, block);
+    if ((error_code != 0) || (block->memory.handle == nullptr)) {
+        debug(user_context) << "BlockAllocator: Failed to allocate memory for new block ("
+                            << (int32_t)(block->memory.size) << " bytes)!\n";
+        destroy_block_entry(user_context, block_entry);
+        return nullptr;
+    }
     return block_entry;
 }
 
-int BlockAllocator::release_block_entry(void *user_context, BlockAllocator::BlockEntry *block_entry) {
+WEAK int BlockAllocator::release_block_entry(void *user_context, BlockAllocator::BlockEntry *block_entry) {
 #ifdef DEBUG_RUNTIME_INTERNAL
     debug(user_context) << "BlockAllocator: Releasing block entry ("
                         << "block_entry=" << (void *)(block_entry) << " "
@@ -501,7 +508,7 @@ int BlockAllocator::release_block_entry(void *user_context, BlockAllocator::Bloc
     return 0;
 }
 
-int BlockAllocator::destroy_block_entry(void *user_context, BlockAllocator::BlockEntry *block_entry) {
+WEAK int BlockAllocator::destroy_block_entry(void *user_context, BlockAllocator::BlockEntry *block_entry) {
 #ifdef DEBUG_RUNTIME_INTERNAL
     debug(user_context) << "BlockAllocator: Destroying block entry ("
                         << "block_entry=" << (void *)(block_entry) << " "
@@ -518,31 +525,33 @@ int BlockAllocator::destroy_block_entry(void *user_context, BlockAllocator::Bloc
     return 0;
 }
 
-int BlockAllocator::alloc_memory_block(void *user_context, BlockResource *block) {
+WEAK int BlockAllocator::alloc_memory_block(void *user_context, BlockResource *block) {
 #ifdef DEBUG_RUNTIME_INTERNAL
     debug(user_context) << "BlockAllocator: Allocating block (ptr=" << (void *)block << " allocator=" << (void *)allocators.block.allocate << ")...\n";
 #endif
     halide_abort_if_false(user_context, allocators.block.allocate != nullptr);
     MemoryBlock *memory_block = &(block->memory);
-    allocators.block.allocate(user_context, memory_block);
+    int error_code = allocators.block.allocate(user_context, memory_block);
     block->reserved = 0;
-    return 0;
+    return error_code;
 }
 
-int BlockAllocator::free_memory_block(void *user_context, BlockResource *block) {
+WEAK int BlockAllocator::free_memory_block(void *user_context, BlockResource *block) {
 #ifdef DEBUG_RUNTIME_INTERNAL
     debug(user_context) << "BlockAllocator: Deallocating block (ptr=" << (void *)block << " allocator=" << (void *)allocators.block.deallocate << ")...\n";
 #endif
     halide_abort_if_false(user_context, allocators.block.deallocate != nullptr);
     MemoryBlock *memory_block = &(block->memory);
-    allocators.block.deallocate(user_context, memory_block);
+    if (memory_block->handle != nullptr) {
+        allocators.block.deallocate(user_context, memory_block);
+    }
     memory_block->handle = nullptr;
     block->reserved = 0;
     block->memory.size = 0;
     return 0;
 }
 
-size_t BlockAllocator::constrain_requested_size(size_t size) const {
+WEAK size_t BlockAllocator::constrain_requested_size(size_t size) const {
     size_t actual_size = size;
     if (config.nearest_multiple) {
         actual_size = (((actual_size + config.nearest_multiple - 1) / config.nearest_multiple) * config.nearest_multiple);
@@ -561,7 +570,7 @@ size_t BlockAllocator::constrain_requested_size(size_t size) const {
     return actual_size;
 }
 
-bool BlockAllocator::is_compatible_block(const BlockResource *block, const MemoryProperties &properties) const {
+WEAK bool BlockAllocator::is_compatible_block(const BlockResource *block, const MemoryProperties &properties) const {
     if (properties.caching != MemoryCaching::DefaultCaching) {
         if (properties.caching != block->memory.properties.caching) {
             return false;
@@ -583,24 +592,24 @@ bool BlockAllocator::is_compatible_block(const BlockResource *block, const Memor
     return true;
 }
 
-const BlockAllocator::MemoryAllocators &BlockAllocator::current_allocators() const {
+WEAK const BlockAllocator::MemoryAllocators &BlockAllocator::current_allocators() const {
     return allocators;
 }
 
-const BlockAllocator::Config &BlockAllocator::current_config() const {
+WEAK const BlockAllocator::Config &BlockAllocator::current_config() const {
     return config;
 }
 
-const BlockAllocator::Config &BlockAllocator::default_config() const {
+WEAK const BlockAllocator::Config &BlockAllocator::default_config() const {
     static Config result;
     return result;
 }
 
-size_t BlockAllocator::block_count() const {
+WEAK size_t BlockAllocator::block_count() const {
     return block_list.size();
 }
 
-size_t BlockAllocator::pool_size() const {
+WEAK size_t BlockAllocator::pool_size() const {
     size_t total_size = 0;
     BlockEntry const *block_entry = nullptr;
     for (block_entry = block_list.front(); block_entry != nullptr; block_entry = block_entry->next_ptr) {
@@ -75,7 +75,7 @@ private:
     size_t entry_count = 0;
 };
 
-LinkedList::LinkedList(void *user_context, uint32_t entry_size, uint32_t capacity,
+WEAK LinkedList::LinkedList(void *user_context, uint32_t entry_size, uint32_t capacity,
                        const SystemMemoryAllocatorFns &sma) {
     uint32_t arena_capacity = max(capacity, MemoryArena::default_capacity);
     link_arena = MemoryArena::create(user_context, {sizeof(EntryType), arena_capacity, 0}, sma);
@@ -85,11 +85,11 @@ LinkedList::LinkedList(void *user_context, uint32_t entry_size, uint32_t capacit
     entry_count = 0;
 }
 
-LinkedList::~LinkedList() {
+WEAK LinkedList::~LinkedList() {
     destroy(nullptr);
 }
 
-void LinkedList::initialize(void *user_context, uint32_t entry_size, uint32_t capacity,
+WEAK void LinkedList::initialize(void *user_context, uint32_t entry_size, uint32_t capacity,
                             const SystemMemoryAllocatorFns &sma) {
     uint32_t arena_capacity = max(capacity, MemoryArena::default_capacity);
     link_arena = MemoryArena::create(user_context, {sizeof(EntryType), arena_capacity, 0}, sma);
@@ -99,7 +99,7 @@ void LinkedList::initialize(void *user_context, uint32_t entry_size, uint32_t ca
     entry_count = 0;
 }
 
-void LinkedList::destroy(void *user_context) {
+WEAK void LinkedList::destroy(void *user_context) {
     clear(nullptr);
     if (link_arena) {
         MemoryArena::destroy(nullptr, link_arena);
@@ -114,23 +114,23 @@ void LinkedList::destroy(void *user_context) {
     entry_count = 0;
 }
 
-typename LinkedList::EntryType *LinkedList::front() {
+WEAK typename LinkedList::EntryType *LinkedList::front() {
     return front_ptr;
 }
 
-typename LinkedList::EntryType *LinkedList::back() {
+WEAK typename LinkedList::EntryType *LinkedList::back() {
     return back_ptr;
 }
 
-const typename LinkedList::EntryType *LinkedList::front() const {
+WEAK const typename LinkedList::EntryType *LinkedList::front() const {
     return front_ptr;
 }
 
-const typename LinkedList::EntryType *LinkedList::back() const {
+WEAK const typename LinkedList::EntryType *LinkedList::back() const {
     return back_ptr;
 }
 
-typename LinkedList::EntryType *
+WEAK typename LinkedList::EntryType *
 LinkedList::prepend(void *user_context) {
     EntryType *entry_ptr = reserve(user_context);
     if (empty()) {
@@ -146,7 +146,7 @@ LinkedList::prepend(void *user_context) {
     return entry_ptr;
 }
 
-typename LinkedList::EntryType *
+WEAK typename LinkedList::EntryType *
 LinkedList::append(void *user_context) {
     EntryType *entry_ptr = reserve(user_context);
     if (empty()) {
@@ -162,21 +162,21 @@ LinkedList::append(void *user_context) {
     return entry_ptr;
 }
 
-typename LinkedList::EntryType *
+WEAK typename LinkedList::EntryType *
 LinkedList::prepend(void *user_context, const void *value) {
     EntryType *entry_ptr = prepend(user_context);
     memcpy(entry_ptr->value, value, data_arena->current_config().entry_size);
     return entry_ptr;
 }
 
-typename LinkedList::EntryType *
+WEAK typename LinkedList::EntryType *
 LinkedList::append(void *user_context, const void *value) {
     EntryType *entry_ptr = append(user_context);
     memcpy(entry_ptr->value, value, data_arena->current_config().entry_size);
     return entry_ptr;
 }
 
-void LinkedList::pop_front(void *user_context) {
+WEAK void LinkedList::pop_front(void *user_context) {
     halide_debug_assert(user_context, (entry_count > 0));
     EntryType *remove_ptr = front_ptr;
     EntryType *next_ptr = remove_ptr->next_ptr;
@@ -188,7 +188,7 @@ void LinkedList::pop_front(void *user_context) {
     --entry_count;
 }
 
-void LinkedList::pop_back(void *user_context) {
+WEAK void LinkedList::pop_back(void *user_context) {
     halide_debug_assert(user_context, (entry_count > 0));
     EntryType *remove_ptr = back_ptr;
     EntryType *prev_ptr = remove_ptr->prev_ptr;
@@ -200,7 +200,7 @@ void LinkedList::pop_back(void *user_context) {
     --entry_count;
 }
 
-void LinkedList::clear(void *user_context) {
+WEAK void LinkedList::clear(void *user_context) {
     if (empty() == false) {
         EntryType *remove_ptr = back_ptr;
         while (remove_ptr != nullptr) {
@@ -214,7 +214,7 @@ void LinkedList::clear(void *user_context) {
     }
 }
 
-void LinkedList::remove(void *user_context, EntryType *entry_ptr) {
+WEAK void LinkedList::remove(void *user_context, EntryType *entry_ptr) {
     halide_debug_assert(user_context, (entry_ptr != nullptr));
     halide_debug_assert(user_context, (entry_count > 0));
 
@@ -236,7 +236,7 @@ void LinkedList::remove(void *user_context, EntryType *entry_ptr) {
     --entry_count;
 }
 
-typename LinkedList::EntryType *
+WEAK typename LinkedList::EntryType *
 LinkedList::insert_before(void *user_context, EntryType *entry_ptr) {
     if (entry_ptr != nullptr) {
         EntryType *prev_ptr = entry_ptr->prev_ptr;
@@ -257,7 +257,7 @@ LinkedList::insert_before(void *user_context, EntryType *entry_ptr) {
     }
 }
 
-typename LinkedList::EntryType *
+WEAK typename LinkedList::EntryType *
 LinkedList::insert_after(void *user_context, EntryType *entry_ptr) {
     if (entry_ptr != nullptr) {
         EntryType *next_ptr = entry_ptr->next_ptr;
@@ -278,39 +278,39 @@ LinkedList::insert_after(void *user_context, EntryType *entry_ptr) {
     }
 }
 
-typename LinkedList::EntryType *
+WEAK typename LinkedList::EntryType *
 LinkedList::insert_before(void *user_context, EntryType *entry_ptr, const void *value) {
     EntryType *new_ptr = insert_before(user_context, entry_ptr);
     memcpy(new_ptr->value, value, data_arena->current_config().entry_size);
     return new_ptr;
 }
 
-typename LinkedList::EntryType *
+WEAK typename LinkedList::EntryType *
 LinkedList::insert_after(void *user_context, EntryType *entry_ptr, const void *value) {
     EntryType *new_ptr = insert_after(user_context, entry_ptr);
     memcpy(new_ptr->value, value, data_arena->current_config().entry_size);
     return new_ptr;
 }
 
-size_t LinkedList::size() const {
+WEAK size_t LinkedList::size() const {
     return entry_count;
 }
 
-bool LinkedList::empty() const {
+WEAK bool LinkedList::empty() const {
     return entry_count == 0;
 }
 
-const SystemMemoryAllocatorFns &
+WEAK const SystemMemoryAllocatorFns &
 LinkedList::current_allocator() const {
     return link_arena->current_allocator();
 }
 
-const SystemMemoryAllocatorFns &
+WEAK const SystemMemoryAllocatorFns &
 LinkedList::default_allocator() {
     return MemoryArena::default_allocator();
 }
 
-typename LinkedList::EntryType *
+WEAK typename LinkedList::EntryType *
 LinkedList::reserve(void *user_context) {
     EntryType *entry_ptr = static_cast<EntryType *>(
         link_arena->reserve(user_context, true));
@@ -320,7 +320,7 @@ LinkedList::reserve(void *user_context) {
     return entry_ptr;
 }
 
-void LinkedList::reclaim(void *user_context, EntryType *entry_ptr) {
+WEAK void LinkedList::reclaim(void *user_context, EntryType *entry_ptr) {
     void *value_ptr = entry_ptr->value;
     entry_ptr->value = nullptr;
     entry_ptr->next_ptr = nullptr;
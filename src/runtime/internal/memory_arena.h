@@ -86,7 +86,7 @@ private:
     BlockStorage blocks;
 };
 
-MemoryArena::MemoryArena(void *user_context,
+WEAK MemoryArena::MemoryArena(void *user_context,
                          const Config &cfg,
                          const SystemMemoryAllocatorFns &alloc)
     : config(cfg),
@@ -94,11 +94,11 @@ MemoryArena::MemoryArena(void *user_context,
     halide_debug_assert(user_context, config.minimum_block_capacity > 1);
 }
 
-MemoryArena::~MemoryArena() {
+WEAK MemoryArena::~MemoryArena() {
     destroy(nullptr);
 }
 
-MemoryArena *MemoryArena::create(void *user_context, const Config &cfg, const SystemMemoryAllocatorFns &system_allocator) {
+WEAK MemoryArena *MemoryArena::create(void *user_context, const Config &cfg, const SystemMemoryAllocatorFns &system_allocator) {
     halide_debug_assert(user_context, system_allocator.allocate != nullptr);
     MemoryArena *result = reinterpret_cast<MemoryArena *>(
         system_allocator.allocate(user_context, sizeof(MemoryArena)));
@@ -112,7 +112,7 @@ MemoryArena *MemoryArena::create(void *user_context, const Config &cfg, const Sy
     return result;
 }
 
-void MemoryArena::destroy(void *user_context, MemoryArena *instance) {
+WEAK void MemoryArena::destroy(void *user_context, MemoryArena *instance) {
     halide_debug_assert(user_context, instance != nullptr);
     const SystemMemoryAllocatorFns &system_allocator = instance->blocks.current_allocator();
     instance->destroy(user_context);
@@ -120,7 +120,7 @@ void MemoryArena::destroy(void *user_context, MemoryArena *instance) {
     system_allocator.deallocate(user_context, instance);
 }
 
-void MemoryArena::initialize(void *user_context,
+WEAK void MemoryArena::initialize(void *user_context,
                              const Config &cfg,
                              const SystemMemoryAllocatorFns &system_allocator) {
     config = cfg;
@@ -128,7 +128,7 @@ void MemoryArena::initialize(void *user_context,
     halide_debug_assert(user_context, config.minimum_block_capacity > 1);
 }
 
-void MemoryArena::destroy(void *user_context) {
+WEAK void MemoryArena::destroy(void *user_context) {
     if (!blocks.empty()) {
         for (size_t i = blocks.size(); i--;) {
             Block *block = lookup_block(user_context, i);
@@ -139,7 +139,7 @@ void MemoryArena::destroy(void *user_context) {
     blocks.destroy(user_context);
 }
 
-bool MemoryArena::collect(void *user_context) {
+WEAK bool MemoryArena::collect(void *user_context) {
     bool result = false;
     for (size_t i = blocks.size(); i--;) {
         Block *block = lookup_block(user_context, i);
@@ -152,7 +152,7 @@ bool MemoryArena::collect(void *user_context) {
     return result;
 }
 
-void *MemoryArena::reserve(void *user_context, bool initialize) {
+WEAK void *MemoryArena::reserve(void *user_context, bool initialize) {
     // Scan blocks for a free entry
     for (size_t i = blocks.size(); i--;) {
         Block *block = lookup_block(user_context, i);
@@ -179,7 +179,7 @@ void *MemoryArena::reserve(void *user_context, bool initialize) {
     return entry_ptr;
 }
 
-void MemoryArena::reclaim(void *user_context, void *entry_ptr) {
+WEAK void MemoryArena::reclaim(void *user_context, void *entry_ptr) {
     for (size_t i = blocks.size(); i--;) {
         Block *block = lookup_block(user_context, i);
         halide_debug_assert(user_context, block != nullptr);
@@ -198,7 +198,7 @@ void MemoryArena::reclaim(void *user_context, void *entry_ptr) {
     halide_error(user_context, "MemoryArena: Pointer address doesn't belong to this memory pool!\n");
 }
 
-typename MemoryArena::Block *MemoryArena::create_block(void *user_context) {
+WEAK typename MemoryArena::Block *MemoryArena::create_block(void *user_context) {
     // resize capacity starting with initial up to 1.5 last capacity
     uint32_t new_capacity = config.minimum_block_capacity;
     if (!blocks.empty()) {
@@ -226,7 +226,7 @@ typename MemoryArena::Block *MemoryArena::create_block(void *user_context) {
     return static_cast<Block *>(blocks.back());
 }
 
-void MemoryArena::destroy_block(void *user_context, Block *block) {
+WEAK void MemoryArena::destroy_block(void *user_context, Block *block) {
     halide_debug_assert(user_context, block != nullptr);
     if (block->entries != nullptr) {
         halide_debug_assert(user_context, current_allocator().deallocate != nullptr);
@@ -239,7 +239,7 @@ void MemoryArena::destroy_block(void *user_context, Block *block) {
     }
 }
 
-bool MemoryArena::collect_block(void *user_context, Block *block) {
+WEAK bool MemoryArena::collect_block(void *user_context, Block *block) {
     halide_debug_assert(user_context, block != nullptr);
     if (block->entries != nullptr) {
         bool can_collect = true;
@@ -257,17 +257,17 @@ bool MemoryArena::collect_block(void *user_context, Block *block) {
     return false;
 }
 
-MemoryArena::Block *MemoryArena::lookup_block(void *user_context, uint32_t index) {
+WEAK MemoryArena::Block *MemoryArena::lookup_block(void *user_context, uint32_t index) {
     return static_cast<Block *>(blocks[index]);
 }
 
-void *MemoryArena::lookup_entry(void *user_context, Block *block, uint32_t index) {
+WEAK void *MemoryArena::lookup_entry(void *user_context, Block *block, uint32_t index) {
     halide_debug_assert(user_context, block != nullptr);
     halide_debug_assert(user_context, block->entries != nullptr);
     return offset_address(block->entries, index * config.entry_size);
 }
 
-void *MemoryArena::create_entry(void *user_context, Block *block, uint32_t index) {
+WEAK void *MemoryArena::create_entry(void *user_context, Block *block, uint32_t index) {
     void *entry_ptr = lookup_entry(user_context, block, index);
     block->free_index = block->indices[index];
     block->status[index] = AllocationStatus::InUse;
@@ -277,29 +277,29 @@ void *MemoryArena::create_entry(void *user_context, Block *block, uint32_t index
     return entry_ptr;
 }
 
-void MemoryArena::destroy_entry(void *user_context, Block *block, uint32_t index) {
+WEAK void MemoryArena::destroy_entry(void *user_context, Block *block, uint32_t index) {
     block->status[index] = AllocationStatus::Available;
     block->indices[index] = block->free_index;
     block->free_index = index;
 }
 
-const typename MemoryArena::Config &
+WEAK const typename MemoryArena::Config &
 MemoryArena::current_config() const {
     return config;
 }
 
-const typename MemoryArena::Config &
+WEAK const typename MemoryArena::Config &
 MemoryArena::default_config() {
     static Config result;
     return result;
 }
 
-const SystemMemoryAllocatorFns &
+WEAK const SystemMemoryAllocatorFns &
 MemoryArena::current_allocator() const {
     return blocks.current_allocator();
 }
 
-const SystemMemoryAllocatorFns &
+WEAK const SystemMemoryAllocatorFns &
 MemoryArena::default_allocator() {
     return BlockStorage::default_allocator();
 }
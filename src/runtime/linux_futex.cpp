@@ -0,0 +1,43 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+extern "C" {
+
+// The syscall number for futex varies across platforms:
+// -- i386 and android x86 is 240
+// -- x64 is 202
+
+#ifndef SYS_FUTEX
+
+#ifdef BITS_64
+#define SYS_FUTEX 202
+#endif
+
+#ifdef BITS_32
+#define SYS_FUTEX 240
+#endif
+
+#endif
+
+// FUTEX_WAIT and FUTEX_WAKE with FUTEX_PRIVATE_FLAG, as our waiters
+// are never in another process.
+#define HALIDE_FUTEX_WAIT_PRIVATE 128
+#define HALIDE_FUTEX_WAKE_PRIVATE 129
+
+extern int syscall(int num, ...);
+
+WEAK bool halide_futex_supported() {
+    return true;
+}
+
+WEAK void halide_futex_wait(int *addr, int val) {
+    // Returns immediately with EAGAIN if *addr has already changed,
+    // and on EINTR; our callers re-check the value either way.
+    syscall(SYS_FUTEX, addr, HALIDE_FUTEX_WAIT_PRIVATE, val, nullptr, nullptr, 0);
+}
+
+WEAK void halide_futex_wake(int *addr, int count) {
+    syscall(SYS_FUTEX, addr, HALIDE_FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+}  // extern "C"
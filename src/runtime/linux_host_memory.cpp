@@ -0,0 +1,130 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+extern "C" {
+
+// The syscall number for mbind varies across platforms, and glibc
+// has no wrapper for it:
+// -- i386 is 274
+// -- x64 is 237
+
+#ifndef SYS_MBIND
+
+#ifdef BITS_64
+#define SYS_MBIND 237
+#endif
+
+#ifdef BITS_32
+#define SYS_MBIND 274
+#endif
+
+#endif
+
+#define HALIDE_PROT_READ_WRITE 3
+#define HALIDE_MAP_PRIVATE 0x02
+#define HALIDE_MAP_ANONYMOUS 0x20
+#define HALIDE_MAP_HUGETLB 0x40000
+#define HALIDE_MAP_HUGE_1GB (30 << 26)
+#define HALIDE_MADV_HUGEPAGE 14
+#define HALIDE_MPOL_INTERLEAVE 3
+
+extern void *mmap(void *addr, size_t length, int prot, int flags, int fd, long offset);
+extern int munmap(void *addr, size_t length);
+extern int madvise(void *addr, size_t length, int advice);
+extern int syscall(int num, ...);
+
+}  // extern "C"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+constexpr size_t huge_page_size = (size_t)1 << 21;
+constexpr size_t gigantic_page_size = (size_t)1 << 30;
+
+ALWAYS_INLINE bool map_failed(void *ptr) {
+    return ptr == (void *)(intptr_t)-1;
+}
+
+// Map 1GB pages from the hugetlbfs reserve, which is empty unless
+// the administrator set one up.
+WEAK void *map_gigantic_pages(size_t *size) {
+    size_t len = align_up(*size, gigantic_page_size);
+    void *region = mmap(nullptr, len, HALIDE_PROT_READ_WRITE,
+                        HALIDE_MAP_PRIVATE | HALIDE_MAP_ANONYMOUS | HALIDE_MAP_HUGETLB | HALIDE_MAP_HUGE_1GB,
+                        -1, 0);
+    if (map_failed(region)) {
+        return nullptr;
+    }
+    *size = len;
+    return region;
+}
+
+// Map a region aligned to 2MB and ask for it to be backed by
+// transparent huge pages. mmap only guarantees page alignment, so map
+// one huge page extra and trim the ends.
+WEAK void *map_huge_pages(size_t *size) {
+    size_t len = align_up(*size, huge_page_size);
+    uint8_t *region = (uint8_t *)mmap(nullptr, len + huge_page_size, HALIDE_PROT_READ_WRITE,
+                                      HALIDE_MAP_PRIVATE | HALIDE_MAP_ANONYMOUS, -1, 0);
+    if (map_failed(region)) {
+        return nullptr;
+    }
+    uint8_t *aligned = (uint8_t *)align_up((uintptr_t)region, huge_page_size);
+    if (aligned > region) {
+        munmap(region, aligned - region);
+    }
+    if (aligned + len < region + len + huge_page_size) {
+        munmap(aligned + len, region + len + huge_page_size - (aligned + len));
+    }
+    // This only fails if transparent huge pages are disabled, in
+    // which case we still have normal pages.
+    (void)madvise(aligned, len, HALIDE_MADV_HUGEPAGE);
+    *size = len;
+    return aligned;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK void *halide_internal_map_host_pages(size_t *size, int policy) {
+    void *region = nullptr;
+    if (policy & halide_host_memory_policy_gigantic_pages) {
+        region = map_gigantic_pages(size);
+    }
+    if (!region && (policy & (halide_host_memory_policy_huge_pages |
+                              halide_host_memory_policy_gigantic_pages))) {
+        region = map_huge_pages(size);
+    }
+    if (!region) {
+        size_t len = align_up(*size, (size_t)4096);
+        region = mmap(nullptr, len, HALIDE_PROT_READ_WRITE,
+                      HALIDE_MAP_PRIVATE | HALIDE_MAP_ANONYMOUS, -1, 0);
+        if (map_failed(region)) {
+            return nullptr;
+        }
+        *size = len;
+    }
+    if (policy & halide_host_memory_policy_numa_interleave) {
+        int nodes = halide_host_numa_node_count();
+        if (nodes > 1) {
+            uint64_t mask = nodes >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << nodes) - 1;
+            // The kernel ignores the last bit of maxnode. This fails
+            // harmlessly on kernels without NUMA support, leaving the
+            // default first-touch placement.
+            (void)syscall(SYS_MBIND, region, *size, HALIDE_MPOL_INTERLEAVE, &mask, 65, 0);
+        }
+    }
+    return region;
+}
+
+WEAK void halide_internal_unmap_host_pages(void *region, size_t size) {
+    munmap(region, size);
+}
+
+}  // extern "C"
@@ -0,0 +1,118 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_internal.h"
+
+extern "C" {
+
+extern int sched_setaffinity(int pid, size_t cpusetsize, const void *mask);
+extern size_t fread(void *ptr, size_t size, size_t n, void *file);
+extern int setpriority(int which, int who, int prio);
+
+}  // extern "C"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// Matches the size of glibc's cpu_set_t.
+constexpr int affinity_mask_cpus = 1024;
+
+struct affinity_mask {
+    uint64_t bits[affinity_mask_cpus / 64];
+};
+
+// Read a small file from sysfs into buf as a nul-terminated
+// string. Returns false if it could not be read.
+WEAK bool read_sysfs_file(const char *path, char *buf, size_t size) {
+    void *f = halide_fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    size_t n = fread(buf, 1, size - 1, f);
+    fclose(f);
+    buf[n] = 0;
+    return n > 0;
+}
+
+// Parse a sysfs cpu list such as "0-3,8-11" into a mask. Returns the
+// highest entry seen, or -1 if the list is empty.
+WEAK int parse_cpu_list(const char *str, affinity_mask *mask) {
+    int highest = -1;
+    while (*str >= '0' && *str <= '9') {
+        int lo = atoi(str);
+        while (*str >= '0' && *str <= '9') {
+            str++;
+        }
+        int hi = lo;
+        if (*str == '-') {
+            str++;
+            hi = atoi(str);
+            while (*str >= '0' && *str <= '9') {
+                str++;
+            }
+        }
+        for (int i = lo; i <= hi && i < affinity_mask_cpus; i++) {
+            if (mask) {
+                mask->bits[i / 64] |= (uint64_t)1 << (i % 64);
+            }
+        }
+        if (hi > highest) {
+            highest = hi;
+        }
+        if (*str == ',') {
+            str++;
+        }
+    }
+    return highest;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_host_numa_node_count() {
+    char buf[256];
+    if (!read_sysfs_file("/sys/devices/system/node/online", buf, sizeof(buf))) {
+        return 1;
+    }
+    int highest = parse_cpu_list(buf, nullptr);
+    return highest < 0 ? 1 : highest + 1;
+}
+
+WEAK bool halide_pin_thread_to_cpu(int cpu) {
+    if (cpu < 0 || cpu >= affinity_mask_cpus) {
+        return false;
+    }
+    affinity_mask mask;
+    memset(&mask, 0, sizeof(mask));
+    mask.bits[cpu / 64] = (uint64_t)1 << (cpu % 64);
+    return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+}
+
+WEAK bool halide_pin_thread_to_numa_node(int node) {
+    StackStringStreamPrinter<64> path(nullptr);
+    path << "/sys/devices/system/node/node" << node << "/cpulist";
+    char buf[1024];
+    if (!read_sysfs_file(path.str(), buf, sizeof(buf))) {
+        return false;
+    }
+    affinity_mask mask;
+    memset(&mask, 0, sizeof(mask));
+    if (parse_cpu_list(buf, &mask) < 0) {
+        return false;
+    }
+    return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+}
+
+WEAK bool halide_set_thread_low_priority() {
+    // On Linux the nice value is per-thread, and who == 0 refers to
+    // the calling thread rather than the whole process.
+    const int prio_process = 0;
+    return setpriority(prio_process, 0, 10) == 0;
+}
+
+}  // extern "C"
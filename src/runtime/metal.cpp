@@ -3,7 +3,9 @@
 #include "device_interface.h"
 #include "gpu_context_common.h"
 #include "printer.h"
+#include "scoped_mutex_lock.h"
 #include "scoped_spin_lock.h"
+#include "timeline.h"
 
 #include "objc_support.h"
 
@@ -243,6 +245,22 @@ WEAK void wait_until_completed(mtl_command_buffer *buffer) {
     (*method)(buffer, sel_getUid("waitUntilCompleted"));
 }
 
+// The time the GPU spent executing a completed command buffer, in
+// nanoseconds, or zero if the OS is too old to say.
+WEAK uint64_t command_buffer_gpu_time_ns(mtl_command_buffer *buffer) {
+    typedef bool (*responds_to_selector_method)(objc_id obj, objc_sel sel_1, objc_sel sel_2);
+    responds_to_selector_method method1 = (responds_to_selector_method)&objc_msgSend;
+    objc_sel start_sel = sel_getUid("GPUStartTime");
+    if (!(*method1)(buffer, sel_getUid("respondsToSelector:"), start_sel)) {
+        return 0;
+    }
+    typedef double (*gpu_time_method)(objc_id buf, objc_sel sel);
+    gpu_time_method method = (gpu_time_method)&objc_msgSend;
+    double start = (*method)(buffer, start_sel);
+    double end = (*method)(buffer, sel_getUid("GPUEndTime"));
+    return end > start ? (uint64_t)((end - start) * 1e9) : 0;
+}
+
 WEAK void *buffer_contents(mtl_buffer *buffer) {
     typedef void *(*contents_method)(objc_id buf, objc_sel sel);
     contents_method method = (contents_method)&objc_msgSend;
@@ -440,6 +458,77 @@ WEAK command_buffer_completed_handler_block_literal command_buffer_completed_han
     0, command_buffer_completed_handler_invoke,
     &command_buffer_completed_handler_descriptor};
 
+// Kernel dispatches are encoded into one shared command buffer, which is
+// only committed when the host needs their results, or once it holds
+// max_batched_dispatches of them, to save a command buffer submission
+// per kernel. The batch has a lock of its own, as users may override
+// halide_metal_acquire_context with one that doesn't serialize calls
+// into the runtime.
+constexpr int max_batched_dispatches = 64;
+WEAK halide_mutex batch_lock;
+WEAK mtl_command_queue *batch_queue = nullptr;
+WEAK mtl_command_buffer *batch_command_buffer = nullptr;
+WEAK mtl_compute_command_encoder *batch_encoder = nullptr;
+WEAK int batch_dispatches = 0;
+
+// Commits the batched dispatches, if any, optionally waiting for them
+// to complete. If gpu_time_ns is given, it is set to the time the GPU
+// spent executing them. Must be called with batch_lock held.
+WEAK void flush_batched_dispatches_locked(bool wait, uint64_t *gpu_time_ns = nullptr) {
+    if (batch_command_buffer == nullptr) {
+        return;
+    }
+    end_encoding(batch_encoder);
+    commit_command_buffer(batch_command_buffer);
+    if (wait) {
+        wait_until_completed(batch_command_buffer);
+        if (gpu_time_ns) {
+            *gpu_time_ns = command_buffer_gpu_time_ns(batch_command_buffer);
+        }
+    }
+    release_ns_object(batch_encoder);
+    release_ns_object(batch_command_buffer);
+    batch_encoder = nullptr;
+    batch_command_buffer = nullptr;
+    batch_queue = nullptr;
+    batch_dispatches = 0;
+}
+
+WEAK void flush_batched_dispatches(bool wait) {
+    ScopedMutexLock lock(&batch_lock);
+    flush_batched_dispatches_locked(wait);
+}
+
+// Returns the compute encoder to add dispatches on queue to, starting a
+// new batch if need be. Must be called with batch_lock held, which
+// should then be kept until the dispatch has been encoded.
+WEAK mtl_compute_command_encoder *batched_compute_encoder(mtl_command_queue *queue) {
+    if (batch_command_buffer != nullptr && batch_queue != queue) {
+        flush_batched_dispatches_locked(false);
+    }
+    if (batch_command_buffer == nullptr) {
+        const char *buffer_label = "halide_metal_run";
+        mtl_command_buffer *command_buffer = new_command_buffer(queue, buffer_label, strlen(buffer_label));
+        if (command_buffer == nullptr) {
+            return nullptr;
+        }
+        // Both the command buffer and the encoder are autoreleased, and
+        // the batch outlives the current autorelease pool.
+        retain_ns_object(command_buffer);
+        mtl_compute_command_encoder *encoder = new_compute_command_encoder(command_buffer);
+        if (encoder == nullptr) {
+            release_ns_object(command_buffer);
+            return nullptr;
+        }
+        retain_ns_object(encoder);
+        add_command_buffer_completed_handler(command_buffer, &command_buffer_completed_handler_block);
+        batch_queue = queue;
+        batch_command_buffer = command_buffer;
+        batch_encoder = encoder;
+    }
+    return batch_encoder;
+}
+
 }  // namespace Metal
 }  // namespace Internal
 }  // namespace Runtime
@@ -578,6 +667,7 @@ WEAK void halide_metal_finalize_kernels(void *user_context, void *state_ptr) {
 namespace {
 
 WEAK void halide_metal_device_sync_internal(mtl_command_queue *queue, struct halide_buffer_t *buffer) {
+    flush_batched_dispatches(true);
     const char *buffer_label = "halide_metal_device_sync_internal";
     mtl_command_buffer *sync_command_buffer = new_command_buffer(queue, buffer_label, strlen(buffer_label));
     if (buffer != nullptr) {
@@ -668,6 +758,17 @@ WEAK int halide_metal_copy_to_device(void *user_context, halide_buffer_t *buffer
                         << " metal_buffer = " << metal_buffer
                         << " host = " << buffer->host << "\n";
 
+    if (c.src == c.dst && !is_buffer_managed(metal_buffer)) {
+        // The host data is the shared contents of the buffer (see
+        // halide_metal_device_and_host_malloc), so the GPU already
+        // sees what the host wrote and there is nothing to wait for.
+        debug(user_context) << "halide_metal_copy_to_device: no copy needed for shared storage\n";
+        return halide_error_code_success;
+    }
+
+    // Batched dispatches may still read the old contents.
+    flush_batched_dispatches(true);
+
     copy_memory(c, user_context);
 
     if (is_buffer_managed(metal_buffer)) {
@@ -733,6 +834,8 @@ WEAK int halide_metal_run(void *user_context,
                           halide_type_t arg_types[],
                           void *args[],
                           int8_t arg_is_buffer[]) {
+    ScopedTimelineSpan span(TimelineKernel, entry_name);
+
 #ifdef DEBUG_RUNTIME
     uint64_t t_before = halide_current_time_ns(user_context);
 #endif
@@ -742,15 +845,10 @@ WEAK int halide_metal_run(void *user_context,
         return metal_context.error();
     }
 
-    mtl_command_buffer *command_buffer = new_command_buffer(metal_context.queue, entry_name, strlen(entry_name));
-    if (command_buffer == nullptr) {
-        error(user_context) << "Metal: Could not allocate command buffer.";
-        return halide_error_code_generic_error;
-    }
-
-    mtl_compute_command_encoder *encoder = new_compute_command_encoder(command_buffer);
+    ScopedMutexLock batch_lock_holder(&batch_lock);
+    mtl_compute_command_encoder *encoder = batched_compute_encoder(metal_context.queue);
     if (encoder == nullptr) {
-        error(user_context) << "Metal: Could not allocate compute command encoder.";
+        error(user_context) << "Metal: Could not allocate command buffer or compute command encoder.";
         return halide_error_code_generic_error;
     }
 
@@ -776,7 +874,6 @@ WEAK int halide_metal_run(void *user_context,
 #ifdef DEBUG_RUNTIME
     int64_t max_total_threads_per_threadgroup = get_max_total_threads_per_threadgroup(pipeline_state);
     if (max_total_threads_per_threadgroup < threadsX * threadsY * threadsZ) {
-        end_encoding(encoder);
         release_ns_object(pipeline_state);
         error(user_context) << "Metal: threadsX(" << threadsX << ") * threadsY("
                             << threadsY << ") * threadsZ(" << threadsZ
@@ -881,11 +978,18 @@ WEAK int halide_metal_run(void *user_context,
     dispatch_threadgroups(encoder,
                           blocksX, blocksY, blocksZ,
                           threadsX, threadsY, threadsZ);
-    end_encoding(encoder);
 
-    add_command_buffer_completed_handler(command_buffer, &command_buffer_completed_handler_block);
-
-    commit_command_buffer(command_buffer);
+    if (should_time_device_kernels()) {
+        // Time each kernel on the GPU by giving it a command buffer of
+        // its own and waiting for it to complete.
+        uint64_t ns = 0;
+        flush_batched_dispatches_locked(true, &ns);
+        if (ns) {
+            device_profiler_event(user_context, DeviceProfilerKernel, 0, 0, ns);
+        }
+    } else if (++batch_dispatches >= max_batched_dispatches) {
+        flush_batched_dispatches_locked(false);
+    }
 
     // We deliberately don't release the function here; this was causing
     // crashes on Mojave (issues #3395 and #3408).
@@ -901,6 +1005,9 @@ WEAK int halide_metal_run(void *user_context,
     return halide_error_code_success;
 }
 
+// Buffers are allocated with MTLStorageModeShared, so the host pointer
+// of a buffer allocated here is the contents of its Metal buffer, and
+// copies to and from the device only wait for the kernels using it.
 WEAK int halide_metal_device_and_host_malloc(void *user_context, struct halide_buffer_t *buffer) {
     debug(user_context) << "halide_metal_device_and_host_malloc called.\n";
     auto result = halide_metal_device_malloc(user_context, buffer);
@@ -977,6 +1084,9 @@ WEAK int halide_metal_buffer_copy(void *user_context, struct halide_buffer_t *sr
         // Device only case
         if (!from_host && !to_host) {
             debug(user_context) << "halide_metal_buffer_copy device to device case.\n";
+            // The blit must be ordered after any batched dispatches.
+            ScopedMutexLock batch_lock_holder(&batch_lock);
+            flush_batched_dispatches_locked(false);
             const char *buffer_label = "halide_metal_buffer_copy";
             mtl_command_buffer *blit_command_buffer = new_command_buffer(metal_context.queue, buffer_label, strlen(buffer_label));
             mtl_blit_command_encoder *blit_encoder = new_blit_command_encoder(blit_command_buffer);
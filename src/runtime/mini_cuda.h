@@ -25,6 +25,12 @@ typedef struct CUfunc_st *CUfunction; /**< CUDA function */
 typedef struct CUstream_st *CUstream; /**< CUDA stream */
 typedef struct CUevent_st *CUevent;   /**< CUDA event */
 typedef struct CUarray_st *CUarray;
+typedef struct CUlinkState_st *CUlinkState; /**< CUDA JIT linker state */
+typedef struct CUgraph_st *CUgraph;         /**< CUDA graph */
+typedef struct CUgraphNode_st *CUgraphNode; /**< CUDA graph node */
+typedef struct CUgraphExec_st *CUgraphExec; /**< CUDA executable graph */
+
+typedef size_t(CUDAAPI *CUoccupancyB2DSize)(int blockSize); /**< Dynamic shared memory for a block size */
 
 typedef enum CUjit_option_enum {
     CU_JIT_MAX_REGISTERS = 0,
@@ -40,6 +46,11 @@ typedef enum CUjit_option_enum {
     CU_JIT_FALLBACK_STRATEGY = 10
 } CUjit_option;
 
+typedef enum CUjitInputType_enum {
+    CU_JIT_INPUT_CUBIN = 0,
+    CU_JIT_INPUT_PTX = 1,
+} CUjitInputType;
+
 typedef enum {
     CUDA_SUCCESS = 0,
     CUDA_ERROR_INVALID_VALUE = 1,
@@ -189,6 +200,7 @@ typedef enum {
     CU_DEVICE_ATTRIBUTE_MANAGED_MEMORY = 83,                        /**< Device can allocate managed memory on this system */
     CU_DEVICE_ATTRIBUTE_MULTI_GPU_BOARD = 84,                       /**< Device is on a multi-GPU board */
     CU_DEVICE_ATTRIBUTE_MULTI_GPU_BOARD_GROUP_ID = 85,              /**< Unique id for a group of devices on the same multi-GPU board */
+    CU_DEVICE_ATTRIBUTE_CONCURRENT_MANAGED_ACCESS = 89,             /**< Device can coherently access managed memory concurrently with the CPU */
     CU_DEVICE_ATTRIBUTE_MAX
 } CUdevice_attribute;
 
@@ -231,6 +243,38 @@ typedef struct CUDA_MEMCPY3D_st {
 
 #define CU_POINTER_ATTRIBUTE_CONTEXT 1
 
+#define CU_MEMHOSTALLOC_PORTABLE 0x01
+
+#define CU_MEM_ATTACH_GLOBAL 0x1
+
+typedef enum CUstream_flags_enum {
+    CU_STREAM_DEFAULT = 0x0,      /**< Default stream flag */
+    CU_STREAM_NON_BLOCKING = 0x1, /**< Stream does not synchronize with stream 0 (the NULL stream) */
+} CUstream_flags;
+
+typedef enum CUevent_flags_enum {
+    CU_EVENT_DEFAULT = 0x0,         /**< Default event flag */
+    CU_EVENT_BLOCKING_SYNC = 0x1,   /**< Event uses blocking synchronization */
+    CU_EVENT_DISABLE_TIMING = 0x2,  /**< Event will not record timing data */
+} CUevent_flags;
+
+/**
+ * GPU kernel node parameters, as taken by the unversioned
+ * cuGraphAddKernelNode and cuGraphExecKernelNodeSetParams entry points.
+ */
+typedef struct CUDA_KERNEL_NODE_PARAMS_st {
+    CUfunction func;             /**< Kernel to launch */
+    unsigned int gridDimX;       /**< Width of grid in blocks */
+    unsigned int gridDimY;       /**< Height of grid in blocks */
+    unsigned int gridDimZ;       /**< Depth of grid in blocks */
+    unsigned int blockDimX;      /**< X dimension of each thread block */
+    unsigned int blockDimY;      /**< Y dimension of each thread block */
+    unsigned int blockDimZ;      /**< Z dimension of each thread block */
+    unsigned int sharedMemBytes; /**< Dynamic shared-memory size per thread block in bytes */
+    void **kernelParams;         /**< Array of pointers to kernel parameters */
+    void **extra;                /**< Extra options */
+} CUDA_KERNEL_NODE_PARAMS;
+
 }  // namespace Cuda
 }  // namespace Internal
 }  // namespace Runtime
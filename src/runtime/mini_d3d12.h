@@ -3093,6 +3093,87 @@ typedef struct D3D12_VERSIONED_ROOT_SIGNATURE_DESC {
 
 #define D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND (0xffffffff)
 
+#ifndef __ID3D12Heap_INTERFACE_DEFINED__
+#define __ID3D12Heap_INTERFACE_DEFINED__
+
+/* interface ID3D12Heap */
+/* [unique][local][object][uuid] */
+
+EXTERN_C const IID IID_ID3D12Heap;
+
+#if defined(__cplusplus) && !defined(CINTERFACE)
+
+MIDL_INTERFACE("6b3b2502-6e51-45b3-90ee-9884265e8df3")
+ID3D12Heap : public ID3D12Pageable {
+public:
+    virtual D3D12_HEAP_DESC STDMETHODCALLTYPE GetDesc() = 0;
+};
+
+#else /* C style interface */
+
+typedef struct ID3D12HeapVtbl {
+    BEGIN_INTERFACE
+
+    HRESULT(STDMETHODCALLTYPE *QueryInterface)
+    (
+        ID3D12Heap *This,
+        REFIID riid,
+        _COM_Outptr_ void **ppvObject);
+
+    ULONG(STDMETHODCALLTYPE *AddRef)
+    (
+        ID3D12Heap *This);
+
+    ULONG(STDMETHODCALLTYPE *Release)
+    (
+        ID3D12Heap *This);
+
+    HRESULT(STDMETHODCALLTYPE *GetPrivateData)
+    (
+        ID3D12Heap *This,
+        _In_ REFGUID guid,
+        _Inout_ UINT *pDataSize,
+        _Out_writes_bytes_opt_(*pDataSize) void *pData);
+
+    HRESULT(STDMETHODCALLTYPE *SetPrivateData)
+    (
+        ID3D12Heap *This,
+        _In_ REFGUID guid,
+        _In_ UINT DataSize,
+        _In_reads_bytes_opt_(DataSize) const void *pData);
+
+    HRESULT(STDMETHODCALLTYPE *SetPrivateDataInterface)
+    (
+        ID3D12Heap *This,
+        _In_ REFGUID guid,
+        _In_opt_ const IUnknown *pData);
+
+    HRESULT(STDMETHODCALLTYPE *SetName)
+    (
+        ID3D12Heap *This,
+        _In_z_ LPCWSTR Name);
+
+    HRESULT(STDMETHODCALLTYPE *GetDevice)
+    (
+        ID3D12Heap *This,
+        REFIID riid,
+        _COM_Outptr_opt_ void **ppvDevice);
+
+    D3D12_HEAP_DESC(STDMETHODCALLTYPE *GetDesc)
+    (
+        ID3D12Heap *This);
+
+    END_INTERFACE
+} ID3D12HeapVtbl;
+
+interface ID3D12Heap {
+    CONST_VTBL struct ID3D12HeapVtbl *lpVtbl;
+};
+
+#endif /* C style interface */
+
+#endif /* __ID3D12Heap_INTERFACE_DEFINED__ */
+
 #ifndef __ID3D12Resource_INTERFACE_DEFINED__
 #define __ID3D12Resource_INTERFACE_DEFINED__
 
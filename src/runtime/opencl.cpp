@@ -1,9 +1,12 @@
 #include "HalideRuntimeOpenCL.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "gpu_binary_cache.h"
 #include "gpu_context_common.h"
+#include "gpu_memory_allocator.h"
 #include "printer.h"
 #include "scoped_spin_lock.h"
+#include "timeline.h"
 
 #include "mini_cl.h"
 
@@ -321,10 +324,51 @@ struct device_handle {
     // insert padding otherwise.
     uint64_t offset;
     cl_mem mem;
+    // Non-null if mem is a block owned by the device memory
+    // suballocator, in which case offset locates this buffer in it.
+    GPUMemoryAllocation *allocation;
 };
 
 WEAK Halide::Internal::GPUCompilationCache<cl_context, cl_program> compilation_cache;
 
+// Blocks for the device memory suballocator, used when
+// halide_can_use_device_suballocation is true.
+WEAK int opencl_allocate_block(void *user_context, void *ctx, size_t size, void **handle) {
+    cl_int err;
+    debug(user_context) << "    clCreateBuffer -> " << (uint64_t)size << " ";
+    cl_mem mem = clCreateBuffer((cl_context)ctx, CL_MEM_READ_WRITE, size, nullptr, &err);
+    if (err != CL_SUCCESS || mem == nullptr) {
+        debug(user_context) << get_opencl_error_name(err) << "\n";
+        return halide_error_code_device_malloc_failed;
+    }
+    debug(user_context) << (void *)mem << "\n";
+    *handle = (void *)mem;
+    return halide_error_code_success;
+}
+
+WEAK int opencl_deallocate_block(void *user_context, void *ctx, void *handle) {
+    debug(user_context) << "    clReleaseMemObject " << handle << "\n";
+    cl_int err = clReleaseMemObject((cl_mem)handle);
+    return (err == CL_SUCCESS) ? halide_error_code_success : halide_error_code_device_free_failed;
+}
+
+WEAK GPUMemoryPool opencl_memory_pool = {{opencl_allocate_block, opencl_deallocate_block}, nullptr, {}, {}};
+
+// Suballocations are only usable as kernel arguments via sub-buffers,
+// which must start on a multiple of the device's base address
+// alignment.
+WEAK size_t suballocation_alignment(void *user_context, cl_context ctx) {
+    size_t alignment = 128;
+    cl_device_id device;
+    cl_uint align_bits = 0;
+    if (clGetContextInfo(ctx, CL_CONTEXT_DEVICES, sizeof(device), &device, nullptr) == CL_SUCCESS &&
+        clGetDeviceInfo(device, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(align_bits), &align_bits, nullptr) == CL_SUCCESS &&
+        (align_bits / 8) > alignment) {
+        alignment = align_bits / 8;
+    }
+    return alignment;
+}
+
 WEAK int validate_device_pointer(void *user_context, halide_buffer_t *buf, size_t size = 0) {
     if (buf->device == 0) {
         return halide_error_code_success;
@@ -559,8 +603,17 @@ WEAK int create_opencl_context(void *user_context, cl_context *ctx, cl_command_q
     }
     debug(user_context) << *ctx << "\n";
 
+    // Kernels can only be timed on the device if the queue was created
+    // with profiling enabled, which costs a little on each command, so
+    // it's only enabled if the profiler may ask for kernel times.
+    cl_command_queue_properties queue_properties = 0;
+    const char *time_kernels = getenv("HL_PROFILER_TIME_KERNELS");
+    if (time_kernels && atoi(time_kernels) > 0) {
+        queue_properties |= CL_QUEUE_PROFILING_ENABLE;
+    }
+
     debug(user_context) << "    clCreateCommandQueue ";
-    *q = clCreateCommandQueue(*ctx, dev, 0, &err);
+    *q = clCreateCommandQueue(*ctx, dev, queue_properties, &err);
     if (err != CL_SUCCESS) {
         return error_opencl(user_context, err, "clCreateCommandQueue failed");
     }
@@ -569,6 +622,65 @@ WEAK int create_opencl_context(void *user_context, cl_context *ctx, cl_command_q
     return halide_error_code_success;
 }
 
+// Identify the binary the driver would build from some source and
+// build options for a device.
+WEAK void opencl_binary_cache_key(cl_device_id dev, const char *src, int size, const char *options,
+                                  Halide::Internal::GPUBinaryCacheKey *key) {
+    key->add(src, size);
+    key->add(options);
+    const cl_device_info infos[] = {CL_DEVICE_VENDOR, CL_DEVICE_NAME, CL_DEVICE_VERSION, CL_DRIVER_VERSION};
+    for (cl_device_info info : infos) {
+        char value[256] = {0};
+        clGetDeviceInfo(dev, info, sizeof(value) - 1, value, nullptr);
+        key->add(value);
+    }
+}
+
+WEAK cl_program load_cached_program(void *user_context, cl_context ctx, cl_device_id dev,
+                                    const char *options, const Halide::Internal::GPUBinaryCacheKey &key) {
+    size_t binary_size = 0;
+    unsigned char *binary = (unsigned char *)Halide::Internal::gpu_binary_cache_load(user_context, "opencl", key, &binary_size);
+    if (!binary) {
+        return nullptr;
+    }
+    cl_int binary_status = CL_SUCCESS, err = CL_SUCCESS;
+    const unsigned char *binaries[] = {binary};
+    debug(user_context) << "    clCreateProgramWithBinary -> ";
+    cl_program program = clCreateProgramWithBinary(ctx, 1, &dev, &binary_size, binaries, &binary_status, &err);
+    free(binary);
+    if (err == CL_SUCCESS && binary_status == CL_SUCCESS) {
+        debug(user_context) << (void *)program << "\n";
+        // Binaries still need to be built, but that's just a load.
+        err = clBuildProgram(program, 1, &dev, options, nullptr, nullptr);
+        if (err == CL_SUCCESS) {
+            return program;
+        }
+    }
+    debug(user_context) << get_opencl_error_name(err) << ", ignoring cached binary\n";
+    if (program) {
+        clReleaseProgram(program);
+    }
+    return nullptr;
+}
+
+WEAK void store_program_binary(void *user_context, cl_program program,
+                               const Halide::Internal::GPUBinaryCacheKey &key) {
+    size_t binary_size = 0;
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(binary_size), &binary_size, nullptr) != CL_SUCCESS ||
+        binary_size == 0) {
+        return;
+    }
+    unsigned char *binary = (unsigned char *)malloc(binary_size);
+    if (!binary) {
+        return;
+    }
+    unsigned char *binaries[] = {binary};
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binaries), binaries, nullptr) == CL_SUCCESS) {
+        Halide::Internal::gpu_binary_cache_store(user_context, "opencl", key, binary, binary_size);
+    }
+    free(binary);
+}
+
 WEAK cl_program compile_kernel(void *user_context, cl_context ctx, const char *src, int size) {
     cl_int err = 0;
     cl_device_id dev;
@@ -607,6 +719,19 @@ WEAK cl_program compile_kernel(void *user_context, cl_context ctx, const char *s
     const char *extra_options = halide_opencl_get_build_options(user_context);
     options << " " << extra_options;
 
+    // Reuse a binary built from the same source for the same device
+    // by an earlier process, if there is one.
+    Halide::Internal::GPUBinaryCacheKey key;
+    const char *cache_dir = halide_gpu_kernel_cache_dir(user_context);
+    const bool use_binary_cache = cache_dir && *cache_dir && clCreateProgramWithBinary && clGetProgramInfo;
+    if (use_binary_cache) {
+        opencl_binary_cache_key(dev, src, size, options.str(), &key);
+        cl_program program = load_cached_program(user_context, ctx, dev, options.str(), key);
+        if (program) {
+            return program;
+        }
+    }
+
     const char *sources[] = {src};
     debug(user_context) << "    clCreateProgramWithSource -> ";
     cl_program program = clCreateProgramWithSource(ctx, 1, &sources[0], nullptr, &err);
@@ -654,9 +779,251 @@ WEAK cl_program compile_kernel(void *user_context, cl_context ctx, const char *s
         return nullptr;
     }
 
+    if (use_binary_cache) {
+        store_program_binary(user_context, program, key);
+    }
+
     return program;
 }
 
+// Page-locked host allocations made by
+// halide_opencl_device_and_host_malloc are the mapping of a buffer
+// created with CL_MEM_ALLOC_HOST_PTR. This header sits just before the
+// host pointer handed out, and doubles as the free list entry when
+// allocations are being cached.
+struct PinnedHostHeader {
+    cl_context ctx;
+    cl_mem mem;
+    void *mapped;
+    size_t size;
+    PinnedHostHeader *next;
+};
+WEAK PinnedHostHeader *pinned_host_free_list = nullptr;
+WEAK halide_mutex pinned_host_free_list_lock;
+
+constexpr size_t pinned_host_alignment = 128;
+
+ALWAYS_INLINE PinnedHostHeader *pinned_host_header(void *host) {
+    return ((PinnedHostHeader *)host) - 1;
+}
+
+WEAK void *alloc_pinned_host(void *user_context, ClContext &ctx, size_t size) {
+    if (halide_can_reuse_device_allocations(user_context)) {
+        ScopedMutexLock lock(&pinned_host_free_list_lock);
+        PinnedHostHeader **prev_ptr = &pinned_host_free_list;
+        for (PinnedHostHeader *h = pinned_host_free_list; h; h = h->next) {
+            if (h->ctx == ctx.context && h->size == size) {
+                *prev_ptr = h->next;
+                h->next = nullptr;
+                return h + 1;
+            }
+            prev_ptr = &h->next;
+        }
+    }
+
+    const size_t alloc_size = size + sizeof(PinnedHostHeader) + pinned_host_alignment;
+    cl_int err;
+    debug(user_context) << "    clCreateBuffer (CL_MEM_ALLOC_HOST_PTR) -> " << (uint64_t)alloc_size << "\n";
+    cl_mem mem = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, alloc_size, nullptr, &err);
+    if (err != CL_SUCCESS || mem == nullptr) {
+        debug(user_context) << "    clCreateBuffer failed (" << get_opencl_error_name(err) << ")\n";
+        return nullptr;
+    }
+    void *mapped = clEnqueueMapBuffer(ctx.cmd_queue, mem, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                                      0, alloc_size, 0, nullptr, nullptr, &err);
+    if (err != CL_SUCCESS || mapped == nullptr) {
+        debug(user_context) << "    clEnqueueMapBuffer failed (" << get_opencl_error_name(err) << ")\n";
+        clReleaseMemObject(mem);
+        return nullptr;
+    }
+
+    uint8_t *host = (uint8_t *)align_up((uintptr_t)mapped + sizeof(PinnedHostHeader), pinned_host_alignment);
+    PinnedHostHeader *h = pinned_host_header(host);
+    h->ctx = ctx.context;
+    h->mem = mem;
+    h->mapped = mapped;
+    h->size = size;
+    h->next = nullptr;
+    return host;
+}
+
+// Release a page-locked allocation. q must belong to h->ctx, or be
+// null, in which case the buffer is released while still mapped.
+WEAK void release_pinned_host(void *user_context, PinnedHostHeader *h, cl_command_queue q) {
+    // The header lives inside the mapping, so read it out first.
+    cl_mem mem = h->mem;
+    void *mapped = h->mapped;
+    debug(user_context) << "    clReleaseMemObject (page-locked host) " << (void *)mem << "\n";
+    if (q) {
+        clEnqueueUnmapMemObject(q, mem, mapped, 0, nullptr, nullptr);
+    }
+    clReleaseMemObject(mem);
+}
+
+WEAK void free_pinned_host(void *user_context, void *host, cl_command_queue q) {
+    PinnedHostHeader *h = pinned_host_header(host);
+    if (halide_can_reuse_device_allocations(user_context)) {
+        debug(user_context) << "    caching page-locked allocation for later use: " << host << "\n";
+        ScopedMutexLock lock(&pinned_host_free_list_lock);
+        h->next = pinned_host_free_list;
+        pinned_host_free_list = h;
+    } else {
+        release_pinned_host(user_context, h, q);
+    }
+}
+
+// Release the cached page-locked allocations belonging to ctx, or all
+// of them if all is set. Allocations belonging to ctx are unmapped
+// with q first.
+WEAK void release_cached_pinned_host(void *user_context, cl_context ctx, cl_command_queue q, bool all) {
+    PinnedHostHeader *to_free = nullptr;
+    {
+        ScopedMutexLock lock(&pinned_host_free_list_lock);
+        PinnedHostHeader **prev_ptr = &pinned_host_free_list;
+        while (*prev_ptr) {
+            PinnedHostHeader *h = *prev_ptr;
+            if (all || h->ctx == ctx) {
+                *prev_ptr = h->next;
+                h->next = to_free;
+                to_free = h;
+            } else {
+                prev_ptr = &h->next;
+            }
+        }
+    }
+    while (to_free) {
+        PinnedHostHeader *next = to_free->next;
+        release_pinned_host(user_context, to_free, (ctx && to_free->ctx == ctx) ? q : nullptr);
+        to_free = next;
+    }
+}
+
+// On devices that share memory with the host, buffers made by
+// halide_opencl_device_and_host_malloc wrap their host allocation with
+// CL_MEM_USE_HOST_PTR, so copies between the two become a map and
+// unmap, which only does cache maintenance. Drivers only avoid keeping
+// a shadow copy of suitably aligned memory; Intel requires it to be
+// 4096 byte aligned, in a multiple of 64 bytes.
+constexpr size_t zero_copy_alignment = 4096;
+constexpr size_t zero_copy_size_multiple = 64;
+
+WEAK cl_context zero_copy_checked_context = nullptr;
+WEAK bool zero_copy_supported = false;
+
+// Zero-copy buffers are used if the device reports unified memory and
+// supports CL_MAP_WRITE_INVALIDATE_REGION (OpenCL 1.2), unless the
+// environment variable HL_OPENCL_ZERO_COPY is set to 0. Must be called
+// with the context held.
+WEAK bool can_use_zero_copy(void *user_context, cl_context ctx) {
+    if (ctx == zero_copy_checked_context) {
+        return zero_copy_supported;
+    }
+    zero_copy_checked_context = ctx;
+    zero_copy_supported = false;
+
+    const char *env = getenv("HL_OPENCL_ZERO_COPY");
+    if (env && env[0] == '0') {
+        return false;
+    }
+    cl_device_id device;
+    cl_bool unified = CL_FALSE;
+    char device_version[256] = "";
+    if (clGetContextInfo(ctx, CL_CONTEXT_DEVICES, sizeof(device), &device, nullptr) != CL_SUCCESS ||
+        clGetDeviceInfo(device, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, nullptr) != CL_SUCCESS ||
+        clGetDeviceInfo(device, CL_DEVICE_VERSION, sizeof(device_version), device_version, nullptr) != CL_SUCCESS ||
+        strlen(device_version) < 10) {
+        return false;
+    }
+    // This should always be of the format "OpenCL X.Y" per the spec
+    int major = device_version[7] - '0';
+    int minor = device_version[9] - '0';
+    zero_copy_supported = (unified == CL_TRUE) && (major > 1 || (major == 1 && minor >= 2));
+    debug(user_context) << "    zero-copy host buffers " << (zero_copy_supported ? "enabled" : "disabled") << "\n";
+    return zero_copy_supported;
+}
+
+WEAK void free_zero_copy_host(void *host) {
+    // The original allocation is stashed just before the aligned one.
+    free(((void **)host)[-1]);
+}
+
+// Allocates both the host and device side of buf as one zero-copy buffer.
+WEAK int alloc_zero_copy(void *user_context, ClContext &ctx, halide_buffer_t *buf) {
+    size_t size = buf->size_in_bytes();
+    for (int i = 0; i < buf->dimensions; i++) {
+        if (buf->dim[i].stride < 0) {
+            return halide_error_code_device_malloc_failed;
+        }
+    }
+    if (size == 0) {
+        return halide_error_code_device_malloc_failed;
+    }
+    size = align_up(size, zero_copy_size_multiple);
+
+    device_handle *dev_handle = (device_handle *)malloc(sizeof(device_handle));
+    void *original = malloc(size + zero_copy_alignment + sizeof(void *));
+    if (dev_handle == nullptr || original == nullptr) {
+        free(dev_handle);
+        free(original);
+        return halide_error_code_out_of_memory;
+    }
+    void *host = (void *)align_up((uintptr_t)original + sizeof(void *), zero_copy_alignment);
+    ((void **)host)[-1] = original;
+
+    cl_int err;
+    debug(user_context) << "    clCreateBuffer (CL_MEM_USE_HOST_PTR) -> " << (uint64_t)size << " ";
+    cl_mem mem = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, size, host, &err);
+    if (err != CL_SUCCESS || mem == nullptr) {
+        debug(user_context) << "failed (" << get_opencl_error_name(err) << ")\n";
+        free(dev_handle);
+        free_zero_copy_host(host);
+        return halide_error_code_device_malloc_failed;
+    }
+    debug(user_context) << (void *)mem << " device_handle: " << dev_handle << "\n";
+
+    dev_handle->mem = mem;
+    dev_handle->offset = 0;
+    dev_handle->allocation = nullptr;
+    buf->host = (uint8_t *)host;
+    buf->device = (uint64_t)dev_handle;
+    buf->device_interface = &opencl_device_interface;
+    buf->device_interface->impl->use_module();
+    return halide_error_code_success;
+}
+
+// Returns true if the device allocation of buf wraps its host allocation.
+WEAK bool is_zero_copy(const halide_buffer_t *buf) {
+    if (buf->device == 0 || buf->host == nullptr || buf->device_interface != &opencl_device_interface) {
+        return false;
+    }
+    device_handle *handle = (device_handle *)buf->device;
+    cl_mem_flags flags = 0;
+    void *host_ptr = nullptr;
+    return handle->allocation == nullptr &&
+           clGetMemObjectInfo(handle->mem, CL_MEM_FLAGS, sizeof(flags), &flags, nullptr) == CL_SUCCESS &&
+           (flags & CL_MEM_USE_HOST_PTR) &&
+           clGetMemObjectInfo(handle->mem, CL_MEM_HOST_PTR, sizeof(host_ptr), &host_ptr, nullptr) == CL_SUCCESS &&
+           (uint8_t *)host_ptr + handle->offset == buf->host;
+}
+
+// Makes the host's view of a zero-copy buffer coherent with the
+// device's, or vice versa, by mapping and unmapping it.
+WEAK int sync_zero_copy(void *user_context, ClContext &ctx, const halide_buffer_t *buf, bool to_host) {
+    device_handle *handle = (device_handle *)buf->device;
+    cl_int err;
+    void *mapped = clEnqueueMapBuffer(ctx.cmd_queue, handle->mem, CL_TRUE,
+                                      to_host ? CL_MAP_READ : CL_MAP_WRITE_INVALIDATE_REGION,
+                                      handle->offset, buf->size_in_bytes(), 0, nullptr, nullptr, &err);
+    if (err != CL_SUCCESS) {
+        return error_opencl(user_context, err, "clEnqueueMapBuffer failed");
+    }
+    err = clEnqueueUnmapMemObject(ctx.cmd_queue, handle->mem, mapped, 0, nullptr, nullptr);
+    if (err != CL_SUCCESS) {
+        return error_opencl(user_context, err, "clEnqueueUnmapMemObject failed");
+    }
+    return halide_error_code_success;
+}
+
 }  // namespace OpenCL
 }  // namespace Internal
 }  // namespace Runtime
@@ -673,7 +1040,8 @@ WEAK int halide_opencl_device_free(void *user_context, halide_buffer_t *buf) {
     }
 
     cl_mem dev_ptr = ((device_handle *)buf->device)->mem;
-    halide_abort_if_false(user_context, (((device_handle *)buf->device)->offset == 0) && "halide_opencl_device_free on buffer obtained from halide_device_crop");
+    GPUMemoryAllocation *allocation = ((device_handle *)buf->device)->allocation;
+    halide_abort_if_false(user_context, (((device_handle *)buf->device)->offset == 0 || allocation != nullptr) && "halide_opencl_device_free on buffer obtained from halide_device_crop");
 
     debug(user_context)
         << "CL: halide_opencl_device_free (user_context: " << user_context
@@ -692,10 +1060,18 @@ WEAK int halide_opencl_device_free(void *user_context, halide_buffer_t *buf) {
     if (result) {
         return result;
     }
-    debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
-    cl_int err = clReleaseMemObject((cl_mem)dev_ptr);
-    // If clReleaseMemObject fails, it is unlikely to succeed in a later call, so
-    // we just end our reference to it regardless.
+    cl_int err = CL_SUCCESS;
+    if (allocation != nullptr) {
+        debug(user_context) << "    releasing suballocation at offset " << (uint64_t)allocation->offset
+                            << " of block " << (void *)dev_ptr << "\n";
+        result = gpu_memory_release(user_context, &opencl_memory_pool, allocation,
+                                    halide_can_reuse_device_allocations(user_context));
+    } else {
+        debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
+        err = clReleaseMemObject((cl_mem)dev_ptr);
+        // If clReleaseMemObject fails, it is unlikely to succeed in a later call, so
+        // we just end our reference to it regardless.
+    }
     free((device_handle *)buf->device);
     buf->device = 0;
     buf->device_interface->impl->release_module();
@@ -703,6 +1079,9 @@ WEAK int halide_opencl_device_free(void *user_context, halide_buffer_t *buf) {
     if (err != CL_SUCCESS) {
         return error_opencl(user_context, err);
     }
+    if (result) {
+        return result;
+    }
 
 #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
@@ -846,6 +1225,12 @@ WEAK int halide_opencl_device_release(void *user_context) {
 
         compilation_cache.delete_context(user_context, ctx, clReleaseProgram);
 
+        release_cached_pinned_host(user_context, ctx, q, false);
+
+        // Anything still suballocated in this context is about to
+        // become invalid anyway.
+        (void)gpu_memory_release_context(user_context, &opencl_memory_pool, ctx);
+
         // Release the context itself, if we created it.
         if (ctx == context) {
             debug(user_context) << "    clReleaseCommandQueue " << command_queue << "\n";
@@ -897,21 +1282,47 @@ WEAK int halide_opencl_device_malloc(void *user_context, halide_buffer_t *buf) {
     if (dev_handle == nullptr) {
         return halide_error_code_out_of_memory;
     }
-
-    cl_int err;
-    debug(user_context) << "    clCreateBuffer -> " << (int)size << " ";
-    cl_mem dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, nullptr, &err);
-    if (err != CL_SUCCESS || dev_ptr == nullptr) {
-        free(dev_handle);
-        if (err == CL_SUCCESS) {
-            err = CL_OUT_OF_RESOURCES;
+    dev_handle->allocation = nullptr;
+
+    if (halide_can_use_device_suballocation(user_context)) {
+        size_t alignment = suballocation_alignment(user_context, ctx.context);
+        GPUMemoryAllocation *allocation =
+            gpu_memory_reserve(user_context, &opencl_memory_pool, ctx.context, nullptr, alignment, size);
+        if (allocation == nullptr) {
+            // Free any empty blocks and try again before falling back
+            // to a dedicated buffer.
+            (void)gpu_memory_release_unused(user_context, &opencl_memory_pool);
+            allocation = gpu_memory_reserve(user_context, &opencl_memory_pool, ctx.context, nullptr, alignment, size);
+        }
+        if (allocation != nullptr) {
+            if (allocation->reused_block) {
+                device_profiler_event(user_context, DeviceProfilerPoolHit, 0, size);
+            }
+            debug(user_context) << "    suballocated offset " << (uint64_t)allocation->offset
+                                << " of block " << allocation->block_handle
+                                << " device_handle: " << dev_handle << "\n";
+            dev_handle->mem = (cl_mem)allocation->block_handle;
+            dev_handle->offset = allocation->offset;
+            dev_handle->allocation = allocation;
         }
-        return error_opencl(user_context, err, "clCreateBuffer failed: ");
     }
-    debug(user_context) << (void *)dev_ptr << " device_handle: " << dev_handle << "\n";
 
-    dev_handle->mem = dev_ptr;
-    dev_handle->offset = 0;
+    if (dev_handle->allocation == nullptr) {
+        cl_int err;
+        debug(user_context) << "    clCreateBuffer -> " << (int)size << " ";
+        cl_mem dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, nullptr, &err);
+        if (err != CL_SUCCESS || dev_ptr == nullptr) {
+            free(dev_handle);
+            if (err == CL_SUCCESS) {
+                err = CL_OUT_OF_RESOURCES;
+            }
+            return error_opencl(user_context, err, "clCreateBuffer failed: ");
+        }
+        debug(user_context) << (void *)dev_ptr << " device_handle: " << dev_handle << "\n";
+
+        dev_handle->mem = dev_ptr;
+        dev_handle->offset = 0;
+    }
     buf->device = (uint64_t)dev_handle;
     buf->device_interface = &opencl_device_interface;
     buf->device_interface->impl->use_module();
@@ -938,9 +1349,59 @@ WEAK int opencl_do_multidimensional_copy(void *user_context, ClContext &ctx,
                                          const device_copy &c,
                                          int64_t src_idx, int64_t dst_idx,
                                          int d, bool from_host, bool to_host) {
+    device_copy_rect rect;
     if (d > MAX_COPY_DIMS) {
         error(user_context) << "Buffer has too many dimensions to copy to/from GPU";
         return halide_error_code_bad_dimensions;
+    } else if (!(from_host && to_host) &&
+               (to_host ? clEnqueueReadBufferRect != nullptr :
+                from_host ? clEnqueueWriteBufferRect != nullptr :
+                            clEnqueueCopyBufferRect != nullptr) &&
+               make_device_copy_rect(c, d, &rect)) {
+        // Do the innermost one or two dimensions with a single
+        // rectangular copy (OpenCL 1.1), rather than one copy per
+        // contiguous chunk.
+        size_t region[3] = {(size_t)rect.width, (size_t)rect.height, (size_t)rect.depth};
+        size_t src_slice_pitch = rect.src_pitch * rect.src_rows;
+        size_t dst_slice_pitch = rect.dst_pitch * rect.dst_rows;
+        // Express the byte offsets as origins within the rectangles.
+        const auto to_origin = [](uint64_t offset, size_t row_pitch, size_t slice_pitch, size_t *origin) {
+            origin[2] = offset / slice_pitch;
+            origin[1] = (offset % slice_pitch) / row_pitch;
+            origin[0] = offset % row_pitch;
+        };
+        size_t src_origin[3], dst_origin[3];
+        debug(user_context) << "    from " << (from_host ? "host" : "device")
+                            << " to " << (to_host ? "host" : "device") << ", "
+                            << (void *)c.src << " + " << src_idx
+                            << " -> " << (void *)c.dst << " + " << dst_idx
+                            << ", " << rect.width << "x" << rect.height << "x" << rect.depth << " bytes\n";
+        cl_int err;
+        if (to_host) {
+            to_origin(src_idx + ((device_handle *)c.src)->offset, rect.src_pitch, src_slice_pitch, src_origin);
+            to_origin(dst_idx, rect.dst_pitch, dst_slice_pitch, dst_origin);
+            err = clEnqueueReadBufferRect(ctx.cmd_queue, ((device_handle *)c.src)->mem, CL_FALSE,
+                                          src_origin, dst_origin, region,
+                                          rect.src_pitch, src_slice_pitch, rect.dst_pitch, dst_slice_pitch,
+                                          (void *)c.dst, 0, nullptr, nullptr);
+        } else if (from_host) {
+            to_origin(src_idx, rect.src_pitch, src_slice_pitch, src_origin);
+            to_origin(dst_idx + ((device_handle *)c.dst)->offset, rect.dst_pitch, dst_slice_pitch, dst_origin);
+            err = clEnqueueWriteBufferRect(ctx.cmd_queue, ((device_handle *)c.dst)->mem, CL_FALSE,
+                                           dst_origin, src_origin, region,
+                                           rect.dst_pitch, dst_slice_pitch, rect.src_pitch, src_slice_pitch,
+                                           (const void *)c.src, 0, nullptr, nullptr);
+        } else {
+            to_origin(src_idx + ((device_handle *)c.src)->offset, rect.src_pitch, src_slice_pitch, src_origin);
+            to_origin(dst_idx + ((device_handle *)c.dst)->offset, rect.dst_pitch, dst_slice_pitch, dst_origin);
+            err = clEnqueueCopyBufferRect(ctx.cmd_queue, ((device_handle *)c.src)->mem, ((device_handle *)c.dst)->mem,
+                                          src_origin, dst_origin, region,
+                                          rect.src_pitch, src_slice_pitch, rect.dst_pitch, dst_slice_pitch,
+                                          0, nullptr, nullptr);
+        }
+        if (err) {
+            return error_opencl(user_context, err, "rectangular buffer copy failed");
+        }
     } else if (d == 0) {
         cl_int err = 0;
 
@@ -1038,7 +1499,13 @@ WEAK int halide_opencl_buffer_copy(void *user_context, struct halide_buffer_t *s
         }
 #endif
 
-        auto result = opencl_do_multidimensional_copy(user_context, ctx, c, c.src_begin, 0, dst->dimensions, from_host, to_host);
+        int result;
+        if (src == dst && from_host != to_host && is_zero_copy(src)) {
+            debug(user_context) << "    zero-copy buffer, synchronizing in place\n";
+            result = sync_zero_copy(user_context, ctx, src, to_host);
+        } else {
+            result = opencl_do_multidimensional_copy(user_context, ctx, c, c.src_begin, 0, dst->dimensions, from_host, to_host);
+        }
         if (result) {
             return result;
         }
@@ -1077,6 +1544,8 @@ WEAK int halide_opencl_run(void *user_context,
                            size_t arg_sizes[],
                            void *args[],
                            int8_t arg_is_buffer[]) {
+    ScopedTimelineSpan span(TimelineKernel, entry_name);
+
     debug(user_context)
         << "CL: halide_opencl_run (user_context: " << user_context << ", "
         << "entry: " << entry_name << ", "
@@ -1190,11 +1659,14 @@ WEAK int halide_opencl_run(void *user_context,
         << "    clEnqueueNDRangeKernel "
         << blocksX << "x" << blocksY << "x" << blocksZ << ", "
         << threadsX << "x" << threadsY << "x" << threadsZ << " -> ";
+    // If the profiler asked for kernel times, get an event to read the
+    // device timestamps of the kernel from.
+    cl_event timing_event = nullptr;
     err = clEnqueueNDRangeKernel(ctx.cmd_queue, f,
                                  // NDRange
                                  3, nullptr, global_dim, local_dim,
                                  // Events
-                                 0, nullptr, nullptr);
+                                 0, nullptr, should_time_device_kernels() ? &timing_event : nullptr);
     debug(user_context) << get_opencl_error_name(err) << "\n";
 
     // Now that the kernel is enqueued, OpenCL is holding its own
@@ -1208,6 +1680,17 @@ WEAK int halide_opencl_run(void *user_context,
         return error_opencl(user_context, err, "clEnqueueNDRangeKernel failed");
     }
 
+    if (timing_event) {
+        cl_ulong start = 0, end = 0;
+        if (clWaitForEvents(1, &timing_event) == CL_SUCCESS &&
+            clGetEventProfilingInfo(timing_event, CL_PROFILING_COMMAND_START, sizeof(start), &start, nullptr) == CL_SUCCESS &&
+            clGetEventProfilingInfo(timing_event, CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr) == CL_SUCCESS &&
+            end >= start) {
+            device_profiler_event(user_context, DeviceProfilerKernel, 0, 0, end - start);
+        }
+        clReleaseEvent(timing_event);
+    }
+
     debug(user_context) << "    Releasing kernel " << (void *)f << "\n";
     clReleaseKernel(f);
     debug(user_context) << "    clReleaseKernel finished" << (void *)f << "\n";
@@ -1224,13 +1707,122 @@ WEAK int halide_opencl_run(void *user_context,
 }
 
 WEAK int halide_opencl_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_malloc(user_context, buf, &opencl_device_interface);
+    if (!buf->pinned_host() && !halide_can_use_pinned_host_allocations(user_context)) {
+        {
+            ClContext ctx(user_context);
+            if (ctx.error()) {
+                return ctx.error();
+            }
+            if (can_use_zero_copy(user_context, ctx.context) &&
+                alloc_zero_copy(user_context, ctx, buf) == halide_error_code_success) {
+                return halide_error_code_success;
+            }
+        }
+        return halide_default_device_and_host_malloc(user_context, buf, &opencl_device_interface);
+    }
+
+    debug(user_context)
+        << "CL: halide_opencl_device_and_host_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    void *host = nullptr;
+    {
+        ClContext ctx(user_context);
+        if (ctx.error()) {
+            return ctx.error();
+        }
+        host = alloc_pinned_host(user_context, ctx, buf->size_in_bytes());
+    }
+
+    if (!host) {
+        debug(user_context) << "    using pageable memory instead\n";
+        return halide_default_device_and_host_malloc(user_context, buf, &opencl_device_interface);
+    }
+
+    buf->host = (uint8_t *)host;
+    buf->set_pinned_host(true);
+    auto result = halide_device_malloc(user_context, buf, &opencl_device_interface);
+    if (result) {
+        ClContext ctx(user_context);
+        free_pinned_host(user_context, host, ctx.error() ? nullptr : ctx.cmd_queue);
+        buf->host = nullptr;
+        buf->set_pinned_host(false);
+    }
+    return result;
 }
 
 WEAK int halide_opencl_device_and_host_free(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_free(user_context, buf, &opencl_device_interface);
+    if (is_zero_copy(buf)) {
+        void *host = buf->host;
+        auto result = halide_device_free(user_context, buf);
+        free_zero_copy_host(host);
+        buf->host = nullptr;
+        buf->set_host_dirty(false);
+        buf->set_device_dirty(false);
+        return result;
+    }
+    if (!buf->pinned_host()) {
+        return halide_default_device_and_host_free(user_context, buf, &opencl_device_interface);
+    }
+
+    debug(user_context)
+        << "CL: halide_opencl_device_and_host_free (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    auto result = halide_device_free(user_context, buf);
+    if (buf->host) {
+        ClContext ctx(user_context);
+        // The allocation may belong to another context than the
+        // current one, in which case it can't be unmapped with our
+        // queue.
+        bool own = !ctx.error() && pinned_host_header(buf->host)->ctx == ctx.context;
+        free_pinned_host(user_context, buf->host, own ? ctx.cmd_queue : nullptr);
+        buf->host = nullptr;
+    }
+    buf->set_pinned_host(false);
+    buf->set_host_dirty(false);
+    buf->set_device_dirty(false);
+    return result;
+}
+
+WEAK int halide_opencl_release_unused_device_allocations(void *user_context) {
+    cl_context ctx = nullptr;
+    cl_command_queue q = nullptr;
+    if (clCreateContext != nullptr) {
+        auto result = halide_acquire_cl_context(user_context, &ctx, &q, false);
+        if (result) {
+            return result;
+        }
+        release_cached_pinned_host(user_context, ctx, q, true);
+        (void)gpu_memory_release_unused(user_context, &opencl_memory_pool);
+        return halide_release_cl_context(user_context);
+    }
+    release_cached_pinned_host(user_context, nullptr, nullptr, true);
+    return gpu_memory_release_unused(user_context, &opencl_memory_pool);
+}
+
+WEAK int halide_opencl_get_device_memory_stats(void *user_context, struct halide_device_memory_stats_t *stats) {
+    gpu_memory_get_stats(&opencl_memory_pool, stats);
+    return halide_error_code_success;
+}
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace OpenCL {
+
+WEAK halide_device_allocation_pool opencl_allocation_pool;
+
+WEAK __attribute__((constructor)) void register_opencl_allocation_pool() {
+    opencl_allocation_pool.release_unused = &halide_opencl_release_unused_device_allocations;
+    halide_register_device_allocation_pool(&opencl_allocation_pool);
 }
 
+}  // namespace OpenCL
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
 WEAK int halide_opencl_wrap_cl_mem(void *user_context, struct halide_buffer_t *buf, uint64_t mem) {
     halide_abort_if_false(user_context, buf->device == 0);
     if (buf->device != 0) {
@@ -1243,6 +1835,7 @@ WEAK int halide_opencl_wrap_cl_mem(void *user_context, struct halide_buffer_t *b
     }
     dev_handle->mem = (cl_mem)mem;
     dev_handle->offset = 0;
+    dev_handle->allocation = nullptr;
     buf->device = (uint64_t)dev_handle;
     buf->device_interface = &opencl_device_interface;
     buf->device_interface->impl->use_module();
@@ -1311,6 +1904,7 @@ WEAK int opencl_device_crop_from_offset(void *user_context,
     clRetainMemObject(((device_handle *)src->device)->mem);
     new_dev_handle->mem = ((device_handle *)src->device)->mem;
     new_dev_handle->offset = ((device_handle *)src->device)->offset + offset;
+    new_dev_handle->allocation = nullptr;
     dst->device = (uint64_t)new_dev_handle;
 
     return halide_error_code_success;
@@ -1681,6 +2275,7 @@ WEAK int halide_opencl_image_device_malloc(void *user_context, halide_buffer_t *
 
     dev_handle->mem = dev_ptr;
     dev_handle->offset = 0;
+    dev_handle->allocation = nullptr;
     buf->device = (uint64_t)dev_handle;
     buf->device_interface = &opencl_image_device_interface;
     buf->device_interface->impl->use_module();
@@ -1867,6 +2462,7 @@ WEAK int halide_opencl_image_wrap_cl_mem(void *user_context, struct halide_buffe
 
     dev_handle->mem = (cl_mem)mem;
     dev_handle->offset = 0;
+    dev_handle->allocation = nullptr;
     buf->device = (uint64_t)dev_handle;
     buf->device_interface = &opencl_image_device_interface;
     buf->device_interface->impl->use_module();
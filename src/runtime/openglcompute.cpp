@@ -3,6 +3,7 @@
 #include "device_interface.h"
 #include "mini_opengl.h"
 #include "printer.h"
+#include "timeline.h"
 
 // Implementation note: all function that directly or indirectly access the
 // runtime state in halide_openglcompute_state must be declared as WEAK, otherwise
@@ -604,6 +605,8 @@ WEAK int halide_openglcompute_run(void *user_context, void *state_ptr,
                                   int blocksZ, int threadsX, int threadsY, int threadsZ,
                                   int shared_mem_bytes, halide_type_t arg_types[], void *args[],
                                   int8_t arg_is_buffer[]) {
+    ScopedTimelineSpan span(TimelineKernel, entry_name);
+
 #ifdef DEBUG_RUNTIME
     uint64_t t_before = halide_current_time_ns(user_context);
 #endif
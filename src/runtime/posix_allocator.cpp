@@ -1,19 +1,257 @@
 #include "HalideRuntime.h"
+#include "runtime_atomics.h"
 #include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
 
 extern "C" {
 
 extern void *malloc(size_t);
 extern void free(void *);
+}
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// An optional pool for halide_default_malloc, enabled with
+// halide_reuse_host_allocations. Sizes are rounded up to one of four
+// classes per power of two, and freed blocks are kept on a free list
+// per class, up to a cap on the total bytes retained. There are
+// several sets of free lists, each with its own lock, and a thread
+// uses the set picked by its stack address, so threads rarely
+// contend for one.
+//
+// A pooled block is preceded by one alignment unit holding its size
+// class, the last word of which is kPooledBlockTag. An unpooled block
+// has the pointer returned by malloc there instead, so
+// halide_default_free can tell them apart. Blocks placed by
+// halide_set_host_memory_policy are mapped directly, and preceded by
+// the start and length of their mapping, and kMappedBlockTag.
+struct PooledBlock {
+    PooledBlock *next;
+};
+
+const int kMinPooledSizeLog2 = 6;
+const int kMaxPooledSizeLog2 = 26;
+const int kNumSizeClasses = (kMaxPooledSizeLog2 - kMinPooledSizeLog2) * 4 + 1;
+const int kNumHostCaches = 16;
+const int64_t kDefaultMaxRetainedBytes = 64 * 1024 * 1024;
+void *const kPooledBlockTag = (void *)1;
+void *const kMappedBlockTag = (void *)2;
+const size_t kDefaultMinPlacedBytes = 16 * 1024 * 1024;
+
+struct HostCache {
+    halide_mutex lock;
+    PooledBlock *free_lists[kNumSizeClasses];
+};
+
+WEAK HostCache host_caches[kNumHostCaches];
+
+WEAK bool halide_reuse_host_allocations_flag = false;
+WEAK int64_t max_retained_host_bytes = kDefaultMaxRetainedBytes;
+WEAK int64_t retained_host_bytes = 0;
+WEAK halide_host_allocation_pool_stats_t host_pool_stats = {};
+
+WEAK int host_memory_policy = halide_host_memory_policy_default;
+WEAK size_t min_placed_host_bytes = kDefaultMinPlacedBytes;
+
+// Returns the size class for a size of at most 1 << kMaxPooledSizeLog2.
+ALWAYS_INLINE int size_class(size_t size) {
+    if (size <= ((size_t)1 << kMinPooledSizeLog2)) {
+        return 0;
+    }
+    int b = 63 - __builtin_clzll((uint64_t)(size - 1));
+    int sub = ((size - 1) >> (b - 2)) & 3;
+    return (b - kMinPooledSizeLog2) * 4 + sub + 1;
+}
+
+ALWAYS_INLINE size_t size_class_bytes(int c) {
+    if (c == 0) {
+        return (size_t)1 << kMinPooledSizeLog2;
+    }
+    int b = (c - 1) / 4 + kMinPooledSizeLog2;
+    int sub = (c - 1) % 4;
+    return (size_t)(4 + sub + 1) << (b - 2);
+}
+
+ALWAYS_INLINE HostCache &host_cache_for_this_thread() {
+    int marker;
+    uintptr_t sp = (uintptr_t)&marker;
+    return host_caches[((sp >> 16) * 0x9e3779b1u >> 16) % kNumHostCaches];
+}
+
+ALWAYS_INLINE void count_host_pool_stat(uint64_t *stat, uint64_t n = 1) {
+    Synchronization::atomic_fetch_add_sequentially_consistent(stat, n);
+}
+
+WEAK void *pooled_malloc(size_t x) {
+    const size_t alignment = ::halide_internal_malloc_alignment();
+    int c = size_class(x);
+    count_host_pool_stat(&host_pool_stats.mallocs);
+
+    HostCache &cache = host_cache_for_this_thread();
+    PooledBlock *block = nullptr;
+    {
+        ScopedMutexLock lock(&cache.lock);
+        block = cache.free_lists[c];
+        if (block) {
+            cache.free_lists[c] = block->next;
+        }
+    }
+    if (block) {
+        Synchronization::atomic_fetch_sub_sequentially_consistent(&retained_host_bytes, (int64_t)size_class_bytes(c));
+        count_host_pool_stat(&host_pool_stats.reused);
+        return block;
+    }
+
+    uint8_t *header = (uint8_t *)::halide_internal_aligned_alloc(alignment, size_class_bytes(c) + alignment);
+    if (header == nullptr) {
+        return nullptr;
+    }
+    *(int *)header = c;
+    uint8_t *ptr = header + alignment;
+    ((void **)ptr)[-1] = kPooledBlockTag;
+    return ptr;
+}
+
+WEAK void pooled_free(void *ptr) {
+    const size_t alignment = ::halide_internal_malloc_alignment();
+    uint8_t *header = (uint8_t *)ptr - alignment;
+    int c = *(int *)header;
+    int64_t bytes = size_class_bytes(c);
+    count_host_pool_stat(&host_pool_stats.frees);
+
+    int64_t max_retained;
+    Synchronization::atomic_load_relaxed(&max_retained_host_bytes, &max_retained);
+    if (halide_reuse_host_allocations_flag &&
+        Synchronization::atomic_add_fetch_sequentially_consistent(&retained_host_bytes, bytes) <= max_retained) {
+        HostCache &cache = host_cache_for_this_thread();
+        ScopedMutexLock lock(&cache.lock);
+        PooledBlock *block = (PooledBlock *)ptr;
+        block->next = cache.free_lists[c];
+        cache.free_lists[c] = block;
+        return;
+    }
+    if (halide_reuse_host_allocations_flag) {
+        Synchronization::atomic_fetch_sub_sequentially_consistent(&retained_host_bytes, bytes);
+    }
+    count_host_pool_stat(&host_pool_stats.released);
+    ::halide_internal_aligned_free(header);
+}
+
+// Allocate a block from pages mapped according to the current host
+// memory policy. Returns nullptr if they can't be mapped.
+WEAK void *mapped_malloc(size_t x, int policy) {
+    const size_t alignment = ::halide_internal_malloc_alignment();
+    size_t size = align_up(x, alignment) + alignment;
+    uint8_t *region = (uint8_t *)::halide_internal_map_host_pages(&size, policy);
+    if (region == nullptr) {
+        return nullptr;
+    }
+    ((void **)region)[0] = region;
+    ((size_t *)region)[1] = size;
+    uint8_t *ptr = region + alignment;
+    ((void **)ptr)[-1] = kMappedBlockTag;
+    return ptr;
+}
+
+WEAK void mapped_free(void *ptr) {
+    const size_t alignment = ::halide_internal_malloc_alignment();
+    uint8_t *region = (uint8_t *)ptr - alignment;
+    ::halide_internal_unmap_host_pages(((void **)region)[0], ((size_t *)region)[1]);
+}
+
+// Free every block on the free lists.
+WEAK void release_host_allocations() {
+    const size_t alignment = ::halide_internal_malloc_alignment();
+    for (HostCache &cache : host_caches) {
+        ScopedMutexLock lock(&cache.lock);
+        for (int c = 0; c < kNumSizeClasses; c++) {
+            while (PooledBlock *block = cache.free_lists[c]) {
+                cache.free_lists[c] = block->next;
+                Synchronization::atomic_fetch_sub_sequentially_consistent(&retained_host_bytes, (int64_t)size_class_bytes(c));
+                count_host_pool_stat(&host_pool_stats.released);
+                ::halide_internal_aligned_free((uint8_t *)block - alignment);
+            }
+        }
+    }
+}
+
+WEAK __attribute__((destructor)) void halide_host_allocation_pool_cleanup() {
+    release_host_allocations();
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+extern "C" {
 
 WEAK void *halide_default_malloc(void *user_context, size_t x) {
+    int policy;
+    Synchronization::atomic_load_relaxed(&host_memory_policy, &policy);
+    if (policy != halide_host_memory_policy_default) {
+        size_t min_size;
+        Synchronization::atomic_load_relaxed(&min_placed_host_bytes, &min_size);
+        if (x >= min_size) {
+            void *ptr = mapped_malloc(x, policy);
+            if (ptr) {
+                return ptr;
+            }
+        }
+    }
+    if (halide_reuse_host_allocations_flag && x <= ((size_t)1 << kMaxPooledSizeLog2)) {
+        return pooled_malloc(x);
+    }
     const size_t alignment = ::halide_internal_malloc_alignment();
     return ::halide_internal_aligned_alloc(alignment, x);
 }
 
 WEAK void halide_default_free(void *user_context, void *ptr) {
+    if (((void **)ptr)[-1] == kPooledBlockTag) {
+        pooled_free(ptr);
+        return;
+    }
+    if (((void **)ptr)[-1] == kMappedBlockTag) {
+        mapped_free(ptr);
+        return;
+    }
     ::halide_internal_aligned_free(ptr);
 }
+
+WEAK int halide_reuse_host_allocations(void *user_context, bool flag) {
+    halide_reuse_host_allocations_flag = flag;
+    if (!flag) {
+        release_host_allocations();
+    }
+    return halide_error_code_success;
+}
+
+WEAK void halide_host_allocation_pool_set_size(int64_t size) {
+    if (size == 0) {
+        size = kDefaultMaxRetainedBytes;
+    }
+    Synchronization::atomic_store_sequentially_consistent(&max_retained_host_bytes, &size);
+}
+
+WEAK int halide_set_host_memory_policy(int policy, size_t min_size) {
+    if (min_size == 0) {
+        min_size = kDefaultMinPlacedBytes;
+    }
+    Synchronization::atomic_store_sequentially_consistent(&min_placed_host_bytes, &min_size);
+    Synchronization::atomic_store_sequentially_consistent(&host_memory_policy, &policy);
+    return halide_error_code_success;
+}
+
+WEAK int halide_host_allocation_pool_get_stats(halide_host_allocation_pool_stats_t *stats) {
+    Synchronization::atomic_load_relaxed(&host_pool_stats.mallocs, &stats->mallocs);
+    Synchronization::atomic_load_relaxed(&host_pool_stats.reused, &stats->reused);
+    Synchronization::atomic_load_relaxed(&host_pool_stats.frees, &stats->frees);
+    Synchronization::atomic_load_relaxed(&host_pool_stats.released, &stats->released);
+    Synchronization::atomic_load_relaxed(&retained_host_bytes, &stats->retained_bytes);
+    Synchronization::atomic_load_relaxed(&max_retained_host_bytes, &stats->max_retained_bytes);
+    return halide_error_code_success;
+}
 }
 
 namespace Halide {
@@ -1,4 +1,5 @@
 #include "HalideRuntime.h"
+#include "runtime_atomics.h"
 #include "runtime_internal.h"
 
 constexpr int MAX_THREADS = 256;
@@ -20,6 +21,7 @@ typedef long pthread_t;
 extern int pthread_create(pthread_t *, const void *attr,
                           void *(*start_routine)(void *), void *arg);
 extern int pthread_join(pthread_t thread, void **retval);
+extern pthread_t pthread_self();
 extern int pthread_cond_init(pthread_cond_t *cond, const void *attr);
 extern int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
 extern int pthread_cond_signal(pthread_cond_t *cond);
@@ -75,6 +77,10 @@ WEAK void halide_join_thread(struct halide_thread *thread_arg) {
     pthread_join(t->handle, &ret);
     free(t);
 }
+
+WEAK uint64_t halide_current_thread_id() {
+    return (uint64_t)pthread_self();
+}
 }
 
 namespace Halide {
@@ -89,10 +95,26 @@ namespace Synchronization {
 // condvar is cheap.  This code can be found in commit
 // 6a1ea6d2c883353f51f62fec4c2bce129649e2a7.
 
+ALWAYS_INLINE bool parker_uses_futex() {
+#if defined(TSAN_ANNOTATIONS) && TSAN_ANNOTATIONS
+    // tsan can't see the ordering a futex provides, so stick to the
+    // mutex and condvar it understands.
+    return false;
+#else
+    return halide_futex_supported();
+#endif
+}
+
 struct thread_parker {
     pthread_mutex_t mutex;
     pthread_cond_t condvar;
-    bool should_park = false;
+    // Nonzero while the thread should stay parked. Where the platform
+    // can wait on an address directly (parker_uses_futex), the parked
+    // thread sleeps on this word and the mutex and condvar are never
+    // used. That is checked afresh in every method rather than
+    // cached in a member, because the waking thread calls unpark_finish
+    // after the parked thread may have destroyed this object.
+    int should_park = 0;
 
     thread_parker(const thread_parker &) = delete;
     thread_parker &operator=(const thread_parker &) = delete;
@@ -100,20 +122,35 @@ struct thread_parker {
     thread_parker &operator=(thread_parker &&) = delete;
 
     ALWAYS_INLINE thread_parker() {
-        pthread_mutex_init(&mutex, nullptr);
-        pthread_cond_init(&condvar, nullptr);
+        if (!parker_uses_futex()) {
+            pthread_mutex_init(&mutex, nullptr);
+            pthread_cond_init(&condvar, nullptr);
+        }
     }
 
     ALWAYS_INLINE ~thread_parker() {
-        pthread_cond_destroy(&condvar);
-        pthread_mutex_destroy(&mutex);
+        if (!parker_uses_futex()) {
+            pthread_cond_destroy(&condvar);
+            pthread_mutex_destroy(&mutex);
+        }
     }
 
     ALWAYS_INLINE void prepare_park() {
-        should_park = true;
+        should_park = 1;
     }
 
     ALWAYS_INLINE void park() {
+        if (parker_uses_futex()) {
+            int val;
+            atomic_load_relaxed(&should_park, &val);
+            while (val) {
+                halide_futex_wait(&should_park, 1);
+                atomic_load_relaxed(&should_park, &val);
+            }
+            // Pairs with the release store in unpark.
+            atomic_thread_fence_acquire();
+            return;
+        }
         pthread_mutex_lock(&mutex);
         while (should_park) {
             pthread_cond_wait(&condvar, &mutex);
@@ -122,20 +159,45 @@ struct thread_parker {
     }
 
     ALWAYS_INLINE void unpark_start() {
-        pthread_mutex_lock(&mutex);
+        if (!parker_uses_futex()) {
+            pthread_mutex_lock(&mutex);
+        }
     }
 
     ALWAYS_INLINE void unpark() {
-        should_park = false;
+        if (parker_uses_futex()) {
+            // As in the Rust parking lot, the parked thread may return
+            // and destroy this object as soon as the store lands, so
+            // the wake may target a dead address. That just wakes
+            // nobody.
+            int zero = 0;
+            atomic_store_release(&should_park, &zero);
+            halide_futex_wake(&should_park, 1);
+            return;
+        }
+        should_park = 0;
         pthread_cond_signal(&condvar);
     }
 
     ALWAYS_INLINE void unpark_finish() {
-        pthread_mutex_unlock(&mutex);
+        if (!parker_uses_futex()) {
+            pthread_mutex_unlock(&mutex);
+        }
     }
 };
 
 }  // namespace Synchronization
+
+// The clock the thread pool uses to time its threads when stats
+// collection is enabled.
+ALWAYS_INLINE void thread_pool_start_clock() {
+    halide_start_clock(nullptr);
+}
+
+ALWAYS_INLINE int64_t thread_pool_clock_ns() {
+    return halide_current_time_ns(nullptr);
+}
+
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
@@ -1,4 +1,5 @@
 #include "HalideRuntime.h"
+#include "device_interface.h"
 #include "printer.h"
 #include "runtime_atomics.h"
 #include "scoped_mutex_lock.h"
@@ -10,7 +11,7 @@
 extern "C" {
 // Returns the address of the global halide_profiler state
 WEAK halide_profiler_state *halide_profiler_get_state() {
-    static halide_profiler_state s = {{{0}}, 1, 0, 0, 0, nullptr, nullptr, nullptr};
+    static halide_profiler_state s = {{{0}}, 1, 0, 0, 0, nullptr, nullptr, nullptr, nullptr, 1, 60000};
     return &s;
 }
 
@@ -75,6 +76,25 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
     p->num_allocs = 0;
     p->active_threads_numerator = 0;
     p->active_threads_denominator = 0;
+    p->device_memory_current = 0;
+    p->device_memory_peak = 0;
+    p->device_memory_total = 0;
+    p->device_num_allocs = 0;
+    p->device_pool_hits = 0;
+    p->copy_to_device_bytes = 0;
+    p->copy_to_host_bytes = 0;
+    p->copy_to_device_time = 0;
+    p->copy_to_host_time = 0;
+    p->kernel_time = 0;
+    p->num_kernels = 0;
+    p->sampled_runs = 0;
+    memset(p->time_histogram, 0, sizeof(p->time_histogram));
+    p->decayed_runs = 0;
+    p->decayed_time = 0;
+    p->decay_time = halide_current_time_ns(nullptr);
+    p->bytes_loaded = 0;
+    p->bytes_stored = 0;
+    p->arithmetic_ops = 0;
     p->funcs = (halide_profiler_func_stats *)malloc(num_funcs * sizeof(halide_profiler_func_stats));
     if (!p->funcs) {
         free(p);
@@ -90,6 +110,22 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
         p->funcs[i].stack_peak = 0;
         p->funcs[i].active_threads_numerator = 0;
         p->funcs[i].active_threads_denominator = 0;
+        p->funcs[i].device_memory_current = 0;
+        p->funcs[i].device_memory_peak = 0;
+        p->funcs[i].device_memory_total = 0;
+        p->funcs[i].device_num_allocs = 0;
+        p->funcs[i].device_pool_hits = 0;
+        p->funcs[i].copy_to_device_bytes = 0;
+        p->funcs[i].copy_to_host_bytes = 0;
+        p->funcs[i].copy_to_device_time = 0;
+        p->funcs[i].copy_to_host_time = 0;
+        p->funcs[i].kernel_time = 0;
+        p->funcs[i].num_kernels = 0;
+        memset(p->funcs[i].time_histogram, 0, sizeof(p->funcs[i].time_histogram));
+        p->funcs[i].decayed_time = 0;
+        p->funcs[i].bytes_loaded = 0;
+        p->funcs[i].bytes_stored = 0;
+        p->funcs[i].arithmetic_ops = 0;
     }
     s->first_free_id += num_funcs;
     s->pipelines = p;
@@ -122,26 +158,215 @@ WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, int ac
     // Someone must have called reset_state while a kernel was running. Do nothing.
 }
 
-extern "C" WEAK int halide_profiler_sample(struct halide_profiler_state *s, uint64_t *prev_t) {
-    int func, active_threads;
-    if (s->get_remote_profiler_state) {
-        // Execution has disappeared into remote code running
-        // on an accelerator (e.g. Hexagon DSP)
-        s->get_remote_profiler_state(&func, &active_threads);
-    } else {
-        func = s->current_func;
-        active_threads = s->active_threads;
+WEAK halide_profiler_pipeline_stats *find_pipeline_for_func(halide_profiler_state *s, int func_id) {
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        if (func_id >= p->first_func_id && func_id < p->first_func_id + p->num_funcs) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+// Live device allocations made inside a pipeline, so that frees (which
+// may happen after the pipeline has returned) are billed to the Func
+// that was running when the allocation was made. Allocations beyond
+// the capacity of this table are not tracked.
+struct DeviceAllocationRecord {
+    uint64_t device;
+    uint64_t bytes;
+    int func_id;
+};
+
+constexpr int max_tracked_device_allocations = 1024;
+WEAK DeviceAllocationRecord device_allocations[max_tracked_device_allocations];
+WEAK int num_device_allocations = 0;
+
+WEAK void profiler_device_event(void *user_context, DeviceProfilerEvent event,
+                                uint64_t device, uint64_t bytes, uint64_t ns) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    LockProfiler lock(s);
+
+    // Device calls don't say which pipeline instance made them, so
+    // bill them to the most recently started one.
+    int func_id = s->instances ? s->instances->current_func[0] : halide_profiler_outside_of_halide;
+    if (event == DeviceProfilerFree) {
+        func_id = -1;
+        for (int i = 0; i < num_device_allocations; i++) {
+            if (device_allocations[i].device == device) {
+                func_id = device_allocations[i].func_id;
+                bytes = device_allocations[i].bytes;
+                device_allocations[i] = device_allocations[--num_device_allocations];
+                break;
+            }
+        }
+    }
+    if (func_id < 0) {
+        // Outside of any profiled pipeline.
+        return;
+    }
+    halide_profiler_pipeline_stats *p = find_pipeline_for_func(s, func_id);
+    if (!p) {
+        return;
+    }
+    halide_profiler_func_stats *f = p->funcs + func_id - p->first_func_id;
+
+    switch (event) {
+    case DeviceProfilerMalloc:
+        if (num_device_allocations < max_tracked_device_allocations) {
+            device_allocations[num_device_allocations++] = {device, bytes, func_id};
+        }
+        p->device_num_allocs++;
+        p->device_memory_total += bytes;
+        p->device_memory_current += bytes;
+        p->device_memory_peak = max(p->device_memory_peak, p->device_memory_current);
+        f->device_num_allocs++;
+        f->device_memory_total += bytes;
+        f->device_memory_current += bytes;
+        f->device_memory_peak = max(f->device_memory_peak, f->device_memory_current);
+        break;
+    case DeviceProfilerFree:
+        p->device_memory_current -= bytes;
+        f->device_memory_current -= bytes;
+        break;
+    case DeviceProfilerPoolHit:
+        p->device_pool_hits++;
+        f->device_pool_hits++;
+        break;
+    case DeviceProfilerCopyToDevice:
+        p->copy_to_device_bytes += bytes;
+        p->copy_to_device_time += ns;
+        f->copy_to_device_bytes += bytes;
+        f->copy_to_device_time += ns;
+        break;
+    case DeviceProfilerCopyToHost:
+        p->copy_to_host_bytes += bytes;
+        p->copy_to_host_time += ns;
+        f->copy_to_host_bytes += bytes;
+        f->copy_to_host_time += ns;
+        break;
+    case DeviceProfilerKernel:
+        p->kernel_time += ns;
+        p->num_kernels++;
+        f->kernel_time += ns;
+        f->num_kernels++;
+        break;
+    }
+}
+
+// Bill time to a Func of a running pipeline instance, and to that
+// Func's time in the current run.
+WEAK void bill_instance_func(halide_profiler_state *s, halide_profiler_instance_state *instance,
+                             int func, uint64_t time, int active_threads) {
+    bill_func(s, func, time, active_threads);
+    int i = func - instance->pipeline->first_func_id;
+    if (instance->func_time && i >= 0 && i < instance->pipeline->num_funcs) {
+        instance->func_time[i] += time;
+    }
+}
+
+// Bill the time since the last sample to the Funcs running in a
+// pipeline instance, split evenly between the threads in parallel
+// leaf tasks if there are any.
+WEAK void bill_instance(halide_profiler_state *s, halide_profiler_instance_state *instance, uint64_t time) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    uint64_t claimed;
+    atomic_load_relaxed(&instance->claimed_slots, &claimed);
+    int active_threads = instance->active_threads;
+    if (!claimed) {
+        int func = instance->current_func[0];
+        if (func >= 0) {
+            bill_instance_func(s, instance, func, time, active_threads);
+        }
+        return;
+    }
+    int num_claimed = __builtin_popcountll(claimed);
+    uint64_t share = time / num_claimed;
+    uint64_t remainder = time - share * num_claimed;
+    while (claimed) {
+        int i = __builtin_ctzll(claimed);
+        claimed &= claimed - 1;
+        int func = instance->current_func[i];
+        if (func >= 0) {
+            bill_instance_func(s, instance, func, share + remainder, active_threads);
+        }
+        remainder = 0;
+    }
+}
+
+WEAK int histogram_bucket(uint64_t ns) {
+    int b = 63 - __builtin_clzll(ns | 1);
+    return b < HALIDE_PROFILER_HISTOGRAM_BUCKETS ? b : HALIDE_PROFILER_HISTOGRAM_BUCKETS - 1;
+}
+
+// Halve the histogram counts of a pipeline and its Funcs once for
+// every half-life that has passed since they were last decayed.
+WEAK void decay_histograms(halide_profiler_state *s, halide_profiler_pipeline_stats *p, uint64_t t_now) {
+    if (s->half_life_ms <= 0 || t_now <= p->decay_time) {
+        return;
+    }
+    uint64_t half_life = (uint64_t)s->half_life_ms * 1000000;
+    uint64_t halvings = (t_now - p->decay_time) / half_life;
+    if (!halvings) {
+        return;
+    }
+    p->decay_time += halvings * half_life;
+    double scale = halvings < 64 ? 1.0 / (double)((uint64_t)1 << halvings) : 0.0;
+    for (double &c : p->time_histogram) {
+        c *= scale;
+    }
+    p->decayed_runs *= scale;
+    p->decayed_time *= scale;
+    for (int i = 0; i < p->num_funcs; i++) {
+        halide_profiler_func_stats *f = p->funcs + i;
+        for (double &c : f->time_histogram) {
+            c *= scale;
+        }
+        f->decayed_time *= scale;
+    }
+}
+
+// Add a sampled run that just finished to the histograms.
+WEAK void record_sampled_run(halide_profiler_state *s, halide_profiler_instance_state *instance, uint64_t t_now) {
+    halide_profiler_pipeline_stats *p = instance->pipeline;
+    decay_histograms(s, p, t_now);
+    uint64_t wall_time = t_now > instance->start_time ? t_now - instance->start_time : 0;
+    p->time_histogram[histogram_bucket(wall_time)] += 1;
+    p->decayed_runs += 1;
+    p->decayed_time += wall_time;
+    if (instance->func_time) {
+        for (int i = 0; i < p->num_funcs; i++) {
+            halide_profiler_func_stats *f = p->funcs + i;
+            f->time_histogram[histogram_bucket(instance->func_time[i])] += 1;
+            f->decayed_time += instance->func_time[i];
+        }
     }
+}
+
+extern "C" WEAK int halide_profiler_sample(struct halide_profiler_state *s, uint64_t *prev_t) {
     uint64_t t_now = halide_current_time_ns(nullptr);
-    if (func == halide_profiler_please_stop) {
+    if (s->current_func == halide_profiler_please_stop) {
 #if TIMER_PROFILING
         s->sampling_thread = nullptr;
 #endif
         return -1;
-    } else if (func >= 0) {
-        // Assume all time since I was last awake is due to
-        // the currently running func.
-        bill_func(s, func, t_now - *prev_t, active_threads);
+    }
+    if (s->get_remote_profiler_state) {
+        // Execution has disappeared into remote code running
+        // on an accelerator (e.g. Hexagon DSP)
+        int func, active_threads;
+        s->get_remote_profiler_state(&func, &active_threads);
+        if (func >= 0) {
+            bill_func(s, func, t_now - *prev_t, active_threads);
+        }
+    } else {
+        // Assume all time since I was last awake is due to the
+        // currently running funcs of each running pipeline.
+        for (halide_profiler_instance_state *instance = s->instances; instance;
+             instance = instance->next) {
+            bill_instance(s, instance, t_now - *prev_t);
+        }
     }
     *prev_t = t_now;
     return s->sleep_time;
@@ -171,6 +396,163 @@ WEAK void sampling_profiler_thread(void *) {
     halide_mutex_unlock(&s->lock);
 }
 
+// With the profile_stages feature, the update definitions and
+// specializations of a Func are billed under names of the form
+// f.update(0) or f.update(0).specialization(1), and reported as
+// children of f.
+WEAK bool is_stage_of(const char *name, const char *func) {
+    size_t len = strlen(func);
+    return strncmp(name, func, len) == 0 && name[len] == '.';
+}
+
+// The time billed to a Func, including its stages.
+WEAK uint64_t func_time_with_stages(halide_profiler_pipeline_stats *p, int func) {
+    const char *name = p->funcs[func].name;
+    uint64_t time = p->funcs[func].time;
+    for (int i = 0; i < p->num_funcs; i++) {
+        if (is_stage_of(p->funcs[i].name, name)) {
+            time += p->funcs[i].time;
+        }
+    }
+    return time;
+}
+
+// Print the line of the report for one Func, or one stage of a Func,
+// billed the given time.
+WEAK void report_func(void *user_context, halide_profiler_pipeline_stats *p,
+                      halide_profiler_func_stats *fs, const char *name,
+                      int indent, uint64_t time, bool serial) {
+    StringStreamPrinter<1024> sstr(user_context);
+    size_t cursor = 0;
+
+    for (int i = 0; i < indent; i++) {
+        sstr << " ";
+    }
+    sstr << name << ": ";
+    cursor += 25;
+    while (sstr.size() < cursor) {
+        sstr << " ";
+    }
+
+    float ft = time / (p->sampled_runs * 1000000.0f);
+    sstr << ft;
+    // We don't need 6 sig. figs.
+    sstr.erase(3);
+    sstr << "ms";
+    cursor += 10;
+    while (sstr.size() < cursor) {
+        sstr << " ";
+    }
+
+    int percent = 0;
+    if (p->time != 0) {
+        percent = (100 * time) / p->time;
+    }
+    sstr << "(" << percent << "%)";
+    cursor += 8;
+    while (sstr.size() < cursor) {
+        sstr << " ";
+    }
+
+    if (!serial) {
+        float threads = fs->active_threads_numerator / (fs->active_threads_denominator + 1e-10);
+        sstr << "threads: " << threads;
+        sstr.erase(3);
+        cursor += 15;
+        while (sstr.size() < cursor) {
+            sstr << " ";
+        }
+    }
+
+    if (fs->memory_peak) {
+        cursor += 15;
+        sstr << " peak: " << fs->memory_peak;
+        while (sstr.size() < cursor) {
+            sstr << " ";
+        }
+        sstr << " num: " << fs->num_allocs;
+        cursor += 15;
+        while (sstr.size() < cursor) {
+            sstr << " ";
+        }
+        int alloc_avg = 0;
+        if (fs->num_allocs != 0) {
+            alloc_avg = fs->memory_total / fs->num_allocs;
+        }
+        sstr << " avg: " << alloc_avg;
+    }
+    if (fs->stack_peak > 0) {
+        sstr << " stack: " << fs->stack_peak;
+    }
+    if (fs->device_memory_peak) {
+        sstr << " device peak: " << fs->device_memory_peak
+             << " num: " << fs->device_num_allocs
+             << " pool hits: " << fs->device_pool_hits;
+    }
+    if (fs->num_kernels) {
+        sstr << " kernels: " << fs->num_kernels
+             << " in " << fs->kernel_time / 1000000.0f << " ms";
+    }
+    if (fs->copy_to_device_bytes) {
+        sstr << " to device: " << fs->copy_to_device_bytes
+             << " in " << fs->copy_to_device_time / 1000000.0f << " ms";
+    }
+    if (fs->copy_to_host_bytes) {
+        sstr << " to host: " << fs->copy_to_host_bytes
+             << " in " << fs->copy_to_host_time / 1000000.0f << " ms";
+    }
+    if (fs->bytes_loaded || fs->bytes_stored) {
+        // Arithmetic intensity, to compare against the machine's
+        // roofline.
+        sstr << " loaded: " << fs->bytes_loaded
+             << " stored: " << fs->bytes_stored
+             << " ops/byte: " << fs->arithmetic_ops / (fs->bytes_loaded + fs->bytes_stored + 1e-10);
+    }
+    sstr << "\n";
+
+    halide_print(user_context, sstr.str());
+}
+
+// Write the time spent in each Func to the file named by
+// HL_PROFILE_FILE, if set, for the compiler to read back when
+// compiling with the profile_guided target feature. Each line is
+// "<pipeline> <func> <average nanoseconds per run>".
+WEAK void write_profile_file(void *user_context, halide_profiler_state *s) {
+    const char *file_name = getenv("HL_PROFILE_FILE");
+    if (!file_name) {
+        return;
+    }
+    void *file = halide_fopen(file_name, "wb");
+    if (!file) {
+        error(user_context) << "Failed to open profile file " << file_name << "\n";
+        return;
+    }
+
+    StringStreamPrinter<1024> sstr(user_context);
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        if (!p->sampled_runs) {
+            continue;
+        }
+        // Skip the catch-all overhead slot. Stages are folded into
+        // their Func, which is what the compiler looks up. After the
+        // time come the average number of active threads, the peak
+        // memory allocated, and the memory allocated per run.
+        for (int i = 1; i < p->num_funcs; i++) {
+            halide_profiler_func_stats *fs = p->funcs + i;
+            if (strchr(fs->name, '.')) {
+                continue;
+            }
+            float threads = fs->active_threads_numerator / (fs->active_threads_denominator + 1e-10);
+            sstr.clear();
+            sstr << p->name << " " << fs->name << " " << func_time_with_stages(p, i) / p->sampled_runs
+                 << " " << threads << " " << fs->memory_peak << " " << fs->memory_total / p->sampled_runs << "\n";
+            fwrite(sstr.str(), 1, sstr.size(), file);
+        }
+    }
+    fclose(file);
+}
+
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
@@ -209,16 +591,29 @@ WEAK halide_profiler_pipeline_stats *halide_profiler_get_pipeline_state(const ch
     return nullptr;
 }
 
-// Returns a token identifying this pipeline instance.
+// Returns a token identifying this pipeline, and adds the instance
+// to the list of running instances, which it stays in until
+// halide_profiler_pipeline_end is called with it.
 WEAK int halide_profiler_pipeline_start(void *user_context,
                                         const char *pipeline_name,
                                         int num_funcs,
-                                        const uint64_t *func_names) {
+                                        const uint64_t *func_names,
+                                        halide_profiler_instance_state *instance) {
     halide_profiler_state *s = halide_profiler_get_state();
 
     LockProfiler lock(s);
 
     if (!s->sampling_thread) {
+        const char *env = getenv("HL_PROFILER_SAMPLE_RUNS");
+        if (env && atoi(env) > 0) {
+            s->runs_per_sample = atoi(env);
+        }
+        env = getenv("HL_PROFILER_HALF_LIFE_MS");
+        if (env && atoi(env) >= 0) {
+            s->half_life_ms = atoi(env);
+        }
+        env = getenv("HL_PROFILER_TIME_KERNELS");
+        device_profiler_time_kernels = env && atoi(env) > 0;
 #if TIMER_PROFILING
         halide_start_clock(user_context);
         halide_start_timer_chain();
@@ -236,6 +631,31 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
         return halide_error_out_of_memory(user_context);
     }
     p->runs++;
+    device_profiler_hook = profiler_device_event;
+
+    // Until the pipeline says otherwise, it's running overhead.
+    instance->current_func[0] = p->first_func_id;
+    instance->claimed_slots = 0;
+    instance->active_threads = 0;
+    instance->pipeline = p;
+    instance->func_time = nullptr;
+    instance->next = nullptr;
+
+    // Runs that aren't sampled stay out of the list of running
+    // instances, so the sampler never sees them.
+    instance->sampled = s->runs_per_sample <= 1 || (p->runs - 1) % s->runs_per_sample == 0;
+    if (instance->sampled) {
+        p->sampled_runs++;
+        // If this allocation fails the run is still billed, but is
+        // left out of the Func histograms.
+        instance->func_time = (uint64_t *)malloc(num_funcs * sizeof(uint64_t));
+        if (instance->func_time) {
+            memset(instance->func_time, 0, num_funcs * sizeof(uint64_t));
+        }
+        instance->start_time = halide_current_time_ns(user_context);
+        instance->next = s->instances;
+        s->instances = instance;
+    }
 
     return p->first_func_id;
 }
@@ -330,13 +750,39 @@ WEAK void halide_profiler_memory_free(void *user_context,
     atomic_sub_fetch_sequentially_consistent(&f_stats->memory_current, decr);
 }
 
+WEAK void halide_profiler_memory_traffic(void *user_context,
+                                         void *pipeline_state,
+                                         int func_id,
+                                         uint64_t bytes_loaded,
+                                         uint64_t bytes_stored,
+                                         uint64_t arithmetic_ops) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    halide_profiler_pipeline_stats *p_stats = (halide_profiler_pipeline_stats *)pipeline_state;
+    halide_abort_if_false(user_context, p_stats != nullptr);
+    halide_abort_if_false(user_context, func_id >= 0);
+    halide_abort_if_false(user_context, func_id < p_stats->num_funcs);
+
+    halide_profiler_func_stats *f_stats = &p_stats->funcs[func_id];
+
+    // Like the memory counters above, these are updated without
+    // grabbing the state's lock. Each parallel task adds its totals
+    // once, when it finishes.
+    atomic_add_fetch_sequentially_consistent(&p_stats->bytes_loaded, bytes_loaded);
+    atomic_add_fetch_sequentially_consistent(&p_stats->bytes_stored, bytes_stored);
+    atomic_add_fetch_sequentially_consistent(&p_stats->arithmetic_ops, arithmetic_ops);
+    atomic_add_fetch_sequentially_consistent(&f_stats->bytes_loaded, bytes_loaded);
+    atomic_add_fetch_sequentially_consistent(&f_stats->bytes_stored, bytes_stored);
+    atomic_add_fetch_sequentially_consistent(&f_stats->arithmetic_ops, arithmetic_ops);
+}
+
 WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_state *s) {
     StringStreamPrinter<1024> sstr(user_context);
 
     for (halide_profiler_pipeline_stats *p = s->pipelines; p;
          p = (halide_profiler_pipeline_stats *)(p->next)) {
         float t = p->time / 1000000.0f;
-        if (!p->runs) {
+        if (!p->sampled_runs) {
             continue;
         }
         sstr.clear();
@@ -345,16 +791,42 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
         sstr << p->name << "\n"
              << " total time: " << t << " ms"
              << "  samples: " << p->samples
-             << "  runs: " << p->runs
-             << "  time/run: " << t / p->runs << " ms\n";
+             << "  runs: " << p->runs;
+        if (p->sampled_runs != p->runs) {
+            sstr << "  sampled runs: " << p->sampled_runs;
+        }
+        sstr << "  time/run: " << t / p->sampled_runs << " ms\n";
         if (!serial) {
             sstr << " average threads used: " << threads << "\n";
         }
         sstr << " heap allocations: " << p->num_allocs
              << "  peak heap usage: " << p->memory_peak << " bytes\n";
+        if (p->device_num_allocs) {
+            sstr << " device allocations: " << p->device_num_allocs
+                 << "  pool hits: " << p->device_pool_hits
+                 << " (" << (100 * p->device_pool_hits) / p->device_num_allocs << "%)"
+                 << "  peak device usage: " << p->device_memory_peak << " bytes\n";
+        }
+        if (p->copy_to_device_bytes || p->copy_to_host_bytes) {
+            sstr << " copies to device: " << p->copy_to_device_bytes << " bytes in "
+                 << p->copy_to_device_time / 1000000.0f << " ms"
+                 << "  copies to host: " << p->copy_to_host_bytes << " bytes in "
+                 << p->copy_to_host_time / 1000000.0f << " ms\n";
+        }
+        if (p->num_kernels) {
+            sstr << " device kernels: " << p->num_kernels << " in "
+                 << p->kernel_time / 1000000.0f << " ms\n";
+        }
+        if (p->bytes_loaded || p->bytes_stored) {
+            sstr << " bytes loaded: " << p->bytes_loaded
+                 << "  bytes stored: " << p->bytes_stored
+                 << "  ops/byte: " << p->arithmetic_ops / (p->bytes_loaded + p->bytes_stored + 1e-10) << "\n";
+        }
         halide_print(user_context, sstr.str());
 
-        bool print_f_states = p->time || p->memory_total;
+        bool print_f_states = p->time || p->memory_total || p->device_memory_total ||
+                              p->copy_to_device_bytes || p->copy_to_host_bytes || p->num_kernels ||
+                              p->bytes_loaded || p->bytes_stored;
         if (!print_f_states) {
             for (int i = 0; i < p->num_funcs; i++) {
                 halide_profiler_func_stats *fs = p->funcs + i;
@@ -367,9 +839,11 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
 
         if (print_f_states) {
             for (int i = 0; i < p->num_funcs; i++) {
-                size_t cursor = 0;
-                sstr.clear();
                 halide_profiler_func_stats *fs = p->funcs + i;
+                if (strchr(fs->name, '.')) {
+                    // A stage, reported below its Func.
+                    continue;
+                }
 
                 // The first func is always a catch-all overhead
                 // slot. Only report overhead time if it's non-zero
@@ -377,74 +851,60 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                     continue;
                 }
 
-                sstr << "  " << fs->name << ": ";
-                cursor += 25;
-                while (sstr.size() < cursor) {
-                    sstr << " ";
-                }
-
-                float ft = fs->time / (p->runs * 1000000.0f);
-                sstr << ft;
-                // We don't need 6 sig. figs.
-                sstr.erase(3);
-                sstr << "ms";
-                cursor += 10;
-                while (sstr.size() < cursor) {
-                    sstr << " ";
-                }
-
-                int percent = 0;
-                if (p->time != 0) {
-                    percent = (100 * fs->time) / p->time;
-                }
-                sstr << "(" << percent << "%)";
-                cursor += 8;
-                while (sstr.size() < cursor) {
-                    sstr << " ";
-                }
-
-                if (!serial) {
-                    float threads = fs->active_threads_numerator / (fs->active_threads_denominator + 1e-10);
-                    sstr << "threads: " << threads;
-                    sstr.erase(3);
-                    cursor += 15;
-                    while (sstr.size() < cursor) {
-                        sstr << " ";
-                    }
-                }
-
-                if (fs->memory_peak) {
-                    cursor += 15;
-                    sstr << " peak: " << fs->memory_peak;
-                    while (sstr.size() < cursor) {
-                        sstr << " ";
-                    }
-                    sstr << " num: " << fs->num_allocs;
-                    cursor += 15;
-                    while (sstr.size() < cursor) {
-                        sstr << " ";
-                    }
-                    int alloc_avg = 0;
-                    if (fs->num_allocs != 0) {
-                        alloc_avg = fs->memory_total / fs->num_allocs;
+                report_func(user_context, p, fs, fs->name, 2, func_time_with_stages(p, i), serial);
+                size_t len = strlen(fs->name);
+                for (int j = 0; j < p->num_funcs; j++) {
+                    halide_profiler_func_stats *stage = p->funcs + j;
+                    if (is_stage_of(stage->name, fs->name)) {
+                        report_func(user_context, p, stage, stage->name + len + 1, 4, stage->time, serial);
                     }
-                    sstr << " avg: " << alloc_avg;
                 }
-                if (fs->stack_peak > 0) {
-                    sstr << " stack: " << fs->stack_peak;
-                }
-                sstr << "\n";
-
-                halide_print(user_context, sstr.str());
             }
         }
     }
+
+    // Summarize the default thread pool, if it has been collecting stats.
+    halide_thread_pool_stats_t pool;
+    halide_thread_pool_get_stats(nullptr, &pool, nullptr, 0);
+    if (pool.enabled && pool.num_workers > 0) {
+        const halide_thread_pool_thread_stats_t &w = pool.workers_total;
+        uint64_t total = w.busy_ns + w.spin_ns + w.idle_ns + w.blocked_ns + w.lock_wait_ns;
+        float scale = 100.0f / (total + 1e-10);
+        sstr.clear();
+        sstr << "thread pool\n"
+             << " workers: " << pool.num_workers
+             << " jobs: " << pool.jobs_enqueued
+             << " max queue depth: " << pool.max_queue_depth
+             << " tasks: " << w.tasks << " (+" << pool.callers.tasks << " by callers)\n"
+             << " busy: " << w.busy_ns * scale << "%"
+             << " spin: " << w.spin_ns * scale << "%"
+             << " idle: " << w.idle_ns * scale << "%"
+             << " blocked: " << w.blocked_ns * scale << "%"
+             << " lock wait: " << w.lock_wait_ns * scale << "%\n";
+        halide_print(user_context, sstr.str());
+    }
 }
 
 WEAK void halide_profiler_report(void *user_context) {
     halide_profiler_state *s = halide_profiler_get_state();
     LockProfiler lock(s);
     halide_profiler_report_unlocked(user_context, s);
+    write_profile_file(user_context, s);
+}
+
+WEAK int halide_profiler_visit(halide_profiler_visitor_t visitor, void *arg) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    LockProfiler lock(s);
+    uint64_t t_now = halide_current_time_ns(nullptr);
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        decay_histograms(s, p, t_now);
+        int result = visitor(arg, p);
+        if (result) {
+            return result;
+        }
+    }
+    return 0;
 }
 
 WEAK void halide_profiler_reset_unlocked(halide_profiler_state *s) {
@@ -455,6 +915,7 @@ WEAK void halide_profiler_reset_unlocked(halide_profiler_state *s) {
         free(p);
     }
     s->first_free_id = 0;
+    num_device_allocations = 0;
 }
 
 WEAK void halide_profiler_reset() {
@@ -523,7 +984,23 @@ WEAK void halide_windows_profiler_shutdown() {
 }  // namespace
 
 WEAK void halide_profiler_pipeline_end(void *user_context, void *state) {
-    ((halide_profiler_state *)state)->current_func = halide_profiler_outside_of_halide;
+    halide_profiler_instance_state *instance = (halide_profiler_instance_state *)state;
+    if (!instance->sampled) {
+        // Never entered the list of running instances.
+        return;
+    }
+    halide_profiler_state *s = halide_profiler_get_state();
+    LockProfiler lock(s);
+    for (halide_profiler_instance_state **ptr = &s->instances; *ptr;
+         ptr = &((*ptr)->next)) {
+        if (*ptr == instance) {
+            *ptr = instance->next;
+            break;
+        }
+    }
+    record_sampled_run(s, instance, halide_current_time_ns(user_context));
+    free(instance->func_time);
+    instance->func_time = nullptr;
 }
 
 }  // extern "C"
@@ -42,6 +42,67 @@ WEAK_INLINE int halide_profiler_init_sampling_token(int32_t *sampling_token, int
     return 0;
 }
 
+// The per-instance equivalents of the above. A local token of -1
+// means no slot is held; code outside of parallel leaf tasks passes a
+// null token and reports in slot 0.
+WEAK_INLINE int halide_profiler_instance_set_current_func(halide_profiler_instance_state *instance, int pipeline, int func, int *slot) {
+    int i = slot ? *slot : 0;
+    if (i >= 0) {
+        volatile int *ptr = &(instance->current_func[i]);
+        // clang-format off
+        asm volatile ("":::);
+        *ptr = pipeline + func;
+        asm volatile ("":::);
+        // clang-format on
+    }
+    return 0;
+}
+
+WEAK_INLINE int halide_profiler_instance_acquire_slot(halide_profiler_instance_state *instance, int *slot) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    uint64_t claimed;
+    atomic_load_relaxed(&instance->claimed_slots, &claimed);
+    while (true) {
+        // Slot 0 is never claimed.
+        uint64_t unclaimed = ~claimed & ~(uint64_t)1;
+        if (!unclaimed) {
+            *slot = -1;
+            return 0;
+        }
+        int i = __builtin_ctzll(unclaimed);
+        uint64_t desired = claimed | ((uint64_t)1 << i);
+        if (atomic_cas_strong_sequentially_consistent(&instance->claimed_slots, &claimed, &desired)) {
+            // The task starts out running whatever Func launched it.
+            instance->current_func[i] = instance->current_func[0];
+            *slot = i;
+            return 0;
+        }
+    }
+}
+
+WEAK_INLINE int halide_profiler_instance_release_slot(halide_profiler_instance_state *instance, int *slot) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    if (*slot >= 0) {
+        atomic_fetch_and_release(&instance->claimed_slots, ~((uint64_t)1 << *slot));
+        *slot = -1;
+    }
+    return 0;
+}
+
+WEAK_INLINE int halide_profiler_instance_incr_active_threads(halide_profiler_instance_state *instance) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    return atomic_fetch_add_sequentially_consistent(&(instance->active_threads), 1);
+}
+
+WEAK_INLINE int halide_profiler_instance_decr_active_threads(halide_profiler_instance_state *instance) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    return atomic_fetch_sub_sequentially_consistent(&(instance->active_threads), 1);
+}
+
 WEAK_INLINE int halide_profiler_incr_active_threads(halide_profiler_state *state) {
     using namespace Halide::Runtime::Internal::Synchronization;
 
@@ -117,4 +117,18 @@ WEAK void *halide_malloc(void *user_context, size_t x) {
 WEAK void halide_free(void *user_context, void *ptr) {
     halide_default_free(user_context, ptr);
 }
+
+// QuRT already reuses a few preallocated buffers for small allocations
+// (see above), so there is no separate pool to enable here.
+WEAK int halide_reuse_host_allocations(void *user_context, bool flag) {
+    return halide_error_code_success;
+}
+
+WEAK void halide_host_allocation_pool_set_size(int64_t size) {
+}
+
+WEAK int halide_host_allocation_pool_get_stats(halide_host_allocation_pool_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    return halide_error_code_success;
+}
 }
@@ -2,16 +2,65 @@
 #include "mini_qurt.h"
 #include "mini_qurt_vtcm.h"
 #include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
 
 using namespace Halide::Runtime::Internal::Qurt;
 
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace Qurt {
+
+// Pipelines place all their VTCM allocations in one arena, so keeping
+// the reservation for it when it is freed lets the next run of the
+// pipeline reuse it without asking QuRT for VTCM again.
+WEAK void *reserved_vtcm = nullptr;
+WEAK int reserved_vtcm_size = 0;
+WEAK bool reserved_vtcm_in_use = false;
+WEAK halide_mutex reserved_vtcm_mutex;
+
+}  // namespace Qurt
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
 extern "C" {
 
 WEAK void *halide_vtcm_malloc(void *user_context, int size) {
-    return HAP_request_VTCM(size, 1);
+    ScopedMutexLock lock(&reserved_vtcm_mutex);
+    if (reserved_vtcm && !reserved_vtcm_in_use) {
+        if (reserved_vtcm_size >= size) {
+            reserved_vtcm_in_use = true;
+            return reserved_vtcm;
+        }
+        // Too small. Give it back, so that the larger request can use
+        // the space.
+        HAP_release_VTCM(reserved_vtcm);
+        reserved_vtcm = nullptr;
+    }
+    void *addr = HAP_request_VTCM(size, 1);
+    if (addr && !reserved_vtcm) {
+        reserved_vtcm = addr;
+        reserved_vtcm_size = size;
+        reserved_vtcm_in_use = true;
+    }
+    return addr;
 }
 
 WEAK void halide_vtcm_free(void *user_context, void *addr) {
-    HAP_release_VTCM(addr);
+    ScopedMutexLock lock(&reserved_vtcm_mutex);
+    if (addr == reserved_vtcm) {
+        reserved_vtcm_in_use = false;
+    } else {
+        HAP_release_VTCM(addr);
+    }
+}
+
+WEAK void halide_vtcm_release_reserved(void *user_context) {
+    ScopedMutexLock lock(&reserved_vtcm_mutex);
+    if (reserved_vtcm && !reserved_vtcm_in_use) {
+        HAP_release_VTCM(reserved_vtcm);
+        reserved_vtcm = nullptr;
+    }
 }
 }
@@ -25,6 +25,7 @@ void spawn_thread_helper(void *arg) {
 extern "C" {
 
 extern void *memalign(size_t, size_t);
+extern qurt_thread_t qurt_thread_get_id();
 
 int halide_host_cpu_count() {
     // Assume a Snapdragon 820
@@ -72,6 +73,10 @@ WEAK void halide_join_thread(struct halide_thread *thread_arg) {
     free(t);
 }
 
+WEAK uint64_t halide_current_thread_id() {
+    return qurt_thread_get_id();
+}
+
 }  // extern "C"
 
 namespace Halide {
@@ -128,6 +133,16 @@ struct thread_parker {
 };
 
 }  // namespace Synchronization
+
+// There is no clock module on this platform, so thread pool stats
+// only count work, and leave all the times at zero.
+ALWAYS_INLINE void thread_pool_start_clock() {
+}
+
+ALWAYS_INLINE int64_t thread_pool_clock_ns() {
+    return 0;
+}
+
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
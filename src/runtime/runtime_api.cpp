@@ -23,24 +23,40 @@
 extern "C" void halide_unused_force_include_types();
 
 extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
+    (void *)&halide_async_call_done,
+    (void *)&halide_async_call_wait,
     (void *)&halide_buffer_copy,
     (void *)&halide_buffer_to_string,
+    (void *)&halide_call_async,
     (void *)&halide_can_use_target_features,
     (void *)&halide_cond_broadcast,
     (void *)&halide_cond_signal,
     (void *)&halide_cond_wait,
+    (void *)&halide_copy_region_to_device,
+    (void *)&halide_copy_region_to_host,
     (void *)&halide_copy_to_device,
     (void *)&halide_copy_to_host,
     (void *)&halide_cuda_detach_device_ptr,
     (void *)&halide_cuda_device_interface,
+    (void *)&halide_cuda_get_device_count,
+    (void *)&halide_cuda_get_device_memory_stats,
     (void *)&halide_cuda_get_device_ptr,
+    (void *)&halide_cuda_graph_begin,
+    (void *)&halide_cuda_graph_end,
+    (void *)&halide_cuda_graph_release,
     (void *)&halide_cuda_initialize_kernels,
+    (void *)&halide_cuda_occupancy_block_size,
     (void *)&halide_cuda_finalize_kernels,
     (void *)&halide_cuda_run,
+    (void *)&halide_cuda_set_user_context_device,
+    (void *)&halide_cuda_use_copy_stream,
+    (void *)&halide_cuda_use_managed_memory,
+    (void *)&halide_cuda_use_stream_pool,
     (void *)&halide_cuda_wrap_device_ptr,
     (void *)&halide_current_time_ns,
     (void *)&halide_debug_to_file,
     (void *)&halide_default_can_use_target_features,
+    (void *)&halide_default_region_complete,
     (void *)&halide_device_and_host_free,
     (void *)&halide_device_and_host_free_as_destructor,
     (void *)&halide_device_and_host_malloc,
@@ -112,16 +128,27 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_hexagon_set_performance_mode,
     (void *)&halide_hexagon_set_thread_priority,
     (void *)&halide_hexagon_wrap_device_handle,
+    (void *)&halide_host_allocation_pool_get_stats,
+    (void *)&halide_host_allocation_pool_set_size,
     (void *)&halide_int64_to_string,
     (void *)&halide_join_thread,
     (void *)&halide_load_library,
     (void *)&halide_malloc,
     (void *)&halide_memoization_cache_cleanup,
     (void *)&halide_memoization_cache_evict,
+    (void *)&halide_memoization_cache_get_eviction_key_usage,
+    (void *)&halide_memoization_cache_get_stats,
     (void *)&halide_memoization_cache_lookup,
     (void *)&halide_memoization_cache_release,
+    (void *)&halide_memoization_cache_release_device,
+    (void *)&halide_memoization_cache_release_device_as_destructor,
+    (void *)&halide_memoization_cache_reset_stats,
+    (void *)&halide_memoization_cache_set_backend,
+    (void *)&halide_memoization_cache_set_device_size,
+    (void *)&halide_memoization_cache_set_eviction_key_size,
     (void *)&halide_memoization_cache_set_size,
     (void *)&halide_memoization_cache_store,
+    (void *)&halide_memoization_cache_use_shared_memory,
     (void *)&halide_metal_acquire_context,
     (void *)&halide_metal_detach_buffer,
     (void *)&halide_metal_device_interface,
@@ -150,6 +177,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_opencl_get_device_type,
     (void *)&halide_opencl_get_platform_name,
     (void *)&halide_opencl_get_crop_offset,
+    (void *)&halide_opencl_get_device_memory_stats,
     (void *)&halide_opencl_image_device_interface,
     (void *)&halide_opencl_image_wrap_cl_mem,
     (void *)&halide_opencl_initialize_kernels,
@@ -171,14 +199,19 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_profiler_get_state,
     (void *)&halide_profiler_memory_allocate,
     (void *)&halide_profiler_memory_free,
+    (void *)&halide_profiler_memory_traffic,
     (void *)&halide_profiler_pipeline_start,
     (void *)&halide_profiler_report,
     (void *)&halide_profiler_reset,
     (void *)&halide_profiler_stack_peak_update,
+    (void *)&halide_profiler_visit,
     (void *)&halide_qurt_hvx_lock,
     (void *)&halide_qurt_hvx_unlock,
     (void *)&halide_qurt_hvx_unlock_as_destructor,
+    (void *)&halide_region_complete,
     (void *)&halide_release_jit_module,
+    (void *)&halide_release_workspaces,
+    (void *)&halide_reuse_host_allocations,
     (void *)&halide_semaphore_init,
     (void *)&halide_semaphore_release,
     (void *)&halide_semaphore_try_acquire,
@@ -192,22 +225,36 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_set_custom_load_library,
     (void *)&halide_set_custom_malloc,
     (void *)&halide_set_custom_print,
+    (void *)&halide_set_custom_region_complete,
     (void *)&halide_set_custom_trace,
     (void *)&halide_set_error_handler,
     (void *)&halide_set_gpu_device,
+    (void *)&halide_set_host_memory_policy,
     (void *)&halide_set_num_threads,
+    (void *)&halide_set_parallel_chunking_policy,
+    (void *)&halide_set_static_workspace,
+    (void *)&halide_set_thread_affinity,
+    (void *)&halide_set_timeline_file,
     (void *)&halide_set_trace_file,
     (void *)&halide_shutdown_thread_pool,
+    (void *)&halide_shutdown_timeline,
     (void *)&halide_shutdown_trace,
     (void *)&halide_sleep_ms,
     (void *)&halide_spawn_thread,
     (void *)&halide_start_clock,
     (void *)&halide_start_timer_chain,
+    (void *)&halide_static_workspace_malloc,
     (void *)&halide_string_to_string,
+    (void *)&halide_thread_pool_bind,
+    (void *)&halide_thread_pool_create,
+    (void *)&halide_thread_pool_destroy,
+    (void *)&halide_thread_pool_enable_stats,
+    (void *)&halide_thread_pool_get_stats,
     (void *)&halide_trace,
     (void *)&halide_trace_helper,
     (void *)&halide_uint64_to_string,
     (void *)&halide_use_jit_module,
+    (void *)&halide_work_stealing_do_par_for,
     (void *)&halide_d3d12compute_acquire_context,
     (void *)&halide_d3d12compute_device_interface,
     (void *)&halide_d3d12compute_initialize_kernels,
@@ -216,6 +263,8 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_d3d12compute_run,
     (void *)&halide_vulkan_acquire_context,
     (void *)&halide_vulkan_device_interface,
+    (void *)&halide_vulkan_export_pipeline_cache,
+    (void *)&halide_vulkan_import_pipeline_cache,
     (void *)&halide_vulkan_initialize_kernels,
     (void *)&halide_vulkan_release_context,
     (void *)&halide_vulkan_run,
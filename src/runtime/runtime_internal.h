@@ -154,6 +154,7 @@ WEAK int64_t halide_current_time_ns(void *user_context);
 WEAK void halide_sleep_ms(void *user_context, int ms);
 WEAK void halide_device_free_as_destructor(void *user_context, void *obj);
 WEAK void halide_device_and_host_free_as_destructor(void *user_context, void *obj);
+WEAK void halide_memoization_cache_release_device_as_destructor(void *user_context, void *obj);
 WEAK void halide_device_host_nop_free(void *user_context, void *obj);
 
 // The pipeline_state is declared as void* type since halide_profiler_pipeline_stats
@@ -169,12 +170,38 @@ WEAK void halide_profiler_memory_free(void *user_context,
                                       void *pipeline_state,
                                       int func_id,
                                       uint64_t decr);
+WEAK void halide_profiler_memory_traffic(void *user_context,
+                                         void *pipeline_state,
+                                         int func_id,
+                                         uint64_t bytes_loaded,
+                                         uint64_t bytes_stored,
+                                         uint64_t arithmetic_ops);
 WEAK int halide_profiler_pipeline_start(void *user_context,
                                         const char *pipeline_name,
                                         int num_funcs,
-                                        const uint64_t *func_names);
+                                        const uint64_t *func_names,
+                                        struct halide_profiler_instance_state *instance);
 WEAK int halide_host_cpu_count();
 
+// Platform specific thread placement, used by the thread pool. The
+// pin functions restrict the calling thread to the given cpu or to
+// the cpus of the given NUMA node, and return false if that isn't
+// possible on this platform. halide_set_thread_low_priority drops the
+// calling thread below the default OS scheduling priority.
+WEAK int halide_host_numa_node_count();
+WEAK bool halide_pin_thread_to_cpu(int cpu);
+WEAK bool halide_pin_thread_to_numa_node(int node);
+WEAK bool halide_set_thread_low_priority();
+
+// Platform specific waiting on an address, used to park threads
+// without a mutex and condition variable. halide_futex_wait sleeps as
+// long as *addr == val, and may return spuriously. halide_futex_wake
+// wakes up to count threads waiting on addr. Neither may be called
+// unless halide_futex_supported returns true.
+WEAK bool halide_futex_supported();
+WEAK void halide_futex_wait(int *addr, int val);
+WEAK void halide_futex_wake(int *addr, int count);
+
 WEAK int halide_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf,
                                        const struct halide_device_interface_t *device_interface);
 WEAK int halide_device_and_host_free(void *user_context, struct halide_buffer_t *buf);
@@ -195,6 +222,17 @@ struct halide_pseudostack_slot_t {
     size_t cumulative_size;
 };
 
+// The state of one allocation site compiled with the workspace target
+// feature. Generated code zero-initializes these, and sizes them as five
+// 64-bit words.
+struct halide_workspace_slot_t {
+    void *block;
+    size_t size;
+    uintptr_t in_use;
+    halide_workspace_slot_t *next;
+    uintptr_t registered;
+};
+
 WEAK void halide_use_jit_module();
 WEAK void halide_release_jit_module();
 
@@ -204,8 +242,18 @@ WEAK_INLINE int halide_internal_malloc_alignment();
 WEAK_INLINE void *halide_internal_aligned_alloc(size_t alignment, size_t size);
 WEAK_INLINE void halide_internal_aligned_free(void *ptr);
 
+// Map fresh pages for an allocation of at least *size bytes, placed
+// according to a set of halide_host_memory_policy_t flags, and set
+// *size to the length mapped. Returns nullptr if the platform doesn't
+// support it or the mapping fails.
+WEAK void *halide_internal_map_host_pages(size_t *size, int policy);
+WEAK void halide_internal_unmap_host_pages(void *region, size_t size);
+
 void halide_thread_yield();
 
+// An id for the calling thread, unique among the threads alive at once.
+uint64_t halide_current_thread_id();
+
 }  // extern "C"
 
 template<typename T>
@@ -1,3 +1,5 @@
+#include "timeline.h"
+
 #define EXTENDED_DEBUG 0
 
 #if EXTENDED_DEBUG
@@ -92,7 +94,70 @@ WEAK int default_desired_num_threads() {
                halide_host_cpu_count();
 }
 
-// The work queue and thread pool is weak, so one big work queue is shared by all halide functions
+WEAK bool default_thread_pool_stats_enabled() {
+    const char *stats_str = getenv("HL_THREAD_POOL_STATS");
+    return stats_str && atoi(stats_str) != 0;
+}
+
+WEAK halide_parallel_chunking_policy_t default_parallel_chunking_policy() {
+    const char *policy_str = getenv("HL_PARALLEL_CHUNKING");
+    if (policy_str && strcmp(policy_str, "single") == 0) {
+        return halide_parallel_chunking_single;
+    }
+    return halide_parallel_chunking_guided;
+}
+
+// The thread placement policy, or -1 if it hasn't been set yet and
+// should be read from HL_THREAD_AFFINITY.
+WEAK int thread_affinity = -1;
+
+WEAK halide_thread_affinity_t current_thread_affinity() {
+    int affinity;
+    Synchronization::atomic_load_relaxed(&thread_affinity, &affinity);
+    if (affinity < 0) {
+        const char *affinity_str = getenv("HL_THREAD_AFFINITY");
+        affinity = halide_thread_affinity_none;
+        if (affinity_str && strcmp(affinity_str, "cpu") == 0) {
+            affinity = halide_thread_affinity_cpu;
+        } else if (affinity_str && strcmp(affinity_str, "numa") == 0) {
+            affinity = halide_thread_affinity_numa_node;
+        }
+        // Racing readers of the environment all agree, so there's
+        // no need to do better than a plain store.
+        Synchronization::atomic_store_release(&thread_affinity, &affinity);
+    }
+    return (halide_thread_affinity_t)affinity;
+}
+
+// Place a thread spawned by one of the pools according to the
+// current policy. The thread that called into the pool counts as
+// thread zero, so the first spawned worker is thread one.
+WEAK void pin_worker_thread(int worker_index, int num_threads) {
+    halide_thread_affinity_t affinity = current_thread_affinity();
+    int thread = worker_index + 1;
+    if (num_threads <= thread) {
+        num_threads = thread + 1;
+    }
+    if (affinity == halide_thread_affinity_cpu) {
+        int cpus = halide_host_cpu_count();
+        if (!halide_pin_thread_to_cpu(thread % (cpus > 0 ? cpus : 1))) {
+            log_message("Could not pin worker " << worker_index << " to a cpu");
+        }
+    } else if (affinity == halide_thread_affinity_numa_node) {
+        // Consecutive threads go on the same node, so that the
+        // contiguous slices of a loop they are handed stay together.
+        int nodes = halide_host_numa_node_count();
+        int node = (int)(((int64_t)thread * nodes) / num_threads);
+        if (!halide_pin_thread_to_numa_node(node)) {
+            log_message("Could not pin worker " << worker_index << " to NUMA node " << node);
+        }
+    }
+}
+
+// The work queue and thread pool is weak, so one big work queue is
+// shared by all halide functions, except for those called with a
+// user_context bound to a pool made by halide_thread_pool_create,
+// which have a work queue of their own.
 struct work_queue_t {
     // all fields are protected by this mutex.
     halide_mutex mutex;
@@ -100,6 +165,28 @@ struct work_queue_t {
     // The desired number threads doing work (HL_NUM_THREADS).
     int desired_threads_working;
 
+    // The halide_thread_pool_priority_t of the worker threads.
+    int priority;
+
+    // The next pool made by halide_thread_pool_create, protected by
+    // the pool registry mutex rather than this one.
+    work_queue_t *next_pool;
+
+    // Whether stats are being collected (HL_THREAD_POOL_STATS), and
+    // whether that has been set explicitly. The stats live up here so
+    // that they survive halide_shutdown_thread_pool. Worker stats are
+    // indexed by the order the threads started in.
+    bool stats_enabled, stats_enabled_set;
+    halide_thread_pool_thread_stats_t worker_stats[MAX_THREADS];
+    halide_thread_pool_thread_stats_t caller_stats;
+    uint64_t jobs_enqueued;
+    int max_queue_depth;
+
+    // How many iterations of a parallel loop to claim at a time
+    // (HL_PARALLEL_CHUNKING), and whether it has been set explicitly.
+    halide_parallel_chunking_policy_t chunking_policy;
+    bool chunking_policy_set;
+
     // All fields after this must be zero in the initial state. See assert_zeroed
     // Field serves both to mark the offset in struct and as layout padding.
     int zero_marker;
@@ -107,8 +194,9 @@ struct work_queue_t {
     // Singly linked list for job stack
     work *jobs;
 
-    // The number threads created
-    int threads_created;
+    // The number threads created, and the number that have started
+    // running (which hands each one its index).
+    int threads_created, threads_started;
 
     // Workers sleep on one of two condition variables, to make it
     // easier to wake up the right number if a small number of tasks
@@ -127,6 +215,15 @@ struct work_queue_t {
     // waking-up thread may not have decremented this yet.
     int workers_sleeping, owners_sleeping;
 
+    // How many times an idle thread yields, waiting for work, before
+    // going to sleep. Adapted to recent queue activity; see
+    // spin_succeeded and spin_failed.
+    int spin_limit;
+
+    // Whether spin_limit has already been decayed since the last
+    // enqueue.
+    bool spin_limit_decayed;
+
     // Keep track of threads so they can be joined at shutdown
     halide_thread *threads[MAX_THREADS];
 
@@ -144,6 +241,35 @@ struct work_queue_t {
         return !shutdown;
     }
 
+    // Spinning is only worth it when work tends to turn up before the
+    // spin runs out, e.g. for back-to-back pipeline calls. A thread
+    // that found work after spinning pulls the limit towards twice
+    // what it needed. A thread that spun in vain decays it, at most
+    // once per enqueue, so an idle pool soon stops burning cpu but a
+    // single long gap doesn't undo what a busy period learned.
+    static constexpr int min_spin_limit = 4;
+    static constexpr int max_spin_limit = 400;
+    static constexpr int initial_spin_limit = 40;
+
+    ALWAYS_INLINE void spin_succeeded(int spins) {
+        spin_limit += (2 * spins - spin_limit) / 4;
+        if (spin_limit < min_spin_limit) {
+            spin_limit = min_spin_limit;
+        } else if (spin_limit > max_spin_limit) {
+            spin_limit = max_spin_limit;
+        }
+    }
+
+    ALWAYS_INLINE void spin_failed() {
+        if (!spin_limit_decayed) {
+            spin_limit -= spin_limit / 8;
+            if (spin_limit < min_spin_limit) {
+                spin_limit = min_spin_limit;
+            }
+            spin_limit_decayed = true;
+        }
+    }
+
     // Used to check initial state is correct.
     ALWAYS_INLINE void assert_zeroed() const {
         // Assert that all fields except the mutex and desired threads count are zeroed.
@@ -165,7 +291,58 @@ struct work_queue_t {
     }
 };
 
-WEAK work_queue_t work_queue = {};
+WEAK work_queue_t default_work_queue = {};
+
+// Times a stretch of a thread's time for the pool stats, when they
+// are enabled. Construct it and call finish with the work queue
+// locked; lap may be called unlocked in between to split the time
+// into two stats.
+class stats_timer {
+    bool enabled;
+    int64_t start, lap_time = 0;
+
+public:
+    ALWAYS_INLINE explicit stats_timer(const work_queue_t &work_queue)
+        : enabled(work_queue.stats_enabled),
+          start(enabled ? thread_pool_clock_ns() : 0) {
+    }
+
+    ALWAYS_INLINE void lap() {
+        if (enabled) {
+            lap_time = thread_pool_clock_ns();
+        }
+    }
+
+    ALWAYS_INLINE void finish(const work_queue_t &work_queue, uint64_t *stat, uint64_t *after_lap = nullptr) {
+        if (!enabled || !work_queue.stats_enabled) {
+            return;
+        }
+        int64_t now = thread_pool_clock_ns();
+        if (after_lap) {
+            *stat += lap_time - start;
+            *after_lap += now - lap_time;
+        } else {
+            *stat += now - start;
+        }
+    }
+};
+
+// How many iterations of the given job a worker should claim at
+// once. Must be called with the work queue locked.
+WEAK int iterations_to_claim(const work_queue_t &work_queue, const work *job) {
+    if (work_queue.chunking_policy == halide_parallel_chunking_single ||
+        job->task.min_threads != 0 ||
+        job->task.num_semaphores != 0) {
+        return 1;
+    }
+    // Guided scheduling: take a share of what's left proportional
+    // to the number of threads that could be helping. The factor of
+    // four leaves enough chunks in flight for threads that get stalled
+    // or start late to still balance the load.
+    int threads = work_queue.threads_created + 1;
+    int iters = job->task.extent / (threads * 4);
+    return iters < 1 ? 1 : iters;
+}
 
 #if EXTENDED_DEBUG
 
@@ -181,7 +358,7 @@ WEAK void print_job(work *job, const char *indent, const char *prefix = nullptr)
     }
 }
 
-WEAK void dump_job_state() {
+WEAK void dump_job_state(const work_queue_t &work_queue) {
     log_message("Dumping job state, jobs in queue:");
     work *job = work_queue.jobs;
     while (job != nullptr) {
@@ -195,16 +372,74 @@ WEAK void dump_job_state() {
 
 // clang-format off
 #define print_job(job, indent, prefix)  do { /*nothing*/ } while (0)
-#define dump_job_state()                do { /*nothing*/ } while (0)
+#define dump_job_state(work_queue)      do { /*nothing*/ } while (0)
 // clang-format on
 
 #endif
 
-WEAK void worker_thread(void *);
+// Sleep on one of the work queue's condition variables. If the thread
+// is sleeping because the only jobs it could run are blocked on their
+// semaphores, the wait is reported to the timeline.
+ALWAYS_INLINE void work_queue_wait(work_queue_t &work_queue, halide_cond *cond,
+                                   bool blocked_on_semaphores, const char *blocked_job_name) {
+    if (blocked_on_semaphores) {
+        ScopedTimelineSpan span(TimelineSemaphoreWait, blocked_job_name);
+        halide_cond_wait(cond, &work_queue.mutex);
+    } else {
+        halide_cond_wait(cond, &work_queue.mutex);
+    }
+}
+
+// Whether a worker on the calling thread could start on a job, ignoring
+// the semaphores it must acquire.
+WEAK bool job_can_start(const work_queue_t &work_queue, const work *job, const work *owned_job) {
+    // Only schedule tasks with enough free worker threads
+    // around to complete. They may get stolen later, but only
+    // by tasks which can themselves use them to complete
+    // work, so forward progress is made.
+    bool enough_threads;
+
+    const work *parent_job = job->parent_job;
+
+    int threads_available;
+    if (parent_job == nullptr) {
+        // The + 1 is because work_queue.threads_created does not include the main thread.
+        threads_available = (work_queue.threads_created + 1) - work_queue.threads_reserved;
+    } else {
+        if (parent_job->active_workers == 0) {
+            threads_available = parent_job->task.min_threads - parent_job->threads_reserved;
+        } else {
+            threads_available = parent_job->active_workers * parent_job->task.min_threads - parent_job->threads_reserved;
+        }
+    }
+    enough_threads = threads_available >= job->task.min_threads;
+
+    if (!enough_threads) {
+        log_message("Not enough threads for job " << job->task.name << " available: " << threads_available << " min_threads: " << job->task.min_threads);
+    }
+    bool can_use_this_thread_stack = !owned_job || (job->siblings == owned_job->siblings) || job->task.min_threads == 0;
+    if (!can_use_this_thread_stack) {
+        log_message("Cannot run job " << job->task.name << " on this thread.");
+    }
+    bool can_add_worker = (!job->task.serial || (job->active_workers == 0));
+    if (!can_add_worker) {
+        log_message("Cannot add worker to job " << job->task.name);
+    }
+
+    return enough_threads && can_use_this_thread_stack && can_add_worker;
+}
 
-WEAK void worker_thread_already_locked(work *owned_job) {
+WEAK void worker_thread_already_locked(work_queue_t &work_queue, work *owned_job,
+                                      halide_thread_pool_thread_stats_t *stats) {
+    // The number of times this thread has yielded waiting for a job,
+    // or sleeping_spin_count once it has given up and gone to sleep.
+    const int sleeping_spin_count = 0x7fffffff;
     int spin_count = 0;
-    const int max_spin_count = 40;
+
+    // The locality group of the last job this thread ran, and the
+    // list it came from.
+    const work *last_siblings = nullptr;
+    int last_locality_group = 0;
 
     while (owned_job ? owned_job->running() : !work_queue.shutdown) {
         work *job = work_queue.jobs;
@@ -231,49 +466,47 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             }
         }
 
-        dump_job_state();
-
-        // Find a job to run, prefering things near the top of the stack.
-        while (job) {
-            print_job(job, "", "Considering job ");
-            // Only schedule tasks with enough free worker threads
-            // around to complete. They may get stolen later, but only
-            // by tasks which can themselves use them to complete
-            // work, so forward progress is made.
-            bool enough_threads;
-
-            work *parent_job = job->parent_job;
-
-            int threads_available;
-            if (parent_job == nullptr) {
-                // The + 1 is because work_queue.threads_created does not include the main thread.
-                threads_available = (work_queue.threads_created + 1) - work_queue.threads_reserved;
-            } else {
-                if (parent_job->active_workers == 0) {
-                    threads_available = parent_job->task.min_threads - parent_job->threads_reserved;
-                } else {
-                    threads_available = parent_job->active_workers * parent_job->task.min_threads - parent_job->threads_reserved;
+        dump_job_state(work_queue);
+
+        // Whether there is a job we could have run if only its
+        // semaphores were available.
+        bool blocked_on_semaphores = false;
+        const char *blocked_job_name = nullptr;
+
+        // Prefer a job in the same locality group as the last one this
+        // thread ran, such as the consumer of the producer it just ran,
+        // so that it finds the data in cache.
+        bool found_local_job = false;
+        if (last_locality_group != 0) {
+            work *local_job = job;
+            work **local_prev_ptr = prev_ptr;
+            while (local_job) {
+                if (local_job->siblings == last_siblings &&
+                    local_job->task.locality_group == last_locality_group &&
+                    job_can_start(work_queue, local_job, owned_job) &&
+                    local_job->make_runnable()) {
+                    job = local_job;
+                    prev_ptr = local_prev_ptr;
+                    found_local_job = true;
+                    break;
                 }
+                local_prev_ptr = &(local_job->next_job);
+                local_job = local_job->next_job;
             }
-            enough_threads = threads_available >= job->task.min_threads;
-
-            if (!enough_threads) {
-                log_message("Not enough threads for job " << job->task.name << " available: " << threads_available << " min_threads: " << job->task.min_threads);
-            }
-            bool can_use_this_thread_stack = !owned_job || (job->siblings == owned_job->siblings) || job->task.min_threads == 0;
-            if (!can_use_this_thread_stack) {
-                log_message("Cannot run job " << job->task.name << " on this thread.");
-            }
-            bool can_add_worker = (!job->task.serial || (job->active_workers == 0));
-            if (!can_add_worker) {
-                log_message("Cannot add worker to job " << job->task.name);
-            }
+        }
 
-            if (enough_threads && can_use_this_thread_stack && can_add_worker) {
+        // Otherwise find a job to run, prefering things near the top of the stack.
+        while (job && !found_local_job) {
+            print_job(job, "", "Considering job ");
+            if (job_can_start(work_queue, job, owned_job)) {
                 if (job->make_runnable()) {
                     break;
                 } else {
                     log_message("Cannot acquire semaphores for " << job->task.name);
+                    if (!blocked_on_semaphores) {
+                        blocked_job_name = job->task.name;
+                    }
+                    blocked_on_semaphores = true;
                 }
             }
             prev_ptr = &(job->next_job);
@@ -283,37 +516,58 @@ WEAK void worker_thread_already_locked(work *owned_job) {
         if (!job) {
             // There is no runnable job. Go to sleep.
             if (owned_job) {
-                if (spin_count++ < max_spin_count) {
+                if (spin_count < work_queue.spin_limit) {
                     // Give the workers a chance to finish up before sleeping
+                    spin_count++;
+                    stats_timer timer(work_queue);
                     halide_mutex_unlock(&work_queue.mutex);
                     halide_thread_yield();
                     halide_mutex_lock(&work_queue.mutex);
+                    timer.finish(work_queue, &stats->spin_ns);
                 } else {
+                    if (spin_count != sleeping_spin_count) {
+                        work_queue.spin_failed();
+                        spin_count = sleeping_spin_count;
+                    }
                     work_queue.owners_sleeping++;
                     owned_job->owner_is_sleeping = true;
-                    halide_cond_wait(&work_queue.wake_owners, &work_queue.mutex);
+                    stats_timer timer(work_queue);
+                    work_queue_wait(work_queue, &work_queue.wake_owners, blocked_on_semaphores, blocked_job_name);
+                    timer.finish(work_queue, blocked_on_semaphores ? &stats->blocked_ns : &stats->idle_ns);
                     owned_job->owner_is_sleeping = false;
                     work_queue.owners_sleeping--;
                 }
             } else {
                 work_queue.workers_sleeping++;
+                stats_timer timer(work_queue);
+                uint64_t *stat = blocked_on_semaphores ? &stats->blocked_ns : &stats->idle_ns;
                 if (work_queue.a_team_size > work_queue.target_a_team_size) {
                     // Transition to B team
                     work_queue.a_team_size--;
                     halide_cond_wait(&work_queue.wake_b_team, &work_queue.mutex);
                     work_queue.a_team_size++;
-                } else if (spin_count++ < max_spin_count) {
+                } else if (spin_count < work_queue.spin_limit) {
                     // Spin waiting for new work
+                    spin_count++;
+                    stat = &stats->spin_ns;
                     halide_mutex_unlock(&work_queue.mutex);
                     halide_thread_yield();
                     halide_mutex_lock(&work_queue.mutex);
                 } else {
-                    halide_cond_wait(&work_queue.wake_a_team, &work_queue.mutex);
+                    if (spin_count != sleeping_spin_count) {
+                        work_queue.spin_failed();
+                        spin_count = sleeping_spin_count;
+                    }
+                    work_queue_wait(work_queue, &work_queue.wake_a_team, blocked_on_semaphores, blocked_job_name);
                 }
+                timer.finish(work_queue, stat);
                 work_queue.workers_sleeping--;
             }
             continue;
         } else {
+            if (spin_count != 0 && spin_count != sleeping_spin_count) {
+                work_queue.spin_succeeded(spin_count);
+            }
             spin_count = 0;
         }
 
@@ -339,6 +593,7 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             *prev_ptr = job->next_job;
 
             // Release the lock and do the task.
+            stats_timer timer(work_queue);
             halide_mutex_unlock(&work_queue.mutex);
             int total_iters = 0;
             int iters = 1;
@@ -353,13 +608,18 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 }
 
                 // Do them
-                result = halide_do_loop_task(job->user_context, job->task.fn,
-                                             job->task.min + total_iters, iters,
-                                             job->task.closure, job);
+                {
+                    ScopedTimelineSpan span(TimelineTask, job->task.name, job->task.min + total_iters, iters);
+                    result = halide_do_loop_task(job->user_context, job->task.fn,
+                                                 job->task.min + total_iters, iters,
+                                                 job->task.closure, job);
+                }
                 total_iters += iters;
                 iters = 0;
             }
+            timer.lap();
             halide_mutex_lock(&work_queue.mutex);
+            timer.finish(work_queue, &stats->busy_ns, &stats->lock_wait_ns);
 
             job->task.min += total_iters;
             job->task.extent -= total_iters;
@@ -372,10 +632,11 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 work_queue.jobs = job;
             }
         } else {
-            // Claim a task from it.
+            // Claim some tasks from it.
+            int iters = iterations_to_claim(work_queue, job);
             work myjob = *job;
-            job->task.min++;
-            job->task.extent--;
+            job->task.min += iters;
+            job->task.extent -= iters;
 
             // If there were no more tasks pending for this job, remove it
             // from the stack.
@@ -383,17 +644,29 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 *prev_ptr = job->next_job;
             }
 
-            // Release the lock and do the task.
+            // Release the lock and do the tasks.
+            stats_timer timer(work_queue);
             halide_mutex_unlock(&work_queue.mutex);
-            if (myjob.task_fn) {
-                result = halide_do_task(myjob.user_context, myjob.task_fn,
-                                        myjob.task.min, myjob.task.closure);
-            } else {
-                result = halide_do_loop_task(myjob.user_context, myjob.task.fn,
-                                             myjob.task.min, 1,
-                                             myjob.task.closure, job);
+            {
+                ScopedTimelineSpan span(TimelineTask, myjob.task.name, myjob.task.min, iters);
+                if (myjob.task_fn) {
+                    for (int i = 0; i < iters && result == halide_error_code_success; i++) {
+                        result = halide_do_task(myjob.user_context, myjob.task_fn,
+                                                myjob.task.min + i, myjob.task.closure);
+                    }
+                } else {
+                    result = halide_do_loop_task(myjob.user_context, myjob.task.fn,
+                                                 myjob.task.min, iters,
+                                                 myjob.task.closure, job);
+                }
             }
+            timer.lap();
             halide_mutex_lock(&work_queue.mutex);
+            timer.finish(work_queue, &stats->busy_ns, &stats->lock_wait_ns);
+        }
+
+        if (work_queue.stats_enabled) {
+            stats->tasks++;
         }
 
         if (result != halide_error_code_success) {
@@ -427,6 +700,9 @@ WEAK void worker_thread_already_locked(work *owned_job) {
         // We are no longer active on this job
         job->active_workers--;
 
+        last_siblings = job->siblings;
+        last_locality_group = job->task.locality_group;
+
         log_message("Done working on job " << job->task.name);
 
         if (wake_owners ||
@@ -437,13 +713,28 @@ WEAK void worker_thread_already_locked(work *owned_job) {
     }
 }
 
-WEAK void worker_thread(void *arg) {
+// Entry point for the threads spawned by a work queue. The argument
+// is the work queue.
+WEAK void spawned_worker_thread(void *arg) {
+    work_queue_t &work_queue = *(work_queue_t *)arg;
     halide_mutex_lock(&work_queue.mutex);
-    worker_thread_already_locked((work *)arg);
+    int worker_index = work_queue.threads_started++;
+    int num_threads = work_queue.desired_threads_working;
+    int priority = work_queue.priority;
+    halide_mutex_unlock(&work_queue.mutex);
+
+    pin_worker_thread(worker_index, num_threads);
+    if (priority == halide_thread_pool_priority_low &&
+        !halide_set_thread_low_priority()) {
+        log_message("Could not lower the priority of worker " << worker_index);
+    }
+
+    halide_mutex_lock(&work_queue.mutex);
+    worker_thread_already_locked(work_queue, nullptr, &work_queue.worker_stats[worker_index]);
     halide_mutex_unlock(&work_queue.mutex);
 }
 
-WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_parent) {
+WEAK void enqueue_work_already_locked(work_queue_t &work_queue, int num_jobs, work *jobs, work *task_parent) {
     if (!work_queue.initialized) {
         work_queue.assert_zeroed();
 
@@ -454,9 +745,25 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
             work_queue.desired_threads_working = default_desired_num_threads();
         }
         work_queue.desired_threads_working = clamp_num_threads(work_queue.desired_threads_working);
+        if (!work_queue.chunking_policy_set) {
+            work_queue.chunking_policy = default_parallel_chunking_policy();
+            work_queue.chunking_policy_set = true;
+        }
+        if (!work_queue.stats_enabled_set) {
+            work_queue.stats_enabled = default_thread_pool_stats_enabled();
+            work_queue.stats_enabled_set = true;
+            if (work_queue.stats_enabled) {
+                thread_pool_start_clock();
+            }
+        }
+        work_queue.spin_limit = work_queue_t::initial_spin_limit;
         work_queue.initialized = true;
     }
 
+    // New work arriving starts a new period of activity for the
+    // purpose of adapting the spin limit.
+    work_queue.spin_limit_decayed = false;
+
     // Gather some information about the work.
 
     // Some tasks require a minimum number of threads to make forward
@@ -513,8 +820,9 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
             // We might need to make some new threads, if work_queue.desired_threads_working has
             // increased, or if there aren't enough threads to complete this new task.
             work_queue.a_team_size++;
-            work_queue.threads[work_queue.threads_created++] =
-                halide_spawn_thread(worker_thread, nullptr);
+            work_queue.threads[work_queue.threads_created] =
+                halide_spawn_thread(spawned_worker_thread, &work_queue);
+            work_queue.threads_created++;
         }
         log_message("enqueue_work_already_locked top level job " << jobs[0].task.name << " with min_threads " << min_threads << " work_queue.threads_created " << work_queue.threads_created << " work_queue.threads_reserved " << work_queue.threads_reserved);
         if (job_has_acquires || job_may_block) {
@@ -541,6 +849,17 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
         work_queue.jobs = jobs + i;
     }
 
+    if (work_queue.stats_enabled) {
+        work_queue.jobs_enqueued += num_jobs;
+        int depth = 0;
+        for (work *job = work_queue.jobs; job; job = job->next_job) {
+            depth++;
+        }
+        if (depth > work_queue.max_queue_depth) {
+            work_queue.max_queue_depth = depth;
+        }
+    }
+
     bool nested_parallelism =
         work_queue.owners_sleeping ||
         (work_queue.workers_sleeping < work_queue.threads_created);
@@ -571,6 +890,345 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
     }
 }
 
+// An alternative pool for halide_do_par_for, selectable via
+// halide_set_custom_parallel_runtime. Rather than having every thread
+// claim loop iterations one at a time from the shared job stack under
+// the work queue mutex, each job splits its range up front into one
+// slot per thread. A slot is a contiguous range of iterations that
+// acts as a deque: the thread that owns it pops iterations off the
+// front, and threads whose own slot has run dry steal the back half
+// of someone else's. Slots are packed into 64 bits so that pushes,
+// pops and steals are all a single CAS. The pool mutex is only taken
+// to publish or retire a job and to sleep.
+struct ws_job {
+    halide_task_t fn;
+    void *user_context;
+    uint8_t *closure;
+    int min;
+
+    // Each slot holds a half-open range [begin, end) of iteration
+    // offsets relative to min, with begin in the low 32 bits.
+    uint64_t slots[MAX_THREADS + 1];
+
+    // The number of slots in use, and the next slot to hand out to a
+    // thread that joins this job. Only modified while the pool is
+    // locked.
+    int num_slots;
+    int next_slot;
+
+    // The number of threads other than the owner currently working
+    // on this job. Protected by the pool mutex.
+    int active_workers;
+
+    int exit_status;
+    bool owner_is_sleeping;
+
+    // If true, each worker always works from the slot matching its
+    // index, so that the same threads handle the same slices of every
+    // loop. Used when threads are pinned, to keep slices local to a
+    // NUMA node.
+    bool slots_follow_workers;
+
+    ws_job *next_job;
+};
+
+struct ws_queue_t {
+    // all fields are protected by this mutex.
+    halide_mutex mutex;
+
+    // The desired number threads doing work (HL_NUM_THREADS).
+    int desired_threads_working;
+
+    // All fields after this must be zero in the initial state. See assert_zeroed
+    // Field serves both to mark the offset in struct and as layout padding.
+    int zero_marker;
+
+    // Singly linked list of jobs with iterations that may be stolen.
+    ws_job *jobs;
+
+    int threads_created;
+
+    // Workers sleep on wake_workers while there is nothing to steal,
+    // and job owners sleep on wake_owners while waiting for workers
+    // to finish the iterations they have claimed.
+    halide_cond wake_workers, wake_owners;
+
+    // The number of sleeping workers. An over-estimate - a waking-up
+    // thread may not have decremented this yet.
+    int workers_sleeping;
+
+    halide_thread *threads[MAX_THREADS];
+
+    bool shutdown, initialized;
+
+    // Used to check initial state is correct.
+    ALWAYS_INLINE void assert_zeroed() const {
+        const char *bytes = ((const char *)&this->zero_marker);
+        const char *limit = ((const char *)this) + sizeof(ws_queue_t);
+        while (bytes < limit && *bytes == 0) {
+            bytes++;
+        }
+        halide_abort_if_false(nullptr, bytes == limit && "Logic error in work-stealing thread pool initialization.\n");
+    }
+
+    // Return the queue to initial state. Must be called while locked
+    // and queue will remain locked.
+    ALWAYS_INLINE void reset() {
+        char *bytes = ((char *)&this->zero_marker);
+        char *limit = ((char *)this) + sizeof(ws_queue_t);
+        memset(bytes, 0, limit - bytes);
+    }
+};
+
+WEAK ws_queue_t ws_queue = {};
+
+ALWAYS_INLINE uint64_t ws_make_range(uint32_t begin, uint32_t end) {
+    return (uint64_t)begin | ((uint64_t)end << 32);
+}
+
+ALWAYS_INLINE bool ws_range_empty(uint64_t range) {
+    return (uint32_t)range >= (uint32_t)(range >> 32);
+}
+
+// Pop a single iteration off the front of a slot.
+WEAK bool ws_pop(ws_job *job, int slot, uint32_t *idx) {
+    using namespace Synchronization;
+    uint64_t expected;
+    atomic_load_relaxed(&job->slots[slot], &expected);
+    while (!ws_range_empty(expected)) {
+        uint32_t begin = (uint32_t)expected;
+        uint64_t desired = ws_make_range(begin + 1, (uint32_t)(expected >> 32));
+        if (atomic_cas_weak_relacq_relaxed(&job->slots[slot], &expected, &desired)) {
+            *idx = begin;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Steal the back half of some other slot and move it into our own,
+// which must be empty. Only the owner of a slot ever refills it, and
+// no other thread modifies an empty slot, so a plain store suffices.
+WEAK bool ws_steal(ws_job *job, int slot) {
+    using namespace Synchronization;
+    int num_slots;
+    atomic_load_acquire(&job->num_slots, &num_slots);
+    for (int i = 1; i < num_slots; i++) {
+        int victim = (slot + i) % num_slots;
+        uint64_t expected;
+        atomic_load_relaxed(&job->slots[victim], &expected);
+        while (!ws_range_empty(expected)) {
+            uint32_t begin = (uint32_t)expected;
+            uint32_t end = (uint32_t)(expected >> 32);
+            uint32_t stolen = (end - begin + 1) / 2;
+            uint64_t desired = ws_make_range(begin, end - stolen);
+            if (atomic_cas_weak_relacq_relaxed(&job->slots[victim], &expected, &desired)) {
+                uint64_t mine = ws_make_range(end - stolen, end);
+                atomic_store_release(&job->slots[slot], &mine);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+WEAK bool ws_job_has_work(ws_job *job) {
+    using namespace Synchronization;
+    int exit_status;
+    atomic_load_relaxed(&job->exit_status, &exit_status);
+    if (exit_status != halide_error_code_success) {
+        return false;
+    }
+    for (int i = 0; i < job->num_slots; i++) {
+        uint64_t range;
+        atomic_load_relaxed(&job->slots[i], &range);
+        if (!ws_range_empty(range)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Run iterations from the given slot, stealing when it runs dry,
+// until there is nothing left to steal or an iteration fails. Called
+// without the pool lock held.
+WEAK void ws_run_job(ws_job *job, int slot) {
+    using namespace Synchronization;
+    ScopedTimelineSpan span(TimelineTask, nullptr);
+    while (true) {
+        int exit_status;
+        atomic_load_relaxed(&job->exit_status, &exit_status);
+        if (exit_status != halide_error_code_success) {
+            return;
+        }
+        uint32_t idx;
+        if (!ws_pop(job, slot, &idx)) {
+            if (ws_steal(job, slot)) {
+                continue;
+            }
+            return;
+        }
+        int result = halide_do_task(job->user_context, job->fn, job->min + (int)idx, job->closure);
+        if (result != halide_error_code_success) {
+            log_message("Work-stealing pool saw error from task: " << (int)result);
+            atomic_store_release(&job->exit_status, &result);
+            return;
+        }
+    }
+}
+
+// Pick the slot a worker should use to join a job, or return -1 if it
+// can't join. Must be called with the pool locked.
+WEAK int ws_slot_for_worker(const ws_job *job, int worker_index) {
+    if (job->slots_follow_workers) {
+        return worker_index + 1 < job->num_slots ? worker_index + 1 : -1;
+    } else if (job->next_slot < job->num_slots) {
+        // Take one of the slots the job was split into.
+        return job->next_slot;
+    } else if (job->num_slots < MAX_THREADS + 1) {
+        // Start a fresh empty one to steal into.
+        return job->num_slots;
+    } else {
+        return -1;
+    }
+}
+
+WEAK void ws_worker_thread(void *arg) {
+    // Workers beyond the desired thread count stay asleep, so that
+    // halide_set_num_threads can shrink the pool.
+    int worker_index = (int)(intptr_t)arg;
+    int spin_count = 0;
+    const int max_spin_count = 40;
+
+    halide_mutex_lock(&ws_queue.mutex);
+    int num_threads = ws_queue.desired_threads_working;
+    halide_mutex_unlock(&ws_queue.mutex);
+    pin_worker_thread(worker_index, num_threads);
+
+    halide_mutex_lock(&ws_queue.mutex);
+    while (!ws_queue.shutdown) {
+        ws_job *job = nullptr;
+        int slot = -1;
+        if (worker_index < ws_queue.desired_threads_working - 1) {
+            for (job = ws_queue.jobs; job; job = job->next_job) {
+                slot = ws_slot_for_worker(job, worker_index);
+                if (slot >= 0 && ws_job_has_work(job)) {
+                    break;
+                }
+            }
+        }
+
+        if (!job) {
+            ws_queue.workers_sleeping++;
+            if (spin_count++ < max_spin_count) {
+                // Spin waiting for new work
+                halide_mutex_unlock(&ws_queue.mutex);
+                halide_thread_yield();
+                halide_mutex_lock(&ws_queue.mutex);
+            } else {
+                halide_cond_wait(&ws_queue.wake_workers, &ws_queue.mutex);
+            }
+            ws_queue.workers_sleeping--;
+            continue;
+        }
+        spin_count = 0;
+
+        if (!job->slots_follow_workers) {
+            if (slot == job->num_slots) {
+                uint64_t empty = 0;
+                Synchronization::atomic_store_release(&job->slots[slot], &empty);
+                int num_slots = slot + 1;
+                Synchronization::atomic_store_release(&job->num_slots, &num_slots);
+            }
+            job->next_slot = slot + 1;
+        }
+        job->active_workers++;
+
+        halide_mutex_unlock(&ws_queue.mutex);
+        ws_run_job(job, slot);
+        halide_mutex_lock(&ws_queue.mutex);
+
+        job->active_workers--;
+        if (job->active_workers == 0 && job->owner_is_sleeping) {
+            halide_cond_broadcast(&ws_queue.wake_owners);
+        }
+    }
+    halide_mutex_unlock(&ws_queue.mutex);
+}
+
+// The pools made by halide_thread_pool_create, and the user_contexts
+// bound to them.
+struct pool_binding {
+    void *user_context;
+    work_queue_t *work_queue;
+    pool_binding *next;
+};
+
+struct pool_registry_t {
+    // Protects the lists below, and is never held while waiting on a
+    // work queue.
+    halide_mutex mutex;
+    work_queue_t *pools;
+    pool_binding *bindings;
+
+    // Read without the mutex, so that when nothing has been created
+    // finding the work queue for a call costs nothing.
+    int num_pools, num_bindings;
+};
+
+WEAK pool_registry_t pool_registry = {};
+
+WEAK work_queue_t &work_queue_for(void *user_context) {
+    int num_bindings;
+    Synchronization::atomic_load_relaxed(&pool_registry.num_bindings, &num_bindings);
+    if (num_bindings == 0) {
+        return default_work_queue;
+    }
+    work_queue_t *result = &default_work_queue;
+    halide_mutex_lock(&pool_registry.mutex);
+    for (pool_binding *b = pool_registry.bindings; b; b = b->next) {
+        if (b->user_context == user_context) {
+            result = b->work_queue;
+            break;
+        }
+    }
+    halide_mutex_unlock(&pool_registry.mutex);
+    return *result;
+}
+
+// Wake everything sleeping on a work queue, e.g. because a semaphore
+// release may have made one of its jobs runnable.
+WEAK void wake_work_queue(work_queue_t &work_queue) {
+    halide_mutex_lock(&work_queue.mutex);
+    halide_cond_broadcast(&work_queue.wake_a_team);
+    halide_cond_broadcast(&work_queue.wake_owners);
+    halide_mutex_unlock(&work_queue.mutex);
+}
+
+// Join all the threads of a work queue and return it to its initial
+// state. Nothing may be running on it.
+WEAK void shutdown_work_queue(work_queue_t &work_queue) {
+    if (work_queue.initialized) {
+        // Wake everyone up and tell them the party's over and it's time
+        // to go home
+        halide_mutex_lock(&work_queue.mutex);
+
+        work_queue.shutdown = true;
+        halide_cond_broadcast(&work_queue.wake_owners);
+        halide_cond_broadcast(&work_queue.wake_a_team);
+        halide_cond_broadcast(&work_queue.wake_b_team);
+        halide_mutex_unlock(&work_queue.mutex);
+
+        // Wait until they leave
+        for (int i = 0; i < work_queue.threads_created; i++) {
+            halide_join_thread(work_queue.threads[i]);
+        }
+
+        // Tidy up
+        work_queue.reset();
+    }
+}
+
 WEAK halide_do_task_t custom_do_task = halide_default_do_task;
 WEAK halide_do_loop_task_t custom_do_loop_task = halide_default_do_loop_task;
 WEAK halide_do_par_for_t custom_do_par_for = halide_default_do_par_for;
@@ -583,6 +1241,31 @@ WEAK halide_semaphore_release_t custom_semaphore_release = halide_default_semaph
 }  // namespace Runtime
 }  // namespace Halide
 
+// A call to a pipeline started by halide_call_async.
+struct halide_async_call_t {
+    int (*fn)(void **);
+    void **args;
+    halide_thread *thread;
+    int result;
+    // Set with release semantics once result has been written.
+    int done;
+};
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+WEAK void async_call_thread(void *closure) {
+    halide_async_call_t *call = (halide_async_call_t *)closure;
+    call->result = call->fn(call->args);
+    int done = 1;
+    Synchronization::atomic_store_release(&call->done, &done);
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
 using namespace Halide::Runtime::Internal;
 
 extern "C" {
@@ -620,6 +1303,8 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     job.task.closure = closure;
     job.task.min_threads = 0;
     job.task.name = nullptr;
+    job.task.priority = 0;
+    job.task.locality_group = 0;
     job.task_fn = f;
     job.user_context = user_context;
     job.exit_status = halide_error_code_success;
@@ -629,9 +1314,10 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     job.siblings = &job;  // guarantees no other job points to the same siblings.
     job.sibling_count = 0;
     job.parent_job = nullptr;
+    work_queue_t &work_queue = work_queue_for(user_context);
     halide_mutex_lock(&work_queue.mutex);
-    enqueue_work_already_locked(1, &job, nullptr);
-    worker_thread_already_locked(&job);
+    enqueue_work_already_locked(work_queue, 1, &job, nullptr);
+    worker_thread_already_locked(work_queue, &job, &work_queue.caller_stats);
     halide_mutex_unlock(&work_queue.mutex);
     return job.exit_status;
 }
@@ -661,13 +1347,25 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
         return halide_error_code_success;
     }
 
+    // Put the tasks with the highest priority on top of the job
+    // stack. The sort is stable, so tasks of equal priority keep the
+    // order they were lowered in.
+    for (int i = 1; i < num_tasks; i++) {
+        for (int j = i; j > 0 && jobs[j].task.priority > jobs[j - 1].task.priority; j--) {
+            work tmp = jobs[j];
+            jobs[j] = jobs[j - 1];
+            jobs[j - 1] = tmp;
+        }
+    }
+
+    work_queue_t &work_queue = work_queue_for(user_context);
     halide_mutex_lock(&work_queue.mutex);
-    enqueue_work_already_locked(num_tasks, jobs, (work *)task_parent);
+    enqueue_work_already_locked(work_queue, num_tasks, jobs, (work *)task_parent);
     int exit_status = halide_error_code_success;
     for (int i = 0; i < num_tasks; i++) {
         // It doesn't matter what order we join the tasks in, because
         // we'll happily assist with siblings too.
-        worker_thread_already_locked(jobs + i);
+        worker_thread_already_locked(work_queue, jobs + i, &work_queue.caller_stats);
         if (jobs[i].exit_status != halide_error_code_success) {
             exit_status = jobs[i].exit_status;
         }
@@ -676,6 +1374,83 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
     return exit_status;
 }
 
+WEAK int halide_work_stealing_do_par_for(void *user_context, halide_task_t f,
+                                         int min, int size, uint8_t *closure) {
+    if (size <= 0) {
+        return halide_error_code_success;
+    }
+
+    ws_job job;
+    job.fn = f;
+    job.user_context = user_context;
+    job.closure = closure;
+    job.min = min;
+    job.active_workers = 0;
+    job.exit_status = halide_error_code_success;
+    job.owner_is_sleeping = false;
+    job.slots_follow_workers = current_thread_affinity() != halide_thread_affinity_none;
+
+    halide_mutex_lock(&ws_queue.mutex);
+    if (!ws_queue.initialized) {
+        ws_queue.assert_zeroed();
+        if (!ws_queue.desired_threads_working) {
+            ws_queue.desired_threads_working = default_desired_num_threads();
+        }
+        ws_queue.desired_threads_working = clamp_num_threads(ws_queue.desired_threads_working);
+        ws_queue.initialized = true;
+    }
+
+    while (ws_queue.threads_created < ws_queue.desired_threads_working - 1) {
+        ws_queue.threads[ws_queue.threads_created] =
+            halide_spawn_thread(ws_worker_thread, (void *)(intptr_t)ws_queue.threads_created);
+        ws_queue.threads_created++;
+    }
+
+    // Split the range evenly across the calling thread and the
+    // workers. The calling thread takes the first slot.
+    int num_slots = ws_queue.desired_threads_working;
+    if (num_slots > size) {
+        num_slots = size;
+    }
+    for (int i = 0; i < num_slots; i++) {
+        uint32_t begin = (uint32_t)(((int64_t)size * i) / num_slots);
+        uint32_t end = (uint32_t)(((int64_t)size * (i + 1)) / num_slots);
+        job.slots[i] = ws_make_range(begin, end);
+    }
+    job.num_slots = num_slots;
+    job.next_slot = 1;
+
+    if (num_slots > 1) {
+        job.next_job = ws_queue.jobs;
+        ws_queue.jobs = &job;
+        if (ws_queue.workers_sleeping) {
+            halide_cond_broadcast(&ws_queue.wake_workers);
+        }
+    }
+    halide_mutex_unlock(&ws_queue.mutex);
+
+    ws_run_job(&job, 0);
+
+    if (num_slots > 1) {
+        halide_mutex_lock(&ws_queue.mutex);
+        // Retire the job so no more workers join, then wait for the
+        // ones still working on iterations they have claimed.
+        ws_job **prev_ptr = &ws_queue.jobs;
+        while (*prev_ptr != &job) {
+            prev_ptr = &(*prev_ptr)->next_job;
+        }
+        *prev_ptr = job.next_job;
+        while (job.active_workers > 0) {
+            job.owner_is_sleeping = true;
+            halide_cond_wait(&ws_queue.wake_owners, &ws_queue.mutex);
+            job.owner_is_sleeping = false;
+        }
+        halide_mutex_unlock(&ws_queue.mutex);
+    }
+
+    return job.exit_status;
+}
+
 WEAK int halide_set_num_threads(int n) {
     if (n < 0) {
         halide_error(nullptr, "halide_set_num_threads: must be >= 0.");
@@ -683,36 +1458,196 @@ WEAK int halide_set_num_threads(int n) {
     // Don't make this an atomic swap - we don't want to be changing
     // the desired number of threads while another thread is in the
     // middle of a sequence of non-atomic operations.
-    halide_mutex_lock(&work_queue.mutex);
+    halide_mutex_lock(&default_work_queue.mutex);
     if (n == 0) {
         n = default_desired_num_threads();
     }
-    int old = work_queue.desired_threads_working;
-    work_queue.desired_threads_working = clamp_num_threads(n);
-    halide_mutex_unlock(&work_queue.mutex);
+    int old = default_work_queue.desired_threads_working;
+    default_work_queue.desired_threads_working = clamp_num_threads(n);
+    halide_mutex_unlock(&default_work_queue.mutex);
+
+    halide_mutex_lock(&ws_queue.mutex);
+    ws_queue.desired_threads_working = clamp_num_threads(n);
+    // Extra workers go back to sleep on their own, but sleeping ones
+    // need waking if the pool is growing.
+    halide_cond_broadcast(&ws_queue.wake_workers);
+    halide_mutex_unlock(&ws_queue.mutex);
+    return old;
+}
+
+WEAK halide_parallel_chunking_policy_t halide_set_parallel_chunking_policy(halide_parallel_chunking_policy_t policy) {
+    halide_mutex_lock(&default_work_queue.mutex);
+    halide_parallel_chunking_policy_t old = default_work_queue.chunking_policy_set ?
+                                                default_work_queue.chunking_policy :
+                                                default_parallel_chunking_policy();
+    default_work_queue.chunking_policy = policy;
+    default_work_queue.chunking_policy_set = true;
+    halide_mutex_unlock(&default_work_queue.mutex);
+    return old;
+}
+
+WEAK halide_thread_affinity_t halide_set_thread_affinity(halide_thread_affinity_t affinity) {
+    halide_thread_affinity_t old = current_thread_affinity();
+    int new_affinity = affinity;
+    Synchronization::atomic_store_release(&thread_affinity, &new_affinity);
     return old;
 }
 
 WEAK void halide_shutdown_thread_pool() {
-    if (work_queue.initialized) {
-        // Wake everyone up and tell them the party's over and it's time
-        // to go home
-        halide_mutex_lock(&work_queue.mutex);
+    shutdown_work_queue(default_work_queue);
 
-        work_queue.shutdown = true;
-        halide_cond_broadcast(&work_queue.wake_owners);
-        halide_cond_broadcast(&work_queue.wake_a_team);
-        halide_cond_broadcast(&work_queue.wake_b_team);
-        halide_mutex_unlock(&work_queue.mutex);
+    if (ws_queue.initialized) {
+        halide_mutex_lock(&ws_queue.mutex);
+        ws_queue.shutdown = true;
+        halide_cond_broadcast(&ws_queue.wake_workers);
+        halide_mutex_unlock(&ws_queue.mutex);
 
-        // Wait until they leave
-        for (int i = 0; i < work_queue.threads_created; i++) {
-            halide_join_thread(work_queue.threads[i]);
+        for (int i = 0; i < ws_queue.threads_created; i++) {
+            halide_join_thread(ws_queue.threads[i]);
         }
 
-        // Tidy up
-        work_queue.reset();
+        ws_queue.reset();
+    }
+}
+
+WEAK halide_thread_pool_t *halide_thread_pool_create(int num_threads,
+                                                     halide_thread_pool_priority_t priority) {
+    if (num_threads < 0) {
+        halide_error(nullptr, "halide_thread_pool_create: num_threads must be >= 0.");
+        return nullptr;
+    }
+    work_queue_t *pool = (work_queue_t *)malloc(sizeof(work_queue_t));
+    if (!pool) {
+        return nullptr;
+    }
+    memset(pool, 0, sizeof(work_queue_t));
+    pool->desired_threads_working = clamp_num_threads(num_threads ? num_threads : default_desired_num_threads());
+    pool->priority = priority;
+
+    halide_mutex_lock(&pool_registry.mutex);
+    pool->next_pool = pool_registry.pools;
+    pool_registry.pools = pool;
+    int num_pools = pool_registry.num_pools + 1;
+    Synchronization::atomic_store_release(&pool_registry.num_pools, &num_pools);
+    halide_mutex_unlock(&pool_registry.mutex);
+    return (halide_thread_pool_t *)pool;
+}
+
+WEAK void halide_thread_pool_destroy(halide_thread_pool_t *p) {
+    if (!p) {
+        return;
+    }
+    work_queue_t *pool = (work_queue_t *)p;
+
+    halide_mutex_lock(&pool_registry.mutex);
+    work_queue_t **prev_pool = &pool_registry.pools;
+    while (*prev_pool && *prev_pool != pool) {
+        prev_pool = &(*prev_pool)->next_pool;
+    }
+    if (*prev_pool) {
+        *prev_pool = pool->next_pool;
+        int num_pools = pool_registry.num_pools - 1;
+        Synchronization::atomic_store_release(&pool_registry.num_pools, &num_pools);
+    }
+    int num_bindings = pool_registry.num_bindings;
+    pool_binding **prev_binding = &pool_registry.bindings;
+    while (*prev_binding) {
+        pool_binding *b = *prev_binding;
+        if (b->work_queue == pool) {
+            *prev_binding = b->next;
+            free(b);
+            num_bindings--;
+        } else {
+            prev_binding = &b->next;
+        }
+    }
+    Synchronization::atomic_store_release(&pool_registry.num_bindings, &num_bindings);
+    halide_mutex_unlock(&pool_registry.mutex);
+
+    // The pool is now unreachable, so its threads can be joined
+    // without holding the registry mutex.
+    shutdown_work_queue(*pool);
+    free(pool);
+}
+
+WEAK int halide_thread_pool_bind(void *user_context, halide_thread_pool_t *p) {
+    work_queue_t *pool = (work_queue_t *)p;
+    int result = halide_error_code_success;
+
+    halide_mutex_lock(&pool_registry.mutex);
+    int num_bindings = pool_registry.num_bindings;
+    pool_binding **prev_binding = &pool_registry.bindings;
+    while (*prev_binding && (*prev_binding)->user_context != user_context) {
+        prev_binding = &(*prev_binding)->next;
+    }
+    if (*prev_binding) {
+        if (pool) {
+            (*prev_binding)->work_queue = pool;
+        } else {
+            pool_binding *b = *prev_binding;
+            *prev_binding = b->next;
+            free(b);
+            num_bindings--;
+        }
+    } else if (pool) {
+        pool_binding *b = (pool_binding *)malloc(sizeof(pool_binding));
+        if (b) {
+            b->user_context = user_context;
+            b->work_queue = pool;
+            b->next = pool_registry.bindings;
+            pool_registry.bindings = b;
+            num_bindings++;
+        } else {
+            result = halide_error_code_out_of_memory;
+        }
+    }
+    Synchronization::atomic_store_release(&pool_registry.num_bindings, &num_bindings);
+    halide_mutex_unlock(&pool_registry.mutex);
+    return result;
+}
+
+WEAK int halide_thread_pool_enable_stats(halide_thread_pool_t *pool, bool enable) {
+    work_queue_t &work_queue = pool ? *(work_queue_t *)pool : default_work_queue;
+    halide_mutex_lock(&work_queue.mutex);
+    if (enable && !work_queue.stats_enabled) {
+        memset(work_queue.worker_stats, 0, sizeof(work_queue.worker_stats));
+        memset(&work_queue.caller_stats, 0, sizeof(work_queue.caller_stats));
+        work_queue.jobs_enqueued = 0;
+        work_queue.max_queue_depth = 0;
+        thread_pool_start_clock();
     }
+    work_queue.stats_enabled = enable;
+    work_queue.stats_enabled_set = true;
+    halide_mutex_unlock(&work_queue.mutex);
+    return halide_error_code_success;
+}
+
+WEAK int halide_thread_pool_get_stats(halide_thread_pool_t *pool,
+                                      halide_thread_pool_stats_t *stats,
+                                      halide_thread_pool_thread_stats_t *workers,
+                                      int max_workers) {
+    work_queue_t &work_queue = pool ? *(work_queue_t *)pool : default_work_queue;
+    memset(stats, 0, sizeof(*stats));
+    halide_mutex_lock(&work_queue.mutex);
+    stats->enabled = work_queue.stats_enabled;
+    stats->num_workers = work_queue.threads_created;
+    for (int i = 0; i < work_queue.threads_created; i++) {
+        const halide_thread_pool_thread_stats_t &w = work_queue.worker_stats[i];
+        stats->workers_total.busy_ns += w.busy_ns;
+        stats->workers_total.spin_ns += w.spin_ns;
+        stats->workers_total.idle_ns += w.idle_ns;
+        stats->workers_total.blocked_ns += w.blocked_ns;
+        stats->workers_total.lock_wait_ns += w.lock_wait_ns;
+        stats->workers_total.tasks += w.tasks;
+        if (workers && i < max_workers) {
+            workers[i] = w;
+        }
+    }
+    stats->callers = work_queue.caller_stats;
+    stats->jobs_enqueued = work_queue.jobs_enqueued;
+    stats->max_queue_depth = work_queue.max_queue_depth;
+    halide_mutex_unlock(&work_queue.mutex);
+    return halide_error_code_success;
 }
 
 struct halide_semaphore_impl_t {
@@ -730,11 +1665,18 @@ WEAK int halide_default_semaphore_release(halide_semaphore_t *s, int n) {
     int old_val = Halide::Runtime::Internal::Synchronization::atomic_fetch_add_acquire_release(&sem->value, n);
     // TODO(abadams|zvookin): Is this correct if an acquire can be for say count of 2 and the releases are 1 each?
     if (old_val == 0 && n != 0) {  // Don't wake if nothing released.
-        // We may have just made a job runnable
-        halide_mutex_lock(&work_queue.mutex);
-        halide_cond_broadcast(&work_queue.wake_a_team);
-        halide_cond_broadcast(&work_queue.wake_owners);
-        halide_mutex_unlock(&work_queue.mutex);
+        // We may have just made a job runnable. We don't know which
+        // pool the job waiting on this semaphore is in, so wake them all.
+        wake_work_queue(default_work_queue);
+        int num_pools;
+        Synchronization::atomic_load_relaxed(&pool_registry.num_pools, &num_pools);
+        if (num_pools) {
+            halide_mutex_lock(&pool_registry.mutex);
+            for (work_queue_t *pool = pool_registry.pools; pool; pool = pool->next_pool) {
+                wake_work_queue(*pool);
+            }
+            halide_mutex_unlock(&pool_registry.mutex);
+        }
     }
     return old_val + n;
 }
@@ -823,4 +1765,33 @@ WEAK int halide_semaphore_release(struct halide_semaphore_t *sema, int count) {
 WEAK bool halide_semaphore_try_acquire(struct halide_semaphore_t *sema, int count) {
     return custom_semaphore_try_acquire(sema, count);
 }
+
+WEAK int halide_call_async(void *user_context, int (*fn)(void **), void **args,
+                           halide_async_call_t **call) {
+    halide_async_call_t *c = (halide_async_call_t *)malloc(sizeof(halide_async_call_t));
+    if (!c) {
+        *call = nullptr;
+        return halide_error_code_out_of_memory;
+    }
+    c->fn = fn;
+    c->args = args;
+    c->result = halide_error_code_success;
+    c->done = 0;
+    c->thread = halide_spawn_thread(async_call_thread, c);
+    *call = c;
+    return halide_error_code_success;
+}
+
+WEAK bool halide_async_call_done(halide_async_call_t *call) {
+    int done;
+    Synchronization::atomic_load_acquire(&call->done, &done);
+    return done != 0;
+}
+
+WEAK int halide_async_call_wait(halide_async_call_t *call) {
+    halide_join_thread(call->thread);
+    int result = call->result;
+    free(call);
+    return result;
+}
 }
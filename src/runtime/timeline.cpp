@@ -0,0 +1,329 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+#include "timeline.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace Timeline {
+
+struct Event {
+    const char *name;
+    uint64_t thread;
+    int64_t ns;
+    int64_t arg0, arg1;
+    uint8_t category;
+    bool begin;
+};
+
+// Events are kept in a list of fixed-size blocks until the timeline
+// is written. Past max_events we stop recording rather than exhaust
+// memory.
+constexpr int events_per_block = 4096;
+constexpr uint64_t max_events = 1 << 23;
+
+struct EventBlock {
+    EventBlock *next;
+    int count;
+    Event events[events_per_block];
+};
+
+// Names belong to the pipelines that report them, and JIT-compiled
+// pipelines may be freed before the timeline is written, so each
+// name is copied the first time it is seen. The table is keyed by the
+// pointer, with the contents checked in case the memory was reused.
+constexpr int name_table_size = 4096;
+
+struct Name {
+    const char *key;
+    char *copy;
+};
+
+struct Recorder {
+    char *file_name;
+    EventBlock *first, *last;
+    uint64_t num_events, dropped_events;
+    Name names[name_table_size];
+
+    const char *intern(const char *name) {
+        uint32_t h = (uint32_t)(((uintptr_t)name >> 3) * 2654435761u);
+        for (int i = 0; i < name_table_size; i++) {
+            Name &n = names[(h + i) % name_table_size];
+            if (n.key == nullptr) {
+                size_t len = strlen(name) + 1;
+                n.copy = (char *)malloc(len);
+                if (!n.copy) {
+                    return nullptr;
+                }
+                memcpy(n.copy, name, len);
+                n.key = name;
+                return n.copy;
+            } else if (n.key == name && strcmp(n.copy, name) == 0) {
+                return n.copy;
+            }
+        }
+        return nullptr;
+    }
+
+    Event *new_event() {
+        if (num_events >= max_events) {
+            return nullptr;
+        }
+        if (!last || last->count == events_per_block) {
+            EventBlock *b = (EventBlock *)malloc(sizeof(EventBlock));
+            if (!b) {
+                return nullptr;
+            }
+            b->next = nullptr;
+            b->count = 0;
+            if (last) {
+                last->next = b;
+            } else {
+                first = b;
+            }
+            last = b;
+        }
+        num_events++;
+        return &last->events[last->count++];
+    }
+
+    void release() {
+        while (first) {
+            EventBlock *next = first->next;
+            free(first);
+            first = next;
+        }
+        for (Name &n : names) {
+            free(n.copy);
+        }
+        free(file_name);
+        free(this);
+    }
+};
+
+WEAK halide_mutex recorder_mutex;
+WEAK Recorder *recorder = nullptr;
+
+WEAK const char *category_name(int category) {
+    static const char *names[TimelineNumCategories] = {
+        "pipeline",
+        "produce",
+        "consume",
+        "task",
+        "semaphore_wait",
+        "copy_to_device",
+        "copy_to_host",
+        "buffer_copy",
+        "kernel",
+    };
+    return names[category];
+}
+
+WEAK void record(TimelineCategory category, bool begin, const char *name,
+                 int64_t arg0, int64_t arg1) {
+    int64_t ns = halide_current_time_ns(nullptr);
+    uint64_t thread = halide_current_thread_id();
+
+    ScopedMutexLock lock(&recorder_mutex);
+    Recorder *r = recorder;
+    if (!r) {
+        return;
+    }
+    Event *e = r->new_event();
+    if (!e) {
+        r->dropped_events++;
+        return;
+    }
+    // Only the begin of a span needs a name.
+    e->name = (begin && name) ? r->intern(name) : nullptr;
+    e->thread = thread;
+    e->ns = ns;
+    e->arg0 = arg0;
+    e->arg1 = arg1;
+    e->category = (uint8_t)category;
+    e->begin = begin;
+}
+
+// Threads are numbered in the order they first appear, which is
+// easier to read in a timeline viewer than the OS thread ids. Must be
+// zero-initialized.
+struct ThreadNumbering {
+    static constexpr int table_size = 4096;
+    uint64_t ids[table_size];
+    int numbers[table_size];
+    bool used[table_size];
+    int count;
+
+    int number(uint64_t id) {
+        uint32_t h = (uint32_t)((id ^ (id >> 32)) * 2654435761u);
+        for (int i = 0; i < table_size; i++) {
+            int slot = (h + i) % table_size;
+            if (!used[slot]) {
+                used[slot] = true;
+                ids[slot] = id;
+                numbers[slot] = count++;
+                return numbers[slot];
+            } else if (ids[slot] == id) {
+                return numbers[slot];
+            }
+        }
+        return table_size;
+    }
+};
+
+// Append a name to the stream as a JSON string.
+WEAK void write_json_string(StringStreamPrinter<1024> &ss, const char *str) {
+    char escaped[512];
+    char *dst = escaped;
+    char *end = escaped + sizeof(escaped) - 2;
+    *dst++ = '"';
+    for (const char *c = str; *c && dst < end - 1; c++) {
+        if (*c == '"' || *c == '\\') {
+            *dst++ = '\\';
+            *dst++ = *c;
+        } else if ((unsigned char)*c < 0x20) {
+            *dst++ = '?';
+        } else {
+            *dst++ = *c;
+        }
+    }
+    *dst++ = '"';
+    *dst = 0;
+    ss << escaped;
+}
+
+WEAK int write_timeline(Recorder *r) {
+    void *file = halide_fopen(r->file_name, "wb");
+    if (!file) {
+        error(nullptr) << "Failed to open timeline file " << r->file_name << "\n";
+        return halide_error_code_trace_failed;
+    }
+
+    ThreadNumbering *threads = (ThreadNumbering *)malloc(sizeof(ThreadNumbering));
+    if (!threads) {
+        fclose(file);
+        return halide_error_code_out_of_memory;
+    }
+    memset(threads, 0, sizeof(ThreadNumbering));
+
+    bool ok = true;
+    StringStreamPrinter<1024> ss(nullptr);
+    auto emit = [&]() {
+        ok = ok && fwrite(ss.str(), ss.size(), 1, file) == 1;
+        ss.clear();
+    };
+
+    ss << "{\"traceEvents\":[\n";
+    bool first_event = true;
+    for (EventBlock *b = r->first; b; b = b->next) {
+        for (int i = 0; i < b->count; i++) {
+            const Event &e = b->events[i];
+            if (!first_event) {
+                ss << ",\n";
+            }
+            first_event = false;
+            // Chrome trace timestamps are in microseconds.
+            int64_t ns = e.ns < 0 ? 0 : e.ns;
+            ss << "{\"name\":";
+            write_json_string(ss, e.name ? e.name : category_name(e.category));
+            ss << ",\"cat\":\"" << category_name(e.category)
+               << "\",\"ph\":\"" << (e.begin ? "B" : "E")
+               << "\",\"pid\":1,\"tid\":" << threads->number(e.thread)
+               << ",\"ts\":" << (ns / 1000) << ".";
+            int64_t frac = ns % 1000;
+            ss << (frac < 100 ? "0" : "") << (frac < 10 ? "0" : "") << frac;
+            if (e.begin && e.category == TimelineTask && e.arg1 > 0) {
+                ss << ",\"args\":{\"min\":" << e.arg0 << ",\"extent\":" << e.arg1 << "}";
+            } else if (e.begin && (e.category == TimelineCopyToDevice ||
+                                   e.category == TimelineCopyToHost ||
+                                   e.category == TimelineBufferCopy)) {
+                ss << ",\"args\":{\"bytes\":" << e.arg0 << "}";
+            }
+            ss << "}";
+            emit();
+        }
+    }
+    ss << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    emit();
+
+    free(threads);
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (r->dropped_events) {
+        print(nullptr) << "Timeline dropped " << r->dropped_events
+                       << " events past the limit of " << max_events << "\n";
+    }
+    return ok ? halide_error_code_success : halide_error_code_trace_failed;
+}
+
+}  // namespace Timeline
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+using namespace Halide::Runtime::Internal::Timeline;
+
+extern "C" {
+
+WEAK int halide_set_timeline_file(const char *filename) {
+    size_t len = strlen(filename) + 1;
+    char *name = (char *)malloc(len);
+    if (!name) {
+        return halide_error_code_out_of_memory;
+    }
+    memcpy(name, filename, len);
+
+    ScopedMutexLock lock(&recorder_mutex);
+    if (recorder) {
+        free(recorder->file_name);
+        recorder->file_name = name;
+        return halide_error_code_success;
+    }
+    Recorder *r = (Recorder *)malloc(sizeof(Recorder));
+    if (!r) {
+        free(name);
+        return halide_error_code_out_of_memory;
+    }
+    memset(r, 0, sizeof(Recorder));
+    r->file_name = name;
+    halide_start_clock(nullptr);
+    recorder = r;
+    timeline_hook = record;
+    return halide_error_code_success;
+}
+
+WEAK int halide_shutdown_timeline() {
+    Recorder *r;
+    {
+        ScopedMutexLock lock(&recorder_mutex);
+        timeline_hook = nullptr;
+        r = recorder;
+        recorder = nullptr;
+    }
+    if (!r) {
+        return halide_error_code_success;
+    }
+    int result = write_timeline(r);
+    r->release();
+    return result;
+}
+
+namespace {
+
+WEAK __attribute__((constructor)) void halide_timeline_init() {
+    const char *filename = getenv("HL_TIMELINE_FILE");
+    if (filename && *filename) {
+        (void)halide_set_timeline_file(filename);  // ignore errors
+    }
+}
+
+WEAK __attribute__((destructor)) void halide_timeline_cleanup() {
+    (void)halide_shutdown_timeline();  // ignore errors
+}
+
+}  // namespace
+}
@@ -0,0 +1,78 @@
+#ifndef HALIDE_RUNTIME_TIMELINE_H
+#define HALIDE_RUNTIME_TIMELINE_H
+
+#include "HalideRuntime.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// Spans reported to the timeline export (see halide_set_timeline_file).
+// The hook is installed by the timeline module while a timeline is
+// being recorded, and is null otherwise, so reporting a span costs a
+// load and a branch when nothing is listening.
+enum TimelineCategory {
+    TimelinePipeline,
+    TimelineProduce,
+    TimelineConsume,
+    TimelineTask,
+    TimelineSemaphoreWait,
+    TimelineCopyToDevice,
+    TimelineCopyToHost,
+    TimelineBufferCopy,
+    TimelineKernel,
+    TimelineNumCategories,
+};
+
+// Spans are reported as a begin and an end on the same thread, and must
+// nest. The recorder timestamps them. The arguments are the min and
+// extent of a task chunk (with an extent of zero if it isn't known up
+// front), or the size in bytes of a copy.
+typedef void (*timeline_hook_t)(TimelineCategory category, bool begin, const char *name,
+                                int64_t arg0, int64_t arg1);
+extern WEAK timeline_hook_t timeline_hook;
+
+ALWAYS_INLINE void timeline_begin(TimelineCategory category, const char *name,
+                                  int64_t arg0 = 0, int64_t arg1 = 0) {
+    if (timeline_hook) {
+        timeline_hook(category, true, name, arg0, arg1);
+    }
+}
+
+ALWAYS_INLINE void timeline_end(TimelineCategory category, const char *name) {
+    if (timeline_hook) {
+        timeline_hook(category, false, name, 0, 0);
+    }
+}
+
+// Reports a span covering its own lifetime. If recording starts part
+// way through, the end is dropped rather than reported unbalanced.
+class ScopedTimelineSpan {
+    TimelineCategory category;
+    const char *name;
+    bool active;
+
+public:
+    ALWAYS_INLINE ScopedTimelineSpan(TimelineCategory category, const char *name,
+                                     int64_t arg0 = 0, int64_t arg1 = 0)
+        : category(category), name(name), active(timeline_hook != nullptr) {
+        if (active) {
+            timeline_hook(category, true, name, arg0, arg1);
+        }
+    }
+
+    ALWAYS_INLINE ~ScopedTimelineSpan() {
+        if (active) {
+            timeline_end(category, name);
+        }
+    }
+
+    ScopedTimelineSpan(const ScopedTimelineSpan &) = delete;
+    ScopedTimelineSpan &operator=(const ScopedTimelineSpan &) = delete;
+};
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+#endif  // HALIDE_RUNTIME_TIMELINE_H
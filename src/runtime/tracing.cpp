@@ -2,6 +2,7 @@
 #include "printer.h"
 #include "runtime_atomics.h"
 #include "scoped_spin_lock.h"
+#include "timeline.h"
 
 extern "C" {
 
@@ -87,6 +88,287 @@ public:
     SharedExclusiveSpinLock() = default;
 };
 
+// An optional compact encoding of the binary trace stream, enabled by
+// setting HL_TRACE_COMPRESS=1 alongside HL_TRACE_FILE. Events are
+// still written to the TraceBuffer as ordinary packets, so the cost
+// on the traced pipeline is unchanged; the encoding happens on flush,
+// which runs with exclusive access to the buffer and so sees the
+// packets in a single, well-defined order.
+//
+// The compressed stream is a sequence of blocks, each of which starts
+// with a 16-byte header: the magic number (which can never be the
+// size of an ordinary packet, so blocks and plain packets can be
+// mixed in the same file), a flags word, the size of the encoded
+// packets, and the number of bytes stored after the header. The
+// stored bytes are either the encoded packets themselves or an
+// LZ77-style compression of them. Each encoded packet is:
+//
+//   varint func name, varint trace tag (see encode_string)
+//   byte   event | (has nonzero value << 7)
+//   byte   type code, byte type bits, varint type lanes
+//   zigzag id delta from previous packet, zigzag id - parent_id
+//   varint value_index, varint dimensions
+//   zigzag coordinate deltas from the previous packet of that Func
+//   raw value bytes (if nonzero)
+//
+// util/HalideTraceUtils.cpp contains the matching decoder; the
+// constants below must agree with it.
+namespace TraceCompression {
+const uint32_t block_magic = 0x315a5448;  // "HTZ1"
+const uint32_t block_header_size = 16;
+const uint32_t flag_reset = 1;  // Start of a stream: reset the decoder state.
+const uint32_t flag_lz = 2;     // The stored bytes are LZ compressed.
+const int max_delta_coords = 16;
+const int max_strings = 1024;
+const int string_arena_size = 64 * 1024;
+const int string_table_size = 2048;
+const uint32_t block_size = 64 * 1024;
+const int lz_hash_bits = 12;
+}  // namespace TraceCompression
+
+class TraceCompressor {
+    // The encoded packets of the block being built.
+    uint8_t block[TraceCompression::block_size];
+    uint32_t block_used = 0;
+
+    // The header and stored bytes of a block, in the worst case that
+    // compression expands the data.
+    uint8_t out[TraceCompression::block_header_size + TraceCompression::block_size +
+                TraceCompression::block_size / 255 + 16];
+
+    // The dictionary of Func names and trace tags seen so far.
+    char string_arena[TraceCompression::string_arena_size];
+    uint32_t string_arena_used = 0;
+    uint32_t string_start[TraceCompression::max_strings];
+    uint32_t string_length[TraceCompression::max_strings];
+    int num_strings = 0;
+    // Open-addressed hash table of dictionary indices plus one.
+    uint16_t string_table[TraceCompression::string_table_size];
+
+    // The coordinates of the last packet of each dictionary-coded Func.
+    int32_t last_coords[TraceCompression::max_strings][TraceCompression::max_delta_coords];
+    int32_t last_id = 0;
+    bool reset_pending = true;
+
+    uint32_t lz_table[1 << TraceCompression::lz_hash_bits];
+
+    ALWAYS_INLINE static void put_varint(uint8_t *&dst, uint32_t v) {
+        while (v >= 0x80) {
+            *dst++ = (uint8_t)(v | 0x80);
+            v >>= 7;
+        }
+        *dst++ = (uint8_t)v;
+    }
+
+    ALWAYS_INLINE static void put_zigzag(uint8_t *&dst, int32_t v) {
+        put_varint(dst, ((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+    }
+
+    ALWAYS_INLINE static uint32_t load32(const uint8_t *p) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    // Strings are written as 0 followed by the literal when they are
+    // added to the dictionary, 1 followed by the literal when the
+    // dictionary is full, and otherwise as their dictionary index
+    // plus two. Returns the dictionary index, or -1.
+    int encode_string(uint8_t *&dst, const char *s, uint32_t len) {
+        uint32_t h = 2166136261u;
+        for (uint32_t i = 0; i < len; i++) {
+            h = (h ^ (uint8_t)s[i]) * 16777619u;
+        }
+        uint32_t slot = h & (TraceCompression::string_table_size - 1);
+        while (string_table[slot]) {
+            int idx = string_table[slot] - 1;
+            if (string_length[idx] == len && !memcmp(string_arena + string_start[idx], s, len)) {
+                put_varint(dst, idx + 2);
+                return idx;
+            }
+            slot = (slot + 1) & (TraceCompression::string_table_size - 1);
+        }
+        int idx = -1;
+        if (num_strings < TraceCompression::max_strings &&
+            string_arena_used + len <= (uint32_t)TraceCompression::string_arena_size) {
+            idx = num_strings++;
+            string_start[idx] = string_arena_used;
+            string_length[idx] = len;
+            memcpy(string_arena + string_arena_used, s, len);
+            string_arena_used += len;
+            string_table[slot] = (uint16_t)(idx + 1);
+            put_varint(dst, 0);
+        } else {
+            put_varint(dst, 1);
+        }
+        put_varint(dst, len);
+        memcpy(dst, s, len);
+        dst += len;
+        return idx;
+    }
+
+    void encode(const halide_trace_packet_t *p, uint32_t func_len, uint32_t tag_len) {
+        uint8_t *dst = block + block_used;
+        int func_idx = encode_string(dst, p->func(), func_len);
+        encode_string(dst, p->trace_tag(), tag_len);
+
+        uint32_t value_bytes = p->type.lanes * p->type.bytes();
+        const uint8_t *value = (const uint8_t *)p->value();
+        bool has_value = false;
+        for (uint32_t i = 0; i < value_bytes && !has_value; i++) {
+            has_value = value[i] != 0;
+        }
+
+        *dst++ = (uint8_t)(p->event | (has_value ? 0x80 : 0));
+        *dst++ = p->type.code;
+        *dst++ = p->type.bits;
+        put_varint(dst, p->type.lanes);
+        put_zigzag(dst, (int32_t)((uint32_t)p->id - (uint32_t)last_id));
+        put_zigzag(dst, (int32_t)((uint32_t)p->id - (uint32_t)p->parent_id));
+        put_varint(dst, (uint32_t)p->value_index);
+        put_varint(dst, (uint32_t)p->dimensions);
+        last_id = p->id;
+
+        const int32_t *coords = p->coordinates();
+        if (func_idx >= 0 && p->dimensions <= TraceCompression::max_delta_coords) {
+            int32_t *last = last_coords[func_idx];
+            for (int i = 0; i < p->dimensions; i++) {
+                put_zigzag(dst, (int32_t)((uint32_t)coords[i] - (uint32_t)last[i]));
+                last[i] = coords[i];
+            }
+        } else {
+            for (int i = 0; i < p->dimensions; i++) {
+                put_zigzag(dst, coords[i]);
+            }
+        }
+
+        if (has_value) {
+            memcpy(dst, value, value_bytes);
+            dst += value_bytes;
+        }
+        block_used = (uint32_t)(dst - block);
+    }
+
+    ALWAYS_INLINE static void put_length(uint8_t *&dst, uint32_t len) {
+        while (len >= 255) {
+            *dst++ = 255;
+            len -= 255;
+        }
+        *dst++ = (uint8_t)len;
+    }
+
+    // Emit one LZ sequence: a token holding four bits each of the
+    // literal and match lengths (with extension bytes for longer
+    // runs), the literals, and then, unless this is the final
+    // sequence, a two-byte offset back to the match.
+    ALWAYS_INLINE static void put_sequence(uint8_t *&dst, const uint8_t *literals, uint32_t num_literals,
+                                           uint32_t offset, uint32_t match_len) {
+        uint32_t match_code = offset ? match_len - 4 : 0;
+        *dst++ = (uint8_t)(((num_literals < 15 ? num_literals : 15) << 4) |
+                           (match_code < 15 ? match_code : 15));
+        if (num_literals >= 15) {
+            put_length(dst, num_literals - 15);
+        }
+        memcpy(dst, literals, num_literals);
+        dst += num_literals;
+        if (offset) {
+            *dst++ = (uint8_t)offset;
+            *dst++ = (uint8_t)(offset >> 8);
+            if (match_code >= 15) {
+                put_length(dst, match_code - 15);
+            }
+        }
+    }
+
+    // A greedy LZ77 compressor with a single-entry hash table.
+    uint32_t lz_compress(const uint8_t *src, uint32_t size, uint8_t *dst) {
+        memset(lz_table, 0, sizeof(lz_table));
+        uint8_t *dst_start = dst;
+        const uint8_t *ip = src, *anchor = src, *end = src + size;
+        while (ip + 4 <= end) {
+            uint32_t seq = load32(ip);
+            uint32_t h = (seq * 2654435761u) >> (32 - TraceCompression::lz_hash_bits);
+            const uint8_t *ref = src + lz_table[h];
+            lz_table[h] = (uint32_t)(ip - src);
+            if (ref < ip && ip - ref <= 0xffff && load32(ref) == seq) {
+                const uint8_t *m = ip + 4;
+                const uint8_t *r = ref + 4;
+                while (m < end && *m == *r) {
+                    m++;
+                    r++;
+                }
+                put_sequence(dst, anchor, (uint32_t)(ip - anchor), (uint32_t)(ip - ref), (uint32_t)(m - ip));
+                ip = anchor = m;
+            } else {
+                ip++;
+            }
+        }
+        put_sequence(dst, anchor, (uint32_t)(end - anchor), 0, 0);
+        return (uint32_t)(dst - dst_start);
+    }
+
+    bool write_block(int fd) {
+        if (!block_used) {
+            return true;
+        }
+        uint32_t stored = lz_compress(block, block_used, out + TraceCompression::block_header_size);
+        uint32_t flags = reset_pending ? TraceCompression::flag_reset : 0;
+        if (stored < block_used) {
+            flags |= TraceCompression::flag_lz;
+        } else {
+            stored = block_used;
+            memcpy(out + TraceCompression::block_header_size, block, block_used);
+        }
+        uint32_t header[4] = {TraceCompression::block_magic, flags, block_used, stored};
+        memcpy(out, header, sizeof(header));
+        uint32_t total = TraceCompression::block_header_size + stored;
+        block_used = 0;
+        reset_pending = false;
+        return total == (uint32_t)write(fd, out, total);
+    }
+
+public:
+    // Encode a buffer full of trace packets and write them to the fd.
+    bool write_packets(int fd, const uint8_t *buf, uint32_t size) {
+        const uint8_t *end = buf + size;
+        while (buf < end) {
+            const halide_trace_packet_t *p = (const halide_trace_packet_t *)buf;
+            uint32_t func_len = strlen(p->func());
+            uint32_t tag_len = strlen(p->trace_tag());
+            // An upper bound on the encoded size of this packet.
+            uint32_t max_encoded = 48 + 2 * func_len + 2 * tag_len + 5 * p->dimensions +
+                                   p->type.lanes * p->type.bytes();
+            if (block_used + max_encoded > TraceCompression::block_size && !write_block(fd)) {
+                return false;
+            }
+            if (max_encoded > TraceCompression::block_size) {
+                // Too large to encode; write the plain packet instead.
+                if (p->size != (uint32_t)write(fd, p, p->size)) {
+                    return false;
+                }
+            } else {
+                encode(p, func_len, tag_len);
+            }
+            buf += p->size;
+        }
+        return write_block(fd);
+    }
+
+    ALWAYS_INLINE void init() {
+        block_used = 0;
+        string_arena_used = 0;
+        num_strings = 0;
+        last_id = 0;
+        reset_pending = true;
+        memset(string_table, 0, sizeof(string_table));
+        memset(last_coords, 0, sizeof(last_coords));
+    }
+
+    TraceCompressor() = default;
+};
+
+WEAK TraceCompressor *halide_trace_compressor = nullptr;
+
 const static int buffer_size = 1024 * 1024;
 
 class TraceBuffer {
@@ -123,7 +405,11 @@ public:
         bool success = true;
         if (cursor) {
             cursor -= overage;
-            success = (cursor == (uint32_t)write(fd, buf, cursor));
+            if (halide_trace_compressor) {
+                success = halide_trace_compressor->write_packets(fd, buf, cursor);
+            } else {
+                success = (cursor == (uint32_t)write(fd, buf, cursor));
+            }
             cursor = 0;
             overage = 0;
         }
@@ -168,6 +454,29 @@ WEAK int halide_trace_file = -1;  // -1 indicates uninitialized
 WEAK ScopedSpinLock::AtomicFlag halide_trace_file_lock = 0;
 WEAK bool halide_trace_file_initialized = false;
 WEAK void *halide_trace_file_internally_opened = nullptr;
+// Only one in this many load and store events is recorded.
+WEAK int halide_trace_sample_rate = 1;
+
+// Report the pipeline, produce and consume events to the timeline as
+// the begins and ends of spans.
+WEAK void trace_event_to_timeline(const halide_trace_event_t *e) {
+    switch (e->event) {
+    case halide_trace_begin_pipeline:
+    case halide_trace_end_pipeline:
+        timeline_hook(TimelinePipeline, e->event == halide_trace_begin_pipeline, e->func, 0, 0);
+        break;
+    case halide_trace_produce:
+    case halide_trace_end_produce:
+        timeline_hook(TimelineProduce, e->event == halide_trace_produce, e->func, 0, 0);
+        break;
+    case halide_trace_consume:
+    case halide_trace_end_consume:
+        timeline_hook(TimelineConsume, e->event == halide_trace_consume, e->func, 0, 0);
+        break;
+    default:
+        break;
+    }
+}
 
 }  // namespace Internal
 }  // namespace Runtime
@@ -184,6 +493,24 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
 
     // If we're dumping to a file, use a binary format
     int fd = halide_get_trace_file(user_context);
+
+    // While a timeline is being recorded, it takes the place of the
+    // human-readable trace.
+    if (timeline_hook) {
+        trace_event_to_timeline(e);
+        if (fd <= 0) {
+            return my_id;
+        }
+    }
+
+    // Sampling drops loads and stores only, so that the realization
+    // and production events that the trace tools rely on survive.
+    if (halide_trace_sample_rate > 1 &&
+        e->event <= halide_trace_store &&
+        (my_id % halide_trace_sample_rate) != 0) {
+        return my_id;
+    }
+
     if (fd > 0) {
         // Compute the total packet size
         uint32_t value_bytes = (uint32_t)(e->type.lanes * e->type.bytes());
@@ -209,11 +536,17 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
         packet->parent_id = e->parent_id;
         packet->value_index = e->value_index;
         packet->dimensions = e->dimensions;
+        // Zero-fill anything missing, so that the compressed
+        // encoding can leave it out.
         if (e->coordinates) {
             memcpy((void *)packet->coordinates(), e->coordinates, coords_bytes);
+        } else {
+            memset((void *)packet->coordinates(), 0, coords_bytes);
         }
         if (e->value) {
             memcpy((void *)packet->value(), e->value, value_bytes);
+        } else {
+            memset((void *)packet->value(), 0, value_bytes);
         }
         memcpy((void *)packet->func(), e->func, name_bytes);
         memcpy((void *)packet->trace_tag(), e->trace_tag ? e->trace_tag : "", trace_tag_bytes);
@@ -343,6 +676,7 @@ namespace Runtime {
 namespace Internal {
 
 WEAK trace_fn halide_custom_trace = halide_default_trace;
+WEAK halide_region_complete_t halide_custom_region_complete = halide_default_region_complete;
 
 }
 }  // namespace Runtime
@@ -356,6 +690,22 @@ WEAK trace_fn halide_set_custom_trace(trace_fn t) {
     return result;
 }
 
+WEAK int halide_default_region_complete(void *user_context, const char *func, int dimensions,
+                                        const int32_t *min, const int32_t *extent) {
+    return halide_error_code_success;
+}
+
+WEAK halide_region_complete_t halide_set_custom_region_complete(halide_region_complete_t handler) {
+    halide_region_complete_t result = halide_custom_region_complete;
+    halide_custom_region_complete = handler;
+    return result;
+}
+
+WEAK int halide_region_complete(void *user_context, const char *func, int dimensions,
+                                const int32_t *min, const int32_t *extent) {
+    return (*halide_custom_region_complete)(user_context, func, dimensions, min, extent);
+}
+
 WEAK void halide_set_trace_file(int fd) {
     halide_trace_file = fd;
 }
@@ -363,18 +713,41 @@ WEAK void halide_set_trace_file(int fd) {
 extern int errno;
 
 WEAK int halide_get_trace_file(void *user_context) {
+    using namespace Halide::Runtime::Internal::Synchronization;
+
+    // This is called for every trace event, so avoid the lock once
+    // the trace file is known.
+    int fd;
+    atomic_load_acquire(&halide_trace_file, &fd);
+    if (fd >= 0) {
+        return fd;
+    }
+
     ScopedSpinLock lock(&halide_trace_file_lock);
     if (halide_trace_file < 0) {
+        const char *sample_rate = getenv("HL_TRACE_SAMPLE");
+        if (sample_rate && atoi(sample_rate) > 1) {
+            halide_trace_sample_rate = atoi(sample_rate);
+        }
         const char *trace_file_name = getenv("HL_TRACE_FILE");
         if (trace_file_name) {
             void *file = halide_fopen(trace_file_name, "ab");
             halide_abort_if_false(user_context, file && "Failed to open trace file\n");
-            halide_set_trace_file(fileno(file));
             halide_trace_file_internally_opened = file;
             if (!halide_trace_buffer) {
                 halide_trace_buffer = (TraceBuffer *)malloc(sizeof(TraceBuffer));
                 halide_trace_buffer->init();
             }
+            const char *compress = getenv("HL_TRACE_COMPRESS");
+            if (compress && atoi(compress) && !halide_trace_compressor) {
+                halide_trace_compressor = (TraceCompressor *)malloc(sizeof(TraceCompressor));
+                halide_abort_if_false(user_context, halide_trace_compressor && "Failed to allocate trace compressor\n");
+                halide_trace_compressor->init();
+            }
+            // Publish the fd last, as other threads may start using
+            // the trace buffer as soon as they see it.
+            fd = fileno(file);
+            atomic_store_release(&halide_trace_file, &fd);
         } else {
             halide_set_trace_file(0);
         }
@@ -388,12 +761,20 @@ WEAK int32_t halide_trace(void *user_context, const halide_trace_event_t *e) {
 
 WEAK int halide_shutdown_trace() {
     if (halide_trace_file_internally_opened) {
+        if (halide_trace_buffer && halide_trace_file > 0) {
+            halide_trace_buffer->flush(nullptr, halide_trace_file);
+        }
         int ret = fclose(halide_trace_file_internally_opened);
         halide_trace_file = 0;
         halide_trace_file_initialized = false;
         halide_trace_file_internally_opened = nullptr;
         if (halide_trace_buffer) {
             free(halide_trace_buffer);
+            halide_trace_buffer = nullptr;
+        }
+        if (halide_trace_compressor) {
+            free(halide_trace_compressor);
+            halide_trace_compressor = nullptr;
         }
         if (ret != 0) {
             return halide_error_code_trace_failed;
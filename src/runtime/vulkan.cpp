@@ -1,4 +1,5 @@
 #include "HalideRuntimeVulkan.h"
+#include "timeline.h"
 
 #include "device_buffer_utils.h"
 #include "device_interface.h"
@@ -233,6 +234,7 @@ WEAK int halide_vulkan_device_release(void *user_context) {
 
         vk_destroy_command_pool(user_context, allocator, command_pool);
         vk_destroy_shader_modules(user_context, allocator);
+        vk_destroy_pipeline_cache(user_context, allocator);
         vk_destroy_memory_allocator(user_context, allocator);
 
         if (device == cached_device) {
@@ -1098,6 +1100,8 @@ WEAK int halide_vulkan_run(void *user_context,
                            size_t arg_sizes[],
                            void *args[],
                            int8_t arg_is_buffer[]) {
+    ScopedTimelineSpan span(TimelineKernel, entry_name);
+
 #ifdef DEBUG_RUNTIME
     debug(user_context)
         << "halide_vulkan_run (user_context: " << user_context << ", "
@@ -1288,15 +1292,19 @@ WEAK int halide_vulkan_run(void *user_context,
         return error_code;
     }
 
-    // 5. Fill the command buffer
+    // 5. Fill the command buffer, bracketing the dispatch with device
+    // timestamps if the profiler asked for kernel times
+    VkQueryPool timing_pool = should_time_device_kernels() ? vk_create_timestamp_query_pool(user_context, ctx.device) : 0;
     error_code = vk_fill_command_buffer_with_dispatch_call(user_context,
                                                            ctx.device, command_buffer,
                                                            entry_point_binding->compute_pipeline,
                                                            cache_entry->pipeline_layout,
                                                            entry_point_binding->descriptor_set,
                                                            entry_point_index,
-                                                           blocksX, blocksY, blocksZ);
+                                                           blocksX, blocksY, blocksZ,
+                                                           timing_pool);
     if (error_code != halide_error_code_success) {
+        vk_destroy_timestamp_query_pool(user_context, ctx.device, timing_pool);
         error(user_context) << "Vulkan: Failed to fill command buffer with dispatch call!\n";
         return error_code;
     }
@@ -1304,6 +1312,7 @@ WEAK int halide_vulkan_run(void *user_context,
     // 6. Submit the command buffer to our command queue
     error_code = vk_submit_command_buffer(user_context, ctx.queue, command_buffer);
     if (error_code != halide_error_code_success) {
+        vk_destroy_timestamp_query_pool(user_context, ctx.device, timing_pool);
         error(user_context) << "Vulkan: Failed to fill submit command buffer!\n";
         return error_code;
     }
@@ -1311,13 +1320,20 @@ WEAK int halide_vulkan_run(void *user_context,
     // 7. Wait until the queue is done with the command buffer
     VkResult result = vkQueueWaitIdle(ctx.queue);
     if (result != VK_SUCCESS) {
+        vk_destroy_timestamp_query_pool(user_context, ctx.device, timing_pool);
         error(user_context) << "Vulkan: vkQueueWaitIdle returned " << vk_get_error_name(result) << "\n";
         return halide_error_code_generic_error;
     }
+    if (timing_pool) {
+        uint64_t ns = vk_read_timestamp_query_pool_ns(user_context, ctx.device, ctx.physical_device, timing_pool);
+        if (ns) {
+            device_profiler_event(user_context, DeviceProfilerKernel, 0, 0, ns);
+        }
+        vk_destroy_timestamp_query_pool(user_context, ctx.device, timing_pool);
+    }
 
     // 8. Cleanup
     error_code = vk_destroy_command_buffer(user_context, ctx.allocator, ctx.command_pool, command_buffer);
-    vkResetCommandPool(ctx.device, ctx.command_pool, VK_COMMAND_POOL_RESET_RELEASE_RESOURCES_BIT);
     if (error_code != halide_error_code_success) {
         error(user_context) << "Vulkan: Failed to destroy command buffer!\n";
         return error_code;
@@ -1401,6 +1417,43 @@ WEAK int halide_vulkan_release_unused_device_allocations(void *user_context) {
     return halide_error_code_success;
 }
 
+WEAK int halide_vulkan_import_pipeline_cache(void *user_context, const void *data, size_t size) {
+    debug(user_context)
+        << "halide_vulkan_import_pipeline_cache (user_context: " << user_context
+        << ", data: " << data << ", size: " << (uint64_t)size << ")\n";
+
+    if ((data == nullptr) || (size == 0)) {
+        return halide_error_code_success;
+    }
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != halide_error_code_success) {
+        error(user_context) << "Vulkan: Failed to acquire context!\n";
+        return ctx.error;
+    }
+
+    return vk_import_pipeline_cache(user_context, ctx.allocator, data, size);
+}
+
+WEAK int halide_vulkan_export_pipeline_cache(void *user_context, void *data, size_t *size) {
+    debug(user_context)
+        << "halide_vulkan_export_pipeline_cache (user_context: " << user_context
+        << ", data: " << data << ")\n";
+
+    if (size == nullptr) {
+        error(user_context) << "Vulkan: halide_vulkan_export_pipeline_cache requires a size!\n";
+        return halide_error_code_generic_error;
+    }
+
+    VulkanContext ctx(user_context);
+    if (ctx.error != halide_error_code_success) {
+        error(user_context) << "Vulkan: Failed to acquire context!\n";
+        return ctx.error;
+    }
+
+    return vk_export_pipeline_cache(user_context, ctx.allocator, data, size);
+}
+
 namespace {
 
 WEAK __attribute__((constructor)) void register_vulkan_allocation_pool() {
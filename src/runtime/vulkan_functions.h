@@ -21,6 +21,10 @@ VULKAN_FN(vkCreateShaderModule)
 VULKAN_FN(vkCreateDescriptorSetLayout)
 VULKAN_FN(vkCreatePipelineLayout)
 VULKAN_FN(vkCreateComputePipelines)
+VULKAN_FN(vkCreatePipelineCache)
+VULKAN_FN(vkDestroyPipelineCache)
+VULKAN_FN(vkGetPipelineCacheData)
+VULKAN_FN(vkMergePipelineCaches)
 VULKAN_FN(vkCreateDescriptorPool)
 VULKAN_FN(vkAllocateDescriptorSets)
 VULKAN_FN(vkGetPhysicalDeviceMemoryProperties)
@@ -34,10 +38,16 @@ VULKAN_FN(vkCreateCommandPool)
 VULKAN_FN(vkResetCommandPool)
 VULKAN_FN(vkAllocateCommandBuffers)
 VULKAN_FN(vkFreeCommandBuffers)
+VULKAN_FN(vkResetCommandBuffer)
 VULKAN_FN(vkBeginCommandBuffer)
 VULKAN_FN(vkCmdBindPipeline)
 VULKAN_FN(vkCmdBindDescriptorSets)
 VULKAN_FN(vkCmdDispatch)
+VULKAN_FN(vkCmdResetQueryPool)
+VULKAN_FN(vkCmdWriteTimestamp)
+VULKAN_FN(vkCreateQueryPool)
+VULKAN_FN(vkDestroyQueryPool)
+VULKAN_FN(vkGetQueryPoolResults)
 VULKAN_FN(vkQueueSubmit)
 VULKAN_FN(vkQueueWaitIdle)
 VULKAN_FN(vkEndCommandBuffer)
@@ -103,10 +103,16 @@ int vk_fill_command_buffer_with_dispatch_call(void *user_context,
                                               VkPipelineLayout pipeline_layout,
                                               VkDescriptorSet descriptor_set,
                                               uint32_t descriptor_set_index,
-                                              int blocksX, int blocksY, int blocksZ);
+                                              int blocksX, int blocksY, int blocksZ,
+                                              VkQueryPool timing_pool = 0);
 
 int vk_submit_command_buffer(void *user_context, VkQueue queue, VkCommandBuffer command_buffer);
 
+// -- Timestamp Queries (used to time kernels for the profiler)
+VkQueryPool vk_create_timestamp_query_pool(void *user_context, VkDevice device);
+uint64_t vk_read_timestamp_query_pool_ns(void *user_context, VkDevice device, VkPhysicalDevice physical_device, VkQueryPool pool);
+void vk_destroy_timestamp_query_pool(void *user_context, VkDevice device, VkQueryPool pool);
+
 // -- Scalar Uniform Buffer
 bool vk_needs_scalar_uniform_buffer(void *user_context,
                                     size_t arg_sizes[],
@@ -185,6 +191,13 @@ int vk_create_pipeline_layout(void *user_context,
 int vk_destroy_pipeline_layout(void *user_context,
                                VulkanMemoryAllocator *allocator,
                                VkPipelineLayout pipeline_layout);
+// -- Pipeline Cache
+VkPipelineCache vk_get_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator);
+void vk_store_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator);
+void vk_destroy_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator);
+int vk_import_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator, const void *data, size_t size);
+int vk_export_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator, void *data, size_t *size);
+
 // -- Compute Pipeline
 int vk_create_compute_pipeline(void *user_context,
                                VulkanMemoryAllocator *allocator,
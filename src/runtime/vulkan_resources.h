@@ -1,6 +1,7 @@
 #ifndef HALIDE_RUNTIME_VULKAN_RESOURCES_H
 #define HALIDE_RUNTIME_VULKAN_RESOURCES_H
 
+#include "gpu_binary_cache.h"
 #include "vulkan_internal.h"
 #include "vulkan_memory.h"
 
@@ -67,6 +68,30 @@ struct VulkanCompilationCacheEntry {
 
 WEAK Halide::Internal::GPUCompilationCache<VkDevice, VulkanCompilationCacheEntry *> compilation_cache;
 
+// Pipeline cache shared by the compute pipelines of a device, persisted
+// through the GPU kernel cache when that is enabled.
+struct VulkanPipelineCacheState {
+    VkDevice device = nullptr;
+    VkPipelineCache cache = {0};
+    size_t stored_size = 0;
+    Halide::Internal::GPUBinaryCacheKey key;
+};
+
+WEAK VulkanPipelineCacheState pipeline_cache_state;
+
+// Command buffers are all short-lived and used one at a time, so they
+// are reset and recycled instead of being freed. Only buffers from the
+// pool made by vk_create_command_pool can be reset individually, so
+// only those are kept.
+constexpr uint32_t max_cached_command_buffers = 4;
+struct VulkanCommandBufferCache {
+    VkCommandPool command_pool = {0};
+    VkCommandBuffer command_buffers[max_cached_command_buffers] = {};
+    uint32_t count = 0;
+};
+
+WEAK VulkanCommandBufferCache command_buffer_cache;
+
 // --------------------------------------------------------------------------
 
 namespace {  // internalize
@@ -88,10 +113,10 @@ int vk_create_command_pool(void *user_context, VulkanMemoryAllocator *allocator,
 
     VkCommandPoolCreateInfo command_pool_info =
         {
-            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,  // struct type
-            nullptr,                                     // pointer to struct extending this
-            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,        // flags. Assume transient short-lived single-use command buffers
-            queue_index                                  // queue family index corresponding to the compute command queue
+            VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,                                             // struct type
+            nullptr,                                                                                // pointer to struct extending this
+            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,  // flags. Short-lived command buffers, reset individually for reuse
+            queue_index                                                                             // queue family index corresponding to the compute command queue
         };
 
     VkResult result = vkCreateCommandPool(allocator->current_device(), &command_pool_info, allocator->callbacks(), command_pool);
@@ -99,6 +124,10 @@ int vk_create_command_pool(void *user_context, VulkanMemoryAllocator *allocator,
         error(user_context) << "Vulkan: Failed to create command pool!\n";
         return halide_error_code_generic_error;
     }
+    if (command_buffer_cache.command_pool == VkCommandPool{0}) {
+        command_buffer_cache.command_pool = *command_pool;
+        command_buffer_cache.count = 0;
+    }
     return halide_error_code_success;
 }
 
@@ -114,6 +143,11 @@ int vk_destroy_command_pool(void *user_context, VulkanMemoryAllocator *allocator
         return halide_error_code_generic_error;
     }
 
+    if (command_buffer_cache.command_pool == command_pool) {
+        // Destroying the pool frees its command buffers.
+        command_buffer_cache.command_pool = {0};
+        command_buffer_cache.count = 0;
+    }
     vkDestroyCommandPool(allocator->current_device(), command_pool, allocator->callbacks());
     return halide_error_code_success;
 }
@@ -132,6 +166,11 @@ int vk_create_command_buffer(void *user_context, VulkanMemoryAllocator *allocato
         return halide_error_code_generic_error;
     }
 
+    if ((command_buffer_cache.command_pool == command_pool) && (command_buffer_cache.count > 0)) {
+        *command_buffer = command_buffer_cache.command_buffers[--command_buffer_cache.count];
+        return halide_error_code_success;
+    }
+
     VkCommandBufferAllocateInfo command_buffer_info =
         {
             VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,  // struct type
@@ -162,6 +201,13 @@ int vk_destroy_command_buffer(void *user_context, VulkanMemoryAllocator *allocat
         return halide_error_code_generic_error;
     }
 
+    if ((command_buffer_cache.command_pool == command_pool) &&
+        (command_buffer_cache.count < max_cached_command_buffers) &&
+        (vkResetCommandBuffer(command_buffer, 0) == VK_SUCCESS)) {
+        command_buffer_cache.command_buffers[command_buffer_cache.count++] = command_buffer;
+        return halide_error_code_success;
+    }
+
     vkFreeCommandBuffers(allocator->current_device(), command_pool, 1, &command_buffer);
     return halide_error_code_success;
 }
@@ -173,7 +219,8 @@ int vk_fill_command_buffer_with_dispatch_call(void *user_context,
                                               VkPipelineLayout pipeline_layout,
                                               VkDescriptorSet descriptor_set,
                                               uint32_t descriptor_set_index,
-                                              int blocksX, int blocksY, int blocksZ) {
+                                              int blocksX, int blocksY, int blocksZ,
+                                              VkQueryPool timing_pool) {
 
 #ifdef DEBUG_RUNTIME
     debug(user_context)
@@ -202,7 +249,14 @@ int vk_fill_command_buffer_with_dispatch_call(void *user_context,
     vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline);
     vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout,
                             descriptor_set_index, 1, &descriptor_set, 0, nullptr);
+    if (timing_pool) {
+        vkCmdResetQueryPool(command_buffer, timing_pool, 0, 2);
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timing_pool, 0);
+    }
     vkCmdDispatch(command_buffer, blocksX, blocksY, blocksZ);
+    if (timing_pool) {
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timing_pool, 1);
+    }
 
     result = vkEndCommandBuffer(command_buffer);
     if (result != VK_SUCCESS) {
@@ -244,6 +298,47 @@ int vk_submit_command_buffer(void *user_context, VkQueue queue, VkCommandBuffer
 
 // --
 
+VkQueryPool vk_create_timestamp_query_pool(void *user_context, VkDevice device) {
+    VkQueryPoolCreateInfo create_info = {
+        VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,  // struct type
+        nullptr,                                   // pointer to struct extending this
+        0,                                         // flags
+        VK_QUERY_TYPE_TIMESTAMP,                   // query type
+        2,                                         // query count: one each for the start and end
+        0                                          // pipeline statistics (unused for timestamps)
+    };
+    VkQueryPool pool = 0;
+    VkResult result = vkCreateQueryPool(device, &create_info, nullptr, &pool);
+    if (result != VK_SUCCESS) {
+        debug(user_context) << "Vulkan: vkCreateQueryPool returned " << vk_get_error_name(result) << "\n";
+        return 0;
+    }
+    return pool;
+}
+
+// Returns the time between the two timestamps in the pool, in
+// nanoseconds, or zero if the device couldn't provide them.
+uint64_t vk_read_timestamp_query_pool_ns(void *user_context, VkDevice device, VkPhysicalDevice physical_device, VkQueryPool pool) {
+    uint64_t timestamps[2] = {0, 0};
+    VkResult result = vkGetQueryPoolResults(device, pool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    if (result != VK_SUCCESS || timestamps[1] < timestamps[0]) {
+        return 0;
+    }
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    // timestampPeriod is the number of nanoseconds per tick.
+    return (uint64_t)((timestamps[1] - timestamps[0]) * (double)properties.limits.timestampPeriod);
+}
+
+void vk_destroy_timestamp_query_pool(void *user_context, VkDevice device, VkQueryPool pool) {
+    if (pool) {
+        vkDestroyQueryPool(device, pool, nullptr);
+    }
+}
+
+// --
+
 bool vk_needs_scalar_uniform_buffer(void *user_context,
                                     size_t arg_sizes[],
                                     void *args[],
@@ -790,6 +885,148 @@ int vk_destroy_pipeline_layout(void *user_context,
 
 // --
 
+VkPipelineCache vk_get_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator) {
+    VulkanPipelineCacheState &state = pipeline_cache_state;
+    if (state.device != nullptr) {
+        // Only the first device gets a persistent cache.
+        return (state.device == allocator->current_device()) ? state.cache : VkPipelineCache{0};
+    }
+    const char *cache_dir = halide_gpu_kernel_cache_dir(user_context);
+    if (!cache_dir || !*cache_dir) {
+        return {0};
+    }
+
+    // The driver validates the header of the cache data against the
+    // device anyway, but keying on it keeps devices from clobbering
+    // each other's entries.
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(allocator->current_physical_device(), &properties);
+    state.key = Halide::Internal::GPUBinaryCacheKey();
+    state.key.add_value(properties.vendorID);
+    state.key.add_value(properties.deviceID);
+    state.key.add_value(properties.driverVersion);
+    state.key.add(properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    size_t size = 0;
+    void *data = Halide::Internal::gpu_binary_cache_load(user_context, "vulkan", state.key, &size);
+    VkPipelineCacheCreateInfo cache_info = {
+        VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,  // structure type
+        nullptr,                                       // pointer to a structure extending this
+        0,                                             // flags
+        size,                                          // initial data size
+        data                                           // initial data
+    };
+    VkResult result = vkCreatePipelineCache(allocator->current_device(), &cache_info, allocator->callbacks(), &state.cache);
+    if (result != VK_SUCCESS && data != nullptr) {
+        // Start over with an empty cache if the driver rejects the data.
+        cache_info.initialDataSize = 0;
+        cache_info.pInitialData = nullptr;
+        size = 0;
+        result = vkCreatePipelineCache(allocator->current_device(), &cache_info, allocator->callbacks(), &state.cache);
+    }
+    free(data);
+    if (result != VK_SUCCESS) {
+        debug(user_context) << "Vulkan: vkCreatePipelineCache returned " << vk_get_error_name(result) << "\n";
+        state.cache = {0};
+    }
+    state.device = allocator->current_device();
+    state.stored_size = size;
+    return state.cache;
+}
+
+void vk_store_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator) {
+    VulkanPipelineCacheState &state = pipeline_cache_state;
+    if (state.cache == VkPipelineCache{0} || state.device != allocator->current_device()) {
+        return;
+    }
+    // Only write the cache back when it has picked up new pipelines.
+    size_t size = 0;
+    if (vkGetPipelineCacheData(state.device, state.cache, &size, nullptr) != VK_SUCCESS ||
+        size <= state.stored_size) {
+        return;
+    }
+    void *data = malloc(size);
+    if (data == nullptr) {
+        return;
+    }
+    if (vkGetPipelineCacheData(state.device, state.cache, &size, data) == VK_SUCCESS) {
+        Halide::Internal::gpu_binary_cache_store(user_context, "vulkan", state.key, data, size);
+        state.stored_size = size;
+    }
+    free(data);
+}
+
+void vk_destroy_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator) {
+    VulkanPipelineCacheState &state = pipeline_cache_state;
+    if (state.device == nullptr || state.device != allocator->current_device()) {
+        return;
+    }
+    if (state.cache != VkPipelineCache{0}) {
+        vkDestroyPipelineCache(state.device, state.cache, allocator->callbacks());
+    }
+    state.device = nullptr;
+    state.cache = {0};
+    state.stored_size = 0;
+}
+
+int vk_import_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator, const void *data, size_t size) {
+    VulkanPipelineCacheState &state = pipeline_cache_state;
+    VkPipelineCache cache = vk_get_pipeline_cache(user_context, allocator);
+    if ((state.device != nullptr) && (state.device != allocator->current_device())) {
+        error(user_context) << "Vulkan: The pipeline cache belongs to another device!\n";
+        return halide_error_code_generic_error;
+    }
+
+    VkPipelineCacheCreateInfo cache_info = {
+        VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,  // structure type
+        nullptr,                                       // pointer to a structure extending this
+        0,                                             // flags
+        size,                                          // initial data size
+        data                                           // initial data
+    };
+    VkPipelineCache imported = {0};
+    VkResult result = vkCreatePipelineCache(allocator->current_device(), &cache_info, allocator->callbacks(), &imported);
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreatePipelineCache returned " << vk_get_error_name(result) << "\n";
+        return halide_error_code_generic_error;
+    }
+
+    if (cache == VkPipelineCache{0}) {
+        // No persistent cache, so the imported one becomes the cache
+        state.device = allocator->current_device();
+        state.cache = imported;
+        state.stored_size = size;
+        return halide_error_code_success;
+    }
+
+    result = vkMergePipelineCaches(state.device, cache, 1, &imported);
+    vkDestroyPipelineCache(state.device, imported, allocator->callbacks());
+    if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkMergePipelineCaches returned " << vk_get_error_name(result) << "\n";
+        return halide_error_code_generic_error;
+    }
+    return halide_error_code_success;
+}
+
+int vk_export_pipeline_cache(void *user_context, VulkanMemoryAllocator *allocator, void *data, size_t *size) {
+    VulkanPipelineCacheState &state = pipeline_cache_state;
+    if ((state.cache == VkPipelineCache{0}) || (state.device != allocator->current_device())) {
+        *size = 0;
+        return halide_error_code_success;
+    }
+    VkResult result = vkGetPipelineCacheData(state.device, state.cache, size, data);
+    if (result == VK_INCOMPLETE) {
+        error(user_context) << "Vulkan: Buffer is too small for the pipeline cache data!\n";
+        return halide_error_code_generic_error;
+    } else if (result != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkGetPipelineCacheData returned " << vk_get_error_name(result) << "\n";
+        return halide_error_code_generic_error;
+    }
+    return halide_error_code_success;
+}
+
+// --
+
 int vk_create_compute_pipeline(void *user_context,
                                VulkanMemoryAllocator *allocator,
                                const char *pipeline_name,
@@ -830,11 +1067,13 @@ int vk_create_compute_pipeline(void *user_context,
             0                 // base pipeline index for derived pipeline
         };
 
-    VkResult result = vkCreateComputePipelines(allocator->current_device(), 0, 1, &compute_pipeline_info, allocator->callbacks(), compute_pipeline);
+    VkPipelineCache pipeline_cache = vk_get_pipeline_cache(user_context, allocator);
+    VkResult result = vkCreateComputePipelines(allocator->current_device(), pipeline_cache, 1, &compute_pipeline_info, allocator->callbacks(), compute_pipeline);
     if (result != VK_SUCCESS) {
         error(user_context) << "Vulkan: Failed to create compute pipeline! vkCreateComputePipelines returned " << vk_get_error_name(result) << "\n";
         return halide_error_code_generic_error;
     }
+    vk_store_pipeline_cache(user_context, allocator);
 
     return halide_error_code_success;
 }
@@ -5,6 +5,7 @@
 #include "printer.h"
 #include "runtime_atomics.h"
 #include "scoped_spin_lock.h"
+#include "timeline.h"
 
 #include "mini_webgpu.h"
 
@@ -238,6 +239,54 @@ struct WgpuBufferHandle {
 WEAK Halide::Internal::GPUCompilationCache<WGPUDevice, WGPUShaderModule>
     shader_cache;
 
+// The size of each staging buffer used for host<->device copies.
+constexpr int kStagingBufferSize = 4 * 1024 * 1024;
+
+// Copies that are split into many chunks, or that are larger than a
+// single staging buffer, are batched through a small ring of staging
+// buffers so that they need one queue submission rather than one per
+// chunk. Readback slots are all mapped at once after the copies are
+// submitted, and drained in order. Upload slots are created mapped,
+// and are mapped again asynchronously once their copies have been
+// submitted, so any wait for a slot to become writable is deferred
+// until the next time it is used. The ring belongs to a single device
+// and is only accessed with the context held.
+constexpr int kStagingRingSize = 4;
+
+struct StagingSlot {
+    WGPUBuffer buffer = nullptr;
+    uint64_t used = 0;
+    uint8_t *mapped = nullptr;
+    volatile ScopedSpinLock::AtomicFlag map_pending = 0;
+    volatile WGPUBufferMapAsyncStatus map_status = WGPUBufferMapAsyncStatus_Success;
+};
+
+struct StagingRing {
+    WGPUDevice device = nullptr;
+    // Readback slot 0 is always the context's staging buffer, and is not
+    // owned by the ring.
+    StagingSlot readback[kStagingRingSize];
+    StagingSlot upload[kStagingRingSize];
+    int next_upload = 0;
+};
+
+WEAK StagingRing staging_ring;
+
+WEAK void release_staging_ring() {
+    for (int i = 0; i < kStagingRingSize; i++) {
+        if (i > 0 && staging_ring.readback[i].buffer) {
+            wgpuBufferRelease(staging_ring.readback[i].buffer);
+        }
+        if (staging_ring.upload[i].buffer) {
+            wgpuBufferRelease(staging_ring.upload[i].buffer);
+        }
+        staging_ring.readback[i] = StagingSlot();
+        staging_ring.upload[i] = StagingSlot();
+    }
+    staging_ring.device = nullptr;
+    staging_ring.next_upload = 0;
+}
+
 namespace {
 
 halide_error_code_t init_error_code = halide_error_code_success;
@@ -345,7 +394,6 @@ WEAK int create_webgpu_context(void *user_context) {
     }
 
     // Create a staging buffer for transfers.
-    constexpr int kStagingBufferSize = 4 * 1024 * 1024;
     WGPUBufferDescriptor buffer_desc{};
     buffer_desc.nextInChain = nullptr;
     buffer_desc.label = nullptr;
@@ -507,6 +555,10 @@ WEAK int halide_webgpu_device_release(void *user_context) {
         shader_cache.delete_context(user_context, device,
                                     wgpuShaderModuleRelease);
 
+        if (device == staging_ring.device) {
+            release_staging_ring();
+        }
+
         // Release the device/adapter/instance/staging_buffer, if we created them.
         if (device == global_device) {
             if (staging_buffer) {
@@ -547,65 +599,253 @@ WEAK int halide_webgpu_device_and_host_free(void *user_context,
 
 namespace {
 
-// Copy `size` bytes of data from buffer `src` to a host pointer `dst`.
-int do_copy_to_host(void *user_context, WgpuContext *context, uint8_t *dst,
-                    WGPUBuffer src, int64_t src_offset, int64_t size) {
-    // Copy chunks via the staging buffer.
-    int64_t staging_buffer_size = wgpuBufferGetSize(context->staging_buffer);
-    for (int64_t offset = 0; offset < size; offset += staging_buffer_size) {
-        int64_t num_bytes = staging_buffer_size;
-        if (offset + num_bytes > size) {
-            num_bytes = size - offset;
+void map_staging_slot(StagingSlot *slot, WGPUMapModeFlags mode, uint64_t size) {
+    __atomic_test_and_set(&slot->map_pending, __ATOMIC_RELAXED);
+    wgpuBufferMapAsync(
+        slot->buffer, mode, 0, size,
+        [](WGPUBufferMapAsyncStatus status, void *userdata) {
+            StagingSlot *slot = (StagingSlot *)userdata;
+            slot->map_status = status;
+            __atomic_clear(&slot->map_pending, __ATOMIC_RELEASE);
+        },
+        slot);
+}
+
+int wait_for_staging_slot(void *user_context, WgpuContext *context, StagingSlot *slot) {
+    while (__atomic_test_and_set(&slot->map_pending, __ATOMIC_ACQUIRE)) {
+        wgpuDeviceTick(context->device);
+    }
+    __atomic_clear(&slot->map_pending, __ATOMIC_RELAXED);
+    if (slot->map_status != WGPUBufferMapAsyncStatus_Success) {
+        error(user_context) << "wgpuBufferMapAsync failed: "
+                            << slot->map_status << "\n";
+        return halide_error_code_generic_error;
+    }
+    return halide_error_code_success;
+}
+
+// Gathers the chunks of a host<->device copy into the staging ring, and
+// submits them together.
+class StagingBatch {
+    void *user_context;
+    WgpuContext *context;
+    bool to_host;
+    uint64_t slot_size;
+    WGPUCommandEncoder encoder = nullptr;
+
+    // The ring slots used by this batch, in order.
+    StagingSlot *slots[kStagingRingSize];
+    int num_slots = 0;
+
+    // The pending device->host copies out of the readback slots.
+    struct Chunk {
+        uint8_t *host;
+        StagingSlot *slot;
+        uint64_t offset;
+        uint64_t size;
+    };
+    static constexpr int kMaxChunks = 128;
+    Chunk chunks[kMaxChunks];
+    int num_chunks = 0;
+
+    int next_slot() {
+        int err = halide_error_code_success;
+        if (num_slots > 0 && !to_host) {
+            StagingSlot *current = slots[num_slots - 1];
+            wgpuBufferUnmap(current->buffer);
+            current->mapped = nullptr;
+        }
+        if (num_slots == kStagingRingSize) {
+            err = flush();
+            if (err) {
+                return err;
+            }
+        }
+        StagingSlot *slot;
+        if (to_host) {
+            slot = &staging_ring.readback[num_slots];
+            if (num_slots == 0) {
+                slot->buffer = context->staging_buffer;
+            } else if (!slot->buffer) {
+                slot->buffer = create_staging_buffer(WGPUBufferUsage_CopyDst | WGPUBufferUsage_MapRead, false);
+            }
+        } else {
+            slot = &staging_ring.upload[staging_ring.next_upload];
+            staging_ring.next_upload = (staging_ring.next_upload + 1) % kStagingRingSize;
+            if (!slot->buffer) {
+                slot->buffer = create_staging_buffer(WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite, true);
+            } else {
+                // Complete the map started when the slot was last used.
+                err = wait_for_staging_slot(user_context, context, slot);
+                if (err) {
+                    return err;
+                }
+            }
+            slot->mapped = (uint8_t *)wgpuBufferGetMappedRange(slot->buffer, 0, slot_size);
+            if (!slot->mapped) {
+                error(user_context) << "wgpuBufferGetMappedRange failed\n";
+                return halide_error_code_generic_error;
+            }
+        }
+        slot->used = 0;
+        slots[num_slots++] = slot;
+        if (!encoder) {
+            encoder = wgpuDeviceCreateCommandEncoder(context->device, nullptr);
         }
+        return halide_error_code_success;
+    }
 
-        // Copy this chunk to the staging buffer.
-        WGPUCommandEncoder encoder =
-            wgpuDeviceCreateCommandEncoder(context->device, nullptr);
-        wgpuCommandEncoderCopyBufferToBuffer(encoder, src, src_offset + offset,
-                                             context->staging_buffer,
-                                             0, num_bytes);
-        WGPUCommandBuffer command_buffer =
-            wgpuCommandEncoderFinish(encoder, nullptr);
-        wgpuQueueSubmit(context->queue, 1, &command_buffer);
+    WGPUBuffer create_staging_buffer(WGPUBufferUsageFlags usage, bool mapped) {
+        WGPUBufferDescriptor desc{};
+        desc.nextInChain = nullptr;
+        desc.label = nullptr;
+        desc.usage = usage;
+        desc.size = slot_size;
+        desc.mappedAtCreation = mapped;
+        return wgpuDeviceCreateBuffer(context->device, &desc);
+    }
+
+public:
+    StagingBatch(void *user_context, WgpuContext *context, bool to_host)
+        : user_context(user_context), context(context), to_host(to_host) {
+        if (staging_ring.device != context->device) {
+            release_staging_ring();
+            staging_ring.device = context->device;
+        }
+        slot_size = to_host ? wgpuBufferGetSize(context->staging_buffer) : kStagingBufferSize;
+    }
 
-        struct BufferMapResult {
-            volatile ScopedSpinLock::AtomicFlag map_complete;
-            volatile WGPUBufferMapAsyncStatus map_status;
-        };
-        BufferMapResult result;
-
-        // Map the staging buffer for reading.
-        __atomic_test_and_set(&result.map_complete, __ATOMIC_RELAXED);
-        wgpuBufferMapAsync(
-            context->staging_buffer, WGPUMapMode_Read, 0, num_bytes,
-            [](WGPUBufferMapAsyncStatus status, void *userdata) {
-                BufferMapResult *result = (BufferMapResult *)userdata;
-                result->map_status = status;
-                __atomic_clear(&result->map_complete, __ATOMIC_RELEASE);
-            },
-            &result);
-
-        while (__atomic_test_and_set(&result.map_complete, __ATOMIC_ACQUIRE)) {
-            wgpuDeviceTick(context->device);
+    ~StagingBatch() {
+        if (encoder) {
+            // Only reached if an error interrupted the batch.
+            for (int i = 0; i < num_slots; i++) {
+                if (slots[i]->mapped) {
+                    wgpuBufferUnmap(slots[i]->buffer);
+                    slots[i]->mapped = nullptr;
+                }
+                if (!to_host) {
+                    map_staging_slot(slots[i], WGPUMapMode_Write, slot_size);
+                }
+            }
+            wgpuCommandEncoderRelease(encoder);
         }
-        if (result.map_status != WGPUBufferMapAsyncStatus_Success) {
-            error(user_context) << "wgpuBufferMapAsync failed: "
-                                << result.map_status << "\n";
-            return halide_error_code_copy_to_host_failed;
+    }
+
+    // Stage a copy of `size` bytes from device buffer `src` to host
+    // pointer `dst`. The host memory is written by flush().
+    int add_readback(WGPUBuffer src, uint64_t src_offset, uint8_t *dst, uint64_t size) {
+        while (size > 0) {
+            int err = halide_error_code_success;
+            if (num_chunks == kMaxChunks) {
+                err = flush();
+            } else if (num_slots == 0 || slots[num_slots - 1]->used == slot_size) {
+                err = next_slot();
+            }
+            if (err) {
+                return err;
+            }
+            if (num_slots == 0) {
+                continue;
+            }
+            StagingSlot *slot = slots[num_slots - 1];
+            uint64_t num_bytes = min<uint64_t>(size, slot_size - slot->used);
+            uint64_t copy_size = round_up_to_multiple_of_4(num_bytes);
+            wgpuCommandEncoderCopyBufferToBuffer(encoder, src, src_offset,
+                                                 slot->buffer, slot->used, copy_size);
+            chunks[num_chunks++] = {dst, slot, slot->used, num_bytes};
+            slot->used += copy_size;
+            src_offset += num_bytes;
+            dst += num_bytes;
+            size -= num_bytes;
         }
+        return halide_error_code_success;
+    }
 
-        // Copy the data from the mapped staging buffer to the host allocation.
-        const void *src = wgpuBufferGetConstMappedRange(context->staging_buffer,
-                                                        0, num_bytes);
-        memcpy(dst + offset, src, num_bytes);
-        wgpuBufferUnmap(context->staging_buffer);
+    // Stage a copy of `size` bytes from host pointer `src` to device
+    // buffer `dst`. The host memory is read immediately.
+    int add_upload(WGPUBuffer dst, uint64_t dst_offset, const uint8_t *src, uint64_t size) {
+        while (size > 0) {
+            if (num_slots == 0 || slots[num_slots - 1]->used == slot_size) {
+                int err = next_slot();
+                if (err) {
+                    return err;
+                }
+            }
+            StagingSlot *slot = slots[num_slots - 1];
+            uint64_t num_bytes = min<uint64_t>(size, slot_size - slot->used);
+            // Copies must be a multiple of 4 bytes, so pad the last
+            // chunk with zeros rather than reading past the end of the
+            // host data.
+            uint64_t copy_size = round_up_to_multiple_of_4(num_bytes);
+            memcpy(slot->mapped + slot->used, src, num_bytes);
+            memset(slot->mapped + slot->used + num_bytes, 0, copy_size - num_bytes);
+            wgpuCommandEncoderCopyBufferToBuffer(encoder, slot->buffer, slot->used,
+                                                 dst, dst_offset, copy_size);
+            slot->used += copy_size;
+            dst_offset += num_bytes;
+            src += num_bytes;
+            size -= num_bytes;
+        }
+        return halide_error_code_success;
     }
 
-    return halide_error_code_success;
-}
+    // Submit the staged copies. For readbacks, this waits for them to
+    // complete and copies the data out to the host.
+    int flush() {
+        if (!encoder) {
+            return halide_error_code_success;
+        }
+        if (!to_host && slots[num_slots - 1]->mapped) {
+            wgpuBufferUnmap(slots[num_slots - 1]->buffer);
+            slots[num_slots - 1]->mapped = nullptr;
+        }
+        WGPUCommandBuffer command_buffer = wgpuCommandEncoderFinish(encoder, nullptr);
+        wgpuQueueSubmit(context->queue, 1, &command_buffer);
+        wgpuCommandBufferRelease(command_buffer);
+        wgpuCommandEncoderRelease(encoder);
+        encoder = nullptr;
+
+        int err = halide_error_code_success;
+        if (to_host) {
+            // Start mapping every slot before waiting on any of them.
+            for (int i = 0; i < num_slots; i++) {
+                map_staging_slot(slots[i], WGPUMapMode_Read, slots[i]->used);
+            }
+            for (int i = 0; i < num_slots; i++) {
+                int result = wait_for_staging_slot(user_context, context, slots[i]);
+                if (result == halide_error_code_success) {
+                    slots[i]->mapped = (uint8_t *)wgpuBufferGetConstMappedRange(slots[i]->buffer, 0, slots[i]->used);
+                } else {
+                    err = halide_error_code_copy_to_host_failed;
+                }
+            }
+            for (int i = 0; i < num_chunks; i++) {
+                const Chunk &c = chunks[i];
+                if (c.slot->mapped) {
+                    memcpy(c.host, c.slot->mapped + c.offset, c.size);
+                }
+            }
+            for (int i = 0; i < num_slots; i++) {
+                if (slots[i]->mapped) {
+                    wgpuBufferUnmap(slots[i]->buffer);
+                    slots[i]->mapped = nullptr;
+                }
+            }
+        } else {
+            // Make the slots writable again for next time, without
+            // waiting for it here.
+            for (int i = 0; i < num_slots; i++) {
+                map_staging_slot(slots[i], WGPUMapMode_Write, slot_size);
+            }
+        }
+        num_slots = 0;
+        num_chunks = 0;
+        return err;
+    }
+};
 
 int do_multidimensional_copy(void *user_context, WgpuContext *context,
-                             const device_copy &c,
+                             StagingBatch *batch, const device_copy &c,
                              int64_t src_idx, int64_t dst_idx,
                              int d, bool from_host, bool to_host) {
     if (d > MAX_COPY_DIMS) {
@@ -625,14 +865,19 @@ int do_multidimensional_copy(void *user_context, WgpuContext *context,
                             << ", " << c.chunk_size << " bytes\n";
         uint64_t copy_size = round_up_to_multiple_of_4(c.chunk_size);
         if (!from_host && to_host) {
-            err = do_copy_to_host(user_context, context,
-                                  (uint8_t *)(c.dst + dst_idx),
-                                  src->buffer, src_idx + src->offset,
-                                  copy_size);
+            err = batch->add_readback(src->buffer, src_idx + src->offset,
+                                      (uint8_t *)(c.dst + dst_idx),
+                                      c.chunk_size);
         } else if (from_host && !to_host) {
-            wgpuQueueWriteBuffer(context->queue, dst->buffer,
-                                 dst_idx + dst->offset,
-                                 (void *)(c.src + src_idx), copy_size);
+            if (batch) {
+                err = batch->add_upload(dst->buffer, dst_idx + dst->offset,
+                                        (const uint8_t *)(c.src + src_idx),
+                                        c.chunk_size);
+            } else {
+                wgpuQueueWriteBuffer(context->queue, dst->buffer,
+                                     dst_idx + dst->offset,
+                                     (void *)(c.src + src_idx), copy_size);
+            }
         } else if (!from_host && !to_host) {
             // Create a command encoder and encode a copy command.
             WGPUCommandEncoder encoder =
@@ -659,7 +904,7 @@ int do_multidimensional_copy(void *user_context, WgpuContext *context,
     } else {
         ssize_t src_off = 0, dst_off = 0;
         for (int i = 0; i < (int)c.extent[d - 1]; i++) {
-            int err = do_multidimensional_copy(user_context, context, c,
+            int err = do_multidimensional_copy(user_context, context, batch, c,
                                                src_idx + src_off,
                                                dst_idx + dst_off,
                                                d - 1, from_host, to_host);
@@ -715,9 +960,23 @@ WEAK int halide_webgpu_buffer_copy(void *user_context,
 
         ErrorScope error_scope(user_context, context.device);
 
-        err = do_multidimensional_copy(user_context, &context, c,
+        // Readbacks always go through the staging ring. Uploads of a
+        // single contiguous chunk are left to wgpuQueueWriteBuffer, but
+        // uploads of many chunks are batched into one submission.
+        uint64_t num_chunks = 1;
+        for (int i = 0; i < MAX_COPY_DIMS; i++) {
+            num_chunks *= c.extent[i];
+        }
+        StagingBatch batch(user_context, &context, to_host);
+        bool use_batch = (from_host != to_host) && (to_host || num_chunks > 1);
+
+        err = do_multidimensional_copy(user_context, &context,
+                                       use_batch ? &batch : nullptr, c,
                                        c.src_begin, 0, dst->dimensions,
                                        from_host, to_host);
+        if (err == halide_error_code_success) {
+            err = batch.flush();
+        }
         if (err == halide_error_code_success) {
             err = error_scope.wait();
         }
@@ -879,6 +1138,8 @@ WEAK int halide_webgpu_run(void *user_context,
                            halide_type_t arg_types[],
                            void *args[],
                            int8_t arg_is_buffer[]) {
+    ScopedTimelineSpan span(TimelineKernel, entry_name);
+
     debug(user_context)
         << "WGPU: halide_webgpu_run (user_context: " << user_context << ", "
         << "entry: " << entry_name << ", "
@@ -27,6 +27,7 @@ extern WIN32API void DeleteCriticalSection(CriticalSection *);
 extern WIN32API void EnterCriticalSection(CriticalSection *);
 extern WIN32API void LeaveCriticalSection(CriticalSection *);
 extern WIN32API int32_t WaitForSingleObject(Thread, int32_t timeout);
+extern WIN32API uint32_t GetCurrentThreadId();
 
 }  // extern "C"
 
@@ -75,6 +76,10 @@ WEAK void halide_join_thread(halide_thread *thread_arg) {
     free(thread);
 }
 
+WEAK uint64_t halide_current_thread_id() {
+    return GetCurrentThreadId();
+}
+
 }  // extern "C"
 
 namespace Halide {
@@ -130,6 +135,17 @@ struct thread_parker {
 };
 
 }  // namespace Synchronization
+
+// The clock the thread pool uses to time its threads when stats
+// collection is enabled.
+ALWAYS_INLINE void thread_pool_start_clock() {
+    halide_start_clock(nullptr);
+}
+
+ALWAYS_INLINE int64_t thread_pool_clock_ns() {
+    return halide_current_time_ns(nullptr);
+}
+
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
@@ -0,0 +1,128 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_atomics.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+// Heap allocations in code compiled with the workspace target feature
+// come from a slot per allocation site. The slot keeps its block between
+// calls of the pipeline, and only reallocates it when a call needs a
+// larger one. A slot is used by one allocation at a time; if it is already
+// in use (by another thread running the same pipeline, or by another
+// iteration of a parallel loop), the allocation falls back to halide_malloc.
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// The slots that have ever held a block, so that
+// halide_release_workspaces can find them.
+WEAK halide_mutex workspace_lock = {{0}};
+WEAK halide_workspace_slot_t *workspace_slots = nullptr;
+
+// The block given to halide_set_static_workspace.
+WEAK void *static_workspace = nullptr;
+WEAK size_t static_workspace_size = 0;
+
+// Every block starts with a header, padded to keep the returned pointer as
+// aligned as halide_malloc's, that records the slot the block belongs to,
+// or null for a block allocated because its slot was in use.
+struct workspace_header_t {
+    halide_workspace_slot_t *slot;
+};
+constexpr size_t workspace_header_bytes = 128;
+
+ALWAYS_INLINE void *workspace_payload(void *block) {
+    return (uint8_t *)block + workspace_header_bytes;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+using namespace Halide::Runtime::Internal::Synchronization;
+
+extern "C" {
+
+WEAK void *halide_workspace_malloc(void *user_context, halide_workspace_slot_t *slot, size_t size) {
+    uintptr_t expected = 0, desired = 1;
+    if (!atomic_cas_strong_sequentially_consistent(&slot->in_use, &expected, &desired)) {
+        void *block = halide_malloc(user_context, size + workspace_header_bytes);
+        if (!block) {
+            return nullptr;
+        }
+        ((workspace_header_t *)block)->slot = nullptr;
+        return workspace_payload(block);
+    }
+
+    if (__builtin_expect(!slot->block || size > slot->size, 0)) {
+        if (!slot->registered) {
+            ScopedMutexLock lock(&workspace_lock);
+            slot->next = workspace_slots;
+            workspace_slots = slot;
+            slot->registered = 1;
+        }
+        if (slot->block) {
+            halide_free(user_context, slot->block);
+        }
+        slot->block = halide_malloc(user_context, size + workspace_header_bytes);
+        if (!slot->block) {
+            slot->size = 0;
+            uintptr_t zero = 0;
+            atomic_store_release(&slot->in_use, &zero);
+            return nullptr;
+        }
+        slot->size = size;
+        ((workspace_header_t *)slot->block)->slot = slot;
+    }
+    return workspace_payload(slot->block);
+}
+
+WEAK void halide_workspace_free(void *user_context, void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    void *block = (uint8_t *)ptr - workspace_header_bytes;
+    halide_workspace_slot_t *slot = ((workspace_header_t *)block)->slot;
+    if (slot) {
+        // Keep the block for the next call.
+        uintptr_t zero = 0;
+        atomic_store_release(&slot->in_use, &zero);
+    } else {
+        halide_free(user_context, block);
+    }
+}
+
+WEAK void halide_release_workspaces(void *user_context) {
+    ScopedMutexLock lock(&workspace_lock);
+    for (halide_workspace_slot_t *slot = workspace_slots; slot; slot = slot->next) {
+        // Skip slots in use by a running pipeline.
+        uintptr_t expected = 0, desired = 1;
+        if (atomic_cas_strong_sequentially_consistent(&slot->in_use, &expected, &desired)) {
+            if (slot->block) {
+                halide_free(user_context, slot->block);
+            }
+            slot->block = nullptr;
+            slot->size = 0;
+            uintptr_t zero = 0;
+            atomic_store_release(&slot->in_use, &zero);
+        }
+    }
+}
+
+WEAK void halide_set_static_workspace(void *ptr, size_t size) {
+    static_workspace = ptr;
+    static_workspace_size = ptr ? size : 0;
+}
+
+WEAK void *halide_static_workspace_malloc(void *user_context, size_t size) {
+    if (!static_workspace || size > static_workspace_size) {
+        error(user_context) << "The pipeline needs a static workspace of " << (uint64_t)size
+                            << " bytes, but the one set by halide_set_static_workspace has "
+                            << (uint64_t)static_workspace_size << " bytes.";
+        return nullptr;
+    }
+    return static_workspace;
+}
+}
@@ -36,6 +36,7 @@ WEAK CpuFeatures halide_get_cpu_features() {
     features.set_known(halide_target_feature_avx512_skylake);
     features.set_known(halide_target_feature_avx512_cannonlake);
     features.set_known(halide_target_feature_avx512_sapphirerapids);
+    features.set_known(halide_target_feature_avx512_fp16);
 
     int32_t info[4];
     cpuid(info, 1);
@@ -72,6 +73,7 @@ WEAK CpuFeatures halide_get_cpu_features() {
         constexpr uint32_t avx512ifma = 1U << 21;
         constexpr uint32_t avx512vnni = 1U << 11;  // vnni result in ecx
         constexpr uint32_t avx512bf16 = 1U << 5;   // bf16 result in eax, cpuid(eax=7, ecx=1)
+        constexpr uint32_t avx512fp16 = 1U << 23;  // fp16 result in edx
         constexpr uint32_t avx512 = avx512f | avx512cd;
         constexpr uint32_t avx512_knl = avx512 | avx512pf | avx512er;
         constexpr uint32_t avx512_skylake = avx512 | avx512vl | avx512bw | avx512dq;
@@ -95,6 +97,9 @@ WEAK CpuFeatures halide_get_cpu_features() {
                 if ((info2[2] & avx512vnni) == avx512vnni &&
                     (info3[0] & avx512bf16) == avx512bf16) {
                     features.set_available(halide_target_feature_avx512_sapphirerapids);
+                    if ((info2[3] & avx512fp16) == avx512fp16) {
+                        features.set_available(halide_target_feature_avx512_fp16);
+                    }
                 }
             }
         }
@@ -1,8 +1,10 @@
 #include "Halide.h"
-#include <cstdlib>   // setenv (or Windows _putenv_s)
-#include <iostream>  // std::cerr / std::endl
-#include <map>       // std::map
-#include <string>    // std::to_string
+#include <cstdlib>     // setenv (or Windows _putenv_s)
+#include <filesystem>  // std::filesystem::temp_directory_path
+#include <iostream>    // std::cerr / std::endl
+#include <map>         // std::map
+#include <string>      // std::to_string
+#include <vector>      // std::vector
 
 using namespace Halide;
 
@@ -55,6 +57,97 @@ bool test_caching(Pipeline &p1, Pipeline &p2, const Target &target) {
     return true;
 }
 
+bool test_search_threads(Pipeline &p1, Pipeline &p2, const Target &target) {
+    constexpr int parallelism = 32;
+    int seed = (int)time(nullptr);
+    AutoschedulerParams params(
+        "Adams2019",
+        {
+            {"parallelism", std::to_string(parallelism)},
+            {"random_dropout_seed", std::to_string(seed)},
+            // Make the random dropout actually drop some states.
+            {"random_dropout", "90"},
+            {"weights_path", weights_path},
+        });
+
+    params.extra["search_threads"] = "1";
+    auto results_one_thread = p1.apply_autoscheduler(target, params);
+
+    params.extra["search_threads"] = "8";
+    auto results_many_threads = p2.apply_autoscheduler(target, params);
+
+    // The same schedule should be found however many threads there are.
+    return (results_one_thread.schedule_source == results_many_threads.schedule_source &&
+            results_one_thread.featurization == results_many_threads.featurization);
+}
+
+bool test_block_cache_path(Pipeline &p1, Pipeline &p2, const Target &target) {
+    constexpr int parallelism = 32;
+    int seed = (int)time(nullptr);
+    std::string path = (std::filesystem::temp_directory_path() / "adams2019_block_cache.txt").string();
+    std::filesystem::remove(path);
+    AutoschedulerParams params(
+        "Adams2019",
+        {
+            {"parallelism", std::to_string(parallelism)},
+            {"random_dropout_seed", std::to_string(seed)},
+            {"weights_path", weights_path},
+            {"block_cache_path", path},
+        });
+
+    auto results_without_file = p1.apply_autoscheduler(target, params);
+    if (!std::filesystem::exists(path)) {
+        std::cerr << "No tilings were saved to " << path << std::endl;
+        return false;
+    }
+
+    // Reusing the saved tilings shouldn't change the schedule found.
+    auto results_with_file = p2.apply_autoscheduler(target, params);
+    std::filesystem::remove(path);
+    return (results_without_file.schedule_source == results_with_file.schedule_source &&
+            results_without_file.featurization == results_with_file.featurization);
+}
+
+bool test_time_limit(Pipeline &p, const Target &target) {
+    constexpr int parallelism = 32;
+    AutoschedulerParams params(
+        "Adams2019",
+        {
+            {"parallelism", std::to_string(parallelism)},
+            {"weights_path", weights_path},
+            // Run out of time immediately.
+            {"time_limit", "0.000001"},
+        });
+
+    // The first pass should still be completed, greedily, so that every
+    // Func gets a schedule.
+    auto results = p.apply_autoscheduler(target, params);
+    for (const Func &f : p.outputs()) {
+        if (results.schedule_source.find(f.name()) == std::string::npos) {
+            std::cerr << "No schedule for " << f.name() << " within the time limit:\n"
+                      << results.schedule_source << std::endl;
+            return false;
+        }
+    }
+    return !results.featurization.empty();
+}
+
+bool test_prefetch_distance(Pipeline &p, const Target &target) {
+    constexpr int parallelism = 32;
+    AutoschedulerParams params(
+        "Adams2019",
+        {
+            {"parallelism", std::to_string(parallelism)},
+            {"weights_path", weights_path},
+            {"prefetch_distance", "2"},
+        });
+
+    // Any prefetches added to the schedule must be legal to lower.
+    auto results = p.apply_autoscheduler(target, params);
+    p.compile_to_module(p.infer_arguments(), "prefetch_distance", target);
+    return !results.schedule_source.empty();
+}
+
 int main(int argc, char **argv) {
     if (argc != 3 || !strlen(argv[1]) || !strlen(argv[2])) {
         fprintf(stderr, "Usage: %s <autoscheduler-lib> <weights-path>\n", argv[0]);
@@ -902,6 +995,108 @@ int main(int argc, char **argv) {
         }
     }
 
+    // A chain of stencils with lots of states to expand
+    if (true) {
+        Pipeline p1;
+        Pipeline p2;
+        for (int test_condition = 0; test_condition < 2; test_condition++) {
+            Buffer<float> im(2048, 2048);
+            Func in("in");
+            in(x, y) = im(x, y);
+            std::vector<Func> chain{in};
+            for (int i = 0; i < 8; i++) {
+                Func blur("blur" + std::to_string(i));
+                Func prev = chain.back();
+                blur(x, y) = prev(x - 1, y) + prev(x, y - 1) + prev(x + 1, y) + prev(x, y + 1);
+                chain.push_back(blur);
+            }
+            chain.back().set_estimate(x, 1, 2000).set_estimate(y, 1, 2000);
+
+            if (test_condition) {
+                p2 = Pipeline(chain.back());
+            } else {
+                p1 = Pipeline(chain.back());
+            }
+        }
+
+        if (!test_search_threads(p1, p2, target)) {
+            std::cerr << "Schedule depends on the number of search threads" << std::endl;
+            return 1;
+        }
+    }
+
+    // The same chain, scheduled using tilings saved by an earlier search
+    if (true) {
+        Pipeline p1;
+        Pipeline p2;
+        for (int test_condition = 0; test_condition < 2; test_condition++) {
+            Buffer<float> im(2048, 2048);
+            Func in("in");
+            in(x, y) = im(x, y);
+            std::vector<Func> chain{in};
+            for (int i = 0; i < 8; i++) {
+                Func blur("blur" + std::to_string(i));
+                Func prev = chain.back();
+                blur(x, y) = prev(x - 1, y) + prev(x, y - 1) + prev(x + 1, y) + prev(x, y + 1);
+                chain.push_back(blur);
+            }
+            chain.back().set_estimate(x, 1, 2000).set_estimate(y, 1, 2000);
+
+            if (test_condition) {
+                p2 = Pipeline(chain.back());
+            } else {
+                p1 = Pipeline(chain.back());
+            }
+        }
+
+        if (!test_block_cache_path(p1, p2, target)) {
+            std::cerr << "Schedule changed when reusing saved tilings" << std::endl;
+            return 1;
+        }
+    }
+
+    // The same chain, scheduled with a time limit
+    if (true) {
+        Buffer<float> im(2048, 2048);
+        Func in("in");
+        in(x, y) = im(x, y);
+        std::vector<Func> chain{in};
+        for (int i = 0; i < 8; i++) {
+            Func blur("blur" + std::to_string(i));
+            Func prev = chain.back();
+            blur(x, y) = prev(x - 1, y) + prev(x, y - 1) + prev(x + 1, y) + prev(x, y + 1);
+            chain.push_back(blur);
+        }
+        chain.back().set_estimate(x, 1, 2000).set_estimate(y, 1, 2000);
+        Pipeline p(chain.back());
+
+        if (!test_time_limit(p, target)) {
+            std::cerr << "No complete schedule was found within the time limit" << std::endl;
+            return 1;
+        }
+    }
+
+    // The same chain, with prefetching
+    if (true) {
+        Buffer<float> im(2048, 2048);
+        Func in("in");
+        in(x, y) = im(x, y);
+        std::vector<Func> chain{in};
+        for (int i = 0; i < 8; i++) {
+            Func blur("blur" + std::to_string(i));
+            Func prev = chain.back();
+            blur(x, y) = prev(x - 1, y) + prev(x, y - 1) + prev(x + 1, y) + prev(x, y + 1);
+            chain.push_back(blur);
+        }
+        chain.back().set_estimate(x, 1, 2000).set_estimate(y, 1, 2000);
+        Pipeline p(chain.back());
+
+        if (!test_prefetch_distance(p, target)) {
+            std::cerr << "No schedule was found with prefetching" << std::endl;
+            return 1;
+        }
+    }
+
     std::cout << "adams2019 testing passed\n";
     return 0;
 }
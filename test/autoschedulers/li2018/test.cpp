@@ -154,6 +154,50 @@ int main(int argc, char **argv) {
         //           << result.schedule_source << "\n\n";
     }
 
+    Target gpu_target = get_jit_target_from_environment();
+    if (gpu_target.has_gpu_feature()) {
+        // The gradient of a 2D convolution, which reduces over the whole
+        // image to produce each filter weight, should run on the GPU
+        // without a manual schedule.
+        Buffer<float> input(256, 256), weights(3, 3);
+        input.for_each_element([&](int x, int y) { input(x, y) = (float)((x + 2 * y) % 7); });
+        weights.fill(1.f);
+
+        Func clamped("clamped");
+        clamped(x, y) = input(clamp(x, 0, 255), clamp(y, 0, 255));
+        RDom r(0, 3, 0, 3);
+        Func conv("conv");
+        conv(x, y) += clamped(x + r.x, y + r.y) * weights(r.x, r.y);
+        RDom all(0, 254, 0, 254);
+        Func loss("loss");
+        loss() += conv(all.x, all.y);
+
+        Derivative d = propagate_adjoints(loss);
+        Func d_weights = d(weights);
+        d_weights.set_estimate(x, 0, 3).set_estimate(y, 0, 3);
+
+        Pipeline p(d_weights);
+        p.apply_autoscheduler(gpu_target, params);
+        Buffer<float> result = p.realize({3, 3}, gpu_target);
+        result.copy_to_host();
+        for (int j = 0; j < 3; j++) {
+            for (int i = 0; i < 3; i++) {
+                // d(loss)/d(weights(i, j)) is the sum of the inputs it is
+                // multiplied by.
+                float correct = 0;
+                for (int yy = 0; yy < 254; yy++) {
+                    for (int xx = 0; xx < 254; xx++) {
+                        correct += input(xx + i, yy + j);
+                    }
+                }
+                if (std::abs(result(i, j) - correct) > 1e-3f * correct) {
+                    printf("d_weights(%d, %d) = %f instead of %f\n", i, j, result(i, j), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
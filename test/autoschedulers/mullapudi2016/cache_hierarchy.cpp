@@ -0,0 +1,69 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+// Schedule a small stencil chain with the given autoscheduler parameters,
+// and check that it still computes the right thing.
+int check(const AutoschedulerParams &params) {
+    Buffer<int> input(1030, 1030);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (x * 7 + y * 13) & 0xff;
+    });
+
+    Var x("x"), y("y");
+    Func blur_x("blur_x"), blur_y("blur_y");
+    blur_x(x, y) = input(x, y) + input(x + 1, y) + input(x + 2, y);
+    blur_y(x, y) = blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2);
+    blur_y.set_estimate(x, 0, 1024).set_estimate(y, 0, 1024);
+
+    Target target = get_jit_target_from_environment();
+    Pipeline p(blur_y);
+    p.apply_autoscheduler(target, params);
+
+    Buffer<int> out = p.realize({1024, 1024});
+    for (int yy = 0; yy < out.height(); yy++) {
+        for (int xx = 0; xx < out.width(); xx++) {
+            int correct = 0;
+            for (int dy = 0; dy < 3; dy++) {
+                for (int dx = 0; dx < 3; dx++) {
+                    correct += input(xx + dx, yy + dy);
+                }
+            }
+            if (out(xx, yy) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), correct);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] Autoschedulers do not support WebAssembly.\n");
+        return 0;
+    }
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <autoscheduler-lib>\n", argv[0]);
+        return 1;
+    }
+
+    load_plugin(argv[1]);
+
+    // An explicit multi-level cache hierarchy
+    if (check({"Mullapudi2016",
+               {{"l1_cache_size", "32768"},
+                {"l2_cache_size", "1048576"},
+                {"last_level_cache_size", "33554432"}}})) {
+        return 1;
+    }
+
+    // Whatever the host has
+    if (check({"Mullapudi2016", {{"detect_host", "1"}}})) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
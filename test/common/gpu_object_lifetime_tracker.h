@@ -22,7 +22,7 @@ class GpuObjectLifetimeTracker {
         }
     };
 
-    std::array<ObjectType, 22> object_types = {{
+    std::array<ObjectType, 23> object_types = {{
         {"Caching compiled kernel:", "Releasing cached compilation:"},
 
         // OpenCL objects
@@ -36,6 +36,7 @@ class GpuObjectLifetimeTracker {
         // CUDA objects
         {"cuCtxCreate", "cuCtxDestroy", true},
         {"cuMemAlloc", "cuMemFree"},
+        {"allocating page-locked host memory", "releasing page-locked host allocation"},
 
         // Metal objects
         {"Allocating: MTLCreateSystemDefaultDevice", "Releasing: MTLCreateSystemDefaultDevice", true},
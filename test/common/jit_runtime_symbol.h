@@ -0,0 +1,33 @@
+#ifndef HALIDE_TEST_JIT_RUNTIME_SYMBOL_H
+#define HALIDE_TEST_JIT_RUNTIME_SYMBOL_H
+
+#include "Halide.h"
+
+namespace Halide {
+namespace Internal {
+namespace Test {
+
+// Find a function exported by the JIT runtime modules for a target,
+// such as a GPU runtime switch that has no wrapper in the JIT API.
+// The device runtime modules aren't loaded until something has run on
+// the device, so this runs something trivial first. Returns nullptr
+// if no runtime module exports the symbol.
+template<typename T>
+T find_jit_runtime_symbol(const Target &target, const char *name) {
+    evaluate_may_gpu<float>(Expr(0.f));
+
+    auto runtime_modules = JITSharedRuntime::get(nullptr, target, false);
+    for (JITModule &m : runtime_modules) {
+        auto sym = m.find_symbol_by_name(name);
+        if (sym.address != nullptr) {
+            return (T)sym.address;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace Test
+}  // namespace Internal
+}  // namespace Halide
+
+#endif  // HALIDE_TEST_JIT_RUNTIME_SYMBOL_H
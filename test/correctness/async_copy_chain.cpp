@@ -92,6 +92,19 @@ int main(int argc, char **argv) {
         check(B);
     }
 
+    // A copy stage double-buffered across tiles
+    {
+        Func A, B;
+        make_pipeline(A, B);
+
+        Var xo, yo, xi, yi;
+        B.tile(x, y, xo, yo, xi, yi, 32, 16);
+        A.compute_root();
+        A.in().copy_to_host().double_buffer(B, xo, yo, x, 32);
+
+        check(B);
+    }
+
     if (get_jit_target_from_environment().has_gpu_feature()) {
         // Two copy stages, to the device and back, flat
         {
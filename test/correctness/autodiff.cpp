@@ -1417,6 +1417,57 @@ void test_random_float() {
     check(__LINE__, d_input(), o(0));
 }
 
+void test_checkpointing() {
+    Var x("x");
+    Buffer<float> input(10);
+    for (int i = 0; i < 10; i++) {
+        input(i) = (float)i / 10.f;
+    }
+    Func clamped = BoundaryConditions::repeat_edge(input);
+    std::vector<Func> chain;
+    Func prev = clamped;
+    for (int i = 0; i < 4; i++) {
+        Func f("chain_" + std::to_string(i));
+        f(x) = sin(prev(x - 1)) * prev(x + 1) + prev(x);
+        chain.push_back(f);
+        prev = f;
+    }
+    RDom r(0, 10);
+    Func f_loss("f_loss");
+    f_loss() += prev(r.x) * prev(r.x);
+
+    Buffer<float> expected = propagate_adjoints(f_loss)(input).realize({10});
+
+    for (int pass = 0; pass < 3; pass++) {
+        std::vector<Func> checkpoints;
+        if (pass == 1) {
+            checkpoints = {chain[1]};
+        } else if (pass == 2) {
+            checkpoints = choose_checkpoints(f_loss);
+            _halide_user_assert(!checkpoints.empty()) << "No checkpoints were chosen\n";
+        }
+        Func d_input = propagate_adjoints(f_loss, checkpoints)(input);
+
+        // The adjoint should only call the forward Funcs that are kept.
+        std::map<std::string, Function> calls = find_transitive_calls(d_input.function());
+        for (const auto &f : chain) {
+            bool kept = false;
+            for (const auto &c : checkpoints) {
+                kept |= c.name() == f.name();
+            }
+            if (calls.count(f.name()) && !kept) {
+                printf("The adjoint calls %s, which should have been recomputed\n", f.name().c_str());
+                exit(1);
+            }
+        }
+
+        Buffer<float> d_input_buf = d_input.realize({10});
+        for (int i = 0; i < 10; i++) {
+            check(__LINE__, d_input_buf(i), expected(i), 1e-4f);
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     test_scalar<float>();
     test_scalar<double>();
@@ -1459,6 +1510,7 @@ int main(int argc, char **argv) {
     test_custom_adjoint_buffer();
     test_print();
     test_random_float();
+    test_checkpointing();
     printf("[autodiff] Success!\n");
     return 0;
 }
@@ -229,5 +229,32 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (t.arch != Target::WebAssembly) {
+        // Check that a Callable can be compiled for whichever of several
+        // targets the host can use.
+        Param<int32_t> p_int(42);
+        Var x;
+        Func f;
+        f(x) = x * p_int;
+        f.vectorize(x, 8);
+
+        std::vector<Target> targets;
+        if (t.arch == Target::X86) {
+            targets.push_back(t.with_feature(Target::AVX512_Skylake));
+            targets.push_back(t.with_feature(Target::AVX2).with_feature(Target::FMA).with_feature(Target::F16C));
+        }
+        targets.push_back(t);
+        Callable c = f.compile_to_callable({p_int}, targets);
+
+        Buffer<int32_t> out(64);
+        check(c(3, out));
+        for (int i = 0; i < 64; i++) {
+            if (out(i) != i * 3) {
+                printf("out[%d] = %d instead of %d\n", i, out(i), i * 3);
+                exit(1);
+            }
+        }
+    }
+
     printf("Success!\n");
 }
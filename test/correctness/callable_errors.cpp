@@ -172,6 +172,11 @@ void test_bad_typed_calls() {
 
         c.make_std_function<Buffer<uint8_t, 2>, int32_t, float, bool>();
         expect_failure(-1, "Argument 4 of 4 ('fn3') was expected to be a buffer of type 'uint8' and dimension 2");
+
+        // bind() checks the signature the same way, and calls to the result fail too
+        auto c_bound = c.bind<Buffer<uint8_t, 2>, int32_t, bool, Buffer<uint8_t, 2>>();
+        expect_failure(-1, "Argument 3 of 4 ('p_float') was expected to be a scalar of type 'float32' and dimension 0");
+        expect_failure(c_bound(in1, 2, true, result1), "Argument 3 of 4 ('p_float') was expected to be a scalar of type 'float32' and dimension 0");
     }
 
     // Test custom error handler in the JITUserContext
@@ -109,6 +109,39 @@ int main(int argc, char **argv) {
         }
     }
 
+    // Check that Callables bound to a signature work, with and without
+    // an explicit JITUserContext.
+    {
+        Param<int32_t> p_int(42);
+        ImageParam p_img(UInt(8), 1);
+
+        Var x("x");
+        Func f("f");
+
+        f(x) = p_img(x) + cast<uint8_t>(p_int);
+
+        auto c = f.compile_to_callable({p_img, p_int}, t)
+                     .bind<Buffer<uint8_t>, int, Buffer<uint8_t>>();
+        assert(c.defined());
+
+        Buffer<uint8_t> in(10);
+        for (int i = 0; i < 10; i++) {
+            in(i) = i;
+        }
+
+        Buffer<uint8_t> out1(10);
+        check(c(in, 42, out1));
+
+        Buffer<uint8_t> out2(10);
+        JITUserContext empty;
+        check(c(&empty, in, 7, out2));
+
+        for (int i = 0; i < 10; i++) {
+            assert(out1(i) == i + 42);
+            assert(out2(i) == i + 7);
+        }
+    }
+
     // Override Halide's malloc and free (except under wasm),
     // make sure that Callable freezes the values
     if (t.arch != Target::WebAssembly) {
@@ -0,0 +1,197 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Record the decisions taken to stay within code size budgets.
+class RecordDecisions : public CompilerLogger {
+public:
+    struct Decision {
+        std::string func, loop, transform;
+        bool applied;
+    };
+    std::vector<Decision> &decisions;
+
+    RecordDecisions(std::vector<Decision> &decisions)
+        : decisions(decisions) {
+    }
+
+    void record_matched_simplifier_rule(const std::string &rulename, Expr expr) override {
+    }
+    void record_non_monotonic_loop_var(const std::string &loop_var, Expr expr) override {
+    }
+    void record_failed_to_prove(Expr failed_to_prove, Expr original_expr) override {
+    }
+    void record_object_code_size(uint64_t bytes) override {
+    }
+    void record_compilation_time(Phase phase, double duration) override {
+    }
+    void record_code_size_decision(const std::string &func, const std::string &loop,
+                                   const std::string &transform, uint64_t cost,
+                                   bool applied) override {
+        decisions.push_back({func, loop, transform, applied});
+    }
+    std::ostream &emit_to_stream(std::ostream &o) override {
+        return o;
+    }
+};
+
+// Count the loops of each type with each name.
+class CountLoops : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const For *op) override {
+        loops[op->name]++;
+        if (op->for_type == ForType::Serial) {
+            serial[op->name]++;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    std::map<std::string, int> loops, serial;
+};
+
+std::vector<RecordDecisions::Decision> decisions;
+
+void start_recording() {
+    decisions.clear();
+    set_compiler_logger(std::unique_ptr<CompilerLogger>(new RecordDecisions(decisions)));
+}
+
+void stop_recording() {
+    set_compiler_logger(nullptr);
+}
+
+int unroll_test(int budget, CountLoops &counter) {
+    Func f("f");
+    Var x("x"), y("y"), xo("xo"), xi("xi");
+    f(x, y) = x * 3 + y;
+    f.bound(x, 0, 16).split(x, xo, xi, 4).unroll(xi).unroll(xo);
+    if (budget) {
+        f.code_size_budget(budget);
+    }
+
+    f.add_custom_lowering_pass(&counter, nullptr);
+    Buffer<int> result = f.realize({16, 8});
+    for (int j = 0; j < result.height(); j++) {
+        for (int i = 0; i < result.width(); i++) {
+            if (result(i, j) != i * 3 + j) {
+                printf("result(%d, %d) = %d instead of %d\n", i, j, result(i, j), i * 3 + j);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int partition_test(int budget, CountLoops &counter) {
+    Buffer<int> input(100);
+    for (int i = 0; i < input.width(); i++) {
+        input(i) = i * i;
+    }
+    Func clamped = BoundaryConditions::repeat_edge(input);
+
+    Func g("g");
+    Var x("x");
+    g(x) = clamped(x - 1) + clamped(x + 1);
+    if (budget) {
+        g.code_size_budget(budget);
+    }
+
+    g.add_custom_lowering_pass(&counter, nullptr);
+    Buffer<int> result = g.realize({100});
+    for (int i = 0; i < result.width(); i++) {
+        int correct = input(std::max(i - 1, 0)) + input(std::min(i + 1, 99));
+        if (result(i) != correct) {
+            printf("result(%d) = %d instead of %d\n", i, result(i), correct);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    // With a generous budget, both loops are unrolled.
+    {
+        CountLoops counter;
+        start_recording();
+        if (unroll_test(1000000, counter)) {
+            return 1;
+        }
+        stop_recording();
+        if (counter.loops.count("f.s0.x.xo") || counter.loops.count("f.s0.x.xi")) {
+            printf("The loops should have been unrolled\n");
+            return 1;
+        }
+        if (decisions.size() != 2 ||
+            !decisions[0].applied || !decisions[1].applied) {
+            printf("Expected two unrolling decisions to be recorded\n");
+            return 1;
+        }
+        // The inner loop is expected to benefit most, so it's
+        // considered first.
+        if (decisions[0].loop != "f.s0.x.xi" || decisions[0].transform != "unroll") {
+            printf("The inner loop should have been considered first, not %s\n",
+                   decisions[0].loop.c_str());
+            return 1;
+        }
+    }
+
+    // With a tiny budget, the loops stay serial.
+    {
+        CountLoops counter;
+        start_recording();
+        if (unroll_test(1, counter)) {
+            return 1;
+        }
+        stop_recording();
+        if (counter.serial["f.s0.x.xo"] != 1 || counter.serial["f.s0.x.xi"] != 1) {
+            printf("The loops should not have been unrolled\n");
+            return 1;
+        }
+        for (const auto &d : decisions) {
+            if (d.applied) {
+                printf("Nothing should have fit in the budget, but %s of %s did\n",
+                       d.transform.c_str(), d.loop.c_str());
+                return 1;
+            }
+        }
+    }
+
+    // Without a budget, the boundary condition gets a loop of its own
+    // at each end.
+    {
+        CountLoops counter;
+        if (partition_test(0, counter)) {
+            return 1;
+        }
+        if (counter.loops["g.s0.x"] != 3) {
+            printf("The loop over g should have been partitioned into 3, not %d\n",
+                   counter.loops["g.s0.x"]);
+            return 1;
+        }
+    }
+
+    // With a tiny budget, it doesn't.
+    {
+        CountLoops counter;
+        start_recording();
+        if (partition_test(1, counter)) {
+            return 1;
+        }
+        stop_recording();
+        if (counter.loops["g.s0.x"] != 1) {
+            printf("The loop over g should not have been partitioned\n");
+            return 1;
+        }
+        if (decisions.empty() || decisions[0].transform != "partition" || decisions[0].applied) {
+            printf("Expected a decision not to partition the loop over g\n");
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
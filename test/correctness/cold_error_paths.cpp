@@ -0,0 +1,124 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+std::vector<std::string> load_file_to_lines(const std::string &filename) {
+    std::vector<std::string> lines;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+bool error_called = false;
+void my_error(JITUserContext *, const char *msg) {
+    error_called = true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT doesn't support custom error handlers.\n");
+        return 0;
+    }
+
+    ImageParam in(Int(32), 2, "in");
+    Param<int> scale("scale");
+    Var x("x"), y("y");
+    Func f("f");
+    // The requirement's message is built from several values, so its
+    // failure path is long enough to be worth outlining.
+    f(x, y) = require(scale > 0, in(x, y) * scale,
+                      "scale must be positive, but was", scale,
+                      "for an input of size", in.dim(0).extent(), "x", in.dim(1).extent());
+
+    // Every error call on the assertion failure paths is marked cold,
+    // and the long ones are outlined into separate cold functions.
+    {
+        std::string ll_file = Internal::get_test_tmp_dir() + "cold_error_paths.ll";
+        Internal::ensure_no_file_exists(ll_file);
+        f.compile_to_llvm_assembly(ll_file, {in, scale}, "f", target.with_feature(Target::NoRuntime));
+        Internal::assert_file_exists(ll_file);
+        std::vector<std::string> lines = load_file_to_lines(ll_file);
+
+        std::map<std::string, bool> cold_attribute_groups;
+        for (const auto &line : lines) {
+            if (Internal::starts_with(line, "attributes #")) {
+                std::string group = line.substr(11, line.find(' ', 11) - 11);
+                cold_attribute_groups[group] = line.find(" cold") != std::string::npos;
+            }
+        }
+
+        int error_calls = 0;
+        bool in_cold_function = false, outlined = false;
+        for (const auto &line : lines) {
+            if (Internal::starts_with(line, "define ")) {
+                in_cold_function = line.find(".cold") != std::string::npos;
+            }
+            if (line.find("call ") == std::string::npos ||
+                line.find("@halide_error_") == std::string::npos) {
+                continue;
+            }
+            error_calls++;
+            size_t hash = line.rfind(" #");
+            std::string group = hash == std::string::npos ? "" : line.substr(hash + 1);
+            if (!cold_attribute_groups[group]) {
+                printf("Error call isn't marked cold:\n%s\n", line.c_str());
+                return 1;
+            }
+            if (in_cold_function && line.find("@halide_error_requirement_failed") != std::string::npos) {
+                outlined = true;
+            }
+        }
+        if (error_calls == 0) {
+            printf("Found no error calls in %s\n", ll_file.c_str());
+            return 1;
+        }
+        if (!outlined) {
+            printf("The failure path of the requirement wasn't outlined into a cold function\n");
+            return 1;
+        }
+    }
+
+    // The checks still work.
+    Callable c = f.compile_to_callable({in, scale}, target);
+    Buffer<int> input(16, 8), output(16, 8);
+    input.fill(3);
+    JITUserContext context;
+    context.handlers.custom_error = my_error;
+
+    int result = c(&context, input, 2, output);
+    if (result != 0 || error_called) {
+        printf("Pipeline failed unexpectedly: %d\n", result);
+        return 1;
+    }
+    for (int yy = 0; yy < output.height(); yy++) {
+        for (int xx = 0; xx < output.width(); xx++) {
+            if (output(xx, yy) != 6) {
+                printf("output(%d, %d) = %d instead of 6\n", xx, yy, output(xx, yy));
+                return 1;
+            }
+        }
+    }
+
+    result = c(&context, input, -1, output);
+    if (result != halide_error_code_requirement_failed || !error_called) {
+        printf("The exit status was %d instead of %d\n", result, halide_error_code_requirement_failed);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+bool error_occurred = false;
+void my_error(JITUserContext *user_context, const char *msg) {
+    error_occurred = true;
+}
+
+int main(int argc, char **argv) {
+    Buffer<uint8_t> input(64, 64);
+    input.for_each_element([&](int x, int y) { input(x, y) = (uint8_t)(x * 3 + y * 5); });
+
+    Var x("x"), y("y");
+    ImageParam in(UInt(8), 2, "in");
+    Param<int> offset("offset");
+
+    // Two pipelines written separately over the same input.
+    Func scaled("scaled");
+    scaled(x, y) = in(x, y) * 2;
+    Pipeline scale_pipeline(scaled);
+    scale_pipeline.add_requirement(offset >= 0, "offset must be non-negative");
+
+    Func shifted("shifted");
+    shifted(x, y) = cast<int>(in(x, y)) + offset;
+    Pipeline shift_pipeline(shifted);
+
+    // Combine them, and compute both over the same rows of the input.
+    Pipeline combined = Pipeline::combine({scale_pipeline, shift_pipeline});
+    shifted.compute_with(scaled, y);
+
+    if (combined.outputs().size() != 2) {
+        printf("The combined pipeline has %d outputs instead of 2\n", (int)combined.outputs().size());
+        return 1;
+    }
+
+    in.set(input);
+    offset.set(7);
+    Buffer<uint8_t> scaled_out(64, 64);
+    Buffer<int> shifted_out(64, 64);
+    combined.realize({scaled_out, shifted_out});
+
+    for (int yy = 0; yy < 64; yy++) {
+        for (int xx = 0; xx < 64; xx++) {
+            uint8_t correct_scaled = (uint8_t)(input(xx, yy) * 2);
+            int correct_shifted = input(xx, yy) + 7;
+            if (scaled_out(xx, yy) != correct_scaled || shifted_out(xx, yy) != correct_shifted) {
+                printf("At (%d, %d): scaled = %d instead of %d, shifted = %d instead of %d\n",
+                       xx, yy, scaled_out(xx, yy), correct_scaled, shifted_out(xx, yy), correct_shifted);
+                return 1;
+            }
+        }
+    }
+
+    // The requirements of the pipelines are checked by the combined one.
+    combined.jit_handlers().custom_error = my_error;
+    offset.set(-1);
+    combined.realize({scaled_out, shifted_out});
+    if (!error_occurred) {
+        printf("The requirement of the first pipeline was not checked\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
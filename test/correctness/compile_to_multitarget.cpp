@@ -2,6 +2,8 @@
 #include "halide_test_dirs.h"
 
 #include <cstdio>
+#include <fstream>
+#include <sstream>
 
 using namespace Halide;
 
@@ -12,6 +14,21 @@ std::string leaf_name(const std::string &path) {
     return path.substr(sep == std::string::npos ? 0 : sep + 1);
 }
 
+std::string read_file(const std::string &path) {
+    std::ifstream f(path, std::ios::binary);
+    std::stringstream contents;
+    contents << f.rdbuf();
+    return contents.str();
+}
+
+void set_compile_multitarget_threads(const char *threads) {
+#ifdef _WIN32
+    _putenv_s("HL_COMPILE_MULTITARGET_THREADS", threads);
+#else
+    setenv("HL_COMPILE_MULTITARGET_THREADS", threads, 1);
+#endif
+}
+
 std::string get_output_path_prefix(const std::string &base) {
     return Internal::get_test_tmp_dir() + "halide_test_correctness_compile_to_multitarget_" + base;
 }
@@ -222,6 +239,58 @@ void test_compile_to_everything(Func j, bool do_object) {
     }
 }
 
+void test_compile_is_deterministic(Func j) {
+    std::string filename_prefix = get_output_path_prefix("c7");
+    const char *o = get_host_target().os == Target::Windows ? ".obj" : ".o";
+
+    std::vector<std::string> target_strings = {
+        "host-profile-no_bounds_query",
+        "host-profile",
+        "host",
+    };
+
+    std::vector<Target> targets;
+    for (auto s : target_strings) {
+        targets.emplace_back(s);
+    }
+
+    auto args = j.infer_arguments();
+    auto module_producer = [&j, &args](const std::string &name, const Target &target) -> Module {
+        return j.compile_to_module(args, name, target);
+    };
+    std::map<OutputFileType, std::string> outputs = {
+        {OutputFileType::llvm_assembly, filename_prefix + ".ll"},
+        {OutputFileType::object, filename_prefix + o},
+        {OutputFileType::stmt, filename_prefix + ".stmt"},
+    };
+    std::string function_name = leaf_name(filename_prefix);
+
+    // Compiling the sub-targets on one thread or on several must give
+    // the same output. Start each compilation from the same unique_name
+    // counters, so that lowering makes the same names each time.
+    const Internal::UniqueNameCounters start;
+    std::vector<std::string> first;
+    for (const char *threads : {"1", "3", "3"}) {
+        set_compile_multitarget_threads(threads);
+        Internal::ScopedUniqueNameCounters names(start);
+        compile_multitarget(function_name, outputs, targets, target_strings, module_producer);
+
+        std::vector<std::string> contents;
+        for (const auto &s : target_strings) {
+            for (const char *ext : {".ll", ".stmt"}) {
+                contents.push_back(read_file(filename_prefix + "-" + s + ext));
+            }
+        }
+        if (first.empty()) {
+            first = contents;
+        } else if (contents != first) {
+            printf("Output of compile_multitarget on %s threads differs from the output on one thread\n", threads);
+            exit(1);
+        }
+    }
+    set_compile_multitarget_threads("");
+}
+
 int main(int argc, char **argv) {
     Param<float> factor("factor");
     Func f, g, h, j;
@@ -241,6 +310,7 @@ int main(int argc, char **argv) {
     test_compile_to_object_files_single_target(j);
     test_compile_to_everything(j, /*do_object*/ true);
     test_compile_to_everything(j, /*do_object*/ false);
+    test_compile_is_deterministic(j);
 
     printf("Success!\n");
     return 0;
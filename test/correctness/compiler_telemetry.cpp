@@ -0,0 +1,86 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Record the sizes of the LoweredFuncs and the peak memory use.
+class RecordTelemetry : public CompilerLogger {
+public:
+    struct Size {
+        uint64_t ir_nodes = 0, object_code_size = 0;
+    };
+    std::map<std::string, Size> &funcs;
+    uint64_t &peak_rss;
+
+    RecordTelemetry(std::map<std::string, Size> &funcs, uint64_t &peak_rss)
+        : funcs(funcs), peak_rss(peak_rss) {
+    }
+
+    void record_matched_simplifier_rule(const std::string &rulename, Expr expr) override {
+    }
+    void record_non_monotonic_loop_var(const std::string &loop_var, Expr expr) override {
+    }
+    void record_failed_to_prove(Expr failed_to_prove, Expr original_expr) override {
+    }
+    void record_object_code_size(uint64_t bytes) override {
+    }
+    void record_compilation_time(Phase phase, double duration) override {
+    }
+    void record_lowered_func(const std::string &name, uint64_t ir_node_count) override {
+        funcs[name].ir_nodes = ir_node_count;
+    }
+    void record_lowered_func_object_code_size(const std::string &name, uint64_t bytes) override {
+        funcs[name].object_code_size += bytes;
+    }
+    void record_peak_rss(uint64_t bytes) override {
+        peak_rss = bytes;
+    }
+    std::ostream &emit_to_stream(std::ostream &o) override {
+        return o;
+    }
+};
+
+int main(int argc, char **argv) {
+    Func f("f");
+    Var x("x"), y("y");
+    f(x, y) = x * y + 3;
+    f.parallel(y);
+
+    std::string object_file = get_test_tmp_dir() + "compiler_telemetry.o";
+    ensure_no_file_exists(object_file);
+
+    std::map<std::string, RecordTelemetry::Size> funcs;
+    uint64_t peak_rss = 0;
+    set_compiler_logger(std::unique_ptr<CompilerLogger>(new RecordTelemetry(funcs, peak_rss)));
+    f.compile_to_object(object_file, {}, "compiler_telemetry", get_host_target());
+    set_compiler_logger(nullptr);
+
+    assert_file_exists(object_file);
+
+    // The pipeline and the closure for the body of the parallel loop
+    // are each a LoweredFunc.
+    if (funcs.size() < 2 || !funcs.count("compiler_telemetry")) {
+        printf("Expected the pipeline and its parallel closure to be recorded\n");
+        return 1;
+    }
+    for (const auto &it : funcs) {
+        if (it.second.ir_nodes == 0) {
+            printf("No IR was recorded for %s\n", it.first.c_str());
+            return 1;
+        }
+    }
+    if (funcs["compiler_telemetry"].object_code_size == 0) {
+        printf("No object code was recorded for the pipeline\n");
+        return 1;
+    }
+    if (peak_rss == 0) {
+        printf("No peak memory use was recorded\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -2204,6 +2204,65 @@ int two_compute_at_test() {
     return 0;
 }
 
+// Stages fused at a vectorized loop should load their common inputs once.
+int shared_vector_loads_test() {
+    const int width = 64;
+    const int height = 16;
+    Buffer<int> in(width + 2, height + 2);
+    in.set_min(-1, -1);
+    in.for_each_element([&](int x, int y) {
+        in(x, y) = x * 7 + y * y;
+    });
+
+    Var x("x"), y("y"), xo("xo"), xi("xi");
+    Func gx("gx"), gy("gy");
+    gx(x, y) = in(x + 1, y) - in(x - 1, y);
+    gy(x, y) = in(x, y + 1) - in(x, y - 1) + in(x + 1, y);
+
+    gx.bound(x, 0, width).bound(y, 0, height).split(x, xo, xi, 8).vectorize(xi);
+    gy.bound(x, 0, width).bound(y, 0, height).split(x, xo, xi, 8).vectorize(xi).compute_with(gx, xi);
+
+    class CountInputLoads : public IRMutator {
+        using IRMutator::visit;
+
+        Expr visit(const Load *op) override {
+            if (op->name == in_name && op->type.is_vector()) {
+                count++;
+            }
+            return IRMutator::visit(op);
+        }
+
+    public:
+        string in_name;
+        int count = 0;
+    };
+
+    CountInputLoads *counter = new CountInputLoads;
+    counter->in_name = in.name();
+    Pipeline p({gx, gy});
+    p.add_custom_lowering_pass(counter);
+    Buffer<int> gx_im(width, height), gy_im(width, height);
+    p.realize({gx_im, gy_im});
+
+    if (counter->count != 4) {
+        printf("Expected 4 vector loads of the input, but saw %d\n", counter->count);
+        return 1;
+    }
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int correct_gx = in(x + 1, y) - in(x - 1, y);
+            int correct_gy = in(x, y + 1) - in(x, y - 1) + in(x + 1, y);
+            if (gx_im(x, y) != correct_gx || gy_im(x, y) != correct_gy) {
+                printf("gx, gy(%d, %d) = %d, %d instead of %d, %d\n",
+                       x, y, gx_im(x, y), gy_im(x, y), correct_gx, correct_gy);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -2248,6 +2307,7 @@ int main(int argc, char **argv) {
         {"store_at different levels test", store_at_different_levels_test},
         {"rvar bounds test", rvar_bounds_test},
         {"two_compute_at test", two_compute_at_test},
+        {"shared vector loads test", shared_vector_loads_test},
     };
 
     using Sharder = Halide::Internal::Test::Sharder;
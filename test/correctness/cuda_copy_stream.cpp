@@ -0,0 +1,79 @@
+#include "Halide.h"
+#include "jit_runtime_symbol.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA)) {
+        printf("[SKIP] CUDA not enabled.\n");
+        return 0;
+    }
+
+    auto halide_cuda_use_copy_stream =
+        Internal::Test::find_jit_runtime_symbol<int (*)(void *, bool)>(target, "halide_cuda_use_copy_stream");
+    if (halide_cuda_use_copy_stream == nullptr) {
+        printf("Failed to extract halide_cuda_use_copy_stream from Halide cuda runtime\n");
+        return 1;
+    }
+
+    halide_cuda_use_copy_stream(nullptr, true);
+
+    // Each input is first used by a different stage, so its upload is
+    // queued on the copy stream while the kernels of the stages before
+    // it run.
+    const int width = 1024, height = 1024, num_inputs = 4;
+    std::vector<ImageParam> inputs;
+    std::vector<Func> stages;
+    Var x, y, xi, yi;
+    for (int i = 0; i < num_inputs; i++) {
+        inputs.emplace_back(Float(32), 2);
+        Func f;
+        if (i == 0) {
+            f(x, y) = inputs[i](x, y);
+        } else {
+            f(x, y) = stages.back()(x, y) * 0.5f + inputs[i](x, y);
+        }
+        f.compute_root().gpu_tile(x, y, xi, yi, 16, 16);
+        stages.push_back(f);
+    }
+    Func out = stages.back();
+    out.compile_jit(target);
+
+    std::vector<Buffer<float>> bufs;
+    for (int i = 0; i < num_inputs; i++) {
+        bufs.emplace_back(width, height);
+    }
+    Buffer<float> result(width, height);
+    for (int iter = 0; iter < 5; iter++) {
+        // Rewrite the inputs on the host, so that they are uploaded
+        // again into memory the previous iteration's kernels used.
+        for (int i = 0; i < num_inputs; i++) {
+            bufs[i].fill((float)(iter * 10 + i));
+            bufs[i].set_host_dirty();
+            inputs[i].set(bufs[i]);
+        }
+        out.realize(result, target);
+        result.copy_to_host();
+
+        float correct = 0.0f;
+        for (int i = 0; i < num_inputs; i++) {
+            correct = correct * 0.5f + (float)(iter * 10 + i);
+        }
+        for (int yy = 0; yy < height; yy++) {
+            for (int xx = 0; xx < width; xx++) {
+                if (result(xx, yy) != correct) {
+                    printf("iteration %d: result(%d, %d) = %f instead of %f\n",
+                           iter, xx, yy, result(xx, yy), correct);
+                    halide_cuda_use_copy_stream(nullptr, false);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    halide_cuda_use_copy_stream(nullptr, false);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "Halide.h"
+#include "jit_runtime_symbol.h"
+
+using namespace Halide;
+
+// Opaque, from HalideRuntimeCuda.h
+struct halide_cuda_graph_t;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA)) {
+        printf("[SKIP] CUDA not enabled.\n");
+        return 0;
+    }
+
+    auto graph_begin = Internal::Test::find_jit_runtime_symbol<int (*)(void *, halide_cuda_graph_t **)>(target, "halide_cuda_graph_begin");
+    auto graph_end = Internal::Test::find_jit_runtime_symbol<int (*)(void *, halide_cuda_graph_t *)>(target, "halide_cuda_graph_end");
+    auto graph_release = Internal::Test::find_jit_runtime_symbol<int (*)(void *, halide_cuda_graph_t *)>(target, "halide_cuda_graph_release");
+    if (graph_begin == nullptr || graph_end == nullptr || graph_release == nullptr) {
+        printf("Failed to extract the CUDA graph API from Halide cuda runtime\n");
+        return 1;
+    }
+
+    // A chain of small kernels, which is what graphs are for.
+    ImageParam in(Float(32), 2);
+    Func f[4];
+    Var x, y, xi, yi;
+    f[0](x, y) = in(x, y) + 1.0f;
+    for (int i = 1; i < 4; i++) {
+        f[i](x, y) = f[i - 1](x, y) * 2.0f;
+    }
+    for (int i = 0; i < 4; i++) {
+        f[i].compute_root().gpu_tile(x, y, xi, yi, 8, 8);
+    }
+    f[3].compile_jit(target);
+
+    halide_cuda_graph_t *graph = nullptr;
+    JITUserContext ctx;
+    // The first call records, the later ones replay with new inputs,
+    // and the last few change the size, and so the grids of the
+    // kernels.
+    for (int iter = 0; iter < 8; iter++) {
+        const int size = iter < 6 ? 64 : 96;
+        Buffer<float> input(size, size);
+        input.fill((float)iter);
+        in.set(input);
+        Buffer<float> out(size, size);
+
+        if (graph_begin(&ctx, &graph) != 0) {
+            printf("halide_cuda_graph_begin failed\n");
+            return 1;
+        }
+        f[3].realize(&ctx, out, target);
+        if (graph_end(&ctx, graph) != 0) {
+            printf("halide_cuda_graph_end failed\n");
+            return 1;
+        }
+
+        out.copy_to_host(&ctx);
+        float correct = (iter + 1.0f) * 8.0f;
+        for (int yy = 0; yy < size; yy++) {
+            for (int xx = 0; xx < size; xx++) {
+                if (out(xx, yy) != correct) {
+                    printf("iteration %d: out(%d, %d) = %f instead of %f\n",
+                           iter, xx, yy, out(xx, yy), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    if (graph_release(&ctx, graph) != 0) {
+        printf("halide_cuda_graph_release failed\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "Halide.h"
+#include "jit_runtime_symbol.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA)) {
+        printf("[SKIP] CUDA not enabled.\n");
+        return 0;
+    }
+
+    auto halide_cuda_use_managed_memory =
+        Internal::Test::find_jit_runtime_symbol<int (*)(void *, bool)>(target, "halide_cuda_use_managed_memory");
+    if (halide_cuda_use_managed_memory == nullptr) {
+        printf("Failed to extract halide_cuda_use_managed_memory from Halide cuda runtime\n");
+        return 1;
+    }
+
+    halide_cuda_use_managed_memory(nullptr, true);
+
+    const int width = 256, height = 256;
+    ImageParam in(Float(32), 2);
+    Func f;
+    Var x, y, xi, yi;
+    f(x, y) = in(x, y) * 2.0f + 1.0f;
+    f.gpu_tile(x, y, xi, yi, 16, 16);
+    f.compile_jit(target);
+
+    Buffer<float> input(nullptr, width, height), output(nullptr, width, height);
+    const halide_device_interface_t *cuda = get_device_interface_for_device_api(DeviceAPI::CUDA, target);
+    if (input.get()->device_and_host_malloc(cuda) != 0 ||
+        output.get()->device_and_host_malloc(cuda) != 0) {
+        printf("device_and_host_malloc failed\n");
+        return 1;
+    }
+    // Devices without concurrent managed access get separate host and
+    // device allocations, which must work the same way.
+    bool managed = (uint64_t)(uintptr_t)input.data() == input.raw_buffer()->device;
+    printf("Using %s memory\n", managed ? "managed" : "separate host and device");
+
+    for (int iter = 0; iter < 3; iter++) {
+        input.fill((float)iter);
+        input.set_host_dirty();
+        in.set(input);
+        f.realize(output, target);
+        output.copy_to_host();
+        for (int yy = 0; yy < height; yy++) {
+            for (int xx = 0; xx < width; xx++) {
+                float correct = iter * 2.0f + 1.0f;
+                if (output(xx, yy) != correct) {
+                    printf("output(%d, %d) = %f instead of %f\n", xx, yy, output(xx, yy), correct);
+                    halide_cuda_use_managed_memory(nullptr, false);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    input.get()->device_and_host_free(cuda);
+    output.get()->device_and_host_free(cuda);
+    halide_cuda_use_managed_memory(nullptr, false);
+
+    printf("Success!\n");
+    return 0;
+}
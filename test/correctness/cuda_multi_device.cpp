@@ -0,0 +1,83 @@
+#include "Halide.h"
+#include "jit_runtime_symbol.h"
+#include <thread>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA)) {
+        printf("[SKIP] CUDA not enabled.\n");
+        return 0;
+    }
+
+    auto halide_cuda_set_user_context_device =
+        Internal::Test::find_jit_runtime_symbol<int (*)(void *, int)>(target, "halide_cuda_set_user_context_device");
+    auto halide_cuda_get_device_count =
+        Internal::Test::find_jit_runtime_symbol<int (*)(void *, int *)>(target, "halide_cuda_get_device_count");
+    if (halide_cuda_set_user_context_device == nullptr || halide_cuda_get_device_count == nullptr) {
+        printf("Failed to extract halide_cuda_set_user_context_device from Halide cuda runtime\n");
+        return 1;
+    }
+
+    int num_devices = 0;
+    if (halide_cuda_get_device_count(nullptr, &num_devices) != 0 || num_devices < 1) {
+        printf("halide_cuda_get_device_count failed\n");
+        return 1;
+    }
+
+    const int width = 256, height = 256, batch = 8;
+
+    Func f;
+    Var x, y, b, xi, yi;
+    f(x, y, b) = cast<float>(x + y * width) + b * 1000.0f;
+    f.gpu_tile(x, y, xi, yi, 16, 16);
+    f.compile_jit(target);
+
+    // Split one realization along the batch dimension, and run each
+    // slice of it on its own thread with a user_context bound to a
+    // different device (wrapping around if there are fewer devices).
+    Buffer<float> out(width, height, batch);
+    std::atomic<int> failures = 0;
+    auto worker = [&](int t) {
+        JITUserContext ctx;
+        if (halide_cuda_set_user_context_device(&ctx, t % num_devices) != 0) {
+            failures++;
+            return;
+        }
+        Runtime::Buffer<float> slice = out.get()->cropped(2, t, 1);
+        f.realize(&ctx, slice, target);
+        slice.copy_to_host(&ctx);
+        slice.device_free(&ctx);
+        halide_cuda_set_user_context_device(&ctx, -1);
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < batch; t++) {
+        threads.emplace_back(worker, t);
+    }
+    for (auto &th : threads) {
+        th.join();
+    }
+
+    if (failures) {
+        printf("halide_cuda_set_user_context_device failed\n");
+        return 1;
+    }
+
+    for (int bb = 0; bb < batch; bb++) {
+        for (int yy = 0; yy < height; yy++) {
+            for (int xx = 0; xx < width; xx++) {
+                float correct = (float)(xx + yy * width) + bb * 1000.0f;
+                if (out(xx, yy, bb) != correct) {
+                    printf("out(%d, %d, %d) = %f instead of %f\n",
+                           xx, yy, bb, out(xx, yy, bb), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
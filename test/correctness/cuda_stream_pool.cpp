@@ -0,0 +1,88 @@
+#include "Halide.h"
+#include "jit_runtime_symbol.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA)) {
+        printf("[SKIP] CUDA not enabled.\n");
+        return 0;
+    }
+
+    auto halide_cuda_use_stream_pool =
+        Internal::Test::find_jit_runtime_symbol<int (*)(void *, bool)>(target, "halide_cuda_use_stream_pool");
+    if (halide_cuda_use_stream_pool == nullptr) {
+        printf("Failed to extract halide_cuda_use_stream_pool from Halide cuda runtime\n");
+        return 1;
+    }
+
+    // Nothing has been left on the GPU by the lookup above, so it's
+    // safe to switch streams now.
+    halide_cuda_use_stream_pool(nullptr, true);
+
+    const int width = 256, height = 256;
+
+    ImageParam in(Float(32), 2);
+    Func f, g;
+    Var x, y, xi, yi;
+    f(x, y) = in(x, y) * 2.0f + 1.0f;
+    g(x, y) = f(x, y) + f(x + 1, y);
+    f.compute_root().gpu_tile(x, y, xi, yi, 16, 16);
+    g.gpu_tile(x, y, xi, yi, 16, 16);
+    in.dim(0).set_extent(width + 1);
+    Callable c = g.compile_to_callable({in}, target);
+
+    // Run the pipeline from several threads at once, each with its own
+    // user_context, and so its own stream. Every thread both uploads
+    // its input and reads back its output asynchronously on that
+    // stream, so if the copies and kernels were not ordered on it we'd
+    // see stale data.
+    const int num_threads = 4;
+    std::atomic<int> failures = 0;
+    auto worker = [&](int t) {
+        JITUserContext ctx;
+        for (int iter = 0; iter < 10; iter++) {
+            Buffer<float> input(width + 1, height);
+            input.fill((float)(t * 100 + iter));
+            Buffer<float> out(width, height);
+            if (c(&ctx, input, out) != 0) {
+                printf("thread %d: the pipeline failed\n", t);
+                failures++;
+                return;
+            }
+            out.copy_to_host(&ctx);
+            float correct = 2.0f * ((t * 100 + iter) * 2.0f + 1.0f);
+            for (int yy = 0; yy < height; yy++) {
+                for (int xx = 0; xx < width; xx++) {
+                    if (out(xx, yy) != correct) {
+                        printf("thread %d: out(%d, %d) = %f instead of %f\n",
+                               t, xx, yy, out(xx, yy), correct);
+                        failures++;
+                        return;
+                    }
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back(worker, t);
+    }
+    for (auto &th : threads) {
+        th.join();
+    }
+
+    halide_cuda_use_stream_pool(nullptr, false);
+
+    if (failures) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the vector loads and stores at data-dependent addresses left
+// for codegen, which it emits as gathers and scatters.
+class CountGathers : public IRMutator {
+    using IRMutator::visit;
+
+    static bool is_data_dependent(const Expr &index) {
+        return index.type().is_vector() && !index.as<Ramp>() && !index.as<Broadcast>();
+    }
+
+    Expr visit(const Load *op) override {
+        if (is_data_dependent(op->index)) {
+            gathers++;
+        }
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Store *op) override {
+        if (is_data_dependent(op->index)) {
+            scatters++;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    int gathers = 0, scatters = 0;
+};
+
+int run(GatherMode mode, const Target &t, int *gathers, int *scatters) {
+    const int size = 64;
+    Var x;
+
+    Func lut("lut");
+    lut(x) = cast<float>(x * x) / 3.0f;
+    lut.compute_root();
+
+    Buffer<int> indices(size);
+    for (int i = 0; i < size; i++) {
+        indices(i) = (i * 7) % size;
+    }
+
+    // A lookup into a table at data-dependent addresses.
+    Func lookup("lookup");
+    lookup(x) = lut(clamp(indices(x), 0, size - 1));
+    lookup.vectorize(x, 16).gather_mode(mode);
+
+    // A permutation, which stores at data-dependent addresses.
+    Func permuted("permuted");
+    RDom r(0, size);
+    permuted(x) = 0.0f;
+    permuted(indices(r)) = lookup(r);
+    permuted.update().allow_race_conditions().vectorize(r, 16);
+    permuted.gather_mode(mode);
+    permuted.bound(x, 0, size);
+    lookup.compute_root();
+
+    CountGathers *counter = new CountGathers;
+    permuted.add_custom_lowering_pass(counter);
+    Buffer<float> result = permuted.realize({size}, t);
+    *gathers = counter->gathers;
+    *scatters = counter->scatters;
+
+    for (int i = 0; i < size; i++) {
+        int idx = (i * 7) % size;
+        float correct = (float)(i * i) / 3.0f;
+        if (result(idx) != correct) {
+            printf("result(%d) = %f instead of %f\n", idx, result(idx), correct);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+
+    int gathers = 0, scatters = 0;
+    if (run(GatherMode::Never, t, &gathers, &scatters)) {
+        return 1;
+    }
+    if (gathers != 0 || scatters != 0) {
+        printf("GatherMode::Never left %d gathers and %d scatters\n", gathers, scatters);
+        return 1;
+    }
+
+    if (run(GatherMode::Always, t, &gathers, &scatters)) {
+        return 1;
+    }
+    bool expect_gathers = target_has_gather(t, Float(32));
+    bool expect_scatters = target_has_scatter(t, Float(32));
+    if ((gathers > 0) != expect_gathers || (scatters > 0) != expect_scatters) {
+        printf("GatherMode::Always left %d gathers and %d scatters on %s\n",
+               gathers, scatters, t.to_string().c_str());
+        return 1;
+    }
+
+    if (run(GatherMode::Auto, t, &gathers, &scatters)) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
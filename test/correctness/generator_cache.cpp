@@ -0,0 +1,150 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+namespace {
+
+int generate_calls = 0;
+
+class CachedGen : public Generator<CachedGen> {
+public:
+    GeneratorParam<int> scale{"scale", 3};
+
+    Input<Buffer<int, 2>> input{"input"};
+    Output<Buffer<int, 2>> output{"output"};
+
+    void generate() {
+        generate_calls++;
+        Var x("x"), y("y");
+        output(x, y) = input(x, y) * scale;
+    }
+};
+
+int count_cache_entries(const std::string &dir) {
+    int count = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.path().extension() == ".generated") {
+            count++;
+        }
+    }
+    return count;
+}
+
+std::string read_file(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Run the Generator, and check whether it was built or came from the
+// cache, and how many entries the cache then holds.
+int run_generator(const std::string &out_dir, const std::string &cache_dir, int scale, bool use_cache,
+                  bool expect_hit, int expected_entries) {
+    ExecuteGeneratorArgs args;
+    args.output_dir = out_dir;
+    args.output_types = {OutputFileType::object, OutputFileType::c_header};
+    args.targets = {get_host_target().with_feature(Target::NoRuntime)};
+    args.generator_name = "cached_gen";
+    args.create_generator = [](const std::string &, const GeneratorContext &context) -> AbstractGeneratorPtr {
+        return CachedGen::create(context);
+    };
+    args.generator_params = {{"scale", std::to_string(scale)}};
+    args.use_generator_cache = use_cache;
+
+    std::filesystem::remove_all(out_dir);
+    std::filesystem::create_directories(out_dir);
+    int calls = generate_calls;
+    execute_generator(args);
+
+    bool hit = generate_calls == calls;
+    if (hit != expect_hit) {
+        printf("Generator with scale %d was %s\n", scale, hit ? "unexpectedly loaded from the cache" : "unexpectedly built");
+        return 1;
+    }
+    int entries = count_cache_entries(cache_dir);
+    if (entries != expected_entries) {
+        printf("Expected %d entries in %s, got %d\n", expected_entries, cache_dir.c_str(), entries);
+        return 1;
+    }
+    for (const char *ext : {".o", ".h"}) {
+        std::string path = out_dir + "/cached_gen" + ext;
+        if (!std::filesystem::exists(path) || std::filesystem::file_size(path) == 0) {
+            printf("Missing output %s\n", path.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("[SKIP] Windows does not have a working setenv\n");
+    return 0;
+#else
+    const std::string dir = get_test_tmp_dir() + "generator_cache";
+    const std::string cache_dir = dir + "/cache", out_dir = dir + "/out";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(cache_dir);
+    setenv("HL_GENERATOR_CACHE_DIR", cache_dir.c_str(), 1);
+    unsetenv("HL_LLVM_CODEGEN_THREADS");
+
+    // The first run is stored...
+    if (run_generator(out_dir, cache_dir, 3, true, false, 1)) {
+        return 1;
+    }
+    const std::string header = read_file(out_dir + "/cached_gen.h");
+    const std::string object = read_file(out_dir + "/cached_gen.o");
+
+    // ...and the second is loaded from the cache, with the same outputs.
+    if (run_generator(out_dir, cache_dir, 3, true, true, 1)) {
+        return 1;
+    }
+    if (read_file(out_dir + "/cached_gen.h") != header ||
+        read_file(out_dir + "/cached_gen.o") != object) {
+        printf("The outputs loaded from the cache differ from the ones built\n");
+        return 1;
+    }
+
+    // Changing a GeneratorParam or the LLVM options invalidates the
+    // entry.
+    if (run_generator(out_dir, cache_dir, 5, true, false, 2)) {
+        return 1;
+    }
+    setenv("HL_LLVM_CODEGEN_THREADS", "2", 1);
+    if (run_generator(out_dir, cache_dir, 3, true, false, 3) ||
+        run_generator(out_dir, cache_dir, 3, true, true, 3)) {
+        return 1;
+    }
+    unsetenv("HL_LLVM_CODEGEN_THREADS");
+
+    // A damaged entry is ignored and replaced.
+    for (const auto &entry : std::filesystem::directory_iterator(cache_dir)) {
+        std::filesystem::resize_file(entry.path(), 16);
+    }
+    if (run_generator(out_dir, cache_dir, 3, true, false, 3) ||
+        run_generator(out_dir, cache_dir, 3, true, true, 3)) {
+        return 1;
+    }
+
+    // Generators that don't opt in never touch the cache.
+    std::filesystem::remove_all(cache_dir);
+    std::filesystem::create_directories(cache_dir);
+    if (run_generator(out_dir, cache_dir, 3, false, false, 0) ||
+        run_generator(out_dir, cache_dir, 3, false, false, 0)) {
+        return 1;
+    }
+
+    unsetenv("HL_GENERATOR_CACHE_DIR");
+    std::filesystem::remove_all(dir);
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
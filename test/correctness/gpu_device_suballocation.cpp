@@ -0,0 +1,72 @@
+#include "Halide.h"
+#include "jit_runtime_symbol.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    const char *stats_fn = nullptr;
+    if (target.has_feature(Target::CUDA)) {
+        stats_fn = "halide_cuda_get_device_memory_stats";
+    } else if (target.has_feature(Target::OpenCL)) {
+        stats_fn = "halide_opencl_get_device_memory_stats";
+    } else {
+        printf("[SKIP] Neither CUDA nor OpenCL is enabled.\n");
+        return 0;
+    }
+
+    auto halide_use_device_suballocation =
+        Internal::Test::find_jit_runtime_symbol<int (*)(void *, bool)>(target, "halide_use_device_suballocation");
+    auto get_stats =
+        Internal::Test::find_jit_runtime_symbol<int (*)(void *, halide_device_memory_stats_t *)>(target, stats_fn);
+    if (halide_use_device_suballocation == nullptr || get_stats == nullptr) {
+        printf("Failed to extract the device suballocation API from the Halide runtime\n");
+        return 1;
+    }
+    halide_use_device_suballocation(nullptr, true);
+
+    ImageParam in(Int(32), 1);
+    Func f, g;
+    Var x, xi;
+    f(x) = in(x) * 2 + 1;
+    g(x) = f(x) + f(x + 1);
+    f.compute_root().gpu_tile(x, xi, 64);
+    g.gpu_tile(x, xi, 64);
+    g.compile_jit(target);
+
+    // Run with a different size every time. Without suballocation each
+    // of these would need device allocations of their own.
+    const int iterations = 50;
+    for (int i = 0; i < iterations; i++) {
+        const int size = 1000 + i * 37;
+        Buffer<int> input(size + 1);
+        input.for_each_element([&](int xx) { input(xx) = xx + i; });
+        in.set(input);
+        Buffer<int> out = g.realize({size}, target);
+        out.copy_to_host();
+        for (int xx = 0; xx < size; xx++) {
+            int correct = (xx + i) * 2 + 1 + (xx + 1 + i) * 2 + 1;
+            if (out(xx) != correct) {
+                printf("out(%d) = %d instead of %d on iteration %d\n", xx, out(xx), correct, i);
+                return 1;
+            }
+        }
+    }
+
+    halide_device_memory_stats_t stats;
+    if (get_stats(nullptr, &stats) != 0) {
+        printf("Failed to get device memory stats\n");
+        return 1;
+    }
+    printf("%d block allocations, %d peak bytes\n",
+           (int)stats.block_allocations, (int)stats.peak_bytes_allocated);
+    if (stats.block_allocations == 0 || stats.block_allocations >= iterations) {
+        printf("Expected a handful of block allocations, got %d\n", (int)stats.block_allocations);
+        return 1;
+    }
+
+    halide_use_device_suballocation(nullptr, false);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdlib>
+#include <filesystem>
+
+using namespace Halide;
+
+namespace {
+
+int count_cache_entries(const std::string &dir) {
+    int count = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.path().extension() == ".bin") {
+            count++;
+        }
+    }
+    return count;
+}
+
+int run_pipeline(const Target &target) {
+    // Use the same names every time, so that the generated kernels are
+    // identical and the second run can be served from the cache.
+    Func f("kernel_cache_f");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    f(x, y) = x * 3 + y * 7;
+    f.gpu_tile(x, y, xi, yi, 8, 8);
+
+    Buffer<int> out = f.realize({64, 64}, target);
+    out.copy_to_host();
+    for (int yy = 0; yy < out.height(); yy++) {
+        for (int xx = 0; xx < out.width(); xx++) {
+            if (out(xx, yy) != xx * 3 + yy * 7) {
+                printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), xx * 3 + yy * 7);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("[SKIP] Windows does not have a working setenv\n");
+    return 0;
+#else
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA) &&
+        !target.has_feature(Target::OpenCL) &&
+        !target.has_feature(Target::Vulkan)) {
+        printf("[SKIP] No GPU backend with a persistent kernel cache enabled.\n");
+        return 0;
+    }
+
+    std::string dir = Internal::get_test_tmp_dir() + "gpu_kernel_cache";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    setenv("HL_GPU_KERNEL_CACHE_DIR", dir.c_str(), 1);
+
+    if (run_pipeline(target)) {
+        return 1;
+    }
+    int entries = count_cache_entries(dir);
+    if (entries == 0) {
+        printf("Expected the kernel to be stored in %s\n", dir.c_str());
+        return 1;
+    }
+
+    // Compiling the same kernel again should be served from the cache,
+    // and so not add any entries.
+    if (run_pipeline(target)) {
+        return 1;
+    }
+    if (count_cache_entries(dir) != entries) {
+        printf("Expected %d cache entries, got %d\n", entries, count_cache_entries(dir));
+        return 1;
+    }
+
+    unsetenv("HL_GPU_KERNEL_CACHE_DIR");
+    std::filesystem::remove_all(dir);
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,79 @@
+#include "Halide.h"
+#include "HalideRuntime.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+
+    Param<int> p;
+    Func f("f"), g("g");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+
+    // f is only ever touched on the device, so the cache keeps its
+    // device allocation, and a hit can use it without any copies.
+    f(x, y) = x + y * p;
+    g(x, y) = f(x, y) * 2;
+
+    f.compute_root().memoize().gpu_tile(x, y, xi, yi, 8, 8);
+    g.gpu_tile(x, y, xi, yi, 8, 8);
+
+    halide_memoization_cache_stats_t before, after;
+    Internal::JITSharedRuntime::memoization_cache_get_stats(&before);
+
+    for (int i = 0; i < 3; i++) {
+        for (int v = 1; v <= 2; v++) {
+            p.set(v);
+            Buffer<int> out = g.realize({32, 32});
+            for (int yy = 0; yy < 32; yy++) {
+                for (int xx = 0; xx < 32; xx++) {
+                    int correct = (xx + yy * v) * 2;
+                    if (out(xx, yy) != correct) {
+                        printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), correct);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+
+    Internal::JITSharedRuntime::memoization_cache_get_stats(&after);
+    if (after.misses - before.misses != 2 || after.hits - before.hits != 4) {
+        printf("Expected 2 misses and 4 hits, got %lld misses and %lld hits\n",
+               (long long)(after.misses - before.misses), (long long)(after.hits - before.hits));
+        return 1;
+    }
+    if (after.device_bytes_stored < 2 * 32 * 32 * (int64_t)sizeof(int)) {
+        printf("Expected the device allocations to be kept in the cache, but only %lld bytes were\n",
+               (long long)after.device_bytes_stored);
+        return 1;
+    }
+
+    // With no room for device memory, the device allocations are
+    // released, but the results are still cached on the host.
+    Internal::JITSharedRuntime::memoization_cache_set_device_size(1);
+    p.set(3);
+    Buffer<int> out = g.realize({32, 32});
+    if (out(5, 7) != (5 + 7 * 3) * 2) {
+        printf("out(5, 7) = %d instead of %d\n", out(5, 7), (5 + 7 * 3) * 2);
+        return 1;
+    }
+    p.set(1);
+    out = g.realize({32, 32});
+    if (out(5, 7) != (5 + 7) * 2) {
+        printf("out(5, 7) = %d instead of %d\n", out(5, 7), (5 + 7) * 2);
+        return 1;
+    }
+
+    // Return cache sizes to default.
+    Internal::JITSharedRuntime::memoization_cache_set_device_size(0);
+    Internal::JITSharedRuntime::memoization_cache_set_size(0);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,39 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x, y, xo, xi;
+    Func f, g;
+
+    f(x, y) = x * 3 + y;
+    g(x, y) = f(x, y) + f(x + 1, y);
+
+    // The block size is picked when the pipeline runs. On CUDA it comes
+    // from the occupancy calculator. Everywhere else it is the maximum.
+    Expr block = gpu_occupancy_block_size(128);
+
+    Target target = get_jit_target_from_environment();
+    if (target.has_gpu_feature()) {
+        f.compute_root().gpu_tile(x, xo, xi, block, TailStrategy::GuardWithIf);
+        g.gpu_tile(x, xo, xi, block, TailStrategy::GuardWithIf);
+    } else {
+        f.compute_root().split(x, xo, xi, block, TailStrategy::GuardWithIf);
+        g.split(x, xo, xi, block, TailStrategy::GuardWithIf);
+    }
+
+    Buffer<int> out = g.realize({1000, 10});
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = x * 6 + 3 + 2 * y;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+
+    // Buffers whose size in bytes isn't a multiple of 4. Some APIs
+    // (eg WebGPU) can only copy whole words, so the last chunk of each
+    // upload has to be padded without reading past the end of the host
+    // allocation.
+    for (int size : {1, 3, 5, 1001, 65537}) {
+        ImageParam in(UInt(8), 1);
+        Func f;
+        Var x, xi;
+        f(x) = in(x) + cast<uint8_t>(1);
+        f.gpu_tile(x, xi, 16, TailStrategy::GuardWithIf);
+
+        // Allocate exactly size bytes, so that a sanitizer can catch
+        // any read past the end.
+        Buffer<uint8_t> input(size);
+        input.for_each_element([&](int xx) { input(xx) = (uint8_t)(xx * 7); });
+        in.set(input);
+
+        Buffer<uint8_t> out = f.realize({size}, target);
+        out.copy_to_host();
+        for (int xx = 0; xx < size; xx++) {
+            uint8_t correct = (uint8_t)(xx * 7 + 1);
+            if (out(xx) != correct) {
+                printf("size %d: out(%d) = %d instead of %d\n", size, xx, out(xx), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+
+    if (!target.has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+
+    const int size = 1024, roi = 64, offset = 100;
+    Var x, y, xi, yi;
+
+    // A GPU pipeline that reads a small region of a large input should
+    // only upload that region. The rest of the device allocation is
+    // stale, so the input stays host dirty.
+    {
+        Buffer<float> input(size, size);
+        input.for_each_element([&](int xx, int yy) { input(xx, yy) = xx + yy * size; });
+        input.set_host_dirty();
+
+        Func f;
+        f(x, y) = input(x + offset, y + offset) * 2.0f;
+        f.gpu_tile(x, y, xi, yi, 16, 16);
+
+        for (int iter = 0; iter < 2; iter++) {
+            Buffer<float> out = f.realize({roi, roi});
+            out.copy_to_host();
+            for (int yy = 0; yy < roi; yy++) {
+                for (int xx = 0; xx < roi; xx++) {
+                    float correct = 2.0f * ((xx + offset) + (yy + offset) * size + iter);
+                    if (out(xx, yy) != correct) {
+                        printf("out(%d, %d) = %f instead of %f\n", xx, yy, out(xx, yy), correct);
+                        return 1;
+                    }
+                }
+            }
+            if (!input.has_device_allocation() || !input.host_dirty()) {
+                printf("Expected only a region of the input to be uploaded\n");
+                return 1;
+            }
+            // Changes to the host data must still be seen next time.
+            input.for_each_value([](float &v) { v += 1.0f; });
+            input.set_host_dirty();
+        }
+
+        // A full copy to the device still moves everything.
+        input.copy_to_device(get_device_interface_for_device_api(DeviceAPI::Default_GPU, target));
+        if (input.host_dirty()) {
+            printf("Explicit copy_to_device left the input host dirty\n");
+            return 1;
+        }
+    }
+
+    // A CPU pipeline that reads a small region of an input that lives
+    // on the GPU should only copy that region back.
+    {
+        Func g;
+        g(x, y) = cast<float>(x + y * size);
+        g.gpu_tile(x, y, xi, yi, 16, 16);
+        Buffer<float> input = g.realize({size, size});
+        if (!input.device_dirty()) {
+            printf("Expected the GPU output to be device dirty\n");
+            return 1;
+        }
+
+        Func h;
+        h(x, y) = input(x + offset, y + offset) + 1.0f;
+        Buffer<float> out = h.realize({roi, roi});
+        for (int yy = 0; yy < roi; yy++) {
+            for (int xx = 0; xx < roi; xx++) {
+                float correct = (xx + offset) + (yy + offset) * size + 1.0f;
+                if (out(xx, yy) != correct) {
+                    printf("out(%d, %d) = %f instead of %f\n", xx, yy, out(xx, yy), correct);
+                    return 1;
+                }
+            }
+        }
+        if (!input.device_dirty()) {
+            printf("Expected only a region of the input to be copied back\n");
+            return 1;
+        }
+        input.copy_to_host();
+        if (input(size - 1, size - 1) != (size - 1) + (size - 1) * size) {
+            printf("Full copy_to_host after a region copy failed\n");
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
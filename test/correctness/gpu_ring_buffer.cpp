@@ -0,0 +1,122 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the barriers in the loop over tiles of the reduction.
+class CountBarriersInLoop : public IRVisitor {
+    using IRVisitor::visit;
+
+    const std::string &loop;
+    bool in_loop = false;
+
+    void visit(const For *op) override {
+        ScopedValue<bool> old_in_loop(in_loop, in_loop || ends_with(op->name, loop));
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        if (in_loop && op->is_intrinsic(Call::gpu_thread_barrier)) {
+            count++;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    CountBarriersInLoop(const std::string &l)
+        : loop(l) {
+    }
+    int count = 0;
+};
+
+class CheckBarriersInLoop : public IRMutator {
+    std::string loop;
+    int correct;
+
+public:
+    CheckBarriersInLoop(const std::string &l, int c)
+        : loop(l), correct(c) {
+    }
+    using IRMutator::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        CountBarriersInLoop c(loop);
+        s.accept(&c);
+        if (c.count != correct) {
+            printf("There were %d barriers in the loop over %s. There were supposed to be %d\n",
+                   c.count, loop.c_str(), correct);
+            exit(1);
+        }
+        return s;
+    }
+};
+
+// A tiled matrix multiply, with the tiles of both inputs staged in
+// shared memory.
+int check_matmul(int size, bool ring_buffer) {
+    Buffer<float> a(size, size), b(size, size);
+    a.for_each_element([&](int x, int y) { a(x, y) = (float)((x + 2 * y) % 7); });
+    b.for_each_element([&](int x, int y) { b(x, y) = (float)((3 * x - y) % 5); });
+
+    Func A("A"), B("B"), prod("prod"), out("out");
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi");
+    RVar ko("ko"), ki("ki");
+    RDom k(0, size);
+
+    A(x, y) = a(x, y);
+    B(x, y) = b(x, y);
+    prod(x, y) = 0.0f;
+    prod(x, y) += A(k, y) * B(x, k);
+    out(x, y) = prod(x, y);
+
+    const int tile = 16;
+    out.gpu_tile(x, y, xo, yo, xi, yi, tile, tile);
+    prod.compute_at(out, xo).gpu_threads(x, y);
+    prod.update().split(k, ko, ki, tile).reorder(ki, x, y, ko).gpu_threads(x, y);
+    for (Func f : {A, B}) {
+        f.compute_at(prod, ko).store_in(MemoryType::GPUShared).gpu_threads(x, y);
+        if (ring_buffer) {
+            f.hoist_storage(out, xo).ring_buffer(2);
+        }
+    }
+
+    // Without ring buffers, there is a barrier after the tiles of each
+    // of A and B are loaded, and one after they are consumed. With
+    // them, the tiles for the next iteration are loaded while the
+    // current ones are consumed, so there is just the one.
+    out.add_custom_lowering_pass(new CheckBarriersInLoop(".ko", ring_buffer ? 1 : 3));
+
+    Buffer<float> result = out.realize({size, size});
+    for (int yy = 0; yy < size; yy++) {
+        for (int xx = 0; xx < size; xx++) {
+            float correct = 0;
+            for (int kk = 0; kk < size; kk++) {
+                correct += a(kk, yy) * b(xx, kk);
+            }
+            if (result(xx, yy) != correct) {
+                printf("%s: out(%d, %d) = %f instead of %f\n",
+                       ring_buffer ? "ring buffer" : "no ring buffer",
+                       xx, yy, result(xx, yy), correct);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (!get_jit_target_from_environment().has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+
+    if (check_matmul(64, false) ||
+        check_matmul(64, true) ||
+        check_matmul(48, true)) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the tensor core operations in a pipeline.
+class CountTensorCoreOps : public IRMutator {
+    using IRMutator::visit;
+
+    Expr visit(const Call *op) override {
+        if (op->name == "wmma_mma") {
+            count++;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    int count = 0;
+};
+
+template<typename InT, typename AccT>
+int test(int size) {
+    Target t = get_jit_target_from_environment();
+
+    Buffer<InT> A_buf(size, size), B_buf(size, size);
+    A_buf.for_each_element([&](int x, int y) { A_buf(x, y) = (InT)((x * 3 + y * 5) % 7 - 3); });
+    B_buf.for_each_element([&](int x, int y) { B_buf(x, y) = (InT)((x * 7 + y * 2) % 5 - 2); });
+
+    // The WMMA loads and stores must be aligned, so the strides of
+    // the inputs and output must be known.
+    ImageParam A(type_of<InT>(), 2, "A"), B(type_of<InT>(), 2, "B");
+    for (ImageParam p : {A, B}) {
+        p.dim(0).set_min(0);
+        p.dim(1).set_min(0).set_stride(size);
+    }
+
+    Var x("x"), y("y");
+    RDom r(0, size);
+
+    Func mm("mm"), out("out");
+    mm(x, y) = cast<AccT>(0);
+    mm(x, y) += cast<AccT>(A(r, y)) * cast<AccT>(B(x, r));
+    out(x, y) = mm(x, y);
+
+    Var xi("xi"), yi("yi"), mxi("mxi"), myi("myi");
+    RVar rxi("rxi"), ryi("ryi"), rro("rro"), rri("rri");
+    out.tile(x, y, xi, yi, 16, 16)
+        .vectorize(xi)
+        .vectorize(yi)
+        .gpu_blocks(x, y);
+    out.output_buffer().dim(0).set_min(0);
+    out.output_buffer().dim(1).set_min(0).set_stride(size);
+
+    mm.compute_at(out, x)
+        .store_in(MemoryType::WMMAAccumulator)
+        .tile(x, y, mxi, myi, 16, 16)
+        .vectorize(mxi)
+        .vectorize(myi);
+    mm.update()
+        .tile(x, y, rxi, ryi, 16, 16)
+        .split(r, rro, rri, 16)
+        .reorder(rri, rxi, ryi, rro, x, y)
+        .atomic()
+        .vectorize(rri)
+        .vectorize(rxi)
+        .vectorize(ryi);
+
+    CountTensorCoreOps counter;
+    out.add_custom_lowering_pass(&counter, nullptr);
+    out.compile_jit(t);
+    if (counter.count == 0) {
+        std::cout << "Tensor cores were not used for " << type_of<InT>() << "\n";
+        return 1;
+    }
+
+    A.set(A_buf);
+    B.set(B_buf);
+    Buffer<AccT> result = out.realize({size, size});
+    for (int j = 0; j < size; j++) {
+        for (int i = 0; i < size; i++) {
+            AccT correct = 0;
+            for (int k = 0; k < size; k++) {
+                correct += (AccT)A_buf(k, j) * (AccT)B_buf(i, k);
+            }
+            // The products and sums of these small integers are
+            // exact, even in float16.
+            if (result(i, j) != correct) {
+                printf("result(%d, %d) = %f instead of %f\n",
+                       i, j, (double)result(i, j), (double)correct);
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_feature(Target::CUDA) || t.get_cuda_capability_lower_bound() < 70) {
+        printf("[SKIP] CUDA with tensor cores (cuda_capability_70 or later) not enabled.\n");
+        return 0;
+    }
+
+    if (test<float16_t, float>(64)) {
+        return 1;
+    }
+    if (t.get_cuda_capability_lower_bound() >= 75 &&
+        (test<int8_t, int32_t>(64) || test<uint8_t, int32_t>(64))) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+std::string load_file(const std::string &filename) {
+    std::ifstream file(filename);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+template<typename T>
+bool check_histogram(const Buffer<T> &out, const Buffer<T> &correct, const char *name) {
+    for (int i = 0; i < correct.width(); i++) {
+        if (out(i) != correct(i)) {
+            printf("%s(%d) = %f instead of %f\n", name, i, (double)out(i), (double)correct(i));
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA) || target.get_cuda_capability_lower_bound() < 80) {
+        printf("[SKIP] CUDA with cuda_capability_80 or later not enabled.\n");
+        return 0;
+    }
+
+    const int size = 8192, bins = 16;
+    Buffer<int> input(size);
+    for (int i = 0; i < size; i++) {
+        // Few enough distinct bins that most lanes of a warp collide.
+        input(i) = (i * i + i / 7) % bins;
+    }
+
+    ImageParam in(Int(32), 1, "in");
+    Var x("x");
+    RDom r(0, size);
+    RVar ro("ro"), ri("ri");
+    Expr bin = clamp(in(r), 0, bins - 1);
+
+    // Counting updates add a constant, so each group of lanes that hit
+    // the same bin adds the size of the group.
+    Func count("count");
+    count(x) = 0;
+    count(bin) += 1;
+
+    Func count_f("count_f");
+    count_f(x) = 0.0f;
+    count_f(bin) += 1.0f;
+
+    // Weighted updates add a value that differs from lane to lane,
+    // which is summed across the group with redux.sync.
+    Func weighted("weighted");
+    weighted(x) = 0;
+    weighted(bin) += in(r) * 3 - r;
+
+    Pipeline p({count, count_f, weighted});
+    for (Func f : {count, count_f, weighted}) {
+        f.compute_root();
+        f.update().atomic().split(r, ro, ri, 128).gpu_blocks(ro).gpu_threads(ri);
+    }
+
+    // The updates were aggregated across the warp, by counting the
+    // lanes in each group and by summing their deltas.
+    {
+        std::string ll_file = Internal::get_test_tmp_dir() + "gpu_warp_aggregated_atomics.ll";
+        Internal::ensure_no_file_exists(ll_file);
+        p.compile_to_llvm_assembly(ll_file, {in}, "gpu_warp_aggregated_atomics", target.with_feature(Target::NoRuntime));
+        Internal::assert_file_exists(ll_file);
+        std::string ptx = load_file(ll_file);
+        for (const char *instruction : {"match.any.sync", "popc.b32", "redux.sync.add"}) {
+            if (ptx.find(instruction) == std::string::npos) {
+                printf("Found no %s in the kernels in %s\n", instruction, ll_file.c_str());
+                return 1;
+            }
+        }
+    }
+
+    Buffer<int> correct_count(bins), correct_weighted(bins);
+    Buffer<float> correct_count_f(bins);
+    correct_count.fill(0);
+    correct_count_f.fill(0.0f);
+    correct_weighted.fill(0);
+    for (int i = 0; i < size; i++) {
+        correct_count(input(i))++;
+        correct_count_f(input(i)) += 1.0f;
+        correct_weighted(input(i)) += input(i) * 3 - i;
+    }
+
+    in.set(input);
+    for (int iter = 0; iter < 10; iter++) {
+        Buffer<int> out_count(bins), out_weighted(bins);
+        Buffer<float> out_count_f(bins);
+        p.realize({out_count, out_count_f, out_weighted}, target);
+        out_count.copy_to_host();
+        out_count_f.copy_to_host();
+        out_weighted.copy_to_host();
+        if (!check_histogram(out_count, correct_count, "count") ||
+            !check_histogram(out_count_f, correct_count_f, "count_f") ||
+            !check_histogram(out_weighted, correct_weighted, "weighted")) {
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
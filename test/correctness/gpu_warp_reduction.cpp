@@ -0,0 +1,97 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the cross-lane reduction intrinsics in a pipeline.
+class CountWarpReductions : public IRMutator {
+    using IRMutator::visit;
+
+    Expr visit(const Call *op) override {
+        if (starts_with(op->name, "llvm.nvvm.shfl") ||
+            starts_with(op->name, "llvm.nvvm.redux")) {
+            count++;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    int count = 0;
+};
+
+template<typename T>
+int test(int width) {
+    Target t = get_jit_target_from_environment();
+
+    const int height = 16;
+    Buffer<T> input(width, height);
+    input.for_each_element([&](int x, int y) { input(x, y) = (T)((x * 17 + y * 3) % 23); });
+
+    Var y("y");
+    RDom r(0, width);
+    Func row_sum("row_sum"), row_max("row_max");
+    row_sum(y) = cast<T>(0);
+    row_sum(y) += input(r, y);
+    row_max(y) = cast<T>(0);
+    row_max(y) = max(row_max(y), input(r, y));
+
+    for (Func f : {row_sum, row_max}) {
+        RVar ro, ri;
+        f.gpu_blocks(y);
+        f.update()
+            .atomic()
+            .split(r, ro, ri, 32)
+            .gpu_lanes(ri)
+            .gpu_blocks(y);
+
+        CountWarpReductions counter;
+        f.add_custom_lowering_pass(&counter, nullptr);
+        f.compile_jit(t);
+        f.clear_custom_lowering_passes();
+        if (counter.count == 0) {
+            printf("%s was not reduced across the warp\n", f.name().c_str());
+            return 1;
+        }
+    }
+
+    Buffer<T> sums = row_sum.realize({height});
+    Buffer<T> maxes = row_max.realize({height});
+    for (int j = 0; j < height; j++) {
+        T correct_sum = 0, correct_max = 0;
+        for (int i = 0; i < width; i++) {
+            correct_sum += input(i, j);
+            correct_max = std::max(correct_max, input(i, j));
+        }
+        if (sums(j) != correct_sum) {
+            printf("row_sum(%d) = %f instead of %f\n", j, (double)sums(j), (double)correct_sum);
+            return 1;
+        }
+        if (maxes(j) != correct_max) {
+            printf("row_max(%d) = %f instead of %f\n", j, (double)maxes(j), (double)correct_max);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_feature(Target::CUDA)) {
+        printf("[SKIP] CUDA not enabled.\n");
+        return 0;
+    }
+
+    // Widths that are and are not a multiple of the warp size, to
+    // exercise the lanes masked off by GuardWithIf.
+    for (int width : {256, 1000}) {
+        if (test<int>(width) ||
+            test<uint32_t>(width) ||
+            test<float>(width)) {
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
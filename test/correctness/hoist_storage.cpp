@@ -0,0 +1,76 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int malloc_count = 0;
+
+void *my_malloc(JITUserContext *user_context, size_t x) {
+    malloc_count++;
+    void *orig = malloc(x + 32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(JITUserContext *user_context, void *ptr) {
+    free(((void **)ptr)[-1]);
+}
+
+// Compute g in 16x16 tiles of f, with storage for g hoisted to the given
+// level, and return how many times g was allocated.
+int run(int level) {
+    Func f("f"), g("g");
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi");
+
+    g(x, y) = x * 3 + y;
+    f(x, y) = g(x, y) + g(x + 1, y + 1);
+
+    // The last tiles in each dimension are smaller, so the allocations
+    // made in each tile aren't all the same size.
+    f.tile(x, y, xo, yo, xi, yi, 16, 16, TailStrategy::GuardWithIf);
+    g.compute_at(f, xo).store_in(MemoryType::Heap);
+    if (level == 1) {
+        g.hoist_storage(f, yo);
+    } else if (level == 2) {
+        g.hoist_storage_root();
+    }
+
+    f.jit_handlers().custom_malloc = my_malloc;
+    f.jit_handlers().custom_free = my_free;
+
+    malloc_count = 0;
+    Buffer<int> out(70, 50);
+    f.realize(out);
+
+    for (int yy = 0; yy < out.height(); yy++) {
+        for (int xx = 0; xx < out.width(); xx++) {
+            int correct = (xx * 3 + yy) + ((xx + 1) * 3 + yy + 1);
+            if (out(xx, yy) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), correct);
+                exit(1);
+            }
+        }
+    }
+    return malloc_count;
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support custom allocators.\n");
+        return 0;
+    }
+
+    // 5x4 tiles
+    int per_tile = run(0);
+    int per_row = run(1);
+    int once = run(2);
+    if (per_tile != 20 || per_row != 4 || once != 1) {
+        printf("Expected 20, 4 and 1 allocations, got %d, %d and %d\n",
+               per_tile, per_row, once);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
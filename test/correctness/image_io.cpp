@@ -255,10 +255,84 @@ void test_mat_header() {
     }
 }
 
+template<typename T>
+void test_mmap() {
+    std::cout << "Testing memory-mapped I/O for " << halide_type_of<T>() << "\n";
+
+    Buffer<T> buf(17, 9, 3, 1);
+    buf.for_each_element([&](int x, int y, int c, int w) { buf(x, y, c, w) = (T)(x + y * 17 + c * 5); });
+
+    for (std::string format : {"tmp", "mat", "raw"}) {
+        std::string filename = Internal::get_test_tmp_dir() + "test_mmap_" +
+                               std::to_string(sizeof(T)) + "." + format;
+
+        // Write the output through a mapping, if the format supports it.
+        if (format != "mat") {
+            Buffer<T> out;
+            if (!Tools::create_mmap(filename, halide_type_of<T>(), {17, 9, 3, 1}, &out)) {
+                std::cout << "create_mmap failed for " << filename << "\n";
+                abort();
+            }
+            out.copy_from(buf);
+        } else {
+            Tools::save_image(buf, filename);
+        }
+
+        Buffer<T> reloaded;
+        bool ok = (format == "raw") ?
+                      Tools::load_raw_mmap(filename, halide_type_of<T>(), {17, 9, 3, 1}, &reloaded) :
+                      Tools::load_mmap(filename, &reloaded);
+        if (!ok) {
+            std::cout << "Could not map " << filename << "\n";
+            abort();
+        }
+        reloaded.for_each_element([&](const int *pos) {
+            if (reloaded(pos) != buf(pos)) {
+                std::cout << "Mismatch in memory-mapped " << filename << "\n";
+                abort();
+            }
+        });
+    }
+}
+
+void test_batch() {
+    std::cout << "Testing batched I/O\n";
+
+    std::vector<Buffer<uint8_t>> images;
+    std::vector<std::string> filenames;
+    for (int i = 0; i < 6; i++) {
+        Buffer<uint8_t> buf = (i % 2) ? Buffer<uint8_t>::make_interleaved(20 + i, 10, 3) : Buffer<uint8_t>(20 + i, 10, 3);
+        buf.for_each_element([&](int x, int y, int c) { buf(x, y, c) = (uint8_t)(x * 7 + y * 3 + c + i); });
+        images.push_back(buf);
+        filenames.push_back(Internal::get_test_tmp_dir() + "test_batch_" + std::to_string(i) + ".ppm");
+    }
+    if (!Tools::save_batch(images, filenames, 4)) {
+        std::cout << "save_batch failed\n";
+        abort();
+    }
+
+    std::vector<Buffer<uint8_t>> reloaded;
+    if (!Tools::load_batch(filenames, &reloaded, 4)) {
+        std::cout << "load_batch failed\n";
+        abort();
+    }
+    for (size_t i = 0; i < images.size(); i++) {
+        images[i].for_each_element([&](int x, int y, int c) {
+            if (reloaded[i](x, y, c) != images[i](x, y, c)) {
+                std::cout << "Mismatch in " << filenames[i] << "\n";
+                abort();
+            }
+        });
+    }
+}
+
 int main(int argc, char **argv) {
     do_test<uint8_t>();
     do_test<uint16_t>();
     test_mat_header();
+    test_mmap<uint8_t>();
+    test_mmap<float>();
+    test_batch();
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,96 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Record the allocations, and the widest store to each of them.
+class CheckAllocations : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const Allocate *op) override {
+        allocations[op->name] = op->extents.size();
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Store *op) override {
+        int &lanes = store_lanes[op->name];
+        lanes = std::max(lanes, op->value.type().lanes());
+        return IRMutator::visit(op);
+    }
+
+public:
+    std::map<std::string, size_t> allocations;
+    std::map<std::string, int> store_lanes;
+};
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    // Complex numbers from a pure definition.
+    {
+        Func f("f");
+        f(x, y) = {cast<float>(x + y), cast<float>(x * y)};
+
+        Func g("g");
+        g(x, y) = f(x, y)[0] * 2.0f + f(x, y)[1];
+
+        f.compute_root().interleave_tuple().vectorize(x, 8);
+        g.vectorize(x, 8);
+
+        CheckAllocations *checker = new CheckAllocations;
+        g.add_custom_lowering_pass(checker);
+        Buffer<float> result = g.realize({64, 16});
+
+        for (int j = 0; j < result.height(); j++) {
+            for (int i = 0; i < result.width(); i++) {
+                float correct = (i + j) * 2.0f + i * j;
+                if (result(i, j) != correct) {
+                    printf("result(%d, %d) = %f instead of %f\n", i, j, result(i, j), correct);
+                    return 1;
+                }
+            }
+        }
+
+        if (!checker->allocations.count("f.0") || checker->allocations.count("f.1")) {
+            printf("The elements of f were not merged into one allocation\n");
+            return 1;
+        }
+        if (checker->allocations["f.0"] != 3) {
+            printf("The allocation of f should have an extra dimension for the Tuple\n");
+            return 1;
+        }
+        if (checker->store_lanes["f.0"] != 16) {
+            printf("The stores to f should have been interleaved into one 16-wide store, not %d\n",
+                   checker->store_lanes["f.0"]);
+            return 1;
+        }
+    }
+
+    // RGB triples with an update definition.
+    {
+        Func f("f");
+        f(x) = {x, 2 * x, 3 * x};
+        RDom r(0, 4);
+        f(x) = {f(x)[0] + r, f(x)[1] * 2, f(x)[2] - r};
+
+        Func g("g");
+        g(x) = f(x)[0] + f(x)[1] + f(x)[2];
+
+        f.compute_root().interleave_tuple().vectorize(x, 4);
+        f.update().vectorize(x, 4);
+        g.vectorize(x, 4);
+
+        Buffer<int> result = g.realize({32});
+        for (int i = 0; i < result.width(); i++) {
+            int correct = (i + 6) + (2 * i * 16) + (3 * i - 6);
+            if (result(i) != correct) {
+                printf("result(%d) = %d instead of %d\n", i, result(i), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
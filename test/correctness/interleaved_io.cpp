@@ -0,0 +1,48 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 67, H = 23, C = 3;
+
+    Buffer<uint8_t> input = Buffer<uint8_t>::make_interleaved(W, H, C);
+    input.for_each_element([&](int x, int y, int c) { input(x, y, c) = (uint8_t)(x * 5 + y * 3 + c * 101); });
+
+    ImageParam rgb(UInt(8), 3, "rgb");
+    Var x("x"), y("y"), c("c");
+
+    // A blur, computed planar, between an interleaved input and an
+    // interleaved output.
+    rgb.deinterleaved(C);
+    Func blur("blur");
+    blur(x, y, c) = (cast<uint16_t>(rgb(clamp(x - 1, 0, W - 1), y, c)) +
+                     rgb(x, y, c) +
+                     rgb(clamp(x + 1, 0, W - 1), y, c)) /
+                    3;
+    Func out("out");
+    out(x, y, c) = cast<uint8_t>(blur(x, y, c));
+    blur.compute_root().vectorize(x, 16);
+    out.store_interleaved(C);
+
+    rgb.set(input);
+    Buffer<uint8_t> output = Buffer<uint8_t>::make_interleaved(W, H, C);
+    out.realize(output);
+
+    for (int yy = 0; yy < H; yy++) {
+        for (int xx = 0; xx < W; xx++) {
+            for (int cc = 0; cc < C; cc++) {
+                int sum = input(std::max(xx - 1, 0), yy, cc) + input(xx, yy, cc) + input(std::min(xx + 1, W - 1), yy, cc);
+                uint8_t correct = (uint8_t)(sum / 3);
+                if (output(xx, yy, cc) != correct) {
+                    printf("output(%d, %d, %d) = %d instead of %d\n",
+                           xx, yy, cc, output(xx, yy, cc), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
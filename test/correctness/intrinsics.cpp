@@ -37,6 +37,20 @@ void check(Expr test, Expr expected) {
     return check(test, expected, expected.type());
 }
 
+// narrow_arithmetic runs just before find_intrinsics in lowering. The
+// arithmetic it narrows must still be recognized.
+void check_narrowed(const Expr &test, const Expr &expected) {
+    Stmt s = find_intrinsics(narrow_arithmetic(Evaluate::make(simplify(test))));
+    Expr result = substitute_in_all_lets(s.as<Evaluate>()->value);
+    if (!equal(result, expected)) {
+        std::cerr << "failure!\n";
+        std::cerr << "test: " << test << "\n";
+        std::cerr << "result: " << result << "\n";
+        std::cerr << "expected: " << expected << "\n";
+        abort();
+    }
+}
+
 template<typename T>
 int64_t mul_shift_right(int64_t a, int64_t b, int q) {
     constexpr int64_t min_t = std::numeric_limits<T>::min();
@@ -192,6 +206,7 @@ int main(int argc, char **argv) {
 
     // Tricky case.
     check(i32(u8x) + 1, i32(widening_add(u8x, u8(1))));
+    check_narrowed(i32(u8x) + 1, i32(widening_add(u8x, u8(1))));
 
     // Check saturating arithmetic
     check(i8_sat(i16(i8x) + i8y), saturating_add(i8x, i8y));
@@ -0,0 +1,74 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+int reports = 0;
+std::string reported_name;
+
+void count_report(const char *pipeline_name, const JITCompileStats &stats) {
+    reports++;
+    reported_name = pipeline_name;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Func f("f");
+    Var x("x");
+    f(x) = x * 2;
+
+    Pipeline p(f);
+    p.jit_handlers().custom_jit_compile_report = count_report;
+
+    // The first realize compiles, and the second reuses the code.
+    p.realize({16});
+    p.realize({16});
+    const JITCompileStats &stats = p.jit_compile_stats();
+    if (stats.compiles != 1 || stats.cache_hits != 1) {
+        printf("Expected one compile and one cache hit, got %d and %d\n",
+               (int)stats.compiles, (int)stats.cache_hits);
+        return 1;
+    }
+    if (reports != 1 || reported_name != "f") {
+        printf("Expected one report for f, got %d for %s\n", reports, reported_name.c_str());
+        return 1;
+    }
+    if (stats.compile_seconds <= 0 ||
+        stats.compile_seconds < stats.lowering_seconds ||
+        stats.compile_seconds < stats.codegen_seconds) {
+        printf("Bad compile times: %f total, %f lowering, %f codegen\n",
+               stats.compile_seconds, stats.lowering_seconds, stats.codegen_seconds);
+        return 1;
+    }
+    uint64_t histogram_total = 0;
+    for (uint64_t count : stats.compile_time_histogram) {
+        histogram_total += count;
+    }
+    if (histogram_total != 1) {
+        printf("Expected one compile in the histogram, got %d\n", (int)histogram_total);
+        return 1;
+    }
+
+    // Invalidating the cache, and compiling for another target, recompile.
+    p.invalidate_cache();
+    p.realize({16});
+    p.compile_jit(get_jit_target_from_environment().with_feature(Target::NoAsserts));
+    if (stats.compiles != 3 || reports != 3 ||
+        stats.invalidations[JITCompileStats::CacheInvalidated] != 1 ||
+        stats.invalidations[JITCompileStats::TargetChanged] != 1) {
+        printf("Expected three compiles after invalidating, got %d\n", (int)stats.compiles);
+        return 1;
+    }
+
+    p.reset_jit_compile_stats();
+    if (stats.compiles != 0 || stats.cache_hits != 0) {
+        printf("Stats were not reset\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
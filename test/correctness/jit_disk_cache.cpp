@@ -0,0 +1,94 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdlib>
+#include <filesystem>
+
+using namespace Halide;
+
+namespace {
+
+int count_cache_entries(const std::string &dir) {
+    int count = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.path().extension() == ".o") {
+            count++;
+        }
+    }
+    return count;
+}
+
+int run_pipeline(const Target &target, int scale) {
+    // Use the same names every time, so that the lowered code is
+    // identical and the second run can be served from the cache.
+    Func f("jit_disk_cache_f");
+    Var x("x"), y("y");
+    f(x, y) = x * scale + y;
+    f.vectorize(x, 8);
+
+    Buffer<int> out = f.realize({64, 64}, target);
+    for (int yy = 0; yy < out.height(); yy++) {
+        for (int xx = 0; xx < out.width(); xx++) {
+            if (out(xx, yy) != xx * scale + yy) {
+                printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), xx * scale + yy);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("[SKIP] Windows does not have a working setenv\n");
+    return 0;
+#else
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] The JIT cache is not used for WebAssembly.\n");
+        return 0;
+    }
+
+    std::string dir = Internal::get_test_tmp_dir() + "jit_disk_cache";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    setenv("HL_JIT_CACHE_DIR", dir.c_str(), 1);
+
+    if (run_pipeline(target, 3)) {
+        return 1;
+    }
+    int entries = count_cache_entries(dir);
+    if (entries != 1) {
+        printf("Expected one object in %s, got %d\n", dir.c_str(), entries);
+        return 1;
+    }
+
+    // The same pipeline should be loaded from the cache, and so not add
+    // any entries.
+    if (run_pipeline(target, 3)) {
+        return 1;
+    }
+    if (count_cache_entries(dir) != entries) {
+        printf("Expected %d cache entries, got %d\n", entries, count_cache_entries(dir));
+        return 1;
+    }
+
+    // A pipeline differing only in a constant must not be served from
+    // the cache.
+    if (run_pipeline(target, 5)) {
+        return 1;
+    }
+    if (count_cache_entries(dir) != entries + 1) {
+        printf("Expected %d cache entries, got %d\n", entries + 1, count_cache_entries(dir));
+        return 1;
+    }
+
+    unsetenv("HL_JIT_CACHE_DIR");
+    std::filesystem::remove_all(dir);
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,162 @@
+#include "Halide.h"
+
+#include <iostream>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Loop carrying only runs in the Hexagon backend. This applies it the
+// same way CodeGen_Hexagon does, as a custom lowering pass, so the
+// result can be inspected and run on any target.
+class CarryValues : public IRMutator {
+public:
+    using IRMutator::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        result = simplify(loop_carry(s, 16));
+        return result;
+    }
+
+    Stmt result;
+};
+
+// Count the loads from a Func inside the loop over its update.
+class CountReloads : public IRVisitor {
+    using IRVisitor::visit;
+
+    const std::string &func;
+    bool in_update = false;
+
+    void visit(const For *op) override {
+        bool old_in_update = in_update;
+        in_update = in_update || starts_with(op->name, func + ".s1.");
+        IRVisitor::visit(op);
+        in_update = old_in_update;
+    }
+
+    void visit(const Load *op) override {
+        if (in_update && op->name == func) {
+            count++;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    CountReloads(const std::string &func)
+        : func(func) {
+    }
+
+    int count = 0;
+};
+
+int run_scan(bool guarded) {
+    const int size = 1024;
+    Buffer<int> input(size);
+    for (int i = 0; i < size; i++) {
+        input(i) = (i * 17) % 23 - 11;
+    }
+
+    std::string name = guarded ? "guarded_scan" : "scan";
+    Func g("g"), scan(name), out("out");
+    Var x("x");
+    RDom r(1, size - 1);
+    g(x) = input(x);
+    scan(x) = g(x);
+    if (guarded) {
+        // The store happens inside an if, which may not run on every
+        // iteration, so the value can't be carried across.
+        r.where(r % 3 != 0);
+    }
+    scan(r) = scan(r - 1) + g(r);
+    out(x) = scan(x);
+    g.compute_root();
+    scan.compute_root();
+
+    CarryValues carry;
+    out.add_custom_lowering_pass(&carry, []() {});
+    Buffer<int> output = out.realize({size});
+
+    CountReloads reloads(name);
+    carry.result.accept(&reloads);
+    if (guarded && reloads.count == 0) {
+        printf("The load of %s inside a guarded update was removed\n", name.c_str());
+        return 1;
+    } else if (!guarded && reloads.count != 0) {
+        std::cerr << "The value of " << name << " stored on one iteration is still reloaded on the next:\n"
+                  << carry.result << "\n";
+        return 1;
+    }
+
+    int correct = input(0);
+    for (int i = 0; i < size; i++) {
+        if (i > 0) {
+            correct = (guarded && i % 3 == 0) ? input(i) : correct + input(i);
+        }
+        if (output(i) != correct) {
+            printf("%s(%d) = %d instead of %d\n", name.c_str(), i, output(i), correct);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+class FindStore : public IRVisitor {
+    using IRVisitor::visit;
+
+    std::string buffer;
+
+    void visit(const Store *op) override {
+        if (op->name == buffer) {
+            store = op;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    FindStore(const std::string &buffer)
+        : buffer(buffer) {
+    }
+
+    const Store *store = nullptr;
+};
+
+// An accumulator stored to the same place on every iteration, and
+// read back after the store, as in a compute_with-fused
+//   acc[0] = acc[0] + g[x]; h[x] = acc[0]
+// The load after the store must see this iteration's value, so it
+// can't be replaced with the value stored on the last one.
+int run_invariant_store() {
+    Expr x = Variable::make(Int(32), "x");
+    auto load = [](const std::string &name, Expr index) {
+        return Load::make(Int(32), name, std::move(index), Buffer<>(), Parameter(), const_true(), ModulusRemainder());
+    };
+    auto store = [](const std::string &name, Expr value, Expr index) {
+        return Store::make(name, std::move(value), std::move(index), Parameter(), const_true(), ModulusRemainder());
+    };
+    Stmt body = Block::make(store("acc", load("acc", 0) + load("g", x), 0),
+                            store("h", load("acc", 0), x));
+    Stmt loop = For::make("x", 0, 100, ForType::Serial, DeviceAPI::None, body);
+
+    Stmt result = simplify(loop_carry(loop, 16));
+    FindStore find_h("h");
+    result.accept(&find_h);
+    const Load *reload = find_h.store ? find_h.store->value.as<Load>() : nullptr;
+    if (!reload || reload->name != "acc") {
+        std::cerr << "The load of acc after the store to it was replaced:\n"
+                  << result << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (run_scan(false) != 0 ||
+        run_scan(true) != 0 ||
+        run_invariant_store() != 0) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
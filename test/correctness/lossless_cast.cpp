@@ -28,6 +28,7 @@ int lossless_cast_test() {
     Expr var_u8 = Variable::make(u8, "x");
     Expr var_u16 = Variable::make(u16, "x");
     Expr var_u8x = Variable::make(u8x, "x");
+    Expr var_i8 = Variable::make(i8, "x");
 
     int res = 0;
 
@@ -46,6 +47,13 @@ int lossless_cast_test() {
     e = cast(u32, var_u8);
     res |= check_lossless_cast(u16, e, cast(u16, var_u8));
 
+    e = cast(i32, var_i8) - cast(i32, var_i8);
+    res |= check_lossless_cast(i16, e, cast(i16, var_i8) - cast(i16, var_i8));
+
+    // The difference may be negative.
+    e = cast(u32, var_u8) - cast(u32, var_u8);
+    res |= check_lossless_cast(u16, e, Expr());
+
     e = VectorReduce::make(VectorReduce::Add, cast(u16x, var_u8x), 1);
     res |= check_lossless_cast(u16, e, cast(u16, e));
 
@@ -55,8 +63,37 @@ int lossless_cast_test() {
     return res;
 }
 
+// Narrowing a difference must not change its value, for every pair of
+// int8 values.
+int lossless_cast_sub_test() {
+    Var x("x"), y("y");
+    Expr a = cast<int8_t>(x - 128), b = cast<int8_t>(y - 128);
+    Expr wide = cast<int32_t>(a) - cast<int32_t>(b);
+    Expr narrow = lossless_cast(Int(16), wide);
+    if (!narrow.defined()) {
+        std::cout << "Couldn't narrow " << wide << " to int16\n";
+        return 1;
+    }
+
+    Func f("f");
+    f(x, y) = {wide, cast<int32_t>(narrow)};
+    f.vectorize(x, 16);
+    Realization r = f.realize({256, 256});
+    Buffer<int> correct = r[0], result = r[1];
+    for (int j = 0; j < 256; j++) {
+        for (int i = 0; i < 256; i++) {
+            if (result(i, j) != correct(i, j)) {
+                std::cout << "lossless_cast(int16, " << wide << ") is " << result(i, j)
+                          << " instead of " << correct(i, j) << " at " << i << ", " << j << "\n";
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
 int main() {
-    if (lossless_cast_test()) {
+    if (lossless_cast_test() || lossless_cast_sub_test()) {
         printf("lossless_cast test failed!\n");
         return 1;
     }
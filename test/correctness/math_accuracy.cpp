@@ -0,0 +1,137 @@
+#include "Halide.h"
+
+#include <cmath>
+#include <functional>
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+// The error of a float result in units of the last place of the exact
+// result.
+double ulp_error(float result, double exact) {
+    int e;
+    std::frexp(std::max(std::abs(exact), 1e-30), &e);
+    return std::abs(result - exact) / std::ldexp(1.0, e - 24);
+}
+
+struct Test {
+    const char *name;
+    // The Halide function under test, called on the inputs x and y,
+    // with and without an accuracy.
+    std::function<Expr(Expr, Expr, MathAccuracy)> halide;
+    std::function<Expr(Expr, Expr)> plain;
+    std::function<double(double, double)> reference;
+    // The range of the arguments.
+    float min, max;
+};
+
+const int size = 1 << 16;
+
+float input(int i, float min, float max) {
+    return min + (max - min) * i / (size - 1);
+}
+
+// The second argument of atan2 goes through a different set of values
+// to the first.
+float second_input(int i) {
+    return 5.0f * std::sin(i * 0.0013f);
+}
+
+bool check(const Test &test, MathAccuracy accuracy, const Target &target,
+           bool plain_call, double ulp_tolerance, double abs_tolerance) {
+    ImageParam in_x(Float(32), 1), in_y(Float(32), 1);
+    Buffer<float> xs(size), ys(size);
+    for (int i = 0; i < size; i++) {
+        xs(i) = input(i, test.min, test.max);
+        ys(i) = second_input(i);
+    }
+    in_x.set(xs);
+    in_y.set(ys);
+
+    Func f;
+    Var x;
+    if (plain_call) {
+        // Let the target decide how to compute the call.
+        f(x) = test.plain(in_x(x), in_y(x));
+    } else {
+        f(x) = test.halide(in_x(x), in_y(x), accuracy);
+    }
+    f.vectorize(x, 8);
+    Buffer<float> out = f.realize({size}, target);
+
+    double worst_ulps = 0, worst_abs = 0;
+    for (int i = 0; i < size; i++) {
+        double exact = test.reference(xs(i), ys(i));
+        worst_ulps = std::max(worst_ulps, ulp_error(out(i), exact));
+        worst_abs = std::max(worst_abs, std::abs(out(i) - exact));
+        if (ulp_error(out(i), exact) > ulp_tolerance &&
+            std::abs(out(i) - exact) > abs_tolerance) {
+            printf("%s(%.9g, %.9g) = %.9g instead of %.9g (%g ulps)\n",
+                   test.name, xs(i), ys(i), out(i), exact, ulp_error(out(i), exact));
+            return false;
+        }
+    }
+    printf("%s: worst error %g ulps, %g absolute\n", test.name, worst_ulps, worst_abs);
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+
+    std::vector<Test> tests = {
+        {"sin", [](Expr x, Expr, MathAccuracy a) { return sin(x, a); },
+         [](Expr x, Expr) { return sin(x); },
+         [](double x, double) { return std::sin(x); }, -8192.0f, 8192.0f},
+        {"cos", [](Expr x, Expr, MathAccuracy a) { return cos(x, a); },
+         [](Expr x, Expr) { return cos(x); },
+         [](double x, double) { return std::cos(x); }, -8192.0f, 8192.0f},
+        {"tan", [](Expr x, Expr, MathAccuracy a) { return tan(x, a); },
+         [](Expr x, Expr) { return tan(x); },
+         [](double x, double) { return std::tan(x); }, -8192.0f, 8192.0f},
+        {"asin", [](Expr x, Expr, MathAccuracy a) { return asin(x, a); },
+         [](Expr x, Expr) { return asin(x); },
+         [](double x, double) { return std::asin(x); }, -1.0f, 1.0f},
+        {"acos", [](Expr x, Expr, MathAccuracy a) { return acos(x, a); },
+         [](Expr x, Expr) { return acos(x); },
+         [](double x, double) { return std::acos(x); }, -1.0f, 1.0f},
+        {"atan", [](Expr x, Expr, MathAccuracy a) { return atan(x, a); },
+         [](Expr x, Expr) { return atan(x); },
+         [](double x, double) { return std::atan(x); }, -100.0f, 100.0f},
+        {"atan2", [](Expr x, Expr y, MathAccuracy a) { return atan2(x, y, a); },
+         [](Expr x, Expr y) { return atan2(x, y); },
+         [](double x, double y) { return std::atan2(x, y); }, -3.0f, 3.0f},
+    };
+
+    for (const Test &test : tests) {
+        // Halide's own approximations.
+        if (!check(test, MathAccuracy::High, target, false, 4, 0)) {
+            return 1;
+        }
+        // The math library, called one lane at a time.
+        if (!check(test, MathAccuracy::Precise, target, false, 2, 0)) {
+            return 1;
+        }
+        // Plain calls with the vector_math feature should match High.
+        if (!check(test, MathAccuracy::High, target.with_feature(Target::VectorMath), true, 4, 0)) {
+            return 1;
+        }
+    }
+
+    // The fast approximations only promise an absolute error, and only
+    // over a couple of periods.
+    for (const Test &test : {tests[0], tests[1]}) {
+        Test fast = test;
+        fast.min = -6.28318531f;
+        fast.max = 6.28318531f;
+        if (!check(fast, MathAccuracy::Fast, target, false, 0, 1e-5)) {
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
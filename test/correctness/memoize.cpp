@@ -488,6 +488,39 @@ int main(int argc, char **argv) {
         Internal::JITSharedRuntime::memoization_cache_set_size(0);
     }
 
+    {
+        // Test more distinct keys than the cache's initial hash
+        // tables hold, with a cache large enough for all of them.
+        Param<int> val;
+
+        call_count_with_arg = 0;
+        Func count_calls;
+        count_calls.define_extern("count_calls_with_arg", {cast<uint8_t>(val)}, UInt(8), 2);
+
+        Func f;
+        Var x, y;
+        f(x, y) = count_calls(x, y);
+        count_calls.compute_root().memoize();
+
+        Internal::JITSharedRuntime::memoization_cache_set_size(10000000);
+
+        for (int pass = 0; pass < 2; pass++) {
+            for (int v = 0; v < 2000; v++) {
+                val.set(v);
+                Buffer<uint8_t> out = f.realize({16, 16});
+                for (int32_t i = 0; i < 16; i++) {
+                    for (int32_t j = 0; j < 16; j++) {
+                        assert(out(i, j) == (uint8_t)v);
+                    }
+                }
+            }
+            assert(call_count_with_arg == 2000);
+        }
+
+        // Return cache size to default.
+        Internal::JITSharedRuntime::memoization_cache_set_size(0);
+    }
+
     {
         // Test multiple argument memoize_tag. This can be unsafe but
         // models cases where one uses a hash of image data as part of
@@ -734,6 +767,55 @@ int main(int argc, char **argv) {
         assert(call_count == 8);
     }
 
+    // Test statistics and eviction key budgets.
+    {
+        Param<int> val;
+
+        call_count_with_arg = 0;
+        Func count_calls;
+        count_calls.define_extern("count_calls_with_arg", {cast<uint8_t>(val)}, UInt(8), 2);
+
+        Func f;
+        Var x, y;
+        f(x, y) = count_calls(x, y);
+        count_calls.compute_root().memoize(EvictionKey(4000));
+
+        // Room for four 16x16 results.
+        Internal::JITSharedRuntime::memoization_cache_set_size(10000000);
+        Internal::JITSharedRuntime::memoization_cache_set_eviction_key_size(4000, 4 * 256);
+
+        halide_memoization_cache_stats_t before, after;
+        Internal::JITSharedRuntime::memoization_cache_get_stats(&before);
+
+        for (int v = 0; v < 20; v++) {
+            val.set(v);
+            Buffer<uint8_t> out = f.realize({16, 16});
+            assert(out(3, 5) == (uint8_t)v);
+            assert(Internal::JITSharedRuntime::memoization_cache_get_eviction_key_usage(4000) <= 4 * 256);
+        }
+        assert(call_count_with_arg == 20);
+
+        // The most recent result is still cached.
+        Buffer<uint8_t> out = f.realize({16, 16});
+        assert(out(3, 5) == 19);
+        assert(call_count_with_arg == 20);
+
+        Internal::JITSharedRuntime::memoization_cache_get_stats(&after);
+        assert(after.misses - before.misses == 20);
+        assert(after.stores - before.stores == 20);
+        assert(after.hits - before.hits == 1);
+        assert(after.evictions - before.evictions >= 16);
+        assert(after.bytes_evicted - before.bytes_evicted >= 16 * 256);
+        assert(after.max_size == 10000000);
+
+        Internal::JITSharedRuntime::memoization_cache_evict(4000);
+        assert(Internal::JITSharedRuntime::memoization_cache_get_eviction_key_usage(4000) == 0);
+
+        // Return cache sizes to default.
+        Internal::JITSharedRuntime::memoization_cache_set_eviction_key_size(4000, 0);
+        Internal::JITSharedRuntime::memoization_cache_set_size(0);
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,83 @@
+#include "Halide.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::Metal)) {
+        printf("[SKIP] Metal not enabled.\n");
+        return 0;
+    }
+
+    // A chain of more kernels than fit in one batch of dispatches, so
+    // that a batch is committed partway through each run.
+    const int num_stages = 100;
+    const int width = 256, height = 64;
+    ImageParam in(Float(32), 2);
+    std::vector<Func> f(num_stages);
+    Var x, y, xi, yi;
+    f[0](x, y) = in(x, y) + 1.0f;
+    for (int i = 1; i < num_stages; i++) {
+        f[i](x, y) = f[i - 1](x, y) + 1.0f;
+    }
+    for (int i = 0; i < num_stages; i++) {
+        if (i < num_stages - 1) {
+            f[i].compute_root();
+        }
+        f[i].gpu_tile(x, y, xi, yi, 16, 16);
+    }
+    Func out = f[num_stages - 1];
+    Callable c = out.compile_to_callable({in}, target);
+
+    // Run from several threads at once. Dispatches from different
+    // threads share the batch, so it must not be committed while
+    // another thread is encoding into it. Each thread also rewrites
+    // its input between runs, which must wait for the batched
+    // dispatches that still read the old contents.
+    const int num_threads = 4;
+    std::atomic<int> failures = 0;
+    auto worker = [&](int t) {
+        Buffer<float> input(width, height);
+        for (int iter = 0; iter < 5; iter++) {
+            float value = (float)(t * 100 + iter);
+            input.fill(value);
+            input.set_host_dirty();
+            Buffer<float> result(width, height);
+            if (c(input, result) != 0) {
+                printf("thread %d: the pipeline failed\n", t);
+                failures++;
+                return;
+            }
+            result.copy_to_host();
+            float correct = value + num_stages;
+            for (int yy = 0; yy < height; yy++) {
+                for (int xx = 0; xx < width; xx++) {
+                    if (result(xx, yy) != correct) {
+                        printf("thread %d: result(%d, %d) = %f instead of %f\n",
+                               t, xx, yy, result(xx, yy), correct);
+                        failures++;
+                        return;
+                    }
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back(worker, t);
+    }
+    for (auto &th : threads) {
+        th.join();
+    }
+
+    if (failures) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include "Halide.h"
+#include <iostream>
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the vector arithmetic done in 32 or more bits.
+class CountWideVectorArithmetic : public IRVisitor {
+    using IRVisitor::visit;
+
+    template<typename T>
+    void visit_arithmetic(const T *op) {
+        if (op->type.is_vector() && op->type.bits() >= 32) {
+            count++;
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Add *op) override {
+        visit_arithmetic(op);
+    }
+
+    void visit(const Sub *op) override {
+        visit_arithmetic(op);
+    }
+
+    void visit(const Mul *op) override {
+        visit_arithmetic(op);
+    }
+
+    void visit(const Div *op) override {
+        visit_arithmetic(op);
+    }
+
+    void visit(const Mod *op) override {
+        visit_arithmetic(op);
+    }
+
+    void visit(const Min *op) override {
+        visit_arithmetic(op);
+    }
+
+    void visit(const Max *op) override {
+        visit_arithmetic(op);
+    }
+
+public:
+    int count = 0;
+};
+
+class CheckWideVectorArithmetic : public IRMutator {
+    bool expect_wide;
+
+public:
+    CheckWideVectorArithmetic(bool expect_wide)
+        : expect_wide(expect_wide) {
+    }
+    using IRMutator::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        CountWideVectorArithmetic c;
+        s.accept(&c);
+        if ((c.count > 0) != expect_wide) {
+            printf("There were %d wide vector operations. There were supposed to be %s.\n",
+                   c.count, expect_wide ? "some" : "none");
+            exit(1);
+        }
+        return s;
+    }
+};
+
+template<typename T>
+int check(Func f, bool expect_wide, const Buffer<uint8_t> &input, T (*reference)(int, int, int)) {
+    f.vectorize(f.args()[0], 16);
+    f.add_custom_lowering_pass(new CheckWideVectorArithmetic(expect_wide));
+    Buffer<T> result = f.realize({1024});
+    for (int x = 0; x < result.width(); x++) {
+        T correct = reference(input(x), input(x + 1), input(x + 2));
+        if (result(x) != correct) {
+            printf("%s(%d) = %d instead of %d\n",
+                   f.name().c_str(), x, (int)result(x), (int)correct);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Check whether the value stored to a buffer loads anything.
+class StoredValueLoads : public IRVisitor {
+    using IRVisitor::visit;
+
+    std::string buffer;
+    bool in_store = false;
+
+    void visit(const Store *op) override {
+        in_store = op->name == buffer;
+        IRVisitor::visit(op);
+        in_store = false;
+    }
+
+    void visit(const Load *op) override {
+        result = result || in_store;
+        IRVisitor::visit(op);
+    }
+
+public:
+    StoredValueLoads(const std::string &buffer)
+        : buffer(buffer) {
+    }
+
+    bool result = false;
+};
+
+// A vector let whose value loads from a buffer that is stored to
+// before the let is used:
+//   let t = i32(buf[ramp]) in { buf[ramp] = 0; out[ramp] = t + t }
+// The narrowed uses of t must not load buf again after the store.
+int check_let_before_store() {
+    Expr ramp = Ramp::make(0, 1, 8);
+    Expr load = Load::make(UInt(8, 8), "buf", ramp, Buffer<>(), Parameter(), const_true(8), ModulusRemainder());
+    Expr t = Variable::make(Int(32, 8), "t");
+    Stmt body = Block::make(Store::make("buf", make_zero(UInt(8, 8)), ramp, Parameter(), const_true(8), ModulusRemainder()),
+                            Store::make("out", t + t, ramp, Parameter(), const_true(8), ModulusRemainder()));
+    Stmt s = narrow_arithmetic(LetStmt::make("t", cast(Int(32, 8), load), body));
+
+    StoredValueLoads loads("out");
+    s.accept(&loads);
+    if (loads.result) {
+        std::cerr << "A use of a narrowed let reloads its value after a store:\n"
+                  << s << "\n";
+        return 1;
+    }
+    CountWideVectorArithmetic c;
+    s.accept(&c);
+    if (c.count > 0) {
+        std::cerr << "The use of a let wasn't narrowed:\n"
+                  << s << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Buffer<uint8_t> input(1026);
+    input.for_each_element([&](int x) { input(x) = (uint8_t)(x * 37 + (x >> 3)); });
+
+    Var x("x");
+    Expr a = cast<int>(input(x)), b = cast<int>(input(x + 1)), c = cast<int>(input(x + 2));
+
+    // A blur computed in int32 out of uint8 inputs. All the
+    // intermediate values fit in 16 bits.
+    Func blur("blur");
+    blur(x) = cast<uint8_t>((a + 2 * b + c + 2) / 4);
+    if (check<uint8_t>(blur, false, input, [](int a, int b, int c) {
+            return (uint8_t)((a + 2 * b + c + 2) / 4);
+        })) {
+        return 1;
+    }
+
+    // Differences can be negative, so they need a signed type.
+    Func diff("diff");
+    diff(x) = max(a - b, c - b) + min(a, c);
+    if (check<int>(diff, false, input, [](int a, int b, int c) {
+            return std::max(a - b, c - b) + std::min(a, c);
+        })) {
+        return 1;
+    }
+
+    // The product of three uint8 values needs more than 16 bits, so it
+    // must stay in 32 bits.
+    Func prod("prod");
+    prod(x) = a * b * c;
+    if (check<int>(prod, true, input, [](int a, int b, int c) {
+            return a * b * c;
+        })) {
+        return 1;
+    }
+
+    // Division and modulus by constants and by values can be done in
+    // a narrower type as long as every value fits.
+    Func divmod("divmod");
+    divmod(x) = (a * 3 + b) / (c + 1) + (a - c) % 7;
+    if (check<int>(divmod, false, input, [](int a, int b, int c) {
+            int m = (a - c) % 7;
+            return (a * 3 + b) / (c + 1) + (m < 0 ? m + 7 : m);
+        })) {
+        return 1;
+    }
+
+    // A vector let used several times is narrowed once, and the uses
+    // refer to the narrowed value.
+    Func let("let");
+    Expr s = Variable::make(Int(32), "s");
+    let(x) = Let::make("s", a + b, (s * 3 + c) / 5 + s % 7);
+    if (check<int>(let, false, input, [](int a, int b, int c) {
+            int s = a + b;
+            return (s * 3 + c) / 5 + s % 7;
+        })) {
+        return 1;
+    }
+
+    if (check_let_before_store()) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "Halide.h"
+#include <mutex>
+#include <stdio.h>
+
+using namespace Halide;
+
+std::mutex regions_mutex;
+Buffer<int> output;
+int calls = 0, pixels_seen = 0;
+bool region_incomplete = false;
+
+int my_region_complete(JITUserContext *user_context, const char *func, int dimensions,
+                       const int32_t *min, const int32_t *extent) {
+    std::lock_guard<std::mutex> lock(regions_mutex);
+    calls++;
+    if (dimensions != 2) {
+        region_incomplete = true;
+        return 0;
+    }
+    // Everything in the region should already be computed.
+    for (int y = min[1]; y < min[1] + extent[1]; y++) {
+        for (int x = min[0]; x < min[0] + extent[0]; x++) {
+            if (output(x, y) != x + 100 * y) {
+                region_incomplete = true;
+            }
+            pixels_seen++;
+        }
+    }
+    return 0;
+}
+
+int failing_region_complete(JITUserContext *user_context, const char *func, int dimensions,
+                            const int32_t *min, const int32_t *extent) {
+    return -1;
+}
+
+bool error_occurred = false;
+void my_error(JITUserContext *user_context, const char *msg) {
+    error_occurred = true;
+}
+
+int check(Func f, int expected_calls) {
+    calls = 0;
+    pixels_seen = 0;
+    region_incomplete = false;
+    output = Buffer<int>(64, 48);
+    output.fill(-1);
+    f.jit_handlers().custom_region_complete = my_region_complete;
+    f.realize(output);
+
+    if (region_incomplete) {
+        printf("A region was reported complete before it was computed\n");
+        return 1;
+    }
+    if (calls != expected_calls) {
+        printf("halide_region_complete was called %d times instead of %d\n",
+               calls, expected_calls);
+        return 1;
+    }
+    if (pixels_seen != 64 * 48) {
+        printf("The regions reported covered %d pixels instead of %d\n",
+               pixels_seen, 64 * 48);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi");
+
+    // Parallel row strips.
+    {
+        Func f("f");
+        f(x, y) = x + 100 * y;
+        f.split(y, yo, yi, 16).parallel(yo).notify_completion(yo);
+        if (check(f, 3)) {
+            return 1;
+        }
+    }
+
+    // Tiles of a Func with an update. The callback should come after
+    // the last stage has run over each tile.
+    {
+        Func f("f");
+        f(x, y) = x;
+        f(x, y) += 100 * y;
+        f.update().tile(x, y, xo, yo, xi, yi, 16, 16);
+        f.notify_completion(xo);
+        if (check(f, 12)) {
+            return 1;
+        }
+    }
+
+    // A nonzero return value aborts the pipeline.
+    {
+        Func f("f");
+        f(x, y) = x + 100 * y;
+        f.notify_completion(y);
+        f.jit_handlers().custom_region_complete = failing_region_complete;
+        f.jit_handlers().custom_error = my_error;
+        f.realize({64, 48});
+        if (!error_occurred) {
+            printf("There should have been an error\n");
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
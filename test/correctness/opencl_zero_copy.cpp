@@ -0,0 +1,74 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::OpenCL)) {
+        printf("[SKIP] OpenCL not enabled.\n");
+        return 0;
+    }
+
+    const int width = 256, height = 256;
+    ImageParam in(Float(32), 2);
+    Func f;
+    Var x, y, xi, yi;
+    f(x, y) = in(x, y) * 2.0f + 1.0f;
+    f.gpu_tile(x, y, xi, yi, 16, 16);
+    f.compile_jit(target);
+
+    // On devices with unified memory these buffers are wrapped around
+    // their host allocations, so every copy below is a map or an
+    // unmap. Other devices get separate host and device allocations,
+    // which must behave the same way.
+    Buffer<float> input(nullptr, width, height), output(nullptr, width, height);
+    const halide_device_interface_t *opencl = get_device_interface_for_device_api(DeviceAPI::OpenCL, target);
+    if (input.get()->device_and_host_malloc(opencl) != 0 ||
+        output.get()->device_and_host_malloc(opencl) != 0) {
+        printf("device_and_host_malloc failed\n");
+        return 1;
+    }
+
+    for (int iter = 0; iter < 3; iter++) {
+        input.fill((float)iter);
+        input.set_host_dirty();
+        in.set(input);
+        f.realize(output, target);
+        output.copy_to_host();
+        for (int yy = 0; yy < height; yy++) {
+            for (int xx = 0; xx < width; xx++) {
+                float correct = iter * 2.0f + 1.0f;
+                if (output(xx, yy) != correct) {
+                    printf("output(%d, %d) = %f instead of %f\n", xx, yy, output(xx, yy), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    {
+        // Only part of the host data changes, and is copied, this time.
+        Runtime::Buffer<float> input_crop = input.get()->cropped(1, height / 4, height / 2);
+        input_crop.fill(100.0f);
+        input_crop.set_host_dirty();
+        input_crop.copy_to_device(opencl);
+    }
+    in.set(input);
+    f.realize(output, target);
+    output.copy_to_host();
+    for (int yy = 0; yy < height; yy++) {
+        for (int xx = 0; xx < width; xx++) {
+            float correct = (yy >= height / 4 && yy < height / 4 + height / 2) ? 201.0f : 5.0f;
+            if (output(xx, yy) != correct) {
+                printf("output(%d, %d) = %f instead of %f\n", xx, yy, output(xx, yy), correct);
+                return 1;
+            }
+        }
+    }
+
+    input.get()->device_and_host_free(opencl);
+    output.get()->device_and_host_free(opencl);
+
+    printf("Success!\n");
+    return 0;
+}
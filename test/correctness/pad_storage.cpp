@@ -0,0 +1,106 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Record the extents of an allocation.
+class FindAllocation : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const Allocate *op) override {
+        if (op->name == name) {
+            extents = op->extents;
+        }
+        return IRMutator::visit(op);
+    }
+
+    std::string name;
+
+public:
+    std::vector<Expr> extents;
+
+    FindAllocation(const std::string &name)
+        : name(name) {
+    }
+};
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    Func in("in"), tile("tile"), out("out");
+    in(x, y) = x + y * 1000;
+    tile(x, y) = in(x, y);
+    out(x, y) = tile(y, x);
+
+    if (t.has_gpu_feature()) {
+        // Transpose through shared memory. Without padding, each warp
+        // reads a column of the tile from a single bank.
+        out.gpu_tile(x, y, xi, yi, 32, 32);
+        tile.compute_at(out, x)
+            .store_in(MemoryType::GPUShared)
+            .gpu_threads(x, y);
+    } else {
+        out.tile(x, y, xi, yi, 32, 32);
+        tile.compute_at(out, x);
+    }
+    tile.pad_storage(x, 1);
+
+    FindAllocation finder("tile");
+    out.add_custom_lowering_pass(&finder, nullptr);
+    Buffer<int> result = out.realize({64, 64}, t);
+
+    // Shared allocations get merged into a single allocation for the
+    // whole kernel, so only check the extents on the CPU.
+    if (!t.has_gpu_feature() &&
+        (finder.extents.size() != 2 ||
+         !is_const(finder.extents[0], 33) ||
+         !is_const(finder.extents[1], 32))) {
+        printf("Expected tile to be allocated with padded extents 33x32\n");
+        return 1;
+    }
+
+    for (int j = 0; j < result.height(); j++) {
+        for (int i = 0; i < result.width(); i++) {
+            int correct = j + i * 1000;
+            if (result(i, j) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", i, j, result(i, j), correct);
+                return 1;
+            }
+        }
+    }
+
+    // Rows of 1024 floats are 4096 bytes apart, so they are padded by a
+    // cache line. Rows of 1000 floats are left alone.
+    for (int width : {1024, 1000}) {
+        Func wide("wide"), transposed("transposed");
+        wide(x, y) = cast<float>(x + y * 1000);
+        transposed(x, y) = wide(y, x);
+        transposed.bound(x, 0, 16).bound(y, 0, width);
+        wide.compute_root().pad_storage_against_aliasing(x);
+
+        FindAllocation wide_finder("wide");
+        transposed.add_custom_lowering_pass(&wide_finder, nullptr);
+        Buffer<float> r = transposed.realize({16, width});
+
+        int expected = width == 1024 ? 1024 + 16 : width;
+        if (wide_finder.extents.size() != 2 ||
+            !is_const(wide_finder.extents[0], expected)) {
+            printf("Expected wide to be allocated with an inner extent of %d\n", expected);
+            return 1;
+        }
+        for (int j = 0; j < r.height(); j++) {
+            for (int i = 0; i < r.width(); i++) {
+                float correct = (float)(j + i * 1000);
+                if (r(i, j) != correct) {
+                    printf("r(%d, %d) = %f instead of %f\n", i, j, r(i, j), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
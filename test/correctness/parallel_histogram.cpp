@@ -0,0 +1,49 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 1000, H = 700;
+
+    Buffer<uint8_t> in(W, H);
+    int reference_hist[256] = {0};
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            in(x, y) = (uint8_t)(rand() & 0xff);
+            reference_hist[in(x, y)]++;
+        }
+    }
+
+    for (int slice_size : {1, 16, 64}) {
+        Func hist("hist");
+        Var x("x"), u("u");
+        RDom r(in);
+        hist(x) = 0;
+        hist(cast<int>(in(r.x, r.y))) += 1;
+
+        // Each slice of rows gets its own copy of the bins, and the
+        // copies are merged with a vectorized update. H isn't a multiple
+        // of 16 or 64, so the last slice is partial in those cases.
+        Func intm = hist.update().privatize(r.y, u, slice_size);
+        intm.vectorize(x, 8);
+        hist.compute_root()
+            .bound(x, 0, 256)
+            .vectorize(x, 8)
+            .update()
+            .reorder(x, r.y)
+            .vectorize(x, 8);
+
+        Buffer<int> result = hist.realize({256});
+        for (int i = 0; i < 256; i++) {
+            if (result(i) != reference_hist[i]) {
+                printf("With slices of %d rows, bin %d is %d instead of %d\n",
+                       slice_size, i, result(i), reference_hist[i]);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
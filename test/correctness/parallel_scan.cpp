@@ -0,0 +1,95 @@
+#include "Halide.h"
+#include <cmath>
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    // A prefix sum over a range that isn't a multiple of the block size,
+    // and doesn't start at zero.
+    {
+        const int min = 3, extent = 1000;
+        Func f("f");
+        f(x) = (x * 17) % 23 - 11;
+        Func scan = prefix_sum(f, 0, min, extent, 64);
+        Buffer<int> out(extent);
+        out.set_min(min);
+        scan.realize(out);
+
+        int correct = 0;
+        for (int i = min; i < min + extent; i++) {
+            correct += ((i * 17) % 23) - 11;
+            if (out(i) != correct) {
+                printf("prefix_sum(%d) = %d instead of %d\n", i, out(i), correct);
+                return 1;
+            }
+        }
+    }
+
+    // A first-order IIR filter down the columns of a narrow, tall image.
+    {
+        const int width = 4, height = 2000;
+        const float alpha = 0.1f;
+        Buffer<float> in(width, height);
+        in.for_each_element([&](int x, int y) {
+            in(x, y) = (float)((x * 7 + y * 13) % 17);
+        });
+
+        Func weighted("weighted");
+        weighted(x, y) = alpha * in(x, y);
+        Func blur = linear_recurrence(weighted, 1, 0, height, 1 - alpha, 128);
+        Buffer<float> out = blur.realize({width, height});
+
+        for (int x = 0; x < width; x++) {
+            float correct = 0;
+            for (int y = 0; y < height; y++) {
+                correct = (1 - alpha) * correct + alpha * in(x, y);
+                if (std::abs(out(x, y) - correct) > 1e-3f) {
+                    printf("blur(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // An integral image.
+    {
+        const int width = 300, height = 200;
+        Buffer<int> in(width, height);
+        in.for_each_element([&](int x, int y) {
+            in(x, y) = (x + y * 3) % 5;
+        });
+
+        Func input("input");
+        input(x, y) = in(x, y);
+        Func integral = prefix_sum(prefix_sum(input, 0, 0, width, 32), 1, 0, height, 32);
+        integral.compute_root().parallel(y);
+        Buffer<int> out = integral.realize({width, height});
+
+        Buffer<int> correct(width, height);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int c = in(x, y);
+                if (x > 0) {
+                    c += correct(x - 1, y);
+                }
+                if (y > 0) {
+                    c += correct(x, y - 1);
+                }
+                if (x > 0 && y > 0) {
+                    c -= correct(x - 1, y - 1);
+                }
+                correct(x, y) = c;
+                if (out(x, y) != c) {
+                    printf("integral(%d, %d) = %d instead of %d\n", x, y, out(x, y), c);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "Halide.h"
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class FindDoParallelTasks : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->name == "halide_do_parallel_tasks") {
+            const Call *list = op->args[2].as<Call>();
+            if (list && list->is_intrinsic(Call::make_struct)) {
+                tasks = list->args;
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    std::vector<Expr> tasks;
+};
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly does not support async() yet.\n");
+        return 0;
+    }
+
+    // A list of three tasks, where the second feeds the third through a
+    // semaphore, and the first is unrelated to both.
+    Expr sema = Variable::make(type_of<halide_semaphore_t *>(), "sema");
+    Stmt unrelated = Evaluate::make(Call::make(Int(32), "unrelated", {}, Call::Extern));
+    Stmt producer = Evaluate::make(Call::make(Int(32), "halide_semaphore_release", {sema, 1}, Call::Extern));
+    Stmt consumer = Acquire::make(sema, 1, Evaluate::make(Call::make(Int(32), "consumer", {}, Call::Extern)));
+    Stmt s = Fork::make(unrelated, Fork::make(producer, consumer));
+
+    std::vector<LoweredFunc> closures;
+    s = lower_parallel_tasks(s, closures, "parallel_task_hints", get_host_target());
+
+    FindDoParallelTasks finder;
+    s.accept(&finder);
+
+    // Each task is described by 11 fields, the last two of which are
+    // its priority and locality group.
+    const int fields = 11;
+    if (finder.tasks.size() != 3 * fields) {
+        printf("Expected a list of three tasks, got %d fields\n", (int)finder.tasks.size());
+        return 1;
+    }
+    int priority[3], group[3];
+    for (int i = 0; i < 3; i++) {
+        const int64_t *p = as_const_int(finder.tasks[i * fields + 9]);
+        const int64_t *g = as_const_int(finder.tasks[i * fields + 10]);
+        if (!p || !g) {
+            printf("Task %d has non-constant hints\n", i);
+            return 1;
+        }
+        priority[i] = (int)*p;
+        group[i] = (int)*g;
+    }
+
+    // The producer is on the critical path, and shares a locality group
+    // with its consumer.
+    if (priority[0] != 0 || priority[1] != 1 || priority[2] != 0) {
+        printf("Unexpected priorities %d %d %d\n", priority[0], priority[1], priority[2]);
+        return 1;
+    }
+    if (group[0] != 0 || group[1] == 0 || group[1] != group[2]) {
+        printf("Unexpected locality groups %d %d %d\n", group[0], group[1], group[2]);
+        return 1;
+    }
+
+    // Run an async pipeline through the thread pool, which uses the hints.
+    Func producer_f, consumer_f;
+    Var x, y;
+    producer_f(x, y) = x + y;
+    consumer_f(x, y) = producer_f(x - 1, y) + producer_f(x + 1, y);
+    producer_f.compute_at(consumer_f, y).async();
+    consumer_f.parallel(y, 4);
+    for (int i = 0; i < 10; i++) {
+        Buffer<int> out = consumer_f.realize({64, 64});
+        for (int yy = 0; yy < out.height(); yy++) {
+            for (int xx = 0; xx < out.width(); xx++) {
+                int correct = 2 * (xx + yy);
+                if (out(xx, yy) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
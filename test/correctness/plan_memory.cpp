@@ -0,0 +1,159 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int malloc_count = 0;
+size_t malloc_bytes = 0;
+
+void *my_malloc(JITUserContext *user_context, size_t x) {
+    malloc_count++;
+    malloc_bytes += x;
+    void *orig = malloc(x + 128);
+    void *ptr = (void *)((((size_t)orig + 128) >> 7) << 7);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(JITUserContext *user_context, void *ptr) {
+    free(((void **)ptr)[-1]);
+}
+
+int run(const Target &t) {
+    const int size = 1000;
+    const int stages = 5;
+
+    // A chain of stages, each of which only needs the one before it.
+    Var x;
+    std::vector<Func> f(stages);
+    f[0](x) = x;
+    for (int i = 1; i < stages; i++) {
+        f[i](x) = f[i - 1](x) * 2 + i;
+    }
+    Func out;
+    out(x) = f[stages - 1](x);
+    out.bound(x, 0, size);
+    for (int i = 0; i < stages; i++) {
+        f[i].compute_root().store_in(MemoryType::Heap);
+    }
+
+    out.jit_handlers().custom_malloc = my_malloc;
+    out.jit_handlers().custom_free = my_free;
+
+    malloc_count = 0;
+    malloc_bytes = 0;
+    Buffer<int> result = out.realize({size}, t);
+
+    for (int i = 0; i < size; i++) {
+        int correct = i;
+        for (int j = 1; j < stages; j++) {
+            correct = correct * 2 + j;
+        }
+        if (result(i) != correct) {
+            printf("result(%d) = %d instead of %d\n", i, result(i), correct);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// VTCM can only be planned for Hexagon, so check the lowered IR
+// directly rather than running anything.
+int check_vtcm_planning() {
+    using namespace Internal;
+
+    auto use = [](const std::string &name) {
+        return Store::make(name, 0, 0, Parameter(), const_true(), ModulusRemainder());
+    };
+
+    // In each iteration of a serial loop, c is used and then a and b are
+    // used one after the other. a and b can share memory, but c is live
+    // for the whole loop.
+    Stmt a = Allocate::make("a", Int(32), MemoryType::VTCM, {256}, const_true(), use("a"));
+    Stmt b = Allocate::make("b", Int(32), MemoryType::VTCM, {128}, const_true(), use("b"));
+    Stmt loop = For::make("i", 0, 10, ForType::Serial, DeviceAPI::None, Block::make({use("c"), a, b}));
+    Stmt s = Allocate::make("c", Int(32), MemoryType::VTCM, {64}, const_true(), loop);
+
+    Stmt planned = plan_memory(s, get_host_target(), MemoryType::VTCM);
+    const Allocate *arena = planned.as<Allocate>();
+    if (!arena || arena->memory_type != MemoryType::VTCM || arena->new_expr.defined()) {
+        printf("Expected the VTCM allocations to be placed in one VTCM arena:\n");
+        std::cout << planned;
+        return 1;
+    }
+    if (!is_const(arena->extents[0], 1024 + 256)) {
+        printf("Expected a VTCM arena of %d bytes, but got:\n", 1024 + 256);
+        std::cout << planned;
+        return 1;
+    }
+    return 0;
+}
+
+// The static workspace holds every heap allocation, including those in
+// serial loops, and comes from halide_static_workspace_malloc.
+int check_static_workspace_planning() {
+    using namespace Internal;
+
+    auto use = [](const std::string &name) {
+        return Store::make(name, 0, 0, Parameter(), const_true(), ModulusRemainder());
+    };
+
+    Stmt a = Allocate::make("a", Int(32), MemoryType::Heap, {256}, const_true(), use("a"));
+    Stmt b = Allocate::make("b", Int(32), MemoryType::Heap, {128}, const_true(), use("b"));
+    Stmt loop = For::make("i", 0, 10, ForType::Serial, DeviceAPI::None, Block::make({use("c"), a, b}));
+    Stmt s = Allocate::make("c", Int(32), MemoryType::Heap, {64}, const_true(), loop);
+
+    Stmt planned = plan_static_workspace(s, get_host_target(), "pipeline");
+    const Allocate *arena = planned.as<Allocate>();
+    const Call *call = arena ? arena->new_expr.as<Call>() : nullptr;
+    if (!call || call->name != "halide_static_workspace_malloc" ||
+        call->args.size() != 1 || !is_const(call->args[0], 1024 + 256)) {
+        printf("Expected the allocations to be placed in a static workspace of %d bytes:\n", 1024 + 256);
+        std::cout << planned;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (check_vtcm_planning()) {
+        return 1;
+    }
+
+    if (check_static_workspace_planning()) {
+        return 1;
+    }
+
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support custom allocators.\n");
+        return 0;
+    }
+
+    if (run(t)) {
+        return 1;
+    }
+    const int unplanned_count = malloc_count;
+    const size_t unplanned_bytes = malloc_bytes;
+
+    if (run(t.with_feature(Target::PlanMemory))) {
+        return 1;
+    }
+
+    // All five intermediates should come from one allocation, and as
+    // only two of them are ever live at once, that allocation should
+    // be a lot smaller than the five separate ones.
+    if (malloc_count != 1 || unplanned_count != 5) {
+        printf("Expected 1 allocation with planning and 5 without, got %d and %d\n",
+               malloc_count, unplanned_count);
+        return 1;
+    }
+    if (malloc_bytes * 2 > unplanned_bytes) {
+        printf("Planned arena is %d bytes, but the separate allocations total %d bytes\n",
+               (int)malloc_bytes, (int)unplanned_bytes);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // Some weights that the pipeline wants transposed and scaled.
+    Buffer<float> weights(16, 8);
+    weights.for_each_element([&](int x, int y) { weights(x, y) = (float)(x * 8 + y); });
+
+    Var x("x"), y("y");
+    Func packed("packed");
+    packed(y, x) = weights(x, y) * 0.5f;
+    Func prepacked = precompute(packed, {{0, 8}, {0, 16}});
+
+    Func out("out");
+    out(x, y) = prepacked(y, x) + 1.0f;
+
+    // The pipeline should read the precomputed weights from an
+    // embedded Buffer rather than computing packed.
+    Module m = out.compile_to_module({});
+    if (m.buffers().size() != 1 || m.buffers()[0].dimensions() != 2 ||
+        m.buffers()[0].dim(0).extent() != 8 || m.buffers()[0].dim(1).extent() != 16) {
+        printf("Expected the pipeline to embed exactly one 8x16 Buffer\n");
+        return 1;
+    }
+
+    Buffer<float> result = out.realize({16, 8});
+    for (int yy = 0; yy < 8; yy++) {
+        for (int xx = 0; xx < 16; xx++) {
+            float correct = weights(xx, yy) * 0.5f + 1.0f;
+            if (result(xx, yy) != correct) {
+                printf("result(%d, %d) = %f instead of %f\n", xx, yy, result(xx, yy), correct);
+                return 1;
+            }
+        }
+    }
+
+    // Tuple-valued Funcs are precomputed into one Buffer per element.
+    Func pair("pair");
+    pair(x) = Tuple(x * 2, cast<uint8_t>(x));
+    Func prepaired = precompute(pair, {{-4, 8}});
+    Func sum("sum");
+    sum(x) = prepaired(x)[0] + prepaired(x)[1];
+    Buffer<int> sums(8);
+    sums.set_min(-4);
+    sum.realize(sums);
+    for (int xx = -4; xx < 4; xx++) {
+        int correct = xx * 2 + (uint8_t)xx;
+        if (sums(xx) != correct) {
+            printf("sums(%d) = %d instead of %d\n", xx, sums(xx), correct);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -469,6 +469,45 @@ int test12(const Target &t) {
     return 0;
 }
 
+int test13(const Target &t) {
+    ImageParam in(Float(32), 2, "in");
+    Func f("f");
+    Var x("x"), y("y");
+
+    // A transpose strides through the input by a row per iteration of x,
+    // so it should get an automatic prefetch.
+    f(x, y) = in(y, x);
+
+    Module m = f.compile_to_module({in}, "", t.with_feature(Target::AutoPrefetch));
+    CollectPrefetches collect;
+    m.functions()[0].body.accept(&collect);
+
+    vector<vector<Expr>> expected = {{Variable::make(Handle(), in.name()), wild<int>(), 1, get_stride(t, 4)}};
+    if (!check(expected, collect.prefetches)) {
+        return 1;
+    }
+    return 0;
+}
+
+int test14(const Target &t) {
+    ImageParam in(Float(32), 2, "in");
+    Func f("f");
+    Var x("x"), y("y");
+
+    // Unit-stride loads are left to the hardware prefetchers.
+    f(x, y) = in(x, y) * 2.0f;
+
+    Module m = f.compile_to_module({in}, "", t.with_feature(Target::AutoPrefetch));
+    CollectPrefetches collect;
+    m.functions()[0].body.accept(&collect);
+
+    vector<vector<Expr>> expected;
+    if (!check(expected, collect.prefetches)) {
+        return 1;
+    }
+    return 0;
+}
+
 }  // anonymous namespace
 
 int main(int argc, char **argv) {
@@ -476,7 +515,7 @@ int main(int argc, char **argv) {
     std::cout << "Testing target: " << t << "\n";
 
     using Fn = int (*)(const Target &t);
-    std::vector<Fn> tests = {test1, test2, test3, test4, test5, test6, test7, test8, test9, test10, test11, test12};
+    std::vector<Fn> tests = {test1, test2, test3, test4, test5, test6, test7, test8, test9, test10, test11, test12, test13, test14};
 
     for (size_t i = 0; i < tests.size(); i++) {
         printf("Running prefetch test %d\n", (int)i + 1);
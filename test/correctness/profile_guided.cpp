@@ -0,0 +1,140 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <fstream>
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the loops with each name.
+class CountLoops : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const For *op) override {
+        loops[op->name]++;
+        return IRMutator::visit(op);
+    }
+
+public:
+    std::map<std::string, int> loops;
+};
+
+struct TestPipeline {
+    Func cheap, expensive, out;
+    Param<bool> p;
+
+    TestPipeline()
+        : cheap("cheap"), expensive("expensive"), out("out") {
+        Var x("x"), y("y"), xi("xi");
+        cheap(x, y) = x + y;
+        Expr e = cast<float>(cheap(x, y));
+        for (int i = 0; i < 50; i++) {
+            e = sin(e);
+        }
+        expensive(x, y) = e;
+        out(x, y) = expensive(x, y) + cheap(x, y);
+
+        cheap.compute_root().split(x, x, xi, 4).unroll(xi);
+        cheap.specialize(p).vectorize(x, 4);
+        expensive.compute_root().split(x, x, xi, 4).unroll(xi);
+    }
+
+    bool check(const Buffer<float> &result) {
+        for (int j = 0; j < result.height(); j++) {
+            for (int i = 0; i < result.width(); i++) {
+                float correct = i + j;
+                for (int k = 0; k < 50; k++) {
+                    correct = std::sin(correct);
+                }
+                correct += i + j;
+                if (std::abs(result(i, j) - correct) > 1e-4f) {
+                    printf("result(%d, %d) = %f instead of %f\n", i, j, result(i, j), correct);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("[SKIP] Windows does not have a working setenv\n");
+#else
+    Target target = get_jit_target_from_environment();
+    std::string profile = Internal::get_test_tmp_dir() + "profile_guided.txt";
+    setenv("HL_PROFILE_FILE", profile.c_str(), 1);
+
+    // The profiler writes the time spent in each Func to the file.
+    {
+        Internal::ensure_no_file_exists(profile);
+        TestPipeline pipeline;
+        pipeline.p.set(false);
+        Buffer<float> result = pipeline.out.realize({64, 64}, target.with_feature(Target::Profile));
+        if (!pipeline.check(result)) {
+            return 1;
+        }
+        Internal::assert_file_exists(profile);
+
+        std::ifstream file(profile);
+        std::string pipeline_name, func;
+        double time;
+        std::set<std::string> funcs;
+        while (file >> pipeline_name >> func >> time) {
+            if (pipeline_name != "out" || time < 0) {
+                printf("Unexpected line in profile: %s %s %f\n", pipeline_name.c_str(), func.c_str(), time);
+                return 1;
+            }
+            funcs.insert(func);
+        }
+        if (!funcs.count("cheap") || !funcs.count("expensive")) {
+            printf("The profile should have mentioned cheap and expensive\n");
+            return 1;
+        }
+    }
+
+    // With a profile that says cheap is cold, it isn't specialized or
+    // unrolled. The hot Func is left alone.
+    for (bool profile_guided : {false, true}) {
+        {
+            std::ofstream file(profile);
+            file << "out cheap 10\n"
+                 << "out expensive 10000\n"
+                 << "out out 100\n";
+        }
+
+        TestPipeline pipeline;
+        pipeline.p.set(true);
+        CountLoops counter;
+        pipeline.out.add_custom_lowering_pass(&counter, nullptr);
+        Target t = profile_guided ? target.with_feature(Target::ProfileGuided) : target;
+        Buffer<float> result = pipeline.out.realize({64, 64}, t);
+        if (!pipeline.check(result)) {
+            return 1;
+        }
+
+        int expected = profile_guided ? 1 : 0;
+        if (counter.loops["cheap.s0.x.xi"] != expected) {
+            printf("With profile_guided=%d, the inner loop of cheap appears %d times instead of %d\n",
+                   profile_guided, counter.loops["cheap.s0.x.xi"], expected);
+            return 1;
+        }
+        if (counter.loops.count("expensive.s0.x.xi")) {
+            printf("The inner loop of expensive should have been unrolled\n");
+            return 1;
+        }
+        // Without the profile, the specialization gives cheap a
+        // second copy of its loop nest.
+        expected = profile_guided ? 1 : 2;
+        if (counter.loops["cheap.s0.y"] != expected) {
+            printf("With profile_guided=%d, the outer loop of cheap appears %d times instead of %d\n",
+                   profile_guided, counter.loops["cheap.s0.y"], expected);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+#endif
+    return 0;
+}
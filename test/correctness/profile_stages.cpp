@@ -0,0 +1,92 @@
+#include "Halide.h"
+
+#include <set>
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Collect the strings in the lowered pipeline, which include the names
+// the profiler bills time under, and any stage markers left behind.
+class CollectNames : public IRMutator {
+    using IRMutator::visit;
+
+    Expr visit(const StringImm *op) override {
+        names.insert(op->value);
+        return op;
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->is_intrinsic(Call::profiler_stage_marker)) {
+            markers++;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    std::set<std::string> names;
+    int markers = 0;
+};
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+
+    for (bool profile_stages : {false, true}) {
+        Func f("f"), g("g");
+        Var x("x"), y("y");
+        Param<bool> p;
+        RDom r(0, 10);
+
+        g(x, y) = x + y;
+        f(x, y) = g(x, y);
+        f(x, y) += g(x, y + r);
+        f(x, y) *= 2;
+
+        g.compute_root();
+        f.specialize(p);
+        f.update(0).specialize(p).vectorize(x, 4);
+
+        CollectNames collector;
+        f.add_custom_lowering_pass(&collector, nullptr);
+
+        Target t = target.with_feature(Target::Profile);
+        if (profile_stages) {
+            t = t.with_feature(Target::ProfileStages);
+        }
+        p.set(true);
+        Buffer<int> result = f.realize({32, 32}, t);
+        for (int j = 0; j < result.height(); j++) {
+            for (int i = 0; i < result.width(); i++) {
+                int correct = i + j;
+                for (int k = 0; k < 10; k++) {
+                    correct += i + j + k;
+                }
+                correct *= 2;
+                if (result(i, j) != correct) {
+                    printf("result(%d, %d) = %d instead of %d\n", i, j, result(i, j), correct);
+                    return 1;
+                }
+            }
+        }
+
+        if (collector.markers) {
+            printf("%d stage markers were left in the pipeline\n", collector.markers);
+            return 1;
+        }
+        for (const char *name : {"f.update(0)", "f.update(1)",
+                                 "f.specialization(0)", "f.update(0).specialization(0)"}) {
+            if (collector.names.count(name) != (profile_stages ? 1 : 0)) {
+                printf("With profile_stages=%d, %s %s billed separately\n",
+                       profile_stages, name, profile_stages ? "should be" : "should not be");
+                return 1;
+            }
+        }
+        if (!collector.names.count("f") || !collector.names.count("g")) {
+            printf("f and g should always be billed\n");
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
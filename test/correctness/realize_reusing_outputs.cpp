@@ -0,0 +1,57 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Param<int> offset;
+    Var x("x"), y("y");
+    Func f("f");
+    f(x, y) = Tuple(x + y * 100 + offset, cast<float>(x - y));
+    // With ShiftInwards, the bounds query asks for outputs rounded up to
+    // a multiple of the vector size, so the results are cropped.
+    f.vectorize(x, 8, TailStrategy::ShiftInwards);
+
+    Pipeline p(f);
+
+    auto check = [&](const Realization &r, int w, int h, int k) {
+        Buffer<int> a = r[0];
+        Buffer<float> b = r[1];
+        if (a.width() != w || a.height() != h || b.width() != w || b.height() != h) {
+            printf("Wrong output size: %d x %d\n", a.width(), a.height());
+            exit(1);
+        }
+        for (int j = 0; j < h; j++) {
+            for (int i = 0; i < w; i++) {
+                if (a(i, j) != i + j * 100 + k || b(i, j) != (float)(i - j)) {
+                    printf("result(%d, %d) = {%d, %f} instead of {%d, %f}\n",
+                           i, j, a(i, j), b(i, j), i + j * 100 + k, (float)(i - j));
+                    exit(1);
+                }
+            }
+        }
+    };
+
+    const void *host = nullptr;
+    for (int k = 0; k < 5; k++) {
+        offset.set(k);
+        const Realization &r = p.realize_reusing_outputs({13, 7});
+        check(r, 13, 7, k);
+        // The outputs of the first call are reused by the others.
+        if (k == 0) {
+            host = r[0].data();
+        } else if (r[0].data() != host) {
+            printf("Outputs were reallocated for the same sizes\n");
+            return 1;
+        }
+    }
+
+    // Other sizes get new outputs, and realize() is not affected.
+    offset.set(3);
+    check(p.realize_reusing_outputs({20, 3}), 20, 3, 3);
+    check(p.realize({13, 7}), 13, 7, 3);
+    check(p.realize_reusing_outputs({13, 7}), 13, 7, 3);
+
+    printf("Success!\n");
+    return 0;
+}
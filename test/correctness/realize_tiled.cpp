@@ -0,0 +1,75 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 100, H = 80;
+
+    ImageParam input(UInt(16), 2, "input");
+    Var x("x"), y("y");
+    Func blur("blur");
+    blur(x, y) = input(x - 1, y) + input(x + 1, y) + input(x, y - 1) + input(x, y + 1);
+    blur.vectorize(x, 8, TailStrategy::GuardWithIf);
+
+    auto value = [](int x, int y) { return (uint16_t)(x * 3 + y * 7 + 1000); };
+
+    for (bool prefetch : {false, true}) {
+        int tiles = 0;
+        std::atomic<int> inputs_provided{0};
+        Buffer<uint16_t> result(W, H);
+        result.fill(0);
+
+        Pipeline p(blur);
+        p.realize_tiled(
+            {W, H}, {32, 32},
+            [&](const std::string &name, Buffer<> &region) {
+                if (name != input.name()) {
+                    printf("Asked for unexpected input %s\n", name.c_str());
+                    exit(1);
+                }
+                // Each tile needs a one pixel border of the input.
+                if (region.dim(0).extent() > 34 || region.dim(1).extent() > 34) {
+                    printf("Input region is larger than a tile\n");
+                    exit(1);
+                }
+                Buffer<uint16_t> b = region;
+                b.for_each_element([&](int x, int y) { b(x, y) = value(x, y); });
+                inputs_provided++;
+            },
+            [&](const Realization &tile) {
+                Buffer<uint16_t> b = tile[0];
+                if (b.dim(0).extent() > 32 || b.dim(1).extent() > 32) {
+                    printf("Output tile is larger than requested\n");
+                    exit(1);
+                }
+                b.for_each_element([&](int x, int y) { result(x, y) = b(x, y); });
+                tiles++;
+            },
+            prefetch);
+
+        // 4 x 3 tiles, the last in each dimension being partial.
+        if (tiles != 12 || inputs_provided != 12) {
+            printf("Expected 12 tiles, got %d outputs and %d inputs\n", tiles, (int)inputs_provided);
+            return 1;
+        }
+        if (input.get().defined()) {
+            printf("realize_tiled() left the input bound\n");
+            return 1;
+        }
+
+        for (int j = 0; j < H; j++) {
+            for (int i = 0; i < W; i++) {
+                uint16_t correct = value(i - 1, j) + value(i + 1, j) + value(i, j - 1) + value(i, j + 1);
+                if (result(i, j) != correct) {
+                    printf("result(%d, %d) = %d instead of %d\n", i, j, result(i, j), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the allocations of partial results kept across the serial loop.
+class CountPartials : public IRMutator {
+    std::string func;
+    int correct;
+
+    class Counter : public IRVisitor {
+        using IRVisitor::visit;
+        void visit(const Allocate *op) override {
+            if (starts_with(op->name, func + "_partial")) {
+                count++;
+            }
+            IRVisitor::visit(op);
+        }
+
+    public:
+        const std::string &func;
+        int count = 0;
+        Counter(const std::string &f)
+            : func(f) {
+        }
+    };
+
+public:
+    CountPartials(const std::string &f, int c)
+        : func(f), correct(c) {
+    }
+    using IRMutator::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        Counter c(func);
+        s.accept(&c);
+        if (c.count != correct) {
+            printf("There were %d partial results for %s instead of %d\n",
+                   c.count, func.c_str(), correct);
+            exit(1);
+        }
+        return s;
+    }
+};
+
+template<typename T>
+int check_sum(int size, bool reassociate) {
+    Buffer<T> input(size, 4);
+    input.for_each_element([&](int x, int y) { input(x, y) = (T)((x * 7 + y * 3) % 17); });
+
+    Func sum("sum");
+    Var y("y");
+    RDom r(0, size);
+    RVar ro("ro"), ri("ri");
+    sum(y) = cast<T>(0);
+    sum(y) += input(r, y);
+
+    sum.update().split(r, ro, ri, 8);
+    if (reassociate) {
+        sum.update().allow_reassociation().vectorize(ri);
+    }
+
+    // The partial sums are only kept when the split is exact, and when
+    // the stage allows reassociation.
+    sum.add_custom_lowering_pass(new CountPartials(sum.name(), (reassociate && size % 8 == 0) ? 1 : 0));
+
+    Buffer<T> result = sum.realize({4});
+    for (int yy = 0; yy < 4; yy++) {
+        T correct = 0;
+        for (int xx = 0; xx < size; xx++) {
+            correct += input(xx, yy);
+        }
+        if (result(yy) != correct) {
+            printf("sum(%d) = %f instead of %f\n", yy, (double)result(yy), (double)correct);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    // The inputs are small integers, so the float sums are exact in
+    // any order.
+    if (check_sum<float>(64, false) ||
+        check_sum<float>(64, true) ||
+        check_sum<float>(61, true) ||
+        check_sum<int>(128, true) ||
+        check_sum<double>(32, true)) {
+        return 1;
+    }
+
+    // The stage is exempt from strict float.
+    {
+        Func sum("strict_sum");
+        RDom r(0, 64);
+        RVar ro("ro"), ri("ri");
+        Buffer<float> input(64);
+        input.for_each_value([](float &v) { v = 1.5f; });
+        sum() = 0.0f;
+        sum() += input(r);
+        sum.update().split(r, ro, ri, 8).allow_reassociation().vectorize(ri);
+        sum.add_custom_lowering_pass(new CountPartials(sum.name(), 1));
+        Buffer<float> result = sum.realize({}, get_jit_target_from_environment().with_feature(Target::StrictFloat));
+        if (result() != 96.0f) {
+            printf("strict_sum() = %f instead of 96\n", result());
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Compute g per row of f, with its storage ring-buffered at the root, so
+// that the producer of g can run ahead of f by a number of rows.
+int check_rows(Expr buffers, const std::string &name) {
+    Func f("f"), g("g");
+    Var x("x"), y("y");
+
+    g(x, y) = x * 3 + y;
+    f(x, y) = g(x, y) + g(x + 1, y + 1);
+
+    g.compute_at(f, y).hoist_storage_root().ring_buffer(buffers).async();
+
+    Buffer<int> out = f.realize({70, 50});
+    for (int yy = 0; yy < out.height(); yy++) {
+        for (int xx = 0; xx < out.width(); xx++) {
+            int correct = (xx * 3 + yy) + ((xx + 1) * 3 + yy + 1);
+            if (out(xx, yy) != correct) {
+                printf("%s: out(%d, %d) = %d instead of %d\n",
+                       name.c_str(), xx, yy, out(xx, yy), correct);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Compute g in tiles of f, where the tiles at the edges are smaller, so
+// the slots are sized for the largest tile.
+int check_tiles() {
+    Func f("f"), g("g");
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi");
+
+    g(x, y) = x * 5 - y;
+    f(x, y) = g(x, y) * g(x + 2, y + 1);
+
+    f.tile(x, y, xo, yo, xi, yi, 16, 16, TailStrategy::GuardWithIf);
+    g.compute_at(f, xo).hoist_storage(f, yo).ring_buffer(3).async();
+
+    Buffer<int> out = f.realize({70, 50});
+    for (int yy = 0; yy < out.height(); yy++) {
+        for (int xx = 0; xx < out.width(); xx++) {
+            int correct = (xx * 5 - yy) * ((xx + 2) * 5 - (yy + 1));
+            if (out(xx, yy) != correct) {
+                printf("tiles: out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), correct);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly does not support async() yet.\n");
+        return 0;
+    }
+
+    if (check_rows(1, "single") ||
+        check_rows(2, "double") ||
+        check_rows(3, "triple")) {
+        return 1;
+    }
+
+    Param<int> buffers;
+    buffers.set(4);
+    if (check_rows(buffers, "param") ||
+        check_tiles()) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
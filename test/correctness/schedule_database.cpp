@@ -0,0 +1,140 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdlib>
+#include <filesystem>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+namespace {
+
+int call_count = 0;
+
+void simple_autoscheduler(const Pipeline &p,
+                          const Target &,
+                          const AutoschedulerParams &,
+                          AutoSchedulerResults *results) {
+    call_count++;
+    Func out = p.outputs()[0];
+    Func producer(find_transitive_calls(out.function()).at("producer"));
+    Var x("x"), y("y"), xi("xi");
+    out.split(x, x, xi, 8).vectorize(xi).parallel(y);
+    producer.compute_at(out, y);
+    results->schedule_source = "out.split(x, x, xi, 8).vectorize(xi).parallel(y);\n"
+                               "producer.compute_at(out, y);\n";
+}
+
+Pipeline make_pipeline(int scale) {
+    // Use the same names every time, so that identical pipelines get the
+    // same database key.
+    Func producer("producer"), out("out");
+    Var x("x"), y("y");
+    producer(x, y) = x * scale + y;
+    out(x, y) = producer(x, y) + producer(x + 1, y);
+    out.set_estimates({{0, 64}, {0, 64}});
+    return Pipeline(out);
+}
+
+int count_entries(const std::string &dir) {
+    int count = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.path().extension() == ".schedule") {
+            count++;
+        }
+    }
+    return count;
+}
+
+int check(Pipeline p, int scale) {
+    Buffer<int> buf = p.realize({64, 64});
+    for (int y = 0; y < buf.height(); y++) {
+        for (int x = 0; x < buf.width(); x++) {
+            int correct = (x * scale + y) + ((x + 1) * scale + y);
+            if (buf(x, y) != correct) {
+                printf("buf(%d, %d) = %d instead of %d\n", x, y, buf(x, y), correct);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("[SKIP] Windows does not have a working setenv\n");
+    return 0;
+#else
+    std::string dir = get_test_tmp_dir() + "schedule_database";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    setenv("HL_SCHEDULE_DATABASE_DIR", dir.c_str(), 1);
+
+    Pipeline::add_autoscheduler("simple", simple_autoscheduler);
+    Target target = get_jit_target_from_environment();
+    AutoschedulerParams params("simple");
+
+    AutoSchedulerResults first;
+    {
+        Pipeline p = make_pipeline(3);
+        first = p.apply_autoscheduler(target, params);
+        if (check(p, 3)) {
+            return 1;
+        }
+    }
+    if (call_count != 1 || count_entries(dir) != 1) {
+        printf("Expected one call and one entry, got %d calls and %d entries\n",
+               call_count, count_entries(dir));
+        return 1;
+    }
+
+    // An identical pipeline should get the stored schedule without
+    // calling the autoscheduler.
+    {
+        Pipeline p = make_pipeline(3);
+        AutoSchedulerResults second = p.apply_autoscheduler(target, params);
+        if (call_count != 1) {
+            printf("The autoscheduler should not have been called again\n");
+            return 1;
+        }
+        if (second.schedule_source != first.schedule_source) {
+            printf("Stored schedule source differs:\n%s\nvs\n%s\n",
+                   second.schedule_source.c_str(), first.schedule_source.c_str());
+            return 1;
+        }
+        bool vectorized = false;
+        for (const Dim &d : p.outputs()[0].function().definition().schedule().dims()) {
+            vectorized |= d.var == "x.xi" && d.for_type == ForType::Vectorized;
+        }
+        if (!vectorized) {
+            printf("The stored schedule was not applied\n");
+            return 1;
+        }
+        if (check(p, 3)) {
+            return 1;
+        }
+    }
+
+    // Changing the algorithm should invalidate the stored schedule.
+    {
+        Pipeline p = make_pipeline(5);
+        p.apply_autoscheduler(target, params);
+        if (call_count != 2 || count_entries(dir) != 2) {
+            printf("Expected two calls and two entries, got %d calls and %d entries\n",
+                   call_count, count_entries(dir));
+            return 1;
+        }
+        if (check(p, 5)) {
+            return 1;
+        }
+    }
+
+    unsetenv("HL_SCHEDULE_DATABASE_DIR");
+    std::filesystem::remove_all(dir);
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
@@ -2,6 +2,7 @@
 #define SIMD_OP_CHECK_H
 
 #include "Halide.h"
+#include "halide_benchmark.h"
 #include "halide_test_dirs.h"
 #include "test_sharding.h"
 
@@ -12,6 +13,10 @@ namespace Halide {
 struct TestResult {
     std::string op;
     std::string error_msg;
+    // Only set in benchmark mode: the best time in seconds to compute
+    // the vectorized and scalar versions over the benchmark buffer.
+    double vector_time = 0, scalar_time = 0;
+    int64_t elements = 0;
 };
 
 struct Task {
@@ -32,6 +37,13 @@ public:
 
     std::string filter{"*"};
     std::string output_directory{Internal::get_test_tmp_dir()};
+    // In benchmark mode (HL_SIMD_OP_CHECK_BENCHMARK=1), each pattern that
+    // can be run is also timed over a buffer of about this many elements,
+    // vectorized and scalar, so that a pattern that generates the
+    // expected instruction but is slowed down by the code around it
+    // shows up.
+    bool benchmark = false;
+    int64_t benchmark_elements = 1 << 22;
     std::vector<Task> tasks;
     std::mt19937 rng;
 
@@ -83,8 +95,10 @@ public:
         // A bunch of feature flags also need to match between the
         // compiled code and the host in order to run the code.
         for (Target::Feature f : {
+                 Target::ARMBf16,
                  Target::ARMDotProd,
                  Target::ARMFp16,
+                 Target::ARMI8mm,
                  Target::ARMv7s,
                  Target::ARMv81a,
                  Target::AVX,
@@ -257,32 +271,7 @@ public:
             Target run_target = get_run_target();
 
             error.infer_input_bounds({}, run_target);
-            // Fill the inputs with noise
-            for (auto p : image_params) {
-                Halide::Buffer<> buf = p.get();
-                if (!buf.defined()) continue;
-                assert(buf.data());
-                Type t = buf.type();
-                // For floats/doubles, we only use values that aren't
-                // subject to rounding error that may differ between
-                // vectorized and non-vectorized versions
-                if (t == Float(32)) {
-                    buf.as<float>().for_each_value([&](float &f) { f = (rng() & 0xfff) / 8.0f - 0xff; });
-                } else if (t == Float(64)) {
-                    buf.as<double>().for_each_value([&](double &f) { f = (rng() & 0xfff) / 8.0 - 0xff; });
-                } else if (t == Float(16)) {
-                    buf.as<float16_t>().for_each_value([&](float16_t &f) { f = float16_t((rng() & 0xff) / 8.0f - 0xf); });
-                } else {
-                    // Random bits is fine
-                    for (uint32_t *ptr = (uint32_t *)buf.data();
-                         ptr != (uint32_t *)buf.data() + buf.size_in_bytes() / 4;
-                         ptr++) {
-                        // Never use the top four bits, to avoid
-                        // signed integer overflow.
-                        *ptr = ((uint32_t)rng()) & 0x0fffffff;
-                    }
-                }
-            }
+            fill_inputs();
             Realization r = error.realize();
             double e = Buffer<double>(r[0])();
             // Use a very loose tolerance for floating point tests. The
@@ -308,7 +297,59 @@ public:
             }
         }
 
-        return {op, error_msg.str()};
+        TestResult result{op, error_msg.str()};
+        if (benchmark && can_run_the_code && error_msg.str().empty()) {
+            benchmark_one(f, f_scalar, &result);
+        }
+        return result;
+    }
+
+    // Fill the inputs with noise
+    void fill_inputs() {
+        for (auto p : image_params) {
+            Halide::Buffer<> buf = p.get();
+            if (!buf.defined()) continue;
+            assert(buf.data());
+            Type t = buf.type();
+            // For floats/doubles, we only use values that aren't
+            // subject to rounding error that may differ between
+            // vectorized and non-vectorized versions
+            if (t == Float(32)) {
+                buf.as<float>().for_each_value([&](float &f) { f = (rng() & 0xfff) / 8.0f - 0xff; });
+            } else if (t == Float(64)) {
+                buf.as<double>().for_each_value([&](double &f) { f = (rng() & 0xfff) / 8.0 - 0xff; });
+            } else if (t == Float(16)) {
+                buf.as<float16_t>().for_each_value([&](float16_t &f) { f = float16_t((rng() & 0xff) / 8.0f - 0xf); });
+            } else {
+                // Random bits is fine
+                for (uint32_t *ptr = (uint32_t *)buf.data();
+                     ptr != (uint32_t *)buf.data() + buf.size_in_bytes() / 4;
+                     ptr++) {
+                    // Never use the top four bits, to avoid
+                    // signed integer overflow.
+                    *ptr = ((uint32_t)rng()) & 0x0fffffff;
+                }
+            }
+        }
+    }
+
+    // Time the vectorized and scalar versions of a pattern over many
+    // rows of width W.
+    void benchmark_one(Func f, Func f_scalar, TestResult *result) {
+        const int rows = (int)std::max<int64_t>(H, benchmark_elements / W);
+        Buffer<> out(f.type(), W, rows);
+        Target run_target = get_run_target();
+
+        setup_images();
+        Pipeline vector_pipeline(f), scalar_pipeline(f_scalar);
+        vector_pipeline.infer_input_bounds(out, run_target);
+        fill_inputs();
+        vector_pipeline.compile_jit(run_target);
+        scalar_pipeline.compile_jit(run_target);
+
+        result->elements = (int64_t)W * rows;
+        result->vector_time = Tools::benchmark([&]() { vector_pipeline.realize(out, run_target); });
+        result->scalar_time = Tools::benchmark([&]() { scalar_pipeline.realize(out, run_target); });
     }
 
     void check(std::string op, int vector_width, Expr e) {
@@ -348,19 +389,39 @@ public:
 
         Sharder sharder;
         bool success = true;
+        std::vector<std::string> slower_than_scalar;
         for (size_t t = 0; t < tasks.size(); t++) {
             if (!sharder.should_run(t)) continue;
             const auto &task = tasks.at(t);
             auto result = check_one(task.op, task.name, task.vector_width, task.expr);
             constexpr int tabstop = 32;
             const int spaces = std::max(1, tabstop - (int)result.op.size());
-            std::cout << result.op << std::string(spaces, ' ') << "(" << run_target_str << ")\n";
+            std::cout << result.op << std::string(spaces, ' ') << "(" << run_target_str << ")";
+            if (result.vector_time > 0) {
+                const double speedup = result.scalar_time / result.vector_time;
+                std::cout << " " << result.elements / result.vector_time * 1e-9 << " Gelem/s, "
+                          << speedup << "x vs scalar";
+                if (speedup < 1) {
+                    std::cout << " (SLOWER THAN SCALAR)";
+                    slower_than_scalar.push_back(result.op);
+                }
+            }
+            std::cout << "\n";
             if (!result.error_msg.empty()) {
                 std::cerr << result.error_msg;
                 success = false;
             }
         }
 
+        if (!slower_than_scalar.empty()) {
+            std::cout << "Warning: " << slower_than_scalar.size()
+                      << " pattern(s) ran slower than the scalar version on " << run_target_str << ":";
+            for (const auto &op : slower_than_scalar) {
+                std::cout << " " << op;
+            }
+            std::cout << "\n";
+        }
+
         return success;
     }
 
@@ -392,6 +453,10 @@ public:
                 test.filter = getenv("HL_SIMD_OP_CHECK_FILTER");
             }
 
+            if (const char *bench = getenv("HL_SIMD_OP_CHECK_BENCHMARK")) {
+                test.benchmark = atoi(bench) != 0;
+            }
+
             test.set_seed(seed);
 
             if (argc > 2) {
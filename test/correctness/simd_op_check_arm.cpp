@@ -640,6 +640,31 @@ public:
                     }
                 }
             }
+
+            // SMMLA/UMMLA/USMMLA/BFMMLA
+            // These compute 2x2 tiles of a matrix product, with lanes
+            // (x / 2, x % 2) of a vector over x.
+            if (!arm32 && target.has_feature(Target::ARMI8mm)) {
+                for (int f : {8, 16}) {
+                    RDom r(0, f);
+                    Expr row = f * (x / 2) + r, col = f * (x % 2) + r + 32;
+                    for (int v : {4, 8}) {
+                        check("smmla", v, sum(i32(in_i8(row)) * in_i8(col)));
+                        check("ummla", v, sum(u32(in_u8(row)) * in_u8(col)));
+                        check("usmmla", v, sum(i32(in_u8(row)) * in_i8(col)));
+                        check("usmmla", v, sum(i32(in_i8(row)) * in_u8(col)));
+                    }
+                }
+            }
+            if (!arm32 && target.has_feature(Target::ARMBf16)) {
+                for (int f : {4, 8}) {
+                    RDom r(0, f);
+                    Expr row = f * (x / 2) + r, col = f * (x % 2) + r + 32;
+                    for (int v : {4, 8}) {
+                        check("bfmmla", v, sum(f32(in_bf16(row)) * in_bf16(col)));
+                    }
+                }
+            }
             // VPOP     X       F, D    Pop from Stack
             // VPUSH    X       F, D    Push to Stack
             // Not used by us
@@ -1122,5 +1147,6 @@ int main(int argc, char **argv) {
             Target("arm-32-linux"),
             Target("arm-64-linux"),
             Target("arm-64-linux-arm_dot_prod"),
+            Target("arm-64-linux-arm_i8mm-arm_bf16"),
         });
 }
@@ -37,7 +37,45 @@ public:
         Expr u64_1 = in_u64(x), u64_2 = in_u64(x + 16), u64_3 = in_u64(x + 32);
         Expr bool_1 = (f32_1 > 0.3f), bool_2 = (f32_1 < -0.3f), bool_3 = (f32_1 != -0.34f);
 
-        check("vmseq.vv", target.natural_vector_size<uint8_t>(), select(u8_1 == u8_2, u8(1), u8(2)));
+        int vu8 = target.natural_vector_size<uint8_t>();
+        int vu16 = target.natural_vector_size<uint16_t>();
+
+        check("vmseq.vv", vu8, select(u8_1 == u8_2, u8(1), u8(2)));
+
+        // Averaging
+        check("vaaddu.vv", vu8, u8((u16(u8_1) + u16(u8_2)) / 2));
+        check("vaadd.vv", vu8, i8((i16(i8_1) + i16(i8_2) + 1) / 2));
+        check("vasubu.vv", vu8, u8((i16(u8_1) - i16(u8_2)) / 2));
+        check("vasub.vv", vu8, i8((i16(i8_1) - i16(i8_2)) / 2));
+
+        // Saturating arithmetic
+        check("vsaddu.vv", vu8, u8_sat(u16(u8_1) + u16(u8_2)));
+        check("vsadd.vv", vu8, i8_sat(i16(i8_1) + i16(i8_2)));
+        check("vssubu.vv", vu8, u8(max(i16(u8_1) - i16(u8_2), 0)));
+        check("vssub.vv", vu16, i16_sat(i32(i16_1) - i32(i16_2)));
+
+        // Widening arithmetic
+        check("vwaddu.vv", vu8, u16(u8_1) + u16(u8_2));
+        check("vwaddu.wv", vu16, u16_1 + u16(u8_1));
+        check("vwsub.wv", vu16, i16_1 - i16(i8_1));
+        check("vwmul.vv", vu8, i16(i8_1) * i16(i8_2));
+        check("vwmaccu.vv", vu16, u16_1 + u16(u8_1) * u16(u8_2));
+        check("vwmacc.vv", vu16, i16_1 + i16(i8_1) * i16(i8_2));
+        check("vwmaccsu.vv", vu16, i16_1 + i16(i8_1) * i16(u8_1));
+
+        // Rounding shifts
+        check("vssrl", vu16, u16((u32(u16_1) + 8) >> 4));
+        check("vssra", vu16, i16((i32(i16_1) + 8) >> 4));
+
+        // Saturating narrowing, with and without a (rounding) shift
+        check("vnclipu", vu16, u8_sat(u16_1));
+        check("vnclip", vu16, i8_sat(i16_1));
+        check("vnclipu", vu16, u8_sat(u16_1 >> 4));
+        check("vnclip", vu16, i8_sat((i16_1 + 8) >> 4));
+
+        // Strided loads, e.g. a channel of interleaved data
+        check("vlse8.v", vu8, in_u8(3 * x));
+        check("vlse16.v", vu16, in_u16(4 * x));
     }
 
 private:
@@ -0,0 +1,66 @@
+#include "simd_op_check.h"
+
+#include "Halide.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+using namespace Halide::ConciseCasts;
+
+namespace {
+
+class SimdOpCheckSVE2 : public SimdOpCheckTest {
+public:
+    SimdOpCheckSVE2(Target t, int w = 768, int h = 128)
+        : SimdOpCheckTest(t, w, h) {
+    }
+
+    void add_tests() override {
+        if (target.arch == Target::ARM &&
+            target.bits == 64 &&
+            target.has_feature(Target::SVE2)) {
+            check_sve_all();
+        }
+    }
+
+    void check_sve_all() {
+        Expr f32_1 = in_f32(x), f32_2 = in_f32(x + 16);
+        Expr i32_1 = in_i32(x), i32_2 = in_i32(x + 16);
+        Expr u8_1 = in_u8(x), u8_2 = in_u8(x + 16);
+
+        int vf32 = target.natural_vector_size<float>();
+        int vi32 = target.natural_vector_size<int32_t>();
+        int vu8 = target.natural_vector_size<uint8_t>();
+
+        // Arithmetic on whole scalable vectors
+        check("fadd", vf32, f32_1 + f32_2);
+        check("add", vi32, i32_1 + i32_2);
+        check("umax", vu8, max(u8_1, u8_2));
+
+        // Data-dependent loads are gathers
+        check("ld1w", vf32, in_f32(clamp(i32_1, 0, 127)));
+        check("ld1w", vi32, in_i32(clamp(i32_1, 0, 127)));
+
+        // Strided loads are gathers too
+        check("ld1w", vf32, in_f32(3 * x));
+    }
+
+private:
+    const Var x{"x"}, y{"y"};
+};
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (Halide::Internal::get_llvm_version() < 160) {
+        std::cout << "[SKIP] simd_op_check_sve2 requires LLVM 16 or later.\n";
+        return 0;
+    }
+    return SimdOpCheckTest::main<SimdOpCheckSVE2>(
+        argc, argv,
+        {
+            Target("arm-64-linux-sve2-vector_bits_128"),
+            Target("arm-64-linux-sve2-vector_bits_256"),
+        });
+}
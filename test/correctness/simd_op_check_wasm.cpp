@@ -18,6 +18,7 @@ public:
         use_wasm_simd128 = target.has_feature(Target::WasmSimd128);
         use_wasm_sat_float_to_int = target.has_feature(Target::WasmSatFloatToInt);
         use_wasm_sign_ext = target.has_feature(Target::WasmSignExt);
+        use_wasm_relaxed_simd = target.has_feature(Target::WasmRelaxedSimd);
     }
 
     void add_tests() override {
@@ -488,8 +489,11 @@ public:
                 check("f64x2.convert_low_i32x4_u", 2 * w, cast<double>(u32_1));
 
                 // Single-precision floating point to integer with saturation
-                check("i32x4.trunc_sat_f32x4_s", 4 * w, cast<int32_t>(f32_1));
-                check("i32x4.trunc_sat_f32x4_u", 4 * w, cast<uint32_t>(f32_1));
+                // (relaxed SIMD uses the non-saturating versions instead)
+                if (!use_wasm_relaxed_simd) {
+                    check("i32x4.trunc_sat_f32x4_s", 4 * w, cast<int32_t>(f32_1));
+                    check("i32x4.trunc_sat_f32x4_u", 4 * w, cast<uint32_t>(f32_1));
+                }
 
                 // Double-precision floating point to integer with saturation
                 // TODO(https://github.com/halide/Halide/issues/5130): NOT BEING GENERATED AT TRUNK
@@ -528,6 +532,30 @@ public:
                 check("i64x2.extend_low_i32x4_u", 4 * w, u64(u32_1));
                 check("i64x2.extend_high_i32x4_u", 4 * w, u64(u32_1));
             }
+
+            if (use_wasm_relaxed_simd && Halide::Internal::get_llvm_version() >= 160) {
+                for (int w = 1; w <= 4; w <<= 1) {
+                    check("f32x4.relaxed_madd", 4 * w, f32_1 * f32_2 + f32_3);
+                    check("f64x2.relaxed_madd", 2 * w, f64_1 * f64_2 + f64_3);
+                    check("f32x4.relaxed_nmadd", 4 * w, f32_3 - f32_1 * f32_2);
+                    check("f64x2.relaxed_nmadd", 2 * w, f64_3 - f64_1 * f64_2);
+
+                    check("i32x4.relaxed_trunc_f32x4_s", 4 * w, i32(f32_1));
+                    check("i32x4.relaxed_trunc_f32x4_u", 4 * w, u32(f32_1));
+
+                    // Integer dot products (8 -> 16 and 8 -> 32), where one
+                    // operand is known to fit in 7 bits.
+                    for (int f : {2, 4}) {
+                        RDom r(0, f);
+                        check("i16x8.relaxed_dot_i8x16_i7x16_s", 8 * w, sum(i16(in_i8(f * x + r)) * (in_u8(f * x + r + 32) / 2)));
+                    }
+                    for (int f : {4, 8}) {
+                        RDom r(0, f);
+                        check("i32x4.relaxed_dot_i8x16_i7x16_add_s", 4 * w, sum(i32(in_i8(f * x + r)) * (in_u8(f * x + r + 32) / 2)));
+                        check("i32x4.relaxed_dot_i8x16_i7x16_add_s", 4 * w, sum(i32(in_i8(f * x + r)) * (in_i8(f * x + r + 32) & 0x7f)));
+                    }
+                }
+            }
         }
     }
 
@@ -535,6 +563,7 @@ private:
     bool use_wasm_simd128{false};
     bool use_wasm_sat_float_to_int{false};
     bool use_wasm_sign_ext{false};
+    bool use_wasm_relaxed_simd{false};
     const Var x{"x"}, y{"y"};
 };
 }  // namespace
@@ -545,5 +574,6 @@ int main(int argc, char **argv) {
         {
             Target("wasm-32-wasmrt"),
             Target("wasm-32-wasmrt-wasm_simd128-wasm_sat_float_to_int"),
+            Target("wasm-32-wasmrt-wasm_simd128-wasm_sat_float_to_int-wasm_relaxed_simd"),
         });
 }
@@ -45,6 +45,7 @@ public:
     void check_sse_and_avx() {
         Expr f64_1 = in_f64(x), f64_2 = in_f64(x + 16), f64_3 = in_f64(x + 32);
         Expr f32_1 = in_f32(x), f32_2 = in_f32(x + 16), f32_3 = in_f32(x + 32);
+        Expr f16_1 = in_f16(x), f16_2 = in_f16(x + 16), f16_3 = in_f16(x + 32);
         Expr i8_1 = in_i8(x), i8_2 = in_i8(x + 16), i8_3 = in_i8(x + 32);
         Expr u8_1 = in_u8(x), u8_2 = in_u8(x + 16), u8_3 = in_u8(x + 32);
         Expr i16_1 = in_i16(x), i16_2 = in_i16(x + 16), i16_3 = in_i16(x + 32);
@@ -142,6 +143,9 @@ public:
             check("pavgb", 8 * w, u8((u16(u8_1) + u16(u8_2) + 1) >> 1));
             check("pavgw", 4 * w, u16((u32(u16_1) + u32(u16_2) + 1) / 2));
             check("pavgw", 4 * w, u16((u32(u16_1) + u32(u16_2) + 1) >> 1));
+            // The same average written in 32 bits is narrowed to 16
+            // bits before intrinsics are found.
+            check("pavgb", 8 * w, u8((i32(u8_1) + i32(u8_2) + 1) / 2));
 
             // Rounding right shifts, halving subtracts, and signed rounding
             // averages should also use pavg
@@ -551,6 +555,18 @@ public:
             }
         }
 
+        if (use_avx2) {
+            // Lookups at data-dependent addresses
+            Expr idx = in_i32(x) & 63;
+            check("vpgather*", 8, in_i32(idx));
+            check("vgather*ps", 8, in_f32(idx));
+            check("vgather*pd", 4, in_f64(idx));
+            if (use_avx512) {
+                check("vpgather*zmm", 16, in_i32(idx));
+                check("vgather*zmm", 8, in_f64(idx));
+            }
+        }
+
         if (use_avx512) {
 #if 0
             // Not yet implemented
@@ -619,6 +635,21 @@ public:
                 check("vpdpbusds*xmm", 4, saturating_sum(i32(in_i8(4 * x + r)) * in_u8(4 * x + r + 32)));
             }
         }
+        if (use_avx512 && target.has_feature(Target::AVX512_FP16)) {
+            check("vaddph*zmm", 32, f16_1 + f16_2);
+            check("vaddph*ymm", 16, f16_1 + f16_2);
+            check("vsubph*zmm", 32, f16_1 - f16_2);
+            check("vmulph*zmm", 32, f16_1 * f16_2);
+            check("vmulph*ymm", 16, f16_1 * f16_2);
+            check("vdivph*zmm", 32, f16_1 / f16_2);
+            check("vmaxph*zmm", 32, max(f16_1, f16_2));
+            check("vminph*zmm", 32, min(f16_1, f16_2));
+            check("vfmadd*ph*zmm", 32, f16_1 * f16_2 + f16_3);
+            check("vsqrtph*zmm", 32, sqrt(f16_1));
+            check("vsqrtph*ymm", 16, sqrt(f16_1));
+            check("vrndscaleph*zmm", 32, floor(f16_1));
+            check("vcmp*ph", 32, select(f16_1 < f16_2, f16_1, f16_3));
+        }
     }
 
 private:
@@ -647,5 +678,6 @@ int main(int argc, char **argv) {
             Target("x86-64-linux-sse41-avx-avx2-avx512-avx512_skylake"),
             Target("x86-64-linux-sse41-avx-avx2-avx512-avx512_skylake-avx512_cannonlake"),
             Target("x86-64-linux-sse41-avx-avx2-avx512-avx512_skylake-avx512_cannonlake-avx512_sapphirerapids"),
+            Target("x86-64-linux-sse41-avx-avx2-avx512-avx512_skylake-avx512_cannonlake-avx512_sapphirerapids-avx512_fp16"),
         });
 }
@@ -201,6 +201,46 @@ int main(int argc, char **argv) {
         check_counts(11);
     }
 
+    {
+        // Skip the tiles of a producer computed per tile of its
+        // consumer that the consumer doesn't use.
+        Func f1, f2;
+        Var xo, xi;
+        f1(x) = call_counter(x, 0);
+        f2(x) = select(x < 20, f1(x), 0);
+
+        f2.bound(x, 0, 48).split(x, xo, xi, 8);
+        f1.compute_at(f2, xo);
+
+        reset_counts();
+        f2.realize({48});
+        check_counts(24);
+    }
+
+    {
+        // Skip the tiles that a coarse mask Func marks as empty.
+        Func mask, f1, f2;
+        Var xo, xi;
+        mask(x) = (x % 3) == 1;
+        f1(x) = call_counter(x, 0);
+        f2(x) = select(mask(x / 8), f1(x), 0);
+
+        mask.compute_root();
+        f2.bound(x, 0, 48).split(x, xo, xi, 8);
+        f1.compute_at(f2, xo);
+
+        reset_counts();
+        Buffer<int> result = f2.realize({48});
+        check_counts(16);
+        for (int i = 0; i < 48; i++) {
+            int correct = ((i / 8) % 3) == 1 ? i : 0;
+            if (result(i) != correct) {
+                printf("result(%d) = %d instead of %d\n", i, result(i), correct);
+                return 1;
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
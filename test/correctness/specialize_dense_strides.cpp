@@ -0,0 +1,82 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the dense and other vector loads from a buffer.
+class CountLoads : public IRMutator {
+    using IRMutator::visit;
+
+    Expr visit(const Load *op) override {
+        if (op->name == name && op->type.is_vector()) {
+            const Ramp *r = op->index.as<Ramp>();
+            if (r && is_const_one(r->stride)) {
+                dense++;
+            } else {
+                other++;
+            }
+        }
+        return IRMutator::visit(op);
+    }
+
+    std::string name;
+
+public:
+    int dense = 0, other = 0;
+
+    CountLoads(const std::string &name)
+        : name(name) {
+    }
+};
+
+int main(int argc, char **argv) {
+    ImageParam in(Float(32), 2, "in");
+    Var x("x"), y("y");
+    Func f("f");
+    f(x, y) = in(x, y) * 2.0f + in(x + 1, y);
+    f.vectorize(x, 8);
+
+    for (bool specialize : {false, true}) {
+        Target t = get_jit_target_from_environment();
+        if (specialize) {
+            t = t.with_feature(Target::SpecializeDenseStrides);
+        }
+        CountLoads counter("in");
+        f.add_custom_lowering_pass(&counter, nullptr);
+        f.compile_jit(t);
+        f.clear_custom_lowering_passes();
+
+        if (specialize && (counter.dense != 2 || counter.other != 2)) {
+            printf("Expected two dense and two strided vector loads of in, not %d and %d\n",
+                   counter.dense, counter.other);
+            return 1;
+        }
+        if (!specialize && counter.dense != 0) {
+            printf("There should be no dense loads of in without the specialization\n");
+            return 1;
+        }
+
+        // The results must be right whichever version runs.
+        Buffer<float> input(65, 32);
+        input.for_each_element([&](int i, int j) { input(i, j) = i + j * 100.0f; });
+        Buffer<float> transposed(32, 65);
+        transposed.for_each_element([&](int i, int j) { transposed(i, j) = j + i * 100.0f; });
+        for (const Buffer<float> &b : {input, Buffer<float>(transposed.transposed(0, 1))}) {
+            in.set(b);
+            Buffer<float> result = f.realize({64, 32}, t);
+            for (int j = 0; j < result.height(); j++) {
+                for (int i = 0; i < result.width(); i++) {
+                    float correct = (i + j * 100.0f) * 2.0f + (i + 1 + j * 100.0f);
+                    if (result(i, j) != correct) {
+                        printf("result(%d, %d) = %f instead of %f\n", i, j, result(i, j), correct);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
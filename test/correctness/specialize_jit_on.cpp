@@ -0,0 +1,106 @@
+#include "Halide.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+namespace {
+
+// Records, for each compilation of the pipeline, whether the lowered
+// code still refers to the Param.
+class CountParamUses : public IRMutator {
+public:
+    std::atomic<int> generic{0}, specialized{0};
+
+    using IRMutator::mutate;
+    Stmt mutate(const Stmt &s) override {
+        if (stmt_uses_var(s, "radius")) {
+            generic++;
+        } else {
+            specialized++;
+        }
+        return s;
+    }
+};
+
+int check(const Buffer<int> &out, int radius) {
+    for (int x = 0; x < out.width(); x++) {
+        int correct = 0;
+        for (int r = -radius; r <= radius; r++) {
+            correct += x + r;
+        }
+        if (out(x) != correct) {
+            printf("out(%d) = %d instead of %d with radius %d\n", x, out(x), correct, radius);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Param<int> radius("radius");
+    Var x("x");
+    Func in("in"), f("f");
+    in(x) = x;
+    RDom r(-radius, 2 * radius + 1);
+    f(x) = sum(in(x + r));
+    in.compute_root();
+
+    // Compile the variants synchronously.
+    {
+        CountParamUses counter;
+        f.add_custom_lowering_pass(&counter, []() {});
+        f.specialize_jit_on({radius}, 2, false);
+
+        for (int rad : {1, 2, 1, 3, 1, 2}) {
+            radius.set(rad);
+            Buffer<int> out = f.realize({32});
+            if (check(out, rad)) {
+                return 1;
+            }
+        }
+        // 1, 2 and 3 each need compiling once. 2 is then the least
+        // recently used of the two variants kept, and gets evicted by 3.
+        if (counter.generic != 1 || counter.specialized != 4) {
+            printf("Compiled %d generic and %d specialized versions\n",
+                   (int)counter.generic, (int)counter.specialized);
+            return 1;
+        }
+        f.clear_custom_lowering_passes();
+    }
+
+    // Compile the variants in the background.
+    {
+        CountParamUses counter;
+        f.add_custom_lowering_pass(&counter, []() {});
+        f.specialize_jit_on({radius});
+
+        radius.set(4);
+        for (int i = 0; i < 1000 && counter.specialized == 0; i++) {
+            // Realizations are served by the generic version until the
+            // variant is ready.
+            Buffer<int> out = f.realize({32});
+            if (check(out, 4)) {
+                return 1;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (counter.specialized != 1) {
+            printf("Specialized variant was not compiled\n");
+            return 1;
+        }
+        Buffer<int> out = f.realize({32});
+        if (check(out, 4)) {
+            return 1;
+        }
+        f.clear_custom_lowering_passes();
+    }
+
+    printf("Success!\n");
+    return 0;
+}
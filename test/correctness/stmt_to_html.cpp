@@ -2,6 +2,8 @@
 #include "halide_test_dirs.h"
 
 #include <cstdio>
+#include <fstream>
+#include <sstream>
 
 using namespace Halide;
 
@@ -44,6 +46,29 @@ int main() {
     tuple_func.compile_to_lowered_stmt(result_file_3, {}, Halide::HTML);
     Internal::assert_file_exists(result_file_3);
 
+#ifndef _WIN32
+    // Check annotating the code with a saved profile.
+    std::string profile_file = Internal::get_test_tmp_dir() + "stmt_to_html_profile.txt";
+    {
+        std::ofstream profile(profile_file);
+        profile << "gradient_fast gradient_fast 1500000 3.5 4096 4096\n";
+    }
+    setenv("HL_STMT_HTML_PROFILE", profile_file.c_str(), 1);
+    std::string result_file_4 = Internal::get_test_tmp_dir() + "stmt_to_html_dump_4.html";
+    Internal::ensure_no_file_exists(result_file_4);
+    gradient_fast.compile_to_lowered_stmt(result_file_4, {}, Halide::HTML);
+    unsetenv("HL_STMT_HTML_PROFILE");
+    Internal::assert_file_exists(result_file_4);
+
+    std::ostringstream html;
+    html << std::ifstream(result_file_4).rdbuf();
+    if (html.str().find("profile-info ProfileHot") == std::string::npos ||
+        html.str().find("threads: 3.5") == std::string::npos) {
+        printf("The profile was not shown in %s\n", result_file_4.c_str());
+        return 1;
+    }
+#endif
+
     printf("Success!\n");
     return 0;
 }
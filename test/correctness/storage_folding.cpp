@@ -339,6 +339,36 @@ int main(int argc, char **argv) {
         }
     }
 
+    {
+        custom_malloc_sizes.clear();
+        Func f, g;
+
+        g(x, y) = x * y;
+        f(x, y) = g(x, y - 2) + g(x, y - 1) + g(x, y) + g(x, y + 1) + g(x, y + 2);
+
+        // A 5-row stencil over long scanlines. Rounding the fold
+        // factor up to 8 would waste three scanlines, so automatic
+        // storage folding should fold by exactly 5.
+        g.compute_at(f, y).store_root();
+
+        Buffer<int> im = f.realize({1000, 1000});
+
+        size_t expected_size = 1000 * 5 * sizeof(int);
+        if (!check_expected_mallocs({expected_size})) {
+            return 1;
+        }
+
+        for (int y = 0; y < im.height(); y++) {
+            for (int x = 0; x < im.width(); x++) {
+                int correct = 5 * x * y;
+                if (im(x, y) != correct) {
+                    printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
     {
         custom_malloc_sizes.clear();
         Func f, g;
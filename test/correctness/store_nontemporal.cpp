@@ -0,0 +1,78 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+using namespace Halide;
+
+std::string load_file_to_string(const std::string &filename) {
+    std::stringstream contents;
+    std::ifstream file(filename);
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+Func make_pipeline(bool nontemporal) {
+    Var x("x"), y("y");
+    Func f("f");
+    f(x, y) = cast<float>(x + y * 3);
+    f.vectorize(x, 16, TailStrategy::RoundUp);
+    if (nontemporal) {
+        f.store_nontemporal();
+    }
+
+    // Make the vector stores aligned.
+    const int alignment = 16;
+    f.output_buffer().set_host_alignment(alignment * sizeof(float));
+    f.output_buffer()
+        .dim(0)
+        .set_min((f.output_buffer().dim(0).min() / alignment) * alignment)
+        .set_extent((f.output_buffer().dim(0).extent() / alignment) * alignment)
+        .dim(1)
+        .set_stride((f.output_buffer().dim(1).stride() / alignment) * alignment);
+    return f;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    const char *instruction = nullptr;
+    if (t.arch == Target::X86) {
+        instruction = "movnt";
+    } else if (t.arch == Target::ARM && t.bits == 64) {
+        instruction = "stnp";
+    }
+
+    if (instruction) {
+        for (bool nontemporal : {false, true}) {
+            Func f = make_pipeline(nontemporal);
+            std::string assembly_file = Internal::get_test_tmp_dir() + "store_nontemporal.s";
+            Internal::ensure_no_file_exists(assembly_file);
+            f.compile_to_assembly(assembly_file, {}, "f", t);
+            Internal::assert_file_exists(assembly_file);
+            bool found = load_file_to_string(assembly_file).find(instruction) != std::string::npos;
+            if (found != nontemporal) {
+                printf("Expected %s to %sappear in the assembly\n", instruction, nontemporal ? "" : "not ");
+                return 1;
+            }
+        }
+    } else {
+        printf("Not checking the assembly on this target\n");
+    }
+
+    Func f = make_pipeline(true);
+    Buffer<float> result = f.realize({64, 8});
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            float correct = x + y * 3;
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "Halide.h"
+#include <atomic>
 #include <stdio.h>
 #include <thread>
 
@@ -34,6 +35,49 @@ int main(int argc, char **argv) {
     for (auto &t : threads) {
         t.join();
     }
+    threads.clear();
+
+    // Compile distinct, less trivial pipelines to Callables on all
+    // threads at once, the way a service compiling pipelines on demand
+    // would, and check that each computes the right thing.
+    std::atomic<int> failures{0};
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back([&, i] {
+            for (int j = 0; j < (is_wasm ? 2 : 8); j++) {
+                Param<int> offset;
+                ImageParam input(Int(32), 1);
+                Func f, g;
+                Var x;
+                f(x) = input(x) * (i + 1) + offset;
+                g(x) = f(x) + f(x + 1) + j;
+                f.compute_root().vectorize(x, 8);
+                g.parallel(x, 16);
+                Callable c = g.compile_to_callable({input, offset});
+
+                Buffer<int> in(101), out(100);
+                in.for_each_element([&](int x) { in(x) = x; });
+                if (c(in, 3, out) != 0) {
+                    failures++;
+                    continue;
+                }
+                out.for_each_element([&](int x) {
+                    int correct = (x + x + 1) * (i + 1) + 6 + j;
+                    if (out(x) != correct) {
+                        failures++;
+                    }
+                });
+            }
+        });
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    if (failures) {
+        printf("%d incorrect results from concurrently compiled pipelines\n", (int)failures);
+        return 1;
+    }
 
     printf("Success!\n");
 
@@ -242,6 +242,33 @@ bool matmul_bf16(int row, int col, int acc, int tile_x, int tile_y, int tile_r)
     return true;
 }
 
+// A Func stored in MemoryType::AMXTile that isn't a tile matmul (or any
+// such Func on a target without AMX) should fall back to ordinary code.
+bool fallback() {
+    Var x("x"), y("y");
+    Func f("f"), g("g");
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) * 2;
+
+    Var xi("xi"), yi("yi");
+    g.tile(x, y, xi, yi, 8, 8);
+    f.compute_at(g, x)
+        .store_in(MemoryType::AMXTile)
+        .vectorize(x, 8);
+
+    Buffer<int32_t> out = g.realize({32, 32});
+    for (int j = 0; j < out.height(); ++j) {
+        for (int i = 0; i < out.width(); ++i) {
+            if (out(i, j) != (i + j) * 2) {
+                std::cerr << "Invalid fallback result at " << i << ", " << j << "\n"
+                          << out(i, j) << " != " << (i + j) * 2 << "\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 auto matmul_ss = &matmul<int8_t, int8_t>;
 auto matmul_us = &matmul<uint8_t, int8_t>;
 auto matmul_su = &matmul<int8_t, uint8_t>;
@@ -252,6 +279,11 @@ bool run_tests(bool (*fn)(int, int, int, int, int, int), int element_width) {
 }
 
 int main(int argc, char **argv) {
+    printf("Running AMX fallback\n");
+    if (!fallback()) {
+        return 1;
+    }
+
     Target t = get_jit_target_from_environment();
     if (!t.has_feature(Target::AVX512_SapphireRapids)) {
         printf("[SKIP] No AMX target enabled\n");
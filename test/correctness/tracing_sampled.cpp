@@ -0,0 +1,104 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+int stores = 0, loads = 0, bad_events = 0;
+int every = 1, lanes = 1;
+int roi_min[2], roi_max[2];
+
+int count_trace(JITUserContext *user_context, const halide_trace_event_t *e) {
+    if (e->event == halide_trace_store) {
+        stores++;
+        if (e->type.lanes != lanes || e->coordinates[0] % every != 0) {
+            bad_events++;
+        }
+    } else if (e->event == halide_trace_load) {
+        loads++;
+        for (int i = 0; i < 2; i++) {
+            if (e->coordinates[i] < roi_min[i] || e->coordinates[i] > roi_max[i]) {
+                bad_events++;
+            }
+        }
+    }
+    return 0;
+}
+
+void reset(int e, int l) {
+    stores = loads = bad_events = 0;
+    every = e;
+    lanes = l;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    {
+        // Trace every 4th column of stores.
+        Func f("f");
+        f(x, y) = x + y;
+        f.trace_stores(TraceSampling::every_nth(4));
+        f.jit_handlers().custom_trace = &count_trace;
+        reset(4, 1);
+        f.realize({64, 64});
+        if (stores != 16 * 64 || bad_events) {
+            printf("every_nth: %d stores, %d bad events\n", stores, bad_events);
+            return 1;
+        }
+    }
+
+    {
+        // A vectorized store is traced whole if any lane is sampled.
+        Func f("f");
+        f(x, y) = x + y;
+        f.vectorize(x, 8);
+        f.trace_stores(TraceSampling::every_nth(16));
+        f.jit_handlers().custom_trace = &count_trace;
+        reset(16, 8);
+        f.realize({64, 64});
+        if (stores != 4 * 64 || bad_events) {
+            printf("vectorized every_nth: %d stores, %d bad events\n", stores, bad_events);
+            return 1;
+        }
+    }
+
+    {
+        // Trace a pseudo-random quarter of the stores.
+        Func f("f");
+        f(x, y) = x + y;
+        f.trace_stores(TraceSampling::random_fraction(0.25f));
+        f.jit_handlers().custom_trace = &count_trace;
+        reset(1, 1);
+        f.realize({64, 64});
+        if (stores < 700 || stores > 1350 || bad_events) {
+            printf("random_fraction: %d stores, %d bad events\n", stores, bad_events);
+            return 1;
+        }
+    }
+
+    {
+        // Trace only the loads inside a region of interest.
+        Func f("f"), g("g");
+        f(x, y) = x + y;
+        g(x, y) = f(x, y) * 2;
+        f.compute_root().trace_loads(TraceSampling::region_of_interest({{10, 5}, {20, 3}}));
+        g.jit_handlers().custom_trace = &count_trace;
+        reset(1, 1);
+        roi_min[0] = 10;
+        roi_max[0] = 14;
+        roi_min[1] = 20;
+        roi_max[1] = 22;
+        g.realize({64, 64});
+        if (loads != 5 * 3 || bad_events) {
+            printf("region_of_interest: %d loads, %d bad events\n", loads, bad_events);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
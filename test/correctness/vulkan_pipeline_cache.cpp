@@ -0,0 +1,90 @@
+#include "Halide.h"
+#include "jit_runtime_symbol.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::Vulkan)) {
+        printf("[SKIP] Vulkan not enabled.\n");
+        return 0;
+    }
+
+    auto import_pipeline_cache =
+        Internal::Test::find_jit_runtime_symbol<int (*)(void *, const void *, size_t)>(target, "halide_vulkan_import_pipeline_cache");
+    auto export_pipeline_cache =
+        Internal::Test::find_jit_runtime_symbol<int (*)(void *, void *, size_t *)>(target, "halide_vulkan_export_pipeline_cache");
+    if (import_pipeline_cache == nullptr || export_pipeline_cache == nullptr) {
+        printf("Failed to extract the pipeline cache API from Halide vulkan runtime\n");
+        return 1;
+    }
+
+    // Start from an empty cache, so that there is one to export even
+    // if the on-disk kernel cache isn't in use.
+    if (import_pipeline_cache(nullptr, nullptr, 0) != 0) {
+        printf("Importing an empty pipeline cache failed\n");
+        return 1;
+    }
+
+    const int width = 256, height = 64;
+    ImageParam in(Float(32), 2);
+    Func f, g;
+    Var x, y, xi, yi;
+    f(x, y) = in(x, y) * 2.0f + 1.0f;
+    g(x, y) = f(x, y) + f(x + 1, y);
+    f.compute_root().gpu_tile(x, y, xi, yi, 16, 16);
+    g.gpu_tile(x, y, xi, yi, 16, 16);
+    in.dim(0).set_extent(width + 1);
+    g.compile_jit(target);
+
+    // Run more times than there are cached command buffers, so that
+    // recycled ones get used, and check the results each time.
+    auto run = [&](int iterations) {
+        for (int iter = 0; iter < iterations; iter++) {
+            Buffer<float> input(width + 1, height);
+            input.fill((float)iter);
+            in.set(input);
+            Buffer<float> out = g.realize({width, height}, target);
+            out.copy_to_host();
+            float correct = 2.0f * (iter * 2.0f + 1.0f);
+            for (int yy = 0; yy < height; yy++) {
+                for (int xx = 0; xx < width; xx++) {
+                    if (out(xx, yy) != correct) {
+                        printf("out(%d, %d) = %f instead of %f on iteration %d\n",
+                               xx, yy, out(xx, yy), correct, iter);
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    };
+    if (!run(20)) {
+        return 1;
+    }
+
+    // The pipelines just made should now be in the cache.
+    size_t size = 0;
+    if (export_pipeline_cache(nullptr, nullptr, &size) != 0 || size == 0) {
+        printf("Querying the pipeline cache size failed (size = %d)\n", (int)size);
+        return 1;
+    }
+    std::vector<uint8_t> data(size);
+    if (export_pipeline_cache(nullptr, data.data(), &size) != 0) {
+        printf("Exporting the pipeline cache failed\n");
+        return 1;
+    }
+
+    // Merging the data back into the cache it came from must succeed,
+    // and leave the pipeline usable.
+    if (import_pipeline_cache(nullptr, data.data(), size) != 0) {
+        printf("Importing the exported pipeline cache failed\n");
+        return 1;
+    }
+    if (!run(5)) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
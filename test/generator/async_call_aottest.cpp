@@ -0,0 +1,68 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+
+#include "async_call.h"
+
+using namespace Halide::Runtime;
+
+const int kNumCalls = 4;
+
+int main(int argc, char **argv) {
+    // Keep several calls in flight from this one thread. Their
+    // arguments must outlive the calls.
+    int offsets[kNumCalls];
+    Buffer<int, 2> outputs[kNumCalls];
+    void *args[kNumCalls][2];
+    halide_async_call_t *calls[kNumCalls];
+    for (int i = 0; i < kNumCalls; i++) {
+        offsets[i] = i * 1000;
+        outputs[i] = Buffer<int, 2>(256, 256);
+        args[i][0] = &offsets[i];
+        args[i][1] = outputs[i].raw_buffer();
+        if (halide_call_async(nullptr, async_call_argv, args[i], &calls[i]) != halide_error_code_success) {
+            printf("halide_call_async failed\n");
+            return 1;
+        }
+    }
+
+    // Poll the first call until it is done. Waiting on it afterwards
+    // must not block.
+    while (!halide_async_call_done(calls[0])) {
+    }
+
+    for (int i = 0; i < kNumCalls; i++) {
+        int ret = halide_async_call_wait(calls[i]);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return 1;
+        }
+        for (int y = 0; y < outputs[i].dim(1).extent(); y++) {
+            for (int x = 0; x < outputs[i].dim(0).extent(); x++) {
+                int correct = x + y * 256 + offsets[i];
+                if (outputs[i](x, y) != correct) {
+                    printf("outputs[%d](%d, %d) = %d instead of %d\n", i, x, y, outputs[i](x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // Errors in the pipeline are returned by halide_async_call_wait.
+    Buffer<float, 2> bad(256, 256);
+    int offset = 0;
+    void *bad_args[2] = {&offset, bad.raw_buffer()};
+    halide_async_call_t *bad_call;
+    if (halide_call_async(nullptr, async_call_argv, bad_args, &bad_call) != halide_error_code_success) {
+        printf("halide_call_async failed\n");
+        return 1;
+    }
+    if (halide_async_call_wait(bad_call) == halide_error_code_success) {
+        printf("Expected an error from a call with the wrong output type\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,22 @@
+#include "Halide.h"
+
+namespace {
+
+class AsyncCall : public Halide::Generator<AsyncCall> {
+public:
+    Input<int> offset{"offset"};
+    Output<Buffer<int, 2>> output{"output"};
+
+    void generate() {
+        Var x, y;
+        output(x, y) = x + y * 256 + offset;
+
+        // The calls run their parallel loops on the thread pool they
+        // share.
+        output.parallel(y);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(AsyncCall, async_call)
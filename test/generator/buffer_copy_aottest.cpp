@@ -1,3 +1,4 @@
+#include <atomic>
 #include <stdio.h>
 
 #include "HalideBuffer.h"
@@ -37,6 +38,58 @@ int main(int argc, char **argv) {
                            in_crop);
     }
 
+    // Test the copies and loops over Buffers that use the Halide
+    // thread pool, including transposing copies.
+    {
+        Buffer<uint8_t, 3> planar(1000, 700, 3);
+        planar.fill([&](int x, int y, int c) { return (uint8_t)(x + 3 * y + 7 * c); });
+        Buffer<uint8_t, 3> interleaved = Buffer<uint8_t, 3>::make_interleaved(1000, 700, 3);
+        interleaved.copy_from_parallel(planar);
+        Buffer<uint8_t, 3> transposed(700, 1000, 3);
+        transposed.transpose(0, 1);
+        transposed.copy_from(interleaved);
+        // Copies are restricted to the region in common.
+        Buffer<uint8_t, 3> cropped(500, 700, 3);
+        cropped.copy_from_parallel(interleaved);
+
+        // Read through const references, since the non-const accessors
+        // mark the buffer host-dirty, and so are only thread-safe if it
+        // already is.
+        const Buffer<uint8_t, 3> &p = planar, &i = interleaved, &t = transposed;
+        std::atomic<int> mismatches{0};
+        p.for_each_element_parallel([&](int x, int y, int c) {
+            if (i(x, y, c) != p(x, y, c) || t(x, y, c) != p(x, y, c)) {
+                mismatches++;
+            }
+        });
+        cropped.for_each_value_parallel([&](uint8_t a, uint8_t b) {
+            if (a != b) {
+                mismatches++;
+            }
+        },
+                                        interleaved.cropped(0, 0, 500));
+        if (mismatches != 0) {
+            printf("Parallel buffer copy failed\n");
+            exit(1);
+        }
+
+        Buffer<int, 2> sums(1000, 100);
+        sums.set_host_dirty();
+        sums.for_each_element_parallel([&](int x, int y) { sums(x, y) = x + y; });
+        Buffer<int, 2> squares(1000, 100);
+        squares.for_each_value_parallel([](int &a, int b) { a = b * b; }, sums);
+        const Buffer<int, 2> &sq = squares;
+        sq.for_each_element_parallel([&](const int *pos) {
+            if (sq(pos) != (pos[0] + pos[1]) * (pos[0] + pos[1])) {
+                mismatches++;
+            }
+        });
+        if (mismatches != 0) {
+            printf("Parallel for_each_value failed\n");
+            exit(1);
+        }
+    }
+
 #if (defined(TEST_CUDA) || defined(TEST_OPENCL))
     const halide_device_interface_t *dev = nullptr;
 #ifdef TEST_CUDA
@@ -0,0 +1,71 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+#include "c_parallel_for.h"
+
+using namespace Halide::Runtime;
+
+const int W = 64, H = 64;
+
+std::atomic<int> par_for_calls{0};
+
+int my_do_par_for(void *user_context, halide_task_t f, int min, int extent, uint8_t *closure) {
+    par_for_calls++;
+    return halide_default_do_par_for(user_context, f, min, extent, closure);
+}
+
+void my_halide_error(void *user_context, const char *msg) {
+    // Silently drop the error
+}
+
+int main(int argc, char **argv) {
+    // The C++ backend library is built with c_plus_plus_parallel_for, and
+    // so emits its parallel loops directly. The LLVM one calls
+    // halide_do_par_for.
+    const bool native = strstr(c_parallel_for_metadata()->target, "c_plus_plus_parallel_for") != nullptr;
+
+    halide_set_custom_do_par_for(my_do_par_for);
+    halide_set_error_handler(my_halide_error);
+
+    Buffer<int32_t, 2> input(W, H + 1), output(W, H);
+    input.for_each_element([&](int x, int y) { input(x, y) = x + y * W; });
+
+    int result = c_parallel_for(input, output);
+    if (result != halide_error_code_success) {
+        printf("c_parallel_for failed: %d\n", result);
+        return 1;
+    }
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = input(x, y) * 3 + input(x, y + 1) * 3 + y;
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return 1;
+            }
+        }
+    }
+
+    if (native && par_for_calls != 0) {
+        printf("halide_do_par_for was called %d times with c_plus_plus_parallel_for\n", (int)par_for_calls);
+        return 1;
+    } else if (!native && par_for_calls == 0) {
+        printf("halide_do_par_for was never called\n");
+        return 1;
+    }
+
+    // A failure in one iteration of the parallel loop must be returned
+    // from the pipeline.
+    input(W / 2, H / 2) = -1;
+    result = c_parallel_for(input, output);
+    if (result != halide_error_code_requirement_failed) {
+        printf("The exit status was %d instead of %d\n", result, halide_error_code_requirement_failed);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
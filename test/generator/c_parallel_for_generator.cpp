@@ -0,0 +1,26 @@
+#include "Halide.h"
+
+namespace {
+
+class CParallelFor : public Halide::Generator<CParallelFor> {
+public:
+    Input<Buffer<int32_t, 2>> input{"input"};
+    Output<Buffer<int32_t, 2>> output{"output"};
+
+    void generate() {
+        Var x, y, yo, yi;
+
+        // A per-row allocation and a check that can fail inside the
+        // parallel loop, so that both have to work from within its body.
+        Func scratch;
+        scratch(x, y) = require(input(x, y) >= 0, input(x, y) * 3, "negative input at", x, y);
+        output(x, y) = scratch(x, y) + scratch(x, y + 1) + y;
+
+        output.split(y, yo, yi, 4).parallel(yo).parallel(yi);
+        scratch.compute_at(output, yi);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(CParallelFor, c_parallel_for)
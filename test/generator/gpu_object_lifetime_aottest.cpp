@@ -202,6 +202,33 @@ int main(int argc, char **argv) {
             }
         }
 
+        // Test page-locked host allocations, both requested per buffer
+        // and for every combined allocation. Devices that can't make
+        // them must fall back to ordinary host memory.
+        {
+            Buffer<int, 1> output(80);
+            gpu_object_lifetime(output);
+            if (output.raw_buffer()->device_interface != nullptr) {
+                output.copy_to_host();
+                for (int pass = 0; pass < 2; pass++) {
+                    halide_use_pinned_host_allocations(nullptr, pass == 1);
+                    Buffer<int, 1> output3(nullptr, 80);
+                    output3.raw_buffer()->set_pinned_host(pass == 0);
+                    output3.device_and_host_malloc(output.raw_buffer()->device_interface);
+                    gpu_object_lifetime(output3);
+                    output3.copy_to_host();
+
+                    for (int x = 0; x < output.width(); x++) {
+                        if (output(x) != output3(x)) {
+                            printf("Error! (pinned host allocation test): %d != %d\n", output(x), output3(x));
+                            return 1;
+                        }
+                    }
+                }
+                halide_use_pinned_host_allocations(nullptr, false);
+            }
+        }
+
 #if defined(TEST_CUDA)
         halide_device_release(nullptr, halide_cuda_device_interface());
 #elif defined(TEST_OPENCL)
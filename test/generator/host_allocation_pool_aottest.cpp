@@ -0,0 +1,59 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+
+#include "host_allocation_pool.h"
+
+using namespace Halide::Runtime;
+
+int main(int argc, char **argv) {
+    Buffer<int, 2> input(257, 256), output(256, 256);
+    input.for_each_element([&](int x, int y) { input(x, y) = x + y; });
+
+    halide_reuse_host_allocations(nullptr, true);
+
+    halide_host_allocation_pool_stats_t before, after;
+    halide_host_allocation_pool_get_stats(&before);
+    for (int i = 0; i < 10; i++) {
+        output.fill(0);
+        int ret = host_allocation_pool(input, output);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return 1;
+        }
+        for (int y = 0; y < output.height(); y++) {
+            for (int x = 0; x < output.width(); x++) {
+                int correct = 2 * (x + y) + 2 * (x + 1 + y);
+                if (output(x, y) != correct) {
+                    printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+    halide_host_allocation_pool_get_stats(&after);
+
+    // Every run after the first can reuse the intermediate's block.
+    uint64_t mallocs = after.mallocs - before.mallocs;
+    uint64_t reused = after.reused - before.reused;
+    if (mallocs < 10 || reused < 9) {
+        printf("Expected at least 9 of 10 allocations to be reused, got %d of %d\n",
+               (int)reused, (int)mallocs);
+        return 1;
+    }
+    if (after.retained_bytes <= 0) {
+        printf("Expected the pool to retain the freed block\n");
+        return 1;
+    }
+
+    halide_reuse_host_allocations(nullptr, false);
+    halide_host_allocation_pool_get_stats(&after);
+    if (after.retained_bytes != 0) {
+        printf("Disabling the pool retained %d bytes\n", (int)after.retained_bytes);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
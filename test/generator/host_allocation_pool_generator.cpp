@@ -0,0 +1,23 @@
+#include "Halide.h"
+
+namespace {
+
+class HostAllocationPool : public Halide::Generator<HostAllocationPool> {
+public:
+    Input<Buffer<int, 2>> input{"input"};
+    Output<Buffer<int, 2>> output{"output"};
+
+    void generate() {
+        Var x, y;
+        Func intermediate;
+        intermediate(x, y) = input(x, y) * 2;
+        output(x, y) = intermediate(x, y) + intermediate(x + 1, y);
+
+        // A heap allocation of a size we don't know at compile time.
+        intermediate.compute_root();
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(HostAllocationPool, host_allocation_pool)
@@ -0,0 +1,61 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "host_memory_policy.h"
+
+using namespace Halide::Runtime;
+
+int main(int argc, char **argv) {
+    const int policies[] = {
+        halide_host_memory_policy_huge_pages,
+        halide_host_memory_policy_gigantic_pages,
+        halide_host_memory_policy_huge_pages | halide_host_memory_policy_numa_interleave,
+        halide_host_memory_policy_default,
+    };
+
+    // The intermediate is about 4MB, so place everything of at least 1MB.
+    Buffer<int, 2> input(1025, 1024), output(1024, 1024);
+    input.for_each_element([&](int x, int y) { input(x, y) = x + y; });
+
+    for (int policy : policies) {
+        halide_set_host_memory_policy(policy, 1024 * 1024);
+
+        // A placed block must be usable like any other, and freed
+        // back to wherever it came from.
+        uint8_t *block = (uint8_t *)halide_malloc(nullptr, 3 * 1024 * 1024 + 1);
+        if (!block) {
+            printf("halide_malloc failed with policy %d\n", policy);
+            return 1;
+        }
+        if ((uintptr_t)block % 32 != 0) {
+            printf("Misaligned block %p with policy %d\n", block, policy);
+            return 1;
+        }
+        for (int i = 0; i < 3 * 1024 * 1024 + 1; i++) {
+            block[i] = (uint8_t)i;
+        }
+        halide_free(nullptr, block);
+
+        output.fill(0);
+        int ret = host_memory_policy(input, output);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return 1;
+        }
+        for (int y = 0; y < output.height(); y++) {
+            for (int x = 0; x < output.width(); x++) {
+                int correct = 2 * (x + y) + 2 * (x + 1 + y);
+                if (output(x, y) != correct) {
+                    printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include "Halide.h"
+
+namespace {
+
+class HostMemoryPolicy : public Halide::Generator<HostMemoryPolicy> {
+public:
+    Input<Buffer<int, 2>> input{"input"};
+    Output<Buffer<int, 2>> output{"output"};
+
+    void generate() {
+        Var x, y;
+        Func intermediate;
+        intermediate(x, y) = input(x, y) * 2;
+        output(x, y) = intermediate(x, y) + intermediate(x + 1, y);
+
+        // A heap allocation large enough to be placed by the policy.
+        intermediate.compute_root().parallel(y);
+        output.parallel(y);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(HostMemoryPolicy, host_memory_policy)
@@ -0,0 +1,106 @@
+#ifdef _WIN32
+#include <stdio.h>
+int main(int argc, char **argv) {
+    printf("[SKIP] This test uses fork and mmap, which aren't available on Windows.\n");
+    return 0;
+}
+#else
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "memoize_shared.h"
+
+using namespace Halide::Runtime;
+
+int call_count = 0;
+
+extern "C" int count_calls(int val, halide_buffer_t *out) {
+    if (!out->is_bounds_query()) {
+        call_count++;
+        Buffer<int>(*out).fill(val);
+    }
+    return 0;
+}
+
+int run_and_check(int val) {
+    Buffer<int, 2> out(64, 64);
+    int ret = memoize_shared(val, out);
+    if (ret) {
+        printf("Non zero exit code: %d\n", ret);
+        return 1;
+    }
+    for (int y = 0; y < out.dim(1).extent(); y++) {
+        for (int x = 0; x < out.dim(0).extent(); x++) {
+            if (out(x, y) != val + x) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), val + x);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const size_t size = 1 << 20;
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        printf("mmap failed\n");
+        return 1;
+    }
+
+    // A child process computes some results...
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (halide_memoization_cache_use_shared_memory(memory, size) != halide_error_code_success) {
+            _exit(1);
+        }
+        for (int val = 0; val < 4; val++) {
+            if (run_and_check(val)) {
+                _exit(1);
+            }
+        }
+        _exit(call_count == 4 ? 0 : 1);
+    }
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("Child process failed\n");
+        return 1;
+    }
+
+    // ...that this process then doesn't need to compute.
+    if (halide_memoization_cache_use_shared_memory(memory, size) != halide_error_code_success) {
+        printf("halide_memoization_cache_use_shared_memory failed\n");
+        return 1;
+    }
+    for (int val = 0; val < 4; val++) {
+        if (run_and_check(val)) {
+            return 1;
+        }
+    }
+    if (call_count != 0) {
+        printf("Shared results were recomputed %d times\n", call_count);
+        return 1;
+    }
+
+    // Results that no process has computed are still computed.
+    if (run_and_check(4)) {
+        return 1;
+    }
+    if (call_count != 1) {
+        printf("Expected one call, got %d\n", call_count);
+        return 1;
+    }
+
+    halide_memoization_cache_use_shared_memory(nullptr, 0);
+    halide_memoization_cache_cleanup();
+    munmap(memory, size);
+
+    printf("Success!\n");
+    return 0;
+}
+#endif
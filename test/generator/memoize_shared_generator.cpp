@@ -0,0 +1,22 @@
+#include "Halide.h"
+
+namespace {
+
+class MemoizeShared : public Halide::Generator<MemoizeShared> {
+public:
+    Input<int> val{"val"};
+    Output<Buffer<int, 2>> output{"output"};
+
+    void generate() {
+        Var x, y;
+        Func expensive;
+        expensive.define_extern("count_calls", {val}, Int(32), {x, y});
+        output(x, y) = expensive(x, y) + x;
+
+        expensive.compute_root().memoize();
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(MemoizeShared, memoize_shared)
@@ -59,6 +59,46 @@ void validate(halide_profiler_state *s) {
     }
 }
 
+// Take one sample by hand, with two running instances of the pipeline:
+// one in serial code, and one running two parallel tasks. Each
+// instance is billed for the whole interval, and the time of the
+// second is split between its tasks.
+void validate_instance_billing(halide_profiler_state *s) {
+    // Holding the lock keeps the sampling thread out.
+    halide_mutex_lock(&s->lock);
+    halide_profiler_pipeline_stats *p = s->pipelines;
+    assert(p && p->num_funcs >= 3);
+    assert(s->instances == nullptr);
+
+    halide_profiler_instance_state serial, parallel;
+    memset(&serial, 0, sizeof(serial));
+    memset(&parallel, 0, sizeof(parallel));
+    serial.pipeline = parallel.pipeline = p;
+    serial.current_func[0] = p->first_func_id + 1;
+    parallel.current_func[0] = p->first_func_id;
+    parallel.current_func[1] = p->first_func_id + 1;
+    parallel.current_func[2] = p->first_func_id + 2;
+    parallel.claimed_slots = (1 << 1) | (1 << 2);
+    serial.next = &parallel;
+
+    // A first sample with no instances running just starts the clock.
+    uint64_t t = 0;
+    halide_profiler_sample(s, &t);
+    uint64_t start = t;
+    uint64_t pipeline_time = p->time, f1_time = p->funcs[1].time, f2_time = p->funcs[2].time;
+    s->instances = &serial;
+    halide_profiler_sample(s, &t);
+    uint64_t elapsed = t - start;
+
+    s->instances = nullptr;
+    halide_mutex_unlock(&s->lock);
+
+    assert(p->time - pipeline_time == 2 * elapsed);
+    assert(p->funcs[1].time - f1_time == elapsed + (elapsed - elapsed / 2));
+    assert(p->funcs[2].time - f2_time == elapsed / 2);
+    (void)pipeline_time, (void)f1_time, (void)f2_time, (void)elapsed;
+}
+
 int launcher_task(void *user_context, int index, uint8_t *closure) {
     Buffer<int, 2> output(width, height);
     float fx = cos(index / 10.0f), fy = sin(index / 10.0f);
@@ -92,6 +132,7 @@ int main(int argc, char **argv) {
     assert(state != nullptr);
 
     validate(state);
+    validate_instance_billing(state);
 
     printf("Success!\n");
     return 0;
@@ -0,0 +1,55 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+
+#include "parallel_chunking.h"
+
+using namespace Halide::Runtime;
+
+int check(const Buffer<int, 2> &out) {
+    for (int y = 0; y < out.dim(1).extent(); y++) {
+        for (int x = 0; x < out.dim(0).extent(); x++) {
+            int correct = x * 3 + y;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const halide_parallel_chunking_policy_t policies[] = {halide_parallel_chunking_guided,
+                                                          halide_parallel_chunking_single};
+
+    halide_parallel_chunking_policy_t initial = halide_set_parallel_chunking_policy(halide_parallel_chunking_single);
+    if (halide_set_parallel_chunking_policy(initial) != halide_parallel_chunking_single) {
+        printf("halide_set_parallel_chunking_policy did not return the old policy\n");
+        return 1;
+    }
+
+    for (halide_parallel_chunking_policy_t policy : policies) {
+        halide_set_parallel_chunking_policy(policy);
+        for (int threads = 1; threads <= 8; threads++) {
+            halide_set_num_threads(threads);
+            // Include extents smaller than the number of threads
+            for (int extent : {1, 3, 100, 1080}) {
+                Buffer<int, 2> out(16, extent);
+                out.fill(-1);
+                int ret = parallel_chunking(out);
+                if (ret) {
+                    printf("Non zero exit code: %d\n", ret);
+                    return 1;
+                }
+                if (check(out)) {
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
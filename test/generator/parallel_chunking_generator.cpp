@@ -0,0 +1,20 @@
+#include "Halide.h"
+
+namespace {
+
+class ParallelChunking : public Halide::Generator<ParallelChunking> {
+public:
+    Output<Buffer<int, 2>> output{"output"};
+
+    void generate() {
+        // A parallel loop with many iterations and a tiny body, which
+        // is where claiming several iterations at once pays off.
+        Var x, y;
+        output(x, y) = x * 3 + y;
+        output.parallel(y);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ParallelChunking, parallel_chunking)
@@ -0,0 +1,55 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "profiler_memory_traffic.h"
+
+using namespace Halide::Runtime;
+
+int main(int argc, char **argv) {
+    const int width = 256, height = 256;
+    Buffer<float, 2> input(width, height), output(width, height);
+    input.fill(1.0f);
+
+    if (profiler_memory_traffic(input, output) != 0) {
+        printf("pipeline failed\n");
+        return 1;
+    }
+
+    halide_profiler_pipeline_stats *p = halide_profiler_get_pipeline_state("profiler_memory_traffic");
+    if (!p) {
+        printf("pipeline not profiled\n");
+        return 1;
+    }
+
+    // Every pixel is loaded and stored once, with a multiply and an
+    // add in between, all of it billed to the output Func. Scalar
+    // loop bookkeeping that isn't part of an address may add a few
+    // more ops per vector.
+    const uint64_t bytes = width * height * sizeof(float);
+    const uint64_t ops = 2 * width * height;
+    printf("loaded: %llu stored: %llu ops: %llu\n",
+           (unsigned long long)p->bytes_loaded,
+           (unsigned long long)p->bytes_stored,
+           (unsigned long long)p->arithmetic_ops);
+    if (p->bytes_loaded != bytes || p->bytes_stored != bytes ||
+        p->arithmetic_ops < ops || p->arithmetic_ops >= 2 * ops) {
+        printf("Expected %llu bytes loaded and stored and about %llu ops\n",
+               (unsigned long long)bytes, (unsigned long long)ops);
+        return 1;
+    }
+    for (int i = 0; i < p->num_funcs; i++) {
+        const halide_profiler_func_stats &f = p->funcs[i];
+        uint64_t expected = strcmp(f.name, "output") == 0 ? bytes : 0;
+        if (f.bytes_loaded != expected || f.bytes_stored != expected) {
+            printf("%s loaded %llu and stored %llu bytes\n", f.name,
+                   (unsigned long long)f.bytes_loaded, (unsigned long long)f.bytes_stored);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
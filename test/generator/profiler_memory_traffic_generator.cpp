@@ -0,0 +1,20 @@
+#include "Halide.h"
+
+namespace {
+
+class ProfilerMemoryTraffic : public Halide::Generator<ProfilerMemoryTraffic> {
+public:
+    Input<Buffer<float, 2>> input{"input"};
+    Output<Buffer<float, 2>> output{"output"};
+
+    void generate() {
+        Var x, y;
+        output(x, y) = input(x, y) * 2.0f + 1.0f;
+
+        output.vectorize(x, 8).parallel(y);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ProfilerMemoryTraffic, profiler_memory_traffic)
@@ -0,0 +1,113 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#include "profiler_sampling.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+const int num_runs = 100;
+const int runs_per_sample = 4;
+const int expected_sampled_runs = num_runs / runs_per_sample;
+
+double histogram_total(const double *histogram) {
+    double total = 0;
+    for (int i = 0; i < HALIDE_PROFILER_HISTOGRAM_BUCKETS; i++) {
+        total += histogram[i];
+    }
+    return total;
+}
+
+struct Snapshot {
+    bool found = false;
+    int runs = 0, sampled_runs = 0;
+    double decayed_runs = 0, histogram_runs = 0;
+    bool funcs_consistent = true;
+};
+
+int visit_pipeline(void *arg, const halide_profiler_pipeline_stats *p) {
+    if (strcmp(p->name, "profiler_sampling") != 0) {
+        return 0;
+    }
+    Snapshot *snapshot = (Snapshot *)arg;
+    snapshot->found = true;
+    snapshot->runs = p->runs;
+    snapshot->sampled_runs = p->sampled_runs;
+    snapshot->decayed_runs = p->decayed_runs;
+    snapshot->histogram_runs = histogram_total(p->time_histogram);
+    // Every Func gets an entry in its histogram for every sampled run.
+    for (int i = 0; i < p->num_funcs; i++) {
+        if (histogram_total(p->funcs[i].time_histogram) != snapshot->histogram_runs) {
+            snapshot->funcs_consistent = false;
+        }
+    }
+    return 1;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    halide_profiler_state *state = halide_profiler_get_state();
+    halide_mutex_lock(&state->lock);
+    state->runs_per_sample = runs_per_sample;
+    state->half_life_ms = 0;
+    halide_mutex_unlock(&state->lock);
+
+    Buffer<float, 2> output(1024, 1024);
+    for (int i = 0; i < num_runs; i++) {
+        int result = profiler_sampling(output);
+        if (result != 0) {
+            printf("pipeline failed: %d\n", result);
+            return 1;
+        }
+    }
+
+    Snapshot snapshot;
+    if (halide_profiler_visit(visit_pipeline, &snapshot) != 1 || !snapshot.found) {
+        printf("pipeline not visited\n");
+        return 1;
+    }
+    printf("runs: %d sampled runs: %d decayed runs: %f\n",
+           snapshot.runs, snapshot.sampled_runs, snapshot.decayed_runs);
+    if (snapshot.runs != num_runs || snapshot.sampled_runs != expected_sampled_runs) {
+        printf("Expected %d runs, %d of them sampled\n", num_runs, expected_sampled_runs);
+        return 1;
+    }
+    // Without a half-life, nothing decays.
+    if (snapshot.decayed_runs != expected_sampled_runs ||
+        snapshot.histogram_runs != expected_sampled_runs) {
+        printf("Expected an undecayed histogram of %d runs\n", expected_sampled_runs);
+        return 1;
+    }
+    if (!snapshot.funcs_consistent) {
+        printf("Func histograms don't match the pipeline's\n");
+        return 1;
+    }
+
+    // With a 1ms half-life, a few milliseconds halves the counts
+    // several times over.
+    halide_mutex_lock(&state->lock);
+    state->half_life_ms = 1;
+    halide_mutex_unlock(&state->lock);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    snapshot = Snapshot();
+    halide_profiler_visit(visit_pipeline, &snapshot);
+    printf("decayed runs after 5ms: %f\n", snapshot.decayed_runs);
+    if (snapshot.decayed_runs > expected_sampled_runs / 16.0) {
+        printf("Expected the counts to have decayed\n");
+        return 1;
+    }
+    if (!snapshot.funcs_consistent) {
+        printf("Func histograms decayed differently to the pipeline's\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,22 @@
+#include "Halide.h"
+
+namespace {
+
+class ProfilerSampling : public Halide::Generator<ProfilerSampling> {
+public:
+    Output<Buffer<float, 2>> output{"output"};
+
+    void generate() {
+        Var x, y;
+        Func producer("producer");
+        producer(x, y) = sin(x * 0.01f) * cos(y * 0.01f);
+        output(x, y) = producer(x, y) + producer(x + 1, y) + producer(x, y + 1);
+
+        producer.compute_root().parallel(y).vectorize(x, 8);
+        output.parallel(y).vectorize(x, 8);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ProfilerSampling, profiler_sampling)
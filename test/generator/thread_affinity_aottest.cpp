@@ -0,0 +1,66 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+
+#include "thread_affinity.h"
+
+using namespace Halide::Runtime;
+
+int run_and_check() {
+    Buffer<int, 2> out(256, 256);
+    for (int i = 0; i < 10; i++) {
+        out.fill(0);
+        int ret = thread_affinity(out);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return 1;
+        }
+        for (int y = 0; y < out.dim(1).extent(); y++) {
+            for (int x = 0; x < out.dim(0).extent(); x++) {
+                if (out(x, y) != x + y * 256) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), x + y * 256);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const halide_thread_affinity_t policies[] = {halide_thread_affinity_cpu,
+                                                 halide_thread_affinity_numa_node,
+                                                 halide_thread_affinity_none};
+
+    halide_set_num_threads(4);
+
+    halide_thread_affinity_t prev = halide_set_thread_affinity(halide_thread_affinity_none);
+    for (halide_thread_affinity_t affinity : policies) {
+        if (halide_set_thread_affinity(affinity) != prev) {
+            printf("halide_set_thread_affinity did not return the old policy\n");
+            return 1;
+        }
+        prev = affinity;
+
+        // Affinity only applies to new threads, so start both pools
+        // afresh. Pinning may not be possible on this platform, but
+        // the results must be correct regardless.
+        halide_shutdown_thread_pool();
+        halide_set_custom_do_par_for(halide_default_do_par_for);
+        if (run_and_check()) {
+            return 1;
+        }
+
+        halide_set_custom_do_par_for(halide_work_stealing_do_par_for);
+        if (run_and_check()) {
+            return 1;
+        }
+    }
+
+    halide_set_custom_do_par_for(halide_default_do_par_for);
+    halide_shutdown_thread_pool();
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,18 @@
+#include "Halide.h"
+
+namespace {
+
+class ThreadAffinity : public Halide::Generator<ThreadAffinity> {
+public:
+    Output<Buffer<int, 2>> output{"output"};
+
+    void generate() {
+        Var x, y;
+        output(x, y) = x + y * 256;
+        output.parallel(y);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ThreadAffinity, thread_affinity)
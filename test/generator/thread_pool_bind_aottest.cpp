@@ -0,0 +1,116 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <mutex>
+#include <set>
+#include <stdio.h>
+#include <thread>
+
+#include "thread_pool_bind.h"
+
+using namespace Halide::Runtime;
+
+struct Tenant {
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    int result = 0;
+};
+
+Tenant tenants[2];
+
+int my_do_task(void *user_context, halide_task_t f, int idx, uint8_t *closure) {
+    Tenant *t = (Tenant *)user_context;
+    {
+        std::lock_guard<std::mutex> lock(t->mutex);
+        t->threads.insert(std::this_thread::get_id());
+    }
+    return halide_default_do_task(user_context, f, idx, closure);
+}
+
+int run_and_check(Tenant *t) {
+    Buffer<int, 2> out(256, 256);
+    for (int i = 0; i < 10; i++) {
+        out.fill(0);
+        int ret = thread_pool_bind(t, out);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return 1;
+        }
+        for (int y = 0; y < out.dim(1).extent(); y++) {
+            for (int x = 0; x < out.dim(0).extent(); x++) {
+                if (out(x, y) != x + y * 256) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), x + y * 256);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    halide_set_custom_do_task(my_do_task);
+
+    halide_thread_pool_t *pools[2] = {
+        halide_thread_pool_create(4, halide_thread_pool_priority_normal),
+        halide_thread_pool_create(2, halide_thread_pool_priority_low),
+    };
+    for (int i = 0; i < 2; i++) {
+        if (!pools[i]) {
+            printf("halide_thread_pool_create failed\n");
+            return 1;
+        }
+        if (halide_thread_pool_bind(&tenants[i], pools[i]) != halide_error_code_success) {
+            printf("halide_thread_pool_bind failed\n");
+            return 1;
+        }
+    }
+
+    // Run both tenants at once from their own threads.
+    std::thread callers[2];
+    for (int i = 0; i < 2; i++) {
+        callers[i] = std::thread([i]() {
+            tenants[i].result = run_and_check(&tenants[i]);
+        });
+    }
+    for (int i = 0; i < 2; i++) {
+        callers[i].join();
+        if (tenants[i].result) {
+            return 1;
+        }
+    }
+
+    // Each pool has its own workers, so no thread should have done
+    // work for both tenants.
+    for (std::thread::id id : tenants[0].threads) {
+        if (tenants[1].threads.count(id)) {
+            printf("A thread did work for both tenants\n");
+            return 1;
+        }
+    }
+
+    // Unbinding sends the work back to the default pool.
+    for (int i = 0; i < 2; i++) {
+        if (halide_thread_pool_bind(&tenants[i], nullptr) != halide_error_code_success) {
+            printf("Unbinding failed\n");
+            return 1;
+        }
+        if (run_and_check(&tenants[i])) {
+            return 1;
+        }
+    }
+
+    // Destroying a pool also removes the bindings to it.
+    halide_thread_pool_bind(&tenants[0], pools[0]);
+    for (halide_thread_pool_t *pool : pools) {
+        halide_thread_pool_destroy(pool);
+    }
+    if (run_and_check(&tenants[0])) {
+        return 1;
+    }
+
+    halide_shutdown_thread_pool();
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,25 @@
+#include "Halide.h"
+
+namespace {
+
+class ThreadPoolBind : public Halide::Generator<ThreadPoolBind> {
+public:
+    Output<Buffer<int, 2>> output{"output"};
+
+    void generate() {
+        Var x, y;
+        Func producer;
+        producer(x, y) = x + y * 256;
+        output(x, y) = producer(x, y);
+
+        // The async producer makes the pipeline use
+        // halide_do_parallel_tasks and semaphores as well as
+        // halide_do_par_for.
+        output.parallel(y);
+        producer.compute_at(output, y).async();
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ThreadPoolBind, thread_pool_bind)
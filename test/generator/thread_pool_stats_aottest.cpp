@@ -0,0 +1,97 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+
+#include "thread_pool_stats.h"
+
+using namespace Halide::Runtime;
+
+int run() {
+    Buffer<int, 2> out(256, 256);
+    for (int i = 0; i < 10; i++) {
+        int ret = thread_pool_stats(out);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return 1;
+        }
+    }
+    for (int y = 0; y < out.dim(1).extent(); y++) {
+        for (int x = 0; x < out.dim(0).extent(); x++) {
+            if (out(x, y) != x + y * 256) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), x + y * 256);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    halide_set_num_threads(4);
+
+    if (halide_thread_pool_enable_stats(nullptr, true) != halide_error_code_success) {
+        printf("halide_thread_pool_enable_stats failed\n");
+        return 1;
+    }
+    if (run()) {
+        return 1;
+    }
+
+    halide_thread_pool_stats_t stats;
+    halide_thread_pool_thread_stats_t workers[8];
+    if (halide_thread_pool_get_stats(nullptr, &stats, workers, 8) != halide_error_code_success) {
+        printf("halide_thread_pool_get_stats failed\n");
+        return 1;
+    }
+    if (!stats.enabled) {
+        printf("Stats are not enabled\n");
+        return 1;
+    }
+    if (stats.num_workers != 3) {
+        printf("Expected 3 workers, got %d\n", stats.num_workers);
+        return 1;
+    }
+    if (stats.jobs_enqueued != 10 || stats.max_queue_depth != 1) {
+        printf("Expected 10 jobs with a queue depth of 1, got %d jobs with a queue depth of %d\n",
+               (int)stats.jobs_enqueued, stats.max_queue_depth);
+        return 1;
+    }
+    uint64_t tasks = 0, busy_ns = 0;
+    for (int i = 0; i < stats.num_workers; i++) {
+        tasks += workers[i].tasks;
+        busy_ns += workers[i].busy_ns;
+    }
+    if (tasks != stats.workers_total.tasks || busy_ns != stats.workers_total.busy_ns) {
+        printf("Per-worker stats do not add up to the total\n");
+        return 1;
+    }
+    // Every claim of iterations counts as a task, so there are at
+    // least as many as runs of the pipeline, and at most one per
+    // iteration.
+    tasks += stats.callers.tasks;
+    if (tasks < 10 || tasks > 10 * 256) {
+        printf("Unexpected number of tasks: %d\n", (int)tasks);
+        return 1;
+    }
+
+    // Re-enabling stats after disabling them resets them.
+    halide_thread_pool_enable_stats(nullptr, false);
+    if (run()) {
+        return 1;
+    }
+    halide_thread_pool_get_stats(nullptr, &stats, nullptr, 0);
+    if (stats.enabled || stats.jobs_enqueued != 10) {
+        printf("Stats were collected while disabled\n");
+        return 1;
+    }
+    halide_thread_pool_enable_stats(nullptr, true);
+    halide_thread_pool_get_stats(nullptr, &stats, nullptr, 0);
+    if (!stats.enabled || stats.jobs_enqueued != 0 || stats.workers_total.tasks != 0) {
+        printf("Stats were not reset\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
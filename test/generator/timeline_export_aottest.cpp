@@ -0,0 +1,95 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+#include <string>
+
+#include "timeline_export.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+int count(const std::string &s, const std::string &pattern) {
+    int n = 0;
+    for (size_t pos = s.find(pattern); pos != std::string::npos; pos = s.find(pattern, pos + 1)) {
+        n++;
+    }
+    return n;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const char *filename = "timeline_export_aottest.json";
+
+    halide_set_num_threads(4);
+    if (halide_set_timeline_file(filename) != halide_error_code_success) {
+        printf("halide_set_timeline_file failed\n");
+        return 1;
+    }
+
+    Buffer<int, 2> out(64, 64);
+    for (int i = 0; i < 4; i++) {
+        int ret = timeline_export(out);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return 1;
+        }
+    }
+    for (int y = 0; y < out.dim(1).extent(); y++) {
+        for (int x = 0; x < out.dim(0).extent(); x++) {
+            int correct = 2 * (x + y) + 1;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return 1;
+            }
+        }
+    }
+
+    if (halide_shutdown_timeline() != halide_error_code_success) {
+        printf("halide_shutdown_timeline failed\n");
+        return 1;
+    }
+
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        printf("Timeline file %s was not written\n", filename);
+        return 1;
+    }
+    std::string json;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        json.append(buf, n);
+    }
+    fclose(f);
+    remove(filename);
+
+    if (json.compare(0, 16, "{\"traceEvents\":[") != 0) {
+        printf("Timeline does not start with a traceEvents array:\n%s\n", json.substr(0, 64).c_str());
+        return 1;
+    }
+    int begins = count(json, "\"ph\":\"B\""), ends = count(json, "\"ph\":\"E\"");
+    if (begins != ends) {
+        printf("%d spans began but %d ended\n", begins, ends);
+        return 1;
+    }
+    // Each call of the pipeline should report its start and end, the
+    // production of its Funcs, and the chunks of its parallel loops.
+    if (count(json, "{\"name\":\"timeline_export\",\"cat\":\"pipeline\",\"ph\":\"B\"") != 4) {
+        printf("Expected 4 pipeline spans\n");
+        return 1;
+    }
+    if (count(json, "{\"name\":\"producer\",\"cat\":\"produce\",\"ph\":\"B\"") != 4) {
+        printf("Expected 4 spans producing producer\n");
+        return 1;
+    }
+    if (count(json, "\"cat\":\"task\",\"ph\":\"B\"") < 8) {
+        printf("Expected at least 8 task spans\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
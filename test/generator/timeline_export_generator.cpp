@@ -0,0 +1,22 @@
+#include "Halide.h"
+
+namespace {
+
+class TimelineExport : public Halide::Generator<TimelineExport> {
+public:
+    Output<Buffer<int, 2>> output{"output"};
+
+    void generate() {
+        Var x, y;
+        Func producer("producer");
+        producer(x, y) = x + y;
+        output(x, y) = producer(x, y) + producer(x + 1, y);
+
+        producer.compute_root().parallel(y);
+        output.parallel(y);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(TimelineExport, timeline_export)
@@ -0,0 +1,92 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdio.h>
+
+#include "vector_intrinsics.h"
+
+using namespace Halide::Runtime;
+
+const int kSize = 1024;
+
+template<typename T>
+T saturate(int64_t v) {
+    return (T)std::min<int64_t>(std::max<int64_t>(v, std::numeric_limits<T>::min()), std::numeric_limits<T>::max());
+}
+
+template<typename T>
+bool check(const char *name, const Buffer<T, 1> &out, int i, int64_t correct) {
+    if ((int64_t)out(i) != correct) {
+        printf("%s(%d) = %lld instead of %lld\n", name, i, (long long)out(i), (long long)correct);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Buffer<uint8_t, 1> a8(kSize), b8(kSize);
+    Buffer<int16_t, 1> a16(kSize), b16(kSize);
+    Buffer<int32_t, 1> a32(kSize);
+
+    // Cover the full range of each type, so that every op saturates,
+    // rounds and overflows somewhere.
+    for (int i = 0; i < kSize; i++) {
+        a8(i) = (uint8_t)(i * 37 + 11);
+        b8(i) = (uint8_t)(i * 101 + 200);
+        a16(i) = (int16_t)(i * 1237 - 30000);
+        b16(i) = (int16_t)(i * 7919 + 12345);
+        a32(i) = (i - kSize / 2) * 97;
+    }
+
+    Buffer<uint8_t, 1> add_u8(kSize), avg_u8(kSize), narrow_u8(kSize);
+    Buffer<int8_t, 1> sub_i8(kSize), narrow_i8(kSize);
+    Buffer<int16_t, 1> add_i16(kSize), narrow_i16(kSize);
+    Buffer<uint16_t, 1> avg_u16(kSize);
+    Buffer<int32_t, 1> mul_i32(kSize), sum_i32(kSize / 4);
+    Buffer<uint32_t, 1> mul_u32(kSize);
+    Buffer<uint8_t, 1> max_u8(kSize / 4);
+
+    int result = vector_intrinsics(a8, b8, a16, b16, a32,
+                                   add_u8, sub_i8, avg_u8, add_i16, avg_u16,
+                                   mul_i32, mul_u32, narrow_u8, narrow_i8, narrow_i16,
+                                   sum_i32, max_u8);
+    if (result != 0) {
+        printf("vector_intrinsics failed: %d\n", result);
+        return 1;
+    }
+
+    for (int i = 0; i < kSize; i++) {
+        const int8_t sa8 = (int8_t)a8(i), sb8 = (int8_t)b8(i);
+        const uint16_t ua16 = (uint16_t)a16(i), ub16 = (uint16_t)b16(i);
+        if (!check("add_u8", add_u8, i, saturate<uint8_t>((int64_t)a8(i) + b8(i))) ||
+            !check("sub_i8", sub_i8, i, saturate<int8_t>((int64_t)sa8 - sb8)) ||
+            !check("avg_u8", avg_u8, i, ((int64_t)a8(i) + b8(i) + 1) >> 1) ||
+            !check("add_i16", add_i16, i, saturate<int16_t>((int64_t)a16(i) + b16(i))) ||
+            !check("avg_u16", avg_u16, i, ((int64_t)ua16 + ub16 + 1) >> 1) ||
+            !check("mul_i32", mul_i32, i, (int64_t)a16(i) * b16(i)) ||
+            !check("mul_u32", mul_u32, i, (int64_t)ua16 * ub16) ||
+            !check("narrow_u8", narrow_u8, i, saturate<uint8_t>(a16(i))) ||
+            !check("narrow_i8", narrow_i8, i, saturate<int8_t>(a16(i))) ||
+            !check("narrow_i16", narrow_i16, i, saturate<int16_t>(a32(i)))) {
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < kSize / 4; i++) {
+        int64_t sum = 0;
+        int64_t max = 0;
+        for (int r = 0; r < 4; r++) {
+            sum += a16(i * 4 + r);
+            max = std::max<int64_t>(max, a8(i * 4 + r));
+        }
+        if (!check("sum_i32", sum_i32, i, sum) ||
+            !check("max_u8", max_u8, i, max)) {
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "Halide.h"
+
+namespace {
+
+// Integer vector intrinsics that the C++ backend emits as calls to its
+// vector ops, rather than lowering them, when it uses vector typedefs.
+class VectorIntrinsics : public Halide::Generator<VectorIntrinsics> {
+public:
+    Input<Buffer<uint8_t, 1>> a8{"a8"};
+    Input<Buffer<uint8_t, 1>> b8{"b8"};
+    Input<Buffer<int16_t, 1>> a16{"a16"};
+    Input<Buffer<int16_t, 1>> b16{"b16"};
+    Input<Buffer<int32_t, 1>> a32{"a32"};
+
+    Output<Buffer<uint8_t, 1>> add_u8{"add_u8"};
+    Output<Buffer<int8_t, 1>> sub_i8{"sub_i8"};
+    Output<Buffer<uint8_t, 1>> avg_u8{"avg_u8"};
+    Output<Buffer<int16_t, 1>> add_i16{"add_i16"};
+    Output<Buffer<uint16_t, 1>> avg_u16{"avg_u16"};
+    Output<Buffer<int32_t, 1>> mul_i32{"mul_i32"};
+    Output<Buffer<uint32_t, 1>> mul_u32{"mul_u32"};
+    Output<Buffer<uint8_t, 1>> narrow_u8{"narrow_u8"};
+    Output<Buffer<int8_t, 1>> narrow_i8{"narrow_i8"};
+    Output<Buffer<int16_t, 1>> narrow_i16{"narrow_i16"};
+    Output<Buffer<int32_t, 1>> sum_i32{"sum_i32"};
+    Output<Buffer<uint8_t, 1>> max_u8{"max_u8"};
+
+    void generate() {
+        Var x;
+        Expr sa8 = cast<int8_t>(a8(x));
+        Expr sb8 = cast<int8_t>(b8(x));
+        Expr ua16 = cast<uint16_t>(a16(x));
+        Expr ub16 = cast<uint16_t>(b16(x));
+
+        add_u8(x) = saturating_add(a8(x), b8(x));
+        sub_i8(x) = saturating_sub(sa8, sb8);
+        avg_u8(x) = rounding_halving_add(a8(x), b8(x));
+        add_i16(x) = saturating_add(a16(x), b16(x));
+        avg_u16(x) = rounding_halving_add(ua16, ub16);
+        mul_i32(x) = widening_mul(a16(x), b16(x));
+        mul_u32(x) = widening_mul(ua16, ub16);
+        narrow_u8(x) = Halide::saturating_cast<uint8_t>(a16(x));
+        narrow_i8(x) = Halide::saturating_cast<int8_t>(a16(x));
+        narrow_i16(x) = Halide::saturating_cast<int16_t>(a32(x));
+
+        // Horizontal reductions, which become VectorReduce nodes.
+        RDom r(0, 4);
+        RVar rx;
+        Var xo, xi;
+        sum_i32(x) = 0;
+        sum_i32(x) += cast<int32_t>(a16(x * 4 + r));
+        max_u8(x) = cast<uint8_t>(0);
+        max_u8(x) = max(max_u8(x), a8(x * 4 + r));
+
+        add_u8.vectorize(x, 16);
+        sub_i8.vectorize(x, 16);
+        avg_u8.vectorize(x, 16);
+        add_i16.vectorize(x, 8);
+        avg_u16.vectorize(x, 8);
+        mul_i32.vectorize(x, 8);
+        mul_u32.vectorize(x, 8);
+        narrow_u8.vectorize(x, 16);
+        narrow_i8.vectorize(x, 16);
+        narrow_i16.vectorize(x, 8);
+        sum_i32.update()
+            .split(x, xo, xi, 4)
+            .fuse(r, xi, rx)
+            .atomic()
+            .vectorize(rx);
+        max_u8.update()
+            .split(x, xo, xi, 4)
+            .fuse(r, xi, rx)
+            .atomic()
+            .vectorize(rx);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(VectorIntrinsics, vector_intrinsics)
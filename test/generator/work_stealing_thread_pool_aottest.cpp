@@ -0,0 +1,51 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+
+#include "work_stealing_thread_pool.h"
+
+using namespace Halide::Runtime;
+
+int main(int argc, char **argv) {
+    halide_set_custom_parallel_runtime(halide_work_stealing_do_par_for,
+                                       halide_default_do_task,
+                                       halide_default_do_loop_task,
+                                       halide_default_do_parallel_tasks,
+                                       halide_default_semaphore_init,
+                                       halide_default_semaphore_try_acquire,
+                                       halide_default_semaphore_release);
+
+    Buffer<int, 3> out(64, 64, 16);
+
+    for (int i = 0; i < 100; i++) {
+        // Vary the number of threads, including running with fewer
+        // iterations than threads in the inner loop.
+        halide_set_num_threads(1 + i % 8);
+
+        out.fill(0);
+        int ret = work_stealing_thread_pool(out);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return 1;
+        }
+
+        for (int z = 0; z < out.dim(2).extent(); z++) {
+            for (int y = 0; y < out.dim(1).extent(); y++) {
+                for (int x = 0; x < out.dim(0).extent(); x++) {
+                    int correct = ((x - 1) * y + z) + ((x + 1) * y + z);
+                    if (out(x, y, z) != correct) {
+                        printf("out(%d, %d, %d) = %d instead of %d\n",
+                               x, y, z, out(x, y, z), correct);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+
+    halide_shutdown_thread_pool();
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,26 @@
+#include "Halide.h"
+
+namespace {
+
+class WorkStealingThreadPool : public Halide::Generator<WorkStealingThreadPool> {
+public:
+    Output<Buffer<int, 3>> output{"output"};
+
+    void generate() {
+        Var x, y, z;
+
+        // An async producer, which enters the task system via
+        // halide_do_parallel_tasks, feeding a consumer with nested
+        // parallel loops, which go through halide_do_par_for.
+        Func producer{"producer"};
+        producer(x, y, z) = x * y + z;
+        output(x, y, z) = producer(x - 1, y, z) + producer(x + 1, y, z);
+
+        producer.compute_at(output, y).async();
+        output.parallel(z).parallel(y);
+    }
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(WorkStealingThreadPool, work_stealing_thread_pool)
@@ -0,0 +1,81 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+
+#include "workspace.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+int mallocs = 0;
+
+void *counting_malloc(void *user_context, size_t size) {
+    mallocs++;
+    return halide_default_malloc(user_context, size);
+}
+
+int run(int width, int height) {
+    Buffer<int, 2> input(width + 1, height), output(width, height);
+    input.for_each_element([&](int x, int y) { input(x, y) = x + y; });
+    int ret = workspace(input, output);
+    if (ret) {
+        printf("Non zero exit code: %d\n", ret);
+        return 1;
+    }
+    for (int y = 0; y < output.height(); y++) {
+        for (int x = 0; x < output.width(); x++) {
+            int correct = 2 * (x + y) + 2 * (x + 1 + y);
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    halide_set_custom_malloc(counting_malloc);
+
+    // The first call allocates the intermediate, and later calls of the
+    // same or a smaller size reuse it.
+    if (run(256, 256)) {
+        return 1;
+    }
+    int first = mallocs;
+    for (int i = 0; i < 10; i++) {
+        if (run(256 - i, 256)) {
+            return 1;
+        }
+    }
+    if (mallocs != first) {
+        printf("Steady-state calls made %d allocations\n", mallocs - first);
+        return 1;
+    }
+
+    // A larger call grows the block once.
+    if (run(512, 512) || run(512, 512)) {
+        return 1;
+    }
+    if (mallocs != first + 1) {
+        printf("Growing the workspace made %d allocations instead of 1\n", mallocs - first);
+        return 1;
+    }
+
+    // After releasing the workspaces, the next call allocates again.
+    halide_release_workspaces(nullptr);
+    if (run(256, 256)) {
+        return 1;
+    }
+    if (mallocs != first + 2) {
+        printf("Expected an allocation after releasing the workspaces\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -10,7 +10,9 @@
 #include "IR.h"
 #include "IREquality.h"
 #include "IRMatch.h"
+#include "IRNodeAllocator.h"
 #include "IRPrinter.h"
+#include "InternExprs.h"
 #include "Interval.h"
 #include "ModulusRemainder.h"
 #include "Monotonic.h"
@@ -26,11 +28,13 @@ int main(int argc, const char **argv) {
     IRPrinter::test();
     CodeGen_C::test();
     ir_equality_test();
+    ir_node_allocator_test();
     bounds_test();
     expr_match_test();
     deinterleave_vector_test();
     modulus_remainder_test();
     cse_test();
+    intern_exprs_test();
     solve_test();
     target_test();
     cplusplus_mangle_test();
@@ -0,0 +1,89 @@
+#include "Halide.h"
+
+#include "halide_benchmark.h"
+#include <cstdio>
+#include <random>
+
+using namespace Halide;
+using namespace Halide::Internal;
+using namespace Halide::Tools;
+
+namespace {
+
+std::mt19937 rng(0);
+
+Expr random_leaf(int lanes) {
+    static const char *names[] = {"a", "b", "c", "d"};
+    Expr e;
+    if (rng() % 3 == 0) {
+        e = Expr((int)(rng() % 16) - 8);
+    } else {
+        e = Variable::make(Int(32), names[rng() % 4]);
+    }
+    if (lanes > 1) {
+        if (rng() % 2) {
+            e = Ramp::make(e, Expr((int)(rng() % 4)), lanes);
+        } else {
+            e = Broadcast::make(e, lanes);
+        }
+    }
+    return e;
+}
+
+Expr random_expr(int depth, int lanes) {
+    if (depth == 0) {
+        return random_leaf(lanes);
+    }
+    Expr a = random_expr(depth - 1, lanes);
+    Expr b = random_expr(depth - 1, lanes);
+    switch (rng() % 6) {
+    case 0:
+        return Add::make(a, b);
+    case 1:
+        return Sub::make(a, b);
+    case 2:
+        return Min::make(a, b);
+    case 3:
+        return Max::make(a, b);
+    case 4:
+        return Mul::make(a, random_leaf(lanes));
+    default:
+        return Select::make(LT::make(a, b), a, random_expr(depth - 1, lanes));
+    }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
+        return 0;
+    }
+
+    // A fixed corpus of scalar and vector expressions, so that runs are
+    // comparable with each other.
+    std::vector<Expr> exprs;
+    for (int i = 0; i < 2000; i++) {
+        exprs.push_back(random_expr(5, (i % 2) ? 8 : 1));
+    }
+
+    size_t nodes = 0;
+    double t = benchmark(3, 1, [&]() {
+        nodes = 0;
+        for (const Expr &e : exprs) {
+            Expr s = simplify(e);
+            nodes += s.defined();
+        }
+    });
+
+    if (nodes != exprs.size()) {
+        printf("Simplified %d of %d expressions\n", (int)nodes, (int)exprs.size());
+        return 1;
+    }
+
+    printf("%g us per expression simplified\n", t * 1e6 / exprs.size());
+
+    printf("Success!\n");
+    return 0;
+}
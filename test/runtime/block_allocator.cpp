@@ -39,6 +39,11 @@ int deallocate_block(void *user_context, MemoryBlock *block) {
     return halide_error_code_success;
 }
 
+int allocate_block_out_of_memory(void *user_context, MemoryBlock *block) {
+    block->handle = nullptr;
+    return halide_error_code_out_of_memory;
+}
+
 int allocate_region(void *user_context, MemoryRegion *region) {
     region->handle = (void *)1;
     allocated_region_memory += region->size;
@@ -220,6 +225,35 @@ int main(int argc, char **argv) {
         halide_abort_if_false(user_context, get_allocated_system_memory() == 0);
     }
 
+    // failed block allocation test
+    {
+        BlockAllocator::Config config = {0};
+        config.minimum_block_size = 1024;
+
+        MemoryBlockAllocatorFns failing_block_allocator = {allocate_block_out_of_memory, deallocate_block};
+        BlockAllocator::MemoryAllocators allocators = {system_allocator, failing_block_allocator, region_allocator};
+        BlockAllocator *instance = BlockAllocator::create(user_context, config, allocators);
+
+        MemoryRequest request = {0};
+        request.size = sizeof(int);
+        request.alignment = sizeof(int);
+        request.properties.visibility = MemoryVisibility::DefaultVisibility;
+        request.properties.caching = MemoryCaching::DefaultCaching;
+        request.properties.usage = MemoryUsage::DefaultUsage;
+
+        // the failed block must not be kept around for later requests
+        MemoryRegion *r1 = instance->reserve(user_context, request);
+        HALIDE_CHECK(user_context, r1 == nullptr);
+        HALIDE_CHECK(user_context, instance->block_count() == 0);
+        HALIDE_CHECK(user_context, allocated_region_memory == 0);
+
+        instance->destroy(user_context);
+        HALIDE_CHECK(user_context, allocated_block_memory == 0);
+
+        BlockAllocator::destroy(user_context, instance);
+        HALIDE_CHECK(user_context, get_allocated_system_memory() == 0);
+    }
+
     print(user_context) << "Success!\n";
     return 0;
 }
@@ -3,20 +3,34 @@
 #include "halide_benchmark.h"
 #include "halide_image_io.h"
 
+#include <cctype>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <random>
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 
 #include <vector>
 
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace Halide {
 namespace RunGen {
 
@@ -478,7 +492,7 @@ inline Buffer<> load_input_from_file(const std::string &pathname,
                                      const halide_filter_argument_t &metadata) {
     Buffer<> b = Buffer<>(metadata.type, 0);
     info() << "Loading input " << metadata.name << " from " << pathname << " ...";
-    if (!Halide::Tools::load<Buffer<>, IOCheckFail>(pathname, &b)) {
+    if (!Halide::Tools::load_mmap<Buffer<>, IOCheckFail>(pathname, &b)) {
         fail() << "Unable to load input: " << pathname;
     }
     if (b.dimensions() != metadata.dimensions) {
@@ -891,6 +905,127 @@ struct ArgData {
     }
 };
 
+// Hardware performance counters (via perf_event_open on Linux), counted
+// over a region of code on the calling thread and any threads it creates
+// afterwards, such as the Halide thread pool. Counters are opened
+// user-space only, so that they work at the default perf_event_paranoid
+// level; counters the machine or kernel doesn't support are skipped.
+class HardwareCounters {
+public:
+    struct Reading {
+        std::string name;
+        double value;
+    };
+
+    HardwareCounters() {
+#ifdef __linux__
+        add("cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        add("instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        add("llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#endif
+    }
+
+    HardwareCounters(const HardwareCounters &) = delete;
+    HardwareCounters &operator=(const HardwareCounters &) = delete;
+
+    ~HardwareCounters() {
+#ifdef __linux__
+        for (const Counter &c : counters) {
+            close(c.fd);
+        }
+#endif
+    }
+
+    bool available() const {
+        return !counters.empty();
+    }
+
+    // Start counting. Any previous counts are discarded.
+    void start() {
+        for (Counter &c : counters) {
+            c.start = read_counter(c);
+        }
+        for (Counter &c : counters) {
+            enable(c, true);
+        }
+    }
+
+    // Stop counting and return the counts since start(). If the kernel
+    // had to multiplex the counters, the counts are scaled up to the
+    // whole region.
+    std::vector<Reading> stop() {
+        for (Counter &c : counters) {
+            enable(c, false);
+        }
+        std::vector<Reading> readings;
+        for (Counter &c : counters) {
+            Value end = read_counter(c);
+            uint64_t running = end.time_running - c.start.time_running;
+            uint64_t enabled = end.time_enabled - c.start.time_enabled;
+            double value = (double)(end.count - c.start.count);
+            if (running > 0 && running < enabled) {
+                value *= (double)enabled / running;
+            }
+            readings.push_back({c.name, value});
+        }
+        return readings;
+    }
+
+private:
+    struct Value {
+        uint64_t count = 0, time_enabled = 0, time_running = 0;
+    };
+
+    struct Counter {
+        std::string name;
+        int fd;
+        Value start;
+    };
+
+    std::vector<Counter> counters;
+
+#ifdef __linux__
+    void add(const char *name, uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (fd < 0) {
+            info() << "Hardware counter " << name << " is not available";
+            return;
+        }
+        counters.push_back({name, fd, Value()});
+    }
+
+    static Value read_counter(const Counter &c) {
+        Value v;
+        if (read(c.fd, &v, sizeof(v)) != (ssize_t)sizeof(v)) {
+            warn() << "Unable to read hardware counter " << c.name;
+            return Value();
+        }
+        return v;
+    }
+
+    static void enable(const Counter &c, bool on) {
+        ioctl(c.fd, on ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+    }
+#else
+    static Value read_counter(const Counter &c) {
+        return Value();
+    }
+
+    static void enable(const Counter &c, bool on) {
+    }
+#endif
+};
+
 class RunGen {
 public:
     using ArgvCall = int (*)(void **);
@@ -1290,6 +1425,13 @@ public:
             this->device_sync_outputs();
         };
 
+        // Open the counters before the first call, so that they follow
+        // the Halide thread pool threads it creates.
+        std::unique_ptr<HardwareCounters> counters;
+        if (benchmark_counters) {
+            counters = std::make_unique<HardwareCounters>();
+        }
+
         info() << "Benchmarking filter...";
 
         Halide::Tools::BenchmarkConfig config;
@@ -1297,19 +1439,84 @@ public:
         config.max_time = benchmark_min_time * 4;
         auto result = Halide::Tools::benchmark(benchmark_inner, config);
 
-        if (!parsable_output) {
+        // The best case hides the tail, so also time individual calls.
+        // The adaptive benchmark above has already warmed everything up.
+        info() << "Measuring latency distribution...";
+        Halide::Tools::LatencyConfig latency_config;
+        latency_config.warmup_iterations = 0;
+        latency_config.min_time = benchmark_min_time;
+        if (counters) {
+            counters->start();
+        }
+        auto latency = Halide::Tools::benchmark_latency(benchmark_inner, latency_config);
+        std::vector<HardwareCounters::Reading> per_call;
+        if (counters) {
+            per_call = counters_per_call(counters->stop(), latency.iterations);
+        }
+
+        if (json_output) {
+            std::ostringstream o;
+            o << "{\"mode\": \"all\", "
+              << "\"num_threads\": " << default_num_threads() << ", "
+              << "\"best_time_sec\": " << result.wall_time << ", "
+              << "\"samples\": " << result.samples << ", "
+              << "\"iterations\": " << result.iterations << ", "
+              << "\"timing_accuracy\": " << result.accuracy << ", "
+              << "\"throughput_mpix_per_sec\": " << (megapixels_out() / result.wall_time) << ", "
+              << "\"latency\": " << latency_to_json(latency)
+              << counters_to_json(per_call) << "}";
+            json_results.push_back(o.str());
+        } else if (!parsable_output) {
             out() << "Benchmark for " << md->name << " produces best case of " << result.wall_time << " sec/iter (over "
                   << result.samples << " samples, "
                   << result.iterations << " iterations, "
                   << "accuracy " << std::setprecision(2) << (result.accuracy * 100.0) << "%).\n"
-                  << "Best output throughput is " << (megapixels_out() / result.wall_time) << " mpix/sec.\n";
+                  << "Best output throughput is " << (megapixels_out() / result.wall_time) << " mpix/sec.\n"
+                  << std::setprecision(6)
+                  << "Latency per call (over " << latency.iterations << " calls): min " << latency.min * 1000
+                  << " msec, median " << latency.p50 * 1000
+                  << " msec, p90 " << latency.p90 * 1000
+                  << " msec, p99 " << latency.p99 * 1000
+                  << " msec, max " << latency.max * 1000
+                  << " msec, stddev " << std::sqrt(latency.variance) * 1000 << " msec.\n"
+                  << counters_to_string(per_call, "");
         } else {
             out() << md->name << "  BEST_TIME_MSEC_PER_ITER  " << result.wall_time * 1000.f << "\n"
                   << md->name << "  SAMPLES                  " << result.samples << "\n"
                   << md->name << "  ITERATIONS               " << result.iterations << "\n"
                   << md->name << "  TIMING_ACCURACY          " << result.accuracy << "\n"
                   << md->name << "  THROUGHPUT_MPIX_PER_SEC  " << (megapixels_out() / result.wall_time) << "\n"
-                  << md->name << "  HALIDE_TARGET            " << md->target << "\n";
+                  << md->name << "  HALIDE_TARGET            " << md->target << "\n"
+                  << md->name << "  LATENCY_CALLS            " << latency.iterations << "\n"
+                  << md->name << "  P50_LATENCY_MSEC         " << latency.p50 * 1000 << "\n"
+                  << md->name << "  P90_LATENCY_MSEC         " << latency.p90 * 1000 << "\n"
+                  << md->name << "  P99_LATENCY_MSEC         " << latency.p99 * 1000 << "\n"
+                  << md->name << "  MAX_LATENCY_MSEC         " << latency.max * 1000 << "\n"
+                  << md->name << "  STDDEV_LATENCY_MSEC      " << std::sqrt(latency.variance) * 1000 << "\n"
+                  << counters_to_string(per_call, std::string(md->name) + "  ");
+        }
+    }
+
+    // Call the filter from several threads at once, each with its own
+    // copy of the input and output buffers, for at least the given
+    // duration, and report the aggregate throughput and the latency of
+    // individual calls. Every combination of caller count and Halide
+    // thread pool size is measured; a thread pool size of zero means the
+    // default (HL_NUM_THREADS, or the number of cores).
+    void run_for_concurrent_benchmark(double duration,
+                                      const std::vector<int> &caller_counts,
+                                      const std::vector<int> &thread_counts) {
+        std::unique_ptr<HardwareCounters> counters;
+        if (benchmark_counters) {
+            counters = std::make_unique<HardwareCounters>();
+        }
+        for (int num_threads : thread_counts) {
+            if (num_threads > 0) {
+                halide_set_num_threads(num_threads);
+            }
+            for (int num_callers : caller_counts) {
+                run_concurrent_callers(duration, num_callers, num_threads, counters.get());
+            }
         }
     }
 
@@ -1362,6 +1569,252 @@ public:
         }
     }
 
+    void run_concurrent_callers(double duration, int num_callers, int num_threads, HardwareCounters *counters) {
+        // Caller zero uses the existing buffers; the others get copies,
+        // so that no two callers share memory other than through the
+        // Halide runtime.
+        std::vector<std::vector<Buffer<>>> buffers(num_callers);
+        std::vector<std::vector<void *>> filter_argvs(num_callers, build_filter_argv());
+        std::vector<std::vector<Buffer<>>> outputs(num_callers);
+        for (int c = 0; c < num_callers; c++) {
+            // The argv points into these Buffers, so they mustn't move.
+            buffers[c].reserve(args.size());
+            for (auto &arg_pair : args) {
+                auto &arg = arg_pair.second;
+                if (arg.metadata->kind == halide_argument_kind_input_scalar) {
+                    continue;
+                }
+                if (c == 0) {
+                    buffers[c].push_back(arg.buffer_value);
+                } else if (arg.metadata->kind == halide_argument_kind_input_buffer) {
+                    buffers[c].push_back(arg.buffer_value.copy());
+                } else {
+                    buffers[c].push_back(Buffer<>::make_with_shape_of(arg.buffer_value));
+                }
+                filter_argvs[c][arg.index] = buffers[c].back().raw_buffer();
+                if (arg.metadata->kind == halide_argument_kind_output_buffer) {
+                    outputs[c].push_back(buffers[c].back());
+                }
+            }
+        }
+
+        info() << "Benchmarking filter with " << num_callers << " concurrent callers...";
+
+        std::vector<std::vector<double>> latencies(num_callers);
+        std::atomic<int> ready{0};
+        std::atomic<bool> go{false};
+        const auto caller = [&](int c) {
+            ready++;
+            while (!go) {
+                std::this_thread::yield();
+            }
+            const auto start = Halide::Tools::benchmark_now();
+            double elapsed = 0;
+            while (elapsed < duration) {
+                const auto call_start = Halide::Tools::benchmark_now();
+                // Ignore result since our halide_error() should catch everything.
+                (void)halide_argv_call(&filter_argvs[c][0]);
+                for (Buffer<> &b : outputs[c]) {
+                    b.device_sync();
+                }
+                const auto call_end = Halide::Tools::benchmark_now();
+                latencies[c].push_back(Halide::Tools::benchmark_duration_seconds(call_start, call_end));
+                elapsed = Halide::Tools::benchmark_duration_seconds(start, call_end);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int c = 0; c < num_callers; c++) {
+            threads.emplace_back(caller, c);
+        }
+        while (ready < num_callers) {
+            std::this_thread::yield();
+        }
+        if (counters) {
+            counters->start();
+        }
+        const auto start = Halide::Tools::benchmark_now();
+        go = true;
+        for (auto &t : threads) {
+            t.join();
+        }
+        const double wall_time = Halide::Tools::benchmark_duration_seconds(start, Halide::Tools::benchmark_now());
+        std::vector<HardwareCounters::Reading> counter_totals;
+        if (counters) {
+            counter_totals = counters->stop();
+        }
+
+        std::vector<double> all_latencies;
+        for (const auto &l : latencies) {
+            all_latencies.insert(all_latencies.end(), l.begin(), l.end());
+        }
+        const auto latency = Halide::Tools::summarize_latencies(std::move(all_latencies));
+        const uint64_t calls = latency.iterations;
+        const double calls_per_sec = calls / wall_time;
+        const double mpix_per_sec = megapixels_out() * calls_per_sec;
+        const auto per_call = counters_per_call(counter_totals, calls);
+
+        std::string threads_desc = num_threads > 0 ? std::to_string(num_threads) : "default";
+        if (json_output) {
+            std::ostringstream o;
+            o << "{\"mode\": \"concurrent\", "
+              << "\"callers\": " << num_callers << ", "
+              << "\"num_threads\": " << (num_threads > 0 ? num_threads : default_num_threads()) << ", "
+              << "\"calls\": " << calls << ", "
+              << "\"wall_time_sec\": " << wall_time << ", "
+              << "\"throughput_calls_per_sec\": " << calls_per_sec << ", "
+              << "\"throughput_mpix_per_sec\": " << mpix_per_sec << ", "
+              << "\"latency\": " << latency_to_json(latency)
+              << counters_to_json(per_call) << "}";
+            json_results.push_back(o.str());
+        } else if (!parsable_output) {
+            out() << "Concurrent benchmark for " << md->name << " with " << num_callers << " callers and "
+                  << threads_desc << " threads: " << calls << " calls in " << wall_time << " sec.\n"
+                  << "Aggregate throughput is " << calls_per_sec << " calls/sec, "
+                  << mpix_per_sec << " mpix/sec.\n"
+                  << "Latency per call: min " << latency.min * 1000
+                  << " msec, median " << latency.p50 * 1000
+                  << " msec, p90 " << latency.p90 * 1000
+                  << " msec, p99 " << latency.p99 * 1000
+                  << " msec, max " << latency.max * 1000
+                  << " msec, stddev " << std::sqrt(latency.variance) * 1000 << " msec.\n"
+                  << counters_to_string(per_call, "");
+        } else {
+            const std::string prefix = std::string(md->name) + "  CALLERS_" + std::to_string(num_callers) + "_THREADS_" + threads_desc + "  ";
+            out() << prefix << "CALLS                    " << calls << "\n"
+                  << prefix << "THROUGHPUT_CALLS_PER_SEC " << calls_per_sec << "\n"
+                  << prefix << "THROUGHPUT_MPIX_PER_SEC  " << mpix_per_sec << "\n"
+                  << prefix << "MIN_LATENCY_MSEC         " << latency.min * 1000 << "\n"
+                  << prefix << "MEDIAN_LATENCY_MSEC      " << latency.p50 * 1000 << "\n"
+                  << prefix << "P90_LATENCY_MSEC         " << latency.p90 * 1000 << "\n"
+                  << prefix << "P99_LATENCY_MSEC         " << latency.p99 * 1000 << "\n"
+                  << prefix << "MAX_LATENCY_MSEC         " << latency.max * 1000 << "\n"
+                  << prefix << "STDDEV_LATENCY_MSEC      " << std::sqrt(latency.variance) * 1000 << "\n"
+                  << counters_to_string(per_call, prefix);
+        }
+    }
+
+    // Divide hardware counter totals by the number of calls, and add
+    // some derived metrics. There's no portable counter for DRAM
+    // traffic, so it is estimated as one 64-byte cache line per
+    // last-level cache miss.
+    static std::vector<HardwareCounters::Reading> counters_per_call(const std::vector<HardwareCounters::Reading> &totals,
+                                                                    uint64_t calls) {
+        std::vector<HardwareCounters::Reading> per_call;
+        if (calls == 0) {
+            return per_call;
+        }
+        std::map<std::string, double> values;
+        for (const auto &r : totals) {
+            per_call.push_back({r.name, r.value / calls});
+            values[r.name] = r.value / calls;
+        }
+        if (values.count("cycles") && values.count("instructions") && values["cycles"] > 0) {
+            per_call.push_back({"ipc", values["instructions"] / values["cycles"]});
+        }
+        if (values.count("llc_misses")) {
+            per_call.push_back({"dram_bytes_estimate", values["llc_misses"] * 64});
+        }
+        return per_call;
+    }
+
+    // Format per-call counter values for the human-readable output (if
+    // prefix is empty) or the parsable output.
+    static std::string counters_to_string(const std::vector<HardwareCounters::Reading> &per_call,
+                                          const std::string &prefix) {
+        if (per_call.empty()) {
+            return "";
+        }
+        std::ostringstream o;
+        if (prefix.empty()) {
+            o << "Hardware counters per call:";
+            const char *sep = " ";
+            for (const auto &r : per_call) {
+                o << sep << r.name << " " << r.value;
+                sep = ", ";
+            }
+            o << ".\n";
+        } else {
+            for (const auto &r : per_call) {
+                std::string key = r.name + "_PER_CALL";
+                std::transform(key.begin(), key.end(), key.begin(), ::toupper);
+                o << prefix << std::left << std::setw(25) << key << std::right << r.value << "\n";
+            }
+        }
+        return o.str();
+    }
+
+    // Format per-call counter values as an additional field of a JSON
+    // benchmark object, if there are any.
+    static std::string counters_to_json(const std::vector<HardwareCounters::Reading> &per_call) {
+        if (per_call.empty()) {
+            return "";
+        }
+        std::ostringstream o;
+        o << ", \"counters_per_call\": {";
+        const char *sep = "";
+        for (const auto &r : per_call) {
+            o << sep << json_string(r.name) << ": " << r.value;
+            sep = ", ";
+        }
+        o << "}";
+        return o.str();
+    }
+
+    // The size of the Halide thread pool when it hasn't been set
+    // explicitly. The runtime has no way to query this, so mirror its
+    // logic: HL_NUM_THREADS (or the older HL_NUMTHREADS), else the
+    // number of cores.
+    static int default_num_threads() {
+        for (const char *var : {"HL_NUM_THREADS", "HL_NUMTHREADS"}) {
+            const char *value = getenv(var);
+            if (value && *value) {
+                return atoi(value);
+            }
+        }
+        return (int)std::thread::hardware_concurrency();
+    }
+
+    static std::string json_string(const std::string &str) {
+        std::ostringstream o;
+        o << "\"";
+        for (char c : str) {
+            if (c == '"' || c == '\\') {
+                o << '\\' << c;
+            } else if ((unsigned char)c < 0x20) {
+                o << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+            } else {
+                o << c;
+            }
+        }
+        o << "\"";
+        return o.str();
+    }
+
+    // All times are in seconds.
+    static std::string latency_to_json(const Halide::Tools::LatencyResult &latency) {
+        std::ostringstream o;
+        o << std::setprecision(9);
+        o << "{\"calls\": " << latency.iterations << ", "
+          << "\"min\": " << latency.min << ", "
+          << "\"max\": " << latency.max << ", "
+          << "\"mean\": " << latency.mean << ", "
+          << "\"variance\": " << latency.variance << ", "
+          << "\"p50\": " << latency.p50 << ", "
+          << "\"p90\": " << latency.p90 << ", "
+          << "\"p99\": " << latency.p99 << ", "
+          << "\"histogram\": {\"edges\": [";
+        for (size_t i = 0; i < latency.histogram_edges.size(); i++) {
+            o << (i > 0 ? ", " : "") << latency.histogram_edges[i];
+        }
+        o << "], \"counts\": [";
+        for (size_t i = 0; i < latency.histogram_counts.size(); i++) {
+            o << (i > 0 ? ", " : "") << latency.histogram_counts[i];
+        }
+        o << "]}}";
+        return o.str();
+    }
+
     std::vector<void *> build_filter_argv() {
         std::vector<void *> filter_argv(args.size(), nullptr);
         for (auto &arg_pair : args) {
@@ -1391,6 +1844,64 @@ public:
         this->parsable_output = parsable_output;
     }
 
+    void set_json_output(bool json_output = true) {
+        this->json_output = json_output;
+    }
+
+    void set_benchmark_counters(bool benchmark_counters = true) {
+        this->benchmark_counters = benchmark_counters;
+    }
+
+    // If JSON output was requested, emit a single JSON object describing
+    // the filter, its arguments, and the results of any benchmarks run.
+    // The schema is versioned so that tools consuming it can detect
+    // incompatible changes; fields may be added without bumping it.
+    void emit_json() const {
+        if (!json_output) {
+            return;
+        }
+        std::ostringstream o;
+        o << "{\n"
+          << "  \"schema_version\": 1,\n"
+          << "  \"name\": " << json_string(md->name) << ",\n"
+          << "  \"target\": " << json_string(md->target) << ",\n"
+          << "  \"num_threads\": " << default_num_threads() << ",\n"
+          << "  \"output_mpix\": " << megapixels_out() << ",\n"
+          << "  \"arguments\": [";
+        // Emit the arguments in declaration order.
+        std::vector<const ArgData *> ordered(args.size(), nullptr);
+        for (const auto &arg_pair : args) {
+            ordered[arg_pair.second.index] = &arg_pair.second;
+        }
+        const char *sep = "\n";
+        for (const ArgData *arg : ordered) {
+            o << sep << "    {\"name\": " << json_string(arg->name) << ", ";
+            switch (arg->metadata->kind) {
+            case halide_argument_kind_input_scalar:
+                o << "\"kind\": \"input_scalar\", \"type\": \"" << arg->metadata->type << "\"}";
+                break;
+            case halide_argument_kind_input_buffer:
+            case halide_argument_kind_output_buffer:
+                o << "\"kind\": \""
+                  << (arg->metadata->kind == halide_argument_kind_input_buffer ? "input_buffer" : "output_buffer")
+                  << "\", \"type\": \"" << arg->metadata->type << "\", "
+                  << "\"shape\": " << get_shape(arg->buffer_value) << "}";
+                break;
+            }
+            sep = ",\n";
+        }
+        o << "\n  ],\n"
+          << "  \"benchmarks\": [";
+        sep = "\n";
+        for (const std::string &r : json_results) {
+            o << sep << "    " << r;
+            sep = ",\n";
+        }
+        o << "\n  ]\n"
+          << "}\n";
+        out() << o.str();
+    }
+
 private:
     static void rungen_ignore_error(void *user_context, const char *message) {
         // nothing
@@ -1464,6 +1975,9 @@ private:
     std::map<std::string, ArgData> args;
     std::map<std::string, Shape> output_shapes;
     bool parsable_output = false;
+    bool json_output = false;
+    bool benchmark_counters = false;
+    std::vector<std::string> json_results;
 };
 
 }  // namespace RunGen
@@ -138,10 +138,35 @@ Flags:
         runs "samples" sets of "iterations" each, and chooses the fastest
         sample set.
 
+    --benchmarks=concurrent:
+        Instead of timing one call at a time, call the filter from several
+        threads at once (each with its own copies of the inputs and outputs)
+        for --benchmark_min_time seconds, and report the aggregate throughput
+        and the latency of individual calls. This is repeated for each
+        combination of --benchmark_callers and --benchmark_threads.
+
     --benchmark_min_time=DURATION_SECONDS [default = 0.1]:
         Override the default minimum desired benchmarking time; ignored if
         --benchmarks is not also specified.
 
+    --benchmark_callers=NUM,NUM,... [default = 1,NUMBER_OF_CORES]:
+        The numbers of concurrent callers to measure with
+        --benchmarks=concurrent.
+
+    --benchmark_threads=NUM,NUM,... [default = 0]:
+        The sizes of the Halide thread pool to measure with
+        --benchmarks=concurrent, as if set with HL_NUM_THREADS. Zero means
+        the default (HL_NUM_THREADS if set, otherwise the number of cores).
+
+    --benchmark_counters:
+        With --benchmarks, also count hardware events with perf_event (Linux
+        only) while timing, and report per-call averages of cycles,
+        instructions, instructions per cycle, last-level cache misses, and an
+        estimate of DRAM traffic (64 bytes per cache miss). Counters the
+        machine or kernel doesn't allow are omitted; only user-space events
+        are counted, so that this works at the default perf_event_paranoid
+        setting.
+
     --track_memory:
         Override Halide memory allocator to track high-water mark of memory
         allocation during run; note that this may slow down execution, so
@@ -160,6 +185,16 @@ Flags:
         Final output is emitted in an easy-to-parse output (one value per line),
         rather than easy-for-humans.
 
+    --json_output:
+        Final output is emitted as a single JSON object on stdout, rather than
+        easy-for-humans. The object has a "schema_version" field (currently 1),
+        the filter "name" and "target", the Halide "num_threads", the
+        "arguments" (with the type and [min,extent,stride] shape of each
+        buffer), and a list of "benchmarks", one per benchmark run. Each
+        benchmark reports the distribution of the latency of individual calls
+        (calls, min, max, mean, variance, p50, p90, p99 and a histogram, all
+        in seconds), measured after warmup runs.
+
     --estimate_all:
         Request that all inputs and outputs are based on estimate,
         and fill buffers with random values. This is exactly equivalent to
@@ -402,6 +437,8 @@ int main(int argc, char **argv) {
     std::string default_input_buffers;
     std::string default_input_scalars;
     std::string benchmarks_flag_value;
+    std::vector<int> benchmark_callers = {1, (int)std::max(1u, std::thread::hardware_concurrency())};
+    std::vector<int> benchmark_threads = {0};
     bool emit_success = false;
     bool skip_bad_environment = false;
     for (int i = 1; i < argc; ++i) {
@@ -443,6 +480,15 @@ int main(int argc, char **argv) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
                 r.set_parsable_output(parsable_output);
+            } else if (flag_name == "json_output") {
+                if (flag_value.empty()) {
+                    flag_value = "true";
+                }
+                bool json_output;
+                if (!parse_scalar(flag_value, &json_output)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+                r.set_json_output(json_output);
             } else if (flag_name == "describe") {
                 if (flag_value.empty()) {
                     flag_value = "true";
@@ -464,6 +510,25 @@ int main(int argc, char **argv) {
                 if (!parse_scalar(flag_value, &benchmark_min_time)) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
+            } else if (flag_name == "benchmark_counters") {
+                if (flag_value.empty()) {
+                    flag_value = "true";
+                }
+                bool benchmark_counters;
+                if (!parse_scalar(flag_value, &benchmark_counters)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+                r.set_benchmark_counters(benchmark_counters);
+            } else if (flag_name == "benchmark_callers" || flag_name == "benchmark_threads") {
+                std::vector<int> &counts = (flag_name == "benchmark_callers") ? benchmark_callers : benchmark_threads;
+                counts.clear();
+                for (const std::string &count : split_string(flag_value, ",")) {
+                    int n = 0;
+                    if (!parse_scalar(count, &n) || n < 0 || (n == 0 && flag_name == "benchmark_callers")) {
+                        fail() << "Invalid value for flag: " << flag_name;
+                    }
+                    counts.push_back(n);
+                }
             } else if (flag_name == "default_input_buffers") {
                 default_input_buffers = flag_value;
                 if (default_input_buffers.empty()) {
@@ -613,10 +678,13 @@ int main(int argc, char **argv) {
         if (benchmarks_flag_value.empty()) {
             benchmarks_flag_value = "all";
         }
-        if (benchmarks_flag_value != "all") {
-            fail() << "The only valid value for --benchmarks is 'all'";
+        if (benchmarks_flag_value == "all") {
+            r.run_for_benchmark(benchmark_min_time);
+        } else if (benchmarks_flag_value == "concurrent") {
+            r.run_for_concurrent_benchmark(benchmark_min_time, benchmark_callers, benchmark_threads);
+        } else {
+            fail() << "The only valid values for --benchmarks are 'all' and 'concurrent'";
         }
-        r.run_for_benchmark(benchmark_min_time);
     } else {
         r.run_for_output();
     }
@@ -634,6 +702,8 @@ int main(int argc, char **argv) {
     // Save the output(s), if necessary.
     r.save_outputs();
 
+    r.emit_json();
+
     if (emit_success) {
         std::cout << "Success!\n";
     }
@@ -4,8 +4,10 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cmath>
 #include <functional>
 #include <limits>
+#include <vector>
 
 #if defined(__EMSCRIPTEN__)
 #include <emscripten.h>
@@ -234,6 +236,111 @@ inline BenchmarkResult benchmark(const std::function<void()> &op, const Benchmar
     return result;
 }
 
+// The distribution of the latencies of individual runs of an operation,
+// for when the tail matters as well as the best case.
+struct LatencyResult {
+    // Number of runs measured (not including warmup runs).
+    uint64_t iterations{0};
+
+    // Statistics of the time per run (seconds).
+    double min{0}, max{0};
+    double mean{0}, variance{0};
+    double p50{0}, p90{0}, p99{0};
+
+    // A histogram of the time per run, with equal-width buckets between
+    // min and max. Bucket i counts the runs that took between
+    // histogram_edges[i] and histogram_edges[i + 1] seconds.
+    std::vector<double> histogram_edges;
+    std::vector<uint64_t> histogram_counts;
+};
+
+// Compute the distribution of a set of measured latencies (in seconds).
+inline LatencyResult summarize_latencies(std::vector<double> latencies, int histogram_buckets = 20) {
+    LatencyResult result;
+    if (latencies.empty()) {
+        return result;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const size_t n = latencies.size();
+    // Nearest-rank percentiles.
+    const auto percentile = [&](double p) {
+        size_t rank = (size_t)std::ceil(p * n);
+        return latencies[std::min(n - 1, rank > 0 ? rank - 1 : 0)];
+    };
+
+    result.iterations = n;
+    result.min = latencies.front();
+    result.max = latencies.back();
+    result.p50 = percentile(0.5);
+    result.p90 = percentile(0.9);
+    result.p99 = percentile(0.99);
+    double sum = 0;
+    for (double t : latencies) {
+        sum += t;
+    }
+    result.mean = sum / n;
+    double sum_sq = 0;
+    for (double t : latencies) {
+        sum_sq += (t - result.mean) * (t - result.mean);
+    }
+    result.variance = n > 1 ? sum_sq / (n - 1) : 0;
+
+    histogram_buckets = std::max(1, histogram_buckets);
+    const double width = (result.max - result.min) / histogram_buckets;
+    for (int i = 0; i <= histogram_buckets; i++) {
+        result.histogram_edges.push_back(result.min + width * i);
+    }
+    result.histogram_counts.resize(histogram_buckets, 0);
+    for (double t : latencies) {
+        int bucket = width > 0 ? (int)((t - result.min) / width) : 0;
+        result.histogram_counts[std::min(bucket, histogram_buckets - 1)]++;
+    }
+    return result;
+}
+
+struct LatencyConfig {
+    // Runs to do before measuring anything, to warm up caches, thread
+    // pools, device allocations, etc.
+    uint64_t warmup_iterations{1};
+
+    // Keep measuring until at least this much time (in seconds) has
+    // been spent on measured runs...
+    double min_time{0.1};
+
+    // ...and at least this many runs have been measured...
+    uint64_t min_iterations{10};
+
+    // ...but never measure more than this many runs.
+    uint64_t max_iterations{1000000};
+
+    // The number of buckets in the histogram.
+    int histogram_buckets{20};
+};
+
+// Benchmark the operation 'op' by timing each run individually, and
+// return the distribution of the time per run. Unlike benchmark(), this
+// can't amortize timer overhead across iterations, so it is not suitable
+// for operations that take less than a few microseconds.
+//
+// The same caveats about GPU code apply as for benchmark().
+inline LatencyResult benchmark_latency(const std::function<void()> &op, const LatencyConfig &config = {}) {
+    for (uint64_t i = 0; i < config.warmup_iterations; i++) {
+        op();
+    }
+    std::vector<double> latencies;
+    double total_time = 0;
+    while (latencies.size() < config.max_iterations &&
+           (total_time < config.min_time || latencies.size() < config.min_iterations)) {
+        auto start = benchmark_now();
+        op();
+        auto end = benchmark_now();
+        double elapsed_seconds = benchmark_duration_seconds(start, end);
+        latencies.push_back(elapsed_seconds);
+        total_time += elapsed_seconds;
+    }
+    return summarize_latencies(std::move(latencies), config.histogram_buckets);
+}
+
 }  // namespace Tools
 }  // namespace Halide
 
@@ -31,7 +31,15 @@
 #include "jpeglib.h"
 #endif
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "HalideRuntime.h"  // for halide_type_t
+#include "halide_thread_pool.h"
 
 namespace Halide {
 namespace Tools {
@@ -702,20 +710,33 @@ template<typename ElemType, typename ImageType>
 void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
     auto im_typed = im->template as<ElemType, AnyDims>();
     const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
+    const int width = im_typed.dim(0).extent();
+    const ptrdiff_t x_stride = im_typed.dim(0).stride();
+    int channels = 1;
+    ptrdiff_t c_stride = 0;
+    ElemType *dst_row;
     if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                im_typed(x, y, c + cmin) = read_big_endian<ElemType>(src);
-                src += sizeof(ElemType);
-            }
-        }
+        channels = im_typed.dim(2).extent();
+        c_stride = im_typed.dim(2).stride();
+        dst_row = &im_typed(xmin, y, im_typed.dim(2).min());
     } else {
-        for (int x = xmin; x <= xmax; x++) {
-            im_typed(x, y) = read_big_endian<ElemType>(src);
-            src += sizeof(ElemType);
+        dst_row = &im_typed(xmin, y);
+    }
+    // Deinterleave one channel at a time using raw pointers, so that
+    // for the usual planar layout the stores are dense and the loop
+    // can be vectorized.
+    const size_t src_stride = channels * sizeof(ElemType);
+    for (int c = 0; c < channels; c++) {
+        ElemType *dst = dst_row + c * c_stride;
+        const uint8_t *s = src + c * sizeof(ElemType);
+        if (x_stride == 1) {
+            for (int x = 0; x < width; x++) {
+                dst[x] = read_big_endian<ElemType>(s + x * src_stride);
+            }
+        } else {
+            for (int x = 0; x < width; x++) {
+                dst[x * x_stride] = read_big_endian<ElemType>(s + x * src_stride);
+            }
         }
     }
 }
@@ -726,20 +747,31 @@ template<typename ElemType, typename ImageType>
 void write_big_endian_row(const ImageType &im, int y, uint8_t *dst) {
     auto im_typed = im.template as<typename std::add_const<ElemType>::type, AnyDims>();
     const int xmin = im_typed.dim(0).min();
-    const int xmax = im_typed.dim(0).max();
+    const int width = im_typed.dim(0).extent();
+    const ptrdiff_t x_stride = im_typed.dim(0).stride();
+    int channels = 1;
+    ptrdiff_t c_stride = 0;
+    const ElemType *src_row;
     if (im_typed.dimensions() > 2) {
-        const int cmin = im_typed.dim(2).min();
-        const int cmax = im_typed.dim(2).max();
-        for (int x = xmin; x <= xmax; x++) {
-            for (int c = cmin; c <= cmax; c++) {
-                write_big_endian<ElemType>(im_typed(x, y, c), dst);
-                dst += sizeof(ElemType);
-            }
-        }
+        channels = im_typed.dim(2).extent();
+        c_stride = im_typed.dim(2).stride();
+        src_row = &im_typed(xmin, y, im_typed.dim(2).min());
     } else {
-        for (int x = xmin; x <= xmax; x++) {
-            write_big_endian<ElemType>(im_typed(x, y), dst);
-            dst += sizeof(ElemType);
+        src_row = &im_typed(xmin, y);
+    }
+    // Interleave one channel at a time, as in read_big_endian_row.
+    const size_t dst_stride = channels * sizeof(ElemType);
+    for (int c = 0; c < channels; c++) {
+        const ElemType *src = src_row + c * c_stride;
+        uint8_t *d = dst + c * sizeof(ElemType);
+        if (x_stride == 1) {
+            for (int x = 0; x < width; x++) {
+                write_big_endian<ElemType>(src[x], d + x * dst_stride);
+            }
+        } else {
+            for (int x = 0; x < width; x++) {
+                write_big_endian<ElemType>(src[x * x_stride], d + x * dst_stride);
+            }
         }
     }
 }
@@ -1198,6 +1230,25 @@ bool buffer_is_compact_planar(ImageType &im) {
     return true;
 }
 
+// Read the header of a .tmp file, leaving f at the start of the payload.
+template<CheckFunc check = CheckReturn>
+bool read_tmp_header(FileOpener &f, halide_type_t *type, std::vector<int> *extents) {
+    int32_t header[5];
+    if (!check(f.read_array(header), "Count not read .tmp header")) {
+        return false;
+    }
+
+    if (!check(header[0] > 0 && header[1] > 0 && header[2] > 0 && header[3] > 0 &&
+                   header[4] >= 0 && header[4] < kNumTmpCodes,
+               "Bad header on .tmp file")) {
+        return false;
+    }
+
+    *type = tmp_code_to_halide_type()[header[4]];
+    *extents = {header[0], header[1], header[2], header[3]};
+    return true;
+}
+
 // ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
 template<typename ImageType, CheckFunc check = CheckReturn>
 bool load_tmp(const std::string &filename, ImageType *im) {
@@ -1208,19 +1259,11 @@ bool load_tmp(const std::string &filename, ImageType *im) {
         return false;
     }
 
-    int32_t header[5];
-    if (!check(f.read_array(header), "Count not read .tmp header")) {
-        return false;
-    }
-
-    if (!check(header[0] > 0 && header[1] > 0 && header[2] > 0 && header[3] > 0 &&
-                   header[4] >= 0 && header[4] < kNumTmpCodes,
-               "Bad header on .tmp file")) {
+    halide_type_t im_type;
+    std::vector<int> im_dimensions;
+    if (!read_tmp_header<check>(f, &im_type, &im_dimensions)) {
         return false;
     }
-
-    const halide_type_t im_type = tmp_code_to_halide_type()[header[4]];
-    std::vector<int> im_dimensions = {header[0], header[1], header[2], header[3]};
     *im = ImageType(im_type, im_dimensions);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
@@ -1347,15 +1390,9 @@ enum MatlabClassCode {
     mxUINT64_CLASS = 15
 };
 
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool load_mat(const std::string &filename, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    FileOpener f(filename, "rb");
-    if (!check(f.f != nullptr, "File could not be opened for reading")) {
-        return false;
-    }
-
+// Read the headers of a .mat file, leaving f at the start of the payload.
+template<CheckFunc check = CheckReturn>
+bool read_mat_header(FileOpener &f, halide_type_t *type, std::vector<int> *extents) {
     uint8_t header[128];
     if (!check(f.read_array(header), "Could not read .mat header\n")) {
         return false;
@@ -1388,8 +1425,8 @@ bool load_mat(const std::string &filename, ImageType *im) {
         return false;
     }
     int dims = shape_header[1] / 4;
-    std::vector<int> extents(dims);
-    if (!check(f.read_vector(&extents), "Could not read .mat header\n")) {
+    extents->resize(dims);
+    if (!check(f.read_vector(extents), "Could not read .mat header\n")) {
         return false;
     }
     if (dims & 1) {
@@ -1423,40 +1460,56 @@ bool load_mat(const std::string &filename, ImageType *im) {
     if (!check(f.read_array(payload_header), "Could not read .mat header\n")) {
         return false;
     }
-    halide_type_t type;
     switch (payload_header[0]) {
     case miINT8:
-        type = halide_type_of<int8_t>();
+        *type = halide_type_of<int8_t>();
         break;
     case miINT16:
-        type = halide_type_of<int16_t>();
+        *type = halide_type_of<int16_t>();
         break;
     case miINT32:
-        type = halide_type_of<int32_t>();
+        *type = halide_type_of<int32_t>();
         break;
     case miINT64:
-        type = halide_type_of<int64_t>();
+        *type = halide_type_of<int64_t>();
         break;
     case miUINT8:
-        type = halide_type_of<uint8_t>();
+        *type = halide_type_of<uint8_t>();
         break;
     case miUINT16:
-        type = halide_type_of<uint16_t>();
+        *type = halide_type_of<uint16_t>();
         break;
     case miUINT32:
-        type = halide_type_of<uint32_t>();
+        *type = halide_type_of<uint32_t>();
         break;
     case miUINT64:
-        type = halide_type_of<uint64_t>();
+        *type = halide_type_of<uint64_t>();
         break;
     case miSINGLE:
-        type = halide_type_of<float>();
+        *type = halide_type_of<float>();
         break;
     case miDOUBLE:
-        type = halide_type_of<double>();
+        *type = halide_type_of<double>();
         break;
     }
 
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_mat(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+
+    halide_type_t type;
+    std::vector<int> extents;
+    if (!read_mat_header<check>(f, &type, &extents)) {
+        return false;
+    }
     *im = ImageType(type, extents);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
@@ -1687,6 +1740,117 @@ bool save_mat(ImageType &im, const std::string &filename) {
     return true;
 }
 
+#ifdef _WIN32
+constexpr bool kCanMapFiles = false;
+#else
+constexpr bool kCanMapFiles = true;
+
+struct MappedFile {
+    void *addr;
+    size_t length;
+
+    static void unmap(void *context) {
+        MappedFile *m = (MappedFile *)context;
+        munmap(m->addr, m->length);
+        delete m;
+    }
+};
+#endif
+
+// Make *im a compact planar image of the given type and extents that
+// aliases the bytes of the open file starting at the given offset,
+// mapped into memory. The image owns the mapping, which is released
+// when the last image referring to it is destroyed. If writable, stores
+// to the image are written back to the file; otherwise they are
+// private to the process.
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool map_file_into_image(FileOpener &f, size_t offset, const halide_type_t &type,
+                         const std::vector<int> &extents, bool writable, ImageType *im) {
+#ifdef _WIN32
+    return check(false, "Memory-mapping files is not supported on Windows");
+#else
+    size_t size = type.bytes();
+    for (int e : extents) {
+        size *= e;
+    }
+    if (!check(size > 0, "Cannot memory-map an empty image")) {
+        return false;
+    }
+    if (!check(offset % type.bytes() == 0, "Image payload is not aligned to its element size")) {
+        return false;
+    }
+
+    int fd = fileno(f.f);
+    struct stat st;
+    if (!check(fstat(fd, &st) == 0, "Could not stat file")) {
+        return false;
+    }
+    if (writable && (size_t)st.st_size < offset + size) {
+        if (!check(ftruncate(fd, offset + size) == 0, "Could not resize file")) {
+            return false;
+        }
+    } else if (!check((size_t)st.st_size >= offset + size, "File is too small for its image payload")) {
+        return false;
+    }
+
+    // mmap() requires the offset to be a multiple of the page size.
+    const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t map_offset = offset - offset % page_size;
+    const size_t length = size + (offset - map_offset);
+    void *addr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                      writable ? MAP_SHARED : MAP_PRIVATE, fd, (off_t)map_offset);
+    if (!check(addr != MAP_FAILED, "mmap() failed")) {
+        return false;
+    }
+
+    *im = ImageType(type, (uint8_t *)addr + (offset - map_offset), extents);
+    im->take_ownership_of_host(MappedFile::unmap, new MappedFile{addr, length});
+    return true;
+#endif
+}
+
+// Memory-map the payload of a .tmp or .mat file. If the file is in
+// another format or its layout can't be mapped, sets *mapped to false and
+// leaves *im untouched, so that the caller can fall back to copying.
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool try_map_image(const std::string &filename, ImageType *im, bool *mapped) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    *mapped = false;
+    const std::string ext = get_lowercase_extension(filename);
+    if (!kCanMapFiles || (ext != "tmp" && ext != "mat")) {
+        return true;
+    }
+
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+
+    halide_type_t type;
+    std::vector<int> extents;
+    if (ext == "tmp") {
+        if (!read_tmp_header<check>(f, &type, &extents)) {
+            return false;
+        }
+    } else {
+        if (!read_mat_header<check>(f, &type, &extents)) {
+            return false;
+        }
+    }
+
+    const long offset = ftell(f.f);
+    if (offset < 0 || offset % type.bytes() != 0) {
+        // e.g. 64-bit elements in a .tmp file, which follow a 20-byte header.
+        return true;
+    }
+    if (!map_file_into_image<ImageType, check>(f, (size_t)offset, type, extents, false, im)) {
+        return false;
+    }
+    *mapped = true;
+    return true;
+}
+
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
 bool load_tiff(const std::string &filename, ImageType *im) {
     static_assert(!ImageType::has_static_halide_type, "");
@@ -2293,6 +2457,116 @@ bool save_query(const std::string &filename, std::set<FormatInfo> *info) {
     return true;
 }
 
+// Load the Image from the given .tmp or .mat file by mapping the file into
+// memory instead of reading it, so that the Image aliases the file's
+// contents and pages are only read in as they are accessed. Writes to the
+// Image are not written back to the file. If the file is in another format,
+// or its payload can't be mapped (e.g. it isn't aligned to the element
+// size, or this is Windows), this falls back to load(), which copies.
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_mmap(const std::string &filename, ImageType *im) {
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+    DynamicImageType im_d;
+    bool mapped = false;
+    if (!Internal::try_map_image<DynamicImageType, check>(filename, &im_d, &mapped)) {
+        return false;
+    }
+    if (!mapped) {
+        return load<ImageType, check>(filename, im);
+    }
+    if (ImageType::has_static_halide_type) {
+        const halide_type_t expected_type = ImageType::static_halide_type();
+        if (!check(im_d.type() == expected_type, "Image loaded did not match the expected type")) {
+            return false;
+        }
+    }
+    *im = im_d.template as<typename ImageType::ElemType, Internal::AnyDims>();
+    im->set_host_dirty();
+    return true;
+}
+
+// Load a headerless file of densely-packed planar elements of the given type
+// and extents, starting at the given byte offset, by mapping it into memory.
+// Falls back to reading the file if it can't be mapped.
+// Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_raw_mmap(const std::string &filename, const halide_type_t &type,
+                   const std::vector<int> &extents, ImageType *im, size_t offset = 0) {
+    if (ImageType::has_static_halide_type) {
+        if (!check(type == ImageType::static_halide_type(), "Requested type did not match the image type")) {
+            return false;
+        }
+    }
+
+    Internal::FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+    if (Internal::kCanMapFiles && offset % type.bytes() == 0) {
+        return Internal::map_file_into_image<ImageType, check>(f, offset, type, extents, false, im);
+    }
+
+    *im = ImageType(type, extents);
+    if (!check(fseek(f.f, (long)offset, SEEK_SET) == 0 &&
+                   f.read_bytes(im->begin(), im->size_in_bytes()),
+               "Could not read raw payload")) {
+        return false;
+    }
+    im->set_host_dirty();
+    return true;
+}
+
+// Create a file of the given type and extents, and make *im an Image of
+// that shape that aliases the file's payload mapped into memory, so that
+// anything written to the Image (e.g. the output of a pipeline) ends up in
+// the file without an additional copy. Files with a .tmp extension get a
+// .tmp header (so at most 4 dimensions, and 64-bit types cannot be mapped);
+// anything else is written as raw, headerless planar data. The file is
+// complete once the last reference to the Image is dropped. Not supported
+// on Windows. Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool create_mmap(const std::string &filename, const halide_type_t &type,
+                 const std::vector<int> &extents, ImageType *im) {
+    if (ImageType::has_static_halide_type) {
+        if (!check(type == ImageType::static_halide_type(), "Requested type did not match the image type")) {
+            return false;
+        }
+    }
+
+    Internal::FileOpener f(filename, "w+b");
+    if (!check(f.f != nullptr, "File could not be opened for writing")) {
+        return false;
+    }
+
+    size_t offset = 0;
+    if (Internal::get_lowercase_extension(filename) == "tmp") {
+        int32_t header[5] = {1, 1, 1, 1, -1};
+        if (!check(extents.size() <= 4, "Too many dimensions for .tmp file")) {
+            return false;
+        }
+        for (size_t i = 0; i < extents.size(); i++) {
+            header[i] = extents[i];
+        }
+        const auto *table = Internal::tmp_code_to_halide_type();
+        for (int i = 0; i < Internal::kNumTmpCodes; i++) {
+            if (type == table[i]) {
+                header[4] = i;
+                break;
+            }
+        }
+        if (!check(header[4] >= 0, "Unsupported type for .tmp file")) {
+            return false;
+        }
+        if (!check(f.write_array(header) && fflush(f.f) == 0, "Could not write .tmp header")) {
+            return false;
+        }
+        offset = sizeof(header);
+    }
+
+    return Internal::map_file_into_image<ImageType, check>(f, offset, type, extents, true, im);
+}
+
 // Fancy wrapper to call load() with CheckFail, inferring the return type;
 // this allows you to simply use
 //
@@ -2390,6 +2664,64 @@ void convert_and_save_image(ImageType &im, const std::string &filename) {
     }
 }
 
+// Load a batch of images concurrently, each as load() would, on a pool of
+// num_threads threads (by default, one per processor). PNG and JPEG decoding
+// is single-threaded per file, so this is the way to use more than one
+// core for them. Returns false if any of the loads failed.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_batch(const std::vector<std::string> &filenames, std::vector<ImageType> *images,
+                size_t num_threads = ThreadPool<bool>::num_processors_online()) {
+    images->clear();
+    images->resize(filenames.size());
+    if (filenames.empty()) {
+        return true;
+    }
+    bool success = true;
+    std::vector<std::future<bool>> results;
+    {
+        ThreadPool<bool> pool(std::max<size_t>(1, std::min(num_threads, filenames.size())));
+        for (size_t i = 0; i < filenames.size(); i++) {
+            results.push_back(pool.async([&filenames, images, i]() {
+                return load<ImageType, check>(filenames[i], &(*images)[i]);
+            }));
+        }
+        // The pool drops any jobs not yet started when it is destroyed,
+        // so wait for them all here.
+        for (auto &r : results) {
+            success &= r.get();
+        }
+    }
+    return success;
+}
+
+// Save a batch of images concurrently, each as save() would, on a pool of
+// num_threads threads (by default, one per processor). Returns false if any
+// of the saves failed.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool save_batch(std::vector<ImageType> &images, const std::vector<std::string> &filenames,
+                size_t num_threads = ThreadPool<bool>::num_processors_online()) {
+    if (!check(images.size() == filenames.size(), "save_batch() needs one filename per image")) {
+        return false;
+    }
+    if (images.empty()) {
+        return true;
+    }
+    bool success = true;
+    std::vector<std::future<bool>> results;
+    {
+        ThreadPool<bool> pool(std::max<size_t>(1, std::min(num_threads, images.size())));
+        for (size_t i = 0; i < images.size(); i++) {
+            results.push_back(pool.async([&filenames, &images, i]() {
+                return save<ImageType, check>(images[i], filenames[i]);
+            }));
+        }
+        for (auto &r : results) {
+            success &= r.get();
+        }
+    }
+    return success;
+}
+
 }  // namespace Tools
 }  // namespace Halide
 
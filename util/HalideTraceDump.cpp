@@ -277,7 +277,8 @@ void usage(char *const *argv) {
         "Funcs into individual image files in the current directory.\n"
         "To generate a suitable binary trace, use Func::trace_stores(), or the\n"
         "target features trace_stores and trace_realizations, and run with\n"
-        "HL_TRACE_FILE=<filename>.\n";
+        "HL_TRACE_FILE=<filename>. Traces written with HL_TRACE_COMPRESS=1\n"
+        "are decoded automatically.\n";
     fprintf(stderr, "%s\n", usage.c_str());
     exit(1);
 }
@@ -325,6 +326,8 @@ int main(int argc, char *const *argv) {
         exit(1);
     }
 
+    TraceReader reader(file_desc);
+
     printf("[INFO] Starting parse of binary trace...\n");
     int packet_count = 0;
 
@@ -334,7 +337,7 @@ int main(int argc, char *const *argv) {
 
     for (;;) {
         Packet p;
-        if (!p.read_from_filedesc(file_desc)) {
+        if (!p.read_from(reader)) {
             printf("[INFO] Finished pass 1 after %d packets.\n", packet_count);
             break;
         }
@@ -356,7 +359,7 @@ int main(int argc, char *const *argv) {
     }
 
     packet_count = 0;
-    fseek(file_desc, 0, SEEK_SET);
+    reader.rewind();
     if (ferror(file_desc)) {
         fprintf(stderr, "Error: couldn't seek back to beginning of trace file. Aborting.\n");
         exit(1);
@@ -368,7 +371,7 @@ int main(int argc, char *const *argv) {
 
     for (;;) {
         Packet p;
-        if (!p.read_from_filedesc(file_desc)) {
+        if (!p.read_from(reader)) {
             printf("[INFO] Finished pass 2 after %d packets.\n", packet_count);
             if (file_desc != nullptr) {
                 fclose(file_desc);
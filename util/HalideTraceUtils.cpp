@@ -7,29 +7,240 @@
 namespace Halide {
 namespace Internal {
 
-bool Packet::read_from_stdin() {
-    return read_from_filedesc(stdin);
+namespace {
+
+// These must match the encoder in src/runtime/tracing.cpp.
+const uint32_t block_magic = 0x315a5448;  // "HTZ1"
+const uint32_t flag_reset = 1;
+const uint32_t flag_lz = 2;
+const int max_delta_coords = 16;
+
+void corrupt_stream(const char *msg) {
+    fprintf(stderr, "Corrupt compressed trace stream: %s\n", msg);
+    exit(1);
 }
 
-bool Packet::read_from_filedesc(FILE *fdesc) {
-    size_t header_size = sizeof(halide_trace_packet_t);
-    if (!Packet::read(this, header_size, fdesc)) {
-        return false;
+// Decompress the LZ77-style blocks produced by the trace encoder.
+void lz_decompress(const uint8_t *src, size_t size, std::vector<uint8_t> &dst) {
+    const uint8_t *end = src + size;
+    auto get_length = [&](uint32_t len) {
+        if (len == 15) {
+            uint8_t b;
+            do {
+                if (src >= end) {
+                    corrupt_stream("truncated length");
+                }
+                b = *src++;
+                len += b;
+            } while (b == 255);
+        }
+        return len;
+    };
+    while (src < end) {
+        uint8_t token = *src++;
+        uint32_t num_literals = get_length(token >> 4);
+        if (num_literals > (size_t)(end - src)) {
+            corrupt_stream("truncated literals");
+        }
+        dst.insert(dst.end(), src, src + num_literals);
+        src += num_literals;
+        if (src == end) {
+            break;
+        }
+        if (end - src < 2) {
+            corrupt_stream("truncated offset");
+        }
+        uint32_t offset = src[0] | (src[1] << 8);
+        src += 2;
+        uint32_t match_len = get_length(token & 15) + 4;
+        if (offset == 0 || offset > dst.size()) {
+            corrupt_stream("bad match offset");
+        }
+        // The match may overlap the bytes it produces.
+        size_t from = dst.size() - offset;
+        for (uint32_t i = 0; i < match_len; i++) {
+            dst.push_back(dst[from + i]);
+        }
     }
-    size_t payload_size = size - header_size;
-    if (payload_size > sizeof(payload)) {
-        fprintf(stderr, "Payload larger than %d bytes in trace stream (%d)\n", (int)sizeof(payload), (int)payload_size);
-        abort();
-        return false;
+}
+
+}  // namespace
+
+void TraceReader::rewind() {
+    fseek(fdesc, 0, SEEK_SET);
+    block.clear();
+    block_pos = 0;
+    reset_stream();
+}
+
+void TraceReader::reset_stream() {
+    strings.clear();
+    last_coords.clear();
+    last_id = 0;
+}
+
+bool TraceReader::read(halide_trace_packet_t *p, size_t capacity) {
+    while (block_pos == block.size()) {
+        block.clear();
+        block_pos = 0;
+        uint32_t word;
+        if (!read_bytes(&word, sizeof(word))) {
+            return false;
+        }
+        if (word == block_magic) {
+            uint32_t header[3];
+            if (!read_bytes(header, sizeof(header)) ||
+                !read_block(header[0], header[1], header[2])) {
+                fprintf(stderr, "Unexpected EOF mid-block\n");
+                return false;
+            }
+            continue;
+        }
+
+        // A plain packet.
+        size_t header_size = sizeof(halide_trace_packet_t);
+        if (word < header_size || word > capacity) {
+            fprintf(stderr, "Packet larger than %d bytes in trace stream (%d)\n", (int)capacity, (int)word);
+            abort();
+            return false;
+        }
+        p->size = word;
+        if (!read_bytes((uint8_t *)p + sizeof(word), word - sizeof(word))) {
+            fprintf(stderr, "Unexpected EOF mid-packet");
+            return false;
+        }
+        return true;
     }
-    if (!Packet::read(payload, payload_size, fdesc)) {
-        fprintf(stderr, "Unexpected EOF mid-packet");
+    decode_packet(p, capacity);
+    return true;
+}
+
+bool TraceReader::read_block(uint32_t flags, uint32_t decoded_size, uint32_t stored_size) {
+    std::vector<uint8_t> stored(stored_size);
+    if (!read_bytes(stored.data(), stored_size)) {
         return false;
     }
+    if (flags & flag_reset) {
+        reset_stream();
+    }
+    if (flags & flag_lz) {
+        block.reserve(decoded_size);
+        lz_decompress(stored.data(), stored.size(), block);
+    } else {
+        block.swap(stored);
+    }
+    if (block.size() != decoded_size) {
+        corrupt_stream("bad block size");
+    }
     return true;
 }
 
-bool Packet::read(void *d, size_t size, FILE *fdesc) {
+uint32_t TraceReader::get_varint() {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (block_pos >= block.size()) {
+            corrupt_stream("truncated packet");
+        }
+        uint8_t b = block[block_pos++];
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return v;
+        }
+    }
+    corrupt_stream("bad varint");
+    return 0;
+}
+
+int32_t TraceReader::get_zigzag() {
+    uint32_t v = get_varint();
+    return (int32_t)((v >> 1) ^ (0 - (v & 1)));
+}
+
+void TraceReader::get_bytes(void *dst, size_t size) {
+    if (size > block.size() - block_pos) {
+        corrupt_stream("truncated packet");
+    }
+    memcpy(dst, block.data() + block_pos, size);
+    block_pos += size;
+}
+
+const std::string *TraceReader::decode_string(std::string *literal, int *index) {
+    uint32_t code = get_varint();
+    if (code >= 2) {
+        if (code - 2 >= strings.size()) {
+            corrupt_stream("bad string index");
+        }
+        *index = (int)(code - 2);
+        return &strings[code - 2];
+    }
+    literal->resize(get_varint());
+    get_bytes(&(*literal)[0], literal->size());
+    if (code == 0) {
+        *index = (int)strings.size();
+        strings.push_back(*literal);
+        last_coords.emplace_back(max_delta_coords, 0);
+        return &strings.back();
+    }
+    *index = -1;
+    return literal;
+}
+
+void TraceReader::decode_packet(halide_trace_packet_t *p, size_t capacity) {
+    std::string func_literal, tag_literal;
+    int func_idx, tag_idx;
+    const std::string *func = decode_string(&func_literal, &func_idx);
+    // Copy out the func name, as decoding the tag may grow the dictionary.
+    std::string func_name = *func;
+    const std::string *tag = decode_string(&tag_literal, &tag_idx);
+
+    uint8_t event;
+    get_bytes(&event, 1);
+    bool has_value = (event & 0x80) != 0;
+    p->event = (halide_trace_event_code_t)(event & 0x7f);
+    uint8_t type_bits[2];
+    get_bytes(type_bits, 2);
+    p->type.code = (halide_type_code_t)type_bits[0];
+    p->type.bits = type_bits[1];
+    p->type.lanes = (uint16_t)get_varint();
+    p->id = (int32_t)((uint32_t)last_id + (uint32_t)get_zigzag());
+    p->parent_id = (int32_t)((uint32_t)p->id - (uint32_t)get_zigzag());
+    last_id = p->id;
+    p->value_index = (int32_t)get_varint();
+    p->dimensions = (int32_t)get_varint();
+
+    // Recompute the size exactly as the runtime does.
+    size_t value_bytes = p->type.lanes * p->type.bytes();
+    size_t size = sizeof(halide_trace_packet_t) + value_bytes + p->dimensions * sizeof(int32_t) +
+                  func_name.size() + 1 + tag->size() + 1;
+    size = (size + 3) & ~3;
+    if (size > capacity) {
+        fprintf(stderr, "Packet larger than %d bytes in trace stream (%d)\n", (int)capacity, (int)size);
+        abort();
+    }
+    p->size = (uint32_t)size;
+    memset((void *)p->coordinates(), 0, size - sizeof(halide_trace_packet_t));
+
+    int32_t *coords = p->coordinates();
+    if (func_idx >= 0 && p->dimensions <= max_delta_coords) {
+        std::vector<int32_t> &last = last_coords[func_idx];
+        for (int i = 0; i < p->dimensions; i++) {
+            coords[i] = (int32_t)((uint32_t)last[i] + (uint32_t)get_zigzag());
+            last[i] = coords[i];
+        }
+    } else {
+        for (int i = 0; i < p->dimensions; i++) {
+            coords[i] = get_zigzag();
+        }
+    }
+
+    if (has_value) {
+        get_bytes(p->value(), value_bytes);
+    }
+    memcpy((void *)p->func(), func_name.c_str(), func_name.size() + 1);
+    memcpy((void *)p->trace_tag(), tag->c_str(), tag->size() + 1);
+}
+
+bool TraceReader::read_bytes(void *d, size_t size) {
     uint8_t *dst = (uint8_t *)d;
     if (!size) {
         return true;
@@ -4,6 +4,8 @@
 #include "HalideRuntime.h"
 #include <cstdio>
 #include <cstring>
+#include <string>
+#include <vector>
 
 namespace Halide {
 namespace Internal {
@@ -60,6 +62,46 @@ T value_as(halide_type_t type, const halide_scalar_value_t &value) {
     return (T)0;
 }
 
+// Reads trace packets from a file. Plain packets and the compressed
+// blocks written when the trace was produced with HL_TRACE_COMPRESS=1
+// (see src/runtime/tracing.cpp) may be freely mixed.
+class TraceReader {
+public:
+    explicit TraceReader(FILE *fdesc)
+        : fdesc(fdesc) {
+    }
+
+    // Read the next packet into 'p', which has room for 'capacity'
+    // bytes. Returns false at the end of the stream.
+    bool read(halide_trace_packet_t *p, size_t capacity);
+
+    // Go back to the start of the file.
+    void rewind();
+
+private:
+    FILE *fdesc;
+
+    // The decoded contents of the current compressed block.
+    std::vector<uint8_t> block;
+    size_t block_pos = 0;
+
+    // Decoder state, carried across the blocks of a stream.
+    std::vector<std::string> strings;
+    std::vector<std::vector<int32_t>> last_coords;
+    int32_t last_id = 0;
+
+    void reset_stream();
+    bool read_block(uint32_t flags, uint32_t decoded_size, uint32_t stored_size);
+    void decode_packet(halide_trace_packet_t *p, size_t capacity);
+    const std::string *decode_string(std::string *literal, int *index);
+    uint32_t get_varint();
+    int32_t get_zigzag();
+    void get_bytes(void *dst, size_t size);
+
+    // Do a blocking read of some number of bytes from the file.
+    bool read_bytes(void *d, size_t size);
+};
+
 // A struct representing a single Halide tracing packet.
 struct Packet : public halide_trace_packet_t {
     // Not all of this will be used, but this
@@ -83,15 +125,10 @@ struct Packet : public halide_trace_packet_t {
         return value_as<T>(type, aligned_value);
     }
 
-    // Grab a packet from stdin. Returns false when stdin closes.
-    bool read_from_stdin();
-
-    // Grab a packet from a particular fctl file descriptor. Returns false when end is reached.
-    bool read_from_filedesc(FILE *fdesc);
-
-private:
-    // Do a blocking read of some number of bytes from a unistd file descriptor.
-    bool read(void *d, size_t size, FILE *fdesc);
+    // Grab the next packet from a trace reader. Returns false when end is reached.
+    bool read_from(TraceReader &reader) {
+        return reader.read(this, sizeof(Packet));
+    }
 };
 
 }  // namespace Internal
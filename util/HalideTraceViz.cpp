@@ -1,13 +1,17 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <iostream>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifdef _MSC_VER
@@ -24,6 +28,7 @@
 #endif
 
 #include "HalideRuntime.h"
+#include "HalideTraceUtils.h"
 #include "inconsolata.h"
 
 #include "halide_trace_config.h"
@@ -151,37 +156,163 @@ T get_value_as(const halide_trace_packet_t &p, int idx) {
 struct PacketAndPayload : public halide_trace_packet_t {
     uint8_t payload[4096];
 
-    static bool read_or_die(void *buf, size_t count) {
-        char *p = (char *)buf;
-        char *p_end = p + count;
-        while (p < p_end) {
-            int64_t bytes_read = ::read(STDIN_FILENO, p, p_end - p);
-            if (bytes_read == 0) {
-                return false;  // EOF
-            } else if (bytes_read < 0) {
-                fail() << "Unable to read packet";
+    bool read(Internal::TraceReader &reader) {
+        return reader.read(this, sizeof(PacketAndPayload));
+    }
+};
+
+// Options that control which parts of the trace get replayed, and how.
+struct ReplayOptions {
+    // The number of threads to use for decoding and compositing.
+    int threads = 1;
+
+    // If non-empty, only these Funcs are drawn, and loads and stores
+    // of all other Funcs are dropped as they are decoded.
+    std::set<std::string> only_funcs;
+
+    // The range of frames to output. Frames before the first are not
+    // composited, and the trace stops being read after the last.
+    int first_frame = 0;
+    int last_frame = -1;
+
+    bool excludes(const char *func) const {
+        return !only_funcs.empty() && !only_funcs.count(func);
+    }
+};
+
+// Decodes trace packets from stdin in batches, on a separate thread
+// if more than one thread is allowed, so that decoding overlaps with
+// rendering.
+class PacketStream {
+    static constexpr size_t batch_bytes = 1 << 20;
+    static constexpr size_t max_batches = 4;
+
+    // Shared with the decoding thread, which may outlive the stream
+    // if we stop reading early.
+    struct Decoder {
+        Internal::TraceReader reader{stdin};
+        ReplayOptions options;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::vector<uint8_t>> batches;
+        bool finished = false, stopping = false;
+
+        // Decode about batch_bytes of packets. Returns false at the
+        // end of the trace.
+        bool decode_batch(std::vector<uint8_t> *batch) {
+            PacketAndPayload p;
+            while (batch->size() < batch_bytes) {
+                if (!p.read(reader)) {
+                    return false;
+                }
+                if ((p.event == halide_trace_load || p.event == halide_trace_store) &&
+                    options.excludes(p.func())) {
+                    continue;
+                }
+                const uint8_t *bytes = (const uint8_t *)&p;
+                batch->insert(batch->end(), bytes, bytes + p.size);
+            }
+            return true;
+        }
+
+        void run() {
+            bool more = true;
+            while (more) {
+                std::vector<uint8_t> batch;
+                more = decode_batch(&batch);
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return batches.size() < max_batches || stopping; });
+                if (stopping) {
+                    return;
+                }
+                batches.push_back(std::move(batch));
+                finished = !more;
+                cv.notify_all();
+            }
+        }
+    };
+
+    std::shared_ptr<Decoder> decoder;
+    std::thread thread;
+    std::vector<uint8_t> current;
+    size_t pos = 0;
+    bool eof = false;
+
+    bool refill() {
+        current.clear();
+        pos = 0;
+        if (!thread.joinable()) {
+            if (eof) {
+                return false;
             }
-            p += bytes_read;
+            eof = !decoder->decode_batch(&current);
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(decoder->mutex);
+        decoder->cv.wait(lock, [&] { return !decoder->batches.empty() || decoder->finished; });
+        if (decoder->batches.empty()) {
+            return false;
         }
-        assert(p == p_end);
+        current = std::move(decoder->batches.front());
+        decoder->batches.pop_front();
+        decoder->cv.notify_all();
         return true;
     }
 
-    bool read() {
-        constexpr size_t header_size = sizeof(halide_trace_packet_t);
-        if (!read_or_die(this, header_size)) {
-            return false;  // EOF
+public:
+    explicit PacketStream(const ReplayOptions &options)
+        : decoder(std::make_shared<Decoder>()) {
+        decoder->options = options;
+        if (options.threads > 1) {
+            std::shared_ptr<Decoder> d = decoder;
+            thread = std::thread([d]() { d->run(); });
         }
+    }
 
-        const size_t payload_size = this->size - header_size;
-        if (payload_size > sizeof(this->payload) || !read_or_die(this->payload, payload_size)) {
-            // Shouldn't ever get EOF here
-            fail() << "Unable to read packet payload of size " << payload_size;
+    ~PacketStream() {
+        if (thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(decoder->mutex);
+                decoder->stopping = true;
+                decoder->cv.notify_all();
+            }
+            // The decoder may be blocked reading stdin, so don't wait for it.
+            thread.detach();
         }
-        return true;
+    }
+
+    PacketStream(const PacketStream &) = delete;
+    void operator=(const PacketStream &) = delete;
+
+    // Get the next packet, or nullptr at the end of the trace. The
+    // packet is valid until the next call.
+    const halide_trace_packet_t *next() {
+        while (pos == current.size()) {
+            if (!refill()) {
+                return nullptr;
+            }
+        }
+        const halide_trace_packet_t *p = (const halide_trace_packet_t *)(current.data() + pos);
+        pos += p->size;
+        return p;
     }
 };
 
+// Call body(begin, end) on contiguous pieces of [0, n), in parallel.
+template<typename Fn>
+void parallel_chunks(size_t n, int threads, const Fn &body) {
+    constexpr size_t min_chunk = 1 << 16;
+    size_t chunk = std::max(min_chunk, (n + threads - 1) / std::max(1, threads));
+    std::vector<std::thread> workers;
+    for (size_t begin = chunk; begin < n; begin += chunk) {
+        workers.emplace_back([&body, begin, chunk, n]() { body(begin, std::min(n, begin + chunk)); });
+    }
+    body(0, std::min(n, chunk));
+    for (auto &w : workers) {
+        w.join();
+    }
+}
+
 // -------------------------------------------------------------
 
 // A struct specifying how a single Func will get visualized.
@@ -410,6 +541,17 @@ Funcs.
      tags in the trace data, overriding the auto-generated layouts.  This is
      the default.
 
+ --threads n: Decode the trace and composite frames using n threads.
+     Defaults to the number of cores.
+
+ --only func: Only draw the named Func. May be repeated. Loads and
+     stores of all other Funcs are dropped as soon as they are read.
+
+ --frames first last: Only output frames first through last
+     (inclusive, counting from zero). Earlier frames are not
+     composited, so highlights from them do not carry over, and the
+     rest of the trace is not read once the last frame is output.
+
  --help: Write this usage information to stdout, and exit.
 
  --verbose: Write additional informational messages to stderr.
@@ -850,6 +992,12 @@ void process_args(int argc, char **argv, VizState *state) {
             // Already processed, just continue
         } else if (next == "--verbose" || next == "--no-verbose") {
             // Already processed, just continue
+        } else if (next == "--threads" || next == "--only") {
+            // Already processed, just continue
+            i++;
+        } else if (next == "--frames") {
+            // Already processed, just continue
+            i += 2;
         } else {
             expect(false, i);
         }
@@ -861,6 +1009,7 @@ void process_args(int argc, char **argv, VizState *state) {
 // it, and text labels. These layers get composited.
 struct Surface {
     const Point frame_size;
+    const int threads;
     std::vector<uint32_t> image, anim, anim_decay, text_buf, blend;
 
     // Composite a single pixel of 'over' over a single pixel of 'under', writing the result into dst.
@@ -888,14 +1037,16 @@ struct Surface {
     void do_decay(int decay_factor, uint32_t *dst) {
         if (decay_factor != 1) {
             const uint32_t inv_d1 = (1 << 24) / std::max(1, decay_factor);
-            for (uint32_t *dst_end = dst + frame_elems(); dst < dst_end; ++dst) {
-                uint32_t color = *dst;
-                uint32_t rgb = color & 0x00ffffff;
-                uint32_t alpha = (color >> 24);
-                alpha *= inv_d1;
-                alpha &= 0xff000000;
-                *dst = alpha | rgb;
-            }
+            parallel_chunks(frame_elems(), threads, [=](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    uint32_t color = dst[i];
+                    uint32_t rgb = color & 0x00ffffff;
+                    uint32_t alpha = (color >> 24);
+                    alpha *= inv_d1;
+                    alpha &= 0xff000000;
+                    dst[i] = alpha | rgb;
+                }
+            });
         }
     }
 
@@ -968,8 +1119,9 @@ struct Surface {
     }
 
 public:
-    Surface(const Point &fs)
+    Surface(const Point &fs, int threads)
         : frame_size(fs),
+          threads(threads),
           image(frame_elems()),
           anim(frame_elems()),
           anim_decay(frame_elems()),
@@ -1038,24 +1190,31 @@ public:
 
     void composite() {
         // Composite text over anim over image
-        uint32_t *anim_decay_px = anim_decay.data();
-        uint32_t *anim_px = anim.data();
-        uint32_t *image_px = image.data();
-        uint32_t *text_px = text_buf.data();
-        uint32_t *blend_px = blend.data();
-        for (size_t i = 0; i < image.size(); i++) {
-            // anim over anim_decay -> anim_decay
-            composite_one(anim_decay_px, anim_px, anim_decay_px);
-            // anim_decay over image -> blend
-            composite_one(image_px, anim_decay_px, blend_px);
-            // text over blend -> blend
-            composite_one(blend_px, text_px, blend_px);
-            anim_decay_px++;
-            anim_px++;
-            image_px++;
-            text_px++;
-            blend_px++;
-        }
+        parallel_chunks(image.size(), threads, [this](size_t begin, size_t end) {
+            uint32_t *anim_decay_px = anim_decay.data() + begin;
+            uint32_t *anim_px = anim.data() + begin;
+            uint32_t *image_px = image.data() + begin;
+            uint32_t *text_px = text_buf.data() + begin;
+            uint32_t *blend_px = blend.data() + begin;
+            for (size_t i = begin; i < end; i++) {
+                // anim over anim_decay -> anim_decay
+                composite_one(anim_decay_px, anim_px, anim_decay_px);
+                // anim_decay over image -> blend
+                composite_one(image_px, anim_decay_px, blend_px);
+                // text over blend -> blend
+                composite_one(blend_px, text_px, blend_px);
+                anim_decay_px++;
+                anim_px++;
+                image_px++;
+                text_px++;
+                blend_px++;
+            }
+        });
+    }
+
+    // Drop the highlights of frames that are not being output.
+    void skip_animations() {
+        std::fill(anim_decay.begin(), anim_decay.end(), 0);
     }
 
     void decay_animations(int decay_factor_after_compute, int decay_factor_during_compute) {
@@ -1073,7 +1232,7 @@ public:
 
 using FlagProcessor = std::function<void(VizState *state)>;
 
-int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
+int run(bool ignore_trace_tags, const ReplayOptions &options, FlagProcessor flag_processor) {
     // State that determines how different funcs get drawn
     VizState state;
 
@@ -1109,7 +1268,7 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
         flag_processor(&state);
 
         // allocate the surface after all tags and flags are processed
-        surface = std::make_unique<Surface>(state.globals.frame_size);
+        surface = std::make_unique<Surface>(state.globals.frame_size, options.threads);
 
         if (state.globals.auto_layout_grid.x < 0 || state.globals.auto_layout_grid.y < 0) {
             int cells_needed = 0;
@@ -1150,6 +1309,7 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
 
     int layout_order = 0;
     std::list<std::pair<Label, int>> labels_being_drawn;
+    PacketStream packets(options);
     size_t end_counter = 0;
     size_t packet_clock = 0;
     for (;;) {
@@ -1167,6 +1327,11 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
             const int64_t frame_bytes = surface->frame_elems() * sizeof(uint32_t);
 
             while (halide_clock > video_clock) {
+                const int frame = (int)(video_clock / state.globals.timestep);
+                if (options.last_frame >= 0 && frame > options.last_frame) {
+                    break;
+                }
+
                 // Always render text last, since it's on top of everything
                 // and there's no need to re-render for every packet.
                 for (auto it = labels_being_drawn.begin(); it != labels_being_drawn.end();) {
@@ -1188,6 +1353,13 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
                     }
                 }
 
+                video_clock += state.globals.timestep;
+
+                if (frame < options.first_frame) {
+                    surface->skip_animations();
+                    continue;
+                }
+
                 // Composite text over anim over image
                 surface->composite();
 
@@ -1197,21 +1369,24 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
                     fail() << "Could not write frame to stdout.";
                 }
 
-                video_clock += state.globals.timestep;
-
                 surface->decay_animations(state.globals.decay_factor_after_compute, state.globals.decay_factor_during_compute);
             }
 
+            if (options.last_frame >= 0 && (int)(video_clock / state.globals.timestep) > options.last_frame) {
+                break;
+            }
+
             // Blank anim
             surface->clear_animations();
         }
 
         // Read a tracing packet
-        PacketAndPayload p;
-        if (!p.read()) {
+        const halide_trace_packet_t *next_packet = packets.next();
+        if (!next_packet) {
             end_counter++;
             continue;
         }
+        const halide_trace_packet_t &p = *next_packet;
         packet_clock++;
 
         // It's a pipeline begin/end event
@@ -1234,6 +1409,11 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
                 warn() << "trace_tags are only expected at the start of a visualization:"
                        << " (" << p.trace_tag() << ") for func (" << p.func() << ")";
             }
+            if (options.excludes(p.func()) &&
+                (FuncConfig::match(p.trace_tag()) || FuncTypeAndDim::match(p.trace_tag()))) {
+                // Keep excluded Funcs out of the layout.
+                continue;
+            }
             if (FuncConfig::match(p.trace_tag())) {
                 if (ignore_trace_tags) {
                     continue;
@@ -1290,7 +1470,7 @@ int run(bool ignore_trace_tags, FlagProcessor flag_processor) {
 
         // Draw the event
         FuncInfo &fi = state.funcs[qualified_name];
-        if (!fi.config_valid) {
+        if (!fi.config_valid || options.excludes(p.func())) {
             continue;
         }
 
@@ -1458,6 +1638,8 @@ int main(int argc, char **argv) {
     }
 
     bool ignore_trace_tags = false;
+    ReplayOptions options;
+    options.threads = std::max(1, (int)std::thread::hardware_concurrency());
     for (int i = 1; i < argc; ++i) {
         if (!strcmp(argv[i], "--help")) {
             std::cout << usage();
@@ -1470,6 +1652,13 @@ int main(int argc, char **argv) {
             verbose = true;
         } else if (!strcmp(argv[i], "--no-verbose")) {
             verbose = false;
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            options.threads = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--only") && i + 1 < argc) {
+            options.only_funcs.insert(argv[++i]);
+        } else if (!strcmp(argv[i], "--frames") && i + 2 < argc) {
+            options.first_frame = atoi(argv[++i]);
+            options.last_frame = atoi(argv[++i]);
         }
     }
 
@@ -1482,5 +1671,5 @@ int main(int argc, char **argv) {
     _setmode(STDOUT_FILENO, _O_BINARY);
 #endif
 
-    run(ignore_trace_tags, flag_processor);
+    run(ignore_trace_tags, options, flag_processor);
 }